@@ -59,6 +59,22 @@ err_t ethernetif_init(struct netif *netif);
  */
 esp_netif_recv_ret_t ethernetif_input(void *h, void *buffer, size_t len, void *l2_buff);
 
+/**
+ * @brief   Early input filter of the Ethernet interfaces
+ * @param netif LWIP's network interface handle
+ * @param p Received frame, starting with the Ethernet header
+ * @return true if the filter took over the frame, it then has to free it;
+ *         false to post it to the tcpip_thread as usual
+ * @note Called in the context of the Ethernet driver's receive task
+ */
+typedef bool (*ethernetif_input_filter_fn_t)(struct netif *netif, struct pbuf *p);
+
+/**
+ * @brief   Install the early input filter of the Ethernet interfaces
+ * @param filter Filter function, NULL to remove it
+ */
+void ethernetif_set_input_filter(ethernetif_input_filter_fn_t filter);
+
 /**
  * @brief   LWIP's network stack init function for WiFi (AP)
  * @param netif LWIP's network interface handle
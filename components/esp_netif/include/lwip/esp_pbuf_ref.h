@@ -17,6 +17,17 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Statistics of the custom pbufs of received frames
+ */
+typedef struct {
+    uint32_t pool_size;      /*!< preallocated pbufs, CONFIG_OPENER_ETH_RX_PBUF_POOL */
+    uint32_t pool_free;      /*!< preallocated pbufs not holding a frame now */
+    uint32_t pool_free_min;  /*!< lowest pool_free since boot */
+    uint32_t pooled;         /*!< frames given a preallocated pbuf */
+    uint32_t allocated;      /*!< frames given a pbuf from the heap, the pool was empty */
+} esp_pbuf_stats_t;
+
 /**
  * @brief Allocate custom pbuf containing pointer to a private l2-free function
  *
@@ -24,6 +35,11 @@ extern "C" {
  */
 struct pbuf* esp_pbuf_allocate(esp_netif_t *esp_netif, void *buffer, size_t len, void *l2_buff);
 
+/**
+ * @brief Get the statistics of the custom pbufs, may be called from any task
+ */
+void esp_pbuf_get_stats(esp_pbuf_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
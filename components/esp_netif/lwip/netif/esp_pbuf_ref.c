@@ -12,6 +12,12 @@
 #include "lwip/mem.h"
 #include "lwip/esp_pbuf_ref.h"
 #include "esp_netif_net_stack.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_OPENER_ETH_RX_PBUF_POOL
+#define CONFIG_OPENER_ETH_RX_PBUF_POOL 0
+#endif
 
 /**
  * @brief Specific pbuf structure for pbufs allocated by ESP netif
@@ -22,8 +28,76 @@ typedef struct esp_custom_pbuf
     struct pbuf_custom p;
     esp_netif_t *esp_netif;
     void* l2_buf;
+    struct esp_custom_pbuf *next; /* in the free list of the pool */
 } esp_custom_pbuf_t;
 
+/* Preallocated custom pbufs, so a received frame needs no allocation of its
+ * own besides the driver's buffer. Taken by the receive task and returned by
+ * whichever task frees the frame; beyond the pool they come from the heap */
+#if CONFIG_OPENER_ETH_RX_PBUF_POOL > 0
+static esp_custom_pbuf_t s_pool[CONFIG_OPENER_ETH_RX_PBUF_POOL];
+#endif
+static esp_custom_pbuf_t *s_pool_free = NULL;
+static bool s_pool_linked = false;
+static esp_pbuf_stats_t s_stats = {
+    .pool_size = CONFIG_OPENER_ETH_RX_PBUF_POOL,
+    .pool_free = CONFIG_OPENER_ETH_RX_PBUF_POOL,
+    .pool_free_min = CONFIG_OPENER_ETH_RX_PBUF_POOL,
+};
+static portMUX_TYPE s_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_custom_pbuf_t *esp_pbuf_take(void)
+{
+    portENTER_CRITICAL(&s_pool_lock);
+#if CONFIG_OPENER_ETH_RX_PBUF_POOL > 0
+    if (!s_pool_linked) {
+        for (size_t i = 0; i < CONFIG_OPENER_ETH_RX_PBUF_POOL; i++) {
+            s_pool[i].next = s_pool_free;
+            s_pool_free = &s_pool[i];
+        }
+    }
+#endif
+    s_pool_linked = true;
+    esp_custom_pbuf_t *esp_pbuf = s_pool_free;
+    if (esp_pbuf != NULL) {
+        s_pool_free = esp_pbuf->next;
+        s_stats.pool_free--;
+        if (s_stats.pool_free < s_stats.pool_free_min) {
+            s_stats.pool_free_min = s_stats.pool_free;
+        }
+        s_stats.pooled++;
+    } else {
+        s_stats.allocated++;
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+    if (esp_pbuf == NULL) {
+        esp_pbuf = mem_malloc(sizeof(esp_custom_pbuf_t));
+    }
+    return esp_pbuf;
+}
+
+static void esp_pbuf_give(esp_custom_pbuf_t *esp_pbuf)
+{
+#if CONFIG_OPENER_ETH_RX_PBUF_POOL > 0
+    if (esp_pbuf >= &s_pool[0] && esp_pbuf < &s_pool[CONFIG_OPENER_ETH_RX_PBUF_POOL]) {
+        portENTER_CRITICAL(&s_pool_lock);
+        esp_pbuf->next = s_pool_free;
+        s_pool_free = esp_pbuf;
+        s_stats.pool_free++;
+        portEXIT_CRITICAL(&s_pool_lock);
+        return;
+    }
+#endif
+    mem_free(esp_pbuf);
+}
+
+void esp_pbuf_get_stats(esp_pbuf_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_pool_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_pool_lock);
+}
+
 /**
  * @brief Free custom pbuf containing the L2 layer buffer allocated in the driver
  *
@@ -34,7 +108,7 @@ static void esp_pbuf_free(struct pbuf *pbuf)
 {
     esp_custom_pbuf_t* esp_pbuf = (esp_custom_pbuf_t*)pbuf;
     esp_netif_free_rx_buffer(esp_pbuf->esp_netif, esp_pbuf->l2_buf);
-    mem_free(pbuf);
+    esp_pbuf_give(esp_pbuf);
 }
 
 /**
@@ -49,7 +123,7 @@ struct pbuf* esp_pbuf_allocate(esp_netif_t *esp_netif, void *buffer, size_t len,
 {
     struct pbuf *p;
 
-    esp_custom_pbuf_t* esp_pbuf  = mem_malloc(sizeof(esp_custom_pbuf_t));
+    esp_custom_pbuf_t* esp_pbuf  = esp_pbuf_take();
     if (esp_pbuf == NULL) {
         return NULL;
     }
@@ -58,7 +132,7 @@ struct pbuf* esp_pbuf_allocate(esp_netif_t *esp_netif, void *buffer, size_t len,
     esp_pbuf->l2_buf = l2_buff;
     p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &esp_pbuf->p, buffer, len);
     if (p == NULL) {
-        mem_free(esp_pbuf);
+        esp_pbuf_give(esp_pbuf);
         return NULL;
     }
     return p;
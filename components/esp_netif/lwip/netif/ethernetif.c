@@ -28,6 +28,14 @@
 #define IFNAME0 'e'
 #define IFNAME1 'n'
 
+/* Frames are offered to this filter before they are posted to the tcpip_thread */
+static volatile ethernetif_input_filter_fn_t s_input_filter = NULL;
+
+void ethernetif_set_input_filter(ethernetif_input_filter_fn_t filter)
+{
+    s_input_filter = filter;
+}
+
 /**
  * In this function, the hardware should be initialized.
  * Invoked by ethernetif_init().
@@ -135,6 +143,10 @@ esp_netif_recv_ret_t ethernetif_input(void *h, void *buffer, size_t len, void *l
         esp_netif_free_rx_buffer(esp_netif, buffer);
         return ESP_NETIF_OPTIONAL_RETURN_CODE(ESP_ERR_NO_MEM);
     }
+    ethernetif_input_filter_fn_t filter = s_input_filter;
+    if (filter != NULL && filter(netif, p)) {
+        return ESP_NETIF_OPTIONAL_RETURN_CODE(ESP_OK);
+    }
     /* full packet send to tcpip_thread to process */
     if (unlikely(netif->input(p, netif) != ERR_OK)) {
         LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_input: IP input error\n"));
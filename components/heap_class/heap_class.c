@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "heap_class.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define HEAP_CLASS_INTERNAL (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define HEAP_CLASS_RESERVE ((size_t)CONFIG_HEAP_CLASS_INTERNAL_RESERVE_KB * 1024U)
+
+static const char *const s_names[HEAP_CLASS_COUNT] = {
+    [HEAP_CLASS_HOT_IO] = "hot_io",
+    [HEAP_CLASS_NETWORK] = "network",
+    [HEAP_CLASS_BULK] = "bulk",
+    [HEAP_CLASS_SCRATCH] = "scratch",
+};
+
+static heap_class_stats_t s_stats[HEAP_CLASS_COUNT];
+// Allocations run in the OpENer task, the I/O scan and the web UI handlers
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool is_cold(heap_class_t cls)
+{
+    return cls == HEAP_CLASS_BULK || cls == HEAP_CLASS_SCRATCH;
+}
+
+static void *allocate(heap_class_t cls, size_t size)
+{
+    if (!is_cold(cls)) {
+        return heap_caps_malloc(size, HEAP_CLASS_INTERNAL);
+    }
+#if CONFIG_SPIRAM
+    void *ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (ptr != NULL) {
+        return ptr;
+    }
+#endif
+    // Checked without a lock, another task may allocate in between; the
+    // reserve is a margin, not a guarantee
+    if (heap_caps_get_largest_free_block(HEAP_CLASS_INTERNAL) < size + HEAP_CLASS_RESERVE) {
+        taskENTER_CRITICAL(&s_lock);
+        s_stats[cls].refused++;
+        taskEXIT_CRITICAL(&s_lock);
+        return NULL;
+    }
+    return heap_caps_malloc(size, HEAP_CLASS_INTERNAL);
+}
+
+void *heap_class_malloc(heap_class_t cls, size_t size)
+{
+    if (cls >= HEAP_CLASS_COUNT) {
+        return NULL;
+    }
+    void *ptr = allocate(cls, size);
+    const uint32_t allocated = (ptr != NULL) ? (uint32_t)heap_caps_get_allocated_size(ptr) : 0;
+    taskENTER_CRITICAL(&s_lock);
+    heap_class_stats_t *stats = &s_stats[cls];
+    if (ptr == NULL) {
+        stats->failures++;
+    } else {
+        stats->allocations++;
+        stats->in_use += allocated;
+        if (stats->in_use > stats->peak) {
+            stats->peak = stats->in_use;
+        }
+        if (esp_ptr_external_ram(ptr)) {
+            stats->external += allocated;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ptr;
+}
+
+void *heap_class_calloc(heap_class_t cls, size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *ptr = heap_class_malloc(cls, count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void heap_class_free(heap_class_t cls, void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    if (cls < HEAP_CLASS_COUNT) {
+        const uint32_t allocated = (uint32_t)heap_caps_get_allocated_size(ptr);
+        const bool external = esp_ptr_external_ram(ptr);
+        taskENTER_CRITICAL(&s_lock);
+        s_stats[cls].in_use -= allocated;
+        if (external) {
+            s_stats[cls].external -= allocated;
+        }
+        taskEXIT_CRITICAL(&s_lock);
+    }
+    heap_caps_free(ptr);
+}
+
+void heap_class_get_stats(heap_class_t cls, heap_class_stats_t *stats)
+{
+    if (cls >= HEAP_CLASS_COUNT) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    taskENTER_CRITICAL(&s_lock);
+    *stats = s_stats[cls];
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+const char *heap_class_name(heap_class_t cls)
+{
+    return (cls < HEAP_CLASS_COUNT) ? s_names[cls] : "unknown";
+}
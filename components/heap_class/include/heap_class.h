@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief What a buffer is used for, which decides the RAM it comes from
+ *
+ * Hot and network buffers take internal RAM only. Cold buffers prefer
+ * PSRAM; in internal RAM they may only take a block that leaves
+ * CONFIG_HEAP_CLASS_INTERNAL_RESERVE_KB in the largest free block, so large
+ * cold buffers and short lived web scratch cannot split the internal heap
+ * that the I/O path and the stack need.
+ */
+typedef enum {
+    HEAP_CLASS_HOT_IO = 0,  ///< touched on every I/O scan, e.g. expander handles, I2C job lists
+    HEAP_CLASS_NETWORK,     ///< CIP object model and connection data of the stack
+    HEAP_CLASS_BULK,        ///< large long lived buffers, e.g. the I/O history
+    HEAP_CLASS_SCRATCH,     ///< short lived web UI buffers, e.g. parsed JSON
+    HEAP_CLASS_COUNT
+} heap_class_t;
+
+/**
+ * @brief Usage of one heap class since boot
+ */
+typedef struct {
+    uint32_t in_use;       ///< bytes allocated now, as the heap counts them
+    uint32_t peak;         ///< most bytes allocated at once
+    uint32_t external;     ///< bytes of in_use that are in PSRAM
+    uint32_t allocations;  ///< successful allocations
+    uint32_t failures;     ///< allocations no permitted RAM could hold
+    uint32_t refused;      ///< cold internal allocations refused by the reserve
+} heap_class_stats_t;
+
+/**
+ * @brief Allocate memory of a heap class
+ *
+ * @param cls Use of the memory
+ * @param size Bytes to allocate
+ * @return Memory aligned for any type, NULL if the class has none left
+ */
+void *heap_class_malloc(heap_class_t cls, size_t size);
+
+/**
+ * @brief Allocate zeroed memory of a heap class, see heap_class_malloc()
+ */
+void *heap_class_calloc(heap_class_t cls, size_t count, size_t size);
+
+/**
+ * @brief Free memory allocated with the same class, accepts NULL
+ */
+void heap_class_free(heap_class_t cls, void *ptr);
+
+/**
+ * @brief Copy the usage of a class, may be called from any task
+ */
+void heap_class_get_stats(heap_class_t cls, heap_class_stats_t *stats);
+
+/**
+ * @brief Name of a class for logs and the web UI, e.g. "hot_io"
+ */
+const char *heap_class_name(heap_class_t cls);
+
+#ifdef __cplusplus
+}
+#endif
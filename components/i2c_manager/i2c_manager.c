@@ -21,33 +21,65 @@
  */
 
 #include "i2c_manager.h"
+#include "heap_class.h"
 #include "esp_log.h"
 #include "driver/i2c_master.h"
+#include <stdlib.h>
+#include <string.h>
 
 static const char *TAG = "i2c_manager";
 
+#define I2C_MANAGER_DEFAULT_GLITCH_IGNORE_CNT 7
+
+// START, address, and the data of a read (ACKed bytes and the NACKed last
+// byte) or a write
+#define I2C_MANAGER_JOBS_PER_OP 4
+
+struct i2c_manager_scan {
+    i2c_master_dev_handle_t dev_handle;
+    i2c_manager_op_t *ops;
+    size_t num_ops;
+    uint8_t *address_bytes;
+    i2c_operation_job_t *jobs;
+    size_t num_jobs;           // without the final STOP
+    size_t *op_first_job;      // first job of each op
+};
+
 static i2c_master_bus_handle_t s_bus_handle = NULL;
 static bool s_initialized = false;
 static uint32_t s_bus_freq_hz = 0;
+static uint32_t s_recovery_count = 0;
+static int s_sda_gpio = -1;
+static int s_scl_gpio = -1;
 
-esp_err_t i2c_manager_init(int sda_gpio, int scl_gpio, uint32_t freq_hz) {
-    if (s_initialized) {
-        ESP_LOGW(TAG, "I2C manager already initialized");
-        return ESP_OK;
-    }
-
+static esp_err_t i2c_manager_create_bus(uint8_t glitch_ignore_cnt) {
     i2c_master_bus_config_t bus_cfg = {
         .i2c_port = I2C_NUM_0,
-        .sda_io_num = sda_gpio,
-        .scl_io_num = scl_gpio,
+        .sda_io_num = s_sda_gpio,
+        .scl_io_num = s_scl_gpio,
         .clk_source = I2C_CLK_SRC_DEFAULT,
-        .glitch_ignore_cnt = 7,
+        .glitch_ignore_cnt = glitch_ignore_cnt,
         .flags.enable_internal_pullup = true,
     };
 
     esp_err_t ret = i2c_new_master_bus(&bus_cfg, &s_bus_handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to create I2C master bus: %s", esp_err_to_name(ret));
+        s_bus_handle = NULL;
+    }
+    return ret;
+}
+
+esp_err_t i2c_manager_init(int sda_gpio, int scl_gpio, uint32_t freq_hz) {
+    if (s_initialized) {
+        ESP_LOGW(TAG, "I2C manager already initialized");
+        return ESP_OK;
+    }
+
+    s_sda_gpio = sda_gpio;
+    s_scl_gpio = scl_gpio;
+    esp_err_t ret = i2c_manager_create_bus(I2C_MANAGER_DEFAULT_GLITCH_IGNORE_CNT);
+    if (ret != ESP_OK) {
         return ret;
     }
 
@@ -59,6 +91,29 @@ esp_err_t i2c_manager_init(int sda_gpio, int scl_gpio, uint32_t freq_hz) {
     return ESP_OK;
 }
 
+esp_err_t i2c_manager_reinit(uint32_t freq_hz, uint8_t glitch_ignore_cnt) {
+    if (!s_initialized) {
+        ESP_LOGE(TAG, "I2C manager not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Fails while a device is still attached, the old bus is kept then
+    esp_err_t ret = i2c_del_master_bus(s_bus_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to delete I2C master bus: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    s_bus_handle = NULL;
+
+    ret = i2c_manager_create_bus(glitch_ignore_cnt);
+    if (ret != ESP_OK) {
+        s_initialized = false;
+        return ret;
+    }
+    s_bus_freq_hz = freq_hz;
+    return ESP_OK;
+}
+
 esp_err_t i2c_manager_deinit(void) {
     if (!s_initialized) {
         return ESP_OK;
@@ -109,3 +164,160 @@ esp_err_t i2c_manager_get_freq(uint32_t *freq_hz) {
     *freq_hz = s_bus_freq_hz;
     return ESP_OK;
 }
+
+esp_err_t i2c_manager_recover_bus(void) {
+    if (!s_initialized) {
+        ESP_LOGE(TAG, "I2C manager not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_recovery_count++;
+    // Bit-bangs the SCL pulses and the STOP, then re-initializes the
+    // controller and the pins
+    esp_err_t ret = i2c_master_bus_reset(s_bus_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "I2C bus recovery failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+uint32_t i2c_manager_get_recovery_count(void) {
+    return s_recovery_count;
+}
+
+static size_t i2c_manager_add_op_jobs(const i2c_manager_op_t *op, uint8_t *address_byte,
+                                      i2c_operation_job_t *jobs) {
+    size_t count = 0;
+    jobs[count++] = (i2c_operation_job_t) {
+        .command = I2C_MASTER_CMD_START,
+    };
+    *address_byte = (uint8_t)((op->address << 1) | (op->type == I2C_MANAGER_OP_READ ? 1 : 0));
+    jobs[count++] = (i2c_operation_job_t) {
+        .command = I2C_MASTER_CMD_WRITE,
+        .write = { .ack_check = true, .data = address_byte, .total_bytes = 1 },
+    };
+
+    if (op->type == I2C_MANAGER_OP_WRITE) {
+        jobs[count++] = (i2c_operation_job_t) {
+            .command = I2C_MASTER_CMD_WRITE,
+            .write = { .ack_check = true, .data = op->data, .total_bytes = op->length },
+        };
+        return count;
+    }
+
+    // The last byte of a read is NACKed to end it
+    if (op->length > 1) {
+        jobs[count++] = (i2c_operation_job_t) {
+            .command = I2C_MASTER_CMD_READ,
+            .read = { .ack_value = I2C_ACK_VAL, .data = op->data, .total_bytes = op->length - 1 },
+        };
+    }
+    jobs[count++] = (i2c_operation_job_t) {
+        .command = I2C_MASTER_CMD_READ,
+        .read = { .ack_value = I2C_NACK_VAL, .data = op->data + op->length - 1, .total_bytes = 1 },
+    };
+    return count;
+}
+
+esp_err_t i2c_manager_create_scan(i2c_manager_op_t *ops, size_t num_ops,
+                                  i2c_manager_scan_handle_t *scan) {
+    if (ops == NULL || num_ops == 0 || scan == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < num_ops; i++) {
+        if (ops[i].data == NULL || ops[i].length == 0 || ops[i].address > 0x7F) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (!s_initialized) {
+        ESP_LOGE(TAG, "I2C manager not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    struct i2c_manager_scan *list = heap_class_calloc(HEAP_CLASS_HOT_IO, 1, sizeof(*list));
+    if (list == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    list->address_bytes = heap_class_calloc(HEAP_CLASS_HOT_IO, num_ops, sizeof(*list->address_bytes));
+    list->op_first_job = heap_class_calloc(HEAP_CLASS_HOT_IO, num_ops, sizeof(*list->op_first_job));
+    list->jobs = heap_class_calloc(HEAP_CLASS_HOT_IO, num_ops * I2C_MANAGER_JOBS_PER_OP + 1,
+                                   sizeof(*list->jobs));
+    if (list->address_bytes == NULL || list->op_first_job == NULL || list->jobs == NULL) {
+        i2c_manager_delete_scan(list);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The addresses are part of the command list, the device only lends the
+    // bus and its clock speed
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = I2C_DEVICE_ADDRESS_NOT_USED,
+        .scl_speed_hz = s_bus_freq_hz,
+    };
+    esp_err_t ret = i2c_master_bus_add_device(s_bus_handle, &dev_cfg, &list->dev_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add the scan list device: %s", esp_err_to_name(ret));
+        list->dev_handle = NULL;
+        i2c_manager_delete_scan(list);
+        return ret;
+    }
+
+    list->ops = ops;
+    list->num_ops = num_ops;
+    for (size_t i = 0; i < num_ops; i++) {
+        list->op_first_job[i] = list->num_jobs;
+        list->num_jobs += i2c_manager_add_op_jobs(&ops[i], &list->address_bytes[i],
+                                                  &list->jobs[list->num_jobs]);
+    }
+    list->jobs[list->num_jobs] = (i2c_operation_job_t) {
+        .command = I2C_MASTER_CMD_STOP,
+    };
+
+    *scan = list;
+    return ESP_OK;
+}
+
+esp_err_t i2c_manager_execute_scan(i2c_manager_scan_handle_t scan, int timeout_ms) {
+    if (scan == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = i2c_master_execute_defined_operations(scan->dev_handle, scan->jobs,
+                                                          scan->num_jobs + 1, timeout_ms);
+    if (ret == ESP_OK || ret == ESP_ERR_TIMEOUT) {
+        for (size_t i = 0; i < scan->num_ops; i++) {
+            scan->ops[i].result = ret;
+        }
+        return ret;
+    }
+
+    // Find the failing device: each op as a transaction of its own
+    for (size_t i = 0; i < scan->num_ops; i++) {
+        const size_t first = scan->op_first_job[i];
+        const size_t count = ((i + 1 < scan->num_ops) ? scan->op_first_job[i + 1] :
+                              scan->num_jobs) - first;
+        i2c_operation_job_t jobs[I2C_MANAGER_JOBS_PER_OP + 1];
+        memcpy(jobs, &scan->jobs[first], count * sizeof(jobs[0]));
+        jobs[count] = (i2c_operation_job_t) {
+            .command = I2C_MASTER_CMD_STOP,
+        };
+        scan->ops[i].result = i2c_master_execute_defined_operations(scan->dev_handle, jobs,
+                                                                    count + 1, timeout_ms);
+    }
+    return ret;
+}
+
+esp_err_t i2c_manager_delete_scan(i2c_manager_scan_handle_t scan) {
+    if (scan == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (scan->dev_handle != NULL) {
+        i2c_master_bus_rm_device(scan->dev_handle);
+    }
+    heap_class_free(HEAP_CLASS_HOT_IO, scan->jobs);
+    heap_class_free(HEAP_CLASS_HOT_IO, scan->op_first_job);
+    heap_class_free(HEAP_CLASS_HOT_IO, scan->address_bytes);
+    heap_class_free(HEAP_CLASS_HOT_IO, scan);
+    return ESP_OK;
+}
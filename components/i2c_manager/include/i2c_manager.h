@@ -39,6 +39,21 @@ extern "C" {
  */
 esp_err_t i2c_manager_init(int sda_gpio, int scl_gpio, uint32_t freq_hz);
 
+/**
+ * @brief Re-create the bus with another clock speed and glitch filter
+ *
+ * Keeps the pins of i2c_manager_init(). No device may be attached to the
+ * bus, so this is for the time before the drivers are set up. Scan lists
+ * created afterwards run at the new speed.
+ *
+ * @param freq_hz I2C bus frequency in Hz
+ * @param glitch_ignore_cnt Pulses shorter than this many I2C module clock
+ *        cycles are filtered out, i2c_manager_init() uses 7
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         error code otherwise
+ */
+esp_err_t i2c_manager_reinit(uint32_t freq_hz, uint8_t glitch_ignore_cnt);
+
 /**
  * @brief Deinitialize the I2C manager
  *
@@ -69,6 +84,88 @@ bool i2c_manager_is_initialized(void);
  */
 esp_err_t i2c_manager_get_freq(uint32_t *freq_hz);
 
+/**
+ * @brief Free a stuck bus and re-initialize the controller
+ *
+ * Clocks SCL until a device holding SDA low releases it, sends a STOP and
+ * resets the controller state machine. Meant for the task that found the
+ * bus faulted: no other transaction may be running on it, the driver does
+ * not lock the bus for the reset.
+ *
+ * @return ESP_OK if SDA is released, error code otherwise
+ */
+esp_err_t i2c_manager_recover_bus(void);
+
+/**
+ * @brief Number of i2c_manager_recover_bus() calls since initialization
+ */
+uint32_t i2c_manager_get_recovery_count(void);
+
+/**
+ * @brief Kind of one access of a scan list
+ */
+typedef enum {
+    I2C_MANAGER_OP_READ,       ///< read length bytes from the device
+    I2C_MANAGER_OP_WRITE,      ///< write length bytes to the device
+} i2c_manager_op_type_t;
+
+/**
+ * @brief One device access of a scan list
+ *
+ * The buffer stays owned by the caller. It is read or written every time the
+ * list is executed, so a write sends whatever it holds at that time.
+ */
+typedef struct {
+    i2c_manager_op_type_t type;
+    uint8_t address;           ///< 7-bit device address
+    uint8_t *data;             ///< receives the read bytes, or holds the bytes to write
+    size_t length;             ///< at least 1
+    esp_err_t result;          ///< outcome of the access, set by i2c_manager_execute_scan()
+} i2c_manager_op_t;
+
+typedef struct i2c_manager_scan *i2c_manager_scan_handle_t;
+
+/**
+ * @brief Register a list of device accesses that is executed as one batch
+ *
+ * The I2C commands of the whole list are built once. Every access starts
+ * with a (repeated) START and the address, the list ends with a single STOP.
+ *
+ * @param ops Accesses in bus order, must stay valid until the list is deleted
+ * @param num_ops Number of accesses
+ * @param scan Pointer to store the list handle
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         ESP_ERR_NO_MEM, error code otherwise
+ */
+esp_err_t i2c_manager_create_scan(i2c_manager_op_t *ops, size_t num_ops,
+                                  i2c_manager_scan_handle_t *scan);
+
+/**
+ * @brief Run all accesses of a scan list back to back
+ *
+ * One driver transaction carries the whole list, so the accesses follow each
+ * other on the wire without a task switch or driver setup in between. If the
+ * batch fails, e.g. because one device does not acknowledge, every access is
+ * retried on its own so the result of each op tells which one failed. A
+ * timeout is a fault of the bus, not of a device, and is not retried; every
+ * op gets ESP_ERR_TIMEOUT.
+ *
+ * Blocks the calling task until the list completed or timed out.
+ *
+ * @param scan List handle
+ * @param timeout_ms Timeout of the batch and of each retried access
+ * @return ESP_OK if every access succeeded, else the error of the batch
+ */
+esp_err_t i2c_manager_execute_scan(i2c_manager_scan_handle_t scan, int timeout_ms);
+
+/**
+ * @brief Delete a scan list
+ *
+ * @param scan List handle
+ * @return ESP_OK on success
+ */
+esp_err_t i2c_manager_delete_scan(i2c_manager_scan_handle_t scan);
+
 #ifdef __cplusplus
 }
 #endif
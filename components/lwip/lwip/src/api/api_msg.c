@@ -770,6 +770,16 @@ netconn_alloc(enum netconn_type t, netconn_callback callback)
       goto free_and_return;
   }
 
+#if CONFIG_OPENER_LWIP_RING_MBOX
+  /* MODIFICATION: UDP receive mailboxes use the lock-free ring mailbox of
+   * the ESP32 port (sys_arch.c), see CONFIG_OPENER_LWIP_RING_MBOX.
+   */
+  if (NETCONNTYPE_GROUP(t) == NETCONN_UDP) {
+    if (sys_mbox_new_ring(&conn->recvmbox, size) != ERR_OK) {
+      goto free_and_return;
+    }
+  } else
+#endif
   if (sys_mbox_new(&conn->recvmbox, size) != ERR_OK) {
     goto free_and_return;
   }
@@ -653,7 +653,14 @@ tcpip_init(tcpip_init_done_fn initfunc, void *arg)
 
   tcpip_init_done = initfunc;
   tcpip_init_done_arg = arg;
+#if CONFIG_OPENER_LWIP_RING_MBOX
+  /* MODIFICATION: lock-free ring mailbox of the ESP32 port (sys_arch.c)
+   * Added for the OpENer ESP32 port, see CONFIG_OPENER_LWIP_RING_MBOX.
+   */
+  if (sys_mbox_new_ring(&tcpip_mbox, TCPIP_MBOX_SIZE) != ERR_OK) {
+#else
   if (sys_mbox_new(&tcpip_mbox, TCPIP_MBOX_SIZE) != ERR_OK) {
+#endif
     LWIP_ASSERT("failed to create tcpip_thread mbox", 0);
   }
 #if LWIP_TCPIP_CORE_LOCKING
@@ -95,8 +95,7 @@
  *    - Impact: Conflict detection still logs via LWIP_DEBUGF (when enabled)
  *
  * 2. OPENER ETHERNET/IP INTEGRATION (lines ~79-90):
- *    - Added forward declarations for CipTcpIpSetLastAcdMac and
- *      CipTcpIpSetLastAcdRawData functions
+ *    - Added a forward declaration of CipTcpIpSetLastAcdConflict()
  *    - Rationale: EtherNet/IP TCP/IP Interface Object Attribute #11 requires
  *      storage of conflict data (MAC address and ARP frame) for diagnostic
  *      purposes. These functions are called when conflicts are detected.
@@ -118,10 +117,11 @@
  *    - Falls back to RFC 5227 defaults when CONFIG_OPENER_ACD_CUSTOM_TIMING=n
  *
  * 5. ARP FRAME CAPTURE FOR ETHERNET/IP (lines ~496-498, ~517-518):
- *    - Added calls to CipTcpIpSetLastAcdMac() and CipTcpIpSetLastAcdRawData()
- *      at conflict detection points
- *    - Rationale: EtherNet/IP Attribute #11 requires storage of conflicting
- *      device MAC address and raw ARP frame data for diagnostic purposes
+ *    - Added calls to CipTcpIpSetLastAcdConflict() at conflict detection
+ *      points, with AcdActivity 1 while probing and 2 while defending
+ *    - Rationale: EtherNet/IP Attribute #11 requires storage of the ACD
+ *      activity, conflicting device MAC address and raw ARP frame data for
+ *      diagnostic purposes; they are recorded in one update
  *
  ******************************************************************************/
 
@@ -135,8 +135,8 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
-extern void CipTcpIpSetLastAcdMac(const uint8_t mac[6]);
-extern void CipTcpIpSetLastAcdRawData(const uint8_t *data, size_t length);
+extern void CipTcpIpSetLastAcdConflict(uint8_t activity, const uint8_t mac[6],
+                                       const uint8_t *data, size_t length);
 #ifdef __cplusplus
 }
 #endif
@@ -733,8 +733,9 @@ acd_arp_reply(struct netif *netif, struct etharp_hdr *hdr)
            * Added by: Adam G. Sweeney <agsweeney@gmail.com>
            * This data is required by EtherNet/IP specification for Attribute #11 "Last Conflict Detected"
            */
-          CipTcpIpSetLastAcdMac(hdr->shwaddr.addr);
-          CipTcpIpSetLastAcdRawData((const uint8_t *)hdr, sizeof(struct etharp_hdr));
+          /* AcdActivity 1: conflict while probing */
+          CipTcpIpSetLastAcdConflict(1, hdr->shwaddr.addr,
+                                     (const uint8_t *)hdr, sizeof(struct etharp_hdr));
           
           acd_restart(netif, acd);
         }
@@ -769,8 +770,9 @@ acd_arp_reply(struct netif *netif, struct etharp_hdr *hdr)
            * Added by: Adam G. Sweeney <agsweeney@gmail.com>
            * This data is required by EtherNet/IP specification for Attribute #11 "Last Conflict Detected"
            */
-          CipTcpIpSetLastAcdMac(hdr->shwaddr.addr);
-          CipTcpIpSetLastAcdRawData((const uint8_t *)hdr, sizeof(struct etharp_hdr));
+          /* AcdActivity 2: conflict while defending */
+          CipTcpIpSetLastAcdConflict(2, hdr->shwaddr.addr,
+                                     (const uint8_t *)hdr, sizeof(struct etharp_hdr));
           
           acd_handle_arp_conflict(netif, acd);
         }
@@ -52,8 +52,16 @@ void dhcp_ip_addr_store(struct netif *netif)
     uint32_t ip_addr = dhcp->offered_ip_addr.addr;
 
     if (nvs_open(DHCP_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
-        nvs_set_u32(nvs, gen_if_key(netif, if_key), ip_addr);
-        nvs_commit(nvs);
+        /* MODIFICATION: called in the tcpip thread for every bound lease,
+         * also the one confirmed by INIT-REBOOT after each power-up. Only an
+         * address that changed is written, a flash write stops both cores. */
+        uint32_t stored_ip_addr = 0;
+        gen_if_key(netif, if_key);
+        if (nvs_get_u32(nvs, if_key, &stored_ip_addr) != ESP_OK ||
+            stored_ip_addr != ip_addr) {
+            nvs_set_u32(nvs, if_key, ip_addr);
+            nvs_commit(nvs);
+        }
         nvs_close(nvs);
     }
 }
@@ -22,8 +22,19 @@ typedef SemaphoreHandle_t sys_sem_t;
 typedef SemaphoreHandle_t sys_mutex_t;
 typedef TaskHandle_t sys_thread_t;
 
+#if CONFIG_OPENER_LWIP_RING_MBOX
+/* Lock-free ring of a mailbox created with sys_mbox_new_ring() */
+struct sys_mbox_ring_s;
+
+/* Notification index a task waiting on a ring mailbox is woken on */
+#define SYS_MBOX_RING_NOTIFY_INDEX 1
+#endif /* CONFIG_OPENER_LWIP_RING_MBOX */
+
 typedef struct sys_mbox_s {
   QueueHandle_t os_mbox;
+#if CONFIG_OPENER_LWIP_RING_MBOX
+  struct sys_mbox_ring_s *ring; /* NULL for a queue mailbox */
+#endif
 }* sys_mbox_t;
 
 /** This is returned by _fromisr() sys functions to tell the outermost function
@@ -65,6 +76,19 @@ typedef enum {
 bool
 sys_thread_tcpip(sys_thread_core_lock_t type);
 
+#if CONFIG_OPENER_LWIP_RING_MBOX
+/**
+ * @brief Create an empty mailbox backed by a lock-free ring
+ *
+ * Used in place of sys_mbox_new() for the tcpip mailbox and the UDP receive
+ * mailboxes. The size is rounded up to a power of two.
+ *
+ * @return ERR_OK or ERR_MEM; declared with the int8_t of err_t because
+ *         lwipopts.h includes this header before lwip/err.h
+ */
+int8_t sys_mbox_new_ring(sys_mbox_t *mbox, int size);
+#endif /* CONFIG_OPENER_LWIP_RING_MBOX */
+
 #ifdef __cplusplus
 }
 #endif
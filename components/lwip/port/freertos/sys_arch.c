@@ -195,6 +195,208 @@ sys_sem_free(sys_sem_t *sem)
   *sem = NULL;
 }
 
+#if CONFIG_OPENER_LWIP_RING_MBOX
+
+#if configTASK_NOTIFICATION_ARRAY_ENTRIES <= SYS_MBOX_RING_NOTIFY_INDEX
+#error "CONFIG_OPENER_LWIP_RING_MBOX needs CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES >= 2"
+#endif
+
+/*
+ * Bounded ring with a sequence number per cell (D. Vyukov's MPMC queue).
+ * A producer claims a position with a compare-and-swap on enqueue_pos and
+ * publishes the message by storing the next sequence number into the cell;
+ * a consumer does the same on dequeue_pos. Neither takes a critical section
+ * nor calls into the scheduler, which is why a post or fetch of a message
+ * that does not have to wait costs a fraction of xQueueSend/xQueueReceive.
+ *
+ * The tcpip mailbox has many producers (every task using the socket API,
+ * the Ethernet driver and ISRs via tcpip_try_callback) and the UDP receive
+ * mailboxes can be drained by more than one task, so the ring is safe for
+ * any number of producers and consumers rather than single producer.
+ *
+ * Waiting uses a task notification on SYS_MBOX_RING_NOTIFY_INDEX. A consumer
+ * finding the ring empty stores its handle in waiter, checks the ring again
+ * and sleeps; a producer takes the handle after publishing and notifies it.
+ * Both sides use sequentially consistent atomics, so at least one of them
+ * sees the other and no wakeup is lost. Only one task can wait that way, a
+ * second consumer blocking at the same time (which lwIP does not do for
+ * these mailboxes) and a producer posting into a full ring poll once per
+ * tick instead.
+ *
+ * The notified task may already have taken a message and returned when the
+ * notification arrives; that only shortens its next wait on a ring mailbox,
+ * which checks the ring again after every wakeup.
+ *
+ * Messages are taken in the order their positions were claimed. A producer
+ * preempted between claiming and publishing holds back the messages posted
+ * after it until it runs again; it wakes the consumer when it publishes.
+ */
+struct sys_mbox_ring_cell_s {
+  u32_t sequence;
+  void *msg;
+};
+
+struct sys_mbox_ring_s {
+  u32_t mask;
+  u32_t enqueue_pos;
+  u32_t dequeue_pos;
+  TaskHandle_t waiter;
+  struct sys_mbox_ring_cell_s cells[];
+};
+
+static bool
+sys_mbox_ring_push(struct sys_mbox_ring_s *ring, void *msg)
+{
+  struct sys_mbox_ring_cell_s *cell;
+  u32_t pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+
+  for (;;) {
+    cell = &ring->cells[pos & ring->mask];
+    s32_t dif = (s32_t)(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - pos);
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&ring->enqueue_pos, &pos, pos + 1, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (dif < 0) {
+      return false; /* full */
+    } else {
+      pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+    }
+  }
+  cell->msg = msg;
+  __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_SEQ_CST);
+  return true;
+}
+
+static bool
+sys_mbox_ring_pop(struct sys_mbox_ring_s *ring, void **msg)
+{
+  struct sys_mbox_ring_cell_s *cell;
+  u32_t pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+
+  for (;;) {
+    cell = &ring->cells[pos & ring->mask];
+    s32_t dif = (s32_t)(__atomic_load_n(&cell->sequence, __ATOMIC_SEQ_CST) - (pos + 1));
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&ring->dequeue_pos, &pos, pos + 1, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (dif < 0) {
+      return false; /* empty, or the next message is not published yet */
+    } else {
+      pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+    }
+  }
+  *msg = cell->msg;
+  __atomic_store_n(&cell->sequence, pos + ring->mask + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+/* The waiting consumer, if any, after a message was published */
+static TaskHandle_t
+sys_mbox_ring_take_waiter(struct sys_mbox_ring_s *ring)
+{
+  if (__atomic_load_n(&ring->waiter, __ATOMIC_SEQ_CST) == NULL) {
+    return NULL;
+  }
+  return __atomic_exchange_n(&ring->waiter, NULL, __ATOMIC_SEQ_CST);
+}
+
+static void
+sys_mbox_ring_wake(struct sys_mbox_ring_s *ring)
+{
+  TaskHandle_t waiter = sys_mbox_ring_take_waiter(ring);
+  if (waiter != NULL) {
+    xTaskNotifyGiveIndexed(waiter, SYS_MBOX_RING_NOTIFY_INDEX);
+  }
+}
+
+/**
+ * @brief Fetch from a ring mailbox, waiting at most ticks (portMAX_DELAY for ever)
+ *
+ * @return true if a message was fetched
+ */
+static bool
+sys_mbox_ring_fetch(struct sys_mbox_ring_s *ring, void **msg, TickType_t ticks)
+{
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  TimeOut_t timeout;
+
+  if (sys_mbox_ring_pop(ring, msg)) {
+    return true;
+  }
+  vTaskSetTimeOutState(&timeout);
+  for (;;) {
+    TaskHandle_t expected = NULL;
+    bool waiting = __atomic_compare_exchange_n(&ring->waiter, &expected, self, false,
+                                               __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    bool fetched = sys_mbox_ring_pop(ring, msg);
+    if (!fetched && ticks != 0) {
+      if (waiting) {
+        ulTaskNotifyTakeIndexed(SYS_MBOX_RING_NOTIFY_INDEX, pdTRUE, ticks);
+      } else {
+        vTaskDelay(1);
+      }
+      fetched = sys_mbox_ring_pop(ring, msg);
+    }
+    if (waiting) {
+      /* still registered unless a producer took the handle */
+      expected = self;
+      __atomic_compare_exchange_n(&ring->waiter, &expected, NULL, false,
+                                  __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+    if (fetched) {
+      return true;
+    }
+    if (ticks == 0 || (ticks != portMAX_DELAY &&
+                       xTaskCheckForTimeOut(&timeout, &ticks) == pdTRUE)) {
+      return false;
+    }
+  }
+}
+
+/**
+ * @brief Create an empty mailbox backed by a lock-free ring
+ *
+ * @param mbox pointer of the mailbox
+ * @param size size of the mailbox, rounded up to a power of two
+ * @return ERR_OK on success, ERR_MEM when out of memory
+ */
+int8_t
+sys_mbox_new_ring(sys_mbox_t *mbox, int size)
+{
+  u32_t capacity = 2;
+  while (capacity < (u32_t)size) {
+    capacity <<= 1;
+  }
+
+  *mbox = mem_malloc(sizeof(struct sys_mbox_s) + sizeof(struct sys_mbox_ring_s) +
+                     capacity * sizeof(struct sys_mbox_ring_cell_s));
+  if (*mbox == NULL) {
+    LWIP_DEBUGF(ESP_THREAD_SAFE_DEBUG, ("fail to new *mbox\n"));
+    return ERR_MEM;
+  }
+
+  struct sys_mbox_ring_s *ring = (struct sys_mbox_ring_s *)(*mbox + 1);
+  ring->mask = capacity - 1;
+  ring->enqueue_pos = 0;
+  ring->dequeue_pos = 0;
+  ring->waiter = NULL;
+  for (u32_t i = 0; i < capacity; i++) {
+    ring->cells[i].sequence = i;
+    ring->cells[i].msg = NULL;
+  }
+  (*mbox)->os_mbox = NULL;
+  (*mbox)->ring = ring;
+
+  LWIP_DEBUGF(ESP_THREAD_SAFE_DEBUG, ("new *mbox ok mbox=%p ring=%p\n", *mbox, ring));
+  return ERR_OK;
+}
+
+#endif /* CONFIG_OPENER_LWIP_RING_MBOX */
+
 /**
  * @brief Create an empty mailbox.
  *
@@ -212,6 +414,9 @@ sys_mbox_new(sys_mbox_t *mbox, int size)
   }
 
   (*mbox)->os_mbox = xQueueCreate(size, sizeof(void *));
+#if CONFIG_OPENER_LWIP_RING_MBOX
+  (*mbox)->ring = NULL;
+#endif
 
   if ((*mbox)->os_mbox == NULL) {
     LWIP_DEBUGF(ESP_THREAD_SAFE_DEBUG, ("fail to new (*mbox)->os_mbox\n"));
@@ -232,6 +437,15 @@ sys_mbox_new(sys_mbox_t *mbox, int size)
 void
 sys_mbox_post(sys_mbox_t *mbox, void *msg)
 {
+#if CONFIG_OPENER_LWIP_RING_MBOX
+  if ((*mbox)->ring != NULL) {
+    while (!sys_mbox_ring_push((*mbox)->ring, msg)) {
+      vTaskDelay(1);
+    }
+    sys_mbox_ring_wake((*mbox)->ring);
+    return;
+  }
+#endif
   BaseType_t ret = xQueueSendToBack((*mbox)->os_mbox, &msg, portMAX_DELAY);
   LWIP_ASSERT("mbox post failed", ret == pdTRUE);
   (void)ret;
@@ -249,6 +463,17 @@ sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
 {
   err_t xReturn;
 
+#if CONFIG_OPENER_LWIP_RING_MBOX
+  if ((*mbox)->ring != NULL) {
+    if (!sys_mbox_ring_push((*mbox)->ring, msg)) {
+      LWIP_DEBUGF(ESP_THREAD_SAFE_DEBUG, ("trypost mbox=%p fail\n", *mbox));
+      return ERR_MEM;
+    }
+    sys_mbox_ring_wake((*mbox)->ring);
+    return ERR_OK;
+  }
+#endif
+
   if (xQueueSend((*mbox)->os_mbox, &msg, 0) == pdTRUE) {
     xReturn = ERR_OK;
   } else {
@@ -274,6 +499,19 @@ sys_mbox_trypost_fromisr(sys_mbox_t *mbox, void *msg)
   BaseType_t ret;
   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
+#if CONFIG_OPENER_LWIP_RING_MBOX
+  if ((*mbox)->ring != NULL) {
+    if (!sys_mbox_ring_push((*mbox)->ring, msg)) {
+      return ERR_MEM;
+    }
+    TaskHandle_t waiter = sys_mbox_ring_take_waiter((*mbox)->ring);
+    if (waiter != NULL) {
+      vTaskNotifyGiveIndexedFromISR(waiter, SYS_MBOX_RING_NOTIFY_INDEX, &xHigherPriorityTaskWoken);
+    }
+    return xHigherPriorityTaskWoken == pdTRUE ? ERR_NEED_SCHED : ERR_OK;
+  }
+#endif
+
   ret = xQueueSendFromISR((*mbox)->os_mbox, &msg, &xHigherPriorityTaskWoken);
   if (ret == pdTRUE) {
     if (xHigherPriorityTaskWoken == pdTRUE) {
@@ -304,6 +542,18 @@ sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout)
     msg = &msg_dummy;
   }
 
+#if CONFIG_OPENER_LWIP_RING_MBOX
+  if ((*mbox)->ring != NULL) {
+    TickType_t ticks = timeout == 0 ? portMAX_DELAY : timeout / portTICK_PERIOD_MS;
+    if (!sys_mbox_ring_fetch((*mbox)->ring, msg, ticks)) {
+      /* timed out */
+      *msg = NULL;
+      return SYS_ARCH_TIMEOUT;
+    }
+    return 0;
+  }
+#endif
+
   if (timeout == 0) {
     /* wait infinite */
     ret = xQueueReceive((*mbox)->os_mbox, &(*msg), portMAX_DELAY);
@@ -338,6 +588,15 @@ sys_arch_mbox_tryfetch(sys_mbox_t *mbox, void **msg)
   if (msg == NULL) {
     msg = &msg_dummy;
   }
+#if CONFIG_OPENER_LWIP_RING_MBOX
+  if ((*mbox)->ring != NULL) {
+    if (!sys_mbox_ring_pop((*mbox)->ring, msg)) {
+      *msg = NULL;
+      return SYS_MBOX_EMPTY;
+    }
+    return 0;
+  }
+#endif
   ret = xQueueReceive((*mbox)->os_mbox, &(*msg), 0);
   if (ret == errQUEUE_EMPTY) {
     *msg = NULL;
@@ -359,6 +618,15 @@ sys_mbox_free(sys_mbox_t *mbox)
   if ((NULL == mbox) || (NULL == *mbox)) {
     return;
   }
+#if CONFIG_OPENER_LWIP_RING_MBOX
+  if ((*mbox)->ring != NULL) {
+    LWIP_ASSERT("mbox quence not empty",
+                (*mbox)->ring->enqueue_pos == (*mbox)->ring->dequeue_pos);
+    free(*mbox);
+    *mbox = NULL;
+    return;
+  }
+#endif
   UBaseType_t msgs_waiting = uxQueueMessagesWaiting((*mbox)->os_mbox);
   LWIP_ASSERT("mbox quence not empty", msgs_waiting == 0);
 
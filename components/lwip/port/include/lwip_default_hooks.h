@@ -74,6 +74,27 @@ int lwip_hook_ip6_input(struct pbuf *p, struct netif *inp);
 void lwip_dhcp_on_extra_option(struct dhcp *dhcp, uint8_t state, uint8_t option, uint8_t len, struct pbuf* p, uint16_t offset);
 #endif /* CONFIG_LWIP_HOOK_DHCP_EXTRA_OPTION_CUSTOM (or DEFAULT) */
 
+#if CONFIG_OPENER_QOS_8021Q_TAGGING
+struct eth_addr;
+/* Implemented by the OpENer port, returns the 802.1Q TCI of a frame or -1 */
+s32_t lwip_hook_vlan_set(struct netif *netif, struct pbuf *p,
+                         const struct eth_addr *src, const struct eth_addr *dst, u16_t eth_type);
+#endif /* CONFIG_OPENER_QOS_8021Q_TAGGING */
+
+#if CONFIG_OPENER_DLR_RING_NODE
+struct pbuf;
+struct netif;
+/* Implemented by the OpENer port, takes over DLR frames */
+err_t lwip_hook_unknown_eth_protocol(struct pbuf *p, struct netif *netif);
+#endif /* CONFIG_OPENER_DLR_RING_NODE */
+
+#if CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT
+struct pbuf;
+struct netif;
+/* Implemented by the OpENer port, drops UDP port 44818 datagrams above the limit */
+int lwip_hook_ip4_input(struct pbuf *pbuf, struct netif *input_netif);
+#endif /* CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT */
+
 #ifdef CONFIG_LWIP_IPV4
 struct netif *
 ip4_route_src_hook(const ip4_addr_t *src,const ip4_addr_t *dest);
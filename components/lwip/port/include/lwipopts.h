@@ -162,12 +162,77 @@ extern "C" {
  */
 #define ARP_QUEUEING                    1
 
-#ifdef CONFIG_LWIP_DHCPS_STATIC_ENTRIES
+/**
+ * ETHARP_SUPPORT_STATIC_ENTRIES==1: Also needed to pin the ARP entries of
+ * I/O connection originators, see CONFIG_OPENER_ARP_PIN_ORIGINATORS.
+ */
+#if defined(CONFIG_LWIP_DHCPS_STATIC_ENTRIES) || CONFIG_OPENER_ARP_PIN_ORIGINATORS
 #define ETHARP_SUPPORT_STATIC_ENTRIES   1
 #else
 #define ETHARP_SUPPORT_STATIC_ENTRIES   0
 #endif
 
+/**
+ * ETHARP_SUPPORT_VLAN==1: Send priority tagged 802.1Q frames as chosen by
+ * LWIP_HOOK_VLAN_SET, see the hook options and the CIP QoS object.
+ */
+#if CONFIG_OPENER_QOS_8021Q_TAGGING
+#define ETHARP_SUPPORT_VLAN             1
+#endif
+
+/**
+ * MQTT_OUTPUT_RINGBUF_SIZE: Room for every send buffer of the KC868-A16
+ * telemetry publisher at once, each with its topic and MQTT header.
+ * MQTT_REQ_MAX_IN_FLIGHT: A QoS 0 message holds a request until it is
+ * sent, one per buffer and one for the connect.
+ */
+#if CONFIG_KC868_MQTT
+#define MQTT_OUTPUT_RINGBUF_SIZE \
+  (CONFIG_KC868_MQTT_BUFFERS * (CONFIG_KC868_MQTT_BUFFER_SIZE + 128))
+#define MQTT_REQ_MAX_IN_FLIGHT          (CONFIG_KC868_MQTT_BUFFERS + 1)
+#endif
+
+/**
+ * LWIP_MDNS_RESPONDER: DNS-SD advertisement of the adapter, one service.
+ * LWIP_MDNS_SEARCH: The adapter only answers, it never browses.
+ */
+#if CONFIG_OPENER_MDNS
+#define LWIP_MDNS_RESPONDER             1
+#define MDNS_MAX_SERVICES               1
+#define LWIP_MDNS_SEARCH                0
+#endif
+
+/**
+ * SNTP_COMP_ROUNDTRIP: The SNTP disciplined clock of OpENer takes the
+ * server time corrected by half the round trip, which relies on the
+ * originate time the checks of SNTP_CHECK_RESPONSE 2 verify.
+ */
+#if CONFIG_OPENER_SNTP_CLOCK
+#define SNTP_CHECK_RESPONSE             2
+#define SNTP_COMP_ROUNDTRIP             1
+#endif
+
+/**
+ * LWIP_SNMP: The KC868-A16 agent, read-only. An empty community turns off
+ * SNMPv1/v2c at run time, hence LWIP_SNMP_CONFIGURE_VERSIONS.
+ * SNMP_LWIP_GETBULK_MAX_REPETITIONS: Caps a GetBulk so one walk of the
+ * connection table cannot build a response of unbounded size.
+ */
+#if CONFIG_KC868_SNMP
+#define LWIP_SNMP                       1
+#define SNMP_COMMUNITY                  CONFIG_KC868_SNMP_COMMUNITY
+#define SNMP_COMMUNITY_WRITE            ""
+#define SNMP_LWIP_MIB2_SYSDESC          "KC868-A16 EtherNet/IP adapter"
+#define SNMP_LWIP_MIB2_SYSNAME          "kc868-a16"
+#define SNMP_LWIP_MIB2_SYSCONTACT       CONFIG_KC868_SNMP_SYS_CONTACT
+#define SNMP_LWIP_MIB2_SYSLOCATION      CONFIG_KC868_SNMP_SYS_LOCATION
+#define SNMP_LWIP_GETBULK_MAX_REPETITIONS 16
+#define LWIP_SNMP_CONFIGURE_VERSIONS    1
+#if CONFIG_KC868_SNMP_V3
+#define LWIP_SNMP_V3                    1
+#endif
+#endif
+
 /*
    --------------------------------
    ---------- IP options ----------
@@ -772,7 +837,14 @@ static inline uint32_t timeout_from_offered(uint32_t lease, uint32_t min)
 #define LWIP_ESP_NETIF_DATA             (0)
 #endif
 
-#define LWIP_NUM_NETIF_CLIENT_DATA      (LWIP_ESP_NETIF_DATA + CONFIG_LWIP_NUM_NETIF_CLIENT_DATA)
+/* The mDNS responder keeps its host data in a netif client data slot */
+#if CONFIG_OPENER_MDNS
+#define LWIP_MDNS_NETIF_DATA            (1)
+#else
+#define LWIP_MDNS_NETIF_DATA            (0)
+#endif
+
+#define LWIP_NUM_NETIF_CLIENT_DATA      (LWIP_ESP_NETIF_DATA + LWIP_MDNS_NETIF_DATA + CONFIG_LWIP_NUM_NETIF_CLIENT_DATA)
 
 /**
  * BRIDGEIF_MAX_PORTS: this is used to create a typedef used for forwarding
@@ -1339,6 +1411,15 @@ static inline uint32_t timeout_from_offered(uint32_t lease, uint32_t min)
 #endif
 #define LWIP_HOOK_FILENAME              "lwip_default_hooks.h"
 #define LWIP_HOOK_IP4_ROUTE_SRC         ip4_route_src_hook
+#if CONFIG_OPENER_QOS_8021Q_TAGGING
+#define LWIP_HOOK_VLAN_SET              lwip_hook_vlan_set
+#endif
+#if CONFIG_OPENER_DLR_RING_NODE
+#define LWIP_HOOK_UNKNOWN_ETH_PROTOCOL  lwip_hook_unknown_eth_protocol
+#endif
+#if CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT
+#define LWIP_HOOK_IP4_INPUT             lwip_hook_ip4_input
+#endif
 #if LWIP_NETCONN_FULLDUPLEX
 #define LWIP_DONE_SOCK(sock)            done_socket(sock)
 #else
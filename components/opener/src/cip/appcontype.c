@@ -5,38 +5,41 @@
  ******************************************************************************/
 
 #include <string.h>
+#include <inttypes.h>
 
 #include "appcontype.h"
 
 #include "cipconnectionmanager.h"
 #include "cipconnectionobject.h"
+#include "cipioconnection.h"
 #include "opener_api.h"
 #include "assert.h"
 #include "trace.h"
 #include "cipepath.h"
 
-/** @brief Exclusive Owner connection data */
+/** @brief The application paths of a connection point */
 typedef struct {
   unsigned int output_assembly; /**< the O-to-T point for the connection */
   unsigned int input_assembly; /**< the T-to-O point for the connection */
   unsigned int config_assembly; /**< the config point for the connection */
+} ConnectionPoint;
+
+/** @brief Exclusive Owner connection data */
+typedef struct {
   CipConnectionObject connection_data; /**< the connection data, only one connection is allowed per O-to-T point*/
+#if OPENER_CIP_REDUNDANT_OWNER
+  CipConnectionObject standby_data; /**< the second connection of a redundant owner, either one may be in control */
+#endif
 } ExclusiveOwnerConnection;
 
 /** @brief Input Only connection data */
 typedef struct {
-  unsigned int output_assembly; /**< the O-to-T point for the connection */
-  unsigned int input_assembly; /**< the T-to-O point for the connection */
-  unsigned int config_assembly; /**< the config point for the connection */
   CipConnectionObject connection_data[
     OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH];                                   /*< the connection data */
 } InputOnlyConnection;
 
 /** @brief Listen Only connection data */
 typedef struct {
-  unsigned int output_assembly; /**< the O-to-T point for the connection */
-  unsigned int input_assembly; /**< the T-to-O point for the connection */
-  unsigned int config_assembly; /**< the config point for the connection */
   CipConnectionObject connection_data[
     OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH
   ];                                                                               /**< the connection data */
@@ -49,6 +52,51 @@ InputOnlyConnection g_input_only_connections[OPENER_CIP_NUM_INPUT_ONLY_CONNS]; /
 
 ListenOnlyConnection g_listen_only_connections[OPENER_CIP_NUM_LISTEN_ONLY_CONNS]; /**< Listen Only connections */
 
+#if OPENER_SEALED_CONFIGURATION
+/* The connection points are constants of the user configuration, so the
+ * compiler unrolls the searches below and compares with immediates. The
+ * zero entry keeps the arrays of empty lists valid C and is not counted. */
+static const ConnectionPoint kExclusiveOwnerPoints[] = {
+  OPENER_SEALED_EXCLUSIVE_OWNER_POINTS { 0, 0, 0 }
+};
+static const ConnectionPoint kInputOnlyPoints[] = {
+  OPENER_SEALED_INPUT_ONLY_POINTS { 0, 0, 0 }
+};
+static const ConnectionPoint kListenOnlyPoints[] = {
+  OPENER_SEALED_LISTEN_ONLY_POINTS { 0, 0, 0 }
+};
+
+/* Like configured ones, points beyond the number of connections of their
+ * type are not connectable */
+#define SEALED_NUMBER_OF_POINTS(points, connections) \
+  ( (sizeof(points) / sizeof(points[0]) - 1 < (connections) ) ? \
+    sizeof(points) / sizeof(points[0]) - 1 : (connections) )
+#define NUMBER_OF_EXCLUSIVE_OWNER_POINTS \
+  SEALED_NUMBER_OF_POINTS(kExclusiveOwnerPoints, \
+                          OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS)
+#define NUMBER_OF_INPUT_ONLY_POINTS \
+  SEALED_NUMBER_OF_POINTS(kInputOnlyPoints, OPENER_CIP_NUM_INPUT_ONLY_CONNS)
+#define NUMBER_OF_LISTEN_ONLY_POINTS \
+  SEALED_NUMBER_OF_POINTS(kListenOnlyPoints, OPENER_CIP_NUM_LISTEN_ONLY_CONNS)
+#define EXCLUSIVE_OWNER_POINTS kExclusiveOwnerPoints
+#define INPUT_ONLY_POINTS kInputOnlyPoints
+#define LISTEN_ONLY_POINTS kListenOnlyPoints
+typedef const ConnectionPoint ConnectionPointTable;
+#else
+static ConnectionPoint g_exclusive_owner_points[
+  OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS];
+static ConnectionPoint g_input_only_points[OPENER_CIP_NUM_INPUT_ONLY_CONNS];
+static ConnectionPoint g_listen_only_points[OPENER_CIP_NUM_LISTEN_ONLY_CONNS];
+
+#define NUMBER_OF_EXCLUSIVE_OWNER_POINTS OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS
+#define NUMBER_OF_INPUT_ONLY_POINTS OPENER_CIP_NUM_INPUT_ONLY_CONNS
+#define NUMBER_OF_LISTEN_ONLY_POINTS OPENER_CIP_NUM_LISTEN_ONLY_CONNS
+#define EXCLUSIVE_OWNER_POINTS g_exclusive_owner_points
+#define INPUT_ONLY_POINTS g_input_only_points
+#define LISTEN_ONLY_POINTS g_listen_only_points
+typedef ConnectionPoint ConnectionPointTable;
+#endif /* OPENER_SEALED_CONFIGURATION */
+
 /** @brief Takes an ConnectionObject and searches and returns an Exclusive Owner Connection based on the ConnectionObject,
  * if there is non it returns NULL
  *
@@ -82,46 +130,135 @@ CipConnectionObject *GetListenOnlyConnection(
   const CipConnectionObject *const RESTRICT connection_object,
   EipUint16 *const extended_error);
 
+#if OPENER_CIP_REDUNDANT_OWNER
+/** @brief The other connection slot of the output point of a connection
+ *
+ * @return NULL if the connection is not an exclusive owner slot
+ */
+static CipConnectionObject *GetRedundantOwnerPeer(
+  const CipConnectionObject *const connection_object) {
+  for (size_t i = 0; i < OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS; ++i) {
+    ExclusiveOwnerConnection *const point = &(g_exlusive_owner_connections[i]);
+    if (connection_object == &(point->connection_data) ) {
+      return &(point->standby_data);
+    }
+    if (connection_object == &(point->standby_data) ) {
+      return &(point->connection_data);
+    }
+  }
+  return NULL;
+}
+
+/** @brief The established connection of an output point that is no standby */
+static CipConnectionObject *GetRedundantOwnerInControl(
+  ExclusiveOwnerConnection *const point) {
+  CipConnectionObject *const slots[] = {
+    &(point->connection_data), &(point->standby_data)
+  };
+  for (size_t j = 0; j < sizeof(slots) / sizeof(slots[0]); ++j) {
+    if (kConnectionObjectStateEstablished ==
+        ConnectionObjectGetState(slots[j]) && !slots[j]->redundant_standby) {
+      return slots[j];
+    }
+  }
+  return NULL;
+}
+
+/** @brief Take the free slot of an output point with an owner in control
+ *
+ * @param owner the connection in control
+ * @param connection_object the Forward Open of the standby
+ * @param extended_error written if the standby is not acceptable
+ * @return the slot for the standby or NULL
+ */
+static CipConnectionObject *GetRedundantOwnerStandbyConnection(
+  const CipConnectionObject *const owner,
+  const CipConnectionObject *const RESTRICT connection_object,
+  EipUint16 *const extended_error) {
+  CipConnectionObject *const standby = GetRedundantOwnerPeer(owner);
+  /* both have to be redundant owners, and there is only one standby */
+  if (!ConnectionObjectIsOToTRedundantOwner(owner) ||
+      !ConnectionObjectIsOToTRedundantOwner(connection_object) ||
+      kConnectionObjectStateEstablished == ConnectionObjectGetState(standby) ) {
+    *extended_error = kConnectionManagerExtendedStatusCodeErrorOwnershipConflict;
+    OPENER_TRACE_INFO("Hit an Ownership conflict with a redundant owner\n");
+    return NULL;
+  }
+  if (kConnectionObjectStateTimedOut == ConnectionObjectGetState(standby) ) {
+    /* the old owner, that timed out and came back */
+    if (ConnectionObjectEqualOriginator(connection_object, standby) ) {
+      TakeOverTimedOutIoConnection(standby);
+    } else {
+      standby->connection_close_function(standby);
+    }
+  }
+  return standby;
+}
+#endif /* OPENER_CIP_REDUNDANT_OWNER */
+
+/** @brief Set a connection point, or check it against the sealed one
+ *
+ * @param points the points of the type
+ * @param number_of_points points of the type that are connectable
+ * @param connection_number the point to set
+ */
+static void ConfigureConnectionPoint(ConnectionPointTable *const points,
+                                     const size_t number_of_points,
+                                     const unsigned int connection_number,
+                                     const unsigned int output_assembly,
+                                     const unsigned int input_assembly,
+                                     const unsigned int config_assembly) {
+  if (number_of_points <= connection_number) {
+    return;
+  }
+#if OPENER_SEALED_CONFIGURATION
+  /* the application still tells its points, a sealed table that differs
+   * from them is out of date */
+  const ConnectionPoint *const point = &points[connection_number];
+  if (point->output_assembly != output_assembly ||
+      point->input_assembly != input_assembly ||
+      point->config_assembly != config_assembly) {
+    OPENER_TRACE_ERR("Connection point %u %u/%u/%u is not the sealed one\n",
+                     connection_number, output_assembly, input_assembly,
+                     config_assembly);
+    OPENER_ASSERT(false);
+  }
+#else
+  points[connection_number] = (ConnectionPoint) {
+    .output_assembly = output_assembly,
+    .input_assembly = input_assembly,
+    .config_assembly = config_assembly
+  };
+#endif
+}
+
 void ConfigureExclusiveOwnerConnectionPoint(
   const unsigned int connection_number,
   const unsigned int output_assembly,
   const unsigned int input_assembly,
   const unsigned int config_assembly) {
-  if (OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS > connection_number) {
-    g_exlusive_owner_connections[connection_number].output_assembly =
-      output_assembly;
-    g_exlusive_owner_connections[connection_number].input_assembly =
-      input_assembly;
-    g_exlusive_owner_connections[connection_number].config_assembly =
-      config_assembly;
-  }
+  ConfigureConnectionPoint(EXCLUSIVE_OWNER_POINTS,
+                           NUMBER_OF_EXCLUSIVE_OWNER_POINTS,
+                           connection_number, output_assembly,
+                           input_assembly, config_assembly);
 }
 
 void ConfigureInputOnlyConnectionPoint(const unsigned int connection_number,
                                        const unsigned int output_assembly,
                                        const unsigned int input_assembly,
                                        const unsigned int config_assembly) {
-  if (OPENER_CIP_NUM_INPUT_ONLY_CONNS > connection_number) {
-    g_input_only_connections[connection_number].output_assembly =
-      output_assembly;
-    g_input_only_connections[connection_number].input_assembly = input_assembly;
-    g_input_only_connections[connection_number].config_assembly =
-      config_assembly;
-  }
+  ConfigureConnectionPoint(INPUT_ONLY_POINTS, NUMBER_OF_INPUT_ONLY_POINTS,
+                           connection_number, output_assembly,
+                           input_assembly, config_assembly);
 }
 
 void ConfigureListenOnlyConnectionPoint(const unsigned int connection_number,
                                         const unsigned int output_assembly,
                                         const unsigned int input_assembly,
                                         const unsigned int config_assembly) {
-  if (OPENER_CIP_NUM_LISTEN_ONLY_CONNS > connection_number) {
-    g_listen_only_connections[connection_number].output_assembly =
-      output_assembly;
-    g_listen_only_connections[connection_number].input_assembly =
-      input_assembly;
-    g_listen_only_connections[connection_number].config_assembly =
-      config_assembly;
-  }
+  ConfigureConnectionPoint(LISTEN_ONLY_POINTS, NUMBER_OF_LISTEN_ONLY_POINTS,
+                           connection_number, output_assembly,
+                           input_assembly, config_assembly);
 }
 
 CipConnectionObject *GetIoConnectionForConnectionData(
@@ -170,24 +307,65 @@ CipConnectionObject *GetIoConnectionForConnectionData(
 
   if (NULL != io_connection) {
     ConnectionObjectDeepCopy(io_connection, connection_object);
+#if OPENER_CIP_REDUNDANT_OWNER
+    /* joining an owner in control makes the connection its standby */
+    const CipConnectionObject *const peer = GetRedundantOwnerPeer(
+      io_connection);
+    io_connection->redundant_standby = NULL != peer &&
+                                       kConnectionObjectStateEstablished ==
+                                       ConnectionObjectGetState(peer) &&
+                                       !peer->redundant_standby;
+    if (io_connection->redundant_standby) {
+      OPENER_TRACE_INFO("IO Exclusive Owner connection is redundant standby\n");
+    }
+#endif
   }
 
   return io_connection;
 }
 
+bool PromoteRedundantOwnerStandby(const CipConnectionObject *const owner) {
+#if OPENER_CIP_REDUNDANT_OWNER
+  if (owner->redundant_standby) {
+    return false;
+  }
+  CipConnectionObject *const standby = GetRedundantOwnerPeer(owner);
+  if (NULL == standby || !standby->redundant_standby ||
+      kConnectionObjectStateEstablished != ConnectionObjectGetState(standby) ) {
+    return false;
+  }
+  standby->redundant_standby = false;
+  OPENER_TRACE_INFO("Redundant owner standby (ConnNr: %u) takes control\n",
+                    standby->connection_serial_number);
+  return true;
+#else
+  (void) owner;
+  return false;
+#endif
+}
+
 CipConnectionObject *GetExclusiveOwnerConnection(
   const CipConnectionObject *const RESTRICT connection_object,
   EipUint16 *const extended_error) {
 
-  for (size_t i = 0; i < OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS; ++i) {
-    if ( (g_exlusive_owner_connections[i].output_assembly ==
+  for (size_t i = 0; i < NUMBER_OF_EXCLUSIVE_OWNER_POINTS; ++i) {
+    if ( (EXCLUSIVE_OWNER_POINTS[i].output_assembly ==
           connection_object->consumed_path.instance_id)
-         && (g_exlusive_owner_connections[i].input_assembly ==
+         && (EXCLUSIVE_OWNER_POINTS[i].input_assembly ==
              connection_object->produced_path.instance_id)
-         && ( (g_exlusive_owner_connections[i].config_assembly ==
+         && ( (EXCLUSIVE_OWNER_POINTS[i].config_assembly ==
                connection_object->configuration_path.instance_id)
               || (0 == connection_object->configuration_path.instance_id) ) ) {
 
+#if OPENER_CIP_REDUNDANT_OWNER
+      const CipConnectionObject *const owner = GetRedundantOwnerInControl(
+        &(g_exlusive_owner_connections[i]) );
+      if (NULL != owner) {
+        return GetRedundantOwnerStandbyConnection(owner, connection_object,
+                                                  extended_error);
+      }
+#endif
+
       /* check if on other connection point with the same output assembly is currently connected */
       const CipConnectionObject *const exclusive_owner =
         GetConnectedOutputAssembly(
@@ -209,9 +387,15 @@ CipConnectionObject *GetExclusiveOwnerConnection(
           if(ConnectionObjectEqualOriginator(connection_object,
                                              exclusive_owner)) {
             /* Same originator - reuse the connection object */
-            g_exlusive_owner_connections[i].connection_data.
-            connection_close_function(&(g_exlusive_owner_connections[i].
-                                        connection_data) );
+            if(exclusive_owner ==
+               &(g_exlusive_owner_connections[i].connection_data) ) {
+              TakeOverTimedOutIoConnection(
+                &(g_exlusive_owner_connections[i].connection_data) );
+            } else {
+              g_exlusive_owner_connections[i].connection_data.
+              connection_close_function(&(g_exlusive_owner_connections[i].
+                                          connection_data) );
+            }
             return &(g_exlusive_owner_connections[i].connection_data);
           } else {
             /* Different originator - close the stale connection and allow new one */
@@ -240,15 +424,15 @@ CipConnectionObject *GetInputOnlyConnection(
   EipUint16 *const extended_error) {
   EipUint16 err = 0;
 
-  for (size_t i = 0; i < OPENER_CIP_NUM_INPUT_ONLY_CONNS; ++i) {
-    if (g_input_only_connections[i].output_assembly
+  for (size_t i = 0; i < NUMBER_OF_INPUT_ONLY_POINTS; ++i) {
+    if (INPUT_ONLY_POINTS[i].output_assembly
         == connection_object->consumed_path.instance_id) { /* we have the same output assembly */
-      if (g_input_only_connections[i].input_assembly
+      if (INPUT_ONLY_POINTS[i].input_assembly
           != connection_object->produced_path.instance_id) {
         err = kConnectionManagerExtendedStatusCodeInvalidProducingApplicationPath;
         continue;
       }
-      if (g_input_only_connections[i].config_assembly
+      if (INPUT_ONLY_POINTS[i].config_assembly
           != connection_object->configuration_path.instance_id
           && 0 != connection_object->configuration_path.instance_id) {
         err = kConnectionManagerExtendedStatusCodeInconsistentApplicationPathCombo;
@@ -263,9 +447,8 @@ CipConnectionObject *GetInputOnlyConnection(
             && ConnectionObjectEqualOriginator(connection_object,
                                                &(g_input_only_connections[i].
                                                  connection_data[j]))) {
-          g_input_only_connections[i].connection_data[j].
-          connection_close_function(
-            &g_input_only_connections[i].connection_data[j]);
+          TakeOverTimedOutIoConnection(
+            &(g_input_only_connections[i].connection_data[j]) );
           return &(g_input_only_connections[i].connection_data[j]);
         }
       }
@@ -278,6 +461,18 @@ CipConnectionObject *GetInputOnlyConnection(
           return &(g_input_only_connections[i].connection_data[j]);
         }
       }
+
+      /* all taken, a timed out connection of another originator gives way */
+      for (size_t j = 0; j < OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH;
+           ++j) {
+        CipConnectionObject *const timed_out =
+          &(g_input_only_connections[i].connection_data[j]);
+        if (kConnectionObjectStateTimedOut
+            == ConnectionObjectGetState(timed_out) ) {
+          timed_out->connection_close_function(timed_out);
+          return timed_out;
+        }
+      }
       err = kConnectionManagerExtendedStatusCodeTargetObjectOutOfConnections;
       break;
     }
@@ -292,23 +487,27 @@ CipConnectionObject *GetListenOnlyConnection(
   EipUint16 *const extended_error) {
   EipUint16 err = 0;
 
-  for (size_t i = 0; i < OPENER_CIP_NUM_LISTEN_ONLY_CONNS; i++) {
-    if (g_listen_only_connections[i].output_assembly
+  for (size_t i = 0; i < NUMBER_OF_LISTEN_ONLY_POINTS; i++) {
+    if (LISTEN_ONLY_POINTS[i].output_assembly
         == connection_object->consumed_path.instance_id) { /* we have the same output assembly */
-      if (g_listen_only_connections[i].input_assembly
+      if (LISTEN_ONLY_POINTS[i].input_assembly
           != connection_object->produced_path.instance_id) {
         err = kConnectionManagerExtendedStatusCodeInvalidProducingApplicationPath;
         continue;
       }
-      if (g_listen_only_connections[i].config_assembly
+      if (LISTEN_ONLY_POINTS[i].config_assembly
           != connection_object->configuration_path.instance_id
           && 0 != connection_object->configuration_path.instance_id) {
         err = kConnectionManagerExtendedStatusCodeInconsistentApplicationPathCombo;
         continue;
       }
 
-      /* Here we look for both Point-to-Point and Multicast IO connections */
-      if ( NULL == GetExistingProducerIoConnection(false,
+      /* A multicast listen only connection can only share a multicast
+       * production, a point-to-point one any production of the input */
+      const bool multicast_only = kConnectionObjectConnectionTypeMulticast ==
+                                  ConnectionObjectGetTToOConnectionType(
+        connection_object);
+      if ( NULL == GetExistingProducerIoConnection(multicast_only,
                                                    connection_object->
                                                    produced_path.instance_id)) {
         err = kConnectionManagerExtendedStatusCodeNonListenOnlyConnectionNotOpened;
@@ -323,9 +522,8 @@ CipConnectionObject *GetListenOnlyConnection(
             && ConnectionObjectEqualOriginator(connection_object,
                                                &(g_listen_only_connections[i].
                                                  connection_data[j]))) {
-          g_listen_only_connections[i].connection_data[j].
-          connection_close_function(
-            &g_listen_only_connections[i].connection_data[j]);
+          TakeOverTimedOutIoConnection(
+            &(g_listen_only_connections[i].connection_data[j]) );
           return &(g_listen_only_connections[i].connection_data[j]);
         }
       }
@@ -338,6 +536,18 @@ CipConnectionObject *GetListenOnlyConnection(
           return &(g_listen_only_connections[i].connection_data[j]);
         }
       }
+
+      /* all taken, a timed out connection of another originator gives way */
+      for (size_t j = 0; j < OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH;
+           ++j) {
+        CipConnectionObject *const timed_out =
+          &(g_listen_only_connections[i].connection_data[j]);
+        if (kConnectionObjectStateTimedOut
+            == ConnectionObjectGetState(timed_out) ) {
+          timed_out->connection_close_function(timed_out);
+          return timed_out;
+        }
+      }
       err = kConnectionManagerExtendedStatusCodeTargetObjectOutOfConnections;
       break;
     }
@@ -350,14 +560,16 @@ CipConnectionObject *GetListenOnlyConnection(
 CipConnectionObject *GetExistingProducerIoConnection(
   const bool multicast_only,
   const EipUint32 input_point) {
-  const DoublyLinkedListNode *node = connection_list.first;
-
-  while (NULL != node) {
-    CipConnectionObject *producer_io_connection = node->data;
-    if (ConnectionObjectIsTypeIOConnection(producer_io_connection) &&
-        (input_point == producer_io_connection->produced_path.instance_id) &&
-        (kEipInvalidSocket !=
-         producer_io_connection->socket[kUdpCommuncationDirectionProducing]) )
+  ConnectionIndexIterator iterator;
+  ProducedInstanceIteratorBegin(&iterator, input_point);
+  CipConnectionObject *producer_io_connection = NULL;
+
+  while (NULL !=
+         (producer_io_connection = ProducedInstanceIteratorNext(&iterator) ) ) {
+    if ( (kConnectionObjectStateEstablished ==
+          ConnectionObjectGetState(producer_io_connection) ) &&
+         (kEipInvalidSocket !=
+          producer_io_connection->socket[kUdpCommuncationDirectionProducing]) )
     {
       ConnectionObjectConnectionType cnxn_type =
         ConnectionObjectGetTToOConnectionType(producer_io_connection);
@@ -373,25 +585,23 @@ CipConnectionObject *GetExistingProducerIoConnection(
         return producer_io_connection;
       }
     }
-    node = node->next;
   }
   return NULL;
 }
 
 CipConnectionObject *GetNextNonControlMasterConnection(
   const EipUint32 input_point) {
-  const DoublyLinkedListNode *node = connection_list.first;
+  ConnectionIndexIterator iterator;
+  ProducedInstanceIteratorBegin(&iterator, input_point);
+  CipConnectionObject *next_non_control_master_connection = NULL;
 
-  while (NULL != node) {
-    CipConnectionObject *next_non_control_master_connection =
-      node->data;
+  while (NULL != (next_non_control_master_connection =
+                    ProducedInstanceIteratorNext(&iterator) ) ) {
     if ( true ==
          ConnectionObjectIsTypeNonLOIOConnection(
            next_non_control_master_connection)
          && kConnectionObjectStateEstablished ==
          ConnectionObjectGetState(next_non_control_master_connection)
-         && input_point ==
-         next_non_control_master_connection->produced_path.instance_id
          &&  kConnectionObjectConnectionTypeMulticast ==
          ConnectionObjectGetTToOConnectionType(
            next_non_control_master_connection)
@@ -404,43 +614,77 @@ CipConnectionObject *GetNextNonControlMasterConnection(
        */
       return next_non_control_master_connection;
     }
-    node = node->next;
   }
   return NULL;
 }
 
+void UpdateMulticastConsumerCount(const EipUint32 input_point) {
+  CipConnectionObject *const producer =
+    GetExistingProducerIoConnection(true, input_point);
+  if (NULL == producer) {
+    return;
+  }
+
+  CipUint consumers = 0;
+  ConnectionIndexIterator iterator;
+  ProducedInstanceIteratorBegin(&iterator, input_point);
+  const CipConnectionObject *connection = NULL;
+  while (NULL != (connection = ProducedInstanceIteratorNext(&iterator) ) ) {
+    if (kConnectionObjectStateEstablished ==
+        ConnectionObjectGetState(connection)
+        && kConnectionObjectConnectionTypeMulticast ==
+        ConnectionObjectGetTToOConnectionType(connection) ) {
+      consumers++;
+    }
+  }
+  producer->multicast_consumer_count = consumers;
+  OPENER_TRACE_INFO("Multicast production of input %" PRIu32
+                    " serves %u connections\n", input_point,
+                    (unsigned) consumers);
+}
+
 void CloseAllConnectionsForInputWithSameType(const EipUint32 input_point,
                                              const ConnectionObjectInstanceType instance_type)
 {
 
   OPENER_TRACE_INFO("Close all instance type %d only connections\n",
                     instance_type);
+  /* The connections of one input depend on each other, closing them one by
+   * one would hand the production over and recount the consumers on every
+   * close. The close function tells the application. */
+  bool closed = false;
+  IoConnectionBeginBatchClose();
   const DoublyLinkedListNode *node = connection_list.first;
   while (NULL != node) {
     CipConnectionObject *const connection = node->data;
     node = node->next;
     if ( (instance_type == ConnectionObjectGetInstanceType(connection) )
          && (input_point == connection->produced_path.instance_id) ) {
-      CipConnectionObject *connection_to_delete = connection;
-      CheckIoConnectionEvent(
-        connection_to_delete->consumed_path.instance_id,
-        connection_to_delete->produced_path.instance_id,
-        kIoConnectionEventClosed);
-
-      assert(connection_to_delete->connection_close_function != NULL);
-      connection_to_delete->connection_close_function(connection_to_delete);
+      assert(connection->connection_close_function != NULL);
+      connection->connection_close_function(connection);
+      closed = true;
     }
   }
+  IoConnectionEndBatchClose();
+  if (closed) {
+    UpdateMulticastConsumerCount(input_point);
+  }
 }
 
 void CloseAllConnections(void) {
-  const DoublyLinkedListNode *node = connection_list.first;
-  while (NULL != node) {
+  /* Everything goes: take the list and its lookups down at once, then close
+   * each connection without handing anything over to the others */
+  DoublyLinkedList detached;
+  DetachActiveConnections(&detached);
+  IoConnectionBeginBatchClose();
+  for (const DoublyLinkedListNode *node = detached.first; NULL != node;
+       node = node->next) {
     CipConnectionObject *const connection = node->data;
     assert(connection->connection_close_function != NULL);
     connection->connection_close_function(connection);
-    node = connection_list.first;
   }
+  IoConnectionEndBatchClose();
+  ReleaseDetachedConnections(&detached);
 }
 
 bool ConnectionWithSameConfigPointExists(const EipUint32 config_point) {
@@ -465,4 +709,9 @@ void InitializeIoConnectionData(void) {
           OPENER_CIP_NUM_INPUT_ONLY_CONNS * sizeof(InputOnlyConnection) );
   memset( g_listen_only_connections, 0,
           OPENER_CIP_NUM_LISTEN_ONLY_CONNS * sizeof(ListenOnlyConnection) );
+#if !OPENER_SEALED_CONFIGURATION
+  memset( g_exclusive_owner_points, 0, sizeof(g_exclusive_owner_points) );
+  memset( g_input_only_points, 0, sizeof(g_input_only_points) );
+  memset( g_listen_only_points, 0, sizeof(g_listen_only_points) );
+#endif
 }
@@ -8,6 +8,12 @@
 
 #include "cipconnectionmanager.h"
 
+#ifndef OPENER_CIP_REDUNDANT_OWNER
+/** Accept a standby for an exclusive owner when both set the O->T redundant
+ * owner bit, see PromoteRedundantOwnerStandby() */
+#define OPENER_CIP_REDUNDANT_OWNER 0
+#endif
+
 void InitializeIoConnectionData(void);
 
 /** @brief check if for the given connection data received in a forward_open request
@@ -49,6 +55,16 @@ CipConnectionObject *GetExistingProducerIoConnection(
 CipConnectionObject *GetNextNonControlMasterConnection(
   const EipUint32 input_point);
 
+/** @brief Count the established multicast connections consuming an input
+ * and store the count at the connection producing it.
+ *
+ * Has to be called whenever a multicast connection of the input is opened,
+ * closed or times out.
+ *
+ * @param input_point the produced input
+ */
+void UpdateMulticastConsumerCount(const EipUint32 input_point);
+
 /** @brief Close all connection producing the same input and have the same type
  * (i.e., listen only or input only).
  *
@@ -65,6 +81,18 @@ void CloseAllConnectionsForInputWithSameType(const EipUint32 input_point,
  */
 void CloseAllConnections(void);
 
+/** @brief Hand the outputs of a redundant exclusive owner to its standby
+ *
+ * The standby of an output point consumes and keeps its watchdog running,
+ * but its data is not applied. When the owner in control times out or is
+ * closed the standby takes control at once, the output assembly keeps the
+ * data of the old owner until the first packet of the new one.
+ *
+ * @param owner the exclusive owner connection that times out or closes
+ * @return true if a standby took control of the outputs
+ */
+bool PromoteRedundantOwnerStandby(const CipConnectionObject *const owner);
+
 /** @brief Check if there is an established connection that uses the same
  * config point.
  *
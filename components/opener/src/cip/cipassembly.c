@@ -13,6 +13,29 @@
 #include "opener_api.h"
 #include "trace.h"
 #include "cipconnectionmanager.h"
+#include "generic_networkhandler.h"
+#include "seqlock.h"
+#include "wcet_profile.h"
+
+#ifndef OPENER_ASSEMBLY_EXPLICIT_READ_MAX_AGE_MS
+/** Age up to which an explicit read gets the data last handed out by
+ *  BeforeAssemblyDataSend(), 0 asks the application on every read */
+#define OPENER_ASSEMBLY_EXPLICIT_READ_MAX_AGE_MS 0
+#endif
+
+/** @brief Data of attribute 3 and the lock readers of snapshots use */
+typedef struct {
+  CipByteArray byte_array; /**< first, the attribute data points to it */
+  SeqLock lock;
+  MicroSeconds last_send_update; /**< last BeforeAssemblyDataSend(), 0 if never */
+  CipUdint data_version; /**< advanced whenever BeforeAssemblyDataSend() reports a change */
+  const EipUint16 *member_sizes; /**< see SetAssemblyMembers(), NULL if none */
+  CipUint member_count;
+} AssemblyData;
+
+#if OPENER_SEALED_CONFIGURATION
+CipClass *g_assembly_class = NULL;
+#endif
 
 /** @brief Retrieve the given data according to CIP encoding from the
  *              message buffer.
@@ -30,14 +53,38 @@ int DecodeCipAssemblyAttribute3(void *const data,
                                 CipMessageRouterRequest *const message_router_request,
                                 CipMessageRouterResponse *const message_router_response);
 
+/** @brief Hand new data of an assembly to the application
+ *
+ *  AfterAssemblyDataReceived() with its execution time profiled.
+ */
+static EipStatus CallAfterAssemblyDataReceived(CipInstance *const instance);
+
 static EipStatus AssemblyPreGetCallback(CipInstance *const instance,
-                                        CipAttributeStruct *const attribute,
+                                        const CipAttributeStruct *const attribute,
                                         CipByte service);
 
 static EipStatus AssemblyPostSetCallback(CipInstance *const instance,
-                                         CipAttributeStruct *const attribute,
+                                         const CipAttributeStruct *const attribute,
                                          CipByte service);
 
+static EipStatus AssemblyGetAttributeSingle(CipInstance *RESTRICT const instance,
+                                            CipMessageRouterRequest *const message_router_request,
+                                            CipMessageRouterResponse *const message_router_response,
+                                            const struct sockaddr *originator_address,
+                                            const CipSessionHandle encapsulation_session);
+
+static EipStatus AssemblyGetMember(CipInstance *RESTRICT const instance,
+                                   CipMessageRouterRequest *const message_router_request,
+                                   CipMessageRouterResponse *const message_router_response,
+                                   const struct sockaddr *originator_address,
+                                   const CipSessionHandle encapsulation_session);
+
+static EipStatus AssemblySetMember(CipInstance *RESTRICT const instance,
+                                   CipMessageRouterRequest *const message_router_request,
+                                   CipMessageRouterResponse *const message_router_response,
+                                   const struct sockaddr *originator_address,
+                                   const CipSessionHandle encapsulation_session);
+
 /** @brief Constructor for the assembly object class
  *
  *  Creates an initializes Assembly class or object instances
@@ -48,9 +95,9 @@ CipClass *CreateAssemblyClass(void) {
   CipClass *assembly_class = CreateCipClass(kCipAssemblyClassCode, 0, /* # class attributes*/
                                             7, /* # highest class attribute number*/
                                             1, /* # class services*/
-                                            2, /* # instance attributes*/
+                                            2, /* # instance attributes, 1 and 2 are encoded by AssemblyGetAttributeSingle() */
                                             4, /* # highest instance attribute number*/
-                                            2, /* # instance services*/
+                                            4, /* # instance services*/
                                             0, /* # instances*/
                                             "assembly", /* name */
                                             2, /* Revision, according to the CIP spec currently this has to be 2 */
@@ -58,7 +105,7 @@ CipClass *CreateAssemblyClass(void) {
   if(NULL != assembly_class) {
     InsertService(assembly_class,
                   kGetAttributeSingle,
-                  &GetAttributeSingle,
+                  &AssemblyGetAttributeSingle,
                   "GetAttributeSingle");
 
     InsertService(assembly_class,
@@ -66,9 +113,22 @@ CipClass *CreateAssemblyClass(void) {
                   &SetAttributeSingle,
                   "SetAttributeSingle");
 
+    InsertService(assembly_class,
+                  kGetMember,
+                  &AssemblyGetMember,
+                  "GetMember");
+
+    InsertService(assembly_class,
+                  kSetMember,
+                  &AssemblySetMember,
+                  "SetMember");
+
     InsertGetSetCallback(assembly_class, AssemblyPreGetCallback, kPreGetFunc);
     InsertGetSetCallback(assembly_class, AssemblyPostSetCallback, kPostSetFunc);
   }
+#if OPENER_SEALED_CONFIGURATION
+  g_assembly_class = assembly_class;
+#endif
 
   return assembly_class;
 }
@@ -81,7 +141,7 @@ EipStatus CipAssemblyInitialize(void) {
 }
 
 void ShutdownAssemblies(void) {
-  const CipClass *const assembly_class = GetCipClass(kCipAssemblyClassCode);
+  const CipClass *const assembly_class = GetAssemblyClass();
 
   if(NULL != assembly_class) {
     const CipInstance *instance = assembly_class->instances;
@@ -93,12 +153,22 @@ void ShutdownAssemblies(void) {
       instance = instance->next;
     }
   }
+#if OPENER_SEALED_CONFIGURATION
+  g_assembly_class = NULL; /* deleted with all classes next */
+#endif
 }
 
 CipInstance *CreateAssemblyObject(const CipInstanceNum instance_id,
                                   EipByte *const data,
                                   const EipUint16 data_length) {
-  CipClass *assembly_class = GetCipClass(kCipAssemblyClassCode);
+#if OPENER_SEALED_CONFIGURATION
+  if(GetSealedAssemblySize(instance_id) != data_length) {
+    OPENER_TRACE_ERR("Assembly %u of %u bytes is not a sealed one\n",
+                     (unsigned) instance_id, (unsigned) data_length);
+    return NULL;
+  }
+#endif
+  CipClass *assembly_class = GetAssemblyClass();
   if(NULL == assembly_class) {
     assembly_class = CreateAssemblyClass();
   }
@@ -109,12 +179,13 @@ CipInstance *CreateAssemblyObject(const CipInstanceNum instance_id,
 
   CipInstance *const instance = AddCipInstance(assembly_class, instance_id); /* add instances (always succeeds (or asserts))*/
 
-  CipByteArray *const assembly_byte_array = (CipByteArray *) CipCalloc(1,
-                                                                       sizeof(
-                                                                         CipByteArray) );
-  if(assembly_byte_array == NULL) {
+  AssemblyData *const assembly_data = (AssemblyData *) CipCalloc(1,
+                                                                 sizeof(
+                                                                   AssemblyData) );
+  if(assembly_data == NULL) {
     return NULL; /*TODO remove assembly instance in case of error*/
   }
+  CipByteArray *const assembly_byte_array = &assembly_data->byte_array;
 
   assembly_byte_array->length = data_length;
   assembly_byte_array->data = data;
@@ -134,22 +205,86 @@ CipInstance *CreateAssemblyObject(const CipInstanceNum instance_id,
   return instance;
 }
 
+EipStatus SetAssemblyMembers(CipInstance *const instance,
+                             const EipUint16 *const member_sizes,
+                             const CipUint member_count) {
+  if(NULL == instance) {
+    return kEipStatusError;
+  }
+  AssemblyData *const assembly_data =
+    (AssemblyData *) instance->attributes->data;
+  size_t length = 0;
+  for(CipUint member = 0; member < member_count; ++member) {
+    length += member_sizes[member];
+  }
+  if(length != assembly_data->byte_array.length) {
+    OPENER_TRACE_ERR("members of assembly %u do not match its size\n",
+                     (unsigned) instance->instance_number);
+    return kEipStatusError;
+  }
+  assembly_data->member_sizes = member_sizes;
+  assembly_data->member_count = member_count;
+  return kEipStatusOk;
+}
+
+/** @brief Locate the member a Get_Member or Set_Member request addresses
+ *
+ *  Sets the general status of the response if the path does not address a
+ *  member of attribute 3.
+ *
+ *  @return true with offset and size of the member in attribute 3
+ */
+static bool GetRequestedMember(const AssemblyData *const assembly_data,
+                               const CipMessageRouterRequest *const message_router_request,
+                               CipMessageRouterResponse *const message_router_response,
+                               size_t *const offset,
+                               size_t *const size) {
+  const EipUint16 member_number =
+    message_router_request->request_path.member_number;
+  if(kAssemblyObjectInstanceAttributeIdData !=
+     message_router_request->request_path.attribute_number) {
+    return false; /* kCipErrorAttributeNotSupported from the header */
+  }
+  if(0 == member_number || member_number > assembly_data->member_count) {
+    message_router_response->general_status = kCipErrorInvalidMemberId;
+    return false;
+  }
+  *offset = 0;
+  for(CipUint member = 0; member < member_number - 1U; ++member) {
+    *offset += assembly_data->member_sizes[member];
+  }
+  *size = assembly_data->member_sizes[member_number - 1U];
+  return true;
+}
+
+static EipStatus CallAfterAssemblyDataReceived(CipInstance *const instance) {
+  OPENER_WCET_PROFILE_BEGIN(application_start);
+  const EipStatus status = AfterAssemblyDataReceived(instance);
+  OPENER_WCET_PROFILE_END(application_start, kWcetProfileKindCallback,
+                          kCipAssemblyClassCode,
+                          kWcetProfileCallbackAfterAssemblyDataReceived,
+                          "AfterAssemblyDataReceived",
+                          instance->instance_number, 0);
+  return status;
+}
+
 EipStatus NotifyAssemblyConnectedDataReceived(CipInstance *const instance,
                                               const EipUint8 *const data,
                                               const size_t data_length) {
   /* empty path (path size = 0) need to be checked and taken care of in future */
   /* copy received data to Attribute 3 */
-  const CipByteArray *const assembly_byte_array =
-    (CipByteArray *) instance->attributes->data;
-  if(assembly_byte_array->length != data_length) {
+  AssemblyData *const assembly_data =
+    (AssemblyData *) instance->attributes->data;
+  if(assembly_data->byte_array.length != data_length) {
     OPENER_TRACE_ERR("wrong amount of data arrived for assembly object\n");
     return kEipStatusError; /*TODO question should we notify the application that wrong data has been received???*/
   } else {
-    memcpy(assembly_byte_array->data, data, data_length);
+    SeqLockWrite(&assembly_data->lock, assembly_data->byte_array.data, data,
+                 data_length);
     /* call the application that new data arrived */
   }
 
-  return AfterAssemblyDataReceived(instance);
+  return CallAfterAssemblyDataReceived(instance);
 }
 
 int DecodeCipAssemblyAttribute3(void *const data,
@@ -179,11 +314,12 @@ int DecodeCipAssemblyAttribute3(void *const data,
   }
 
   // data-length is correct
-  memcpy(cip_byte_array->data,
-         message_router_request->data,
-         cip_byte_array->length);
+  SeqLockWrite(&( (AssemblyData *)data )->lock,
+               cip_byte_array->data,
+               message_router_request->data,
+               cip_byte_array->length);
 
-  if(AfterAssemblyDataReceived(instance) != kEipStatusOk) {
+  if(CallAfterAssemblyDataReceived(instance) != kEipStatusOk) {
     /* punt early without updating the status... though I don't know
      * how much this helps us here, as the attribute's data has already
      * been overwritten.
@@ -203,25 +339,201 @@ int DecodeCipAssemblyAttribute3(void *const data,
 }
 
 static EipStatus AssemblyPreGetCallback(CipInstance *const instance,
-                                        CipAttributeStruct *const attribute,
+                                        const CipAttributeStruct *const attribute,
                                         CipByte service) {
   int rc;
   (void) attribute;
   (void) service; /* no unused parameter warnings */
 
-  rc = BeforeAssemblyDataSend(instance);
+#if OPENER_ASSEMBLY_EXPLICIT_READ_MAX_AGE_MS > 0
+  /* Serve polling explicit reads from the data the I/O production or a
+   * previous read packed; the application is asked again once that is
+   * older than the bound */
+  const AssemblyData *const assembly_data =
+    (const AssemblyData *) instance->attributes->data;
+  if(0 != assembly_data->last_send_update &&
+     GetMicroSeconds() - assembly_data->last_send_update <
+     OPENER_ASSEMBLY_EXPLICIT_READ_MAX_AGE_MS * 1000ULL) {
+    return kEipStatusOk;
+  }
+#endif
+  rc = NotifyAssemblyDataSend(instance);
 
   return rc;
 }
 
 static EipStatus AssemblyPostSetCallback(CipInstance *const instance,
-                                         CipAttributeStruct *const attribute,
+                                         const CipAttributeStruct *const attribute,
                                          CipByte service) {
   int rc;
   (void) attribute;
   (void) service; /* no unused parameter warnings */
 
-  rc = AfterAssemblyDataReceived(instance);
+  rc = CallAfterAssemblyDataReceived(instance);
 
   return rc;
 }
+
+/** @brief GetAttributeSingle with the member attributes 1 and 2
+ *
+ *  The member list is not kept in attributes of its own, attribute 3 stays
+ *  the first attribute of the instance.
+ */
+static EipStatus AssemblyGetAttributeSingle(CipInstance *RESTRICT const instance,
+                                            CipMessageRouterRequest *const message_router_request,
+                                            CipMessageRouterResponse *const message_router_response,
+                                            const struct sockaddr *originator_address,
+                                            const CipSessionHandle encapsulation_session) {
+  const AssemblyData *const assembly_data =
+    (const AssemblyData *) instance->attributes->data;
+  const EipUint16 attribute_number =
+    message_router_request->request_path.attribute_number;
+  if( (kAssemblyObjectInstanceAttributeIdNumberOfMembers != attribute_number &&
+       kAssemblyObjectInstanceAttributeIdMemberList != attribute_number) ||
+      0 == assembly_data->member_count ) {
+    return GetAttributeSingle(instance, message_router_request,
+                              message_router_response, originator_address,
+                              encapsulation_session);
+  }
+
+  GenerateGetAttributeSingleHeader(message_router_request,
+                                   message_router_response);
+  ENIPMessage *const message = &message_router_response->message;
+  if(kAssemblyObjectInstanceAttributeIdNumberOfMembers == attribute_number) {
+    AddIntToMessage(assembly_data->member_count, message);
+  } else {
+    /* Member data description in bits and an empty member path each */
+    if(assembly_data->member_count * 2U * sizeof(CipUint) >
+       message->message_buffer_size - message->used_message_length) {
+      message_router_response->general_status = kCipErrorReplyDataTooLarge;
+      return kEipStatusOkSend;
+    }
+    for(CipUint member = 0; member < assembly_data->member_count; ++member) {
+      AddIntToMessage( (EipUint16) (assembly_data->member_sizes[member] * 8U),
+                       message );
+      AddIntToMessage(0, message);
+    }
+  }
+  message_router_response->general_status = kCipErrorSuccess;
+  return kEipStatusOkSend;
+}
+
+/** @brief Get_Member of attribute 3, copies only the requested member */
+static EipStatus AssemblyGetMember(CipInstance *RESTRICT const instance,
+                                   CipMessageRouterRequest *const message_router_request,
+                                   CipMessageRouterResponse *const message_router_response,
+                                   const struct sockaddr *originator_address,
+                                   const CipSessionHandle encapsulation_session) {
+  (void) originator_address;
+  (void) encapsulation_session;
+
+  const AssemblyData *const assembly_data =
+    (const AssemblyData *) instance->attributes->data;
+  GenerateGetAttributeSingleHeader(message_router_request,
+                                   message_router_response);
+  size_t offset = 0;
+  size_t size = 0;
+  if( !GetRequestedMember(assembly_data, message_router_request,
+                          message_router_response, &offset, &size) ) {
+    return kEipStatusOkSend;
+  }
+
+  /* The same data age bound as reads of the whole attribute */
+  (void) AssemblyPreGetCallback(instance, instance->attributes,
+                                message_router_request->service);
+  ENIPMessage *const message = &message_router_response->message;
+  memcpy(message->current_message_position,
+         assembly_data->byte_array.data + offset, size);
+  message->current_message_position += size;
+  message->used_message_length += size;
+  message_router_response->general_status = kCipErrorSuccess;
+  return kEipStatusOkSend;
+}
+
+/** @brief Set_Member of attribute 3, replaces only the requested member */
+static EipStatus AssemblySetMember(CipInstance *RESTRICT const instance,
+                                   CipMessageRouterRequest *const message_router_request,
+                                   CipMessageRouterResponse *const message_router_response,
+                                   const struct sockaddr *originator_address,
+                                   const CipSessionHandle encapsulation_session) {
+  (void) originator_address;
+  (void) encapsulation_session;
+
+  AssemblyData *const assembly_data =
+    (AssemblyData *) instance->attributes->data;
+  GenerateSetAttributeSingleHeader(message_router_request,
+                                   message_router_response);
+  size_t offset = 0;
+  size_t size = 0;
+  if( !GetRequestedMember(assembly_data, message_router_request,
+                          message_router_response, &offset, &size) ) {
+    return kEipStatusOkSend;
+  }
+  if(message_router_request->request_data_size < size) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
+  if(message_router_request->request_data_size > size) {
+    message_router_response->general_status = kCipErrorTooMuchData;
+    return kEipStatusOkSend;
+  }
+
+  SeqLockWrite(&assembly_data->lock, assembly_data->byte_array.data + offset,
+               message_router_request->data, size);
+  InvalidateGetAttributeAllCache(instance);
+  message_router_response->general_status =
+    (kEipStatusOk == CallAfterAssemblyDataReceived(instance) ) ?
+    kCipErrorSuccess : kCipErrorInvalidAttributeValue;
+  return kEipStatusOkSend;
+}
+
+EipBool8 NotifyAssemblyDataSend(CipInstance *const instance) {
+  AssemblyData *const assembly_data =
+    (AssemblyData *) instance->attributes->data;
+  SeqLockWriteBegin(&assembly_data->lock);
+  OPENER_WCET_PROFILE_BEGIN(application_start);
+  const EipBool8 data_changed = BeforeAssemblyDataSend(instance);
+  OPENER_WCET_PROFILE_END(application_start, kWcetProfileKindCallback,
+                          kCipAssemblyClassCode,
+                          kWcetProfileCallbackBeforeAssemblyDataSend,
+                          "BeforeAssemblyDataSend",
+                          instance->instance_number, 0);
+  SeqLockWriteEnd(&assembly_data->lock);
+  if(data_changed) {
+    assembly_data->data_version++;
+  }
+#if OPENER_ASSEMBLY_EXPLICIT_READ_MAX_AGE_MS > 0
+  assembly_data->last_send_update = GetMicroSeconds();
+#endif
+  return data_changed;
+}
+
+CipUdint GetAssemblyDataVersion(const CipInstance *const instance) {
+  return ( (const AssemblyData *) instance->attributes->data )->data_version;
+}
+
+EipStatus GetAssemblyDataSnapshot(const CipInstanceNum instance_number,
+                                  EipByte *const buffer,
+                                  const size_t buffer_size,
+                                  size_t *const data_length,
+                                  CipUdint *const version) {
+  const CipInstance *const instance =
+    GetCipInstance(GetAssemblyClass(), instance_number);
+  if(NULL == instance) {
+    return kEipStatusError;
+  }
+  const AssemblyData *const assembly_data =
+    (const AssemblyData *) instance->attributes->data;
+  const size_t length = assembly_data->byte_array.length;
+  if(length > buffer_size) {
+    return kEipStatusError;
+  }
+  if( !SeqLockRead(&assembly_data->lock, buffer,
+                   assembly_data->byte_array.data, length, version) ) {
+    return kEipStatusError;
+  }
+  if(NULL != data_length) {
+    *data_length = length;
+  }
+  return kEipStatusOk;
+}
@@ -19,6 +19,8 @@ static const CipUint kCipAssemblyClassCode = 0x04U;
  * \cite CipVol1, Table 5-5.4
  */
 typedef enum {
+  kAssemblyObjectInstanceAttributeIdNumberOfMembers = 1,
+  kAssemblyObjectInstanceAttributeIdMemberList = 2,
   kAssemblyObjectInstanceAttributeIdData = 3
 } AssemblyObjectInstanceAttributeId;
 
@@ -58,4 +60,82 @@ EipStatus NotifyAssemblyConnectedDataReceived(CipInstance *const instance,
                                               const EipUint8 *const data,
                                               const size_t data_length);
 
+/** @brief notify the application that the data of an Assembly object is sent
+ *
+ *  Calls BeforeAssemblyDataSend() with a new version of the assembly data in
+ *  progress, so the application may update attribute 3 in the callback.
+ *
+ *  @param instance the assembly object instance about to be sent
+ *  @return the result of BeforeAssemblyDataSend()
+ */
+EipBool8 NotifyAssemblyDataSend(CipInstance *const instance);
+
+/** @brief Version of the data of an Assembly object
+ *
+ *  Advanced by NotifyAssemblyDataSend() each time BeforeAssemblyDataSend()
+ *  reports changed data, so every producing connection can tell whether the
+ *  data changed since its own last production.
+ *
+ *  @param instance the assembly object instance
+ *  @return the version, wraps around
+ */
+CipUdint GetAssemblyDataVersion(const CipInstance *const instance);
+
+/** @brief Take a consistent copy of the data of an Assembly object
+ *
+ *  Lock free, may be called from any task once the assemblies are created.
+ *  The stack publishes a new version whenever it receives data for the
+ *  assembly or the application updated it in BeforeAssemblyDataSend().
+ *
+ *  @param instance_number the assembly object instance to copy
+ *  @param buffer destination of the copy
+ *  @param buffer_size size of buffer in bytes
+ *  @param data_length set to the number of bytes copied if not NULL
+ *  @param version set to the version of the copy if not NULL
+ *  @return
+ *     - kEipStatusOk buffer holds a consistent copy
+ *     - kEipStatusError unknown instance, buffer too small or a write was in
+ *       progress, retry later
+ */
+EipStatus GetAssemblyDataSnapshot(const CipInstanceNum instance_number,
+                                  EipByte *const buffer,
+                                  const size_t buffer_size,
+                                  size_t *const data_length,
+                                  CipUdint *const version);
+
+#if OPENER_SEALED_CONFIGURATION
+/** @brief The Assembly class, set when it is created */
+extern CipClass *g_assembly_class;
+
+/** @brief The Assembly class, a load instead of a class lookup */
+#define GetAssemblyClass() (g_assembly_class)
+
+/** @brief Size of attribute 3 of an assembly of the sealed configuration
+ *
+ *  OPENER_SEALED_ASSEMBLIES lists the assemblies with their sizes and
+ *  CreateAssemblyObject() refuses any other, so for a constant instance
+ *  number the size folds to a constant.
+ *
+ *  @param instance_number the assembly object instance
+ *  @return its size in bytes, -1 for an instance that is not sealed
+ */
+static inline int GetSealedAssemblySize(const CipInstanceNum instance_number)
+{
+  static const struct {
+    CipInstanceNum instance_number;
+    EipUint16 size;
+  } kSealedAssemblies[] = { OPENER_SEALED_ASSEMBLIES };
+  for(size_t i = 0; i < sizeof(kSealedAssemblies) /
+      sizeof(kSealedAssemblies[0]); ++i) {
+    if(instance_number == kSealedAssemblies[i].instance_number) {
+      return kSealedAssemblies[i].size;
+    }
+  }
+  return -1;
+}
+#else
+/** @brief The Assembly class */
+#define GetAssemblyClass() GetCipClass(kCipAssemblyClassCode)
+#endif /* OPENER_SEALED_CONFIGURATION */
+
 #endif /* OPENER_CIPASSEMBLY_H_ */
@@ -42,6 +42,9 @@ CipError EstablishClass3Connection(
     ConnectionObjectSetInstanceType(explicit_connection,
                                     kConnectionObjectInstanceTypeExplicitMessaging);
 
+    memset(&explicit_connection->explicit_route, 0,
+           sizeof(explicit_connection->explicit_route) );
+
     /* set the connection call backs */
     explicit_connection->connection_close_function =
       CloseConnection;
@@ -24,9 +24,11 @@
   #include "cipdlr.h"
 #endif
 #include "cipqos.h"
+#include "cipconnectiondiagnostics.h"
 #include "cpf.h"
 #include "trace.h"
 #include "appcontype.h"
+#include "wcet_profile.h"
 #include "cipepath.h"
 #include "stdlib.h"
 #include "ciptypes.h"
@@ -41,6 +43,48 @@
   #include "SecurityObjects/EtherNetIPSecurityObject/ethernetipsecurity.h"
   #include "SecurityObjects/CertificateManagementObject/certificatemanagement.h"
 #endif
+
+#ifndef OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE
+/** Bytes of cached GetAttributeAll encoding per instance with static
+ *  attributes, 0 disables the cache */
+#define OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE 64
+#endif
+
+#ifndef OPENER_CIP_QOS_OBJECT
+/** Create the QoS object, without it the default DSCP values apply */
+#define OPENER_CIP_QOS_OBJECT 1
+#endif
+
+#ifndef OPENER_CIP_LAZY_OBJECTS
+/** Create the optional objects on their first use instead of in
+ *  CipStackInit(), see RegisterDeferredCipClass() */
+#define OPENER_CIP_LAZY_OBJECTS 0
+#endif
+
+/** Marks the last step of a GetAttributeAll cache, no attribute follows */
+#define GET_ATTRIBUTE_ALL_NO_ATTRIBUTE 0xFFFF
+
+/** @brief One run of cached bytes and the attribute encoded after them */
+typedef struct {
+  EipUint16 length; /**< bytes of cached encoding */
+  EipUint16 attribute_index; /**< index of the attribute encoded next, GET_ATTRIBUTE_ALL_NO_ATTRIBUTE after the last run */
+} GetAttributeAllStep;
+
+/** @brief Cached GetAttributeAll encoding of an instance
+ *
+ * A reply is the concatenation of the steps: the cached bytes of a run of
+ * kGetableAllStatic attributes, then the fresh encoding of the attribute
+ * that breaks the run.
+ */
+typedef struct cip_get_attribute_all_cache {
+  bool valid; /**< the steps and data describe the current values */
+  EipUint16 number_of_steps; /**< dynamic GetAttributeAll attributes + 1 */
+  GetAttributeAllStep *steps;
+  CipOctet *data; /**< OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE bytes */
+} GetAttributeAllCache;
+
+static void CreateGetAttributeAllCache(CipInstance *const instance);
+
 /* private functions*/
 
 EipStatus CipStackInit(const EipUint16 unique_connection_id) {
@@ -57,12 +101,32 @@ EipStatus CipStackInit(const EipUint16 unique_connection_id) {
   OPENER_ASSERT(kEipStatusOk == eip_status);
   eip_status = CipAssemblyInitialize();
   OPENER_ASSERT(kEipStatusOk == eip_status);
+  /* The optional objects only hold data of their own module, they work
+   * the same whether their class exists yet or not */
+#if 0 != OPENER_CIP_LAZY_OBJECTS
+#if defined(OPENER_IS_DLR_DEVICE) && 0 != OPENER_IS_DLR_DEVICE
+  eip_status = RegisterDeferredCipClass(kCipDlrClassCode, CipDlrInit);
+  OPENER_ASSERT(kEipStatusOk == eip_status);
+#endif
+#if 0 != OPENER_CIP_QOS_OBJECT
+  eip_status = RegisterDeferredCipClass(kCipQoSClassCode, CipQoSInit);
+  OPENER_ASSERT(kEipStatusOk == eip_status);
+#endif
+  eip_status = RegisterDeferredCipClass(kCipConnectionDiagnosticsClassCode,
+                                        CipConnectionDiagnosticsInit);
+  OPENER_ASSERT(kEipStatusOk == eip_status);
+#else
 #if defined(OPENER_IS_DLR_DEVICE) && 0 != OPENER_IS_DLR_DEVICE
   eip_status = CipDlrInit();
   OPENER_ASSERT(kEipStatusOk == eip_status);
 #endif
+#if 0 != OPENER_CIP_QOS_OBJECT
   eip_status = CipQoSInit();
   OPENER_ASSERT(kEipStatusOk == eip_status);
+#endif
+  eip_status = CipConnectionDiagnosticsInit();
+  OPENER_ASSERT(kEipStatusOk == eip_status);
+#endif
 
 #if defined(CIP_FILE_OBJECT) && 0 != CIP_FILE_OBJECT
   eip_status = CipFileInit();
@@ -115,25 +179,25 @@ EipStatus NotifyClass(const CipClass *RESTRICT const cip_class,
                       instance_number,
                       instance_number == 0 ? " (class object)" : "");
 
-    CipServiceStruct *service = instance->cip_class->services; /* get pointer to array of services */
-    if(NULL != service) /* if services are defined */
+    CipServiceStruct *service = GetCipService(instance,
+                                              message_router_request->service);
+    if(NULL != service) /* if match is found */
     {
-      for(size_t i = 0; i < instance->cip_class->number_of_services; i++) /* seach the services list */
-      {
-        if(message_router_request->service == service->service_number) /* if match is found */
-        {
-          /* call the service, and return what it returns */
-          OPENER_TRACE_INFO("notify: calling %s service\n", service->name);
-          OPENER_ASSERT(NULL != service->service_function);
-          return service->service_function(instance,
-                                           message_router_request,
-                                           message_router_response,
-                                           originator_address,
-                                           encapsulation_session);
-        } else {
-          service++;
-        }
-      }
+      /* call the service, and return what it returns */
+      OPENER_TRACE_INFO("notify: calling %s service\n", service->name);
+      OPENER_ASSERT(NULL != service->service_function);
+      OPENER_WCET_PROFILE_BEGIN(service_start);
+      const EipStatus service_status =
+        service->service_function(instance,
+                                  message_router_request,
+                                  message_router_response,
+                                  originator_address,
+                                  encapsulation_session);
+      OPENER_WCET_PROFILE_END(service_start, kWcetProfileKindService,
+                              cip_class->class_code, service->service_number,
+                              service->name, instance_number,
+                              message_router_request->request_path.attribute_number);
+      return service_status;
     } OPENER_TRACE_WARN(
       "notify: service 0x%x not supported\n", message_router_request->service);
     message_router_response->general_status = kCipErrorServiceNotSupported; /* if no services or service not found, return an error reply*/
@@ -146,7 +210,7 @@ EipStatus NotifyClass(const CipClass *RESTRICT const cip_class,
 
   /* handle error replies*/
   message_router_response->size_of_additional_status = 0; /* fill in the rest of the reply with not much of anything*/
-  InitializeENIPMessage(&message_router_response->message);
+  ClearENIPMessage(&message_router_response->message);
   message_router_response->reply_service =
     (0x80 | message_router_request->service);                                        /* except the reply code is an echo of the command + the reply flag */
 
@@ -165,6 +229,44 @@ CipUint GetMaxInstanceNumber(CipClass *RESTRICT const cip_class) {
   return max_instance;
 }
 
+void UpdateCipInstanceIndex(CipClass *RESTRICT const cip_class) {
+  MessageRouterInvalidateRoutes();
+  CipFree(cip_class->instance_index);
+  cip_class->instance_index = NULL;
+  cip_class->instance_index_length = 0;
+
+  size_t number_of_instances = 0;
+  for(CipInstance *instance = cip_class->instances; NULL != instance;
+      instance = instance->next) {
+    number_of_instances++;
+  }
+  if(0 == number_of_instances) {
+    return;
+  }
+  CipInstance **index = (CipInstance **) CipCalloc(number_of_instances,
+                                                   sizeof(CipInstance *) );
+  if(NULL == index) {
+    OPENER_TRACE_WARN("no memory for the instance index of class %s\n",
+                      cip_class->class_name);
+    return;
+  }
+  /* insertion sort, the list is almost always in order already */
+  size_t length = 0;
+  for(CipInstance *instance = cip_class->instances; NULL != instance;
+      instance = instance->next) {
+    size_t position = length;
+    while(position > 0 &&
+          index[position - 1]->instance_number > instance->instance_number) {
+      index[position] = index[position - 1];
+      position--;
+    }
+    index[position] = instance;
+    length++;
+  }
+  cip_class->instance_index = index;
+  cip_class->instance_index_length = length;
+}
+
 CipInstance *AddCipInstances(CipClass *RESTRICT const cip_class,
                              const CipInstanceNum number_of_instances) {
   CipInstance **next_instance = NULL;
@@ -217,7 +319,7 @@ CipInstance *AddCipInstances(CipClass *RESTRICT const cip_class,
     current_instance->instance_number = instance_number; /* assign the next sequential instance number */
     current_instance->cip_class = cip_class; /* point each instance to its class */
 
-    if(cip_class->number_of_attributes) /* if the class calls for instance attributes */
+    if(cip_class->number_of_attributes && !cip_class->attribute_tables) /* if the class calls for instance attributes */
     { /* then allocate storage for the attribute array */
       current_instance->attributes = (CipAttributeStruct *) CipCalloc(
         cip_class->number_of_attributes,
@@ -235,6 +337,7 @@ CipInstance *AddCipInstances(CipClass *RESTRICT const cip_class,
   }
 
   cip_class->max_instance = GetMaxInstanceNumber(cip_class); /* update largest instance number (class Attribute 2) */
+  UpdateCipInstanceIndex(cip_class);
 
   if(new_instances != number_of_instances) {
     /* TODO: Free again all attributes and instances allocated so far in this call. */
@@ -258,6 +361,7 @@ CipInstance *AddCipInstance(CipClass *RESTRICT const cip_class,
   }
 
   cip_class->max_instance = GetMaxInstanceNumber(cip_class); /* update largest instance number (class Attribute 2) */
+  UpdateCipInstanceIndex(cip_class);
 
   return instance;
 }
@@ -403,6 +507,47 @@ CipClass *CreateCipClass(const CipUdint class_code,
   return cip_class;
 }
 
+/* Adds the attribute to the bit masks of its class */
+static void SetAttributeMasks(CipClass *const cip_class,
+                              const EipUint16 attribute_number,
+                              const EipByte cip_flags) {
+  OPENER_ASSERT(attribute_number <= cip_class->highest_attribute_number);
+
+  size_t index = CalculateIndex(attribute_number);
+
+  cip_class->get_single_bit_mask[index] |=
+    (cip_flags & kGetableSingle) ? 1 << (attribute_number) % 8 : 0;
+  cip_class->get_all_bit_mask[index] |=
+    ( cip_flags & (kGetableAll | kGetableAllDummy) ) ? 1 <<
+      (attribute_number) % 8 : 0;
+  cip_class->set_bit_mask[index] |= ( (cip_flags & kSetable) ? 1 : 0 ) <<
+                                    ( (attribute_number) % 8 );
+}
+
+/* The encoder copied inline for attributes of cip_type, NULL for the types
+ * without a fixed size */
+static CipAttributeEncodeInMessage GetStandardEncoder(const EipUint8 cip_type)
+{
+  switch(cip_type) {
+    case kCipBool: return EncodeCipBool;
+    case kCipSint: return EncodeCipSint;
+    case kCipUsint: return EncodeCipUsint;
+    case kCipByte: return EncodeCipByte;
+    case kCipInt: return EncodeCipInt;
+    case kCipUint: return EncodeCipUint;
+    case kCipWord: return EncodeCipWord;
+    case kCipDint: return EncodeCipDint;
+    case kCipUdint: return EncodeCipUdint;
+    case kCipDword: return EncodeCipDword;
+    case kCipReal: return EncodeCipReal;
+    case kCipLint: return EncodeCipLint;
+    case kCipUlint: return EncodeCipUlint;
+    case kCipLword: return EncodeCipLword;
+    case kCipLreal: return EncodeCipLreal;
+    default: return NULL;
+  }
+}
+
 void InsertAttribute(CipInstance *const instance,
                      const EipUint16 attribute_number,
                      const EipUint8 cip_type,
@@ -413,31 +558,34 @@ void InsertAttribute(CipInstance *const instance,
 
   OPENER_ASSERT(NULL != data); /* Its not allowed to push a NULL pointer, as this marks an unused attribute struct */
 
-  CipAttributeStruct *attribute = instance->attributes;
+  /* the attributes of an instance are only allocated here */
+  CipAttributeStruct *attribute = (CipAttributeStruct *) instance->attributes;
   CipClass *cip_class = instance->cip_class;
 
+  OPENER_ASSERT(!cip_class->attribute_tables);
   OPENER_ASSERT(NULL != attribute);
   /* adding a attribute to a class that was not declared to have any attributes is not allowed */
   for(int i = 0; i < instance->cip_class->number_of_attributes; i++) {
     if(attribute->data == NULL) { /* found non set attribute */
+      /* keep the set attributes sorted by number for GetCipAttribute() */
+      while(attribute != instance->attributes &&
+            (attribute - 1)->attribute_number > attribute_number) {
+        *attribute = *(attribute - 1);
+        attribute--;
+      }
       attribute->attribute_number = attribute_number;
       attribute->type = cip_type;
+      /* an elementary type with an encoder of its own keeps the call */
+      attribute->encoding = (NULL != encode_function &&
+                             GetStandardEncoder(cip_type) == encode_function)
+                            ? CIP_ATTRIBUTE_ENCODING(cip_type)
+                            : kCipAttributeEncodingFunction;
       attribute->encode = encode_function;
       attribute->decode = decode_function;
       attribute->attribute_flags = cip_flags;
       attribute->data = data;
 
-      OPENER_ASSERT(attribute_number <= cip_class->highest_attribute_number);
-
-      size_t index = CalculateIndex(attribute_number);
-
-      cip_class->get_single_bit_mask[index] |=
-        (cip_flags & kGetableSingle) ? 1 << (attribute_number) % 8 : 0;
-      cip_class->get_all_bit_mask[index] |=
-        ( cip_flags & (kGetableAll | kGetableAllDummy) ) ? 1 <<
-          (attribute_number) % 8 : 0;
-      cip_class->set_bit_mask[index] |= ( (cip_flags & kSetable) ? 1 : 0 ) <<
-                                        ( (attribute_number) % 8 );
+      SetAttributeMasks(cip_class, attribute_number, cip_flags);
 
       return;
     }
@@ -451,6 +599,194 @@ void InsertAttribute(CipInstance *const instance,
   /* trying to insert too many attributes*/
 }
 
+void SetCipInstanceAttributes(CipInstance *const instance,
+                              const CipAttributeStruct *const attributes,
+                              const EipUint16 number_of_attributes) {
+  CipClass *const cip_class = instance->cip_class;
+
+  /* a class with allocated attributes, or a table of another length, would
+   * break GetCipAttribute() and the release in ShutdownCipStack() */
+  OPENER_ASSERT(NULL == instance->attributes);
+  OPENER_ASSERT(cip_class->attribute_tables ||
+                0 == cip_class->number_of_attributes);
+  OPENER_ASSERT(!cip_class->attribute_tables ||
+                number_of_attributes == cip_class->number_of_attributes);
+
+  for(EipUint16 i = 0; i < number_of_attributes; ++i) {
+    OPENER_ASSERT(NULL != attributes[i].data);
+    /* CIP_ATTRIBUTE() encodes elementary types inline */
+    OPENER_ASSERT(kCipAttributeEncodingFunction == attributes[i].encoding ||
+                  GetStandardEncoder(attributes[i].type) ==
+                  attributes[i].encode);
+    OPENER_ASSERT(0 == i ||
+                  attributes[i - 1].attribute_number <
+                  attributes[i].attribute_number);
+    SetAttributeMasks(cip_class, attributes[i].attribute_number,
+                      attributes[i].attribute_flags);
+  }
+  cip_class->attribute_tables = true;
+  cip_class->number_of_attributes = number_of_attributes;
+  instance->attributes = attributes;
+  CreateGetAttributeAllCache(instance);
+}
+
+static bool IsGetAttributeAllAttribute(const CipAttributeStruct *const attribute)
+{
+  return 0 != ( attribute->attribute_flags & (kGetableAll | kGetableAllDummy) );
+}
+
+/* Set up the cache of an instance whose table has static attributes */
+static void CreateGetAttributeAllCache(CipInstance *const instance) {
+  size_t static_attributes = 0;
+  size_t dynamic_attributes = 0;
+  for(size_t i = 0; i < instance->cip_class->number_of_attributes; ++i) {
+    const CipAttributeStruct *const attribute = &instance->attributes[i];
+    if(IsGetAttributeAllAttribute(attribute) ) {
+      if(attribute->attribute_flags & kGetableAllStatic) {
+        static_attributes++;
+      } else {
+        dynamic_attributes++;
+      }
+    }
+  }
+  if(0 == static_attributes || 0 == OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE) {
+    return;
+  }
+
+  /* one allocation, at initialization, for the cache, its steps and data */
+  const size_t number_of_steps = dynamic_attributes + 1;
+  const size_t size = sizeof(GetAttributeAllCache) +
+                      number_of_steps * sizeof(GetAttributeAllStep) +
+                      OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE;
+  GetAttributeAllCache *const cache = (GetAttributeAllCache *) CipCalloc(1,
+                                                                        size);
+  if(NULL == cache) {
+    OPENER_TRACE_WARN("No GetAttributeAll cache for class %" PRIu32 "\n",
+                      instance->cip_class->class_code);
+    return;
+  }
+  cache->number_of_steps = (EipUint16) number_of_steps;
+  cache->steps = (GetAttributeAllStep *) (cache + 1);
+  cache->data = (CipOctet *) (cache->steps + number_of_steps);
+  instance->get_attribute_all_cache = cache;
+}
+
+void InvalidateGetAttributeAllCache(CipInstance *const instance) {
+  if(NULL != instance && NULL != instance->get_attribute_all_cache) {
+    instance->get_attribute_all_cache->valid = false;
+  }
+}
+
+static void EncodeGetAttributeAllAttribute(CipInstance *const instance,
+                                           const CipAttributeStruct *const attribute,
+                                           CipMessageRouterRequest *const message_router_request,
+                                           CipMessageRouterResponse *const message_router_response,
+                                           const bool call_get_callbacks) {
+  message_router_request->request_path.attribute_number =
+    attribute->attribute_number;
+  if(call_get_callbacks && (attribute->attribute_flags & kPreGetFunc) &&
+     NULL != instance->cip_class->PreGetCallback) {
+    instance->cip_class->PreGetCallback(instance,
+                                        attribute,
+                                        message_router_request->service);
+  }
+  EncodeCipAttribute(attribute, &message_router_response->message);
+  if(call_get_callbacks && (attribute->attribute_flags & kPostGetFunc) &&
+     NULL != instance->cip_class->PostGetCallback) {
+    instance->cip_class->PostGetCallback(instance,
+                                         attribute,
+                                         message_router_request->service);
+  }
+}
+
+/* Ends a run of static attributes: keeps its bytes and the attribute after it */
+static void CloseGetAttributeAllRun(GetAttributeAllCache *const cache,
+                                    const size_t step,
+                                    const CipOctet *const run_start,
+                                    const CipOctet *const run_end,
+                                    size_t *const cached_length,
+                                    const EipUint16 attribute_index) {
+  const size_t run_length = (size_t) (run_end - run_start);
+  OPENER_ASSERT(step < cache->number_of_steps);
+  if(*cached_length + run_length > OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE) {
+    *cached_length = OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE + 1; /* does not fit */
+    return;
+  }
+  memcpy(cache->data + *cached_length, run_start, run_length);
+  *cached_length += run_length;
+  cache->steps[step].length = (EipUint16) run_length;
+  cache->steps[step].attribute_index = attribute_index;
+}
+
+/* Encode all attributes and keep the encoding of the static ones */
+static void FillGetAttributeAllCache(CipInstance *const instance,
+                                     CipMessageRouterRequest *const message_router_request,
+                                     CipMessageRouterResponse *const message_router_response,
+                                     const bool call_get_callbacks) {
+  GetAttributeAllCache *const cache = instance->get_attribute_all_cache;
+  const ENIPMessage *const message = &message_router_response->message;
+  const CipOctet *run_start = message->current_message_position;
+  size_t cached_length = 0;
+  size_t step = 0;
+
+  for(size_t i = 0; i < instance->cip_class->number_of_attributes; ++i) {
+    const CipAttributeStruct *const attribute = &instance->attributes[i];
+    if(!IsGetAttributeAllAttribute(attribute) ) {
+      continue;
+    }
+    const bool dynamic = 0 == (attribute->attribute_flags & kGetableAllStatic);
+    if(dynamic) {
+      CloseGetAttributeAllRun(cache, step++, run_start,
+                              message->current_message_position,
+                              &cached_length, (EipUint16) i);
+    }
+    EncodeGetAttributeAllAttribute(instance, attribute, message_router_request,
+                                   message_router_response, call_get_callbacks);
+    if(dynamic) {
+      run_start = message->current_message_position;
+    }
+  }
+  CloseGetAttributeAllRun(cache, step++, run_start,
+                          message->current_message_position, &cached_length,
+                          GET_ATTRIBUTE_ALL_NO_ATTRIBUTE);
+  /* a too long encoding is not cached, the attributes are encoded each time */
+  cache->valid = cached_length <= OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE &&
+                 step == cache->number_of_steps;
+}
+
+bool EncodeGetAttributeAllFromCache(CipInstance *const instance,
+                                    CipMessageRouterRequest *const message_router_request,
+                                    CipMessageRouterResponse *const message_router_response,
+                                    const bool call_get_callbacks) {
+  const GetAttributeAllCache *const cache = instance->get_attribute_all_cache;
+  if(NULL == cache) {
+    return false;
+  }
+  if(!cache->valid) {
+    FillGetAttributeAllCache(instance, message_router_request,
+                             message_router_response, call_get_callbacks);
+    return true;
+  }
+
+  ENIPMessage *const message = &message_router_response->message;
+  const CipOctet *cached = cache->data;
+  for(size_t i = 0; i < cache->number_of_steps; ++i) {
+    const GetAttributeAllStep *const step = &cache->steps[i];
+    memcpy(message->current_message_position, cached, step->length);
+    message->current_message_position += step->length;
+    message->used_message_length += step->length;
+    cached += step->length;
+    if(GET_ATTRIBUTE_ALL_NO_ATTRIBUTE != step->attribute_index) {
+      EncodeGetAttributeAllAttribute(instance,
+                                     &instance->attributes[step->attribute_index],
+                                     message_router_request,
+                                     message_router_response,
+                                     call_get_callbacks);
+    }
+  }
+  return true;
+}
+
 void InsertService(const CipClass *const cip_class,
                    const EipUint8 service_number,
                    const CipServiceFunction service_function,
@@ -467,9 +803,18 @@ void InsertService(const CipClass *const cip_class,
     if(service->service_number == service_number ||
        service->service_function == NULL)                                              /* found undefined service slot*/
     {
+      /* keep the defined services sorted by number for GetCipService() */
+      while(service->service_function == NULL &&
+            service != cip_class->services &&
+            (service - 1)->service_number > service_number) {
+        *service = *(service - 1);
+        service--;
+        service->service_function = NULL;
+      }
       service->service_number = service_number; /* fill in service number*/
       service->service_function = service_function; /* fill in function address*/
       service->name = service_name;
+      MessageRouterInvalidateRoutes();
       return;
     }
     ++service;
@@ -497,17 +842,28 @@ void InsertGetSetCallback(CipClass *const cip_class,
   }
 }
 
-CipAttributeStruct *GetCipAttribute(const CipInstance *const instance,
-                                    const EipUint16 attribute_number) {
+const CipAttributeStruct *GetCipAttribute(const CipInstance *const instance,
+                                          const EipUint16 attribute_number) {
 
-  CipAttributeStruct *attribute = instance->attributes; /* init pointer to array of attributes*/
-  for(int i = 0; i < instance->cip_class->number_of_attributes; i++) {
-    if(attribute_number == attribute->attribute_number) {
-      return attribute;
+  /* Set attributes are sorted by number and followed by the unset ones, see
+   * InsertAttribute() */
+  const CipAttributeStruct *const attributes = instance->attributes;
+  size_t low = 0;
+  size_t high = instance->cip_class->number_of_attributes;
+  while(low < high) {
+    const size_t middle = low + (high - low) / 2;
+    if(NULL != attributes[middle].data &&
+       attributes[middle].attribute_number < attribute_number) {
+      low = middle + 1;
     } else {
-      ++attribute;
+      high = middle;
     }
   }
+  if(low < instance->cip_class->number_of_attributes &&
+     NULL != attributes[low].data &&
+     attributes[low].attribute_number == attribute_number) {
+    return &attributes[low];
+  }
 
   OPENER_TRACE_WARN("attribute %d not defined\n", attribute_number);
 
@@ -517,7 +873,7 @@ CipAttributeStruct *GetCipAttribute(const CipInstance *const instance,
 void GenerateGetAttributeSingleHeader(
   const CipMessageRouterRequest *const message_router_request,
   CipMessageRouterResponse *const message_router_response) {
-  InitializeENIPMessage(&message_router_response->message);
+  ClearENIPMessage(&message_router_response->message);
   message_router_response->reply_service =
     (0x80 | message_router_request->service);
   message_router_response->general_status = kCipErrorAttributeNotSupported;
@@ -536,7 +892,7 @@ EipStatus GetAttributeSingle(CipInstance *RESTRICT const instance,
 
   /* Mask for filtering get-ability */
 
-  CipAttributeStruct *attribute = GetCipAttribute(instance,
+  const CipAttributeStruct *attribute = GetCipAttribute(instance,
                                                   message_router_request->request_path.attribute_number);
 
   GenerateGetAttributeSingleHeader(message_router_request,
@@ -562,7 +918,7 @@ EipStatus GetAttributeSingle(CipInstance *RESTRICT const instance,
       }
 
       OPENER_ASSERT(NULL != attribute);
-      attribute->encode(attribute->data, &message_router_response->message);
+      EncodeCipAttribute(attribute, &message_router_response->message);
       message_router_response->general_status = kCipErrorSuccess;
 
       /* Call the PostGetCallback if enabled for this attribute and the class provides one. */
@@ -685,6 +1041,38 @@ void EncodeCipString(const void *const data,
   }
 }
 
+void EncodeCipStringFixed(const void *const data,
+                          ENIPMessage *const outgoing_message) {
+  const CipStringFixed *const string = (const CipStringFixed *) data;
+
+  AddIntToMessage(string->length, outgoing_message);
+  if(0 != string->length) {
+    memcpy(outgoing_message->current_message_position,
+           (const CipByte *) (string + 1),
+           string->length);
+    outgoing_message->current_message_position += string->length;
+    outgoing_message->used_message_length += string->length;
+
+    if(outgoing_message->used_message_length & 0x01) {
+      /* we have an odd byte count */
+      AddSintToMessage(0, outgoing_message);
+    }
+  }
+}
+
+void EncodeCipShortStringFixed(const void *const data,
+                               ENIPMessage *const outgoing_message) {
+  const CipStringFixed *const string = (const CipStringFixed *) data;
+
+  AddSintToMessage( (EipUint8) string->length, outgoing_message);
+
+  memcpy(outgoing_message->current_message_position,
+         (const CipByte *) (string + 1),
+         string->length);
+  outgoing_message->current_message_position += string->length;
+  outgoing_message->used_message_length += string->length;
+}
+
 void EncodeCipString2(const void *const data,
                       ENIPMessage *const outgoing_message) {
   /* Suppress unused parameter compiler warning. */
@@ -772,7 +1160,7 @@ void EncodeCipEthernetLinkPhyisicalAddress(const void *const data,
 void GenerateSetAttributeSingleHeader(
   const CipMessageRouterRequest *const message_router_request,
   CipMessageRouterResponse *const message_router_response) {
-  InitializeENIPMessage(&message_router_response->message);
+  ClearENIPMessage(&message_router_response->message);
   message_router_response->reply_service =
     (0x80 | message_router_request->service);
   message_router_response->general_status = kCipErrorAttributeNotSupported;
@@ -788,7 +1176,7 @@ EipStatus SetAttributeSingle(CipInstance *RESTRICT const instance,
   (void)originator_address;
   (void)encapsulation_session;
 
-  CipAttributeStruct *attribute = GetCipAttribute(instance,
+  const CipAttributeStruct *attribute = GetCipAttribute(instance,
                                                   message_router_request->request_path.attribute_number);
 
   GenerateSetAttributeSingleHeader(message_router_request,
@@ -800,9 +1188,11 @@ EipStatus SetAttributeSingle(CipInstance *RESTRICT const instance,
   /* Mask for filtering set-ability */
   if( (NULL != attribute) && (NULL != attribute->data) ) {
 
-    if( (attribute->attribute_flags == kGetableAllDummy) ||
-        (attribute->attribute_flags == kNotSetOrGetable) ||
-        (attribute->attribute_flags == kGetableAll) ) {
+    const CIPAttributeFlag access_flags =
+      attribute->attribute_flags & ~kGetableAllStatic;
+    if( (access_flags == kGetableAllDummy) ||
+        (access_flags == kNotSetOrGetable) ||
+        (access_flags == kGetableAll) ) {
       OPENER_TRACE_WARN("SetAttributeSingle: Attribute %d not supported!\n\r",
                         attribute_number);
     } else {
@@ -824,13 +1214,21 @@ EipStatus SetAttributeSingle(CipInstance *RESTRICT const instance,
         attribute->decode(attribute->data,
                           message_router_request,
                           message_router_response);                                          //writes data to attribute, sets resonse status
+        InvalidateGetAttributeAllCache(instance);
 
         /* Call the PostSetCallback if enabled for this attribute and the class provides one. */
         if( ( attribute->attribute_flags & (kPostSetFunc | kNvDataFunc) ) &&
             NULL != instance->cip_class->PostSetCallback ) {
+          OPENER_WCET_PROFILE_BEGIN(post_set_start);
           instance->cip_class->PostSetCallback(instance,
                                                attribute,
                                                message_router_request->service);
+          OPENER_WCET_PROFILE_END(post_set_start, kWcetProfileKindCallback,
+                                  instance->cip_class->class_code,
+                                  kWcetProfileCallbackPostSet,
+                                  "PostSetCallback",
+                                  instance->instance_number,
+                                  attribute_number);
         }
       } else {
         message_router_response->general_status = kCipErrorAttributeNotSetable;
@@ -1060,13 +1458,27 @@ int DecodeCipShortString(CipShortString *data,
 
 CipServiceStruct *GetCipService(const CipInstance *const instance,
                                 CipUsint service_number) {
-  CipServiceStruct *service = instance->cip_class->services;
-  for(size_t i = 0; i < instance->cip_class->number_of_services; i++) /* hunt for the GET_ATTRIBUTE_SINGLE service*/
-  {
-    if(service->service_number == service_number) {
-      return service; /* found the service */
+  /* Defined services are sorted by number and followed by the undefined
+   * slots, see InsertService() */
+  CipServiceStruct *const services = instance->cip_class->services;
+  if(NULL == services) {
+    return NULL;
+  }
+  size_t low = 0;
+  size_t high = instance->cip_class->number_of_services;
+  while(low < high) {
+    const size_t middle = low + (high - low) / 2;
+    if(NULL != services[middle].service_function &&
+       services[middle].service_number < service_number) {
+      low = middle + 1;
+    } else {
+      high = middle;
     }
-    service++;
+  }
+  if(low < instance->cip_class->number_of_services &&
+     NULL != services[low].service_function &&
+     services[low].service_number == service_number) {
+    return &services[low];
   }
   return NULL; /* didn't find the service */
 }
@@ -1080,7 +1492,7 @@ EipStatus GetAttributeAll(CipInstance *instance,
   (void)originator_address;
   (void)encapsulation_session;
 
-  InitializeENIPMessage(&message_router_response->message);
+  ClearENIPMessage(&message_router_response->message);
 
   //Missing header
 
@@ -1094,20 +1506,25 @@ EipStatus GetAttributeAll(CipInstance *instance,
     GenerateGetAttributeSingleHeader(message_router_request,
                                      message_router_response);
     message_router_response->general_status = kCipErrorSuccess;
-    /* Iterate through attributes by attribute number (1 to highest_attribute_number)
-     * rather than by array index, to handle missing attributes correctly */
-    for(EipUint16 attr_num = 1; attr_num <= instance->cip_class->highest_attribute_number; attr_num++) {
-      /* Check if this attribute is flagged for GetAttributeAll */
+    if(EncodeGetAttributeAllFromCache(instance, message_router_request,
+                                      message_router_response, false) ) {
+      return kEipStatusOkSend;
+    }
+    /* The set attributes are sorted by attribute number, so one pass over
+     * the array returns them in the order GetAttributeAll requires */
+    const CipAttributeStruct *attribute = instance->attributes;
+    for(size_t i = 0; i < instance->cip_class->number_of_attributes;
+        i++, attribute++) {
+      if(NULL == attribute->data) {
+        break; /* only unset attributes follow */
+      }
+      const EipUint16 attr_num = attribute->attribute_number;
+      /* only return attributes that are flagged as being part of GetAttributeAll */
       if( (instance->cip_class->get_all_bit_mask[CalculateIndex(attr_num)
            ]) & ( 1 << (attr_num % 8) ) ) {
-        /* Find the attribute by number */
-        CipAttributeStruct *attribute = GetCipAttribute(instance, attr_num);
-        if(attribute != NULL && attribute->data != NULL) {
-          /* only return attributes that are flagged as being part of GetAttributeAll */
-          message_router_request->request_path.attribute_number = attr_num;
+        message_router_request->request_path.attribute_number = attr_num;
 
-          attribute->encode(attribute->data, &message_router_response->message);
-        }
+        EncodeCipAttribute(attribute, &message_router_response->message);
       }
     }
   }
@@ -1123,7 +1540,7 @@ EipStatus GetAttributeList(CipInstance *instance,
   (void)originator_address;
   (void)encapsulation_session;
 
-  InitializeENIPMessage(&message_router_response->message);
+  ClearENIPMessage(&message_router_response->message);
   message_router_response->reply_service =
     (0x80 | message_router_request->service);
   message_router_response->general_status = kCipErrorSuccess;
@@ -1135,7 +1552,7 @@ EipStatus GetAttributeList(CipInstance *instance,
   if(0 != attribute_count_request) {
 
     EipUint16 attribute_number = 0;
-    CipAttributeStruct *attribute = NULL;
+    const CipAttributeStruct *attribute = NULL;
 
     CipOctet *attribute_count_responst_position =
       message_router_response->message.current_message_position;
@@ -1155,7 +1572,7 @@ EipStatus GetAttributeList(CipInstance *instance,
           CipSint) );
 
       const int_fast64_t remaining_message_space =
-        (int_fast64_t) PC_OPENER_ETHERNET_BUFFER_SIZE -
+        (int_fast64_t) message_router_response->message.message_buffer_size -
         (int_fast64_t)  message_router_response->message.used_message_length -
         33LL;                                                                                                                                                                   //need 33 bytes extra space for the rest of the ENIP message
       if (needed_message_space > remaining_message_space) {
@@ -1187,7 +1604,7 @@ EipStatus GetAttributeList(CipInstance *instance,
         if( 0 != ( get_bit_mask & ( 1 << (attribute_number % 8) ) ) ) { //check if attribute is gettable
           AddSintToMessage(kCipErrorSuccess, &message_router_response->message); // Attribute status
           AddSintToMessage(0, &message_router_response->message); // Reserved, shall be 0
-          attribute->encode(attribute->data, &message_router_response->message); // write Attribute data to response
+          EncodeCipAttribute(attribute, &message_router_response->message); // write Attribute data to response
         } else {
           AddSintToMessage(kCipErrorAttributeNotGettable,
                            &message_router_response->message);                                // Attribute status
@@ -1229,7 +1646,7 @@ EipStatus SetAttributeList(CipInstance *instance,
   (void)originator_address;
   (void)encapsulation_session;
 
-  InitializeENIPMessage(&message_router_response->message);
+  ClearENIPMessage(&message_router_response->message);
   message_router_response->reply_service =
     (0x80 | message_router_request->service);
   message_router_response->general_status = kCipErrorSuccess;
@@ -1241,7 +1658,7 @@ EipStatus SetAttributeList(CipInstance *instance,
   if(0 != attribute_count_request) {
 
     EipUint16 attribute_number = 0;
-    CipAttributeStruct *attribute = NULL;
+    const CipAttributeStruct *attribute = NULL;
 
     CipOctet *attribute_count_responst_position =
       message_router_response->message.current_message_position;
@@ -1261,7 +1678,7 @@ EipStatus SetAttributeList(CipInstance *instance,
           CipSint) );
 
       const int_fast64_t remaining_message_space =
-        (int_fast64_t) PC_OPENER_ETHERNET_BUFFER_SIZE -
+        (int_fast64_t) message_router_response->message.message_buffer_size -
         (int_fast64_t)  message_router_response->message.used_message_length -
         33LL;                                                                                                                                                                   //need 33 bytes extra space for the rest of the ENIP message
       if (needed_message_space > remaining_message_space) {
@@ -1296,6 +1713,7 @@ EipStatus SetAttributeList(CipInstance *instance,
           attribute->decode(attribute->data,
                             message_router_request,
                             message_router_response);                                          // write data to attribute
+          InvalidateGetAttributeAllCache(instance);
         } else {
           AddSintToMessage(kCipErrorAttributeNotSetable,
                            &message_router_response->message);                               // Attribute status
@@ -1392,81 +1810,56 @@ EipStatus DecodePaddedEPath(CipEpath *epath,
                             const EipUint8 **message,
                             size_t *const bytes_consumed) {
   OPENER_ASSERT(bytes_consumed != NULL);
-  unsigned int number_of_decoded_elements = 0;
   const EipUint8 *message_runner = *message;
 
   epath->path_size = *message_runner;
   message_runner++;
-  /* copy path to structure, in version 0.1 only 8 bit for Class,Instance and Attribute, need to be replaced with function */
+  /* in version 0.1 only 8 and 16 bit for Class, Instance and Attribute */
   epath->class_id = 0;
   epath->instance_number = 0;
   epath->attribute_number = 0;
-
-  while(number_of_decoded_elements < epath->path_size) {
-    if( kSegmentTypeReserved == ( (*message_runner) & kSegmentTypeReserved ) ) {
-      /* If invalid/reserved segment type, segment type greater than 0xE0 */
+  epath->member_number = 0;
+
+  CipEpathIterator iterator;
+  CipEpathIteratorInit(&iterator, message_runner,
+                       epath->path_size * sizeof(CipWord) );
+  CipEpathSegment segment;
+  while(CipEpathIteratorNext(&iterator, &segment) ) {
+    if(kSegmentTypeLogicalSegment != segment.info.segment_type ||
+       (kLogicalSegmentLogicalFormatEightBit != segment.info.logical_format &&
+        kLogicalSegmentLogicalFormatSixteenBit !=
+        segment.info.logical_format) ) {
+      /* also the reserved segment types, header bytes from 0xE0 on */
+      OPENER_TRACE_ERR("wrong path requested\n");
       return kEipStatusError;
     }
 
-    number_of_decoded_elements++; /*At least one element is decoded */
-    switch(*message_runner) {
-      case SEGMENT_TYPE_LOGICAL_SEGMENT + LOGICAL_SEGMENT_TYPE_CLASS_ID +
-        LOGICAL_SEGMENT_FORMAT_EIGHT_BIT:
-        epath->class_id = *(EipUint8 *) (message_runner + 1);
-        message_runner += 2;
-        break;
-
-      case SEGMENT_TYPE_LOGICAL_SEGMENT + LOGICAL_SEGMENT_TYPE_CLASS_ID +
-        LOGICAL_SEGMENT_FORMAT_SIXTEEN_BIT:
-        message_runner += 2;
-        epath->class_id = GetUintFromMessage( &(message_runner) );
-        number_of_decoded_elements++;
-        break;
-
-      case SEGMENT_TYPE_LOGICAL_SEGMENT + LOGICAL_SEGMENT_TYPE_INSTANCE_ID +
-        LOGICAL_SEGMENT_FORMAT_EIGHT_BIT:
-        epath->instance_number = *(EipUint8 *) (message_runner + 1);
-        message_runner += 2;
-        break;
-
-      case SEGMENT_TYPE_LOGICAL_SEGMENT + LOGICAL_SEGMENT_TYPE_INSTANCE_ID +
-        LOGICAL_SEGMENT_FORMAT_SIXTEEN_BIT:
-        message_runner += 2;
-        epath->instance_number = GetUintFromMessage( &(message_runner) );
-        number_of_decoded_elements++;
+    switch(segment.info.subtype) {
+      case kLogicalSegmentLogicalTypeClassId:
+        epath->class_id = (EipUint16) segment.logical_value;
         break;
-
-      case SEGMENT_TYPE_LOGICAL_SEGMENT + LOGICAL_SEGMENT_TYPE_ATTRIBUTE_ID +
-        LOGICAL_SEGMENT_FORMAT_EIGHT_BIT:
-        epath->attribute_number = *(EipUint8 *) (message_runner + 1);
-        message_runner += 2;
+      case kLogicalSegmentLogicalTypeInstanceId:
+        epath->instance_number = (CipInstanceNum) segment.logical_value;
         break;
-
-      case SEGMENT_TYPE_LOGICAL_SEGMENT + LOGICAL_SEGMENT_TYPE_ATTRIBUTE_ID +
-        LOGICAL_SEGMENT_FORMAT_SIXTEEN_BIT:
-        message_runner += 2;
-        epath->attribute_number = GetUintFromMessage( &(message_runner) );
-        number_of_decoded_elements++;
+      case kLogicalSegmentLogicalTypeAttributeId:
+        epath->attribute_number = (EipUint16) segment.logical_value;
         break;
-
-      case SEGMENT_TYPE_LOGICAL_SEGMENT + LOGICAL_SEGMENT_TYPE_MEMBER_ID +
-        LOGICAL_SEGMENT_FORMAT_EIGHT_BIT:
-        message_runner += 2;
+      case kLogicalSegmentLogicalTypeMemberId:
+        epath->member_number = (EipUint16) segment.logical_value;
         break;
-      case SEGMENT_TYPE_LOGICAL_SEGMENT + LOGICAL_SEGMENT_TYPE_MEMBER_ID +
-        LOGICAL_SEGMENT_FORMAT_SIXTEEN_BIT:
-        message_runner += 2;
-        number_of_decoded_elements++;
-        break;
-
       default:
         OPENER_TRACE_ERR("wrong path requested\n");
         return kEipStatusError;
     }
   }
+  if(0 != CipEpathIteratorRemaining(&iterator) ) {
+    /* a segment of unknown length or one cut off by the path size */
+    OPENER_TRACE_ERR("wrong path requested\n");
+    return kEipStatusError;
+  }
 
-  *message = message_runner;
-  *bytes_consumed = number_of_decoded_elements * sizeof(CipWord) + 1; /* number_of_decoded_elements times 2 as every encoding uses 2 bytes */
+  *message = iterator.position;
+  *bytes_consumed = epath->path_size * sizeof(CipWord) + 1;
   return kEipStatusOk;
 }
 
@@ -1479,7 +1872,7 @@ EipStatus CipCreateService(CipInstance *RESTRICT const instance,
   (void)originator_address;
   (void)encapsulation_session;
 
-  InitializeENIPMessage(&message_router_response->message);
+  ClearENIPMessage(&message_router_response->message);
   message_router_response->reply_service =
     (0x80 | message_router_request->service);
   message_router_response->general_status = kCipErrorSuccess;
@@ -1523,7 +1916,7 @@ EipStatus CipDeleteService(CipInstance *RESTRICT const instance,
 
   message_router_response->general_status = kCipErrorInstanceNotDeletable;
   message_router_response->size_of_additional_status = 0;
-  InitializeENIPMessage(&message_router_response->message);
+  ClearENIPMessage(&message_router_response->message);
   message_router_response->reply_service =
     (0x80 | message_router_request->service);
 
@@ -1563,12 +1956,14 @@ EipStatus CipDeleteService(CipInstance *RESTRICT const instance,
                                 message_router_response);
     }
 
+    CipFree(instance->get_attribute_all_cache);
     CipFree(instance);  // delete instance
 
     class->number_of_instances--; /* update the total number of instances
                                             recorded by the class - Attr. 3 */
 
     class->max_instance = GetMaxInstanceNumber(class); /* update largest instance number (class Attribute 2) */
+    UpdateCipInstanceIndex(class);
 
     message_router_response->general_status = kCipErrorSuccess;
   }
@@ -1586,7 +1981,7 @@ EipStatus CipResetService(CipInstance *RESTRICT const instance,
 
   message_router_response->general_status = kCipErrorSuccess;
   message_router_response->size_of_additional_status = 0;
-  InitializeENIPMessage(&message_router_response->message);
+  ClearENIPMessage(&message_router_response->message);
   message_router_response->reply_service =
     (0x80 | message_router_request->service);
 
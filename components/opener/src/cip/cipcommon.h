@@ -12,9 +12,13 @@
 
 #include "typedefs.h"
 #include "ciptypes.h"
+#include "endianconv.h"
 
 static const EipUint16 kCipUintZero = 0; /**< Zero value for returning the UINT standard value */
 
+/** @brief Number of entries of an array, e.g. of a const attribute table */
+#define NELEMENTS(x)  ( (sizeof(x) / sizeof(x[0]) ) )
+
 /** @brief Check if requested service present in class/instance and call appropriate service.
  *
  * @param cip_class class receiving the message
@@ -40,6 +44,24 @@ EipStatus NotifyClass(const CipClass *const RESTRICT cip_class,
  */
 CipUint GetMaxInstanceNumber(CipClass *RESTRICT const cip_class);                      
 
+/** @brief Rebuild the sorted instance index GetCipInstance() searches
+ *
+ * Has to be called whenever instances are added, renumbered or removed.
+ * Without memory for the index GetCipInstance() walks the instance list.
+ *
+ * @param cip_class class whose instances changed
+ */
+void UpdateCipInstanceIndex(CipClass *RESTRICT const cip_class);
+
+/** @brief Get the service of an instance's class by service code
+ *
+ * @param instance instance the service is requested for
+ * @param service_number service code
+ * @return pointer to the service, NULL if the class does not provide it
+ */
+CipServiceStruct *GetCipService(const CipInstance *const instance,
+                                CipUsint service_number);
+
 void GenerateGetAttributeSingleHeader(
   const CipMessageRouterRequest *const message_router_request,
   CipMessageRouterResponse *const message_router_response);
@@ -108,6 +130,25 @@ EipStatus GetAttributeAll(CipInstance *instance,
                           const struct sockaddr *originator_address,
                           const CipSessionHandle encapsulation_session);
 
+/** @brief Encode the GetAttributeAll attributes through the instance's cache
+ *
+ * Copies the cached encoding of the kGetableAllStatic attributes and encodes
+ * the other ones, or encodes all of them and fills the cache after it was
+ * invalidated. For GetAttributeAll implementations of single classes.
+ *
+ * @param instance instance of the request
+ * @param message_router_request pointer to MR request.
+ * @param message_router_response pointer for MR response, the reply header
+ *        is already generated
+ * @param call_get_callbacks call the Pre- and PostGetCallback of the class
+ *        for the attributes that are encoded
+ * @return false if the instance has no cache and nothing was encoded
+ */
+bool EncodeGetAttributeAllFromCache(CipInstance *const instance,
+                                    CipMessageRouterRequest *const message_router_request,
+                                    CipMessageRouterResponse *const message_router_response,
+                                    const bool call_get_callbacks);
+
 /** @brief Generic implementation of the GetAttributeList CIP service
  *
  * Copy the contents of the selected gettable attributes of the specified
@@ -221,4 +262,33 @@ EipStatus CipResetService(CipInstance *RESTRICT const instance,
     const struct sockaddr *originator_address,
     const CipSessionHandle encapsulation_session);
 
+/** @brief Append the value of an attribute to a response
+ *
+ *  Elementary types with their standard encoder are copied here, without
+ *  the indirect call of the encode function, see @ref CipAttributeEncoding.
+ *
+ * @param attribute attribute to encode
+ * @param outgoing_message response the value is appended to
+ */
+static inline void EncodeCipAttribute(const CipAttributeStruct *const attribute,
+                                      ENIPMessage *const outgoing_message) {
+  switch(attribute->encoding) {
+    case kCipAttributeEncoding8Bit:
+      AddSintToMessage(*(const EipUint8 *) attribute->data, outgoing_message);
+      break;
+    case kCipAttributeEncoding16Bit:
+      AddIntToMessage(*(const EipUint16 *) attribute->data, outgoing_message);
+      break;
+    case kCipAttributeEncoding32Bit:
+      AddDintToMessage(*(const EipUint32 *) attribute->data, outgoing_message);
+      break;
+    case kCipAttributeEncoding64Bit:
+      AddLintToMessage(*(const EipUint64 *) attribute->data, outgoing_message);
+      break;
+    default:
+      attribute->encode(attribute->data, outgoing_message);
+      break;
+  }
+}
+
 #endif /* OPENER_CIPCOMMON_H_ */
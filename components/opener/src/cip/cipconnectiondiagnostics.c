@@ -0,0 +1,277 @@
+/*******************************************************************************
+ * Copyright (c) 2019, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "cipconnectiondiagnostics.h"
+
+#include "cipcommon.h"
+#include "endianconv.h"
+#include "opener_api.h"
+#include "trace.h"
+
+const CipUint kCipConnectionDiagnosticsIntervalLimits[
+  CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS - 1] = {
+  1, 2, 5, 10, 25, 50, 100
+};
+
+const CipUdint kCipConnectionDiagnosticsLatencyLimits[
+  CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS - 1] = {
+  50, 100, 250, 500, 1000, 2500, 5000
+};
+
+/** @brief Recording state of one instance */
+typedef struct {
+  const CipConnectionObject *connection_object; /**< NULL if unused */
+  MicroSeconds last_produced; /**< time of the previous produced packet, 0 before the first */
+  MicroSeconds last_consumed; /**< time of the previous consumed packet, 0 before the first */
+  CipConnectionDiagnostics diagnostics;
+} ConnectionDiagnosticsSlot;
+
+static ConnectionDiagnosticsSlot s_slots[
+  CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES];
+
+static ConnectionDiagnosticsSlot *FindSlot(
+  const CipConnectionObject *const connection_object) {
+  for(size_t i = 0; i < CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES; ++i) {
+    if(connection_object == s_slots[i].connection_object) {
+      return &s_slots[i];
+    }
+  }
+  return NULL;
+}
+
+static void ResetIntervalStatistics(
+  CipConnectionIntervalStatistics *const statistics,
+  const CipUdint requested_interval) {
+  memset(statistics, 0, sizeof(*statistics) );
+  statistics->requested_interval = requested_interval;
+  statistics->minimum_interval = UINT32_MAX;
+}
+
+static void RecordInterval(CipConnectionIntervalStatistics *const statistics,
+                           MicroSeconds *const last_time,
+                           const MicroSeconds now) {
+  statistics->packets++;
+  const MicroSeconds previous = *last_time;
+  *last_time = now;
+  if(0 == previous || now < previous) {
+    return; /* first packet, no interval yet */
+  }
+  const MicroSeconds interval = now - previous;
+  const CipUdint clamped_interval =
+    interval > UINT32_MAX ? UINT32_MAX : (CipUdint)interval;
+  if(clamped_interval < statistics->minimum_interval) {
+    statistics->minimum_interval = clamped_interval;
+  }
+  if(clamped_interval > statistics->maximum_interval) {
+    statistics->maximum_interval = clamped_interval;
+  }
+
+  const MicroSeconds requested = statistics->requested_interval;
+  if(0 == requested) {
+    return;
+  }
+  if(interval >= 2 * requested) {
+    statistics->missed_packets += (CipUdint)(interval / requested - 1);
+  } else if(4 * interval > 5 * requested) {
+    statistics->late_packets++;
+  }
+
+  const MicroSeconds deviation =
+    interval > requested ? interval - requested : requested - interval;
+  size_t bucket = 0;
+  while(bucket < CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS - 1 &&
+        100 * deviation >
+        kCipConnectionDiagnosticsIntervalLimits[bucket] * requested) {
+    bucket++;
+  }
+  statistics->histogram[bucket]++;
+}
+
+void CipConnectionDiagnosticsConnectionOpened(
+  const CipConnectionObject *const connection_object) {
+  ConnectionDiagnosticsSlot *slot = FindSlot(connection_object);
+  if(NULL == slot) {
+    slot = FindSlot(NULL);
+  }
+  if(NULL == slot) {
+    OPENER_TRACE_WARN("Connection diagnostics: no free instance\n");
+    return;
+  }
+  slot->connection_object = connection_object;
+  slot->last_produced = 0;
+  slot->last_consumed = 0;
+  memset(&slot->diagnostics, 0, sizeof(slot->diagnostics) );
+  slot->diagnostics.connection_id =
+    connection_object->cip_produced_connection_id;
+  ResetIntervalStatistics(&slot->diagnostics.produced,
+                          connection_object->t_to_o_requested_packet_interval);
+  ResetIntervalStatistics(&slot->diagnostics.consumed,
+                          connection_object->o_to_t_requested_packet_interval);
+}
+
+void CipConnectionDiagnosticsConnectionClosed(
+  const CipConnectionObject *const connection_object) {
+  ConnectionDiagnosticsSlot *const slot = FindSlot(connection_object);
+  if(NULL != slot) {
+    /* the statistics stay readable until the instance is used again */
+    slot->connection_object = NULL;
+    slot->diagnostics.connection_id = 0;
+  }
+}
+
+void CipConnectionDiagnosticsRecordProduced(
+  const CipConnectionObject *const connection_object,
+  const MicroSeconds now) {
+  ConnectionDiagnosticsSlot *const slot = FindSlot(connection_object);
+  if(NULL != slot) {
+    RecordInterval(&slot->diagnostics.produced, &slot->last_produced, now);
+  }
+}
+
+void CipConnectionDiagnosticsRecordConsumed(
+  const CipConnectionObject *const connection_object,
+  const MicroSeconds received) {
+  ConnectionDiagnosticsSlot *const slot = FindSlot(connection_object);
+  if(NULL != slot) {
+    RecordInterval(&slot->diagnostics.consumed, &slot->last_consumed, received);
+  }
+}
+
+void CipConnectionDiagnosticsRecordApplied(
+  const CipConnectionObject *const connection_object,
+  const MicroSeconds received,
+  const MicroSeconds applied) {
+  ConnectionDiagnosticsSlot *const slot = FindSlot(connection_object);
+  if(NULL == slot || applied < received) {
+    return;
+  }
+  CipConnectionLatencyStatistics *const statistics =
+    &slot->diagnostics.consumed_to_applied;
+  const MicroSeconds latency = applied - received;
+  const CipUdint clamped_latency =
+    latency > UINT32_MAX ? UINT32_MAX : (CipUdint)latency;
+  statistics->samples++;
+  if(clamped_latency > statistics->maximum_latency) {
+    statistics->maximum_latency = clamped_latency;
+  }
+  size_t bucket = 0;
+  while(bucket < CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS - 1 &&
+        clamped_latency > kCipConnectionDiagnosticsLatencyLimits[bucket]) {
+    bucket++;
+  }
+  statistics->histogram[bucket]++;
+}
+
+bool CipConnectionDiagnosticsGet(const size_t index,
+                                 CipConnectionDiagnostics *const diagnostics) {
+  if(index >= CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES) {
+    return false;
+  }
+  *diagnostics = s_slots[index].diagnostics;
+  return true;
+}
+
+static void EncodeHistogram(const CipUdint *const histogram,
+                            ENIPMessage *const outgoing_message) {
+  for(size_t i = 0; i < CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS; ++i) {
+    EncodeCipUdint(&histogram[i], outgoing_message);
+  }
+}
+
+static void EncodeCipConnectionIntervalStatistics(const void *const data,
+                                                  ENIPMessage *const outgoing_message)
+{
+  const CipConnectionIntervalStatistics *const statistics =
+    (const CipConnectionIntervalStatistics *)data;
+  /* no interval seen yet reads as 0 instead of the search start value */
+  const CipUdint minimum_interval =
+    UINT32_MAX == statistics->minimum_interval ? 0 : statistics->
+    minimum_interval;
+  EncodeCipUdint(&statistics->requested_interval, outgoing_message);
+  EncodeCipUdint(&statistics->packets, outgoing_message);
+  EncodeCipUdint(&statistics->late_packets, outgoing_message);
+  EncodeCipUdint(&statistics->missed_packets, outgoing_message);
+  EncodeCipUdint(&minimum_interval, outgoing_message);
+  EncodeCipUdint(&statistics->maximum_interval, outgoing_message);
+  EncodeHistogram(statistics->histogram, outgoing_message);
+}
+
+static void EncodeCipConnectionLatencyStatistics(const void *const data,
+                                                 ENIPMessage *const outgoing_message)
+{
+  const CipConnectionLatencyStatistics *const statistics =
+    (const CipConnectionLatencyStatistics *)data;
+  EncodeCipUdint(&statistics->samples, outgoing_message);
+  EncodeCipUdint(&statistics->maximum_latency, outgoing_message);
+  EncodeHistogram(statistics->histogram, outgoing_message);
+}
+
+EipStatus CipConnectionDiagnosticsInit(void) {
+  CipClass *diagnostics_class = NULL;
+
+  if( ( diagnostics_class = CreateCipClass(kCipConnectionDiagnosticsClassCode,
+                                           7, /* # class attributes */
+                                           7, /* # highest class attribute number */
+                                           2, /* # class services */
+                                           4, /* # instance attributes */
+                                           4, /* # highest instance attribute number */
+                                           2, /* # instance services */
+                                           CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES, /* # instances */
+                                           "Connection Diagnostics",
+                                           1, /* # class revision */
+                                           NULL /* # function pointer for initialization */
+                                           ) ) == 0 ) {
+
+    return kEipStatusError;
+  }
+
+  for(size_t i = 0; i < CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES; ++i) {
+    CipInstance *instance = GetCipInstance(diagnostics_class,
+                                           (CipInstanceNum)(i + 1) );
+    /* The slots are not reset, the class may be created on its first
+     * request while connections are recorded already */
+    ConnectionDiagnosticsSlot *const slot = &s_slots[i];
+
+    InsertAttribute(instance,
+                    1,
+                    kCipUdint,
+                    EncodeCipUdint,
+                    NULL,
+                    &slot->diagnostics.connection_id,
+                    kGetableSingleAndAll);
+    InsertAttribute(instance,
+                    2,
+                    kCipAny,
+                    EncodeCipConnectionIntervalStatistics,
+                    NULL,
+                    &slot->diagnostics.produced,
+                    kGetableSingleAndAll);
+    InsertAttribute(instance,
+                    3,
+                    kCipAny,
+                    EncodeCipConnectionIntervalStatistics,
+                    NULL,
+                    &slot->diagnostics.consumed,
+                    kGetableSingleAndAll);
+    InsertAttribute(instance,
+                    4,
+                    kCipAny,
+                    EncodeCipConnectionLatencyStatistics,
+                    NULL,
+                    &slot->diagnostics.consumed_to_applied,
+                    kGetableSingleAndAll);
+  }
+
+  InsertService(diagnostics_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(diagnostics_class, kGetAttributeAll, &GetAttributeAll,
+                "GetAttributeAll");
+
+  return kEipStatusOk;
+}
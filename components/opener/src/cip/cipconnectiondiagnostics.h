@@ -0,0 +1,136 @@
+/*******************************************************************************
+ * Copyright (c) 2019, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_CIPCONNECTIONDIAGNOSTICS_H_
+#define OPENER_CIPCONNECTIONDIAGNOSTICS_H_
+
+/** @file cipconnectiondiagnostics.h
+ *  @brief Public interface of the vendor specific Connection Diagnostics Object
+ *
+ *  Keeps timing statistics of the I/O connections: the produced and consumed
+ *  packet intervals compared to the requested packet interval, and the time
+ *  from receiving consumed data until the application took it over.
+ *
+ *  Instance n describes the n-th I/O connection slot; attribute 1 reads 0
+ *  while the slot is unused. All intervals and latencies are in microseconds.
+ */
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+#include "ciptypes.h"
+#include "cipconnectionobject.h"
+#include "opener_user_conf.h"
+
+/** @brief Connection Diagnostics Object class code (vendor specific range) */
+static const CipUint kCipConnectionDiagnosticsClassCode = 0x64U;
+
+/** Number of histogram buckets of every statistic */
+#define CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS 8
+
+/** One instance per I/O connection that can be open at the same time */
+#define CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES \
+  (OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS + \
+   OPENER_CIP_NUM_INPUT_ONLY_CONNS * \
+   OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH + \
+   OPENER_CIP_NUM_LISTEN_ONLY_CONNS * \
+   OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH)
+
+/** @brief Upper limits of the interval histogram buckets
+ *
+ *  Deviation of the actual from the requested packet interval in percent of
+ *  the requested one; the last bucket takes everything above the last limit.
+ */
+extern const CipUint
+  kCipConnectionDiagnosticsIntervalLimits[
+  CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS - 1];
+
+/** @brief Upper limits of the latency histogram buckets in microseconds */
+extern const CipUdint
+  kCipConnectionDiagnosticsLatencyLimits[
+  CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS - 1];
+
+/** @brief Packet interval statistics of one direction of a connection */
+typedef struct {
+  CipUdint requested_interval; /**< requested packet interval */
+  CipUdint packets; /**< packets seen */
+  CipUdint late_packets; /**< intervals more than 25 % above the requested one */
+  CipUdint missed_packets; /**< packets missing from intervals of twice the requested one or more */
+  CipUdint minimum_interval; /**< shortest interval seen */
+  CipUdint maximum_interval; /**< longest interval seen */
+  CipUdint histogram[CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS]; /**< intervals by deviation */
+} CipConnectionIntervalStatistics;
+
+/** @brief Statistics of the consumed data to application latency */
+typedef struct {
+  CipUdint samples; /**< consumed packets handed to the application */
+  CipUdint maximum_latency; /**< longest latency seen */
+  CipUdint histogram[CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS]; /**< latencies by duration */
+} CipConnectionLatencyStatistics;
+
+/** @brief Attributes of one Connection Diagnostics instance */
+typedef struct {
+  CipUdint connection_id; /**< Attr. #1: produced connection ID, 0 if unused */
+  CipConnectionIntervalStatistics produced; /**< Attr. #2: target to originator */
+  CipConnectionIntervalStatistics consumed; /**< Attr. #3: originator to target */
+  CipConnectionLatencyStatistics consumed_to_applied; /**< Attr. #4 */
+} CipConnectionDiagnostics;
+
+/** @brief Create the Connection Diagnostics class and its instances
+ */
+EipStatus CipConnectionDiagnosticsInit(void);
+
+/** @brief Start collecting statistics for a newly established I/O connection
+ *
+ *  Connections that find no free instance are not recorded.
+ */
+void CipConnectionDiagnosticsConnectionOpened(
+  const CipConnectionObject *const connection_object);
+
+/** @brief Stop collecting statistics for a closed I/O connection
+ */
+void CipConnectionDiagnosticsConnectionClosed(
+  const CipConnectionObject *const connection_object);
+
+/** @brief Record that a packet was produced on a connection
+ *
+ *  @param now time the packet was sent, GetMicroSeconds() time base
+ */
+void CipConnectionDiagnosticsRecordProduced(
+  const CipConnectionObject *const connection_object,
+  const MicroSeconds now);
+
+/** @brief Record that a packet was consumed on a connection
+ *
+ *  @param received time the packet was received, GetMicroSeconds() time base
+ */
+void CipConnectionDiagnosticsRecordConsumed(
+  const CipConnectionObject *const connection_object,
+  const MicroSeconds received);
+
+/** @brief Record that consumed data was handed to the application
+ *
+ *  @param received time the packet was received
+ *  @param applied time the application returned from taking the data
+ */
+void CipConnectionDiagnosticsRecordApplied(
+  const CipConnectionObject *const connection_object,
+  const MicroSeconds received,
+  const MicroSeconds applied);
+
+/** @brief Copy the statistics of one instance
+ *
+ *  May be called from other tasks; a copy taken while a packet is recorded
+ *  can mix values from before and after that packet.
+ *
+ *  @param index instance number - 1
+ *  @param diagnostics receives the statistics
+ *  @return false if index is out of range
+ */
+bool CipConnectionDiagnosticsGet(const size_t index,
+                                 CipConnectionDiagnostics *const diagnostics);
+
+#endif /* OPENER_CIPCONNECTIONDIAGNOSTICS_H_ */
@@ -29,6 +29,8 @@
 #include "cipelectronickey.h"
 #include "cipqos.h"
 #include "xorshiftrandom.h"
+#include "latency_probe.h"
+#include "trace_event.h"
 
 #if defined(__ESP_PLATFORM__) || defined(ESP_PLATFORM)
 #include "freertos/FreeRTOS.h"
@@ -78,6 +80,350 @@ typedef struct {
 
 static ConnectionManagerStatistics g_connection_manager_stats = {0};
 
+/** @brief Frames sent by multicast productions and the frames separate point
+ * to point productions for each of their consumers would have needed on top
+ */
+static CipUdint g_multicast_packets_produced = 0;
+static CipUdint g_multicast_packets_saved = 0;
+
+/** @brief Productions, and those late by ConnectionProductionIsLate() */
+static CipUdint g_productions = 0;
+static CipUdint g_late_productions = 0;
+
+#if OPENER_FORWARD_OPEN_TRACE_ENTRIES > 0
+/** @brief The last Forward Opens, oldest overwritten first, and the one in
+ * progress */
+static ForwardOpenTrace g_forward_open_traces[OPENER_FORWARD_OPEN_TRACE_ENTRIES];
+static CipUdint g_forward_open_count = 0;
+static ForwardOpenTrace g_forward_open_current;
+static bool g_forward_open_active = false;
+static ForwardOpenStage g_forward_open_stage = kForwardOpenStageRequest;
+static MicroSeconds g_forward_open_stage_start = 0;
+#endif
+
+/** @brief Open addressed (linear probing) index of the active connections
+ * by a key that stays the same while a connection is active, used to find
+ * connections without walking the connection list. Several connections may
+ * share a key, a lookup walks the probe sequence up to the next free slot
+ * and compares the keys. Sized to stay at most half full.
+ */
+#define CONNECTION_INDEX_SIZE (2 * OPENER_CIP_NUM_ACTIVE_CONNS + 1)
+
+typedef CipUdint (*ConnectionIndexKeyFunction)(
+  const CipConnectionObject *const connection_object);
+
+typedef struct {
+  CipConnectionObject *slots[CONNECTION_INDEX_SIZE];
+  ConnectionIndexKeyFunction key;
+} ConnectionIndex;
+
+static CipUdint ConnectionIndexConsumedConnectionId(
+  const CipConnectionObject *const connection_object) {
+  return ConnectionObjectGetCipConsumedConnectionID(connection_object);
+}
+
+static CipUdint ConnectionIndexTriad(
+  const CipConnectionObject *const connection_object) {
+  return connection_object->originator_serial_number ^
+         ( (CipUdint) connection_object->originator_vendor_id << 16 ) ^
+         connection_object->connection_serial_number;
+}
+
+static CipUdint ConnectionIndexProducedInstance(
+  const CipConnectionObject *const connection_object) {
+  return connection_object->produced_path.instance_id;
+}
+
+static CipUdint ConnectionIndexConsumedInstance(
+  const CipConnectionObject *const connection_object) {
+  return connection_object->consumed_path.instance_id;
+}
+
+/** Established connections by their consumed connection ID */
+static ConnectionIndex g_connection_id_index = {
+  .key = ConnectionIndexConsumedConnectionId
+};
+/** All active connections by the connection triad */
+static ConnectionIndex g_connection_triad_index = {
+  .key = ConnectionIndexTriad
+};
+/** Active I/O connections by the assembly instance they produce */
+static ConnectionIndex g_produced_instance_index = {
+  .key = ConnectionIndexProducedInstance
+};
+/** Active I/O connections by the assembly instance they consume */
+static ConnectionIndex g_consumed_instance_index = {
+  .key = ConnectionIndexConsumedInstance
+};
+
+static size_t ConnectionIndexHome(const CipUdint key) {
+  /* connection IDs share the incarnation ID in the upper 16 bits, mix them */
+  CipUdint hash = key ^ (key >> 16);
+  hash *= 0x45D9F3BU;
+  hash ^= hash >> 16;
+  return hash % CONNECTION_INDEX_SIZE;
+}
+
+static void ConnectionIndexInsert(ConnectionIndex *const index,
+                                  CipConnectionObject *const connection_object)
+{
+  size_t slot = ConnectionIndexHome(index->key(connection_object) );
+  for(size_t probe = 0; probe < CONNECTION_INDEX_SIZE; ++probe) {
+    if(NULL == index->slots[slot] ||
+       connection_object == index->slots[slot]) {
+      index->slots[slot] = connection_object;
+      return;
+    }
+    slot = (slot + 1) % CONNECTION_INDEX_SIZE;
+  }
+  OPENER_TRACE_ERR("Connection index full\n");
+}
+
+static void ConnectionIndexRemove(
+  ConnectionIndex *const index,
+  const CipConnectionObject *const connection_object) {
+  size_t slot = ConnectionIndexHome(index->key(connection_object) );
+  size_t probe = 0;
+  while(connection_object != index->slots[slot]) {
+    if(NULL == index->slots[slot] ||
+       ++probe >= CONNECTION_INDEX_SIZE) {
+      return;   /* not indexed */
+    }
+    slot = (slot + 1) % CONNECTION_INDEX_SIZE;
+  }
+
+  /* backward shift deletion keeps probe sequences intact without tombstones */
+  size_t hole = slot;
+  index->slots[hole] = NULL;
+  for(size_t next = (hole + 1) % CONNECTION_INDEX_SIZE;
+      NULL != index->slots[next];
+      next = (next + 1) % CONNECTION_INDEX_SIZE) {
+    size_t home = ConnectionIndexHome(index->key(index->slots[next]) );
+    /* move the entry into the hole unless its home lies cyclically in
+     * (hole, next] */
+    bool home_between = (hole <= next) ?
+                        (hole < home && home <= next) :
+                        (hole < home || home <= next);
+    if(!home_between) {
+      index->slots[hole] = index->slots[next];
+      index->slots[next] = NULL;
+      hole = next;
+    }
+  }
+}
+
+static void ConnectionIndexIteratorBegin(
+  ConnectionIndexIterator *const iterator,
+  const CipUdint key) {
+  iterator->key = key;
+  iterator->slot = ConnectionIndexHome(key);
+  iterator->probe = 0;
+}
+
+static CipConnectionObject *ConnectionIndexIteratorNext(
+  const ConnectionIndex *const index,
+  ConnectionIndexIterator *const iterator) {
+  while(iterator->probe < CONNECTION_INDEX_SIZE &&
+        NULL != index->slots[iterator->slot]) {
+    CipConnectionObject *const connection_object =
+      index->slots[iterator->slot];
+    iterator->slot = (iterator->slot + 1) % CONNECTION_INDEX_SIZE;
+    iterator->probe++;
+    if(iterator->key == index->key(connection_object) ) {
+      return connection_object;
+    }
+  }
+  return NULL;
+}
+
+void ProducedInstanceIteratorBegin(ConnectionIndexIterator *const iterator,
+                                   const CipUdint instance_id) {
+  ConnectionIndexIteratorBegin(iterator, instance_id);
+}
+
+CipConnectionObject *ProducedInstanceIteratorNext(
+  ConnectionIndexIterator *const iterator) {
+  return ConnectionIndexIteratorNext(&g_produced_instance_index, iterator);
+}
+
+/** @brief Entry of the connection deadline queue
+ *
+ * The deadline is kept next to the object pointer, so sifting the heap only
+ * reads the queue itself and not the connection objects it points to.
+ */
+typedef struct {
+  MicroSeconds deadline;
+  CipConnectionObject *connection_object;
+} ConnectionDeadlineQueueEntry;
+
+/** @brief Binary min-heap of active connections ordered by their next deadline
+ *
+ * ManageConnections() only visits connections at the top of the heap whose
+ * deadline has expired instead of counting down the timers of every active
+ * connection on each tick.
+ */
+static ConnectionDeadlineQueueEntry g_connection_deadline_queue[
+  OPENER_CIP_NUM_ACTIVE_CONNS];
+static size_t g_connection_deadline_queue_size = 0;
+
+/** True from DetachActiveConnections() until ReleaseDetachedConnections() */
+static bool g_active_connections_detached = false;
+
+static const MicroSeconds kConnectionNoDeadline = UINT64_MAX;
+
+/** @brief Connection manager time base in microseconds, see
+ * ConnectionManagerGetTime() */
+static MicroSeconds g_connection_manager_time = 0;
+
+static bool ConnectionDeadlineQueueContains(
+  const CipConnectionObject *const connection_object) {
+  const size_t position = connection_object->deadline_queue_position;
+  return position < g_connection_deadline_queue_size &&
+         connection_object ==
+         g_connection_deadline_queue[position].connection_object;
+}
+
+static void ConnectionDeadlineQueuePlace(
+  const ConnectionDeadlineQueueEntry entry,
+  const size_t position) {
+  g_connection_deadline_queue[position] = entry;
+  entry.connection_object->deadline_queue_position = position;
+}
+
+static void ConnectionDeadlineQueueSiftUp(size_t position) {
+  const ConnectionDeadlineQueueEntry entry =
+    g_connection_deadline_queue[position];
+  while(position > 0) {
+    const size_t parent = (position - 1) / 2;
+    if(g_connection_deadline_queue[parent].deadline <= entry.deadline) {
+      break;
+    }
+    ConnectionDeadlineQueuePlace(g_connection_deadline_queue[parent], position);
+    position = parent;
+  }
+  ConnectionDeadlineQueuePlace(entry, position);
+}
+
+static void ConnectionDeadlineQueueSiftDown(size_t position) {
+  const ConnectionDeadlineQueueEntry entry =
+    g_connection_deadline_queue[position];
+  for(;; ) {
+    size_t child = 2 * position + 1;
+    if(child >= g_connection_deadline_queue_size) {
+      break;
+    }
+    if(child + 1 < g_connection_deadline_queue_size &&
+       g_connection_deadline_queue[child + 1].deadline <
+       g_connection_deadline_queue[child].deadline) {
+      child++;
+    }
+    if(entry.deadline <= g_connection_deadline_queue[child].deadline) {
+      break;
+    }
+    ConnectionDeadlineQueuePlace(g_connection_deadline_queue[child], position);
+    position = child;
+  }
+  ConnectionDeadlineQueuePlace(entry, position);
+}
+
+/** @brief Earliest point in time at which ManageConnections() has to look at
+ * the connection
+ */
+static MicroSeconds ConnectionNextDeadline(
+  const CipConnectionObject *const connection_object) {
+  MicroSeconds deadline = kConnectionNoDeadline;
+  switch(ConnectionObjectGetState(connection_object) ) {
+    case kConnectionObjectStateTimedOut:
+      /* grace period before a timed out connection is cleaned up */
+      deadline = connection_object->inactivity_watchdog_timer;
+      break;
+    case kConnectionObjectStateEstablished:
+      if( (NULL != connection_object->consuming_instance) ||
+          (kConnectionObjectTransportClassTriggerDirectionServer ==
+           ConnectionObjectGetTransportClassTriggerDirection(connection_object) ) )
+      {
+        deadline = connection_object->inactivity_watchdog_timer;
+      }
+      if( (0 != ConnectionObjectGetExpectedPacketRate(connection_object) ) &&
+          (kEipInvalidSocket !=
+           connection_object->socket[kUdpCommuncationDirectionProducing]) &&
+          (connection_object->transmission_trigger_timer < deadline) ) {
+        deadline = connection_object->transmission_trigger_timer;
+      }
+      break;
+    default:
+      break;
+  }
+  return deadline;
+}
+
+static void ConnectionDeadlineQueueInsert(
+  CipConnectionObject *const connection_object) {
+  if(ConnectionDeadlineQueueContains(connection_object) ) {
+    ConnectionManagerRescheduleConnection(connection_object);
+    return;
+  }
+  OPENER_ASSERT(g_connection_deadline_queue_size < OPENER_CIP_NUM_ACTIVE_CONNS);
+  const ConnectionDeadlineQueueEntry entry = {
+    .deadline = ConnectionNextDeadline(connection_object),
+    .connection_object = connection_object,
+  };
+  ConnectionDeadlineQueuePlace(entry, g_connection_deadline_queue_size++);
+  ConnectionDeadlineQueueSiftUp(connection_object->deadline_queue_position);
+}
+
+static void ConnectionDeadlineQueueRemove(
+  const CipConnectionObject *const connection_object) {
+  if(!ConnectionDeadlineQueueContains(connection_object) ) {
+    return;
+  }
+  const size_t position = connection_object->deadline_queue_position;
+  const ConnectionDeadlineQueueEntry last =
+    g_connection_deadline_queue[--g_connection_deadline_queue_size];
+  g_connection_deadline_queue[g_connection_deadline_queue_size] =
+    (ConnectionDeadlineQueueEntry) { 0 };
+  if(last.connection_object != connection_object) {
+    ConnectionDeadlineQueuePlace(last, position);
+    ConnectionDeadlineQueueSiftUp(position);
+    ConnectionDeadlineQueueSiftDown(
+      last.connection_object->deadline_queue_position);
+  }
+}
+
+MicroSeconds ConnectionManagerGetTime(void) {
+  return g_connection_manager_time;
+}
+
+/* Latch the platform clock so that all timers set while handling one event
+ * share the same reference time */
+static MicroSeconds ConnectionManagerUpdateTime(void) {
+  g_connection_manager_time = GetMicroSeconds();
+  return g_connection_manager_time;
+}
+
+MicroSeconds GetNextConnectionDeadline(void) {
+  return (g_connection_deadline_queue_size > 0) ?
+         g_connection_deadline_queue[0].deadline :
+         kConnectionNoDeadline;
+}
+
+void ConnectionManagerRescheduleConnection(
+  CipConnectionObject *const connection_object) {
+  if(!ConnectionDeadlineQueueContains(connection_object) ) {
+    return; /* not active yet, the deadline is taken on insertion */
+  }
+  const size_t position = connection_object->deadline_queue_position;
+  const MicroSeconds deadline = ConnectionNextDeadline(connection_object);
+  const MicroSeconds previous_deadline =
+    g_connection_deadline_queue[position].deadline;
+  g_connection_deadline_queue[position].deadline = deadline;
+  if(deadline < previous_deadline) {
+    ConnectionDeadlineQueueSiftUp(position);
+  } else if(deadline > previous_deadline) {
+    ConnectionDeadlineQueueSiftDown(position);
+  }
+}
+
 /* Dummy data pointer for attribute 9 (Connection Entry List) - dynamically encoded, not used */
 static CipUint g_connection_entry_list_dummy = 0;
 
@@ -132,6 +478,15 @@ EipStatus AssembleForwardOpenResponse(CipConnectionObject *connection_object,
                                       EipUint8 general_status,
                                       EipUint16 extended_status);
 
+/** @brief Start the trace of a received Forward Open */
+static void ForwardOpenTraceBegin(void);
+
+/** @brief Finish the trace with the response's status */
+static void ForwardOpenTraceEnd(
+  const CipConnectionObject *const connection_object,
+  const EipUint8 general_status,
+  const EipUint16 extended_status);
+
 EipStatus AssembleForwardCloseResponse(EipUint16 connection_serial_number,
                                        EipUint16 originatior_vendor_id,
                                        EipUint32 originator_serial_number,
@@ -164,21 +519,6 @@ EipStatus CheckElectronicKeyData(EipUint8 key_format,
                                  void *key_data,
                                  EipUint16 *extended_status);
 
-/** @brief Parse the connection path of a forward open request
- *
- * This function will take the connection object and the received data stream and parse the connection path.
- * @param connection_object pointer to the connection object structure for which the connection should
- *                      be established
- * @param message_router_request pointer to the received request structure. The position of the data stream pointer has to be at the connection length entry
- * @param extended_error the extended error code in case an error happened
- * @return general status on the establishment
- *    - kEipStatusOk ... on success
- *    - On an error the general status code to be put into the response
- */
-EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
-                             CipMessageRouterRequest *message_router_request,
-                             EipUint16 *extended_error);
-
 ConnectionManagementHandling *GetConnectionManagementEntry(
   const EipUint32 class_id);
 
@@ -304,6 +644,47 @@ static void EncodeConnectionEntryList(const void *const data,
   /* No additional update needed - AddIntToMessage handles the UINT, and we handle the bits array above */
 }
 
+/* The instance attributes, kept in flash */
+static const CipAttributeStruct kConnectionManagerInstanceAttributes[] = {
+  CIP_ATTRIBUTE(1, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.open_requests,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(2, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.open_format_rejects,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(3, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.open_resource_rejects,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(4, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.open_other_rejects,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(5, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.close_requests,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(6, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.close_format_requests,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(7, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.close_other_requests,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(8, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.connection_timeouts,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(9, kCipAny,
+                (CipAttributeEncodeInMessage)EncodeConnectionEntryList, NULL,
+                &g_connection_entry_list_dummy, kGetableSingleAndAll),
+  /* Attribute 10 not defined in spec */
+  CIP_ATTRIBUTE(11, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.cpu_utilization,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(12, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.max_buff_size,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(13, kCipUint, EncodeCipUint, NULL,
+                &g_connection_manager_stats.buff_size_remaining,
+                kGetableSingleAndAll),
+};
+
 void InitializeConnectionManager(CipClass *class) {
 
   CipClass *meta_class = class->class_instance.cip_class;
@@ -328,43 +709,8 @@ void InitializeConnectionManager(CipClass *class) {
   /* Instance attributes (1-14) - Get the actual instance, not the class instance */
   CipInstance *instance = GetCipInstance(class, 1);
   OPENER_ASSERT(NULL != instance);
-  
-  InsertAttribute(instance, 1, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.open_requests,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance, 2, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.open_format_rejects,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance, 3, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.open_resource_rejects,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance, 4, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.open_other_rejects,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance, 5, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.close_requests,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance, 6, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.close_format_requests,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance, 7, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.close_other_requests,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance, 8, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.connection_timeouts,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance, 9, kCipAny, (CipAttributeEncodeInMessage)EncodeConnectionEntryList, NULL,
-                  (void *)&g_connection_entry_list_dummy, kGetableSingleAndAll);
-  /* Attribute 10 not defined in spec */
-  InsertAttribute(instance, 11, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.cpu_utilization,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance, 12, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.max_buff_size,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance, 13, kCipUint, EncodeCipUint, NULL,
-                  (void *)&g_connection_manager_stats.buff_size_remaining,
-                  kGetableSingleAndAll);
+  SetCipInstanceAttributes(instance, kConnectionManagerInstanceAttributes,
+                           NELEMENTS(kConnectionManagerInstanceAttributes) );
 
   InsertService(meta_class,
                 kGetAttributeAll,
@@ -384,7 +730,7 @@ EipStatus ConnectionManagerInit(EipUint16 unique_connection_id) {
                                                 0, /* # of class attributes */
                                                 7, /* # highest class attribute number*/
                                                 2, /* # of class services */
-                                                13, /* # of instance attributes */
+                                                0, /* # of instance attributes, from kConnectionManagerInstanceAttributes */
                                                 14, /* # highest instance attribute number*/
                                                 8, /* # of instance services */
                                                 1, /* # of instances */
@@ -430,63 +776,181 @@ EipStatus ConnectionManagerInit(EipUint16 unique_connection_id) {
   return kEipStatusOk;
 }
 
-EipStatus HandleReceivedConnectedData(const EipUint8 *const data,
-                                      int data_length,
-                                      struct sockaddr_in *from_address) {
+/** @brief Length of the CPF header of a sequenced connected data frame
+ *
+ * Item count, sequenced address item (type, length, connection ID, sequence
+ * number) and the type and length of the connected data item.
+ */
+#define CONNECTED_DATA_FRAME_HEADER_LENGTH 18
+
+/** @brief Decode the CPF header of a received connected data frame
+ *
+ * Class 0/1 frames practically always consist of a sequenced address item
+ * followed by a connected data item. That layout is decoded in place, with
+ * the payload left in the receive buffer. Anything else goes through
+ * CommonPacketFormatViewParse().
+ *
+ * @return true if the frame carries connected data
+ */
+static bool DecodeConnectedDataFrame(const EipUint8 *const data,
+                                     const int data_length,
+                                     CipUdint *const connection_id,
+                                     CipUdint *const sequence_number,
+                                     const EipUint8 **const payload,
+                                     EipUint16 *const payload_length) {
+  if(data_length >= CONNECTED_DATA_FRAME_HEADER_LENGTH) {
+    const EipUint8 *message = data;
+    const CipUint item_count = GetUintFromMessage(&message);
+    const CipUint address_type = GetUintFromMessage(&message);
+    const CipUint address_length = GetUintFromMessage(&message);
+    if( (2 == item_count) &&
+        (kCipItemIdSequencedAddressItem == address_type) &&
+        (8 == address_length) ) {
+      *connection_id = GetUdintFromMessage(&message);
+      *sequence_number = GetUdintFromMessage(&message);
+      const CipUint data_type = GetUintFromMessage(&message);
+      const CipUint length = GetUintFromMessage(&message);
+      if( (kCipItemIdConnectedDataItem != data_type) ||
+          (length > data_length - CONNECTED_DATA_FRAME_HEADER_LENGTH) ) {
+        return false;
+      }
+      *payload = message;
+      *payload_length = length;
+      return true;
+    }
+  }
+
+  CipCommonPacketFormatView view;
+  if(data_length < 0 ||
+     CommonPacketFormatViewParse(data, (size_t)data_length, &view) ==
+     kEipStatusError) {
+    return false;
+  }
+  /* check if connected address item or sequenced address item received, otherwise it is no connected message and should not be here */
+  if( (view.address_item.type_id != kCipItemIdConnectionAddress)
+      && (view.address_item.type_id != kCipItemIdSequencedAddressItem) ) {
+    return false;
+  }
+  if(view.data_item.type_id != kCipItemIdConnectedDataItem) {
+    return false;
+  }
+  *connection_id = CommonPacketFormatViewGetConnectionIdentifier(&view);
+  *sequence_number = CommonPacketFormatViewGetSequenceNumber(&view);
+  *payload = view.data_item.data;
+  *payload_length = view.data_item.length;
+  return true;
+}
 
-  if( (CreateCommonPacketFormatStructure(data, data_length,
-                                         &g_common_packet_format_data_item) ) ==
-      kEipStatusError ) {
+/** @brief Hand a received I/O frame to its connection
+ *
+ * @param secure the frame came over a DTLS session. A connection opened over
+ *        TLS takes only such frames, others take none.
+ */
+#if defined(OPENER_CIP_SECURITY) && 0 != OPENER_CIP_SECURITY
+/** @brief Whether a record came over the DTLS session of a connection
+ *
+ * The first record binds a connection whose originator had several unbound
+ * sessions at the Forward Open, see SecureTransportBindIoSession().
+ */
+static bool ConnectionIsFromSecurePeer(
+  CipConnectionObject *const connection_object,
+  const struct sockaddr_in *const from_address) {
+  struct sockaddr_in *const peer = &connection_object->secure_peer;
+  if(0 == peer->sin_port) {
+    if(peer->sin_addr.s_addr != from_address->sin_addr.s_addr ||
+       !SecureTransportClaimIoSession(connection_object->secure_tls_socket,
+                                      from_address) ) {
+      return false;
+    }
+    *peer = *from_address;
+    return true;
+  }
+  return peer->sin_addr.s_addr == from_address->sin_addr.s_addr &&
+         peer->sin_port == from_address->sin_port;
+}
+#endif
+
+static EipStatus HandleReceivedConnectedDataOnTransport(
+  const EipUint8 *const data,
+  int data_length,
+  struct sockaddr_in *from_address,
+  const CipBool secure) {
+  OPENER_LATENCY_PROBE(kLatencyProbeConsume);
+
+  CipUdint connection_id = 0;
+  CipUdint sequence_number = 0;
+  const EipUint8 *payload = NULL;
+  EipUint16 payload_length = 0;
+  if(!DecodeConnectedDataFrame(data, data_length, &connection_id,
+                               &sequence_number, &payload,
+                               &payload_length) ) {
     return kEipStatusError;
-  } else {
-    /* check if connected address item or sequenced address item received, otherwise it is no connected message and should not be here */
-    if( (g_common_packet_format_data_item.address_item.type_id ==
-         kCipItemIdConnectionAddress)
-        || (g_common_packet_format_data_item.address_item.type_id ==
-            kCipItemIdSequencedAddressItem) ) { /* found connected address item or found sequenced address item -> for now the sequence number will be ignored */
-      if(g_common_packet_format_data_item.data_item.type_id ==
-         kCipItemIdConnectedDataItem) { /* connected data item received */
-
-        CipConnectionObject *connection_object = GetConnectedObject(
-          g_common_packet_format_data_item.address_item.data.connection_identifier);
-        if(connection_object == NULL) {
-          return kEipStatusError;
-        }
+  }
 
-        /* only handle the data if it is coming from the originator */
-        if(connection_object->originator_address.sin_addr.s_addr ==
-           from_address->sin_addr.s_addr) {
-          ConnectionObjectResetLastPackageInactivityTimerValue(connection_object);
-
-          if(SEQ_GT32(g_common_packet_format_data_item.address_item.data.
-                      sequence_number,
-                      connection_object->eip_level_sequence_count_consuming) ||
-             !connection_object->eip_first_level_sequence_count_received) {
-            /* reset the watchdog timer */
-            ConnectionObjectResetInactivityWatchdogTimerValue(connection_object);
-
-            /* only inform assembly object if the sequence counter is greater or equal */
-            connection_object->eip_level_sequence_count_consuming =
-              g_common_packet_format_data_item.address_item.data.sequence_number;
-            connection_object->eip_first_level_sequence_count_received = true;
-
-            if(NULL != connection_object->connection_receive_data_function) {
-              return connection_object->connection_receive_data_function(
-                connection_object,
-                g_common_packet_format_data_item.data_item.data,
-                g_common_packet_format_data_item.data_item.length);
-            }
-          }
-        } else {
-          OPENER_TRACE_WARN(
-            "Connected Message Data Received with wrong address information\n");
-        }
+  CipConnectionObject *connection_object = GetConnectedObject(connection_id);
+  if(connection_object == NULL) {
+    return kEipStatusError;
+  }
+  if(connection_object->secure_transport != secure) {
+    OPENER_TRACE_WARN(
+      "Connected Message Data Received over the wrong transport\n");
+    return kEipStatusError;
+  }
+#if defined(OPENER_CIP_SECURITY) && 0 != OPENER_CIP_SECURITY
+  if(secure && !ConnectionIsFromSecurePeer(connection_object, from_address) ) {
+    OPENER_TRACE_WARN(
+      "Connected Message Data Received over another DTLS session\n");
+    return kEipStatusError;
+  }
+#endif
+
+  /* only handle the data if it is coming from the originator */
+  if(connection_object->originator_address.sin_addr.s_addr ==
+     from_address->sin_addr.s_addr) {
+    OPENER_TRACE_EVENT(kTraceEventConsume,
+                       connection_object->connection_serial_number,
+                       sequence_number, 0);
+    ConnectionManagerUpdateTime();
+    ConnectionObjectResetLastPackageInactivityTimerValue(connection_object);
+
+    if(SEQ_GT32(sequence_number,
+                connection_object->eip_level_sequence_count_consuming) ||
+       !connection_object->eip_first_level_sequence_count_received) {
+      /* reset the watchdog timer */
+      ConnectionObjectResetInactivityWatchdogTimerValue(connection_object);
+
+      /* only inform assembly object if the sequence counter is greater or equal */
+      connection_object->eip_level_sequence_count_consuming = sequence_number;
+      connection_object->eip_first_level_sequence_count_received = true;
+
+      if(NULL != connection_object->connection_receive_data_function) {
+        return connection_object->connection_receive_data_function(
+          connection_object,
+          payload,
+          payload_length);
       }
     }
+  } else {
+    OPENER_TRACE_WARN(
+      "Connected Message Data Received with wrong address information\n");
   }
   return kEipStatusOk;
 }
 
+EipStatus HandleReceivedConnectedData(const EipUint8 *const data,
+                                      int data_length,
+                                      struct sockaddr_in *from_address) {
+  return HandleReceivedConnectedDataOnTransport(data, data_length,
+                                                from_address, false);
+}
+
+EipStatus HandleReceivedSecureConnectedData(const EipUint8 *const data,
+                                            int data_length,
+                                            struct sockaddr_in *from_address) {
+  return HandleReceivedConnectedDataOnTransport(data, data_length,
+                                                from_address, true);
+}
+
 /** @brief Function prototype for all Forward Open handle functions
  *
  */
@@ -527,11 +991,46 @@ EipStatus HandleNullNonMatchingForwardOpenRequest(
                                      kConnectionManagerExtendedStatusCodeNullForwardOpenNotSupported);
 }
 
+static ConnectionManagerExtendedStatusCode ConnectionAdmissionCheck(
+  CipConnectionObject *const connection_object,
+  const CipConnectionObject *const reconfigured_connection);
+
+/* Whether another connection produces the assembly of a multicast T->O
+ * connection, which then has to keep the RPI they share */
+static bool ConnectionSharesProduction(
+  const CipConnectionObject *const connection_object) {
+  if(kConnectionObjectConnectionTypeMulticast !=
+     ConnectionObjectGetTToOConnectionType(connection_object) ) {
+    return false;
+  }
+  ConnectionIndexIterator producers;
+  ProducedInstanceIteratorBegin(&producers,
+                                connection_object->produced_path.instance_id);
+  const CipConnectionObject *iterator = NULL;
+  while(NULL != (iterator = ProducedInstanceIteratorNext(&producers) ) ) {
+    if(iterator != connection_object) {
+      return true;
+    }
+  }
+  return false;
+}
+
 /** @brief Handles a Null Matching Forward Open request
  *
- * Either  reconfigure a target device's application, or
- * return General Status kCipErrorConnectionFailure and
- * Extended Status kConnectionManagerExtendedStatusCodeNullForwardOpenNotSupported
+ * Reconfigures an established I/O connection of the same originator without
+ * closing it: configuration data in the connection path is written to the
+ * configuration assembly of the connection and non zero RPIs replace the
+ * ones of the directions the connection has. Everything is checked before
+ * anything is applied, so a rejected request leaves the connection as it
+ * was. Both happen within this call, i.e. between two productions of the
+ * connection; the production already scheduled keeps its deadline and the
+ * following ones use the new T->O RPI. The consumption watchdog switches
+ * to the new timing with the next packet received.
+ *
+ * Class 3 connections and requests of another originator get General Status
+ * kCipErrorConnectionFailure with the Extended Status
+ * kConnectionManagerExtendedStatusCodeNullForwardOpenNotSupported or
+ * kConnectionManagerExtendedStatusCodeErrorOwnershipConflict.
  */
 EipStatus HandleNullMatchingForwardOpenRequest(
   CipConnectionObject *connection_object,
@@ -546,13 +1045,149 @@ EipStatus HandleNullMatchingForwardOpenRequest(
   CipMessageRouterResponse *message_router_response) {
   /* Suppress unused parameter compiler warning. */
   (void) instance;
-  (void) message_router_request;
 
-  OPENER_TRACE_INFO("Right now we cannot handle Null requests\n");
+  CipConnectionObject *const established =
+    CheckForExistingConnection(connection_object);
+  OPENER_ASSERT(NULL != established);
+  if(!ConnectionObjectIsTypeIOConnection(established) ) {
+    OPENER_TRACE_INFO("Null Forward_Open of a class 3 connection\n");
+    return AssembleForwardOpenResponse(connection_object,
+                                       message_router_response,
+                                       kCipErrorConnectionFailure,
+                                       kConnectionManagerExtendedStatusCodeNullForwardOpenNotSupported);
+  }
+  if(connection_object->originator_address.sin_addr.s_addr !=
+     established->originator_address.sin_addr.s_addr) {
+    g_connection_manager_stats.open_resource_rejects++;
+    return AssembleForwardOpenResponse(connection_object,
+                                       message_router_response,
+                                       kCipErrorConnectionFailure,
+                                       kConnectionManagerExtendedStatusCodeErrorOwnershipConflict);
+  }
+
+  EipUint16 connection_status = kConnectionManagerExtendedStatusCodeSuccess;
+  EipUint32 status = ParseConnectionPath(connection_object,
+                                         message_router_request,
+                                         &connection_status);
+  if(kEipStatusOk != status) {
+    g_connection_manager_stats.open_format_rejects++;
+    return AssembleForwardOpenResponse(connection_object,
+                                       message_router_response,
+                                       status,
+                                       connection_status);
+  }
+  if(connection_object->configuration_path.class_id !=
+     established->configuration_path.class_id ||
+     connection_object->configuration_path.instance_id !=
+     established->configuration_path.instance_id) {
+    g_connection_manager_stats.open_other_rejects++;
+    return AssembleForwardOpenResponse(connection_object,
+                                       message_router_response,
+                                       kCipErrorConnectionFailure,
+                                       kConnectionManagerExtendedStatusCodeInconsistentApplicationPathCombo);
+  }
+
+  /* From here on the request object describes the reconfigured connection */
+  CipUdint o_to_t_rpi = ConnectionObjectGetOToTRequestedPacketInterval(
+    connection_object);
+  CipUdint t_to_o_rpi = ConnectionObjectGetTToORequestedPacketInterval(
+    connection_object);
+  if(0 == o_to_t_rpi ||
+     kConnectionObjectConnectionTypeNull ==
+     ConnectionObjectGetOToTConnectionType(established) ) {
+    o_to_t_rpi = ConnectionObjectGetOToTRequestedPacketInterval(established);
+  }
+  if(0 == t_to_o_rpi ||
+     kConnectionObjectConnectionTypeNull ==
+     ConnectionObjectGetTToOConnectionType(established) ) {
+    t_to_o_rpi = ConnectionObjectGetTToORequestedPacketInterval(established);
+  }
+  connection_object->transport_class_trigger =
+    established->transport_class_trigger;
+  connection_object->o_to_t_network_connection_parameters =
+    established->o_to_t_network_connection_parameters;
+  connection_object->t_to_o_network_connection_parameters =
+    established->t_to_o_network_connection_parameters;
+  connection_object->consumed_path = established->consumed_path;
+  connection_object->produced_path = established->produced_path;
+  connection_object->production_inhibit_time =
+    established->production_inhibit_time;
+  connection_object->cip_consumed_connection_id =
+    established->cip_consumed_connection_id;
+  connection_object->cip_produced_connection_id =
+    established->cip_produced_connection_id;
+  ConnectionObjectSetOToTRequestedPacketInterval(connection_object, o_to_t_rpi);
+  ConnectionObjectSetTToORequestedPacketInterval(connection_object, t_to_o_rpi);
+
+  const bool rpi_changed =
+    o_to_t_rpi != ConnectionObjectGetOToTRequestedPacketInterval(established) ||
+    t_to_o_rpi != ConnectionObjectGetTToORequestedPacketInterval(established);
+  if(rpi_changed) {
+    if(t_to_o_rpi !=
+       ConnectionObjectGetTToORequestedPacketInterval(established) &&
+       ConnectionSharesProduction(established) ) {
+      connection_object->correct_originator_to_target_packet_interval = 0;
+      connection_object->correct_target_to_originator_packet_interval =
+        ConnectionObjectGetTToORequestedPacketInterval(established);
+      connection_object->correct_packet_interval_types =
+        kConnectionManagerRpiTypeRequired << 8;
+      connection_status =
+        kConnectionManagerExtendedStatusCodeErrorRpiValuesNotAcceptable;
+    } else if(kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
+              ConnectionObjectGetTransportClassTriggerProductionTrigger(
+                connection_object) &&
+              ConnectionObjectGetProductionInhibitTime(connection_object) >
+              t_to_o_rpi / 1000) {
+      connection_status =
+        kConnectionManagerExtendedStatusCodeProductionInhibitTimerGreaterThanRpi;
+    } else {
+      ForwardOpenTraceStage(kForwardOpenStageAdmission);
+      connection_status = ConnectionAdmissionCheck(connection_object,
+                                                   established);
+    }
+    if(kConnectionManagerExtendedStatusCodeSuccess != connection_status) {
+      g_connection_manager_stats.open_resource_rejects++;
+      return AssembleForwardOpenResponse(connection_object,
+                                         message_router_response,
+                                         kCipErrorConnectionFailure,
+                                         connection_status);
+    }
+  }
+
+  if(0 != g_config_data_length) {
+    CipInstance *const config_instance = GetCipInstance(
+      GetAssemblyClass(),
+      established->configuration_path.instance_id);
+    if(NULL == config_instance ||
+       kEipStatusOk != NotifyAssemblyConnectedDataReceived(
+         config_instance, g_config_data_buffer, g_config_data_length) ) {
+      OPENER_TRACE_WARN("Configuration data was invalid\n");
+      g_connection_manager_stats.open_other_rejects++;
+      return AssembleForwardOpenResponse(connection_object,
+                                         message_router_response,
+                                         kCipErrorConnectionFailure,
+                                         kConnectionManagerExtendedStatusCodeInvalidConfigurationApplicationPath);
+    }
+  }
+
+  if(rpi_changed) {
+    OPENER_TRACE_INFO("Null Forward_Open: RPIs O->T %" PRIu32 " us, T->O %"
+                      PRIu32 " us\n", o_to_t_rpi, t_to_o_rpi);
+    ConnectionObjectSetOToTRequestedPacketInterval(established, o_to_t_rpi);
+    ConnectionObjectSetTToORequestedPacketInterval(established, t_to_o_rpi);
+    ConnectionObjectSetExpectedPacketRate(established);
+  }
+  g_connection_manager_stats.open_requests++;
+
+  /* no socket address items, the connection keeps its addresses */
+  message_router_response->common_packet_format_data->address_info_item[0].
+  type_id = 0;
+  message_router_response->common_packet_format_data->address_info_item[1].
+  type_id = 0;
   return AssembleForwardOpenResponse(connection_object,
                                      message_router_response,
-                                     kCipErrorConnectionFailure,
-                                     kConnectionManagerExtendedStatusCodeNullForwardOpenNotSupported);
+                                     kCipErrorSuccess,
+                                     0);
 }
 
 /** @brief Handles a Non Null Matching Forward Open Request
@@ -582,6 +1217,207 @@ EipStatus HandleNonNullMatchingForwardOpenRequest(
                                      kConnectionManagerExtendedStatusCodeErrorConnectionInUseOrDuplicateForwardOpen);
 }
 
+#ifndef OPENER_ADMISSION_MAX_PACKETS_PER_SECOND
+/** I/O packets per second produced and consumed by all connections, 0 for no limit */
+#define OPENER_ADMISSION_MAX_PACKETS_PER_SECOND 0
+#endif
+
+#ifndef OPENER_ADMISSION_CPU_BUDGET_PERCENT
+/** Share of the CPU time the I/O packets of all connections may take, 0 for no limit */
+#define OPENER_ADMISSION_CPU_BUDGET_PERCENT 0
+#endif
+
+/** @brief I/O traffic of a set of connections */
+typedef struct {
+  CipUdint produced_packets; /**< per second */
+  CipUdint consumed_packets; /**< per second */
+} ConnectionAdmissionLoad;
+
+static CipUdint ConnectionAdmissionPacketRate(const CipUdint rpi) {
+  return (0 == rpi) ? 0 : (1000000UL + rpi - 1) / rpi;
+}
+
+/* Whether a multicast T->O connection joins an established production
+ * instead of producing itself */
+static bool ConnectionAdmissionJoinsProduction(
+  const CipConnectionObject *const connection_object) {
+  if(kConnectionObjectConnectionTypeMulticast !=
+     ConnectionObjectGetTToOConnectionType(connection_object) ) {
+    return false;
+  }
+  return NULL != GetExistingProducerIoConnection(
+    true, connection_object->produced_path.instance_id);
+}
+
+static ConnectionAdmissionLoad ConnectionAdmissionGetLoad(
+  const CipConnectionObject *const connection_object) {
+  ConnectionAdmissionLoad load = { 0 };
+  if(kConnectionObjectConnectionTypeNull !=
+     ConnectionObjectGetOToTConnectionType(connection_object) ) {
+    load.consumed_packets = ConnectionAdmissionPacketRate(
+      ConnectionObjectGetOToTRequestedPacketInterval(connection_object) );
+  }
+  if(kConnectionObjectConnectionTypeNull !=
+     ConnectionObjectGetTToOConnectionType(connection_object) ) {
+    load.produced_packets = ConnectionAdmissionPacketRate(
+      ConnectionObjectGetTToORequestedPacketInterval(connection_object) );
+  }
+  return load;
+}
+
+/* Capacity left for the new connection and its demand in one budget, in
+ * the unit of that budget */
+typedef struct {
+  uint64_t remaining;
+  uint64_t demand;
+} ConnectionAdmissionBudget;
+
+/* Scales an RPI so that its part of the demand fits the remaining capacity */
+static CipUdint ConnectionAdmissionScaleRpi(
+  const CipUdint rpi,
+  const ConnectionAdmissionBudget *const budget) {
+  const uint64_t scaled = ( (uint64_t) rpi * budget->demand +
+                            budget->remaining - 1 ) / budget->remaining;
+  return (scaled > UINT32_MAX) ? UINT32_MAX : (CipUdint) scaled;
+}
+
+/** @brief Checks the I/O load of a new connection against the budgets
+ *
+ * The packet rate of a connection follows from its RPIs, the CPU time from
+ * the packet rate and the cost of a packet as measured by the platform, see
+ * GetIoPacketProcessingTime(). The budgets only limit new connections; the
+ * established ones keep their RPIs, so their timing is not affected by a
+ * connection that would not fit. A connection that is too fast gets the
+ * slowest of the RPIs that fit all budgets proposed, with type minimum.
+ *
+ * @param connection_object parsed Forward_Open request
+ * @param reconfigured_connection established connection the request
+ *        replaces, left out of the established load, NULL for a new one
+ * @return kConnectionManagerExtendedStatusCodeSuccess if the connection fits,
+ *         the RPI values not acceptable status with the proposed RPIs in
+ *         connection_object if it fits at slower RPIs and the network
+ *         bandwidth status if the budgets are used up
+ */
+static ConnectionManagerExtendedStatusCode ConnectionAdmissionCheck(
+  CipConnectionObject *const connection_object,
+  const CipConnectionObject *const reconfigured_connection) {
+  if(!ConnectionObjectIsTypeIOConnection(connection_object) ) {
+    return kConnectionManagerExtendedStatusCodeSuccess;
+  }
+
+  ConnectionAdmissionLoad established = { 0 };
+  for(const DoublyLinkedListNode *node = connection_list.first; NULL != node;
+      node = node->next) {
+    const CipConnectionObject *const iterator = node->data;
+    if(kConnectionObjectStateEstablished != ConnectionObjectGetState(iterator) ||
+       !ConnectionObjectIsTypeIOConnection(iterator) ||
+       reconfigured_connection == iterator) {
+      continue;
+    }
+    ConnectionAdmissionLoad load = ConnectionAdmissionGetLoad(iterator);
+    if(kEipInvalidSocket ==
+       iterator->socket[kUdpCommuncationDirectionProducing]) {
+      load.produced_packets = 0; /* joined a multicast production */
+    }
+    established.produced_packets += load.produced_packets;
+    established.consumed_packets += load.consumed_packets;
+  }
+
+  ConnectionAdmissionLoad requested = ConnectionAdmissionGetLoad(
+    connection_object);
+  const bool joins_production = (NULL != reconfigured_connection) ?
+                                kEipInvalidSocket ==
+                                reconfigured_connection->socket[
+                                  kUdpCommuncationDirectionProducing] :
+                                ConnectionAdmissionJoinsProduction(
+                                  connection_object);
+  if(joins_production) {
+    requested.produced_packets = 0;
+  }
+
+  ConnectionAdmissionBudget budgets[2];
+  size_t number_of_budgets = 0;
+#if OPENER_ADMISSION_MAX_PACKETS_PER_SECOND > 0
+  {
+    const uint64_t used = (uint64_t) established.produced_packets +
+                          established.consumed_packets;
+    budgets[number_of_budgets++] = (ConnectionAdmissionBudget) {
+      .remaining = (used < OPENER_ADMISSION_MAX_PACKETS_PER_SECOND) ?
+                   OPENER_ADMISSION_MAX_PACKETS_PER_SECOND - used : 0,
+      .demand = (uint64_t) requested.produced_packets +
+                requested.consumed_packets,
+    };
+  }
+#endif
+#if OPENER_ADMISSION_CPU_BUDGET_PERCENT > 0
+  CipUdint production_time = 0;
+  CipUdint consumption_time = 0;
+  GetIoPacketProcessingTime(&production_time, &consumption_time);
+  if(0 != production_time || 0 != consumption_time) {
+    /* microseconds of CPU time per second */
+    const uint64_t cpu_budget = OPENER_ADMISSION_CPU_BUDGET_PERCENT * 10000ULL;
+    const uint64_t used =
+      (uint64_t) established.produced_packets * production_time +
+      (uint64_t) established.consumed_packets * consumption_time;
+    budgets[number_of_budgets++] = (ConnectionAdmissionBudget) {
+      .remaining = (used < cpu_budget) ? cpu_budget - used : 0,
+      .demand = (uint64_t) requested.produced_packets * production_time +
+                (uint64_t) requested.consumed_packets * consumption_time,
+    };
+  }
+#endif
+
+  CipUdint o_to_t_rpi = ConnectionObjectGetOToTRequestedPacketInterval(
+    connection_object);
+  CipUdint t_to_o_rpi = ConnectionObjectGetTToORequestedPacketInterval(
+    connection_object);
+  bool fits = true;
+  for(size_t i = 0; i < number_of_budgets; ++i) {
+    if(budgets[i].demand <= budgets[i].remaining) {
+      continue;
+    }
+    if(0 == budgets[i].remaining) {
+      OPENER_TRACE_WARN("admission: I/O budget used up, connection rejected\n");
+      return kConnectionManagerExtendedStatusCodeNetworkBandwithNotAvailableForData;
+    }
+    fits = false;
+    if(0 != requested.consumed_packets) {
+      const CipUdint rpi = ConnectionAdmissionScaleRpi(
+        ConnectionObjectGetOToTRequestedPacketInterval(connection_object),
+        &budgets[i]);
+      o_to_t_rpi = (rpi > o_to_t_rpi) ? rpi : o_to_t_rpi;
+    }
+    if(0 != requested.produced_packets) {
+      const CipUdint rpi = ConnectionAdmissionScaleRpi(
+        ConnectionObjectGetTToORequestedPacketInterval(connection_object),
+        &budgets[i]);
+      t_to_o_rpi = (rpi > t_to_o_rpi) ? rpi : t_to_o_rpi;
+    }
+  }
+  if(fits) {
+    return kConnectionManagerExtendedStatusCodeSuccess;
+  }
+
+  OPENER_TRACE_WARN("admission: RPIs too fast, proposing O->T %" PRIu32
+                    " us, T->O %" PRIu32 " us\n", o_to_t_rpi, t_to_o_rpi);
+  connection_object->correct_originator_to_target_packet_interval = 0;
+  connection_object->correct_target_to_originator_packet_interval = 0;
+  connection_object->correct_packet_interval_types = 0;
+  if(0 != requested.consumed_packets) {
+    connection_object->correct_originator_to_target_packet_interval =
+      o_to_t_rpi;
+    connection_object->correct_packet_interval_types |=
+      kConnectionManagerRpiTypeMinimum;
+  }
+  if(0 != requested.produced_packets) {
+    connection_object->correct_target_to_originator_packet_interval =
+      t_to_o_rpi;
+    connection_object->correct_packet_interval_types |=
+      kConnectionManagerRpiTypeMinimum << 8;
+  }
+  return kConnectionManagerExtendedStatusCodeErrorRpiValuesNotAcceptable;
+}
+
 /** @brief Handles a Non Null Non Matching Forward Open Request
  *
  * Non-Null, Non-Matching request - Establish a new connection
@@ -620,7 +1456,18 @@ EipStatus HandleNonNullNonMatchingForwardOpenRequest(
   if(kEipStatusOk != temp) {
     return AssembleForwardOpenResponse(&g_dummy_connection_object,
                                        message_router_response,
-                                       temp,
+                                       temp,
+                                       connection_status);
+  }
+
+  ForwardOpenTraceStage(kForwardOpenStageAdmission);
+  connection_status = ConnectionAdmissionCheck(&g_dummy_connection_object,
+                                               NULL);
+  if(kConnectionManagerExtendedStatusCodeSuccess != connection_status) {
+    g_connection_manager_stats.open_resource_rejects++;
+    return AssembleForwardOpenResponse(&g_dummy_connection_object,
+                                       message_router_response,
+                                       kCipErrorConnectionFailure,
                                        connection_status);
   }
 
@@ -630,8 +1477,12 @@ EipStatus HandleNonNullNonMatchingForwardOpenRequest(
       g_dummy_connection_object.configuration_path.class_id);
   if(NULL != connection_management_entry) {
     if (NULL != connection_management_entry->open_connection_function) {
+      g_dummy_connection_object.forward_open_items =
+        message_router_response->common_packet_format_data;
+      ForwardOpenTraceStage(kForwardOpenStageEstablish);
       temp = connection_management_entry->open_connection_function(
           &g_dummy_connection_object, &connection_status);
+      g_dummy_connection_object.forward_open_items = NULL;
     } else {
       connection_status = kConnectionManagerExtendedStatusCodeMiscellaneous;
     }
@@ -747,6 +1598,9 @@ EipStatus ForwardOpenRoutine(CipInstance *instance,
                              const struct sockaddr *originator_address,
                              const CipSessionHandle encapsulation_session) {
   (void) instance; /*suppress compiler warning */
+  /* the reply carries the socket address items of the connection */
+  OPENER_ASSERT(NULL != message_router_response->common_packet_format_data);
+  ForwardOpenTraceBegin();
 
   bool is_null_request = false; /* 1 = Null Request, 0 =  Non-Null Request  */
   bool is_matching_request = false; /* 1 = Matching Request, 0 = Non-Matching Request  */
@@ -838,8 +1692,11 @@ EipStatus ForwardClose(CipInstance *instance,
     kConnectionManagerExtendedStatusCodeErrorConnectionTargetConnectionNotFound;
 
   /* set AddressInfo Items to invalid TypeID to prevent assembleLinearMsg to read them */
-  g_common_packet_format_data_item.address_info_item[0].type_id = 0;
-  g_common_packet_format_data_item.address_info_item[1].type_id = 0;
+  OPENER_ASSERT(NULL != message_router_response->common_packet_format_data);
+  message_router_response->common_packet_format_data->address_info_item[0].
+  type_id = 0;
+  message_router_response->common_packet_format_data->address_info_item[1].
+  type_id = 0;
 
   message_router_request->data += 2; /* ignore Priority/Time_tick and Time-out_ticks */
 
@@ -1097,116 +1954,245 @@ void AssembleConnectionDataResponseMessage(
                    &message_router_response->message);
 }
 
+/** @brief Update the achieved production interval of a connection */
+static void ConnectionRecordProduction(CipConnectionObject *const connection_object,
+                                       const MicroSeconds now) {
+  if(0 != connection_object->production_count) {
+    const MicroSeconds interval = now - connection_object->last_production_time;
+    const CipUdint achieved_interval =
+      (interval > UINT32_MAX) ? UINT32_MAX : (CipUdint) interval;
+    if(1 == connection_object->production_count) {
+      connection_object->production_interval_average = achieved_interval;
+    } else {
+      /* exponential moving average with a weight of 1/8 */
+      connection_object->production_interval_average +=
+        ( (CipDint) achieved_interval -
+          (CipDint) connection_object->production_interval_average ) / 8;
+    }
+    if(achieved_interval > connection_object->production_interval_maximum) {
+      connection_object->production_interval_maximum = achieved_interval;
+    }
+  }
+  connection_object->last_production_time = now;
+  if(UINT32_MAX != connection_object->production_count) {
+    connection_object->production_count++;
+  }
+  if(kConnectionObjectConnectionTypeMulticast ==
+     ConnectionObjectGetTToOConnectionType(connection_object) ) {
+    g_multicast_packets_produced++;
+    if(connection_object->multicast_consumer_count > 1) {
+      g_multicast_packets_saved +=
+        connection_object->multicast_consumer_count - 1;
+    }
+  }
+}
+
+/** @brief Whether a production missed the interval the timer can keep
+ *
+ * Productions run off the timer tick, so a connection cannot be produced
+ * more often than once per tick and each production may be up to one tick
+ * past its deadline. A production is late only if it comes more than one
+ * tick after max(RPI, tick) since the previous one; an RPI below the tick
+ * is not late without load. Called before ConnectionRecordProduction().
+ */
+static bool ConnectionProductionIsLate(
+  const CipConnectionObject *const connection_object,
+  const MicroSeconds now) {
+  if(0 == connection_object->production_count) {
+    return false;
+  }
+  const MicroSeconds tick = (MicroSeconds) kOpenerTimerTickInMilliSeconds *
+                            1000U;
+  MicroSeconds interval =
+    connection_object->t_to_o_requested_packet_interval;
+  if(interval < tick) {
+    interval = tick;
+  }
+  return now - connection_object->last_production_time > interval + tick;
+}
+
+/** @brief Handle the expired watchdog and transmission deadlines of a
+ * single connection
+ */
+static void ManageConnectionDeadlines(CipConnectionObject *const connection_object,
+                                      const MicroSeconds now) {
+  /* Clean up stale timed-out connections (grace period expired) */
+  if(kConnectionObjectStateTimedOut ==
+     ConnectionObjectGetState(connection_object)) {
+    if(now >= connection_object->inactivity_watchdog_timer) {
+      /* Grace period expired - clean up the timed-out connection */
+      OPENER_TRACE_INFO(
+        "Cleaning up stale timed-out connection after grace period (ConnNr: %u)\n",
+        connection_object->connection_serial_number);
+      if(NULL != connection_object->connection_close_function) {
+        connection_object->connection_close_function(connection_object);
+      }
+    }
+    return;
+  }
+
+  if(kConnectionObjectStateEstablished !=
+     ConnectionObjectGetState(connection_object) ) {
+    return;
+  }
+
+  if( (NULL != connection_object->consuming_instance) || /* we have a consuming connection check inactivity watchdog timer */
+      (kConnectionObjectTransportClassTriggerDirectionServer ==
+       ConnectionObjectGetTransportClassTriggerDirection(connection_object) ) ) /* all server connections have to maintain an inactivity watchdog timer */
+  {
+    if(now >= connection_object->inactivity_watchdog_timer) {
+      /* we have a timed out connection perform watchdog time out action*/
+      OPENER_TRACE_INFO(">>>>>>>>>>Connection ConnNr: %u timed out\n",
+                        connection_object->connection_serial_number);
+      g_connection_manager_stats.connection_timeouts++;  /* Increment timeout counter */
+      OPENER_TRACE_EVENT(kTraceEventConnectionTimeout,
+                         connection_object->connection_serial_number, 0, 0);
+      OPENER_ASSERT(NULL != connection_object->connection_timeout_function);
+      connection_object->connection_timeout_function(connection_object);
+    }
+  }
+  /* only if the connection has not timed out check if data is to be send */
+  if(kConnectionObjectStateEstablished !=
+     ConnectionObjectGetState(connection_object) ) {
+    return;
+  }
+  /* client connection */
+  if( (0 != ConnectionObjectGetExpectedPacketRate(connection_object) )
+      && (kEipInvalidSocket !=
+          connection_object->socket[kUdpCommuncationDirectionProducing]) /* only produce for the master connection */
+      && (now >= connection_object->transmission_trigger_timer) ) { /* need to send package */
+    OPENER_ASSERT(NULL != connection_object->connection_send_data_function);
+    EipStatus eip_status =
+      connection_object->connection_send_data_function(connection_object);
+    if(eip_status == kEipStatusError) {
+      OPENER_TRACE_ERR("sending of UDP data in manage Connection failed\n");
+    }
+    if(ConnectionProductionIsLate(connection_object, now) ) {
+      g_late_productions++;
+    }
+    ConnectionRecordProduction(connection_object, now);
+    g_productions++;
+    /* add the RPI to the deadline, keeping the production phase */
+    const CipUdint requested_packet_interval =
+      connection_object->t_to_o_requested_packet_interval;
+    connection_object->transmission_trigger_timer += requested_packet_interval;
+    if(connection_object->transmission_trigger_timer <= now) {
+      /* more than one RPI late, restart the production phase from now */
+      OPENER_TRACE_INFO("transmission was %" PRIu64 " us late for RPI: %" PRIu32
+                        " us\n",
+                        (uint64_t) (now -
+                                    connection_object->transmission_trigger_timer),
+                        requested_packet_interval);
+      connection_object->transmission_trigger_timer = now +
+                                                      requested_packet_interval;
+    }
+    if(kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
+       ConnectionObjectGetTransportClassTriggerProductionTrigger(
+         connection_object) ) {
+      /* non cyclic connections have to reload the production inhibit timer */
+      ConnectionObjectResetProductionInhibitTimer(connection_object);
+    }
+  }
+}
+
+void ManageConnectionTimers(void) {
+  const MicroSeconds now = ConnectionManagerUpdateTime();
+
+  /* Every connection is visited at most once per call; handled connections
+   * are rescheduled to a deadline in the future or leave the queue */
+  for(size_t visits = g_connection_deadline_queue_size;
+      visits > 0 && g_connection_deadline_queue_size > 0 &&
+      g_connection_deadline_queue[0].deadline <= now;
+      --visits) {
+    CipConnectionObject *connection_object =
+      g_connection_deadline_queue[0].connection_object;
+    ManageConnectionDeadlines(connection_object, now);
+    ConnectionManagerRescheduleConnection(connection_object);
+  }
+}
+
 EipStatus ManageConnections(MilliSeconds elapsed_time) {
   //OPENER_TRACE_INFO("Entering ManageConnections\n");
   /*Inform application that it can execute */
   HandleApplication();
   ManageEncapsulationMessages(elapsed_time);
 
-  DoublyLinkedListNode *node = connection_list.first;
+  ManageConnectionTimers();
+  return kEipStatusOk;
+}
 
-  while(NULL != node) {
-    //OPENER_TRACE_INFO("Entering Connection Object loop\n");
-    CipConnectionObject *connection_object = node->data;
-    
-    DoublyLinkedListNode *next_node = node->next;
-
-    /* Clean up stale timed-out connections (grace period expired) */
-    if(kConnectionObjectStateTimedOut ==
-       ConnectionObjectGetState(connection_object)) {
-      /* For multicast connections that timed out, we set inactivity_watchdog_timer
-       * to a grace period (10 seconds). Count it down and clean up when expired. */
-      if(connection_object->inactivity_watchdog_timer > 0) {
-        if(elapsed_time >= connection_object->inactivity_watchdog_timer) {
-          /* Grace period expired - clean up the timed-out connection */
-          OPENER_TRACE_INFO(
-            "Cleaning up stale timed-out connection after grace period (ConnNr: %u)\n",
-            connection_object->connection_serial_number);
-          if(NULL != connection_object->connection_close_function) {
-            connection_object->connection_close_function(connection_object);
-          }
-        } else {
-          connection_object->inactivity_watchdog_timer -= elapsed_time;
-        }
-      }
-      /* Skip to next connection - don't process timed-out connections further */
-      node = next_node;
-      continue;
-    }
-    
-    if(kConnectionObjectStateEstablished ==
-       ConnectionObjectGetState(connection_object) ) {
-      if( (NULL != connection_object->consuming_instance) || /* we have a consuming connection check inactivity watchdog timer */
-          (kConnectionObjectTransportClassTriggerDirectionServer ==
-           ConnectionObjectGetTransportClassTriggerDirection(connection_object) ) ) /* all server connections have to maintain an inactivity watchdog timer */
-      {
-        if(elapsed_time >= connection_object->inactivity_watchdog_timer) {
-          /* we have a timed out connection perform watchdog time out action*/
-          OPENER_TRACE_INFO(">>>>>>>>>>Connection ConnNr: %u timed out\n",
-                            connection_object->connection_serial_number);
-          g_connection_manager_stats.connection_timeouts++;  /* Increment timeout counter */
-          OPENER_ASSERT(NULL != connection_object->connection_timeout_function);
-          connection_object->connection_timeout_function(connection_object);
-        } else {
-          connection_object->inactivity_watchdog_timer -= elapsed_time;
-          connection_object->last_package_watchdog_timer -= elapsed_time;
-        }
-      }
-      /* only if the connection has not timed out check if data is to be send */
-      if(kConnectionObjectStateEstablished ==
-         ConnectionObjectGetState(connection_object) ) {
-        /* client connection */
-        if( (0 != ConnectionObjectGetExpectedPacketRate(connection_object) )
-            && (kEipInvalidSocket !=
-                connection_object->socket[kUdpCommuncationDirectionProducing]) ) /* only produce for the master connection */
-        {
-          if(kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
-             ConnectionObjectGetTransportClassTriggerProductionTrigger(
-               connection_object) ) {
-            /* non cyclic connections have to decrement production inhibit timer */
-            if(elapsed_time <= connection_object->production_inhibit_timer) {
-              //The connection is allowed to send again
-            } else {
-              connection_object->production_inhibit_timer -= elapsed_time;
-            }
-          }
+static void ForwardOpenTraceBegin(void) {
+#if OPENER_FORWARD_OPEN_TRACE_ENTRIES > 0
+  memset(&g_forward_open_current, 0, sizeof(g_forward_open_current));
+  g_forward_open_current.received = GetMicroSeconds();
+  g_forward_open_stage = kForwardOpenStageRequest;
+  g_forward_open_stage_start = g_forward_open_current.received;
+  g_forward_open_active = true;
+#endif
+}
 
-          if(connection_object->transmission_trigger_timer <= elapsed_time) { /* need to send package */
-            OPENER_ASSERT(
-              NULL != connection_object->connection_send_data_function);
-            EipStatus eip_status =
-              connection_object->connection_send_data_function(connection_object);
-            if(eip_status == kEipStatusError) {
-              OPENER_TRACE_ERR(
-                "sending of UDP data in manage Connection failed\n");
-            }
-            /* add the RPI to the timer value */
-            connection_object->transmission_trigger_timer +=
-              ConnectionObjectGetRequestedPacketInterval(connection_object);
-            /* decrecment the elapsed time from timer value, if less than timer value */
-            if (connection_object->transmission_trigger_timer > elapsed_time) {
-              connection_object->transmission_trigger_timer -= elapsed_time;
-            } else {  /* elapsed time was longer than RPI */
-              connection_object->transmission_trigger_timer = 0;
-              OPENER_TRACE_INFO("elapsed time: %lu ms was longer than RPI: %u ms\n",
-                                elapsed_time,
-                                ConnectionObjectGetRequestedPacketInterval(connection_object));
-            }
-            if(kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
-               ConnectionObjectGetTransportClassTriggerProductionTrigger(
-                 connection_object) ) {
-              /* non cyclic connections have to reload the production inhibit timer */
-              ConnectionObjectResetProductionInhibitTimer(connection_object);
-            }
-          } else {
-            connection_object->transmission_trigger_timer -= elapsed_time;
-          }
-        }
-      }
-    }
-    node = node->next;
+void ForwardOpenTraceStage(const ForwardOpenStage stage) {
+#if OPENER_FORWARD_OPEN_TRACE_ENTRIES > 0
+  if(!g_forward_open_active) {
+    return;
   }
-  return kEipStatusOk;
+  const MicroSeconds now = GetMicroSeconds();
+  g_forward_open_current.stage_us[g_forward_open_stage] +=
+    (CipUdint) (now - g_forward_open_stage_start);
+  g_forward_open_stage = stage;
+  g_forward_open_stage_start = now;
+#else
+  (void) stage;
+#endif
+}
+
+/** @brief Close the response stage and keep the Forward Open */
+static void ForwardOpenTraceEnd(
+  const CipConnectionObject *const connection_object,
+  const EipUint8 general_status,
+  const EipUint16 extended_status) {
+#if OPENER_FORWARD_OPEN_TRACE_ENTRIES > 0
+  if(!g_forward_open_active) {
+    return;
+  }
+  ForwardOpenTraceStage(kForwardOpenStageResponse);
+  g_forward_open_active = false;
+  ForwardOpenTrace *const trace = &g_forward_open_current;
+  trace->sequence = g_forward_open_count;
+  trace->total_us = 0;
+  for(size_t i = 0; i < kForwardOpenStageCount; i++) {
+    trace->total_us += trace->stage_us[i];
+  }
+  trace->connection_serial_number = connection_object->connection_serial_number;
+  trace->originator_vendor_id = connection_object->originator_vendor_id;
+  trace->originator_serial_number = connection_object->originator_serial_number;
+  trace->general_status = general_status;
+  trace->extended_status = extended_status;
+  trace->large = connection_object->is_large_forward_open;
+  g_forward_open_traces[g_forward_open_count %
+                        OPENER_FORWARD_OPEN_TRACE_ENTRIES] = *trace;
+  g_forward_open_count++;
+#else
+  (void) connection_object;
+  (void) general_status;
+  (void) extended_status;
+#endif
+}
+
+bool GetForwardOpenTrace(const size_t index, ForwardOpenTrace *const trace) {
+#if OPENER_FORWARD_OPEN_TRACE_ENTRIES > 0
+  if(index >= OPENER_FORWARD_OPEN_TRACE_ENTRIES ||
+     index >= g_forward_open_count) {
+    return false;
+  }
+  *trace = g_forward_open_traces[(g_forward_open_count - 1 - index) %
+                                 OPENER_FORWARD_OPEN_TRACE_ENTRIES];
+  return true;
+#else
+  (void) index;
+  (void) trace;
+  return false;
+#endif
 }
 
 /** @brief Assembles the Forward Open Response
@@ -1224,9 +2210,10 @@ EipStatus AssembleForwardOpenResponse(CipConnectionObject *connection_object,
                                       CipMessageRouterResponse *message_router_response,
                                       EipUint8 general_status,
                                       EipUint16 extended_status) {
+  ForwardOpenTraceStage(kForwardOpenStageResponse);
   /* write reply information in CPF struct dependent of pa_status */
   CipCommonPacketFormatData *cip_common_packet_format_data =
-    &g_common_packet_format_data_item;
+    message_router_response->common_packet_format_data;
   cip_common_packet_format_data->item_count = 2;
   cip_common_packet_format_data->data_item.type_id =
     kCipItemIdUnconnectedDataItem;
@@ -1293,6 +2280,29 @@ EipStatus AssembleForwardOpenResponse(CipConnectionObject *connection_object,
             break;
           }
 
+          case kConnectionManagerExtendedStatusCodeErrorRpiValuesNotAcceptable:
+          {
+            /* Vol.1 Table 3-5.33: acceptable RPI types, then the O->T and
+             * the T->O RPI the types refer to */
+            const CipUdint o_to_t_rpi =
+              connection_object->correct_originator_to_target_packet_interval;
+            const CipUdint t_to_o_rpi =
+              connection_object->correct_target_to_originator_packet_interval;
+            message_router_response->size_of_additional_status = 6;
+            message_router_response->additional_status[0] = extended_status;
+            message_router_response->additional_status[1] =
+              connection_object->correct_packet_interval_types;
+            message_router_response->additional_status[2] =
+              (EipUint16) (o_to_t_rpi & 0xFFFF);
+            message_router_response->additional_status[3] =
+              (EipUint16) (o_to_t_rpi >> 16);
+            message_router_response->additional_status[4] =
+              (EipUint16) (t_to_o_rpi & 0xFFFF);
+            message_router_response->additional_status[5] =
+              (EipUint16) (t_to_o_rpi >> 16);
+            break;
+          }
+
           default: {
             message_router_response->size_of_additional_status = 1;
             message_router_response->additional_status[0] = extended_status;
@@ -1322,6 +2332,7 @@ EipStatus AssembleForwardOpenResponse(CipConnectionObject *connection_object,
   AddSintToMessage(0, &message_router_response->message); /* remaining path size - for routing devices relevant */
   AddSintToMessage(0, &message_router_response->message); /* reserved */
 
+  ForwardOpenTraceEnd(connection_object, general_status, extended_status);
   return kEipStatusOkSend; /* send reply */
 }
 
@@ -1363,7 +2374,7 @@ EipStatus AssembleForwardCloseResponse(EipUint16 connection_serial_number,
                                        EipUint16 extended_error_code) {
   /* write reply information in CPF struct dependent of pa_status */
   CipCommonPacketFormatData *common_data_packet_format_data =
-    &g_common_packet_format_data_item;
+    message_router_response->common_packet_format_data;
   common_data_packet_format_data->item_count = 2;
   common_data_packet_format_data->data_item.type_id =
     kCipItemIdUnconnectedDataItem;
@@ -1400,55 +2411,52 @@ EipStatus AssembleForwardCloseResponse(EipUint16 connection_serial_number,
 }
 
 CipConnectionObject *GetConnectedObject(const EipUint32 connection_id) {
-  DoublyLinkedListNode *iterator = connection_list.first;
-
-  while(NULL != iterator) {
+  ConnectionIndexIterator iterator;
+  ConnectionIndexIteratorBegin(&iterator, connection_id);
+  CipConnectionObject *connection_object = NULL;
+  while(NULL != (connection_object =
+                   ConnectionIndexIteratorNext(&g_connection_id_index,
+                                               &iterator) ) ) {
     if(kConnectionObjectStateEstablished ==
-       ConnectionObjectGetState(iterator->data)
-       && connection_id ==
-       ConnectionObjectGetCipConsumedConnectionID(iterator->data) ) {
-      return iterator->data;
+       ConnectionObjectGetState(connection_object) ) {
+      return connection_object;
     }
-    iterator = iterator->next;
   }
   return NULL;
 }
 
 CipConnectionObject *GetConnectedOutputAssembly(
   const EipUint32 output_assembly_id) {
-  DoublyLinkedListNode *iterator = connection_list.first;
-
-  while(NULL != iterator) {
+  ConnectionIndexIterator iterator;
+  ProducedInstanceIteratorBegin(&iterator, output_assembly_id);
+  CipConnectionObject *connection_object = NULL;
+  while(NULL != (connection_object = ProducedInstanceIteratorNext(&iterator) ) )
+  {
     if(kConnectionObjectInstanceTypeIOExclusiveOwner ==
-       ConnectionObjectGetInstanceType(iterator->data)
+       ConnectionObjectGetInstanceType(connection_object)
        && (kConnectionObjectStateEstablished ==
-           ConnectionObjectGetState(iterator->data)
+           ConnectionObjectGetState(connection_object)
            || kConnectionObjectStateTimedOut ==
-           ConnectionObjectGetState(iterator->data) )
-       && output_assembly_id ==
-       ( (CipConnectionObject *) iterator->data )->produced_path.instance_id) {
-      return iterator->data;
+           ConnectionObjectGetState(connection_object) ) ) {
+      return connection_object;
     }
-    iterator = iterator->next;
   }
   return NULL;
 }
 
 CipConnectionObject *CheckForExistingConnection(
   const CipConnectionObject *const connection_object) {
-
-  DoublyLinkedListNode *iterator = connection_list.first;
-
-  while(NULL != iterator) {
-    if(kConnectionObjectStateEstablished ==
-       ConnectionObjectGetState(iterator->data) ) {
-      if(EqualConnectionTriad(connection_object, iterator->data) ) {
-        return iterator->data;
-      }
+  ConnectionIndexIterator iterator;
+  ConnectionIndexIteratorBegin(&iterator,
+                               ConnectionIndexTriad(connection_object) );
+  CipConnectionObject *active = NULL;
+  while(NULL != (active = ConnectionIndexIteratorNext(&g_connection_triad_index,
+                                                       &iterator) ) ) {
+    if(kConnectionObjectStateEstablished == ConnectionObjectGetState(active) &&
+       EqualConnectionTriad(connection_object, active) ) {
+      return active;
     }
-    iterator = iterator->next;
   }
-
   return NULL;
 }
 
@@ -1530,9 +2538,163 @@ EipStatus CheckElectronicKeyData(EipUint8 key_format,
          kEipStatusError;
 }
 
+#ifndef OPENER_CONNECTION_PATH_CACHE_SIZE
+/** Parsed connection paths kept for repeated Forward_Opens, 0 disables the cache */
+#define OPENER_CONNECTION_PATH_CACHE_SIZE 4
+#endif
+
+/** Longer connection paths, i.e. ones with much configuration data, are not cached */
+#define CONNECTION_PATH_CACHE_MAX_PATH_LENGTH 64
+
+#if OPENER_CONNECTION_PATH_CACHE_SIZE > 0
+
+/** @brief Result of a successful ParseConnectionPath()
+ *
+ * Keyed by the raw path, electronic key included, and by the connection
+ * parameters the parsing depends on. The path names classes and instances
+ * that exist and a key that matched, both do not change until the stack is
+ * restarted. Only the position of the configuration data in the request is
+ * kept, the data itself is part of the key.
+ */
+typedef struct {
+  EipUint8 path[CONNECTION_PATH_CACHE_MAX_PATH_LENGTH];
+  EipUint8 path_length; /**< in bytes, 0 marks a free entry */
+  CipByte transport_class_trigger;
+  EipUint8 originator_to_target_connection_type;
+  EipUint8 target_to_originator_connection_type;
+  bool has_electronic_key;
+  CipUint production_inhibit_time;
+  CipConnectionPathEpath configuration_path;
+  CipConnectionPathEpath consumed_path;
+  CipConnectionPathEpath produced_path;
+  EipUint8 config_data_offset; /**< offset in the path of the configuration data */
+  EipUint8 config_data_length; /**< 0 if the path has no configuration data */
+  EipUint8 parsed_length; /**< bytes of the path consumed by the parsing */
+} ConnectionPathCacheEntry;
+
+static ConnectionPathCacheEntry g_connection_path_cache[
+  OPENER_CONNECTION_PATH_CACHE_SIZE];
+/** Entry replaced next, the cache is filled round robin */
+static size_t g_connection_path_cache_next = 0;
+
+static bool ConnectionPathCacheMatches(
+  const ConnectionPathCacheEntry *const entry,
+  const CipConnectionObject *const connection_object,
+  const EipUint8 *const path,
+  const size_t path_length) {
+  return path_length == entry->path_length &&
+         connection_object->transport_class_trigger ==
+         entry->transport_class_trigger &&
+         ConnectionObjectGetOToTConnectionType(connection_object) ==
+         entry->originator_to_target_connection_type &&
+         ConnectionObjectGetTToOConnectionType(connection_object) ==
+         entry->target_to_originator_connection_type &&
+         0 == memcmp(path, entry->path, path_length);
+}
+
+static const ConnectionPathCacheEntry *ConnectionPathCacheFind(
+  const CipConnectionObject *const connection_object,
+  const EipUint8 *const path,
+  const size_t path_length) {
+  for(size_t i = 0; i < OPENER_CONNECTION_PATH_CACHE_SIZE; ++i) {
+    if(ConnectionPathCacheMatches(&g_connection_path_cache[i],
+                                  connection_object, path, path_length) ) {
+      return &g_connection_path_cache[i];
+    }
+  }
+  return NULL;
+}
+
+/** @brief Set the connection object as the parsing of the cached path did */
+static void ConnectionPathCacheApply(
+  const ConnectionPathCacheEntry *const entry,
+  CipConnectionObject *const connection_object,
+  const EipUint8 *const path) {
+  connection_object->production_inhibit_time = entry->production_inhibit_time;
+  if(entry->has_electronic_key) {
+    connection_object->electronic_key.key_format = 4;
+    connection_object->electronic_key.key_data = NULL;
+  }
+  connection_object->configuration_path = entry->configuration_path;
+  if(kConnectionObjectTransportClassTriggerTransportClass3 ==
+     ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
+  {
+    connection_object->produced_path = entry->produced_path;
+    return;
+  }
+
+  connection_object->consumed_connection_path_length = 0;
+  connection_object->consumed_connection_path = NULL;
+  if(kConnectionObjectConnectionTypeNull !=
+     ConnectionObjectGetOToTConnectionType(connection_object) ) {
+    connection_object->consumed_path = entry->consumed_path;
+  }
+  if(kConnectionObjectConnectionTypeNull !=
+     ConnectionObjectGetTToOConnectionType(connection_object) ) {
+    connection_object->produced_path = entry->produced_path;
+  }
+  g_config_data_length = entry->config_data_length;
+  g_config_data_buffer = (0 != entry->config_data_length) ?
+                         (EipUint8 *) path + entry->config_data_offset : NULL;
+}
+
+static void ConnectionPathCacheStore(
+  const CipConnectionObject *const connection_object,
+  const EipUint8 *const path,
+  const size_t path_length,
+  const EipUint8 *const parsed_end,
+  const bool has_electronic_key) {
+  if(path_length > CONNECTION_PATH_CACHE_MAX_PATH_LENGTH ||
+     parsed_end < path || parsed_end > path + path_length) {
+    return;
+  }
+  const bool io_connection =
+    kConnectionObjectTransportClassTriggerTransportClass3 !=
+    ConnectionObjectGetTransportClassTriggerTransportClass(connection_object);
+  if(io_connection && 0 != g_config_data_length &&
+     (g_config_data_buffer < path ||
+      g_config_data_buffer + g_config_data_length > path + path_length) ) {
+    return;
+  }
+
+  ConnectionPathCacheEntry *const entry =
+    &g_connection_path_cache[g_connection_path_cache_next];
+  g_connection_path_cache_next = (g_connection_path_cache_next + 1) %
+                                 OPENER_CONNECTION_PATH_CACHE_SIZE;
+  memcpy(entry->path, path, path_length);
+  entry->path_length = (EipUint8) path_length;
+  entry->transport_class_trigger = connection_object->transport_class_trigger;
+  entry->originator_to_target_connection_type =
+    (EipUint8) ConnectionObjectGetOToTConnectionType(connection_object);
+  entry->target_to_originator_connection_type =
+    (EipUint8) ConnectionObjectGetTToOConnectionType(connection_object);
+  entry->has_electronic_key = has_electronic_key;
+  entry->production_inhibit_time = connection_object->production_inhibit_time;
+  entry->configuration_path = connection_object->configuration_path;
+  entry->consumed_path = connection_object->consumed_path;
+  entry->produced_path = connection_object->produced_path;
+  entry->config_data_offset = 0;
+  entry->config_data_length = 0;
+  if(io_connection && 0 != g_config_data_length) {
+    entry->config_data_offset = (EipUint8) (g_config_data_buffer - path);
+    entry->config_data_length = (EipUint8) g_config_data_length;
+  }
+  entry->parsed_length = (EipUint8) (parsed_end - path);
+}
+
+#endif /* OPENER_CONNECTION_PATH_CACHE_SIZE > 0 */
+
+void ClearConnectionPathCache(void) {
+#if OPENER_CONNECTION_PATH_CACHE_SIZE > 0
+  memset(g_connection_path_cache, 0, sizeof(g_connection_path_cache) );
+  g_connection_path_cache_next = 0;
+#endif
+}
+
 EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
                              CipMessageRouterRequest *message_router_request,
                              EipUint16 *extended_error) {
+  ForwardOpenTraceStage(kForwardOpenStagePath);
   const EipUint8 *message = message_router_request->data;
   const size_t connection_path_size = GetUsintFromMessage(&message); /* length in words */
   if(0 == connection_path_size) {
@@ -1570,6 +2732,21 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
     return kCipErrorNotEnoughData;
   }
 
+  const EipUint8 *const path = message;
+  const size_t path_length = connection_path_size * sizeof(CipWord);
+  bool has_electronic_key = false;
+#if OPENER_CONNECTION_PATH_CACHE_SIZE > 0
+  /* Originators repeat the same Forward_Open until it succeeds */
+  const ConnectionPathCacheEntry *const cached_path =
+    ConnectionPathCacheFind(connection_object, path, path_length);
+  if(NULL != cached_path) {
+    OPENER_TRACE_INFO("Connection path found in the cache\n");
+    ConnectionPathCacheApply(cached_path, connection_object, path);
+    message_router_request->data = path + cached_path->parsed_length;
+    return kEipStatusOk;
+  }
+#endif
+
   if(remaining_path > 0) {
     /* first look if there is an electronic key */
     if(kSegmentTypeLogicalSegment == GetPathSegmentType(message) ) {
@@ -1587,6 +2764,7 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
             }
             /* Electronic key format 4 found */
             connection_object->electronic_key.key_format = 4;
+            has_electronic_key = true;
             ElectronicKeyFormat4 *electronic_key = ElectronicKeyFormat4New();
             GetElectronicKeyFormat4FromMessage(&message, electronic_key);
             /* logical electronic key found */
@@ -1605,12 +2783,13 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
                                                    electronic_key.key_data),
               ElectronicKeyFormat4GetMinorRevision(connection_object->
                                                    electronic_key.key_data) );
-            if(kEipStatusOk
-               != CheckElectronicKeyData(connection_object->electronic_key.
-                                         key_format,
-                                         connection_object->electronic_key.
-                                         key_data,
-                                         extended_error) ) {
+            ForwardOpenTraceStage(kForwardOpenStageElectronicKey);
+            const EipStatus key_status = CheckElectronicKeyData(
+              connection_object->electronic_key.key_format,
+              connection_object->electronic_key.key_data,
+              extended_error);
+            ForwardOpenTraceStage(kForwardOpenStagePath);
+            if(kEipStatusOk != key_status) {
               ElectronicKeyFormat4Delete(&electronic_key);
               return kCipErrorConnectionFailure;
             }
@@ -1623,30 +2802,35 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
       }
     }
 
+    /* the rest of the path is walked once, segment by segment */
+    CipEpathIterator iterator;
+    CipEpathIteratorInit(&iterator, message, remaining_path * sizeof(CipWord) );
+    CipEpathSegment segment;
+    bool has_segment = CipEpathIteratorPeek(&iterator, &segment);
+
     //TODO: Refactor this afterwards
     if(kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
        ConnectionObjectGetTransportClassTriggerProductionTrigger(
          connection_object) )
     {
       /*non cyclic connections may have a production inhibit */
-      if(kSegmentTypeNetworkSegment == GetPathSegmentType(message) ) {
-        NetworkSegmentSubtype network_segment_subtype =
-          GetPathNetworkSegmentSubtype(message);
-        if(kNetworkSegmentSubtypeProductionInhibitTimeInMilliseconds ==
-           network_segment_subtype) {
-          OPENER_TRACE_INFO("PIT segment available - value: %u\n",message[1]);
-          connection_object->production_inhibit_time = message[1];
-          message += 2;
-          remaining_path -= 1;
-        }
+      if(has_segment &&
+         kSegmentTypeNetworkSegment == segment.info.segment_type &&
+         kNetworkSegmentSubtypeProductionInhibitTimeInMilliseconds ==
+         segment.info.subtype) {
+        OPENER_TRACE_INFO("PIT segment available - value: %u\n",
+                          segment.header[1]);
+        connection_object->production_inhibit_time = segment.header[1];
+        CipEpathIteratorSkip(&iterator, &segment);
+        has_segment = CipEpathIteratorPeek(&iterator, &segment);
       }
     }
 
-    if(kSegmentTypeLogicalSegment == GetPathSegmentType(message) &&
-       kLogicalSegmentLogicalTypeClassId ==
-       GetPathLogicalSegmentLogicalType(message) ) {
+    if(has_segment &&
+       kSegmentTypeLogicalSegment == segment.info.segment_type &&
+       kLogicalSegmentLogicalTypeClassId == segment.info.subtype) {
 
-      class_id = CipEpathGetLogicalValue(&message);
+      class_id = segment.logical_value;
       class = GetCipClass(class_id);
       if(NULL == class) {
         OPENER_TRACE_ERR("classid %" PRIx32 " not found\n",
@@ -1670,13 +2854,14 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
         kConnectionManagerExtendedStatusCodeErrorInvalidSegmentTypeInPath;
       return kCipErrorConnectionFailure;
     }
-    remaining_path -= 1; /* 1 16Bit word for the class part of the path */
+    CipEpathIteratorSkip(&iterator, &segment);
+    has_segment = CipEpathIteratorPeek(&iterator, &segment);
 
     /* Get instance ID */
-    if(kSegmentTypeLogicalSegment == GetPathSegmentType(message) &&
-       kLogicalSegmentLogicalTypeInstanceId ==
-       GetPathLogicalSegmentLogicalType(message) ) { /* store the configuration ID for later checking in the application connection types */
-      const CipDword temp_id = CipEpathGetLogicalValue(&message);
+    if(has_segment &&
+       kSegmentTypeLogicalSegment == segment.info.segment_type &&
+       kLogicalSegmentLogicalTypeInstanceId == segment.info.subtype) { /* store the configuration ID for later checking in the application connection types */
+      const CipDword temp_id = segment.logical_value;
 
       OPENER_TRACE_INFO("Configuration instance id %" PRId32 "\n",
                         temp_id);
@@ -1688,8 +2873,7 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
         return kCipErrorConnectionFailure;
       }
       instance_id = (CipInstanceNum)temp_id;
-      /* 1 or 2 16Bit words for the configuration instance part of the path  */
-      remaining_path -= (instance_id > 0xFF) ? 2 : 1; //TODO: 32 bit case missing
+      CipEpathIteratorSkip(&iterator, &segment);
     } else {
       OPENER_TRACE_INFO("no config data\n");
     }
@@ -1698,7 +2882,7 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
        ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
     {
       /*we have Class 3 connection*/
-      if(remaining_path > 0) {
+      if(0 != CipEpathIteratorRemaining(&iterator) ) {
         OPENER_TRACE_WARN(
           "Too much data in connection path for class 3 connection\n");
         *extended_error =
@@ -1769,15 +2953,15 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
 
       for(size_t i = 0; i < number_of_encoded_paths; i++) /* process up to 2 encoded paths */
       {
-        if(kSegmentTypeLogicalSegment == GetPathSegmentType(message)
-           && (kLogicalSegmentLogicalTypeInstanceId ==
-               GetPathLogicalSegmentLogicalType(message)
+        if(CipEpathIteratorPeek(&iterator, &segment)
+           && kSegmentTypeLogicalSegment == segment.info.segment_type
+           && (kLogicalSegmentLogicalTypeInstanceId == segment.info.subtype
                || kLogicalSegmentLogicalTypeConnectionPoint ==
-               GetPathLogicalSegmentLogicalType(message) ) ) /* Connection Point interpreted as InstanceNr -> only in Assembly Objects */
+               segment.info.subtype) ) /* Connection Point interpreted as InstanceNr -> only in Assembly Objects */
         {   /* Attribute Id or Connection Point */
 
           /* Validate encoded instance number. */
-          const CipDword temp_instance_id = CipEpathGetLogicalValue(&message);
+          const CipDword temp_instance_id = segment.logical_value;
           if (temp_instance_id > kCipInstanceNumMax) {
             *extended_error =
               kConnectionManagerExtendedStatusCodeErrorInvalidSegmentTypeInPath;
@@ -1799,8 +2983,7 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
               kConnectionManagerExtendedStatusCodeInconsistentApplicationPathCombo;
             return kCipErrorConnectionFailure;
           }
-          /* 1 or 2 16Bit word for the connection point part of the path */
-          remaining_path -= (instance_id > 0xFF) ? 2 : 1;
+          CipEpathIteratorSkip(&iterator, &segment);
         } else {
           *extended_error =
             kConnectionManagerExtendedStatusCodeErrorInvalidSegmentTypeInPath;
@@ -1811,19 +2994,19 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
       g_config_data_length = 0;
       g_config_data_buffer = NULL;
 
-      while(remaining_path > 0) { /* remaining_path_size something left in the path should be configuration data */
-
-        SegmentType segment_type = GetPathSegmentType(message);
+      while(0 != CipEpathIteratorRemaining(&iterator) ) { /* something left in the path should be configuration data */
+        /*offset in 16Bit words where within the connection path the error happened*/
+        const EipUint16 error_offset =
+          (EipUint16) ( (iterator.position - path) / sizeof(CipWord) );
+        const SegmentType segment_type =
+          CipEpathIteratorPeek(&iterator, &segment) ?
+          (SegmentType) segment.info.segment_type : kSegmentTypeInvalid;
         switch(segment_type) {
           case kSegmentTypeDataSegment: {
-            DataSegmentSubtype data_segment_type = GetPathDataSegmentSubtype(
-              message);
-            switch(data_segment_type) {
+            switch(segment.info.subtype) {
               case kDataSegmentSubtypeSimpleData:
-                g_config_data_length = message[1] * 2; /*data segments store length 16-bit word wise */
-                g_config_data_buffer = (EipUint8 *) message + 2;
-                remaining_path -= (g_config_data_length + 2) / 2;
-                message += (g_config_data_length + 2);
+                g_config_data_length = segment.length - 2; /*data segments store length 16-bit word wise */
+                g_config_data_buffer = (EipUint8 *) segment.header + 2;
                 break;
               default:
                 OPENER_TRACE_ERR("Not allowed in connection manager");
@@ -1832,19 +3015,16 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
           }
           break;
           case kSegmentTypeNetworkSegment: {
-            NetworkSegmentSubtype subtype =
-              GetPathNetworkSegmentSubtype(message);
-            switch(subtype) {
+            switch(segment.info.subtype) {
               case kNetworkSegmentSubtypeProductionInhibitTimeInMilliseconds:
                 if(kConnectionObjectTransportClassTriggerProductionTriggerCyclic
                    != ConnectionObjectGetTransportClassTriggerProductionTrigger(
                      connection_object) ) {
                   /* only non cyclic connections may have a production inhibit */
-                  connection_object->production_inhibit_time = message[1];
-                  message += 2;
-                  remaining_path -= 2;
+                  connection_object->production_inhibit_time =
+                    segment.header[1];
                 } else {
-                  *extended_error = connection_path_size - remaining_path; /*offset in 16Bit words where within the connection path the error happened*/
+                  *extended_error = error_offset;
                   return kCipErrorPathSegmentError; /*status code for invalid segment type*/
                 }
                 break;
@@ -1858,25 +3038,248 @@ EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
           default:
             OPENER_TRACE_WARN(
               "No data segment identifier found for the configuration data\n");
-            *extended_error = connection_path_size - remaining_path; /*offset in 16Bit words where within the connection path the error happened*/
+            *extended_error = error_offset;
             return
               kConnectionManagerGeneralStatusPathSegmentErrorInUnconnectedSend;
         }
+        CipEpathIteratorSkip(&iterator, &segment);
       }
     }
+    /*the position after the parsed part of the path*/
+    message = iterator.position;
   }
 
   OPENER_TRACE_INFO("Resulting PIT value: %u\n",
                     connection_object->production_inhibit_time);
+#if OPENER_CONNECTION_PATH_CACHE_SIZE > 0
+  ConnectionPathCacheStore(connection_object, path, path_length, message,
+                           has_electronic_key);
+#else
+  (void) path;
+  (void) path_length;
+  (void) has_electronic_key;
+#endif
   /*save back the current position in the stream allowing followers to parse anything thats still there*/
   message_router_request->data = message;
   return kEipStatusOk;
 }
 
+#ifndef OPENER_PRODUCTION_PHASE_SLOTS
+/** Phase slots the RPI of a new cyclic connection is divided into when its
+ * first production is staggered against the other connections, 0 produces
+ * right away */
+#define OPENER_PRODUCTION_PHASE_SLOTS 64
+#endif
+
+#ifndef OPENER_PRODUCTION_PHASE_RESOLUTION_US
+/** Narrowest phase slot, the resolution at which productions are sent */
+#define OPENER_PRODUCTION_PHASE_RESOLUTION_US \
+  ( (MicroSeconds) kOpenerTimerTickInMilliSeconds * 1000U)
+#endif
+
+#if OPENER_PRODUCTION_PHASE_SLOTS > 0
+
+/** @brief One RPI of a connection divided into phase slots, with the number
+ * of productions of the other connections falling into each slot
+ */
+typedef struct {
+  MicroSeconds start; /**< beginning of slot 0 */
+  MicroSeconds slot_width;
+  size_t slot_count;
+  unsigned int load[OPENER_PRODUCTION_PHASE_SLOTS];
+} ProductionPhaseWindow;
+
+/** @brief Connections producing at their RPI, the heartbeat of change of
+ * state connections included
+ */
+static bool ConnectionProducesPeriodically(
+  const CipConnectionObject *const connection_object) {
+  return kConnectionObjectStateEstablished ==
+         ConnectionObjectGetState(connection_object) &&
+         0 != connection_object->t_to_o_requested_packet_interval &&
+         kEipInvalidSocket !=
+         connection_object->socket[kUdpCommuncationDirectionProducing];
+}
+
+/** @brief Connections whose production phase may be chosen freely */
+static bool ConnectionProducesCyclically(
+  const CipConnectionObject *const connection_object) {
+  return ConnectionProducesPeriodically(connection_object) &&
+         kConnectionObjectTransportClassTriggerProductionTriggerCyclic ==
+         ConnectionObjectGetTransportClassTriggerProductionTrigger(
+    connection_object);
+}
+
+static void ProductionPhaseWindowAdd(ProductionPhaseWindow *const window,
+                                     const CipConnectionObject *const producer)
+{
+  const MicroSeconds interval = producer->t_to_o_requested_packet_interval;
+  if(interval <= window->slot_width) {
+    /* produces in every slot */
+    for(size_t slot = 0; slot < window->slot_count; ++slot) {
+      window->load[slot]++;
+    }
+    return;
+  }
+  const MicroSeconds end = window->start +
+                           window->slot_width * window->slot_count;
+  MicroSeconds production = producer->transmission_trigger_timer;
+  if(production < window->start) {
+    /* skip the productions before the window, keeping the phase */
+    production += (window->start - production + interval - 1) / interval *
+                  interval;
+  }
+  for(; production < end; production += interval) {
+    window->load[(production - window->start) / window->slot_width]++;
+  }
+}
+
+/** @brief Divide the RPI of a connection starting at start into phase slots
+ * and count the productions of all other connections in them
+ *
+ * @return false if the RPI is too short to be divided
+ */
+static bool ProductionPhaseWindowFill(
+  ProductionPhaseWindow *const window,
+  const MicroSeconds start,
+  const CipConnectionObject *const connection_object) {
+  const MicroSeconds interval =
+    connection_object->t_to_o_requested_packet_interval;
+  *window = (ProductionPhaseWindow) {
+    .start = start,
+    .slot_width = interval / OPENER_PRODUCTION_PHASE_SLOTS
+  };
+  if(window->slot_width < OPENER_PRODUCTION_PHASE_RESOLUTION_US) {
+    window->slot_width = OPENER_PRODUCTION_PHASE_RESOLUTION_US;
+  }
+  window->slot_count = interval / window->slot_width;
+  if(window->slot_count < 2) {
+    return false;
+  }
+  for(const DoublyLinkedListNode *node = connection_list.first; NULL != node;
+      node = node->next) {
+    const CipConnectionObject *const other = node->data;
+    if(other != connection_object && ConnectionProducesPeriodically(other) ) {
+      ProductionPhaseWindowAdd(window, other);
+    }
+  }
+  return true;
+}
+
+/** @brief Least loaded slot of a window, among equally loaded slots the one
+ * farthest away from the more loaded ones
+ */
+static size_t ProductionPhaseWindowBestSlot(
+  const ProductionPhaseWindow *const window) {
+  unsigned int minimum_load = window->load[0];
+  for(size_t slot = 1; slot < window->slot_count; ++slot) {
+    if(window->load[slot] < minimum_load) {
+      minimum_load = window->load[slot];
+    }
+  }
+  size_t best_slot = 0;
+  size_t best_distance = 0;
+  for(size_t slot = 0; slot < window->slot_count; ++slot) {
+    if(window->load[slot] != minimum_load) {
+      continue;
+    }
+    size_t distance = window->slot_count; /* no loaded slot at all */
+    for(size_t other = 0; other < window->slot_count; ++other) {
+      if(window->load[other] > minimum_load) {
+        size_t other_distance = (other > slot) ? other - slot : slot - other;
+        if(window->slot_count - other_distance < other_distance) {
+          other_distance = window->slot_count - other_distance; /* wraps */
+        }
+        if(other_distance < distance) {
+          distance = other_distance;
+        }
+      }
+    }
+    if(distance > best_distance) {
+      best_slot = slot;
+      best_distance = distance;
+    }
+  }
+  return best_slot;
+}
+
+/** @brief Stagger the first production of a new cyclic connection within
+ * its RPI against the productions of the established connections
+ *
+ * Connections sharing a RPI would otherwise all produce in the same tick
+ * and send their packets in one burst.
+ */
+static void ConnectionAssignProductionPhase(
+  CipConnectionObject *const connection_object) {
+  if(!ConnectionProducesCyclically(connection_object) ) {
+    return; /* change of state and application triggered produce right away */
+  }
+  ProductionPhaseWindow window;
+  if(ProductionPhaseWindowFill(&window, ConnectionManagerGetTime(),
+                               connection_object) ) {
+    connection_object->transmission_trigger_timer = window.start +
+                                                    window.slot_width *
+                                                    ProductionPhaseWindowBestSlot(
+      &window);
+  }
+}
+
+/** @brief Move the cyclic connection that gains the most to a less loaded
+ * phase after a producing connection closed
+ *
+ * At most one connection is moved. Its next production is delayed by less
+ * than one RPI, well within the connection timeout of at least four RPIs.
+ */
+static void ConnectionRebalanceProductionPhases(void) {
+  const MicroSeconds now = ConnectionManagerGetTime();
+  CipConnectionObject *moved_connection = NULL;
+  MicroSeconds moved_production = 0;
+  unsigned int best_gain = 0;
+  for(const DoublyLinkedListNode *node = connection_list.first; NULL != node;
+      node = node->next) {
+    CipConnectionObject *const connection_object = node->data;
+    if(!ConnectionProducesCyclically(connection_object) ) {
+      continue;
+    }
+    /* slot 0 is the next production of the connection */
+    const MicroSeconds start =
+      (connection_object->transmission_trigger_timer > now) ?
+      connection_object->transmission_trigger_timer : now;
+    ProductionPhaseWindow window;
+    if(!ProductionPhaseWindowFill(&window, start, connection_object) ) {
+      continue;
+    }
+    const size_t slot = ProductionPhaseWindowBestSlot(&window);
+    if(window.load[0] > window.load[slot] &&
+       window.load[0] - window.load[slot] > best_gain) {
+      best_gain = window.load[0] - window.load[slot];
+      moved_connection = connection_object;
+      moved_production = start + window.slot_width * slot;
+    }
+  }
+  if(NULL != moved_connection) {
+    OPENER_TRACE_INFO("moving production of ConnNr: %u by %" PRIu64 " us\n",
+                      moved_connection->connection_serial_number,
+                      (uint64_t) (moved_production -
+                                  moved_connection->transmission_trigger_timer) );
+    moved_connection->transmission_trigger_timer = moved_production;
+    ConnectionManagerRescheduleConnection(moved_connection);
+  }
+}
+
+#endif /* OPENER_PRODUCTION_PHASE_SLOTS > 0 */
+
 void CloseConnection(CipConnectionObject *RESTRICT connection_object) {
 
   OPENER_TRACE_INFO("cipconnectionmanager: CloseConnection, trigger: %d \n",
   	ConnectionObjectGetTransportClassTriggerTransportClass(connection_object));
+#if OPENER_PRODUCTION_PHASE_SLOTS > 0
+  /* timed out connections have stopped producing but still left a gap */
+  const bool was_producing =
+    0 != connection_object->t_to_o_requested_packet_interval &&
+    kEipInvalidSocket !=
+    connection_object->socket[kUdpCommuncationDirectionProducing];
+#endif
 
   if(kConnectionObjectTransportClassTriggerTransportClass3 !=
      ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
@@ -1891,42 +3294,157 @@ void CloseConnection(CipConnectionObject *RESTRICT connection_object) {
   }
   RemoveFromActiveConnections(connection_object);
   ConnectionObjectInitializeEmpty(connection_object);
-
+#if OPENER_PRODUCTION_PHASE_SLOTS > 0
+  if(was_producing) {
+    ConnectionRebalanceProductionPhases();
+  }
+#endif
 }
 
 void AddNewActiveConnection(CipConnectionObject *const connection_object) {
   DoublyLinkedListInsertAtHead(&connection_list, connection_object);
+  connection_object->active_list_node = connection_list.first;
+  ConnectionIndexInsert(&g_connection_id_index, connection_object);
+  ConnectionIndexInsert(&g_connection_triad_index, connection_object);
+  if(ConnectionObjectIsTypeIOConnection(connection_object) ) {
+    ConnectionIndexInsert(&g_produced_instance_index, connection_object);
+    ConnectionIndexInsert(&g_consumed_instance_index, connection_object);
+  }
   ConnectionObjectSetState(connection_object,
                            kConnectionObjectStateEstablished);
+  OPENER_TRACE_EVENT(kTraceEventConnectionOpen,
+                     connection_object->connection_serial_number,
+                     connection_object->o_to_t_requested_packet_interval,
+                     connection_object->t_to_o_requested_packet_interval);
+  connection_object->production_count = 0;
+  connection_object->production_interval_average = 0;
+  connection_object->production_interval_maximum = 0;
+  connection_object->multicast_consumer_count = 0;
+#if OPENER_PRODUCTION_PHASE_SLOTS > 0
+  ConnectionAssignProductionPhase(connection_object);
+#endif
+  ConnectionDeadlineQueueInsert(connection_object);
 }
 
-void RemoveFromActiveConnections(CipConnectionObject *const connection_object) {
-  for(DoublyLinkedListNode *iterator = connection_list.first; iterator != NULL;
-      iterator = iterator->next) {
-    if(iterator->data == connection_object) {
-      DoublyLinkedListRemoveNode(&connection_list, &iterator);
-      return;
+size_t GetConnectionProductionStatistics(
+  ConnectionProductionStatistics *const statistics,
+  const size_t max_entries) {
+  size_t entries = 0;
+  for(const DoublyLinkedListNode *node = connection_list.first;
+      NULL != node && entries < max_entries; node = node->next) {
+    const CipConnectionObject *const connection_object = node->data;
+    if(0 == connection_object->production_count) {
+      continue; /* not producing, e.g. explicit or listen only */
     }
-  } OPENER_TRACE_ERR("Connection not found in active connection list\n");
+    statistics[entries++] = (ConnectionProductionStatistics) {
+      .connection_serial_number = connection_object->connection_serial_number,
+      .produced_connection_id = connection_object->cip_produced_connection_id,
+      .requested_packet_interval =
+        connection_object->t_to_o_requested_packet_interval,
+      .achieved_packet_interval_average =
+        connection_object->production_interval_average,
+      .achieved_packet_interval_maximum =
+        connection_object->production_interval_maximum,
+      .production_count = connection_object->production_count,
+      .consumer_count =
+        (kConnectionObjectConnectionTypeMulticast ==
+         ConnectionObjectGetTToOConnectionType(connection_object) ) ?
+        connection_object->multicast_consumer_count : 1
+    };
+  }
+  return entries;
 }
 
-EipBool8 IsConnectedOutputAssembly(const CipInstanceNum instance_number) {
-  EipBool8 is_connected = false;
+void ConnectionManagerGetProductionCounts(CipUdint *const productions,
+                                          CipUdint *const late_productions) {
+  *productions = g_productions;
+  *late_productions = g_late_productions;
+}
 
-  DoublyLinkedListNode *node = connection_list.first;
+void GetMulticastProductionStatistics(
+  MulticastProductionStatistics *const statistics) {
+  *statistics = (MulticastProductionStatistics) {
+    .packets_produced = g_multicast_packets_produced,
+    .packets_saved = g_multicast_packets_saved
+  };
+  for(const DoublyLinkedListNode *node = connection_list.first; NULL != node;
+      node = node->next) {
+    const CipConnectionObject *const connection_object = node->data;
+    if(kConnectionObjectConnectionTypeMulticast ==
+       ConnectionObjectGetTToOConnectionType(connection_object)
+       && kEipInvalidSocket !=
+       connection_object->socket[kUdpCommuncationDirectionProducing]) {
+      statistics->producers++;
+      statistics->consumers += connection_object->multicast_consumer_count;
+    }
+  }
+}
 
-  while(NULL != node) {
-    CipConnectionObject *connection_object = (CipConnectionObject *) node->data;
-    CipDword consumed_connection_point =
-      connection_object->consumed_path.instance_id;
-    if(instance_number == consumed_connection_point &&
-       true == ConnectionObjectIsTypeIOConnection(connection_object) ) {
-      is_connected = true;
-      break;
+void RemoveFromActiveConnections(CipConnectionObject *const connection_object) {
+  OPENER_TRACE_EVENT(kTraceEventConnectionClose,
+                     connection_object->connection_serial_number, 0, 0);
+  ConnectionIndexRemove(&g_connection_id_index, connection_object);
+  ConnectionIndexRemove(&g_connection_triad_index, connection_object);
+  ConnectionIndexRemove(&g_produced_instance_index, connection_object);
+  ConnectionIndexRemove(&g_consumed_instance_index, connection_object);
+  ConnectionDeadlineQueueRemove(connection_object);
+  if(NULL != connection_object->active_list_node) {
+    DoublyLinkedListRemoveNode(&connection_list,
+                               &connection_object->active_list_node);
+  } else if(!g_active_connections_detached) {
+    OPENER_TRACE_ERR("Connection not found in active connection list\n");
+  }
+}
+
+/** @brief Empty the connection indexes and the deadline queue */
+static void ClearActiveConnectionLookups(void) {
+  memset(g_connection_id_index.slots, 0, sizeof(g_connection_id_index.slots) );
+  memset(g_connection_triad_index.slots, 0,
+         sizeof(g_connection_triad_index.slots) );
+  memset(g_produced_instance_index.slots, 0,
+         sizeof(g_produced_instance_index.slots) );
+  memset(g_consumed_instance_index.slots, 0,
+         sizeof(g_consumed_instance_index.slots) );
+  memset(g_connection_deadline_queue, 0, sizeof(g_connection_deadline_queue) );
+  g_connection_deadline_queue_size = 0;
+}
+
+void DetachActiveConnections(DoublyLinkedList *const detached) {
+  *detached = connection_list;
+  connection_list.first = NULL;
+  connection_list.last = NULL;
+  for(const DoublyLinkedListNode *node = detached->first; NULL != node;
+      node = node->next) {
+    ( (CipConnectionObject *) node->data )->active_list_node = NULL;
+  }
+  ClearActiveConnectionLookups();
+  g_active_connections_detached = true;
+}
+
+void ReleaseDetachedConnections(DoublyLinkedList *const detached) {
+  DoublyLinkedListDestroy(detached);
+  g_active_connections_detached = false;
+}
+
+EipBool8 IsConnectedOutputAssembly(const CipInstanceNum instance_number) {
+  ConnectionIndexIterator iterator;
+  ConnectionIndexIteratorBegin(&iterator, instance_number);
+  return NULL != ConnectionIndexIteratorNext(&g_consumed_instance_index,
+                                             &iterator);
+}
+
+EipBool8 IsIoConnectionOriginator(const CipUdint address) {
+  for(const DoublyLinkedListNode *node = connection_list.first; NULL != node;
+      node = node->next) {
+    const CipConnectionObject *const connection_object = node->data;
+    if(kConnectionObjectStateEstablished ==
+       ConnectionObjectGetState(connection_object) &&
+       ConnectionObjectIsTypeIOConnection(connection_object) &&
+       address == connection_object->originator_address.sin_addr.s_addr) {
+      return true;
     }
-    node = node->next;
   }
-  return is_connected;
+  return false;
 }
 
 EipStatus AddConnectableObject(const CipUdint class_code,
@@ -1972,16 +3490,25 @@ EipStatus TriggerConnections(unsigned int output_assembly,
     CipConnectionObject *connection_object = node->data;
     if( (output_assembly == connection_object->consumed_path.instance_id) &&
         (input_assembly == connection_object->produced_path.instance_id) ) {
-      if(
-        kConnectionObjectTransportClassTriggerProductionTriggerApplicationObject
-        == ConnectionObjectGetTransportClassTriggerProductionTrigger(
-          connection_object) ) {
-        /* produce at the next allowed occurrence */
-        connection_object->transmission_trigger_timer =
-          connection_object->production_inhibit_time;
+      ConnectionObjectTransportClassTriggerProductionTrigger trigger =
+        ConnectionObjectGetTransportClassTriggerProductionTrigger(
+          connection_object);
+      if( (kConnectionObjectTransportClassTriggerProductionTriggerApplicationObject
+           == trigger) ||
+          (kConnectionObjectTransportClassTriggerProductionTriggerChangeOfState
+           == trigger) ) {
+        /* produce at the next allowed occurrence, i.e. as soon as the
+         * production inhibit timer has expired */
+        if(connection_object->production_inhibit_timer <
+           connection_object->transmission_trigger_timer) {
+          connection_object->transmission_trigger_timer =
+            connection_object->production_inhibit_timer;
+          ConnectionManagerRescheduleConnection(connection_object);
+        }
         status = kEipStatusOk;
       }
-      break;
+      /* keep searching, input only and listen only connections may share
+       * the same connection points */
     }
     node = node->next;
   }
@@ -2016,8 +3543,10 @@ void InitializeConnectionManagerData() {
   memset(g_connection_management_list,
          0,
          g_kNumberOfConnectableObjects * sizeof(ConnectionManagementHandling) );
+  ClearActiveConnectionLookups();
   InitializeClass3ConnectionData();
   InitializeIoConnectionData();
+  ClearConnectionPathCache();
   
   /* Initialize buffer sizes */
   /* Estimate based on typical EtherNet/IP buffer requirements */
@@ -12,6 +12,11 @@
 #include "ciptypes.h"
 #include "cipconnectionobject.h"
 
+#ifndef OPENER_FORWARD_OPEN_TRACE_ENTRIES
+/** Last Forward Opens whose stage times are kept, 0 leaves the trace out */
+#define OPENER_FORWARD_OPEN_TRACE_ENTRIES 8
+#endif
+
 /**
  * @brief Connection Type constants of the Forward Open service request
  *   Indicates either a
@@ -140,6 +145,14 @@ typedef enum {
   kConnectionManagerExtendedStatusWrongCloser = 0xFFFF /* No a real extended error code, but needed for forward close */
 } ConnectionManagerExtendedStatusCode;
 
+/** @brief Acceptable RPI types of the RPI values not acceptable status, Vol.1 Table 3-5.33 */
+typedef enum {
+  kConnectionManagerRpiTypeAcceptable = 0, /**< the requested RPI is acceptable */
+  kConnectionManagerRpiTypeMinimum = 2, /**< the requested RPI is too fast, the given one is the minimum */
+  kConnectionManagerRpiTypeMaximum = 3, /**< the requested RPI is too slow, the given one is the maximum */
+  kConnectionManagerRpiTypeRequired = 4 /**< only the given RPI is accepted */
+} ConnectionManagerRpiType;
+
 /** @brief macros for comparing sequence numbers according to CIP spec vol
  * 2 3-4.2 for int type variables
  * @def SEQ_LEQ32(a, b) Checks if sequence number a is less or equal than b
@@ -189,6 +202,33 @@ CipConnectionObject *GetConnectedObject(const EipUint32 connection_id);
 CipConnectionObject *GetConnectedOutputAssembly(
   const EipUint32 output_assembly_id);
 
+/** @brief Position of a lookup in an index of the active connections */
+typedef struct {
+  CipUdint key;
+  size_t slot;
+  size_t probe;
+} ConnectionIndexIterator;
+
+/** @brief Start walking the active I/O connections producing an assembly
+ *
+ * The connections are indexed when they are added to and removed from the
+ * active connections, a lookup does not depend on the number of other
+ * connections. Connections must not be added or removed during a walk.
+ *
+ * @param iterator iterator to initialize
+ * @param instance_id assembly instance of the produced path
+ */
+void ProducedInstanceIteratorBegin(ConnectionIndexIterator *const iterator,
+                                   const CipUdint instance_id);
+
+/** @brief Next active I/O connection producing the assembly, in any state
+ *
+ * @param iterator iterator set up by ProducedInstanceIteratorBegin()
+ * @return the connection, NULL once all were returned
+ */
+CipConnectionObject *ProducedInstanceIteratorNext(
+  ConnectionIndexIterator *const iterator);
+
 /** @brief Close the given connection
  *
  * This function will take the data form the connection and correctly closes the
@@ -198,9 +238,20 @@ CipConnectionObject *GetConnectedOutputAssembly(
  */
 void CloseConnection(CipConnectionObject *RESTRICT connection_object);
 
-/* TODO: Missing documentation */
+/** @brief Check if an active I/O connection consumes an assembly instance
+ *
+ * @param instance_number assembly instance of the consumed path
+ * @return true if a connection in any state consumes it
+ */
 EipBool8 IsConnectedOutputAssembly(const CipInstanceNum instance_number);
 
+/** @brief Check if an originator has an established I/O connection
+ *
+ * @param address IP address of the originator, network byte order
+ * @return true if an established I/O connection was opened from @p address
+ */
+EipBool8 IsIoConnectionOriginator(const CipUdint address);
+
 /** @brief Insert the given connection object to the list of currently active
  *  and managed connections.
  *
@@ -218,6 +269,182 @@ void AddNewActiveConnection(CipConnectionObject *const connection_object);
  */
 void RemoveFromActiveConnections(CipConnectionObject *const connection_object);
 
+/** @brief Take all connections off the active connection list at once
+ *
+ * Empties the list, the connection indexes and the deadline queue in one
+ * step for CloseAllConnections(). The connections are still open; their
+ * close functions then only release their own resources, removing them from
+ * the active connections is a no-op.
+ *
+ * @param detached receives the former list, hand it to
+ *   ReleaseDetachedConnections() once its connections are closed
+ */
+void DetachActiveConnections(DoublyLinkedList *const detached);
+
+/** @brief Free the nodes of a list taken by DetachActiveConnections()
+ *
+ * @param detached the list, empty afterwards
+ */
+void ReleaseDetachedConnections(DoublyLinkedList *const detached);
+
+/** @brief Current connection manager time in microseconds
+ *
+ * Time base of the absolute deadlines held in the connection timer fields.
+ * It is the platform's GetMicroSeconds() latched when connection timers are
+ * managed and when connected data is received.
+ */
+MicroSeconds ConnectionManagerGetTime(void);
+
+/** @brief Earliest watchdog or transmission deadline of all active connections
+ *
+ * @return deadline on the ConnectionManagerGetTime() time base, UINT64_MAX if
+ *         no connection has a pending deadline
+ */
+MicroSeconds GetNextConnectionDeadline(void);
+
+/** @brief Handle all connection deadlines that expired by now
+ *
+ * Produces data for connections whose RPI deadline was reached and performs
+ * the watchdog timeout actions. Called by ManageConnections(); a platform with
+ * a high resolution timer may additionally call it at
+ * GetNextConnectionDeadline() to produce independent of the timer tick.
+ */
+void ManageConnectionTimers(void);
+
+/** @brief Achieved versus requested production interval of a connection */
+typedef struct {
+  CipUint connection_serial_number;
+  CipUdint produced_connection_id;
+  CipUdint requested_packet_interval; /**< T->O RPI in microseconds */
+  CipUdint achieved_packet_interval_average; /**< moving average in microseconds */
+  CipUdint achieved_packet_interval_maximum; /**< worst interval in microseconds */
+  CipUdint production_count; /**< frames produced since the connection opened */
+  CipUint consumer_count; /**< connections served by the production, more than one if shared by multicast */
+} ConnectionProductionStatistics;
+
+/** @brief Get the production timing of all producing active connections
+ *
+ * @param statistics Array receiving one entry per producing connection
+ * @param max_entries Number of entries in @p statistics
+ * @return Number of entries written
+ */
+size_t GetConnectionProductionStatistics(
+  ConnectionProductionStatistics *const statistics,
+  const size_t max_entries);
+
+/** @brief Sharing of the multicast T->O productions */
+typedef struct {
+  CipUint producers; /**< active multicast productions */
+  CipUint consumers; /**< established connections served by them */
+  CipUdint packets_produced; /**< frames sent by multicast productions */
+  CipUdint packets_saved; /**< frames separate productions for every consumer would have sent in addition */
+} MulticastProductionStatistics;
+
+/** @brief Get how many consumers share the multicast productions
+ *
+ * @param statistics Receives the current statistics
+ */
+void GetMulticastProductionStatistics(
+  MulticastProductionStatistics *const statistics);
+
+/** @brief Stages of a Forward Open, see ForwardOpenTraceStage()
+ *
+ * Each stage is timed without the stages nested in it, so the stage times
+ * of a Forward Open add up to its total.
+ */
+typedef enum {
+  kForwardOpenStageRequest, /**< decoding and the checks of ForwardOpenRoutine() */
+  kForwardOpenStagePath, /**< ParseConnectionPath() without the key check */
+  kForwardOpenStageElectronicKey, /**< CheckElectronicKeyData() */
+  kForwardOpenStageAdmission, /**< ConnectionAdmissionCheck() */
+  kForwardOpenStageEstablish, /**< open connection function, e.g. EstablishIoConnection() */
+  kForwardOpenStageChannels, /**< OpenCommunicationChannels(): sockets and multicast joins */
+  kForwardOpenStageResponse, /**< AssembleForwardOpenResponse() */
+  kForwardOpenStageCount
+} ForwardOpenStage;
+
+/** @brief Stage times of one Forward Open */
+typedef struct {
+  CipUdint sequence; /**< Forward Opens before this one since start up */
+  MicroSeconds received; /**< GetMicroSeconds() when processing began */
+  CipUdint total_us;
+  CipUdint stage_us[kForwardOpenStageCount];
+  CipUint connection_serial_number;
+  CipUint originator_vendor_id;
+  CipUdint originator_serial_number;
+  CipUsint general_status; /**< of the response, 0 for an opened connection */
+  CipUint extended_status;
+  EipBool8 large; /**< Large_Forward_Open */
+} ForwardOpenTrace;
+
+/** @brief Charge the time since the last stage change to the current stage
+ * and continue with @p stage
+ *
+ * Only has an effect while a Forward Open is processed. A nested stage
+ * switches back to its parent when it ends.
+ *
+ * @param stage the stage starting now
+ */
+void ForwardOpenTraceStage(const ForwardOpenStage stage);
+
+/** @brief Copy one of the last OPENER_FORWARD_OPEN_TRACE_ENTRIES Forward Opens
+ *
+ * Has to be called with the stack lock held.
+ *
+ * @param index 0 for the latest, counting back
+ * @param trace Receives the stage times
+ * @return false if fewer Forward Opens were received
+ */
+bool GetForwardOpenTrace(const size_t index, ForwardOpenTrace *const trace);
+
+/** @brief Count the timer driven productions since start up
+ *
+ * A production more than one RPI late restarts the production phase of its
+ * connection. Has to be called with the stack lock held.
+ *
+ * @param productions Receives the number of productions
+ * @param late_productions Receives how many of them came more than one timer
+ *        tick after max(RPI, tick) since the previous production of their
+ *        connection
+ */
+void ConnectionManagerGetProductionCounts(CipUdint *const productions,
+                                          CipUdint *const late_productions);
+
+/** @brief Update the position of an active connection in the deadline queue
+ *
+ * Has to be called whenever a timer deadline, the state or the producing
+ * socket of an active connection changes. Connections that are not in the
+ * active connection list are ignored.
+ *
+ * @param connection_object Connection whose deadlines changed
+ */
+void ConnectionManagerRescheduleConnection(
+  CipConnectionObject *const connection_object);
+
+
+/** @brief Parse the connection path of a forward open request
+ *
+ * This function will take the connection object and the received data stream and parse the connection path.
+ * @param connection_object pointer to the connection object structure for which the connection should
+ *                      be established
+ * @param message_router_request pointer to the received request structure. The position of the data stream pointer has to be at the connection length entry
+ * @param extended_error the extended error code in case an error happened
+ * @return general status on the establishment
+ *    - kEipStatusOk ... on success
+ *    - On an error the general status code to be put into the response
+ */
+EipUint8 ParseConnectionPath(CipConnectionObject *connection_object,
+                             CipMessageRouterRequest *message_router_request,
+                             EipUint16 *extended_error);
+
+/** @brief Forget the connection paths ParseConnectionPath() has cached
+ *
+ * Successfully parsed paths are kept, keyed by their raw bytes and the
+ * transport class and connection types, so a repeated Forward_Open skips the
+ * segment decoding and the electronic key check. The cache is cleared when
+ * the connection manager is initialized.
+ */
+void ClearConnectionPathCache(void);
 
 CipUdint GetConnectionId(void);
 
@@ -60,28 +60,27 @@ DoublyLinkedList connection_list;
 CipConnectionObject explicit_connection_object_pool[
   OPENER_CIP_NUM_EXPLICIT_CONNS];
 
+/** @brief Node storage for the connection list, one node per connection */
+static DoublyLinkedListNode connection_list_nodes[OPENER_CIP_NUM_ACTIVE_CONNS];
+
+static BlockPool connection_list_node_pool;
+
 DoublyLinkedListNode *CipConnectionObjectListArrayAllocator() {
-  enum {
-    kNodesAmount = OPENER_CIP_NUM_EXPLICIT_CONNS +
-                   OPENER_CIP_NUM_INPUT_ONLY_CONNS +
-                   OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS +
-                   OPENER_CIP_NUM_LISTEN_ONLY_CONNS
-  };
-  static DoublyLinkedListNode nodes[kNodesAmount] = { 0 };
-  for(size_t i = 0; i < kNodesAmount; ++i) {
-    if(nodes[i].previous == NULL && nodes[i].next == NULL &&
-       nodes[i].data == NULL) {
-      return &nodes[i];
-    }
+  if(!BlockPoolIsInitialized(&connection_list_node_pool) ) {
+    BlockPoolInitialize(&connection_list_node_pool,
+                        connection_list_nodes,
+                        sizeof(connection_list_nodes[0]),
+                        sizeof(connection_list_nodes) /
+                        sizeof(connection_list_nodes[0]) );
   }
-  return NULL;
+  return BlockPoolAllocate(&connection_list_node_pool);
 }
 
 void CipConnectionObjectListArrayFree(DoublyLinkedListNode **node) {
 
   if(NULL != node) {
     if(NULL != *node) {
-      memset(*node, 0, sizeof(DoublyLinkedListNode) );
+      BlockPoolFree(&connection_list_node_pool, *node);
       *node = NULL;
     } else {
       OPENER_TRACE_ERR("Attempt to delete NULL pointer to node\n");
@@ -92,6 +91,10 @@ void CipConnectionObjectListArrayFree(DoublyLinkedListNode **node) {
 
 }
 
+const BlockPool *CipConnectionObjectListNodePool(void) {
+  return &connection_list_node_pool;
+}
+
 /* Private methods declaration */
 uint64_t ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
   const CipConnectionObject *const connection_object);
@@ -588,24 +591,32 @@ void ConnectionObjectSetInitialInactivityWatchdogTimerValue(
   const uint64_t calculated_timeout_value =
     ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
       connection_object);
-  connection_object->inactivity_watchdog_timer =
+  const uint64_t timeout_value =
     (calculated_timeout_value >
      kMinimumInitialTimeoutValue) ? calculated_timeout_value :
     kMinimumInitialTimeoutValue;
+  connection_object->inactivity_watchdog_timer = ConnectionManagerGetTime() +
+                                                timeout_value * 1000;
+  ConnectionManagerRescheduleConnection(connection_object);
 }
 
 void ConnectionObjectResetInactivityWatchdogTimerValue(
   CipConnectionObject *const connection_object) {
-  connection_object->inactivity_watchdog_timer =
+  const uint64_t timeout_value =
     ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
       connection_object);
+  connection_object->inactivity_watchdog_timer = ConnectionManagerGetTime() +
+                                                timeout_value * 1000;
+  ConnectionManagerRescheduleConnection(connection_object);
 }
 
 void ConnectionObjectResetLastPackageInactivityTimerValue(
   CipConnectionObject *const connection_object) {
-  connection_object->last_package_watchdog_timer =
+  const uint64_t timeout_value =
     ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
       connection_object);
+  connection_object->last_package_watchdog_timer = ConnectionManagerGetTime() +
+                                                  timeout_value * 1000;
 }
 
 uint64_t ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
@@ -903,6 +914,13 @@ void ConnectionObjectDeepCopy(
   const CipConnectionObject *RESTRICT const source
   ) {
   memcpy( destination, source, sizeof(CipConnectionObject) );
+  /* the cached reply must not keep pointing into the source object */
+  PrepareENIPMessage(&destination->last_reply_sent);
+  if(source->last_reply_sent.message_buffer ==
+     source->last_reply_sent.inline_buffer) {
+    (void)ENIPMessageCopy(&destination->last_reply_sent,
+                          &source->last_reply_sent);
+  }
 }
 
 void ConnectionObjectResetSequenceCounts(
@@ -916,8 +934,9 @@ void ConnectionObjectResetSequenceCounts(
 
 void ConnectionObjectResetProductionInhibitTimer(
   CipConnectionObject *const connection_object) {
-  connection_object->production_inhibit_timer =
-    connection_object->production_inhibit_time;
+  connection_object->production_inhibit_timer = ConnectionManagerGetTime() +
+                                               (uint64_t) connection_object->
+                                               production_inhibit_time * 1000;
 }
 
 void ConnectionObjectGeneralConfiguration(
@@ -951,7 +970,7 @@ void ConnectionObjectGeneralConfiguration(
 
   ConnectionObjectResetProductionInhibitTimer(connection_object);
 
-  connection_object->transmission_trigger_timer = 0;
+  connection_object->transmission_trigger_timer = 0; /* produce right away */
 }
 
 bool ConnectionObjectEqualOriginator(const CipConnectionObject *const object1,
@@ -12,11 +12,28 @@
 #include "opener_user_conf.h"
 #include "opener_api.h"
 #include "doublylinkedlist.h"
+#include "blockpool.h"
 #include "cipelectronickey.h"
 #include "cipepath.h"
+#include "cipmessagerouter.h"
 
 #define CIP_CONNECTION_OBJECT_CODE 0x05
 
+/** @brief Upper bound of simultaneously active connections of all types */
+/** @brief Largest CPF header of a produced I/O frame
+ *
+ * Item count, sequenced address item and connected data item header including
+ * the class 1 sequence count.
+ */
+#define CIP_IO_FRAME_TEMPLATE_MAX_LENGTH 20
+
+#define OPENER_CIP_NUM_ACTIVE_CONNS ( OPENER_CIP_NUM_EXPLICIT_CONNS + \
+                                      OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS + \
+                                      OPENER_CIP_NUM_INPUT_ONLY_CONNS * \
+                                      OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH + \
+                                      OPENER_CIP_NUM_LISTEN_ONLY_CONNS * \
+                                      OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH )
+
 typedef enum {
   kConnectionObjectStateNonExistent = 0, /**< Connection is non existent */
   kConnectionObjectStateConfiguring, /**< Waiting for both to be configured and to apply the configuration */
@@ -103,15 +120,102 @@ typedef EipStatus (*CipConnectionStateHandler)(CipConnectionObject *RESTRICT
                                                ConnectionObjectState new_state);
 
 struct cip_connection_object {
+  /* Hot part: read or written each time ManageConnectionTimers() handles the
+   * connection and for every produced or consumed I/O frame. Kept together
+   * at the start of the object so that this touches a few cache lines and
+   * not the whole object. */
   CipUsint state; /*< Attribute 1 */
   CipUsint instance_type; /*< Attribute 2 */
   CipByte transport_class_trigger; /*< Attribute 3 */
-  /* Attribute 4-6 only for device net*/
-  CipUint produced_connection_size; /*< Attribute 7 - Limits produced connection size - for explicit messaging 0xFFFF means no predefined limit */
-  CipUint consumed_connection_size; /*< Attribute 8 - Limits produced connection size - for explicit messaging 0xFFFF means no predefined limit */
+  CipBool eip_first_level_sequence_count_received; /**< False if eip_level_sequence_count_consuming
+                                                   hasn't been initialized with a sequence
+                                                   count yet, true otherwise */
+  CipBool redundant_standby; /**< True for the standby of a redundant
+                                exclusive owner, its data is not applied */
+  CipBool run_idle_reported; /**< True once run_idle_state is part of the
+                                device run/idle state */
   CipUint expected_packet_rate; /*< Attribute 9 - Resolution in Milliseconds */
+  CipUint sequence_count_producing; /**< sequence Count for Class 1 Producing
+                                         Connections */
+  CipUint sequence_count_consuming; /**< sequence Count for Class 1 Producing
+                                         Connections */
+  CipUdint produced_data_version; /**< assembly data version of the last
+                                     production, see GetAssemblyDataVersion() */
+  EipUint32 run_idle_state; /**< last consumed run/idle header */
+  /* Number of established connections served by the multicast production
+   * of this connection, only maintained on the producing master */
+  CipUint multicast_consumer_count;
+
+  CipUdint t_to_o_requested_packet_interval;
   CipUdint cip_produced_connection_id; /*< Attribute 10 */
   CipUdint cip_consumed_connection_id; /*< Attribute 11 */
+
+  EipUint32 eip_level_sequence_count_producing; /**< the EIP level sequence Count
+                                                   for Class 0/1
+                                                   Producing Connections may have a
+                                                   different
+                                                   value than SequenceCountProducing */
+  EipUint32 eip_level_sequence_count_consuming; /**< the EIP level sequence Count
+                                                   for Class 0/1
+                                                   Producing Connections may have a
+                                                   different
+                                                   value than SequenceCountProducing */
+
+  /* Sockets for consuming and producing connection */
+  int socket[2];
+  /* DSCP of the produced frames, from the T->O priority at establishment */
+  CipUsint producing_dscp;
+
+  /* Timer deadlines, absolute in ConnectionManagerGetTime() microseconds */
+  uint64_t transmission_trigger_timer;
+  uint64_t inactivity_watchdog_timer;
+  uint64_t last_package_watchdog_timer;
+  uint64_t production_inhibit_timer;
+
+  /* Position in the connection manager deadline queue while the connection
+   * is active, the queue keeps the deadline itself */
+  size_t deadline_queue_position;
+  /* Node of the connection in connection_list while it is active, so that
+   * removing it needs no search */
+  DoublyLinkedListNode *active_list_node;
+
+  CipInstance *producing_instance;
+  CipInstance *consuming_instance;
+
+  /* pointers to connection handling functions */
+  CipConnectionStateHandler current_state_handler;
+
+  ConnectionCloseFunction connection_close_function;
+  ConnectionTimeoutFunction connection_timeout_function;
+  ConnectionSendDataFunction connection_send_data_function;
+  ConnectionReceiveDataFunction connection_receive_data_function;
+
+  /* Achieved production timing, see GetConnectionProductionStatistics() */
+  MicroSeconds last_production_time;
+  CipUdint production_interval_average;
+  CipUdint production_interval_maximum;
+  CipUdint production_count;
+
+  struct sockaddr_in remote_address; /* socket address for produce */
+  struct sockaddr_in originator_address; /* the address of the originator that
+                                              established the connection. needed
+                                              for scanning if the right packet is
+                                              arriving */
+  CipBool secure_transport; /* opened over TLS, produced and consumed over the
+                               DTLS session of the originator */
+  struct sockaddr_in secure_peer; /* address and port of that DTLS session,
+                                     port 0 until the first record binds it */
+  int secure_tls_socket; /* the TLS session the connection was opened over */
+
+  /* CPF header of produced I/O frames, prebuilt by EstablishIoConnection() so
+   * that SendConnectedData() only needs to patch the sequence counts */
+  size_t io_frame_template_length;
+  CipOctet io_frame_template[CIP_IO_FRAME_TEMPLATE_MAX_LENGTH];
+
+  /* Cold part: Forward Open parameters, paths and the remaining CIP
+   * attributes, used when the connection is opened, closed or read */
+  CipUint produced_connection_size; /*< Attribute 7 - Limits produced connection size - for explicit messaging 0xFFFF means no predefined limit */
+  CipUint consumed_connection_size; /*< Attribute 8 - Limits produced connection size - for explicit messaging 0xFFFF means no predefined limit */
   CipUsint watchdog_timeout_action; /*< Attribute 12 */
   CipUint produced_connection_path_length; /*< Attribute 13 */
   CipOctet *produced_connection_path; /*< Attribute 14 */
@@ -129,17 +233,9 @@ struct cip_connection_object {
 
   CipConnectionPathEpath configuration_path;
 
-  CipInstance *producing_instance;
-  CipInstance *consuming_instance;
-
   CipUint requested_produced_connection_size;
   CipUint requested_consumed_connection_size;
 
-  uint64_t transmission_trigger_timer;
-  uint64_t inactivity_watchdog_timer;
-  uint64_t last_package_watchdog_timer;
-  uint64_t production_inhibit_timer;
-
   CipUint connection_serial_number;
   CipUint originator_vendor_id;
   CipUdint originator_serial_number;
@@ -149,51 +245,31 @@ struct cip_connection_object {
   CipUdint o_to_t_requested_packet_interval;
   CipDword o_to_t_network_connection_parameters;
 
-  CipUdint t_to_o_requested_packet_interval;
   CipDword t_to_o_network_connection_parameters;
 
-  CipUint sequence_count_producing; /**< sequence Count for Class 1 Producing
-                                         Connections */
-  CipUint sequence_count_consuming; /**< sequence Count for Class 1 Producing
-                                         Connections */
-
-  EipUint32 eip_level_sequence_count_producing; /**< the EIP level sequence Count
-                                                   for Class 0/1
-                                                   Producing Connections may have a
-                                                   different
-                                                   value than SequenceCountProducing */
-  EipUint32 eip_level_sequence_count_consuming; /**< the EIP level sequence Count
-                                                   for Class 0/1
-                                                   Producing Connections may have a
-                                                   different
-                                                   value than SequenceCountProducing */
-  CipBool eip_first_level_sequence_count_received; /**< False if eip_level_sequence_count_consuming
-                                                   hasn't been initialized with a sequence
-                                                   count yet, true otherwise */
   CipInt correct_originator_to_target_size;
   CipInt correct_target_to_originator_size;
-
-  /* Sockets for consuming and producing connection */
-  int socket[2];
-
-  struct sockaddr_in remote_address; /* socket address for produce */
-  struct sockaddr_in originator_address; /* the address of the originator that
-                                              established the connection. needed
-                                              for scanning if the right packet is
-                                              arriving */
+  CipUdint correct_originator_to_target_packet_interval; /**< O->T RPI the
+                                                            admission control
+                                                            proposes */
+  CipUdint correct_target_to_originator_packet_interval; /**< T->O RPI an
+                                                            existing multicast
+                                                            producer requires
+                                                            or the admission
+                                                            control proposes */
+  CipUint correct_packet_interval_types; /**< ConnectionManagerRpiType of the
+                                            O->T RPI in the low and of the
+                                            T->O RPI in the high byte */
 
   CipSessionHandle associated_encapsulation_session; /* The session handle ID via which the forward open was sent */
 
-  /* pointers to connection handling functions */
-  CipConnectionStateHandler current_state_handler;
-
-  ConnectionCloseFunction connection_close_function;
-  ConnectionTimeoutFunction connection_timeout_function;
-  ConnectionSendDataFunction connection_send_data_function;
-  ConnectionReceiveDataFunction connection_receive_data_function;
-
   ENIPMessage last_reply_sent;
+  /* target of the last request of a Class 3 connection */
+  CipMessageRouterRoute explicit_route;
   CipBool is_large_forward_open;
+  /* CPF items of the Forward_Open request, completed for its reply. Only set
+   * on the request while its connection is opened */
+  CipCommonPacketFormatData *forward_open_items;
 };
 
 /** @brief Extern declaration of the global connection list */
@@ -203,6 +279,12 @@ DoublyLinkedListNode *CipConnectionObjectListArrayAllocator(
   );
 void CipConnectionObjectListArrayFree(DoublyLinkedListNode **node);
 
+/** @brief Node pool backing the connection list allocator
+ *
+ * Exposes the pool usage and high-water mark for diagnostics.
+ */
+const BlockPool *CipConnectionObjectListNodePool(void);
+
 /** @brief Array allocator
  *
  */
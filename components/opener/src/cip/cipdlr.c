@@ -113,6 +113,34 @@ static void EncodeCipNodeAddress(const void *const data,
 /* ********************************************************************
  * public functions
  */
+/* The instance attributes, kept in flash */
+static const CipAttributeStruct kDlrInstanceAttributes[] = {
+  CIP_ATTRIBUTE(1, kCipUsint, EncodeCipUsint, NULL, &g_dlr.network_topology,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(2, kCipUsint, EncodeCipUsint, NULL, &g_dlr.network_status,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(3, kCipUsint, EncodeCipUsint, NULL, &s_0xFF_default,
+                kGetableAll),
+  CIP_ATTRIBUTE(4, kCipAny, EncodeCipRingSupervisorConfig, NULL,
+                &s_0x00000000_default, kGetableAllDummy),
+  CIP_ATTRIBUTE(5, kCipUint, EncodeCipUint, NULL, &s_0x0000_default,
+                kGetableAll),
+  CIP_ATTRIBUTE(6, kCipAny, EncodeCipNodeAddress, NULL, &s_zero_node,
+                kGetableAll),
+  CIP_ATTRIBUTE(7, kCipAny, EncodeCipNodeAddress, NULL, &s_zero_node,
+                kGetableAll),
+  CIP_ATTRIBUTE(8, kCipUint, EncodeCipUint, NULL, &s_0xFFFF_default,
+                kGetableAll),
+  /* Attribute #9 is not implemented and also NOT part of the GetAttributesAll
+   *  response. Therefore it is not added here! */
+  CIP_ATTRIBUTE(10, kCipAny, EncodeCipNodeAddress, NULL,
+                &g_dlr.active_supervisor_address, kGetableSingleAndAll),
+  CIP_ATTRIBUTE(11, kCipUsint, EncodeCipUsint, NULL, &s_0x00_default,
+                kGetableAll),
+  CIP_ATTRIBUTE(12, kCipDword, EncodeCipDword, NULL, &g_dlr.capability_flags,
+                kGetableSingleAndAll),
+};
+
 EipStatus CipDlrInit(void) {
   CipClass *dlr_class = NULL;
 
@@ -120,7 +148,7 @@ EipStatus CipDlrInit(void) {
                              0, /* # class attributes */
                              7, /* # highest class attribute number */
                              2, /* # class services */
-                             11,/* # instance attributes */
+                             0, /* # instance attributes, from kDlrInstanceAttributes */
                              12,/* # of highest instance attribute */
                              2, /* # instance services */
                              1, /* # instances */
@@ -140,87 +168,9 @@ EipStatus CipDlrInit(void) {
                 GetAttributeAll, "GetAttributeAll");
 
   /* Bind attributes to the instance */
-  CipInstance *dlr_instance = GetCipInstance(dlr_class, 1u);
-
-  InsertAttribute(dlr_instance,
-                  1,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  NULL,
-                  &g_dlr.network_topology,
-                  kGetableSingleAndAll);
-  InsertAttribute(dlr_instance,
-                  2,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  NULL,
-                  &g_dlr.network_status,
-                  kGetableSingleAndAll);
-  InsertAttribute(dlr_instance,
-                  3,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  NULL,
-                  (void *)&s_0xFF_default,
-                  kGetableAll);
-  InsertAttribute(dlr_instance,
-                  4,
-                  kCipAny,
-                  EncodeCipRingSupervisorConfig,
-                  NULL,
-                  (void *)&s_0x00000000_default,
-                  kGetableAllDummy);
-  InsertAttribute(dlr_instance,
-                  5,
-                  kCipUint,
-                  EncodeCipUint,
-                  NULL,
-                  (void *)&s_0x0000_default,
-                  kGetableAll);
-  InsertAttribute(dlr_instance,
-                  6,
-                  kCipAny,
-                  EncodeCipNodeAddress,
-                  NULL,
-                  (void *)&s_zero_node,
-                  kGetableAll);
-  InsertAttribute(dlr_instance,
-                  7,
-                  kCipAny,
-                  EncodeCipNodeAddress,
-                  NULL,
-                  (void *)&s_zero_node,
-                  kGetableAll);
-  InsertAttribute(dlr_instance,
-                  8,
-                  kCipUint,
-                  EncodeCipUint,
-                  NULL,
-                  (void *)&s_0xFFFF_default,
-                  kGetableAll);
-  /* Attribute #9 is not implemented and also NOT part of the GetAttributesAll
-   *  response. Therefore it is not added here! */
-  InsertAttribute(dlr_instance,
-                  10,
-                  kCipAny,
-                  EncodeCipNodeAddress,
-                  NULL,
-                  &g_dlr.active_supervisor_address,
-                  kGetableSingleAndAll);
-  InsertAttribute(dlr_instance,
-                  11,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  NULL,
-                  (void *)&s_0x00_default,
-                  kGetableAll);
-  InsertAttribute(dlr_instance,
-                  12,
-                  kCipDword,
-                  EncodeCipDword,
-                  NULL,
-                  &g_dlr.capability_flags,
-                  kGetableSingleAndAll);
+  SetCipInstanceAttributes(GetCipInstance(dlr_class, 1u),
+                           kDlrInstanceAttributes,
+                           NELEMENTS(kDlrInstanceAttributes) );
 
   /* Set attributes to initial values */
   /* Assume beacon based DLR device. Also all Revision 3 and higher devices
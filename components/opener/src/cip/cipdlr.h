@@ -41,6 +41,21 @@ typedef enum {
   kDlrCapFlushTableFrame = 0x80,
 } CipDlrCapabilityFlags;
 
+/** @brief Values of the Network Topology attribute (#1) */
+typedef enum {
+  kDlrTopologyLinear = 0, /**< Linear or star network */
+  kDlrTopologyRing = 1, /**< Ring network */
+} CipDlrNetworkTopology;
+
+/** @brief Values of the Network Status attribute (#2) */
+typedef enum {
+  kDlrStatusNormal = 0, /**< Normal operation */
+  kDlrStatusRingFault = 1, /**< The supervisor detected a ring fault */
+  kDlrStatusUnexpectedLoop = 2, /**< Unexpected loop detected */
+  kDlrStatusPartialFault = 3, /**< Partial network fault */
+  kDlrStatusRapidFault = 4, /**< Rapid fault/restore cycle */
+} CipDlrNetworkStatus;
+
 
 /** @brief Node address information for a DLR node
  *
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 
 #include "cipelectronickey.h"
+#include "opener_api.h"
 
 void ElectronicKeySetKeyFormat(CipElectronicKey *const electronic_key,
                                const CipUsint key_format) {
@@ -38,11 +39,11 @@ typedef struct electronic_key_format_4 {
 const size_t kElectronicKeyFormat4Size = sizeof(ElectronicKeyFormat4);
 
 ElectronicKeyFormat4 *ElectronicKeyFormat4New() {
-  return (ElectronicKeyFormat4 *)calloc( 1, sizeof(ElectronicKeyFormat4) );
+  return (ElectronicKeyFormat4 *)CipCalloc( 1, sizeof(ElectronicKeyFormat4) );
 }
 
 void ElectronicKeyFormat4Delete(ElectronicKeyFormat4 **electronic_key) {
-  free(*electronic_key);
+  CipFree(*electronic_key);
   *electronic_key = NULL;
 }
 
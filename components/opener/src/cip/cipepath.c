@@ -16,42 +16,95 @@
 
 const unsigned int kPortSegmentExtendedPort = 15; /**< Reserved port segment port value, indicating the use of the extended port field */
 
+/*** Segment information table ***/
+
+/* The entries are computed from their index by the compiler. The segment
+ * type, logical type and logical format enums follow the order of the bits
+ * in the header byte, the network and data subtypes have to be mapped. */
+#define EPATH_TYPE_BITS(h) ( (h) & 0xE0 )
+#define EPATH_LOW_BITS(h) ( (h) & 0x1F )
+#define EPATH_LOGICAL_TYPE_BITS(h) ( (h) & 0x1C )
+#define EPATH_LOGICAL_FORMAT_BITS(h) ( (h) & 0x03 )
+
+#define EPATH_NETWORK_SUBTYPE(h) \
+  (NETWORK_SEGMENT_SCHEDULE == EPATH_LOW_BITS(h) ? \
+   kNetworkSegmentSubtypeScheduleSegment : \
+   NETWORK_SEGMENT_FIXED_TAG == EPATH_LOW_BITS(h) ? \
+   kNetworkSegmentSubtypeFixedTagSegment : \
+   NETWORK_SEGMENT_PRODUCTION_INHIBIT_TIME_IN_MILLISECONDS == \
+   EPATH_LOW_BITS(h) ? \
+   kNetworkSegmentSubtypeProductionInhibitTimeInMilliseconds : \
+   NETWORK_SEGMENT_SAFETY == EPATH_LOW_BITS(h) ? \
+   kNetworkSegmentSubtypeSafetySegment : \
+   NETWORK_SEGMENT_PRODUCTION_INHIBIT_TIME_IN_MICROSECONDS == \
+   EPATH_LOW_BITS(h) ? \
+   kNetworkSegmentSubtypeProductionInhibitTimeInMicroseconds : \
+   NETWORK_SEGMENT_EXTENDED_NETWORK == EPATH_LOW_BITS(h) ? \
+   kNetworkSegmentSubtypeExtendedNetworkSegment : \
+   kNetworkSegmentSubtypeReserved)
+
+#define EPATH_DATA_SUBTYPE(h) \
+  (DATA_SEGMENT_SUBTYPE_SIMPLE_DATA == EPATH_LOW_BITS(h) ? \
+   kDataSegmentSubtypeSimpleData : \
+   DATA_SEGMENT_SUBTYPE_ANSI_EXTENDED_SYMBOL == EPATH_LOW_BITS(h) ? \
+   kDataSegmentSubtypeANSIExtendedSymbol : \
+   kDataSegmentSubtypeReserved)
+
+#define EPATH_SUBTYPE(h) \
+  (SEGMENT_TYPE_LOGICAL_SEGMENT == EPATH_TYPE_BITS(h) ? \
+   EPATH_LOGICAL_TYPE_BITS(h) >> 2 : \
+   SEGMENT_TYPE_NETWORK_SEGMENT == EPATH_TYPE_BITS(h) ? \
+   EPATH_NETWORK_SUBTYPE(h) : \
+   SEGMENT_TYPE_DATA_SEGMENT == EPATH_TYPE_BITS(h) ? \
+   EPATH_DATA_SUBTYPE(h) : 0)
+
+/* Special and extended logical segments carry more than a value */
+#define EPATH_LOGICAL_LENGTH(h) \
+  (LOGICAL_SEGMENT_TYPE_SPECIAL == EPATH_LOGICAL_TYPE_BITS(h) || \
+   LOGICAL_SEGMENT_TYPE_EXTENDED_LOGICAL == EPATH_LOGICAL_TYPE_BITS(h) ? 0 : \
+   LOGICAL_SEGMENT_FORMAT_EIGHT_BIT == EPATH_LOGICAL_FORMAT_BITS(h) ? 2 : \
+   LOGICAL_SEGMENT_FORMAT_SIXTEEN_BIT == EPATH_LOGICAL_FORMAT_BITS(h) ? 4 : \
+   LOGICAL_SEGMENT_FORMAT_THIRTY_TWO_BIT == EPATH_LOGICAL_FORMAT_BITS(h) ? 6 : \
+   0)
+
+/* Port segments without an extended link address: port number, optional
+ * extended port number and a one byte link address. Network segments with
+ * bit 4 cleared hold one byte of data. */
+#define EPATH_LENGTH(h) \
+  (SEGMENT_TYPE_PORT_SEGMENT == EPATH_TYPE_BITS(h) ? \
+   (0 != ( (h) & kPortSegmentFlagExtendedLinkAddressSize ) ? 0 : \
+    15 == ( (h) & 0x0F ) ? 4 : 2) : \
+   SEGMENT_TYPE_LOGICAL_SEGMENT == EPATH_TYPE_BITS(h) ? \
+   EPATH_LOGICAL_LENGTH(h) : \
+   SEGMENT_TYPE_NETWORK_SEGMENT == EPATH_TYPE_BITS(h) ? \
+   (0 != ( (h) & 0x10 ) ? 0 : 2) : 0)
+
+#define EPATH_SEGMENT_INFO(h) \
+  { .segment_type = EPATH_TYPE_BITS(h) >> 5, \
+    .subtype = EPATH_SUBTYPE(h), \
+    .logical_format = SEGMENT_TYPE_LOGICAL_SEGMENT == EPATH_TYPE_BITS(h) ? \
+                      EPATH_LOGICAL_FORMAT_BITS(h) : 0, \
+    .length = EPATH_LENGTH(h) }
+#define EPATH_SEGMENT_INFO_4(h) \
+  EPATH_SEGMENT_INFO(h), EPATH_SEGMENT_INFO( (h) + 1), \
+  EPATH_SEGMENT_INFO( (h) + 2), EPATH_SEGMENT_INFO( (h) + 3)
+#define EPATH_SEGMENT_INFO_16(h) \
+  EPATH_SEGMENT_INFO_4(h), EPATH_SEGMENT_INFO_4( (h) + 4), \
+  EPATH_SEGMENT_INFO_4( (h) + 8), EPATH_SEGMENT_INFO_4( (h) + 12)
+#define EPATH_SEGMENT_INFO_64(h) \
+  EPATH_SEGMENT_INFO_16(h), EPATH_SEGMENT_INFO_16( (h) + 16), \
+  EPATH_SEGMENT_INFO_16( (h) + 32), EPATH_SEGMENT_INFO_16( (h) + 48)
+
+const CipEpathSegmentInfo g_kCipEpathSegmentInfo[256] = {
+  EPATH_SEGMENT_INFO_64(0), EPATH_SEGMENT_INFO_64(64),
+  EPATH_SEGMENT_INFO_64(128), EPATH_SEGMENT_INFO_64(192)
+};
+
+/*** Segment information table ***/
+
 /*** Path Segment ***/
 SegmentType GetPathSegmentType(const CipOctet *const cip_path) {
-  const unsigned int kSegmentTypeMask = 0xE0;
-  const unsigned int segment_type = *cip_path & kSegmentTypeMask;
-  SegmentType result = kSegmentTypeInvalid;
-  switch(segment_type) {
-    case SEGMENT_TYPE_PORT_SEGMENT:
-      result = kSegmentTypePortSegment;
-      break;
-    case SEGMENT_TYPE_LOGICAL_SEGMENT:
-      result = kSegmentTypeLogicalSegment;
-      break;
-    case SEGMENT_TYPE_NETWORK_SEGMENT:
-      result = kSegmentTypeNetworkSegment;
-      break;
-    case SEGMENT_TYPE_SYMBOLIC_SEGMENT:
-      result = kSegmentTypeSymbolicSegment;
-      break;
-    case SEGMENT_TYPE_DATA_SEGMENT:
-      result = kSegmentTypeDataSegment;
-      break;
-    case SEGMENT_TYPE_DATA_TYPE_CONSTRUCTED:
-      result = kSegmentTypeDataTypeConstructed;
-      break;
-    case SEGMENT_TYPE_DATA_TYPE_ELEMENTARTY:
-      result = kSegmentTypeDataTypeElementary;
-      break;
-    case SEGMENT_TYPE_SEGMENT_RESERVED:
-      result = kSegmentTypeReserved;
-      break;
-    default:
-      OPENER_TRACE_ERR(
-        "Invalid Segment type in the message! We should never come here!\n");
-      break;
-  }
-  return result;
+  return (SegmentType) g_kCipEpathSegmentInfo[*cip_path].segment_type;
 }
 
 void SetPathSegmentType(SegmentType segment_type,
@@ -160,39 +213,8 @@ LogicalSegmentLogicalType GetPathLogicalSegmentLogicalType(
   const unsigned char *const cip_path) {
   OPENER_ASSERT(kSegmentTypeLogicalSegment == GetPathSegmentType(cip_path) );
   const unsigned int kLogicalTypeMask = 0x1C;
-  const unsigned int logical_type = (*cip_path) & kLogicalTypeMask;
-  LogicalSegmentLogicalType result = kLogicalSegmentLogicalTypeInvalid;
-  switch(logical_type) {
-    case LOGICAL_SEGMENT_TYPE_CLASS_ID:
-      result = kLogicalSegmentLogicalTypeClassId;
-      break;
-    case LOGICAL_SEGMENT_TYPE_INSTANCE_ID:
-      result = kLogicalSegmentLogicalTypeInstanceId;
-      break;
-    case LOGICAL_SEGMENT_TYPE_MEMBER_ID:
-      result = kLogicalSegmentLogicalTypeMemberId;
-      break;
-    case LOGICAL_SEGMENT_TYPE_CONNECTION_POINT:
-      result = kLogicalSegmentLogicalTypeConnectionPoint;
-      break;
-    case LOGICAL_SEGMENT_TYPE_ATTRIBUTE_ID:
-      result = kLogicalSegmentLogicalTypeAttributeId;
-      break;
-    case LOGICAL_SEGMENT_TYPE_SPECIAL:
-      result = kLogicalSegmentLogicalTypeSpecial;
-      break;
-    case LOGICAL_SEGMENT_TYPE_SERVICE_ID:
-      result = kLogicalSegmentLogicalTypeServiceId;
-      break;
-    case LOGICAL_SEGMENT_TYPE_EXTENDED_LOGICAL:
-      result = kLogicalSegmentLogicalTypeExtendedLogical;
-      break;
-    default:
-      OPENER_TRACE_ERR(
-        "Logical segment/logical type: Invalid input!\n");
-      break;
-  }
-  return result;
+  return (LogicalSegmentLogicalType) g_kCipEpathSegmentInfo[
+    SEGMENT_TYPE_LOGICAL_SEGMENT | (*cip_path & kLogicalTypeMask)].subtype;
 }
 
 void SetPathLogicalSegmentLogicalType(LogicalSegmentLogicalType logical_type,
@@ -235,22 +257,13 @@ LogicalSegmentLogicalFormat GetPathLogicalSegmentLogicalFormat(
   const unsigned char *const cip_path) {
   OPENER_ASSERT(kSegmentTypeLogicalSegment == GetPathSegmentType(cip_path) );
   const unsigned int kLogicalFormatMask = 0x03;
-  const unsigned int logical_format = (*cip_path) & kLogicalFormatMask;
-  LogicalSegmentLogicalFormat result = kLogicalSegmentLogicalFormatInvalid;
-  switch(logical_format) {
-    case LOGICAL_SEGMENT_FORMAT_EIGHT_BIT:
-      result = kLogicalSegmentLogicalFormatEightBit;
-      break;
-    case LOGICAL_SEGMENT_FORMAT_SIXTEEN_BIT:
-      result = kLogicalSegmentLogicalFormatSixteenBit;
-      break;
-    case LOGICAL_SEGMENT_FORMAT_THIRTY_TWO_BIT:
-      result = kLogicalSegmentLogicalFormatThirtyTwoBit;
-      break;
-    default:
-      OPENER_TRACE_ERR(
-        "Logical segment/logical type: Invalid logical type detected!\n");
-      break;
+  const LogicalSegmentLogicalFormat result =
+    (LogicalSegmentLogicalFormat) g_kCipEpathSegmentInfo[
+      SEGMENT_TYPE_LOGICAL_SEGMENT | (*cip_path & kLogicalFormatMask)].
+    logical_format;
+  if(kLogicalSegmentLogicalFormatInvalid == result) {
+    OPENER_TRACE_ERR(
+      "Logical segment/logical type: Invalid logical type detected!\n");
   }
   return result;
 }
@@ -431,33 +444,8 @@ NetworkSegmentSubtype GetPathNetworkSegmentSubtype(
   const unsigned char *const cip_path) {
   OPENER_ASSERT(kSegmentTypeNetworkSegment == GetPathSegmentType(cip_path) );
   const unsigned int kSubtypeMask = 0x1F;
-  const unsigned int subtype = (*cip_path) & kSubtypeMask;
-  NetworkSegmentSubtype result = kNetworkSegmentSubtypeReserved;
-  switch(subtype) {
-    case NETWORK_SEGMENT_SCHEDULE:
-      result = kNetworkSegmentSubtypeScheduleSegment;
-      break;
-    case NETWORK_SEGMENT_FIXED_TAG:
-      result = kNetworkSegmentSubtypeFixedTagSegment;
-      break;
-    case NETWORK_SEGMENT_PRODUCTION_INHIBIT_TIME_IN_MILLISECONDS:
-      result = kNetworkSegmentSubtypeProductionInhibitTimeInMilliseconds;
-      break;
-    case NETWORK_SEGMENT_SAFETY:
-      result = kNetworkSegmentSubtypeSafetySegment;
-      break;
-    case NETWORK_SEGMENT_PRODUCTION_INHIBIT_TIME_IN_MICROSECONDS:
-      result = kNetworkSegmentSubtypeProductionInhibitTimeInMicroseconds;
-      break;
-    case NETWORK_SEGMENT_EXTENDED_NETWORK:
-      result = kNetworkSegmentSubtypeExtendedNetworkSegment;
-      break;
-    default:
-      result = kNetworkSegmentSubtypeReserved;
-      break;
-  }
-
-  return result;
+  return (NetworkSegmentSubtype) g_kCipEpathSegmentInfo[
+    SEGMENT_TYPE_NETWORK_SEGMENT | (*cip_path & kSubtypeMask)].subtype;
 }
 
 /**
@@ -577,21 +565,8 @@ SymbolicSegmentExtendedFormat GetPathSymbolicSegmentExtendedFormat(
 DataSegmentSubtype GetPathDataSegmentSubtype(const unsigned char *const cip_path)
 {
   const unsigned int kDataSegmentSubtypeMask = 0x1F;
-  const unsigned int data_subtype = (*cip_path) & kDataSegmentSubtypeMask;
-
-  DataSegmentSubtype result = kDataSegmentSubtypeReserved;
-  switch(data_subtype) {
-    case DATA_SEGMENT_SUBTYPE_SIMPLE_DATA:
-      result = kDataSegmentSubtypeSimpleData;
-      break;
-    case DATA_SEGMENT_SUBTYPE_ANSI_EXTENDED_SYMBOL:
-      result = kDataSegmentSubtypeANSIExtendedSymbol;
-      break;
-    default:
-      result = kDataSegmentSubtypeReserved;
-      break;
-  }
-  return result;
+  return (DataSegmentSubtype) g_kCipEpathSegmentInfo[
+    SEGMENT_TYPE_DATA_SEGMENT | (*cip_path & kDataSegmentSubtypeMask)].subtype;
 }
 
 /** @brief Returns the amount of 16-bit data words in the Simple Data EPath
@@ -694,3 +669,114 @@ bool CipEpathEqual(const CipOctet *const path1,
   return true;
 }
 
+
+/*** Path Iterator ***/
+
+/** @brief Length of a segment whose header byte does not tell it
+ *
+ * @param segment The header byte of the segment, followed by at least one
+ *        byte of the path
+ * @return The length of the segment in bytes, 0 if unknown
+ */
+static size_t GetVariableSegmentLength(const CipOctet *const segment) {
+  const CipEpathSegmentInfo *const info = &g_kCipEpathSegmentInfo[*segment];
+  size_t length = 0;
+  switch(info->segment_type) {
+    case kSegmentTypePortSegment: {
+      /* Extended link address: size byte, optional extended port number,
+         link address and a pad byte to an even length */
+      length = 2 + segment[1];
+      if(kPortSegmentExtendedPort == (*segment & 0x0F) ) {
+        length += 2;
+      }
+      length += length & 1;
+    }
+    break;
+    case kSegmentTypeLogicalSegment:
+      if(kLogicalSegmentLogicalTypeSpecial == info->subtype &&
+         LOGICAL_SEGMENT_SPECIAL_TYPE_FORMAT_ELECTRONIC_KEY ==
+         (*segment & 0x03) &&
+         ELECTRONIC_KEY_SEGMENT_KEY_FORMAT_4 == segment[1]) {
+        length = 10; /* header, key format, 8 bytes of key format 4 */
+      }
+      break;
+    case kSegmentTypeNetworkSegment:
+      if(kNetworkSegmentSubtypeExtendedNetworkSegment != info->subtype) {
+        length = 2 + segment[1] * sizeof(CipWord); /* data size in words */
+      }
+      break;
+    case kSegmentTypeDataSegment:
+      if(kDataSegmentSubtypeSimpleData == info->subtype) {
+        length = 2 + segment[1] * sizeof(CipWord); /* data size in words */
+      } else if(kDataSegmentSubtypeANSIExtendedSymbol == info->subtype) {
+        length = 2 + segment[1] + (segment[1] & 1); /* symbol and pad byte */
+      }
+      break;
+    default:
+      break;
+  }
+  return length;
+}
+
+void CipEpathIteratorInit(CipEpathIterator *const iterator,
+                          const CipOctet *const cip_path,
+                          const size_t path_length) {
+  iterator->position = cip_path;
+  iterator->end = cip_path + path_length;
+}
+
+bool CipEpathIteratorPeek(const CipEpathIterator *const iterator,
+                          CipEpathSegment *const segment) {
+  const CipOctet *const header = iterator->position;
+  const size_t available = CipEpathIteratorRemaining(iterator);
+  if(0 == available) {
+    return false;
+  }
+  segment->header = header;
+  segment->info = g_kCipEpathSegmentInfo[*header];
+  segment->logical_value = 0;
+  segment->length = segment->info.length;
+  if(0 == segment->length && available >= 2) {
+    segment->length = GetVariableSegmentLength(header);
+  }
+  if(0 == segment->length || segment->length > available) {
+    return false;
+  }
+
+  if(kSegmentTypeLogicalSegment == segment->info.segment_type &&
+     0 != segment->info.length) {
+    /* Values wider than 8 bit follow a pad byte */
+    const CipOctet *value = header + 2;
+    switch(segment->info.logical_format) {
+      case kLogicalSegmentLogicalFormatEightBit:
+        segment->logical_value = header[1];
+        break;
+      case kLogicalSegmentLogicalFormatSixteenBit:
+        segment->logical_value = GetWordFromMessage(&value);
+        break;
+      default:
+        segment->logical_value = GetDwordFromMessage(&value);
+        break;
+    }
+  }
+  return true;
+}
+
+bool CipEpathIteratorNext(CipEpathIterator *const iterator,
+                          CipEpathSegment *const segment) {
+  if(!CipEpathIteratorPeek(iterator, segment) ) {
+    return false;
+  }
+  CipEpathIteratorSkip(iterator, segment);
+  return true;
+}
+
+void CipEpathIteratorSkip(CipEpathIterator *const iterator,
+                          const CipEpathSegment *const segment) {
+  OPENER_ASSERT(segment->header == iterator->position);
+  iterator->position += segment->length;
+}
+
+size_t CipEpathIteratorRemaining(const CipEpathIterator *const iterator) {
+  return (size_t) (iterator->end - iterator->position);
+}
@@ -8,6 +8,7 @@
 #define SRC_CIP_CIPEPATH_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "ciptypes.h"
 #include "cipelectronickey.h"
@@ -185,6 +186,70 @@ typedef struct connection_path_epath {
 } CipConnectionPathEpath;
 /* End - Often used types of EPaths */
 
+/** @brief What the first byte of a segment tells about the segment
+ *
+ * One entry per header byte in g_kCipEpathSegmentInfo, so a segment is
+ * classified with a single table access instead of a switch per field.
+ */
+typedef struct cip_epath_segment_info {
+  EipUint8 segment_type; /**< SegmentType */
+  EipUint8 subtype; /**< LogicalSegmentLogicalType, NetworkSegmentSubtype or DataSegmentSubtype, 0 for other segment types */
+  EipUint8 logical_format; /**< LogicalSegmentLogicalFormat of logical segments, 0 otherwise */
+  EipUint8 length; /**< Length of the segment in bytes, 0 if the bytes after the header byte tell it */
+} CipEpathSegmentInfo;
+
+/** @brief Segment information indexed by the header byte of a segment */
+extern const CipEpathSegmentInfo g_kCipEpathSegmentInfo[256];
+
+/** @brief One segment of an EPath, as returned by CipEpathIteratorNext() */
+typedef struct cip_epath_segment {
+  const CipOctet *header; /**< Header byte of the segment in the message */
+  CipEpathSegmentInfo info; /**< Classification of the header byte */
+  size_t length; /**< Length of the segment in bytes, pad bytes included */
+  CipDword logical_value; /**< Value of an 8, 16 or 32 bit logical segment, 0 otherwise */
+} CipEpathSegment;
+
+/** @brief Walks the segments of a padded EPath once, front to back */
+typedef struct cip_epath_iterator {
+  const CipOctet *position; /**< Header byte of the next segment */
+  const CipOctet *end; /**< First byte after the path */
+} CipEpathIterator;
+
+/** @brief Sets up an iterator over a padded EPath
+ *
+ * @param iterator The iterator to set up
+ * @param cip_path The first segment of the path
+ * @param path_length The length of the path in bytes
+ */
+void CipEpathIteratorInit(CipEpathIterator *const iterator,
+                          const CipOctet *const cip_path,
+                          const size_t path_length);
+
+/** @brief Decodes the next segment without moving past it
+ *
+ * @param iterator The iterator
+ * @param segment Receives the segment
+ * @return true if there is a next segment, false at the end of the path, for
+ *         segments cut off by the end of the path and for segments of unknown
+ *         length
+ */
+bool CipEpathIteratorPeek(const CipEpathIterator *const iterator,
+                          CipEpathSegment *const segment);
+
+/** @brief Decodes the next segment and moves past it
+ *
+ * @see CipEpathIteratorPeek()
+ */
+bool CipEpathIteratorNext(CipEpathIterator *const iterator,
+                          CipEpathSegment *const segment);
+
+/** @brief Moves past a segment returned by CipEpathIteratorPeek() */
+void CipEpathIteratorSkip(CipEpathIterator *const iterator,
+                          const CipEpathSegment *const segment);
+
+/** @brief Bytes of the path after the current position */
+size_t CipEpathIteratorRemaining(const CipEpathIterator *const iterator);
+
 /** @brief Gets the basic segment type of a CIP EPath
  *
  * @param cip_path The start of the EPath message
@@ -122,8 +122,8 @@ static EipStatus GetAndClearEthernetLink(
  *          -1 .. error
  */
 int DecodeCipEthernetLinkInterfaceControl(
-		CipEthernetLinkInterfaceControl *const data,
-		const CipMessageRouterRequest *const message_router_request,
+		void *const data,
+		CipMessageRouterRequest *const message_router_request,
 		CipMessageRouterResponse *const message_router_response);
 #endif
 
@@ -218,7 +218,7 @@ static EipStatus GetAttributeAllEthernetLink(
   (void)originator_address;
   (void)encapsulation_session;
 
-  InitializeENIPMessage(&message_router_response->message);
+  ClearENIPMessage(&message_router_response->message);
 
   if (0 == instance->cip_class->number_of_attributes) {
     message_router_response->reply_service =
@@ -232,7 +232,13 @@ static EipStatus GetAttributeAllEthernetLink(
                                    message_router_response);
   message_router_response->general_status = kCipErrorSuccess;
 
-  CipAttributeStruct *attribute = instance->attributes;
+  /* MAC address, type, label and capabilities are encoded once */
+  if (EncodeGetAttributeAllFromCache(instance, message_router_request,
+                                     message_router_response, true)) {
+    return kEipStatusOkSend;
+  }
+
+  const CipAttributeStruct *attribute = instance->attributes;
   for (size_t j = 0; j < instance->cip_class->number_of_attributes; ++j) {
     EipUint16 attribute_number = attribute->attribute_number;
     if ( (instance->cip_class->get_all_bit_mask[CalculateIndex(attribute_number)])
@@ -246,7 +252,7 @@ static EipStatus GetAttributeAllEthernetLink(
                                             message_router_request->service);
       }
 
-      attribute->encode(attribute->data, &message_router_response->message);
+      EncodeCipAttribute(attribute, &message_router_response->message);
 
       if ((attribute->attribute_flags & kPostGetFunc) &&
           NULL != instance->cip_class->PostGetCallback) {
@@ -270,6 +276,73 @@ void CipEthernetLinkSetInterfaceState(CipInstanceNum instance,
   s_interface_state[idx] = (CipUsint)state;
 }
 
+#if defined(OPENER_ETHLINK_CNTRS_ENABLE) && 0 != OPENER_ETHLINK_CNTRS_ENABLE
+  #define ETHLINK_COUNTERS_ATTRIBUTES(idx) \
+  CIP_ATTRIBUTE(4, kCipAny, EncodeCipEthernetLinkInterfaceCounters, NULL, \
+                &g_ethernet_link[idx].interface_cntrs, \
+                kGetableSingleAndAll | kPreGetFunc), \
+  CIP_ATTRIBUTE(5, kCipAny, EncodeCipEthernetLinkMediaCounters, NULL, \
+                &g_ethernet_link[idx].media_cntrs, \
+                kGetableSingleAndAll | kPreGetFunc)
+#else
+  #define ETHLINK_COUNTERS_ATTRIBUTES(idx) \
+  CIP_ATTRIBUTE(4, kCipAny, EncodeCipEthernetLinkInterfaceCounters, NULL, \
+                &dummy_attribute_udint, kGetableSingleAndAll), \
+  CIP_ATTRIBUTE(5, kCipAny, EncodeCipEthernetLinkMediaCounters, NULL, \
+                &dummy_attribute_udint, kGetableSingleAndAll)
+#endif  /* ... && 0 != OPENER_ETHLINK_CNTRS_ENABLE */
+
+#if defined(OPENER_ETHLINK_IFACE_CTRL_ENABLE) && \
+  0 != OPENER_ETHLINK_IFACE_CTRL_ENABLE
+  #define ETHLINK_IFACE_CTRL_ATTRIBUTE(idx, access_mode) \
+  CIP_ATTRIBUTE(6, kCipAny, EncodeCipEthernetLinkInterfaceControl, \
+                DecodeCipEthernetLinkInterfaceControl, \
+                &g_ethernet_link[idx].interface_control, access_mode)
+#else
+  #define ETHLINK_IFACE_CTRL_ATTRIBUTE(idx, access_mode) \
+  CIP_ATTRIBUTE(6, kCipAny, EncodeCipEthernetLinkInterfaceControl, NULL, \
+                &s_interface_control, kGetableAll)
+#endif
+
+/* The attributes of instance idx + 1 */
+#define ETHLINK_INSTANCE_ATTRIBUTES(idx, iface_ctrl_access_mode) { \
+    CIP_ATTRIBUTE(1, kCipUdint, EncodeCipUdint, NULL, \
+                  &g_ethernet_link[idx].interface_speed, kGetableSingleAndAll), \
+    CIP_ATTRIBUTE(2, kCipDword, EncodeCipDword, NULL, \
+                  &g_ethernet_link[idx].interface_flags, kGetableSingleAndAll), \
+    CIP_ATTRIBUTE(3, kCip6Usint, EncodeCipEthernetLinkPhyisicalAddress, NULL, \
+                  &g_ethernet_link[idx].physical_address, \
+                  kGetableSingleAndAll | kGetableAllStatic), \
+    ETHLINK_COUNTERS_ATTRIBUTES(idx), \
+    ETHLINK_IFACE_CTRL_ATTRIBUTE(idx, iface_ctrl_access_mode), \
+    CIP_ATTRIBUTE(7, kCipUsint, EncodeCipUsint, NULL, \
+                  &g_ethernet_link[idx].interface_type, \
+                  kGetableSingleAndAll | kGetableAllStatic), \
+    CIP_ATTRIBUTE(8, kCipUsint, EncodeCipUsint, NULL, &s_interface_state[idx], \
+                  kGetableAllDummy), \
+    CIP_ATTRIBUTE(9, kCipUsint, EncodeCipUsint, NULL, &dummy_attribute_usint, \
+                  kGetableAllDummy), \
+    CIP_ATTRIBUTE(10, kCipShortString, EncodeCipShortString, NULL, \
+                  &g_ethernet_link[idx].interface_label, \
+                  IFACE_LABEL_ACCESS_MODE | kGetableAllStatic), \
+    CIP_ATTRIBUTE(11, kCipAny, EncodeCipEthernetLinkInterfaceCaps, NULL, \
+                  &g_ethernet_link[idx].interface_caps, \
+                  kGetableSingleAndAll | kGetableAllStatic), \
+}
+
+/* The instance attributes, kept in flash */
+static const CipAttributeStruct kEthernetLinkInstanceAttributes[
+  OPENER_ETHLINK_INSTANCE_CNT][11] = {
+  ETHLINK_INSTANCE_ATTRIBUTES(0, IFACE_CTRL_ACCESS_MODE),
+#if OPENER_ETHLINK_INSTANCE_CNT > 1
+  ETHLINK_INSTANCE_ATTRIBUTES(1, IFACE_CTRL_ACCESS_MODE),
+#endif
+#if OPENER_ETHLINK_INSTANCE_CNT > 2
+  /* Interface control of internal switch port is never settable. */
+  ETHLINK_INSTANCE_ATTRIBUTES(2, IFACE_CTRL_ACCESS_MODE & ~kSetable),
+#endif
+};
+
 EipStatus CipEthernetLinkInit(void) {
   CipClass *ethernet_link_class = CreateCipClass(kCipEthernetLinkClassCode,
                                                  0,
@@ -278,8 +351,8 @@ EipStatus CipEthernetLinkInit(void) {
                                                  /* # highest class attribute number*/
                                                  2,
                                                  /* # class services*/
-                                                 11,
-                                                 /* # instance attributes*/
+                                                 0,
+                                                 /* # instance attributes, from kEthernetLinkInstanceAttributes*/
                                                  11,
                                                  /* # highest instance attribute number*/
                                                  /* # instance services follow */
@@ -340,124 +413,10 @@ EipStatus CipEthernetLinkInit(void) {
 
     /* bind attributes to the instance */
     for (CipInstanceNum idx = 0; idx < OPENER_ETHLINK_INSTANCE_CNT; ++idx) {
-      CipInstance *ethernet_link_instance =
-        GetCipInstance( ethernet_link_class, (CipInstanceNum)(idx + 1) );
-
-      InsertAttribute(ethernet_link_instance,
-                      1,
-                      kCipUdint,
-                      EncodeCipUdint,
-                      NULL,
-                      &g_ethernet_link[idx].interface_speed,
-                      kGetableSingleAndAll);
-      InsertAttribute(ethernet_link_instance,
-                      2,
-                      kCipDword,
-                      EncodeCipDword,
-                      NULL,
-                      &g_ethernet_link[idx].interface_flags,
-                      kGetableSingleAndAll);
-      InsertAttribute(ethernet_link_instance,
-                      3,
-                      kCip6Usint,
-                      EncodeCipEthernetLinkPhyisicalAddress,
-                      NULL,
-                      &g_ethernet_link[idx].physical_address,
-                      kGetableSingleAndAll);
-#if defined(OPENER_ETHLINK_CNTRS_ENABLE) && 0 != OPENER_ETHLINK_CNTRS_ENABLE
-      InsertAttribute(ethernet_link_instance,
-                      4,
-                      kCipAny,
-                      EncodeCipEthernetLinkInterfaceCounters,
-                      NULL,
-                      &g_ethernet_link[idx].interface_cntrs,
-                      kGetableSingleAndAll);
-      InsertAttribute(ethernet_link_instance,
-                      5,
-                      kCipAny,
-                      EncodeCipEthernetLinkMediaCounters,
-                      NULL,
-                      &g_ethernet_link[idx].media_cntrs,
-                      kGetableSingleAndAll);
-#else
-      InsertAttribute(ethernet_link_instance,
-                      4,
-                      kCipAny,
-                      EncodeCipEthernetLinkInterfaceCounters,
-                      NULL,
-                      &dummy_attribute_udint,
-                      kGetableSingleAndAll);
-      InsertAttribute(ethernet_link_instance,
-                      5,
-                      kCipAny,
-                      EncodeCipEthernetLinkMediaCounters,
-                      NULL,
-                      &dummy_attribute_udint,
-                      kGetableSingleAndAll);
-#endif  /* ... && 0 != OPENER_ETHLINK_CNTRS_ENABLE */
-#if defined(OPENER_ETHLINK_IFACE_CTRL_ENABLE) && \
-      0 != OPENER_ETHLINK_IFACE_CTRL_ENABLE
-      if (2 == idx) {
-        /* Interface control of internal switch port is never settable. */
-        InsertAttribute(ethernet_link_instance,
-                        6,
-                        kCipAny,
-                        EncodeCipEthernetLinkInterfaceControl,
-                        DecodeCipEthernetLinkInterfaceControl,
-                        &g_ethernet_link[idx].interface_control,
-                        IFACE_CTRL_ACCESS_MODE & ~kSetable);
-      } else {
-        InsertAttribute(ethernet_link_instance,
-                        6,
-                        kCipAny,
-                        EncodeCipEthernetLinkInterfaceControl,
-                        DecodeCipEthernetLinkInterfaceControl,
-                        &g_ethernet_link[idx].interface_control,
-                        IFACE_CTRL_ACCESS_MODE);
-      }
-#else
-      InsertAttribute(ethernet_link_instance,
-                      6,
-                      kCipAny,
-                      EncodeCipEthernetLinkInterfaceControl,
-                      NULL,
-                      &s_interface_control,
-                      kGetableAll);
-#endif
-      InsertAttribute(ethernet_link_instance,
-                      7,
-                      kCipUsint,
-                      EncodeCipUsint,
-                      NULL,
-                      &g_ethernet_link[idx].interface_type,
-                      kGetableSingleAndAll);
-      InsertAttribute(ethernet_link_instance,
-                      8,
-                      kCipUsint,
-                      EncodeCipUsint,
-                      NULL,
-                      &s_interface_state[idx],
-                      kGetableAllDummy);
-      InsertAttribute(ethernet_link_instance,
-                      9,
-                      kCipUsint,
-                      EncodeCipUsint,
-                      NULL,
-                      &dummy_attribute_usint, kGetableAllDummy);
-      InsertAttribute(ethernet_link_instance,
-                      10,
-                      kCipShortString,
-                      EncodeCipShortString,
-                      NULL,
-                      &g_ethernet_link[idx].interface_label,
-                      IFACE_LABEL_ACCESS_MODE);
-      InsertAttribute(ethernet_link_instance,
-                      11,
-                      kCipAny,
-                      EncodeCipEthernetLinkInterfaceCaps,
-                      NULL,
-                      &g_ethernet_link[idx].interface_caps,
-                      kGetableSingleAndAll);
+      SetCipInstanceAttributes(
+        GetCipInstance( ethernet_link_class, (CipInstanceNum)(idx + 1) ),
+        kEthernetLinkInstanceAttributes[idx],
+        NELEMENTS(kEthernetLinkInstanceAttributes[idx]) );
     }
   } else {
     return kEipStatusError;
@@ -467,11 +426,18 @@ EipStatus CipEthernetLinkInit(void) {
 }
 
 void CipEthernetLinkSetMac(EipUint8 *p_physical_address) {
+  /* NULL if called before CipEthernetLinkInit() */
+  const CipClass *const ethernet_link_class =
+    GetCipClass(kCipEthernetLinkClassCode);
   for (size_t idx = 0; idx < OPENER_ETHLINK_INSTANCE_CNT; ++idx) {
     memcpy(g_ethernet_link[idx].physical_address,
            p_physical_address,
            sizeof(g_ethernet_link[0].physical_address)
            );
+    if (NULL != ethernet_link_class) {
+      InvalidateGetAttributeAllCache(
+        GetCipInstance(ethernet_link_class, (CipInstanceNum)(idx + 1) ) );
+    }
   }
   return;
 }
@@ -485,9 +451,9 @@ static void EncodeCipEthernetLinkInterfaceCounters(const void *const data,
 #if defined(OPENER_ETHLINK_CNTRS_ENABLE) && 0 != OPENER_ETHLINK_CNTRS_ENABLE
   const CipEthernetLinkInterfaceCounters *counters =
     (const CipEthernetLinkInterfaceCounters *)data;
-  for (size_t i = 0; i < (sizeof(counters->cntr32) / sizeof(counters->cntr32[0])); ++i) {
-    EncodeCipUdint(&counters->cntr32[i], outgoing_message);
-  }
+  EncodeUdintArray(counters->cntr32,
+                   sizeof(counters->cntr32) / sizeof(counters->cntr32[0]),
+                   outgoing_message);
 #else
   /* Encode the default counter value of 0 */
   FillNextNMessageOctetsWithValueAndMoveToNextPosition(0,
@@ -505,9 +471,9 @@ static void EncodeCipEthernetLinkMediaCounters(const void *const data,
 #if defined(OPENER_ETHLINK_CNTRS_ENABLE) && 0 != OPENER_ETHLINK_CNTRS_ENABLE
   const CipEthernetLinkMediaCounters *counters =
     (const CipEthernetLinkMediaCounters *)data;
-  for (size_t i = 0; i < (sizeof(counters->cntr32) / sizeof(counters->cntr32[0])); ++i) {
-    EncodeCipUdint(&counters->cntr32[i], outgoing_message);
-  }
+  EncodeUdintArray(counters->cntr32,
+                   sizeof(counters->cntr32) / sizeof(counters->cntr32[0]),
+                   outgoing_message);
 #else
   /* Encode the default counter value of 0 */
   FillNextNMessageOctetsWithValueAndMoveToNextPosition(0,
@@ -533,7 +499,6 @@ static void EncodeCipEthernetLinkInterfaceControl(const void *const data,
   EncodeCipUint(&interface_control->forced_interface_speed, outgoing_message);
 }
 
-#define NELEMENTS(x)  ( (sizeof(x) / sizeof(x[0]) ) )
 static void EncodeCipEthernetLinkInterfaceCaps(const void *const data,
                                                ENIPMessage *const outgoing_message)
 {
@@ -565,7 +530,7 @@ static EipStatus GetAndClearEthernetLink(
   const struct sockaddr *originator_address,
   const CipSessionHandle encapsulation_session) {
 
-  CipAttributeStruct *attribute = GetCipAttribute(
+  const CipAttributeStruct *attribute = GetCipAttribute(
     instance, message_router_request->request_path.attribute_number);
 
   (void)originator_address;
@@ -588,7 +553,7 @@ static EipStatus GetAndClearEthernetLink(
                                           message_router_request->service);
     }
 
-    attribute->encode(attribute->data, &message_router_response->message);
+    EncodeCipAttribute(attribute, &message_router_response->message);
     message_router_response->general_status = kCipErrorSuccess;
 
     if ((attribute->attribute_flags & kPostGetFunc) &&
@@ -624,7 +589,7 @@ static bool IsIfaceControlAllowed(CipInstanceNum instance_id,
 }
 
 int DecodeCipEthernetLinkInterfaceControl(
-		CipEthernetLinkInterfaceControl *const data,
+		void *const data,
 		CipMessageRouterRequest *const message_router_request,
 		CipMessageRouterResponse *const message_router_response) {
 
@@ -663,7 +628,7 @@ int DecodeCipEthernetLinkInterfaceControl(
 					return number_of_decoded_bytes;
 				}
 			}
-			*data = if_cntrl; //write data to attribute
+			*(CipEthernetLinkInterfaceControl *)data = if_cntrl; //write data to attribute
 			message_router_response->general_status = kCipErrorSuccess;
 			number_of_decoded_bytes = 4;
 		}
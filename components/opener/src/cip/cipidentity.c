@@ -55,25 +55,37 @@ CipIdentityObject g_identity = { .vendor_id = OPENER_DEVICE_VENDOR_ID, /* Attrib
                                  .state = kStateSelfTesting /* Attribute 8: State */
                                  };
 
+/* The setters of the attributes flagged kGetableAllStatic call this */
+static void IdentityStaticAttributeChanged(void) {
+  CipClass *const identity_class = GetCipClass(kCipIdentityClassCode);
+  if(NULL != identity_class) {
+    InvalidateGetAttributeAllCache(GetCipInstance(identity_class, 1) );
+  }
+}
+
 /* The Doxygen comment is with the function's prototype in opener_api.h. */
 void SetDeviceRevision(EipUint8 major, EipUint8 minor) {
   g_identity.revision.major_revision = major;
   g_identity.revision.minor_revision = minor;
+  IdentityStaticAttributeChanged();
 }
 
 /* The Doxygen comment is with the function's prototype in opener_api.h. */
 void SetDeviceSerialNumber(const EipUint32 serial_number) {
   g_identity.serial_number = serial_number;
+  IdentityStaticAttributeChanged();
 }
 
 /* The Doxygen comment is with the function's prototype in opener_api.h. */
 void SetDeviceType(const EipUint16 type) {
   g_identity.device_type = type;
+  IdentityStaticAttributeChanged();
 }
 
 /* The Doxygen comment is with the function's prototype in opener_api.h. */
 void SetDeviceProductCode(const EipUint16 code) {
   g_identity.product_code = code;
+  IdentityStaticAttributeChanged();
 }
 
 /* The Doxygen comment is with the function's prototype in opener_api.h. */
@@ -85,6 +97,7 @@ void SetDeviceStatus(const CipWord status) {
 /* The Doxygen comment is with the function's prototype in opener_api.h. */
 void SetDeviceVendorId(CipUint vendor_id) {
   g_identity.vendor_id = vendor_id;
+  IdentityStaticAttributeChanged();
 }
 
 /* The Doxygen comment is with the function's prototype in opener_api.h. */
@@ -97,12 +110,13 @@ void SetDeviceProductName(const char *product_name) {
   if (!product_name)
     return;
 
-  SetCipShortStringByCstr(&g_identity.product_name, product_name);
+  (void) CIP_STRING_FIXED_SET_BY_CSTR(&g_identity.product_name, product_name);
+  IdentityStaticAttributeChanged();
 }
 
 /* The Doxygen comment is with the function's prototype in opener_api.h. */
-CipShortString *GetDeviceProductName(void) {
-  return &g_identity.product_name;
+CipStringFixed *GetDeviceProductName(void) {
+  return &g_identity.product_name.header;
 }
 
 static inline void MergeStatusAndExtStatus(void) {
@@ -247,12 +261,33 @@ void EncodeRevision(const void *const data,
   AddSintToMessage(revision->minor_revision, outgoing_message);
 }
 
+/* The instance attributes, kept in flash */
+static const CipAttributeStruct kIdentityInstanceAttributes[] = {
+  CIP_ATTRIBUTE(1, kCipUint, EncodeCipUint, NULL, &g_identity.vendor_id,
+                kGetableSingleAndAll | kGetableAllStatic),
+  CIP_ATTRIBUTE(2, kCipUint, EncodeCipUint, NULL, &g_identity.device_type,
+                kGetableSingleAndAll | kGetableAllStatic),
+  CIP_ATTRIBUTE(3, kCipUint, EncodeCipUint, NULL, &g_identity.product_code,
+                kGetableSingleAndAll | kGetableAllStatic),
+  CIP_ATTRIBUTE(4, kCipUsintUsint, EncodeRevision, NULL, &g_identity.revision,
+                kGetableSingleAndAll | kGetableAllStatic),
+  CIP_ATTRIBUTE(5, kCipWord, EncodeCipWord, NULL, &g_identity.status,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(6, kCipUdint, EncodeCipUdint, NULL, &g_identity.serial_number,
+                kGetableSingleAndAll | kGetableAllStatic),
+  CIP_ATTRIBUTE(7, kCipShortString, EncodeCipShortStringFixed, NULL,
+                &g_identity.product_name,
+                kGetableSingleAndAll | kGetableAllStatic),
+  CIP_ATTRIBUTE(8, kCipUsint, EncodeCipUsint, NULL, &g_identity.state,
+                kGetableSingleAndAll),
+};
+
 EipStatus CipIdentityInit() {
 
   CipClass *class = CreateCipClass(kCipIdentityClassCode, 0, /* # of non-default class attributes */
                                    7, /* # highest class attribute number*/
                                    2, /* # of class services*/
-                                   8, /* # of instance attributes*/
+                                   0, /* # of instance attributes, from kIdentityInstanceAttributes*/
                                    8, /* # highest instance attribute number*/
                                    5, /* # of instance services*/
                                    1, /* # of instances*/
@@ -264,26 +299,12 @@ EipStatus CipIdentityInit() {
     return kEipStatusError;
   }
 
-  if (g_identity.product_name.length == 0)
+  if (g_identity.product_name.header.length == 0)
     SetDeviceProductName(OPENER_DEVICE_NAME);
 
-  CipInstance *instance = GetCipInstance(class, 1);
-  InsertAttribute(instance, 1, kCipUint, EncodeCipUint,
-                  NULL, &g_identity.vendor_id, kGetableSingleAndAll);
-  InsertAttribute(instance, 2, kCipUint, EncodeCipUint,
-                  NULL, &g_identity.device_type, kGetableSingleAndAll);
-  InsertAttribute(instance, 3, kCipUint, EncodeCipUint,
-                  NULL, &g_identity.product_code, kGetableSingleAndAll);
-  InsertAttribute(instance, 4, kCipUsintUsint, EncodeRevision,
-                  NULL, &g_identity.revision, kGetableSingleAndAll);
-  InsertAttribute(instance, 5, kCipWord, EncodeCipWord,
-                  NULL, &g_identity.status, kGetableSingleAndAll);
-  InsertAttribute(instance, 6, kCipUdint, EncodeCipUdint,
-                  NULL, &g_identity.serial_number, kGetableSingleAndAll);
-  InsertAttribute(instance, 7, kCipShortString, EncodeCipShortString,
-                  NULL, &g_identity.product_name, kGetableSingleAndAll);
-  InsertAttribute(instance, 8, kCipUsint, EncodeCipUsint,
-                  NULL, &g_identity.state, kGetableSingleAndAll);
+  SetCipInstanceAttributes(GetCipInstance(class, 1),
+                           kIdentityInstanceAttributes,
+                           NELEMENTS(kIdentityInstanceAttributes) );
 
   InsertService(class,
                 kGetAttributeSingle,
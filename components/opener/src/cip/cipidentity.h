@@ -55,6 +55,9 @@ typedef enum {
   kStateDefault = 255U
 } CipIdentityState;
 
+/** @brief Longest Product Name, Vol. 1 Table 5A-2.7 */
+#define CIP_IDENTITY_MAX_PRODUCT_NAME_LENGTH 32
+
 /** @brief Declaration of the Identity object's structure type
  */
 typedef struct {
@@ -65,7 +68,7 @@ typedef struct {
   CipWord status; /**< Attribute 5: Status */
   CipWord ext_status;   /**< Attribute 5: last set extended status, needed for Status handling */
   CipUdint serial_number; /**< Attribute 6: Serial Number, has to be set prior to OpENer's network initialization */
-  CipShortString product_name; /**< Attribute 7: Product Name */
+  CIP_STRING_FIXED(CIP_IDENTITY_MAX_PRODUCT_NAME_LENGTH) product_name; /**< Attribute 7: Product Name */
   CipUsint state; /** Attribute 8: state, this member could control the Module Status LED blink pattern */
 } CipIdentityObject;
 
@@ -16,11 +16,15 @@
 #include "cipidentity.h"
 #include "ciptcpipinterface.h"
 #include "cipcommon.h"
+#include "cipconnectiondiagnostics.h"
+#include "cipqos.h"
 #include "appcontype.h"
 #include "cpf.h"
 #include "trace.h"
 #include "endianconv.h"
 #include "opener_error.h"
+#include "latency_probe.h"
+#include "trace_event.h"
 
 /* producing multicast connection have to consider the rules that apply for
  * application connection types.
@@ -41,7 +45,9 @@ CipError OpenProducingPointToPointConnection(
   CipConnectionObject *connection_object,
   CipCommonPacketFormatData *common_packet_format_data);
 
-CipError OpenCommunicationChannels(CipConnectionObject *connection_object);
+CipError OpenCommunicationChannels(
+  CipConnectionObject *connection_object,
+  CipCommonPacketFormatData *common_packet_format_data);
 void CloseCommunicationChannelsAndRemoveFromActiveConnectionsList(
   CipConnectionObject *connection_object);
 
@@ -66,11 +72,32 @@ EipStatus HandleReceivedIoConnectionData(CipConnectionObject *connection_object,
                                          const EipUint8 *data,
                                          EipUint16 data_length);
 
+static void BuildIoFrameTemplate(CipConnectionObject *const connection_object);
+
+/** @brief Offset of the EIP level sequence number in a sequenced address item frame */
+static const size_t kIoFrameEipSequenceNumberOffset = 10;
+
 /**** Global variables ****/
 EipUint8 *g_config_data_buffer = NULL; /**< buffers for the config data coming with a forward open request. */
 unsigned int g_config_data_length = 0; /**< length of g_config_data_buffer. Initialized with 0 */
 
-EipUint32 g_run_idle_state = 0; /**< buffer for holding the run idle information. */
+#ifndef OPENER_IO_CONNECTION_STANDBY_MS
+/** Time a timed out point-to-point I/O connection keeps its socket for a
+ * re-open of the same originator, 0 closes it right away */
+#define OPENER_IO_CONNECTION_STANDBY_MS 0
+#endif
+
+/** UDP socket of a timed out connection a re-open took over, see
+ * TakeOverTimedOutIoConnection(). Only valid during EstablishIoConnection(). */
+static int s_standby_socket = kEipInvalidSocket;
+
+/** Run/idle state of the device, derived from the owners by
+ * IoConnectionUpdateRunIdle(), valid while s_run_idle_reported */
+static EipUint32 s_run_idle_state = 0;
+static bool s_run_idle_reported = false;
+
+/** Nesting of IoConnectionBeginBatchClose(), closes are batched while not 0 */
+static unsigned int s_batch_close_depth = 0;
 
 /**** Local variables, set by API, with build-time defaults ****/
 #ifdef OPENER_CONSUMED_DATA_HAS_RUN_IDLE_HEADER
@@ -136,10 +163,24 @@ void SetIoConnectionCallbacks(CipConnectionObject *const io_connection_object) {
     HandleReceivedIoConnectionData;
 }
 
+/** @brief Size of attribute 3 of the assembly of a connection point */
+static EipUint16 GetConnectionPointDataLength(
+  const CipInstance *const instance) {
+#if OPENER_SEALED_CONFIGURATION
+  return (EipUint16) GetSealedAssemblySize(instance->instance_number);
+#else
+  /* an assembly object should always have a data attribute. */
+  const CipAttributeStruct *attribute = GetCipAttribute(instance,
+                                                  kAssemblyObjectInstanceAttributeIdData);
+  OPENER_ASSERT(attribute != NULL);
+  return ( (const CipByteArray *) attribute->data )->length;
+#endif
+}
+
 EipUint16 SetupIoConnectionOriginatorToTargetConnectionPoint(
   CipConnectionObject *const io_connection_object,
   CipConnectionObject *const RESTRICT connection_object) {
-  CipClass *const assembly_class = GetCipClass(kCipAssemblyClassCode);
+  CipClass *const assembly_class = GetAssemblyClass();
   CipInstance *instance = NULL;
   if( NULL !=
       ( instance =
@@ -159,11 +200,8 @@ EipUint16 SetupIoConnectionOriginatorToTargetConnectionPoint(
     OPENER_TRACE_INFO("O->T requested size: %d bytes\n", data_size);
     int diff_size = 0;
 
-    /* an assembly object should always have a data attribute. */
-    CipAttributeStruct *attribute = GetCipAttribute(instance,
-                                                    kAssemblyObjectInstanceAttributeIdData);
-    OPENER_ASSERT(attribute != NULL);
-    bool is_heartbeat = ( ( (CipByteArray *) attribute->data )->length == 0 );
+    const EipUint16 assembly_length = GetConnectionPointDataLength(instance);
+    bool is_heartbeat = (assembly_length == 0);
     if( kConnectionObjectTransportClassTriggerTransportClass1 ==
         ConnectionObjectGetTransportClassTriggerTransportClass(
           io_connection_object) )
@@ -173,8 +211,7 @@ EipUint16 SetupIoConnectionOriginatorToTargetConnectionPoint(
       diff_size += 2;
     }
 
-    EipInt16 length_gap =
-      data_size - ( (CipByteArray *) attribute->data )->length;
+    EipInt16 length_gap = data_size - assembly_length;
     if( (length_gap == 4) && !s_consume_run_idle ) {
       OPENER_TRACE_INFO(
         "Applying implicit run/idle header compensation for consuming data\n");
@@ -190,15 +227,15 @@ EipUint16 SetupIoConnectionOriginatorToTargetConnectionPoint(
     }
     OPENER_TRACE_INFO("O->T expect data len %d (assembly %d, diff %d)\n",
                       data_size,
-                      ( (CipByteArray *) attribute->data )->length,
+                      assembly_length,
                       diff_size);
 
-    if( ( (CipByteArray *) attribute->data )->length != data_size ) {
+    if(assembly_length != data_size) {
       /*wrong connection size */
       connection_object->correct_originator_to_target_size =
-        ( (CipByteArray *) attribute->data )->length + diff_size;
+        assembly_length + diff_size;
       OPENER_TRACE_ERR("O->T size mismatch: assembly len %d, expected %d\n",
-                       ( (CipByteArray *) attribute->data )->length,
+                       assembly_length,
                        data_size);
       return kConnectionManagerExtendedStatusCodeErrorInvalidOToTConnectionSize;
     }
@@ -211,57 +248,58 @@ EipUint16 SetupIoConnectionOriginatorToTargetConnectionPoint(
 EipUint16 SetupIoConnectionTargetToOriginatorConnectionPoint(
   CipConnectionObject *const io_connection_object,
   CipConnectionObject *const RESTRICT connection_object) {
-  DoublyLinkedListNode *node = connection_list.first;
-  while( NULL != node &&
-         kConnectionObjectConnectionTypeMulticast ==
-         ConnectionObjectGetTToOConnectionType(io_connection_object) ) {
-    CipConnectionObject *iterator = node->data;
-    if(io_connection_object->produced_path.instance_id ==
-       iterator->produced_path.instance_id) {
-      //Check parameters
-      if( ConnectionObjectGetTToORequestedPacketInterval(io_connection_object)
-          !=
-          ConnectionObjectGetTToORequestedPacketInterval(iterator) ) {
-        return kConnectionManagerExtendedStatusCodeErrorRpiValuesNotAcceptable;
-      }
-      if( ConnectionObjectGetTToOConnectionSizeType(io_connection_object) !=
-          ConnectionObjectGetTToOConnectionSizeType(iterator) ) {
-        return
-          kConnectionManagerExtendedStatusCodeMismatchedTToONetworkConnectionFixVar;
-      }
-      if( ConnectionObjectGetTToOPriority(io_connection_object) !=
-          ConnectionObjectGetTToOPriority(iterator) ) {
-        return
-          kConnectionManagerExtendedStatusCodeMismatchedTToONetworkConnectionPriority;
-      }
-
-      if( ConnectionObjectGetTransportClassTriggerTransportClass(
-            io_connection_object) !=
-          ConnectionObjectGetTransportClassTriggerTransportClass(iterator) ) {
-        return kConnectionManagerExtendedStatusCodeMismatchedTransportClass;
-      }
-
-      if( ConnectionObjectGetTransportClassTriggerProductionTrigger(
-            io_connection_object)
-          != ConnectionObjectGetTransportClassTriggerProductionTrigger(iterator) )
-      {
-        return
-          kConnectionManagerExtendedStatusCodeMismatchedTToOProductionTrigger;
-      }
+  ConnectionIndexIterator producers;
+  ProducedInstanceIteratorBegin(&producers,
+                                io_connection_object->produced_path.instance_id);
+  CipConnectionObject *iterator = NULL;
+  while( kConnectionObjectConnectionTypeMulticast ==
+         ConnectionObjectGetTToOConnectionType(io_connection_object) &&
+         NULL != (iterator = ProducedInstanceIteratorNext(&producers) ) ) {
+    //Check parameters
+    if( ConnectionObjectGetTToORequestedPacketInterval(io_connection_object)
+        !=
+        ConnectionObjectGetTToORequestedPacketInterval(iterator) ) {
+      connection_object->correct_originator_to_target_packet_interval = 0;
+      connection_object->correct_target_to_originator_packet_interval =
+        ConnectionObjectGetTToORequestedPacketInterval(iterator);
+      connection_object->correct_packet_interval_types =
+        kConnectionManagerRpiTypeRequired << 8;
+      return kConnectionManagerExtendedStatusCodeErrorRpiValuesNotAcceptable;
+    }
+    if( ConnectionObjectGetTToOConnectionSizeType(io_connection_object) !=
+        ConnectionObjectGetTToOConnectionSizeType(iterator) ) {
+      return
+        kConnectionManagerExtendedStatusCodeMismatchedTToONetworkConnectionFixVar;
+    }
+    if( ConnectionObjectGetTToOPriority(io_connection_object) !=
+        ConnectionObjectGetTToOPriority(iterator) ) {
+      return
+        kConnectionManagerExtendedStatusCodeMismatchedTToONetworkConnectionPriority;
+    }
 
-      if( ConnectionObjectGetProductionInhibitTime(io_connection_object) !=
-          ConnectionObjectGetProductionInhibitTime(iterator) ) {
-        return
-          kConnectionManagerExtendedStatusCodeMismatchedTToOProductionInhibitTimeSegment;
-      }
+    if( ConnectionObjectGetTransportClassTriggerTransportClass(
+          io_connection_object) !=
+        ConnectionObjectGetTransportClassTriggerTransportClass(iterator) ) {
+      return kConnectionManagerExtendedStatusCodeMismatchedTransportClass;
+    }
 
+    if( ConnectionObjectGetTransportClassTriggerProductionTrigger(
+          io_connection_object)
+        != ConnectionObjectGetTransportClassTriggerProductionTrigger(iterator) )
+    {
+      return
+        kConnectionManagerExtendedStatusCodeMismatchedTToOProductionTrigger;
     }
 
-    node = node->next;
+    if( ConnectionObjectGetProductionInhibitTime(io_connection_object) !=
+        ConnectionObjectGetProductionInhibitTime(iterator) ) {
+      return
+        kConnectionManagerExtendedStatusCodeMismatchedTToOProductionInhibitTimeSegment;
+    }
   }
 
   /*setup producer side*/
-  CipClass *const assembly_class = GetCipClass(kCipAssemblyClassCode);
+  CipClass *const assembly_class = GetAssemblyClass();
   CipInstance *instance = NULL;
   if( NULL !=
       ( instance =
@@ -275,10 +313,8 @@ EipUint16 SetupIoConnectionTargetToOriginatorConnectionPoint(
     /* an assembly object should always have a data attribute. */
     io_connection_object->produced_path.attribute_id_or_connection_point =
       kAssemblyObjectInstanceAttributeIdData;
-    CipAttributeStruct *attribute = GetCipAttribute(instance,
-                                                    kAssemblyObjectInstanceAttributeIdData);
-    OPENER_ASSERT(attribute != NULL);
-    bool is_heartbeat = ( ( (CipByteArray *) attribute->data )->length == 0 );
+    const EipUint16 assembly_length = GetConnectionPointDataLength(instance);
+    bool is_heartbeat = (assembly_length == 0);
     if( kConnectionObjectTransportClassTriggerTransportClass1 ==
         ConnectionObjectGetTransportClassTriggerTransportClass(
           io_connection_object) )
@@ -293,14 +329,14 @@ EipUint16 SetupIoConnectionTargetToOriginatorConnectionPoint(
     }
     OPENER_TRACE_INFO("T->O expect data len %d (assembly %d, diff %d)\n",
                       data_size,
-                      ( (CipByteArray *) attribute->data )->length,
+                      assembly_length,
                       diff_size);
-    if( ( (CipByteArray *) attribute->data )->length != data_size ) {
+    if(assembly_length != data_size) {
       /*wrong connection size*/
       connection_object->correct_target_to_originator_size =
-        ( (CipByteArray *) attribute->data )->length + diff_size;
+        assembly_length + diff_size;
       OPENER_TRACE_ERR("T->O size mismatch: assembly len %d, expected %d\n",
-                       ( (CipByteArray *) attribute->data )->length,
+                       assembly_length,
                        data_size);
       return kConnectionManagerExtendedStatusCodeErrorInvalidTToOConnectionSize;
     }
@@ -321,7 +357,106 @@ EipUint16 SetupIoConnectionTargetToOriginatorConnectionPoint(
  *    - kEipStatusOk ... on success
  *    - On an error the general status code to be put into the response
  */
-CipError EstablishIoConnection(
+/** @brief Check that a multicast connection can share the production of an
+ * already produced input
+ *
+ * All consumers of a multicast production receive the same frames, so the
+ * T->O parameters defining them have to match the existing production.
+ *
+ * @param io_connection_object the connection to be established
+ * @param connection_object the Forward Open data, receives the T->O RPI to
+ *        request in case of a RPI mismatch
+ * @return kConnectionManagerExtendedStatusCodeSuccess if no multicast
+ *         production exists yet or the parameters match, otherwise the
+ *         extended status of the mismatch
+ */
+static EipUint16 CheckSharedMulticastProduction(
+  const CipConnectionObject *const io_connection_object,
+  CipConnectionObject *const connection_object) {
+  const CipConnectionObject *const producer =
+    GetExistingProducerIoConnection(true,
+                                    io_connection_object->produced_path.
+                                    instance_id);
+  if(NULL == producer) {
+    return kConnectionManagerExtendedStatusCodeSuccess;
+  }
+
+  if(ConnectionObjectGetTransportClassTriggerTransportClass(
+       io_connection_object) !=
+     ConnectionObjectGetTransportClassTriggerTransportClass(producer) ) {
+    return kConnectionManagerExtendedStatusCodeMismatchedTransportClass;
+  }
+  if(ConnectionObjectGetTransportClassTriggerProductionTrigger(
+       io_connection_object) !=
+     ConnectionObjectGetTransportClassTriggerProductionTrigger(producer) ) {
+    return kConnectionManagerExtendedStatusCodeMismatchedTToOProductionTrigger;
+  }
+  if(ConnectionObjectGetTToOConnectionSizeType(io_connection_object) !=
+     ConnectionObjectGetTToOConnectionSizeType(producer) ) {
+    return kConnectionManagerExtendedStatusCodeMismatchedTToONetworkConnectionFixVar;
+  }
+  if(ConnectionObjectGetTToOPriority(io_connection_object) !=
+     ConnectionObjectGetTToOPriority(producer) ) {
+    return kConnectionManagerExtendedStatusCodeMismatchedTToONetworkConnectionPriority;
+  }
+  if(ConnectionObjectGetTToORequestedPacketInterval(io_connection_object) !=
+     ConnectionObjectGetTToORequestedPacketInterval(producer) ) {
+    OPENER_TRACE_INFO("T->O RPI %" PRIu32 " us does not match the multicast "
+                      "production with %" PRIu32 " us\n",
+                      ConnectionObjectGetTToORequestedPacketInterval(
+                        io_connection_object),
+                      ConnectionObjectGetTToORequestedPacketInterval(producer) );
+    connection_object->correct_originator_to_target_packet_interval = 0;
+    connection_object->correct_target_to_originator_packet_interval =
+      ConnectionObjectGetTToORequestedPacketInterval(producer);
+    connection_object->correct_packet_interval_types =
+      kConnectionManagerRpiTypeRequired << 8;
+    return kConnectionManagerExtendedStatusCodeErrorRpiValuesNotAcceptable;
+  }
+  if(ConnectionObjectGetProductionInhibitTime(io_connection_object) !=
+     ConnectionObjectGetProductionInhibitTime(producer) ) {
+    return
+      kConnectionManagerExtendedStatusCodeMismatchedTToOProductionInhibitTimeSegment;
+  }
+  return kConnectionManagerExtendedStatusCodeSuccess;
+}
+
+/** @brief Bind a connection opened over TLS to the DTLS session of its
+ *  originator
+ *
+ * CIP Security carries such I/O point-to-point only, and the originator sets
+ * up the DTLS session before it sends the Forward Open.
+ */
+static EipUint16 SetUpSecureTransport(
+  CipConnectionObject *const io_connection_object,
+  const ConnectionObjectConnectionType originator_to_target_connection_type,
+  const ConnectionObjectConnectionType target_to_originator_connection_type)
+{
+  io_connection_object->secure_transport = IsPeerSessionSecure();
+  if(!io_connection_object->secure_transport) {
+    return kConnectionManagerExtendedStatusCodeSuccess;
+  }
+  if(kConnectionObjectConnectionTypeMulticast ==
+     originator_to_target_connection_type) {
+    return kConnectionManagerExtendedStatusCodeErrorInvalidOToTConnectionType;
+  }
+  if(kConnectionObjectConnectionTypeMulticast ==
+     target_to_originator_connection_type) {
+    return kConnectionManagerExtendedStatusCodeErrorInvalidTToOConnectionType;
+  }
+#if defined(OPENER_CIP_SECURITY) && 0 != OPENER_CIP_SECURITY
+  io_connection_object->secure_tls_socket = g_current_active_tcp_socket;
+  if( !SecureTransportBindIoSession(g_current_active_tcp_socket,
+                                    GetPeerAddress(),
+                                    &io_connection_object->secure_peer) ) {
+    OPENER_TRACE_INFO("Forward Open over TLS without a DTLS session\n");
+    return kConnectionManagerExtendedStatusCodeMiscellaneous;
+  }
+#endif
+  return kConnectionManagerExtendedStatusCodeSuccess;
+}
+
+static CipError SetUpIoConnection(
   CipConnectionObject *RESTRICT const connection_object,
   EipUint16 *const extended_error) {
   CipError cip_error = kCipErrorSuccess;
@@ -355,6 +490,13 @@ CipError EstablishIoConnection(
       target_to_originator_connection_type ==
       kConnectionObjectConnectionTypeNull) );
 
+  *extended_error = SetUpSecureTransport(io_connection_object,
+                                         originator_to_target_connection_type,
+                                         target_to_originator_connection_type);
+  if(kConnectionManagerExtendedStatusCodeSuccess != *extended_error) {
+    return kCipErrorConnectionFailure;
+  }
+
   io_connection_object->consuming_instance = NULL;
   io_connection_object->consumed_connection_path_length = 0;
   io_connection_object->producing_instance = NULL;
@@ -380,6 +522,14 @@ CipError EstablishIoConnection(
     if(kConnectionManagerExtendedStatusCodeSuccess != *extended_error) {
       return kCipErrorConnectionFailure;
     }
+    if(kConnectionObjectConnectionTypeMulticast ==
+       target_to_originator_connection_type) {
+      *extended_error = CheckSharedMulticastProduction(io_connection_object,
+                                                       connection_object);
+      if(kConnectionManagerExtendedStatusCodeSuccess != *extended_error) {
+        return kCipErrorConnectionFailure;
+      }
+    }
   }
 
   if(NULL != g_config_data_buffer) { /* config data has been sent with this forward open request */
@@ -389,16 +539,57 @@ CipError EstablishIoConnection(
     }
   }
 
-  cip_error = OpenCommunicationChannels(io_connection_object);
+  CipCommonPacketFormatData *const forward_open_items =
+    connection_object->forward_open_items;
+  /* the copy must not keep pointing to the items of the request */
+  io_connection_object->forward_open_items = NULL;
+  ForwardOpenTraceStage(kForwardOpenStageChannels);
+  cip_error = OpenCommunicationChannels(io_connection_object,
+                                        forward_open_items);
+  ForwardOpenTraceStage(kForwardOpenStageEstablish);
   if(kCipErrorSuccess != cip_error) {
     *extended_error = 0; /*TODO find out the correct extended error code*/
     return cip_error;
   }
 
+  if(NULL != io_connection_object->producing_instance) {
+    BuildIoFrameTemplate(io_connection_object);
+  }
+
+  /* RunIdleChanged() reports the first header, run or idle */
+  io_connection_object->run_idle_reported = false;
   AddNewActiveConnection(io_connection_object);
-  CheckIoConnectionEvent(io_connection_object->consumed_path.instance_id,
-                         io_connection_object->produced_path.instance_id,
-                         kIoConnectionEventOpened);
+  CipConnectionDiagnosticsConnectionOpened(io_connection_object);
+  IoConnectionOriginatorChanged(&io_connection_object->originator_address,
+                                true);
+  /* a redundant standby leaves the outputs to the owner in control */
+  if(!io_connection_object->redundant_standby) {
+    CheckIoConnectionEvent(io_connection_object->consumed_path.instance_id,
+                           io_connection_object->produced_path.instance_id,
+                           kIoConnectionEventOpened);
+  }
+  if(kConnectionObjectConnectionTypeMulticast ==
+     target_to_originator_connection_type) {
+    UpdateMulticastConsumerCount(
+      io_connection_object->produced_path.instance_id);
+  }
+  return cip_error;
+}
+
+/** @brief Close a taken over standby socket the new connection did not adopt */
+static void ReleaseStandbySocket(void) {
+  if(kEipInvalidSocket != s_standby_socket) {
+    CloseUdpSocket(s_standby_socket);
+  }
+  s_standby_socket = kEipInvalidSocket;
+}
+
+CipError EstablishIoConnection(
+  CipConnectionObject *RESTRICT const connection_object,
+  EipUint16 *const extended_error) {
+  const CipError cip_error = SetUpIoConnection(connection_object,
+                                               extended_error);
+  ReleaseStandbySocket();
   return cip_error;
 }
 
@@ -445,13 +636,6 @@ EipStatus OpenConsumingPointToPointConnection(
   { .sin_family = AF_INET, .sin_addr.s_addr = INADDR_ANY, .sin_port = htons(
       kOpenerEipIoUdpPort) };
 
-  CipUsint qos_for_socket = ConnectionObjectGetTToOPriority(connection_object);
-  int error = SetQos(qos_for_socket);
-  if (error != 0) {
-    OPENER_TRACE_ERR(
-      "cannot set QoS for UDP socket in OpenPointToPointConnection\n");
-    return kEipStatusError;
-  }
   /* store the address of the originator for packet scanning */
   connection_object->originator_address.sin_family = AF_INET;
   connection_object->originator_address.sin_addr.s_addr = GetPeerAddress();
@@ -491,13 +675,10 @@ CipError OpenProducingPointToPointConnection(
   connection_object->remote_address.sin_addr.s_addr = GetPeerAddress();
   connection_object->remote_address.sin_port = port;
 
-  CipUsint qos_for_socket = ConnectionObjectGetTToOPriority(connection_object);
-  int error = SetQos(qos_for_socket);
-  if (error != 0) {
-    OPENER_TRACE_ERR(
-      "cannot set QoS for UDP socket in OpenPointToPointConnection\n");
-    return kEipStatusError;
-  }
+  /* marked per frame, so connections of different priorities can share the
+   * producing socket */
+  connection_object->producing_dscp = CipQosGetDscpPriority(
+    ConnectionObjectGetTToOPriority(connection_object) );
 
   connection_object->socket[kUdpCommuncationDirectionProducing] =
     g_network_status.udp_io_messaging;
@@ -505,6 +686,37 @@ CipError OpenProducingPointToPointConnection(
   return kCipErrorSuccess;
 }
 
+/** @brief Move the production of a shared multicast connection to a new
+ * master connection
+ *
+ * The new master continues the sequence counts and the production phase, so
+ * the consumers see one uninterrupted production.
+ *
+ * @param new_master connection taking over the production
+ * @param old_master connection producing until now
+ */
+static void HandOverMulticastProduction(CipConnectionObject *const new_master,
+                                        CipConnectionObject *const old_master) {
+  new_master->socket[kUdpCommuncationDirectionProducing] =
+    old_master->socket[kUdpCommuncationDirectionProducing];
+  old_master->socket[kUdpCommuncationDirectionProducing] = kEipInvalidSocket;
+  new_master->producing_dscp = old_master->producing_dscp;
+
+  memcpy( &(new_master->remote_address), &(old_master->remote_address),
+          sizeof(new_master->remote_address) );
+  new_master->eip_level_sequence_count_producing =
+    old_master->eip_level_sequence_count_producing;
+  new_master->sequence_count_producing = old_master->sequence_count_producing;
+  new_master->produced_data_version = old_master->produced_data_version;
+  new_master->transmission_trigger_timer =
+    old_master->transmission_trigger_timer;
+  new_master->multicast_consumer_count = old_master->multicast_consumer_count;
+  old_master->multicast_consumer_count = 0;
+
+  ConnectionManagerRescheduleConnection(old_master);
+  ConnectionManagerRescheduleConnection(new_master);
+}
+
 EipStatus OpenProducingMulticastConnection(
   CipConnectionObject *connection_object,
   CipCommonPacketFormatData *common_packet_format_data) {
@@ -523,11 +735,6 @@ EipStatus OpenProducingMulticastConnection(
     return kEipStatusError;
   }
 
-  uint16_t port = htons(kOpenerEipIoUdpPort);
-  if(kCipItemIdSocketAddressInfoTargetToOriginator != sock_addr_info->type_id) {
-    port = sock_addr_info->sin_port;
-  }
-
   sock_addr_info->type_id = kCipItemIdSocketAddressInfoTargetToOriginator;
 
   if(NULL == existing_connection_object) { /* we are the first connection producing for the given Input Assembly */
@@ -547,23 +754,22 @@ EipStatus OpenProducingMulticastConnection(
     /* exclusive owners take the socket and further manage the connection
      * especially in the case of time outs.
      */
-    connection_object->socket[kUdpCommuncationDirectionProducing] =
-      existing_connection_object->socket[kUdpCommuncationDirectionProducing];
-    existing_connection_object->socket[kUdpCommuncationDirectionProducing] =
-      kEipInvalidSocket;
+    HandOverMulticastProduction(connection_object,
+                                existing_connection_object);
   } else { /* this connection will not produce the data */
     connection_object->socket[kUdpCommuncationDirectionProducing] =
       kEipInvalidSocket;
+    memcpy( &(connection_object->remote_address),
+            &(existing_connection_object->remote_address),
+            sizeof(connection_object->remote_address) );
   }
 
+  /* all consumers are told the group the production is actually sent to */
   sock_addr_info->length = 16;
-
-  connection_object->remote_address.sin_family = AF_INET;
-  connection_object->remote_address.sin_port = sock_addr_info->sin_port = port;
-  connection_object->remote_address.sin_addr.s_addr = sock_addr_info->sin_addr =
-    g_tcpip.mcast_config.starting_multicast_address;
-  memset(sock_addr_info->nasin_zero, 0, 8);
   sock_addr_info->sin_family = htons(AF_INET);
+  sock_addr_info->sin_port = connection_object->remote_address.sin_port;
+  sock_addr_info->sin_addr = connection_object->remote_address.sin_addr.s_addr;
+  memset(sock_addr_info->nasin_zero, 0, 8);
 
   return kEipStatusOk;
 }
@@ -652,14 +858,9 @@ EipStatus OpenMulticastConnection(UdpCommuncationDirection direction,
   socket_address.sin_port =
     common_packet_format_data->address_info_item[j].sin_port;
 
-  CipUsint qos_for_socket = ConnectionObjectGetTToOPriority(connection_object);
-  int error = SetQos(qos_for_socket);
-  if (error != 0) {
-    OPENER_TRACE_ERR(
-      "cannot set QoS for UDP socket in OpenMulticastConnection\n");
-    return kEipStatusError;
-  }
   if (direction == kUdpCommuncationDirectionProducing) {
+    connection_object->producing_dscp = CipQosGetDscpPriority(
+      ConnectionObjectGetTToOPriority(connection_object) );
     SetSocketOptionsMulticastProduce();
   }
 
@@ -682,7 +883,7 @@ EipStatus OpenMulticastConnection(UdpCommuncationDirection direction,
 
 EipUint16 HandleConfigData(CipConnectionObject *connection_object) {
 
-  CipClass *const assembly_class = GetCipClass(kCipAssemblyClassCode);
+  CipClass *const assembly_class = GetAssemblyClass();
   EipUint16 connection_manager_status = 0;
   CipInstance *config_instance = GetCipInstance(assembly_class,
                                                 connection_object->configuration_path.instance_id);
@@ -694,7 +895,7 @@ EipUint16 HandleConfigData(CipConnectionObject *connection_object) {
                                             .instance_id) ) {
       /* there is a connected connection with the same config point
        * we have to have the same data as already present in the config point*/
-      CipAttributeStruct *attribute_three = GetCipAttribute(config_instance, 3);
+      const CipAttributeStruct *attribute_three = GetCipAttribute(config_instance, 3);
       OPENER_ASSERT(NULL != attribute_three);
       CipByteArray *attribute_three_data =
         (CipByteArray *) attribute_three->data;
@@ -744,38 +945,119 @@ static int transfer_master_connection(CipConnectionObject *connection_object) {
   }
 
   OPENER_TRACE_INFO("Transferring socket ownership\n");
-  active->socket[kUdpCommuncationDirectionProducing] =
-    connection_object->socket[kUdpCommuncationDirectionProducing];
-  connection_object->socket[kUdpCommuncationDirectionProducing] =
-    kEipInvalidSocket;
-
-  memcpy( &(active->remote_address), &(connection_object->remote_address),
-          sizeof(active->remote_address) );
-  active->eip_level_sequence_count_producing =
-    connection_object->eip_level_sequence_count_producing;
-  active->sequence_count_producing =
-    connection_object->sequence_count_producing;
-  active->transmission_trigger_timer =
-    connection_object->transmission_trigger_timer;
+  HandOverMulticastProduction(active, connection_object);
 
   return 0;
 }
 
+/** @brief Check if the outputs of a leaving connection stay driven
+ *
+ * True for a redundant standby, which never had them, and for an owner in
+ * control whose standby takes them over. The application is then not told
+ * about the close or time out.
+ */
+static bool IoConnectionOutputsStay(
+  const CipConnectionObject *const connection_object) {
+  if(connection_object->redundant_standby) {
+    return true;
+  }
+  if(kConnectionObjectInstanceTypeIOExclusiveOwner ==
+     ConnectionObjectGetInstanceType(connection_object) &&
+     kConnectionObjectStateEstablished ==
+     ConnectionObjectGetState(connection_object) &&
+     PromoteRedundantOwnerStandby(connection_object) ) {
+    return true;
+  }
+  return false;
+}
+
+/** @brief Derive the run/idle state of the device from its owners
+ *
+ * The device runs while one established consuming connection last sent a
+ * run header, it is idle while all of them sent idle. The Identity status
+ * and RunIdleChanged() are updated when that changes, and for the first
+ * header of a connection; the application applies its idle action in its
+ * own task. Once the last owner left the next first header is reported.
+ *
+ * @param first_header true for the first header of a connection
+ */
+static void IoConnectionUpdateRunIdle(const bool first_header) {
+  const EipUint32 kRunBitMask = 0x0001;
+  bool owners = false;
+  EipUint32 run_idle_state = 0;
+  for(const DoublyLinkedListNode *node = connection_list.first; NULL != node;
+      node = node->next) {
+    const CipConnectionObject *const connection = node->data;
+    if(NULL != connection->consuming_instance &&
+       connection->run_idle_reported && !connection->redundant_standby &&
+       kConnectionObjectStateEstablished ==
+       ConnectionObjectGetState(connection) ) {
+      owners = true;
+      run_idle_state |= connection->run_idle_state & kRunBitMask;
+    }
+  }
+  if(!owners) {
+    s_run_idle_reported = false;
+    return;
+  }
+  if(!first_header && s_run_idle_reported &&
+     s_run_idle_state == run_idle_state) {
+    return;
+  }
+  CipIdentitySetExtendedDeviceStatus(
+    run_idle_state ? kAtLeastOneIoConnectionInRunMode :
+    kAtLeastOneIoConnectionEstablishedAllInIdleMode);
+  s_run_idle_state = run_idle_state;
+  s_run_idle_reported = true;
+  RunIdleChanged(run_idle_state);
+}
+
+/** @brief Drop a leaving consuming connection from the device run/idle state
+ *
+ * Called once the connection is no longer established and active.
+ */
+static void IoConnectionLeaveRunIdle(
+  CipConnectionObject *const connection_object) {
+  if(connection_object->run_idle_reported) {
+    connection_object->run_idle_reported = false;
+    IoConnectionUpdateRunIdle(false);
+  }
+}
+
+void IoConnectionBeginBatchClose(void) {
+  s_batch_close_depth++;
+}
+
+void IoConnectionEndBatchClose(void) {
+  OPENER_ASSERT(s_batch_close_depth > 0);
+  s_batch_close_depth--;
+}
+
 /* Always sync any changes with HandleIoConnectionTimeout() */
 void CloseIoConnection(CipConnectionObject *RESTRICT connection_object) {
   ConnectionObjectInstanceType instance_type = ConnectionObjectGetInstanceType(
     connection_object);
   ConnectionObjectConnectionType conn_type =
     ConnectionObjectGetTToOConnectionType(connection_object);
-
-  CheckIoConnectionEvent(connection_object->consumed_path.instance_id,
-                         connection_object->produced_path.instance_id,
-                         kIoConnectionEventClosed);
+  const bool batch = 0 != s_batch_close_depth;
+
+  /* the application has been told about a time out already, in a batch no
+   * standby is left to take the outputs over */
+  if(kConnectionObjectStateTimedOut !=
+     ConnectionObjectGetState(connection_object) &&
+     !(batch ? connection_object->redundant_standby :
+       IoConnectionOutputsStay(connection_object) ) ) {
+    CheckIoConnectionEvent(connection_object->consumed_path.instance_id,
+                           connection_object->produced_path.instance_id,
+                           kIoConnectionEventClosed);
+  }
   ConnectionObjectSetState(connection_object,
                            kConnectionObjectStateNonExistent);
+  IoConnectionLeaveRunIdle(connection_object);
 
-  if(kConnectionObjectInstanceTypeIOExclusiveOwner == instance_type ||
-     kConnectionObjectInstanceTypeIOInputOnly == instance_type) {
+  if(!batch &&
+     (kConnectionObjectInstanceTypeIOExclusiveOwner == instance_type ||
+      kConnectionObjectInstanceTypeIOInputOnly == instance_type) ) {
     if(kConnectionObjectConnectionTypeMulticast == conn_type &&
        kEipInvalidSocket !=
        connection_object->socket[kUdpCommuncationDirectionProducing]) {
@@ -793,21 +1075,30 @@ void CloseIoConnection(CipConnectionObject *RESTRICT connection_object) {
     }
   }
 
+  const EipUint32 input_point = connection_object->produced_path.instance_id;
   CloseCommunicationChannelsAndRemoveFromActiveConnectionsList(connection_object);
+  if(!batch && kConnectionObjectConnectionTypeMulticast == conn_type) {
+    UpdateMulticastConsumerCount(input_point);
+  }
 }
 
 /* Always sync any changes with CloseIoConnection() */
 void HandleIoConnectionTimeOut(CipConnectionObject *connection_object) {
   ConnectionObjectInstanceType instance_type = ConnectionObjectGetInstanceType(
     connection_object);
+  const EipUint32 input_point = connection_object->produced_path.instance_id;
   ConnectionObjectConnectionType conn_type =
     ConnectionObjectGetTToOConnectionType(connection_object);
   int handover = 0;
+  const bool outputs_stay = IoConnectionOutputsStay(connection_object);
 
-  CheckIoConnectionEvent(connection_object->consumed_path.instance_id,
-                         connection_object->produced_path.instance_id,
-                         kIoConnectionEventTimedOut);
+  if(!outputs_stay) {
+    CheckIoConnectionEvent(connection_object->consumed_path.instance_id,
+                           connection_object->produced_path.instance_id,
+                           kIoConnectionEventTimedOut);
+  }
   ConnectionObjectSetState(connection_object, kConnectionObjectStateTimedOut);
+  IoConnectionLeaveRunIdle(connection_object);
 
   if(connection_object->last_package_watchdog_timer ==
      connection_object->inactivity_watchdog_timer) {
@@ -838,7 +1129,7 @@ void HandleIoConnectionTimeOut(CipConnectionObject *connection_object) {
   }
 
   if(kConnectionObjectInstanceTypeIOExclusiveOwner == instance_type &&
-     !handover) {
+     !handover && !outputs_stay) {
     CloseAllConnectionsForInputWithSameType(
       connection_object->produced_path.instance_id,
       kConnectionObjectInstanceTypeIOInputOnly);
@@ -849,99 +1140,167 @@ void HandleIoConnectionTimeOut(CipConnectionObject *connection_object) {
 
   ConnectionObjectSetState(connection_object, kConnectionObjectStateTimedOut);
 
-  /* For point-to-point connections, clean up immediately after timeout.
-   * For multicast connections, cleanup happens after handover logic above.
-   * This ensures timed-out connections are removed from the active list
-   * and resources are freed, preventing ownership conflicts on reconnect. */
-  if(kConnectionObjectConnectionTypePointToPoint == conn_type ||
-     handover == 0) {
-    /* Point-to-point or no handover needed - clean up immediately */
+  /* Point-to-point connections go to standby, or are cleaned up right away
+   * without one. Multicast connections without a handover are cleaned up
+   * right away, a taken over multicast production is cleaned up after the
+   * grace period below. This ensures timed-out connections are removed from
+   * the active list and resources are freed, preventing ownership conflicts
+   * on reconnect. */
+  if(kConnectionObjectConnectionTypePointToPoint == conn_type) {
+#if OPENER_IO_CONNECTION_STANDBY_MS > 0
+    /* Warm standby - the socket stays open until the grace period expires,
+     * a re-open of the same originator takes it over */
+    OPENER_TRACE_INFO("Timed-out connection in standby (ConnNr: %u)\n",
+                      connection_object->connection_serial_number);
+    connection_object->inactivity_watchdog_timer = ConnectionManagerGetTime() +
+                                                  (MicroSeconds) OPENER_IO_CONNECTION_STANDBY_MS * 1000U;
+    ConnectionManagerRescheduleConnection(connection_object);
+#else
+    OPENER_TRACE_INFO("Cleaning up timed-out connection (ConnNr: %u)\n",
+                      connection_object->connection_serial_number);
+    CloseCommunicationChannelsAndRemoveFromActiveConnectionsList(connection_object);
+#endif
+  } else if(0 == handover) {
+    /* Multicast, no handover needed - clean up immediately */
     OPENER_TRACE_INFO("Cleaning up timed-out connection (ConnNr: %u)\n",
                       connection_object->connection_serial_number);
     CloseCommunicationChannelsAndRemoveFromActiveConnectionsList(connection_object);
   } else {
     /* Multicast with handover - set timer for delayed cleanup (10 seconds grace period) */
-    connection_object->inactivity_watchdog_timer = 10000; /* 10 seconds in milliseconds */
+    connection_object->inactivity_watchdog_timer = ConnectionManagerGetTime() +
+                                                  10000000; /* 10 seconds in microseconds */
+    ConnectionManagerRescheduleConnection(connection_object);
+  }
+  if(kConnectionObjectConnectionTypeMulticast == conn_type) {
+    UpdateMulticastConsumerCount(input_point);
   }
 }
 
-EipStatus SendConnectedData(CipConnectionObject *connection_object) {
-
-  /* TODO think of adding an own send buffer to each connection object in order to preset up the whole message on connection opening and just change the variable data items e.g., sequence number */
-
-  CipCommonPacketFormatData *common_packet_format_data =
-    &g_common_packet_format_data_item;
-  /* TODO think on adding a CPF data item to the S_CIP_ConnectionObject in order to remove the code here or even better allocate memory in the connection object for storing the message to send and just change the application data*/
-
-  connection_object->eip_level_sequence_count_producing++;
+/** @brief Assemble the constant part of the connection's produced frames
+ *
+ * Item count, address item and data item header only depend on parameters
+ * fixed at connection establishment, so they are encoded once into
+ * io_frame_template. The EIP level and class 1 sequence counts are left zero
+ * and patched per frame.
+ */
+static void BuildIoFrameTemplate(CipConnectionObject *const connection_object) {
+  CipCommonPacketFormatData common_packet_format_data = { 0 };
 
-  /* assembleCPFData */
-  common_packet_format_data->item_count = 2;
+  common_packet_format_data.item_count = 2;
   if( kConnectionObjectTransportClassTriggerTransportClass0 !=
       ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
   /* use Sequenced Address Items if not Connection Class 0 */
   {
-    common_packet_format_data->address_item.type_id =
+    common_packet_format_data.address_item.type_id =
       kCipItemIdSequencedAddressItem;
-    common_packet_format_data->address_item.length = 8;
-    common_packet_format_data->address_item.data.sequence_number =
-      connection_object->eip_level_sequence_count_producing;
+    common_packet_format_data.address_item.length = 8;
   } else {
-    common_packet_format_data->address_item.type_id =
+    common_packet_format_data.address_item.type_id =
       kCipItemIdConnectionAddress;
-    common_packet_format_data->address_item.length = 4;
-
+    common_packet_format_data.address_item.length = 4;
   }
-  common_packet_format_data->address_item.data.connection_identifier =
+  common_packet_format_data.address_item.data.connection_identifier =
     connection_object->cip_produced_connection_id;
 
-  common_packet_format_data->data_item.type_id = kCipItemIdConnectedDataItem;
+  common_packet_format_data.data_item.type_id = kCipItemIdConnectedDataItem;
+  common_packet_format_data.data_item.length = 0;
 
+  ENIPMessage message;
+  InitializeENIPMessage(&message);
+  AssembleIOMessage(&common_packet_format_data, &message);
+
+  /* rewrite the data item length, AssembleIOMessage() encoded an empty item */
+  MoveMessageNOctets(-2, &message);
   CipByteArray *producing_instance_attributes =
     (CipByteArray *) connection_object->producing_instance->attributes->data;
-  common_packet_format_data->data_item.length = 0;
-
-  /* notify the application that data will be sent immediately after the call */
-  if( BeforeAssemblyDataSend(connection_object->producing_instance) ) {
-    /* the data has changed increase sequence counter */
-    connection_object->sequence_count_producing++;
-  }
-
-  /* set AddressInfo Items to invalid Type */
-  common_packet_format_data->address_info_item[0].type_id = 0;
-  common_packet_format_data->address_info_item[1].type_id = 0;
-
-  ENIPMessage outgoing_message;
-  InitializeENIPMessage(&outgoing_message);
-  AssembleIOMessage(common_packet_format_data, &outgoing_message);
-
-  MoveMessageNOctets(-2, &outgoing_message);
-  common_packet_format_data->data_item.length =
-    producing_instance_attributes->length;
+  EipUint16 data_item_length = producing_instance_attributes->length;
 
   if( kConnectionObjectTransportClassTriggerTransportClass1 ==
       ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
   {
-    common_packet_format_data->data_item.length += 2;
-    AddIntToMessage(common_packet_format_data->data_item.length,
-                    &outgoing_message);
-    AddIntToMessage(connection_object->sequence_count_producing,
-                    &outgoing_message);
+    data_item_length += 2;
+    AddIntToMessage(data_item_length, &message);
+    AddIntToMessage(0, &message); /* class 1 sequence count */
   } else {
-    AddIntToMessage(common_packet_format_data->data_item.length,
-                    &outgoing_message);
+    AddIntToMessage(data_item_length, &message);
   }
 
-  memcpy(outgoing_message.current_message_position,
-         producing_instance_attributes->data,
-         producing_instance_attributes->length);
+  OPENER_ASSERT(message.used_message_length <= CIP_IO_FRAME_TEMPLATE_MAX_LENGTH);
+  memcpy(connection_object->io_frame_template,
+         message.message_buffer,
+         message.used_message_length);
+  connection_object->io_frame_template_length = message.used_message_length;
+}
+
+EipStatus SendConnectedData(CipConnectionObject *connection_object) {
+  OPENER_LATENCY_PROBE(kLatencyProbeProduce);
+
+  connection_object->eip_level_sequence_count_producing++;
+  OPENER_TRACE_EVENT(kTraceEventProduce,
+                     connection_object->connection_serial_number,
+                     connection_object->eip_level_sequence_count_producing, 0);
+
+  /* notify the application that data will be sent immediately after the call */
+  NotifyAssemblyDataSend(connection_object->producing_instance);
+  const CipUdint data_version =
+    GetAssemblyDataVersion(connection_object->producing_instance);
+  if(data_version != connection_object->produced_data_version) {
+    /* the data has changed since this connection's last production, even
+     * if another connection of the assembly has produced meanwhile */
+    connection_object->produced_data_version = data_version;
+    connection_object->sequence_count_producing++;
+  }
 
-  outgoing_message.current_message_position +=
-    producing_instance_attributes->length;
-  outgoing_message.used_message_length += producing_instance_attributes->length;
+  if(0 == connection_object->io_frame_template_length) {
+    BuildIoFrameTemplate(connection_object);
+  }
 
-  return SendUdpData(&connection_object->remote_address,
+  CipByteArray *producing_instance_attributes =
+    (CipByteArray *) connection_object->producing_instance->attributes->data;
+  const size_t header_length = connection_object->io_frame_template_length;
+
+  /* only the header is built here, the payload is sent straight from the
+   * assembly. Static instead of on the producing task's stack, production
+   * runs under the stack lock; not cleared, the template is copied over it */
+  static ENIPMessage outgoing_message;
+  PrepareENIPMessage(&outgoing_message);
+  memcpy(outgoing_message.message_buffer,
+         connection_object->io_frame_template,
+         header_length);
+  outgoing_message.current_message_position = outgoing_message.message_buffer +
+                                              kIoFrameEipSequenceNumberOffset;
+  outgoing_message.used_message_length = kIoFrameEipSequenceNumberOffset;
+
+  const ConnectionObjectTransportClassTriggerTransportClass transport_class =
+    ConnectionObjectGetTransportClassTriggerTransportClass(connection_object);
+  if(kConnectionObjectTransportClassTriggerTransportClass0 != transport_class) {
+    AddDintToMessage(connection_object->eip_level_sequence_count_producing,
                      &outgoing_message);
+  }
+  if(kConnectionObjectTransportClassTriggerTransportClass1 == transport_class) {
+    outgoing_message.current_message_position =
+      outgoing_message.message_buffer + header_length - 2;
+    AddIntToMessage(connection_object->sequence_count_producing,
+                    &outgoing_message);
+  }
+
+  CipConnectionDiagnosticsRecordProduced(connection_object, GetMicroSeconds() );
+#if defined(OPENER_CIP_SECURITY) && 0 != OPENER_CIP_SECURITY
+  if(connection_object->secure_transport) {
+    return SendSecureUdpFrame(&connection_object->secure_peer,
+                              connection_object->producing_dscp,
+                              outgoing_message.message_buffer,
+                              header_length,
+                              producing_instance_attributes->data,
+                              producing_instance_attributes->length);
+  }
+#endif
+  return SendUdpFrame(&connection_object->remote_address,
+                      connection_object->producing_dscp,
+                      outgoing_message.message_buffer,
+                      header_length,
+                      producing_instance_attributes->data,
+                      producing_instance_attributes->length);
 }
 
 EipStatus HandleReceivedIoConnectionData(CipConnectionObject *connection_object,
@@ -949,6 +1308,9 @@ EipStatus HandleReceivedIoConnectionData(CipConnectionObject *connection_object,
                                          EipUint16 data_length) {
 
   OPENER_TRACE_INFO("Starting data length: %d\n", data_length);
+  /* latched when the packet was handed to the connection manager */
+  const MicroSeconds received = ConnectionManagerGetTime();
+  CipConnectionDiagnosticsRecordConsumed(connection_object, received);
   bool no_new_data = false;
   if( kConnectionObjectTransportClassTriggerTransportClass1 ==
       ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
@@ -961,23 +1323,25 @@ EipStatus HandleReceivedIoConnectionData(CipConnectionObject *connection_object,
     connection_object->sequence_count_consuming = sequence_buffer;
     data_length -= 2;
   }
+  if(connection_object->redundant_standby) {
+    /* keeps its watchdog running, the owner in control drives the outputs */
+    return kEipStatusOk;
+  }
 
   OPENER_TRACE_INFO("data length after sequence count: %d\n", data_length);
   if(data_length > 0) {
     if(s_consume_run_idle) {
       EipUint32 nRunIdleBuf = GetUdintFromMessage( &(data) );
-      OPENER_TRACE_INFO("Run/Idle handler: 0x%" PRIx32 "\n", nRunIdleBuf);
-      const uint32_t kRunBitMask = 0x0001;
-      if( (kRunBitMask & nRunIdleBuf) == 1 ) {
-        CipIdentitySetExtendedDeviceStatus(kAtLeastOneIoConnectionInRunMode);
-      } else {
-        CipIdentitySetExtendedDeviceStatus(
-          kAtLeastOneIoConnectionEstablishedAllInIdleMode);
+      /* Every packet repeats the header, only a change of this connection
+       * costs more than the compare */
+      if(connection_object->run_idle_state != nRunIdleBuf ||
+         !connection_object->run_idle_reported) {
+        OPENER_TRACE_INFO("Run/Idle handler: 0x%" PRIx32 "\n", nRunIdleBuf);
+        const bool first_header = !connection_object->run_idle_reported;
+        connection_object->run_idle_state = nRunIdleBuf;
+        connection_object->run_idle_reported = true;
+        IoConnectionUpdateRunIdle(first_header);
       }
-      if(g_run_idle_state != nRunIdleBuf) {
-        RunIdleChanged(nRunIdleBuf);
-      }
-      g_run_idle_state = nRunIdleBuf;
       data_length -= 4;
     }
     if(no_new_data) {
@@ -999,17 +1363,26 @@ EipStatus HandleReceivedIoConnectionData(CipConnectionObject *connection_object,
                                            data_length) != 0) {
       return kEipStatusError;
     }
+    CipConnectionDiagnosticsRecordApplied(connection_object,
+                                          received,
+                                          GetMicroSeconds() );
   }
   return kEipStatusOk;
 }
 
-CipError OpenCommunicationChannels(CipConnectionObject *connection_object) {
+CipError OpenCommunicationChannels(
+  CipConnectionObject *connection_object,
+  CipCommonPacketFormatData *common_packet_format_data) {
 
   CipError cip_error = kCipErrorSuccess;
-  CreateUdpSocket();
-
-  CipCommonPacketFormatData *common_packet_format_data =
-    &g_common_packet_format_data_item;
+  if(kEipInvalidSocket == s_standby_socket ||
+     s_standby_socket != g_network_status.udp_io_messaging) {
+    CreateUdpSocket();
+  } else {
+    OPENER_TRACE_INFO("Reusing the UDP socket %d of the standby connection\n",
+                      s_standby_socket);
+    s_standby_socket = kEipInvalidSocket; /* adopted */
+  }
 
   ConnectionObjectConnectionType originator_to_target_connection_type =
     ConnectionObjectGetOToTConnectionType(connection_object);
@@ -1069,7 +1442,30 @@ void CloseCommunicationChannelsAndRemoveFromActiveConnectionsList(
   }
 
   RemoveFromActiveConnections(connection_object);
+  CipConnectionDiagnosticsConnectionClosed(connection_object);
+  IoConnectionOriginatorChanged(&connection_object->originator_address, false);
   ConnectionObjectInitializeEmpty(connection_object);
   OPENER_TRACE_INFO(
     "cipioconnection: CloseCommunicationChannelsAndRemoveFromActiveConnectionsList\n");
 }
+
+void TakeOverTimedOutIoConnection(CipConnectionObject *connection_object) {
+  ReleaseStandbySocket();
+  for(size_t i = 0; i < 2; ++i) {
+    const int socket_handle = connection_object->socket[i];
+    if(kEipInvalidSocket == socket_handle || s_standby_socket == socket_handle) {
+      continue;
+    }
+    if(kEipInvalidSocket == s_standby_socket) {
+      s_standby_socket = socket_handle;
+    } else {
+      CloseUdpSocket(socket_handle);
+    }
+  }
+
+  RemoveFromActiveConnections(connection_object);
+  CipConnectionDiagnosticsConnectionClosed(connection_object);
+  IoConnectionOriginatorChanged(&connection_object->originator_address, false);
+  ConnectionObjectInitializeEmpty(connection_object);
+  OPENER_TRACE_INFO("cipioconnection: timed-out connection taken over\n");
+}
@@ -59,13 +59,16 @@ CipError EstablishIoConnection(
 
 /** @brief Take the data given in the connection object structure and open the necessary communication channels
  *
- * This function will use the g_stCPFDataItem!
  * @param connection_object pointer to the connection object data
+ * @param common_packet_format_data CPF items of the Forward_Open, the
+ *        socket address items of the reply are added
  * @return general status on the open process
  *    - EIP_OK ... on success
  *    - On an error the general status code to be put into the response
  */
-CipError OpenCommunicationChannels(CipConnectionObject *connection_object);
+CipError OpenCommunicationChannels(
+  CipConnectionObject *connection_object,
+  CipCommonPacketFormatData *common_packet_format_data);
 
 /** @brief close the communication channels of the given connection and remove it
  * from the active connections list.
@@ -75,6 +78,32 @@ CipError OpenCommunicationChannels(CipConnectionObject *connection_object);
 void CloseCommunicationChannelsAndRemoveFromActiveConnectionsList(
   CipConnectionObject *connection_object);
 
+/** @brief Hand a timed out connection over to a re-open of its originator
+ *
+ * Called instead of the close function when a Forward_Open of the same
+ * originator reuses the connection slot. The connection is removed from the
+ * active connections list without telling the application, it was told
+ * about the time out already. Its UDP socket is kept for the connection
+ * EstablishIoConnection() is setting up.
+ *
+ * @param connection_object timed out connection
+ */
+void TakeOverTimedOutIoConnection(CipConnectionObject *connection_object);
+
+/** @brief Start closing several I/O connections together
+ *
+ * Until the matching IoConnectionEndBatchClose() CloseIoConnection() neither
+ * hands a multicast production over to another connection, nor closes the
+ * listen only connections of a production that found no new master, nor
+ * recounts the multicast consumers of the input, and a redundant standby
+ * does not take the outputs over. The caller closes all connections that
+ * depend on each other and recounts once. Calls nest.
+ */
+void IoConnectionBeginBatchClose(void);
+
+/** @brief End a batch started by IoConnectionBeginBatchClose() */
+void IoConnectionEndBatchClose(void);
+
 extern EipUint8 *g_config_data_buffer;
 extern unsigned int g_config_data_length;
 
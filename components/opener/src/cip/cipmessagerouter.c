@@ -3,31 +3,48 @@
  * All rights reserved.
  *
  ******************************************************************************/
+#include <inttypes.h>
+#include <string.h>
+
 #include "opener_api.h"
 #include "cipcommon.h"
 #include "endianconv.h"
 #include "ciperror.h"
 #include "trace.h"
 #include "enipmessage.h"
+#include "cpf.h"
 
 #include "cipmessagerouter.h"
+#include "wcet_profile.h"
 
-CipMessageRouterRequest g_message_router_request;
-
-/** @brief A class registry list node
+/** @brief Registry of the classes known to the message router
  *
- * A linked list of this  object is the registry of classes known to the message router
- * for small devices with very limited memory it could make sense to change this list into an
- * array with a given max size for removing the need for having to dynamically allocate
- * memory. The size of the array could be a parameter in the platform config file.
+ * Kept sorted by class code so explicit messages find their class by binary
+ * search, independent of the registration order. The maximum number of
+ * classes is set with OPENER_CIP_NUM_REGISTERED_CLASSES in the platform
+ * config file.
  */
-typedef struct cip_message_router_object {
-  struct cip_message_router_object *next; /**< link */
-  CipClass *cip_class; /**< object */
-} CipMessageRouterObject;
+static CipClass *g_registered_classes[OPENER_CIP_NUM_REGISTERED_CLASSES];
+
+/** @brief Number of valid entries in g_registered_classes */
+static size_t g_number_of_registered_classes = 0;
+
+/** @brief A class registered with RegisterDeferredCipClass(), not created
+ *  yet */
+typedef struct {
+  CipUdint class_code;
+  CipDeferredClassCreate create;
+} CipDeferredClass;
+
+/** @brief Deferred classes, sorted by class code like g_registered_classes */
+static CipDeferredClass g_deferred_classes[OPENER_CIP_NUM_DEFERRED_CLASSES];
+
+/** @brief Number of valid entries in g_deferred_classes */
+static size_t g_number_of_deferred_classes = 0;
 
-/** @brief Pointer to first registered object in MessageRouter*/
-CipMessageRouterObject *g_first_object = NULL;
+/** @brief Object model generation, routes from older generations are stale.
+ *  Starts at 1 so an all zero route never matches. */
+static CipUdint g_route_generation = 1;
 
 /** @brief Register a CIP Class to the message router
  *  @param cip_class Pointer to a class object to be registered.
@@ -48,6 +65,164 @@ CipError CreateMessageRouterRequestStructure(const EipUint8 *data,
                                              EipInt16 data_length,
                                              CipMessageRouterRequest *message_router_request);
 
+/** @brief Octets kept free in the response for the encapsulation and CPF headers */
+static const size_t kMultipleServicePacketReservedSpace = 33;
+
+/** @brief Size of an embedded reply without its additional status and data */
+static const size_t kMultipleServicePacketReplyHeaderLength = 4;
+
+static size_t MultipleServicePacketGetFreeSpace(
+  const ENIPMessage *const message) {
+  const size_t used_space = message->used_message_length +
+                            kMultipleServicePacketReservedSpace;
+  if(used_space >= message->message_buffer_size) {
+    return 0;
+  }
+  return message->message_buffer_size - used_space;
+}
+
+/** @brief Checks the offset table of a Multiple Service Packet request
+ *
+ *  Embedded requests have to follow the table in ascending order, each at
+ *  least a service code and a path size long.
+ */
+static bool MultipleServicePacketOffsetsValid(const CipOctet *offset_table,
+                                              const CipUint number_of_services,
+                                              const size_t header_length,
+                                              const size_t request_data_size)
+{
+  size_t previous_offset = 0;
+  for(CipUint i = 0; i < number_of_services; ++i) {
+    const size_t offset = GetUintFromMessage(&offset_table);
+    if( (offset < header_length) ||
+        ( (0 != i) && (offset < previous_offset + 2) ) ) {
+      return false;
+    }
+    previous_offset = offset;
+  }
+  return previous_offset + 2 <= request_data_size;
+}
+
+/** @brief Multiple Service Packet service (0x0A) of the Message Router
+ *
+ *  Routes each embedded request through NotifyMessageRouter() and returns
+ *  all replies in one response, see CIP Vol. 1, 2-4.4.1. Replies that do not
+ *  fit into the response anymore are answered with Reply Data Too Large.
+ */
+EipStatus MultipleServicePacket(CipInstance *RESTRICT const instance,
+                                CipMessageRouterRequest *const message_router_request,
+                                CipMessageRouterResponse *const message_router_response,
+                                const struct sockaddr *originator_address,
+                                const CipSessionHandle encapsulation_session) {
+  /* Suppress unused parameter compiler warning. */
+  (void)instance;
+
+  const CipOctet *const request_data = message_router_request->data;
+  const size_t request_data_size = message_router_request->request_data_size;
+
+  ClearENIPMessage(&message_router_response->message);
+  message_router_response->reply_service =
+    (0x80 | message_router_request->service);
+  message_router_response->general_status = kCipErrorSuccess;
+  message_router_response->size_of_additional_status = 0;
+
+  if(request_data_size < sizeof(CipUint) ) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
+  const CipOctet *offset_table = request_data;
+  const CipUint number_of_services = GetUintFromMessage(&offset_table);
+  const size_t header_length = sizeof(CipUint) *
+                               (1 + (size_t)number_of_services);
+  if( (0 == number_of_services) || (header_length > request_data_size) ) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
+  if( !MultipleServicePacketOffsetsValid(offset_table, number_of_services,
+                                         header_length, request_data_size) ) {
+    message_router_response->general_status = kCipErrorInvalidParameter;
+    return kEipStatusOkSend;
+  }
+  if(header_length + number_of_services * kMultipleServicePacketReplyHeaderLength
+     > MultipleServicePacketGetFreeSpace(&message_router_response->message) ) {
+    message_router_response->general_status = kCipErrorReplyDataTooLarge;
+    return kEipStatusOkSend;
+  }
+
+  ENIPMessage *const reply = &message_router_response->message;
+  CipOctet *const reply_start = reply->current_message_position;
+  AddIntToMessage(number_of_services, reply);
+  CipOctet *reply_offset_position = reply->current_message_position;
+  MoveMessageNOctets(header_length - sizeof(CipUint), reply);
+
+  for(CipUint i = 0; i < number_of_services; ++i) {
+    const size_t request_offset = GetUintFromMessage(&offset_table);
+    size_t request_end = request_data_size;
+    if(i + 1 < number_of_services) {
+      const CipOctet *next_offset = offset_table;
+      request_end = GetUintFromMessage(&next_offset);
+    }
+
+    const size_t reply_offset = (size_t)(reply->current_message_position -
+                                         reply_start);
+    *reply_offset_position++ = (CipOctet)reply_offset;
+    *reply_offset_position++ = (CipOctet)(reply_offset >> 8);
+
+    /* keep room for the headers of the replies still to come */
+    const size_t free_space = MultipleServicePacketGetFreeSpace(reply) -
+                              (number_of_services - i - 1) *
+                              kMultipleServicePacketReplyHeaderLength;
+
+    CipMessageRouterResponse embedded_response;
+    memset(&embedded_response, 0, sizeof(embedded_response) );
+    PrepareENIPMessage(&embedded_response.message);
+    embedded_response.common_packet_format_data =
+      message_router_response->common_packet_format_data;
+
+    const CipOctet *const embedded_request = request_data + request_offset;
+    if(kMultipleServicePacket == embedded_request[0]) {
+      embedded_response.reply_service = (0x80 | embedded_request[0]);
+      embedded_response.general_status = kCipErrorServiceNotSupported;
+    } else {
+      (void)ENIPMessageAttachPooledBuffer(&embedded_response.message,
+                                          free_space);
+      const EipStatus status = NotifyMessageRouter(
+        (EipUint8 *)embedded_request,
+        (int)(request_end - request_offset),
+        &embedded_response,
+        originator_address,
+        encapsulation_session);
+      if( (kEipStatusOkSend != status) &&
+          (kCipErrorSuccess == embedded_response.general_status) ) {
+        /* a reply that is sent later or not at all cannot be embedded */
+        embedded_response.reply_service = (0x80 | embedded_request[0]);
+        embedded_response.general_status = kCipErrorServiceNotSupported;
+        embedded_response.size_of_additional_status = 0;
+        ClearENIPMessage(&embedded_response.message);
+      }
+    }
+
+    if(kMultipleServicePacketReplyHeaderLength +
+       2 * embedded_response.size_of_additional_status +
+       embedded_response.message.used_message_length > free_space) {
+      embedded_response.general_status = kCipErrorReplyDataTooLarge;
+      embedded_response.size_of_additional_status = 0;
+      ClearENIPMessage(&embedded_response.message);
+    }
+    if(kCipErrorSuccess != embedded_response.general_status) {
+      message_router_response->general_status = kCipErrorEmbeddedServiceError;
+    }
+
+    EncodeReplyService(&embedded_response, reply);
+    EncodeReservedFieldOfLengthByte(&embedded_response, reply);
+    EncodeGeneralStatus(&embedded_response, reply);
+    EncodeExtendedStatus(&embedded_response, reply);
+    EncodeMessageRouterResponseData(&embedded_response, reply);
+    ENIPMessageReleasePooledBuffer(&embedded_response.message);
+  }
+  return kEipStatusOkSend;
+}
+
 void InitializeCipMessageRouterClass(CipClass *cip_class) {
 
   CipClass *meta_class = cip_class->class_instance.cip_class;
@@ -79,15 +254,39 @@ void InitializeCipMessageRouterClass(CipClass *cip_class) {
                 "GetAttributeSingle");
 }
 
+/** @brief Instance attribute 1, Object_List: the number of classes and
+ *  their class codes, deferred classes included */
+static void EncodeMessageRouterObjectList(const void *const data,
+                                          ENIPMessage *const outgoing_message) {
+  (void) data;
+  AddIntToMessage( (EipUint16) (g_number_of_registered_classes +
+                                g_number_of_deferred_classes),
+                   outgoing_message );
+  size_t deferred = 0;
+  for(size_t i = 0; i < g_number_of_registered_classes; ++i) {
+    const CipUdint class_code = g_registered_classes[i]->class_code;
+    while(deferred < g_number_of_deferred_classes &&
+          g_deferred_classes[deferred].class_code < class_code) {
+      AddIntToMessage( (EipUint16) g_deferred_classes[deferred++].class_code,
+                       outgoing_message );
+    }
+    AddIntToMessage( (EipUint16) class_code, outgoing_message );
+  }
+  while(deferred < g_number_of_deferred_classes) {
+    AddIntToMessage( (EipUint16) g_deferred_classes[deferred++].class_code,
+                     outgoing_message );
+  }
+}
+
 EipStatus CipMessageRouterInit() {
 
   CipClass *message_router = CreateCipClass(kCipMessageRouterClassCode, /* class code */
                                             7, /* # of class attributes */
                                             7, /* # highest class attribute number */
                                             2, /* # of class services */
-                                            0, /* # of instance attributes */
-                                            0, /* # highest instance attribute number */
-                                            1, /* # of instance services */
+                                            1, /* # of instance attributes */
+                                            1, /* # highest instance attribute number */
+                                            2, /* # of instance services */
                                             1, /* # of instances */
                                             "message router", /* class name */
                                             1, /* # class revision*/
@@ -99,41 +298,96 @@ EipStatus CipMessageRouterInit() {
                 kGetAttributeSingle,
                 &GetAttributeSingle,
                 "GetAttributeSingle");
+  InsertService(message_router,
+                kMultipleServicePacket,
+                &MultipleServicePacket,
+                "MultipleServicePacket");
+  InsertAttribute(GetCipInstance(message_router, 1), 1, kCipAny,
+                  EncodeMessageRouterObjectList, NULL,
+                  (void *) g_registered_classes, kGetableSingle);
 
   /* reserved for future use -> set to zero */
   return kEipStatusOk;
 }
 
-/** @brief Get the registered MessageRouter object corresponding to ClassID.
- *  given a class ID, return a pointer to the registration node for that object
+/** @brief Find the position of a class code in the class registry
  *
- *  @param class_id Class code to be searched for.
- *  @return Pointer to registered message router object
- *      NULL .. Class not registered
+ *  @param class_code Class code to be searched for.
+ *  @return Index of the class if it is registered, otherwise the index it
+ *      would have to be inserted at
  */
-CipMessageRouterObject *GetRegisteredObject(EipUint32 class_id) {
-  CipMessageRouterObject *object = g_first_object; /* get pointer to head of class registration list */
+static size_t FindRegisteredClassIndex(const CipUdint class_code) {
+  size_t low = 0;
+  size_t high = g_number_of_registered_classes;
+  while(low < high) {
+    const size_t middle = low + (high - low) / 2;
+    if(g_registered_classes[middle]->class_code < class_code) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
 
-  while(NULL != object) /* for each entry in list*/
-  {
-    OPENER_ASSERT(NULL != object->cip_class);
-    if(object->cip_class->class_code == class_id) {
-      return object; /* return registration node if it matches class ID*/
+/** @brief Find the position of a class code among the deferred classes,
+ *  like FindRegisteredClassIndex() */
+static size_t FindDeferredClassIndex(const CipUdint class_code) {
+  size_t low = 0;
+  size_t high = g_number_of_deferred_classes;
+  while(low < high) {
+    const size_t middle = low + (high - low) / 2;
+    if(g_deferred_classes[middle].class_code < class_code) {
+      low = middle + 1;
+    } else {
+      high = middle;
     }
-    object = object->next;
   }
-  return NULL;
+  return low;
 }
 
-CipClass *GetCipClass(const CipUdint class_code) {
-  CipMessageRouterObject *message_router_object =
-    GetRegisteredObject(class_code);
+/** @brief Create a deferred class of @p class_code, if there is one
+ *
+ *  The entry is removed first, so the GetCipClass() of CreateCipClass()
+ *  finds no class.
+ */
+static void CreateDeferredClass(const CipUdint class_code) {
+  const size_t index = FindDeferredClassIndex(class_code);
+  if( (index >= g_number_of_deferred_classes) ||
+      (g_deferred_classes[index].class_code != class_code) ) {
+    return;
+  }
+  const CipDeferredClassCreate create = g_deferred_classes[index].create;
+  memmove(&g_deferred_classes[index],
+          &g_deferred_classes[index + 1],
+          (g_number_of_deferred_classes - index - 1) *
+          sizeof(CipDeferredClass) );
+  g_number_of_deferred_classes--;
+  if(kEipStatusOk != create() ) {
+    OPENER_TRACE_ERR("GetCipClass: creating deferred class 0x%" PRIx32
+                     " failed\n", class_code);
+    return;
+  }
+  OPENER_TRACE_INFO("GetCipClass: created deferred class 0x%" PRIx32 "\n",
+                    class_code);
+}
 
-  if(message_router_object) {
-    return message_router_object->cip_class;
-  } else {
+CipClass *GetCipClass(const CipUdint class_code) {
+  size_t index = FindRegisteredClassIndex(class_code);
+  if( (index < g_number_of_registered_classes) &&
+      (g_registered_classes[index]->class_code == class_code) ) {
+    return g_registered_classes[index];
+  }
+  if(0 == g_number_of_deferred_classes) {
     return NULL;
   }
+  CreateDeferredClass(class_code);
+  index = FindRegisteredClassIndex(class_code);
+  if( (index < g_number_of_registered_classes) &&
+      (g_registered_classes[index]->class_code == class_code) ) {
+    return g_registered_classes[index];
+  }
+  return NULL;
 }
 
 CipInstance *GetCipInstance(const CipClass *RESTRICT const cip_class,
@@ -143,7 +397,33 @@ CipInstance *GetCipInstance(const CipClass *RESTRICT const cip_class,
     return (CipInstance *) cip_class; /* if the instance number is zero, return the class object itself*/
 
   }
-  /* pointer to linked list of instances from the class object*/
+
+  CipInstance *const *const index = cip_class->instance_index;
+  const size_t index_length = cip_class->instance_index_length;
+  if(NULL != index) {
+    /* instances are usually numbered 1..n, so try the direct slot first */
+    if( (instance_number <= index_length) &&
+        (index[instance_number - 1]->instance_number == instance_number) ) {
+      return index[instance_number - 1];
+    }
+    size_t low = 0;
+    size_t high = index_length;
+    while(low < high) {
+      const size_t middle = low + (high - low) / 2;
+      if(index[middle]->instance_number < instance_number) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    if( (low < index_length) &&
+        (index[low]->instance_number == instance_number) ) {
+      return index[low];
+    }
+    return NULL;
+  }
+
+  /* no index (meta classes or out of memory), walk the list */
   for(CipInstance *instance = cip_class->instances; instance;
       instance = instance->next)                                                         /* follow the list*/
   {
@@ -156,24 +436,60 @@ CipInstance *GetCipInstance(const CipClass *RESTRICT const cip_class,
 }
 
 EipStatus RegisterCipClass(CipClass *cip_class) {
-  CipMessageRouterObject **message_router_object = &g_first_object;
+  if(g_number_of_registered_classes >= OPENER_CIP_NUM_REGISTERED_CLASSES) {
+    OPENER_TRACE_ERR(
+      "RegisterCipClass: no room for class '%s', increase OPENER_CIP_NUM_REGISTERED_CLASSES\n",
+      cip_class->class_name);
+    return kEipStatusError;
+  }
+  const size_t index = FindRegisteredClassIndex(cip_class->class_code);
+  memmove(&g_registered_classes[index + 1],
+          &g_registered_classes[index],
+          (g_number_of_registered_classes - index) * sizeof(CipClass *) );
+  g_registered_classes[index] = cip_class;
+  g_number_of_registered_classes++;
+  MessageRouterInvalidateRoutes();
 
-  while(*message_router_object) {
-    message_router_object = &(*message_router_object)->next; /* follow the list until p points to an empty link (list end)*/
+  return kEipStatusOk;
+}
 
+EipStatus RegisterDeferredCipClass(const CipUdint class_code,
+                                   CipDeferredClassCreate create) {
+  const size_t registered_index = FindRegisteredClassIndex(class_code);
+  if( (registered_index < g_number_of_registered_classes) &&
+      (g_registered_classes[registered_index]->class_code == class_code) ) {
+    OPENER_TRACE_ERR("RegisterDeferredCipClass: class 0x%" PRIx32
+                     " exists already\n", class_code);
+    return kEipStatusError;
   }
-  *message_router_object =
-    (CipMessageRouterObject *) CipCalloc(1, sizeof(CipMessageRouterObject) );                      /* create a new node at the end of the list*/
-  if(*message_router_object == 0) {
-    return kEipStatusError; /* check for memory error*/
-
+  const size_t index = FindDeferredClassIndex(class_code);
+  if( (index < g_number_of_deferred_classes) &&
+      (g_deferred_classes[index].class_code == class_code) ) {
+    g_deferred_classes[index].create = create;
+    return kEipStatusOk;
   }
-  (*message_router_object)->cip_class = cip_class; /* fill in the new node*/
-  (*message_router_object)->next = NULL;
-
+  if(g_number_of_deferred_classes >= OPENER_CIP_NUM_DEFERRED_CLASSES) {
+    OPENER_TRACE_ERR(
+      "RegisterDeferredCipClass: no room for class 0x%" PRIx32
+      ", increase OPENER_CIP_NUM_DEFERRED_CLASSES\n", class_code);
+    return kEipStatusError;
+  }
+  memmove(&g_deferred_classes[index + 1],
+          &g_deferred_classes[index],
+          (g_number_of_deferred_classes - index) * sizeof(CipDeferredClass) );
+  g_deferred_classes[index].class_code = class_code;
+  g_deferred_classes[index].create = create;
+  g_number_of_deferred_classes++;
   return kEipStatusOk;
 }
 
+void MessageRouterInvalidateRoutes(void) {
+  g_route_generation++;
+  if(0 == g_route_generation) {
+    g_route_generation = 1;
+  }
+}
+
 EipStatus NotifyMessageRouter(EipUint8 *data,
                               int data_length,
                               CipMessageRouterResponse *message_router_response,
@@ -181,41 +497,44 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
                               const CipSessionHandle encapsulation_session) {
   EipStatus eip_status = kEipStatusOkSend;
   CipError status = kCipErrorSuccess;
+  /* each request is decoded on the stack of its caller, nothing of it is
+   * kept in the message router */
+  CipMessageRouterRequest message_router_request;
 
   OPENER_TRACE_INFO("NotifyMessageRouter: routing unconnected message\n");
   if(kCipErrorSuccess !=
      (status =
         CreateMessageRouterRequestStructure(data, data_length,
-                                            &g_message_router_request) ) ) {                                             /* error from create MR structure*/
+                                            &message_router_request) ) ) {                                             /* error from create MR structure*/
     OPENER_TRACE_ERR(
       "NotifyMessageRouter: error from createMRRequeststructure\n");
     message_router_response->general_status = status;
     message_router_response->size_of_additional_status = 0;
     message_router_response->reserved = 0;
     message_router_response->reply_service =
-      (0x80 | g_message_router_request.service);
+      (0x80 | message_router_request.service);
   } else {
     /* forward request to appropriate Object if it is registered*/
-    CipMessageRouterObject *registered_object = GetRegisteredObject(
-      g_message_router_request.request_path.class_id);
-    if(registered_object == 0) {
+    CipClass *const registered_class = GetCipClass(
+      message_router_request.request_path.class_id);
+    if(NULL == registered_class) {
       OPENER_TRACE_ERR(
         "NotifyMessageRouter: sending CIP_ERROR_OBJECT_DOES_NOT_EXIST reply, class id 0x%x is not registered\n",
-        (unsigned ) g_message_router_request.request_path.class_id);
+        (unsigned ) message_router_request.request_path.class_id);
       message_router_response->general_status = kCipErrorPathDestinationUnknown; /*according to the test tool this should be the correct error flag instead of CIP_ERROR_OBJECT_DOES_NOT_EXIST;*/
       message_router_response->size_of_additional_status = 0;
       message_router_response->reserved = 0;
       message_router_response->reply_service =
-        (0x80 | g_message_router_request.service);
+        (0x80 | message_router_request.service);
     } else {
       /* call notify function from Object with ClassID (gMRRequest.RequestPath.ClassID)
          object will or will not make an reply into gMRResponse*/
       message_router_response->reserved = 0;
-      OPENER_ASSERT(NULL != registered_object->cip_class); OPENER_TRACE_INFO(
+      OPENER_TRACE_INFO(
         "NotifyMessageRouter: calling notify function of class '%s'\n",
-        registered_object->cip_class->class_name);
-      eip_status = NotifyClass(registered_object->cip_class,
-                               &g_message_router_request,
+        registered_class->class_name);
+      eip_status = NotifyClass(registered_class,
+                               &message_router_request,
                                message_router_response,
                                originator_address,
                                encapsulation_session);
@@ -224,15 +543,15 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
       if (eip_status == kEipStatusError) {
         OPENER_TRACE_ERR(
           "notifyMR: notify function of class '%s' returned an error\n",
-          registered_object->cip_class->class_name);
+          registered_class->class_name);
       } else if (eip_status == kEipStatusOk) {
         OPENER_TRACE_INFO(
           "notifyMR: notify function of class '%s' returned no reply\n",
-          registered_object->cip_class->class_name);
+          registered_class->class_name);
       } else {
         OPENER_TRACE_INFO(
           "notifyMR: notify function of class '%s' returned a reply\n",
-          registered_object->cip_class->class_name);
+          registered_class->class_name);
       }
 #endif
     }
@@ -240,6 +559,92 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
   return eip_status;
 }
 
+EipStatus NotifyMessageRouterWithRoute(EipUint8 *data,
+                                       int data_length,
+                                       CipMessageRouterResponse *message_router_response,
+                                       const struct sockaddr *const originator_address,
+                                       const CipSessionHandle encapsulation_session,
+                                       CipMessageRouterRoute *const route) {
+  CipMessageRouterRequest message_router_request;
+  /* service code and path size, then the path in 16-bit words */
+  const size_t header_length = (data_length >= 2) ?
+                               2U + 2U * (size_t) data[1] : 0;
+
+  if( (0 != header_length) && (header_length <= (size_t) data_length) &&
+      (route->generation == g_route_generation) &&
+      (route->request_header_length == header_length) &&
+      (0 == memcmp(route->request_header, data, header_length) ) ) {
+    message_router_request.service = data[0];
+    message_router_request.request_path = route->request_path;
+    message_router_request.data = data + header_length;
+    message_router_request.request_data_size = data_length - header_length;
+    message_router_response->reserved = 0;
+    OPENER_WCET_PROFILE_BEGIN(service_start);
+    const EipStatus service_status =
+      route->service_function(route->instance,
+                              &message_router_request,
+                              message_router_response,
+                              originator_address,
+                              encapsulation_session);
+    OPENER_WCET_PROFILE_END(service_start, kWcetProfileKindService,
+                            message_router_request.request_path.class_id,
+                            message_router_request.service, NULL,
+                            message_router_request.request_path.instance_number,
+                            message_router_request.request_path.attribute_number);
+    return service_status;
+  }
+
+  route->request_header_length = 0;
+  if( (0 != header_length) && (header_length <= (size_t) data_length) &&
+      (header_length <= sizeof(route->request_header) ) &&
+      (kCipErrorSuccess ==
+       CreateMessageRouterRequestStructure(data, data_length,
+                                           &message_router_request) ) ) {
+    const CipClass *const registered_class = GetCipClass(
+      message_router_request.request_path.class_id);
+    CipInstance *const instance = (NULL != registered_class) ?
+                                  GetCipInstance(registered_class,
+                                                 message_router_request.request_path.instance_number)
+                                  : NULL;
+    const CipServiceStruct *const service = (NULL != instance) ?
+                                            GetCipService(instance,
+                                                          message_router_request.service)
+                                            : NULL;
+    if(NULL != service) {
+      memcpy(route->request_header, data, header_length);
+      route->request_header_length = header_length;
+      route->request_path = message_router_request.request_path;
+      route->instance = instance;
+      route->service_function = service->service_function;
+      /* taken before the call, a service creating or deleting instances
+       * invalidates the route it was called through */
+      route->generation = g_route_generation;
+      message_router_response->reserved = 0;
+      OPENER_WCET_PROFILE_BEGIN(service_start);
+      const EipStatus service_status =
+        service->service_function(instance,
+                                  &message_router_request,
+                                  message_router_response,
+                                  originator_address,
+                                  encapsulation_session);
+      OPENER_WCET_PROFILE_END(service_start, kWcetProfileKindService,
+                              message_router_request.request_path.class_id,
+                              service->service_number, service->name,
+                              message_router_request.request_path.instance_number,
+                              message_router_request.request_path.attribute_number);
+      return service_status;
+    }
+  }
+
+  /* unknown targets, malformed and long paths take the full path for their
+   * error replies */
+  return NotifyMessageRouter(data,
+                             data_length,
+                             message_router_response,
+                             originator_address,
+                             encapsulation_session);
+}
+
 CipError CreateMessageRouterRequestStructure(const EipUint8 *data,
                                              EipInt16 data_length,
                                              CipMessageRouterRequest *message_router_request)
@@ -269,29 +674,28 @@ CipError CreateMessageRouterRequestStructure(const EipUint8 *data,
 }
 
 void DeleteAllClasses(void) {
-  CipMessageRouterObject *message_router_object = g_first_object; /* get pointer to head of class registration list */
-  CipMessageRouterObject *message_router_object_to_delete = NULL;
+  MessageRouterInvalidateRoutes();
+  g_number_of_deferred_classes = 0;
   CipInstance *instance = NULL;
   CipInstance *instance_to_delete = NULL;
 
-  while(NULL != message_router_object) {
-    message_router_object_to_delete = message_router_object;
-    message_router_object = message_router_object->next;
+  for(size_t i = 0; i < g_number_of_registered_classes; ++i) {
+    CipClass *cip_class = g_registered_classes[i];
 
-    instance = message_router_object_to_delete->cip_class->instances;
+    instance = cip_class->instances;
     while(NULL != instance) {
       instance_to_delete = instance;
       instance = instance->next;
-      if(message_router_object_to_delete->cip_class->number_of_attributes) /* if the class has instance attributes */
+      if(cip_class->number_of_attributes && !cip_class->attribute_tables) /* if the class has instance attributes */
       { /* then free storage for the attribute array */
-        CipFree(instance_to_delete->attributes);
+        CipFree( (void *) instance_to_delete->attributes );
       }
+      CipFree(instance_to_delete->get_attribute_all_cache);
       CipFree(instance_to_delete);
     }
 
     /* free meta class data*/
-    CipClass *meta_class =
-      message_router_object_to_delete->cip_class->class_instance.cip_class;
+    CipClass *meta_class = cip_class->class_instance.cip_class;
     CipFree(meta_class->class_name);
     CipFree(meta_class->services);
     CipFree(meta_class->get_single_bit_mask);
@@ -300,16 +704,15 @@ void DeleteAllClasses(void) {
     CipFree(meta_class);
 
     /* free class data*/
-    CipClass *cip_class = message_router_object_to_delete->cip_class;
     CipFree(cip_class->class_name);
     CipFree(cip_class->get_single_bit_mask);
     CipFree(cip_class->set_bit_mask);
     CipFree(cip_class->get_all_bit_mask);
-    CipFree(cip_class->class_instance.attributes);
+    CipFree( (void *) cip_class->class_instance.attributes );
     CipFree(cip_class->services);
+    CipFree(cip_class->instance_index);
     CipFree(cip_class);
-    /* free message router object */
-    CipFree(message_router_object_to_delete);
+    g_registered_classes[i] = NULL;
   }
-  g_first_object = NULL;
+  g_number_of_registered_classes = 0;
 }
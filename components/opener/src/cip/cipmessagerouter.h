@@ -9,9 +9,35 @@
 #include "typedefs.h"
 #include "ciptypes.h"
 
+#ifndef OPENER_CIP_NUM_DEFERRED_CLASSES
+/** Classes that can wait for their first use, see RegisterDeferredCipClass() */
+#define OPENER_CIP_NUM_DEFERRED_CLASSES 4
+#endif
+
 /** @brief Message Router class code */
 static const CipUint kCipMessageRouterClassCode = 0x02U;
 
+/** @brief Longest request path a route holds in bytes: class, instance and
+ *  attribute as 16-bit logical segments */
+#define CIP_MESSAGE_ROUTER_ROUTE_MAX_PATH_LENGTH 12U
+
+/** @brief Resolved target of the last request of a Class 3 connection
+ *
+ *  HMIs read the same tags cyclically over their connection. A request
+ *  whose service code and path match the last one byte for byte skips
+ *  the path decoding and the class, instance and service look up.
+ *  Routes resolved before a class, instance or service was added or
+ *  removed are ignored. All zero is an empty route.
+ */
+typedef struct {
+  CipOctet request_header[2 + CIP_MESSAGE_ROUTER_ROUTE_MAX_PATH_LENGTH]; /**< service code, path size and path as received */
+  size_t request_header_length; /**< 0 for an empty route */
+  CipEpath request_path; /**< decoded request_header path */
+  CipInstance *instance;
+  CipServiceFunction service_function;
+  CipUdint generation; /**< object model generation the route was resolved in */
+} CipMessageRouterRoute;
+
 /* public functions */
 
 /** @brief Initialize the data structures of the message router
@@ -25,8 +51,11 @@ void DeleteAllClasses(void);
 
 /** @brief Notify the MessageRouter that an explicit message (connected or unconnected)
  *  has been received. This function will be called from the encapsulation layer.
- *  The CPF structure is already parsed an can be accessed via the global variable:
- *  g_stCPFDataItem.
+ *  The CPF items of the request are in the common_packet_format_data of the
+ *  response, services add the items of their reply there.
+ *  The router keeps no state of the request, so every caller passing its
+ *  own data and message_router_response can route independently of the
+ *  others, as the Multiple Service Packet does for its embedded requests.
  *  @param data pointer to the data buffer of the message directly at the beginning of the CIP part.
  *  @param data_length number of bytes in the data buffer
  *  @param originator_address The address of the originator as received
@@ -40,6 +69,29 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
                               const struct sockaddr *const originator_address,
                               const CipSessionHandle encapsulation_session);
 
+/** @brief NotifyMessageRouter() for connected explicit messages
+ *
+ *  Reuses @p route if the request has the same service code and path as
+ *  the previous one, otherwise resolves the request and stores its route.
+ *  Requests that fail to resolve are answered by NotifyMessageRouter() and
+ *  leave the route empty.
+ *
+ *  @param route route cache of the connection the request came in on
+ */
+EipStatus NotifyMessageRouterWithRoute(EipUint8 *data,
+                                       int data_length,
+                                       CipMessageRouterResponse *message_router_response,
+                                       const struct sockaddr *const originator_address,
+                                       const CipSessionHandle encapsulation_session,
+                                       CipMessageRouterRoute *const route);
+
+/** @brief Invalidate all cached routes
+ *
+ *  Called whenever classes, instances or services change, the pointers
+ *  held by a route may not be valid anymore.
+ */
+void MessageRouterInvalidateRoutes(void);
+
 /*! Register a class at the message router.
  *  In order that the message router can deliver
  *  explicit messages each class has to register.
@@ -50,4 +102,25 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
  */
 EipStatus RegisterCipClass(CipClass *cip_class);
 
+/** @brief Creates a deferred class, returns kEipStatusOk once it is
+ *  registered */
+typedef EipStatus (*CipDeferredClassCreate)(void);
+
+/** @brief Register a class that is created when it is first looked up
+ *
+ *  The class is listed in the Message Router's Object_List from now on, but
+ *  @p create only runs on the first GetCipClass() of @p class_code, e.g.
+ *  for the first request addressed to it. Until then the class costs one
+ *  entry of OPENER_CIP_NUM_DEFERRED_CLASSES. Registering a deferred class
+ *  code again replaces its create function, which lets the platform add
+ *  to what the stack's create function does. Classes are created in the
+ *  task running the stack, like all requests.
+ *  @param class_code class code of the class @p create creates
+ *  @param create function creating the class with CreateCipClass()
+ *  @return kEipStatusOk on success
+ *          kEipStatusError if the class exists already or no entry is free
+ */
+EipStatus RegisterDeferredCipClass(const CipUdint class_code,
+                                   CipDeferredClassCreate create);
+
 #endif /* OPENER_CIPMESSAGEROUTER_H_ */
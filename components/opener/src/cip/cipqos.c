@@ -23,6 +23,15 @@
 #define DEFAULT_DSCP_LOW 31U
 #define DEFAULT_DSCP_EXPLICIT 27U
 
+/* 802.1Q priorities of the traffic classes */
+#define PCP_EVENT 7
+#define PCP_GENERAL 5
+#define PCP_URGENT 6
+#define PCP_SCHEDULED 5
+#define PCP_HIGH 4
+#define PCP_LOW 3
+#define PCP_EXPLICIT 3
+
 /** @brief The QoS object
  *
  *  The global instance of the QoS object
@@ -54,6 +63,9 @@ static CipQosDscpValues s_active_dscp = {
   .explicit_msg = DEFAULT_DSCP_EXPLICIT
 };
 
+/** @brief Active 802.1Q Tag Enable, changes come into effect like the DSCP values */
+static CipUsint s_active_q_frames_enable = false;
+
 /************** Functions ****************************************/
 
 
@@ -100,6 +112,28 @@ int DecodeCipQoSAttribute(void *const data,
 
 }
 
+/** @brief Decode the 802.1Q Tag Enable attribute, only 0 and 1 are valid
+ *
+ *  @param data pointer to value to be written.
+ *  @param message_router_request pointer to the request where the data should be taken from
+ *  @param message_router_response pointer to the response where status should be set
+ *  @return length of taken bytes
+ *          -1 .. error
+ */
+static int DecodeCipQoSTagEnable(void *const data,
+                                 CipMessageRouterRequest *const message_router_request,
+                                 CipMessageRouterResponse *const message_router_response)
+{
+  const CipUsint value = GetUsintFromMessage(&message_router_request->data);
+  if(value > 1U) {
+    message_router_response->general_status = kCipErrorInvalidAttributeValue;
+    return -1;
+  }
+  *(CipUsint *)data = value;
+  message_router_response->general_status = kCipErrorSuccess;
+  return 1;
+}
+
 CipUsint CipQosGetDscpPriority(ConnectionObjectPriority priority) {
 
   CipUsint priority_value;
@@ -124,6 +158,59 @@ CipUsint CipQosGetDscpPriority(ConnectionObjectPriority priority) {
   return priority_value;
 }
 
+int CipQosGetVlanPriority(CipUsint dscp) {
+  if(!s_active_q_frames_enable) {
+    return -1;
+  }
+  /* classes sharing a DSCP value get the higher priority */
+  if(dscp == s_active_dscp.event) {
+    return PCP_EVENT;
+  }
+  if(dscp == s_active_dscp.urgent) {
+    return PCP_URGENT;
+  }
+  if(dscp == s_active_dscp.general) {
+    return PCP_GENERAL;
+  }
+  if(dscp == s_active_dscp.scheduled) {
+    return PCP_SCHEDULED;
+  }
+  if(dscp == s_active_dscp.high) {
+    return PCP_HIGH;
+  }
+  if(dscp == s_active_dscp.low) {
+    return PCP_LOW;
+  }
+  if(dscp == s_active_dscp.explicit_msg) {
+    return PCP_EXPLICIT;
+  }
+  return -1;
+}
+
+CipUsint CipQosGetDscpPtp(CipBool event) {
+  return event ? s_active_dscp.event : s_active_dscp.general;
+}
+
+/* The instance attributes, kept in flash */
+static const CipAttributeStruct kQosInstanceAttributes[] = {
+  CIP_ATTRIBUTE(1, kCipUsint, EncodeCipUsint, DecodeCipQoSTagEnable,
+                &g_qos.q_frames_enable, kGetableSingle | kSetable | kNvDataFunc),
+  CIP_ATTRIBUTE(2, kCipUsint, EncodeCipUsint, NULL, &g_qos.dscp.event,
+                kNotSetOrGetable),
+  CIP_ATTRIBUTE(3, kCipUsint, EncodeCipUsint, NULL, &g_qos.dscp.general,
+                kNotSetOrGetable),
+  CIP_ATTRIBUTE(4, kCipUsint, EncodeCipUsint, DecodeCipQoSAttribute,
+                &g_qos.dscp.urgent, kGetableSingle | kSetable | kNvDataFunc),
+  CIP_ATTRIBUTE(5, kCipUsint, EncodeCipUsint, DecodeCipQoSAttribute,
+                &g_qos.dscp.scheduled, kGetableSingle | kSetable | kNvDataFunc),
+  CIP_ATTRIBUTE(6, kCipUsint, EncodeCipUsint, DecodeCipQoSAttribute,
+                &g_qos.dscp.high, kGetableSingle | kSetable | kNvDataFunc),
+  CIP_ATTRIBUTE(7, kCipUsint, EncodeCipUsint, DecodeCipQoSAttribute,
+                &g_qos.dscp.low, kGetableSingle | kSetable | kNvDataFunc),
+  CIP_ATTRIBUTE(8, kCipUsint, EncodeCipUsint, DecodeCipQoSAttribute,
+                &g_qos.dscp.explicit_msg, kGetableSingle | kSetable | kNvDataFunc),
+};
+
 EipStatus CipQoSInit() {
 
   CipClass *qos_class = NULL;
@@ -132,7 +219,7 @@ EipStatus CipQoSInit() {
                                    7, /* # class attributes */
                                    7, /* # highest class attribute number */
                                    2, /* # class services */
-                                   8, /* # instance attributes */
+                                   0, /* # instance attributes, from kQosInstanceAttributes */
                                    8, /* # highest instance attribute number */
                                    2, /* # instance services */
                                    1, /* # instances */
@@ -144,64 +231,9 @@ EipStatus CipQoSInit() {
     return kEipStatusError;
   }
 
-  CipInstance *instance = GetCipInstance(qos_class, 1); /* bind attributes to the instance #1 that was created above */
-
-  InsertAttribute(instance,
-                  1,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  NULL,
-                  (void *) &g_qos.q_frames_enable,
-                  kNotSetOrGetable);
-  InsertAttribute(instance,
-                  2,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  NULL,
-                  (void *) &g_qos.dscp.event,
-                  kNotSetOrGetable);
-  InsertAttribute(instance,
-                  3,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  NULL,
-                  (void *) &g_qos.dscp.general,
-                  kNotSetOrGetable);
-  InsertAttribute(instance,
-                  4,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  DecodeCipQoSAttribute,
-                  (void *) &g_qos.dscp.urgent,
-                  kGetableSingle | kSetable | kNvDataFunc);
-  InsertAttribute(instance,
-                  5,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  DecodeCipQoSAttribute,
-                  (void *) &g_qos.dscp.scheduled,
-                  kGetableSingle | kSetable | kNvDataFunc);
-  InsertAttribute(instance,
-                  6,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  DecodeCipQoSAttribute,
-                  (void *) &g_qos.dscp.high,
-                  kGetableSingle | kSetable | kNvDataFunc);
-  InsertAttribute(instance,
-                  7,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  DecodeCipQoSAttribute,
-                  (void *) &g_qos.dscp.low,
-                  kGetableSingle | kSetable | kNvDataFunc);
-  InsertAttribute(instance,
-                  8,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  DecodeCipQoSAttribute,
-                  (void *) &g_qos.dscp.explicit_msg,
-                  kGetableSingle | kSetable | kNvDataFunc);
+  SetCipInstanceAttributes(GetCipInstance(qos_class, 1),
+                           kQosInstanceAttributes,
+                           NELEMENTS(kQosInstanceAttributes) );
 
   InsertService(qos_class, kGetAttributeSingle, &GetAttributeSingle,
                 "GetAttributeSingle");
@@ -213,6 +245,7 @@ EipStatus CipQoSInit() {
 
 void CipQosUpdateUsedSetQosValues(void) {
   s_active_dscp = g_qos.dscp;
+  s_active_q_frames_enable = g_qos.q_frames_enable;
 }
 
 void CipQosResetAttributesToDefaultValues(void) {
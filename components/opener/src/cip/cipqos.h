@@ -49,11 +49,30 @@ extern CipQosObject g_qos;
  */
 CipUsint CipQosGetDscpPriority(ConnectionObjectPriority priority);
 
+/** @brief Provide the 802.1Q priority for a frame sent with the given DSCP value
+ *
+ *  Maps the active DSCP values to the priorities the CIP specification assigns
+ *  to the traffic classes: 7 for PTP event, 6 for urgent, 5 for PTP general and
+ *  scheduled, 4 for high and 3 for low and explicit messages.
+ *
+ *  @param dscp DSCP value of the frame
+ *  @return priority 0 ... 7, or -1 if the frame is not to be tagged, because
+ *  802.1Q tagging is disabled or @p dscp belongs to no CIP traffic class
+ */
+int CipQosGetVlanPriority(CipUsint dscp);
+
+/** @brief Provide the active DSCP value of IEEE 1588 messages
+ *
+ *  @param event true for event messages (Sync, Delay_Req), false for general
+ *  messages (Announce, Follow_Up, Delay_Resp)
+ */
+CipUsint CipQosGetDscpPtp(CipBool event);
+
 /** @brief Create and initialize the QoS object
  */
 EipStatus CipQoSInit(void);
 
-/** @brief Updates the currently used set of DSCP priority values
+/** @brief Updates the currently used set of DSCP priority values and 802.1Q tag enable
  */
 void CipQosUpdateUsedSetQosValues(void);
 
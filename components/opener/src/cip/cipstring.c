@@ -193,6 +193,37 @@ CipString *SetCipStringByCstr(CipString *const cip_string,
                             (const CipOctet *) string);
 }
 
+CipStringFixed *SetCipStringFixedByData(CipStringFixed *const cip_string,
+                                        const size_t capacity,
+                                        const CipUint str_len,
+                                        const CipOctet *const data) {
+  if(str_len > capacity) {
+    cip_string->length = 0;
+    return NULL;
+  }
+  /* No trailing '\0' character. */
+  memcpy(GetCipStringFixedData(cip_string), data, str_len);
+  cip_string->length = str_len;
+  return cip_string;
+}
+
+CipStringFixed *SetCipStringFixedByCstr(CipStringFixed *const cip_string,
+                                        const size_t capacity,
+                                        const char *const string) {
+  const size_t str_len = strlen(string);
+  if(str_len > capacity) {
+    cip_string->length = 0;
+    return NULL;
+  }
+  return SetCipStringFixedByData(cip_string, capacity, (CipUint) str_len,
+                                 (const CipOctet *) string);
+}
+
+CipStringFixed *ClearCipStringFixed(CipStringFixed *const cip_string) {
+  cip_string->length = 0;
+  return cip_string;
+}
+
 CipShortString *ClearCipShortString(CipShortString *const cip_string) {
   if(NULL != cip_string) {
     if(NULL != cip_string->string) {
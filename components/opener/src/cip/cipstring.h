@@ -130,6 +130,57 @@ CipString *SetCipStringByData(CipString *const cip_string,
 CipString *SetCipStringByCstr(CipString *const cip_string,
                               const char *const string);
 
+/** @brief Sets a fixed capacity string from an octet stream, in place
+ *
+ * @param cip_string Header of the target CIP_STRING_FIXED()
+ * @param capacity Characters the target holds, the size of its string member
+ * @param str_len Amount of symbols
+ * @param data The octet stream
+ *
+ * @return The target, or NULL if @p str_len exceeds @p capacity; the target
+ *         is empty then
+ */
+CipStringFixed *SetCipStringFixedByData(CipStringFixed *const cip_string,
+                                        const size_t capacity,
+                                        const CipUint str_len,
+                                        const CipOctet *const data);
+
+/** @brief Copies a C-string to a fixed capacity string, in place
+ *
+ * @param cip_string Header of the target CIP_STRING_FIXED()
+ * @param capacity Characters the target holds
+ * @param string Source C-string
+ *
+ * @return The target, or NULL if @p string is too long; the target is empty
+ *         then
+ */
+CipStringFixed *SetCipStringFixedByCstr(CipStringFixed *const cip_string,
+                                        const size_t capacity,
+                                        const char *const string);
+
+/** @brief Empties a fixed capacity string
+ *
+ * @param cip_string Header of the CIP_STRING_FIXED()
+ *
+ * @return The emptied string
+ */
+CipStringFixed *ClearCipStringFixed(CipStringFixed *const cip_string);
+
+/** @brief Characters of a fixed capacity string, they follow its header */
+static inline CipByte *GetCipStringFixedData(CipStringFixed *const cip_string)
+{
+  return (CipByte *) (cip_string + 1);
+}
+
+/** @brief SetCipStringFixedByData() through a pointer to a CIP_STRING_FIXED() */
+#define CIP_STRING_FIXED_SET_BY_DATA(fixed, str_len, data) \
+  SetCipStringFixedByData(&(fixed)->header, sizeof( (fixed)->string), \
+                          (str_len), (data) )
+
+/** @brief SetCipStringFixedByCstr() through a pointer to a CIP_STRING_FIXED() */
+#define CIP_STRING_FIXED_SET_BY_CSTR(fixed, cstr) \
+  SetCipStringFixedByCstr(&(fixed)->header, sizeof( (fixed)->string), (cstr) )
+
 /** @brief Clears the internal CipShortString structure
  *
  * @param cip_string The CipShortString structure to be cleared
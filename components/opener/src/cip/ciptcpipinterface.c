@@ -19,10 +19,11 @@
 #include "trace.h"
 #include "cipassembly.h"
 #include "nvtcpip.h"
+#include "seqlock.h"
 
 enum {
-  kTcpipMaxDomainLength = 48,
-  kTcpipMaxHostnameLength = 64,
+  kTcpipMaxDomainLength = CIP_TCPIP_MAX_DOMAIN_LENGTH,
+  kTcpipMaxHostnameLength = CIP_TCPIP_MAX_HOSTNAME_LENGTH,
 };
 
 /* Define constants to initialize the config_capability attribute (#2). These
@@ -49,6 +50,9 @@ enum {
   #define CFG_CAPS  (CFG_CAPS_DHCP_CLIENT | CFG_CAPS_ACD_CAPABLE)
 #endif
 
+/** Sequence lock of the g_tcpip values copied by CipTcpIpGetSnapshot() */
+static SeqLock s_tcpip_lock;
+
 /** definition of TCP/IP object instance 1 data */
 CipTcpIpObject g_tcpip =
 {
@@ -79,12 +83,11 @@ CipTcpIpObject g_tcpip =
     0, /* NameServer */
     0, /* NameServer2 */
     { /* DomainName */
-      0, NULL,
+      { 0 },
     }
   },
   .hostname = { /* attribute #6 hostname */
-    0,
-    NULL
+    { 0 },
   },
   .mcast_ttl_value = 1,  /* attribute #8 mcast TTL value */
   .mcast_config = {   /* attribute #9 multicast configuration */
@@ -94,6 +97,7 @@ CipTcpIpObject g_tcpip =
     0   /* the multicast address will be allocated on IP address configuration */
   },
   .select_acd = false,
+  .quick_connect = false,
   .encapsulation_inactivity_timeout = 120 /* attribute #13 encapsulation_inactivity_timeout, use a default value of 120 */
 };
 
@@ -323,14 +327,21 @@ static CipUsint dummy_data_field = 0; /**< dummy data fiel to provide non-null d
  * and raw ARP frame) as required by EtherNet/IP specification for Attribute #11
  * "Last Conflict Detected"
  */
-static struct {
+typedef struct {
   CipUsint activity;
   CipUsint remote_mac[6];
   CipUsint raw_data[28];
-} s_tcpip_last_conflict = {0};
+} TcpipLastConflict;
+
+static TcpipLastConflict s_tcpip_last_conflict = {0};
+
+/** Written by the lwIP task, read by the stack when it encodes attribute #11 */
+static SeqLock s_last_conflict_lock;
 
 static void TcpipSetLastConflictState(CipUsint activity) {
+  SeqLockWriteBegin(&s_last_conflict_lock);
   s_tcpip_last_conflict.activity = activity;
+  SeqLockWriteEnd(&s_last_conflict_lock);
   /* MAC and raw_data persist across activity changes to maintain conflict history.
    * They are only set when a conflict is detected (via CipTcpIpSetLastAcdMac/RawData)
    * and should remain available for diagnostic purposes even after the conflict
@@ -358,7 +369,8 @@ void CipTcpIpSetLastAcdActivity(CipUsint activity) {
  */
 void CipTcpIpSetLastAcdMac(const uint8_t mac[6]) {
   if (NULL != mac) {
-    memcpy(s_tcpip_last_conflict.remote_mac, mac, sizeof(s_tcpip_last_conflict.remote_mac));
+    SeqLockWrite(&s_last_conflict_lock, s_tcpip_last_conflict.remote_mac, mac,
+                 sizeof(s_tcpip_last_conflict.remote_mac) );
   }
 }
 
@@ -369,7 +381,7 @@ void CipTcpIpSetLastAcdMac(const uint8_t mac[6]) {
  *  This function is called from lwIP ACD when a conflict is detected
  *  to store the raw ARP frame for Attribute #11 diagnostic purposes
  */
-void CipTcpIpSetLastAcdRawData(const uint8_t *data, size_t length) {
+static void TcpipCopyLastConflictRawData(const uint8_t *data, size_t length) {
   if (NULL == data) {
     memset(s_tcpip_last_conflict.raw_data, 0, sizeof(s_tcpip_last_conflict.raw_data));
     return;
@@ -385,6 +397,25 @@ void CipTcpIpSetLastAcdRawData(const uint8_t *data, size_t length) {
   }
 }
 
+void CipTcpIpSetLastAcdRawData(const uint8_t *data, size_t length) {
+  SeqLockWriteBegin(&s_last_conflict_lock);
+  TcpipCopyLastConflictRawData(data, length);
+  SeqLockWriteEnd(&s_last_conflict_lock);
+}
+
+void CipTcpIpSetLastAcdConflict(CipUsint activity,
+                                const uint8_t mac[6],
+                                const uint8_t *data,
+                                size_t length) {
+  SeqLockWriteBegin(&s_last_conflict_lock);
+  s_tcpip_last_conflict.activity = activity;
+  if (NULL != mac) {
+    memcpy(s_tcpip_last_conflict.remote_mac, mac, sizeof(s_tcpip_last_conflict.remote_mac));
+  }
+  TcpipCopyLastConflictRawData(data, length);
+  SeqLockWriteEnd(&s_last_conflict_lock);
+}
+
 /************** Functions ****************************************/
 
 void EncodeCipTcpIpInterfaceConfiguration(const void *const data,
@@ -403,8 +434,8 @@ void EncodeCipTcpIpInterfaceConfiguration(const void *const data,
                    outgoing_message);
   AddDintToMessage(ntohl(tcp_ip_network_interface_configuration->name_server_2),
                    outgoing_message);
-  EncodeCipString(&(tcp_ip_network_interface_configuration->domain_name),
-                  outgoing_message);
+  EncodeCipStringFixed(&(tcp_ip_network_interface_configuration->domain_name),
+                       outgoing_message);
 }
 
 void EncodeCipTcpIpMulticastConfiguration(const void *const data,
@@ -441,18 +472,24 @@ void EncodeCipLastConflictDetected(const void *const data,
                                    ENIPMessage *const outgoing_message) {
   (void)data;
 
-  outgoing_message->current_message_position[0] = s_tcpip_last_conflict.activity;
+  /* A conflict recorded during all attempts is rare, the torn copy of the
+   * last attempt is sent then and the next read is consistent again */
+  TcpipLastConflict last_conflict;
+  (void)SeqLockRead(&s_last_conflict_lock, &last_conflict, &s_tcpip_last_conflict,
+                    sizeof(last_conflict), NULL);
+
+  outgoing_message->current_message_position[0] = last_conflict.activity;
   MoveMessageNOctets(1, outgoing_message);
 
   memcpy(outgoing_message->current_message_position,
-         s_tcpip_last_conflict.remote_mac,
-         sizeof(s_tcpip_last_conflict.remote_mac));
-  MoveMessageNOctets(sizeof(s_tcpip_last_conflict.remote_mac), outgoing_message);
+         last_conflict.remote_mac,
+         sizeof(last_conflict.remote_mac));
+  MoveMessageNOctets(sizeof(last_conflict.remote_mac), outgoing_message);
 
   memcpy(outgoing_message->current_message_position,
-         s_tcpip_last_conflict.raw_data,
-         sizeof(s_tcpip_last_conflict.raw_data));
-  MoveMessageNOctets(sizeof(s_tcpip_last_conflict.raw_data), outgoing_message);
+         last_conflict.raw_data,
+         sizeof(last_conflict.raw_data));
+  MoveMessageNOctets(sizeof(last_conflict.raw_data), outgoing_message);
 }
 
 
@@ -520,27 +557,22 @@ int DecodeCipTcpIpInterfaceConfiguration( /* Attribute 5 */
 		message_router_response->general_status = kCipErrorTooMuchData;
 		return number_of_decoded_bytes;
 	}
-	if (NULL == SetCipStringByData(&if_cfg.domain_name, domain_name_length,
-                                 message_router_request->data) ) {
-    message_router_response->general_status = kCipErrorNotEnoughData;
-    return number_of_decoded_bytes;
-  }
+	(void) CIP_STRING_FIXED_SET_BY_DATA(&if_cfg.domain_name, domain_name_length,
+                                      message_router_request->data);
 	domain_name_length = (domain_name_length + 1) & (~0x0001u); /* Align for possible pad byte */
-  const char *domain_str = (if_cfg.domain_name.length > 0 && NULL != if_cfg.domain_name.string)
-                           ? (const char *)if_cfg.domain_name.string : "";
-  OPENER_TRACE_INFO("Domain: ds %hu '%s'\n",
-                    domain_name_length,
-                    domain_str);
 
   bool domain_valid = true;
-  if (if_cfg.domain_name.length > 0) {
+  if (if_cfg.domain_name.header.length > 0) {
     char domain_buf[kTcpipMaxDomainLength + 1] = {0};
-    CipUint len = if_cfg.domain_name.length;
+    CipUint len = if_cfg.domain_name.header.length;
     if (len > kTcpipMaxDomainLength) {
       len = kTcpipMaxDomainLength;
     }
     memcpy(domain_buf, if_cfg.domain_name.string, len);
     domain_valid = IsValidDomain((EipByte *)domain_buf);
+    OPENER_TRACE_INFO("Domain: ds %hu '%s'\n",
+                      domain_name_length,
+                      domain_buf);
   }
 
   if (!CipTcpIpIsValidNetworkConfig(&if_cfg) || !domain_valid) {
@@ -549,6 +581,7 @@ int DecodeCipTcpIpInterfaceConfiguration( /* Attribute 5 */
     return number_of_decoded_bytes;
   }
 
+  CipTcpIpBeginUpdate();
   if (switch_to_static) {
     g_tcpip.config_control &= ~kTcpipCfgCtrlMethodMask;
     g_tcpip.config_control |= kTcpipCfgCtrlStaticIp;
@@ -559,6 +592,7 @@ int DecodeCipTcpIpInterfaceConfiguration( /* Attribute 5 */
 
 	/* Tell that this configuration change becomes active after a reset */
 	g_tcpip.status |= kTcpipStatusIfaceCfgPend;
+  CipTcpIpEndUpdate();
 	message_router_response->general_status = kCipErrorSuccess;
 
 	return number_of_decoded_bytes;
@@ -566,43 +600,31 @@ int DecodeCipTcpIpInterfaceConfiguration( /* Attribute 5 */
 }
 
 int DecodeCipTcpIpInterfaceHostName( /* Attribute 6 */
-		CipString *const data,
+		CipTcpIpHostName *const data,
 		CipMessageRouterRequest *const message_router_request,
 		CipMessageRouterResponse *const message_router_response) {
 
 	int number_of_decoded_bytes = -1;
 
-	          CipString tmp_host_name = {
-	            .length = 0u,
-	            .string = NULL
-	          };
+	          CipTcpIpHostName tmp_host_name;
 	          CipUint host_name_length =
 	            GetUintFromMessage(&(message_router_request->data) );
 	          if (host_name_length > kTcpipMaxHostnameLength) {  /* see RFC 1123 on more details */
 	            message_router_response->general_status = kCipErrorTooMuchData;
 	            return number_of_decoded_bytes;
 	          }
-          if (NULL == SetCipStringByData(&tmp_host_name,
-                                         host_name_length,
-                                         message_router_request->data) ) {
-            message_router_response->general_status = kCipErrorNotEnoughData;
-            return number_of_decoded_bytes;
-          }
+          (void) CIP_STRING_FIXED_SET_BY_DATA(&tmp_host_name,
+                                              host_name_length,
+                                              message_router_request->data);
 	          CipUint padded_length = (host_name_length + 1) & (~0x0001u);  /* Align for possible pad byte */
-          const char *host_str = (tmp_host_name.length > 0 && NULL != tmp_host_name.string)
-                                 ? (const char *)tmp_host_name.string : "";
-          OPENER_TRACE_INFO("Host Name: ds %hu '%s'\n",
-                            padded_length,
-                            host_str);
 
           bool hostname_valid = true;
           if (host_name_length > 0) {
             char host_buf[kTcpipMaxHostnameLength + 1] = {0};
-            CipUint len = host_name_length;
-            if (len > kTcpipMaxHostnameLength) {
-              len = kTcpipMaxHostnameLength;
-            }
-            memcpy(host_buf, tmp_host_name.string, len);
+            memcpy(host_buf, tmp_host_name.string, host_name_length);
+            OPENER_TRACE_INFO("Host Name: ds %hu '%s'\n",
+                              padded_length,
+                              host_buf);
             hostname_valid = IsValidDomain((EipByte *)host_buf);
           }
 
@@ -612,10 +634,12 @@ int DecodeCipTcpIpInterfaceHostName( /* Attribute 6 */
             return number_of_decoded_bytes;
           }
 
-          *data = tmp_host_name; //write data to attribute
+          *data = tmp_host_name; /* copied in place, nothing to allocate */
 
 	          /* Tell that this configuration change becomes active after a reset */
+          CipTcpIpBeginUpdate();
 	          g_tcpip.status |= kTcpipStatusIfaceCfgPend;
+          CipTcpIpEndUpdate();
 	          message_router_response->general_status = kCipErrorSuccess;
 
 	return number_of_decoded_bytes;
@@ -635,7 +659,7 @@ static int DecodeTcpIpInterfaceHostNameWrapper(void *const data,
 		CipMessageRouterRequest *const message_router_request,
 		CipMessageRouterResponse *const message_router_response) {
   return DecodeCipTcpIpInterfaceHostName(
-            (CipString *)data,
+            (CipTcpIpHostName *)data,
             message_router_request,
             message_router_response);
 }
@@ -659,8 +683,34 @@ static int DecodeTcpIpSelectAcd(void *const data,
   *(CipBool *)data = (CipBool)selection;
   message_router_response->general_status = kCipErrorSuccess;
   /* Clear previous ACD fault indications whenever the setting changes */
+  CipTcpIpBeginUpdate();
   g_tcpip.status &= ~(kTcpipStatusAcdStatus | kTcpipStatusAcdFault);
-  (void)NvTcpipStore(&g_tcpip);
+  CipTcpIpEndUpdate();
+  (void)NvTcpipStoreDeferred();
+
+  return 1;
+}
+
+/* Takes effect on the next power-up, see the boot path in main.c */
+static int DecodeTcpIpQuickConnect(void *const data,
+                                   CipMessageRouterRequest *const message_router_request,
+                                   CipMessageRouterResponse *const message_router_response) {
+  if (message_router_request->request_data_size < 1) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return -1;
+  }
+
+  CipUsint selection = GetUsintFromMessage(&(message_router_request->data));
+  if (selection > 1) {
+    message_router_response->general_status = kCipErrorInvalidAttributeValue;
+    return -1;
+  }
+
+  CipTcpIpBeginUpdate();
+  *(CipBool *)data = (CipBool)selection;
+  CipTcpIpEndUpdate();
+  message_router_response->general_status = kCipErrorSuccess;
+  (void)NvTcpipStoreDeferred();
 
   return 1;
 }
@@ -680,7 +730,9 @@ int DecodeCipTcpIpInterfaceEncapsulationInactivityTimeout( /* Attribute 13 */
 				kCipErrorInvalidAttributeValue;
 	} else {
 
+		CipTcpIpBeginUpdate();
 		*(CipUint *)data = inactivity_timeout_received;
+		CipTcpIpEndUpdate();
 		message_router_response->general_status = kCipErrorSuccess;
 		number_of_decoded_bytes = 2;
 
@@ -690,6 +742,62 @@ int DecodeCipTcpIpInterfaceEncapsulationInactivityTimeout( /* Attribute 13 */
 
 }
 
+/* The instance attributes, kept in flash */
+static const CipAttributeStruct kTcpIpInstanceAttributes[] = {
+  CIP_ATTRIBUTE(1, kCipDword, EncodeCipDword, NULL, &g_tcpip.status,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(2, kCipDword, EncodeCipDword, NULL, &g_tcpip.config_capability,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(3, kCipDword, EncodeCipDword,
+                DecodeTcpIpInterfaceConfigurationControl,
+                &g_tcpip.config_control,
+                kSetAndGetAble | kNvDataFunc | IFACE_CFG_SET_MODE),
+  CIP_ATTRIBUTE(4, kCipEpath, EncodeCipEPath, NULL,
+                &g_tcpip.physical_link_object, kGetableSingleAndAll),
+#if defined (OPENER_TCPIP_IFACE_CFG_SETTABLE) && \
+  0 != OPENER_TCPIP_IFACE_CFG_SETTABLE
+  CIP_ATTRIBUTE(5, kCipUdintUdintUdintUdintUdintString,
+                EncodeCipTcpIpInterfaceConfiguration,
+                DecodeTcpIpInterfaceConfigurationWrapper,
+                &g_tcpip.interface_configuration,
+                kGetableSingleAndAll | kNvDataFunc | IFACE_CFG_SET_MODE),
+  CIP_ATTRIBUTE(6, kCipString, EncodeCipStringFixed,
+                DecodeTcpIpInterfaceHostNameWrapper, &g_tcpip.hostname,
+                kGetableSingleAndAll | kNvDataFunc | IFACE_CFG_SET_MODE),
+#else
+  CIP_ATTRIBUTE(5, kCipUdintUdintUdintUdintUdintString,
+                EncodeCipTcpIpInterfaceConfiguration,
+                NULL, /* not settable */
+                &g_tcpip.interface_configuration,
+                kGetableSingleAndAll | kNvDataFunc | IFACE_CFG_SET_MODE),
+  CIP_ATTRIBUTE(6, kCipString, EncodeCipStringFixed,
+                NULL, /* not settable */
+                &g_tcpip.hostname,
+                kGetableSingleAndAll | kNvDataFunc | IFACE_CFG_SET_MODE),
+#endif /* defined (OPENER_TCPIP_IFACE_CFG_SETTABLE) && 0 != OPENER_TCPIP_IFACE_CFG_SETTABLE*/
+  CIP_ATTRIBUTE(7, kCipAny, EncodeSafetyNetworkNumber, NULL, &dummy_data_field,
+                kGetableAllDummy),
+  CIP_ATTRIBUTE(8, kCipUsint, EncodeCipUsint, NULL, &g_tcpip.mcast_ttl_value,
+                kGetableSingleAndAll),
+  CIP_ATTRIBUTE(9, kCipAny, EncodeCipTcpIpMulticastConfiguration, NULL,
+                &g_tcpip.mcast_config, kGetableSingleAndAll),
+  CIP_ATTRIBUTE(10, kCipBool, EncodeCipBool, DecodeTcpIpSelectAcd,
+                &g_tcpip.select_acd,
+                kGetableSingleAndAll | kSetable | kNvDataFunc),
+  /* MODIFICATION: Register Attribute #11 "Last Conflict Detected"
+   * Added by: Adam G. Sweeney <agsweeney@gmail.com>
+   * This attribute stores ACD conflict data as required by EtherNet/IP specification
+   */
+  CIP_ATTRIBUTE(11, kCipAny, EncodeCipLastConflictDetected, NULL,
+                &dummy_data_field, kGetableSingleAndAll),
+  CIP_ATTRIBUTE(12, kCipBool, EncodeCipBool, DecodeTcpIpQuickConnect,
+                &g_tcpip.quick_connect,
+                kGetableSingleAndAll | kSetable | kNvDataFunc),
+  CIP_ATTRIBUTE(13, kCipUint, EncodeCipUint,
+                DecodeCipTcpIpInterfaceEncapsulationInactivityTimeout,
+                &g_tcpip.encapsulation_inactivity_timeout,
+                kSetAndGetAble | kNvDataFunc),
+};
 
 EipStatus CipTcpIpInterfaceInit() {
   CipClass *tcp_ip_class = NULL;
@@ -698,7 +806,7 @@ EipStatus CipTcpIpInterfaceInit() {
                                        0, /* # class attributes */
                                        7, /* # highest class attribute number */
                                        2, /* # class services */
-                                       13, /* # instance attributes */
+                                       0, /* # instance attributes, from kTcpIpInstanceAttributes */
                                        13, /* # highest instance attribute number */
                                        3, /* # instance services */
                                        1, /* # instances */
@@ -708,124 +816,9 @@ EipStatus CipTcpIpInterfaceInit() {
     return kEipStatusError;
   }
 
-  CipInstance *instance = GetCipInstance(tcp_ip_class, 1); /* bind attributes to the instance #1 that was created above */
-
-  InsertAttribute(instance,
-                  1,
-                  kCipDword,
-                  EncodeCipDword,
-                  NULL,
-                  &g_tcpip.status,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance,
-                  2,
-                  kCipDword,
-                  EncodeCipDword,
-                  NULL,
-                  &g_tcpip.config_capability,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance,
-                  3,
-                  kCipDword,
-                  EncodeCipDword,
-                  DecodeTcpIpInterfaceConfigurationControl,
-                  &g_tcpip.config_control,
-                  kSetAndGetAble | kNvDataFunc | IFACE_CFG_SET_MODE );
-  InsertAttribute(instance,
-                  4,
-                  kCipEpath,
-                  EncodeCipEPath,
-                  NULL,
-                  &g_tcpip.physical_link_object,
-                  kGetableSingleAndAll);
-
-#if defined (OPENER_TCPIP_IFACE_CFG_SETTABLE) && \
-          0 != OPENER_TCPIP_IFACE_CFG_SETTABLE
-  InsertAttribute(instance,
-                  5,
-                  kCipUdintUdintUdintUdintUdintString,
-                  EncodeCipTcpIpInterfaceConfiguration,
-                  DecodeTcpIpInterfaceConfigurationWrapper,
-                  &g_tcpip.interface_configuration,
-                  kGetableSingleAndAll | kNvDataFunc | IFACE_CFG_SET_MODE);
-  InsertAttribute(instance,
-                  6,
-                  kCipString,
-                  EncodeCipString,
-                  DecodeTcpIpInterfaceHostNameWrapper,
-                  &g_tcpip.hostname,
-                  kGetableSingleAndAll | kNvDataFunc | IFACE_CFG_SET_MODE);
-
-#else
-  InsertAttribute(instance,
-                  5,
-                  kCipUdintUdintUdintUdintUdintString,
-                  EncodeCipTcpIpInterfaceConfiguration,
-                  NULL, //not settable
-                  &g_tcpip.interface_configuration,
-                  kGetableSingleAndAll | kNvDataFunc | IFACE_CFG_SET_MODE);
-    InsertAttribute(instance,
-                  6,
-                  kCipString,
-                  EncodeCipString,
-                  NULL, //not settable
-                  &g_tcpip.hostname,
-                  kGetableSingleAndAll | kNvDataFunc | IFACE_CFG_SET_MODE);
-
-#endif /* defined (OPENER_TCPIP_IFACE_CFG_SETTABLE) && 0 != OPENER_TCPIP_IFACE_CFG_SETTABLE*/
-
-  InsertAttribute(instance,
-                  7,
-                  kCipAny,
-                  EncodeSafetyNetworkNumber,
-                  NULL,
-                  &dummy_data_field,
-                  kGetableAllDummy);
-  InsertAttribute(instance,
-                  8,
-                  kCipUsint,
-                  EncodeCipUsint,
-                  NULL,
-                  &g_tcpip.mcast_ttl_value,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance,
-                  9,
-                  kCipAny,
-                  EncodeCipTcpIpMulticastConfiguration,
-                  NULL,
-                  &g_tcpip.mcast_config,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance,
-                  10,
-                  kCipBool,
-                  EncodeCipBool,
-                  DecodeTcpIpSelectAcd,
-                  &g_tcpip.select_acd,
-                  kGetableSingleAndAll | kSetable | kNvDataFunc);
-  /* MODIFICATION: Register Attribute #11 "Last Conflict Detected"
-   * Added by: Adam G. Sweeney <agsweeney@gmail.com>
-   * This attribute stores ACD conflict data as required by EtherNet/IP specification
-   */
-  InsertAttribute(instance,
-                  11,
-                  kCipBool,
-                  EncodeCipLastConflictDetected,
-                  NULL,
-                  &dummy_data_field,
-                  kGetableSingleAndAll);
-  InsertAttribute(instance,
-                  12,
-                  kCipBool,
-                  EncodeCipBool,
-                  NULL,
-                  &dummy_data_field, kGetableAllDummy);
-  InsertAttribute(instance,
-                  13,
-                  kCipUint,
-                  EncodeCipUint,
-                  DecodeCipTcpIpInterfaceEncapsulationInactivityTimeout,
-                  &g_tcpip.encapsulation_inactivity_timeout,
-                  kSetAndGetAble | kNvDataFunc);
+  SetCipInstanceAttributes(GetCipInstance(tcp_ip_class, 1),
+                           kTcpIpInstanceAttributes,
+                           NELEMENTS(kTcpIpInstanceAttributes) );
 
   InsertService(tcp_ip_class, kGetAttributeSingle,
                 &GetAttributeSingle,
@@ -842,16 +835,8 @@ EipStatus CipTcpIpInterfaceInit() {
 }
 
 void ShutdownTcpIpInterface(void) {
-  /*Only free the resources if they are initialized */
-  if (NULL != g_tcpip.hostname.string) {
-    CipFree(g_tcpip.hostname.string);
-    g_tcpip.hostname.string = NULL;
-  }
-
-  if (NULL != g_tcpip.interface_configuration.domain_name.string) {
-    CipFree(g_tcpip.interface_configuration.domain_name.string);
-    g_tcpip.interface_configuration.domain_name.string = NULL;
-  }
+  (void) ClearCipStringFixed(&g_tcpip.hostname.header);
+  (void) ClearCipStringFixed(&g_tcpip.interface_configuration.domain_name.header);
 }
 
 /**
@@ -876,10 +861,39 @@ void CipTcpIpCalculateMulticastIp(CipTcpIpObject *const tcpip) {
 
 
 EipUint16 GetEncapsulationInactivityTimeout(CipInstance *instance) {
-  CipAttributeStruct *attribute = GetCipAttribute(instance, 13);
+  const CipAttributeStruct *attribute = GetCipAttribute(instance, 13);
   OPENER_ASSERT(NULL != attribute);
   CipUint *data = (CipUint *) attribute->data;
   EipUint16 encapsulation_inactivity_timeout = *data;
   return encapsulation_inactivity_timeout;
 }
 
+void CipTcpIpBeginUpdate(void) {
+  SeqLockWriteBegin(&s_tcpip_lock);
+}
+
+void CipTcpIpEndUpdate(void) {
+  SeqLockWriteEnd(&s_tcpip_lock);
+}
+
+EipStatus CipTcpIpGetSnapshot(CipTcpIpSnapshot *const snapshot) {
+  for (unsigned int attempt = 0; attempt < kSeqLockReadAttempts; ++attempt) {
+    const uint32_t sequence = SeqLockReadBegin(&s_tcpip_lock);
+    snapshot->status = g_tcpip.status;
+    snapshot->config_capability = g_tcpip.config_capability;
+    snapshot->config_control = g_tcpip.config_control;
+    snapshot->ip_address = g_tcpip.interface_configuration.ip_address;
+    snapshot->network_mask = g_tcpip.interface_configuration.network_mask;
+    snapshot->gateway = g_tcpip.interface_configuration.gateway;
+    snapshot->name_server = g_tcpip.interface_configuration.name_server;
+    snapshot->name_server_2 = g_tcpip.interface_configuration.name_server_2;
+    snapshot->encapsulation_inactivity_timeout =
+      g_tcpip.encapsulation_inactivity_timeout;
+    snapshot->quick_connect = g_tcpip.quick_connect;
+    if (SeqLockReadValid(&s_tcpip_lock, sequence) ) {
+      snapshot->version = sequence;
+      return kEipStatusOk;
+    }
+  }
+  return kEipStatusError;
+}
@@ -27,6 +27,12 @@ static const CipDword kTcpipStatusAcdStatus = 0x40U;
 /** Indicates when an IP address conflict has been detected by ACD or the defense failed. */
 static const CipDword kTcpipStatusAcdFault = 0x80U;
 
+/* Declare constants for the AcdActivity of attribute #11 "Last Conflict Detected" */
+static const CipUsint kTcpipAcdActivityNoConflict = 0U;  /**< no conflict detected since the last reset */
+static const CipUsint kTcpipAcdActivityProbe      = 1U;  /**< conflict while probing the address */
+static const CipUsint kTcpipAcdActivityOngoing    = 2U;  /**< conflict while defending the address */
+static const CipUsint kTcpipAcdActivitySemiActive = 3U;  /**< conflict during a semi-active probe */
+
 /* Declare constants for config_control attribute (#3) */
 static const CipDword kTcpipCfgCtrlStaticIp   = 0x00U;  /**< IP configuration method is manual IP assignment */
 static const CipDword kTcpipCfgCtrlBootp      = 0x01U;  /**< IP configuration method is BOOTP */
@@ -52,17 +58,37 @@ typedef struct {
   CipDword config_control;    /**< attribute #3 bitmap: control the interface configuration method: static / BOOTP / DHCP */
   CipEpath physical_link_object;  /**< attribute #4 references the Ethernet Link object for this  interface */
   CipTcpIpInterfaceConfiguration interface_configuration;/**< attribute #5 IP, network mask, gateway, name server 1 & 2, domain name*/
-  CipString hostname; /**< #6 host name*/
+  CipTcpIpHostName hostname; /**< #6 host name*/
   CipUsint mcast_ttl_value; /**< #8 the time to live value to be used for multi-cast connections */
 
   /** #9 The multicast configuration for this device */
   MulticastAddressConfiguration mcast_config;
   CipBool select_acd; /**< attribute #10 - Is ACD enabled? */
+  CipBool quick_connect; /**< attribute #12 - Is Quick Connect enabled? */
 
   /** #13 Number of seconds of inactivity before TCP connection is closed */
   CipUint encapsulation_inactivity_timeout;
 } CipTcpIpObject;
 
+/** @brief Consistent copy of the fixed size TCP/IP object attributes
+ *
+ *  Taken with CipTcpIpGetSnapshot(); the strings of attributes 5 and 6 are
+ *  not part of it.
+ */
+typedef struct {
+  CipUdint version; /**< changes whenever a writer published new values */
+  CipDword status;
+  CipDword config_capability;
+  CipDword config_control;
+  CipUdint ip_address;
+  CipUdint network_mask;
+  CipUdint gateway;
+  CipUdint name_server;
+  CipUdint name_server_2;
+  CipUint encapsulation_inactivity_timeout;
+  CipBool quick_connect;
+} CipTcpIpSnapshot;
+
 
 /* global public variables */
 extern CipTcpIpObject g_tcpip;  /**< declaration of TCP/IP object instance 1 data */
@@ -74,9 +100,9 @@ extern CipTcpIpObject g_tcpip;  /**< declaration of TCP/IP object instance 1 dat
  */
 EipStatus CipTcpIpInterfaceInit(void);
 
-/** @brief Clean up the allocated data of the TCP/IP interface object.
+/** @brief Reset the data of the TCP/IP interface object.
  *
- * Currently this is the host name string and the domain name string.
+ * Empties the host name and the domain name, both are stored in place.
  *
  */
 void ShutdownTcpIpInterface(void);
@@ -103,6 +129,43 @@ void CipTcpIpSetLastAcdActivity(CipUsint activity);
  */
 void CipTcpIpSetLastAcdMac(const uint8_t mac[6]);
 void CipTcpIpSetLastAcdRawData(const uint8_t *data, size_t length);
+
+/** @brief Record a conflict for attribute #11 in one update
+ *
+ *  Readers of the attribute get the activity, MAC address and ARP frame of
+ *  the same conflict. Called from the lwIP task only.
+ *
+ *  @param activity ACD activity at the time of the conflict, kTcpipAcdActivity*
+ *  @param mac MAC address of the conflicting device (6 bytes)
+ *  @param data ARP frame of the conflict
+ *  @param length length of the ARP frame (max 28 bytes)
+ */
+void CipTcpIpSetLastAcdConflict(CipUsint activity,
+                                const uint8_t mac[6],
+                                const uint8_t *data,
+                                size_t length);
 CipBool CipTcpIpIsValidNetworkConfig(const CipTcpIpInterfaceConfiguration *if_cfg);
 
+/** @brief Start changing g_tcpip
+ *
+ *  Readers of CipTcpIpGetSnapshot() see either all or none of the changes made
+ *  until CipTcpIpEndUpdate(). Writers have to be serialized: the stack changes
+ *  g_tcpip with the stack entered, other tasks have to enter it as well, see
+ *  NetworkHandlerEnterStack().
+ */
+void CipTcpIpBeginUpdate(void);
+
+/** @brief Publish the changes made to g_tcpip since CipTcpIpBeginUpdate() */
+void CipTcpIpEndUpdate(void);
+
+/** @brief Take a consistent copy of the fixed size attributes of g_tcpip
+ *
+ *  Lock free, may be called from any task.
+ *
+ *  @param snapshot destination of the copy
+ *  @return kEipStatusOk on success, kEipStatusError if an update was in
+ *          progress, retry later
+ */
+EipStatus CipTcpIpGetSnapshot(CipTcpIpSnapshot *const snapshot);
+
 #endif /* OPENER_CIPTCPIPINTERFACE_H_ */
@@ -129,6 +129,8 @@ typedef enum { /* TODO: Rework */
   kPreSetFunc = 0x40, /**< enable pre set callback */
   kPostSetFunc = 0x80, /**< enable post set callback */
   kNvDataFunc = 0x80, /**< enable Non Volatile data callback, is the same as @ref kPostSetFunc */
+  /* Only in attribute tables, see SetCipInstanceAttributes() */
+  kGetableAllStatic = 0x100, /**< the value only changes through Set services and setter functions, GetAttributeAll reuses its encoding */
 } CIPAttributeFlag;
 
 typedef enum {
@@ -161,6 +163,36 @@ typedef struct {
   CipByte *string;   /**< Pointer to the string data */
 } CipString;
 
+/** @brief Length of a STRING or SHORT_STRING with inline storage
+ *
+ *  First member of every CIP_STRING_FIXED() type, the characters follow it
+ *  without padding. Setting such a string copies into the storage and never
+ *  allocates; see SetCipStringFixedByData().
+ */
+typedef struct {
+  EipUint16 length;   /**< Length of the String */
+} CipStringFixed;
+
+/** @brief Type of a string holding up to @p capacity characters in place
+ *
+ *  Encoded with EncodeCipStringFixed() or EncodeCipShortStringFixed(). Only
+ *  strings of the same capacity (the same typedef) can be assigned to each
+ *  other.
+ */
+#define CIP_STRING_FIXED(capacity) \
+  struct { \
+    CipStringFixed header; \
+    CipByte string[capacity]; \
+  }
+
+/** @brief Domain name of the TCP/IP Interface Configuration, Vol. 2, 5-4.3 */
+#define CIP_TCPIP_MAX_DOMAIN_LENGTH 48
+typedef CIP_STRING_FIXED(CIP_TCPIP_MAX_DOMAIN_LENGTH) CipTcpIpDomainName;
+
+/** @brief Host Name of the TCP/IP Interface object, RFC 1123 */
+#define CIP_TCPIP_MAX_HOSTNAME_LENGTH 64
+typedef CIP_STRING_FIXED(CIP_TCPIP_MAX_HOSTNAME_LENGTH) CipTcpIpHostName;
+
 /** @brief CIP String2
  *
  */
@@ -231,6 +263,7 @@ typedef struct {
   EipUint16 class_id;   /**< Class ID of the linked object */
   CipInstanceNum instance_number;   /**< Requested Instance Number of the linked object */
   EipUint16 attribute_number;   /**< Requested Attribute Number of the linked object */
+  EipUint16 member_number;   /**< Requested Member ID, 0 if the path has none */
 } CipEpath;
 
 typedef enum connection_point_type {
@@ -269,9 +302,10 @@ typedef struct {
   const CipOctet *data;
 } CipMessageRouterRequest;
 
-#define MAX_SIZE_OF_ADD_STATUS 2 /* for now we support extended status codes up to 2 16bit values there is mostly only one 16bit value used */
+#define MAX_SIZE_OF_ADD_STATUS 6 /* extended status codes use up to 6 16bit values (RPI values not acceptable), there is mostly only one 16bit value used */
 
 typedef struct enip_message ENIPMessage;
+typedef struct cip_common_packet_format_data CipCommonPacketFormatData;
 
 /** @brief CIP Message Router Response
  *
@@ -288,6 +322,11 @@ typedef struct {
                                                             If SizeOfAdditionalStatus is 0. there is no
                                                             Additional Status */
   ENIPMessage message;   /* The constructed message */
+  CipCommonPacketFormatData *common_packet_format_data;   /**< CPF items of the
+                                                             request, completed
+                                                             for the reply. NULL
+                                                             without an
+                                                             encapsulation */
 } CipMessageRouterResponse;
 
 /** @brief self-describing data encoding for CIP types */
@@ -301,11 +340,41 @@ typedef int (*CipAttributeDecodeFromMessage)(void *const data,
                                              CipMessageRouterResponse *const
                                              message_router_response);
 
+/** @brief Encoding of an attribute in a response, see EncodeCipAttribute()
+ *
+ *  Attributes of the fixed size elementary types with their standard encoder,
+ *  e.g. a kCipUint with EncodeCipUint(), are copied inline; all others call
+ *  their encode function.
+ */
+typedef enum {
+  kCipAttributeEncodingFunction = 0, /**< call the encode function */
+  kCipAttributeEncoding8Bit, /**< one octet */
+  kCipAttributeEncoding16Bit, /**< 16 bit value, little endian */
+  kCipAttributeEncoding32Bit, /**< 32 bit value, little endian */
+  kCipAttributeEncoding64Bit, /**< 64 bit value, little endian */
+} CipAttributeEncoding;
+
+/** @brief @ref CipAttributeEncoding of an attribute of type cip_type with its
+ *  standard encoder, a constant expression */
+#define CIP_ATTRIBUTE_ENCODING(cip_type) \
+  ( (kCipBool == (cip_type) || kCipSint == (cip_type) || \
+     kCipUsint == (cip_type) || kCipByte == (cip_type) ) ? \
+    kCipAttributeEncoding8Bit : \
+    (kCipInt == (cip_type) || kCipUint == (cip_type) || \
+     kCipWord == (cip_type) ) ? kCipAttributeEncoding16Bit : \
+    (kCipDint == (cip_type) || kCipUdint == (cip_type) || \
+     kCipDword == (cip_type) || kCipReal == (cip_type) ) ? \
+    kCipAttributeEncoding32Bit : \
+    (kCipLint == (cip_type) || kCipUlint == (cip_type) || \
+     kCipLword == (cip_type) || kCipLreal == (cip_type) ) ? \
+    kCipAttributeEncoding64Bit : kCipAttributeEncodingFunction)
+
 /** @brief Structure to describe a single CIP attribute of an object
  */
 typedef struct {
   EipUint16 attribute_number;   /**< The attribute number of this attribute. */
   EipUint8 type;   /**< The @ref CipDataType of this attribute. */
+  EipUint8 encoding;   /**< The @ref CipAttributeEncoding of this attribute. */
   CipAttributeEncodeInMessage encode;   /**< Self-describing its data encoding */
   CipAttributeDecodeFromMessage decode;   /**< Self-describing its data decoding */
   CIPAttributeFlag attribute_flags;   /**< See @ref CIPAttributeFlag declaration for valid values. */
@@ -319,18 +388,23 @@ typedef struct {
  */
 typedef struct cip_instance {
   CipInstanceNum instance_number;   /**< this instance's number (unique within the class) */
-  CipAttributeStruct *attributes;   /**< pointer to an array of attributes which
-                                       is unique to this instance */
+  const CipAttributeStruct *attributes;   /**< array of attributes sorted by
+                                             number, allocated for this instance
+                                             or a const table, see
+                                             SetCipInstanceAttributes() */
   struct cip_class *cip_class;   /**< class the instance belongs to */
   struct cip_instance *next;   /**< next instance, all instances of a class live
                                   in a linked list */
   void *data; /**< pointer to instance data struct */
+  struct cip_get_attribute_all_cache *get_attribute_all_cache; /**< encoding of
+                                      the kGetableAllStatic attributes, NULL if
+                                      there are none */
 } CipInstance;
 
 /** @ingroup CIP_API
  *  @typedef EipStatus (*CipGetSetCallback)(
  *    CipInstance *const instance,
- *    CipAttributeStruct *const attribute,
+ *    const CipAttributeStruct *const attribute,
  *    CipByte service
  *  )
  *  @brief Signature definition of callback functions for Set and Get services
@@ -341,7 +415,7 @@ typedef struct cip_instance {
  *  @return           status of kEipStatusOk or kEipStatusError on failure
  */
 typedef EipStatus (*CipGetSetCallback)(CipInstance *const instance,
-                                       CipAttributeStruct *const attribute,
+                                       const CipAttributeStruct *const attribute,
                                        CipByte service);
 
 /** @ingroup CIP_API
@@ -377,12 +451,18 @@ typedef struct cip_class {
   EipUint16 highest_attribute_number;   /**< highest defined attribute number
                                            (attribute numbers are not necessarily
                                            consecutive) */
+  CipBool attribute_tables;   /**< instance attributes are const tables set
+                                 with SetCipInstanceAttributes(), not
+                                 allocated */
   uint8_t *get_single_bit_mask;   /**< bit mask for GetAttributeSingle */
   uint8_t *set_bit_mask;   /**< bit mask for SetAttributeSingle */
   uint8_t *get_all_bit_mask;   /**< bit mask for GetAttributeAll */
 
   EipUint16 number_of_services;   /**< number of services supported */
   CipInstance *instances;   /**< pointer to the list of instances */
+  CipInstance **instance_index;   /**< instances sorted by instance number,
+                                     NULL if not built */
+  size_t instance_index_length;   /**< number of entries in instance_index */
   struct cip_service_struct *services;   /**< pointer to the array of services */
   char *class_name;   /**< class name */
   /** Is called in GetAttributeSingle* before the response is assembled from
@@ -458,7 +538,7 @@ typedef struct {
   CipUdint gateway;
   CipUdint name_server;
   CipUdint name_server_2;
-  CipString domain_name;
+  CipTcpIpDomainName domain_name;
 } CipTcpIpInterfaceConfiguration;
 
 typedef struct {
@@ -17,6 +17,7 @@
 #include "trace.h"
 #include "encap.h"
 #include "enipmessage.h"
+#include "trace_event.h"
 
 const size_t kItemCountFieldSize = 2; /**< The size of the item count field in the message */
 const size_t KItemDataTypeIdFieldLength = 2; /**< The size of the item count field in the message */
@@ -27,8 +28,6 @@ const size_t KItemDataTypeIdFieldLength = 2; /**< The size of the item count fie
  */
 const EipUint16 kSequencedAddressItemLength = 8;
 
-CipCommonPacketFormatData g_common_packet_format_data_item; /**< CPF global data items */
-
 static void InitializeMessageRouterResponse(
   CipMessageRouterResponse *const message_router_response) {
   memset(message_router_response, 0, sizeof(*message_router_response) );
@@ -41,35 +40,50 @@ EipStatus NotifyCommonPacketFormat(const EncapsulationData *const received_data,
   EipStatus return_value = kEipStatusError;
   CipMessageRouterResponse message_router_response;
   InitializeMessageRouterResponse(&message_router_response);
+  /* let the response grow up to what the outgoing message can carry */
+  (void)ENIPMessageAttachPooledBuffer(&message_router_response.message,
+                                      outgoing_message->message_buffer_size);
 
+  /* the items of the request, completed by the service for its reply */
+  CipCommonPacketFormatView view;
+  CipCommonPacketFormatData common_packet_format_data;
   if(kEipStatusError
      == (return_value =
-           CreateCommonPacketFormatStructure(received_data->
-                                             current_communication_buffer_position,
-                                             received_data->data_length,
-                                             &
-                                             g_common_packet_format_data_item) ) )
+           CommonPacketFormatViewParse(received_data->
+                                       current_communication_buffer_position,
+                                       received_data->data_length,
+                                       &view) ) )
   {
     OPENER_TRACE_ERR("notifyCPF: error from createCPFstructure\n");
   } else {
     return_value = kEipStatusOkSend; /* In cases of errors we normally need to send an error response */
-    if(g_common_packet_format_data_item.address_item.type_id ==
+    if(view.address_item.type_id ==
        kCipItemIdNullAddress)                                                          /* check if NullAddressItem received, otherwise it is no unconnected message and should not be here*/
     { /* found null address item*/
-      if(g_common_packet_format_data_item.data_item.type_id ==
+      if(view.data_item.type_id ==
          kCipItemIdUnconnectedDataItem) {                                                       /* unconnected data item received*/
+        CommonPacketFormatViewDecode(&view, &common_packet_format_data);
+        message_router_response.common_packet_format_data =
+          &common_packet_format_data;
+        OPENER_TRACE_EVENT(kTraceEventExplicitRequest,
+                           (0 != common_packet_format_data.data_item.length) ?
+                           common_packet_format_data.data_item.data[0] : 0,
+                           common_packet_format_data.data_item.length,
+                           0);
         return_value = NotifyMessageRouter(
-          g_common_packet_format_data_item.data_item.data,
-          g_common_packet_format_data_item.data_item.length,
+          common_packet_format_data.data_item.data,
+          common_packet_format_data.data_item.length,
           &message_router_response,
           originator_address,
           received_data->session_handle);
+        OPENER_TRACE_EVENT_END(kTraceEventExplicitRequest,
+                               message_router_response.general_status);
         if(return_value != kEipStatusError) {
           SkipEncapsulationHeader(outgoing_message);
           /* TODO: Here we get the status. What to do? kEipStatusError from AssembleLinearMessage().
            *  Its not clear how to transport this error information to the requester. */
           EipStatus status = AssembleLinearMessage(&message_router_response,
-                                                   &g_common_packet_format_data_item,
+                                                   &common_packet_format_data,
                                                    outgoing_message);
           (void)status; /* Suppress unused variable warning. */
 
@@ -108,6 +122,7 @@ EipStatus NotifyCommonPacketFormat(const EncapsulationData *const received_data,
       return_value = kEipStatusOkSend;
     }
   }
+  ENIPMessageReleasePooledBuffer(&message_router_response.message);
   return return_value;
 }
 
@@ -116,40 +131,48 @@ EipStatus NotifyConnectedCommonPacketFormat(
   const struct sockaddr *const originator_address,
   ENIPMessage *const outgoing_message) {
 
-  EipStatus return_value = CreateCommonPacketFormatStructure(
+  CipCommonPacketFormatView view;
+  EipStatus return_value = CommonPacketFormatViewParse(
     received_data->current_communication_buffer_position,
     received_data->data_length,
-    &g_common_packet_format_data_item);
+    &view);
 
   if(kEipStatusError == return_value) {
     OPENER_TRACE_ERR("notifyConnectedCPF: error from createCPFstructure\n");
   } else {
     return_value = kEipStatusError; /* For connected explicit messages status always has to be 0*/
-    if(g_common_packet_format_data_item.address_item.type_id ==
+    if(view.address_item.type_id ==
        kCipItemIdConnectionAddress)                                                          /* check if ConnectedAddressItem received, otherwise it is no connected message and should not be here*/
     { /* ConnectedAddressItem item */
       CipConnectionObject *connection_object = GetConnectedObject(
-        g_common_packet_format_data_item.address_item.data.connection_identifier);
+        CommonPacketFormatViewGetConnectionIdentifier(&view) );
       if(NULL != connection_object) {
         /* reset the watchdog timer */
         ConnectionObjectResetInactivityWatchdogTimerValue(connection_object);
 
         /*TODO check connection id  and sequence count */
-        if(g_common_packet_format_data_item.data_item.type_id ==
+        if(view.data_item.type_id ==
            kCipItemIdConnectedDataItem) {                                                       /* connected data item received*/
-          EipUint8 *buffer = g_common_packet_format_data_item.data_item.data;
-          g_common_packet_format_data_item.address_item.data.sequence_number =
+          /* the items of the request, completed by the service for its
+           * reply */
+          CipCommonPacketFormatData common_packet_format_data;
+          CommonPacketFormatViewDecode(&view, &common_packet_format_data);
+          EipUint8 *buffer = common_packet_format_data.data_item.data;
+          common_packet_format_data.address_item.data.sequence_number =
             GetUintFromMessage( (const EipUint8 **const ) &buffer );
           OPENER_TRACE_INFO(
             "Class 3 sequence number: %" PRIu32 ", last sequence number: %u\n",
-            g_common_packet_format_data_item.address_item.data.sequence_number,
+            common_packet_format_data.address_item.data.sequence_number,
             (unsigned int)connection_object->sequence_count_consuming);
-          if(connection_object->sequence_count_consuming ==
-             g_common_packet_format_data_item.address_item.data.sequence_number)
+          /* replies too large for the inline buffer are not cached; such
+           * duplicates are processed again */
+          if( (connection_object->sequence_count_consuming ==
+               common_packet_format_data.address_item.data.
+               sequence_number) &&
+              (0 != connection_object->last_reply_sent.used_message_length) &&
+              ENIPMessageCopy(outgoing_message,
+                              &(connection_object->last_reply_sent) ) )
           {
-            memcpy(outgoing_message,
-                   &(connection_object->last_reply_sent),
-                   sizeof(ENIPMessage) );
             outgoing_message->current_message_position =
               outgoing_message->message_buffer;
             /* Regenerate encapsulation header for new message */
@@ -165,27 +188,39 @@ EipStatus NotifyConnectedCommonPacketFormat(
             return kEipStatusOkSend;
           }
           connection_object->sequence_count_consuming =
-            g_common_packet_format_data_item.address_item.data.sequence_number;
+            common_packet_format_data.address_item.data.sequence_number;
 
           ConnectionObjectResetInactivityWatchdogTimerValue(connection_object);
 
           CipMessageRouterResponse message_router_response;
           InitializeMessageRouterResponse(&message_router_response);
-          return_value = NotifyMessageRouter(buffer,
-                                             g_common_packet_format_data_item.data_item.length - 2,
-                                             &message_router_response,
-                                             originator_address,
-                                             received_data->session_handle);
+          (void)ENIPMessageAttachPooledBuffer(&message_router_response.message,
+                                              outgoing_message->message_buffer_size);
+          message_router_response.common_packet_format_data =
+            &common_packet_format_data;
+          OPENER_TRACE_EVENT(kTraceEventExplicitRequest,
+                             (common_packet_format_data.data_item.length > 2) ?
+                             buffer[0] : 0,
+                             common_packet_format_data.data_item.length - 2,
+                             connection_object->connection_serial_number);
+          return_value = NotifyMessageRouterWithRoute(buffer,
+                                                      common_packet_format_data.data_item.length - 2,
+                                                      &message_router_response,
+                                                      originator_address,
+                                                      received_data->session_handle,
+                                                      &connection_object->explicit_route);
+          OPENER_TRACE_EVENT_END(kTraceEventExplicitRequest,
+                                 message_router_response.general_status);
 
           if(return_value != kEipStatusError) {
-            g_common_packet_format_data_item.address_item.data.
+            common_packet_format_data.address_item.data.
             connection_identifier =
               connection_object->cip_produced_connection_id;
             SkipEncapsulationHeader(outgoing_message);
             /* TODO: Here we get the status. What to do? kEipStatusError from AssembleLinearMessage().
              *  Its not clear how to transport this error information to the requester. */
             EipStatus status = AssembleLinearMessage(&message_router_response,
-                                                     &g_common_packet_format_data_item,
+                                                     &common_packet_format_data,
                                                      outgoing_message);
             (void)status; /* Suppress unused variable warning. */
 
@@ -198,11 +233,11 @@ EipStatus NotifyConnectedCommonPacketFormat(
                                         kEncapsulationProtocolSuccess,
                                         outgoing_message);
             outgoing_message->current_message_position = pos;
-            memcpy(&connection_object->last_reply_sent,
-                   outgoing_message,
-                   sizeof(ENIPMessage) );
+            (void)ENIPMessageCopy(&connection_object->last_reply_sent,
+                                  outgoing_message);
             return_value = kEipStatusOkSend;
           }
+          ENIPMessageReleasePooledBuffer(&message_router_response.message);
         } else {
           /* wrong data item detected*/
           OPENER_TRACE_ERR(
@@ -223,6 +258,138 @@ EipStatus NotifyConnectedCommonPacketFormat(
           kEipStatusOk);                                                                 /* TODO: What would the right EipStatus to return? */
 }
 
+/** @brief Length of the data of a Sockaddr Info item */
+#define SOCKET_ADDRESS_INFO_ITEM_LENGTH 16
+
+/** @brief Take the header of the next CPF item, if the item fits
+ *
+ * @param data position of the item, moved past it
+ * @param remaining octets left in the packet, reduced by the item
+ * @param item receives the item header
+ * @return true if the item fits into remaining
+ */
+static bool CommonPacketFormatViewTakeItem(
+  const EipUint8 **const data,
+  size_t *const remaining,
+  CipCommonPacketFormatItemView *const item) {
+  if(*remaining < 4) {
+    return false;
+  }
+  const EipUint8 *position = *data;
+  const CipUint type_id = GetUintFromMessage(&position);
+  const CipUint length = GetUintFromMessage(&position);
+  if(*remaining - 4 < length) {
+    return false;
+  }
+  *item = (CipCommonPacketFormatItemView) {
+    .type_id = type_id, .length = length, .data = position
+  };
+  *data = position + length;
+  *remaining -= 4U + length;
+  return true;
+}
+
+EipStatus CommonPacketFormatViewParse(const EipUint8 *data,
+                                      size_t data_length,
+                                      CipCommonPacketFormatView *const view) {
+  *view = (CipCommonPacketFormatView) { 0 };
+  if(data_length < kItemCountFieldSize) {
+    return kEipStatusError;
+  }
+  view->item_count = GetUintFromMessage(&data);
+  size_t remaining = data_length - kItemCountFieldSize;
+  if(view->item_count >= 1U &&
+     !CommonPacketFormatViewTakeItem(&data, &remaining, &view->address_item) )
+  {
+    return kEipStatusError;
+  }
+  if(view->item_count >= 2U &&
+     !CommonPacketFormatViewTakeItem(&data, &remaining, &view->data_item) ) {
+    return kEipStatusError;
+  }
+
+  /* Data type per CIP Volume 2, Edition 1.4, Table 2-6.1. */
+  size_t address_info_item_count = 0;
+  for(CipUint i = 2; i < view->item_count; ++i) {
+    CipCommonPacketFormatItemView item;
+    if(!CommonPacketFormatViewTakeItem(&data, &remaining, &item) ) {
+      break; /* an optional item that does not fit is ignored */
+    }
+    OPENER_TRACE_INFO("Sockaddr type id: %x\n", item.type_id);
+    if( (kCipItemIdSocketAddressInfoOriginatorToTarget == item.type_id ||
+         kCipItemIdSocketAddressInfoTargetToOriginator == item.type_id) &&
+        SOCKET_ADDRESS_INFO_ITEM_LENGTH == item.length &&
+        address_info_item_count < 2) {
+      view->address_info_item[address_info_item_count++] = item;
+    }
+  }
+
+  if(0 != remaining) {
+    OPENER_TRACE_WARN(
+      "something is wrong with the length in Message Router @ CommonPacketFormatViewParse\n");
+    if(view->item_count <= 2) {
+      return kEipStatusError; /* something with the length was wrong */
+    }
+    /* there is an optional packet in data stream which is not sockaddr item */
+  }
+  return kEipStatusOk;
+}
+
+CipUdint CommonPacketFormatViewGetConnectionIdentifier(
+  const CipCommonPacketFormatView *const view) {
+  const EipUint8 *data = view->address_item.data;
+  return (view->address_item.length >= 4) ? GetUdintFromMessage(&data) : 0;
+}
+
+CipUdint CommonPacketFormatViewGetSequenceNumber(
+  const CipCommonPacketFormatView *const view) {
+  const EipUint8 *data = view->address_item.data;
+  if(8 != view->address_item.length) {
+    return 0;
+  }
+  data += 4; /* connection ID */
+  return GetUdintFromMessage(&data);
+}
+
+void CommonPacketFormatViewDecode(
+  const CipCommonPacketFormatView *const view,
+  CipCommonPacketFormatData *const common_packet_format_data) {
+  *common_packet_format_data = (CipCommonPacketFormatData) {
+    .item_count = view->item_count,
+    .address_item = {
+      .type_id = view->address_item.type_id,
+      .length = view->address_item.length,
+      .data = {
+        .connection_identifier =
+          CommonPacketFormatViewGetConnectionIdentifier(view),
+        .sequence_number = CommonPacketFormatViewGetSequenceNumber(view)
+      }
+    },
+    .data_item = {
+      .type_id = view->data_item.type_id,
+      .length = view->data_item.length,
+      .data = (EipUint8 *) view->data_item.data
+    }
+  };
+  for(size_t j = 0; j < 2; ++j) {
+    const CipCommonPacketFormatItemView *const item =
+      &view->address_info_item[j];
+    if(NULL == item->data) {
+      continue; /* type ID 0 marks the item as not set */
+    }
+    SocketAddressInfoItem *const address_info_item =
+      &common_packet_format_data->address_info_item[j];
+    const EipUint8 *data = item->data;
+    address_info_item->type_id = item->type_id;
+    address_info_item->length = item->length;
+    address_info_item->sin_family = GetIntFromMessage(&data);
+    address_info_item->sin_port = GetIntFromMessage(&data);
+    address_info_item->sin_addr = GetUdintFromMessage(&data);
+    memcpy(address_info_item->nasin_zero, data,
+           sizeof(address_info_item->nasin_zero) );
+  }
+}
+
 /**
  * @brief Creates Common Packet Format structure out of data.
  * @param data Pointer to data which need to be structured.
@@ -236,95 +403,11 @@ EipStatus CreateCommonPacketFormatStructure(const EipUint8 *data,
                                             size_t data_length,
                                             CipCommonPacketFormatData *common_packet_format_data)
 {
-
-  common_packet_format_data->address_info_item[0].type_id = 0;
-  common_packet_format_data->address_info_item[1].type_id = 0;
-
-  size_t length_count = 0;
-  CipUint item_count = GetUintFromMessage(&data);
-  //OPENER_ASSERT(4U >= item_count);/* Sanitizing data - probably needs to be changed for productive code */
-  common_packet_format_data->item_count = item_count;
-  length_count += 2;
-  if(common_packet_format_data->item_count >= 1U) {
-    common_packet_format_data->address_item.type_id = GetUintFromMessage(&data);
-    common_packet_format_data->address_item.length = GetUintFromMessage(&data);
-    length_count += 4;
-    if(common_packet_format_data->address_item.length >= 4) {
-      common_packet_format_data->address_item.data.connection_identifier =
-        GetUdintFromMessage(&data);
-      length_count += 4;
-    }
-    if(common_packet_format_data->address_item.length == 8) {
-      common_packet_format_data->address_item.data.sequence_number =
-        GetUdintFromMessage(&data);
-      length_count += 4;
-    }
-  }
-  if(common_packet_format_data->item_count >= 2) {
-    common_packet_format_data->data_item.type_id = GetUintFromMessage(&data);
-    common_packet_format_data->data_item.length = GetUintFromMessage(&data);
-    common_packet_format_data->data_item.data = (EipUint8 *) data;
-    if(data_length >=
-       length_count + 4 + common_packet_format_data->data_item.length) {
-      data += common_packet_format_data->data_item.length;
-      length_count += (4 + common_packet_format_data->data_item.length);
-    } else {
-      return kEipStatusError;
-    }
-
-    /* Data type per CIP Volume 2, Edition 1.4, Table 2-6.1. */
-    CipUint address_item_count = (CipUint)(common_packet_format_data->item_count - 2U);
-
-    for(size_t j = 0; j < (address_item_count > 2 ? 2 : address_item_count);
-        j++)                                                                      /* TODO there needs to be a limit check here???*/
-    {
-      common_packet_format_data->address_info_item[j].type_id =
-        GetIntFromMessage(&data);
-      OPENER_TRACE_INFO("Sockaddr type id: %x\n",
-                        common_packet_format_data->address_info_item[j].type_id);
-      length_count += 2;
-      if( (common_packet_format_data->address_info_item[j].type_id ==
-           kCipItemIdSocketAddressInfoOriginatorToTarget)
-          || (common_packet_format_data->address_info_item[j].type_id ==
-              kCipItemIdSocketAddressInfoTargetToOriginator) ) {
-        common_packet_format_data->address_info_item[j].length =
-          GetIntFromMessage(&data);
-        common_packet_format_data->address_info_item[j].sin_family =
-          GetIntFromMessage(&data);
-        common_packet_format_data->address_info_item[j].sin_port =
-          GetIntFromMessage(&data);
-        common_packet_format_data->address_info_item[j].sin_addr =
-          GetUdintFromMessage(&data);
-        for(size_t i = 0; i < 8; i++) {
-          common_packet_format_data->address_info_item[j].nasin_zero[i] = *data;
-          data++;
-        }
-        length_count += 18;
-      } else { /* no sockaddr item found */
-        common_packet_format_data->address_info_item[j].type_id = 0; /* mark as not set */
-        data -= 2;
-      }
-    }
-  }
-  /* set the addressInfoItems to not set if they were not received */
-  if(common_packet_format_data->item_count < 4) {
-    common_packet_format_data->address_info_item[1].type_id = 0;
-    if(common_packet_format_data->item_count < 3) {
-      common_packet_format_data->address_info_item[0].type_id = 0;
-    }
-  }
-  if(length_count == data_length) { /* length of data is equal to length of Addr and length of Data */
-    return kEipStatusOk;
-  } else {
-    OPENER_TRACE_WARN(
-      "something is wrong with the length in Message Router @ CreateCommonPacketFormatStructure\n");
-    if(common_packet_format_data->item_count > 2) {
-      /* there is an optional packet in data stream which is not sockaddr item */
-      return kEipStatusOk;
-    } else { /* something with the length was wrong */
-      return kEipStatusError;
-    }
-  }
+  CipCommonPacketFormatView view;
+  const EipStatus status = CommonPacketFormatViewParse(data, data_length,
+                                                       &view);
+  CommonPacketFormatViewDecode(&view, common_packet_format_data);
+  return status;
 }
 
 /**
@@ -660,7 +743,7 @@ EipStatus AssembleLinearMessage(
          kCipItemIdConnectedDataItem) {                                                      /* Connected Item */
         EncodeConnectedDataItemLength(message_router_response,
                                       outgoing_message);
-        EncodeSequenceNumber(&g_common_packet_format_data_item,
+        EncodeSequenceNumber(common_packet_format_data_item,
                              outgoing_message);
 
       } else { /* Unconnected Item */
@@ -64,13 +64,34 @@ typedef struct {
 
 /* this one case of a CPF packet is supported:*/
 /** @brief A variant of a CPF packet, including item count, one address item, one data item, and two Sockaddr Info items */
-typedef struct {
+typedef struct cip_common_packet_format_data {
   EipUint16 item_count; /**< Up to four for this structure allowed */
   AddressItem address_item;
   DataItem data_item;
   SocketAddressInfoItem address_info_item[2];
 } CipCommonPacketFormatData;
 
+/** @brief Header of a received CPF item and where its data is */
+typedef struct {
+  CipUint type_id; /**< 0 if the item was not received */
+  CipUint length;
+  const EipUint8 *data; /**< item data in the receive buffer, NULL if the item was not received */
+} CipCommonPacketFormatItemView;
+
+/** @brief The items of a received CPF packet, left in the receive buffer
+ *
+ * CommonPacketFormatViewParse() only walks the item headers. The contents
+ * of the items are decoded when they are asked for, so a view is cheap to
+ * keep on the stack of whoever handles the packet. The receive buffer has
+ * to outlive the view.
+ */
+typedef struct {
+  CipUint item_count;
+  CipCommonPacketFormatItemView address_item;
+  CipCommonPacketFormatItemView data_item;
+  CipCommonPacketFormatItemView address_info_item[2]; /**< Sockaddr Info items in the order received */
+} CipCommonPacketFormatView;
+
 /** @ingroup ENCAP
  * Parse the CPF data from a received unconnected explicit message and
  * hand the data on to the message router
@@ -100,6 +121,52 @@ EipStatus NotifyConnectedCommonPacketFormat(
   const struct sockaddr *const originator_address,
   ENIPMessage *const outgoing_message);
 
+/** @ingroup ENCAP
+ * Find the items of a received CPF packet
+ *
+ * Items past the data item other than Sockaddr Info items are skipped, as
+ * are Sockaddr Info items beyond the first two.
+ *
+ * @param data start of the item count
+ * @param data_length length of the CPF packet
+ * @param view receives the item headers
+ * @return kEipStatusOk if the items fit into data_length, kEipStatusError
+ *         otherwise
+ */
+EipStatus CommonPacketFormatViewParse(const EipUint8 *data,
+                                      size_t data_length,
+                                      CipCommonPacketFormatView *const view);
+
+/** @ingroup ENCAP
+ * Connection ID of the connected or sequenced address item of a view
+ *
+ * @param view parsed CPF packet
+ * @return connection ID, 0 if the address item carries none
+ */
+CipUdint CommonPacketFormatViewGetConnectionIdentifier(
+  const CipCommonPacketFormatView *const view);
+
+/** @ingroup ENCAP
+ * Sequence number of the sequenced address item of a view
+ *
+ * @param view parsed CPF packet
+ * @return sequence number, 0 if the address item carries none
+ */
+CipUdint CommonPacketFormatViewGetSequenceNumber(
+  const CipCommonPacketFormatView *const view);
+
+/** @ingroup ENCAP
+ * Decode all items of a view into a CPF structure
+ *
+ * The data item keeps pointing into the receive buffer.
+ *
+ * @param view parsed CPF packet
+ * @param common_packet_format_data receives the decoded items
+ */
+void CommonPacketFormatViewDecode(
+  const CipCommonPacketFormatView *const view,
+  CipCommonPacketFormatData *const common_packet_format_data);
+
 /** @ingroup ENCAP
  *  Create CPF structure out of the received data.
  *  @param  data		pointer to data which need to be structured.
@@ -142,10 +209,53 @@ EipStatus AssembleLinearMessage(
   ENIPMessage *const outgoing_message);
 
 /** @ingroup ENCAP
- * @brief Data storage for the any CPF data
- * Currently we are single threaded and need only one CPF at the time.
- * For future extensions towards multithreading maybe more CPF data items may be necessary
+ * @brief Encodes the reply service code of a Message Router Response
+ *
+ * @param message_router_response Router Response message to be processed
+ * @param outgoing_message The outgoing message object
  */
-extern CipCommonPacketFormatData g_common_packet_format_data_item;
+void EncodeReplyService(
+  const CipMessageRouterResponse *const message_router_response,
+  ENIPMessage *const outgoing_message);
+
+/** @ingroup ENCAP
+ * @brief Encodes the reserved octet of a Message Router Response
+ *
+ * @param message_router_response Router Response message to be processed
+ * @param outgoing_message The outgoing message object
+ */
+void EncodeReservedFieldOfLengthByte(
+  const CipMessageRouterResponse *const message_router_response,
+  ENIPMessage *const outgoing_message);
+
+/** @ingroup ENCAP
+ * @brief Encodes the general status of a Message Router Response
+ *
+ * @param message_router_response Router Response message to be processed
+ * @param outgoing_message The outgoing message object
+ */
+void EncodeGeneralStatus(
+  const CipMessageRouterResponse *const message_router_response,
+  ENIPMessage *const outgoing_message);
+
+/** @ingroup ENCAP
+ * @brief Encodes the additional status size and words of a Message Router Response
+ *
+ * @param message_router_response Router Response message to be processed
+ * @param outgoing_message The outgoing message object
+ */
+void EncodeExtendedStatus(
+  const CipMessageRouterResponse *const message_router_response,
+  ENIPMessage *const outgoing_message);
+
+/** @ingroup ENCAP
+ * @brief Copies the response data of a Message Router Response
+ *
+ * @param message_router_response Router Response message to be processed
+ * @param outgoing_message The outgoing message object
+ */
+void EncodeMessageRouterResponseData(
+  const CipMessageRouterResponse *const message_router_response,
+  ENIPMessage *const outgoing_message);
 
 #endif /* OPENER_CPF_H_ */
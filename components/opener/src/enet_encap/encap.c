@@ -6,6 +6,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "encap.h"
 
@@ -21,7 +22,9 @@
 #include "generic_networkhandler.h"
 #include "trace.h"
 #include "socket_timer.h"
+#include "socketindexmap.h"
 #include "opener_error.h"
+#include "overload_governor.h"
 
 /* IP address data taken from TCPIPInterfaceObject*/
 const EipUint16 kSupportedProtocolVersion = 1; /**< Supported Encapsulation protocol version */
@@ -58,23 +61,46 @@ typedef enum {
   kCapabilityFlagsCipUdpClass0or1 = 0x0100
 } CapabilityFlags;
 
-#define ENCAP_NUMBER_OF_SUPPORTED_DELAYED_ENCAP_MESSAGES 2 /**< According to EIP spec at least 2 delayed message requests should be supported */
+#ifndef OPENER_LIST_IDENTITY_QUEUE_DEPTH
+/** According to EIP spec at least 2 delayed message requests should be supported */
+#define OPENER_LIST_IDENTITY_QUEUE_DEPTH 2
+#endif
 
 /* Encapsulation layer data  */
 
-/** @brief Delayed Encapsulation Message structure */
+/** @brief Delayed reply to a ListIdentity request received over UDP
+ *
+ * Only the requester is kept, the reply is encoded when it is due from the
+ * cached CIP Identity item, see EncodeListIdentityCipIdentityItem().
+ */
 typedef struct {
-  EipInt32 time_out; /**< time out in milli seconds */
+  MilliSeconds deadline; /**< on s_list_identity_clock */
   int socket; /**< associated socket */
   struct sockaddr_in receiver;
-  ENIPMessage outgoing_message;
-} DelayedEncapsulationMessage;
+  CipOctet sender_context[8]; /**< of the latest request of the receiver */
+} DelayedListIdentityReply;
 
 EncapsulationServiceInformation g_service_information;
 
 int g_registered_sessions[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
 
-DelayedEncapsulationMessage g_delayed_encapsulation_messages[ENCAP_NUMBER_OF_SUPPORTED_DELAYED_ENCAP_MESSAGES];
+/** Session index (handle - 1) by socket */
+static SocketIndexMapEntry s_session_map_entries[SOCKET_INDEX_MAP_CAPACITY(
+                                                   OPENER_NUMBER_OF_SUPPORTED_SESSIONS)];
+static SocketIndexMap s_session_by_socket;
+
+/** Free session indices, handed out oldest first so that a session handle
+ * is not reused right after its session was closed */
+static size_t s_free_sessions[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
+static size_t s_free_sessions_first;
+static size_t s_free_sessions_count;
+
+/** Pending ListIdentity replies, earliest deadline first */
+static DelayedListIdentityReply s_delayed_replies[
+  OPENER_LIST_IDENTITY_QUEUE_DEPTH];
+static size_t s_delayed_reply_count;
+/** Time since EncapsulationInit(), advanced by ManageEncapsulationMessages() */
+static MilliSeconds s_list_identity_clock;
 
 /*** private functions ***/
 void HandleReceivedListIdentityCommandTcp(const EncapsulationData *const receive_data, ENIPMessage *const outgoing_message);
@@ -94,7 +120,9 @@ int GetFreeSessionIndex(void);
 
 SessionStatus CheckRegisteredSessions(const EncapsulationData *const receive_data);
 
-void DetermineDelayTime(const EipByte *buffer_start, DelayedEncapsulationMessage *const delayed_message_buffer);
+static void ReleaseSession(const size_t session_index);
+
+MilliSeconds DetermineDelayTime(const EipByte *buffer_start);
 
 /*   @brief Initializes session list and interface information. */
 void EncapsulationInit(void) {
@@ -106,13 +134,18 @@ void EncapsulationInit(void) {
   srand(g_tcpip.interface_configuration.ip_address);
 
   /* initialize Sessions to invalid == free session */
+  SocketIndexMapInitialize(&s_session_by_socket, s_session_map_entries,
+                           SOCKET_INDEX_MAP_CAPACITY(
+                             OPENER_NUMBER_OF_SUPPORTED_SESSIONS) );
+  s_free_sessions_first = 0;
+  s_free_sessions_count = 0;
   for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; i++) {
     g_registered_sessions[i] = kEipInvalidSocket;
+    s_free_sessions[s_free_sessions_count++] = i;
   }
 
-  for(size_t i = 0; i < ENCAP_NUMBER_OF_SUPPORTED_DELAYED_ENCAP_MESSAGES; i++) {
-    g_delayed_encapsulation_messages[i].socket = kEipInvalidSocket;
-  }
+  s_delayed_reply_count = 0;
+  s_list_identity_clock = 0;
 
   /*TODO make the service information configurable*/
   /* initialize service information */
@@ -327,39 +360,109 @@ void HandleReceivedListIdentityCommandTcp(const EncapsulationData *const receive
   EncapsulateListIdentityResponseMessage(receive_data, outgoing_message);
 }
 
+/* Also true for deadlines that wrapped around */
+static bool ListIdentityDeadlineBefore(const MilliSeconds deadline,
+                                       const MilliSeconds reference) {
+  return 0 > (long) (deadline - reference);
+}
+
 void HandleReceivedListIdentityCommandUdp(const int socket,
                                           const struct sockaddr_in *const from_address,
                                           const EncapsulationData *const receive_data)
 {
-  DelayedEncapsulationMessage *delayed_message_buffer = NULL;
-  ENIPMessage *p_outgoing_message = NULL;
-
-  for(size_t i = 0; i < ENCAP_NUMBER_OF_SUPPORTED_DELAYED_ENCAP_MESSAGES; i++) {
-    if(kEipInvalidSocket == g_delayed_encapsulation_messages[i].socket) {
-      delayed_message_buffer = &(g_delayed_encapsulation_messages[i]);
-
-      p_outgoing_message = &(delayed_message_buffer->outgoing_message);
-      InitializeENIPMessage(p_outgoing_message);
-      break;
+  /* A requester that asks again before its reply is due, e.g. a browse
+   * repeating the broadcast, gets one reply to its latest request */
+  for(size_t i = 0; i < s_delayed_reply_count; i++) {
+    DelayedListIdentityReply *const reply = &s_delayed_replies[i];
+    if(reply->receiver.sin_addr.s_addr == from_address->sin_addr.s_addr &&
+       reply->receiver.sin_port == from_address->sin_port) {
+      reply->socket = socket;
+      memcpy(reply->sender_context, receive_data->sender_context,
+             kSenderContextSize);
+      return;
     }
   }
 
-  if(NULL != delayed_message_buffer) {
-    delayed_message_buffer->socket = socket;
-    memcpy((&delayed_message_buffer->receiver), from_address, sizeof(struct sockaddr_in));
-
-    DetermineDelayTime(receive_data->communication_buffer_start, delayed_message_buffer);
+  if(s_delayed_reply_count >= OPENER_LIST_IDENTITY_QUEUE_DEPTH) {
+    OPENER_TRACE_WARN("encap: ListIdentity reply queue full, request dropped\n");
+    return;
+  }
 
-    EncapsulateListIdentityResponseMessage(receive_data, p_outgoing_message);
+  const MilliSeconds deadline = s_list_identity_clock +
+                                DetermineDelayTime(
+    receive_data->communication_buffer_start);
+  size_t position = s_delayed_reply_count;
+  while(0 < position &&
+        ListIdentityDeadlineBefore(deadline,
+                                   s_delayed_replies[position - 1].deadline) ) {
+    position--;
   }
+  memmove(&s_delayed_replies[position + 1], &s_delayed_replies[position],
+          (s_delayed_reply_count - position) * sizeof(s_delayed_replies[0]) );
+  s_delayed_reply_count++;
+
+  DelayedListIdentityReply *const reply = &s_delayed_replies[position];
+  reply->deadline = deadline;
+  reply->socket = socket;
+  memcpy(&reply->receiver, from_address, sizeof(reply->receiver) );
+  memcpy(reply->sender_context, receive_data->sender_context,
+         kSenderContextSize);
+}
+
+static void SendDelayedListIdentityReply(
+  const DelayedListIdentityReply *const reply) {
+  /* Only used by ManageEncapsulationMessages() under the stack lock. Not
+   * cleared, every octet sent is written */
+  static ENIPMessage outgoing_message;
+  PrepareENIPMessage(&outgoing_message);
+
+  EncapsulationData request = {
+    .command_code = kEncapsulationCommandListIdentity,
+  };
+  memcpy(request.sender_context, reply->sender_context, kSenderContextSize);
+  EncapsulateListIdentityResponseMessage(&request, &outgoing_message);
+
+  sendto(reply->socket, (char*) outgoing_message.message_buffer,
+         outgoing_message.used_message_length, 0,
+         (const struct sockaddr*) &reply->receiver, sizeof(struct sockaddr) );
 }
 
 CipUint ListIdentityGetCipIdentityItemLength() {
   return sizeof(CipUint) + sizeof(CipInt) + sizeof(CipUint) + sizeof(CipUdint) + 8 * sizeof(CipUsint) + sizeof(CipUint) + sizeof(CipUint) + sizeof(CipUint)
-    + 2 * sizeof(CipUsint) + sizeof(CipWord) + sizeof(CipUdint) + sizeof(CipUsint) + g_identity.product_name.length + sizeof(CipUsint);
+    + 2 * sizeof(CipUsint) + sizeof(CipWord) + sizeof(CipUdint) + sizeof(CipUsint) + g_identity.product_name.header.length + sizeof(CipUsint);
 }
 
-void EncodeListIdentityCipIdentityItem(ENIPMessage *const outgoing_message) {
+/** @brief Encoded CIP Identity item of the last ListIdentity reply
+ *
+ * Everything but the Identity status and state, the interface address and
+ * the product name is fixed after startup, so the item is only encoded again
+ * when one of those differs from the values it was encoded with.
+ */
+typedef struct {
+  bool valid;
+  CipWord status;
+  CipUsint state;
+  CipUdint ip_address;
+  EipUint8 product_name_length;
+  CipByte product_name[CIP_IDENTITY_MAX_PRODUCT_NAME_LENGTH];
+  size_t length;
+  CipOctet item[4 + 34 + CIP_IDENTITY_MAX_PRODUCT_NAME_LENGTH]; /**< item header, fixed fields and the longest product name */
+} ListIdentityItemCache;
+
+static ListIdentityItemCache s_list_identity_item_cache;
+
+static bool ListIdentityItemCacheIsCurrent(
+  const ListIdentityItemCache *const cache) {
+  return cache->valid && (cache->status == g_identity.status) &&
+         (cache->state == g_identity.state) &&
+         (cache->ip_address == g_tcpip.interface_configuration.ip_address) &&
+         (cache->product_name_length == g_identity.product_name.header.length) &&
+         (0 == memcmp(cache->product_name, g_identity.product_name.string,
+                      cache->product_name_length) );
+}
+
+static void EncodeListIdentityCipIdentityItemFields(
+  ENIPMessage *const outgoing_message) {
   /* Item ID*/
   const CipUint kItemIDCipIdentity = 0x0C;
   AddIntToMessage(kItemIDCipIdentity, outgoing_message);
@@ -380,15 +483,38 @@ void EncodeListIdentityCipIdentityItem(ENIPMessage *const outgoing_message) {
   AddSintToMessage(g_identity.revision.minor_revision, outgoing_message);
   AddIntToMessage(g_identity.status, outgoing_message);
   AddDintToMessage(g_identity.serial_number, outgoing_message);
-  AddSintToMessage((unsigned char) g_identity.product_name.length, outgoing_message);
-//TODO Change to EncodeCipString
-  memcpy(outgoing_message->current_message_position, g_identity.product_name.string, g_identity.product_name.length);
-  outgoing_message->current_message_position += g_identity.product_name.length;
-  outgoing_message->used_message_length += g_identity.product_name.length;
+  EncodeCipShortStringFixed(&g_identity.product_name, outgoing_message);
 
   AddSintToMessage(g_identity.state, outgoing_message);
 }
 
+void EncodeListIdentityCipIdentityItem(ENIPMessage *const outgoing_message) {
+  ListIdentityItemCache *const cache = &s_list_identity_item_cache;
+  if( ListIdentityItemCacheIsCurrent(cache) ) {
+    memcpy(outgoing_message->current_message_position, cache->item,
+           cache->length);
+    outgoing_message->current_message_position += cache->length;
+    outgoing_message->used_message_length += cache->length;
+    return;
+  }
+
+  const CipOctet *const item_start = outgoing_message->current_message_position;
+  EncodeListIdentityCipIdentityItemFields(outgoing_message);
+  const size_t length =
+    (size_t)(outgoing_message->current_message_position - item_start);
+  cache->valid = length <= sizeof(cache->item);
+  if(cache->valid) {
+    memcpy(cache->item, item_start, length);
+    cache->length = length;
+    cache->status = g_identity.status;
+    cache->state = g_identity.state;
+    cache->ip_address = g_tcpip.interface_configuration.ip_address;
+    cache->product_name_length = (EipUint8) g_identity.product_name.header.length;
+    memcpy(cache->product_name, g_identity.product_name.string,
+           cache->product_name_length);
+  }
+}
+
 void EncapsulateListIdentityResponseMessage(const EncapsulationData *const receive_data, ENIPMessage *const outgoing_message) {
 
   const CipUint kEncapsulationCommandListIdentityLength = ListIdentityGetCipIdentityItemLength() + sizeof(CipUint) + sizeof(CipUint) + sizeof(CipUint); /* Last element is item count */
@@ -402,7 +528,7 @@ void EncapsulateListIdentityResponseMessage(const EncapsulationData *const recei
 
 }
 
-void DetermineDelayTime(const EipByte *buffer_start, DelayedEncapsulationMessage *const delayed_message_buffer) {
+MilliSeconds DetermineDelayTime(const EipByte *buffer_start) {
 
   buffer_start += 12; /* start of the sender context */
   EipUint16 maximum_delay_time = GetUintFromMessage((const EipUint8** const ) &buffer_start);
@@ -413,7 +539,11 @@ void DetermineDelayTime(const EipByte *buffer_start, DelayedEncapsulationMessage
     maximum_delay_time = kListIdentityMinimumDelayTime;
   }
 
-  delayed_message_buffer->time_out = rand() % maximum_delay_time;
+  if(OverloadGovernorIsShedding(kOverloadStageDiscovery) ) {
+    /* the latest reply the scanner still waits for */
+    return (MilliSeconds) (maximum_delay_time - 1U);
+  }
+  return (MilliSeconds) (rand() % maximum_delay_time);
 }
 
 void EncapsulateRegisterSessionCommandResponseMessage(const EncapsulationData *const receive_data, const CipSessionHandle session_handle,
@@ -443,17 +573,15 @@ void HandleReceivedRegisterSessionCommand(int socket, const EncapsulationData *c
   /* check if requested protocol version is supported and the register session option flag is zero*/
   if((0 < protocol_version) && (protocol_version <= kSupportedProtocolVersion) && (0 == option_flag)) { /*Option field should be zero*/
     /* check if the socket has already a session open */
-    for(unsigned int i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
-      if(g_registered_sessions[i] == socket) {
-        /* the socket has already registered a session this is not allowed*/
-        OPENER_TRACE_INFO(
-            "Error: A session is already registered at socket %d\n",
-            socket);
-        session_handle = i + 1; /*return the already assigned session back, the cip spec is not clear about this needs to be tested*/
-        encapsulation_protocol_status = kEncapsulationProtocolInvalidCommand;
-        session_index = kSessionStatusInvalid;
-        break;
-      }
+    size_t registered_index = 0;
+    if(SocketIndexMapFind(&s_session_by_socket, socket, &registered_index)) {
+      /* the socket has already registered a session this is not allowed*/
+      OPENER_TRACE_INFO(
+          "Error: A session is already registered at socket %d\n",
+          socket);
+      session_handle = (CipSessionHandle)(registered_index + 1); /*return the already assigned session back, the cip spec is not clear about this needs to be tested*/
+      encapsulation_protocol_status = kEncapsulationProtocolInvalidCommand;
+      session_index = kSessionStatusInvalid;
     }
 
     if(kSessionStatusInvalid != session_index) {
@@ -462,10 +590,10 @@ void HandleReceivedRegisterSessionCommand(int socket, const EncapsulationData *c
       {
         encapsulation_protocol_status = kEncapsulationProtocolInsufficientMemory;
       } else { /* successful session registered */
-        SocketTimer *socket_timer = SocketTimerArrayGetEmptySocketTimer(g_timestamps,
-        OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
-        SocketTimerSetSocket(socket_timer, socket);
-        SocketTimerSetLastUpdate(socket_timer, g_actual_time);
+        /* cannot fail, the map has room for twice the number of sessions */
+        (void)SocketIndexMapInsert(&s_session_by_socket, socket,
+                                   (size_t)session_index);
+        AddSocketTimerToList(socket);
         g_registered_sessions[session_index] = socket; /* store associated socket */
         session_handle = (CipSessionHandle)(session_index + 1);
         encapsulation_protocol_status = kEncapsulationProtocolSuccess;
@@ -493,7 +621,7 @@ EipStatus HandleReceivedUnregisterSessionCommand(const EncapsulationData *const
     CipSessionHandle i = receive_data->session_handle - 1;
     if(kEipInvalidSocket != g_registered_sessions[i]) {
       CloseTcpSocket(g_registered_sessions[i]);
-      g_registered_sessions[i] = kEipInvalidSocket;
+      ReleaseSession(i);
       CloseClass3ConnectionBasedOnSession(i + 1);
       return kEipStatusOk;
     }
@@ -525,7 +653,7 @@ EipStatus HandleReceivedSendUnitDataCommand(const EncapsulationData *const recei
     {
       return_value = NotifyConnectedCommonPacketFormat(receive_data, originator_address, outgoing_message);
     } else { /* received a package with non registered session handle */
-      InitializeENIPMessage(outgoing_message);
+      ClearENIPMessage(outgoing_message);
       GenerateEncapsulationHeader(receive_data, 0, receive_data->session_handle, kEncapsulationProtocolInvalidSessionHandle, outgoing_message);
       return_value = kEipStatusOkSend; /* TODO: Needs to be here if line with first TODO of this function is adjusted. */
     }
@@ -557,7 +685,7 @@ EipStatus HandleReceivedSendRequestResponseDataCommand(const EncapsulationData *
     {
       return_value = NotifyCommonPacketFormat(receive_data, originator_address, outgoing_message);
     } else { /* received a package with non registered session handle */
-      InitializeENIPMessage(outgoing_message);
+      ClearENIPMessage(outgoing_message);
       GenerateEncapsulationHeader(receive_data, 0, receive_data->session_handle, kEncapsulationProtocolInvalidSessionHandle, outgoing_message);
       return_value = kEipStatusOkSend; /* TODO: Needs to be here if line with first TODO of this function is adjusted. */
     }
@@ -578,12 +706,30 @@ EipStatus HandleReceivedInvalidCommand(const EncapsulationData *const receive_da
  *                      kInvalidSession .. no free session available
  */
 int GetFreeSessionIndex(void) {
-  for(int session_index = 0; session_index < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; session_index++) {
-    if(kEipInvalidSocket == g_registered_sessions[session_index]) {
-      return session_index;
-    }
+  if(0 == s_free_sessions_count) {
+    return kSessionStatusInvalid;
   }
-  return kSessionStatusInvalid;
+  const size_t session_index = s_free_sessions[s_free_sessions_first];
+  s_free_sessions_first = (s_free_sessions_first + 1) % OPENER_NUMBER_OF_SUPPORTED_SESSIONS;
+  s_free_sessions_count--;
+  return (int)session_index;
+}
+
+/** @brief Mark a session as free and queue its index for reuse
+ *
+ * The socket of the session is not closed.
+ *  @param session_index Index of the session, session handle - 1
+ */
+static void ReleaseSession(const size_t session_index) {
+  if(kEipInvalidSocket == g_registered_sessions[session_index]) {
+    return; /* already free */
+  }
+  SocketIndexMapRemove(&s_session_by_socket, g_registered_sessions[session_index]);
+  g_registered_sessions[session_index] = kEipInvalidSocket;
+  OPENER_ASSERT(s_free_sessions_count < OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+  s_free_sessions[(s_free_sessions_first + s_free_sessions_count) % OPENER_NUMBER_OF_SUPPORTED_SESSIONS] =
+    session_index;
+  s_free_sessions_count++;
 }
 
 /** @brief copy data from pa_buf in little endian to host in structure.
@@ -644,31 +790,29 @@ SessionStatus CheckRegisteredSessions(const EncapsulationData *const receive_dat
 void CloseSessionBySessionHandle(const CipConnectionObject *const connection_object) {
   OPENER_TRACE_INFO("encap.c: Close session by handle\n");
   CipSessionHandle session_handle = connection_object->associated_encapsulation_session;
-  CloseTcpSocket(g_registered_sessions[session_handle - 1]);
-  g_registered_sessions[session_handle - 1] = kEipInvalidSocket;
+  if(kEipInvalidSocket != g_registered_sessions[session_handle - 1]) {
+    CloseTcpSocket(g_registered_sessions[session_handle - 1]);
+  }
+  ReleaseSession(session_handle - 1);
   OPENER_TRACE_INFO("encap.c: Close session by handle done\n");
 }
 
 void CloseSession(int socket) {
   OPENER_TRACE_INFO("encap.c: Close session\n");
-  for(unsigned int i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
-    if(g_registered_sessions[i] == socket) {
-      CloseTcpSocket(socket);
-      g_registered_sessions[i] = kEipInvalidSocket;
-      CloseClass3ConnectionBasedOnSession(i + 1);
-      break;
-    }
+  size_t i = 0;
+  if(SocketIndexMapFind(&s_session_by_socket, socket, &i)) {
+    CloseTcpSocket(socket);
+    ReleaseSession(i);
+    CloseClass3ConnectionBasedOnSession(i + 1);
   }OPENER_TRACE_INFO("encap.c: Close session done\n");
 }
 
 void RemoveSession(const int socket) {
   OPENER_TRACE_INFO("encap.c: Removing session\n");
-  for(unsigned int i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
-    if(g_registered_sessions[i] == socket) {
-      g_registered_sessions[i] = kEipInvalidSocket;
-      CloseClass3ConnectionBasedOnSession(i + 1);
-      break;
-    }
+  size_t i = 0;
+  if(SocketIndexMapFind(&s_session_by_socket, socket, &i)) {
+    ReleaseSession(i);
+    CloseClass3ConnectionBasedOnSession(i + 1);
   }OPENER_TRACE_INFO("encap.c: Session removed\n");
 }
 
@@ -677,24 +821,38 @@ void EncapsulationShutDown(void) {
   for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
     if(kEipInvalidSocket != g_registered_sessions[i]) {
       CloseTcpSocket(g_registered_sessions[i]);
-      g_registered_sessions[i] = kEipInvalidSocket;
+      ReleaseSession(i);
     }
   }
 }
 
 void ManageEncapsulationMessages(const MilliSeconds elapsed_time) {
-  for(size_t i = 0; i < ENCAP_NUMBER_OF_SUPPORTED_DELAYED_ENCAP_MESSAGES; i++) {
-    if(kEipInvalidSocket != g_delayed_encapsulation_messages[i].socket) {
-      g_delayed_encapsulation_messages[i].time_out -= elapsed_time;
-      if(0 >= g_delayed_encapsulation_messages[i].time_out) {
-        /* If delay is reached or passed, send the UDP message */
-        sendto(g_delayed_encapsulation_messages[i].socket, (char*) g_delayed_encapsulation_messages[i].outgoing_message.message_buffer,
-          g_delayed_encapsulation_messages[i].outgoing_message.used_message_length, 0, (struct sockaddr*) &(g_delayed_encapsulation_messages[i].receiver),
-          sizeof(struct sockaddr));
-        g_delayed_encapsulation_messages[i].socket = kEipInvalidSocket;
-      }
-    }
+  s_list_identity_clock += elapsed_time;
+  /* The queue is sorted, so only the due replies at its head are visited */
+  size_t number_of_sent_replies = 0;
+  while(number_of_sent_replies < s_delayed_reply_count &&
+        !ListIdentityDeadlineBefore(s_list_identity_clock,
+                                    s_delayed_replies[number_of_sent_replies].
+                                    deadline) ) {
+    SendDelayedListIdentityReply(&s_delayed_replies[number_of_sent_replies]);
+    number_of_sent_replies++;
+  }
+  if(0 != number_of_sent_replies) {
+    s_delayed_reply_count -= number_of_sent_replies;
+    memmove(s_delayed_replies, &s_delayed_replies[number_of_sent_replies],
+            s_delayed_reply_count * sizeof(s_delayed_replies[0]) );
+  }
+}
+
+bool GetNextDelayedEncapsulationMessage(MilliSeconds *const remaining_time) {
+  if(0 == s_delayed_reply_count) {
+    return false;
   }
+  const MilliSeconds deadline = s_delayed_replies[0].deadline;
+  *remaining_time =
+    ListIdentityDeadlineBefore(s_list_identity_clock, deadline) ?
+    deadline - s_list_identity_clock : 0;
+  return true;
 }
 
 void CloseEncapsulationSessionBySockAddr(const CipConnectionObject *const connection_object) {
@@ -718,12 +876,11 @@ void CloseEncapsulationSessionBySockAddr(const CipConnectionObject *const connec
 }
 
 CipSessionHandle GetSessionFromSocket(const int socket_handle) {
-  for(CipSessionHandle i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
-    if(socket_handle == g_registered_sessions[i]) {
-      return i;
-    }
+  size_t i = 0;
+  if(SocketIndexMapFind(&s_session_by_socket, socket_handle, &i)) {
+    return (CipSessionHandle)(i + 1);
   }
-  return OPENER_NUMBER_OF_SUPPORTED_SESSIONS;
+  return 0; /* no session, 0 is never a valid session handle */
 }
 
 void CloseClass3ConnectionBasedOnSession(CipSessionHandle encapsulation_session_handle) {
@@ -79,6 +79,20 @@ void EncapsulationShutDown(void);
  */
 void ManageEncapsulationMessages(const MilliSeconds elapsed_time);
 
+/** @ingroup ENCAP
+ * @brief Get the time until the next delayed response is due
+ *
+ * @param remaining_time Receives the time ManageEncapsulationMessages() still
+ *        has to be advanced by, 0 if a response is already due
+ * @return true if a delayed response is waiting
+ */
+bool GetNextDelayedEncapsulationMessage(MilliSeconds *const remaining_time);
+
+/** @brief Get the session registered on a TCP socket
+ *
+ * @param socket_handle The TCP socket
+ * @return The session handle, 0 if no session is registered on the socket
+ */
 CipSessionHandle GetSessionFromSocket(const int socket_handle);
 
 void RemoveSession(const int socket);
@@ -21,138 +21,58 @@
 
 OpenerEndianess g_opener_platform_endianess = kOpenerEndianessUnknown;
 
-/* THESE ROUTINES MODIFY THE BUFFER POINTER*/
-
-/**
- *   @brief Reads EIP_UINT8 from *buffer and converts little endian to host.
- *   @param buffer pointer where data should be reed.
- *   @return EIP_UINT8 data value
- */
-CipSint GetSintFromMessage(const EipUint8 **const buffer) {
-  const unsigned char *const buffer_address = (unsigned char *) *buffer;
-  EipUint8 data = buffer_address[0];
-  *buffer += 1;
-  return data;
-}
-
-CipByte GetByteFromMessage(const CipOctet **const buffer_address) {
-  const CipOctet *buffer = *buffer_address;
-  CipByte data = buffer[0];
-  *buffer_address += 1;
-  return data;
-}
-
-CipUsint GetUsintFromMessage(const CipOctet **const buffer_address) {
-  const CipOctet *buffer = *buffer_address;
-  CipUsint data = buffer[0];
-  *buffer_address += 1;
-  return data;
-}
-
-CipBool GetBoolFromMessage(const EipBool8 **const buffer_address) {
-  const EipBool8 *buffer = *buffer_address;
-  EipBool8 data = buffer[0];
-  *buffer_address += 1;
-  return data;
-}
-
-/* little-endian-to-host unsigned 16 bit*/
-
-/**
- *   @brief Reads EIP_UINT16 from *buffer and converts little endian to host.
- *   @param buffer pointer where data should be reed.
- *   @return EIP_UINT16 data value
- */
-CipInt GetIntFromMessage(const EipUint8 **const buffer) {
-  const unsigned char *const buffer_address = (unsigned char *) *buffer;
-  EipUint16 data = buffer_address[0] | buffer_address[1] << 8;
-  *buffer += 2;
-  return data;
-}
-
-CipUint GetUintFromMessage(const CipOctet **const buffer_address) {
-  const CipOctet *buffer = *buffer_address;
-  EipUint16 data = buffer[0] | buffer[1] << 8;
-  *buffer_address += 2;
-  return data;
-}
-
-CipWord GetWordFromMessage(const CipOctet **const buffer_address) {
-  const CipOctet *buffer = *buffer_address;
-  EipUint16 data = buffer[0] | buffer[1] << 8;
-  *buffer_address += 2;
-  return data;
-}
-
-/**
- *   @brief Reads EIP_UINT32 from *buffer and converts little endian to host.
- *   @param buffer pointer where data should be reed.
- *   @return EIP_UNÍT32 value
- */
-CipDint GetDintFromMessage(const EipUint8 **const buffer) {
-  const unsigned char *p = (unsigned char *) *buffer;
-  EipUint32 data = p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24;
-  *buffer += 4;
-  return data;
-}
-
-CipUdint GetUdintFromMessage(const CipOctet **const buffer_address) {
-  const CipOctet *buffer = *buffer_address;
-  CipUdint data = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] <<
-                  24;
-  *buffer_address += 4;
-  return data;
-}
-
-CipUdint GetDwordFromMessage(const CipOctet **const buffer_address) {
-  const CipOctet *buffer = *buffer_address;
-  CipDword data = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] <<
-                  24;
-  *buffer_address += 4;
-  return data;
+void EncodeUintArray(const CipUint *const values,
+                     const size_t count,
+                     ENIPMessage *const outgoing_message) {
+#if OPENER_LITTLE_ENDIAN_HOST
+  memcpy(outgoing_message->current_message_position, values,
+         count * sizeof(CipUint) );
+  MoveMessageNOctets( (int) (count * sizeof(CipUint) ), outgoing_message );
+#else
+  for (size_t i = 0; i < count; ++i) {
+    AddIntToMessage(values[i], outgoing_message);
+  }
+#endif
 }
 
-/**
- * @brief converts UINT8 data from host to little endian an writes it to buffer.
- * @param data value to be written
- * @param buffer pointer where data should be written.
- */
-void AddSintToMessage(const EipUint8 data,
+void EncodeUdintArray(const CipUdint *const values,
+                      const size_t count,
                       ENIPMessage *const outgoing_message) {
-
-  outgoing_message->current_message_position[0] = (unsigned char) data;
-  outgoing_message->current_message_position += 1;
-  outgoing_message->used_message_length += 1;
+#if OPENER_LITTLE_ENDIAN_HOST
+  memcpy(outgoing_message->current_message_position, values,
+         count * sizeof(CipUdint) );
+  MoveMessageNOctets( (int) (count * sizeof(CipUdint) ), outgoing_message );
+#else
+  for (size_t i = 0; i < count; ++i) {
+    AddDintToMessage(values[i], outgoing_message);
+  }
+#endif
 }
 
-/**
- * @brief converts UINT16 data from host to little endian an writes it to buffer.
- * @param data value to be written
- * @param buffer pointer where data should be written.
- */
-void AddIntToMessage(const EipUint16 data,
-                     ENIPMessage *const outgoing_message) {
-
-  outgoing_message->current_message_position[0] = (unsigned char) data;
-  outgoing_message->current_message_position[1] = (unsigned char) (data >> 8);
-  outgoing_message->current_message_position += 2;
-  outgoing_message->used_message_length += 2;
+void DecodeUintArray(const CipOctet **const buffer_address,
+                     CipUint *const values,
+                     const size_t count) {
+#if OPENER_LITTLE_ENDIAN_HOST
+  memcpy(values, *buffer_address, count * sizeof(CipUint) );
+  *buffer_address += count * sizeof(CipUint);
+#else
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = GetUintFromMessage(buffer_address);
+  }
+#endif
 }
 
-/**
- * @brief Converts UINT32 data from host to little endian and writes it to buffer.
- * @param data value to be written
- * @param buffer pointer where data should be written.
- */
-void AddDintToMessage(const EipUint32 data,
-                      ENIPMessage *const outgoing_message) {
-  outgoing_message->current_message_position[0] = (unsigned char) data;
-  outgoing_message->current_message_position[1] = (unsigned char) (data >> 8);
-  outgoing_message->current_message_position[2] = (unsigned char) (data >> 16);
-  outgoing_message->current_message_position[3] = (unsigned char) (data >> 24);
-
-  outgoing_message->current_message_position += 4;
-  outgoing_message->used_message_length += 4;
+void DecodeUdintArray(const CipOctet **const buffer_address,
+                      CipUdint *const values,
+                      const size_t count) {
+#if OPENER_LITTLE_ENDIAN_HOST
+  memcpy(values, *buffer_address, count * sizeof(CipUdint) );
+  *buffer_address += count * sizeof(CipUdint);
+#else
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = GetUdintFromMessage(buffer_address);
+  }
+#endif
 }
 
 /**
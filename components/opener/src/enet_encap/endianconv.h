@@ -6,6 +6,9 @@
 #ifndef OPENER_ENDIANCONV_H_
 #define OPENER_ENDIANCONV_H_
 
+#include <stddef.h>
+#include <string.h>
+
 #include "typedefs.h"
 #include "ciptypes.h"
 
@@ -19,18 +22,92 @@ typedef enum {
   kOpENerEndianessBig = 1
 } OpenerEndianess;
 
+/* Little endian loads and stores of the wire format. With a little endian
+ * host a memcpy() is a plain load or store where the target allows
+ * unaligned access and byte accesses otherwise; big endian hosts assemble
+ * the value byte by byte. */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define OPENER_LITTLE_ENDIAN_HOST 1
+#else
+#define OPENER_LITTLE_ENDIAN_HOST 0
+#endif
+
+static inline EipUint16 LoadUint16LittleEndian(const CipOctet *const buffer) {
+#if OPENER_LITTLE_ENDIAN_HOST
+  EipUint16 data;
+  memcpy(&data, buffer, sizeof(data) );
+  return data;
+#else
+  return (EipUint16) (buffer[0] | buffer[1] << 8);
+#endif
+}
+
+static inline EipUint32 LoadUint32LittleEndian(const CipOctet *const buffer) {
+#if OPENER_LITTLE_ENDIAN_HOST
+  EipUint32 data;
+  memcpy(&data, buffer, sizeof(data) );
+  return data;
+#else
+  return (EipUint32) buffer[0] | (EipUint32) buffer[1] << 8 |
+         (EipUint32) buffer[2] << 16 | (EipUint32) buffer[3] << 24;
+#endif
+}
+
+static inline void StoreUint16LittleEndian(CipOctet *const buffer,
+                                           const EipUint16 data) {
+#if OPENER_LITTLE_ENDIAN_HOST
+  memcpy(buffer, &data, sizeof(data) );
+#else
+  buffer[0] = (CipOctet) data;
+  buffer[1] = (CipOctet) (data >> 8);
+#endif
+}
+
+static inline void StoreUint32LittleEndian(CipOctet *const buffer,
+                                           const EipUint32 data) {
+#if OPENER_LITTLE_ENDIAN_HOST
+  memcpy(buffer, &data, sizeof(data) );
+#else
+  buffer[0] = (CipOctet) data;
+  buffer[1] = (CipOctet) (data >> 8);
+  buffer[2] = (CipOctet) (data >> 16);
+  buffer[3] = (CipOctet) (data >> 24);
+#endif
+}
+
+/* THESE ROUTINES MODIFY THE BUFFER POINTER*/
+
 /** @ingroup ENCAP
  *   @brief Reads EIP_UINT8 from *buffer and converts little endian to host.
  *   @param buffer pointer where data should be reed.
  *   @return EIP_UINT8 data value
  */
-CipSint GetSintFromMessage(const EipUint8 **const buffer);
+static inline CipSint GetSintFromMessage(const EipUint8 **const buffer) {
+  CipSint data = (CipSint) (*buffer)[0];
+  *buffer += 1;
+  return data;
+}
 
-CipByte GetByteFromMessage(const CipOctet **const buffer_address);
+static inline CipByte GetByteFromMessage(const CipOctet **const buffer_address)
+{
+  CipByte data = (*buffer_address)[0];
+  *buffer_address += 1;
+  return data;
+}
 
-CipUsint GetUsintFromMessage(const CipOctet **const buffer_address);
+static inline CipUsint GetUsintFromMessage(
+  const CipOctet **const buffer_address) {
+  CipUsint data = (*buffer_address)[0];
+  *buffer_address += 1;
+  return data;
+}
 
-CipBool GetBoolFromMessage(const EipBool8 **const buffer_address);
+static inline CipBool GetBoolFromMessage(const EipBool8 **const buffer_address)
+{
+  CipBool data = (*buffer_address)[0];
+  *buffer_address += 1;
+  return data;
+}
 
 /** @ingroup ENCAP
  *
@@ -38,11 +115,25 @@ CipBool GetBoolFromMessage(const EipBool8 **const buffer_address);
  * @param buffer Pointer to the network buffer array. This pointer will be incremented by 2!
  * @return Extracted 16 bit integer value
  */
-CipInt GetIntFromMessage(const EipUint8 **const buffer);
+static inline CipInt GetIntFromMessage(const EipUint8 **const buffer) {
+  CipInt data = (CipInt) LoadUint16LittleEndian(*buffer);
+  *buffer += 2;
+  return data;
+}
 
-CipUint GetUintFromMessage(const CipOctet **const buffer_address);
+static inline CipUint GetUintFromMessage(const CipOctet **const buffer_address)
+{
+  CipUint data = LoadUint16LittleEndian(*buffer_address);
+  *buffer_address += 2;
+  return data;
+}
 
-CipWord GetWordFromMessage(const CipOctet **const buffer_address);
+static inline CipWord GetWordFromMessage(const CipOctet **const buffer_address)
+{
+  CipWord data = LoadUint16LittleEndian(*buffer_address);
+  *buffer_address += 2;
+  return data;
+}
 
 /** @ingroup ENCAP
  *
@@ -50,11 +141,25 @@ CipWord GetWordFromMessage(const CipOctet **const buffer_address);
  * @param buffer pointer to the network buffer array. This pointer will be incremented by 4!
  * @return Extracted 32 bit integer value
  */
-CipDint GetDintFromMessage(const EipUint8 **const buffer);
+static inline CipDint GetDintFromMessage(const EipUint8 **const buffer) {
+  CipDint data = (CipDint) LoadUint32LittleEndian(*buffer);
+  *buffer += 4;
+  return data;
+}
 
-CipUdint GetUdintFromMessage(const CipOctet **const buffer_address);
+static inline CipUdint GetUdintFromMessage(
+  const CipOctet **const buffer_address) {
+  CipUdint data = LoadUint32LittleEndian(*buffer_address);
+  *buffer_address += 4;
+  return data;
+}
 
-CipUdint GetDwordFromMessage(const CipOctet **const buffer_address);
+static inline CipUdint GetDwordFromMessage(
+  const CipOctet **const buffer_address) {
+  CipDword data = LoadUint32LittleEndian(*buffer_address);
+  *buffer_address += 4;
+  return data;
+}
 
 /** @ingroup ENCAP
  *
@@ -62,8 +167,12 @@ CipUdint GetDwordFromMessage(const CipOctet **const buffer_address);
  * @param data value to be written
  * @param buffer pointer where data should be written.
  */
-void AddSintToMessage(const EipUint8 data,
-                      ENIPMessage *const outgoing_message);
+static inline void AddSintToMessage(const EipUint8 data,
+                                    ENIPMessage *const outgoing_message) {
+  outgoing_message->current_message_position[0] = data;
+  outgoing_message->current_message_position += 1;
+  outgoing_message->used_message_length += 1;
+}
 
 /** @ingroup ENCAP
  *
@@ -73,8 +182,12 @@ void AddSintToMessage(const EipUint8 data,
  *
  * @return Length in bytes of the encoded message
  */
-void AddIntToMessage(const EipUint16 data,
-                     ENIPMessage *const outgoing_message);
+static inline void AddIntToMessage(const EipUint16 data,
+                                   ENIPMessage *const outgoing_message) {
+  StoreUint16LittleEndian(outgoing_message->current_message_position, data);
+  outgoing_message->current_message_position += 2;
+  outgoing_message->used_message_length += 2;
+}
 
 /** @ingroup ENCAP
  *
@@ -84,9 +197,57 @@ void AddIntToMessage(const EipUint16 data,
  *
  * @return Length in bytes of the encoded message
  */
-void AddDintToMessage(const EipUint32 data,
+static inline void AddDintToMessage(const EipUint32 data,
+                                    ENIPMessage *const outgoing_message) {
+  StoreUint32LittleEndian(outgoing_message->current_message_position, data);
+  outgoing_message->current_message_position += 4;
+  outgoing_message->used_message_length += 4;
+}
+
+/** @ingroup ENCAP
+ *
+ * @brief Write an array of 16Bit integers to the network buffer.
+ * @param values values to write
+ * @param count number of values
+ * @param outgoing_message The message the values are appended to
+ */
+void EncodeUintArray(const CipUint *const values,
+                     const size_t count,
+                     ENIPMessage *const outgoing_message);
+
+/** @ingroup ENCAP
+ *
+ * @brief Write an array of 32Bit integers to the network buffer.
+ * @param values values to write
+ * @param count number of values
+ * @param outgoing_message The message the values are appended to
+ */
+void EncodeUdintArray(const CipUdint *const values,
+                      const size_t count,
                       ENIPMessage *const outgoing_message);
 
+/** @ingroup ENCAP
+ *
+ * @brief Read an array of 16Bit integers from the network buffer.
+ * @param buffer_address Pointer to the network buffer array. This pointer will be incremented by 2 * count!
+ * @param values Array receiving the values
+ * @param count number of values
+ */
+void DecodeUintArray(const CipOctet **const buffer_address,
+                     CipUint *const values,
+                     const size_t count);
+
+/** @ingroup ENCAP
+ *
+ * @brief Read an array of 32Bit integers from the network buffer.
+ * @param buffer_address Pointer to the network buffer array. This pointer will be incremented by 4 * count!
+ * @param values Array receiving the values
+ * @param count number of values
+ */
+void DecodeUdintArray(const CipOctet **const buffer_address,
+                      CipUdint *const values,
+                      const size_t count);
+
 EipUint64 GetLintFromMessage(const EipUint8 **const buffer);
 
 /** @ingroup ENCAP
@@ -84,23 +84,25 @@ EipStatus IfaceWaitForIp(TcpIpInterface *const iface,
  * @brief Get host name from platform
  *
  * @param  iface      address specifying the network interface
- * @param  hostname   address of CipString destination structure
+ * @param  hostname   host name destination, stored in place
  *
  * This function reads the host name from the platform and returns it
- *  via the hostname parameter.
+ *  via the hostname parameter. A host name longer than
+ *  CIP_TCPIP_MAX_HOSTNAME_LENGTH leaves it empty.
  */
 void GetHostName(TcpIpInterface *iface,
-                 CipString *hostname);
+                 CipTcpIpHostName *hostname);
 #else   /** other targets */
 /** @ingroup CIP_API
  * @brief Get host name from platform
  *
- * @param  hostname  address of CipString destination structure
+ * @param  hostname  host name destination, stored in place
  *
  * This function reads the host name from the platform and returns it
- *  via the hostname parameter.
+ *  via the hostname parameter. A host name longer than
+ *  CIP_TCPIP_MAX_HOSTNAME_LENGTH leaves it empty.
  */
-void GetHostName(CipString *hostname);
+void GetHostName(CipTcpIpHostName *hostname);
 #endif    /** other targets */
 
 /** @ingroup CIP_API
@@ -164,7 +166,9 @@ CipUint GetDeviceVendorId(void);
 /** @ingroup CIP_API
  * @breif Set device's CIP ProductName
  *
- * @param product_name C-string to use as ProducName
+ * @param product_name C-string to use as ProducName, up to
+ *        CIP_IDENTITY_MAX_PRODUCT_NAME_LENGTH characters; a longer one
+ *        leaves the product name empty
  *
  * When OpENer is used as a library, multiple CIP adapters may use it
  * and will need to change the product name.
@@ -174,12 +178,12 @@ void SetDeviceProductName(const char *product_name);
 /** @ingroup CIP_API
  * @brief Get device's current CIP ProductName
  *
- * Hint, use GetCstrFromCipShortString() to get a printable/logable C
- * string, since CipShortString's aren't NUL terminated.
+ * The name is stored in place and is not NUL terminated; its characters
+ * are at GetCipStringFixedData(), header->length of them.
  *
- * @returns the CipShortString for the product name
+ * @returns the header of the fixed capacity product name string
  */
-CipShortString *GetDeviceProductName(void);
+CipStringFixed *GetDeviceProductName(void);
 
 /** @ingroup CIP_API
  * @brief Initialize and setup the CIP-stack
@@ -256,8 +260,9 @@ CipInstance *GetCipInstance(const CipClass *RESTRICT const cip_object,
  * @return pointer to attribute
  *          0 if instance is not in the object
  */
-CipAttributeStruct *GetCipAttribute(const CipInstance *const cip_instance,
-                                    const EipUint16 attribute_number);
+const CipAttributeStruct *GetCipAttribute(
+  const CipInstance *const cip_instance,
+  const EipUint16 attribute_number);
 
 typedef void (*InitializeCipClass)(CipClass *); /**< Initializer function for CIP class initialization */
 
@@ -352,6 +357,55 @@ void InsertAttribute(CipInstance *const instance,
                      void *const data,
                      const EipByte cip_flags);
 
+/** @ingroup CIP_API
+ * @brief Entry of a const attribute table, see SetCipInstanceAttributes()
+ *
+ *  The arguments are those of InsertAttribute(). The attribute data has to
+ *  have static storage, its address is a constant of the firmware image.
+ *  An attribute of a fixed size elementary type has to use the standard
+ *  encoder of its type, e.g. EncodeCipUint() for kCipUint, as it is encoded
+ *  inline; give other encoders kCipAny.
+ */
+#define CIP_ATTRIBUTE(attribute_number, cip_type, encode_function, \
+                      decode_function, data, cip_flags) \
+  { (attribute_number), (cip_type), CIP_ATTRIBUTE_ENCODING(cip_type), \
+    (encode_function), (decode_function), (cip_flags), (void *) (data) }
+
+/** @ingroup CIP_API
+ * @brief Use a const table as the attributes of an instance
+ *
+ *  An alternative to InsertAttribute() for objects whose attribute data has
+ *  static storage. The table stays in flash, the instance neither allocates
+ *  nor copies it, only the attribute values are in RAM. All instances of the
+ *  class have to use tables of the same length and the class has to be
+ *  created with 0 instance attributes, so that AddCipInstances() allocates
+ *  none.
+ *
+ *  Attributes flagged kGetableAllStatic in addition to kGetableAll keep
+ *  their GetAttributeAll encoding in a per instance cache; the encoders of
+ *  the other attributes run on every request. Code that changes the value of
+ *  such an attribute other than through the Set services has to call
+ *  InvalidateGetAttributeAllCache().
+ *
+ *  @param instance instance the table describes
+ *  @param attributes table built with CIP_ATTRIBUTE(), sorted by attribute
+ *  number
+ *  @param number_of_attributes number of entries in the table
+ */
+void SetCipInstanceAttributes(CipInstance *const instance,
+                              const CipAttributeStruct *const attributes,
+                              const EipUint16 number_of_attributes);
+
+/** @ingroup CIP_API
+ * @brief Forget the cached GetAttributeAll encoding of an instance
+ *
+ *  The next GetAttributeAll request encodes the kGetableAllStatic attributes
+ *  again. The Set services call it themselves.
+ *
+ *  @param instance instance whose static attributes changed, may be NULL
+ */
+void InvalidateGetAttributeAllCache(CipInstance *const instance);
+
 /** @ingroup CIP_API
  * @brief Allocates Attribute bitmasks
  *
@@ -467,6 +521,14 @@ void EncodeCipShortString(const void *const data,
 void EncodeCipString(const void *const data,
                      ENIPMessage *const outgoing_message);
 
+/** @brief Encodes a CIP_STRING_FIXED() as STRING, @p data points to it */
+void EncodeCipStringFixed(const void *const data,
+                          ENIPMessage *const outgoing_message);
+
+/** @brief Encodes a CIP_STRING_FIXED() as SHORT_STRING, at most 255 symbols */
+void EncodeCipShortStringFixed(const void *const data,
+                               ENIPMessage *const outgoing_message);
+
 void EncodeCipString2(const void *const data,
                       ENIPMessage *const outgoing_message);
 
@@ -594,6 +656,23 @@ CipInstance *CreateAssemblyObject(const CipInstanceNum instance_number,
                                   EipByte *const data,
                                   const EipUint16 data_length);
 
+/** @ingroup CIP_API
+ * @brief Declare the members of an assembly object
+ *
+ * The members follow each other without gaps in the assembly's data. They
+ * are reported in attributes 1 and 2, and Get_Member and Set_Member on
+ * attribute 3 with a member ID from 1 on only copy that member's bytes.
+ *
+ * @param instance assembly object from CreateAssemblyObject(), may be NULL
+ * @param member_sizes size in bytes of each member, not copied
+ * @param member_count number of members
+ * @return kEipStatusOk, or kEipStatusError if instance is NULL or the
+ * members do not add up to the size of the assembly's data
+ */
+EipStatus SetAssemblyMembers(CipInstance *const instance,
+                             const EipUint16 *const member_sizes,
+                             const CipUint member_count);
+
 typedef struct cip_connection_object CipConnectionObject;
 
 /** @ingroup CIP_API
@@ -786,6 +865,22 @@ EipStatus HandleReceivedConnectedData(const EipUint8 *const received_data,
                                       int received_data_length,
                                       struct sockaddr_in *from_address);
 
+/** @ingroup CIP_API
+ *  @brief Notify the connection manager that data for a connection has been
+ *  received over a DTLS session.
+ *
+ *  Counterpart of HandleReceivedConnectedData() for the CIP Security
+ *  transport. Only connections opened over TLS take such data, and they
+ *  take no other.
+ *  @param received_data pointer to the decrypted data
+ *  @param received_data_length number of bytes in the data buffer
+ *  @param from_address peer of the DTLS session
+ *  @return EIP_OK on success
+ */
+EipStatus HandleReceivedSecureConnectedData(const EipUint8 *const received_data,
+                                            int received_data_length,
+                                            struct sockaddr_in *from_address);
+
 /** @ingroup CIP_API
  * @brief Check if any of the connection timers (TransmissionTrigger or
  * WatchdogTimeout) have timed out.
@@ -812,7 +907,8 @@ EipStatus ManageConnections(MilliSeconds elapsed_time);
  * be invoked from void HandleApplication(void).
  *
  * The connection can only be triggered if the application is established and it
- * is of application application triggered type.
+ * is of application triggered or change of state type. All established
+ * connections using the given connection points are triggered.
  *
  * @param output_assembly_id the output assembly connection point of the
  * connection
@@ -953,6 +1049,11 @@ void CipFree(void *data);
  * @brief Inform the application that the Run/Idle State has been changed
  * by the originator.
  *
+ * The state is the one of the device: run while one consuming connection
+ * sends run, idle while all of them send idle. Called for the first header
+ * of a new connection, on every change of the device state, and when a
+ * leaving connection changes it.
+ *
  * @param run_idle_value the current value of the run/idle flag according to CIP
  * spec Vol 1 3-6.5
  */
@@ -974,6 +1075,30 @@ int CreateUdpSocket(void);
 EipStatus SendUdpData(const struct sockaddr_in *const socket_data,
                       const ENIPMessage *const outgoing_message);
 
+/** @ingroup CIP_CALLBACK_API
+ * @brief Sends an implicit IO frame given as header and payload via UDP
+ *
+ * Lets the platform gather the frame directly into the network buffer, so
+ * the payload does not have to be copied behind the header first.
+ *
+ * The frame carries the DSCP of its connection, the platform marks it per
+ * frame without changing the options of the shared producing socket.
+ *
+ * @param socket_data Address message to be sent
+ * @param dscp DSCP value of the frame, as given by CipQosGetDscpPriority()
+ * @param header CPF header of the frame
+ * @param header_length Length of the header
+ * @param payload Frame payload, may be NULL if payload_length is 0
+ * @param payload_length Length of the payload
+ * @return kEipStatusOk on success
+ */
+EipStatus SendUdpFrame(const struct sockaddr_in *const socket_data,
+                       const CipUsint dscp,
+                       const EipUint8 *const header,
+                       const size_t header_length,
+                       const EipUint8 *const payload,
+                       const size_t payload_length);
+
 /** @ingroup CIP_CALLBACK_API
  * @brief Close the given socket and clean up the stack
  *
@@ -988,6 +1113,34 @@ void CloseSocket(const int socket_handle);
  */
 void RegisterTimeoutChecker(TimeoutCheckerFunction timeout_checker_function);
 
+/** @ingroup CIP_CALLBACK_API
+ * @brief Measured CPU time of one produced and of one consumed I/O packet
+ *
+ * Used by the Forward_Open admission control together with
+ * OPENER_ADMISSION_CPU_BUDGET_PERCENT. A platform that does not measure the
+ * packet handling returns 0, only the packet rate budget applies then.
+ *
+ * @param production_time receives the average time of a production in microseconds
+ * @param consumption_time receives the average time of a consumed packet in microseconds
+ */
+void GetIoPacketProcessingTime(CipUdint *const production_time,
+                               CipUdint *const consumption_time);
+
+/** @ingroup CIP_CALLBACK_API
+ * @brief An I/O connection of an originator was established or closed
+ *
+ * Called once with established set when the connection becomes active and
+ * once without when it is closed, timed out or taken over. Lets the
+ * platform keep the link layer address of the originator resolved while it
+ * has connections, e.g. with a static ARP entry.
+ *
+ * @param originator_address address the Forward_Open came from
+ * @param established true for a new connection, false for a closed one
+ */
+void IoConnectionOriginatorChanged(
+  const struct sockaddr_in *const originator_address,
+  const bool established);
+
 /** @mainpage OpENer - Open Source EtherNet/IP(TM) Communication Stack
  * Documentation
  *
@@ -0,0 +1,164 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "app_scheduler.h"
+
+#include <stdbool.h>
+
+#include "trace.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+typedef struct {
+  AppSchedulerJobConfig config;
+  TaskHandle_t task;
+  esp_timer_handle_t timer;
+  /* Under s_scheduler_lock, set by the timer and taken by the job task */
+  int64_t period_start;
+  bool period_pending;
+  AppSchedulerJobStatistics statistics;
+} AppSchedulerJob;
+
+static AppSchedulerJob s_jobs[CONFIG_OPENER_APP_SCHEDULER_MAX_JOBS];
+/* Published after the job is complete, read by AppSchedulerSignal() */
+static size_t s_number_of_jobs = 0;
+static portMUX_TYPE s_scheduler_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Runs in the esp_timer task, only hands over to the job task */
+static void AppSchedulerTimerExpired(void *argument) {
+  AppSchedulerJob *const job = argument;
+  const int64_t now = esp_timer_get_time();
+  taskENTER_CRITICAL(&s_scheduler_lock);
+  if(job->period_pending) {
+    job->statistics.overruns++;
+  } else {
+    job->period_start = now;
+    job->period_pending = true;
+  }
+  taskEXIT_CRITICAL(&s_scheduler_lock);
+  xTaskNotify(job->task, kAppSchedulerEventPeriod, eSetBits);
+}
+
+static void AppSchedulerTask(void *argument) {
+  AppSchedulerJob *const job = argument;
+  for(;; ) {
+    uint32_t events = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+    const int64_t start = esp_timer_get_time();
+    CipUdint latency = 0;
+    if(0 != (events & kAppSchedulerEventPeriod) ) {
+      taskENTER_CRITICAL(&s_scheduler_lock);
+      latency = (CipUdint) (start - job->period_start);
+      job->period_pending = false;
+      taskEXIT_CRITICAL(&s_scheduler_lock);
+    }
+
+    job->config.function(job->config.argument, events);
+
+    const CipUdint run_time = (CipUdint) (esp_timer_get_time() - start);
+    taskENTER_CRITICAL(&s_scheduler_lock);
+    job->statistics.runs++;
+    if(latency > job->statistics.maximum_latency) {
+      job->statistics.maximum_latency = latency;
+    }
+    if(run_time > job->statistics.maximum_run_time) {
+      job->statistics.maximum_run_time = run_time;
+    }
+    taskEXIT_CRITICAL(&s_scheduler_lock);
+  }
+}
+
+EipStatus AppSchedulerRegister(const AppSchedulerJobConfig *const config) {
+  if(NULL == config->function ||
+     (0 == config->period_ms && 0 == config->events) ) {
+    OPENER_TRACE_ERR("App scheduler: job %s has nothing to run on\n",
+                     config->name);
+    return kEipStatusError;
+  }
+  if(s_number_of_jobs >= CONFIG_OPENER_APP_SCHEDULER_MAX_JOBS) {
+    OPENER_TRACE_ERR("App scheduler: no slot for job %s\n", config->name);
+    return kEipStatusError;
+  }
+
+  AppSchedulerJob *const job = &s_jobs[s_number_of_jobs];
+  job->config = *config;
+  job->config.events &= ~(uint32_t) kAppSchedulerEventPeriod;
+  job->period_pending = false;
+  job->statistics = (AppSchedulerJobStatistics) {
+    .name = config->name,
+    .period_ms = config->period_ms,
+  };
+
+  if(pdPASS != xTaskCreatePinnedToCore(AppSchedulerTask,
+                                       config->name,
+                                       config->stack_size,
+                                       job,
+                                       config->priority,
+                                       &job->task,
+                                       config->core) ) {
+    OPENER_TRACE_ERR("App scheduler: failed to create task %s\n",
+                     config->name);
+    return kEipStatusError;
+  }
+
+  job->timer = NULL;
+  if(0 != config->period_ms) {
+    const esp_timer_create_args_t timer_args = {
+      .callback = AppSchedulerTimerExpired,
+      .arg = job,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = config->name,
+    };
+    if(ESP_OK != esp_timer_create(&timer_args, &job->timer) ||
+       ESP_OK != esp_timer_start_periodic(job->timer,
+                                          (uint64_t) config->period_ms * 1000U) )
+    {
+      OPENER_TRACE_ERR("App scheduler: failed to start the timer of %s\n",
+                       config->name);
+      if(NULL != job->timer) {
+        esp_timer_delete(job->timer);
+      }
+      vTaskDelete(job->task);
+      return kEipStatusError;
+    }
+  }
+
+  __atomic_store_n(&s_number_of_jobs, s_number_of_jobs + 1, __ATOMIC_RELEASE);
+  OPENER_TRACE_INFO("App scheduler: job %s, period %u ms, events 0x%x, "
+                    "core %d, priority %u\n",
+                    config->name, (unsigned) config->period_ms,
+                    (unsigned) job->config.events, (int) config->core,
+                    (unsigned) config->priority);
+  return kEipStatusOk;
+}
+
+void AppSchedulerSignal(const uint32_t events) {
+  const size_t number_of_jobs = __atomic_load_n(&s_number_of_jobs,
+                                                __ATOMIC_ACQUIRE);
+  for(size_t i = 0; i < number_of_jobs; ++i) {
+    const uint32_t subscribed = events & s_jobs[i].config.events;
+    if(0 != subscribed) {
+      xTaskNotify(s_jobs[i].task, subscribed, eSetBits);
+    }
+  }
+}
+
+size_t AppSchedulerGetNumberOfJobs(void) {
+  return __atomic_load_n(&s_number_of_jobs, __ATOMIC_ACQUIRE);
+}
+
+EipStatus AppSchedulerGetJobStatistics(const size_t index,
+                                       AppSchedulerJobStatistics *const statistics)
+{
+  if(index >= AppSchedulerGetNumberOfJobs() ) {
+    return kEipStatusError;
+  }
+  taskENTER_CRITICAL(&s_scheduler_lock);
+  *statistics = s_jobs[index].statistics;
+  taskEXIT_CRITICAL(&s_scheduler_lock);
+  return kEipStatusOk;
+}
@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_APP_SCHEDULER_H_
+#define OPENER_APP_SCHEDULER_H_
+
+/** @file app_scheduler.h
+ *  @brief Periodic and event driven application jobs in their own tasks
+ *
+ *  HandleApplication() runs in the OpENer task once per timer tick, with
+ *  the stack locked and behind the network work of that loop. Application
+ *  work that needs its own timing, e.g. I/O processing, logic or telemetry,
+ *  registers a job instead. Every job gets a task of its own with the
+ *  configured core, priority and stack. The task sleeps in
+ *  xTaskNotifyWait() and is woken by
+ *
+ *  - an esp_timer every period_ms, for periodic jobs, and
+ *  - AppSchedulerSignal() from the stack callbacks, for the events it
+ *    subscribed to: output data received, a connection opened, timed out
+ *    or closed, and a change of the Run/Idle header, or from another task
+ *    that queued a request for the job.
+ *
+ *  Events arriving while a job runs are collected and passed to its next
+ *  run, so a job never runs twice at the same time and a slow job delays
+ *  only itself. Signalling sets notification bits and never blocks, the
+ *  network path does not wait for the jobs.
+ *
+ *  Jobs run without the stack lock. A job that reads or writes stack data,
+ *  e.g. an assembly, takes ProductionSchedulerLock() around the access.
+ *
+ *  Start latency, run time and periods a job was still busy with the
+ *  previous one are kept per job for GET /api/system.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "freertos/FreeRTOS.h"
+
+/** @brief Events a job can subscribe to, passed to the job as a bit set */
+typedef enum {
+  kAppSchedulerEventPeriod = 1U << 0, /**< period_ms elapsed */
+  kAppSchedulerEventOutputReceived = 1U << 1, /**< new output assembly data */
+  kAppSchedulerEventConnectionState = 1U << 2, /**< an I/O connection opened, timed out or closed */
+  kAppSchedulerEventRunIdle = 1U << 3, /**< the Run/Idle header changed */
+  kAppSchedulerEventRequest = 1U << 4, /**< work handed over by a task outside the stack, e.g. the web API */
+} AppSchedulerEvent;
+
+/** @brief Job body
+ *
+ *  @param argument argument given at registration
+ *  @param events AppSchedulerEvent bits that arrived since the last run
+ */
+typedef void (*AppSchedulerJobFunction)(void *argument, uint32_t events);
+
+/** @brief Description of a job */
+typedef struct {
+  const char *name; /**< task name, kept by reference */
+  AppSchedulerJobFunction function;
+  void *argument;
+  uint32_t period_ms; /**< 0 for a job that only runs on events */
+  uint32_t events; /**< AppSchedulerEvent bits besides the period */
+  BaseType_t core; /**< 0, 1 or tskNO_AFFINITY */
+  UBaseType_t priority;
+  uint32_t stack_size; /**< in bytes */
+} AppSchedulerJobConfig;
+
+/** @brief Timing of one job, times in microseconds */
+typedef struct {
+  const char *name;
+  uint32_t period_ms;
+  CipUdint runs;
+  CipUdint overruns; /**< periods that elapsed while the previous one was pending */
+  CipUdint maximum_latency; /**< period start until the job ran */
+  CipUdint maximum_run_time;
+} AppSchedulerJobStatistics;
+
+/** @brief Create the task and, for a periodic job, the timer of a job
+ *
+ *  Jobs are registered from one task, e.g. in ApplicationInitialization(),
+ *  and stay for the lifetime of the firmware.
+ *
+ *  @param config job description, copied
+ *  @return kEipStatusOk, or kEipStatusError if CONFIG_OPENER_APP_SCHEDULER_MAX_JOBS
+ *          jobs exist already or the task or timer could not be created
+ */
+EipStatus AppSchedulerRegister(const AppSchedulerJobConfig *const config);
+
+/** @brief Wake the jobs subscribed to any of the events
+ *
+ *  Called from the stack callbacks with the stack lock held, and for
+ *  kAppSchedulerEventRequest from any task. Never blocks.
+ *
+ *  @param events AppSchedulerEvent bits
+ */
+void AppSchedulerSignal(const uint32_t events);
+
+/** @brief Number of registered jobs */
+size_t AppSchedulerGetNumberOfJobs(void);
+
+/** @brief Copy the timing of a job
+ *
+ *  @param index 0 to AppSchedulerGetNumberOfJobs() - 1
+ *  @param statistics destination
+ *  @return kEipStatusError for an unknown index
+ */
+EipStatus AppSchedulerGetJobStatistics(const size_t index,
+                                       AppSchedulerJobStatistics *const statistics);
+
+#endif /* OPENER_APP_SCHEDULER_H_ */
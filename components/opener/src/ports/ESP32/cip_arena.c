@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "cip_arena.h"
+
+#if CONFIG_OPENER_CIP_ARENA
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heap_class.h"
+#include "trace.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define CIP_ARENA_ALIGNMENT 8U
+#define CIP_ARENA_ALIGN(size) ( ( (size) + CIP_ARENA_ALIGNMENT - 1U ) & \
+                                ~(size_t) (CIP_ARENA_ALIGNMENT - 1U) )
+#define CIP_POOL_BLOCK_SIZE CIP_ARENA_ALIGN(CONFIG_OPENER_CIP_POOL_BLOCK_SIZE)
+
+static uint8_t s_arena[CIP_ARENA_ALIGN(CONFIG_OPENER_CIP_ARENA_SIZE)]
+__attribute__( (aligned(CIP_ARENA_ALIGNMENT) ) );
+static uint8_t s_pool[CONFIG_OPENER_CIP_POOL_BLOCKS][CIP_POOL_BLOCK_SIZE]
+__attribute__( (aligned(CIP_ARENA_ALIGNMENT) ) );
+/* Bit n set: pool block n is allocated */
+static uint32_t s_pool_map = 0;
+
+static CipArenaStatistics s_statistics = {
+  .arena_size = sizeof(s_arena),
+  .pool_blocks = CONFIG_OPENER_CIP_POOL_BLOCKS,
+};
+/* CipCalloc() runs in the OpENer task and in the web UI handlers */
+static portMUX_TYPE s_arena_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void CipArenaBeginInit(void) {
+  taskENTER_CRITICAL(&s_arena_lock);
+  const bool reset = (0 == s_statistics.arena_live);
+  if(reset) {
+    s_statistics.arena_used = 0;
+    s_statistics.frozen = false;
+  }
+  taskEXIT_CRITICAL(&s_arena_lock);
+  if(!reset) {
+    OPENER_TRACE_WARN("CIP arena: %" PRIu32 " allocations still in use, "
+                      "initializing from the heap\n",
+                      s_statistics.arena_live);
+  }
+}
+
+void CipArenaFreeze(void) {
+  taskENTER_CRITICAL(&s_arena_lock);
+  s_statistics.frozen = true;
+  taskEXIT_CRITICAL(&s_arena_lock);
+  OPENER_TRACE_INFO("CIP arena: %" PRIu32 " of %" PRIu32 " bytes used, "
+                    "%" PRIu32 " allocations from the heap\n",
+                    s_statistics.arena_used, s_statistics.arena_size,
+                    s_statistics.heap_allocations);
+}
+
+/* Caller holds s_arena_lock */
+static void *CipArenaTake(const size_t size) {
+  if(!s_statistics.frozen) {
+    const size_t aligned_size = CIP_ARENA_ALIGN(size);
+    if(aligned_size <= sizeof(s_arena) - s_statistics.arena_used) {
+      void *const data = &s_arena[s_statistics.arena_used];
+      s_statistics.arena_used += aligned_size;
+      s_statistics.arena_live++;
+      return data;
+    }
+  } else {
+    s_statistics.runtime_allocations++;
+    if(size <= CIP_POOL_BLOCK_SIZE) {
+      for(uint32_t block = 0; block < CONFIG_OPENER_CIP_POOL_BLOCKS; ++block) {
+        if(0 == (s_pool_map & (1UL << block) ) ) {
+          s_pool_map |= (1UL << block);
+          s_statistics.pool_in_use++;
+          if(s_statistics.pool_in_use > s_statistics.pool_peak) {
+            s_statistics.pool_peak = s_statistics.pool_in_use;
+          }
+          return s_pool[block];
+        }
+      }
+    }
+  }
+  s_statistics.heap_allocations++;
+  return NULL;
+}
+
+void *CipArenaCalloc(size_t number_of_elements, size_t size_of_element) {
+  if(0 != size_of_element && number_of_elements > SIZE_MAX / size_of_element) {
+    return NULL;
+  }
+  const size_t size = number_of_elements * size_of_element;
+  taskENTER_CRITICAL(&s_arena_lock);
+  void *data = CipArenaTake(size);
+  taskEXIT_CRITICAL(&s_arena_lock);
+  if(NULL == data) {
+    return heap_class_calloc(HEAP_CLASS_NETWORK, 1, size);
+  }
+  memset(data, 0, size);
+  return data;
+}
+
+void CipArenaFree(void *data) {
+  const uint8_t *const position = data;
+  if(position >= s_arena && position < s_arena + sizeof(s_arena) ) {
+    taskENTER_CRITICAL(&s_arena_lock);
+    s_statistics.arena_live--;
+    taskEXIT_CRITICAL(&s_arena_lock);
+    return;
+  }
+  if(position >= &s_pool[0][0] &&
+     position < &s_pool[0][0] + sizeof(s_pool) ) {
+    const uint32_t block =
+      (uint32_t) ( (size_t) (position - &s_pool[0][0]) / CIP_POOL_BLOCK_SIZE );
+    taskENTER_CRITICAL(&s_arena_lock);
+    s_pool_map &= ~(1UL << block);
+    s_statistics.pool_in_use--;
+    taskEXIT_CRITICAL(&s_arena_lock);
+    return;
+  }
+  heap_class_free(HEAP_CLASS_NETWORK, data);
+}
+
+void CipArenaGetStatistics(CipArenaStatistics *statistics) {
+  taskENTER_CRITICAL(&s_arena_lock);
+  *statistics = s_statistics;
+  taskEXIT_CRITICAL(&s_arena_lock);
+}
+
+#endif /* CONFIG_OPENER_CIP_ARENA */
@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_CIP_ARENA_H_
+#define OPENER_CIP_ARENA_H_
+
+/** @file cip_arena.h
+ *  @brief Arena backend of CipCalloc() and CipFree()
+ *
+ *  Selected with CONFIG_OPENER_CIP_ARENA. Classes, instances, attribute
+ *  tables and strings created by CipStackInit() and the application are
+ *  allocated from one static region of CONFIG_OPENER_CIP_ARENA_SIZE bytes
+ *  by bumping a pointer. Freeing an arena allocation only counts it; the
+ *  space is reused once every arena allocation has been freed, i.e. after
+ *  ShutdownCipStack().
+ *
+ *  CipArenaFreeze() ends the initialization. Later allocations, such as the
+ *  electronic key of a Forward_Open, come from a pool of CONFIG_OPENER_CIP_POOL_BLOCKS blocks of
+ *  CONFIG_OPENER_CIP_POOL_BLOCK_SIZE bytes. Allocations the arena or the
+ *  pool cannot hold fall back to the heap and are counted, so a full arena
+ *  or pool shows up in the statistics instead of failing the stack.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_CIP_ARENA
+
+/** @brief Allocation counters, see CipArenaGetStatistics() */
+typedef struct {
+  uint32_t arena_size; /**< bytes of the arena */
+  uint32_t arena_used; /**< bytes handed out since the last reset */
+  uint32_t arena_live; /**< arena allocations not yet freed */
+  bool frozen; /**< initialization ended, the arena takes no allocations */
+  uint32_t pool_blocks; /**< blocks of the runtime pool */
+  uint32_t pool_in_use; /**< blocks allocated now */
+  uint32_t pool_peak; /**< most blocks allocated at once */
+  uint32_t runtime_allocations; /**< allocations after the freeze */
+  uint32_t heap_allocations; /**< allocations neither arena nor pool held */
+} CipArenaStatistics;
+
+/** @brief Start an initialization of the CIP stack
+ *
+ * Called before CipStackInit(). Resets the arena if all of its allocations
+ * have been freed, otherwise the arena stays frozen and the initialization
+ * allocates from the pool and the heap.
+ */
+void CipArenaBeginInit(void);
+
+/** @brief End the initialization, later allocations use the pool */
+void CipArenaFreeze(void);
+
+/** @brief Backend of CipCalloc(), zeroed memory aligned for any type */
+void *CipArenaCalloc(size_t number_of_elements, size_t size_of_element);
+
+/** @brief Backend of CipFree(), accepts NULL */
+void CipArenaFree(void *data);
+
+/** @brief Copy the allocation counters, may be called from any task */
+void CipArenaGetStatistics(CipArenaStatistics *statistics);
+
+#endif /* CONFIG_OPENER_CIP_ARENA */
+
+#endif /* OPENER_CIP_ARENA_H_ */
@@ -0,0 +1,252 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "dlr_ring_node.h"
+
+#if CONFIG_OPENER_DLR_RING_NODE
+
+#include <string.h>
+
+#include "cipdlr.h"
+#include "trace.h"
+#include "esp_timer.h"
+#include "lwip/def.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/timeouts.h"
+#include "lwip/prot/ethernet.h"
+
+#define DLR_ETHERTYPE 0x80E1U
+#define DLR_RING_SUBTYPE 0x02U
+#define DLR_PROTOCOL_VERSION 0x01U
+/* Every DLR PDU has 42 octets, the common header included */
+#define DLR_PDU_LENGTH 42U
+/* Used until a beacon announced its own timeout */
+#define DLR_DEFAULT_BEACON_TIMEOUT_US 1960U
+/* The board's only port */
+#define DLR_PORT 1U
+/* DLR frames are sent priority tagged with PCP 7 */
+#define DLR_VLAN_PRIORITY 7U
+
+/* Offsets in the DLR PDU, which follows the Ethernet type */
+#define DLR_OFFSET_SUBTYPE 0
+#define DLR_OFFSET_VERSION 1
+#define DLR_OFFSET_FRAME_TYPE 2
+#define DLR_OFFSET_SOURCE_PORT 3
+#define DLR_OFFSET_SOURCE_IP 4
+#define DLR_OFFSET_SEQUENCE_ID 8
+/* Beacon */
+#define DLR_OFFSET_RING_STATE 12
+#define DLR_OFFSET_PRECEDENCE 13
+#define DLR_OFFSET_BEACON_TIMEOUT 18
+/* Neighbor_Check response */
+#define DLR_OFFSET_REQUEST_PORT 12
+
+typedef enum {
+  kDlrFrameBeacon = 0x01,
+  kDlrFrameNeighborCheckRequest = 0x02,
+  kDlrFrameNeighborCheckResponse = 0x03,
+  kDlrFrameLinkStatus = 0x04,
+  kDlrFrameLocateFault = 0x05,
+  kDlrFrameAnnounce = 0x06,
+  kDlrFrameSignOn = 0x07,
+  kDlrFrameAdvertise = 0x08,
+  kDlrFrameFlushTables = 0x09,
+  kDlrFrameLearningUpdate = 0x0A,
+} DlrFrameType;
+
+/* Ring State field of a beacon */
+typedef enum {
+  kDlrRingStateNormal = 1,
+  kDlrRingStateFault = 2,
+} DlrRingState;
+
+/* Only touched in the tcpip thread */
+typedef struct {
+  bool active;
+  u8_t precedence;
+  struct eth_addr mac_address;
+  int64_t last_beacon_us;
+  u32_t beacon_timeout_us;
+} DlrSupervisor;
+
+static DlrSupervisor s_supervisor;
+static bool s_timer_armed = false;
+
+static u32_t DlrGetU32(const u8_t *const data) {
+  return ( (u32_t) data[0] << 24 ) | ( (u32_t) data[1] << 16 ) |
+         ( (u32_t) data[2] << 8 ) | (u32_t) data[3];
+}
+
+static const u8_t *DlrRingNodeGetPdu(const struct pbuf *const frame) {
+  if(frame->len < SIZEOF_ETH_HDR) {
+    return NULL;
+  }
+  const struct eth_hdr *ethernet_header = frame->payload;
+  u16_t type = ethernet_header->type;
+  size_t offset = SIZEOF_ETH_HDR;
+  if(PP_HTONS(ETHTYPE_VLAN) == type) {
+    if(frame->len < SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR) {
+      return NULL;
+    }
+    const struct eth_vlan_hdr *vlan_header =
+      (const struct eth_vlan_hdr *) ( (const u8_t *) frame->payload +
+                                      SIZEOF_ETH_HDR);
+    type = vlan_header->tpid;
+    offset += SIZEOF_VLAN_HDR;
+  }
+  if(PP_HTONS(DLR_ETHERTYPE) != type ||
+     frame->len < offset + DLR_PDU_LENGTH) {
+    return NULL;
+  }
+  const u8_t *pdu = (const u8_t *) frame->payload + offset;
+  if(DLR_RING_SUBTYPE != pdu[DLR_OFFSET_SUBTYPE] ||
+     DLR_PROTOCOL_VERSION != pdu[DLR_OFFSET_VERSION]) {
+    return NULL;
+  }
+  return pdu;
+}
+
+bool DlrRingNodeIsFrame(const struct pbuf *const frame) {
+  return NULL != DlrRingNodeGetPdu(frame);
+}
+
+static void DlrRingNodeBeaconTimer(void *argument);
+
+static void DlrRingNodeArmTimer(const int64_t delay_us) {
+  sys_timeout( (u32_t) ( (delay_us + 999) / 1000 ), DlrRingNodeBeaconTimer,
+               NULL );
+  s_timer_armed = true;
+}
+
+/* Armed at most once per beacon timeout, a beacon only records its time */
+static void DlrRingNodeBeaconTimer(void *argument) {
+  (void) argument;
+  s_timer_armed = false;
+  if(!s_supervisor.active) {
+    return;
+  }
+  const int64_t elapsed = esp_timer_get_time() - s_supervisor.last_beacon_us;
+  if(elapsed < (int64_t) s_supervisor.beacon_timeout_us) {
+    DlrRingNodeArmTimer(s_supervisor.beacon_timeout_us - elapsed);
+    return;
+  }
+  OPENER_TRACE_WARN("DLR: beacon timeout, no ring supervisor\n");
+  s_supervisor.active = false;
+  g_dlr.network_topology = kDlrTopologyLinear;
+  g_dlr.network_status = kDlrStatusNormal;
+  memset(&g_dlr.active_supervisor_address, 0,
+         sizeof(g_dlr.active_supervisor_address) );
+}
+
+static void DlrRingNodeHandleBeacon(const struct eth_hdr *const ethernet_header,
+                                    const u8_t *const pdu) {
+  const u8_t precedence = pdu[DLR_OFFSET_PRECEDENCE];
+  const struct eth_addr *const source = &ethernet_header->src;
+  const bool same_supervisor = s_supervisor.active &&
+                               eth_addr_eq(source, &s_supervisor.mac_address);
+  if(s_supervisor.active && !same_supervisor) {
+    /* The higher precedence wins, on a tie the higher MAC address */
+    if(precedence < s_supervisor.precedence ||
+       (precedence == s_supervisor.precedence &&
+        0 > memcmp(source->addr, s_supervisor.mac_address.addr,
+                   ETH_HWADDR_LEN) ) ) {
+      return;
+    }
+  }
+
+  s_supervisor.last_beacon_us = esp_timer_get_time();
+  const u32_t beacon_timeout_us = DlrGetU32(pdu + DLR_OFFSET_BEACON_TIMEOUT);
+  s_supervisor.beacon_timeout_us =
+    (0 != beacon_timeout_us) ? beacon_timeout_us :
+    DLR_DEFAULT_BEACON_TIMEOUT_US;
+  if(!same_supervisor) {
+    s_supervisor.active = true;
+    s_supervisor.precedence = precedence;
+    SMEMCPY(&s_supervisor.mac_address, source, ETH_HWADDR_LEN);
+    g_dlr.active_supervisor_address.device_ip =
+      DlrGetU32(pdu + DLR_OFFSET_SOURCE_IP);
+    memcpy(g_dlr.active_supervisor_address.device_mac, source->addr,
+           ETH_HWADDR_LEN);
+    g_dlr.network_topology = kDlrTopologyRing;
+    OPENER_TRACE_INFO("DLR: supervisor %02x:%02x:%02x:%02x:%02x:%02x, "
+                      "precedence %u\n",
+                      source->addr[0], source->addr[1], source->addr[2],
+                      source->addr[3], source->addr[4], source->addr[5],
+                      precedence);
+  }
+
+  const CipUsint network_status =
+    (kDlrRingStateFault == pdu[DLR_OFFSET_RING_STATE]) ?
+    kDlrStatusRingFault : kDlrStatusNormal;
+  if(network_status != g_dlr.network_status) {
+    OPENER_TRACE_INFO("DLR: ring %s\n",
+                      kDlrStatusNormal == network_status ? "normal" : "fault");
+    g_dlr.network_status = network_status;
+  }
+  if(!s_timer_armed) {
+    DlrRingNodeArmTimer(s_supervisor.beacon_timeout_us);
+  }
+}
+
+/* Answered to the requester's MAC address on the receiving port */
+static void DlrRingNodeAnswerNeighborCheck(struct netif *const netif,
+                                           const struct eth_hdr *const
+                                           ethernet_header,
+                                           const u8_t *const pdu) {
+  const u16_t length = SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR + DLR_PDU_LENGTH;
+  struct pbuf *const frame = pbuf_alloc(PBUF_RAW, length, PBUF_RAM);
+  if(NULL == frame) {
+    return;
+  }
+  u8_t *const data = frame->payload;
+  memset(data, 0, length);
+  struct eth_hdr *const response_header = (struct eth_hdr *) data;
+  SMEMCPY(&response_header->dest, &ethernet_header->src, ETH_HWADDR_LEN);
+  SMEMCPY(&response_header->src, netif->hwaddr, ETH_HWADDR_LEN);
+  response_header->type = PP_HTONS(ETHTYPE_VLAN);
+  struct eth_vlan_hdr *const vlan_header =
+    (struct eth_vlan_hdr *) (data + SIZEOF_ETH_HDR);
+  vlan_header->prio_vid = PP_HTONS(DLR_VLAN_PRIORITY << 13);
+  vlan_header->tpid = PP_HTONS(DLR_ETHERTYPE);
+
+  u8_t *const response = data + SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR;
+  response[DLR_OFFSET_SUBTYPE] = DLR_RING_SUBTYPE;
+  response[DLR_OFFSET_VERSION] = DLR_PROTOCOL_VERSION;
+  response[DLR_OFFSET_FRAME_TYPE] = kDlrFrameNeighborCheckResponse;
+  response[DLR_OFFSET_SOURCE_PORT] = DLR_PORT;
+  const u32_t address = ip4_addr_get_u32(netif_ip4_addr(netif) );
+  memcpy(response + DLR_OFFSET_SOURCE_IP, &address, sizeof(address) );
+  memcpy(response + DLR_OFFSET_SEQUENCE_ID, pdu + DLR_OFFSET_SEQUENCE_ID, 4);
+  response[DLR_OFFSET_REQUEST_PORT] = pdu[DLR_OFFSET_SOURCE_PORT];
+
+  netif->linkoutput(netif, frame);
+  pbuf_free(frame);
+}
+
+err_t lwip_hook_unknown_eth_protocol(struct pbuf *p, struct netif *netif) {
+  const u8_t *const pdu = DlrRingNodeGetPdu(p);
+  if(NULL == pdu) {
+    return ERR_ARG;
+  }
+  const struct eth_hdr *const ethernet_header = p->payload;
+  switch(pdu[DLR_OFFSET_FRAME_TYPE]) {
+    case kDlrFrameBeacon:
+      DlrRingNodeHandleBeacon(ethernet_header, pdu);
+      break;
+    case kDlrFrameNeighborCheckRequest:
+      DlrRingNodeAnswerNeighborCheck(netif, ethernet_header, pdu);
+      break;
+    default:
+      /* Sign_On, Locate_Fault and Flush_Tables concern the ring ports and
+       * the MAC table of a switch, the board has neither */
+      break;
+  }
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+#endif /* CONFIG_OPENER_DLR_RING_NODE */
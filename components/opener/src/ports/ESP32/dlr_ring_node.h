@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_DLR_RING_NODE_H_
+#define OPENER_DLR_RING_NODE_H_
+
+/** @file dlr_ring_node.h
+ *  @brief DLR frame processing of a beacon-based ring node
+ *
+ *  Selected with CONFIG_OPENER_DLR_RING_NODE. DLR frames (Ethernet type
+ *  0x80E1, usually priority tagged) reach the node through lwIP's
+ *  LWIP_HOOK_UNKNOWN_ETH_PROTOCOL and are handled in the tcpip thread:
+ *
+ *  - Beacons select the active supervisor by precedence and MAC address and
+ *    set the Network Topology, Network Status and Active Supervisor Address
+ *    of the DLR object from the ring state they announce.
+ *  - A beacon timeout, taken from the supervisor's beacons, returns the node
+ *    to the idle state: linear topology, no supervisor.
+ *  - Neighbor_Check requests are answered on the receiving port.
+ *
+ *  The KC868-A16 has a single PHY and no switch, so it cannot be a member of
+ *  the ring itself. A ring node forwards every frame between its two ring
+ *  ports in hardware, blocks nothing and flushes its MAC table on
+ *  Flush_Tables; all of that takes an embedded three port switch with
+ *  DLR support in front of the EMAC. Until such hardware exists the board
+ *  is attached to a ring through a DLR tap, and this module reports the ring
+ *  state from the beacons that reach its port. Sign_On, Locate_Fault and
+ *  Flush_Tables frames need a second port and are ignored.
+ *
+ *  The DLR object is written by the tcpip thread only. Topology and status
+ *  are single octets; the supervisor address changes only when another
+ *  supervisor takes over.
+ */
+
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_DLR_RING_NODE
+
+#include "lwip/err.h"
+
+struct netif;
+struct pbuf;
+
+/** @brief True for a DLR frame, tagged or untagged
+ *
+ *  Used by the early input filter to keep DLR frames out of the broadcast
+ *  rate limit.
+ */
+bool DlrRingNodeIsFrame(const struct pbuf *const frame);
+
+/** @brief LWIP_HOOK_UNKNOWN_ETH_PROTOCOL of the DLR ring node
+ *
+ *  @param p received frame, starting with the Ethernet header
+ *  @param netif receiving interface
+ *  @return ERR_OK if the frame was a DLR frame and has been freed, else an
+ *  error and lwIP drops the frame
+ */
+err_t lwip_hook_unknown_eth_protocol(struct pbuf *p, struct netif *netif);
+
+#endif /* CONFIG_OPENER_DLR_RING_NODE */
+
+#endif /* OPENER_DLR_RING_NODE_H_ */
@@ -0,0 +1,294 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "eds_file.h"
+
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_EDS_FILE
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "endianconv.h"
+#include "opener_api.h"
+#include "trace.h"
+
+/** @brief File object specific services */
+enum {
+  kCipFileInitiateUpload = 0x4B,
+  kCipFileUploadTransfer = 0x4F,
+};
+
+/** @brief Values of the State attribute */
+enum {
+  kCipFileStateFileLoaded = 2,
+  kCipFileStateUploadInitiated = 3,
+  kCipFileStateUploadInProgress = 5,
+};
+
+/** @brief Transfer Packet Type of an Upload_Transfer reply */
+enum {
+  kCipFilePacketFirst = 0,
+  kCipFilePacketMiddle = 1,
+  kCipFilePacketLast = 2,
+  kCipFilePacketFirstAndLast = 4,
+};
+
+static const char kEdsFileInstanceName[] = "EDS and Icon Files";
+static const CipUint kEdsFileInstanceFormatVersion = 1;
+static const CipUsint kEdsFileAccessRuleReadOnly = 1;
+static const CipUsint kEdsFileEncodingCompressed = 1;
+
+/* The one upload, s_transfer_size is 0 unless one was initiated and not
+ * aborted */
+static CipUsint s_state = kCipFileStateFileLoaded;
+static CipUsint s_transfer_size;
+static CipUsint s_next_transfer_number; /**< wraps around */
+static CipUdint s_next_offset; /**< of the chunk of s_next_transfer_number */
+static bool s_has_previous; /**< a chunk was sent that may be repeated */
+static CipUdint s_previous_offset;
+
+/** @brief Encode a text as STRINGI with one English SHORT_STRING */
+static void EncodeEdsFileStringI(const char *const text,
+                                 ENIPMessage *const outgoing_message) {
+  const size_t length = strlen(text);
+  AddSintToMessage(1, outgoing_message); /* number of strings */
+  AddSintToMessage('e', outgoing_message);
+  AddSintToMessage('n', outgoing_message);
+  AddSintToMessage('g', outgoing_message);
+  AddSintToMessage(kCipShortString, outgoing_message);
+  AddIntToMessage(kCipStringICharSet_ISO_8859_1_1987, outgoing_message);
+  AddSintToMessage( (EipUint8) length, outgoing_message );
+  memcpy(outgoing_message->current_message_position, text, length);
+  outgoing_message->current_message_position += length;
+  outgoing_message->used_message_length += length;
+}
+
+static void EncodeEdsFileInstanceName(const void *const data,
+                                      ENIPMessage *const outgoing_message) {
+  EncodeEdsFileStringI( (const char *) data, outgoing_message );
+}
+
+static void EncodeEdsFileName(const void *const data,
+                              ENIPMessage *const outgoing_message) {
+  EncodeEdsFileStringI( ( (const EdsFileImage *) data )->name,
+                        outgoing_message );
+}
+
+static void EncodeEdsFileRevision(const void *const data,
+                                  ENIPMessage *const outgoing_message) {
+  const EdsFileImage *const image = (const EdsFileImage *) data;
+  AddSintToMessage(image->revision_major, outgoing_message);
+  AddSintToMessage(image->revision_minor, outgoing_message);
+}
+
+/** @brief Class attribute 32, the instance number and the names of each
+ *  instance */
+static void EncodeEdsFileDirectory(const void *const data,
+                                   ENIPMessage *const outgoing_message) {
+  (void) data;
+  AddIntToMessage(kCipFileEdsInstance, outgoing_message);
+  EncodeEdsFileStringI(kEdsFileInstanceName, outgoing_message);
+  EncodeEdsFileStringI(g_eds_file_image.name, outgoing_message);
+}
+
+static void GenerateEdsFileReplyHeader(
+  const CipMessageRouterRequest *const message_router_request,
+  CipMessageRouterResponse *const message_router_response) {
+  ClearENIPMessage(&message_router_response->message);
+  message_router_response->reply_service =
+    (0x80 | message_router_request->service);
+  message_router_response->size_of_additional_status = 0;
+}
+
+/** @brief Check a request with one USINT parameter, sets the general status
+ *  if it has another size */
+static bool GetEdsFileUsintParameter(
+  const CipMessageRouterRequest *const message_router_request,
+  CipMessageRouterResponse *const message_router_response,
+  CipUsint *const value) {
+  if(message_router_request->request_data_size < 1) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return false;
+  }
+  if(message_router_request->request_data_size > 1) {
+    message_router_response->general_status = kCipErrorTooMuchData;
+    return false;
+  }
+  *value = message_router_request->data[0];
+  return true;
+}
+
+static EipStatus EdsFileInitiateUpload(
+  CipInstance *const instance,
+  CipMessageRouterRequest *const message_router_request,
+  CipMessageRouterResponse *const message_router_response,
+  const struct sockaddr *originator_address,
+  const CipSessionHandle encapsulation_session) {
+  (void) instance;
+  (void) originator_address;
+  (void) encapsulation_session;
+
+  GenerateEdsFileReplyHeader(message_router_request, message_router_response);
+  CipUsint maximum_transfer_size = 0;
+  if( !GetEdsFileUsintParameter(message_router_request,
+                                message_router_response,
+                                &maximum_transfer_size) ) {
+    return kEipStatusOkSend;
+  }
+  if(0 == maximum_transfer_size) {
+    message_router_response->general_status = kCipErrorInvalidParameter;
+    return kEipStatusOkSend;
+  }
+
+  /* A new upload replaces one that did not finish. Chunks of up to 255
+   * bytes, the USINT maximum, fit the reply buffer */
+  s_transfer_size = maximum_transfer_size;
+  s_next_transfer_number = 0;
+  s_next_offset = 0;
+  s_has_previous = false;
+  s_state = kCipFileStateUploadInitiated;
+
+  AddDintToMessage(g_eds_file_image.size, &message_router_response->message);
+  AddSintToMessage(s_transfer_size, &message_router_response->message);
+  message_router_response->general_status = kCipErrorSuccess;
+  return kEipStatusOkSend;
+}
+
+static EipStatus EdsFileUploadTransfer(
+  CipInstance *const instance,
+  CipMessageRouterRequest *const message_router_request,
+  CipMessageRouterResponse *const message_router_response,
+  const struct sockaddr *originator_address,
+  const CipSessionHandle encapsulation_session) {
+  (void) instance;
+  (void) originator_address;
+  (void) encapsulation_session;
+
+  GenerateEdsFileReplyHeader(message_router_request, message_router_response);
+  CipUsint transfer_number = 0;
+  if( !GetEdsFileUsintParameter(message_router_request,
+                                message_router_response,
+                                &transfer_number) ) {
+    return kEipStatusOkSend;
+  }
+
+  const bool in_progress = (0 != s_transfer_size &&
+                            kCipFileStateFileLoaded != s_state);
+  bool repeat = false;
+  if(in_progress && transfer_number == s_next_transfer_number) {
+    repeat = false;
+  } else if(0 != s_transfer_size && s_has_previous &&
+            transfer_number == (CipUsint) (s_next_transfer_number - 1U) ) {
+    /* The reply to the previous one was lost, also after the last chunk */
+    repeat = true;
+  } else if(!in_progress) {
+    message_router_response->general_status = kCipErrorObjectStateConflict;
+    return kEipStatusOkSend;
+  } else {
+    OPENER_TRACE_WARN("EDS file: transfer %u out of sequence, upload aborted\n",
+                      (unsigned) transfer_number);
+    s_transfer_size = 0;
+    s_state = kCipFileStateFileLoaded;
+    message_router_response->general_status = kCipErrorInvalidParameter;
+    return kEipStatusOkSend;
+  }
+
+  const CipUdint offset = repeat ? s_previous_offset : s_next_offset;
+  CipUdint length = g_eds_file_image.size - offset;
+  if(length > s_transfer_size) {
+    length = s_transfer_size;
+  }
+  const bool first = (0 == offset);
+  const bool last = (offset + length == g_eds_file_image.size);
+  if(!repeat) {
+    s_has_previous = true;
+    s_previous_offset = offset;
+    s_next_offset = offset + length;
+    s_next_transfer_number++;
+    s_state = last ? kCipFileStateFileLoaded : kCipFileStateUploadInProgress;
+  }
+
+  ENIPMessage *const message = &message_router_response->message;
+  AddSintToMessage(transfer_number, message);
+  AddSintToMessage(first && last ? kCipFilePacketFirstAndLast :
+                   first ? kCipFilePacketFirst :
+                   last ? kCipFilePacketLast : kCipFilePacketMiddle,
+                   message);
+  memcpy(message->current_message_position, g_eds_file_image.data + offset,
+         length);
+  message->current_message_position += length;
+  message->used_message_length += length;
+  if(last) {
+    AddIntToMessage(g_eds_file_image.checksum, message);
+  }
+  message_router_response->general_status = kCipErrorSuccess;
+  return kEipStatusOkSend;
+}
+
+EipStatus EdsFileCreateCipObject(void) {
+  CipClass *file_class = NULL;
+
+  if( ( file_class = CreateCipClass(kCipFileClassCode,
+                                    1, /* # class attributes */
+                                    32, /* # highest class attribute number */
+                                    2, /* # class services */
+                                    9, /* # instance attributes */
+                                    11, /* # highest instance attribute number */
+                                    4, /* # instance services */
+                                    0, /* # instances */
+                                    "File",
+                                    1, /* # class revision */
+                                    NULL /* # function pointer for initialization */
+                                    ) ) == 0 ) {
+    OPENER_TRACE_ERR("EDS file: failed to create the CIP object\n");
+    return kEipStatusError;
+  }
+  InsertAttribute( (CipInstance *) file_class, 32, kCipAny,
+                   EncodeEdsFileDirectory, NULL, (void *) &g_eds_file_image,
+                   kGetableSingle );
+
+  CipInstance *const instance = AddCipInstance(file_class,
+                                               kCipFileEdsInstance);
+  InsertAttribute(instance, 1, kCipUsint, EncodeCipUsint, NULL,
+                  &s_state, kGetableSingleAndAll);
+  InsertAttribute(instance, 2, kCipAny, EncodeEdsFileInstanceName, NULL,
+                  (void *) kEdsFileInstanceName, kGetableSingleAndAll);
+  InsertAttribute(instance, 3, kCipUint, EncodeCipUint, NULL,
+                  (void *) &kEdsFileInstanceFormatVersion,
+                  kGetableSingleAndAll);
+  InsertAttribute(instance, 4, kCipAny, EncodeEdsFileName, NULL,
+                  (void *) &g_eds_file_image, kGetableSingleAndAll);
+  InsertAttribute(instance, 5, kCipAny, EncodeEdsFileRevision, NULL,
+                  (void *) &g_eds_file_image, kGetableSingleAndAll);
+  InsertAttribute(instance, 6, kCipUdint, EncodeCipUdint, NULL,
+                  (void *) &g_eds_file_image.size, kGetableSingleAndAll);
+  InsertAttribute(instance, 7, kCipInt, EncodeCipInt, NULL,
+                  (void *) &g_eds_file_image.checksum, kGetableSingleAndAll);
+  InsertAttribute(instance, 10, kCipUsint, EncodeCipUsint, NULL,
+                  (void *) &kEdsFileAccessRuleReadOnly, kGetableSingleAndAll);
+  InsertAttribute(instance, 11, kCipUsint, EncodeCipUsint, NULL,
+                  (void *) &kEdsFileEncodingCompressed, kGetableSingleAndAll);
+
+  InsertService(file_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(file_class, kGetAttributeAll, &GetAttributeAll,
+                "GetAttributeAll");
+  InsertService(file_class, kCipFileInitiateUpload, &EdsFileInitiateUpload,
+                "InitiateUpload");
+  InsertService(file_class, kCipFileUploadTransfer, &EdsFileUploadTransfer,
+                "UploadTransfer");
+
+  OPENER_TRACE_INFO("EDS file: %s, %u bytes compressed\n",
+                    g_eds_file_image.name,
+                    (unsigned) g_eds_file_image.size);
+  return kEipStatusOk;
+}
+
+#endif /* CONFIG_OPENER_EDS_FILE */
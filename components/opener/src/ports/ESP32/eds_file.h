@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_EDS_FILE_H_
+#define OPENER_EDS_FILE_H_
+
+/** @file eds_file.h
+ *  @brief The device's EDS, served by the CIP File object
+ *
+ *  Selected with CONFIG_OPENER_EDS_FILE. The build runs
+ *  scripts/generate_eds_assemblies.py --embed with the firmware's sdkconfig,
+ *  so the image is the EDS of exactly the assemblies and connection points
+ *  of this firmware, zlib compressed in flash.
+ *
+ *  File object (class 0x37) instance 0xC8 is the EDS file instance tools
+ *  look for. Its attributes describe the file, File Encoding Format 1 tells
+ *  the compression. Initiate_Upload agrees on the transfer size up to
+ *  255 bytes and Upload_Transfer returns the chunks by transfer number,
+ *  the last with the file checksum. Repeating the previous transfer number
+ *  returns the same chunk again, for a reply lost on the way. There is one
+ *  upload at a time, Initiate_Upload restarts it. GET /api/eds returns the
+ *  same image in one response.
+ */
+
+#include "typedefs.h"
+#include "ciptypes.h"
+
+/** @brief File object class code */
+static const CipUint kCipFileClassCode = 0x37U;
+
+/** @brief File object instance of the EDS file */
+static const CipInstanceNum kCipFileEdsInstance = 0xC8U;
+
+/** @brief The compressed EDS, generated into eds_file_data.c */
+typedef struct {
+  const char *name; /**< file name, e.g. "KC868A16.eds" */
+  const EipUint8 *data; /**< zlib stream */
+  CipUdint size; /**< bytes of data */
+  CipUdint uncompressed_size;
+  CipUint checksum; /**< two's complement of the 16-bit sum of data */
+  CipUsint revision_major; /**< Revision of the EDS's [File] section */
+  CipUsint revision_minor;
+} EdsFileImage;
+
+extern const EdsFileImage g_eds_file_image;
+
+/** @brief Create the File object with the EDS instance, called by the
+ *  application */
+EipStatus EdsFileCreateCipObject(void);
+
+#endif /* OPENER_EDS_FILE_H_ */
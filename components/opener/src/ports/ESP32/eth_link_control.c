@@ -0,0 +1,324 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "eth_link_control.h"
+
+#if CONFIG_OPENER_ETH_LINK_CONTROL
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "app_scheduler.h"
+#include "cipcommon.h"
+#include "cipethernetlink.h"
+#include "nvconfig.h"
+#include "opener_api.h"
+#include "production_scheduler.h"
+#include "esp_eth_com.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+
+/* The blob of earlier firmware, read once to fill the configuration record */
+#define ETH_LINK_CONTROL_NVS_NAMESPACE "ethlink"
+#define ETH_LINK_CONTROL_NVS_KEY "iface_ctrl"
+/* Layout of EthLinkControlBlob, a blob of another layout is not taken */
+#define ETH_LINK_CONTROL_NVS_VERSION 1U
+
+/* Lets the Set_Attribute_Single reply leave before the link goes down */
+#define ETH_LINK_CONTROL_APPLY_DELAY_MS 100U
+
+#define ETH_LINK_CONTROL_JOB_CORE 1
+#define ETH_LINK_CONTROL_JOB_PRIORITY 1
+#define ETH_LINK_CONTROL_JOB_STACK_SIZE 3072U
+
+/* Interface Flags, attribute 2: link active, full duplex, and the
+ * negotiation status in bits 2..4 */
+#define ETH_LINK_FLAGS_LINK_ACTIVE 0x01U
+#define ETH_LINK_FLAGS_FULL_DUPLEX 0x02U
+#define ETH_LINK_FLAGS_NEGOTIATED (3U << 2)
+#define ETH_LINK_FLAGS_FORCED (4U << 2)
+
+typedef struct {
+  uint8_t version;
+  uint8_t reserved;
+  uint16_t control_bits;
+  uint16_t forced_interface_speed;
+} EthLinkControlBlob;
+
+static const char *kTag = "eth_link";
+
+static esp_eth_handle_t s_handle = NULL;
+
+/* The setting in NVS and on the PHY, written by app_main before the stack
+ * runs and later only by the job */
+static CipEthernetLinkInterfaceControl s_applied = {
+  .control_bits = kEthLinkIfCntrlAutonegotiate,
+  .forced_interface_speed = 0U,
+};
+
+/* Handed from the stack callback to the job under s_control_lock */
+static CipEthernetLinkInterfaceControl s_requested;
+static bool s_pending = false;
+static portMUX_TYPE s_control_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool EthLinkControlIsAutonegotiate(
+  const CipEthernetLinkInterfaceControl *const control) {
+  return 0 != (control->control_bits & kEthLinkIfCntrlAutonegotiate);
+}
+
+static bool EthLinkControlIsFullDuplex(
+  const CipEthernetLinkInterfaceControl *const control) {
+  return 0 != (control->control_bits & kEthLinkIfCntrlForceDuplexFD);
+}
+
+/* The same rules DecodeCipEthernetLinkInterfaceControl() applies, for a
+ * blob written by another firmware */
+static bool EthLinkControlIsValid(
+  const CipEthernetLinkInterfaceControl *const control) {
+  if(control->control_bits > kEthLinkIfCntrlMaxValid) {
+    return false;
+  }
+  if(EthLinkControlIsAutonegotiate(control) ) {
+    return !EthLinkControlIsFullDuplex(control) &&
+           0 == control->forced_interface_speed;
+  }
+  return 10U == control->forced_interface_speed ||
+         100U == control->forced_interface_speed;
+}
+
+static bool EthLinkControlEqual(const CipEthernetLinkInterfaceControl *const a,
+                                const CipEthernetLinkInterfaceControl *const b)
+{
+  return a->control_bits == b->control_bits &&
+         a->forced_interface_speed == b->forced_interface_speed;
+}
+
+static bool EthLinkControlReadLegacy(NvConfigEthLink *const config) {
+  nvs_handle_t handle;
+  if(ESP_OK != nvs_open(ETH_LINK_CONTROL_NVS_NAMESPACE, NVS_READONLY,
+                        &handle) ) {
+    return false; /* never stored */
+  }
+  EthLinkControlBlob blob;
+  size_t size = sizeof(blob);
+  const esp_err_t err = nvs_get_blob(handle, ETH_LINK_CONTROL_NVS_KEY, &blob,
+                                     &size);
+  nvs_close(handle);
+  if(ESP_OK != err || sizeof(blob) != size ||
+     ETH_LINK_CONTROL_NVS_VERSION != blob.version) {
+    return false;
+  }
+  config->control_bits = blob.control_bits;
+  config->forced_interface_speed = blob.forced_interface_speed;
+  (void) NvConfigSet(kNvConfigSectionEthLink, config, sizeof(*config) );
+  (void) NvConfigCommitDeferred();
+  return true;
+}
+
+static void EthLinkControlLoad(void) {
+  NvConfigEthLink config;
+  if(!NvConfigGet(kNvConfigSectionEthLink, &config, sizeof(config) ) &&
+     !EthLinkControlReadLegacy(&config) ) {
+    return;
+  }
+  const CipEthernetLinkInterfaceControl control = {
+    .control_bits = config.control_bits,
+    .forced_interface_speed = config.forced_interface_speed,
+  };
+  if(!EthLinkControlIsValid(&control) ) {
+    ESP_LOGW(kTag, "Ignoring stored interface control 0x%04x, %u Mbit/s",
+             (unsigned) control.control_bits,
+             (unsigned) control.forced_interface_speed);
+    return;
+  }
+  s_applied = control;
+}
+
+/* Written behind by the writer of the configuration record */
+static EipStatus EthLinkControlStore(
+  const CipEthernetLinkInterfaceControl *const control) {
+  const NvConfigEthLink config = {
+    .control_bits = control->control_bits,
+    .forced_interface_speed = control->forced_interface_speed,
+  };
+  (void) NvConfigSet(kNvConfigSectionEthLink, &config, sizeof(config) );
+  return NvConfigCommitDeferred();
+}
+
+/* The driver has to be stopped */
+static esp_err_t EthLinkControlProgramPhy(
+  const CipEthernetLinkInterfaceControl *const control) {
+  bool autonegotiate = EthLinkControlIsAutonegotiate(control);
+  esp_err_t err = esp_eth_ioctl(s_handle, ETH_CMD_S_AUTONEGO, &autonegotiate);
+  if(ESP_OK != err || autonegotiate) {
+    return err;
+  }
+  eth_speed_t speed = 100U == control->forced_interface_speed ?
+                      ETH_SPEED_100M : ETH_SPEED_10M;
+  err = esp_eth_ioctl(s_handle, ETH_CMD_S_SPEED, &speed);
+  if(ESP_OK == err) {
+    eth_duplex_t duplex = EthLinkControlIsFullDuplex(control) ?
+                          ETH_DUPLEX_FULL : ETH_DUPLEX_HALF;
+    err = esp_eth_ioctl(s_handle, ETH_CMD_S_DUPLEX_MODE, &duplex);
+  }
+  return err;
+}
+
+/* Interface speed and flags of instance 1 for the setting in effect,
+ * caller holds the stack lock */
+static void EthLinkControlUpdateObject(void) {
+  CipEthernetLinkObject *const link = &g_ethernet_link[0];
+  link->interface_control = s_applied;
+  if(EthLinkControlIsAutonegotiate(&s_applied) ) {
+    link->interface_speed = 100U;
+    link->interface_flags = ETH_LINK_FLAGS_LINK_ACTIVE |
+                            ETH_LINK_FLAGS_FULL_DUPLEX |
+                            ETH_LINK_FLAGS_NEGOTIATED;
+  } else {
+    link->interface_speed = s_applied.forced_interface_speed;
+    link->interface_flags = ETH_LINK_FLAGS_LINK_ACTIVE |
+                            (EthLinkControlIsFullDuplex(&s_applied) ?
+                             ETH_LINK_FLAGS_FULL_DUPLEX : 0U) |
+                            ETH_LINK_FLAGS_FORCED;
+  }
+}
+
+static void EthLinkControlLog(const char *const what,
+                              const CipEthernetLinkInterfaceControl *const
+                              control) {
+  if(EthLinkControlIsAutonegotiate(control) ) {
+    ESP_LOGI(kTag, "%s: auto-negotiation", what);
+  } else {
+    ESP_LOGI(kTag, "%s: forced %u Mbit/s %s duplex", what,
+             (unsigned) control->forced_interface_speed,
+             EthLinkControlIsFullDuplex(control) ? "full" : "half");
+  }
+}
+
+void EthLinkControlInitialize(esp_eth_handle_t handle) {
+  s_handle = handle;
+  EthLinkControlLoad();
+  if(EthLinkControlIsAutonegotiate(&s_applied) ) {
+    return; /* the driver default */
+  }
+  const esp_err_t err = EthLinkControlProgramPhy(&s_applied);
+  if(ESP_OK != err) {
+    ESP_LOGW(kTag, "Programming the PHY failed (%s), auto-negotiating",
+             esp_err_to_name(err) );
+    s_applied.control_bits = kEthLinkIfCntrlAutonegotiate;
+    s_applied.forced_interface_speed = 0U;
+    return;
+  }
+  EthLinkControlLog("Boot", &s_applied);
+}
+
+static void EthLinkControlJob(void *argument, uint32_t events) {
+  (void) argument;
+  (void) events;
+  taskENTER_CRITICAL(&s_control_lock);
+  const bool pending = s_pending;
+  taskEXIT_CRITICAL(&s_control_lock);
+  if(!pending) {
+    return; /* a request for another job */
+  }
+  vTaskDelay(pdMS_TO_TICKS(ETH_LINK_CONTROL_APPLY_DELAY_MS) );
+
+  /* A second Set during the delay is taken here as well */
+  taskENTER_CRITICAL(&s_control_lock);
+  const CipEthernetLinkInterfaceControl requested = s_requested;
+  s_pending = false;
+  taskEXIT_CRITICAL(&s_control_lock);
+  if(EthLinkControlEqual(&requested, &s_applied) ) {
+    return;
+  }
+
+  if(kEipStatusOk != EthLinkControlStore(&requested) ) {
+    ESP_LOGE(kTag, "Storing the interface control failed");
+  }
+  if(NULL != s_handle) {
+    esp_err_t err = esp_eth_stop(s_handle);
+    if(ESP_OK == err) {
+      err = EthLinkControlProgramPhy(&requested);
+      if(ESP_OK != err) {
+        /* Back to what the PHY had, the driver starts in any case */
+        (void) EthLinkControlProgramPhy(&s_applied);
+      }
+      const esp_err_t start_err = esp_eth_start(s_handle);
+      if(ESP_OK != start_err) {
+        ESP_LOGE(kTag, "Restarting the Ethernet driver failed (%s)",
+                 esp_err_to_name(start_err) );
+      }
+    }
+    if(ESP_OK != err) {
+      ESP_LOGE(kTag, "Applying the interface control failed (%s), "
+               "effective at the next boot", esp_err_to_name(err) );
+      ProductionSchedulerLock();
+      EthLinkControlUpdateObject();
+      ProductionSchedulerUnlock();
+      return;
+    }
+  }
+  s_applied = requested;
+  ProductionSchedulerLock();
+  EthLinkControlUpdateObject();
+  ProductionSchedulerUnlock();
+  EthLinkControlLog("Applied", &s_applied);
+}
+
+static EipStatus EthLinkControlSetCallback(CipInstance *const instance,
+                                           const CipAttributeStruct *const
+                                           attribute,
+                                           CipByte service) {
+  /* Same workaround as NvTcpipSetCallback(): skip flagged services */
+  if(1 != instance->instance_number || 6 != attribute->attribute_number ||
+     0 != (0x80 & service) ) {
+    return kEipStatusOk;
+  }
+  taskENTER_CRITICAL(&s_control_lock);
+  s_requested = g_ethernet_link[0].interface_control;
+  s_pending = true;
+  taskEXIT_CRITICAL(&s_control_lock);
+  AppSchedulerSignal(kAppSchedulerEventRequest);
+  return kEipStatusOk;
+}
+
+EipStatus EthLinkControlBind(void) {
+  CipClass *const ethernet_link_class =
+    GetCipClass(kCipEthernetLinkClassCode);
+  if(NULL == ethernet_link_class) {
+    return kEipStatusError;
+  }
+  CipEthernetLinkObject *const link = &g_ethernet_link[0];
+  link->interface_caps.capability_bits = kEthLinkCapAutoNeg |
+                                         kEthLinkCapManualSpeed;
+  link->interface_caps.speed_duplex_selector = kEthLinkSpeedDpx_10_HD |
+                                               kEthLinkSpeedDpx_10_FD |
+                                               kEthLinkSpeedDpx_100_HD |
+                                               kEthLinkSpeedDpx_100_FD;
+  EthLinkControlUpdateObject();
+
+  const AppSchedulerJobConfig config = {
+    .name = "eth_link",
+    .function = EthLinkControlJob,
+    .argument = NULL,
+    .period_ms = 0,
+    .events = kAppSchedulerEventRequest,
+    .core = ETH_LINK_CONTROL_JOB_CORE,
+    .priority = ETH_LINK_CONTROL_JOB_PRIORITY,
+    .stack_size = ETH_LINK_CONTROL_JOB_STACK_SIZE,
+  };
+  if(kEipStatusOk != AppSchedulerRegister(&config) ) {
+    ESP_LOGE(kTag, "No job to apply interface control changes");
+    return kEipStatusError;
+  }
+  InsertGetSetCallback(ethernet_link_class, EthLinkControlSetCallback,
+                       kNvDataFunc);
+  return kEipStatusOk;
+}
+
+#endif /* CONFIG_OPENER_ETH_LINK_CONTROL */
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_ETH_LINK_CONTROL_H_
+#define OPENER_ETH_LINK_CONTROL_H_
+
+/** @file eth_link_control.h
+ *  @brief Interface Control of the Ethernet Link object applied to the PHY
+ *
+ *  Selected with CONFIG_OPENER_ETH_LINK_CONTROL, which makes attribute 6 of
+ *  the Ethernet Link object settable. The setting is kept in the
+ *  configuration record, see nvconfig.h. At boot it is given to the LAN8720
+ *  while the driver is still stopped, so a link forced to a speed and
+ *  duplex comes up without the auto-negotiation.
+ *
+ *  A Set_Attribute_Single of attribute 6 is stored and applied by a job of
+ *  the application scheduler, after the reply went out: the ESP-IDF driver
+ *  takes speed, duplex and auto-negotiation only while it is stopped, so
+ *  the driver is stopped, the PHY programmed and the driver started again.
+ *  The link goes down once, as for a cable pulled.
+ *
+ *  A forced link needs its partner forced the same way. A partner left in
+ *  auto-negotiation detects the speed but falls back to half duplex.
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_ETH_LINK_CONTROL
+
+#include "esp_eth_driver.h"
+#include "typedefs.h"
+
+/** @brief Load the stored setting and give it to the PHY
+ *
+ *  Called by app_main after esp_eth_driver_install() and before
+ *  esp_eth_start(). Without a stored setting the PHY auto-negotiates as
+ *  before.
+ *
+ *  @param handle installed, not yet started Ethernet driver
+ */
+void EthLinkControlInitialize(esp_eth_handle_t handle);
+
+/** @brief Hand the setting to the Ethernet Link object and watch its changes
+ *
+ *  Called once after CipStackInit(). Sets the interface capability to
+ *  auto-negotiation and forced 10 and 100 Mbit/s at half and full duplex.
+ *
+ *  @return kEipStatusError if the Ethernet Link class or the job is missing
+ */
+EipStatus EthLinkControlBind(void);
+
+#endif /* CONFIG_OPENER_ETH_LINK_CONTROL */
+
+#endif /* OPENER_ETH_LINK_CONTROL_H_ */
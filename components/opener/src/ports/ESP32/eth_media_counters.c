@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "eth_media_counters.h"
+
+#if CONFIG_OPENER_ETH_MEDIA_COUNTERS
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "generic_networkhandler.h"
+#include "esp_eth_com.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "soc/soc.h"
+
+/* DMAMISSEDFR, cleared when read. Bits 15..0 count frames missed for lack
+ * of a receive descriptor, bits 27..17 frames lost to a FIFO overflow. Bit
+ * 16 and 28 flag a counter that wrapped since the last read. */
+#define ETH_MEDIA_DMA_MISSED_FRAME_REG (DR_REG_EMAC_BASE + 0x0020U)
+#define ETH_MEDIA_MISSED_FRAMES(value) ( (value) & 0xFFFFU)
+#define ETH_MEDIA_MISSED_FRAMES_WRAPPED(value) ( ( (value) >> 16) & 0x1U)
+#define ETH_MEDIA_FIFO_OVERFLOWS(value) ( ( (value) >> 17) & 0x7FFU)
+#define ETH_MEDIA_FIFO_OVERFLOWS_WRAPPED(value) ( ( (value) >> 28) & 0x1U)
+
+/* LAN8720 Symbol Error Counter Register, counts each packet with an invalid
+ * code symbol once. Not cleared by reading, it rolls over at 16 bits. */
+#define ETH_MEDIA_LAN8720_SECR 26U
+
+static const char *kTag = "eth_media";
+
+/* Written by the esp_timer task, read and cleared by the OpENer task and the
+ * web UI, all under s_media_lock */
+static EthMediaCounters s_counters;
+static portMUX_TYPE s_media_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Only used by the esp_timer task */
+static esp_eth_handle_t s_eth_handle = NULL;
+static esp_timer_handle_t s_media_timer = NULL;
+static uint32_t s_last_symbol_errors = 0;
+static bool s_symbol_errors_valid = false;
+
+static bool EthMediaReadSymbolErrors(uint32_t *const value) {
+  esp_eth_phy_reg_rw_data_t request = {
+    .reg_addr = ETH_MEDIA_LAN8720_SECR,
+    .reg_value_p = value,
+  };
+  return ESP_OK == esp_eth_ioctl(s_eth_handle, ETH_CMD_READ_PHY_REG, &request);
+}
+
+static void EthMediaTimerCallback(void *argument) {
+  (void) argument;
+
+  const uint32_t dma = REG_READ(ETH_MEDIA_DMA_MISSED_FRAME_REG);
+  uint32_t missed = ETH_MEDIA_MISSED_FRAMES(dma);
+  if(ETH_MEDIA_MISSED_FRAMES_WRAPPED(dma) ) {
+    missed += 0x10000U;
+  }
+  uint32_t overflows = ETH_MEDIA_FIFO_OVERFLOWS(dma);
+  if(ETH_MEDIA_FIFO_OVERFLOWS_WRAPPED(dma) ) {
+    overflows += 0x800U;
+  }
+
+  uint32_t symbol_errors = 0;
+  uint32_t new_symbol_errors = 0;
+  const bool read_ok = EthMediaReadSymbolErrors(&symbol_errors);
+  if(read_ok) {
+    symbol_errors &= 0xFFFFU;
+    if(s_symbol_errors_valid) {
+      new_symbol_errors = (symbol_errors - s_last_symbol_errors) & 0xFFFFU;
+    }
+    s_last_symbol_errors = symbol_errors;
+    s_symbol_errors_valid = true;
+  }
+
+  if(0 != missed) {
+    NetworkHandlerDiscardedIoMessages(kNetworkDropNoReceiveBuffer, missed);
+  }
+
+  bool new_peak = false;
+  taskENTER_CRITICAL(&s_media_lock);
+  s_counters.fifo_overflows += overflows;
+  s_counters.symbol_errors += new_symbol_errors;
+  if(!read_ok) {
+    s_counters.mdio_errors++;
+  }
+  if(0 != missed) {
+    s_counters.overrun_samples++;
+    if(missed > s_counters.overrun_peak) {
+      s_counters.overrun_peak = missed;
+      new_peak = true;
+    }
+  }
+  taskEXIT_CRITICAL(&s_media_lock);
+
+  if(new_peak) {
+    ESP_LOGW(kTag,
+             "%" PRIu32 " frames missed in %d ms, all %d DMA receive buffers "
+             "were in use", missed, CONFIG_OPENER_ETH_MEDIA_COUNTERS_PERIOD_MS,
+             CONFIG_ETH_DMA_RX_BUFFER_NUM);
+  }
+}
+
+void EthMediaCountersInitialize(esp_eth_handle_t handle) {
+  if(NULL != s_media_timer || NULL == handle) {
+    return;
+  }
+  s_eth_handle = handle;
+
+  /* Drop what the counters collected before the driver was up */
+  (void) REG_READ(ETH_MEDIA_DMA_MISSED_FRAME_REG);
+
+  const esp_timer_create_args_t timer_args = {
+    .callback = EthMediaTimerCallback,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "eth_media",
+  };
+  if(ESP_OK != esp_timer_create(&timer_args, &s_media_timer) ) {
+    ESP_LOGE(kTag, "Failed to create the sampling timer");
+    s_media_timer = NULL;
+    return;
+  }
+  if(ESP_OK !=
+     esp_timer_start_periodic(s_media_timer,
+                              (uint64_t) CONFIG_OPENER_ETH_MEDIA_COUNTERS_PERIOD_MS *
+                              1000U) ) {
+    ESP_LOGE(kTag, "Failed to start the sampling timer");
+  }
+}
+
+void EthMediaCountersGet(EthMediaCounters *const counters) {
+  taskENTER_CRITICAL(&s_media_lock);
+  *counters = s_counters;
+  taskEXIT_CRITICAL(&s_media_lock);
+}
+
+void EthMediaCountersGetAndClear(EthMediaCounters *const counters) {
+  taskENTER_CRITICAL(&s_media_lock);
+  *counters = s_counters;
+  memset(&s_counters, 0, sizeof(s_counters) );
+  taskEXIT_CRITICAL(&s_media_lock);
+}
+
+#endif /* CONFIG_OPENER_ETH_MEDIA_COUNTERS */
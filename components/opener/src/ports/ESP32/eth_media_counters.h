@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_ETH_MEDIA_COUNTERS_H_
+#define OPENER_ETH_MEDIA_COUNTERS_H_
+
+/** @file eth_media_counters.h
+ *  @brief Receive errors of the ESP32 EMAC and the LAN8720 PHY
+ *
+ *  Selected with CONFIG_OPENER_ETH_MEDIA_COUNTERS. An esp_timer reads the
+ *  EMAC DMA missed frame register and the LAN8720 symbol error counter over
+ *  MDIO and accumulates them. The ESP-IDF driver polls the PHY link from the
+ *  esp_timer task as well, so both never use the MDIO bus at the same time.
+ *
+ *  The ESP32 EMAC has no MMC statistics block. Frames failing the FCS or
+ *  alignment check are dropped by the MAC without being counted, and the
+ *  link always runs full duplex, so there are no collisions to count. What
+ *  is left are the frames lost to receive errors on the wire, to a full
+ *  receive FIFO and to missing DMA descriptors, i.e. more frames arriving
+ *  than CONFIG_ETH_DMA_RX_BUFFER_NUM buffers can hold.
+ *
+ *  Symbol errors and FIFO overflows are reported in the MAC Receive Errors
+ *  media counter of the Ethernet Link object (attribute 5). Missed frames
+ *  are passed to the network handler as kNetworkDropNoReceiveBuffer and
+ *  end up in the In Discards interface counter (attribute 4).
+ *  GET /api/diagnostics/network shows both.
+ *
+ *  Missed frames are also watched as a burst detector: the sample periods
+ *  with losses and the most frames lost in one period are kept, and each
+ *  new peak is logged. A peak that keeps rising under the normal scanner
+ *  load means the receive ring is too short for the bursts it sees.
+ */
+
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_ETH_MEDIA_COUNTERS
+
+#include "esp_eth_driver.h"
+
+/** @brief Accumulated receive errors since boot or the last clear */
+typedef struct {
+  CipUdint symbol_errors; /**< packets received with a PHY symbol error */
+  CipUdint fifo_overflows; /**< frames lost to a full EMAC receive FIFO */
+  CipUdint mdio_errors; /**< PHY reads that failed, their sample is skipped */
+  CipUdint overrun_samples; /**< sample periods in which frames were missed */
+  CipUdint overrun_peak; /**< most frames missed in one sample period */
+} EthMediaCounters;
+
+/** @brief Start sampling, safe to call more than once
+ *
+ *  @param handle installed Ethernet driver. The DMA registers are only
+ *         read once the driver is installed, its clock is running then.
+ */
+void EthMediaCountersInitialize(esp_eth_handle_t handle);
+
+/** @brief Copy the accumulated counters */
+void EthMediaCountersGet(EthMediaCounters *const counters);
+
+/** @brief Copy the accumulated counters and reset them in one step */
+void EthMediaCountersGetAndClear(EthMediaCounters *const counters);
+
+#endif /* CONFIG_OPENER_ETH_MEDIA_COUNTERS */
+
+#endif /* OPENER_ETH_MEDIA_COUNTERS_H_ */
@@ -0,0 +1,192 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "eth_rx_moderation.h"
+
+#if CONFIG_OPENER_ETH_RX_MODERATION
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_eth_com.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/esp_pbuf_ref.h"
+#include "soc/soc.h"
+
+/* DMARXBASEADDR, the first descriptor of the receive ring the driver set
+ * up, and DMARINTWDTIMER, bits 7..0 the receive interrupt watchdog in
+ * units of 256 APB clock cycles, 0 disables it */
+#define ETH_RX_MODERATION_DMA_RX_BASE_REG (DR_REG_EMAC_BASE + 0x000CU)
+#define ETH_RX_MODERATION_DMA_WATCHDOG_REG (DR_REG_EMAC_BASE + 0x0024U)
+#define ETH_RX_MODERATION_WATCHDOG_MAX_UNITS 255U
+
+/* Receive descriptor words: RDES1 bit 31 Disable Interrupt on Completion,
+ * RDES3 the next descriptor of the chained ring. The DMA only writes back
+ * RDES0 and the extended status, RDES1 keeps what is set here. */
+#define ETH_RX_MODERATION_RDES1 1U
+#define ETH_RX_MODERATION_RDES3 3U
+#define ETH_RX_MODERATION_RDES1_DIC (1UL << 31)
+
+static const char *kTag = "eth_rx_moderation";
+
+/* Changed by the esp_timer task and the event loop task, read by the web
+ * UI, all under s_moderation_lock */
+static EthRxModerationStatistics s_statistics;
+static portMUX_TYPE s_moderation_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_eth_handle_t s_eth_handle = NULL;
+
+#if CONFIG_OPENER_ETH_RX_MODERATION_ADAPTIVE
+/* Only used by the esp_timer task */
+static esp_timer_handle_t s_rate_timer = NULL;
+static uint32_t s_last_frames = 0;
+#endif
+
+static CipUdint EthRxModerationWatchdogUnits(void) {
+  const uint64_t cycles = (uint64_t) CONFIG_OPENER_ETH_RX_MODERATION_TIMEOUT_US *
+                          (APB_CLK_FREQ / 1000000U);
+  CipUdint units = (CipUdint) ( (cycles + 255U) / 256U );
+  if(units > ETH_RX_MODERATION_WATCHDOG_MAX_UNITS) {
+    units = ETH_RX_MODERATION_WATCHDOG_MAX_UNITS;
+  }
+  return 0 == units ? 1U : units;
+}
+
+/* Mark all descriptors but every CONFIG_OPENER_ETH_RX_MODERATION_FRAMES th
+ * one, or none, with s_moderation_lock held */
+static void EthRxModerationMarkDescriptors(const bool moderate) {
+  volatile uint32_t *descriptor =
+    (volatile uint32_t *) (uintptr_t) REG_READ(
+      ETH_RX_MODERATION_DMA_RX_BASE_REG);
+  for(size_t i = 0; i < CONFIG_ETH_DMA_RX_BUFFER_NUM && NULL != descriptor;
+      ++i) {
+    if(moderate && 0 != (i + 1U) % CONFIG_OPENER_ETH_RX_MODERATION_FRAMES) {
+      descriptor[ETH_RX_MODERATION_RDES1] |= ETH_RX_MODERATION_RDES1_DIC;
+    } else {
+      descriptor[ETH_RX_MODERATION_RDES1] &= ~ETH_RX_MODERATION_RDES1_DIC;
+    }
+    descriptor = (volatile uint32_t *) (uintptr_t)
+                 descriptor[ETH_RX_MODERATION_RDES3];
+  }
+}
+
+static void EthRxModerationApply(const bool moderate) {
+  taskENTER_CRITICAL(&s_moderation_lock);
+  if(moderate) {
+    /* Armed before the first marked descriptor can complete. It stays set
+     * when moderation is turned off, so a frame marked until then still
+     * gets its interrupt */
+    REG_WRITE(ETH_RX_MODERATION_DMA_WATCHDOG_REG, s_statistics.watchdog_units);
+    if(!s_statistics.active) {
+      s_statistics.activations++;
+    }
+  }
+  EthRxModerationMarkDescriptors(moderate);
+  s_statistics.active = moderate;
+  taskEXIT_CRITICAL(&s_moderation_lock);
+}
+
+static void EthRxModerationEventHandler(void *argument,
+                                        esp_event_base_t event_base,
+                                        int32_t event_id,
+                                        void *event_data) {
+  (void) argument;
+  (void) event_base;
+  (void) event_id;
+  if(s_eth_handle != *(esp_eth_handle_t *) event_data) {
+    return;
+  }
+  /* The start reset the DMA and the descriptors */
+  taskENTER_CRITICAL(&s_moderation_lock);
+  const bool active = s_statistics.active;
+  taskEXIT_CRITICAL(&s_moderation_lock);
+  EthRxModerationApply(active);
+}
+
+#if CONFIG_OPENER_ETH_RX_MODERATION_ADAPTIVE
+static uint32_t EthRxModerationReceivedFrames(void) {
+  esp_pbuf_stats_t pbufs;
+  esp_pbuf_get_stats(&pbufs);
+  return pbufs.pooled + pbufs.allocated;
+}
+
+static void EthRxModerationTimerCallback(void *argument) {
+  (void) argument;
+
+  const uint32_t frames = EthRxModerationReceivedFrames();
+  const CipUdint rate =
+    (CipUdint) ( (uint64_t) (frames - s_last_frames) * 1000U /
+                 CONFIG_OPENER_ETH_RX_MODERATION_PERIOD_MS );
+  s_last_frames = frames;
+
+  taskENTER_CRITICAL(&s_moderation_lock);
+  s_statistics.frame_rate = rate;
+  const bool active = s_statistics.active;
+  taskEXIT_CRITICAL(&s_moderation_lock);
+
+  /* Half the rate as hysteresis, a load around the threshold does not
+   * switch every period */
+  if(!active && rate >= CONFIG_OPENER_ETH_RX_MODERATION_RATE) {
+    EthRxModerationApply(true);
+    ESP_LOGD(kTag, "On at %u frames/s", (unsigned) rate);
+  } else if(active && rate < CONFIG_OPENER_ETH_RX_MODERATION_RATE / 2U) {
+    EthRxModerationApply(false);
+    ESP_LOGD(kTag, "Off at %u frames/s", (unsigned) rate);
+  }
+}
+#endif
+
+void EthRxModerationInitialize(esp_eth_handle_t handle) {
+  if(NULL != s_eth_handle || NULL == handle) {
+    return;
+  }
+  s_eth_handle = handle;
+
+  taskENTER_CRITICAL(&s_moderation_lock);
+  s_statistics.watchdog_units = EthRxModerationWatchdogUnits();
+  taskEXIT_CRITICAL(&s_moderation_lock);
+
+  if(ESP_OK != esp_event_handler_register(ETH_EVENT, ETHERNET_EVENT_START,
+                                          EthRxModerationEventHandler,
+                                          NULL) ) {
+    ESP_LOGE(kTag, "Failed to register the start event handler");
+  }
+
+#if CONFIG_OPENER_ETH_RX_MODERATION_ADAPTIVE
+  /* Starts off, the first periods at the rate turn it on */
+  s_last_frames = EthRxModerationReceivedFrames();
+  const esp_timer_create_args_t timer_args = {
+    .callback = EthRxModerationTimerCallback,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "eth_rx_moderation",
+  };
+  if(ESP_OK != esp_timer_create(&timer_args, &s_rate_timer) ) {
+    ESP_LOGE(kTag, "Failed to create the rate timer, moderation stays off");
+    s_rate_timer = NULL;
+    return;
+  }
+  if(ESP_OK !=
+     esp_timer_start_periodic(s_rate_timer,
+                              (uint64_t) CONFIG_OPENER_ETH_RX_MODERATION_PERIOD_MS *
+                              1000U) ) {
+    ESP_LOGE(kTag, "Failed to start the rate timer, moderation stays off");
+  }
+#else
+  EthRxModerationApply(true);
+#endif
+}
+
+void EthRxModerationGetStatistics(EthRxModerationStatistics *const statistics)
+{
+  taskENTER_CRITICAL(&s_moderation_lock);
+  *statistics = s_statistics;
+  taskEXIT_CRITICAL(&s_moderation_lock);
+}
+
+#endif /* CONFIG_OPENER_ETH_RX_MODERATION */
@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_ETH_RX_MODERATION_H_
+#define OPENER_ETH_RX_MODERATION_H_
+
+/** @file eth_rx_moderation.h
+ *  @brief Receive interrupt moderation of the ESP32 EMAC
+ *
+ *  Selected with CONFIG_OPENER_ETH_RX_MODERATION. Without it every received
+ *  frame raises the EMAC receive interrupt, and every interrupt wakes the
+ *  Ethernet receive task of the ESP-IDF driver. The task already takes all
+ *  frames the DMA has completed per wake-up, but under a load of small
+ *  Class 1 frames it rarely finds more than one.
+ *
+ *  While moderation is on, the receive descriptors are marked Disable
+ *  Interrupt on Completion, all but every
+ *  CONFIG_OPENER_ETH_RX_MODERATION_FRAMES th one of the ring. A frame in a
+ *  marked descriptor starts the DMA receive interrupt watchdog instead,
+ *  which raises the interrupt after CONFIG_OPENER_ETH_RX_MODERATION_TIMEOUT_US
+ *  unless an unmarked descriptor did so first. The receive task then takes
+ *  the whole batch in one wake-up; no frame waits longer than the watchdog.
+ *
+ *  With CONFIG_OPENER_ETH_RX_MODERATION_ADAPTIVE an esp_timer counts the
+ *  frames handed to lwIP, see esp_pbuf_get_stats(), and turns moderation
+ *  on from CONFIG_OPENER_ETH_RX_MODERATION_RATE frames per second and off
+ *  again below half of it, so single frames at low rates are not delayed.
+ *  Without it moderation is on whenever the driver runs.
+ *
+ *  The driver clears the descriptors at every start, so they are marked
+ *  again on ETHERNET_EVENT_START. The watchdog counts in units of 256 APB
+ *  clock cycles, the driver holds the APB frequency at its maximum while
+ *  it runs.
+ */
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_ETH_RX_MODERATION
+
+#include "esp_eth_driver.h"
+
+/** @brief State of the moderation and its changes since boot */
+typedef struct {
+  bool active; /**< descriptors are marked now */
+  CipUdint frame_rate; /**< frames per second in the last period, adaptive only */
+  CipUdint activations; /**< times moderation was turned on */
+  CipUdint watchdog_units; /**< programmed watchdog, 256 APB cycles each */
+} EthRxModerationStatistics;
+
+/** @brief Moderate as configured from now on, safe to call more than once
+ *
+ *  @param handle installed Ethernet driver. The DMA registers are only
+ *         written once the driver is installed, its clock is running then.
+ */
+void EthRxModerationInitialize(esp_eth_handle_t handle);
+
+/** @brief Copy the state, may be called from any task */
+void EthRxModerationGetStatistics(EthRxModerationStatistics *const statistics);
+
+#endif /* CONFIG_OPENER_ETH_RX_MODERATION */
+
+#endif /* OPENER_ETH_RX_MODERATION_H_ */
@@ -0,0 +1,532 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "io_endpoint.h"
+
+#if OPENER_IO_EVENT_BACKEND
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "dlr_ring_node.h"
+#include "generic_networkhandler.h"
+#include "io_l2tap.h"
+#include "multicast_filter.h"
+#include "production_scheduler.h"
+#include "trace.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/priv/tcpip_priv.h"
+
+#if CONFIG_OPENER_IO_EARLY_DEMUX
+#include "esp_timer.h"
+#include "lwip/esp_netif_net_stack.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/stats.h"
+#include "lwip/prot/etharp.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+#endif
+
+typedef struct {
+  struct pbuf *datagram;
+  ip_addr_t source_address;
+  u16_t source_port;
+} IoEndpointReceivedDatagram;
+
+typedef struct {
+  struct tcpip_api_call_data call; /* has to be the first member */
+  ip_addr_t address;
+  u16_t port;
+  u8_t tos;
+  const CipOctet *header;
+  size_t header_length;
+  const CipOctet *payload;
+  size_t payload_length;
+} IoEndpointSendRequest;
+
+static struct udp_pcb *s_io_pcb = NULL;
+static QueueHandle_t s_received_queue = NULL;
+/* Written by the tcpip thread and, with the early demultiplexer, by the
+ * Ethernet receive task */
+static volatile uint32_t s_dropped_datagrams = 0;
+static volatile uint32_t s_queue_peak = 0;
+/* Only written by the tcpip thread */
+static volatile uint32_t s_arp_queued = 0;
+
+/* Kept for the pcb when it is (re)opened */
+static u8_t s_multicast_ttl = 1;
+static ip4_addr_t s_multicast_interface;
+
+/* Reused for every produced frame, only touched in the tcpip thread. Sends
+ * are serialized by the stack lock and complete before tcpip_api_call()
+ * returns, so one frame serves all producing connections. */
+static struct pbuf *s_transmit_frame = NULL;
+static void *s_transmit_frame_payload = NULL;
+
+/* Hands a datagram, positioned at the UDP payload, to the producer task */
+static void IoEndpointQueueDatagram(struct pbuf *datagram,
+                                    const ip_addr_t *address,
+                                    u16_t port) {
+  IoEndpointReceivedDatagram received = {
+    .datagram = datagram,
+    .source_port = port,
+  };
+  ip_addr_copy(received.source_address, *address);
+
+  if(pdTRUE != xQueueSend(s_received_queue, &received, 0) ) {
+    /* a newer datagram supersedes the oldest queued one, so a burst costs
+     * stale data instead of the latest value of a connection */
+    IoEndpointReceivedDatagram oldest;
+    if(pdTRUE == xQueueReceive(s_received_queue, &oldest, 0) ) {
+      pbuf_free(oldest.datagram);
+      __atomic_fetch_add(&s_dropped_datagrams, 1, __ATOMIC_RELAXED);
+    }
+    if(pdTRUE != xQueueSend(s_received_queue, &received, 0) ) {
+      pbuf_free(datagram);
+      __atomic_fetch_add(&s_dropped_datagrams, 1, __ATOMIC_RELAXED);
+      return;
+    }
+  }
+  /* two writers may race here, the peak is only a hint for sizing */
+  const uint32_t waiting = uxQueueMessagesWaiting(s_received_queue);
+  if(waiting > s_queue_peak) {
+    s_queue_peak = waiting;
+  }
+  ProductionSchedulerNotifyIoEvent();
+}
+
+/* Runs in the tcpip thread */
+static void IoEndpointReceive(void *argument,
+                              struct udp_pcb *pcb,
+                              struct pbuf *datagram,
+                              const ip_addr_t *address,
+                              u16_t port) {
+  (void) argument;
+  (void) pcb;
+  IoEndpointQueueDatagram(datagram, address, port);
+}
+
+#if CONFIG_OPENER_IO_EARLY_DEMUX
+
+/* Broadcast and multicast frames are counted per window of this length */
+#define IO_ENDPOINT_BROADCAST_WINDOW_US 10000
+#define IO_ENDPOINT_BROADCASTS_PER_WINDOW \
+  ( (CONFIG_OPENER_BROADCAST_RATE_LIMIT + 99) / 100)
+
+/* Only written by the Ethernet receive task */
+static volatile uint32_t s_early_datagrams = 0;
+static volatile uint32_t s_dropped_broadcasts = 0;
+static int64_t s_broadcast_window = 0;
+static uint32_t s_broadcasts_in_window = 0;
+
+/* Takes over a unicast UDP frame to port 2222 of this host. Fragments,
+ * IP options and everything else is left to lwIP. */
+static bool IoEndpointTakeIoFrame(struct netif *netif, struct pbuf *frame) {
+  if(frame->len != frame->tot_len ||
+     frame->len < SIZEOF_ETH_HDR + IP_HLEN + UDP_HLEN) {
+    return false;
+  }
+  const struct ip_hdr *ip_header =
+    (const struct ip_hdr *) ( (const u8_t *) frame->payload + SIZEOF_ETH_HDR);
+  if(4 != IPH_V(ip_header) || IP_HLEN != IPH_HL_BYTES(ip_header) ||
+     IP_PROTO_UDP != IPH_PROTO(ip_header) ||
+     0 != (lwip_ntohs(IPH_OFFSET(ip_header) ) & (IP_OFFMASK | IP_MF) ) ) {
+    return false;
+  }
+  const struct udp_hdr *udp_header =
+    (const struct udp_hdr *) ( (const u8_t *) ip_header + IP_HLEN);
+  if(PP_HTONS(kOpenerEipIoUdpPort) != udp_header->dest) {
+    return false;
+  }
+  ip4_addr_t destination;
+  ip4_addr_copy(destination, ip_header->dest);
+  /* multicast and broadcast I/O still pass the IGMP and netif checks */
+  if(!ip4_addr_cmp(&destination, netif_ip4_addr(netif) ) ) {
+    return false;
+  }
+  const u16_t ip_length = lwip_ntohs(IPH_LEN(ip_header) );
+  const u16_t udp_length = lwip_ntohs(udp_header->len);
+  if(ip_length > frame->len - SIZEOF_ETH_HDR ||
+     udp_length != ip_length - IP_HLEN || udp_length < UDP_HLEN ||
+     0 != inet_chksum(ip_header, IP_HLEN) ) {
+    return false;
+  }
+
+  ip4_addr_t source;
+  ip4_addr_copy(source, ip_header->src);
+  const u16_t source_port = lwip_ntohs(udp_header->src);
+  const u16_t checksum = udp_header->chksum;
+  pbuf_remove_header(frame, SIZEOF_ETH_HDR + IP_HLEN);
+  pbuf_realloc(frame, udp_length); /* drop the Ethernet padding */
+  if(0 != checksum &&
+     0 != inet_chksum_pseudo(frame, IP_PROTO_UDP, udp_length,
+                             &source, &destination) ) {
+    UDP_STATS_INC(udp.chkerr);
+    pbuf_free(frame);
+    return true;
+  }
+  pbuf_remove_header(frame, UDP_HLEN);
+
+  ip_addr_t address;
+  ip_addr_copy_from_ip4(address, source);
+  s_early_datagrams++;
+  IoEndpointQueueDatagram(frame, &address, source_port);
+  return true;
+}
+
+/* Class 1 traffic, UDP port 2222 or any DSCP, is never rate limited */
+static bool IoEndpointIsPriorityFrame(const struct pbuf *frame) {
+  if(frame->len < SIZEOF_ETH_HDR + IP_HLEN + UDP_HLEN) {
+    return false;
+  }
+  const struct ip_hdr *ip_header =
+    (const struct ip_hdr *) ( (const u8_t *) frame->payload + SIZEOF_ETH_HDR);
+  if(4 != IPH_V(ip_header) ) {
+    return false;
+  }
+  if(0 != (IPH_TOS(ip_header) >> 2) ) {
+    return true;
+  }
+  const struct udp_hdr *udp_header = (const struct udp_hdr *)
+                                     ( (const u8_t *) ip_header +
+                                       IPH_HL_BYTES(ip_header) );
+  return IP_PROTO_UDP == IPH_PROTO(ip_header) &&
+         frame->len >= SIZEOF_ETH_HDR + IPH_HL_BYTES(ip_header) + UDP_HLEN &&
+         PP_HTONS(kOpenerEipIoUdpPort) == udp_header->dest;
+}
+
+/* An ARP request for our own address must get through a storm */
+static bool IoEndpointIsOwnArp(struct netif *netif, const struct pbuf *frame) {
+  if(frame->len < SIZEOF_ETH_HDR + SIZEOF_ETHARP_HDR) {
+    return false;
+  }
+  const struct etharp_hdr *arp_header =
+    (const struct etharp_hdr *) ( (const u8_t *) frame->payload +
+                                  SIZEOF_ETH_HDR);
+  ip4_addr_t target;
+  IPADDR_WORDALIGNED_COPY_TO_IP4_ADDR_T(&target, &arp_header->dipaddr);
+  return ip4_addr_cmp(&target, netif_ip4_addr(netif) );
+}
+
+/* Runs in the Ethernet receive task, before the frame is posted to the
+ * tcpip thread. Unicast I/O datagrams skip the tcpip mailbox, so a burst of
+ * web or explicit traffic queued there cannot delay them. Other broadcast
+ * and multicast frames are rate limited, so a storm cannot fill it. */
+static bool IoEndpointFilterInput(struct netif *netif, struct pbuf *frame) {
+  if(frame->len < SIZEOF_ETH_HDR) {
+    return false;
+  }
+#if CONFIG_OPENER_MULTICAST_FILTER
+  if(MulticastFilterInput(netif, frame) ) {
+    return true;
+  }
+#endif
+  const struct eth_hdr *ethernet_header = frame->payload;
+  if(PP_HTONS(ETHTYPE_IP) == ethernet_header->type &&
+     IoEndpointTakeIoFrame(netif, frame) ) {
+    return true;
+  }
+  if(0 == CONFIG_OPENER_BROADCAST_RATE_LIMIT ||
+     0 == (ethernet_header->dest.addr[0] & 1u) ) {
+    return false;
+  }
+#if CONFIG_OPENER_DLR_RING_NODE
+  /* beacons arrive every few hundred microseconds, far above the limit */
+  if(DlrRingNodeIsFrame(frame) ) {
+    return false;
+  }
+#endif
+  if(PP_HTONS(ETHTYPE_IP) == ethernet_header->type) {
+    if(IoEndpointIsPriorityFrame(frame) ) {
+      return false;
+    }
+  } else if(PP_HTONS(ETHTYPE_ARP) == ethernet_header->type) {
+    if(IoEndpointIsOwnArp(netif, frame) ) {
+      return false;
+    }
+  }
+
+  const int64_t window = esp_timer_get_time() / IO_ENDPOINT_BROADCAST_WINDOW_US;
+  if(window != s_broadcast_window) {
+    s_broadcast_window = window;
+    s_broadcasts_in_window = 0;
+  }
+  if(s_broadcasts_in_window < IO_ENDPOINT_BROADCASTS_PER_WINDOW) {
+    s_broadcasts_in_window++;
+    return false;
+  }
+  s_dropped_broadcasts++;
+  pbuf_free(frame);
+  return true;
+}
+
+#endif /* CONFIG_OPENER_IO_EARLY_DEMUX */
+
+static err_t IoEndpointOpenInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+  s_io_pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+  if(NULL == s_io_pcb) {
+    return ERR_MEM;
+  }
+  ip_set_option(s_io_pcb, SOF_REUSEADDR);
+  udp_set_multicast_ttl(s_io_pcb, s_multicast_ttl);
+  udp_set_multicast_netif_addr(s_io_pcb, &s_multicast_interface);
+  /* the ENIP spec wants the source port to be 2222 */
+  err_t error = udp_bind(s_io_pcb, IP4_ADDR_ANY, kOpenerEipIoUdpPort);
+  if(ERR_OK != error) {
+    udp_remove(s_io_pcb);
+    s_io_pcb = NULL;
+    return error;
+  }
+  udp_recv(s_io_pcb, IoEndpointReceive, NULL);
+#if CONFIG_OPENER_IO_EARLY_DEMUX
+  ethernetif_set_input_filter(IoEndpointFilterInput);
+#endif
+  return ERR_OK;
+}
+
+static err_t IoEndpointCloseInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+#if CONFIG_OPENER_IO_EARLY_DEMUX && CONFIG_OPENER_MULTICAST_FILTER
+  ethernetif_set_input_filter(MulticastFilterInput);
+#elif CONFIG_OPENER_IO_EARLY_DEMUX
+  ethernetif_set_input_filter(NULL);
+#endif
+  if(NULL != s_io_pcb) {
+    udp_remove(s_io_pcb);
+    s_io_pcb = NULL;
+  }
+  if(NULL != s_transmit_frame) {
+    pbuf_free(s_transmit_frame);
+    s_transmit_frame = NULL;
+  }
+  return ERR_OK;
+}
+
+static err_t IoEndpointApplyOptionsInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+  if(NULL != s_io_pcb) {
+    udp_set_multicast_ttl(s_io_pcb, s_multicast_ttl);
+    udp_set_multicast_netif_addr(s_io_pcb, &s_multicast_interface);
+  }
+  return ERR_OK;
+}
+
+/* Runs in the tcpip thread */
+static struct pbuf *IoEndpointTakeTransmitFrame(const size_t length) {
+  if(NULL == s_transmit_frame) {
+    s_transmit_frame = pbuf_alloc(PBUF_TRANSPORT,
+                                  PC_OPENER_ETHERNET_BUFFER_SIZE,
+                                  PBUF_RAM);
+    if(NULL == s_transmit_frame) {
+      return NULL;
+    }
+    s_transmit_frame_payload = s_transmit_frame->payload;
+  }
+  /* drop the lower layer headers of the previous frame */
+  s_transmit_frame->payload = s_transmit_frame_payload;
+  s_transmit_frame->len = (u16_t) length;
+  s_transmit_frame->tot_len = (u16_t) length;
+  return s_transmit_frame;
+}
+
+static err_t IoEndpointSendInTcpip(struct tcpip_api_call_data *call) {
+  IoEndpointSendRequest *request = (IoEndpointSendRequest *) call;
+  if(NULL == s_io_pcb) {
+    return ERR_CONN;
+  }
+
+  struct pbuf *frame = IoEndpointTakeTransmitFrame(
+    request->header_length + request->payload_length);
+  if(NULL == frame) {
+    return ERR_MEM;
+  }
+  CipOctet *frame_data = frame->payload;
+  memcpy(frame_data, request->header, request->header_length);
+  if(0 != request->payload_length) {
+    memcpy(frame_data + request->header_length,
+           request->payload,
+           request->payload_length);
+  }
+
+  /* the pcb is shared by all connections, each frame carries the TOS of
+   * its own; a field write, not an option call */
+  s_io_pcb->tos = request->tos;
+  err_t error = udp_sendto(s_io_pcb, frame, &request->address, request->port);
+#if CONFIG_OPENER_IO_L2TAP_TRANSMIT
+  if(ERR_OK == error) {
+    IoL2TapLearn(s_io_pcb, ip_2_ip4(&request->address), request->port);
+  }
+#endif
+  if(1 != frame->ref) {
+    /* The EMAC copies the frame before udp_sendto() returns, a reference
+     * left is the ARP queue waiting for the destination; leave it to lwIP */
+    s_arp_queued++;
+    pbuf_free(frame);
+    s_transmit_frame = NULL;
+  }
+  return error;
+}
+
+int IoEndpointOpen(void) {
+  if(NULL == s_received_queue) {
+    s_received_queue = xQueueCreate(CONFIG_OPENER_IO_EVENT_QUEUE_LENGTH,
+                                    sizeof(IoEndpointReceivedDatagram) );
+    if(NULL == s_received_queue) {
+      OPENER_TRACE_ERR("I/O endpoint: failed to create receive queue\n");
+      return kEipInvalidSocket;
+    }
+  }
+
+  struct tcpip_api_call_data call;
+  err_t error = tcpip_api_call(IoEndpointOpenInTcpip, &call);
+  if(ERR_OK != error) {
+    OPENER_TRACE_ERR("I/O endpoint: cannot bind UDP port %d: %d\n",
+                     kOpenerEipIoUdpPort,
+                     error);
+    return kEipInvalidSocket;
+  }
+  OPENER_TRACE_INFO("I/O endpoint: listening on UDP port %d\n",
+                    kOpenerEipIoUdpPort);
+#if CONFIG_OPENER_IO_L2TAP_TRANSMIT
+  IoL2TapOpen();
+#endif
+  return kOpenerIoEndpointHandle;
+}
+
+void IoEndpointClose(void) {
+  struct tcpip_api_call_data call;
+  tcpip_api_call(IoEndpointCloseInTcpip, &call);
+#if CONFIG_OPENER_IO_L2TAP_TRANSMIT
+  IoL2TapClose();
+#endif
+
+  if(NULL != s_received_queue) {
+    IoEndpointReceivedDatagram received;
+    while(pdTRUE == xQueueReceive(s_received_queue, &received, 0) ) {
+      pbuf_free(received.datagram);
+    }
+  }
+}
+
+EipStatus IoEndpointSend(const CipUdint address,
+                         const CipUint port,
+                         const CipUsint dscp,
+                         const CipOctet *const header,
+                         const size_t header_length,
+                         const CipOctet *const payload,
+                         const size_t payload_length) {
+  if(header_length + payload_length > PC_OPENER_ETHERNET_BUFFER_SIZE) {
+    return kEipStatusError;
+  }
+  const u8_t tos = (u8_t) (dscp << 2);
+#if CONFIG_OPENER_IO_L2TAP_TRANSMIT
+  if(IoL2TapSend(address, port, tos, header, header_length, payload,
+                 payload_length) ) {
+    return kEipStatusOk;
+  }
+#endif
+  IoEndpointSendRequest request = {
+    .port = ntohs(port),
+    .tos = tos,
+    .header = header,
+    .header_length = header_length,
+    .payload = payload,
+    .payload_length = payload_length,
+  };
+  ip_addr_set_ip4_u32(&request.address, address);
+
+  err_t error = tcpip_api_call(IoEndpointSendInTcpip, &request.call);
+  if(ERR_OK != error) {
+    OPENER_TRACE_ERR("I/O endpoint: error on send: %d\n", error);
+    return kEipStatusError;
+  }
+  return kEipStatusOk;
+}
+
+static void IoEndpointApplyOptions(void) {
+  struct tcpip_api_call_data call;
+  tcpip_api_call(IoEndpointApplyOptionsInTcpip, &call);
+}
+
+void IoEndpointSetMulticastProduce(const CipUsint ttl,
+                                   const CipUdint interface_address) {
+  if( (ttl != s_multicast_ttl) ||
+      (interface_address != ip4_addr_get_u32(&s_multicast_interface) ) ) {
+    s_multicast_ttl = ttl;
+    ip4_addr_set_u32(&s_multicast_interface, interface_address);
+    IoEndpointApplyOptions();
+  }
+}
+
+void IoEndpointGetStatistics(IoEndpointStatistics *const statistics) {
+  statistics->queue_length = CONFIG_OPENER_IO_EVENT_QUEUE_LENGTH;
+  statistics->queue_peak = s_queue_peak;
+  statistics->dropped_datagrams = s_dropped_datagrams;
+  statistics->arp_queued = s_arp_queued;
+#if CONFIG_OPENER_IO_EARLY_DEMUX
+  statistics->early_datagrams = s_early_datagrams;
+  statistics->dropped_broadcasts = s_dropped_broadcasts;
+#else
+  statistics->early_datagrams = 0;
+  statistics->dropped_broadcasts = 0;
+#endif
+}
+
+void IoEndpointDispatch(void) {
+  /* only the producer task dispatches; holds chained datagrams only */
+  static CipOctet incoming_message[PC_OPENER_ETHERNET_BUFFER_SIZE];
+  static uint32_t reported_drops = 0;
+
+  const uint32_t dropped = s_dropped_datagrams - reported_drops;
+  if(0 != dropped) {
+    reported_drops += dropped;
+    NetworkHandlerDiscardedIoMessages(kNetworkDropIoQueueFull, dropped);
+    OPENER_TRACE_WARN("I/O endpoint: receive queue full, dropped %" PRIu32
+                      " oldest datagrams\n", dropped);
+  }
+
+  /* Bounded so a flood on the I/O port cannot starve production */
+  IoEndpointReceivedDatagram received;
+  for(size_t i = 0; i < CONFIG_OPENER_IO_EVENT_QUEUE_LENGTH; ++i) {
+    if(pdTRUE != xQueueReceive(s_received_queue, &received, 0) ) {
+      return;
+    }
+    struct pbuf *const datagram = received.datagram;
+    struct sockaddr_in from_address = {
+      .sin_family = AF_INET,
+      .sin_port = htons(received.source_port),
+      .sin_addr.s_addr = ip4_addr_get_u32(ip_2_ip4(&received.source_address) ),
+    };
+
+    if(datagram->len == datagram->tot_len) {
+      /* single pbuf: decode straight from the lwIP buffer, the payload is
+       * copied once into the consuming assembly */
+      NetworkHandlerReceivedIoMessage(datagram->payload, datagram->len,
+                                      &from_address);
+    } else if(datagram->tot_len <= sizeof(incoming_message) ) {
+      const u16_t length = pbuf_copy_partial(datagram,
+                                             incoming_message,
+                                             datagram->tot_len,
+                                             0);
+      NetworkHandlerReceivedIoMessage(incoming_message, length,
+                                      &from_address);
+    } else {
+      NetworkHandlerDiscardedIoMessages(kNetworkDropTruncated, 1);
+    }
+    pbuf_free(datagram);
+  }
+
+  if(0 != uxQueueMessagesWaiting(s_received_queue) ) {
+    ProductionSchedulerNotifyIoEvent();
+  }
+}
+
+#endif /* OPENER_IO_EVENT_BACKEND */
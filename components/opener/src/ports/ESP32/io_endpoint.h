@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_IO_ENDPOINT_H_
+#define OPENER_IO_ENDPOINT_H_
+
+/** @file io_endpoint.h
+ *  @brief Event driven implicit I/O endpoint on lwIP raw UDP
+ *
+ *  Selected with CONFIG_OPENER_NETWORK_BACKEND_EVENT. A raw UDP pcb bound to
+ *  port 2222 receives all I/O datagrams in the tcpip thread and queues the
+ *  pbufs together with the sender. A full queue drops its oldest datagram
+ *  for the new one, as cyclic data supersedes itself. The producer task is
+ *  woken for every datagram and dispatches the queue with the stack lock
+ *  held, so consumed data neither waits for select() nor costs a socket
+ *  scan. Datagrams that fit in one pbuf are decoded in place, without an
+ *  intermediate copy. Explicit messaging stays on BSD sockets and select().
+ *
+ *  With CONFIG_OPENER_IO_EARLY_DEMUX the Ethernet input filter takes unicast
+ *  I/O datagrams over in the Ethernet receive task, so they never wait in the
+ *  tcpip mailbox behind other traffic, and rate limits the other broadcast
+ *  and multicast frames.
+ *
+ *  The platform interface is declared in networkhandler.h.
+ */
+
+#include "networkhandler.h"
+
+#if OPENER_IO_EVENT_BACKEND
+
+#include <stdint.h>
+
+/** @brief Receive queue counters of the I/O endpoint */
+typedef struct {
+  uint32_t queue_length; /**< queued datagrams at most */
+  uint32_t queue_peak; /**< most datagrams queued at once since boot */
+  uint32_t dropped_datagrams; /**< oldest datagrams dropped on a full queue */
+  uint32_t early_datagrams; /**< taken over before the tcpip thread */
+  uint32_t dropped_broadcasts; /**< frames above the broadcast rate limit */
+  uint32_t arp_queued; /**< produced datagrams held back for ARP resolution */
+} IoEndpointStatistics;
+
+/** @brief Read the receive queue counters, safe from any task */
+void IoEndpointGetStatistics(IoEndpointStatistics *const statistics);
+
+/** @brief Dispatch the received I/O datagrams
+ *
+ * Called from the producer task with the stack lock held.
+ */
+void IoEndpointDispatch(void);
+
+#endif /* OPENER_IO_EVENT_BACKEND */
+
+#endif /* OPENER_IO_ENDPOINT_H_ */
@@ -0,0 +1,234 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "io_l2tap.h"
+
+#if CONFIG_OPENER_IO_L2TAP_TRANSMIT
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "networkhandler.h"
+#include "opener_user_conf.h"
+#include "trace.h"
+#include "esp_vfs_l2tap.h"
+#include "lwip/etharp.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip4.h"
+#include "lwip/udp.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+#if CONFIG_OPENER_QOS_8021Q_TAGGING
+#include "cipqos.h"
+#endif
+
+#define IO_L2TAP_TEMPLATES (OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS + \
+                            OPENER_CIP_NUM_INPUT_ONLY_CONNS)
+#define IO_L2TAP_MAX_HEADER_LENGTH (SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR + \
+                                    IP_HLEN + UDP_HLEN)
+/* Shorter frames are padded, in case the MAC does not */
+#define IO_L2TAP_MIN_FRAME_LENGTH 60
+
+typedef struct {
+  CipUdint address; /* network byte order, 0 if the entry is unused */
+  CipUint port; /* network byte order */
+  u8_t tos; /* connections of different priorities to one port differ here */
+  MilliSeconds built;
+  u16_t header_length; /* Ethernet, optional 802.1Q tag, IP and UDP */
+  u32_t pseudo_sum; /* UDP pseudo header except the length */
+  u8_t header[IO_L2TAP_MAX_HEADER_LENGTH];
+} IoL2TapTemplate;
+
+static int s_l2tap_fd = -1;
+static IoL2TapTemplate s_templates[IO_L2TAP_TEMPLATES];
+static u16_t s_ip_id = 0;
+/* Only used by the task that holds the stack lock */
+static u8_t s_frame[IO_L2TAP_MAX_HEADER_LENGTH +
+                    PC_OPENER_ETHERNET_BUFFER_SIZE] __attribute__((aligned(4) ) );
+
+void IoL2TapOpen(void) {
+  static bool registered = false;
+  if(!registered) {
+    if(ESP_OK != esp_vfs_l2tap_intf_register(NULL) ) {
+      OPENER_TRACE_ERR("I/O L2 TAP: cannot register the TAP device\n");
+      return;
+    }
+    registered = true;
+  }
+  if(0 <= s_l2tap_fd) {
+    return;
+  }
+  s_l2tap_fd = open("/dev/net/tap", O_NONBLOCK);
+  if(0 > s_l2tap_fd) {
+    OPENER_TRACE_ERR("I/O L2 TAP: cannot open the TAP device: %d\n", errno);
+    return;
+  }
+  if(0 > ioctl(s_l2tap_fd, L2TAP_S_INTF_DEVICE, "ETH_DEF") ) {
+    OPENER_TRACE_ERR("I/O L2 TAP: cannot bind to the Ethernet interface: %d\n",
+                     errno);
+    close(s_l2tap_fd);
+    s_l2tap_fd = -1;
+    return;
+  }
+  OPENER_TRACE_INFO("I/O L2 TAP: point-to-point I/O is sent on L2\n");
+}
+
+void IoL2TapClose(void) {
+  memset(s_templates, 0, sizeof(s_templates) );
+  if(0 <= s_l2tap_fd) {
+    close(s_l2tap_fd);
+    s_l2tap_fd = -1;
+  }
+}
+
+static IoL2TapTemplate *IoL2TapFindTemplate(const CipUdint address,
+                                            const CipUint port,
+                                            const u8_t tos) {
+  for(size_t i = 0; i < IO_L2TAP_TEMPLATES; ++i) {
+    if(address == s_templates[i].address && port == s_templates[i].port &&
+       tos == s_templates[i].tos) {
+      return &s_templates[i];
+    }
+  }
+  return NULL;
+}
+
+bool IoL2TapSend(const CipUdint address,
+                 const CipUint port,
+                 const u8_t tos,
+                 const CipOctet *const header,
+                 const size_t header_length,
+                 const CipOctet *const payload,
+                 const size_t payload_length) {
+  const IoL2TapTemplate *const template = IoL2TapFindTemplate(address, port,
+                                                              tos);
+  if(NULL == template ||
+     GetMilliSeconds() - template->built >= kIoL2TapRefreshMs) {
+    return false;
+  }
+
+  memcpy(s_frame, template->header, template->header_length);
+  struct ip_hdr *const ip_header =
+    (struct ip_hdr *) (s_frame + template->header_length - IP_HLEN - UDP_HLEN);
+  struct udp_hdr *const udp_header =
+    (struct udp_hdr *) ( (u8_t *) ip_header + IP_HLEN);
+  u8_t *const data = (u8_t *) udp_header + UDP_HLEN;
+  memcpy(data, header, header_length);
+  if(0 != payload_length) {
+    memcpy(data + header_length, payload, payload_length);
+  }
+
+  const u16_t udp_length = (u16_t) (UDP_HLEN + header_length + payload_length);
+  IPH_LEN_SET(ip_header, lwip_htons(IP_HLEN + udp_length) );
+  IPH_ID_SET(ip_header, lwip_htons(s_ip_id) );
+  s_ip_id++;
+  IPH_CHKSUM_SET(ip_header, inet_chksum(ip_header, IP_HLEN) );
+
+  udp_header->len = lwip_htons(udp_length);
+  /* inet_chksum() returns the complement, undo it to add the pseudo header */
+  u32_t sum = template->pseudo_sum + lwip_htons(udp_length) +
+              (u16_t) ~inet_chksum(udp_header, udp_length);
+  sum = FOLD_U32T(sum);
+  sum = FOLD_U32T(sum);
+  const u16_t checksum = (u16_t) ~sum;
+  udp_header->chksum = (0 == checksum) ? 0xFFFF : checksum;
+
+  size_t frame_length = template->header_length + header_length +
+                        payload_length;
+  if(frame_length < IO_L2TAP_MIN_FRAME_LENGTH) {
+    memset(s_frame + frame_length, 0, IO_L2TAP_MIN_FRAME_LENGTH - frame_length);
+    frame_length = IO_L2TAP_MIN_FRAME_LENGTH;
+  }
+  /* on a full transmit ring lwIP gets the datagram and may queue it */
+  return (ssize_t) frame_length == write(s_l2tap_fd, s_frame, frame_length);
+}
+
+void IoL2TapLearn(const struct udp_pcb *const pcb,
+                  const ip4_addr_t *const address,
+                  const u16_t port) {
+  if(0 > s_l2tap_fd || ip4_addr_ismulticast(address) ) {
+    return;
+  }
+  struct netif *const netif = ip4_route(address);
+  if(NULL == netif || ip4_addr_isbroadcast(address, netif) ||
+     !ip4_addr_net_eq(address, netif_ip4_addr(netif),
+                      netif_ip4_netmask(netif) ) ) {
+    return;
+  }
+  struct eth_addr *mac_address = NULL;
+  const ip4_addr_t *entry_address = NULL;
+  if(0 > etharp_find_addr(netif, address, &mac_address, &entry_address) ) {
+    return;
+  }
+
+  const CipUdint key_address = ip4_addr_get_u32(address);
+  const CipUint key_port = lwip_htons(port);
+  IoL2TapTemplate *template = IoL2TapFindTemplate(key_address, key_port,
+                                                  pcb->tos);
+  const MilliSeconds now = GetMilliSeconds();
+  if(NULL == template) {
+    /* an unused entry, else the oldest one */
+    template = &s_templates[0];
+    for(size_t i = 0; i < IO_L2TAP_TEMPLATES; ++i) {
+      if(0 == s_templates[i].address) {
+        template = &s_templates[i];
+        break;
+      }
+      if(now - s_templates[i].built > now - template->built) {
+        template = &s_templates[i];
+      }
+    }
+  }
+
+  memset(template, 0, sizeof(*template) );
+  u8_t *position = template->header;
+  struct eth_hdr *const ethernet_header = (struct eth_hdr *) position;
+  SMEMCPY(&ethernet_header->dest, mac_address, ETH_HWADDR_LEN);
+  SMEMCPY(&ethernet_header->src, netif->hwaddr, ETH_HWADDR_LEN);
+  ethernet_header->type = PP_HTONS(ETHTYPE_IP);
+  position += SIZEOF_ETH_HDR;
+#if CONFIG_OPENER_QOS_8021Q_TAGGING
+  /* same priority tag as lwip_hook_vlan_set() gives the lwIP path */
+  const int priority = CipQosGetVlanPriority(pcb->tos >> 2);
+  if(0 <= priority) {
+    struct eth_vlan_hdr *const vlan_header = (struct eth_vlan_hdr *) position;
+    vlan_header->prio_vid = lwip_htons( (u16_t) (priority << 13) );
+    vlan_header->tpid = PP_HTONS(ETHTYPE_IP);
+    ethernet_header->type = PP_HTONS(ETHTYPE_VLAN);
+    position += SIZEOF_VLAN_HDR;
+  }
+#endif
+
+  struct ip_hdr *const ip_header = (struct ip_hdr *) position;
+  IPH_VHL_SET(ip_header, 4, IP_HLEN / 4);
+  IPH_TOS_SET(ip_header, pcb->tos);
+  IPH_TTL_SET(ip_header, pcb->ttl);
+  IPH_PROTO_SET(ip_header, IP_PROTO_UDP);
+  ip4_addr_copy(ip_header->src, *netif_ip4_addr(netif) );
+  ip4_addr_copy(ip_header->dest, *address);
+  position += IP_HLEN;
+
+  struct udp_hdr *const udp_header = (struct udp_hdr *) position;
+  udp_header->src = lwip_htons(pcb->local_port);
+  udp_header->dest = key_port;
+  position += UDP_HLEN;
+
+  const u32_t source = ip4_addr_get_u32(netif_ip4_addr(netif) );
+  template->pseudo_sum = (source & 0xFFFFUL) + (source >> 16) +
+                         (key_address & 0xFFFFUL) + (key_address >> 16) +
+                         lwip_htons(IP_PROTO_UDP);
+  template->header_length = (u16_t) (position - template->header);
+  template->address = key_address;
+  template->port = key_port;
+  template->tos = pcb->tos;
+  template->built = now;
+}
+
+#endif /* CONFIG_OPENER_IO_L2TAP_TRANSMIT */
@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_IO_L2TAP_H_
+#define OPENER_IO_L2TAP_H_
+
+/** @file io_l2tap.h
+ *  @brief Experimental transmit path for point-to-point I/O on L2 TAP
+ *
+ *  Selected with CONFIG_OPENER_IO_L2TAP_TRANSMIT on top of the event backend.
+ *  The first datagram to a unicast consumer on the local subnet goes through
+ *  lwIP as usual. Once lwIP resolved the consumer's MAC address, the Ethernet,
+ *  IP and UDP headers of that destination are kept as a template and the
+ *  following datagrams are completed from it and written to the L2 TAP
+ *  device by the producing task, without the tcpip thread. Every
+ *  kIoL2TapRefreshMs one datagram takes the lwIP path again, which keeps the
+ *  ARP entry alive and rebuilds the template.
+ *
+ *  Receiving stays on lwIP: an L2 TAP receive filter on the IPv4 Ethernet type
+ *  would take all IP traffic away from lwIP. CONFIG_OPENER_IO_EARLY_DEMUX
+ *  keeps consumed datagrams out of the tcpip mailbox instead.
+ *
+ *  Sends are serialized by the stack lock, see io_endpoint.c. IoL2TapLearn()
+ *  runs in the tcpip thread while the sending task waits for it, so the
+ *  templates need no lock of their own.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "typedefs.h"
+#include "lwip/ip4_addr.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_IO_L2TAP_TRANSMIT
+
+struct udp_pcb;
+
+/** @brief Age after which a template is rebuilt over lwIP */
+enum {
+  kIoL2TapRefreshMs = 1000
+};
+
+/** @brief Open the L2 TAP device of the Ethernet interface */
+void IoL2TapOpen(void);
+
+/** @brief Close the L2 TAP device and drop all templates */
+void IoL2TapClose(void);
+
+/** @brief Send a datagram from the template of its destination
+ *
+ *  @param address destination IP address, network byte order
+ *  @param port destination UDP port, network byte order
+ *  @param tos IP TOS of the datagram, part of the template key
+ *  @param header first part of the UDP payload
+ *  @param header_length length of @p header
+ *  @param payload second part of the UDP payload, may be NULL
+ *  @param payload_length length of @p payload
+ *  @return true if the frame was written, false if the datagram has to be
+ *  sent through lwIP
+ */
+bool IoL2TapSend(const CipUdint address,
+                 const CipUint port,
+                 const u8_t tos,
+                 const CipOctet *const header,
+                 const size_t header_length,
+                 const CipOctet *const payload,
+                 const size_t payload_length);
+
+/** @brief Build the template of a destination after lwIP sent to it
+ *
+ *  Does nothing for multicast, broadcast and routed destinations and while
+ *  the MAC address is not resolved.
+ *
+ *  @param pcb the I/O pcb, source of port, TOS and TTL
+ *  @param address destination IP address
+ *  @param port destination UDP port, host byte order
+ */
+void IoL2TapLearn(const struct udp_pcb *const pcb,
+                  const ip4_addr_t *const address,
+                  const u16_t port);
+
+#endif /* CONFIG_OPENER_IO_L2TAP_TRANSMIT */
+
+#endif /* OPENER_IO_L2TAP_H_ */
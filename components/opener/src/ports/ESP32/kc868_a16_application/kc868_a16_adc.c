@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "kc868_a16_adc.h"
+
+#include "sdkconfig.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#if CONFIG_KC868_ADC_CONTINUOUS
+#include "esp_adc/adc_continuous.h"
+#endif
+#include "esp_log.h"
+#include "esp_err.h"
+
+#define ANALOG_A1  36  /* Physical terminal A1 - INA1 (4-20mA) */
+#define ANALOG_A2  34  /* Physical terminal A2 - INA2 (0-5V) */
+#define ANALOG_A3  35  /* Physical terminal A3 - INA3 (0-5V) */
+#define ANALOG_A4  39  /* Physical terminal A4 - INA4 (4-20mA) */
+
+#define ADC_ATTENUATION         ADC_ATTEN_DB_12
+
+#if CONFIG_KC868_ADC_CONTINUOUS
+#define ADC_CONV_FRAME_SIZE     256
+#define ADC_STORE_BUFFER_SIZE   (4 * ADC_CONV_FRAME_SIZE)
+#define ADC_FILTER_FRACTION_BITS 8
+#endif
+
+static const adc_channel_t kAnalogChannels[KC868_A16_ANALOG_INPUT_COUNT] = {
+  ADC_CHANNEL_0,  /* GPIO36 - A1/INA1 (4-20mA) */
+  ADC_CHANNEL_6,  /* GPIO34 - A2/INA2 (0-5V) */
+  ADC_CHANNEL_7,  /* GPIO35 - A3/INA3 (0-5V) */
+  ADC_CHANNEL_3,  /* GPIO39 - A4/INA4 (4-20mA) */
+};
+
+static const char *TAG_ADC = "kc868_adc";
+
+static bool s_adc_initialized = false;
+static adc_cali_handle_t s_cali_handle = NULL;
+
+#if CONFIG_KC868_ADC_CONTINUOUS
+static adc_continuous_handle_t s_adc_handle = NULL;
+
+/* Oversampling accumulators and filter state, A1 first. The IIR state keeps
+ * ADC_FILTER_FRACTION_BITS fractional bits so small steps are not lost. */
+static uint32_t s_oversample_sum[KC868_A16_ANALOG_INPUT_COUNT];
+static uint32_t s_oversample_count[KC868_A16_ANALOG_INPUT_COUNT];
+static uint32_t s_filter_state[KC868_A16_ANALOG_INPUT_COUNT];
+static bool s_filter_primed[KC868_A16_ANALOG_INPUT_COUNT];
+static uint16_t s_filtered_raw[KC868_A16_ANALOG_INPUT_COUNT];
+#else
+static adc_oneshot_unit_handle_t s_adc_handle = NULL;
+#endif
+
+static void InitializeCalibration(void) {
+#if CONFIG_KC868_ADC_REPORT_MILLIVOLTS && ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+  adc_cali_line_fitting_config_t cali_cfg = {
+    .unit_id = ADC_UNIT_1,
+    .atten = ADC_ATTENUATION,
+    .bitwidth = ADC_BITWIDTH_12,
+  };
+  esp_err_t ret = adc_cali_create_scheme_line_fitting(&cali_cfg, &s_cali_handle);
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG_ADC, "ADC calibration unavailable (%s), reporting raw counts",
+             esp_err_to_name(ret));
+    s_cali_handle = NULL;
+  }
+#endif
+}
+
+static uint16_t ConvertRaw(uint16_t raw) {
+  if (NULL == s_cali_handle) {
+    return raw;
+  }
+  int millivolts = 0;
+  if (adc_cali_raw_to_voltage(s_cali_handle, raw, &millivolts) != ESP_OK ||
+      millivolts < 0) {
+    return 0;
+  }
+  return (uint16_t)millivolts;
+}
+
+#if CONFIG_KC868_ADC_CONTINUOUS
+
+static int ChannelToIndex(uint32_t channel) {
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    if ((uint32_t)kAnalogChannels[channel_index] == channel) {
+      return (int)channel_index;
+    }
+  }
+  return -1;
+}
+
+static void FilterSample(size_t channel_index, uint32_t raw) {
+  s_oversample_sum[channel_index] += raw;
+  if (++s_oversample_count[channel_index] < CONFIG_KC868_ADC_OVERSAMPLING) {
+    return;
+  }
+
+  uint32_t average = s_oversample_sum[channel_index] /
+                     s_oversample_count[channel_index];
+  s_oversample_sum[channel_index] = 0;
+  s_oversample_count[channel_index] = 0;
+
+  uint32_t sample = average << ADC_FILTER_FRACTION_BITS;
+  if (!s_filter_primed[channel_index]) {
+    s_filter_state[channel_index] = sample;
+    s_filter_primed[channel_index] = true;
+  } else {
+    /* y += (x - y) / 2^shift, done in signed arithmetic */
+    int32_t delta = (int32_t)sample - (int32_t)s_filter_state[channel_index];
+    s_filter_state[channel_index] = (uint32_t)((int32_t)s_filter_state[channel_index] +
+                                    (delta >> CONFIG_KC868_ADC_FILTER_SHIFT));
+  }
+  s_filtered_raw[channel_index] =
+    (uint16_t)((s_filter_state[channel_index] +
+                (1u << (ADC_FILTER_FRACTION_BITS - 1))) >> ADC_FILTER_FRACTION_BITS);
+}
+
+bool KC868_A16_AdcInitialize(void) {
+  if (s_adc_initialized) {
+    return true;
+  }
+
+  adc_continuous_handle_cfg_t handle_cfg = {
+    .max_store_buf_size = ADC_STORE_BUFFER_SIZE,
+    .conv_frame_size = ADC_CONV_FRAME_SIZE,
+  };
+  esp_err_t ret = adc_continuous_new_handle(&handle_cfg, &s_adc_handle);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG_ADC, "Failed to create continuous ADC handle: %s",
+             esp_err_to_name(ret));
+    s_adc_handle = NULL;
+    return false;
+  }
+
+  adc_digi_pattern_config_t pattern[KC868_A16_ANALOG_INPUT_COUNT] = { 0 };
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    pattern[channel_index].atten = ADC_ATTENUATION;
+    pattern[channel_index].channel = kAnalogChannels[channel_index] & 0x7;
+    pattern[channel_index].unit = ADC_UNIT_1;
+    pattern[channel_index].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+
+  adc_continuous_config_t dig_cfg = {
+    .pattern_num = KC868_A16_ANALOG_INPUT_COUNT,
+    .adc_pattern = pattern,
+    .sample_freq_hz = CONFIG_KC868_ADC_SAMPLE_FREQ_HZ,
+    .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+    .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+  };
+  ret = adc_continuous_config(s_adc_handle, &dig_cfg);
+  if (ret == ESP_OK) {
+    ret = adc_continuous_start(s_adc_handle);
+  }
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG_ADC, "Failed to start continuous ADC: %s", esp_err_to_name(ret));
+    adc_continuous_deinit(s_adc_handle);
+    s_adc_handle = NULL;
+    return false;
+  }
+
+  InitializeCalibration();
+  s_adc_initialized = true;
+  ESP_LOGI(TAG_ADC, "Continuous ADC at %d Hz, %dx oversampling, filter shift %d%s",
+           CONFIG_KC868_ADC_SAMPLE_FREQ_HZ, CONFIG_KC868_ADC_OVERSAMPLING,
+           CONFIG_KC868_ADC_FILTER_SHIFT,
+           (NULL != s_cali_handle) ? ", calibrated mV" : "");
+  return true;
+}
+
+void KC868_A16_AdcRead(uint16_t *values) {
+  if (!s_adc_initialized) {
+    memset(values, 0, KC868_A16_ANALOG_INPUT_COUNT * sizeof(values[0]));
+    return;
+  }
+
+  /* Drain everything the DMA engine has finished without blocking */
+  uint8_t frame[ADC_CONV_FRAME_SIZE];
+  uint32_t frame_length = 0;
+  while (adc_continuous_read(s_adc_handle, frame, sizeof(frame), &frame_length,
+                             0) == ESP_OK) {
+    for (uint32_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= frame_length;
+         offset += SOC_ADC_DIGI_RESULT_BYTES) {
+      const adc_digi_output_data_t *result =
+        (const adc_digi_output_data_t *)&frame[offset];
+      int channel_index = ChannelToIndex(result->type1.channel);
+      if (channel_index >= 0) {
+        FilterSample((size_t)channel_index, result->type1.data);
+      }
+    }
+  }
+
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    values[channel_index] = s_filter_primed[channel_index] ?
+                            ConvertRaw(s_filtered_raw[channel_index]) : 0;
+  }
+}
+
+#else /* CONFIG_KC868_ADC_CONTINUOUS */
+
+bool KC868_A16_AdcInitialize(void) {
+  if (s_adc_initialized) {
+    return true;
+  }
+
+  adc_oneshot_unit_init_cfg_t unit_cfg = {
+    .unit_id = ADC_UNIT_1,
+    .ulp_mode = ADC_ULP_MODE_DISABLE,
+  };
+  if (adc_oneshot_new_unit(&unit_cfg, &s_adc_handle) != ESP_OK) {
+    s_adc_handle = NULL;
+    return false;
+  }
+
+  adc_oneshot_chan_cfg_t chan_cfg = {
+    .atten = ADC_ATTENUATION,
+    .bitwidth = ADC_BITWIDTH_12,
+  };
+
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    if (adc_oneshot_config_channel(s_adc_handle,
+                                   kAnalogChannels[channel_index],
+                                   &chan_cfg) != ESP_OK) {
+      ESP_LOGE(TAG_ADC, "Failed to configure ADC channel %zu", channel_index);
+      adc_oneshot_del_unit(s_adc_handle);
+      s_adc_handle = NULL;
+      return false;
+    }
+  }
+
+  InitializeCalibration();
+  s_adc_initialized = true;
+  return true;
+}
+
+void KC868_A16_AdcRead(uint16_t *values) {
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    int raw_value = 0;
+    if (!s_adc_initialized ||
+        adc_oneshot_read(s_adc_handle, kAnalogChannels[channel_index],
+                         &raw_value) != ESP_OK) {
+      raw_value = 0;
+    }
+    if (raw_value < 0) {
+      raw_value = 0;
+    }
+    values[channel_index] = ConvertRaw((uint16_t)raw_value);
+  }
+}
+
+#endif /* CONFIG_KC868_ADC_CONTINUOUS */
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_ADC_H_
+#define KC868_A16_ADC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "kc868_a16_io.h"
+
+/** @file kc868_a16_adc.h
+ *  @brief KC868-A16 analog inputs A1-A4 on ADC1
+ *
+ *  With CONFIG_KC868_ADC_CONTINUOUS the four channels are converted in the
+ *  background by the ADC DMA engine; each read only drains the finished
+ *  conversions, oversamples them and runs them through an IIR low-pass filter.
+ *  Without it every read performs four one-shot conversions.
+ *
+ *  Only the I/O scan task may call into this module.
+ */
+
+/** @brief Set up the ADC unit, channels and optional calibration
+ *
+ *  @return true if the analog inputs are usable
+ */
+bool KC868_A16_AdcInitialize(void);
+
+/** @brief Get the current value of all analog inputs
+ *
+ *  Values are raw counts (0-4095) or, with CONFIG_KC868_ADC_REPORT_MILLIVOLTS,
+ *  calibrated millivolts at the ADC pin. Channels without data read 0.
+ *
+ *  @param values KC868_A16_ANALOG_INPUT_COUNT output values, A1 first
+ */
+void KC868_A16_AdcRead(uint16_t *values);
+
+#endif /* KC868_A16_ADC_H_ */
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_alarm.h"
+
+#if CONFIG_KC868_ANALOG_ALARMS
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+
+#define ALARM_NVS_NAMESPACE  "kc868"
+#define ALARM_NVS_KEY        "analog_alarm"
+#define ALARM_NVS_VERSION    1
+
+/* Samples kept over the rate window */
+#define ALARM_RATE_STEPS     8
+
+#define ALARM_RATE_BITS (KC868_A16_ALARM_RATE_RISING | \
+                         KC868_A16_ALARM_RATE_FALLING)
+
+typedef struct __attribute__((packed)) {
+  uint8_t version;
+  uint8_t channel_count;
+  KC868_A16_AnalogAlarm alarms[KC868_A16_ANALOG_INPUT_COUNT];
+} AlarmNvBlob;
+
+/* Samples of one channel a rate window back, scan task only */
+typedef struct {
+  int32_t value[ALARM_RATE_STEPS];
+  int64_t time_us[ALARM_RATE_STEPS];
+  size_t next; /**< oldest sample once count is ALARM_RATE_STEPS */
+  size_t count;
+} AlarmRateHistory;
+
+static const char *TAG_ALARM = "kc868_alarm";
+
+/* Configured alarms, written by the application */
+static KC868_A16_AnalogAlarm s_configured[KC868_A16_ANALOG_INPUT_COUNT];
+static bool s_configured_pending = false;
+static portMUX_TYPE s_configured_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Scan task only */
+static KC868_A16_AnalogAlarm s_alarms[KC868_A16_ANALOG_INPUT_COUNT];
+static AlarmRateHistory s_history[KC868_A16_ANALOG_INPUT_COUNT];
+static uint32_t s_scan_status = 0;
+
+/* Byte n: alarm bits of channel n+1, stored by the scan task */
+static uint32_t s_status = 0;
+
+const char *KC868_A16_AlarmValidateConfig(const KC868_A16_AnalogAlarm *alarms) {
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    const KC868_A16_AnalogAlarm *const alarm = &alarms[channel_index];
+    if (0 != (alarm->enable & ~KC868_A16_ALARM_ALL)) {
+      return "unknown alarm enabled";
+    }
+    if ((alarm->enable & KC868_A16_ALARM_LO_LO) &&
+        (alarm->enable & KC868_A16_ALARM_LO) && alarm->lo_lo > alarm->lo) {
+      return "lo-lo above lo";
+    }
+    if ((alarm->enable & KC868_A16_ALARM_HI_HI) &&
+        (alarm->enable & KC868_A16_ALARM_HI) && alarm->hi_hi < alarm->hi) {
+      return "hi-hi below hi";
+    }
+    if ((alarm->enable & ALARM_RATE_BITS) &&
+        (0 == alarm->rate || alarm->rate_window_ms < ALARM_RATE_STEPS)) {
+      return "rate alarm without a rate or window";
+    }
+  }
+  return NULL;
+}
+
+static bool AlarmEqual(const KC868_A16_AnalogAlarm *a,
+                       const KC868_A16_AnalogAlarm *b) {
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    if (a[channel_index].enable != b[channel_index].enable ||
+        a[channel_index].lo_lo != b[channel_index].lo_lo ||
+        a[channel_index].lo != b[channel_index].lo ||
+        a[channel_index].hi != b[channel_index].hi ||
+        a[channel_index].hi_hi != b[channel_index].hi_hi ||
+        a[channel_index].hysteresis != b[channel_index].hysteresis ||
+        a[channel_index].rate != b[channel_index].rate ||
+        a[channel_index].rate_window_ms != b[channel_index].rate_window_ms) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Returns false if the alarms are already configured */
+static bool PostConfig(const KC868_A16_AnalogAlarm *alarms) {
+  bool changed = false;
+  taskENTER_CRITICAL(&s_configured_lock);
+  if (!AlarmEqual(s_configured, alarms)) {
+    memcpy(s_configured, alarms, sizeof(s_configured));
+    changed = true;
+  }
+  taskEXIT_CRITICAL(&s_configured_lock);
+  if (changed) {
+    __atomic_store_n(&s_configured_pending, true, __ATOMIC_RELEASE);
+  }
+  return changed;
+}
+
+void KC868_A16_AlarmGetConfig(KC868_A16_AnalogAlarm *alarms) {
+  taskENTER_CRITICAL(&s_configured_lock);
+  memcpy(alarms, s_configured, sizeof(s_configured));
+  taskEXIT_CRITICAL(&s_configured_lock);
+}
+
+static esp_err_t StoreConfig(const KC868_A16_AnalogAlarm *alarms) {
+  AlarmNvBlob blob;
+  memset(&blob, 0, sizeof(blob));
+  blob.version = ALARM_NVS_VERSION;
+  blob.channel_count = KC868_A16_ANALOG_INPUT_COUNT;
+  memcpy(blob.alarms, alarms, sizeof(blob.alarms));
+
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(ALARM_NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    return err;
+  }
+  err = nvs_set_blob(handle, ALARM_NVS_KEY, &blob, sizeof(blob));
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  return err;
+}
+
+EipStatus KC868_A16_AlarmSetConfig(const KC868_A16_AnalogAlarm *alarms) {
+  const char *error = KC868_A16_AlarmValidateConfig(alarms);
+  if (NULL != error) {
+    ESP_LOGW(TAG_ALARM, "Alarm configuration rejected: %s", error);
+    return kEipStatusError;
+  }
+  /* Every Forward_Open with configuration data ends up here, only a new
+   * configuration costs a flash write */
+  if (!PostConfig(alarms)) {
+    return kEipStatusOk;
+  }
+  esp_err_t err = StoreConfig(alarms);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG_ALARM, "Failed to store the alarm configuration: %s",
+             esp_err_to_name(err));
+    return kEipStatusError;
+  }
+  return kEipStatusOk;
+}
+
+void KC868_A16_AlarmInitialize(void) {
+  /* Until a configuration is stored no alarm is checked */
+  KC868_A16_AnalogAlarm alarms[KC868_A16_ANALOG_INPUT_COUNT];
+  memset(alarms, 0, sizeof(alarms));
+  AlarmNvBlob blob;
+  size_t length = sizeof(blob);
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(ALARM_NVS_NAMESPACE, NVS_READONLY, &handle);
+  if (err == ESP_OK) {
+    err = nvs_get_blob(handle, ALARM_NVS_KEY, &blob, &length);
+    nvs_close(handle);
+  }
+  if (err == ESP_OK) {
+    KC868_A16_AnalogAlarm stored[KC868_A16_ANALOG_INPUT_COUNT];
+    memcpy(stored, blob.alarms, sizeof(stored));
+    if (length != sizeof(blob) || blob.version != ALARM_NVS_VERSION ||
+        blob.channel_count != KC868_A16_ANALOG_INPUT_COUNT ||
+        NULL != KC868_A16_AlarmValidateConfig(stored)) {
+      ESP_LOGW(TAG_ALARM, "Ignoring invalid stored alarm configuration");
+    } else {
+      memcpy(alarms, stored, sizeof(alarms));
+      ESP_LOGI(TAG_ALARM, "Loaded the analog alarm configuration");
+    }
+  }
+  taskENTER_CRITICAL(&s_configured_lock);
+  memcpy(s_configured, alarms, sizeof(s_configured));
+  taskEXIT_CRITICAL(&s_configured_lock);
+  __atomic_store_n(&s_configured_pending, true, __ATOMIC_RELEASE);
+}
+
+/* Set at or beyond the limit, clear once back past it by the hysteresis;
+ * direction is 1 for the high limits and -1 for the low ones */
+static CipByte LimitAlarm(CipByte status, CipByte bit, int32_t value,
+                          int32_t limit, int32_t hysteresis, int32_t direction) {
+  const int32_t excess = (value - limit) * direction;
+  if (excess >= 0) {
+    return (CipByte)(status | bit);
+  }
+  if (-excess > hysteresis) {
+    return (CipByte)(status & ~bit);
+  }
+  return status;
+}
+
+/* Set at or above the rate limit, clear below 7/8 of it */
+static CipByte RateAlarm(CipByte status, CipByte bit, int64_t rate,
+                         int64_t limit) {
+  if (rate >= limit) {
+    return (CipByte)(status | bit);
+  }
+  if (rate * 8 < limit * 7) {
+    return (CipByte)(status & ~bit);
+  }
+  return status;
+}
+
+static CipByte RateAlarms(const KC868_A16_AnalogAlarm *alarm,
+                          AlarmRateHistory *history, CipByte status,
+                          int32_t value, int64_t now_us) {
+  const int64_t step_us = (int64_t)alarm->rate_window_ms * 1000 /
+                          ALARM_RATE_STEPS;
+  const size_t newest = (history->next + ALARM_RATE_STEPS - 1) %
+                        ALARM_RATE_STEPS;
+  if (0 == history->count || now_us - history->time_us[newest] >= step_us) {
+    history->value[history->next] = value;
+    history->time_us[history->next] = now_us;
+    history->next = (history->next + 1) % ALARM_RATE_STEPS;
+    if (history->count < ALARM_RATE_STEPS) {
+      history->count++;
+    }
+  }
+  if (history->count < ALARM_RATE_STEPS) {
+    return status;
+  }
+  const int64_t elapsed_us = now_us - history->time_us[history->next];
+  if (elapsed_us <= 0) {
+    return status;
+  }
+  const int64_t rate = (int64_t)(value - history->value[history->next]) *
+                       1000000 / elapsed_us;
+  if (alarm->enable & KC868_A16_ALARM_RATE_RISING) {
+    status = RateAlarm(status, KC868_A16_ALARM_RATE_RISING, rate, alarm->rate);
+  }
+  if (alarm->enable & KC868_A16_ALARM_RATE_FALLING) {
+    status = RateAlarm(status, KC868_A16_ALARM_RATE_FALLING, -rate,
+                       alarm->rate);
+  }
+  return status;
+}
+
+bool KC868_A16_AlarmProcess(const EipUint8 *image, int64_t now_us) {
+  if (__atomic_exchange_n(&s_configured_pending, false, __ATOMIC_ACQUIRE)) {
+    KC868_A16_AlarmGetConfig(s_alarms);
+    memset(s_history, 0, sizeof(s_history));
+  }
+
+  uint32_t status = 0;
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    const KC868_A16_AnalogAlarm *const alarm = &s_alarms[channel_index];
+    const size_t offset = KC868_A16_INPUT_ANALOG_START_OFFSET +
+                          channel_index * KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL;
+    const int32_t value = (int32_t)(image[offset] | (image[offset + 1] << 8));
+    CipByte bits = (CipByte)((s_scan_status >> (8 * channel_index)) &
+                             alarm->enable);
+    if (alarm->enable & KC868_A16_ALARM_LO_LO) {
+      bits = LimitAlarm(bits, KC868_A16_ALARM_LO_LO, value, alarm->lo_lo,
+                        alarm->hysteresis, -1);
+    }
+    if (alarm->enable & KC868_A16_ALARM_LO) {
+      bits = LimitAlarm(bits, KC868_A16_ALARM_LO, value, alarm->lo,
+                        alarm->hysteresis, -1);
+    }
+    if (alarm->enable & KC868_A16_ALARM_HI) {
+      bits = LimitAlarm(bits, KC868_A16_ALARM_HI, value, alarm->hi,
+                        alarm->hysteresis, 1);
+    }
+    if (alarm->enable & KC868_A16_ALARM_HI_HI) {
+      bits = LimitAlarm(bits, KC868_A16_ALARM_HI_HI, value, alarm->hi_hi,
+                        alarm->hysteresis, 1);
+    }
+    if (alarm->enable & ALARM_RATE_BITS) {
+      bits = RateAlarms(alarm, &s_history[channel_index], bits, value, now_us);
+    }
+    status |= (uint32_t)bits << (8 * channel_index);
+  }
+
+  if (status == s_scan_status) {
+    return false;
+  }
+  s_scan_status = status;
+  __atomic_store_n(&s_status, status, __ATOMIC_RELEASE);
+  return true;
+}
+
+uint32_t KC868_A16_AlarmGetStatus(void) {
+  return __atomic_load_n(&s_status, __ATOMIC_ACQUIRE);
+}
+
+#endif /* CONFIG_KC868_ANALOG_ALARMS */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_ALARM_H_
+#define KC868_A16_ALARM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "kc868_a16_io.h"
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_alarm.h
+ *  @brief Limit and rate of change alarms of the analog inputs
+ *
+ *  Selected with CONFIG_KC868_ANALOG_ALARMS. The I/O scan task checks every
+ *  sample of A1-A4, in counts or mV like the input image, against four
+ *  limits and a rate of change:
+ *  - lo-lo and lo are set at or below their limit and clear above it plus
+ *    the hysteresis, hi and hi-hi the other way round
+ *  - the rising and falling rate alarms compare the change over the rate
+ *    window, in units per second, with the rate limit and clear below 7/8
+ *    of it
+ *  The window is followed in eight steps, so the rate is taken over 7/8 to
+ *  all of it and is known one window after start or a new configuration.
+ *
+ *  The alarm bits go out in input assemblies 100 and 104, a change of one
+ *  raises the change-of-state flag. The configuration is stored in NVS and
+ *  is part of the configuration assembly 151; it is only written to NVS
+ *  when it changed.
+ */
+
+#if CONFIG_KC868_ANALOG_ALARMS
+
+/* Alarm bits of a channel, also the enable flags of its configuration */
+#define KC868_A16_ALARM_LO_LO        0x01
+#define KC868_A16_ALARM_LO           0x02
+#define KC868_A16_ALARM_HI           0x04
+#define KC868_A16_ALARM_HI_HI        0x08
+#define KC868_A16_ALARM_RATE_RISING  0x10
+#define KC868_A16_ALARM_RATE_FALLING 0x20
+#define KC868_A16_ALARM_ALL          0x3F
+
+/** Size of the configuration of one channel on the wire */
+#define KC868_A16_ANALOG_ALARM_SIZE 15
+
+/** @brief Alarms of one channel, on the wire in this order, little endian */
+typedef struct {
+  CipByte enable; /**< KC868_A16_ALARM_* bits of the alarms checked */
+  CipUint lo_lo; /**< limits in the units of the input image */
+  CipUint lo;
+  CipUint hi;
+  CipUint hi_hi;
+  CipUint hysteresis; /**< of the limits */
+  CipUint rate; /**< rate limit in units per second */
+  CipUint rate_window_ms; /**< at least 8 with a rate alarm enabled */
+} KC868_A16_AnalogAlarm;
+
+/** @brief Load the configuration from NVS, before the I/O scan starts */
+void KC868_A16_AlarmInitialize(void);
+
+/** @brief Check a new input sample, I/O scan task only
+ *
+ *  Picks up a configuration applied since the previous call first.
+ *
+ *  @param image KC868_A16_INPUT_IMAGE_SIZE bytes of the scan image
+ *  @param now_us esp_timer time of the sample
+ *  @return true if an alarm bit changed
+ */
+bool KC868_A16_AlarmProcess(const EipUint8 *image, int64_t now_us);
+
+/** @brief Alarm bits of all channels, byte n = channel n+1, any task */
+uint32_t KC868_A16_AlarmGetStatus(void);
+
+/** @brief Copy the configuration of all channels
+ *
+ *  @param alarms KC868_A16_ANALOG_INPUT_COUNT entries, A1 first
+ */
+void KC868_A16_AlarmGetConfig(KC868_A16_AnalogAlarm *alarms);
+
+/** @brief Check a configuration without applying it
+ *
+ *  @return NULL if it is valid, else a description of the error
+ */
+const char *KC868_A16_AlarmValidateConfig(const KC868_A16_AnalogAlarm *alarms);
+
+/** @brief Apply a valid configuration and store it in NVS if it changed
+ *
+ *  May be called from any task, not from an interrupt.
+ *
+ *  @param alarms KC868_A16_ANALOG_INPUT_COUNT entries, A1 first
+ *  @return kEipStatusOk, or kEipStatusError if the configuration is invalid
+ *          or could not be stored; an invalid one is not applied
+ */
+EipStatus KC868_A16_AlarmSetConfig(const KC868_A16_AnalogAlarm *alarms);
+
+#endif /* CONFIG_KC868_ANALOG_ALARMS */
+
+#endif /* KC868_A16_ALARM_H_ */
@@ -21,6 +21,8 @@
  */
 
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "opener_api.h"
 #include "appcontype.h"
@@ -28,325 +30,1102 @@
 #include "cipidentity.h"
 #include "ciptcpipinterface.h"
 #include "cipqos.h"
+#include "nvqos.h"
 #include "cipstring.h"
 #include "ciptypes.h"
 #include "typedefs.h"
-#include "esp_adc/adc_oneshot.h"
-#include "driver/gpio.h"
-#include "esp_log.h"
-#include "esp_err.h"
-#include "freertos/FreeRTOS.h"
-#include "i2c_manager.h"
-#include "pcf8574.h"
+#include "kc868_a16_application.h"
+#include "kc868_a16_assembly_map.h"
+#include "kc868_a16_io.h"
+#include "kc868_a16_soe.h"
+#include "kc868_a16_history.h"
+#include "kc868_a16_mqtt.h"
+#include "kc868_a16_snmp.h"
+#include "kc868_a16_modbus.h"
+#include "kc868_a16_peer.h"
+#include "kc868_a16_pcnt.h"
+#include "kc868_a16_sensor.h"
+#include "kc868_a16_logic.h"
+#include "kc868_a16_scaling.h"
+#include "kc868_a16_debounce.h"
+#include "kc868_a16_relay_timer.h"
+#include "kc868_a16_relay_count.h"
+#include "kc868_a16_alarm.h"
+#include "kc868_a16_expansion.h"
+#include "kc868_a16_modbus_rtu.h"
+#include "cipassembly.h"
+#include "cipconnectionmanager.h"
+#include "cipethernetlink.h"
+#include "generic_networkhandler.h"
+#include "eth_media_counters.h"
+#include "loop_profile.h"
+#include "wcet_profile.h"
+#include "benchmark.h"
+#include "cip_arena.h"
+#include "heap_class.h"
+#include "app_scheduler.h"
+#include "overload_governor.h"
+#if CONFIG_OPENER_PTP_TIME_SYNC
+#include "ptp_clock.h"
+#endif
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+#include "esp_timer.h"
+#if !CONFIG_OPENER_PTP_TIME_SYNC
+#include "sntp_clock.h"
+#endif
+#endif
+#if CONFIG_OPENER_TASK_TELEMETRY
+#include "task_telemetry.h"
+#endif
+#if CONFIG_OPENER_EDS_FILE
+#include "eds_file.h"
+#endif
 
 struct netif;
 
-#define DEMO_APP_INPUT_ASSEMBLY_NUM                100
-#define DEMO_APP_OUTPUT_ASSEMBLY_NUM               150
-#define DEMO_APP_CONFIG_ASSEMBLY_NUM               151
-
-#define OUTPUT_ASSEMBLY_SIZE                      2
-#define CONFIG_ASSEMBLY_SIZE                      0
-#define DIGITAL_INPUT_BYTES                       2
-#define ANALOG_INPUT_COUNT                        4
-#define ANALOG_INPUT_BYTES_PER_CHANNEL            2
-#define INPUT_ANALOG_START_OFFSET                 DIGITAL_INPUT_BYTES
-#define INPUT_ASSEMBLY_SIZE                       (DIGITAL_INPUT_BYTES + \
-                                                   (ANALOG_INPUT_COUNT * \
-                                                    ANALOG_INPUT_BYTES_PER_CHANNEL))
-
-#define I2C_SDA_GPIO            4
-#define I2C_SCL_GPIO            5
-#define I2C_FREQ_HZ             400000
-
-#define PCF8574_ADDR_INPUTS_1_8  0x22
-#define PCF8574_ADDR_INPUTS_9_16 0x21
-#define PCF8574_ADDR_OUTPUTS_1_8 0x24
-#define PCF8574_ADDR_OUTPUTS_9_16 0x25
-
-#define ANALOG_A1  36  /* Physical terminal A1 - INA1 (4-20mA) */
-#define ANALOG_A2  34  /* Physical terminal A2 - INA2 (0-5V) */
-#define ANALOG_A3  35  /* Physical terminal A3 - INA3 (0-5V) */
-#define ANALOG_A4  39  /* Physical terminal A4 - INA4 (4-20mA) */
-
-static const adc_channel_t kAnalogChannels[ANALOG_INPUT_COUNT] = {
-  ADC_CHANNEL_0,  /* GPIO36 - A1/INA1 (4-20mA) */
-  ADC_CHANNEL_6,  /* GPIO34 - A2/INA2 (0-5V) */
-  ADC_CHANNEL_7,  /* GPIO35 - A3/INA3 (0-5V) */
-  ADC_CHANNEL_3,  /* GPIO39 - A4/INA4 (4-20mA) */
-};
-
-static const char *TAG_IO = "kc868_io";
-
-static EipUint8 s_input_assembly_data[INPUT_ASSEMBLY_SIZE];
+#define DEMO_APP_OUTPUT_ASSEMBLY_NUM               KC868_A16_OUTPUT_ASSEMBLY_NUM
+#define DEMO_APP_CONFIG_ASSEMBLY_NUM               KC868_A16_CONFIG_ASSEMBLY_NUM
+#define DEMO_APP_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM  KC868_A16_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM
+#define DEMO_APP_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM KC868_A16_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM
+
+#define OUTPUT_ASSEMBLY_SIZE                      KC868_A16_ASSEMBLY_SIZE(KC868_A16_MAP_OUTPUT)
+#define CONFIG_ASSEMBLY_SIZE                      KC868_A16_ASSEMBLY_SIZE(KC868_A16_MAP_CONFIG)
+/* The Apply At time follows the relays in the output assembly */
+#define OUTPUT_ASSEMBLY_APPLY_AT_OFFSET           KC868_A16_OUTPUT_IMAGE_SIZE
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+#define OUTPUT_ASSEMBLY_APPLY_AT_SIZE             kKc868FieldSizeApplyAt
+#else
+#define OUTPUT_ASSEMBLY_APPLY_AT_SIZE             0
+#endif
+/* Offsets in the safe state of the fault and the idle mode, which follow
+ * each other in the configuration assembly */
+#define CONFIG_ASSEMBLY_PRESET_OFFSET             KC868_A16_OUTPUT_COUNT
+#define CONFIG_ASSEMBLY_HOLD_OFFSET               (CONFIG_ASSEMBLY_PRESET_OFFSET + 2)
+#define CONFIG_ASSEMBLY_SAFE_STATE_SIZE           (CONFIG_ASSEMBLY_HOLD_OFFSET + 2)
+#define CONFIG_ASSEMBLY_FAULT_OFFSET              0
+#define CONFIG_ASSEMBLY_IDLE_OFFSET               CONFIG_ASSEMBLY_SAFE_STATE_SIZE
+/* Followed by the calibration of the analog channels, A1 first */
+#define CONFIG_ASSEMBLY_SCALING_OFFSET            (2 * CONFIG_ASSEMBLY_SAFE_STATE_SIZE)
+#if CONFIG_KC868_ANALOG_SCALING
+#define CONFIG_ASSEMBLY_SCALING_SIZE              (KC868_A16_ANALOG_INPUT_COUNT * \
+                                                   KC868_A16_ANALOG_SCALING_SIZE)
+#else
+#define CONFIG_ASSEMBLY_SCALING_SIZE              0
+#endif
+/* Then the debounce times of the digital inputs, X01 first */
+#define CONFIG_ASSEMBLY_DEBOUNCE_OFFSET           (CONFIG_ASSEMBLY_SCALING_OFFSET + \
+                                                   CONFIG_ASSEMBLY_SCALING_SIZE)
+#if CONFIG_KC868_INPUT_DEBOUNCE
+#define CONFIG_ASSEMBLY_DEBOUNCE_SIZE             KC868_A16_INPUT_DEBOUNCE_SIZE
+#else
+#define CONFIG_ASSEMBLY_DEBOUNCE_SIZE             0
+#endif
+/* Then the alarms of the analog channels, A1 first */
+#define CONFIG_ASSEMBLY_ALARM_OFFSET              (CONFIG_ASSEMBLY_DEBOUNCE_OFFSET + \
+                                                   CONFIG_ASSEMBLY_DEBOUNCE_SIZE)
+#if CONFIG_KC868_ANALOG_ALARMS
+#define CONFIG_ASSEMBLY_ALARM_SIZE                (KC868_A16_ANALOG_INPUT_COUNT * \
+                                                   KC868_A16_ANALOG_ALARM_SIZE)
+#else
+#define CONFIG_ASSEMBLY_ALARM_SIZE                0
+#endif
+
+_Static_assert(OUTPUT_ASSEMBLY_SIZE ==
+               OUTPUT_ASSEMBLY_APPLY_AT_OFFSET + OUTPUT_ASSEMBLY_APPLY_AT_SIZE,
+               "output assembly map does not match the output image and the apply at time");
+_Static_assert(CONFIG_ASSEMBLY_SIZE ==
+               CONFIG_ASSEMBLY_ALARM_OFFSET + CONFIG_ASSEMBLY_ALARM_SIZE,
+               "configuration assembly map does not match the safe states, calibration, debounce times and alarms");
+
 static EipUint8 s_output_assembly_data[OUTPUT_ASSEMBLY_SIZE];
-static EipUint8 s_config_assembly_data[1];  /* Minimal config assembly */
-static bool s_pcf8574_initialized = false;
-static bool s_adc_initialized = false;
-static adc_oneshot_unit_handle_t s_adc_handle = NULL;
-static pcf8574_handle_t s_pcf8574_inputs_1_8 = NULL;
-static pcf8574_handle_t s_pcf8574_inputs_9_16 = NULL;
-static pcf8574_handle_t s_pcf8574_outputs_1_8 = NULL;
-static pcf8574_handle_t s_pcf8574_outputs_9_16 = NULL;
-
-static void InitializeI2C(void) {
-  if (s_pcf8574_initialized) {
-    return;
+static EipUint8 s_config_assembly_data[CONFIG_ASSEMBLY_SIZE];
+/* Configuration the safe states were last taken from */
+static EipUint8 s_applied_config_data[CONFIG_ASSEMBLY_SIZE];
+/* Members of the assemblies, for Get_Member and Set_Member per field */
+static const EipUint16 s_output_member_sizes[] =
+  KC868_A16_MEMBER_SIZES(KC868_A16_MAP_OUTPUT);
+static const EipUint16 s_config_member_sizes[] =
+  KC868_A16_MEMBER_SIZES(KC868_A16_MAP_CONFIG);
+
+/* Relays follow the output assembly in the run mode, else the I/O task
+ * holds their safe state; both only touched with the stack lock held */
+static KC868_A16_OutputMode s_output_mode = kKc868OutputModeIdle;
+static bool s_showing_safe_image = false;
+
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+/* Output assembly last handed to the I/O task with a time; the PLC repeats
+ * image and time every RPI, and a repeat after the time would be late */
+static EipUint8 s_scheduled_output_data[OUTPUT_ASSEMBLY_SIZE];
+static bool s_scheduled_output_valid = false;
+#endif
+
+#if CONFIG_KC868_EXPANSION
+#define EXPANSION_INPUT_ASSEMBLY_NUM  KC868_A16_EXPANSION_INPUT_ASSEMBLY_NUM
+#define EXPANSION_OUTPUT_ASSEMBLY_NUM KC868_A16_EXPANSION_OUTPUT_ASSEMBLY_NUM
+
+/* Created with the sizes of the devices found at boot */
+static EipUint8 s_expansion_input_data[KC868_A16_EXPANSION_STATUS_SIZE +
+                                       KC868_A16_EXPANSION_MAX_IMAGE_BYTES];
+static EipUint8 s_expansion_packed_data[sizeof(s_expansion_input_data)];
+static EipUint8 s_expansion_output_data[KC868_A16_EXPANSION_MAX_IMAGE_BYTES];
+/* As s_output_mode, for the owner of the expansion output assembly */
+static KC868_A16_OutputMode s_expansion_output_mode = kKc868OutputModeIdle;
+#endif
+
+#if CONFIG_KC868_MODBUS_RTU
+#define MODBUS_RTU_INPUT_ASSEMBLY_NUM  KC868_A16_MODBUS_RTU_INPUT_ASSEMBLY_NUM
+#define MODBUS_RTU_OUTPUT_ASSEMBLY_NUM KC868_A16_MODBUS_RTU_OUTPUT_ASSEMBLY_NUM
+
+/* Created with the sizes of the poll table */
+static EipUint8 s_modbus_rtu_input_data[KC868_A16_MODBUS_RTU_STATUS_SIZE +
+                                        KC868_A16_MODBUS_RTU_MAX_IMAGE_BYTES];
+static EipUint8 s_modbus_rtu_packed_data[sizeof(s_modbus_rtu_input_data)];
+static EipUint8 s_modbus_rtu_output_data[KC868_A16_MODBUS_RTU_MAX_IMAGE_BYTES];
+/* As s_output_mode, for the owner of the Modbus RTU output assembly */
+static KC868_A16_OutputMode s_modbus_rtu_output_mode = kKc868OutputModeIdle;
+#endif
+
+static inline void PutLittleEndian(EipUint8 *data, EipUint64 value, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    data[i] = (EipUint8)(value >> (8 * i));
   }
+}
 
-  // Initialize I2C manager
-  esp_err_t ret = i2c_manager_init(I2C_SDA_GPIO, I2C_SCL_GPIO, I2C_FREQ_HZ);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG_IO, "Failed to initialize I2C manager: %s", esp_err_to_name(ret));
-    return;
+static bool DecodeOutputSafeState(const EipUint8 *data,
+                                  KC868_A16_OutputSafeState *safe_state) {
+  for (size_t output = 0; output < KC868_A16_OUTPUT_COUNT; ++output) {
+    if (data[output] > kKc868OutputActionHoldThenClear) {
+      return false;
+    }
+    safe_state->action[output] = data[output];
   }
+  safe_state->preset = (CipWord)(data[CONFIG_ASSEMBLY_PRESET_OFFSET] |
+                                 (data[CONFIG_ASSEMBLY_PRESET_OFFSET + 1] << 8));
+  safe_state->hold_ms = (CipUint)(data[CONFIG_ASSEMBLY_HOLD_OFFSET] |
+                                  (data[CONFIG_ASSEMBLY_HOLD_OFFSET + 1] << 8));
+  return true;
+}
 
-  // Scan for PCF8574 devices
-  const uint8_t expected_addresses[] = {
-    PCF8574_ADDR_INPUTS_1_8,
-    PCF8574_ADDR_INPUTS_9_16,
-    PCF8574_ADDR_OUTPUTS_1_8,
-    PCF8574_ADDR_OUTPUTS_9_16,
-  };
-  const char *device_names[] = {
-    "Inputs X01-X08",
-    "Inputs X09-X16",
-    "Outputs Y01-Y08",
-    "Outputs Y09-Y16",
-  };
+#if CONFIG_KC868_ANALOG_SCALING
+static void DecodeAnalogScaling(const EipUint8 *data,
+                                KC868_A16_AnalogScaling *scaling) {
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    scaling[channel_index].range = data[0];
+    scaling[channel_index].input_low = (CipUint)(data[1] | (data[2] << 8));
+    scaling[channel_index].input_high = (CipUint)(data[3] | (data[4] << 8));
+    scaling[channel_index].value_low = (CipInt)(data[5] | (data[6] << 8));
+    scaling[channel_index].value_high = (CipInt)(data[7] | (data[8] << 8));
+    data += KC868_A16_ANALOG_SCALING_SIZE;
+  }
+}
 
-  ESP_LOGI(TAG_IO, "Checking PCF8574 device presence...");
-  size_t num_found = 0;
-  uint8_t found_addresses[4] = {0};
-  ret = pcf8574_scan(expected_addresses, sizeof(expected_addresses), found_addresses, &num_found);
-  if (ret == ESP_OK) {
-    for (size_t i = 0; i < sizeof(expected_addresses); i++) {
-      bool found = false;
-      for (size_t j = 0; j < num_found; j++) {
-        if (found_addresses[j] == expected_addresses[i]) {
-          ESP_LOGI(TAG_IO, "  [OK] PCF8574 at 0x%02X - %s", expected_addresses[i], device_names[i]);
-          found = true;
-          break;
-        }
-      }
-      if (!found) {
-        ESP_LOGW(TAG_IO, "  [FAIL] PCF8574 at 0x%02X - %s not found", expected_addresses[i], device_names[i]);
-      }
-    }
-    ESP_LOGI(TAG_IO, "PCF8574 scan complete: %zu/%zu devices found", num_found, sizeof(expected_addresses));
+static void EncodeAnalogScaling(const KC868_A16_AnalogScaling *scaling,
+                                EipUint8 *data) {
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    data[0] = scaling[channel_index].range;
+    PutLittleEndian(data + 1, scaling[channel_index].input_low, 2);
+    PutLittleEndian(data + 3, scaling[channel_index].input_high, 2);
+    PutLittleEndian(data + 5, (CipUint)scaling[channel_index].value_low, 2);
+    PutLittleEndian(data + 7, (CipUint)scaling[channel_index].value_high, 2);
+    data += KC868_A16_ANALOG_SCALING_SIZE;
   }
+}
+#endif
 
-  // Initialize PCF8574 devices
-  pcf8574_config_t config = {
-    .freq_hz = I2C_FREQ_HZ,
-  };
+#if CONFIG_KC868_ANALOG_ALARMS
+static void DecodeAnalogAlarms(const EipUint8 *data,
+                               KC868_A16_AnalogAlarm *alarms) {
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    alarms[channel_index].enable = data[0];
+    alarms[channel_index].lo_lo = (CipUint)(data[1] | (data[2] << 8));
+    alarms[channel_index].lo = (CipUint)(data[3] | (data[4] << 8));
+    alarms[channel_index].hi = (CipUint)(data[5] | (data[6] << 8));
+    alarms[channel_index].hi_hi = (CipUint)(data[7] | (data[8] << 8));
+    alarms[channel_index].hysteresis = (CipUint)(data[9] | (data[10] << 8));
+    alarms[channel_index].rate = (CipUint)(data[11] | (data[12] << 8));
+    alarms[channel_index].rate_window_ms = (CipUint)(data[13] | (data[14] << 8));
+    data += KC868_A16_ANALOG_ALARM_SIZE;
+  }
+}
 
-  config.address = PCF8574_ADDR_INPUTS_1_8;
-  ret = pcf8574_init(&config, &s_pcf8574_inputs_1_8);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG_IO, "Failed to initialize PCF8574 inputs_1_8 (0x%02X): %s", 
-             PCF8574_ADDR_INPUTS_1_8, esp_err_to_name(ret));
-    return;
+static void EncodeAnalogAlarms(const KC868_A16_AnalogAlarm *alarms,
+                               EipUint8 *data) {
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    data[0] = alarms[channel_index].enable;
+    PutLittleEndian(data + 1, alarms[channel_index].lo_lo, 2);
+    PutLittleEndian(data + 3, alarms[channel_index].lo, 2);
+    PutLittleEndian(data + 5, alarms[channel_index].hi, 2);
+    PutLittleEndian(data + 7, alarms[channel_index].hi_hi, 2);
+    PutLittleEndian(data + 9, alarms[channel_index].hysteresis, 2);
+    PutLittleEndian(data + 11, alarms[channel_index].rate, 2);
+    PutLittleEndian(data + 13, alarms[channel_index].rate_window_ms, 2);
+    data += KC868_A16_ANALOG_ALARM_SIZE;
   }
+}
+#endif
 
-  config.address = PCF8574_ADDR_INPUTS_9_16;
-  ret = pcf8574_init(&config, &s_pcf8574_inputs_9_16);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG_IO, "Failed to initialize PCF8574 inputs_9_16 (0x%02X): %s", 
-             PCF8574_ADDR_INPUTS_9_16, esp_err_to_name(ret));
-    return;
+/* Hand the configuration assembly to the I/O task, invalid data is refused
+ * and the previous safe states, calibration, debounce times and alarms stay
+ * in use */
+static EipStatus ApplyConfigAssembly(void) {
+  KC868_A16_OutputSafeStates safe_states;
+  if (!DecodeOutputSafeState(s_config_assembly_data + CONFIG_ASSEMBLY_FAULT_OFFSET,
+                             &safe_states.fault) ||
+      !DecodeOutputSafeState(s_config_assembly_data + CONFIG_ASSEMBLY_IDLE_OFFSET,
+                             &safe_states.idle)) {
+    OPENER_TRACE_WARN("Invalid output action in the configuration assembly\n");
+    return kEipStatusError;
+  }
+#if CONFIG_KC868_ANALOG_SCALING
+  KC868_A16_AnalogScaling scaling[KC868_A16_ANALOG_INPUT_COUNT];
+  DecodeAnalogScaling(s_config_assembly_data + CONFIG_ASSEMBLY_SCALING_OFFSET,
+                      scaling);
+  if (NULL != KC868_A16_ScalingValidateConfig(scaling)) {
+    OPENER_TRACE_WARN("Invalid analog calibration in the configuration assembly\n");
+    return kEipStatusError;
+  }
+#endif
+#if CONFIG_KC868_ANALOG_ALARMS
+  KC868_A16_AnalogAlarm alarms[KC868_A16_ANALOG_INPUT_COUNT];
+  DecodeAnalogAlarms(s_config_assembly_data + CONFIG_ASSEMBLY_ALARM_OFFSET,
+                     alarms);
+  if (NULL != KC868_A16_AlarmValidateConfig(alarms)) {
+    OPENER_TRACE_WARN("Invalid analog alarms in the configuration assembly\n");
+    return kEipStatusError;
   }
+#endif
+#if CONFIG_KC868_ANALOG_SCALING
+  /* Valid, so a failure only means it is lost at the next power cycle */
+  (void)KC868_A16_ScalingSetConfig(scaling);
+#endif
+#if CONFIG_KC868_INPUT_DEBOUNCE
+  /* Any time is valid, and applied even if it could not be stored */
+  KC868_A16_InputDebounce debounce;
+  memcpy(debounce.time_ms, s_config_assembly_data + CONFIG_ASSEMBLY_DEBOUNCE_OFFSET,
+         sizeof(debounce.time_ms));
+  (void)KC868_A16_DebounceSetConfig(&debounce);
+#endif
+#if CONFIG_KC868_ANALOG_ALARMS
+  (void)KC868_A16_AlarmSetConfig(alarms);
+#endif
+  memcpy(s_applied_config_data, s_config_assembly_data,
+         sizeof(s_applied_config_data));
+  KC868_A16_IoSetOutputSafeStates(&safe_states);
+  return kEipStatusOk;
+}
 
-  config.address = PCF8574_ADDR_OUTPUTS_1_8;
-  ret = pcf8574_init(&config, &s_pcf8574_outputs_1_8);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG_IO, "Failed to initialize PCF8574 outputs_1_8 (0x%02X): %s", 
-             PCF8574_ADDR_OUTPUTS_1_8, esp_err_to_name(ret));
+static void InitializeConfigAssembly(void) {
+#if CONFIG_KC868_OUTPUT_SAFE_STATE_CLEAR
+  const EipUint8 action = kKc868OutputActionClear;
+#else
+  const EipUint8 action = kKc868OutputActionHold;
+#endif
+  memset(s_config_assembly_data, 0, sizeof(s_config_assembly_data));
+  memset(s_config_assembly_data + CONFIG_ASSEMBLY_FAULT_OFFSET, action,
+         KC868_A16_OUTPUT_COUNT);
+  memset(s_config_assembly_data + CONFIG_ASSEMBLY_IDLE_OFFSET, action,
+         KC868_A16_OUTPUT_COUNT);
+#if CONFIG_KC868_ANALOG_SCALING
+  /* The calibration loaded from NVS */
+  KC868_A16_AnalogScaling scaling[KC868_A16_ANALOG_INPUT_COUNT];
+  KC868_A16_ScalingGetConfig(scaling);
+  EncodeAnalogScaling(scaling,
+                      s_config_assembly_data + CONFIG_ASSEMBLY_SCALING_OFFSET);
+#endif
+#if CONFIG_KC868_INPUT_DEBOUNCE
+  /* The debounce times loaded from NVS */
+  KC868_A16_InputDebounce debounce;
+  KC868_A16_DebounceGetConfig(&debounce);
+  memcpy(s_config_assembly_data + CONFIG_ASSEMBLY_DEBOUNCE_OFFSET,
+         debounce.time_ms, sizeof(debounce.time_ms));
+#endif
+#if CONFIG_KC868_ANALOG_ALARMS
+  /* The alarms loaded from NVS */
+  KC868_A16_AnalogAlarm alarms[KC868_A16_ANALOG_INPUT_COUNT];
+  KC868_A16_AlarmGetConfig(alarms);
+  EncodeAnalogAlarms(alarms,
+                     s_config_assembly_data + CONFIG_ASSEMBLY_ALARM_OFFSET);
+#endif
+  (void)ApplyConfigAssembly();
+}
+
+static void SetOutputMode(KC868_A16_OutputMode mode) {
+  s_output_mode = mode;
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+  /* The mode drops a waiting image, the next one is posted again */
+  s_scheduled_output_valid = false;
+#endif
+  KC868_A16_IoSetOutputMode(mode);
+}
+
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+/* esp_timer time of an Apply At, from the offset of the clock now. Both
+ * clocks run on esp_timer, so the offset holds while the image waits */
+static int64_t GetScheduledOutputLocalTime(CipUlint apply_at_ns) {
+  const int64_t now_us = esp_timer_get_time();
+#if CONFIG_OPENER_PTP_TIME_SYNC
+  const int64_t ahead_ns = (int64_t)(apply_at_ns - PtpClockFromLocalTime(now_us));
+  return now_us + ahead_ns / 1000;
+#else
+  return now_us + ((int64_t)(apply_at_ns / 1000) - SntpClockFromLocalTime(now_us));
+#endif
+}
+#endif
+
+/* Hand the relays of the output assembly to the I/O task, at their Apply
+ * At time if they have one */
+static void PostOutputAssembly(void) {
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+  CipUlint apply_at_ns = 0;
+  for (size_t i = 0; i < OUTPUT_ASSEMBLY_APPLY_AT_SIZE; ++i) {
+    apply_at_ns |= (CipUlint)s_output_assembly_data[OUTPUT_ASSEMBLY_APPLY_AT_OFFSET + i]
+                   << (8 * i);
+  }
+  if (0 != apply_at_ns) {
+    if (s_scheduled_output_valid &&
+        0 == memcmp(s_scheduled_output_data, s_output_assembly_data,
+                    sizeof(s_scheduled_output_data))) {
+      return;
+    }
+    memcpy(s_scheduled_output_data, s_output_assembly_data,
+           sizeof(s_scheduled_output_data));
+    s_scheduled_output_valid = true;
+    KC868_A16_IoPostScheduledOutputImage(s_output_assembly_data,
+                                         GetScheduledOutputLocalTime(apply_at_ns));
     return;
   }
+  s_scheduled_output_valid = false;
+#endif
+  KC868_A16_IoPostOutputImage(s_output_assembly_data);
+}
 
-  config.address = PCF8574_ADDR_OUTPUTS_9_16;
-  ret = pcf8574_init(&config, &s_pcf8574_outputs_9_16);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG_IO, "Failed to initialize PCF8574 outputs_9_16 (0x%02X): %s", 
-             PCF8574_ADDR_OUTPUTS_9_16, esp_err_to_name(ret));
+/* Mirror the relays the I/O task switched to a safe state into the output
+ * assembly, so the web UI shows them and starts from them */
+static void ShowSafeImage(void) {
+  /* Shown with an Apply At of 0 */
+  EipUint8 image[OUTPUT_ASSEMBLY_SIZE] = { 0 };
+  if (!KC868_A16_IoTakeSafeImage(image)) {
     return;
   }
+  CipInstance *const instance =
+    GetCipInstance(GetAssemblyClass(),
+                   DEMO_APP_OUTPUT_ASSEMBLY_NUM);
+  if (NULL == instance) {
+    return;
+  }
+  s_showing_safe_image = true;
+  (void)NotifyAssemblyConnectedDataReceived(instance, image, sizeof(image));
+  s_showing_safe_image = false;
+}
 
-  s_pcf8574_initialized = true;
-  ESP_LOGI(TAG_IO, "PCF8574 devices initialized successfully");
+/* Sources of the input assembly fields, each read at most once per
+ * production so that all fields of an assembly come from the same sample */
+typedef enum {
+  kFieldSourceUnread = 0,
+  kFieldSourceValid,
+  kFieldSourceBusy, /**< the writer was busy, the fields keep their data */
+} FieldSourceState;
 
-  // Initialize all PCF8574 outputs to 0xFF (all relays OFF - active low)
-  uint8_t init_value = 0xFF;
-  pcf8574_write(s_pcf8574_inputs_1_8, init_value);
-  pcf8574_write(s_pcf8574_inputs_9_16, init_value);
-  ret = pcf8574_write(s_pcf8574_outputs_1_8, init_value);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG_IO, "Failed to initialize outputs_1_8: %s", esp_err_to_name(ret));
+typedef struct {
+  FieldSourceState image_state;
+  EipUint8 image[KC868_A16_INPUT_IMAGE_SIZE];
+#if CONFIG_KC868_LOGIC
+  bool logic_read;
+  uint32_t logic_status;
+#endif
+#if CONFIG_KC868_ANALOG_ALARMS
+  bool alarms_read;
+  uint32_t alarm_status;
+#endif
+#if CONFIG_OPENER_PTP_TIME_SYNC
+  FieldSourceState edges_state;
+  KC868_A16_InputEdges edges;
+#endif
+#if CONFIG_KC868_PCNT
+  FieldSourceState counters_state;
+  KC868_A16_PcntValues counters;
+#endif
+#if CONFIG_KC868_ANALOG_SCALING
+  FieldSourceState scaled_state;
+  KC868_A16_ScaledAnalogs scaled;
+#endif
+#if CONFIG_KC868_SENSORS
+  FieldSourceState sensors_state;
+  KC868_A16_SensorValues sensors;
+#endif
+} FieldSources;
+
+static const EipUint8 *GetInputImage(FieldSources *sources) {
+  if (kFieldSourceUnread == sources->image_state) {
+    sources->image_state = KC868_A16_IoGetInputImage(sources->image) ?
+                           kFieldSourceValid : kFieldSourceBusy;
   }
-  ret = pcf8574_write(s_pcf8574_outputs_9_16, init_value);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG_IO, "Failed to initialize outputs_9_16: %s", esp_err_to_name(ret));
+  return (kFieldSourceValid == sources->image_state) ? sources->image : NULL;
+}
+
+/* Packers of the field kinds, see kc868_a16_assembly_map.h */
+static inline void PackFieldDigitalInputs(EipUint8 *data, unsigned int argument,
+                                          FieldSources *sources) {
+  (void) argument;
+  const EipUint8 *const image = GetInputImage(sources);
+  if (NULL != image) {
+    memcpy(data, image, KC868_A16_DIGITAL_INPUT_BYTES);
   }
 }
 
-static void InitializeAdc(void) {
-  if (s_adc_initialized) {
-    return;
+static inline void PackFieldAnalogRaw(EipUint8 *data, unsigned int argument,
+                                      FieldSources *sources) {
+  const EipUint8 *const image = GetInputImage(sources);
+  if (NULL != image) {
+    memcpy(data, image + KC868_A16_INPUT_ANALOG_START_OFFSET +
+           argument * KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL,
+           KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL);
   }
+}
 
-  adc_oneshot_unit_init_cfg_t unit_cfg = {
-    .unit_id = ADC_UNIT_1,
-    .ulp_mode = ADC_ULP_MODE_DISABLE,
-  };
-  if (adc_oneshot_new_unit(&unit_cfg, &s_adc_handle) != ESP_OK) {
-    s_adc_handle = NULL;
-    return;
+static inline void PackFieldRelayOutputs(EipUint8 *data, unsigned int argument,
+                                         FieldSources *sources) {
+  (void) argument;
+  (void) sources;
+  /* Holds the relays' safe state as well, see ShowSafeImage() */
+  memcpy(data, s_output_assembly_data, OUTPUT_ASSEMBLY_SIZE);
+}
+
+static inline void PackFieldOutputMode(EipUint8 *data, unsigned int argument,
+                                       FieldSources *sources) {
+  (void) argument;
+  (void) sources;
+  data[0] = (EipUint8)s_output_mode;
+}
+
+static inline void PackFieldExpanderStatus(EipUint8 *data,
+                                           unsigned int argument,
+                                           FieldSources *sources) {
+  (void) argument;
+  (void) sources;
+  data[0] = KC868_A16_IoGetStatus();
+}
+
+#if CONFIG_KC868_LOGIC
+static uint32_t GetLogicStatus(FieldSources *sources) {
+  if (!sources->logic_read) {
+    sources->logic_status = KC868_A16_LogicGetStatus();
+    sources->logic_read = true;
   }
+  return sources->logic_status;
+}
 
-  adc_oneshot_chan_cfg_t chan_cfg = {
-    .atten = ADC_ATTEN_DB_12,
-    .bitwidth = ADC_BITWIDTH_12,
-  };
-  
-  for (size_t channel_index = 0; channel_index < ANALOG_INPUT_COUNT;
-       ++channel_index) {
-    if (adc_oneshot_config_channel(s_adc_handle,
-                                   kAnalogChannels[channel_index],
-                                   &chan_cfg) != ESP_OK) {
-      ESP_LOGE(TAG_IO, "Failed to configure ADC channel %zu", channel_index);
-      adc_oneshot_del_unit(s_adc_handle);
-      s_adc_handle = NULL;
-      return;
-    }
+static inline void PackFieldLogicResults(EipUint8 *data, unsigned int argument,
+                                         FieldSources *sources) {
+  (void) argument;
+  PutLittleEndian(data, GetLogicStatus(sources) & 0xFFFFU, 2);
+}
+
+static inline void PackFieldLogicForced(EipUint8 *data, unsigned int argument,
+                                        FieldSources *sources) {
+  (void) argument;
+  PutLittleEndian(data, GetLogicStatus(sources) >> 16, 2);
+}
+#endif
+
+#if CONFIG_KC868_ANALOG_ALARMS
+static inline void PackFieldAnalogAlarms(EipUint8 *data, unsigned int argument,
+                                         FieldSources *sources) {
+  if (!sources->alarms_read) {
+    sources->alarm_status = KC868_A16_AlarmGetStatus();
+    sources->alarms_read = true;
   }
+  data[0] = (EipUint8)(sources->alarm_status >> (8 * argument));
+}
+#endif
 
-  s_adc_initialized = true;
+#if CONFIG_OPENER_PTP_TIME_SYNC
+/* Without a consistent copy the edge fields keep the previous edges, the
+ * image may already show the new edge */
+static const KC868_A16_InputEdges *GetInputEdges(FieldSources *sources) {
+  if (kFieldSourceUnread == sources->edges_state) {
+    sources->edges_state = KC868_A16_IoGetInputEdges(&sources->edges) ?
+                           kFieldSourceValid : kFieldSourceBusy;
+  }
+  return (kFieldSourceValid == sources->edges_state) ? &sources->edges : NULL;
 }
 
-static void StoreAnalogValue(size_t channel_index, uint16_t value) {
-  size_t offset = INPUT_ANALOG_START_OFFSET +
-                  (channel_index * ANALOG_INPUT_BYTES_PER_CHANNEL);
-  s_input_assembly_data[offset] = (uint8_t)(value & 0xFF);
-  s_input_assembly_data[offset + 1] = (uint8_t)(value >> 8);
+static inline void PackFieldEdgeSynchronized(EipUint8 *data,
+                                             unsigned int argument,
+                                             FieldSources *sources) {
+  (void) argument;
+  const KC868_A16_InputEdges *const edges = GetInputEdges(sources);
+  if (NULL != edges) {
+    PutLittleEndian(data, edges->synchronized, 2);
+  }
 }
 
-static void UpdateInputs(void) {
-  if (!s_pcf8574_initialized) {
-    s_input_assembly_data[0] = 0;
-    s_input_assembly_data[1] = 0;
-  } else {
-    uint8_t input_1_8 = 0xFF;
-    if (pcf8574_read(s_pcf8574_inputs_1_8, &input_1_8) == ESP_OK) {
-      s_input_assembly_data[0] = (uint8_t)~input_1_8;
-    } else {
-      s_input_assembly_data[0] = 0;
-    }
+static inline void PackFieldEdgeCount(EipUint8 *data, unsigned int argument,
+                                      FieldSources *sources) {
+  (void) argument;
+  const KC868_A16_InputEdges *const edges = GetInputEdges(sources);
+  if (NULL != edges) {
+    PutLittleEndian(data, edges->edge_count, 4);
+  }
+}
 
-    uint8_t input_9_16 = 0xFF;
-    if (pcf8574_read(s_pcf8574_inputs_9_16, &input_9_16) == ESP_OK) {
-      s_input_assembly_data[1] = (uint8_t)~input_9_16;
-    } else {
-      s_input_assembly_data[1] = 0;
-    }
+static inline void PackFieldEdgeTime(EipUint8 *data, unsigned int argument,
+                                     FieldSources *sources) {
+  const KC868_A16_InputEdges *const edges = GetInputEdges(sources);
+  if (NULL != edges) {
+    PutLittleEndian(data, edges->edge_time_ns[argument], 8);
+  }
+}
+#endif
+
+#if CONFIG_KC868_PCNT
+static const KC868_A16_PcntValues *GetCounters(FieldSources *sources) {
+  if (kFieldSourceUnread == sources->counters_state) {
+    sources->counters_state = KC868_A16_PcntGetValues(&sources->counters) ?
+                              kFieldSourceValid : kFieldSourceBusy;
   }
+  return (kFieldSourceValid == sources->counters_state) ?
+         &sources->counters : NULL;
+}
 
-  if (!s_adc_initialized) {
-    for (size_t channel_index = 0; channel_index < ANALOG_INPUT_COUNT;
-         ++channel_index) {
-      StoreAnalogValue(channel_index, 0);
-    }
+static inline void PackFieldCounterCount(EipUint8 *data, unsigned int argument,
+                                         FieldSources *sources) {
+  const KC868_A16_PcntValues *const counters = GetCounters(sources);
+  if (NULL != counters) {
+    PutLittleEndian(data, (EipUint32)counters->count[argument], 4);
+  }
+}
+
+static inline void PackFieldCounterFrequency(EipUint8 *data,
+                                             unsigned int argument,
+                                             FieldSources *sources) {
+  const KC868_A16_PcntValues *const counters = GetCounters(sources);
+  if (NULL != counters) {
+    PutLittleEndian(data, counters->frequency_mhz[argument], 4);
+  }
+}
+#endif
+
+#if CONFIG_KC868_SENSORS
+static const KC868_A16_SensorValues *GetSensorValues(FieldSources *sources) {
+  if (kFieldSourceUnread == sources->sensors_state) {
+    sources->sensors_state = KC868_A16_SensorGetValues(&sources->sensors) ?
+                             kFieldSourceValid : kFieldSourceBusy;
+  }
+  return (kFieldSourceValid == sources->sensors_state) ?
+         &sources->sensors : NULL;
+}
+
+static inline void PackFieldSensorTemperature(EipUint8 *data,
+                                              unsigned int argument,
+                                              FieldSources *sources) {
+  const KC868_A16_SensorValues *const sensors = GetSensorValues(sources);
+  if (NULL != sensors) {
+    PutLittleEndian(data, (CipUint)sensors->temperature_dc[argument], 2);
+  }
+}
+
+static inline void PackFieldSensorHumidity(EipUint8 *data,
+                                           unsigned int argument,
+                                           FieldSources *sources) {
+  const KC868_A16_SensorValues *const sensors = GetSensorValues(sources);
+  if (NULL != sensors) {
+    PutLittleEndian(data, sensors->humidity_dpm[argument], 2);
+  }
+}
+
+static inline void PackFieldSensorStatus(EipUint8 *data, unsigned int argument,
+                                         FieldSources *sources) {
+  (void) argument;
+  const KC868_A16_SensorValues *const sensors = GetSensorValues(sources);
+  if (NULL != sensors) {
+    data[0] = sensors->status;
+  }
+}
+#endif
+
+#if CONFIG_KC868_ANALOG_SCALING
+static const KC868_A16_ScaledAnalogs *GetScaledAnalogs(FieldSources *sources) {
+  if (kFieldSourceUnread == sources->scaled_state) {
+    sources->scaled_state = KC868_A16_IoGetScaledAnalogs(&sources->scaled) ?
+                            kFieldSourceValid : kFieldSourceBusy;
+  }
+  return (kFieldSourceValid == sources->scaled_state) ? &sources->scaled : NULL;
+}
+
+static inline void PackFieldAnalogScaled(EipUint8 *data, unsigned int argument,
+                                         FieldSources *sources) {
+  const KC868_A16_ScaledAnalogs *const scaled = GetScaledAnalogs(sources);
+  if (NULL != scaled) {
+    PutLittleEndian(data, (CipUint)scaled->value[argument], 2);
+  }
+}
+
+static inline void PackFieldAnalogStatus(EipUint8 *data, unsigned int argument,
+                                         FieldSources *sources) {
+  const KC868_A16_ScaledAnalogs *const scaled = GetScaledAnalogs(sources);
+  if (NULL != scaled) {
+    data[0] = scaled->status[argument];
+  }
+}
+#endif
+
+/* One buffer and one packing function with constant offsets per input
+ * assembly of the map. The packer compares the result with the last packed
+ * data, so the Class 1 sequence count only advances on new data */
+#define PACK_FIELD(kind, argument) \
+  PackField##kind(data + offset, (argument), sources); \
+  offset += kKc868FieldSize##kind;
+
+#define DEFINE_INPUT_ASSEMBLY(name, instance, eds_name, fields, points, \
+                              rpi_us) \
+  static EipUint8 s_##name##_assembly_data[KC868_A16_ASSEMBLY_SIZE(fields)]; \
+  static EipUint8 s_##name##_packed_data[KC868_A16_ASSEMBLY_SIZE(fields)]; \
+  static const EipUint16 s_##name##_member_sizes[] = \
+    KC868_A16_MEMBER_SIZES(fields); \
+  static bool Pack##name##Assembly(FieldSources *sources) { \
+    EipUint8 *const data = s_##name##_assembly_data; \
+    size_t offset = 0; \
+    fields(PACK_FIELD) \
+    (void) offset; \
+    if (0 == memcmp(data, s_##name##_packed_data, sizeof(s_##name##_packed_data))) { \
+      return false; \
+    } \
+    memcpy(s_##name##_packed_data, data, sizeof(s_##name##_packed_data)); \
+    return true; \
+  }
+KC868_A16_INPUT_ASSEMBLIES(DEFINE_INPUT_ASSEMBLY)
+
+/* Per input assembly steps of the stack callbacks */
+#define CREATE_INPUT_ASSEMBLY(name, instance, eds_name, fields, points, \
+                              rpi_us) \
+  (void)SetAssemblyMembers(CreateAssemblyObject(instance, \
+                                                s_##name##_assembly_data, \
+                                                sizeof(s_##name##_assembly_data)), \
+                           s_##name##_member_sizes, \
+                           sizeof(s_##name##_member_sizes) / sizeof(EipUint16));
+#define CONFIGURE_INPUT_ASSEMBLY(name, instance, eds_name, fields, points, \
+                                 rpi_us) \
+  ConfigureInputConnectionPoints(&connection_points, \
+                                 DEMO_APP_OUTPUT_ASSEMBLY_NUM, instance, points);
+#define TRIGGER_INPUT_ASSEMBLY(name, instance, eds_name, fields, points, \
+                               rpi_us) \
+  TriggerInputConnections(DEMO_APP_OUTPUT_ASSEMBLY_NUM, instance, points);
+#define PACK_INPUT_ASSEMBLY(name, instance, eds_name, fields, points, \
+                            rpi_us) \
+  case instance: \
+    data_changed = Pack##name##Assembly(&sources); \
+    break;
+
+/* Next connection point of each type */
+typedef struct {
+  unsigned int exclusive_owner;
+  unsigned int input_only;
+  unsigned int listen_only;
+} ConnectionPointNumbers;
+
+/* The next connection points of the KC868_A16_POINT_* types in points for
+ * an input assembly; beyond the configured number of points of a type
+ * they are not connectable */
+static void ConfigureInputConnectionPoints(ConnectionPointNumbers *numbers,
+                                           unsigned int output_assembly,
+                                           unsigned int input_assembly,
+                                           unsigned int points) {
+  if (0 != (points & KC868_A16_POINT_EXCLUSIVE_OWNER)) {
+    ConfigureExclusiveOwnerConnectionPoint(numbers->exclusive_owner++,
+                                           output_assembly, input_assembly,
+                                           DEMO_APP_CONFIG_ASSEMBLY_NUM);
+  }
+  if (0 != (points & KC868_A16_POINT_INPUT_ONLY)) {
+    ConfigureInputOnlyConnectionPoint(numbers->input_only++,
+                                      DEMO_APP_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM,
+                                      input_assembly,
+                                      DEMO_APP_CONFIG_ASSEMBLY_NUM);
+  }
+  if (0 != (points & KC868_A16_POINT_LISTEN_ONLY)) {
+    ConfigureListenOnlyConnectionPoint(numbers->listen_only++,
+                                       DEMO_APP_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM,
+                                       input_assembly,
+                                       DEMO_APP_CONFIG_ASSEMBLY_NUM);
+  }
+}
+
+/* Change of state and application triggered connections of an input
+ * assembly. Input only connections consume the heartbeat assembly, listen
+ * only connections share the production of another connection. */
+static void TriggerInputConnections(unsigned int output_assembly,
+                                    unsigned int input_assembly,
+                                    unsigned int points) {
+  if (0 != (points & KC868_A16_POINT_EXCLUSIVE_OWNER)) {
+    TriggerConnections(output_assembly, input_assembly);
+  }
+  if (0 != (points & KC868_A16_POINT_INPUT_ONLY)) {
+    TriggerConnections(DEMO_APP_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM,
+                       input_assembly);
+  }
+}
+
+#if CONFIG_KC868_EXPANSION
+/* The expansion assemblies and their points after those of the map; the
+ * exclusive owner needs output pins */
+static void CreateExpansionAssemblies(ConnectionPointNumbers *numbers) {
+  const size_t input_size = KC868_A16_ExpansionInputImageSize();
+  if (0 == input_size) {
     return;
   }
+  (void)KC868_A16_ExpansionGetInputImage(s_expansion_input_data);
+  memcpy(s_expansion_packed_data, s_expansion_input_data, input_size);
+  CreateAssemblyObject(EXPANSION_INPUT_ASSEMBLY_NUM, s_expansion_input_data,
+                       input_size);
+  const size_t output_size = KC868_A16_ExpansionOutputImageSize();
+  if (0 != output_size) {
+    CreateAssemblyObject(EXPANSION_OUTPUT_ASSEMBLY_NUM,
+                         s_expansion_output_data, output_size);
+  }
+  ConfigureInputConnectionPoints(numbers, EXPANSION_OUTPUT_ASSEMBLY_NUM,
+                                 EXPANSION_INPUT_ASSEMBLY_NUM,
+                                 (0 != output_size) ? KC868_A16_POINTS_ALL :
+                                 KC868_A16_POINTS_MONITOR);
+  if ((0 != output_size &&
+       numbers->exclusive_owner > CONFIG_OPENER_NUM_EXCLUSIVE_OWNER_CONNS) ||
+      numbers->input_only > CONFIG_OPENER_NUM_INPUT_ONLY_CONNS ||
+      numbers->listen_only > CONFIG_OPENER_NUM_LISTEN_ONLY_CONNS) {
+    OPENER_TRACE_WARN("Expansion assemblies need exclusive owner point %u, "
+                      "input only and listen only points %u and %u, raise "
+                      "the number of connection points\n",
+                      numbers->exclusive_owner, numbers->input_only,
+                      numbers->listen_only);
+  }
+}
 
-  for (size_t channel_index = 0; channel_index < ANALOG_INPUT_COUNT;
-       ++channel_index) {
-    int raw_value = 0;
-    if (adc_oneshot_read(s_adc_handle, kAnalogChannels[channel_index],
-                         &raw_value) != ESP_OK) {
-      raw_value = 0;
-    }
-    if (raw_value < 0) {
-      raw_value = 0;
-    }
-    StoreAnalogValue(channel_index, (uint16_t)raw_value);
+static bool PackExpansionAssembly(void) {
+  const size_t size = KC868_A16_ExpansionInputImageSize();
+  if (!KC868_A16_ExpansionGetInputImage(s_expansion_input_data) ||
+      0 == memcmp(s_expansion_input_data, s_expansion_packed_data, size)) {
+    return false;
   }
+  memcpy(s_expansion_packed_data, s_expansion_input_data, size);
+  return true;
 }
 
-static void UpdateOutputs(void) {
-  if (!s_pcf8574_initialized) {
-    ESP_LOGW(TAG_IO, "UpdateOutputs called but PCF8574 not initialized");
+static void SetExpansionOutputMode(KC868_A16_OutputMode mode) {
+  s_expansion_output_mode = mode;
+  KC868_A16_ExpansionSetOutputMode(mode);
+}
+#endif
+
+#if CONFIG_KC868_MODBUS_RTU
+/* The Modbus RTU assemblies and their points after the expansion ones; the
+ * exclusive owner needs write entries */
+static void CreateModbusRtuAssemblies(ConnectionPointNumbers *numbers) {
+  const size_t input_size = KC868_A16_ModbusRtuInputImageSize();
+  if (0 == input_size) {
     return;
   }
+  (void)KC868_A16_ModbusRtuGetInputImage(s_modbus_rtu_input_data);
+  memcpy(s_modbus_rtu_packed_data, s_modbus_rtu_input_data, input_size);
+  CreateAssemblyObject(MODBUS_RTU_INPUT_ASSEMBLY_NUM, s_modbus_rtu_input_data,
+                       input_size);
+  const size_t output_size = KC868_A16_ModbusRtuOutputImageSize();
+  if (0 != output_size) {
+    CreateAssemblyObject(MODBUS_RTU_OUTPUT_ASSEMBLY_NUM,
+                         s_modbus_rtu_output_data, output_size);
+  }
+  ConfigureInputConnectionPoints(numbers, MODBUS_RTU_OUTPUT_ASSEMBLY_NUM,
+                                 MODBUS_RTU_INPUT_ASSEMBLY_NUM,
+                                 (0 != output_size) ? KC868_A16_POINTS_ALL :
+                                 KC868_A16_POINTS_MONITOR);
+  if ((0 != output_size &&
+       numbers->exclusive_owner > CONFIG_OPENER_NUM_EXCLUSIVE_OWNER_CONNS) ||
+      numbers->input_only > CONFIG_OPENER_NUM_INPUT_ONLY_CONNS ||
+      numbers->listen_only > CONFIG_OPENER_NUM_LISTEN_ONLY_CONNS) {
+    OPENER_TRACE_WARN("Modbus RTU assemblies need exclusive owner point %u, "
+                      "input only and listen only points %u and %u, raise "
+                      "the number of connection points\n",
+                      numbers->exclusive_owner, numbers->input_only,
+                      numbers->listen_only);
+  }
+}
 
-  uint8_t outputs_1_8 = (uint8_t)~s_output_assembly_data[0];
-  esp_err_t ret = pcf8574_write(s_pcf8574_outputs_1_8, outputs_1_8);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG_IO, "Failed to write outputs_1_8 (0x%02X): %s", outputs_1_8, esp_err_to_name(ret));
+static bool PackModbusRtuAssembly(void) {
+  const size_t size = KC868_A16_ModbusRtuInputImageSize();
+  if (!KC868_A16_ModbusRtuGetInputImage(s_modbus_rtu_input_data) ||
+      0 == memcmp(s_modbus_rtu_input_data, s_modbus_rtu_packed_data, size)) {
+    return false;
   }
+  memcpy(s_modbus_rtu_packed_data, s_modbus_rtu_input_data, size);
+  return true;
+}
 
-  uint8_t outputs_9_16 = (uint8_t)~s_output_assembly_data[1];
-  ret = pcf8574_write(s_pcf8574_outputs_9_16, outputs_9_16);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG_IO, "Failed to write outputs_9_16 (0x%02X): %s", outputs_9_16, esp_err_to_name(ret));
+/* Outside the run mode the master stops writing, the slaves keep the
+ * values last written */
+static void SetModbusRtuOutputMode(KC868_A16_OutputMode mode) {
+  s_modbus_rtu_output_mode = mode;
+  if (kKc868OutputModeRun != mode) {
+    KC868_A16_ModbusRtuHoldOutputs();
   }
 }
+#endif
+
+#if CONFIG_KC868_SNMP
+static void OverloadStageChanged(const OverloadStage stage) {
+  KC868_A16_SnmpSetPaused(stage >= kOverloadStageServices);
+}
+#endif
 
 EipStatus ApplicationInitialization(void) {
-  InitializeI2C();
-  InitializeAdc();
-
-  CreateAssemblyObject(DEMO_APP_OUTPUT_ASSEMBLY_NUM, s_output_assembly_data,
-                       OUTPUT_ASSEMBLY_SIZE);
-
-  CreateAssemblyObject(DEMO_APP_INPUT_ASSEMBLY_NUM, s_input_assembly_data,
-                       INPUT_ASSEMBLY_SIZE);
-
-  CreateAssemblyObject(DEMO_APP_CONFIG_ASSEMBLY_NUM, s_config_assembly_data,
-                       CONFIG_ASSEMBLY_SIZE);
-
-  ConfigureExclusiveOwnerConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
-                                        DEMO_APP_INPUT_ASSEMBLY_NUM,
-                                        DEMO_APP_CONFIG_ASSEMBLY_NUM);
-  ConfigureInputOnlyConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
-                                    DEMO_APP_INPUT_ASSEMBLY_NUM,
-                                    DEMO_APP_CONFIG_ASSEMBLY_NUM);
-  ConfigureListenOnlyConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
-                                     DEMO_APP_INPUT_ASSEMBLY_NUM,
-                                     DEMO_APP_CONFIG_ASSEMBLY_NUM);
+  KC868_A16_IoInitialize();
+#if OPENER_LOOP_PROFILE
+  LoopProfileCreateCipObject();
+#endif
+#if OPENER_WCET_PROFILE
+  WcetProfileCreateCipObject();
+#endif
+#if CONFIG_OPENER_PTP_TIME_SYNC
+  PtpClockCreateCipObject();
+#endif
+#if CONFIG_OPENER_TASK_TELEMETRY
+  TaskTelemetryCreateCipObject();
+#endif
+#if CONFIG_OPENER_EDS_FILE
+  EdsFileCreateCipObject();
+#endif
+#if CONFIG_KC868_SOE_BUFFER
+  KC868_A16_SoeCreateCipObject();
+#endif
+#if CONFIG_KC868_LOGIC
+  KC868_A16_LogicCreateCipObject();
+#endif
+#if CONFIG_KC868_RELAY_TIMERS
+  KC868_A16_RelayTimerCreateCipObject();
+#endif
+#if CONFIG_KC868_RELAY_COUNTERS
+  KC868_A16_RelayCountCreateCipObject();
+#endif
+#if CONFIG_KC868_MQTT
+  KC868_A16_MqttStart();
+#endif
+#if CONFIG_KC868_SNMP
+  KC868_A16_SnmpStart();
+  OverloadGovernorSetStageCallback(OverloadStageChanged);
+#endif
+#if CONFIG_KC868_MODBUS
+  KC868_A16_ModbusStart();
+#endif
+#if CONFIG_KC868_PEER
+  KC868_A16_PeerStart();
+#endif
+#if CONFIG_KC868_MODBUS_RTU
+  KC868_A16_ModbusRtuStart();
+#endif
+#if CONFIG_KC868_SENSORS
+  KC868_A16_SensorStart();
+#endif
+
+  (void)SetAssemblyMembers(CreateAssemblyObject(DEMO_APP_OUTPUT_ASSEMBLY_NUM,
+                                                s_output_assembly_data,
+                                                OUTPUT_ASSEMBLY_SIZE),
+                           s_output_member_sizes,
+                           sizeof(s_output_member_sizes) / sizeof(EipUint16));
+
+  KC868_A16_INPUT_ASSEMBLIES(CREATE_INPUT_ASSEMBLY)
+
+  InitializeConfigAssembly();
+  (void)SetAssemblyMembers(CreateAssemblyObject(DEMO_APP_CONFIG_ASSEMBLY_NUM,
+                                                s_config_assembly_data,
+                                                CONFIG_ASSEMBLY_SIZE),
+                           s_config_member_sizes,
+                           sizeof(s_config_member_sizes) / sizeof(EipUint16));
+
+  /* Zero sized O->T points of the input only and listen only connections */
+  CreateAssemblyObject(DEMO_APP_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM, NULL, 0);
+  CreateAssemblyObject(DEMO_APP_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM, NULL, 0);
+
+  /* Input assemblies take the connection points in the order of the map */
+  ConnectionPointNumbers connection_points = { 0 };
+  KC868_A16_INPUT_ASSEMBLIES(CONFIGURE_INPUT_ASSEMBLY)
+#if CONFIG_KC868_EXPANSION
+  CreateExpansionAssemblies(&connection_points);
+#endif
+#if CONFIG_KC868_MODBUS_RTU
+  CreateModbusRtuAssemblies(&connection_points);
+#endif
+  /* The EDS declares the 32-bit run/idle header of the exclusive owner */
+#if CONFIG_KC868_RUN_IDLE_HEADER
+  CipRunIdleHeaderSetO2T(true);
+#else
   CipRunIdleHeaderSetO2T(false);
+#endif
   CipRunIdleHeaderSetT2O(false);
 
   return kEipStatusOk;
 }
 
 void HandleApplication(void) {
+  /* Outside the profiled part, it calls AfterAssemblyDataReceived() */
+  ShowSafeImage();
+  OPENER_LOOP_PROFILE_BEGIN(application_start);
+  /* Change of state / application triggered connections on the input
+   * assembly produce as soon as their production inhibit time allows;
+   * cyclic connections ignore the trigger. */
+  if (KC868_A16_IoTakeInputChange()) {
+    KC868_A16_INPUT_ASSEMBLIES(TRIGGER_INPUT_ASSEMBLY)
+#if CONFIG_KC868_EXPANSION
+    TriggerInputConnections(EXPANSION_OUTPUT_ASSEMBLY_NUM,
+                            EXPANSION_INPUT_ASSEMBLY_NUM, KC868_A16_POINTS_ALL);
+#endif
+  }
+#if CONFIG_KC868_MODBUS_RTU
+  /* Responses arrive at the pace of the bus, not of the I/O scan */
+  if (KC868_A16_ModbusRtuTakeInputChange()) {
+    TriggerInputConnections(MODBUS_RTU_OUTPUT_ASSEMBLY_NUM,
+                            MODBUS_RTU_INPUT_ASSEMBLY_NUM, KC868_A16_POINTS_ALL);
+  }
+#endif
+  OPENER_LOOP_PROFILE_END(kLoopProfilePhaseApplication, application_start);
 }
 
 void CheckIoConnectionEvent(unsigned int output_assembly_id,
                             unsigned int input_assembly_id,
                             IoConnectionEvent io_connection_event) {
-  (void) output_assembly_id;
   (void) input_assembly_id;
-  (void) io_connection_event;
+  AppSchedulerSignal(kAppSchedulerEventConnectionState);
+#if CONFIG_KC868_HISTORY
+  /* Any timed out connection, also one of the input only assemblies */
+  if (kIoConnectionEventTimedOut == io_connection_event) {
+    KC868_A16_HistoryTrigger(kKc868HistoryTriggerTimeout);
+  }
+#endif
+#if CONFIG_KC868_EXPANSION
+  if (output_assembly_id == EXPANSION_OUTPUT_ASSEMBLY_NUM) {
+    switch (io_connection_event) {
+      case kIoConnectionEventOpened:
+        SetExpansionOutputMode(CipRunIdleHeaderGetO2T() ? kKc868OutputModeIdle :
+                               kKc868OutputModeRun);
+        break;
+      case kIoConnectionEventTimedOut:
+        SetExpansionOutputMode(kKc868OutputModeFault);
+        break;
+      case kIoConnectionEventClosed:
+        SetExpansionOutputMode(kKc868OutputModeIdle);
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+#endif
+#if CONFIG_KC868_MODBUS_RTU
+  if (output_assembly_id == MODBUS_RTU_OUTPUT_ASSEMBLY_NUM) {
+    switch (io_connection_event) {
+      case kIoConnectionEventOpened:
+        SetModbusRtuOutputMode(CipRunIdleHeaderGetO2T() ?
+                               kKc868OutputModeIdle : kKc868OutputModeRun);
+        break;
+      case kIoConnectionEventTimedOut:
+        SetModbusRtuOutputMode(kKc868OutputModeFault);
+        break;
+      case kIoConnectionEventClosed:
+        SetModbusRtuOutputMode(kKc868OutputModeIdle);
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+#endif
+  if (output_assembly_id != DEMO_APP_OUTPUT_ASSEMBLY_NUM) {
+    return;
+  }
+  switch (io_connection_event) {
+    case kIoConnectionEventOpened:
+      /* With a run/idle header the relays wait for the first run packet */
+      SetOutputMode(CipRunIdleHeaderGetO2T() ? kKc868OutputModeIdle :
+                    kKc868OutputModeRun);
+      break;
+    case kIoConnectionEventTimedOut:
+      SetOutputMode(kKc868OutputModeFault);
+      break;
+    case kIoConnectionEventClosed:
+      SetOutputMode(kKc868OutputModeIdle);
+      break;
+    default:
+      break;
+  }
 }
 
 EipStatus AfterAssemblyDataReceived(CipInstance *instance) {
+  OPENER_LOOP_PROFILE_BEGIN(application_start);
+  EipStatus status = kEipStatusOk;
   if (instance->instance_number == DEMO_APP_OUTPUT_ASSEMBLY_NUM) {
-    UpdateOutputs();
-    UpdateInputs();
+    /* Data of an idle scanner and the mirrored safe image are not posted;
+     * the web UI only writes while no connection owns the outputs */
+    if (!s_showing_safe_image &&
+        (kKc868OutputModeRun == s_output_mode ||
+         !KC868_A16_ApplicationOutputsOwned())) {
+      PostOutputAssembly();
+    }
+    AppSchedulerSignal(kAppSchedulerEventOutputReceived);
+#if CONFIG_KC868_EXPANSION
+  } else if (instance->instance_number == EXPANSION_OUTPUT_ASSEMBLY_NUM) {
+    if (kKc868OutputModeRun == s_expansion_output_mode ||
+        !IsConnectedOutputAssembly(EXPANSION_OUTPUT_ASSEMBLY_NUM)) {
+      KC868_A16_ExpansionPostOutputImage(s_expansion_output_data);
+    }
+    AppSchedulerSignal(kAppSchedulerEventOutputReceived);
+#endif
+#if CONFIG_KC868_MODBUS_RTU
+  } else if (instance->instance_number == MODBUS_RTU_OUTPUT_ASSEMBLY_NUM) {
+    /* The master reads the assembly itself, it only needs the go ahead */
+    if (kKc868OutputModeRun == s_modbus_rtu_output_mode ||
+        !IsConnectedOutputAssembly(MODBUS_RTU_OUTPUT_ASSEMBLY_NUM)) {
+      KC868_A16_ModbusRtuReleaseOutputs();
+    }
+    AppSchedulerSignal(kAppSchedulerEventOutputReceived);
+#endif
+  } else if (instance->instance_number == DEMO_APP_CONFIG_ASSEMBLY_NUM) {
+    status = ApplyConfigAssembly();
+    if (kEipStatusOk != status) {
+      /* Read back the configuration still in use */
+      (void)NotifyAssemblyConnectedDataReceived(instance, s_applied_config_data,
+                                                sizeof(s_applied_config_data));
+    }
   }
-  return kEipStatusOk;
+  OPENER_LOOP_PROFILE_END(kLoopProfilePhaseApplication, application_start);
+  return status;
 }
 
 EipBool8 BeforeAssemblyDataSend(CipInstance *instance) {
-  if (instance->instance_number == DEMO_APP_INPUT_ASSEMBLY_NUM) {
-    UpdateInputs();
+  OPENER_LOOP_PROFILE_BEGIN(application_start);
+  FieldSources sources = { .image_state = kFieldSourceUnread };
+  bool data_changed = false;
+  switch (instance->instance_number) {
+    KC868_A16_INPUT_ASSEMBLIES(PACK_INPUT_ASSEMBLY)
+#if CONFIG_KC868_EXPANSION
+    case EXPANSION_INPUT_ASSEMBLY_NUM:
+      data_changed = PackExpansionAssembly();
+      break;
+#endif
+#if CONFIG_KC868_MODBUS_RTU
+    case MODBUS_RTU_INPUT_ASSEMBLY_NUM:
+      data_changed = PackModbusRtuAssembly();
+      break;
+#endif
+    default:
+      break;
   }
-  return true;
+  OPENER_LOOP_PROFILE_END(kLoopProfilePhaseApplication, application_start);
+  return data_changed;
 }
 
 EipStatus ResetDevice(void) {
+#if CONFIG_KC868_RELAY_COUNTERS
+  (void)KC868_A16_RelayCountFlush();
+#endif
   CloseAllConnections();
   CipQosUpdateUsedSetQosValues();
   return kEipStatusOk;
@@ -355,20 +1134,94 @@ EipStatus ResetDevice(void) {
 EipStatus ResetDeviceToInitialConfiguration(void) {
   g_tcpip.encapsulation_inactivity_timeout = 120;
   CipQosResetAttributesToDefaultValues();
+  (void)NvQosStore(&g_qos);
+#if CONFIG_KC868_RELAY_COUNTERS
+  /* The counts belong to the relays, not to the configuration */
+  (void)KC868_A16_RelayCountFlush();
+#endif
   CloseAllConnections();
   return kEipStatusOk;
 }
 
 void* CipCalloc(size_t number_of_elements, size_t size_of_element) {
-  return calloc(number_of_elements, size_of_element);
+#if OPENER_BENCHMARK
+  BenchmarkCountAllocation(number_of_elements * size_of_element);
+#endif
+#if CONFIG_OPENER_CIP_ARENA
+  return CipArenaCalloc(number_of_elements, size_of_element);
+#else
+  return heap_class_calloc(HEAP_CLASS_NETWORK, number_of_elements,
+                           size_of_element);
+#endif
 }
 
 void CipFree(void *data) {
-  free(data);
+#if CONFIG_OPENER_CIP_ARENA
+  CipArenaFree(data);
+#else
+  heap_class_free(HEAP_CLASS_NETWORK, data);
+#endif
 }
 
 void RunIdleChanged(EipUint32 run_idle_value) {
-  (void) run_idle_value;
+  AppSchedulerSignal(kAppSchedulerEventRunIdle);
+  const KC868_A16_OutputMode mode = (run_idle_value & 0x0001U) ?
+                                    kKc868OutputModeRun : kKc868OutputModeIdle;
+  /* The stack derives one run/idle state from all owners, it applies to all */
+#if CONFIG_KC868_EXPANSION
+  if (IsConnectedOutputAssembly(EXPANSION_OUTPUT_ASSEMBLY_NUM)) {
+    SetExpansionOutputMode(mode);
+  }
+#endif
+#if CONFIG_KC868_MODBUS_RTU
+  if (IsConnectedOutputAssembly(MODBUS_RTU_OUTPUT_ASSEMBLY_NUM)) {
+    SetModbusRtuOutputMode(mode);
+  }
+#endif
+#if CONFIG_KC868_EXPANSION || CONFIG_KC868_MODBUS_RTU
+  if (!IsConnectedOutputAssembly(DEMO_APP_OUTPUT_ASSEMBLY_NUM)) {
+    return;
+  }
+#endif
+  /* Only the exclusive owner of the output assembly consumes data */
+  SetOutputMode(mode);
+}
+
+bool KC868_A16_ApplicationOutputsOwned(void) {
+  return IsConnectedOutputAssembly(DEMO_APP_OUTPUT_ASSEMBLY_NUM);
+}
+
+bool KC868_A16_ApplicationOutputsRunning(void) {
+  return kKc868OutputModeRun == s_output_mode;
+}
+
+EipStatus KC868_A16_ApplicationUpdateOutputs(const EipUint16 set_mask,
+                                             const EipUint16 clear_mask,
+                                             EipUint16 *const outputs) {
+  if (KC868_A16_ApplicationOutputsOwned()) {
+    return kEipStatusError;
+  }
+  CipInstance *const instance =
+    GetCipInstance(GetAssemblyClass(),
+                   DEMO_APP_OUTPUT_ASSEMBLY_NUM);
+  if (NULL == instance) {
+    return kEipStatusError;
+  }
+
+  EipUint16 image = (EipUint16)(s_output_assembly_data[0] |
+                                (s_output_assembly_data[1] << 8));
+  image = (EipUint16)( (image & ~clear_mask) | set_mask );
+  const EipUint8 data[OUTPUT_ASSEMBLY_SIZE] = {
+    (EipUint8)image, (EipUint8)(image >> 8)
+  };
+  /* Same path as received output data: publishes a new assembly version and
+   * posts the image through AfterAssemblyDataReceived() */
+  EipStatus status = NotifyAssemblyConnectedDataReceived(instance, data,
+                                                         sizeof(data));
+  if (NULL != outputs) {
+    *outputs = image;
+  }
+  return status;
 }
 
 void KC868_A16_ApplicationNotifyLinkUp(void) {
@@ -383,16 +1236,56 @@ void KC868_A16_ApplicationSetActiveNetif(struct netif *netif) {
 
 #if defined(OPENER_ETHLINK_CNTRS_ENABLE) && 0 != OPENER_ETHLINK_CNTRS_ENABLE
 EipStatus EthLnkPreGetCallback(CipInstance *instance,
-                               CipAttributeStruct *attribute,
+                               const CipAttributeStruct *attribute,
                                CipByte service) {
   (void) instance;
-  (void) attribute;
-  (void) service;
+
+  /* Attribute 4 is filled from the network handler's 64-bit counters. A
+   * GetAndClear takes the snapshot and resets in one step, so nothing
+   * counted between the read and the clear is lost. */
+  if (4 == attribute->attribute_number) {
+    NetworkInterfaceCounters counters;
+    if (kEthLinkGetAndClear == service) {
+      NetworkGetAndClearInterfaceCounters(&counters);
+    } else {
+      NetworkGetInterfaceCounters(&counters);
+    }
+
+    CipEthernetLinkInterfaceCounters *cntrs =
+      (CipEthernetLinkInterfaceCounters *) attribute->data;
+    cntrs->ul.in_octets = (CipUdint) counters.in_octets;
+    cntrs->ul.in_ucast = (CipUdint) counters.in_ucast_packets;
+    cntrs->ul.in_nucast = (CipUdint) counters.in_nucast_packets;
+    cntrs->ul.in_discards = (CipUdint) counters.in_discards;
+    cntrs->ul.in_errors = (CipUdint) counters.in_errors;
+    cntrs->ul.in_unknown_protos = (CipUdint) counters.in_unknown_protos;
+    cntrs->ul.out_octets = (CipUdint) counters.out_octets;
+    cntrs->ul.out_ucast = (CipUdint) counters.out_ucast_packets;
+    cntrs->ul.out_nucast = (CipUdint) counters.out_nucast_packets;
+    cntrs->ul.out_discards = (CipUdint) counters.out_discards;
+    cntrs->ul.out_errors = (CipUdint) counters.out_errors;
+  }
+#if CONFIG_OPENER_ETH_MEDIA_COUNTERS
+  /* Attribute 5: the EMAC has no MMC block, the receive errors it and the
+   * PHY count are all the media counters there are on this board */
+  if (5 == attribute->attribute_number) {
+    EthMediaCounters media;
+    if (kEthLinkGetAndClear == service) {
+      EthMediaCountersGetAndClear(&media);
+    } else {
+      EthMediaCountersGet(&media);
+    }
+
+    CipEthernetLinkMediaCounters *cntrs =
+      (CipEthernetLinkMediaCounters *) attribute->data;
+    cntrs->ul.mac_rx_errs = media.symbol_errors + media.fifo_overflows;
+  }
+#endif
   return kEipStatusOk;
 }
 
 EipStatus EthLnkPostGetCallback(CipInstance *instance,
-                              CipAttributeStruct *attribute,
+                              const CipAttributeStruct *attribute,
                               CipByte service) {
   (void) instance;
   (void) attribute;
@@ -401,7 +1294,7 @@ EipStatus EthLnkPostGetCallback(CipInstance *instance,
 }
 #else
 EipStatus EthLnkPreGetCallback(CipInstance *instance,
-                               CipAttributeStruct *attribute,
+                               const CipAttributeStruct *attribute,
                                CipByte service) {
   (void) instance;
   (void) attribute;
@@ -410,7 +1303,7 @@ EipStatus EthLnkPreGetCallback(CipInstance *instance,
 }
 
 EipStatus EthLnkPostGetCallback(CipInstance *instance,
-                                CipAttributeStruct *attribute,
+                                const CipAttributeStruct *attribute,
                                 CipByte service) {
   (void) instance;
   (void) attribute;
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_APPLICATION_H_
+#define KC868_A16_APPLICATION_H_
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+
+/** @file kc868_a16_application.h
+ *  @brief Access of other tasks to the KC868-A16 application's I/O
+ */
+
+/** @brief Set and clear relay outputs as if the output assembly was written
+ *
+ *  Applies (outputs & ~clear_mask) | set_mask to the output assembly 150 in
+ *  one update and hands the result to the I/O scan task, so relays that are
+ *  not in either mask keep their state. Refused while an I/O connection
+ *  consumes the output assembly; the exclusive owner alone controls the
+ *  relays then.
+ *
+ *  Must be called with the stack lock held, see ProductionSchedulerLock().
+ *
+ *  @param set_mask relays to energize, bit 0 = relay 1
+ *  @param clear_mask relays to release
+ *  @param outputs receives the resulting output image
+ *  @return kEipStatusOk if the outputs were applied, kEipStatusError if a
+ *          connection owns the outputs
+ */
+EipStatus KC868_A16_ApplicationUpdateOutputs(const EipUint16 set_mask,
+                                             const EipUint16 clear_mask,
+                                             EipUint16 *const outputs);
+
+/** @brief Check whether an I/O connection owns the relay outputs
+ *
+ *  Must be called with the stack lock held, see ProductionSchedulerLock().
+ */
+bool KC868_A16_ApplicationOutputsOwned(void);
+
+/** @brief Check whether the relays follow the output assembly
+ *
+ *  False while the relays hold the safe state of the idle or the fault
+ *  mode. Must be called with the stack lock held, see
+ *  ProductionSchedulerLock().
+ */
+bool KC868_A16_ApplicationOutputsRunning(void);
+
+#endif /* KC868_A16_APPLICATION_H_ */
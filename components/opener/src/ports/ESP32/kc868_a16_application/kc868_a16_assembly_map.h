@@ -0,0 +1,443 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_ASSEMBLY_MAP_H_
+#define KC868_A16_ASSEMBLY_MAP_H_
+
+#include "sdkconfig.h"
+
+/** @file kc868_a16_assembly_map.h
+ *  @brief Data map of the KC868-A16 assemblies
+ *
+ *  The layout of every assembly is a list of fields. From these lists the
+ *  application generates its assembly buffers and sizes and one packing
+ *  function per input assembly, with all offsets known at compile time.
+ *  scripts/generate_eds_assemblies.py runs the same lists through the C
+ *  preprocessor and rewrites the assembly, connection and member parameter
+ *  entries of eds/KC868A16.eds from them.
+ *
+ *  To add a variant, list its fields in an input assembly entry; the
+ *  application gives it the next connection point of every type it offers.
+ *  Fields of new kinds also need a packer in kc868_a16_application.c.
+ *
+ *  Only sdkconfig.h may be included here, the EDS generator preprocesses
+ *  this file alone.
+ */
+
+/* Connection points shared by all input assemblies */
+#define KC868_A16_OUTPUT_ASSEMBLY_NUM                150
+#define KC868_A16_CONFIG_ASSEMBLY_NUM                151
+#define KC868_A16_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM  152
+#define KC868_A16_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM 153
+
+/* Expansion expanders, sized at boot from the devices found and therefore
+ * not part of the field lists, see kc868_a16_expansion.h */
+#define KC868_A16_EXPANSION_INPUT_ASSEMBLY_NUM       106
+#define KC868_A16_EXPANSION_OUTPUT_ASSEMBLY_NUM      154
+
+/* Modbus RTU master, sized at boot from the poll table, see
+ * kc868_a16_modbus_rtu.h */
+#define KC868_A16_MODBUS_RTU_INPUT_ASSEMBLY_NUM      107
+#define KC868_A16_MODBUS_RTU_OUTPUT_ASSEMBLY_NUM     155
+
+/** @brief Kinds of fields
+ *
+ *  KIND(kind, size, eds_type, name, units, help, limits). The EDS generator
+ *  replaces %u in name and help with the field argument plus one; limits
+ *  are the minimum, maximum and default of the EDS parameter.
+ */
+#define KC868_A16_FIELD_KINDS(KIND) \
+  KIND(DigitalInputs, 2, 0xD2, "Digital Inputs", "", \
+       "Opto inputs X01-X16 (bit 0=X01 .. bit 15=X16)", "0,65535,0") \
+  KIND(AnalogRaw, 2, 0xC7, "Analog A%u", "counts", \
+       "A%u raw ADC count, or mV with KC868_ADC_REPORT_MILLIVOLTS", "0,4095,0") \
+  KIND(RelayOutputs, 2, 0xD2, "Relay Outputs", "", \
+       "Relay outputs Y01-Y16 (bit 0=Y01 .. bit 15=Y16)", "0,65535,0") \
+  KIND(OutputMode, 1, 0xC6, "Output Mode", "", \
+       "0 run, 1 idle, 2 fault; the relays hold their safe state unless run", \
+       "0,2,0") \
+  KIND(ExpanderStatus, 1, 0xD1, "Expander Status", "", \
+       "bit 0/1 Y01-08/Y09-16 write failed, 2/3 X01-08/X09-16 stale, 4/5 Y01-08/Y09-16 read back wrong", \
+       "0,63,0") \
+  KIND(LogicResults, 2, 0xD2, "Logic Results", "", \
+       "Result of logic rule n+1 in bit n", "0,65535,0") \
+  KIND(LogicForced, 2, 0xD2, "Logic Forced Relays", "", \
+       "Relays forced by the logic rules, bit 0=Y01", "0,65535,0") \
+  KIND(EdgeSynchronized, 2, 0xD2, "Edges Synchronized", "", \
+       "Bit n: last edge of input n+1 stamped with a synchronized PTP clock", \
+       "0,65535,0") \
+  KIND(EdgeCount, 4, 0xC8, "Edge Count", "", \
+       "Edges on all inputs since start, wraps around", ",,") \
+  KIND(EdgeTime, 8, 0xC9, "X%02u Edge Time", "ns", \
+       "PTP time of the last edge of X%02u, 0 before the first edge", ",,") \
+  KIND(CounterCount, 4, 0xC4, "Counter %u Count", "", \
+       "Counted edges of pulse counter %u, wraps around", ",,") \
+  KIND(CounterFrequency, 4, 0xC8, "Counter %u Frequency", "mHz", \
+       "Edges per second of pulse counter %u, in 1/1000 Hz", ",,") \
+  KIND(SensorTemperature, 2, 0xC3, "Sensor %u Temperature", "0.1 degC", \
+       "Temperature of the sensor on HT%u, in 0.1 degrees Celsius", \
+       "-550,1250,0") \
+  KIND(SensorHumidity, 2, 0xC7, "Sensor %u Humidity", "0.1 %RH", \
+       "Relative humidity of the DHT sensor on HT%u, 0 for a DS18B20", \
+       "0,1000,0") \
+  KIND(SensorStatus, 1, 0xD1, "Sensor Status", "", \
+       "Bit n set while the sensor on HT(n+1) has no valid reading", \
+       "0,7,0") \
+  KIND(FaultAction, 1, 0xC6, "Fault Action Y%02u", "", \
+       "Y%02u on fault: 0 hold, 1 clear, 2 preset, 3 hold then clear", \
+       "0,3,1") \
+  KIND(FaultPreset, 2, 0xD2, "Fault Preset", "", \
+       "Relay states of the preset action on fault, bit 0 = Y01", \
+       "0,65535,0") \
+  KIND(FaultHoldTime, 2, 0xC7, "Fault Hold Time", "ms", \
+       "Time the hold then clear action keeps a relay on fault", "0,65535,0") \
+  KIND(IdleAction, 1, 0xC6, "Idle Action Y%02u", "", \
+       "Y%02u on idle: 0 hold, 1 clear, 2 preset, 3 hold then clear", \
+       "0,3,1") \
+  KIND(IdlePreset, 2, 0xD2, "Idle Preset", "", \
+       "Relay states of the preset action on idle, bit 0 = Y01", \
+       "0,65535,0") \
+  KIND(IdleHoldTime, 2, 0xC7, "Idle Hold Time", "ms", \
+       "Time the hold then clear action keeps a relay on idle", "0,65535,0") \
+  KIND(AnalogScaled, 2, 0xC3, "Analog A%u Scaled", "", \
+       "A%u in the engineering units of its calibration", \
+       "-32768,32767,0") \
+  KIND(AnalogStatus, 1, 0xD1, "Analog A%u Status", "", \
+       "A%u: bit 0 under range, bit 1 over range, bit 2 wire break", \
+       "0,7,0") \
+  KIND(AnalogRange, 1, 0xC6, "A%u Range", "", \
+       "A%u range: 0 off, 1 linear, 2 4-20 mA", "0,2,0") \
+  KIND(AnalogInputLow, 2, 0xC7, "A%u Input Low", "counts", \
+       "A%u input value at the low end of the range, counts or mV", \
+       "0,65535,0") \
+  KIND(AnalogInputHigh, 2, 0xC7, "A%u Input High", "counts", \
+       "A%u input value at the high end of the range, counts or mV", \
+       "0,65535,4095") \
+  KIND(AnalogValueLow, 2, 0xC3, "A%u Value Low", "", \
+       "Engineering value of A%u at input low", "-32768,32767,0") \
+  KIND(AnalogValueHigh, 2, 0xC3, "A%u Value High", "", \
+       "Engineering value of A%u at input high", "-32768,32767,4095") \
+  KIND(InputDebounce, 1, 0xC6, "X%02u Debounce", "ms", \
+       "Time X%02u must hold a new level before it is reported, 0 off", \
+       "0,255,5") \
+  KIND(AnalogAlarms, 1, 0xD1, "A%u Alarms", "", \
+       "A%u: bit 0 lo-lo, 1 lo, 2 hi, 3 hi-hi, 4 rising, 5 falling rate", \
+       "0,63,0") \
+  KIND(AlarmEnable, 1, 0xD1, "A%u Alarm Enable", "", \
+       "A%u alarms checked, bits as in the alarm status", "0,63,0") \
+  KIND(AlarmLoLo, 2, 0xC7, "A%u Lo-Lo Limit", "counts", \
+       "A%u lo-lo alarm at or below this input value", "0,65535,0") \
+  KIND(AlarmLo, 2, 0xC7, "A%u Lo Limit", "counts", \
+       "A%u lo alarm at or below this input value", "0,65535,0") \
+  KIND(AlarmHi, 2, 0xC7, "A%u Hi Limit", "counts", \
+       "A%u hi alarm at or above this input value", "0,65535,4095") \
+  KIND(AlarmHiHi, 2, 0xC7, "A%u Hi-Hi Limit", "counts", \
+       "A%u hi-hi alarm at or above this input value", "0,65535,4095") \
+  KIND(AlarmHysteresis, 2, 0xC7, "A%u Alarm Hysteresis", "counts", \
+       "A%u limit alarms clear this far back inside the limit", \
+       "0,65535,0") \
+  KIND(AlarmRate, 2, 0xC7, "A%u Rate Limit", "counts/s", \
+       "A%u rate alarms at or above this change per second", \
+       "0,65535,0") \
+  KIND(AlarmRateWindow, 2, 0xC7, "A%u Rate Window", "ms", \
+       "Time A%u's rate of change is taken over", "0,65535,1000") \
+  KIND(ApplyAt, 8, 0xC9, "Apply At", "ns", \
+       "PTP time, or UTC with the SNTP clock, the relays switch at; 0 at once", \
+       ",,")
+
+#if CONFIG_KC868_LOGIC
+#define KC868_A16_IF_LOGIC(...) __VA_ARGS__
+#else
+#define KC868_A16_IF_LOGIC(...)
+#endif
+#if CONFIG_OPENER_PTP_TIME_SYNC
+#define KC868_A16_IF_PTP(...) __VA_ARGS__
+#else
+#define KC868_A16_IF_PTP(...)
+#endif
+#if CONFIG_KC868_PCNT
+#define KC868_A16_IF_PCNT(...) __VA_ARGS__
+#else
+#define KC868_A16_IF_PCNT(...)
+#endif
+#if CONFIG_KC868_SENSORS
+#define KC868_A16_IF_SENSORS(...) __VA_ARGS__
+#else
+#define KC868_A16_IF_SENSORS(...)
+#endif
+#if CONFIG_KC868_ANALOG_SCALING
+#define KC868_A16_IF_SCALING(...) __VA_ARGS__
+#else
+#define KC868_A16_IF_SCALING(...)
+#endif
+#if CONFIG_KC868_INPUT_DEBOUNCE
+#define KC868_A16_IF_DEBOUNCE(...) __VA_ARGS__
+#else
+#define KC868_A16_IF_DEBOUNCE(...)
+#endif
+#if CONFIG_KC868_ANALOG_ALARMS
+#define KC868_A16_IF_ALARMS(...) __VA_ARGS__
+#else
+#define KC868_A16_IF_ALARMS(...)
+#endif
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+#define KC868_A16_IF_SCHEDULED(...) __VA_ARGS__
+#else
+#define KC868_A16_IF_SCHEDULED(...)
+#endif
+
+/* Fields of the input image, in the order of the scan layer */
+#define KC868_A16_MAP_INPUT_IMAGE(FIELD) \
+  FIELD(DigitalInputs, 0) \
+  FIELD(AnalogRaw, 0) \
+  FIELD(AnalogRaw, 1) \
+  FIELD(AnalogRaw, 2) \
+  FIELD(AnalogRaw, 3)
+
+#define KC868_A16_MAP_LOGIC_STATUS(FIELD) \
+  KC868_A16_IF_LOGIC(FIELD(LogicResults, 0) FIELD(LogicForced, 0))
+
+#define KC868_A16_MAP_ALARM_STATUS(FIELD) \
+  KC868_A16_IF_ALARMS(FIELD(AnalogAlarms, 0) FIELD(AnalogAlarms, 1) \
+                      FIELD(AnalogAlarms, 2) FIELD(AnalogAlarms, 3))
+
+/* FIELD(kind, argument) */
+#define KC868_A16_MAP_STANDARD_INPUT(FIELD) \
+  KC868_A16_MAP_INPUT_IMAGE(FIELD) \
+  KC868_A16_MAP_LOGIC_STATUS(FIELD) \
+  KC868_A16_MAP_ALARM_STATUS(FIELD)
+
+#define KC868_A16_MAP_TIMESTAMPED_INPUT(FIELD) \
+  KC868_A16_MAP_INPUT_IMAGE(FIELD) \
+  FIELD(EdgeSynchronized, 0) \
+  FIELD(EdgeCount, 0) \
+  FIELD(EdgeTime, 0) FIELD(EdgeTime, 1) FIELD(EdgeTime, 2) \
+  FIELD(EdgeTime, 3) FIELD(EdgeTime, 4) FIELD(EdgeTime, 5) \
+  FIELD(EdgeTime, 6) FIELD(EdgeTime, 7) FIELD(EdgeTime, 8) \
+  FIELD(EdgeTime, 9) FIELD(EdgeTime, 10) FIELD(EdgeTime, 11) \
+  FIELD(EdgeTime, 12) FIELD(EdgeTime, 13) FIELD(EdgeTime, 14) \
+  FIELD(EdgeTime, 15)
+
+#define KC868_A16_MAP_COUNTER_INPUT(FIELD) \
+  KC868_A16_MAP_INPUT_IMAGE(FIELD) \
+  FIELD(CounterCount, 0) FIELD(CounterFrequency, 0) \
+  FIELD(CounterCount, 1) FIELD(CounterFrequency, 1) \
+  FIELD(CounterCount, 2) FIELD(CounterFrequency, 2)
+
+/* Temperature and humidity of the HT1-HT3 sensors, see kc868_a16_sensor.h */
+#define KC868_A16_MAP_SENSOR_INPUT(FIELD) \
+  KC868_A16_MAP_INPUT_IMAGE(FIELD) \
+  FIELD(SensorTemperature, 0) FIELD(SensorHumidity, 0) \
+  FIELD(SensorTemperature, 1) FIELD(SensorHumidity, 1) \
+  FIELD(SensorTemperature, 2) FIELD(SensorHumidity, 2) \
+  FIELD(SensorStatus, 0)
+
+/* Nothing but the digital inputs, for a short RPI */
+#define KC868_A16_MAP_DIGITAL_INPUT(FIELD) \
+  FIELD(DigitalInputs, 0)
+
+/* Inputs together with the relays, the state they are in and the health
+ * of the expanders */
+#define KC868_A16_MAP_DIAGNOSTIC_INPUT(FIELD) \
+  KC868_A16_MAP_INPUT_IMAGE(FIELD) \
+  FIELD(RelayOutputs, 0) \
+  FIELD(OutputMode, 0) \
+  FIELD(ExpanderStatus, 0) \
+  KC868_A16_MAP_LOGIC_STATUS(FIELD) \
+  KC868_A16_MAP_ALARM_STATUS(FIELD)
+
+/* Digital inputs with the analog inputs in engineering units */
+#define KC868_A16_MAP_SCALED_INPUT(FIELD) \
+  FIELD(DigitalInputs, 0) \
+  FIELD(AnalogScaled, 0) FIELD(AnalogScaled, 1) \
+  FIELD(AnalogScaled, 2) FIELD(AnalogScaled, 3) \
+  FIELD(AnalogStatus, 0) FIELD(AnalogStatus, 1) \
+  FIELD(AnalogStatus, 2) FIELD(AnalogStatus, 3)
+
+/* Connection points an input assembly offers */
+#define KC868_A16_POINT_EXCLUSIVE_OWNER 0x01
+#define KC868_A16_POINT_INPUT_ONLY      0x02
+#define KC868_A16_POINT_LISTEN_ONLY     0x04
+#define KC868_A16_POINTS_ALL            0x07
+#define KC868_A16_POINTS_MONITOR        (KC868_A16_POINT_INPUT_ONLY | \
+                                         KC868_A16_POINT_LISTEN_ONLY)
+
+/** @brief Input assemblies, in the order of their connection points
+ *
+ *  ASSEMBLY(name, instance, eds_name, fields, points, rpi_us)
+ *
+ *  points are the KC868_A16_POINT_* the assembly offers, rpi_us the
+ *  default RPI of its connections in the EDS. The assemblies take the
+ *  connection points of each type in this order, so the ones for a
+ *  connection of their own come first: the full inputs, the digital
+ *  inputs for a short RPI next to a slower connection of the full ones,
+ *  and the diagnostics for input only and listen only historians.
+ */
+#define KC868_A16_INPUT_ASSEMBLIES(ASSEMBLY) \
+  ASSEMBLY(StandardInput, 100, "Input Assembly", \
+           KC868_A16_MAP_STANDARD_INPUT, KC868_A16_POINTS_ALL, 10000) \
+  ASSEMBLY(DigitalInput, 103, "Digital Input Assembly", \
+           KC868_A16_MAP_DIGITAL_INPUT, KC868_A16_POINTS_ALL, 2000) \
+  ASSEMBLY(DiagnosticInput, 104, "Diagnostic Input Assembly", \
+           KC868_A16_MAP_DIAGNOSTIC_INPUT, KC868_A16_POINTS_MONITOR, 100000) \
+  KC868_A16_IF_PTP(ASSEMBLY(TimestampedInput, 101, \
+                            "Timestamped Input Assembly", \
+                            KC868_A16_MAP_TIMESTAMPED_INPUT, \
+                            KC868_A16_POINTS_ALL, 10000)) \
+  KC868_A16_IF_PCNT(ASSEMBLY(CounterInput, 102, "Counter Input Assembly", \
+                             KC868_A16_MAP_COUNTER_INPUT, \
+                             KC868_A16_POINTS_ALL, 10000)) \
+  KC868_A16_IF_SCALING(ASSEMBLY(ScaledInput, 105, \
+                                "Scaled Analog Input Assembly", \
+                                KC868_A16_MAP_SCALED_INPUT, \
+                                KC868_A16_POINTS_ALL, 10000)) \
+  KC868_A16_IF_SENSORS(ASSEMBLY(SensorInput, 108, "Sensor Input Assembly", \
+                                KC868_A16_MAP_SENSOR_INPUT, \
+                                KC868_A16_POINTS_ALL, 100000))
+
+/* The relays, with CONFIG_KC868_SCHEDULED_OUTPUTS the time they switch at */
+#define KC868_A16_MAP_OUTPUT(FIELD) \
+  FIELD(RelayOutputs, 0) \
+  KC868_A16_IF_SCHEDULED(FIELD(ApplyAt, 0))
+
+/* Safe state of the fault or the idle mode, see KC868_A16_OutputSafeState */
+#define KC868_A16_MAP_SAFE_STATE(FIELD, mode) \
+  FIELD(mode##Action, 0) FIELD(mode##Action, 1) FIELD(mode##Action, 2) \
+  FIELD(mode##Action, 3) FIELD(mode##Action, 4) FIELD(mode##Action, 5) \
+  FIELD(mode##Action, 6) FIELD(mode##Action, 7) FIELD(mode##Action, 8) \
+  FIELD(mode##Action, 9) FIELD(mode##Action, 10) FIELD(mode##Action, 11) \
+  FIELD(mode##Action, 12) FIELD(mode##Action, 13) FIELD(mode##Action, 14) \
+  FIELD(mode##Action, 15) \
+  FIELD(mode##Preset, 0) \
+  FIELD(mode##HoldTime, 0)
+
+/* Calibration of analog channel n+1, see KC868_A16_AnalogScaling */
+#define KC868_A16_MAP_ANALOG_SCALING(FIELD, channel) \
+  FIELD(AnalogRange, channel) \
+  FIELD(AnalogInputLow, channel) FIELD(AnalogInputHigh, channel) \
+  FIELD(AnalogValueLow, channel) FIELD(AnalogValueHigh, channel)
+
+/* Debounce time of every input, see KC868_A16_InputDebounce */
+#define KC868_A16_MAP_INPUT_DEBOUNCE(FIELD) \
+  FIELD(InputDebounce, 0) FIELD(InputDebounce, 1) FIELD(InputDebounce, 2) \
+  FIELD(InputDebounce, 3) FIELD(InputDebounce, 4) FIELD(InputDebounce, 5) \
+  FIELD(InputDebounce, 6) FIELD(InputDebounce, 7) FIELD(InputDebounce, 8) \
+  FIELD(InputDebounce, 9) FIELD(InputDebounce, 10) FIELD(InputDebounce, 11) \
+  FIELD(InputDebounce, 12) FIELD(InputDebounce, 13) \
+  FIELD(InputDebounce, 14) FIELD(InputDebounce, 15)
+
+/* Alarms of analog channel n+1, see KC868_A16_AnalogAlarm */
+#define KC868_A16_MAP_ANALOG_ALARM(FIELD, channel) \
+  FIELD(AlarmEnable, channel) \
+  FIELD(AlarmLoLo, channel) FIELD(AlarmLo, channel) \
+  FIELD(AlarmHi, channel) FIELD(AlarmHiHi, channel) \
+  FIELD(AlarmHysteresis, channel) \
+  FIELD(AlarmRate, channel) FIELD(AlarmRateWindow, channel)
+
+#define KC868_A16_MAP_CONFIG(FIELD) \
+  KC868_A16_MAP_SAFE_STATE(FIELD, Fault) \
+  KC868_A16_MAP_SAFE_STATE(FIELD, Idle) \
+  KC868_A16_IF_SCALING(KC868_A16_MAP_ANALOG_SCALING(FIELD, 0) \
+                       KC868_A16_MAP_ANALOG_SCALING(FIELD, 1) \
+                       KC868_A16_MAP_ANALOG_SCALING(FIELD, 2) \
+                       KC868_A16_MAP_ANALOG_SCALING(FIELD, 3)) \
+  KC868_A16_IF_DEBOUNCE(KC868_A16_MAP_INPUT_DEBOUNCE(FIELD)) \
+  KC868_A16_IF_ALARMS(KC868_A16_MAP_ANALOG_ALARM(FIELD, 0) \
+                      KC868_A16_MAP_ANALOG_ALARM(FIELD, 1) \
+                      KC868_A16_MAP_ANALOG_ALARM(FIELD, 2) \
+                      KC868_A16_MAP_ANALOG_ALARM(FIELD, 3))
+
+/** @brief Consumed and configuration assemblies
+ *
+ *  ASSEMBLY(name, instance, eds_name, fields)
+ */
+#define KC868_A16_OTHER_ASSEMBLIES(ASSEMBLY) \
+  ASSEMBLY(Output, KC868_A16_OUTPUT_ASSEMBLY_NUM, "Output Assembly", \
+           KC868_A16_MAP_OUTPUT) \
+  ASSEMBLY(Config, KC868_A16_CONFIG_ASSEMBLY_NUM, "Configuration Assembly", \
+           KC868_A16_MAP_CONFIG)
+
+/* Sizes of the field kinds, kKc868FieldSize<kind> */
+#define KC868_A16_FIELD_SIZE_ENUMERATOR(kind, size, eds_type, name, units, \
+                                        help, limits) \
+  kKc868FieldSize##kind = size,
+enum {
+  KC868_A16_FIELD_KINDS(KC868_A16_FIELD_SIZE_ENUMERATOR)
+};
+
+#define KC868_A16_FIELD_SIZE(kind, argument) + kKc868FieldSize##kind
+/** @brief Size in bytes of the assembly made of a field list */
+#define KC868_A16_ASSEMBLY_SIZE(fields) (0 fields(KC868_A16_FIELD_SIZE))
+
+/** @brief Size in bytes of the output assembly, for snapshots of it */
+#define KC868_A16_OUTPUT_ASSEMBLY_SIZE KC868_A16_ASSEMBLY_SIZE(KC868_A16_MAP_OUTPUT)
+
+#define KC868_A16_MEMBER_SIZE(kind, argument) kKc868FieldSize##kind,
+/** @brief Initializer of the assembly member sizes, one member per field */
+#define KC868_A16_MEMBER_SIZES(fields) { fields(KC868_A16_MEMBER_SIZE) }
+
+/* Sealed configuration, CONFIG_OPENER_SEALED_CONFIGURATION: the connection
+ * points and assemblies above as initializers of the stack's constant
+ * tables, see OPENER_SEALED_EXCLUSIVE_OWNER_POINTS. The points an input
+ * assembly offers are selected by the name of its points argument, which
+ * therefore has to be KC868_A16_POINTS_ALL or KC868_A16_POINTS_MONITOR. */
+#define KC868_A16_SEALED_EXCLUSIVE_OWNER_KC868_A16_POINTS_ALL(...) __VA_ARGS__
+#define KC868_A16_SEALED_EXCLUSIVE_OWNER_KC868_A16_POINTS_MONITOR(...)
+#define KC868_A16_SEALED_INPUT_ONLY_KC868_A16_POINTS_ALL(...) __VA_ARGS__
+#define KC868_A16_SEALED_INPUT_ONLY_KC868_A16_POINTS_MONITOR(...) __VA_ARGS__
+#define KC868_A16_SEALED_LISTEN_ONLY_KC868_A16_POINTS_ALL(...) __VA_ARGS__
+#define KC868_A16_SEALED_LISTEN_ONLY_KC868_A16_POINTS_MONITOR(...) __VA_ARGS__
+
+#define KC868_A16_SEALED_EXCLUSIVE_OWNER_POINT(name, instance, eds_name, \
+                                               fields, points, rpi_us) \
+  KC868_A16_SEALED_EXCLUSIVE_OWNER_##points( \
+    { KC868_A16_OUTPUT_ASSEMBLY_NUM, instance, \
+      KC868_A16_CONFIG_ASSEMBLY_NUM },)
+#define KC868_A16_SEALED_INPUT_ONLY_POINT(name, instance, eds_name, fields, \
+                                          points, rpi_us) \
+  KC868_A16_SEALED_INPUT_ONLY_##points( \
+    { KC868_A16_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM, instance, \
+      KC868_A16_CONFIG_ASSEMBLY_NUM },)
+#define KC868_A16_SEALED_LISTEN_ONLY_POINT(name, instance, eds_name, fields, \
+                                           points, rpi_us) \
+  KC868_A16_SEALED_LISTEN_ONLY_##points( \
+    { KC868_A16_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM, instance, \
+      KC868_A16_CONFIG_ASSEMBLY_NUM },)
+#define KC868_A16_SEALED_INPUT_ASSEMBLY(name, instance, eds_name, fields, \
+                                        points, rpi_us) \
+  { instance, KC868_A16_ASSEMBLY_SIZE(fields) },
+#define KC868_A16_SEALED_OTHER_ASSEMBLY(name, instance, eds_name, fields) \
+  { instance, KC868_A16_ASSEMBLY_SIZE(fields) },
+
+#define KC868_A16_SEALED_EXCLUSIVE_OWNER_POINTS \
+  KC868_A16_INPUT_ASSEMBLIES(KC868_A16_SEALED_EXCLUSIVE_OWNER_POINT)
+#define KC868_A16_SEALED_INPUT_ONLY_POINTS \
+  KC868_A16_INPUT_ASSEMBLIES(KC868_A16_SEALED_INPUT_ONLY_POINT)
+#define KC868_A16_SEALED_LISTEN_ONLY_POINTS \
+  KC868_A16_INPUT_ASSEMBLIES(KC868_A16_SEALED_LISTEN_ONLY_POINT)
+#define KC868_A16_SEALED_ASSEMBLIES \
+  KC868_A16_OTHER_ASSEMBLIES(KC868_A16_SEALED_OTHER_ASSEMBLY) \
+  KC868_A16_INPUT_ASSEMBLIES(KC868_A16_SEALED_INPUT_ASSEMBLY) \
+  { KC868_A16_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM, 0 }, \
+  { KC868_A16_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM, 0 },
+
+#endif /* KC868_A16_ASSEMBLY_MAP_H_ */
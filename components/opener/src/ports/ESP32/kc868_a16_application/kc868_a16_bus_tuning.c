@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_bus_tuning.h"
+
+#if CONFIG_KC868_I2C_AUTOTUNE
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "i2c_manager.h"
+#include "nvs.h"
+
+#define TUNING_NVS_NAMESPACE  "kc868"
+#define TUNING_NVS_KEY        "i2c_timing"
+#define TUNING_NVS_VERSION    1
+
+#define TUNING_DEFAULT_GLITCH_IGNORE_CNT 7
+#define TUNING_TIMEOUT_MS                10
+
+static const char *TAG_TUNING = "kc868_bus";
+
+/* Fastest first, the last one takes the reference read backs */
+static const uint32_t kTuningSpeeds[] = { 1000000, 800000, 600000, 400000,
+                                          100000 };
+/* Strongest filter first, in I2C module clock cycles */
+static const uint8_t kTuningGlitchFilters[] = { 7, 3, 1 };
+
+#define TUNING_SPEED_COUNT  (sizeof(kTuningSpeeds) / sizeof(kTuningSpeeds[0]))
+#define TUNING_FILTER_COUNT (sizeof(kTuningGlitchFilters) / \
+                             sizeof(kTuningGlitchFilters[0]))
+
+/* Accesses of a round: write the relay expanders, read them back, read the
+ * inputs */
+enum {
+  kTuningWriteOutputs1To8,
+  kTuningWriteOutputs9To16,
+  kTuningReadOutputs1To8,
+  kTuningReadOutputs9To16,
+  kTuningReadInputs1To8,
+  kTuningReadInputs9To16,
+  kTuningOpCount
+};
+
+typedef struct __attribute__((packed)) {
+  uint8_t version;
+  uint8_t glitch_ignore_cnt;
+  uint32_t freq_hz;
+} BusTuningNvBlob;
+
+typedef struct {
+  uint32_t failed_rounds;
+  uint32_t round_us; /**< mean time of a round */
+} TuningResult;
+
+static bool IsCandidate(uint32_t freq_hz, uint8_t glitch_ignore_cnt) {
+  bool speed = false;
+  for (size_t i = 0; i < TUNING_SPEED_COUNT; i++) {
+    speed = speed || kTuningSpeeds[i] == freq_hz;
+  }
+  bool filter = false;
+  for (size_t i = 0; i < TUNING_FILTER_COUNT; i++) {
+    filter = filter || kTuningGlitchFilters[i] == glitch_ignore_cnt;
+  }
+  return speed && filter;
+}
+
+/* Run the rounds on the bus re-created with the setting. With
+ * take_reference the read backs of the first round become the reference. */
+static void RunRounds(const uint8_t *addresses, uint32_t freq_hz,
+                      uint8_t glitch_ignore_cnt, uint8_t *reference,
+                      bool take_reference, TuningResult *result) {
+  result->failed_rounds = CONFIG_KC868_I2C_AUTOTUNE_ROUNDS;
+  result->round_us = 0;
+  if (ESP_OK != i2c_manager_reinit(freq_hz, glitch_ignore_cnt)) {
+    return;
+  }
+
+  const size_t expander_of_op[kTuningOpCount] = {
+    kKc868ExpanderOutputs1To8, kKc868ExpanderOutputs9To16,
+    kKc868ExpanderOutputs1To8, kKc868ExpanderOutputs9To16,
+    kKc868ExpanderInputs1To8, kKc868ExpanderInputs9To16,
+  };
+  uint8_t data[kTuningOpCount];
+  i2c_manager_op_t ops[kTuningOpCount];
+  for (size_t i = 0; i < kTuningOpCount; i++) {
+    ops[i] = (i2c_manager_op_t) {
+      .type = (i < kTuningReadOutputs1To8) ? I2C_MANAGER_OP_WRITE :
+              I2C_MANAGER_OP_READ,
+      .address = addresses[expander_of_op[i]],
+      .data = &data[i],
+      .length = 1,
+    };
+  }
+  i2c_manager_scan_handle_t scan;
+  if (ESP_OK != i2c_manager_create_scan(ops, kTuningOpCount, &scan)) {
+    return;
+  }
+
+  uint32_t failed_rounds = 0;
+  int64_t busy_us = 0;
+  for (uint32_t round = 0; round < CONFIG_KC868_I2C_AUTOTUNE_ROUNDS; round++) {
+    /* Relays released */
+    data[kTuningWriteOutputs1To8] = 0xFF;
+    data[kTuningWriteOutputs9To16] = 0xFF;
+    const int64_t start_us = esp_timer_get_time();
+    bool passed = (ESP_OK == i2c_manager_execute_scan(scan, TUNING_TIMEOUT_MS));
+    busy_us += esp_timer_get_time() - start_us;
+
+    for (size_t i = kTuningReadOutputs1To8; passed && i <= kTuningReadOutputs9To16;
+         i++) {
+      const size_t index = i - kTuningReadOutputs1To8;
+      if (take_reference && 0 == round) {
+        reference[index] = data[i];
+      }
+      passed = (reference[index] == data[i]);
+    }
+    if (!passed) {
+      failed_rounds++;
+    }
+  }
+  (void)i2c_manager_delete_scan(scan);
+
+  result->failed_rounds = failed_rounds;
+  result->round_us = (uint32_t)(busy_us / CONFIG_KC868_I2C_AUTOTUNE_ROUNDS);
+}
+
+static void LogResult(uint32_t freq_hz, uint8_t glitch_ignore_cnt,
+                      const TuningResult *result) {
+  ESP_LOGI(TAG_TUNING, "  %7lu Hz, filter %u: %lu/%d rounds failed, %lu us per round",
+           (unsigned long)freq_hz, glitch_ignore_cnt,
+           (unsigned long)result->failed_rounds, CONFIG_KC868_I2C_AUTOTUNE_ROUNDS,
+           (unsigned long)result->round_us);
+}
+
+#if !CONFIG_KC868_I2C_AUTOTUNE_EVERY_BOOT
+static bool LoadSetting(BusTuningNvBlob *blob) {
+  size_t length = sizeof(*blob);
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(TUNING_NVS_NAMESPACE, NVS_READONLY, &handle);
+  if (err == ESP_OK) {
+    err = nvs_get_blob(handle, TUNING_NVS_KEY, blob, &length);
+    nvs_close(handle);
+  }
+  return err == ESP_OK && length == sizeof(*blob) &&
+         blob->version == TUNING_NVS_VERSION &&
+         IsCandidate(blob->freq_hz, blob->glitch_ignore_cnt);
+}
+#endif
+
+static esp_err_t StoreSetting(uint32_t freq_hz, uint8_t glitch_ignore_cnt) {
+  BusTuningNvBlob blob;
+  memset(&blob, 0, sizeof(blob));
+  blob.version = TUNING_NVS_VERSION;
+  blob.glitch_ignore_cnt = glitch_ignore_cnt;
+  blob.freq_hz = freq_hz;
+
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(TUNING_NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    return err;
+  }
+  err = nvs_set_blob(handle, TUNING_NVS_KEY, &blob, sizeof(blob));
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  return err;
+}
+
+static uint32_t UseDefault(uint32_t default_freq_hz) {
+  (void)i2c_manager_reinit(default_freq_hz, TUNING_DEFAULT_GLITCH_IGNORE_CNT);
+  return default_freq_hz;
+}
+
+uint32_t KC868_A16_BusTuningSelect(const uint8_t *addresses,
+                                   uint32_t default_freq_hz) {
+#if !CONFIG_KC868_I2C_AUTOTUNE_EVERY_BOOT
+  BusTuningNvBlob stored;
+  if (LoadSetting(&stored) &&
+      ESP_OK == i2c_manager_reinit(stored.freq_hz, stored.glitch_ignore_cnt)) {
+    ESP_LOGI(TAG_TUNING, "I2C at the tuned %lu Hz, glitch filter %u",
+             (unsigned long)stored.freq_hz, stored.glitch_ignore_cnt);
+    return stored.freq_hz;
+  }
+#endif
+
+  ESP_LOGI(TAG_TUNING, "Characterising the I2C bus, %d rounds per setting",
+           CONFIG_KC868_I2C_AUTOTUNE_ROUNDS);
+  /* The failures at too high a speed are expected */
+  esp_log_level_set("i2c.master", ESP_LOG_NONE);
+
+  uint8_t reference[KC868_A16_OUTPUT_IMAGE_SIZE];
+  TuningResult result;
+  RunRounds(addresses, kTuningSpeeds[TUNING_SPEED_COUNT - 1],
+            TUNING_DEFAULT_GLITCH_IGNORE_CNT, reference, true, &result);
+  if (0 != result.failed_rounds) {
+    esp_log_level_set("i2c.master", ESP_LOG_INFO);
+    LogResult(kTuningSpeeds[TUNING_SPEED_COUNT - 1],
+              TUNING_DEFAULT_GLITCH_IGNORE_CNT, &result);
+    ESP_LOGE(TAG_TUNING, "I2C bus unreliable at the lowest speed, using %lu Hz",
+             (unsigned long)default_freq_hz);
+    return UseDefault(default_freq_hz);
+  }
+
+  /* Every setting is measured for the log, the first that passes wins */
+  uint32_t best_freq_hz = 0;
+  uint8_t best_glitch_ignore_cnt = 0;
+  for (size_t speed = 0; speed < TUNING_SPEED_COUNT; speed++) {
+    for (size_t filter = 0; filter < TUNING_FILTER_COUNT; filter++) {
+      RunRounds(addresses, kTuningSpeeds[speed], kTuningGlitchFilters[filter],
+                reference, false, &result);
+      LogResult(kTuningSpeeds[speed], kTuningGlitchFilters[filter], &result);
+      if (0 == result.failed_rounds && 0 == best_freq_hz) {
+        best_freq_hz = kTuningSpeeds[speed];
+        best_glitch_ignore_cnt = kTuningGlitchFilters[filter];
+      }
+    }
+  }
+  esp_log_level_set("i2c.master", ESP_LOG_INFO);
+
+  if (0 == best_freq_hz ||
+      ESP_OK != i2c_manager_reinit(best_freq_hz, best_glitch_ignore_cnt)) {
+    ESP_LOGE(TAG_TUNING, "No I2C setting passed, using %lu Hz",
+             (unsigned long)default_freq_hz);
+    return UseDefault(default_freq_hz);
+  }
+  ESP_LOGI(TAG_TUNING, "I2C tuned to %lu Hz, glitch filter %u",
+           (unsigned long)best_freq_hz, best_glitch_ignore_cnt);
+  esp_err_t err = StoreSetting(best_freq_hz, best_glitch_ignore_cnt);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG_TUNING, "Failed to store the I2C setting: %s",
+             esp_err_to_name(err));
+  }
+  return best_freq_hz;
+}
+
+#endif /* CONFIG_KC868_I2C_AUTOTUNE */
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_BUS_TUNING_H_
+#define KC868_A16_BUS_TUNING_H_
+
+#include <stdint.h>
+
+#include "kc868_a16_io.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_bus_tuning.h
+ *  @brief SCL speed and glitch filter of the expander bus, per board
+ *
+ *  Selected with CONFIG_KC868_I2C_AUTOTUNE. The bus is characterised
+ *  once: every combination of the candidate SCL speeds (100 kHz up to
+ *  1 MHz Fast-mode Plus) and glitch filters runs
+ *  CONFIG_KC868_I2C_AUTOTUNE_ROUNDS rounds of the accesses of an I/O scan.
+ *  A round writes the released state 0xFF to the relay expanders, reads it
+ *  back and reads the input expanders. It fails if an access fails or a
+ *  read back differs from the one taken at 100 kHz. The time of a round
+ *  and the failed rounds of every combination are logged.
+ *
+ *  The fastest speed without a failed round wins, with the strongest
+ *  filter that passed at that speed. It is stored in NVS and used on later
+ *  boots without characterising again, unless
+ *  CONFIG_KC868_I2C_AUTOTUNE_EVERY_BOOT is set.
+ */
+
+#if CONFIG_KC868_I2C_AUTOTUNE
+
+/** @brief Switch the bus to the tuned setting
+ *
+ *  Call after i2c_manager_init() and before any device is attached to the
+ *  bus. Drives the relay expanders to 0xFF, all relays released, while
+ *  characterising.
+ *
+ *  @param addresses expander addresses in KC868_A16_Expander order
+ *  @param default_freq_hz speed used if no setting passes
+ *  @return SCL speed the bus now runs at
+ */
+uint32_t KC868_A16_BusTuningSelect(const uint8_t *addresses,
+                                   uint32_t default_freq_hz);
+
+#endif /* CONFIG_KC868_I2C_AUTOTUNE */
+
+#endif /* KC868_A16_BUS_TUNING_H_ */
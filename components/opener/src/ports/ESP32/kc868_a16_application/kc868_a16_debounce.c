@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_debounce.h"
+
+#if CONFIG_KC868_INPUT_DEBOUNCE
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "nvconfig.h"
+
+/* The blob of earlier firmware, read once to fill the configuration record */
+#define DEBOUNCE_NVS_NAMESPACE  "kc868"
+#define DEBOUNCE_NVS_KEY        "debounce"
+#define DEBOUNCE_NVS_VERSION    1
+
+_Static_assert(KC868_A16_DIGITAL_INPUT_COUNT == NV_CONFIG_IO_INPUT_COUNT,
+               "the I/O section has a time for every input");
+
+typedef struct __attribute__((packed)) {
+  uint8_t version;
+  uint8_t input_count;
+  CipUsint time_ms[KC868_A16_DIGITAL_INPUT_COUNT];
+} DebounceNvBlob;
+
+static const char *TAG_DEBOUNCE = "kc868_debounce";
+
+/* Configured times, written by the application */
+static KC868_A16_InputDebounce s_configured;
+static bool s_configured_pending = false;
+static portMUX_TYPE s_configured_lock = portMUX_INITIALIZER_UNLOCKED;
+/* Bit n: an input of byte n has a debounce time */
+static uint32_t s_active_bytes = 0;
+
+/* Scan task only */
+static int64_t s_debounce_us[KC868_A16_DIGITAL_INPUT_COUNT];
+static uint8_t s_raw[KC868_A16_DIGITAL_INPUT_BYTES];
+static int64_t s_level_time_us[KC868_A16_DIGITAL_INPUT_COUNT];
+
+static uint32_t ActiveBytes(const KC868_A16_InputDebounce *debounce) {
+  uint32_t active = 0;
+  for (size_t input = 0; input < KC868_A16_DIGITAL_INPUT_COUNT; ++input) {
+    if (0 != debounce->time_ms[input]) {
+      active |= 1u << (input / 8);
+    }
+  }
+  return active;
+}
+
+/* Returns false if the times are already configured */
+static bool PostConfig(const KC868_A16_InputDebounce *debounce) {
+  bool changed = false;
+  taskENTER_CRITICAL(&s_configured_lock);
+  if (0 != memcmp(&s_configured, debounce, sizeof(s_configured))) {
+    s_configured = *debounce;
+    changed = true;
+  }
+  taskEXIT_CRITICAL(&s_configured_lock);
+  if (changed) {
+    __atomic_store_n(&s_active_bytes, ActiveBytes(debounce), __ATOMIC_RELAXED);
+    __atomic_store_n(&s_configured_pending, true, __ATOMIC_RELEASE);
+  }
+  return changed;
+}
+
+void KC868_A16_DebounceGetConfig(KC868_A16_InputDebounce *debounce) {
+  taskENTER_CRITICAL(&s_configured_lock);
+  *debounce = s_configured;
+  taskEXIT_CRITICAL(&s_configured_lock);
+}
+
+bool KC868_A16_DebounceActive(size_t index) {
+  return 0 != (__atomic_load_n(&s_active_bytes, __ATOMIC_RELAXED) &
+               (1u << index));
+}
+
+static EipStatus StoreConfig(const KC868_A16_InputDebounce *debounce) {
+  NvConfigIo config;
+  config.input_count = KC868_A16_DIGITAL_INPUT_COUNT;
+  memcpy(config.debounce_ms, debounce->time_ms, sizeof(config.debounce_ms));
+  (void)NvConfigSet(kNvConfigSectionIo, &config, sizeof(config));
+  return NvConfigCommitDeferred();
+}
+
+EipStatus KC868_A16_DebounceSetConfig(const KC868_A16_InputDebounce *debounce) {
+  /* Every Forward_Open with configuration data ends up here, only new times
+   * cost a flash write */
+  if (!PostConfig(debounce)) {
+    return kEipStatusOk;
+  }
+  if (StoreConfig(debounce) != kEipStatusOk) {
+    ESP_LOGE(TAG_DEBOUNCE, "Failed to store the debounce times");
+    return kEipStatusError;
+  }
+  return kEipStatusOk;
+}
+
+/* The times an earlier firmware stored under their own key */
+static bool LoadLegacyConfig(KC868_A16_InputDebounce *debounce) {
+  DebounceNvBlob blob;
+  size_t length = sizeof(blob);
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(DEBOUNCE_NVS_NAMESPACE, NVS_READONLY, &handle);
+  if (err == ESP_OK) {
+    err = nvs_get_blob(handle, DEBOUNCE_NVS_KEY, &blob, &length);
+    nvs_close(handle);
+  }
+  if (err != ESP_OK) {
+    return false;
+  }
+  if (length != sizeof(blob) || blob.version != DEBOUNCE_NVS_VERSION ||
+      blob.input_count != KC868_A16_DIGITAL_INPUT_COUNT) {
+    ESP_LOGW(TAG_DEBOUNCE, "Ignoring invalid stored debounce times");
+    return false;
+  }
+  memcpy(debounce->time_ms, blob.time_ms, sizeof(debounce->time_ms));
+  (void)StoreConfig(debounce);
+  return true;
+}
+
+void KC868_A16_DebounceInitialize(void) {
+  /* Until times are stored every input has the default */
+  KC868_A16_InputDebounce debounce;
+  memset(&debounce, KC868_A16_INPUT_DEBOUNCE_DEFAULT_MS, sizeof(debounce));
+  NvConfigIo config;
+  if (NvConfigGet(kNvConfigSectionIo, &config, sizeof(config))) {
+    if (config.input_count != KC868_A16_DIGITAL_INPUT_COUNT) {
+      ESP_LOGW(TAG_DEBOUNCE, "Ignoring invalid stored debounce times");
+    } else {
+      memcpy(debounce.time_ms, config.debounce_ms, sizeof(debounce.time_ms));
+      ESP_LOGI(TAG_DEBOUNCE, "Loaded the input debounce times");
+    }
+  } else if (LoadLegacyConfig(&debounce)) {
+    ESP_LOGI(TAG_DEBOUNCE, "Loaded the input debounce times");
+  }
+  taskENTER_CRITICAL(&s_configured_lock);
+  s_configured = debounce;
+  taskEXIT_CRITICAL(&s_configured_lock);
+  __atomic_store_n(&s_active_bytes, ActiveBytes(&debounce), __ATOMIC_RELAXED);
+  __atomic_store_n(&s_configured_pending, true, __ATOMIC_RELEASE);
+}
+
+uint8_t KC868_A16_DebounceFilter(size_t index, uint8_t raw, int64_t time_us,
+                                 int64_t now_us, uint8_t *filtered,
+                                 int64_t *edge_time_us) {
+  if (__atomic_exchange_n(&s_configured_pending, false, __ATOMIC_ACQUIRE)) {
+    KC868_A16_InputDebounce debounce;
+    KC868_A16_DebounceGetConfig(&debounce);
+    for (size_t input = 0; input < KC868_A16_DIGITAL_INPUT_COUNT; ++input) {
+      s_debounce_us[input] = (int64_t)debounce.time_ms[input] * 1000;
+    }
+  }
+
+  const uint8_t moved = (uint8_t)(raw ^ s_raw[index]);
+  const uint8_t differing = (uint8_t)(raw ^ *filtered);
+  s_raw[index] = raw;
+  uint8_t settled = 0;
+  for (size_t bit = 0; bit < 8; ++bit) {
+    const uint8_t mask = (uint8_t)(1u << bit);
+    const size_t input = index * 8 + bit;
+    if (moved & mask) {
+      s_level_time_us[input] = time_us;
+    }
+    /* A level back to the debounced one before its time was a glitch */
+    if ((differing & mask) &&
+        now_us - s_level_time_us[input] >= s_debounce_us[input]) {
+      settled |= mask;
+      edge_time_us[bit] = s_level_time_us[input];
+    }
+  }
+  *filtered ^= settled;
+  return settled;
+}
+
+#endif /* CONFIG_KC868_INPUT_DEBOUNCE */
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_DEBOUNCE_H_
+#define KC868_A16_DEBOUNCE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "kc868_a16_io.h"
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_debounce.h
+ *  @brief Debounce and glitch filter of the digital inputs
+ *
+ *  Selected with CONFIG_KC868_INPUT_DEBOUNCE. Every input has a debounce
+ *  time of 0 to 255 ms. A new level read from the expanders only reaches
+ *  the scan image once it held for that time, and every change of the level
+ *  read starts the time again: a bouncing contact is reported once, when it
+ *  settled, and a pulse shorter than the time is dropped. 0 passes the
+ *  input on as read.
+ *
+ *  The edge is stamped with the time the settled level was first read, so
+ *  the edge times and the sequence of events keep their resolution; the
+ *  input image, Change-of-State production and the logic rules see it one
+ *  debounce time later. The time is checked on every scan and so rounds up
+ *  to a multiple of CONFIG_KC868_IO_SCAN_PERIOD_US.
+ *
+ *  The times are the I/O section of the configuration record, see
+ *  nvconfig.h, and are part of the configuration assembly 151, so a PLC
+ *  sets them with its Forward_Open. The record is only written when they
+ *  changed, behind by its writer task, so the Forward_Open never waits for
+ *  the flash.
+ */
+
+#if CONFIG_KC868_INPUT_DEBOUNCE
+
+/** Debounce time until one is configured, the EDS default of the map */
+#define KC868_A16_INPUT_DEBOUNCE_DEFAULT_MS 5
+
+/** Size of the debounce times on the wire, one USINT in ms per input */
+#define KC868_A16_INPUT_DEBOUNCE_SIZE KC868_A16_DIGITAL_INPUT_COUNT
+
+/** @brief Debounce times of all inputs */
+typedef struct {
+  CipUsint time_ms[KC868_A16_DIGITAL_INPUT_COUNT]; /**< X01 first, 0 off */
+} KC868_A16_InputDebounce;
+
+/** @brief Load the debounce times from the configuration record, before the
+ *  I/O scan starts */
+void KC868_A16_DebounceInitialize(void);
+
+/** @brief Filter one byte read from an input expander, I/O scan task only
+ *
+ *  Picks up debounce times set since the previous call first. Call it on
+ *  every scan, with the last byte read if the expander was not read, so a
+ *  level that settled is taken when its time is over.
+ *
+ *  @param index byte of the input image, 0 = X01-X08
+ *  @param raw byte read, bit 0 = first input of the byte
+ *  @param time_us esp_timer time raw was read
+ *  @param now_us esp_timer time of this scan
+ *  @param filtered the debounced byte, takes the inputs that settled
+ *  @param edge_time_us 8 entries, receives for every changed bit the time
+ *         its new level was first read
+ *  @return the bits of filtered that changed
+ */
+uint8_t KC868_A16_DebounceFilter(size_t index, uint8_t raw, int64_t time_us,
+                                 int64_t now_us, uint8_t *filtered,
+                                 int64_t *edge_time_us);
+
+/** @brief True if an input of byte index has a debounce time, any task */
+bool KC868_A16_DebounceActive(size_t index);
+
+/** @brief Copy the debounce times of all inputs */
+void KC868_A16_DebounceGetConfig(KC868_A16_InputDebounce *debounce);
+
+/** @brief Apply debounce times and schedule storing them if they changed
+ *
+ *  May be called from any task, not from an interrupt.
+ *
+ *  @return kEipStatusOk, or kEipStatusError if they could not be stored;
+ *          they are applied anyway
+ */
+EipStatus KC868_A16_DebounceSetConfig(const KC868_A16_InputDebounce *debounce);
+
+#endif /* CONFIG_KC868_INPUT_DEBOUNCE */
+
+#endif /* KC868_A16_DEBOUNCE_H_ */
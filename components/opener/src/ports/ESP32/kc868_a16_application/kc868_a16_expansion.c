@@ -0,0 +1,652 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_expansion.h"
+
+#if CONFIG_KC868_EXPANSION
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "seqlock.h"
+
+#include "driver/gpio.h"
+#include "driver/i2c_master.h"
+#include "esp_log.h"
+#include "i2c_manager.h"
+
+/* Timeout of one device access, a few hundred times its length on the
+ * wire */
+#define EXPANSION_BUS_TIMEOUT_MS 10
+#define EXPANSION_PROBE_TIMEOUT_MS 5
+
+/* A failing device is retried after its update period, doubling with
+ * every further failure up to this interval */
+#define EXPANSION_BACKOFF_MAX_US 1000000
+
+/* With the interrupt line the inputs are still polled at this interval,
+ * a missed edge cannot leave a stale input forever */
+#define EXPANSION_SAFETY_POLL_US 100000
+
+/* MCP23017 registers with IOCON.BANK = 0, ports A and B follow each other */
+#define MCP23017_IODIRA   0x00
+#define MCP23017_IPOLA    0x02
+#define MCP23017_GPINTENA 0x04
+#define MCP23017_INTCONA  0x08
+#define MCP23017_IOCON    0x0A
+#define MCP23017_GPPUA    0x0C
+#define MCP23017_GPIOA    0x12
+#define MCP23017_OLATA    0x14
+/* INTA and INTB mirrored, open drain so several devices share one line */
+#define MCP23017_IOCON_MIRROR 0x40
+#define MCP23017_IOCON_ODR    0x04
+
+static const char *TAG_EXPANSION = "kc868_exp";
+
+/* Scan task only, apart from the fixed device registry */
+typedef struct {
+  /* Reading: the register pointer of an MCP23017, then its two ports; a
+   * PCF8574 is read directly */
+  uint8_t read_register;
+  uint8_t read_data[2];
+  i2c_manager_op_t read_ops[2];
+  i2c_manager_scan_handle_t read_scan;
+  /* Writing: the output latch pointer and both ports, or the one port */
+  uint8_t write_data[3];
+  i2c_manager_op_t write_op;
+  i2c_manager_scan_handle_t write_scan;
+  uint8_t ports; /* 1 or 2 */
+  int64_t period_us;
+  int64_t next_read_us;
+  int64_t last_read_us;
+  uint32_t failures;
+  int64_t retry_time_us;
+  uint16_t written;
+  bool written_valid;
+} ExpansionSlot;
+
+static KC868_A16_ExpansionDevice s_devices[KC868_A16_EXPANSION_MAX_DEVICES];
+static ExpansionSlot s_slots[KC868_A16_EXPANSION_MAX_DEVICES];
+static size_t s_device_count = 0;
+static size_t s_input_bytes = 0;
+static size_t s_output_bytes = 0;
+static bool s_interrupt_line = false;
+
+/* Status and inputs of the last scan, scan task only, and the copy
+ * shared with the OpENer task */
+static EipUint8 s_scan_image[KC868_A16_EXPANSION_STATUS_SIZE + KC868_A16_EXPANSION_MAX_IMAGE_BYTES];
+static EipUint8 s_input_image[KC868_A16_EXPANSION_STATUS_SIZE + KC868_A16_EXPANSION_MAX_IMAGE_BYTES];
+static SeqLock s_input_image_lock;
+
+/* Single-slot output mailbox and the output mode, see kc868_a16_io.c */
+static EipUint8 s_output_mailbox[KC868_A16_EXPANSION_MAX_IMAGE_BYTES];
+static SeqLock s_output_mailbox_lock;
+static bool s_output_mailbox_pending = false;
+static KC868_A16_OutputMode s_requested_mode = kKc868OutputModeIdle;
+/* Scan task only: the image the outputs follow and the mode applied */
+static EipUint8 s_requested_outputs[KC868_A16_EXPANSION_MAX_IMAGE_BYTES];
+static KC868_A16_OutputMode s_output_mode = kKc868OutputModeIdle;
+
+static const char *TypeName(CipUsint type) {
+  return (kKc868ExpansionMcp23017 == type) ? "MCP23017" : "PCF8574";
+}
+
+/* Port value of pins at the logic level value, for the polarity of the
+ * outputs and the inputs */
+static uint16_t OutputLevels(uint16_t value) {
+#if CONFIG_KC868_EXPANSION_INVERT_OUTPUTS
+  return (uint16_t)~value;
+#else
+  return value;
+#endif
+}
+
+static uint16_t InputValues(uint16_t levels) {
+#if CONFIG_KC868_EXPANSION_INVERT_INPUTS
+  return (uint16_t)~levels;
+#else
+  return levels;
+#endif
+}
+
+static bool IsBoardAddress(uint8_t address, const uint8_t *board_addresses,
+                           size_t board_count) {
+  for (size_t i = 0; i < board_count; i++) {
+    if (board_addresses[i] == address) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* A PCF8574A only lives at 0x38-0x3F, at 0x20-0x27 both types do */
+static bool IsExpansionAddress(uint8_t address) {
+  return (address >= 0x20 && address <= 0x27) ||
+         (address >= 0x38 && address <= 0x3F);
+}
+
+static void SetDefaults(KC868_A16_ExpansionDevice *device, uint8_t address) {
+  memset(device, 0, sizeof(*device));
+  device->i2c_address = address;
+#if CONFIG_KC868_EXPANSION_DEFAULT_MCP23017
+  device->device_type = (address < 0x38) ? kKc868ExpansionMcp23017 :
+                        kKc868ExpansionPcf8574;
+#else
+  device->device_type = kKc868ExpansionPcf8574;
+#endif
+  if (kKc868ExpansionMcp23017 == device->device_type) {
+    device->pin_directions = CONFIG_KC868_EXPANSION_MCP23017_DIRECTIONS;
+    device->update_rate_ms = CONFIG_KC868_EXPANSION_MCP23017_UPDATE_MS;
+  } else {
+    device->pin_directions = CONFIG_KC868_EXPANSION_PCF8574_DIRECTIONS;
+    device->update_rate_ms = CONFIG_KC868_EXPANSION_PCF8574_UPDATE_MS;
+  }
+}
+
+/* One entry of CONFIG_KC868_EXPANSION_DEVICES,
+ * address:type:pin directions:update period in ms */
+static bool ParseDevice(const char *entry, KC868_A16_ExpansionDevice *device) {
+  int address = 0;
+  char type[9] = { 0 };
+  int directions = 0;
+  unsigned int update_ms = 0;
+  if (4 != sscanf(entry, "%i:%8[a-zA-Z0-9]:%i:%u", &address, type,
+                  &directions, &update_ms) ||
+      address < 0 || address > 0x7F || !IsExpansionAddress((uint8_t)address) ||
+      0 == update_ms || update_ms > UINT16_MAX) {
+    return false;
+  }
+  SetDefaults(device, (uint8_t)address);
+  if (0 == strcasecmp(type, "mcp23017") && address < 0x38) {
+    device->device_type = kKc868ExpansionMcp23017;
+  } else if (0 == strcasecmp(type, "pcf8574")) {
+    device->device_type = kKc868ExpansionPcf8574;
+  } else {
+    return false;
+  }
+  const int pins = (kKc868ExpansionMcp23017 == device->device_type) ?
+                   0xFFFF : 0xFF;
+  if (directions < 0 || directions > pins) {
+    return false;
+  }
+  device->pin_directions = (CipUint)directions;
+  device->update_rate_ms = (CipUint)update_ms;
+  return true;
+}
+
+static bool AddDevice(const KC868_A16_ExpansionDevice *device) {
+  for (size_t i = 0; i < s_device_count; i++) {
+    if (s_devices[i].i2c_address == device->i2c_address) {
+      return false;
+    }
+  }
+  if (s_device_count == KC868_A16_EXPANSION_MAX_DEVICES) {
+    return false;
+  }
+  s_devices[s_device_count++] = *device;
+  return true;
+}
+
+/* The configured devices, or every expansion address that answers */
+static void RegisterDevices(i2c_master_bus_handle_t bus,
+                            const uint8_t *board_addresses,
+                            size_t board_count) {
+  char list[] = CONFIG_KC868_EXPANSION_DEVICES;
+  char *save = NULL;
+  for (char *entry = strtok_r(list, " ,;", &save); NULL != entry;
+       entry = strtok_r(NULL, " ,;", &save)) {
+    KC868_A16_ExpansionDevice device;
+    if (!ParseDevice(entry, &device) ||
+        IsBoardAddress(device.i2c_address, board_addresses, board_count) ||
+        !AddDevice(&device)) {
+      ESP_LOGW(TAG_EXPANSION, "Ignoring expansion device \"%s\"", entry);
+    }
+  }
+  const bool listed = (0 != s_device_count);
+
+  for (unsigned int address = 0x20; address <= 0x3F; address++) {
+    if (!IsExpansionAddress((uint8_t)address) ||
+        IsBoardAddress((uint8_t)address, board_addresses, board_count)) {
+      continue;
+    }
+    const bool found = (ESP_OK == i2c_master_probe(bus, (uint16_t)address,
+                                                   EXPANSION_PROBE_TIMEOUT_MS));
+    if (listed) {
+      for (size_t i = 0; i < s_device_count; i++) {
+        if (s_devices[i].i2c_address == address) {
+          s_devices[i].detected = found;
+        }
+      }
+    } else if (found) {
+      KC868_A16_ExpansionDevice device;
+      SetDefaults(&device, (uint8_t)address);
+      device.detected = true;
+      (void)AddDevice(&device);
+    }
+  }
+}
+
+/* Byte ranges in the order of the devices: one input byte per port with
+ * an input pin, one output byte per port with an output pin */
+static void AssignByteRanges(void) {
+  for (size_t i = 0; i < s_device_count; i++) {
+    KC868_A16_ExpansionDevice *const device = &s_devices[i];
+    const uint8_t ports = (kKc868ExpansionMcp23017 == device->device_type) ?
+                          2 : 1;
+    device->input_bytes = 0;
+    device->output_bytes = 0;
+    for (uint8_t port = 0; port < ports; port++) {
+      const uint8_t inputs = (uint8_t)(device->pin_directions >> (8 * port));
+      device->input_bytes += (0 != inputs) ? 1 : 0;
+      device->output_bytes += (0xFF != inputs) ? 1 : 0;
+    }
+    device->input_byte_start = (0 != device->input_bytes) ?
+                               (CipUsint)s_input_bytes :
+                               KC868_A16_EXPANSION_NO_BYTES;
+    device->output_byte_start = (0 != device->output_bytes) ?
+                                (CipUsint)s_output_bytes :
+                                KC868_A16_EXPANSION_NO_BYTES;
+    s_input_bytes += device->input_bytes;
+    s_output_bytes += device->output_bytes;
+    s_slots[i].ports = ports;
+  }
+}
+
+static esp_err_t WriteRegisters(uint8_t address, uint8_t *data, size_t length) {
+  i2c_manager_op_t op = {
+    .type = I2C_MANAGER_OP_WRITE,
+    .address = address,
+    .data = data,
+    .length = length,
+  };
+  i2c_manager_scan_handle_t scan = NULL;
+  esp_err_t ret = i2c_manager_create_scan(&op, 1, &scan);
+  if (ESP_OK == ret) {
+    ret = i2c_manager_execute_scan(scan, EXPANSION_BUS_TIMEOUT_MS);
+    (void)i2c_manager_delete_scan(scan);
+  }
+  return ret;
+}
+
+/* Port value written to a device: the outputs at value, the input pins of
+ * a PCF8574 released high so they can be read */
+static uint16_t PortValue(const KC868_A16_ExpansionDevice *device,
+                          uint16_t value) {
+  const uint16_t inputs = device->pin_directions;
+  uint16_t levels = (uint16_t)(OutputLevels(value) & ~inputs);
+  if (kKc868ExpansionPcf8574 == device->device_type) {
+    levels |= inputs;
+  }
+  return levels;
+}
+
+/* Outputs released before the pins are switched to outputs */
+static esp_err_t SetUpMcp23017(const KC868_A16_ExpansionDevice *device) {
+  const uint8_t address = device->i2c_address;
+  const uint16_t inputs = device->pin_directions;
+  const uint16_t released = PortValue(device, 0);
+  const uint16_t interrupts = s_interrupt_line ? inputs : 0;
+  uint8_t iocon[] = { MCP23017_IOCON,
+                      MCP23017_IOCON_MIRROR | MCP23017_IOCON_ODR };
+  uint8_t olat[] = { MCP23017_OLATA, (uint8_t)released,
+                     (uint8_t)(released >> 8) };
+  uint8_t ipol[] = { MCP23017_IPOLA, 0, 0 };
+  uint8_t iodir[] = { MCP23017_IODIRA, (uint8_t)inputs,
+                      (uint8_t)(inputs >> 8) };
+  uint8_t gppu[] = { MCP23017_GPPUA, (uint8_t)inputs,
+                     (uint8_t)(inputs >> 8) };
+  /* Interrupt on any change against the previous value */
+  uint8_t intcon[] = { MCP23017_INTCONA, 0, 0 };
+  uint8_t gpinten[] = { MCP23017_GPINTENA, (uint8_t)interrupts,
+                        (uint8_t)(interrupts >> 8) };
+  struct {
+    uint8_t *data;
+    size_t length;
+  } const steps[] = {
+    { iocon, sizeof(iocon) }, { olat, sizeof(olat) }, { ipol, sizeof(ipol) },
+    { iodir, sizeof(iodir) }, { gppu, sizeof(gppu) },
+    { intcon, sizeof(intcon) }, { gpinten, sizeof(gpinten) },
+  };
+  for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+    const esp_err_t ret = WriteRegisters(address, steps[i].data,
+                                         steps[i].length);
+    if (ESP_OK != ret) {
+      return ret;
+    }
+  }
+  return ESP_OK;
+}
+
+static esp_err_t CreateScanLists(size_t index) {
+  const KC868_A16_ExpansionDevice *const device = &s_devices[index];
+  ExpansionSlot *const slot = &s_slots[index];
+  const bool mcp23017 = (kKc868ExpansionMcp23017 == device->device_type);
+  esp_err_t ret = ESP_OK;
+  if (0 != device->input_bytes) {
+    slot->read_register = MCP23017_GPIOA;
+    size_t ops = 0;
+    if (mcp23017) {
+      slot->read_ops[ops++] = (i2c_manager_op_t) {
+        .type = I2C_MANAGER_OP_WRITE,
+        .address = device->i2c_address,
+        .data = &slot->read_register,
+        .length = 1,
+      };
+    }
+    /* Repeated START, GPIOA and GPIOB in one read */
+    slot->read_ops[ops++] = (i2c_manager_op_t) {
+      .type = I2C_MANAGER_OP_READ,
+      .address = device->i2c_address,
+      .data = slot->read_data,
+      .length = slot->ports,
+    };
+    ret = i2c_manager_create_scan(slot->read_ops, ops, &slot->read_scan);
+  }
+  if (ESP_OK == ret && 0 != device->output_bytes) {
+    slot->write_data[0] = MCP23017_OLATA;
+    slot->write_op = (i2c_manager_op_t) {
+      .type = I2C_MANAGER_OP_WRITE,
+      .address = device->i2c_address,
+      .data = mcp23017 ? slot->write_data : &slot->write_data[1],
+      .length = mcp23017 ? 3 : 1,
+    };
+    ret = i2c_manager_create_scan(&slot->write_op, 1, &slot->write_scan);
+  }
+  return ret;
+}
+
+static void InitializeInterruptLine(void) {
+#if CONFIG_KC868_EXPANSION_INT_GPIO >= 0
+  const gpio_config_t config = {
+    .pin_bit_mask = 1ULL << CONFIG_KC868_EXPANSION_INT_GPIO,
+    .mode = GPIO_MODE_INPUT,
+    .pull_up_en = GPIO_PULLUP_ENABLE,
+    .pull_down_en = GPIO_PULLDOWN_DISABLE,
+    .intr_type = GPIO_INTR_DISABLE,
+  };
+  s_interrupt_line = (ESP_OK == gpio_config(&config));
+  if (!s_interrupt_line) {
+    ESP_LOGW(TAG_EXPANSION, "INT line on GPIO%d unavailable, polling",
+             CONFIG_KC868_EXPANSION_INT_GPIO);
+  }
+#endif
+}
+
+size_t KC868_A16_ExpansionInitialize(const uint8_t *board_addresses,
+                                     size_t board_count) {
+  i2c_master_bus_handle_t bus = NULL;
+  if (0 != s_device_count || ESP_OK != i2c_manager_get_bus(&bus)) {
+    return s_device_count;
+  }
+  InitializeInterruptLine();
+  RegisterDevices(bus, board_addresses, board_count);
+  AssignByteRanges();
+
+  for (size_t i = 0; i < s_device_count; i++) {
+    KC868_A16_ExpansionDevice *const device = &s_devices[i];
+    ExpansionSlot *const slot = &s_slots[i];
+    slot->period_us = (int64_t)device->update_rate_ms * 1000;
+    /* The first pass reads the inputs whatever the INT line */
+    slot->last_read_us = -EXPANSION_SAFETY_POLL_US;
+    esp_err_t ret = CreateScanLists(i);
+    if (ESP_OK != ret) {
+      ESP_LOGE(TAG_EXPANSION, "Failed to create the scan lists of 0x%02X: %s",
+               device->i2c_address, esp_err_to_name(ret));
+      device->detected = false;
+    }
+    if (device->detected) {
+      if (kKc868ExpansionMcp23017 == device->device_type) {
+        ret = SetUpMcp23017(device);
+      } else {
+        uint8_t released = (uint8_t)PortValue(device, 0);
+        ret = WriteRegisters(device->i2c_address, &released, 1);
+      }
+      if (ESP_OK != ret) {
+        ESP_LOGE(TAG_EXPANSION, "Failed to set up %s 0x%02X: %s",
+                 TypeName(device->device_type), device->i2c_address,
+                 esp_err_to_name(ret));
+      }
+    }
+    /* Not answering: retried by the scans like a device that fails later */
+    slot->written = PortValue(device, 0);
+    slot->written_valid = device->detected;
+    slot->failures = device->detected ? 0 : 1;
+    if (!device->detected) {
+      s_scan_image[i / 8] |= (EipUint8)(1u << (i % 8));
+    }
+    ESP_LOGI(TAG_EXPANSION,
+             "%s 0x%02X%s: pins 0x%04X inputs, %u in at %u, %u out at %u, every %u ms",
+             TypeName(device->device_type), device->i2c_address,
+             device->detected ? "" : " (not found)",
+             (unsigned int)device->pin_directions,
+             (unsigned int)device->input_bytes,
+             (unsigned int)device->input_byte_start,
+             (unsigned int)device->output_bytes,
+             (unsigned int)device->output_byte_start,
+             (unsigned int)device->update_rate_ms);
+  }
+  memcpy(s_input_image, s_scan_image, sizeof(s_input_image));
+  ESP_LOGI(TAG_EXPANSION, "%zu expansion devices, %zu input and %zu output bytes%s",
+           s_device_count, s_input_bytes, s_output_bytes,
+           s_interrupt_line ? ", inputs read on INT" : "");
+  return s_device_count;
+}
+
+size_t KC868_A16_ExpansionGetDevices(const KC868_A16_ExpansionDevice **devices) {
+  *devices = s_devices;
+  return s_device_count;
+}
+
+size_t KC868_A16_ExpansionInputImageSize(void) {
+  return (0 != s_device_count) ?
+         KC868_A16_EXPANSION_STATUS_SIZE + s_input_bytes : 0;
+}
+
+size_t KC868_A16_ExpansionOutputImageSize(void) {
+  return s_output_bytes;
+}
+
+/* Count the access of a device, back it off while it fails and keep its
+ * status bit; true if the access succeeded */
+static bool UpdateHealth(size_t index, esp_err_t result, int64_t now_us) {
+  KC868_A16_ExpansionDevice *const device = &s_devices[index];
+  ExpansionSlot *const slot = &s_slots[index];
+  EipUint8 *const status = &s_scan_image[index / 8];
+  const EipUint8 bit = (EipUint8)(1u << (index % 8));
+  if (ESP_OK == result) {
+    if (slot->failures > 0) {
+      ESP_LOGI(TAG_EXPANSION, "%s 0x%02X answers again",
+               TypeName(device->device_type), device->i2c_address);
+      slot->failures = 0;
+      *status &= (EipUint8)~bit;
+      if (!device->detected && kKc868ExpansionMcp23017 == device->device_type) {
+        /* Powered up after the boot, its registers are at their reset
+         * values */
+        (void)SetUpMcp23017(device);
+      }
+      device->detected = true;
+    }
+    return true;
+  }
+  if (0 == slot->failures) {
+    ESP_LOGW(TAG_EXPANSION, "%s 0x%02X failed: %s, retrying with backoff",
+             TypeName(device->device_type), device->i2c_address,
+             esp_err_to_name(result));
+    *status |= bit;
+  }
+  if (slot->failures < 16) {
+    slot->failures++;
+  }
+  int64_t backoff_us = slot->period_us << (slot->failures - 1);
+  if (backoff_us > EXPANSION_BACKOFF_MAX_US) {
+    backoff_us = EXPANSION_BACKOFF_MAX_US;
+  }
+  slot->retry_time_us = now_us + backoff_us;
+  return false;
+}
+
+static bool Accessible(size_t index, int64_t now_us) {
+  const ExpansionSlot *const slot = &s_slots[index];
+  return 0 == slot->failures || now_us - slot->retry_time_us >= 0;
+}
+
+static void TakeOutputs(void) {
+  if (__atomic_exchange_n(&s_output_mailbox_pending, false, __ATOMIC_ACQUIRE)) {
+    /* The posting task never runs below the scan task on the same core */
+    while (!SeqLockRead(&s_output_mailbox_lock, s_requested_outputs,
+                        s_output_mailbox, s_output_bytes, NULL)) {
+    }
+  }
+  const KC868_A16_OutputMode mode =
+    __atomic_load_n(&s_requested_mode, __ATOMIC_ACQUIRE);
+  if (mode == s_output_mode) {
+    return;
+  }
+  s_output_mode = mode;
+#if CONFIG_KC868_OUTPUT_SAFE_STATE_CLEAR
+  if (kKc868OutputModeRun != mode) {
+    /* Until an image is posted again, by the connection or the web UI */
+    memset(s_requested_outputs, 0, sizeof(s_requested_outputs));
+    ESP_LOGI(TAG_EXPANSION, "Expansion outputs released, %s",
+             (kKc868OutputModeFault == mode) ? "faulted" : "idle");
+  }
+#endif
+}
+
+static void WriteOutputs(int64_t now_us) {
+  for (size_t i = 0; i < s_device_count; i++) {
+    const KC868_A16_ExpansionDevice *const device = &s_devices[i];
+    ExpansionSlot *const slot = &s_slots[i];
+    if (0 == device->output_bytes) {
+      continue;
+    }
+    /* The output bytes belong to the ports with output pins, in order */
+    uint16_t value = 0;
+    size_t byte = device->output_byte_start;
+    for (uint8_t port = 0; port < slot->ports; port++) {
+      if (0xFF != (uint8_t)(device->pin_directions >> (8 * port))) {
+        value |= (uint16_t)(s_requested_outputs[byte++] << (8 * port));
+      }
+    }
+    const uint16_t levels = PortValue(device, value);
+    if ((slot->written_valid && slot->written == levels) ||
+        !Accessible(i, now_us)) {
+      continue;
+    }
+    slot->write_data[1] = (uint8_t)levels;
+    slot->write_data[2] = (uint8_t)(levels >> 8);
+    const esp_err_t ret =
+      i2c_manager_execute_scan(slot->write_scan, EXPANSION_BUS_TIMEOUT_MS);
+    slot->written = levels;
+    slot->written_valid = UpdateHealth(i, ret, now_us);
+  }
+}
+
+/* Inputs due at the update period, with the INT line only while asserted
+ * or at the safety poll */
+static bool ReadInputs(int64_t now_us) {
+  bool asserted = true;
+#if CONFIG_KC868_EXPANSION_INT_GPIO >= 0
+  if (s_interrupt_line) {
+    asserted = (0 == gpio_get_level((gpio_num_t)CONFIG_KC868_EXPANSION_INT_GPIO));
+  }
+#endif
+  bool accessed = false;
+  for (size_t i = 0; i < s_device_count; i++) {
+    const KC868_A16_ExpansionDevice *const device = &s_devices[i];
+    ExpansionSlot *const slot = &s_slots[i];
+    if (0 == device->input_bytes || now_us - slot->next_read_us < 0 ||
+        !Accessible(i, now_us)) {
+      continue;
+    }
+    if (!asserted && now_us - slot->last_read_us < EXPANSION_SAFETY_POLL_US) {
+      continue;
+    }
+    slot->next_read_us += slot->period_us;
+    if (now_us - slot->next_read_us >= 0) {
+      /* Far behind, e.g. after a backoff: restart the period from now */
+      slot->next_read_us = now_us + slot->period_us;
+    }
+    slot->last_read_us = now_us;
+    accessed = true;
+    const esp_err_t ret =
+      i2c_manager_execute_scan(slot->read_scan, EXPANSION_BUS_TIMEOUT_MS);
+    if (!UpdateHealth(i, ret, now_us)) {
+      continue; /* the inputs keep the last value read */
+    }
+    const uint16_t levels = InputValues((uint16_t)(slot->read_data[0] |
+                                                   (slot->read_data[1] << 8)));
+    size_t byte = KC868_A16_EXPANSION_STATUS_SIZE + device->input_byte_start;
+    for (uint8_t port = 0; port < slot->ports; port++) {
+      if (0 != (uint8_t)(device->pin_directions >> (8 * port))) {
+        s_scan_image[byte++] = (uint8_t)(levels >> (8 * port));
+      }
+    }
+  }
+  return accessed;
+}
+
+bool KC868_A16_ExpansionScan(int64_t now_us, bool read_inputs) {
+  if (0 == s_device_count) {
+    return false;
+  }
+  TakeOutputs();
+  WriteOutputs(now_us);
+  if (!read_inputs || !ReadInputs(now_us)) {
+    return false;
+  }
+  const size_t size = KC868_A16_ExpansionInputImageSize();
+  if (0 == memcmp(s_scan_image, s_input_image, size)) {
+    return false;
+  }
+  SeqLockWrite(&s_input_image_lock, s_input_image, s_scan_image, size);
+  return true;
+}
+
+bool KC868_A16_ExpansionGetInputImage(EipUint8 *image) {
+  EipUint8 copy[sizeof(s_input_image)];
+  const size_t size = KC868_A16_ExpansionInputImageSize();
+  if (!SeqLockRead(&s_input_image_lock, copy, s_input_image, size, NULL)) {
+    return false;
+  }
+  memcpy(image, copy, size);
+  return true;
+}
+
+void KC868_A16_ExpansionPostOutputImage(const EipUint8 *image) {
+  if (0 == s_output_bytes) {
+    return;
+  }
+  SeqLockWrite(&s_output_mailbox_lock, s_output_mailbox, image, s_output_bytes);
+  __atomic_store_n(&s_output_mailbox_pending, true, __ATOMIC_RELEASE);
+  KC868_A16_IoWakeExpansion();
+}
+
+void KC868_A16_ExpansionSetOutputMode(KC868_A16_OutputMode mode) {
+  if (mode == __atomic_exchange_n(&s_requested_mode, mode, __ATOMIC_RELEASE)) {
+    return;
+  }
+  KC868_A16_IoWakeExpansion();
+}
+
+#endif /* CONFIG_KC868_EXPANSION */
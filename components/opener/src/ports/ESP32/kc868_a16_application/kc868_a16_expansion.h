@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_EXPANSION_H_
+#define KC868_A16_EXPANSION_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "kc868_a16_io.h"
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_expansion.h
+ *  @brief Expansion expanders on the I2C bus of the board
+ *
+ *  PCF8574 and MCP23017 expanders next to the four PCF8574 of the board are
+ *  registered at boot, either the ones of CONFIG_KC868_EXPANSION_DEVICES or
+ *  every address that answers. Each device gets a byte range of the
+ *  expansion input image and of the expansion output image, in the order of
+ *  the list or of the addresses, so the expansion assemblies are as large
+ *  as the devices need. Listed devices keep their range while they do not
+ *  answer, the layout only changes with the list.
+ *
+ *  The I/O scan task accesses every device at its own update period. An
+ *  MCP23017 reads its 16 pins in one transaction, where two PCF8574 take
+ *  two. With CONFIG_KC868_EXPANSION_INT_GPIO the MCP23017 mirror both
+ *  ports on one open drain INT output; the inputs are only read while that
+ *  line is asserted, and at a slow safety poll.
+ *
+ *  The expansion input image starts with the device status, a UINT with bit
+ *  n set while device n does not answer, followed by the input bytes.
+ */
+
+/** Addresses 0x20-0x27 and 0x38-0x3F without the board's four expanders */
+#define KC868_A16_EXPANSION_MAX_DEVICES 12
+/** Largest expansion input or output image without the status: four
+ *  MCP23017 and eight PCF8574A */
+#define KC868_A16_EXPANSION_MAX_IMAGE_BYTES 16
+/** Size of the device status in front of the expansion inputs */
+#define KC868_A16_EXPANSION_STATUS_SIZE 2
+/** Byte start of a device without inputs or outputs */
+#define KC868_A16_EXPANSION_NO_BYTES    0xFF
+
+typedef enum {
+  kKc868ExpansionPcf8574 = 0, /**< 8 quasi-bidirectional pins, PCF8574 or PCF8574A */
+  kKc868ExpansionMcp23017 = 1, /**< 16 pins in ports A and B */
+} KC868_A16_ExpansionType;
+
+/** @brief A registered device, fields named as the devices of the web API */
+typedef struct {
+  CipUsint i2c_address;
+  CipUsint device_type; /**< KC868_A16_ExpansionType */
+  CipUint pin_directions; /**< bit n set: pin n is an input, port B of an MCP23017 from bit 8 */
+  CipUsint input_byte_start; /**< in the expansion inputs, after the status */
+  CipUsint input_bytes;
+  CipUsint output_byte_start; /**< in the expansion output image */
+  CipUsint output_bytes;
+  CipUint update_rate_ms;
+  bool detected; /**< answered at boot */
+} KC868_A16_ExpansionDevice;
+
+#if CONFIG_KC868_EXPANSION
+
+/** @brief Register the expansion devices and set them up
+ *
+ *  Called by KC868_A16_IoInitialize() once the bus is up, before the scan
+ *  task starts. Outputs start released.
+ *
+ *  @param board_addresses addresses of the board's expanders, not probed
+ *  @param board_count number of board_addresses
+ *  @return number of registered devices
+ */
+size_t KC868_A16_ExpansionInitialize(const uint8_t *board_addresses,
+                                     size_t board_count);
+
+/** @brief The registered devices, in the order of their byte ranges
+ *
+ *  Fixed after KC868_A16_ExpansionInitialize(), apart from detected.
+ *
+ *  @param devices receives a pointer to the devices
+ *  @return number of devices
+ */
+size_t KC868_A16_ExpansionGetDevices(const KC868_A16_ExpansionDevice **devices);
+
+/** @brief Size of the expansion input image, the status included */
+size_t KC868_A16_ExpansionInputImageSize(void);
+
+/** @brief Size of the expansion output image, 0 without output pins */
+size_t KC868_A16_ExpansionOutputImageSize(void);
+
+/** @brief Access the devices that are due, called by the I/O scan task
+ *
+ *  Changed outputs are written right away, inputs are read at the update
+ *  period of their device.
+ *
+ *  @param now_us esp_timer time
+ *  @param read_inputs false on a pass that only handles outputs
+ *  @return true if an input or the device status changed
+ */
+bool KC868_A16_ExpansionScan(int64_t now_us, bool read_inputs);
+
+/** @brief Copy the most recent consistent expansion input image
+ *
+ *  Same sequence lock scheme as KC868_A16_IoGetInputImage().
+ *
+ *  @param image KC868_A16_ExpansionInputImageSize() bytes
+ *  @return true if image was updated
+ */
+bool KC868_A16_ExpansionGetInputImage(EipUint8 *image);
+
+/** @brief Hand a new expansion output image to the I/O scan task
+ *
+ *  Single-slot mailbox as KC868_A16_IoPostOutputImage().
+ *
+ *  @param image KC868_A16_ExpansionOutputImageSize() bytes, bit set = on
+ */
+void KC868_A16_ExpansionPostOutputImage(const EipUint8 *image);
+
+/** @brief Switch the expansion outputs between run, idle and fault
+ *
+ *  Outside the run mode the outputs are released, or hold their state
+ *  without CONFIG_KC868_OUTPUT_SAFE_STATE_CLEAR, until an image is posted.
+ *
+ *  @param mode new mode
+ */
+void KC868_A16_ExpansionSetOutputMode(KC868_A16_OutputMode mode);
+
+#endif /* CONFIG_KC868_EXPANSION */
+
+#endif /* KC868_A16_EXPANSION_H_ */
@@ -0,0 +1,594 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "kc868_a16_history.h"
+
+#if CONFIG_KC868_HISTORY
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+#include "heap_class.h"
+#include "esp_memory_utils.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#if CONFIG_OPENER_SNTP_CLOCK
+#include "sntp_clock.h"
+#endif
+
+/* UINT length, UDINT samples */
+#define HISTORY_BLOCK_HEADER_SIZE 6U
+/* The header, the time and the first sample */
+#define HISTORY_KEYFRAME_SIZE \
+  (HISTORY_BLOCK_HEADER_SIZE + 8U + KC868_A16_HISTORY_SAMPLE_SIZE)
+/* Deltas and counts are kept below 4 varint bytes, a longer gap starts a
+ * new block */
+#define HISTORY_MAX_VARINT 0x0FFFFFFFU
+/* Largest records: mask, delta and every byte; mask, count and delta */
+#define HISTORY_CHANGE_RECORD_MAX (2U + 4U + KC868_A16_HISTORY_SAMPLE_SIZE)
+#define HISTORY_REPEAT_RECORD_MAX (1U + 4U + 4U)
+#define HISTORY_FILE_HEADER_SIZE 16U
+/* Longest CSV line */
+#define HISTORY_CSV_LINE_SIZE 96U
+
+_Static_assert(KC868_A16_HISTORY_SAMPLE_SIZE <= 14,
+               "the change mask has to fit a 2 byte varint");
+
+typedef enum {
+  kHistoryStageHeader = 0,
+  kHistoryStageBlocks,
+  kHistoryStageFooter,
+  kHistoryStageEnd,
+} HistoryStage;
+
+/* The blocks are written by the scan task. Which blocks are held, the
+ * header of the block written and the trigger change under the lock, and
+ * readers copy a block under it. */
+static uint8_t *s_buffer = NULL;
+static uint32_t s_block_count = 0;
+static bool s_psram = false;
+static bool s_started = false; /* the first block was begun */
+static uint32_t s_head = 0; /* number of the block written */
+static uint32_t s_oldest = 0; /* number of the oldest block held */
+static uint32_t s_samples_before_head = 0; /* samples of the other blocks */
+static uint32_t s_pending_samples = 0; /* unchanged scans not yet written */
+static uint32_t s_overwritten = 0;
+static EipUint64 s_newest_us = 0;
+static bool s_frozen = false;
+static KC868_A16_HistoryTriggerSource s_trigger = kKc868HistoryTriggerNone;
+static EipUint64 s_trigger_time_us = 0;
+static uint32_t s_post_remaining = 0;
+static KC868_A16_HistoryTriggerConfig s_config = {
+  .inputs = CONFIG_KC868_HISTORY_TRIGGER_INPUTS,
+#if CONFIG_KC868_HISTORY_TRIGGER_TIMEOUT
+  .timeout = true,
+#endif
+  .post_trigger = CONFIG_KC868_HISTORY_POST_TRIGGER,
+};
+static portMUX_TYPE s_history_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Encoder state, scan task only */
+static size_t s_used = 0; /* bytes of the head block */
+static uint32_t s_block_samples = 0;
+static int64_t s_last_us = 0; /* time of the last sample written */
+static uint8_t s_sample[KC868_A16_HISTORY_SAMPLE_SIZE];
+static uint32_t s_repeat = 0; /* unchanged samples since */
+static int64_t s_repeat_us = 0; /* time of the last of them */
+static bool s_new_block = true; /* begin a block with the next sample */
+
+static const char *const kHistoryTriggerNames[] = {
+  "none", "input", "timeout", "request",
+};
+
+/* Times kept in the blocks and the status; the varints between the samples
+ * of a block stay esp_timer differences */
+static EipUint64 WallTime(int64_t time_us) {
+#if CONFIG_OPENER_SNTP_CLOCK
+  return (EipUint64)SntpClockFromLocalTime(time_us);
+#else
+  return (EipUint64)time_us;
+#endif
+}
+
+static uint8_t *BlockAt(uint32_t number) {
+  return s_buffer + (size_t)(number % s_block_count) *
+         KC868_A16_HISTORY_BLOCK_SIZE;
+}
+
+static void PutUint16(uint8_t *data, uint16_t value) {
+  data[0] = (uint8_t)value;
+  data[1] = (uint8_t)(value >> 8);
+}
+
+static void PutUint32(uint8_t *data, uint32_t value) {
+  PutUint16(data, (uint16_t)value);
+  PutUint16(data + 2, (uint16_t)(value >> 16));
+}
+
+static void PutUint64(uint8_t *data, uint64_t value) {
+  PutUint32(data, (uint32_t)value);
+  PutUint32(data + 4, (uint32_t)(value >> 32));
+}
+
+static uint16_t GetUint16(const uint8_t *data) {
+  return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static uint32_t GetUint32(const uint8_t *data) {
+  return GetUint16(data) | ((uint32_t)GetUint16(data + 2) << 16);
+}
+
+static uint64_t GetUint64(const uint8_t *data) {
+  return GetUint32(data) | ((uint64_t)GetUint32(data + 4) << 32);
+}
+
+static size_t PutVarint(uint8_t *data, uint32_t value) {
+  size_t length = 0;
+  while (value >= 0x80U) {
+    data[length++] = (uint8_t)(value | 0x80U);
+    value >>= 7;
+  }
+  data[length++] = (uint8_t)value;
+  return length;
+}
+
+/* Bytes taken by the varint at data, 0 if it runs past end */
+static size_t GetVarint(const uint8_t *data, const uint8_t *end,
+                        uint32_t *value) {
+  *value = 0;
+  for (size_t length = 0; length < 5 && data + length < end; ++length) {
+    *value |= (uint32_t)(data[length] & 0x7FU) << (7 * length);
+    if (0 == (data[length] & 0x80U)) {
+      return length + 1;
+    }
+  }
+  return 0;
+}
+
+/* Called under the lock with a trigger that applies */
+static void TriggerLocked(KC868_A16_HistoryTriggerSource trigger,
+                          EipUint64 time_us) {
+  if (kKc868HistoryTriggerNone != s_trigger) {
+    return;
+  }
+  s_trigger = trigger;
+  s_trigger_time_us = time_us;
+  s_post_remaining = s_config.post_trigger;
+}
+
+/* Write the unchanged samples counted so far, which always fit: every
+ * other record leaves room for this one */
+static void FlushRepeats(void) {
+  if (0 == s_repeat) {
+    return;
+  }
+  uint8_t *const block = BlockAt(s_head);
+  block[s_used++] = 0;
+  s_used += PutVarint(block + s_used, s_repeat);
+  s_used += PutVarint(block + s_used, (uint32_t)(s_repeat_us - s_last_us));
+  s_block_samples += s_repeat;
+  s_last_us = s_repeat_us;
+  s_repeat = 0;
+}
+
+/* Make the written bytes visible to the readers */
+static void PublishLocked(void) {
+  uint8_t *const block = BlockAt(s_head);
+  PutUint16(block, (uint16_t)s_used);
+  PutUint32(block + 2, s_block_samples);
+  s_pending_samples = s_repeat;
+}
+
+static void BeginBlock(const uint8_t *sample, int64_t time_us) {
+  taskENTER_CRITICAL(&s_history_lock);
+  if (s_started) {
+    /* With the repeats flushed just before */
+    PublishLocked();
+    s_samples_before_head += GetUint32(BlockAt(s_head) + 2);
+    s_head++;
+    if (s_head - s_oldest >= s_block_count) {
+      s_samples_before_head -= GetUint32(BlockAt(s_oldest) + 2);
+      s_oldest++;
+      s_overwritten++;
+    }
+  }
+  s_started = true;
+  /* Readers skip the block until the first sample is in */
+  uint8_t *const block = BlockAt(s_head);
+  PutUint16(block, 0);
+  PutUint32(block + 2, 0);
+  taskEXIT_CRITICAL(&s_history_lock);
+
+  PutUint64(block + HISTORY_BLOCK_HEADER_SIZE, WallTime(time_us));
+  memcpy(block + HISTORY_BLOCK_HEADER_SIZE + 8U, sample,
+         KC868_A16_HISTORY_SAMPLE_SIZE);
+  s_used = HISTORY_KEYFRAME_SIZE;
+  s_block_samples = 1;
+  s_last_us = time_us;
+  s_new_block = false;
+}
+
+static void WriteChange(uint32_t mask, const uint8_t *sample,
+                        int64_t time_us) {
+  uint8_t *const block = BlockAt(s_head);
+  s_used += PutVarint(block + s_used, mask);
+  s_used += PutVarint(block + s_used, (uint32_t)(time_us - s_last_us));
+  for (size_t i = 0; i < KC868_A16_HISTORY_SAMPLE_SIZE; ++i) {
+    if (0 != (mask & (1U << i))) {
+      block[s_used++] = sample[i];
+    }
+  }
+  s_block_samples++;
+  s_last_us = time_us;
+}
+
+void KC868_A16_HistoryInitialize(void) {
+  if (NULL != s_buffer) {
+    return;
+  }
+  size_t size = 0;
+#if CONFIG_SPIRAM
+  size = (size_t)CONFIG_KC868_HISTORY_PSRAM_SIZE_KB * 1024U;
+  s_buffer = heap_class_malloc(HEAP_CLASS_BULK, size);
+  if (NULL != s_buffer && !esp_ptr_external_ram(s_buffer)) {
+    /* The PSRAM size is not meant for internal RAM */
+    heap_class_free(HEAP_CLASS_BULK, s_buffer);
+    s_buffer = NULL;
+  }
+#endif
+  if (NULL == s_buffer) {
+    size = (size_t)CONFIG_KC868_HISTORY_SIZE_KB * 1024U;
+    s_buffer = heap_class_malloc(HEAP_CLASS_BULK, size);
+  }
+  if (NULL == s_buffer) {
+    OPENER_TRACE_ERR("History: no %u bytes for the buffer\n", (unsigned)size);
+    return;
+  }
+  s_psram = esp_ptr_external_ram(s_buffer);
+  s_block_count = (uint32_t)(size / KC868_A16_HISTORY_BLOCK_SIZE);
+  OPENER_TRACE_INFO("History: %u blocks in %s\n", (unsigned)s_block_count,
+                    s_psram ? "PSRAM" : "internal RAM");
+}
+
+void KC868_A16_HistoryRecord(const EipUint8 *inputs, const EipUint8 *outputs,
+                             int64_t time_us) {
+  if (NULL == s_buffer) {
+    return;
+  }
+  if (__atomic_load_n(&s_frozen, __ATOMIC_ACQUIRE)) {
+    /* Resume with a full sample after the gap */
+    s_new_block = true;
+    return;
+  }
+  uint8_t sample[KC868_A16_HISTORY_SAMPLE_SIZE];
+  memcpy(sample, inputs, KC868_A16_INPUT_IMAGE_SIZE);
+  memcpy(sample + KC868_A16_INPUT_IMAGE_SIZE, outputs,
+         KC868_A16_OUTPUT_IMAGE_SIZE);
+  const EipUint16 edges = !s_new_block ?
+                          (EipUint16)(GetUint16(sample) ^ GetUint16(s_sample)) :
+                          0;
+
+  if (s_new_block) {
+    BeginBlock(sample, time_us);
+  } else {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < KC868_A16_HISTORY_SAMPLE_SIZE; ++i) {
+      if (sample[i] != s_sample[i]) {
+        mask |= 1U << i;
+      }
+    }
+    if (0 == mask && s_repeat < HISTORY_MAX_VARINT &&
+        time_us - s_last_us <= (int64_t)HISTORY_MAX_VARINT) {
+      s_repeat++;
+      s_repeat_us = time_us;
+    } else {
+      FlushRepeats();
+      if (time_us - s_last_us > (int64_t)HISTORY_MAX_VARINT ||
+          s_used + HISTORY_CHANGE_RECORD_MAX + HISTORY_REPEAT_RECORD_MAX >
+          KC868_A16_HISTORY_BLOCK_SIZE) {
+        BeginBlock(sample, time_us);
+      } else {
+        WriteChange(mask, sample, time_us);
+      }
+    }
+  }
+  memcpy(s_sample, sample, sizeof(s_sample));
+
+  bool freeze = false;
+  KC868_A16_HistoryTriggerSource trigger = kKc868HistoryTriggerNone;
+  const EipUint64 wall_us = WallTime(time_us);
+  taskENTER_CRITICAL(&s_history_lock);
+  PublishLocked();
+  s_newest_us = wall_us;
+  if (0 != (edges & s_config.inputs)) {
+    TriggerLocked(kKc868HistoryTriggerInput, wall_us);
+  }
+  trigger = s_trigger;
+  if (kKc868HistoryTriggerNone != trigger) {
+    if (0 == s_post_remaining) {
+      freeze = true;
+    } else {
+      s_post_remaining--;
+    }
+  }
+  taskEXIT_CRITICAL(&s_history_lock);
+
+  if (freeze) {
+    FlushRepeats();
+    taskENTER_CRITICAL(&s_history_lock);
+    PublishLocked();
+    __atomic_store_n(&s_frozen, true, __ATOMIC_RELEASE);
+    taskEXIT_CRITICAL(&s_history_lock);
+    OPENER_TRACE_INFO("History: frozen, %s trigger\n",
+                      kHistoryTriggerNames[trigger]);
+  }
+}
+
+void KC868_A16_HistoryTrigger(KC868_A16_HistoryTriggerSource trigger) {
+  const EipUint64 now = WallTime(esp_timer_get_time());
+  taskENTER_CRITICAL(&s_history_lock);
+  if (kKc868HistoryTriggerTimeout != trigger || s_config.timeout) {
+    TriggerLocked(trigger, now);
+  }
+  taskEXIT_CRITICAL(&s_history_lock);
+}
+
+void KC868_A16_HistoryArm(const KC868_A16_HistoryTriggerConfig *config) {
+  taskENTER_CRITICAL(&s_history_lock);
+  if (NULL != config) {
+    s_config = *config;
+  }
+  s_trigger = kKc868HistoryTriggerNone;
+  s_trigger_time_us = 0;
+  __atomic_store_n(&s_frozen, false, __ATOMIC_RELEASE);
+  taskEXIT_CRITICAL(&s_history_lock);
+}
+
+void KC868_A16_HistoryGetStatus(KC868_A16_HistoryStatus *status) {
+  memset(status, 0, sizeof(*status));
+  status->psram = s_psram;
+  status->capacity = s_block_count * KC868_A16_HISTORY_BLOCK_SIZE;
+  taskENTER_CRITICAL(&s_history_lock);
+  if (s_started) {
+    status->samples = s_samples_before_head +
+                      GetUint32(BlockAt(s_head) + 2) + s_pending_samples;
+    const uint8_t *const oldest = BlockAt(s_oldest);
+    status->oldest_us = (GetUint16(oldest) >= HISTORY_KEYFRAME_SIZE) ?
+                        GetUint64(oldest + HISTORY_BLOCK_HEADER_SIZE) :
+                        s_newest_us;
+    status->newest_us = s_newest_us;
+  }
+  status->blocks_overwritten = s_overwritten;
+  status->frozen = s_frozen;
+  status->trigger = s_trigger;
+  status->trigger_time_us = s_trigger_time_us;
+  status->config = s_config;
+  taskEXIT_CRITICAL(&s_history_lock);
+}
+
+const char *KC868_A16_HistoryGetTriggerName(
+  KC868_A16_HistoryTriggerSource trigger) {
+  return kHistoryTriggerNames[trigger];
+}
+
+void KC868_A16_HistoryCursorInit(KC868_A16_HistoryCursor *cursor,
+                                 KC868_A16_HistoryFormat format) {
+  memset(cursor, 0, sizeof(*cursor));
+  cursor->format = format;
+  cursor->stage = kHistoryStageHeader;
+  taskENTER_CRITICAL(&s_history_lock);
+  cursor->next_block = s_oldest;
+  taskEXIT_CRITICAL(&s_history_lock);
+}
+
+/* Copy the next block holding a sample behind the UDINT block number;
+ * false past the newest block */
+static bool CopyNextBlock(KC868_A16_HistoryCursor *cursor) {
+  while (true) {
+    size_t length = 0;
+    taskENTER_CRITICAL(&s_history_lock);
+    if (!s_started || cursor->next_block > s_head) {
+      taskEXIT_CRITICAL(&s_history_lock);
+      return false;
+    }
+    if (cursor->next_block < s_oldest) {
+      cursor->lost += s_oldest - cursor->next_block;
+      cursor->next_block = s_oldest;
+    }
+    const uint8_t *const block = BlockAt(cursor->next_block);
+    length = GetUint16(block);
+    memcpy(cursor->block + 4, block, length);
+    taskEXIT_CRITICAL(&s_history_lock);
+
+    PutUint32(cursor->block, cursor->next_block);
+    cursor->next_block++;
+    if (length >= HISTORY_KEYFRAME_SIZE) {
+      cursor->length = length;
+      cursor->offset = 0;
+      return true;
+    }
+  }
+}
+
+/* Format the CSV line of the next record into line; the cursor only
+ * advances if the line fits into space */
+static bool EncodeCsvRecord(KC868_A16_HistoryCursor *cursor, char *line,
+                            size_t space, size_t *line_length) {
+  const uint8_t *const block = cursor->block + 4;
+  const uint8_t *const end = block + cursor->length;
+  size_t offset = cursor->offset;
+  EipUint64 time_us = cursor->time_us;
+  uint8_t sample[KC868_A16_HISTORY_SAMPLE_SIZE];
+  uint32_t samples = 1;
+  memcpy(sample, cursor->sample, sizeof(sample));
+
+  if (0 == offset) {
+    time_us = GetUint64(block + HISTORY_BLOCK_HEADER_SIZE);
+    memcpy(sample, block + HISTORY_BLOCK_HEADER_SIZE + 8U, sizeof(sample));
+    offset = HISTORY_KEYFRAME_SIZE;
+  } else {
+    uint32_t mask = 0;
+    uint32_t value = 0;
+    size_t taken = GetVarint(block + offset, end, &mask);
+    if (0 != taken) {
+      offset += taken;
+      if (0 == mask) {
+        taken = GetVarint(block + offset, end, &samples);
+        offset += taken;
+      }
+    }
+    if (0 != taken) {
+      taken = GetVarint(block + offset, end, &value);
+      offset += taken;
+      time_us += value;
+    }
+    for (size_t i = 0; 0 != taken && i < KC868_A16_HISTORY_SAMPLE_SIZE;
+         ++i) {
+      if (0 != (mask & (1U << i))) {
+        if (block + offset >= end) {
+          taken = 0;
+        } else {
+          sample[i] = block[offset++];
+        }
+      }
+    }
+    if (0 == taken) {
+      /* Truncated record, nothing more in this block */
+      cursor->offset = cursor->length;
+      *line_length = 0;
+      return true;
+    }
+  }
+
+  int length = snprintf(line, HISTORY_CSV_LINE_SIZE,
+                        "%" PRIu64 ",%" PRIu32 ",0x%04X,0x%04X", time_us,
+                        samples, (unsigned)GetUint16(sample),
+                        (unsigned)GetUint16(sample +
+                                            KC868_A16_INPUT_IMAGE_SIZE));
+  for (size_t channel = 0; channel < KC868_A16_ANALOG_INPUT_COUNT; ++channel) {
+    length += snprintf(line + length, HISTORY_CSV_LINE_SIZE - length, ",%u",
+                       (unsigned)GetUint16(
+                         sample + KC868_A16_INPUT_ANALOG_START_OFFSET +
+                         channel * KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL));
+  }
+  length += snprintf(line + length, HISTORY_CSV_LINE_SIZE - length, "\n");
+  if ((size_t)length > space) {
+    return false;
+  }
+
+  cursor->offset = offset;
+  cursor->time_us = time_us;
+  memcpy(cursor->sample, sample, sizeof(sample));
+  *line_length = (size_t)length;
+  return true;
+}
+
+size_t KC868_A16_HistoryRead(KC868_A16_HistoryCursor *cursor, uint8_t *data,
+                             size_t size) {
+  size_t used = 0;
+  char line[HISTORY_CSV_LINE_SIZE];
+
+  while (kHistoryStageEnd != cursor->stage) {
+    size_t length = 0;
+    if (kHistoryStageHeader == cursor->stage) {
+      if (kKc868HistoryFormatCsv == cursor->format) {
+        length = (size_t)snprintf(line, sizeof(line),
+                                  "time_us,samples,inputs,relays");
+        for (size_t channel = 1; channel <= KC868_A16_ANALOG_INPUT_COUNT;
+             ++channel) {
+          length += (size_t)snprintf(line + length, sizeof(line) - length,
+                                     ",ai%u", (unsigned)channel);
+        }
+        length += (size_t)snprintf(line + length, sizeof(line) - length, "\n");
+      } else {
+        /* The trigger as of the start of the download */
+        uint8_t *const header = (uint8_t *)line;
+        memcpy(header, "KCH1", 4);
+        PutUint16(header + 4, KC868_A16_HISTORY_SAMPLE_SIZE);
+        taskENTER_CRITICAL(&s_history_lock);
+        header[6] = (uint8_t)s_trigger;
+        PutUint64(header + 8, s_trigger_time_us);
+        taskEXIT_CRITICAL(&s_history_lock);
+        header[7] = 0;
+        length = HISTORY_FILE_HEADER_SIZE;
+      }
+      if (used + length > size) {
+        return used;
+      }
+      memcpy(data + used, line, length);
+      used += length;
+      cursor->stage = kHistoryStageBlocks;
+      continue;
+    }
+
+    if (kHistoryStageFooter == cursor->stage) {
+      if (kKc868HistoryFormatCsv == cursor->format && 0 != cursor->lost) {
+        length = (size_t)snprintf(line, sizeof(line),
+                                  "# %" PRIu32 " blocks overwritten during "
+                                  "the download\n", cursor->lost);
+        if (used + length > size) {
+          return used;
+        }
+        memcpy(data + used, line, length);
+        used += length;
+      }
+      cursor->stage = kHistoryStageEnd;
+      continue;
+    }
+
+    /* In binary the offset counts the copied bytes with the block number,
+     * in CSV the decoded bytes of the block; a length of 0 is no block */
+    const size_t block_end =
+      (kKc868HistoryFormatBinary == cursor->format && 0 != cursor->length) ?
+      4U + cursor->length : cursor->length;
+    if (cursor->offset >= block_end) {
+      if (!CopyNextBlock(cursor)) {
+        cursor->stage = kHistoryStageFooter;
+      }
+      continue;
+    }
+    if (kKc868HistoryFormatBinary == cursor->format) {
+      length = block_end - cursor->offset;
+      if (length > size - used) {
+        length = size - used;
+      }
+      if (0 == length) {
+        return used;
+      }
+      memcpy(data + used, cursor->block + cursor->offset, length);
+      cursor->offset += length;
+      used += length;
+      continue;
+    }
+    /* A line that does not fit is decoded again by the next call */
+    if (!EncodeCsvRecord(cursor, line, size - used, &length)) {
+      return used;
+    }
+    memcpy(data + used, line, length);
+    used += length;
+  }
+  return used;
+}
+
+#endif /* CONFIG_KC868_HISTORY */
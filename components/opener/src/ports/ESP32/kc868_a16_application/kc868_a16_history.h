@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_HISTORY_H_
+#define KC868_A16_HISTORY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "kc868_a16_io.h"
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_history.h
+ *  @brief I/O history recorder: the input and relay images of every scan
+ *
+ *  Selected with CONFIG_KC868_HISTORY. The scan task records the input
+ *  image and the relay image after every scan with its esp_timer time,
+ *  which CONFIG_OPENER_SNTP_CLOCK turns into UTC since 1970 once set. The
+ *  buffer is CONFIG_KC868_HISTORY_PSRAM_SIZE_KB of PSRAM on a module that
+ *  has it, else CONFIG_KC868_HISTORY_SIZE_KB of internal RAM. It is split
+ *  into blocks of KC868_A16_HISTORY_BLOCK_SIZE bytes; when it is full the
+ *  oldest block is overwritten.
+ *
+ *  Every block starts with a full sample, the following samples only hold
+ *  the bytes that changed and the microseconds since the previous one.
+ *  Scans that change nothing are counted, not stored, so a quiet machine
+ *  costs a few bytes per change instead of per scan.
+ *
+ *  A trigger freezes the buffer after CONFIG_KC868_HISTORY_POST_TRIGGER
+ *  more scans: an edge of a selected input, a timed out I/O connection
+ *  or a request. Recording resumes when the recorder is armed again.
+ *
+ *  Readers have a cursor holding one block, which it encodes as CSV or
+ *  binary a piece at a time, so a download never needs more than that.
+ *  Binary layout, little endian:
+ *  - header: "KCH1", UINT sample size, USINT trigger, USINT reserved,
+ *    ULINT trigger time (0 without a trigger);
+ *  - per block: UDINT block number, then the block: UINT length of the
+ *    block including this field, UDINT samples, ULINT time, the first
+ *    sample, then records of a varint mask of the changed sample bytes
+ *    (bit 0 = byte 0) followed by
+ *    - for a mask other than 0: a varint of the microseconds since the
+ *      previous sample and the changed bytes;
+ *    - for mask 0: a varint count of unchanged samples and a varint of
+ *      the microseconds from the previous sample to the last of them.
+ *  Varints hold 7 bits per byte, lowest first, bit 7 set if more follow.
+ */
+
+#if CONFIG_KC868_HISTORY
+
+/** @brief Bytes of one recorded block */
+#define KC868_A16_HISTORY_BLOCK_SIZE 512U
+/** @brief A sample: the input image, then the relay image */
+#define KC868_A16_HISTORY_SAMPLE_SIZE \
+  (KC868_A16_INPUT_IMAGE_SIZE + KC868_A16_OUTPUT_IMAGE_SIZE)
+
+typedef enum {
+  kKc868HistoryFormatCsv = 0,
+  kKc868HistoryFormatBinary,
+} KC868_A16_HistoryFormat;
+
+/** @brief What froze the buffer */
+typedef enum {
+  kKc868HistoryTriggerNone = 0,
+  kKc868HistoryTriggerInput, /**< edge of an input of the trigger mask */
+  kKc868HistoryTriggerTimeout, /**< an I/O connection timed out */
+  kKc868HistoryTriggerRequest, /**< KC868_A16_HistoryTrigger() by hand */
+} KC868_A16_HistoryTriggerSource;
+
+/** @brief Trigger settings, kept until the next restart */
+typedef struct {
+  EipUint16 inputs; /**< inputs whose edges trigger, bit 0 = input 1 */
+  bool timeout; /**< a timed out I/O connection triggers */
+  EipUint32 post_trigger; /**< scans recorded after the trigger */
+} KC868_A16_HistoryTriggerConfig;
+
+typedef struct {
+  bool psram; /**< the buffer is in PSRAM */
+  EipUint32 capacity; /**< bytes, 0 if the buffer could not be allocated */
+  EipUint32 samples; /**< samples held */
+  EipUint64 oldest_us; /**< time of the oldest sample held */
+  EipUint64 newest_us;
+  EipUint32 blocks_overwritten;
+  bool frozen;
+  KC868_A16_HistoryTriggerSource trigger;
+  EipUint64 trigger_time_us;
+  KC868_A16_HistoryTriggerConfig config;
+} KC868_A16_HistoryStatus;
+
+/** @brief Read position of one reader, opaque to it */
+typedef struct {
+  KC868_A16_HistoryFormat format;
+  uint8_t stage;
+  uint32_t next_block; /**< number of the block copied next */
+  uint32_t lost; /**< blocks overwritten before this reader got them */
+  size_t length; /**< bytes of the copied block */
+  size_t offset; /**< bytes of it already returned or decoded */
+  EipUint64 time_us; /**< decoding: time and value of the last sample */
+  uint8_t sample[KC868_A16_HISTORY_SAMPLE_SIZE];
+  uint8_t block[4 + KC868_A16_HISTORY_BLOCK_SIZE];
+} KC868_A16_HistoryCursor;
+
+/** @brief Allocate the buffer, called before the scan task starts */
+void KC868_A16_HistoryInitialize(void);
+
+/** @brief Record the sample of one scan, called by the scan task only
+ *
+ *  @param inputs KC868_A16_INPUT_IMAGE_SIZE bytes of the input image
+ *  @param outputs KC868_A16_OUTPUT_IMAGE_SIZE bytes, bit set = relay on
+ *  @param time_us esp_timer_get_time() of the scan
+ */
+void KC868_A16_HistoryRecord(const EipUint8 *inputs, const EipUint8 *outputs,
+                             int64_t time_us);
+
+/** @brief Trigger the freeze, ignored while a trigger is pending
+ *
+ *  May be called from any task. A timeout is only taken if the trigger
+ *  settings ask for it.
+ */
+void KC868_A16_HistoryTrigger(KC868_A16_HistoryTriggerSource trigger);
+
+/** @brief Change the trigger settings and resume recording
+ *
+ *  @param config new settings, NULL to keep the current ones
+ */
+void KC868_A16_HistoryArm(const KC868_A16_HistoryTriggerConfig *config);
+
+/** @brief Read the fill level, trigger state and settings */
+void KC868_A16_HistoryGetStatus(KC868_A16_HistoryStatus *status);
+
+/** @brief Name of a trigger, as used in the web API */
+const char *KC868_A16_HistoryGetTriggerName(
+  KC868_A16_HistoryTriggerSource trigger);
+
+/** @brief Position a cursor at the oldest block held */
+void KC868_A16_HistoryCursorInit(KC868_A16_HistoryCursor *cursor,
+                                 KC868_A16_HistoryFormat format);
+
+/** @brief Encode the next part of the history
+ *
+ *  CSV is returned in whole lines, the first one naming the columns:
+ *  time_us, samples (1, or the number of unchanged scans up to time_us),
+ *  inputs and relays as hexadecimal words, and the raw analog inputs. A
+ *  last comment line counts the blocks overwritten during the download.
+ *  The download ends with the newest block as copied when the reader gets
+ *  to it; unchanged scans not written yet are not part of it.
+ *
+ *  @param cursor cursor of the reader
+ *  @param data receives the bytes, not NUL terminated
+ *  @param size size of data, at least 96
+ *  @return number of bytes written, 0 at the end
+ */
+size_t KC868_A16_HistoryRead(KC868_A16_HistoryCursor *cursor, uint8_t *data,
+                             size_t size);
+
+#endif /* CONFIG_KC868_HISTORY */
+
+#endif /* KC868_A16_HISTORY_H_ */
@@ -0,0 +1,1589 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "kc868_a16_io.h"
+#include "kc868_a16_io_backend.h"
+#include "kc868_a16_soe.h"
+#include "kc868_a16_history.h"
+#include "kc868_a16_pcnt.h"
+#include "kc868_a16_logic.h"
+#include "kc868_a16_scaling.h"
+#include "kc868_a16_debounce.h"
+#include "kc868_a16_alarm.h"
+#include "kc868_a16_relay_timer.h"
+#include "kc868_a16_relay_count.h"
+#include "kc868_a16_expansion.h"
+#include "kc868_a16_peer.h"
+#include "kc868_a16_scan_schedule.h"
+#include "loop_profile.h"
+#include "seqlock.h"
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+#include "esp_attr.h"
+#endif
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#if CONFIG_OPENER_PTP_TIME_SYNC
+#include "ptp_clock.h"
+#endif
+#if CONFIG_OPENER_TASK_TELEMETRY
+#include "task_telemetry.h"
+#endif
+#if CONFIG_OPENER_WARM_RESTART
+#include "warm_restart.h"
+#endif
+
+#define PCF8574_ADDR_INPUTS_1_8  0x22
+#define PCF8574_ADDR_INPUTS_9_16 0x21
+#define PCF8574_ADDR_OUTPUTS_1_8 0x24
+#define PCF8574_ADDR_OUTPUTS_9_16 0x25
+
+/* A failing expander is retried after one scan period, doubling with every
+ * further failure up to this interval. A stuck bus is recovered at most
+ * once per interval as well. */
+#define IO_BUS_BACKOFF_MAX_US   1000000
+
+#define IO_SCAN_TASK_CORE       1
+
+/* The expander probe runs once at start up, next to the Ethernet bring-up */
+#define IO_PROBE_TASK_STACK_SIZE 3072
+#define IO_PROBE_TASK_PRIORITY   5
+
+#define IO_EVENT_SCAN           (1u << 0)
+#define IO_EVENT_OUTPUTS        (1u << 1)
+#define IO_EVENT_INPUTS         (1u << 2)
+#define IO_EVENT_MODE           (1u << 3)
+#define IO_EVENT_RELAY_TIMERS   (1u << 4)
+#define IO_EVENT_PEER           (1u << 5)
+#define IO_EVENT_SCHEDULED_OUTPUTS (1u << 6)
+
+/* With interrupt-driven inputs the expanders are still polled at this
+ * interval so that a missed edge cannot leave a stale input forever. */
+#define IO_INTERRUPT_SAFETY_POLL_US  100000
+
+static const char *TAG_IO = "kc868_io";
+
+#if CONFIG_KC868_IO_BACKEND_SIMULATED
+static const KC868_A16_IoBackend *const s_backend = &g_kc868_a16_io_simulated;
+#else
+static const KC868_A16_IoBackend *const s_backend = &g_kc868_a16_io_pcf8574;
+#endif
+
+static const uint8_t kExpanderAddresses[kKc868ExpanderCount] = {
+  PCF8574_ADDR_OUTPUTS_1_8,
+  PCF8574_ADDR_OUTPUTS_9_16,
+  PCF8574_ADDR_INPUTS_1_8,
+  PCF8574_ADDR_INPUTS_9_16,
+};
+
+static bool s_expanders_initialized = false;
+
+/* Which expanders answered the probe of the backend, all of them without
+ * one. Given once the probe task is done. */
+static bool s_expander_present[kKc868ExpanderCount] = {
+  true, true, true, true
+};
+static SemaphoreHandle_t s_probe_done = NULL;
+
+/* Port values of the scan task's expander accesses in KC868_A16_Expander
+ * order: the two output writes, then the two input reads. As long as an
+ * expander fails the backend accesses each one separately, so the others
+ * are not held up by its retries. */
+static uint8_t s_bus_data[kKc868ExpanderCount];
+
+/* Scan task only: consecutive failed accesses of each expander and when
+ * it is retried, the next bus recovery allowed */
+typedef struct {
+  uint32_t failures;
+  int64_t retry_time_us;
+} ExpanderHealth;
+static ExpanderHealth s_expander_health[kKc868ExpanderCount];
+static int64_t s_recovery_time_us = 0;
+#if CONFIG_KC868_OUTPUT_VERIFY
+/* Scan task only: when the relay expanders are read back next */
+static int64_t s_verify_time_us = 0;
+#endif
+
+/* Expander status and counters. The scan task works on the s_scan_ copies
+ * and publishes the status atomically, the statistics like the input
+ * image. */
+static CipUsint s_io_status = 0;
+static CipUsint s_scan_io_status = 0;
+static CipUsint s_cos_reference_status = 0;
+static KC868_A16_IoBusStatistics s_scan_bus_statistics;
+static KC868_A16_IoBusStatistics s_bus_statistics;
+static SeqLock s_bus_statistics_lock;
+
+static TaskHandle_t s_io_scan_task = NULL;
+static esp_timer_handle_t s_io_scan_timer = NULL;
+
+/* Input image shared with the OpENer task, protected by a sequence lock
+ * written by the scan task, see seqlock.h */
+static EipUint8 s_input_image[KC868_A16_INPUT_IMAGE_SIZE];
+static SeqLock s_input_image_lock;
+
+/* Working copy of the input image, only touched by the scan task */
+static EipUint8 s_scan_image[KC868_A16_INPUT_IMAGE_SIZE];
+
+/* Image the last change-of-state report was based on, scan task only */
+static EipUint8 s_cos_reference_image[KC868_A16_INPUT_IMAGE_SIZE];
+static bool s_input_change_pending = false;
+
+/* Digital input bytes delivered by the PCF8574 interrupt task with the
+ * esp_timer time of their INT edge */
+static bool s_input_interrupts_enabled = false;
+/* Scan task only: scans between two reads of the input expanders while
+ * the inputs are interrupt driven */
+static uint32_t s_safety_poll_scans = 1;
+static uint32_t s_scans_until_poll = 0;
+static uint8_t s_interrupt_inputs[KC868_A16_DIGITAL_INPUT_BYTES];
+static int64_t s_interrupt_time_us[KC868_A16_DIGITAL_INPUT_BYTES];
+static portMUX_TYPE s_interrupt_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_OPENER_PTP_TIME_SYNC
+/* Edge record, written by the scan task only and published like the input
+ * image */
+static KC868_A16_InputEdges s_input_edges;
+static SeqLock s_input_edges_lock;
+static KC868_A16_InputEdges s_scan_edges;
+#endif
+
+#if CONFIG_KC868_INPUT_DEBOUNCE
+/* Last byte read from each input expander, the scan image holds the
+ * debounced inputs; scan task only */
+static uint8_t s_raw_inputs[KC868_A16_DIGITAL_INPUT_BYTES];
+#endif
+
+#if CONFIG_KC868_ANALOG_SCALING
+/* Engineering values of the last sample, written by the scan task only and
+ * published like the input image */
+static KC868_A16_ScaledAnalogs s_scaled_analogs;
+static SeqLock s_scaled_analogs_lock;
+#endif
+
+/* Single-slot output mailbox filled by the OpENer task and drained by the
+ * scan task. Posting overwrites the slot, so only the newest image is written
+ * when several packets arrive between bus slots. Same sequence lock scheme as
+ * the input image. */
+typedef struct {
+  EipUint8 image[KC868_A16_OUTPUT_IMAGE_SIZE];
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+  int64_t apply_at_us; /**< esp_timer time to write it at, 0 for at once */
+#endif
+} OutputMailbox;
+static OutputMailbox s_output_mailbox;
+static SeqLock s_output_mailbox_lock;
+static bool s_output_mailbox_pending = false;
+
+/* Last byte successfully written to each output expander. */
+static uint8_t s_output_written[KC868_A16_OUTPUT_IMAGE_SIZE];
+static bool s_output_written_valid[KC868_A16_OUTPUT_IMAGE_SIZE];
+/* A port value differing from the one written waits in s_bus_data for
+ * the next bus transfer */
+static bool s_outputs_staged = false;
+#if CONFIG_KC868_RELAY_COUNTERS
+/* Last byte written to each output expander without error; unlike
+ * s_output_written it survives failed writes, so a relay that switched
+ * while its expander failed is counted with the next good write */
+static uint8_t s_counted_written[KC868_A16_OUTPUT_IMAGE_SIZE];
+static bool s_counted_written_valid[KC868_A16_OUTPUT_IMAGE_SIZE];
+#endif
+
+/* Scan task only: the last posted image, or the safe state replacing it */
+static EipUint8 s_requested_outputs[KC868_A16_OUTPUT_IMAGE_SIZE];
+
+/* Output mode and safe states set by the application. The scan task keeps
+ * the mode it applied last, the relays still to be released by a
+ * hold-then-clear action and when. */
+static KC868_A16_OutputMode s_requested_mode = kKc868OutputModeIdle;
+static KC868_A16_OutputSafeStates s_safe_states;
+static SeqLock s_safe_states_lock;
+static KC868_A16_OutputMode s_output_mode = kKc868OutputModeIdle;
+static uint16_t s_release_mask = 0;
+static int64_t s_release_time_us = 0;
+
+/* Image the scan task switched to by itself, for the application to mirror
+ * into the output assembly; same sequence lock scheme as the input image */
+static EipUint8 s_safe_image[KC868_A16_OUTPUT_IMAGE_SIZE];
+static SeqLock s_safe_image_lock;
+static bool s_safe_image_pending = false;
+
+#if CONFIG_KC868_RELAY_TIMERS
+/* Wakes the scan task at the next deadline of the relay commands */
+static esp_timer_handle_t s_relay_timer = NULL;
+static int64_t s_relay_timer_deadline_us = INT64_MAX;
+#endif
+
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+/* Scan task only: the image waiting for its time, and the one-shot timer
+ * waking the scan task then. The counters are published for the other
+ * tasks with every change. */
+static EipUint8 s_scheduled_outputs[KC868_A16_OUTPUT_IMAGE_SIZE];
+static int64_t s_scheduled_at_us = 0;
+static bool s_scheduled_pending = false;
+static esp_timer_handle_t s_scheduled_output_timer = NULL;
+static KC868_A16_ScheduledOutputStatistics s_scan_scheduled_statistics;
+static KC868_A16_ScheduledOutputStatistics s_scheduled_statistics;
+static SeqLock s_scheduled_statistics_lock;
+#endif
+
+#if CONFIG_KC868_LOGIC
+/* Scan task only: the relays the interlock rules force on top of the
+ * requested image */
+static uint16_t s_force_mask = 0;
+static uint16_t s_force_value = 0;
+#endif
+
+#if CONFIG_KC868_PEER
+/* Scan task only: the relays that follow the peer, below the rules */
+static uint16_t s_peer_mask = 0;
+static uint16_t s_peer_value = 0;
+#endif
+
+#if CONFIG_OPENER_WARM_RESTART
+/* Application area of the warm restart block: the relays last written,
+ * saved by the scan task, and the fault safe state in effect, saved by
+ * KC868_A16_IoSetOutputSafeStates() */
+typedef struct {
+  EipUint8 outputs[KC868_A16_OUTPUT_IMAGE_SIZE];
+  KC868_A16_OutputSafeState fault;
+} IoWarmState;
+_Static_assert(sizeof(IoWarmState) <= WARM_RESTART_APPLICATION_SIZE,
+               "the I/O state has to fit the warm restart block");
+
+static void SaveWarmOutputs(void);
+static bool RestoreWarmOutputs(uint16_t *outputs);
+#endif
+
+static bool UpdateExpanderHealth(size_t expander, esp_err_t result,
+                                 int64_t now_us);
+
+static void ProbeExpanders(void) {
+  const esp_err_t ret = s_backend->probe(kExpanderAddresses, s_expander_present);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG_IO, "Failed to probe the %s expanders: %s", s_backend->name,
+             esp_err_to_name(ret));
+    for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+      s_expander_present[i] = true;
+    }
+  }
+}
+
+static void ProbeTask(void *arg) {
+  (void)arg;
+  ProbeExpanders();
+  xSemaphoreGive(s_probe_done);
+  vTaskDelete(NULL);
+}
+
+void KC868_A16_IoStartProbe(void) {
+  if (NULL == s_backend->probe || NULL != s_probe_done) {
+    return;
+  }
+  s_probe_done = xSemaphoreCreateBinary();
+  if (NULL == s_probe_done) {
+    return;
+  }
+  if (pdPASS != xTaskCreatePinnedToCore(ProbeTask, "kc868_probe",
+                                        IO_PROBE_TASK_STACK_SIZE, NULL,
+                                        IO_PROBE_TASK_PRIORITY, NULL,
+                                        IO_SCAN_TASK_CORE)) {
+    /* InitializeExpanders() probes then */
+    vSemaphoreDelete(s_probe_done);
+    s_probe_done = NULL;
+  }
+}
+
+static void InitializeExpanders(void) {
+  if (s_expanders_initialized) {
+    return;
+  }
+
+  if (NULL != s_probe_done) {
+    /* Done long before with that much of the boot in between, unless the
+     * bus hangs */
+    (void)xSemaphoreTake(s_probe_done, portMAX_DELAY);
+    vSemaphoreDelete(s_probe_done);
+    s_probe_done = NULL;
+  } else if (NULL != s_backend->probe) {
+    ProbeExpanders();
+  }
+  esp_err_t ret = s_backend->initialize(kExpanderAddresses);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG_IO, "Failed to initialize the %s I/O backend: %s",
+             s_backend->name, esp_err_to_name(ret));
+    return;
+  }
+  s_expanders_initialized = true;
+
+  /* A missing expander starts out failed, so the scan task accesses it on
+   * its own with backoff from the first scan on */
+  const int64_t now_us = esp_timer_get_time();
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    if (!s_expander_present[i]) {
+      (void)UpdateExpanderHealth(i, ESP_ERR_NOT_FOUND, now_us);
+    }
+  }
+
+  // All relays off (0xFF, active low), or after a warm restart the fault
+  // safe state applied to the relays before the reset
+  uint16_t outputs = 0;
+#if CONFIG_OPENER_WARM_RESTART
+  (void)RestoreWarmOutputs(&outputs);
+#endif
+  const bool access[kKc868ExpanderCount] = {
+    s_expander_present[kKc868ExpanderOutputs1To8],
+    s_expander_present[kKc868ExpanderOutputs9To16], false, false
+  };
+  esp_err_t results[kKc868ExpanderCount];
+  s_bus_data[kKc868ExpanderOutputs1To8] = (uint8_t)~outputs;
+  s_bus_data[kKc868ExpanderOutputs9To16] = (uint8_t)~(outputs >> 8);
+  s_backend->transfer(access, true, s_bus_data, results);
+  for (size_t i = 0; i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+    const size_t expander = kKc868ExpanderOutputs1To8 + i;
+    if (!access[expander]) {
+      continue;
+    }
+    if (results[expander] != ESP_OK) {
+      ESP_LOGE(TAG_IO, "Failed to initialize outputs at 0x%02X: %s",
+               kExpanderAddresses[expander], esp_err_to_name(results[expander]));
+    } else {
+      s_output_written[i] = s_bus_data[expander];
+      s_output_written_valid[i] = true;
+#if CONFIG_KC868_RELAY_COUNTERS
+      s_counted_written[i] = s_bus_data[expander];
+      s_counted_written_valid[i] = true;
+#endif
+    }
+  }
+#if CONFIG_OPENER_WARM_RESTART
+  SaveWarmOutputs();
+#endif
+#if CONFIG_KC868_EXPANSION
+  (void)KC868_A16_ExpansionInitialize(kExpanderAddresses, kKc868ExpanderCount);
+#endif
+}
+
+static void StoreAnalogValue(EipUint8 *image, size_t channel_index,
+                             uint16_t value) {
+  size_t offset = KC868_A16_INPUT_ANALOG_START_OFFSET +
+                  (channel_index * KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL);
+  image[offset] = (uint8_t)(value & 0xFF);
+  image[offset + 1] = (uint8_t)(value >> 8);
+}
+
+/* Count the access of an expander and back it off while it fails; true
+ * if the access succeeded */
+static bool UpdateExpanderHealth(size_t expander, esp_err_t result,
+                                 int64_t now_us) {
+  ExpanderHealth *const health = &s_expander_health[expander];
+  KC868_A16_ExpanderStatistics *const statistics =
+    &s_scan_bus_statistics.expander[expander];
+  const CipUsint bit = (CipUsint)(1u << expander);
+  if (health->failures > 0) {
+    statistics->retries++;
+  }
+
+  if (ESP_OK == result) {
+    if (health->failures > 0) {
+      ESP_LOGI(TAG_IO, "PCF8574 0x%02X answers again after %lu failed accesses",
+               kExpanderAddresses[expander], (unsigned long)health->failures);
+      health->failures = 0;
+      s_scan_io_status &= (CipUsint)~bit;
+    }
+    return true;
+  }
+
+  statistics->errors++;
+  if (0 == health->failures) {
+    /* Logged once, not on every retry */
+    ESP_LOGW(TAG_IO, "PCF8574 0x%02X failed: %s, retrying with backoff",
+             kExpanderAddresses[expander], esp_err_to_name(result));
+    s_scan_io_status |= bit;
+  }
+  if (health->failures < UINT32_MAX) {
+    health->failures++;
+  }
+  int64_t backoff_us = CONFIG_KC868_IO_SCAN_PERIOD_US;
+  for (uint32_t i = 1; i < health->failures && backoff_us < IO_BUS_BACKOFF_MAX_US;
+       i++) {
+    backoff_us *= 2;
+  }
+  if (backoff_us > IO_BUS_BACKOFF_MAX_US) {
+    backoff_us = IO_BUS_BACKOFF_MAX_US;
+  }
+  health->retry_time_us = now_us + backoff_us;
+  return false;
+}
+
+/* A timeout means SCL or SDA is held low, several devices failing at once
+ * points at the bus as well: clock it free, then retry every failing
+ * expander right away */
+static void RecoverBus(int64_t now_us) {
+  if (now_us - s_recovery_time_us < 0) {
+    return;
+  }
+  s_recovery_time_us = now_us + IO_BUS_BACKOFF_MAX_US;
+  if (ESP_OK == s_backend->recover_bus()) {
+    ESP_LOGW(TAG_IO, "I2C bus recovered");
+  }
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    s_expander_health[i].retry_time_us = now_us;
+  }
+}
+
+#if CONFIG_KC868_OUTPUT_VERIFY
+/* Read the port latches of the relay expanders back every
+ * CONFIG_KC868_OUTPUT_VERIFY_PERIOD_MS, in a scan that wrote none of them.
+ * An expander that reset, e.g. on a brownout, has released all its relays;
+ * a latch that differs from the byte written is staged again and rewritten
+ * by the next transfer. A failed read faults the expander like a failed
+ * write, so it is rewritten with backoff as well. */
+static void VerifyOutputs(int64_t now_us) {
+  if (NULL == s_backend->read_outputs || now_us - s_verify_time_us < 0) {
+    return;
+  }
+  s_verify_time_us = now_us + (int64_t)CONFIG_KC868_OUTPUT_VERIFY_PERIOD_MS * 1000;
+  bool read[KC868_A16_OUTPUT_IMAGE_SIZE];
+  bool any = false;
+  for (size_t i = 0; i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+    read[i] = s_output_written_valid[i] &&
+              0 == s_expander_health[kKc868ExpanderOutputs1To8 + i].failures;
+    any = any || read[i];
+  }
+  if (!any) {
+    return;
+  }
+
+  uint8_t ports[KC868_A16_OUTPUT_IMAGE_SIZE];
+  esp_err_t results[KC868_A16_OUTPUT_IMAGE_SIZE];
+  s_backend->read_outputs(read, ports, results);
+  for (size_t i = 0; i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+    if (!read[i]) {
+      continue;
+    }
+    const size_t expander = kKc868ExpanderOutputs1To8 + i;
+    const CipUsint bit = (CipUsint)(KC868_A16_IO_OUTPUTS_1_8_MISMATCH << i);
+    if (!UpdateExpanderHealth(expander, results[i], now_us)) {
+      s_output_written_valid[i] = false;
+      s_outputs_staged = true;
+      continue;
+    }
+    if (ports[i] == s_output_written[i]) {
+      s_scan_io_status &= (CipUsint)~bit;
+      continue;
+    }
+    if (0 == (s_scan_io_status & bit)) {
+      ESP_LOGW(TAG_IO, "PCF8574 0x%02X reads 0x%02X instead of 0x%02X, rewriting",
+               kExpanderAddresses[expander], ports[i], s_output_written[i]);
+    }
+    s_scan_io_status |= bit;
+    s_scan_bus_statistics.expander[expander].mismatches++;
+#if CONFIG_KC868_RELAY_COUNTERS
+    /* The rewrite closes the relays the expander released once more */
+    s_counted_written[i] = ports[i];
+#endif
+    s_output_written_valid[i] = false;
+    s_outputs_staged = true;
+  }
+}
+#endif
+
+/* Write the staged output bytes and, with digital set, read the inputs
+ * into it, all in one bus transaction. Outputs go first, so the inputs
+ * are sampled with the relays of this scan. The inputs of an expander that
+ * fails or backs off keep the last value read. */
+static void TransferExpanders(EipUint8 *digital) {
+  if (!s_expanders_initialized) {
+    if (NULL != digital) {
+      digital[0] = 0;
+      digital[1] = 0;
+    }
+    return;
+  }
+
+  const int64_t now_us = esp_timer_get_time();
+  bool access[kKc868ExpanderCount];
+  bool failing = false;
+  size_t accesses = 0;
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    access[i] = (i < kKc868ExpanderInputs1To8) ? s_outputs_staged :
+                (NULL != digital);
+    if (access[i] && s_expander_health[i].failures > 0) {
+      failing = true;
+      access[i] = (now_us - s_expander_health[i].retry_time_us >= 0);
+    }
+    if (access[i]) {
+      accesses++;
+    }
+  }
+
+  /* The port values of the outputs stay staged in s_bus_data, the inputs
+   * are read into a copy */
+  uint8_t ports[kKc868ExpanderCount];
+  esp_err_t results[kKc868ExpanderCount];
+  memcpy(ports, s_bus_data, sizeof(ports));
+  if (0 != accesses) {
+    s_backend->transfer(access, failing, ports, results);
+  }
+
+  bool bus_fault = false;
+  size_t failures = 0;
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    if (!access[i]) {
+      continue;
+    }
+    const esp_err_t result = results[i];
+    if (!UpdateExpanderHealth(i, result, now_us)) {
+      failures++;
+      bus_fault = bus_fault || (ESP_ERR_TIMEOUT == result);
+    }
+  }
+
+  s_outputs_staged = false;
+#if CONFIG_KC868_RELAY_COUNTERS
+  uint16_t closed = 0;
+#endif
+  for (size_t i = 0; i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+    const size_t expander = kKc868ExpanderOutputs1To8 + i;
+#if CONFIG_KC868_RELAY_COUNTERS
+    /* Active low: a port bit going from 1 to 0 closed a relay */
+    if (access[expander] && ESP_OK == results[expander]) {
+      if (s_counted_written_valid[i]) {
+        closed |= (uint16_t)((uint8_t)(s_counted_written[i] &
+                                       ~s_bus_data[expander]) << (8 * i));
+      }
+      s_counted_written[i] = s_bus_data[expander];
+      s_counted_written_valid[i] = true;
+    }
+#endif
+    if (access[expander]) {
+      /* A failed write is retried after the backoff */
+      s_output_written_valid[i] = (ESP_OK == results[expander]);
+      s_output_written[i] = s_bus_data[expander];
+    }
+    if (!s_output_written_valid[i] || s_output_written[i] != s_bus_data[expander]) {
+      s_outputs_staged = true;
+    }
+  }
+#if CONFIG_KC868_RELAY_COUNTERS
+  KC868_A16_RelayCountAdd(closed);
+#endif
+#if CONFIG_OPENER_WARM_RESTART
+  if (access[kKc868ExpanderOutputs1To8] || access[kKc868ExpanderOutputs9To16]) {
+    SaveWarmOutputs();
+  }
+#endif
+#if CONFIG_KC868_OUTPUT_VERIFY
+  if (!access[kKc868ExpanderOutputs1To8] && !access[kKc868ExpanderOutputs9To16]) {
+    VerifyOutputs(now_us);
+  }
+#endif
+
+  if (NULL != digital) {
+    for (size_t i = 0; i < KC868_A16_DIGITAL_INPUT_BYTES; i++) {
+      const size_t expander = kKc868ExpanderInputs1To8 + i;
+#if CONFIG_KC868_INPUT_DEBOUNCE
+      const uint8_t last = s_raw_inputs[i];
+#else
+      const uint8_t last = s_scan_image[i];
+#endif
+      digital[i] = (access[expander] && ESP_OK == results[expander]) ?
+                   (uint8_t)~ports[expander] : last;
+    }
+  }
+
+  if (bus_fault || (failures > 1 && failures == accesses)) {
+    RecoverBus(now_us);
+  }
+  if (failing || 0 != failures) {
+    s_scan_bus_statistics.bus_recoveries = s_backend->bus_recoveries();
+    SeqLockWrite(&s_bus_statistics_lock, &s_bus_statistics,
+                 &s_scan_bus_statistics, sizeof(s_bus_statistics));
+  }
+  __atomic_store_n(&s_io_status, s_scan_io_status, __ATOMIC_RELAXED);
+}
+
+static void SampleAnalogInputs(EipUint8 *image) {
+  uint16_t values[KC868_A16_ANALOG_INPUT_COUNT];
+  s_backend->adc_read(values);
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    StoreAnalogValue(image, channel_index, values[channel_index]);
+  }
+}
+
+/* Stage a byte for the next TransferExpanders(). Both expanders are
+ * written once one has changed, the other simply gets its value again. */
+static void StageOutputExpander(size_t index, uint8_t image_byte) {
+  /* Relays are active low */
+  uint8_t port_value = (uint8_t)~image_byte;
+  s_bus_data[kKc868ExpanderOutputs1To8 + index] = port_value;
+  if (s_output_written_valid[index] && s_output_written[index] == port_value) {
+    return;
+  }
+  s_outputs_staged = true;
+}
+
+static bool TakeOutputMailbox(OutputMailbox *mailbox) {
+  if (!__atomic_exchange_n(&s_output_mailbox_pending, false, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+
+  /* The posting task never runs below the scan task on the same core, so a
+   * write in progress always completes */
+  while (!SeqLockRead(&s_output_mailbox_lock, mailbox, &s_output_mailbox,
+                      sizeof(s_output_mailbox), NULL)) {
+  }
+  return true;
+}
+
+static void WriteOutputs(const EipUint8 *image) {
+  if (!s_expanders_initialized) {
+    return;
+  }
+  uint16_t outputs = (uint16_t)(image[0] | (image[1] << 8));
+#if CONFIG_KC868_RELAY_TIMERS
+  outputs = KC868_A16_RelayTimerApply(outputs);
+#endif
+#if CONFIG_KC868_PEER
+  outputs = (uint16_t)((outputs & ~s_peer_mask) |
+                       (s_peer_value & s_peer_mask));
+#endif
+#if CONFIG_KC868_LOGIC
+  outputs = (uint16_t)((outputs & ~s_force_mask) |
+                       (s_force_value & s_force_mask));
+#endif
+  StageOutputExpander(0, (uint8_t)outputs);
+  StageOutputExpander(1, (uint8_t)(outputs >> 8));
+}
+
+static void TakeRequestedOutputs(const EipUint8 *image) {
+  /* Outside the run mode only the web UI posts, it takes over from the
+   * safe state */
+  s_release_mask = 0;
+#if CONFIG_KC868_RELAY_TIMERS
+  /* Relays the image changes are its own again */
+  KC868_A16_RelayTimerRelease((uint16_t)((image[0] ^ s_requested_outputs[0]) |
+                                         ((image[1] ^ s_requested_outputs[1]) << 8)));
+#endif
+  memcpy(s_requested_outputs, image, sizeof(s_requested_outputs));
+  WriteOutputs(image);
+}
+
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+static void PublishScheduledStatistics(void) {
+  SeqLockWrite(&s_scheduled_statistics_lock, &s_scheduled_statistics,
+               &s_scan_scheduled_statistics, sizeof(s_scheduled_statistics));
+}
+
+/* Keep an image whose time is ahead until the timer fires; false if it is
+ * to be written at once. Any newer image replaces the one waiting. */
+static bool ScheduleOutputImage(const OutputMailbox *mailbox) {
+  KC868_A16_ScheduledOutputStatistics *const statistics =
+    &s_scan_scheduled_statistics;
+  if (s_scheduled_pending) {
+    s_scheduled_pending = false;
+    statistics->replaced++;
+  }
+  const int64_t ahead_us = mailbox->apply_at_us - esp_timer_get_time();
+  bool keep = false;
+  if (0 == mailbox->apply_at_us) {
+    /* At once, from the web UI or a PLC not using the time */
+  } else if (ahead_us <= 0) {
+    statistics->late++;
+  } else if (ahead_us > (int64_t)CONFIG_KC868_SCHEDULED_OUTPUTS_MAX_AHEAD_MS * 1000) {
+    statistics->out_of_range++;
+  } else {
+    memcpy(s_scheduled_outputs, mailbox->image, sizeof(s_scheduled_outputs));
+    s_scheduled_at_us = mailbox->apply_at_us;
+    s_scheduled_pending = true;
+    statistics->scheduled++;
+    /* Without the timer the next scan tick writes it */
+    if (NULL != s_scheduled_output_timer) {
+      (void)esp_timer_stop(s_scheduled_output_timer);
+      (void)esp_timer_start_once(s_scheduled_output_timer, (uint64_t)ahead_us);
+    }
+    keep = true;
+  }
+  PublishScheduledStatistics();
+  return keep;
+}
+
+/* Write the waiting image once its time has come, straight to the bus
+ * instead of with the rest of the pass */
+static void RunScheduledOutputs(void) {
+  if (!s_scheduled_pending || esp_timer_get_time() - s_scheduled_at_us < 0) {
+    return;
+  }
+  s_scheduled_pending = false;
+  TakeRequestedOutputs(s_scheduled_outputs);
+  TransferExpanders(NULL);
+  const int64_t lateness_us = esp_timer_get_time() - s_scheduled_at_us;
+  KC868_A16_ScheduledOutputStatistics *const statistics =
+    &s_scan_scheduled_statistics;
+  statistics->applied++;
+  statistics->last_lateness_us = (CipUdint)lateness_us;
+  if (statistics->last_lateness_us > statistics->max_lateness_us) {
+    statistics->max_lateness_us = statistics->last_lateness_us;
+  }
+  PublishScheduledStatistics();
+}
+
+/* A new output mode takes over from the image waiting */
+static void CancelScheduledOutputs(void) {
+  if (!s_scheduled_pending) {
+    return;
+  }
+  s_scheduled_pending = false;
+  if (NULL != s_scheduled_output_timer) {
+    (void)esp_timer_stop(s_scheduled_output_timer);
+  }
+  s_scan_scheduled_statistics.cancelled++;
+  PublishScheduledStatistics();
+}
+#endif
+
+static void DrainOutputMailbox(void) {
+  OutputMailbox mailbox;
+  if (!TakeOutputMailbox(&mailbox)) {
+    return;
+  }
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+  if (ScheduleOutputImage(&mailbox)) {
+    return;
+  }
+#endif
+  TakeRequestedOutputs(mailbox.image);
+}
+
+static void WriteSafeImage(uint16_t outputs) {
+  s_requested_outputs[0] = (EipUint8)outputs;
+  s_requested_outputs[1] = (EipUint8)(outputs >> 8);
+  WriteOutputs(s_requested_outputs);
+  SeqLockWrite(&s_safe_image_lock, s_safe_image, s_requested_outputs,
+               sizeof(s_safe_image));
+  __atomic_store_n(&s_safe_image_pending, true, __ATOMIC_RELEASE);
+}
+
+/* The relays of a safe state taking over from outputs; relays to hold and
+ * then clear start their hold time */
+static uint16_t ApplySafeState(const KC868_A16_OutputSafeState *safe_state,
+                               uint16_t outputs) {
+  uint16_t release_mask = 0;
+  for (size_t output = 0; output < KC868_A16_OUTPUT_COUNT; ++output) {
+    const uint16_t bit = (uint16_t)(1u << output);
+    switch (safe_state->action[output]) {
+      case kKc868OutputActionClear:
+        outputs &= (uint16_t)~bit;
+        break;
+      case kKc868OutputActionPreset:
+        outputs = (uint16_t)((outputs & ~bit) | (safe_state->preset & bit));
+        break;
+      case kKc868OutputActionHoldThenClear:
+        release_mask |= bit;
+        break;
+      default:
+        break;
+    }
+  }
+  if (0 != (release_mask & outputs)) {
+    s_release_mask = release_mask & outputs;
+    s_release_time_us = esp_timer_get_time() +
+                        (int64_t)safe_state->hold_ms * 1000;
+  }
+  return outputs;
+}
+
+/* Apply the safe state of a new mode to the last requested image, right
+ * after the mailbox so a last image of the PLC does not override it */
+static void ApplyOutputMode(void) {
+  const KC868_A16_OutputMode mode =
+    __atomic_load_n(&s_requested_mode, __ATOMIC_ACQUIRE);
+  if (mode == s_output_mode) {
+    return;
+  }
+  s_output_mode = mode;
+  s_release_mask = 0;
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+  CancelScheduledOutputs();
+#endif
+  if (kKc868OutputModeRun == mode) {
+    /* The next image of the PLC sets the relays */
+    return;
+  }
+#if CONFIG_KC868_RELAY_TIMERS
+  KC868_A16_RelayTimerCancel();
+#endif
+
+  KC868_A16_OutputSafeStates safe_states;
+  while (!SeqLockRead(&s_safe_states_lock, &safe_states, &s_safe_states,
+                      sizeof(safe_states), NULL)) {
+  }
+  const KC868_A16_OutputSafeState *const safe_state =
+    (kKc868OutputModeFault == mode) ? &safe_states.fault : &safe_states.idle;
+  const uint16_t outputs =
+    ApplySafeState(safe_state, (uint16_t)(s_requested_outputs[0] |
+                                          (s_requested_outputs[1] << 8)));
+  WriteSafeImage(outputs);
+  ESP_LOGI(TAG_IO, "Outputs %s, relays 0x%04X",
+           (kKc868OutputModeFault == mode) ? "faulted" : "idle",
+           (unsigned int)outputs);
+}
+
+#if CONFIG_OPENER_WARM_RESTART
+/* Keep the relays of each expander written successfully for a warm
+ * restart; scan task only */
+static void SaveWarmOutputs(void) {
+  static EipUint8 saved[KC868_A16_OUTPUT_IMAGE_SIZE];
+  static bool saved_valid[KC868_A16_OUTPUT_IMAGE_SIZE];
+  for (size_t i = 0; i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+    /* Relays are active low */
+    const EipUint8 relays = (EipUint8)~s_output_written[i];
+    if (!s_output_written_valid[i] ||
+        (saved_valid[i] && saved[i] == relays)) {
+      continue;
+    }
+    saved[i] = relays;
+    saved_valid[i] = true;
+    WarmRestartSetApplication(offsetof(IoWarmState, outputs) + i, &relays,
+                              sizeof(relays));
+  }
+}
+
+/* After a warm restart the relays of before the reset take the fault safe
+ * state then in effect, as if the connection had timed out, until the PLC
+ * or the web UI takes over again */
+static bool RestoreWarmOutputs(uint16_t *outputs) {
+  IoWarmState state;
+  if (!WarmRestartGetApplication(&state, sizeof(state))) {
+    return false;
+  }
+  WarmRestartSetApplication(offsetof(IoWarmState, fault), &state.fault,
+                            sizeof(state.fault));
+  const uint16_t last = (uint16_t)(state.outputs[0] | (state.outputs[1] << 8));
+  *outputs = ApplySafeState(&state.fault, last);
+  s_requested_outputs[0] = (EipUint8)*outputs;
+  s_requested_outputs[1] = (EipUint8)(*outputs >> 8);
+  s_requested_mode = kKc868OutputModeFault;
+  s_output_mode = kKc868OutputModeFault;
+  SeqLockWrite(&s_safe_image_lock, s_safe_image, s_requested_outputs,
+               sizeof(s_safe_image));
+  __atomic_store_n(&s_safe_image_pending, true, __ATOMIC_RELEASE);
+  ESP_LOGW(TAG_IO, "Warm restart, relays 0x%04X before the reset, 0x%04X now",
+           (unsigned int)last, (unsigned int)*outputs);
+  return true;
+}
+#endif
+
+#if CONFIG_KC868_RELAY_TIMERS
+/* Execute the relay commands that are due and wake up again for the next
+ * one; a command in the idle or fault mode is cancelled by the mode right
+ * after */
+static void RunRelayTimers(void) {
+  const int64_t now_us = esp_timer_get_time();
+  bool changed = false;
+  const int64_t deadline_us = KC868_A16_RelayTimerRun(now_us, &changed);
+  if (changed) {
+    WriteOutputs(s_requested_outputs);
+  }
+  if (deadline_us == s_relay_timer_deadline_us || NULL == s_relay_timer) {
+    return;
+  }
+  s_relay_timer_deadline_us = deadline_us;
+  (void)esp_timer_stop(s_relay_timer);
+  if (INT64_MAX != deadline_us) {
+    (void)esp_timer_start_once(s_relay_timer, (uint64_t)(deadline_us - now_us));
+  }
+}
+#endif
+
+/* Release the relays of the hold-then-clear actions once their time is up,
+ * checked on every scan */
+static void ReleaseHeldOutputs(void) {
+  if (0 == s_release_mask ||
+      esp_timer_get_time() - s_release_time_us < 0) {
+    return;
+  }
+  const uint16_t outputs = (uint16_t)((s_requested_outputs[0] |
+                                       (s_requested_outputs[1] << 8)) &
+                                      ~s_release_mask);
+  s_release_mask = 0;
+  WriteSafeImage(outputs);
+}
+
+static void PublishInputImage(const EipUint8 *image) {
+  SeqLockWrite(&s_input_image_lock, s_input_image, image, sizeof(s_input_image));
+}
+
+static uint16_t GetAnalogValue(const EipUint8 *image, size_t channel_index) {
+  size_t offset = KC868_A16_INPUT_ANALOG_START_OFFSET +
+                  (channel_index * KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL);
+  return (uint16_t)(image[offset] | (image[offset + 1] << 8));
+}
+
+/* Compare with the image of the last change report: any digital edge, or an
+ * analog channel moving by more than the deadband, counts as a change. */
+static bool InputImageChanged(const EipUint8 *image) {
+  if (0 != memcmp(image, s_cos_reference_image, KC868_A16_DIGITAL_INPUT_BYTES)) {
+    return true;
+  }
+#if CONFIG_KC868_IO_COS_ANALOG_DEADBAND > 0
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    int delta = (int)GetAnalogValue(image, channel_index) -
+                (int)GetAnalogValue(s_cos_reference_image, channel_index);
+    if (delta > CONFIG_KC868_IO_COS_ANALOG_DEADBAND ||
+        delta < -CONFIG_KC868_IO_COS_ANALOG_DEADBAND) {
+      return true;
+    }
+  }
+#endif
+  return false;
+}
+
+/* Convert the analog inputs of the scan image to engineering units; true if
+ * the range status of a channel changed */
+static bool PublishScaledAnalogs(void) {
+#if CONFIG_KC868_ANALOG_SCALING
+  KC868_A16_ScaledAnalogs scaled;
+  const bool changed = KC868_A16_ScalingProcess(s_scan_image, &scaled);
+  SeqLockWrite(&s_scaled_analogs_lock, &s_scaled_analogs, &scaled,
+               sizeof(s_scaled_analogs));
+  return changed;
+#else
+  return false;
+#endif
+}
+
+static void PublishScanImage(void) {
+  PublishInputImage(s_scan_image);
+  bool changed = InputImageChanged(s_scan_image);
+  if (changed) {
+    memcpy(s_cos_reference_image, s_scan_image, sizeof(s_cos_reference_image));
+  }
+  if (PublishScaledAnalogs()) {
+    changed = true;
+  }
+#if CONFIG_KC868_ANALOG_ALARMS
+  if (KC868_A16_AlarmProcess(s_scan_image, esp_timer_get_time())) {
+    changed = true;
+  }
+#endif
+  if (s_scan_io_status != s_cos_reference_status) {
+    s_cos_reference_status = s_scan_io_status;
+    changed = true;
+  }
+#if CONFIG_KC868_LOGIC
+  /* The rules act on the sample just taken, before the next bus slot */
+  if (KC868_A16_LogicEvaluate(s_scan_image, esp_timer_get_time(),
+                              &s_force_mask, &s_force_value)) {
+    changed = true;
+  }
+  WriteOutputs(s_requested_outputs);
+#endif
+  if (changed) {
+    __atomic_store_n(&s_input_change_pending, true, __ATOMIC_RELEASE);
+  }
+}
+
+/* Expansion devices due on this pass, their outputs on every pass */
+static void ScanExpansion(bool read_inputs) {
+#if CONFIG_KC868_EXPANSION
+  if (KC868_A16_ExpansionScan(esp_timer_get_time(), read_inputs)) {
+    __atomic_store_n(&s_input_change_pending, true, __ATOMIC_RELEASE);
+  }
+#else
+  (void) read_inputs;
+#endif
+}
+
+/* Stamp the inputs of image byte index that differ from the scan image,
+ * called before the scan image takes the new byte */
+static void RecordInputEdges(size_t index, uint8_t value, int64_t time_us) {
+#if CONFIG_OPENER_PTP_TIME_SYNC
+  uint8_t changed = (uint8_t)(value ^ s_scan_image[index]);
+  if (0 == changed) {
+    return;
+  }
+  const CipUlint time_ns = PtpClockFromLocalTime(time_us);
+  const bool synchronized = PtpClockIsSynchronized();
+  for (size_t bit = 0; bit < 8; ++bit) {
+    if (0 == (changed & (1u << bit))) {
+      continue;
+    }
+    const size_t input = index * 8 + bit;
+    s_scan_edges.edge_time_ns[input] = time_ns;
+    if (synchronized) {
+      s_scan_edges.synchronized |= (CipUint)(1u << input);
+    } else {
+      s_scan_edges.synchronized &= (CipUint)~(1u << input);
+    }
+    s_scan_edges.edge_count++;
+  }
+  SeqLockWrite(&s_input_edges_lock, &s_input_edges, &s_scan_edges,
+               sizeof(s_input_edges));
+#else
+  (void) index;
+  (void) value;
+  (void) time_us;
+#endif
+}
+
+/* Take a byte read from an input expander at time_us into the scan image,
+ * through the debounce filter when configured. Edges go to the sequence of
+ * events from here unless the interrupt path recorded them already. */
+static void TakeInputByte(size_t index, uint8_t value, int64_t time_us,
+                          int64_t now_us, bool record_events) {
+#if CONFIG_KC868_INPUT_DEBOUNCE
+  (void) record_events;
+  s_raw_inputs[index] = value;
+  uint8_t filtered = s_scan_image[index];
+  int64_t edge_time_us[8];
+  const uint8_t settled = KC868_A16_DebounceFilter(index, value, time_us,
+                                                   now_us, &filtered,
+                                                   edge_time_us);
+  /* One input at a time, each with the time its level was first read */
+  for (size_t bit = 0; bit < 8 && 0 != settled; ++bit) {
+    if (0 == (settled & (1u << bit))) {
+      continue;
+    }
+    const uint8_t next = (uint8_t)(s_scan_image[index] ^ (1u << bit));
+    RecordInputEdges(index, next, edge_time_us[bit]);
+#if CONFIG_KC868_SOE_BUFFER
+    KC868_A16_SoeRecord(index, next, edge_time_us[bit]);
+#endif
+    s_scan_image[index] = next;
+  }
+#else
+  (void) now_us;
+  RecordInputEdges(index, value, time_us);
+#if CONFIG_KC868_SOE_BUFFER
+  if (record_events) {
+    KC868_A16_SoeRecord(index, value, time_us);
+  }
+#else
+  (void) record_events;
+#endif
+  s_scan_image[index] = value;
+#endif
+}
+
+#if CONFIG_KC868_HISTORY
+/* The scan image with the relay image this scan writes */
+static void RecordHistory(int64_t time_us) {
+  EipUint8 relays[KC868_A16_OUTPUT_IMAGE_SIZE] = { 0 };
+  if (s_expanders_initialized) {
+    for (size_t i = 0; i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+      relays[i] = (uint8_t)~s_bus_data[kKc868ExpanderOutputs1To8 + i];
+    }
+  }
+  KC868_A16_HistoryRecord(s_scan_image, relays, time_us);
+}
+#endif
+
+static void IoScanTimerCallback(void *arg) {
+  (void) arg;
+  xTaskNotify(s_io_scan_task, IO_EVENT_SCAN, eSetBits);
+}
+
+#if CONFIG_KC868_RELAY_TIMERS
+static void RelayTimerCallback(void *arg) {
+  (void) arg;
+  xTaskNotify(s_io_scan_task, IO_EVENT_RELAY_TIMERS, eSetBits);
+}
+#endif
+
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+/* Dispatched from the esp_timer interrupt, the scan task writes the image */
+static void IRAM_ATTR ScheduledOutputTimerCallback(void *arg) {
+  (void) arg;
+  BaseType_t woken = pdFALSE;
+  xTaskNotifyFromISR(s_io_scan_task, IO_EVENT_SCHEDULED_OUTPUTS, eSetBits,
+                     &woken);
+  if (pdFALSE != woken) {
+    esp_timer_isr_dispatch_need_yield();
+  }
+}
+#endif
+
+static void InputExpanderChanged(size_t index, uint8_t value,
+                                 int64_t timestamp_us) {
+  taskENTER_CRITICAL(&s_interrupt_lock);
+  s_interrupt_inputs[index] = (uint8_t)~value;
+  s_interrupt_time_us[index] = timestamp_us;
+  taskEXIT_CRITICAL(&s_interrupt_lock);
+#if CONFIG_KC868_SOE_BUFFER
+  /* Every read, a pulse may be over before the scan task runs; debounced
+   * inputs are recorded once they settled */
+#if CONFIG_KC868_INPUT_DEBOUNCE
+  const bool record = !KC868_A16_DebounceActive(index);
+#else
+  const bool record = true;
+#endif
+  if (record) {
+    KC868_A16_SoeRecord(index, (uint8_t)~value, timestamp_us);
+  }
+#endif
+  xTaskNotify(s_io_scan_task, IO_EVENT_INPUTS, eSetBits);
+}
+
+static void EnableInputInterrupts(void) {
+#if CONFIG_KC868_IO_INPUT_INT_GPIO >= 0
+  if (!s_expanders_initialized) {
+    return;
+  }
+
+  const esp_err_t ret = (NULL != s_backend->enable_input_interrupts) ?
+                        s_backend->enable_input_interrupts(InputExpanderChanged) :
+                        ESP_ERR_NOT_SUPPORTED;
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG_IO, "Input interrupts unavailable (%s), polling inputs",
+             esp_err_to_name(ret));
+    return;
+  }
+  s_input_interrupts_enabled = true;
+#endif
+}
+
+/* Read the input expanders, or with interrupt-driven inputs only settle
+ * the levels read by the interrupt path between the safety polls */
+static void ScanDigitalInputs(void) {
+  if (!s_input_interrupts_enabled || 0 == s_scans_until_poll) {
+    EipUint8 digital[KC868_A16_DIGITAL_INPUT_BYTES];
+    const int64_t sampled_us = esp_timer_get_time();
+    TransferExpanders(digital);
+    for (size_t i = 0; i < KC868_A16_DIGITAL_INPUT_BYTES; i++) {
+      TakeInputByte(i, digital[i], sampled_us, sampled_us, true);
+    }
+    s_scans_until_poll = s_safety_poll_scans;
+  } else {
+    TransferExpanders(NULL);
+#if CONFIG_KC868_INPUT_DEBOUNCE
+    /* Levels the interrupt path read settle on the scans */
+    const int64_t now_us = esp_timer_get_time();
+    for (size_t i = 0; i < KC868_A16_DIGITAL_INPUT_BYTES; i++) {
+      TakeInputByte(i, s_raw_inputs[i], now_us, now_us, false);
+    }
+#endif
+  }
+  --s_scans_until_poll;
+#if CONFIG_KC868_PCNT
+  KC868_A16_PcntSample(esp_timer_get_time());
+#endif
+}
+
+/* The counters of the bus and of the schedule for the other tasks */
+static void PublishDiagnostics(void) {
+  s_scan_bus_statistics.bus_recoveries = s_backend->bus_recoveries();
+  SeqLockWrite(&s_bus_statistics_lock, &s_bus_statistics,
+               &s_scan_bus_statistics, sizeof(s_bus_statistics));
+  KC868_A16_ScanSchedulePublish();
+}
+
+/* One pass of the scan groups on a tick of the scan timer; true if the
+ * expansion devices were scanned */
+static bool RunScanGroups(void) {
+  int64_t now_us = esp_timer_get_time();
+  KC868_A16_ScanScheduleBeginPass(now_us);
+  bool sampled = false;
+  bool expansion_scanned = false;
+  KC868_A16_ScanGroup group;
+  while (KC868_A16_ScanScheduleNext(now_us, &group)) {
+    switch (group) {
+      case kKc868ScanGroupDigital:
+        ScanDigitalInputs();
+        sampled = true;
+        break;
+      case kKc868ScanGroupExpansion:
+        ScanExpansion(true);
+        expansion_scanned = true;
+        break;
+      case kKc868ScanGroupAnalog:
+        SampleAnalogInputs(s_scan_image);
+        sampled = true;
+        break;
+      case kKc868ScanGroupDiagnostics:
+        PublishDiagnostics();
+        break;
+      default:
+        break;
+    }
+    const int64_t end_us = esp_timer_get_time();
+    KC868_A16_ScanScheduleComplete(group, now_us, end_us);
+    now_us = end_us;
+  }
+  if (sampled) {
+    PublishScanImage();
+#if CONFIG_KC868_HISTORY
+    RecordHistory(esp_timer_get_time());
+#endif
+  }
+  KC868_A16_ScanScheduleEndPass(esp_timer_get_time());
+  return expansion_scanned;
+}
+
+#if CONFIG_KC868_PEER
+/* New data of the peer or its connection lost: the relays that follow it
+ * and the rules on the last sample */
+static void ApplyPeerData(void) {
+  KC868_A16_PeerGetRelays(&s_peer_mask, &s_peer_value);
+#if CONFIG_KC868_LOGIC
+  if (KC868_A16_LogicEvaluate(s_scan_image, esp_timer_get_time(),
+                              &s_force_mask, &s_force_value)) {
+    __atomic_store_n(&s_input_change_pending, true, __ATOMIC_RELEASE);
+  }
+#endif
+  WriteOutputs(s_requested_outputs);
+}
+#endif
+
+static void IoScanTask(void *arg) {
+  (void) arg;
+  s_safety_poll_scans = IO_INTERRUPT_SAFETY_POLL_US /
+                        CONFIG_KC868_IO_SCAN_PERIOD_US;
+  if (s_safety_poll_scans == 0) {
+    s_safety_poll_scans = 1;
+  }
+
+  while (true) {
+    uint32_t events = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+    OPENER_LOOP_PROFILE_BEGIN(scan_start);
+    /* Outputs first; an output update also rides along with every scan in
+     * case a post raced with the notification. A scan writes them together
+     * with the input reads. */
+    DrainOutputMailbox();
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+    /* Checked on every wake-up, the timer's or a scan tick after it */
+    RunScheduledOutputs();
+#endif
+#if CONFIG_KC868_RELAY_TIMERS
+    RunRelayTimers();
+#endif
+    if (events & IO_EVENT_MODE) {
+      ApplyOutputMode();
+    }
+#if CONFIG_KC868_PEER
+    if (events & IO_EVENT_PEER) {
+      ApplyPeerData();
+    }
+#endif
+    if (!(events & IO_EVENT_SCAN)) {
+      TransferExpanders(NULL);
+    }
+
+    if (events & IO_EVENT_INPUTS) {
+      for (size_t i = 0; i < KC868_A16_DIGITAL_INPUT_BYTES; i++) {
+        taskENTER_CRITICAL(&s_interrupt_lock);
+        const uint8_t value = s_interrupt_inputs[i];
+        const int64_t time_us = s_interrupt_time_us[i];
+        taskEXIT_CRITICAL(&s_interrupt_lock);
+        TakeInputByte(i, value, time_us, esp_timer_get_time(), false);
+      }
+      if (!(events & IO_EVENT_SCAN)) {
+        PublishScanImage();
+      }
+    }
+
+    bool expansion_scanned = false;
+    if (events & IO_EVENT_SCAN) {
+      ReleaseHeldOutputs();
+      expansion_scanned = RunScanGroups();
+    }
+    /* Relays the rules set on this sample */
+    TransferExpanders(NULL);
+    if (!expansion_scanned) {
+      ScanExpansion(false);
+    }
+    OPENER_LOOP_PROFILE_END(kLoopProfilePhaseIoScan, scan_start);
+  }
+}
+
+static void StartIoScan(void) {
+  if (NULL != s_io_scan_task) {
+    return;
+  }
+
+  /* Seed the image before the first production so the scanner never sees
+   * the all-zero startup image once I/O is available. */
+  TransferExpanders(s_scan_image);
+#if CONFIG_KC868_INPUT_DEBOUNCE
+  memcpy(s_raw_inputs, s_scan_image, sizeof(s_raw_inputs));
+#endif
+  SampleAnalogInputs(s_scan_image);
+  PublishInputImage(s_scan_image);
+  (void)PublishScaledAnalogs();
+#if CONFIG_KC868_ANALOG_ALARMS
+  (void)KC868_A16_AlarmProcess(s_scan_image, esp_timer_get_time());
+#endif
+#if CONFIG_KC868_SOE_BUFFER
+  KC868_A16_SoeInitialize(s_scan_image);
+#endif
+#if CONFIG_KC868_HISTORY
+  KC868_A16_HistoryInitialize();
+#endif
+  memcpy(s_cos_reference_image, s_scan_image, sizeof(s_cos_reference_image));
+
+#if OPENER_LOOP_PROFILE
+  LoopProfileSetBudget(kLoopProfilePhaseIoScan, CONFIG_KC868_IO_SCAN_PERIOD_US);
+#endif
+  if (pdPASS != xTaskCreatePinnedToCore(IoScanTask, "kc868_io",
+                                        CONFIG_KC868_IO_SCAN_TASK_STACK_SIZE,
+                                        NULL,
+                                        CONFIG_KC868_IO_SCAN_TASK_PRIORITY,
+                                        &s_io_scan_task, IO_SCAN_TASK_CORE)) {
+    ESP_LOGE(TAG_IO, "Failed to create I/O scan task");
+    s_io_scan_task = NULL;
+    return;
+  }
+#if CONFIG_OPENER_TASK_TELEMETRY
+  TaskTelemetryRegister(kTaskTelemetryIoScan,
+                        CONFIG_KC868_IO_SCAN_TASK_STACK_SIZE);
+#endif
+
+  EnableInputInterrupts();
+
+#if CONFIG_KC868_RELAY_TIMERS
+  const esp_timer_create_args_t relay_timer_args = {
+    .callback = RelayTimerCallback,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "kc868_relay",
+  };
+  if (ESP_OK != esp_timer_create(&relay_timer_args, &s_relay_timer)) {
+    ESP_LOGE(TAG_IO, "Failed to create the relay timer");
+    s_relay_timer = NULL;
+  }
+#endif
+
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+  const esp_timer_create_args_t scheduled_output_timer_args = {
+    .callback = ScheduledOutputTimerCallback,
+    .dispatch_method = ESP_TIMER_ISR,
+    .name = "kc868_apply_at",
+  };
+  if (ESP_OK != esp_timer_create(&scheduled_output_timer_args,
+                                 &s_scheduled_output_timer)) {
+    ESP_LOGE(TAG_IO, "Failed to create the scheduled output timer");
+    s_scheduled_output_timer = NULL;
+  }
+#endif
+
+  const esp_timer_create_args_t timer_args = {
+    .callback = IoScanTimerCallback,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "kc868_io_scan",
+  };
+  esp_err_t ret = esp_timer_create(&timer_args, &s_io_scan_timer);
+  if (ret == ESP_OK) {
+    /* The scan task only runs groups on the ticks of this timer */
+    KC868_A16_ScanScheduleInitialize(esp_timer_get_time());
+    ret = esp_timer_start_periodic(s_io_scan_timer,
+                                   CONFIG_KC868_IO_SCAN_PERIOD_US);
+  }
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG_IO, "Failed to start I/O scan timer: %s", esp_err_to_name(ret));
+    return;
+  }
+
+  ESP_LOGI(TAG_IO, "I/O scan running every %d us on core %d, inputs %s, "
+           "analog inputs every %d us",
+           CONFIG_KC868_IO_SCAN_PERIOD_US, IO_SCAN_TASK_CORE,
+           s_input_interrupts_enabled ? "interrupt driven" : "polled",
+           CONFIG_KC868_IO_ANALOG_PERIOD_US);
+}
+
+void KC868_A16_IoInitialize(void) {
+  InitializeExpanders();
+  (void)s_backend->adc_initialize();
+#if CONFIG_KC868_PCNT
+  KC868_A16_PcntInitialize();
+#endif
+#if CONFIG_KC868_LOGIC
+  KC868_A16_LogicInitialize();
+#endif
+#if CONFIG_KC868_ANALOG_SCALING
+  KC868_A16_ScalingInitialize();
+#endif
+#if CONFIG_KC868_INPUT_DEBOUNCE
+  KC868_A16_DebounceInitialize();
+#endif
+#if CONFIG_KC868_ANALOG_ALARMS
+  KC868_A16_AlarmInitialize();
+#endif
+#if CONFIG_KC868_RELAY_COUNTERS
+  KC868_A16_RelayCountInitialize();
+#endif
+  StartIoScan();
+}
+
+bool KC868_A16_IoGetInputImage(EipUint8 *image) {
+  /* A reader above the scan task on core 1 (task_placement.h) can catch
+   * the scan task in the middle of a write, give up instead of spinning */
+  EipUint8 copy[KC868_A16_INPUT_IMAGE_SIZE];
+  if (!SeqLockRead(&s_input_image_lock, copy, s_input_image, sizeof(s_input_image), NULL)) {
+    return false;
+  }
+  memcpy(image, copy, sizeof(copy));
+  return true;
+}
+
+CipUsint KC868_A16_IoGetStatus(void) {
+  return __atomic_load_n(&s_io_status, __ATOMIC_RELAXED);
+}
+
+bool KC868_A16_IoGetBusStatistics(KC868_A16_IoBusStatistics *statistics) {
+  KC868_A16_IoBusStatistics copy;
+  if (!SeqLockRead(&s_bus_statistics_lock, &copy, &s_bus_statistics,
+                   sizeof(s_bus_statistics), NULL)) {
+    return false;
+  }
+  *statistics = copy;
+  return true;
+}
+
+#if CONFIG_OPENER_PTP_TIME_SYNC
+bool KC868_A16_IoGetInputEdges(KC868_A16_InputEdges *edges) {
+  KC868_A16_InputEdges copy;
+  if (!SeqLockRead(&s_input_edges_lock, &copy, &s_input_edges, sizeof(copy), NULL)) {
+    return false;
+  }
+  *edges = copy;
+  return true;
+}
+#endif
+
+#if CONFIG_KC868_ANALOG_SCALING
+bool KC868_A16_IoGetScaledAnalogs(KC868_A16_ScaledAnalogs *scaled) {
+  KC868_A16_ScaledAnalogs copy;
+  if (!SeqLockRead(&s_scaled_analogs_lock, &copy, &s_scaled_analogs,
+                   sizeof(copy), NULL)) {
+    return false;
+  }
+  *scaled = copy;
+  return true;
+}
+#endif
+
+static void PostOutputMailbox(const OutputMailbox *mailbox) {
+  SeqLockWrite(&s_output_mailbox_lock, &s_output_mailbox, mailbox,
+               sizeof(s_output_mailbox));
+  __atomic_store_n(&s_output_mailbox_pending, true, __ATOMIC_RELEASE);
+
+  if (NULL != s_io_scan_task) {
+    xTaskNotify(s_io_scan_task, IO_EVENT_OUTPUTS, eSetBits);
+  }
+}
+
+void KC868_A16_IoPostOutputImage(const EipUint8 *image) {
+  OutputMailbox mailbox = { 0 };
+  memcpy(mailbox.image, image, sizeof(mailbox.image));
+  PostOutputMailbox(&mailbox);
+}
+
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+void KC868_A16_IoPostScheduledOutputImage(const EipUint8 *image,
+                                          int64_t apply_at_us) {
+  OutputMailbox mailbox = { .apply_at_us = apply_at_us };
+  memcpy(mailbox.image, image, sizeof(mailbox.image));
+  PostOutputMailbox(&mailbox);
+}
+
+bool KC868_A16_IoGetScheduledOutputStatistics(KC868_A16_ScheduledOutputStatistics *statistics) {
+  KC868_A16_ScheduledOutputStatistics copy;
+  if (!SeqLockRead(&s_scheduled_statistics_lock, &copy, &s_scheduled_statistics,
+                   sizeof(copy), NULL)) {
+    return false;
+  }
+  *statistics = copy;
+  return true;
+}
+#endif
+
+#if CONFIG_KC868_RELAY_TIMERS
+void KC868_A16_IoWakeRelayTimers(void) {
+  if (NULL != s_io_scan_task) {
+    xTaskNotify(s_io_scan_task, IO_EVENT_RELAY_TIMERS, eSetBits);
+  }
+}
+#endif
+
+#if CONFIG_KC868_EXPANSION
+void KC868_A16_IoWakeExpansion(void) {
+  if (NULL != s_io_scan_task) {
+    xTaskNotify(s_io_scan_task, IO_EVENT_OUTPUTS, eSetBits);
+  }
+}
+#endif
+
+#if CONFIG_KC868_PEER
+void KC868_A16_IoWakePeer(void) {
+  if (NULL != s_io_scan_task) {
+    xTaskNotify(s_io_scan_task, IO_EVENT_PEER, eSetBits);
+  }
+}
+#endif
+
+void KC868_A16_IoSetOutputMode(KC868_A16_OutputMode mode) {
+  if (mode == __atomic_exchange_n(&s_requested_mode, mode, __ATOMIC_RELEASE)) {
+    return;
+  }
+  if (NULL != s_io_scan_task) {
+    xTaskNotify(s_io_scan_task, IO_EVENT_MODE, eSetBits);
+  }
+}
+
+void KC868_A16_IoSetOutputSafeStates(const KC868_A16_OutputSafeStates *safe_states) {
+  SeqLockWrite(&s_safe_states_lock, &s_safe_states, safe_states,
+               sizeof(s_safe_states));
+#if CONFIG_OPENER_WARM_RESTART
+  WarmRestartSetApplication(offsetof(IoWarmState, fault), &safe_states->fault,
+                            sizeof(safe_states->fault));
+#endif
+}
+
+bool KC868_A16_IoTakeSafeImage(EipUint8 *image) {
+  if (!__atomic_exchange_n(&s_safe_image_pending, false, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  if (!SeqLockRead(&s_safe_image_lock, image, s_safe_image,
+                   sizeof(s_safe_image), NULL)) {
+    /* Written again right now, pick it up on the next call */
+    __atomic_store_n(&s_safe_image_pending, true, __ATOMIC_RELEASE);
+    return false;
+  }
+  return true;
+}
+
+bool KC868_A16_IoTakeInputChange(void) {
+  return __atomic_exchange_n(&s_input_change_pending, false, __ATOMIC_ACQUIRE);
+}
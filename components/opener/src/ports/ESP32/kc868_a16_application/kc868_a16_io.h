@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_IO_H_
+#define KC868_A16_IO_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_io.h
+ *  @brief KC868-A16 field I/O (PCF8574 expanders and ADC1) scan layer
+ *
+ *  The I/O scan task owns the I2C bus and ADC unit. It samples all inputs at
+ *  a fixed period into an input image that the OpENer task reads without
+ *  touching any hardware, so production latency does not depend on I2C bus
+ *  speed. The hardware is reached through a backend, the board's or a
+ *  simulated one, see kc868_a16_io_backend.h.
+ */
+
+#define KC868_A16_DIGITAL_INPUT_BYTES             2
+#define KC868_A16_ANALOG_INPUT_COUNT              4
+#define KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL  2
+#define KC868_A16_INPUT_ANALOG_START_OFFSET       KC868_A16_DIGITAL_INPUT_BYTES
+#define KC868_A16_INPUT_IMAGE_SIZE                (KC868_A16_DIGITAL_INPUT_BYTES + \
+                                                   (KC868_A16_ANALOG_INPUT_COUNT * \
+                                                    KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL))
+#define KC868_A16_OUTPUT_IMAGE_SIZE               2
+#define KC868_A16_DIGITAL_INPUT_COUNT             (KC868_A16_DIGITAL_INPUT_BYTES * 8)
+#define KC868_A16_OUTPUT_COUNT                    (KC868_A16_OUTPUT_IMAGE_SIZE * 8)
+
+/** @brief Who the relays answer to, set by the application */
+typedef enum {
+  kKc868OutputModeRun = 0, /**< relays follow the posted output images */
+  kKc868OutputModeIdle = 1, /**< scanner in idle, or the connection was closed */
+  kKc868OutputModeFault = 2, /**< the connection timed out */
+} KC868_A16_OutputMode;
+
+/** @brief What a relay does when the outputs leave the run mode */
+typedef enum {
+  kKc868OutputActionHold = 0, /**< keep the last state */
+  kKc868OutputActionClear = 1, /**< release */
+  kKc868OutputActionPreset = 2, /**< take the state of the preset */
+  kKc868OutputActionHoldThenClear = 3, /**< keep the last state for hold_ms, then release */
+} KC868_A16_OutputAction;
+
+/** @brief Safe state of the relays in one of the idle and fault modes */
+typedef struct {
+  CipUsint action[KC868_A16_OUTPUT_COUNT]; /**< KC868_A16_OutputAction of relay n+1 */
+  CipWord preset; /**< bit n: state of relay n+1 for kKc868OutputActionPreset */
+  CipUint hold_ms; /**< of kKc868OutputActionHoldThenClear */
+} KC868_A16_OutputSafeState;
+
+typedef struct {
+  KC868_A16_OutputSafeState idle;
+  KC868_A16_OutputSafeState fault;
+} KC868_A16_OutputSafeStates;
+
+#if CONFIG_OPENER_PTP_TIME_SYNC
+/** @brief Last edge of every digital input in PTP time
+ *
+ *  With interrupt driven inputs the time of an edge is the falling INT edge
+ *  seen by the PCF8574 ISR; with polled inputs, and for edges only the safety
+ *  poll caught, it is the time of the scan that read the new state.
+ */
+typedef struct {
+  CipUint synchronized; /**< bit n: edge of input n+1 stamped while the PTP clock was synchronized */
+  CipUdint edge_count; /**< edges on all inputs since start, wraps around */
+  CipUlint edge_time_ns[KC868_A16_DIGITAL_INPUT_COUNT]; /**< 0 until the first edge */
+} KC868_A16_InputEdges;
+#endif
+
+#if CONFIG_KC868_ANALOG_SCALING
+/* Status bits of a scaled analog channel, see kc868_a16_scaling.h */
+#define KC868_A16_ANALOG_UNDER_RANGE  0x01
+#define KC868_A16_ANALOG_OVER_RANGE   0x02
+#define KC868_A16_ANALOG_WIRE_BREAK   0x04 /**< 4-20 mA only */
+
+/** @brief Analog inputs in engineering units, converted after every sample */
+typedef struct {
+  CipInt value[KC868_A16_ANALOG_INPUT_COUNT]; /**< A1 first */
+  CipUsint status[KC868_A16_ANALOG_INPUT_COUNT]; /**< KC868_A16_ANALOG_* bits */
+} KC868_A16_ScaledAnalogs;
+#endif
+
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+/** @brief Output images with a time to switch at, since start */
+typedef struct {
+  CipUdint scheduled; /**< images that waited for their time */
+  CipUdint applied; /**< of those, written at their time */
+  CipUdint replaced; /**< replaced by a newer image before their time */
+  CipUdint cancelled; /**< dropped by a change of the output mode */
+  CipUdint late; /**< their time had passed on arrival, written at once */
+  CipUdint out_of_range; /**< further ahead than CONFIG_KC868_SCHEDULED_OUTPUTS_MAX_AHEAD_MS, written at once */
+  CipUdint last_lateness_us; /**< end of the expander write after the time, last image applied */
+  CipUdint max_lateness_us;
+} KC868_A16_ScheduledOutputStatistics;
+#endif
+
+/** @brief The PCF8574 expanders, in the order the scan task accesses them */
+typedef enum {
+  kKc868ExpanderOutputs1To8 = 0, /**< Y01-Y08, 0x24 */
+  kKc868ExpanderOutputs9To16 = 1, /**< Y09-Y16, 0x25 */
+  kKc868ExpanderInputs1To8 = 2, /**< X01-X08, 0x22 */
+  kKc868ExpanderInputs9To16 = 3, /**< X09-X16, 0x21 */
+  kKc868ExpanderCount
+} KC868_A16_Expander;
+
+/* Expander status bits, bit n stands for expander n */
+#define KC868_A16_IO_OUTPUTS_1_8_FAULT  0x01 /**< Y01-Y08 may not be in the requested state */
+#define KC868_A16_IO_OUTPUTS_9_16_FAULT 0x02 /**< Y09-Y16 may not be in the requested state */
+#define KC868_A16_IO_INPUTS_1_8_STALE   0x04 /**< X01-X08 hold the last value read */
+#define KC868_A16_IO_INPUTS_9_16_STALE  0x08 /**< X09-X16 hold the last value read */
+/* Output verification, bit 4 + n for relay expander n */
+#define KC868_A16_IO_OUTPUTS_1_8_MISMATCH  0x10 /**< Y01-Y08 read back other than written, rewritten */
+#define KC868_A16_IO_OUTPUTS_9_16_MISMATCH 0x20 /**< Y09-Y16 read back other than written, rewritten */
+
+/** @brief Access counters of one expander, since start */
+typedef struct {
+  CipUdint errors; /**< failed accesses */
+  CipUdint retries; /**< accesses while failing, the one that succeeded included */
+  CipUdint mismatches; /**< relay expanders: read back other than written */
+} KC868_A16_ExpanderStatistics;
+
+typedef struct {
+  KC868_A16_ExpanderStatistics expander[kKc868ExpanderCount]; /**< KC868_A16_Expander order */
+  CipUdint bus_recoveries; /**< stuck bus freed by the scan task */
+} KC868_A16_IoBusStatistics;
+
+/** @brief Probe the I2C expanders in a task of its own
+ *
+ *  Called by app_main before the Ethernet bring-up, so the probe runs while
+ *  the PHY comes up. KC868_A16_IoInitialize() waits for it and registers
+ *  the expanders from its result; without this call it probes inline.
+ */
+void KC868_A16_IoStartProbe(void);
+
+/** @brief Initialize the I2C expanders and ADC and start the I/O scan task
+ *
+ *  Safe to call more than once; the hardware and the scan task are only set
+ *  up on the first call.
+ */
+void KC868_A16_IoInitialize(void);
+
+/** @brief Copy the most recent consistent input image
+ *
+ *  Lock-free and non-blocking with respect to the scan task; never performs
+ *  any bus access.
+ *
+ *  @param image destination buffer of KC868_A16_INPUT_IMAGE_SIZE bytes
+ *  @return true if image was updated, false if the scan task was writing and
+ *          image still holds the previous copy
+ */
+bool KC868_A16_IoGetInputImage(EipUint8 *image);
+
+#if CONFIG_OPENER_PTP_TIME_SYNC
+/** @brief Copy the most recent consistent edge record
+ *
+ *  Same sequence lock scheme as KC868_A16_IoGetInputImage().
+ *
+ *  @param edges destination
+ *  @return true if edges was updated, false if the scan task was writing
+ */
+bool KC868_A16_IoGetInputEdges(KC868_A16_InputEdges *edges);
+#endif
+
+#if CONFIG_KC868_ANALOG_SCALING
+/** @brief Copy the most recent consistent scaled analog values
+ *
+ *  Same sequence lock scheme as KC868_A16_IoGetInputImage().
+ *
+ *  @param scaled destination
+ *  @return true if scaled was updated, false if the scan task was writing
+ */
+bool KC868_A16_IoGetScaledAnalogs(KC868_A16_ScaledAnalogs *scaled);
+#endif
+
+/** @brief Expander status of the last scan
+ *
+ *  An expander is faulted from its first failed access to the first that
+ *  succeeds again. Meanwhile the scan task retries it with a growing
+ *  interval; the inputs of a faulted input expander keep their last value.
+ *
+ *  @return KC868_A16_IO_* bits
+ */
+CipUsint KC868_A16_IoGetStatus(void);
+
+/** @brief Copy the most recent consistent bus statistics
+ *
+ *  Same sequence lock scheme as KC868_A16_IoGetInputImage().
+ *
+ *  @param statistics destination
+ *  @return true if statistics was updated, false if the scan task was writing
+ */
+bool KC868_A16_IoGetBusStatistics(KC868_A16_IoBusStatistics *statistics);
+
+/** @brief Check and clear the input change-of-state flag
+ *
+ *  The scan task raises the flag whenever a digital input differs from the
+ *  last reported image, an analog input moved by more than
+ *  CONFIG_KC868_IO_COS_ANALOG_DEADBAND counts or, with
+ *  CONFIG_KC868_ANALOG_SCALING, the range status of a channel changed. A
+ *  change of KC868_A16_IoGetStatus() counts as well.
+ *
+ *  @return true if the inputs changed since the previous call
+ */
+bool KC868_A16_IoTakeInputChange(void);
+
+/** @brief Hand a new relay output image to the I/O scan task
+ *
+ *  Only stores the image in a single-slot mailbox and wakes the scan task,
+ *  which writes it to the expanders. Images posted before the scan task gets
+ *  to the bus replace each other, and expanders whose byte did not change are
+ *  not written.
+ *
+ *  @param image KC868_A16_OUTPUT_IMAGE_SIZE bytes, bit set = relay energized
+ */
+void KC868_A16_IoPostOutputImage(const EipUint8 *image);
+
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+/** @brief Hand a relay output image to be written at a time
+ *
+ *  Same mailbox as KC868_A16_IoPostOutputImage(). The scan task keeps an
+ *  image whose time is ahead and writes it when a one-shot timer wakes it
+ *  then; a newer image replaces it, and a change of the output mode drops
+ *  it. An image whose time has passed, or is further ahead than
+ *  CONFIG_KC868_SCHEDULED_OUTPUTS_MAX_AHEAD_MS, is written at once.
+ *
+ *  @param image KC868_A16_OUTPUT_IMAGE_SIZE bytes, bit set = relay energized
+ *  @param apply_at_us esp_timer time to write it at, 0 for at once
+ */
+void KC868_A16_IoPostScheduledOutputImage(const EipUint8 *image,
+                                          int64_t apply_at_us);
+
+/** @brief Copy the most recent consistent schedule counters
+ *
+ *  Same sequence lock scheme as KC868_A16_IoGetInputImage().
+ *
+ *  @param statistics destination
+ *  @return true if statistics was updated, false if the scan task was writing
+ */
+bool KC868_A16_IoGetScheduledOutputStatistics(KC868_A16_ScheduledOutputStatistics *statistics);
+#endif
+
+#if CONFIG_KC868_RELAY_TIMERS
+/** @brief Wake the scan task to take posted relay commands
+ *
+ *  See kc868_a16_relay_timer.h. May be called from any task, not from an
+ *  interrupt.
+ */
+void KC868_A16_IoWakeRelayTimers(void);
+#endif
+
+#if CONFIG_KC868_EXPANSION
+/** @brief Wake the scan task to take the expansion outputs
+ *
+ *  See kc868_a16_expansion.h. May be called from any task, not from an
+ *  interrupt.
+ */
+void KC868_A16_IoWakeExpansion(void);
+#endif
+
+#if CONFIG_KC868_PEER
+/** @brief Wake the scan task to take the data of the peer connection
+ *
+ *  See kc868_a16_peer.h. May be called from any task, not from an
+ *  interrupt.
+ */
+void KC868_A16_IoWakePeer(void);
+#endif
+
+/** @brief Switch the relays between the run, idle and fault modes
+ *
+ *  Wakes the scan task, which applies the safe state of the new mode on its
+ *  next pass, before any input is sampled. Relays with
+ *  kKc868OutputActionHoldThenClear are released by the first scan after
+ *  their hold time. An output image posted while not in the run mode is
+ *  written as usual and cancels the pending releases; this is how the web UI
+ *  takes over after a connection was closed.
+ *
+ *  May be called from any task, not from an interrupt.
+ *
+ *  @param mode new mode, setting the current mode again does nothing
+ */
+void KC868_A16_IoSetOutputMode(KC868_A16_OutputMode mode);
+
+/** @brief Replace the safe states of the idle and fault modes
+ *
+ *  Takes effect at the next mode change. May be called from any task, not
+ *  from an interrupt.
+ *
+ *  @param safe_states valid actions only, see KC868_A16_OutputAction
+ */
+void KC868_A16_IoSetOutputSafeStates(const KC868_A16_OutputSafeStates *safe_states);
+
+/** @brief Take the image the scan task switched the relays to by itself
+ *
+ *  Set whenever a safe state was applied or held relays were released, so
+ *  the application can show the relays in the output assembly again.
+ *
+ *  @param image receives KC868_A16_OUTPUT_IMAGE_SIZE bytes
+ *  @return true if image holds a new safe image
+ */
+bool KC868_A16_IoTakeSafeImage(EipUint8 *image);
+
+#endif /* KC868_A16_IO_H_ */
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_IO_BACKEND_H_
+#define KC868_A16_IO_BACKEND_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "kc868_a16_io.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_io_backend.h
+ *  @brief Hardware below the I/O scan layer
+ *
+ *  kc868_a16_io.c keeps the scan task, the images, change of state, the
+ *  backoff of failing expanders and the output modes; everything that
+ *  touches the expanders or the ADC goes through one of these backends,
+ *  selected with CONFIG_KC868_IO_BACKEND:
+ *
+ *  - g_kc868_a16_io_pcf8574: the PCF8574 expanders on the I2C bus and the
+ *    analog inputs on ADC1 of the board
+ *  - g_kc868_a16_io_simulated: the model of kc868_a16_sim.h, so the scan
+ *    task and change of state can be exercised and timed without a board
+ *
+ *  Port values are the levels of the expander pins, relays and inputs
+ *  are active low. Only the I/O scan task calls a backend, apart from the
+ *  initialization before the task is started.
+ */
+
+/** @brief Called by a backend when an input expander signalled a change
+ *
+ *  @param input_byte 0 for X01-X08, 1 for X09-X16
+ *  @param port port value read
+ *  @param timestamp_us when the change was signalled
+ */
+typedef void (*KC868_A16_IoInputChanged)(size_t input_byte, uint8_t port,
+                                         int64_t timestamp_us);
+
+typedef struct {
+  const char *name;
+
+  /** Bring up the bus and check which expanders at addresses answer, into
+   *  present[i]. Called once before initialize(), from a task of its own
+   *  while the network comes up; initialize() registers the expanders from
+   *  its result. May be NULL. */
+  esp_err_t (*probe)(const uint8_t *addresses, bool *present);
+
+  /** Bring up the bus and the expanders at addresses, in KC868_A16_Expander
+   *  order. Returns ESP_OK once transfer() may be called. */
+  esp_err_t (*initialize)(const uint8_t *addresses);
+
+  /** Write ports[i] to the relay expanders and read the input expanders
+   *  into ports[i], for every expander with access[i]. Writes go first, so
+   *  the inputs are read with the relays of this transfer. results[i] is
+   *  set for every access. With separately each access is a transaction of
+   *  its own, otherwise the accesses share one. */
+  void (*transfer)(const bool *access, bool separately, uint8_t *ports,
+                   esp_err_t *results);
+
+  /** Read the port latches of the relay expanders back into ports[i], for
+   *  every i of the output image with read[i], one transaction for both.
+   *  results[i] is set for every read. May be NULL, the outputs are not
+   *  verified then. */
+  void (*read_outputs)(const bool *read, uint8_t *ports, esp_err_t *results);
+
+  /** Free a stuck bus */
+  esp_err_t (*recover_bus)(void);
+
+  /** Bus recoveries since start, of the scan task and others */
+  uint32_t (*bus_recoveries)(void);
+
+  /** Report input changes through changed, ESP_ERR_NOT_SUPPORTED if the
+   *  board cannot; the inputs are polled then. May be NULL. */
+  esp_err_t (*enable_input_interrupts)(KC868_A16_IoInputChanged changed);
+
+  /** Set up the analog inputs, true if they are usable */
+  bool (*adc_initialize)(void);
+
+  /** KC868_A16_ANALOG_INPUT_COUNT values, A1 first, see KC868_A16_AdcRead() */
+  void (*adc_read)(uint16_t *values);
+} KC868_A16_IoBackend;
+
+#if CONFIG_KC868_IO_BACKEND_SIMULATED
+extern const KC868_A16_IoBackend g_kc868_a16_io_simulated;
+#else
+extern const KC868_A16_IoBackend g_kc868_a16_io_pcf8574;
+#endif
+
+#endif /* KC868_A16_IO_BACKEND_H_ */
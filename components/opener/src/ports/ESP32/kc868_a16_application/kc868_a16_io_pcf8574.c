@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "kc868_a16_io_backend.h"
+
+#if !CONFIG_KC868_IO_BACKEND_SIMULATED
+
+#include "kc868_a16_adc.h"
+#include "kc868_a16_bus_tuning.h"
+#include "latency_probe.h"
+#include "trace_event.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "i2c_manager.h"
+#include "pcf8574.h"
+
+#define I2C_SDA_GPIO            4
+#define I2C_SCL_GPIO            5
+#define I2C_FREQ_HZ             400000
+
+/* Timeout of one batch of expander accesses, a few hundred times its
+ * length on the wire */
+#define IO_BUS_TIMEOUT_MS       10
+
+static const char *TAG_IO = "kc868_io";
+
+static pcf8574_handle_t s_expanders[kKc868ExpanderCount];
+
+/* Expander accesses of the scan task in KC868_A16_Expander order: the two
+ * output writes, then the two input reads. The scan lists cover the whole
+ * array, the writes, the reads or a single expander, and each is one I2C
+ * transaction. As long as an expander fails only the single ones are used,
+ * so the others are not held up by its retries. */
+static uint8_t s_bus_data[kKc868ExpanderCount];
+static i2c_manager_op_t s_bus_ops[kKc868ExpanderCount];
+static i2c_manager_scan_handle_t s_bus_scan_all = NULL;
+static i2c_manager_scan_handle_t s_bus_scan_outputs = NULL;
+static i2c_manager_scan_handle_t s_bus_scan_inputs = NULL;
+static i2c_manager_scan_handle_t s_bus_scan_single[kKc868ExpanderCount];
+
+/* Reads of the relay expanders' port latches for the output verification:
+ * both in one transaction, or each on its own */
+static uint8_t s_readback_data[KC868_A16_OUTPUT_IMAGE_SIZE];
+static i2c_manager_op_t s_readback_ops[KC868_A16_OUTPUT_IMAGE_SIZE];
+static i2c_manager_scan_handle_t s_readback_scan_both = NULL;
+static i2c_manager_scan_handle_t s_readback_scan_single[KC868_A16_OUTPUT_IMAGE_SIZE];
+
+static const char *const kExpanderNames[kKc868ExpanderCount] = {
+  "Outputs Y01-Y08",
+  "Outputs Y09-Y16",
+  "Inputs X01-X08",
+  "Inputs X09-X16",
+};
+
+/* Result of Pcf8574Probe(), taken by Pcf8574Initialize() */
+static bool s_present[kKc868ExpanderCount];
+static bool s_probed = false;
+
+static esp_err_t Pcf8574Probe(const uint8_t *addresses, bool *present) {
+  esp_err_t ret = i2c_manager_init(I2C_SDA_GPIO, I2C_SCL_GPIO, I2C_FREQ_HZ);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG_IO, "Failed to initialize I2C manager: %s", esp_err_to_name(ret));
+    return ret;
+  }
+  ret = pcf8574_probe(addresses, kKc868ExpanderCount, s_present,
+                      IO_BUS_TIMEOUT_MS);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  s_probed = true;
+
+  size_t num_found = 0;
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    present[i] = s_present[i];
+    if (s_present[i]) {
+      ESP_LOGI(TAG_IO, "  [OK] PCF8574 at 0x%02X - %s", addresses[i], kExpanderNames[i]);
+      num_found++;
+    } else {
+      ESP_LOGW(TAG_IO, "  [FAIL] PCF8574 at 0x%02X - %s not found", addresses[i], kExpanderNames[i]);
+    }
+  }
+  ESP_LOGI(TAG_IO, "PCF8574 probe complete: %zu/%d devices found", num_found,
+           kKc868ExpanderCount);
+  return ESP_OK;
+}
+
+static esp_err_t Pcf8574Initialize(const uint8_t *addresses) {
+  /* After a failed probe the bus may still have to be brought up, every
+   * expander then counts as present */
+  esp_err_t ret = ESP_OK;
+  if (!i2c_manager_is_initialized()) {
+    ret = i2c_manager_init(I2C_SDA_GPIO, I2C_SCL_GPIO, I2C_FREQ_HZ);
+    if (ret != ESP_OK) {
+      ESP_LOGE(TAG_IO, "Failed to initialize I2C manager: %s", esp_err_to_name(ret));
+      return ret;
+    }
+  }
+  if (!s_probed) {
+    for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+      s_present[i] = true;
+    }
+  }
+
+  uint32_t freq_hz = I2C_FREQ_HZ;
+#if CONFIG_KC868_I2C_AUTOTUNE
+  /* Before any device is attached, the bus is re-created */
+  freq_hz = KC868_A16_BusTuningSelect(addresses, I2C_FREQ_HZ);
+#endif
+
+  // Initialize PCF8574 devices
+  pcf8574_config_t config = {
+    .freq_hz = freq_hz,
+  };
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    config.address = addresses[i];
+    ret = pcf8574_init(&config, &s_expanders[i]);
+    if (ret != ESP_OK) {
+      ESP_LOGE(TAG_IO, "Failed to initialize PCF8574 %s (0x%02X): %s",
+               kExpanderNames[i], addresses[i], esp_err_to_name(ret));
+      return ret;
+    }
+  }
+
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    s_bus_ops[i] = (i2c_manager_op_t) {
+      .type = (i < kKc868ExpanderInputs1To8) ? I2C_MANAGER_OP_WRITE :
+              I2C_MANAGER_OP_READ,
+      .address = addresses[i],
+      .data = &s_bus_data[i],
+      .length = 1,
+    };
+  }
+  ret = i2c_manager_create_scan(s_bus_ops, kKc868ExpanderCount, &s_bus_scan_all);
+  if (ret == ESP_OK) {
+    ret = i2c_manager_create_scan(&s_bus_ops[kKc868ExpanderOutputs1To8], 2,
+                                  &s_bus_scan_outputs);
+  }
+  if (ret == ESP_OK) {
+    ret = i2c_manager_create_scan(&s_bus_ops[kKc868ExpanderInputs1To8], 2,
+                                  &s_bus_scan_inputs);
+  }
+  for (size_t i = 0; ret == ESP_OK && i < kKc868ExpanderCount; i++) {
+    ret = i2c_manager_create_scan(&s_bus_ops[i], 1, &s_bus_scan_single[i]);
+  }
+  for (size_t i = 0; i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+    s_readback_ops[i] = (i2c_manager_op_t) {
+      .type = I2C_MANAGER_OP_READ,
+      .address = addresses[kKc868ExpanderOutputs1To8 + i],
+      .data = &s_readback_data[i],
+      .length = 1,
+    };
+  }
+  if (ret == ESP_OK) {
+    ret = i2c_manager_create_scan(s_readback_ops, KC868_A16_OUTPUT_IMAGE_SIZE,
+                                  &s_readback_scan_both);
+  }
+  for (size_t i = 0; ret == ESP_OK && i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+    ret = i2c_manager_create_scan(&s_readback_ops[i], 1,
+                                  &s_readback_scan_single[i]);
+  }
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG_IO, "Failed to create the I/O scan lists: %s",
+             esp_err_to_name(ret));
+    return ret;
+  }
+
+  // Quasi-bidirectional ports: the input pins are read while released high.
+  // A missing expander is left to the scan task and its backoff.
+  for (size_t i = kKc868ExpanderInputs1To8; i <= kKc868ExpanderInputs9To16; i++) {
+    if (s_present[i]) {
+      pcf8574_write(s_expanders[i], 0xFF);
+    }
+  }
+  ESP_LOGI(TAG_IO, "PCF8574 devices initialized successfully");
+  return ESP_OK;
+}
+
+static void Pcf8574Transfer(const bool *access, bool separately,
+                            uint8_t *ports, esp_err_t *results) {
+  /* The scan task accesses both relay expanders, both input expanders or
+   * all of them while none fails */
+  const bool outputs = access[kKc868ExpanderOutputs1To8] &&
+                       access[kKc868ExpanderOutputs9To16];
+  const bool inputs = access[kKc868ExpanderInputs1To8] &&
+                      access[kKc868ExpanderInputs9To16];
+  i2c_manager_scan_handle_t scan = NULL;
+  if (!separately) {
+    if (outputs && inputs) {
+      scan = s_bus_scan_all;
+    } else if (outputs && !access[kKc868ExpanderInputs1To8] &&
+               !access[kKc868ExpanderInputs9To16]) {
+      scan = s_bus_scan_outputs;
+    } else if (inputs && !access[kKc868ExpanderOutputs1To8] &&
+               !access[kKc868ExpanderOutputs9To16]) {
+      scan = s_bus_scan_inputs;
+    }
+  }
+
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    s_bus_data[i] = ports[i];
+  }
+#if OPENER_TRACE_EVENTS
+  uint32_t expanders = 0;
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    if (access[i]) {
+      expanders |= 1UL << i;
+    }
+  }
+  OPENER_TRACE_EVENT(kTraceEventI2cTransfer, expanders, 0, 0);
+#endif
+  if (NULL != scan) {
+    (void)i2c_manager_execute_scan(scan, IO_BUS_TIMEOUT_MS);
+  } else {
+    for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+      if (access[i]) {
+        (void)i2c_manager_execute_scan(s_bus_scan_single[i], IO_BUS_TIMEOUT_MS);
+      }
+    }
+  }
+#if OPENER_TRACE_EVENTS
+  esp_err_t first_error = ESP_OK;
+  for (size_t i = 0; i < kKc868ExpanderCount && ESP_OK == first_error; i++) {
+    if (access[i]) {
+      first_error = s_bus_ops[i].result;
+    }
+  }
+  OPENER_TRACE_EVENT_END(kTraceEventI2cTransfer, first_error);
+#endif
+  if (access[kKc868ExpanderOutputs1To8] || access[kKc868ExpanderOutputs9To16]) {
+    OPENER_LATENCY_PROBE(kLatencyProbeOutputWritten);
+  }
+  if (access[kKc868ExpanderInputs1To8] || access[kKc868ExpanderInputs9To16]) {
+    OPENER_LATENCY_PROBE(kLatencyProbeInputRead);
+  }
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    if (access[i]) {
+      results[i] = s_bus_ops[i].result;
+      if (ESP_OK == results[i]) {
+        ports[i] = s_bus_data[i];
+      }
+    }
+  }
+}
+
+/* A PCF8574 read returns the pin levels; a pin written low reads low, one
+ * released high reads high unless the relay driver pulls it down */
+static void Pcf8574ReadOutputs(const bool *read, uint8_t *ports,
+                               esp_err_t *results) {
+  if (read[0] && read[1]) {
+    (void)i2c_manager_execute_scan(s_readback_scan_both, IO_BUS_TIMEOUT_MS);
+  } else {
+    for (size_t i = 0; i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+      if (read[i]) {
+        (void)i2c_manager_execute_scan(s_readback_scan_single[i],
+                                       IO_BUS_TIMEOUT_MS);
+      }
+    }
+  }
+  for (size_t i = 0; i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+    if (read[i]) {
+      results[i] = s_readback_ops[i].result;
+      ports[i] = s_readback_data[i];
+    }
+  }
+}
+
+#if CONFIG_KC868_IO_INPUT_INT_GPIO >= 0
+static KC868_A16_IoInputChanged s_input_changed = NULL;
+
+#if OPENER_LATENCY_PROBES
+static void IRAM_ATTR MarkInputInterrupt(void) {
+  OPENER_LATENCY_PROBE(kLatencyProbeInputInterrupt);
+}
+#endif
+
+static void InputExpanderChanged(pcf8574_handle_t handle, uint8_t value,
+                                 int64_t timestamp_us, void *user_ctx) {
+  (void) handle;
+  OPENER_LATENCY_PROBE(kLatencyProbeInputRead);
+  s_input_changed((size_t)(uintptr_t)user_ctx, value, timestamp_us);
+}
+#endif
+
+static esp_err_t Pcf8574EnableInputInterrupts(KC868_A16_IoInputChanged changed) {
+#if CONFIG_KC868_IO_INPUT_INT_GPIO >= 0
+  const gpio_num_t int_gpio = (gpio_num_t)CONFIG_KC868_IO_INPUT_INT_GPIO;
+  s_input_changed = changed;
+#if OPENER_LATENCY_PROBES
+  pcf8574_set_isr_hook(MarkInputInterrupt);
+#endif
+  esp_err_t ret = pcf8574_enable_interrupt(s_expanders[kKc868ExpanderInputs1To8],
+                                           int_gpio, InputExpanderChanged,
+                                           (void *)0);
+  if (ret == ESP_OK) {
+    ret = pcf8574_enable_interrupt(s_expanders[kKc868ExpanderInputs9To16],
+                                   int_gpio, InputExpanderChanged, (void *)1);
+    if (ret != ESP_OK) {
+      pcf8574_disable_interrupt(s_expanders[kKc868ExpanderInputs1To8]);
+    }
+  }
+  return ret;
+#else
+  (void) changed;
+  return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+const KC868_A16_IoBackend g_kc868_a16_io_pcf8574 = {
+  .name = "PCF8574",
+  .probe = Pcf8574Probe,
+  .initialize = Pcf8574Initialize,
+  .transfer = Pcf8574Transfer,
+  .read_outputs = Pcf8574ReadOutputs,
+  .recover_bus = i2c_manager_recover_bus,
+  .bus_recoveries = i2c_manager_get_recovery_count,
+  .enable_input_interrupts = Pcf8574EnableInputInterrupts,
+  .adc_initialize = KC868_A16_AdcInitialize,
+  .adc_read = KC868_A16_AdcRead,
+};
+
+#endif /* !CONFIG_KC868_IO_BACKEND_SIMULATED */
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "kc868_a16_io_backend.h"
+
+#if CONFIG_KC868_IO_BACKEND_SIMULATED
+
+#include "kc868_a16_sim.h"
+
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+_Static_assert(KC868_A16_SIM_EXPANDER_COUNT == kKc868ExpanderCount &&
+               KC868_A16_SIM_FIRST_INPUT_EXPANDER == kKc868ExpanderInputs1To8 &&
+               KC868_A16_SIM_ANALOG_INPUT_COUNT == KC868_A16_ANALOG_INPUT_COUNT,
+               "the model has to match the scan layer");
+
+static const char *TAG_IO = "kc868_io";
+
+/* The scan task is held for the latency of the model like by a transfer on
+ * the bus; whole ticks block so lower priority tasks on the core still run */
+static void SimulateLatency(uint32_t time_us) {
+  const uint32_t tick_us = portTICK_PERIOD_MS * 1000U;
+  if (time_us >= tick_us) {
+    vTaskDelay(time_us / tick_us);
+    time_us %= tick_us;
+  }
+  if (0 != time_us) {
+    esp_rom_delay_us(time_us);
+  }
+}
+
+static esp_err_t SimInitialize(const uint8_t *addresses) {
+  (void) addresses;
+  ESP_LOGW(TAG_IO, "Simulated I/O backend, the expanders and ADC1 are not used");
+  return ESP_OK;
+}
+
+static void SimTransfer(const bool *access, bool separately, uint8_t *ports,
+                        esp_err_t *results) {
+  KC868_A16_SimResult sim_results[kKc868ExpanderCount];
+  SimulateLatency(KC868_A16_SimTransfer(access, separately, ports, sim_results,
+                                        esp_timer_get_time()));
+  for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+    if (!access[i]) {
+      continue;
+    }
+    switch (sim_results[i]) {
+      case kKc868SimOk:
+        results[i] = ESP_OK;
+        break;
+      case kKc868SimTimeout:
+        results[i] = ESP_ERR_TIMEOUT;
+        break;
+      default:
+        results[i] = ESP_FAIL;
+        break;
+    }
+  }
+}
+
+/* The relay ports of the model as written, without latency or faults */
+static void SimReadOutputs(const bool *read, uint8_t *ports,
+                           esp_err_t *results) {
+  const uint16_t relays = KC868_A16_SimGetRelays();
+  for (size_t i = 0; i < KC868_A16_OUTPUT_IMAGE_SIZE; i++) {
+    if (read[i]) {
+      ports[i] = (uint8_t)~(relays >> (8 * i));
+      results[i] = ESP_OK;
+    }
+  }
+}
+
+static esp_err_t SimRecoverBus(void) {
+  KC868_A16_SimRecoverBus();
+  return ESP_OK;
+}
+
+static uint32_t SimBusRecoveries(void) {
+  KC868_A16_SimStatistics statistics;
+  KC868_A16_SimGetStatistics(&statistics);
+  return statistics.bus_recoveries;
+}
+
+static bool SimAdcInitialize(void) {
+  return true;
+}
+
+static void SimAdcRead(uint16_t *values) {
+  SimulateLatency(KC868_A16_SimReadAnalog(values, esp_timer_get_time()));
+}
+
+/* No input interrupts, the scan task polls the model */
+const KC868_A16_IoBackend g_kc868_a16_io_simulated = {
+  .name = "simulated",
+  .initialize = SimInitialize,
+  .transfer = SimTransfer,
+  .read_outputs = SimReadOutputs,
+  .recover_bus = SimRecoverBus,
+  .bus_recoveries = SimBusRecoveries,
+  .enable_input_interrupts = NULL,
+  .adc_initialize = SimAdcInitialize,
+  .adc_read = SimAdcRead,
+};
+
+#endif /* CONFIG_KC868_IO_BACKEND_SIMULATED */
@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_logic.h"
+
+#if CONFIG_KC868_LOGIC
+
+#include <string.h>
+
+#include "kc868_a16_io.h"
+#include "kc868_a16_peer.h"
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "endianconv.h"
+#include "opener_api.h"
+#include "trace.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+
+#define LOGIC_NVS_NAMESPACE  "kc868"
+#define LOGIC_NVS_KEY        "logic_rules"
+#define LOGIC_NVS_VERSION    1
+#define LOGIC_FLAGS_MASK     (KC868_A16_LOGIC_INVERT_A | \
+                              KC868_A16_LOGIC_INVERT_B | \
+                              KC868_A16_LOGIC_OUTPUT_ON)
+
+typedef struct __attribute__((packed)) {
+  uint8_t version;
+  uint8_t rule_count;
+  KC868_A16_LogicRule rules[KC868_A16_LOGIC_MAX_RULES];
+} LogicNvBlob;
+
+/* Timers and latches of one rule, scan task only */
+typedef struct {
+  bool running;
+  bool latched;
+  int64_t start_us;
+} LogicRuleState;
+
+static const char *TAG_LOGIC = "kc868_logic";
+
+/* Configured table, written by the CIP object and the web UI */
+static KC868_A16_LogicRule s_configured_rules[KC868_A16_LOGIC_MAX_RULES];
+static bool s_rules_pending = false;
+static portMUX_TYPE s_rules_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Scan task only */
+static KC868_A16_LogicRule s_active_rules[KC868_A16_LOGIC_MAX_RULES];
+static LogicRuleState s_rule_state[KC868_A16_LOGIC_MAX_RULES];
+static uint16_t s_results = 0;
+#if CONFIG_KC868_PEER
+/* The peer's data of this evaluation */
+static uint32_t s_peer_bits = 0;
+static bool s_peer_established = false;
+#endif
+
+/* Rule results in the low word, forced relays in the high word */
+static uint32_t s_status = 0;
+
+static const CipUint kLogicMaxRulesAttribute = KC868_A16_LOGIC_MAX_RULES;
+
+static bool OperandIsValid(CipUsint operand) {
+#if CONFIG_KC868_PEER
+  if (operand >= KC868_A16_LOGIC_OPERAND_PEER(0) &&
+      operand <= KC868_A16_LOGIC_OPERAND_PEER_OK) {
+    return true;
+  }
+#endif
+  return operand < KC868_A16_LOGIC_OPERAND_AI(0) ||
+         (operand >= KC868_A16_LOGIC_OPERAND_AI(0) &&
+          operand < KC868_A16_LOGIC_OPERAND_AI(KC868_A16_ANALOG_INPUT_COUNT)) ||
+         (operand >= KC868_A16_LOGIC_OPERAND_RULE(0) &&
+          operand < KC868_A16_LOGIC_OPERAND_RULE(KC868_A16_LOGIC_MAX_RULES)) ||
+         operand == KC868_A16_LOGIC_OPERAND_TRUE;
+}
+
+const char *KC868_A16_LogicValidateRules(const KC868_A16_LogicRule *rules) {
+  for (size_t i = 0; i < KC868_A16_LOGIC_MAX_RULES; ++i) {
+    const KC868_A16_LogicRule *rule = &rules[i];
+    if (rule->type > kKc868LogicLatch) {
+      return "unknown rule type";
+    }
+    if (!OperandIsValid(rule->operand_a) || !OperandIsValid(rule->operand_b)) {
+      return "unknown operand";
+    }
+    if (0 != (rule->flags & ~LOGIC_FLAGS_MASK) || 0 != rule->reserved) {
+      return "unknown flags";
+    }
+    if (rule->output >= KC868_A16_OUTPUT_IMAGE_SIZE * 8 &&
+        rule->output != KC868_A16_LOGIC_NO_OUTPUT) {
+      return "unknown output";
+    }
+  }
+  return NULL;
+}
+
+static void PostRules(const KC868_A16_LogicRule *rules) {
+  taskENTER_CRITICAL(&s_rules_lock);
+  memcpy(s_configured_rules, rules, sizeof(s_configured_rules));
+  taskEXIT_CRITICAL(&s_rules_lock);
+  __atomic_store_n(&s_rules_pending, true, __ATOMIC_RELEASE);
+}
+
+void KC868_A16_LogicGetRules(KC868_A16_LogicRule *rules) {
+  taskENTER_CRITICAL(&s_rules_lock);
+  memcpy(rules, s_configured_rules, sizeof(s_configured_rules));
+  taskEXIT_CRITICAL(&s_rules_lock);
+}
+
+static esp_err_t StoreRules(const KC868_A16_LogicRule *rules) {
+  LogicNvBlob blob = {
+    .version = LOGIC_NVS_VERSION,
+    .rule_count = KC868_A16_LOGIC_MAX_RULES,
+  };
+  memcpy(blob.rules, rules, sizeof(blob.rules));
+
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(LOGIC_NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    return err;
+  }
+  err = nvs_set_blob(handle, LOGIC_NVS_KEY, &blob, sizeof(blob));
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  return err;
+}
+
+EipStatus KC868_A16_LogicSetRules(const KC868_A16_LogicRule *rules) {
+  const char *error = KC868_A16_LogicValidateRules(rules);
+  if (NULL != error) {
+    ESP_LOGW(TAG_LOGIC, "Rule table rejected: %s", error);
+    return kEipStatusError;
+  }
+  PostRules(rules);
+  esp_err_t err = StoreRules(rules);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG_LOGIC, "Failed to store the rules: %s", esp_err_to_name(err));
+    return kEipStatusError;
+  }
+  return kEipStatusOk;
+}
+
+void KC868_A16_LogicInitialize(void) {
+  LogicNvBlob blob;
+  size_t length = sizeof(blob);
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(LOGIC_NVS_NAMESPACE, NVS_READONLY, &handle);
+  if (err == ESP_OK) {
+    err = nvs_get_blob(handle, LOGIC_NVS_KEY, &blob, &length);
+    nvs_close(handle);
+  }
+  if (err != ESP_OK) {
+    /* Nothing stored yet: no rules, the PLC alone drives the relays */
+    return;
+  }
+  KC868_A16_LogicRule rules[KC868_A16_LOGIC_MAX_RULES];
+  memcpy(rules, blob.rules, sizeof(rules));
+  if (length != sizeof(blob) || blob.version != LOGIC_NVS_VERSION ||
+      blob.rule_count != KC868_A16_LOGIC_MAX_RULES ||
+      NULL != KC868_A16_LogicValidateRules(rules)) {
+    ESP_LOGW(TAG_LOGIC, "Ignoring invalid stored rules");
+    return;
+  }
+  PostRules(rules);
+  ESP_LOGI(TAG_LOGIC, "Loaded the interlock rules");
+}
+
+static bool OperandValue(const KC868_A16_LogicRule *rule, CipUsint operand,
+                         bool invert, const EipUint8 *image) {
+  bool value = true;
+  if (operand < KC868_A16_LOGIC_OPERAND_AI(0)) {
+    value = 0 != (image[operand / 8] & (1u << (operand % 8)));
+  } else if (operand < KC868_A16_LOGIC_OPERAND_RULE(0)) {
+    const size_t offset = KC868_A16_INPUT_ANALOG_START_OFFSET +
+                          (operand - KC868_A16_LOGIC_OPERAND_AI(0)) *
+                          KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL;
+    value = (uint16_t)(image[offset] | (image[offset + 1] << 8)) >=
+            rule->threshold;
+#if CONFIG_KC868_PEER
+  } else if (operand >= KC868_A16_LOGIC_OPERAND_PEER(0) &&
+             operand < KC868_A16_LOGIC_OPERAND_PEER_OK) {
+    value = 0 != (s_peer_bits &
+                  (1u << (operand - KC868_A16_LOGIC_OPERAND_PEER(0))));
+  } else if (operand == KC868_A16_LOGIC_OPERAND_PEER_OK) {
+    value = s_peer_established;
+#endif
+  } else if (operand != KC868_A16_LOGIC_OPERAND_TRUE) {
+    value = 0 != (s_results & (1u << (operand - KC868_A16_LOGIC_OPERAND_RULE(0))));
+  }
+  return value != invert;
+}
+
+static bool EvaluateRule(size_t index, const EipUint8 *image, int64_t now_us) {
+  const KC868_A16_LogicRule *rule = &s_active_rules[index];
+  LogicRuleState *state = &s_rule_state[index];
+  const bool a = OperandValue(rule, rule->operand_a,
+                              0 != (rule->flags & KC868_A16_LOGIC_INVERT_A), image);
+  const bool b = OperandValue(rule, rule->operand_b,
+                              0 != (rule->flags & KC868_A16_LOGIC_INVERT_B), image);
+  const int64_t preset_us = (int64_t)rule->preset_ms * 1000;
+  const bool previous = 0 != (s_results & (1u << index));
+
+  switch ((KC868_A16_LogicType)rule->type) {
+    case kKc868LogicAnd:
+      return a && b;
+    case kKc868LogicOr:
+      return a || b;
+    case kKc868LogicOnDelay:
+      if (!a) {
+        state->running = false;
+        return false;
+      }
+      if (!state->running) {
+        state->running = true;
+        state->start_us = now_us;
+      }
+      return now_us - state->start_us >= preset_us;
+    case kKc868LogicOffDelay:
+      if (a) {
+        state->running = false;
+        return true;
+      }
+      if (!previous) {
+        return false;
+      }
+      if (!state->running) {
+        state->running = true;
+        state->start_us = now_us;
+      }
+      return now_us - state->start_us < preset_us;
+    case kKc868LogicLatch:
+      if (b) {
+        state->latched = false;
+      } else if (a) {
+        state->latched = true;
+      }
+      return state->latched;
+    case kKc868LogicDisabled:
+    default:
+      return false;
+  }
+}
+
+bool KC868_A16_LogicEvaluate(const EipUint8 *image, int64_t now_us,
+                             uint16_t *force_mask, uint16_t *force_value) {
+  if (__atomic_exchange_n(&s_rules_pending, false, __ATOMIC_ACQUIRE)) {
+    taskENTER_CRITICAL(&s_rules_lock);
+    memcpy(s_active_rules, s_configured_rules, sizeof(s_active_rules));
+    taskEXIT_CRITICAL(&s_rules_lock);
+    memset(s_rule_state, 0, sizeof(s_rule_state));
+    s_results = 0;
+  }
+#if CONFIG_KC868_PEER
+  s_peer_established = KC868_A16_PeerGetBits(&s_peer_bits);
+#endif
+
+  uint16_t forced_on = 0;
+  uint16_t forced_off = 0;
+  for (size_t i = 0; i < KC868_A16_LOGIC_MAX_RULES; ++i) {
+    const bool result = EvaluateRule(i, image, now_us);
+    if (result) {
+      s_results |= (uint16_t)(1u << i);
+    } else {
+      s_results &= (uint16_t)~(1u << i);
+    }
+    const KC868_A16_LogicRule *rule = &s_active_rules[i];
+    if (!result || rule->output == KC868_A16_LOGIC_NO_OUTPUT) {
+      continue;
+    }
+    if (0 != (rule->flags & KC868_A16_LOGIC_OUTPUT_ON)) {
+      forced_on |= (uint16_t)(1u << rule->output);
+    } else {
+      forced_off |= (uint16_t)(1u << rule->output);
+    }
+  }
+
+  *force_mask = forced_on | forced_off;
+  *force_value = forced_on & (uint16_t)~forced_off;
+  const uint32_t status = s_results | ((uint32_t)*force_mask << 16);
+  if (status == __atomic_load_n(&s_status, __ATOMIC_RELAXED)) {
+    return false;
+  }
+  __atomic_store_n(&s_status, status, __ATOMIC_RELEASE);
+  return true;
+}
+
+uint32_t KC868_A16_LogicGetStatus(void) {
+  return __atomic_load_n(&s_status, __ATOMIC_ACQUIRE);
+}
+
+static void EncodeLogicRules(const void *const data,
+                             ENIPMessage *const outgoing_message) {
+  (void) data;
+  KC868_A16_LogicRule rules[KC868_A16_LOGIC_MAX_RULES];
+  KC868_A16_LogicGetRules(rules);
+  for (size_t i = 0; i < KC868_A16_LOGIC_MAX_RULES; ++i) {
+    AddSintToMessage(rules[i].type, outgoing_message);
+    AddSintToMessage(rules[i].operand_a, outgoing_message);
+    AddSintToMessage(rules[i].operand_b, outgoing_message);
+    AddSintToMessage(rules[i].flags, outgoing_message);
+    AddSintToMessage(rules[i].output, outgoing_message);
+    AddSintToMessage(rules[i].reserved, outgoing_message);
+    AddIntToMessage(rules[i].preset_ms, outgoing_message);
+    AddIntToMessage(rules[i].threshold, outgoing_message);
+  }
+}
+
+/* The whole table in one request; it is checked, applied and stored here */
+static int DecodeLogicRules(void *const data,
+                            CipMessageRouterRequest *const message_router_request,
+                            CipMessageRouterResponse *const message_router_response) {
+  (void) data;
+  const size_t size = KC868_A16_LOGIC_MAX_RULES * KC868_A16_LOGIC_RULE_SIZE;
+  if (message_router_request->request_data_size < size) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return -1;
+  }
+  if (message_router_request->request_data_size > size) {
+    message_router_response->general_status = kCipErrorTooMuchData;
+    return -1;
+  }
+
+  KC868_A16_LogicRule rules[KC868_A16_LOGIC_MAX_RULES];
+  for (size_t i = 0; i < KC868_A16_LOGIC_MAX_RULES; ++i) {
+    rules[i].type = GetUsintFromMessage(&message_router_request->data);
+    rules[i].operand_a = GetUsintFromMessage(&message_router_request->data);
+    rules[i].operand_b = GetUsintFromMessage(&message_router_request->data);
+    rules[i].flags = GetUsintFromMessage(&message_router_request->data);
+    rules[i].output = GetUsintFromMessage(&message_router_request->data);
+    rules[i].reserved = GetUsintFromMessage(&message_router_request->data);
+    rules[i].preset_ms = GetUintFromMessage(&message_router_request->data);
+    rules[i].threshold = GetUintFromMessage(&message_router_request->data);
+  }
+  if (NULL != KC868_A16_LogicValidateRules(rules)) {
+    message_router_response->general_status = kCipErrorInvalidAttributeValue;
+    return -1;
+  }
+  if (kEipStatusOk != KC868_A16_LogicSetRules(rules)) {
+    /* Applied, but lost at the next power cycle */
+    message_router_response->general_status = kCipErrorStoreOperationFailure;
+    return -1;
+  }
+  message_router_response->general_status = kCipErrorSuccess;
+  return (int)size;
+}
+
+static void EncodeLogicStatus(const void *const data,
+                              ENIPMessage *const outgoing_message) {
+  (void) data;
+  AddDintToMessage(KC868_A16_LogicGetStatus(), outgoing_message);
+}
+
+EipStatus KC868_A16_LogicCreateCipObject(void) {
+  CipClass *logic_class = NULL;
+
+  if ((logic_class = CreateCipClass(kKc868LogicClassCode,
+                                    7, /* # class attributes */
+                                    7, /* # highest class attribute number */
+                                    2, /* # class services */
+                                    3, /* # instance attributes */
+                                    3, /* # highest instance attribute number */
+                                    2, /* # instance services */
+                                    1, /* # instances */
+                                    "Logic",
+                                    1, /* # class revision */
+                                    NULL /* # function pointer for initialization */
+                                    )) == 0) {
+    OPENER_TRACE_ERR("Logic: failed to create the CIP object\n");
+    return kEipStatusError;
+  }
+
+  CipInstance *instance = GetCipInstance(logic_class, 1);
+  InsertAttribute(instance, 1, kCipUint, EncodeCipUint, NULL,
+                  (void *)&kLogicMaxRulesAttribute, kGetableSingleAndAll);
+  /* The encoder and decoder work on the rule table itself */
+  InsertAttribute(instance, 2, kCipAny, EncodeLogicRules, DecodeLogicRules,
+                  s_configured_rules, kSetAndGetAble);
+  InsertAttribute(instance, 3, kCipUdint, EncodeLogicStatus, NULL,
+                  &s_status, kGetableSingleAndAll);
+
+  InsertService(logic_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(logic_class, kSetAttributeSingle, &SetAttributeSingle,
+                "SetAttributeSingle");
+
+  return kEipStatusOk;
+}
+
+#endif /* CONFIG_KC868_LOGIC */
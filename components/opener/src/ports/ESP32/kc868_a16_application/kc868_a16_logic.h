@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_LOGIC_H_
+#define KC868_A16_LOGIC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_logic.h
+ *  @brief Local interlock rules evaluated in the I/O scan task
+ *
+ *  Selected with CONFIG_KC868_LOGIC. A table of up to
+ *  KC868_A16_LOGIC_MAX_RULES rules is evaluated after every input sample,
+ *  in table order. A rule combines two operands: digital inputs, analog
+ *  inputs compared with a threshold, the result of another rule or, with
+ *  CONFIG_KC868_PEER, a bit consumed from another board. A rule
+ *  with an output forces that relay on or off while its result is true, no
+ *  matter what the output assembly asks for; if rules disagree, off wins.
+ *  The reaction time is one I/O scan instead of a round trip through the
+ *  PLC.
+ *
+ *  The table is stored in NVS. It is read and written through attribute 2
+ *  of the Logic object (class 0x67) and GET/POST /api/logic. Writes go to
+ *  the scan task through a mailbox, and the timers and latches restart.
+ */
+
+#if CONFIG_KC868_LOGIC
+
+#define KC868_A16_LOGIC_MAX_RULES   16
+/** Rule results (WORD) and relays forced by the rules (WORD) */
+#define KC868_A16_LOGIC_STATUS_SIZE 4
+/** Size of one rule on the wire, see KC868_A16_LogicRule */
+#define KC868_A16_LOGIC_RULE_SIZE   10
+
+/** @brief Logic object class code (vendor specific) */
+static const CipUint kKc868LogicClassCode = 0x67U;
+
+typedef enum {
+  kKc868LogicDisabled = 0, /**< rule unused, result false */
+  kKc868LogicAnd = 1, /**< a and b */
+  kKc868LogicOr = 2, /**< a or b */
+  kKc868LogicOnDelay = 3, /**< a has been true for preset_ms */
+  kKc868LogicOffDelay = 4, /**< a, held for preset_ms after a fell */
+  kKc868LogicLatch = 5, /**< set by a, reset by b, reset wins */
+} KC868_A16_LogicType;
+
+/* Operands */
+#define KC868_A16_LOGIC_OPERAND_DI(n)    (n)        /**< digital input n+1, 0-15 */
+#define KC868_A16_LOGIC_OPERAND_AI(n)    (16 + (n)) /**< analog input n+1 >= threshold */
+#define KC868_A16_LOGIC_OPERAND_RULE(n)  (32 + (n)) /**< result of rule n+1 */
+#define KC868_A16_LOGIC_OPERAND_PEER(n)  (64 + (n)) /**< bit n of the peer data, 0-31, with CONFIG_KC868_PEER */
+#define KC868_A16_LOGIC_OPERAND_PEER_OK  96         /**< the peer connection is established */
+#define KC868_A16_LOGIC_OPERAND_TRUE     0xFF       /**< always true, for unused b */
+#define KC868_A16_LOGIC_NO_OUTPUT        0xFF
+
+/* Flags */
+#define KC868_A16_LOGIC_INVERT_A   0x01
+#define KC868_A16_LOGIC_INVERT_B   0x02
+#define KC868_A16_LOGIC_OUTPUT_ON  0x04 /**< force the relay on, else off */
+
+/** @brief One rule, encoded on the wire in this order, little endian
+ *
+ *  A rule refers to a later rule's result from the previous scan.
+ */
+typedef struct {
+  CipUsint type; /**< KC868_A16_LogicType */
+  CipUsint operand_a;
+  CipUsint operand_b;
+  CipUsint flags;
+  CipUsint output; /**< relay 0-15, or KC868_A16_LOGIC_NO_OUTPUT */
+  CipUsint reserved; /**< 0 */
+  CipUint preset_ms; /**< delay of the timer types */
+  CipUint threshold; /**< of the analog operands, counts or mV like the image */
+} KC868_A16_LogicRule;
+
+/** @brief Load the rule table from NVS, before the I/O scan starts */
+void KC868_A16_LogicInitialize(void);
+
+/** @brief Evaluate the rules on a new input image, I/O scan task only
+ *
+ *  @param image KC868_A16_INPUT_IMAGE_SIZE bytes of the scan image
+ *  @param now_us esp_timer_get_time() of the sample
+ *  @param force_mask receives the relays the rules force
+ *  @param force_value receives the forced state of those relays
+ *  @return true if the status changed
+ */
+bool KC868_A16_LogicEvaluate(const EipUint8 *image, int64_t now_us,
+                             uint16_t *force_mask, uint16_t *force_value);
+
+/** @brief Results of the rules (low word) and forced relays (high word)
+ *
+ *  May be called from any task.
+ */
+uint32_t KC868_A16_LogicGetStatus(void);
+
+/** @brief Copy the rule table
+ *
+ *  @param rules KC868_A16_LOGIC_MAX_RULES entries
+ */
+void KC868_A16_LogicGetRules(KC868_A16_LogicRule *rules);
+
+/** @brief Check a rule table without applying it
+ *
+ *  @return NULL if the table is valid, else a description of the error
+ */
+const char *KC868_A16_LogicValidateRules(const KC868_A16_LogicRule *rules);
+
+/** @brief Apply a valid rule table and store it in NVS
+ *
+ *  May be called from any task, not from an interrupt.
+ *
+ *  @param rules KC868_A16_LOGIC_MAX_RULES entries
+ *  @return kEipStatusOk, or kEipStatusError if the table is invalid or could
+ *          not be stored; an invalid table is not applied
+ */
+EipStatus KC868_A16_LogicSetRules(const KC868_A16_LogicRule *rules);
+
+/** @brief Create the Logic object, called by the application */
+EipStatus KC868_A16_LogicCreateCipObject(void);
+
+#endif /* CONFIG_KC868_LOGIC */
+
+#endif /* KC868_A16_LOGIC_H_ */
@@ -0,0 +1,263 @@
+/*
+Generated by LwipMibCompiler
+*/
+
+#include "lwip/apps/snmp_opts.h"
+#if LWIP_SNMP
+
+#include "kc868_a16_mib.h"
+#include "lwip/apps/snmp.h"
+#include "lwip/apps/snmp_core.h"
+#include "lwip/apps/snmp_scalar.h"
+#include "lwip/apps/snmp_table.h"
+
+
+/* --- kc868Connections 1.3.6.1.4.1.26381.868.1.2 ----------------------------------------------------- */
+static s16_t kc868IoConnections_get_value(struct snmp_node_instance *instance, void *value);
+static const struct snmp_scalar_node kc868ioconnections_scalar = SNMP_SCALAR_CREATE_NODE_READONLY(1, SNMP_ASN1_TYPE_GAUGE, kc868IoConnections_get_value);
+
+static snmp_err_t kc868conntable_get_instance(const u32_t *column, const u32_t *row_oid, u8_t row_oid_len, struct snmp_node_instance *cell_instance);
+static snmp_err_t kc868conntable_get_next_instance(const u32_t *column, struct snmp_obj_id *row_oid, struct snmp_node_instance *cell_instance);
+static s16_t kc868conntable_get_value(struct snmp_node_instance *cell_instance, void *value);
+static const struct snmp_table_col_def kc868conntable_columns[] = {
+  {2, SNMP_ASN1_TYPE_GAUGE, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnId */ 
+  {3, SNMP_ASN1_TYPE_GAUGE, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnProducedRpi */ 
+  {4, SNMP_ASN1_TYPE_COUNTER, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnProducedPackets */ 
+  {5, SNMP_ASN1_TYPE_COUNTER, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnProducedLate */ 
+  {6, SNMP_ASN1_TYPE_COUNTER, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnProducedMissed */ 
+  {7, SNMP_ASN1_TYPE_GAUGE, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnProducedJitterMax */ 
+  {8, SNMP_ASN1_TYPE_GAUGE, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnConsumedRpi */ 
+  {9, SNMP_ASN1_TYPE_COUNTER, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnConsumedPackets */ 
+  {10, SNMP_ASN1_TYPE_COUNTER, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnConsumedLate */ 
+  {11, SNMP_ASN1_TYPE_COUNTER, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnConsumedMissed */ 
+  {12, SNMP_ASN1_TYPE_GAUGE, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868ConnConsumedJitterMax */ 
+};
+static const struct snmp_table_node kc868conntable = SNMP_TABLE_CREATE(2, kc868conntable_columns, kc868conntable_get_instance, kc868conntable_get_next_instance, kc868conntable_get_value, NULL, NULL);
+
+static const struct snmp_node *const kc868connections_subnodes[] = {
+  &kc868ioconnections_scalar.node.node,
+  &kc868conntable.node.node
+};
+static const struct snmp_tree_node kc868connections_treenode = SNMP_CREATE_TREE_NODE(2, kc868connections_subnodes);
+
+/* --- kc868Objects 1.3.6.1.4.1.26381.868.1 ----------------------------------------------------- */
+static s16_t kc868io_scalars_get_value(const struct snmp_scalar_array_node_def *node, void *value);
+static const struct snmp_scalar_array_node_def kc868io_scalars_nodes[] = {
+  {1, SNMP_ASN1_TYPE_GAUGE, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868IoStatus */ 
+  {2, SNMP_ASN1_TYPE_GAUGE, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868DigitalInputs */ 
+  {3, SNMP_ASN1_TYPE_GAUGE, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868RelayOutputs */ 
+  {4, SNMP_ASN1_TYPE_COUNTER, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868BusErrors */ 
+  {5, SNMP_ASN1_TYPE_COUNTER, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868BusRetries */ 
+  {6, SNMP_ASN1_TYPE_COUNTER, SNMP_NODE_INSTANCE_READ_ONLY}, /* kc868BusRecoveries */ 
+};
+static const struct snmp_scalar_array_node kc868io_scalars = SNMP_SCALAR_CREATE_ARRAY_NODE(1, kc868io_scalars_nodes, kc868io_scalars_get_value, NULL, NULL);
+
+static const struct snmp_node *const kc868objects_subnodes[] = {
+  &kc868io_scalars.node.node,
+  &kc868connections_treenode.node
+};
+static const struct snmp_tree_node kc868objects_treenode = SNMP_CREATE_TREE_NODE(1, kc868objects_subnodes);
+
+/* --- kc868a16MIB  ----------------------------------------------------- */
+static const struct snmp_node *const kc868a16mib_subnodes[] = {
+  &kc868objects_treenode.node
+};
+static const struct snmp_tree_node kc868a16mib_root = SNMP_CREATE_TREE_NODE(868, kc868a16mib_subnodes);
+static const u32_t kc868a16mib_base_oid[] = {1,3,6,1,4,1,26381,868};
+const struct snmp_mib kc868a16mib = {kc868a16mib_base_oid, LWIP_ARRAYSIZE(kc868a16mib_base_oid), &kc868a16mib_root.node};
+
+
+
+/*
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+LWIP MIB generator - preserved section begin
+Code below is preserved on regeneration. Remove these comment lines to regenerate code.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*/
+
+/* Runs in the tcpip thread. Every value is read from the lock-free copies
+ * the I/O scan task and the Connection Diagnostics object keep; a copy that
+ * races a writer keeps the previous value, as for the web UI. */
+#include "cipassembly.h"
+#include "cipconnectiondiagnostics.h"
+#include "kc868_a16_assembly_map.h"
+#include "kc868_a16_io.h"
+
+static EipUint8 s_input_image[KC868_A16_INPUT_IMAGE_SIZE];
+static EipByte s_output_image[KC868_A16_OUTPUT_ASSEMBLY_SIZE];
+static KC868_A16_IoBusStatistics s_bus_statistics;
+
+/* The row found by the last get_instance/get_next_instance, read by the
+ * get_value that follows it */
+static CipConnectionDiagnostics s_row;
+
+/* Row index = Connection Diagnostics instance number; unused instances are
+ * no rows */
+static u8_t kc868conntable_read_row(u32_t row_index)
+{
+   if ((row_index == 0) ||
+       !CipConnectionDiagnosticsGet((size_t)row_index - 1, &s_row)) {
+      return 0;
+   }
+   return (s_row.connection_id != 0) ? 1 : 0;
+}
+
+static u32_t kc868conntable_jitter_max(const CipConnectionIntervalStatistics *statistics)
+{
+   u32_t jitter = 0;
+   if (statistics->maximum_interval > statistics->requested_interval) {
+      jitter = statistics->maximum_interval - statistics->requested_interval;
+   }
+   /* UINT32_MAX until the first interval */
+   if ((statistics->minimum_interval != UINT32_MAX) &&
+       (statistics->requested_interval > statistics->minimum_interval) &&
+       (statistics->requested_interval - statistics->minimum_interval > jitter)) {
+      jitter = statistics->requested_interval - statistics->minimum_interval;
+   }
+   return jitter;
+}
+
+/* --- kc868Connections 1.3.6.1.4.1.26381.868.1.2 ----------------------------------------------------- */
+static s16_t kc868IoConnections_get_value(struct snmp_node_instance *instance, void *value)
+{
+   u32_t *v = (u32_t *)value;
+   u32_t row_index;
+
+   LWIP_UNUSED_ARG(instance);
+   *v = 0;
+   for (row_index = 1; row_index <= CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES; row_index++) {
+      *v += kc868conntable_read_row(row_index);
+   }
+   return sizeof(u32_t);
+}
+
+static snmp_err_t kc868conntable_get_instance(const u32_t *column, const u32_t *row_oid, u8_t row_oid_len, struct snmp_node_instance *cell_instance)
+{
+   /*
+   The instance OID of this table consists of following (index) column(s):
+    kc868ConnIndex (Gauge, OID length = 1)
+   */
+   snmp_err_t err = SNMP_ERR_NOSUCHINSTANCE;
+
+   LWIP_UNUSED_ARG(column);
+   LWIP_UNUSED_ARG(cell_instance);
+   if ((row_oid_len == 1) && kc868conntable_read_row(row_oid[0]))
+   {
+      err = SNMP_ERR_NOERROR;
+   }
+   return err;
+}
+static snmp_err_t kc868conntable_get_next_instance(const u32_t *column, struct snmp_obj_id *row_oid, struct snmp_node_instance *cell_instance)
+{
+   /*
+   The instance OID of this table consists of following (index) column(s):
+    kc868ConnIndex (Gauge, OID length = 1)
+   */
+   struct snmp_next_oid_state state;
+   u32_t result_buf[1];
+   u32_t row_index;
+
+   LWIP_UNUSED_ARG(column);
+   LWIP_UNUSED_ARG(cell_instance);
+   snmp_next_oid_init(&state, row_oid->id, row_oid->len, result_buf, LWIP_ARRAYSIZE(result_buf));
+   for (row_index = 1; row_index <= CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES; row_index++) {
+      if (kc868conntable_read_row(row_index)) {
+         snmp_next_oid_check(&state, &row_index, 1, NULL);
+      }
+   }
+   if ((state.status != SNMP_NEXT_OID_STATUS_SUCCESS) ||
+       !kc868conntable_read_row(state.next_oid[0])) {
+      return SNMP_ERR_NOSUCHINSTANCE;
+   }
+   snmp_oid_assign(row_oid, state.next_oid, state.next_oid_len);
+   return SNMP_ERR_NOERROR;
+}
+static s16_t kc868conntable_get_value(struct snmp_node_instance *cell_instance, void *value)
+{
+   u32_t *v = (u32_t *)value;
+
+   switch (SNMP_TABLE_GET_COLUMN_FROM_OID(cell_instance->instance_oid.id))
+   {
+      case 2: /* kc868ConnId */
+         *v = s_row.connection_id;
+         break;
+      case 3: /* kc868ConnProducedRpi */
+         *v = s_row.produced.requested_interval;
+         break;
+      case 4: /* kc868ConnProducedPackets */
+         *v = s_row.produced.packets;
+         break;
+      case 5: /* kc868ConnProducedLate */
+         *v = s_row.produced.late_packets;
+         break;
+      case 6: /* kc868ConnProducedMissed */
+         *v = s_row.produced.missed_packets;
+         break;
+      case 7: /* kc868ConnProducedJitterMax */
+         *v = kc868conntable_jitter_max(&s_row.produced);
+         break;
+      case 8: /* kc868ConnConsumedRpi */
+         *v = s_row.consumed.requested_interval;
+         break;
+      case 9: /* kc868ConnConsumedPackets */
+         *v = s_row.consumed.packets;
+         break;
+      case 10: /* kc868ConnConsumedLate */
+         *v = s_row.consumed.late_packets;
+         break;
+      case 11: /* kc868ConnConsumedMissed */
+         *v = s_row.consumed.missed_packets;
+         break;
+      case 12: /* kc868ConnConsumedJitterMax */
+         *v = kc868conntable_jitter_max(&s_row.consumed);
+         break;
+      default:
+         LWIP_DEBUGF(SNMP_MIB_DEBUG,("kc868conntable_get_value(): unknown id: %"S32_F"\n", SNMP_TABLE_GET_COLUMN_FROM_OID(cell_instance->instance_oid.id)));
+         return 0;
+   }
+   return sizeof(u32_t);
+}
+
+/* --- kc868Objects 1.3.6.1.4.1.26381.868.1 ----------------------------------------------------- */
+static s16_t kc868io_scalars_get_value(const struct snmp_scalar_array_node_def *node, void *value)
+{
+   u32_t *v = (u32_t *)value;
+   size_t i;
+
+   switch (node->oid)
+   {
+      case 1: /* kc868IoStatus */
+         *v = KC868_A16_IoGetStatus();
+         break;
+      case 2: /* kc868DigitalInputs */
+         (void)KC868_A16_IoGetInputImage(s_input_image);
+         *v = (u32_t)s_input_image[0] | ((u32_t)s_input_image[1] << 8);
+         break;
+      case 3: /* kc868RelayOutputs */
+         (void)GetAssemblyDataSnapshot(KC868_A16_OUTPUT_ASSEMBLY_NUM,
+                                       s_output_image, sizeof(s_output_image),
+                                       NULL, NULL);
+         *v = (u32_t)s_output_image[0] | ((u32_t)s_output_image[1] << 8);
+         break;
+      case 4: /* kc868BusErrors */
+      case 5: /* kc868BusRetries */
+         (void)KC868_A16_IoGetBusStatistics(&s_bus_statistics);
+         *v = 0;
+         for (i = 0; i < kKc868ExpanderCount; i++) {
+            *v += (node->oid == 4) ? s_bus_statistics.expander[i].errors :
+                                     s_bus_statistics.expander[i].retries;
+         }
+         break;
+      case 6: /* kc868BusRecoveries */
+         (void)KC868_A16_IoGetBusStatistics(&s_bus_statistics);
+         *v = s_bus_statistics.bus_recoveries;
+         break;
+      default:
+         LWIP_DEBUGF(SNMP_MIB_DEBUG,("kc868io_scalars_get_value(): unknown id: %"S32_F"\n", node->oid));
+         return 0;
+   }
+   return sizeof(u32_t);
+}
+
+/* --- kc868a16MIB  ----------------------------------------------------- */
+#endif /* LWIP_SNMP */
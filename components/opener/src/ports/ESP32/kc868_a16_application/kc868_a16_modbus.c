@@ -0,0 +1,512 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_modbus.h"
+
+#if CONFIG_KC868_MODBUS
+
+#include <string.h>
+
+#include "cipassembly.h"
+#include "kc868_a16_application.h"
+#include "kc868_a16_assembly_map.h"
+#include "kc868_a16_io.h"
+#include "production_scheduler.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+
+#define MODBUS_TASK_STACK_SIZE    4096
+#define MODBUS_TASK_CORE          1
+#define MODBUS_SELECT_TIMEOUT_MS  1000
+#define MODBUS_SEND_TIMEOUT_MS    1000
+
+/* Transaction, protocol and length field, unit identifier */
+#define MODBUS_MBAP_SIZE          7
+#define MODBUS_MAX_PDU_SIZE       253
+#define MODBUS_MAX_ADU_SIZE       (MODBUS_MBAP_SIZE + MODBUS_MAX_PDU_SIZE)
+/* A receive takes at least one whole request besides a partial one */
+#define MODBUS_RX_BUFFER_SIZE     (2 * MODBUS_MAX_ADU_SIZE)
+#define MODBUS_TX_BUFFER_SIZE     (2 * MODBUS_MAX_ADU_SIZE)
+
+#define MODBUS_MAX_READ_BITS      2000
+#define MODBUS_MAX_READ_REGISTERS 125
+#define MODBUS_MAX_WRITE_COILS    1968
+
+static const char *TAG_MODBUS = "kc868_modbus";
+
+typedef enum {
+  kModbusFunctionReadCoils = 0x01,
+  kModbusFunctionReadDiscreteInputs = 0x02,
+  kModbusFunctionReadInputRegisters = 0x04,
+  kModbusFunctionWriteSingleCoil = 0x05,
+  kModbusFunctionWriteMultipleCoils = 0x0F,
+} ModbusFunction;
+
+typedef enum {
+  kModbusExceptionIllegalFunction = 0x01,
+  kModbusExceptionIllegalDataAddress = 0x02,
+  kModbusExceptionIllegalDataValue = 0x03,
+  kModbusExceptionServerBusy = 0x06,
+} ModbusException;
+
+typedef struct {
+  int socket; /* -1 while the slot is free */
+  size_t length; /* bytes received but not answered yet */
+  int64_t last_us; /* time of the last receive */
+  uint8_t rx[MODBUS_RX_BUFFER_SIZE];
+} ModbusClient;
+
+/* The copies all requests of one wake-up are answered from; a copy that
+ * could not be taken keeps the previous one */
+typedef struct {
+  bool inputs_read;
+  bool outputs_read;
+  EipUint8 inputs[KC868_A16_INPUT_IMAGE_SIZE];
+  EipUint8 outputs[KC868_A16_OUTPUT_ASSEMBLY_SIZE];
+} ModbusPoints;
+
+/* Only used by the server task */
+static ModbusClient s_clients[CONFIG_KC868_MODBUS_MAX_CLIENTS];
+static ModbusPoints s_points;
+static uint8_t s_tx[MODBUS_TX_BUFFER_SIZE];
+static bool s_started = false;
+
+/* Changed by the server task, read by the web UI, under s_modbus_lock */
+static KC868_A16_ModbusStatistics s_statistics;
+static portMUX_TYPE s_modbus_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint16_t GetUint16Be(const uint8_t *data) {
+  return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static void PutUint16Be(uint8_t *data, uint16_t value) {
+  data[0] = (uint8_t)(value >> 8);
+  data[1] = (uint8_t)value;
+}
+
+static uint16_t ModbusDigitalInputs(ModbusPoints *points) {
+  if (!points->inputs_read) {
+    (void) KC868_A16_IoGetInputImage(points->inputs);
+    points->inputs_read = true;
+  }
+  return (uint16_t)(points->inputs[0] | (points->inputs[1] << 8));
+}
+
+static uint16_t ModbusCoils(ModbusPoints *points) {
+  if (!points->outputs_read) {
+    (void) GetAssemblyDataSnapshot(KC868_A16_OUTPUT_ASSEMBLY_NUM,
+                                   points->outputs, sizeof(points->outputs),
+                                   NULL, NULL);
+    points->outputs_read = true;
+  }
+  return (uint16_t)(points->outputs[0] | (points->outputs[1] << 8));
+}
+
+static size_t ModbusExceptionResponse(uint8_t function, ModbusException code,
+                                      uint8_t *response) {
+  response[0] = (uint8_t)(function | 0x80);
+  response[1] = (uint8_t)code;
+  return 2;
+}
+
+static size_t ModbusReadBits(const uint8_t *request, size_t length,
+                             uint16_t bits, size_t count, uint8_t *response) {
+  if (5 != length) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataValue, response);
+  }
+  const uint16_t start = GetUint16Be(request + 1);
+  const uint16_t quantity = GetUint16Be(request + 3);
+  if (0 == quantity || quantity > MODBUS_MAX_READ_BITS) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataValue, response);
+  }
+  if ((uint32_t)start + quantity > count) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataAddress,
+                                   response);
+  }
+  const size_t byte_count = (quantity + 7U) / 8U;
+  response[0] = request[0];
+  response[1] = (uint8_t)byte_count;
+  memset(response + 2, 0, byte_count);
+  for (uint16_t i = 0; i < quantity; ++i) {
+    if (0 != (bits & (1U << (start + i)))) {
+      response[2 + i / 8U] |= (uint8_t)(1U << (i % 8U));
+    }
+  }
+  return 2 + byte_count;
+}
+
+static size_t ModbusReadInputRegisters(const uint8_t *request, size_t length,
+                                       ModbusPoints *points,
+                                       uint8_t *response) {
+  if (5 != length) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataValue, response);
+  }
+  const uint16_t start = GetUint16Be(request + 1);
+  const uint16_t quantity = GetUint16Be(request + 3);
+  if (0 == quantity || quantity > MODBUS_MAX_READ_REGISTERS) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataValue, response);
+  }
+  if ((uint32_t)start + quantity > KC868_A16_ANALOG_INPUT_COUNT) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataAddress,
+                                   response);
+  }
+  (void) ModbusDigitalInputs(points); /* takes the copy of the image */
+  response[0] = request[0];
+  response[1] = (uint8_t)(quantity * 2U);
+  for (uint16_t i = 0; i < quantity; ++i) {
+    const size_t offset = KC868_A16_INPUT_ANALOG_START_OFFSET +
+                          (start + i) * KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL;
+    PutUint16Be(response + 2 + i * 2U,
+                (uint16_t)(points->inputs[offset] |
+                           (points->inputs[offset + 1] << 8)));
+  }
+  return 2 + quantity * 2U;
+}
+
+/* Same read-modify-write as POST /api/io/outputs, refused while an I/O
+ * connection owns the output assembly */
+static bool ModbusWriteCoils(uint16_t set_mask, uint16_t clear_mask,
+                             ModbusPoints *points) {
+  EipUint16 outputs = 0;
+  ProductionSchedulerLock();
+  const EipStatus status = KC868_A16_ApplicationUpdateOutputs(set_mask,
+                                                              clear_mask,
+                                                              &outputs);
+  ProductionSchedulerUnlock();
+  if (kEipStatusOk != status) {
+    taskENTER_CRITICAL(&s_modbus_lock);
+    s_statistics.writes_refused++;
+    taskEXIT_CRITICAL(&s_modbus_lock);
+    return false;
+  }
+  points->outputs[0] = (EipUint8)outputs;
+  points->outputs[1] = (EipUint8)(outputs >> 8);
+  points->outputs_read = true;
+  return true;
+}
+
+static size_t ModbusWriteSingleCoil(const uint8_t *request, size_t length,
+                                    ModbusPoints *points, uint8_t *response) {
+  if (5 != length) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataValue, response);
+  }
+  const uint16_t address = GetUint16Be(request + 1);
+  const uint16_t value = GetUint16Be(request + 3);
+  if (0xFF00U != value && 0x0000U != value) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataValue, response);
+  }
+  if (address >= KC868_A16_OUTPUT_COUNT) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataAddress,
+                                   response);
+  }
+  const uint16_t mask = (uint16_t)(1U << address);
+  if (!ModbusWriteCoils(0 != value ? mask : 0, 0 != value ? 0 : mask,
+                        points)) {
+    return ModbusExceptionResponse(request[0], kModbusExceptionServerBusy,
+                                   response);
+  }
+  memcpy(response, request, 5);
+  return 5;
+}
+
+static size_t ModbusWriteMultipleCoils(const uint8_t *request, size_t length,
+                                       ModbusPoints *points,
+                                       uint8_t *response) {
+  if (length < 6) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataValue, response);
+  }
+  const uint16_t start = GetUint16Be(request + 1);
+  const uint16_t quantity = GetUint16Be(request + 3);
+  const size_t byte_count = request[5];
+  if (0 == quantity || quantity > MODBUS_MAX_WRITE_COILS ||
+      byte_count != (quantity + 7U) / 8U || length != 6 + byte_count) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataValue, response);
+  }
+  if ((uint32_t)start + quantity > KC868_A16_OUTPUT_COUNT) {
+    return ModbusExceptionResponse(request[0],
+                                   kModbusExceptionIllegalDataAddress,
+                                   response);
+  }
+  uint16_t set_mask = 0;
+  uint16_t clear_mask = 0;
+  for (uint16_t i = 0; i < quantity; ++i) {
+    const uint16_t mask = (uint16_t)(1U << (start + i));
+    if (0 != (request[6 + i / 8U] & (1U << (i % 8U)))) {
+      set_mask |= mask;
+    } else {
+      clear_mask |= mask;
+    }
+  }
+  if (!ModbusWriteCoils(set_mask, clear_mask, points)) {
+    return ModbusExceptionResponse(request[0], kModbusExceptionServerBusy,
+                                   response);
+  }
+  memcpy(response, request, 5);
+  return 5;
+}
+
+/* Answer one request PDU, returns the length of the response PDU */
+static size_t ModbusProcessPdu(const uint8_t *request, size_t length,
+                               ModbusPoints *points, uint8_t *response) {
+  switch (request[0]) {
+    case kModbusFunctionReadCoils:
+      return ModbusReadBits(request, length, ModbusCoils(points),
+                            KC868_A16_OUTPUT_COUNT, response);
+    case kModbusFunctionReadDiscreteInputs:
+      return ModbusReadBits(request, length, ModbusDigitalInputs(points),
+                            KC868_A16_DIGITAL_INPUT_COUNT, response);
+    case kModbusFunctionReadInputRegisters:
+      return ModbusReadInputRegisters(request, length, points, response);
+    case kModbusFunctionWriteSingleCoil:
+      return ModbusWriteSingleCoil(request, length, points, response);
+    case kModbusFunctionWriteMultipleCoils:
+      return ModbusWriteMultipleCoils(request, length, points, response);
+    default:
+      return ModbusExceptionResponse(request[0],
+                                     kModbusExceptionIllegalFunction,
+                                     response);
+  }
+}
+
+static bool ModbusSend(int socket, const uint8_t *data, size_t length) {
+  while (length > 0) {
+    const ssize_t sent = send(socket, data, length, 0);
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    length -= (size_t)sent;
+  }
+  return true;
+}
+
+/* Receive and answer every whole request received so far in one send;
+ * false if the connection is to be closed */
+static bool ModbusServeClient(ModbusClient *client) {
+  const ssize_t received = recv(client->socket, client->rx + client->length,
+                                sizeof(client->rx) - client->length, 0);
+  if (received <= 0) {
+    return false;
+  }
+  client->length += (size_t)received;
+  client->last_us = esp_timer_get_time();
+
+  size_t offset = 0;
+  size_t tx_length = 0;
+  CipUdint requests = 0;
+  CipUdint exceptions = 0;
+  bool keep = true;
+  while (client->length - offset >= MODBUS_MBAP_SIZE) {
+    const uint8_t *const adu = client->rx + offset;
+    const uint16_t protocol = GetUint16Be(adu + 2);
+    const uint16_t field_length = GetUint16Be(adu + 4);
+    if (0 != protocol || field_length < 2 ||
+        field_length > MODBUS_MAX_PDU_SIZE + 1) {
+      taskENTER_CRITICAL(&s_modbus_lock);
+      s_statistics.dropped++;
+      taskEXIT_CRITICAL(&s_modbus_lock);
+      keep = false;
+      break;
+    }
+    const size_t adu_length = 6U + field_length;
+    if (client->length - offset < adu_length) {
+      break;
+    }
+    if (tx_length + MODBUS_MAX_ADU_SIZE > sizeof(s_tx)) {
+      if (!ModbusSend(client->socket, s_tx, tx_length)) {
+        keep = false;
+        break;
+      }
+      tx_length = 0;
+    }
+    uint8_t *const out = s_tx + tx_length;
+    const size_t pdu_length = ModbusProcessPdu(adu + MODBUS_MBAP_SIZE,
+                                               field_length - 1U, &s_points,
+                                               out + MODBUS_MBAP_SIZE);
+    memcpy(out, adu, 4); /* transaction and protocol identifier */
+    PutUint16Be(out + 4, (uint16_t)(pdu_length + 1U));
+    out[6] = adu[6];
+    tx_length += MODBUS_MBAP_SIZE + pdu_length;
+    offset += adu_length;
+    requests++;
+    if (0 != (out[MODBUS_MBAP_SIZE] & 0x80)) {
+      exceptions++;
+    }
+  }
+  if (keep && 0 != tx_length) {
+    keep = ModbusSend(client->socket, s_tx, tx_length);
+  }
+  memmove(client->rx, client->rx + offset, client->length - offset);
+  client->length -= offset;
+
+  taskENTER_CRITICAL(&s_modbus_lock);
+  s_statistics.requests += requests;
+  s_statistics.exceptions += exceptions;
+  taskEXIT_CRITICAL(&s_modbus_lock);
+  return keep;
+}
+
+static void ModbusCloseClient(ModbusClient *client) {
+  close(client->socket);
+  client->socket = -1;
+  client->length = 0;
+  taskENTER_CRITICAL(&s_modbus_lock);
+  s_statistics.clients--;
+  taskEXIT_CRITICAL(&s_modbus_lock);
+}
+
+static void ModbusAcceptClient(int listener) {
+  const int client_socket = accept(listener, NULL, NULL);
+  if (client_socket < 0) {
+    return;
+  }
+  const struct timeval send_timeout = {
+    .tv_sec = MODBUS_SEND_TIMEOUT_MS / 1000,
+    .tv_usec = (MODBUS_SEND_TIMEOUT_MS % 1000) * 1000,
+  };
+  const int no_delay = 1;
+  (void) setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &send_timeout,
+                    sizeof(send_timeout));
+  (void) setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay,
+                    sizeof(no_delay));
+
+  /* A free slot, else the client that has been quiet the longest */
+  ModbusClient *slot = &s_clients[0];
+  for (size_t i = 0; i < CONFIG_KC868_MODBUS_MAX_CLIENTS; ++i) {
+    if (s_clients[i].socket < 0) {
+      slot = &s_clients[i];
+      break;
+    }
+    if (s_clients[i].last_us < slot->last_us) {
+      slot = &s_clients[i];
+    }
+  }
+  if (slot->socket >= 0) {
+    ESP_LOGW(TAG_MODBUS, "All clients connected, replacing the quietest");
+    ModbusCloseClient(slot);
+  }
+  slot->socket = client_socket;
+  slot->length = 0;
+  slot->last_us = esp_timer_get_time();
+  taskENTER_CRITICAL(&s_modbus_lock);
+  s_statistics.clients++;
+  s_statistics.accepted++;
+  taskEXIT_CRITICAL(&s_modbus_lock);
+}
+
+static void ModbusTask(void *arg) {
+  (void) arg;
+  const int listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  struct sockaddr_in address = {
+    .sin_family = AF_INET,
+    .sin_port = htons(CONFIG_KC868_MODBUS_PORT),
+    .sin_addr.s_addr = htonl(INADDR_ANY),
+  };
+  if (listener < 0 ||
+      0 != bind(listener, (struct sockaddr *)&address, sizeof(address)) ||
+      0 != listen(listener, 2)) {
+    ESP_LOGE(TAG_MODBUS, "Failed to listen on port %d",
+             CONFIG_KC868_MODBUS_PORT);
+    if (listener >= 0) {
+      close(listener);
+    }
+    vTaskDelete(NULL);
+    return;
+  }
+
+  for (;;) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(listener, &readable);
+    int highest = listener;
+    for (size_t i = 0; i < CONFIG_KC868_MODBUS_MAX_CLIENTS; ++i) {
+      if (s_clients[i].socket >= 0) {
+        FD_SET(s_clients[i].socket, &readable);
+        if (s_clients[i].socket > highest) {
+          highest = s_clients[i].socket;
+        }
+      }
+    }
+    struct timeval timeout = {
+      .tv_sec = MODBUS_SELECT_TIMEOUT_MS / 1000,
+      .tv_usec = (MODBUS_SELECT_TIMEOUT_MS % 1000) * 1000,
+    };
+    if (select(highest + 1, &readable, NULL, NULL, &timeout) <= 0) {
+      continue;
+    }
+
+    /* Fresh copies for the requests of this wake-up */
+    s_points.inputs_read = false;
+    s_points.outputs_read = false;
+    for (size_t i = 0; i < CONFIG_KC868_MODBUS_MAX_CLIENTS; ++i) {
+      ModbusClient *const client = &s_clients[i];
+      if (client->socket >= 0 && FD_ISSET(client->socket, &readable) &&
+          !ModbusServeClient(client)) {
+        ModbusCloseClient(client);
+      }
+    }
+    if (FD_ISSET(listener, &readable)) {
+      ModbusAcceptClient(listener);
+    }
+  }
+}
+
+void KC868_A16_ModbusStart(void) {
+  if (s_started) {
+    return;
+  }
+  for (size_t i = 0; i < CONFIG_KC868_MODBUS_MAX_CLIENTS; ++i) {
+    s_clients[i].socket = -1;
+  }
+  if (pdPASS != xTaskCreatePinnedToCore(ModbusTask, "kc868_modbus",
+                                        MODBUS_TASK_STACK_SIZE, NULL,
+                                        CONFIG_KC868_MODBUS_TASK_PRIORITY,
+                                        NULL, MODBUS_TASK_CORE)) {
+    ESP_LOGE(TAG_MODBUS, "Failed to create the server task");
+    return;
+  }
+  s_started = true;
+  ESP_LOGI(TAG_MODBUS, "Serving Modbus TCP on port %d",
+           CONFIG_KC868_MODBUS_PORT);
+}
+
+void KC868_A16_ModbusGetStatistics(KC868_A16_ModbusStatistics *statistics) {
+  taskENTER_CRITICAL(&s_modbus_lock);
+  *statistics = s_statistics;
+  taskEXIT_CRITICAL(&s_modbus_lock);
+}
+
+#endif /* CONFIG_KC868_MODBUS */
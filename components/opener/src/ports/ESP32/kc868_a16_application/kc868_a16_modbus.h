@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_MODBUS_H_
+#define KC868_A16_MODBUS_H_
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_modbus.h
+ *  @brief Modbus TCP server on the I/O image of EtherNet/IP
+ *
+ *  Selected with CONFIG_KC868_MODBUS. A server task below the OpENer task
+ *  answers on TCP port CONFIG_KC868_MODBUS_PORT for any unit identifier:
+ *  - coils 0-15: relays 1-16, read (1), write single (5) and write
+ *    multiple (15);
+ *  - discrete inputs 0-15: digital inputs 1-16, read (2);
+ *  - input registers 0-3: the raw analog inputs 1-4, read (4).
+ *  Other function codes get exception 1, addresses past the points
+ *  exception 2.
+ *
+ *  Reads use the copies the OpENer task and the MQTT publisher read as
+ *  well, so the task never touches the I2C bus or an assembly being
+ *  written. All requests that arrived in one receive are answered from one
+ *  copy of the inputs and in one send; a write only makes the following
+ *  coil reads take a new copy.
+ *
+ *  Coil writes take the path of the web UI's POST /api/io/outputs: they
+ *  change the output assembly under the stack lock and are refused with
+ *  exception 6, server device busy, while an exclusive owner connection
+ *  consumes it. Modbus never takes the relays from a scanner, and a
+ *  scanner takes them over from Modbus with its Forward Open.
+ *
+ *  Up to CONFIG_KC868_MODBUS_MAX_CLIENTS clients are served at a time; a
+ *  further client replaces the one that has been quiet the longest.
+ */
+
+#if CONFIG_KC868_MODBUS
+
+/** @brief Server counters since start */
+typedef struct {
+  CipUdint clients; /**< connected now */
+  CipUdint accepted; /**< connections accepted */
+  CipUdint requests; /**< requests answered, exceptions included */
+  CipUdint exceptions; /**< exception responses */
+  CipUdint writes_refused; /**< coil writes refused, an owner had the relays */
+  CipUdint dropped; /**< connections closed for a malformed header */
+} KC868_A16_ModbusStatistics;
+
+/** @brief Start the server task
+ *
+ *  Called from ApplicationInitialization(). Safe to call more than once,
+ *  only the first call has an effect.
+ */
+void KC868_A16_ModbusStart(void);
+
+/** @brief Read the counters, safe from any task */
+void KC868_A16_ModbusGetStatistics(KC868_A16_ModbusStatistics *statistics);
+
+#endif /* CONFIG_KC868_MODBUS */
+
+#endif /* KC868_A16_MODBUS_H_ */
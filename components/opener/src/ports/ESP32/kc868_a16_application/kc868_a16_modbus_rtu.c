@@ -0,0 +1,664 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_modbus_rtu.h"
+
+#if CONFIG_KC868_MODBUS_RTU
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cipassembly.h"
+#include "kc868_a16_assembly_map.h"
+#include "seqlock.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define MODBUS_RTU_TASK_STACK_SIZE    4096
+#define MODBUS_RTU_TASK_CORE          1
+#define MODBUS_RTU_UART_BUFFER_SIZE   512
+/* Longest wait without a due entry, so a lost wake-up costs at most this */
+#define MODBUS_RTU_IDLE_WAIT_MS       1000
+#define MODBUS_RTU_TX_TIMEOUT_MS      500
+/* Allowed on top of the transmission time of the rest of a response */
+#define MODBUS_RTU_FRAME_MARGIN_MS    10
+/* Request: unit, function, address, count, byte count, data, CRC */
+#define MODBUS_RTU_MAX_FRAME_SIZE     256
+#define MODBUS_RTU_BITS_PER_CHARACTER 11
+
+#define MODBUS_RTU_MAX_READ_BITS       2000
+#define MODBUS_RTU_MAX_READ_REGISTERS  125
+#define MODBUS_RTU_MAX_WRITE_COILS     1968
+#define MODBUS_RTU_MAX_WRITE_REGISTERS 123
+
+static const char *TAG_MODBUS_RTU = "kc868_mb_rtu";
+
+typedef enum {
+  kModbusRtuReadCoils = 0x01,
+  kModbusRtuReadDiscreteInputs = 0x02,
+  kModbusRtuReadHoldingRegisters = 0x03,
+  kModbusRtuReadInputRegisters = 0x04,
+  kModbusRtuWriteSingleCoil = 0x05,
+  kModbusRtuWriteSingleRegister = 0x06,
+  kModbusRtuWriteMultipleCoils = 0x0F,
+  kModbusRtuWriteMultipleRegisters = 0x10,
+} ModbusRtuFunction;
+
+typedef enum {
+  kModbusRtuResultOk = 0,
+  kModbusRtuResultException,
+  kModbusRtuResultTimeout,
+  kModbusRtuResultBadFrame, /* wrong CRC, length or echo */
+} ModbusRtuResult;
+
+/* One entry of the poll table */
+typedef struct {
+  uint8_t unit;
+  uint8_t function;
+  uint8_t slave; /* index in s_slaves */
+  bool written; /* a write entry's bytes in s_written were acknowledged */
+  uint16_t address;
+  uint16_t count; /* coils or registers */
+  uint16_t byte_start; /* in the input data after the status, or the output image */
+  uint16_t bytes;
+  uint32_t period_ms;
+  int64_t due_us;
+} ModbusRtuEntry;
+
+/* Scheduling state of a slave, its counters are in s_statistics */
+typedef struct {
+  uint8_t first_entry;
+  uint32_t timeout_ms;
+  uint32_t backoff_ms; /* 0 while it answers */
+  int64_t blocked_until_us;
+  int64_t first_entry_polled_us; /* 0 before the first poll */
+} ModbusRtuSlave;
+
+/* Fixed after KC868_A16_ModbusRtuStart() */
+static ModbusRtuEntry s_entries[KC868_A16_MODBUS_RTU_MAX_ENTRIES];
+static size_t s_entry_count = 0;
+static ModbusRtuSlave s_slaves[KC868_A16_MODBUS_RTU_MAX_ENTRIES];
+static size_t s_slave_count = 0;
+static size_t s_input_bytes = 0; /* without the status */
+static size_t s_output_bytes = 0;
+static bool s_started = false;
+static TaskHandle_t s_task = NULL;
+
+/* Only used by the master task */
+static EipUint8 s_inputs[KC868_A16_MODBUS_RTU_STATUS_SIZE +
+                         KC868_A16_MODBUS_RTU_MAX_IMAGE_BYTES];
+static EipUint8 s_outputs[KC868_A16_MODBUS_RTU_MAX_IMAGE_BYTES];
+static EipUint8 s_written[KC868_A16_MODBUS_RTU_MAX_IMAGE_BYTES];
+static uint8_t s_frame[MODBUS_RTU_MAX_FRAME_SIZE];
+static int64_t s_bus_idle_since_us = 0;
+static uint32_t s_frame_gap_us = 0;
+
+/* Written by the master task, copied by the OpENer task */
+static EipUint8 s_input_image[sizeof(s_inputs)];
+static SeqLock s_input_image_lock;
+static bool s_input_changed = false;
+static bool s_outputs_released = false;
+
+/* Changed by the master task, read by the web UI, under s_modbus_rtu_lock */
+static KC868_A16_ModbusRtuSlaveStatistics s_statistics[
+  KC868_A16_MODBUS_RTU_MAX_ENTRIES];
+static portMUX_TYPE s_modbus_rtu_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint16_t ModbusRtuCrc(const uint8_t *data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+    }
+  }
+  return crc;
+}
+
+static void PutUint16Be(uint8_t *data, uint16_t value) {
+  data[0] = (uint8_t)(value >> 8);
+  data[1] = (uint8_t)value;
+}
+
+static bool IsWriteFunction(uint8_t function) {
+  return function >= kModbusRtuWriteSingleCoil;
+}
+
+static bool IsRegisterFunction(uint8_t function) {
+  return kModbusRtuReadHoldingRegisters == function ||
+         kModbusRtuReadInputRegisters == function ||
+         kModbusRtuWriteSingleRegister == function ||
+         kModbusRtuWriteMultipleRegisters == function;
+}
+
+static unsigned int MaximumCount(uint8_t function) {
+  switch (function) {
+    case kModbusRtuReadCoils:
+    case kModbusRtuReadDiscreteInputs:
+      return MODBUS_RTU_MAX_READ_BITS;
+    case kModbusRtuReadHoldingRegisters:
+    case kModbusRtuReadInputRegisters:
+      return MODBUS_RTU_MAX_READ_REGISTERS;
+    case kModbusRtuWriteSingleCoil:
+    case kModbusRtuWriteSingleRegister:
+      return 1;
+    case kModbusRtuWriteMultipleCoils:
+      return MODBUS_RTU_MAX_WRITE_COILS;
+    case kModbusRtuWriteMultipleRegisters:
+      return MODBUS_RTU_MAX_WRITE_REGISTERS;
+    default:
+      return 0;
+  }
+}
+
+/* One entry of CONFIG_KC868_MODBUS_RTU_POLLS,
+ * unit:function:address:count[:period in ms] */
+static bool ParseEntry(const char *text, ModbusRtuEntry *entry) {
+  unsigned int unit = 0;
+  unsigned int function = 0;
+  int address = 0;
+  unsigned int count = 0;
+  unsigned int period_ms = CONFIG_KC868_MODBUS_RTU_PERIOD_MS;
+  const int fields = sscanf(text, "%u:%u:%i:%u:%u", &unit, &function,
+                            &address, &count, &period_ms);
+  if (fields < 4 || unit < 1 || unit > 247 || address < 0 ||
+      address > UINT16_MAX || 0 == count || count > MaximumCount(function) ||
+      0 == period_ms || period_ms > 3600000) {
+    return false;
+  }
+  memset(entry, 0, sizeof(*entry));
+  entry->unit = (uint8_t)unit;
+  entry->function = (uint8_t)function;
+  entry->address = (uint16_t)address;
+  entry->count = (uint16_t)count;
+  entry->bytes = (uint16_t)(IsRegisterFunction(entry->function) ?
+                            2 * count : (count + 7) / 8);
+  entry->period_ms = period_ms;
+  return true;
+}
+
+/* The timeout of a slave from CONFIG_KC868_MODBUS_RTU_SLAVE_TIMEOUTS,
+ * unit:timeout in ms, or the default */
+static uint32_t SlaveTimeout(uint8_t unit) {
+  char list[] = CONFIG_KC868_MODBUS_RTU_SLAVE_TIMEOUTS;
+  char *save = NULL;
+  for (char *text = strtok_r(list, " ,;", &save); NULL != text;
+       text = strtok_r(NULL, " ,;", &save)) {
+    unsigned int listed_unit = 0;
+    unsigned int timeout_ms = 0;
+    if (2 == sscanf(text, "%u:%u", &listed_unit, &timeout_ms) &&
+        listed_unit == unit && timeout_ms > 0) {
+      return timeout_ms;
+    }
+  }
+  return CONFIG_KC868_MODBUS_RTU_TIMEOUT_MS;
+}
+
+static bool AddEntry(ModbusRtuEntry *entry) {
+  size_t *const used = IsWriteFunction(entry->function) ? &s_output_bytes :
+                       &s_input_bytes;
+  if (s_entry_count == KC868_A16_MODBUS_RTU_MAX_ENTRIES ||
+      *used + entry->bytes > KC868_A16_MODBUS_RTU_MAX_IMAGE_BYTES) {
+    return false;
+  }
+  size_t slave = 0;
+  while (slave < s_slave_count &&
+         s_statistics[slave].unit != entry->unit) {
+    slave++;
+  }
+  if (slave == s_slave_count) {
+    s_slaves[slave].first_entry = (uint8_t)s_entry_count;
+    s_slaves[slave].timeout_ms = SlaveTimeout(entry->unit);
+    s_statistics[slave].unit = entry->unit;
+    s_statistics[slave].timeout_ms = s_slaves[slave].timeout_ms;
+    s_slave_count++;
+  }
+  entry->slave = (uint8_t)slave;
+  entry->byte_start = (uint16_t)*used;
+  *used += entry->bytes;
+  s_entries[s_entry_count++] = *entry;
+  return true;
+}
+
+static void RegisterEntries(void) {
+  char list[] = CONFIG_KC868_MODBUS_RTU_POLLS;
+  char *save = NULL;
+  for (char *text = strtok_r(list, " ,;", &save); NULL != text;
+       text = strtok_r(NULL, " ,;", &save)) {
+    ModbusRtuEntry entry;
+    if (!ParseEntry(text, &entry) || !AddEntry(&entry)) {
+      ESP_LOGW(TAG_MODBUS_RTU, "Ignoring poll entry \"%s\"", text);
+    }
+  }
+}
+
+static bool OpenUart(void) {
+  const uart_config_t config = {
+    .baud_rate = CONFIG_KC868_MODBUS_RTU_BAUD_RATE,
+    .data_bits = UART_DATA_8_BITS,
+#if CONFIG_KC868_MODBUS_RTU_PARITY_EVEN
+    .parity = UART_PARITY_EVEN,
+    .stop_bits = UART_STOP_BITS_1,
+#elif CONFIG_KC868_MODBUS_RTU_PARITY_ODD
+    .parity = UART_PARITY_ODD,
+    .stop_bits = UART_STOP_BITS_1,
+#else
+    /* Without parity Modbus RTU takes two stop bits, 11 bits either way */
+    .parity = UART_PARITY_DISABLE,
+    .stop_bits = UART_STOP_BITS_2,
+#endif
+    .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+    .source_clk = UART_SCLK_DEFAULT,
+  };
+  const uart_port_t port = CONFIG_KC868_MODBUS_RTU_UART_PORT;
+  if (ESP_OK != uart_driver_install(port, MODBUS_RTU_UART_BUFFER_SIZE, 0, 0,
+                                    NULL, 0) ||
+      ESP_OK != uart_param_config(port, &config) ||
+      ESP_OK != uart_set_pin(port, CONFIG_KC868_MODBUS_RTU_TX_GPIO,
+                             CONFIG_KC868_MODBUS_RTU_RX_GPIO,
+                             CONFIG_KC868_MODBUS_RTU_DE_GPIO,
+                             UART_PIN_NO_CHANGE)) {
+    return false;
+  }
+  /* The transceiver of the board switches direction by itself, a DE pin
+   * is driven by the UART during each transmission */
+  if (CONFIG_KC868_MODBUS_RTU_DE_GPIO >= 0 &&
+      ESP_OK != uart_set_mode(port, UART_MODE_RS485_HALF_DUPLEX)) {
+    return false;
+  }
+  /* 3.5 characters, fixed above 19200 bit/s */
+  s_frame_gap_us = (CONFIG_KC868_MODBUS_RTU_BAUD_RATE > 19200) ? 1750 :
+                   (uint32_t)(35ULL * MODBUS_RTU_BITS_PER_CHARACTER * 100000ULL /
+                              CONFIG_KC868_MODBUS_RTU_BAUD_RATE);
+  return true;
+}
+
+/* Transmission time of a number of characters in ms, rounded up */
+static uint32_t CharactersMs(size_t characters) {
+  return (uint32_t)((characters * MODBUS_RTU_BITS_PER_CHARACTER * 1000ULL +
+                     CONFIG_KC868_MODBUS_RTU_BAUD_RATE - 1) /
+                    CONFIG_KC868_MODBUS_RTU_BAUD_RATE);
+}
+
+static TickType_t MsToTicksRoundedUp(uint32_t ms) {
+  return (TickType_t)((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
+/* The silent interval since the end of the previous frame */
+static void WaitFrameGap(void) {
+  const int64_t remaining_us = s_bus_idle_since_us + s_frame_gap_us -
+                               esp_timer_get_time();
+  if (remaining_us > 0) {
+    esp_rom_delay_us((uint32_t)remaining_us);
+  }
+}
+
+/* The request of an entry in s_frame, without the CRC; returns its length */
+static size_t BuildRequest(const ModbusRtuEntry *entry) {
+  s_frame[0] = entry->unit;
+  s_frame[1] = entry->function;
+  PutUint16Be(&s_frame[2], entry->address);
+  const EipUint8 *const data = &s_outputs[entry->byte_start];
+  switch (entry->function) {
+    case kModbusRtuWriteSingleCoil:
+      PutUint16Be(&s_frame[4], (data[0] & 1) ? 0xFF00 : 0x0000);
+      return 6;
+    case kModbusRtuWriteSingleRegister:
+      PutUint16Be(&s_frame[4], (uint16_t)(data[0] | (data[1] << 8)));
+      return 6;
+    case kModbusRtuWriteMultipleCoils:
+      PutUint16Be(&s_frame[4], entry->count);
+      s_frame[6] = (uint8_t)entry->bytes;
+      memcpy(&s_frame[7], data, entry->bytes);
+      return 7 + entry->bytes;
+    case kModbusRtuWriteMultipleRegisters:
+      PutUint16Be(&s_frame[4], entry->count);
+      s_frame[6] = (uint8_t)entry->bytes;
+      for (size_t i = 0; i < entry->count; i++) {
+        PutUint16Be(&s_frame[7 + 2 * i],
+                    (uint16_t)(data[2 * i] | (data[2 * i + 1] << 8)));
+      }
+      return 7 + entry->bytes;
+    default:
+      PutUint16Be(&s_frame[4], entry->count);
+      return 6;
+  }
+}
+
+/* Read a response of expected bytes into s_frame; the first two bytes wait
+ * for the timeout, the rest for its transmission time */
+static ModbusRtuResult ReceiveResponse(const ModbusRtuEntry *entry,
+                                       size_t expected, uint32_t timeout_ms,
+                                       uint8_t *exception) {
+  const uart_port_t port = CONFIG_KC868_MODBUS_RTU_UART_PORT;
+  int length = uart_read_bytes(port, s_frame, 2,
+                               MsToTicksRoundedUp(timeout_ms));
+  if (length <= 0) {
+    return kModbusRtuResultTimeout;
+  }
+  if (2 != length || s_frame[0] != entry->unit ||
+      (s_frame[1] & 0x7F) != entry->function) {
+    return kModbusRtuResultBadFrame;
+  }
+  if (0 != (s_frame[1] & 0x80)) {
+    expected = 5;
+  }
+  const size_t rest = expected - 2;
+  length = uart_read_bytes(port, &s_frame[2], rest,
+                           MsToTicksRoundedUp(CharactersMs(rest) +
+                                              MODBUS_RTU_FRAME_MARGIN_MS));
+  if (length < 0 || (size_t)length != rest ||
+      ModbusRtuCrc(s_frame, expected - 2) !=
+      (uint16_t)(s_frame[expected - 2] | (s_frame[expected - 1] << 8))) {
+    return kModbusRtuResultBadFrame;
+  }
+  if (0 != (s_frame[1] & 0x80)) {
+    *exception = s_frame[2];
+    return kModbusRtuResultException;
+  }
+  return kModbusRtuResultOk;
+}
+
+/* Send the request of an entry and take its response into the images */
+static ModbusRtuResult PollEntry(ModbusRtuEntry *entry, uint8_t *exception) {
+  const uart_port_t port = CONFIG_KC868_MODBUS_RTU_UART_PORT;
+  const ModbusRtuSlave *const slave = &s_slaves[entry->slave];
+  size_t length = BuildRequest(entry);
+  const uint16_t crc = ModbusRtuCrc(s_frame, length);
+  s_frame[length++] = (uint8_t)crc;
+  s_frame[length++] = (uint8_t)(crc >> 8);
+  /* The echo of a write, the byte count and data of a read */
+  uint8_t request[8];
+  memcpy(request, s_frame, sizeof(request));
+  const size_t expected = IsWriteFunction(entry->function) ? 8 :
+                          5 + entry->bytes;
+
+  WaitFrameGap();
+  uart_flush_input(port);
+  (void)uart_write_bytes(port, s_frame, length);
+  (void)uart_wait_tx_done(port, pdMS_TO_TICKS(MODBUS_RTU_TX_TIMEOUT_MS));
+  uart_flush_input(port); /* an echo of the transceiver */
+  const ModbusRtuResult result = ReceiveResponse(entry, expected,
+                                                 slave->timeout_ms, exception);
+  s_bus_idle_since_us = esp_timer_get_time();
+  if (kModbusRtuResultOk != result) {
+    return result;
+  }
+
+  if (IsWriteFunction(entry->function)) {
+    const size_t echoed = (kModbusRtuWriteSingleCoil == entry->function ||
+                           kModbusRtuWriteSingleRegister == entry->function) ?
+                          6 : 4;
+    if (0 != memcmp(s_frame + 2, request + 2, echoed - 2)) {
+      return kModbusRtuResultBadFrame;
+    }
+    memcpy(&s_written[entry->byte_start], &s_outputs[entry->byte_start],
+           entry->bytes);
+    entry->written = true;
+    return kModbusRtuResultOk;
+  }
+
+  if (s_frame[2] != entry->bytes) {
+    return kModbusRtuResultBadFrame;
+  }
+  EipUint8 *const data = &s_inputs[KC868_A16_MODBUS_RTU_STATUS_SIZE +
+                                   entry->byte_start];
+  if (IsRegisterFunction(entry->function)) {
+    for (size_t i = 0; i < entry->count; i++) {
+      data[2 * i] = s_frame[3 + 2 * i + 1];
+      data[2 * i + 1] = s_frame[3 + 2 * i];
+    }
+  } else {
+    memcpy(data, &s_frame[3], entry->bytes);
+  }
+  return kModbusRtuResultOk;
+}
+
+static void PublishInputs(void) {
+  if (0 == s_input_bytes) {
+    return;
+  }
+  const size_t size = KC868_A16_MODBUS_RTU_STATUS_SIZE + s_input_bytes;
+  if (0 == memcmp(s_input_image, s_inputs, size)) {
+    return;
+  }
+  SeqLockWrite(&s_input_image_lock, s_input_image, s_inputs, size);
+  __atomic_store_n(&s_input_changed, true, __ATOMIC_RELEASE);
+}
+
+static void SetEntryStatus(size_t index, bool failed) {
+  uint16_t status = (uint16_t)(s_inputs[0] | (s_inputs[1] << 8));
+  status = failed ? (uint16_t)(status | (1U << index)) :
+           (uint16_t)(status & ~(1U << index));
+  s_inputs[0] = (uint8_t)status;
+  s_inputs[1] = (uint8_t)(status >> 8);
+}
+
+/* Poll one entry and account for it at its slave */
+static void RunEntry(size_t index, int64_t now_us) {
+  ModbusRtuEntry *const entry = &s_entries[index];
+  ModbusRtuSlave *const slave = &s_slaves[entry->slave];
+  const bool first = (slave->first_entry == index);
+  const int64_t previous_poll_us = slave->first_entry_polled_us;
+  if (first) {
+    slave->first_entry_polled_us = now_us;
+  }
+
+  uint8_t exception = 0;
+  const ModbusRtuResult result = PollEntry(entry, &exception);
+  /* Reads keep their cadence, writes repeat a period after the last one */
+  if (IsWriteFunction(entry->function)) {
+    entry->due_us = now_us + (int64_t)entry->period_ms * 1000;
+  } else {
+    entry->due_us += (int64_t)entry->period_ms * 1000;
+    if (entry->due_us < now_us) {
+      entry->due_us = now_us;
+    }
+  }
+  if (kModbusRtuResultTimeout == result) {
+    slave->backoff_ms = (0 == slave->backoff_ms) ? slave->timeout_ms :
+                        2 * slave->backoff_ms;
+    if (slave->backoff_ms > CONFIG_KC868_MODBUS_RTU_MAX_BACKOFF_MS) {
+      slave->backoff_ms = CONFIG_KC868_MODBUS_RTU_MAX_BACKOFF_MS;
+    }
+    slave->blocked_until_us = s_bus_idle_since_us +
+                              (int64_t)slave->backoff_ms * 1000;
+  } else if (kModbusRtuResultBadFrame != result) {
+    if (0 != slave->backoff_ms) {
+      ESP_LOGI(TAG_MODBUS_RTU, "Slave %u answers again", entry->unit);
+    }
+    slave->backoff_ms = 0;
+  }
+  if (kModbusRtuResultException == result) {
+    ESP_LOGD(TAG_MODBUS_RTU, "Slave %u function %u address %u: exception %u",
+             entry->unit, entry->function, entry->address, exception);
+  }
+  SetEntryStatus(index, kModbusRtuResultOk != result);
+  PublishInputs();
+
+  KC868_A16_ModbusRtuSlaveStatistics *const statistics =
+    &s_statistics[entry->slave];
+  taskENTER_CRITICAL(&s_modbus_rtu_lock);
+  statistics->requests++;
+  switch (result) {
+    case kModbusRtuResultOk:
+      statistics->responses++;
+      break;
+    case kModbusRtuResultException:
+      statistics->responses++;
+      statistics->exceptions++;
+      break;
+    case kModbusRtuResultTimeout:
+      statistics->timeouts++;
+      break;
+    default:
+      statistics->crc_errors++;
+      break;
+  }
+  if (kModbusRtuResultBadFrame != result) {
+    statistics->online = (kModbusRtuResultTimeout != result);
+  }
+  statistics->backoff_ms = slave->backoff_ms;
+  if (first && 0 != previous_poll_us) {
+    statistics->cycle_ms = (CipUdint)((now_us - previous_poll_us) / 1000);
+    if (statistics->cycle_ms > statistics->cycle_max_ms) {
+      statistics->cycle_max_ms = statistics->cycle_ms;
+    }
+  }
+  taskEXIT_CRITICAL(&s_modbus_rtu_lock);
+}
+
+/* The entry to poll next and the time it is due. A write entry whose bytes
+ * changed is due at once; entries of a slave in backoff wait for it. */
+static ModbusRtuEntry *NextEntry(bool outputs_valid, int64_t now_us,
+                                 int64_t *due_us) {
+  ModbusRtuEntry *next = NULL;
+  for (size_t i = 0; i < s_entry_count; i++) {
+    ModbusRtuEntry *const entry = &s_entries[i];
+    int64_t due = entry->due_us;
+    if (IsWriteFunction(entry->function)) {
+      if (!outputs_valid) {
+        continue;
+      }
+      if (!entry->written ||
+          0 != memcmp(&s_outputs[entry->byte_start],
+                      &s_written[entry->byte_start], entry->bytes)) {
+        due = now_us;
+      }
+    }
+    const int64_t blocked_until = s_slaves[entry->slave].blocked_until_us;
+    if (due < blocked_until) {
+      due = blocked_until;
+    }
+    if (NULL == next || due < *due_us) {
+      next = entry;
+      *due_us = due;
+    }
+  }
+  return next;
+}
+
+static void ModbusRtuTask(void *arg) {
+  (void)arg;
+  for (;;) {
+    const int64_t now_us = esp_timer_get_time();
+    const bool outputs_valid =
+      0 != s_output_bytes &&
+      __atomic_load_n(&s_outputs_released, __ATOMIC_ACQUIRE) &&
+      kEipStatusOk == GetAssemblyDataSnapshot(
+        KC868_A16_MODBUS_RTU_OUTPUT_ASSEMBLY_NUM, s_outputs,
+        sizeof(s_outputs), NULL, NULL);
+    int64_t due_us = 0;
+    ModbusRtuEntry *const next = NextEntry(outputs_valid, now_us, &due_us);
+    if (NULL == next || due_us > now_us) {
+      uint32_t wait_ms = MODBUS_RTU_IDLE_WAIT_MS;
+      if (NULL != next && (due_us - now_us) / 1000 < wait_ms) {
+        wait_ms = (uint32_t)((due_us - now_us + 999) / 1000);
+      }
+      (void)ulTaskNotifyTake(pdTRUE, MsToTicksRoundedUp(wait_ms));
+      continue;
+    }
+    RunEntry((size_t)(next - s_entries), now_us);
+  }
+}
+
+void KC868_A16_ModbusRtuStart(void) {
+  if (s_started) {
+    return;
+  }
+  s_started = true;
+  RegisterEntries();
+  if (0 == s_entry_count) {
+    ESP_LOGW(TAG_MODBUS_RTU, "No poll entries, the master is not started");
+    return;
+  }
+  /* Every entry is flagged until it was answered */
+  const uint16_t status = (uint16_t)((1U << s_entry_count) - 1);
+  s_inputs[0] = (uint8_t)status;
+  s_inputs[1] = (uint8_t)(status >> 8);
+  memcpy(s_input_image, s_inputs, sizeof(s_input_image));
+  if (!OpenUart()) {
+    ESP_LOGE(TAG_MODBUS_RTU, "Failed to open UART %d",
+             CONFIG_KC868_MODBUS_RTU_UART_PORT);
+    return;
+  }
+  if (pdPASS != xTaskCreatePinnedToCore(ModbusRtuTask, "kc868_mb_rtu",
+                                        MODBUS_RTU_TASK_STACK_SIZE, NULL,
+                                        CONFIG_KC868_MODBUS_RTU_TASK_PRIORITY,
+                                        &s_task, MODBUS_RTU_TASK_CORE)) {
+    ESP_LOGE(TAG_MODBUS_RTU, "Failed to create the master task");
+    return;
+  }
+  ESP_LOGI(TAG_MODBUS_RTU, "%u poll entries for %u slaves: %u input bytes, "
+           "%u output bytes", (unsigned)s_entry_count,
+           (unsigned)s_slave_count, (unsigned)s_input_bytes,
+           (unsigned)s_output_bytes);
+}
+
+size_t KC868_A16_ModbusRtuInputImageSize(void) {
+  return (0 != s_input_bytes) ?
+         KC868_A16_MODBUS_RTU_STATUS_SIZE + s_input_bytes : 0;
+}
+
+size_t KC868_A16_ModbusRtuOutputImageSize(void) {
+  return s_output_bytes;
+}
+
+bool KC868_A16_ModbusRtuGetInputImage(EipUint8 *image) {
+  EipUint8 copy[sizeof(s_input_image)];
+  const size_t size = KC868_A16_ModbusRtuInputImageSize();
+  if (0 == size ||
+      !SeqLockRead(&s_input_image_lock, copy, s_input_image, size, NULL)) {
+    return false;
+  }
+  memcpy(image, copy, size);
+  return true;
+}
+
+bool KC868_A16_ModbusRtuTakeInputChange(void) {
+  return __atomic_exchange_n(&s_input_changed, false, __ATOMIC_ACQ_REL);
+}
+
+void KC868_A16_ModbusRtuReleaseOutputs(void) {
+  __atomic_store_n(&s_outputs_released, true, __ATOMIC_RELEASE);
+  if (NULL != s_task) {
+    xTaskNotifyGive(s_task);
+  }
+}
+
+void KC868_A16_ModbusRtuHoldOutputs(void) {
+  __atomic_store_n(&s_outputs_released, false, __ATOMIC_RELEASE);
+}
+
+size_t KC868_A16_ModbusRtuGetStatistics(
+  KC868_A16_ModbusRtuSlaveStatistics *statistics) {
+  taskENTER_CRITICAL(&s_modbus_rtu_lock);
+  memcpy(statistics, s_statistics, s_slave_count * sizeof(*statistics));
+  taskEXIT_CRITICAL(&s_modbus_rtu_lock);
+  return s_slave_count;
+}
+
+#endif /* CONFIG_KC868_MODBUS_RTU */
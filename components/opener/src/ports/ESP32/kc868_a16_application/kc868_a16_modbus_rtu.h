@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_MODBUS_RTU_H_
+#define KC868_A16_MODBUS_RTU_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_modbus_rtu.h
+ *  @brief Modbus RTU master on the RS485 port of the board
+ *
+ *  Selected with CONFIG_KC868_MODBUS_RTU. A task below the OpENer task runs
+ *  the poll table of CONFIG_KC868_MODBUS_RTU_POLLS on the RS485 UART. Each
+ *  entry reads or writes one block of one slave:
+ *  - functions 1 and 2 read coils and discrete inputs, packed eight to a
+ *    byte with the first point in bit 0;
+ *  - functions 3 and 4 read holding and input registers, one UINT each;
+ *  - functions 5 and 15 write coils, 6 and 16 holding registers, from the
+ *    output image in the same formats.
+ *  Registers are little endian in the images like every CIP integer.
+ *
+ *  Read entries get consecutive byte ranges of the input image behind the
+ *  status, write entries of the output image, in the order of the table.
+ *  The status is a UINT with bit n set while entry n has no valid data:
+ *  not answered yet, or its last request timed out or got an exception. The
+ *  data of a failed entry keeps its last value. The layout only changes
+ *  with the table.
+ *
+ *  The bus carries one request at a time. Requests follow each other with
+ *  only the 3.5 character gap, the entry due first goes next. A slave that
+ *  does not answer within its timeout is left out with a doubling backoff
+ *  up to CONFIG_KC868_MODBUS_RTU_MAX_BACKOFF_MS, so a missing slave costs
+ *  one timeout per backoff instead of one per poll. Its entries are flagged
+ *  in the status meanwhile.
+ *
+ *  Write entries go out when their bytes changed and again at their period.
+ *  They start held: nothing is written before the output assembly was
+ *  received once, and an idle, closed or timed out owner connection holds
+ *  them again. The slaves keep the values last written, their own
+ *  communication timeout decides what they do without the master.
+ *
+ *  The OpENer task never waits for the bus. It copies the input image
+ *  under the sequence lock scheme of KC868_A16_IoGetInputImage(), and the
+ *  master takes the output assembly with GetAssemblyDataSnapshot().
+ */
+
+/** Entries of the poll table, one status bit each */
+#define KC868_A16_MODBUS_RTU_MAX_ENTRIES 16
+/** Largest input or output image without the status */
+#define KC868_A16_MODBUS_RTU_MAX_IMAGE_BYTES 256
+/** Size of the entry status in front of the input data */
+#define KC868_A16_MODBUS_RTU_STATUS_SIZE 2
+
+#if CONFIG_KC868_MODBUS_RTU
+
+/** @brief Counters of one slave since start */
+typedef struct {
+  CipUsint unit; /**< slave address */
+  bool online; /**< its last request was answered */
+  CipUdint requests;
+  CipUdint responses; /**< exceptions included */
+  CipUdint exceptions;
+  CipUdint timeouts;
+  CipUdint crc_errors; /**< responses with a bad CRC or length */
+  CipUdint cycle_ms; /**< time between the last two polls of its first entry */
+  CipUdint cycle_max_ms;
+  CipUdint timeout_ms; /**< response timeout */
+  CipUdint backoff_ms; /**< left out this long after a timeout, 0 while it answers */
+} KC868_A16_ModbusRtuSlaveStatistics;
+
+/** @brief Parse the poll table, open the UART and start the master task
+ *
+ *  Called from ApplicationInitialization() before the assemblies are
+ *  created. Safe to call more than once, only the first call has an
+ *  effect.
+ */
+void KC868_A16_ModbusRtuStart(void);
+
+/** @brief Size of the input image, the status included; 0 without a read
+ *  entry */
+size_t KC868_A16_ModbusRtuInputImageSize(void);
+
+/** @brief Size of the output image, 0 without a write entry */
+size_t KC868_A16_ModbusRtuOutputImageSize(void);
+
+/** @brief Copy the most recent consistent input image
+ *
+ *  @param image KC868_A16_ModbusRtuInputImageSize() bytes
+ *  @return true if image was updated
+ */
+bool KC868_A16_ModbusRtuGetInputImage(EipUint8 *image);
+
+/** @brief Whether a response changed the input image since the last call */
+bool KC868_A16_ModbusRtuTakeInputChange(void);
+
+/** @brief The output assembly was received and may be written, wakes the
+ *  master */
+void KC868_A16_ModbusRtuReleaseOutputs(void);
+
+/** @brief Stop the writes until the next KC868_A16_ModbusRtuReleaseOutputs() */
+void KC868_A16_ModbusRtuHoldOutputs(void);
+
+/** @brief Read the counters of the slaves, safe from any task
+ *
+ *  @param statistics room for KC868_A16_MODBUS_RTU_MAX_ENTRIES slaves
+ *  @return number of slaves, in the order of their first entry
+ */
+size_t KC868_A16_ModbusRtuGetStatistics(
+  KC868_A16_ModbusRtuSlaveStatistics *statistics);
+
+#endif /* CONFIG_KC868_MODBUS_RTU */
+
+#endif /* KC868_A16_MODBUS_RTU_H_ */
@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_mqtt.h"
+
+#if CONFIG_KC868_MQTT
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cipassembly.h"
+#include "kc868_a16_assembly_map.h"
+#include "kc868_a16_io.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "lwip/apps/mqtt.h"
+#include "lwip/apps/mqtt_priv.h"
+#include "lwip/ip_addr.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"
+
+#define MQTT_TASK_STACK_SIZE        3072
+#define MQTT_TASK_CORE              1
+#define MQTT_RECONNECT_INTERVAL_US  5000000
+#define MQTT_KEEP_ALIVE_S           30
+
+static const char *TAG_MQTT = "kc868_mqtt";
+
+typedef enum {
+  kMqttPointDigitalInputs = 0,
+  kMqttPointOutputs,
+  kMqttPointAnalog1,
+  kMqttPointAnalog2,
+  kMqttPointAnalog3,
+  kMqttPointAnalog4,
+  kMqttPointIoStatus,
+  kMqttPointBusErrors,
+  kMqttPointCount
+} MqttPoint;
+
+#define MQTT_ALL_POINTS ((1U << kMqttPointCount) - 1U)
+
+static const char *const kMqttPointNames[kMqttPointCount] = {
+  "di", "do", "ai1", "ai2", "ai3", "ai4", "io_status", "bus_errors",
+};
+
+/* The longest message, every point at its largest value, stays below 200
+ * bytes; the smallest buffer has 256 */
+typedef struct {
+  struct tcpip_callback_msg *message; /* posts this buffer, allocated once */
+  u16_t length;
+  char payload[CONFIG_KC868_MQTT_BUFFER_SIZE];
+} MqttBuffer;
+
+static MqttBuffer s_buffers[CONFIG_KC868_MQTT_BUFFERS];
+static QueueHandle_t s_free_buffers = NULL; /* MqttBuffer pointers */
+
+/* tcpip thread only, after KC868_A16_MqttStart() */
+static mqtt_client_t s_client;
+static ip_addr_t s_broker;
+static struct mqtt_connect_client_info_t s_client_info;
+
+/* Written by the tcpip thread and the publisher task, under s_mqtt_lock */
+static KC868_A16_MqttStatistics s_statistics;
+static bool s_resync = false; /* a connect or a lost message, send all */
+static portMUX_TYPE s_mqtt_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Publisher task only: the sources, which keep their previous copy when a
+ * read races a writer, and the values the broker has */
+static EipUint8 s_input_image[KC868_A16_INPUT_IMAGE_SIZE];
+static EipByte s_output_image[KC868_A16_OUTPUT_ASSEMBLY_SIZE];
+static KC868_A16_IoBusStatistics s_bus_statistics;
+static uint32_t s_published[kMqttPointCount];
+static uint32_t s_sequence = 0;
+
+static void MqttConnectionCallback(mqtt_client_t *client, void *arg,
+                                   mqtt_connection_status_t status) {
+  (void) client;
+  (void) arg;
+  const bool accepted = (MQTT_CONNECT_ACCEPTED == status);
+  taskENTER_CRITICAL(&s_mqtt_lock);
+  s_statistics.connected = accepted;
+  if (accepted) {
+    s_statistics.connects++;
+    s_resync = true;
+  }
+  taskEXIT_CRITICAL(&s_mqtt_lock);
+  if (accepted) {
+    ESP_LOGI(TAG_MQTT, "Connected to %s:%d", CONFIG_KC868_MQTT_BROKER,
+             CONFIG_KC868_MQTT_PORT);
+  } else {
+    ESP_LOGW(TAG_MQTT, "Connection closed, status %d", (int) status);
+  }
+}
+
+static err_t MqttConnectInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+  /* ERR_ISCONN while a connect is still in progress */
+  return mqtt_client_connect(&s_client, &s_broker, CONFIG_KC868_MQTT_PORT,
+                             MqttConnectionCallback, NULL, &s_client_info);
+}
+
+/* The MQTT client copies the payload into its ring buffer, the buffer is
+ * free again right away */
+static void MqttPublishInTcpip(void *context) {
+  MqttBuffer *buffer = (MqttBuffer *) context;
+  err_t error = ERR_CONN;
+  if (mqtt_client_is_connected(&s_client)) {
+    error = mqtt_publish(&s_client, CONFIG_KC868_MQTT_TOPIC, buffer->payload,
+                         buffer->length, 0, 0, NULL, NULL);
+  }
+  if (ERR_OK != error) {
+    taskENTER_CRITICAL(&s_mqtt_lock);
+    s_statistics.dropped++;
+    s_resync = true;
+    taskEXIT_CRITICAL(&s_mqtt_lock);
+  }
+  (void) xQueueSend(s_free_buffers, &buffer, 0);
+}
+
+static void MqttSamplePoints(uint32_t *points) {
+  (void) KC868_A16_IoGetInputImage(s_input_image);
+  (void) GetAssemblyDataSnapshot(KC868_A16_OUTPUT_ASSEMBLY_NUM,
+                                 s_output_image, sizeof(s_output_image),
+                                 NULL, NULL);
+  (void) KC868_A16_IoGetBusStatistics(&s_bus_statistics);
+
+  points[kMqttPointDigitalInputs] = (uint32_t) s_input_image[0] |
+                                    ((uint32_t) s_input_image[1] << 8);
+  points[kMqttPointOutputs] = (uint32_t) s_output_image[0] |
+                              ((uint32_t) s_output_image[1] << 8);
+  for (size_t channel = 0; channel < KC868_A16_ANALOG_INPUT_COUNT; ++channel) {
+    const size_t offset = KC868_A16_INPUT_ANALOG_START_OFFSET +
+                          channel * KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL;
+    points[kMqttPointAnalog1 + channel] =
+      (uint32_t) s_input_image[offset] |
+      ((uint32_t) s_input_image[offset + 1] << 8);
+  }
+  points[kMqttPointIoStatus] = KC868_A16_IoGetStatus();
+  uint32_t errors = 0;
+  for (size_t i = 0; i < kKc868ExpanderCount; ++i) {
+    errors += s_bus_statistics.expander[i].errors;
+  }
+  points[kMqttPointBusErrors] = errors;
+}
+
+/* Points that differ from what the broker has */
+static uint32_t MqttChangedPoints(const uint32_t *points) {
+  uint32_t changed = 0;
+  for (size_t i = 0; i < kMqttPointCount; ++i) {
+    if (i >= kMqttPointAnalog1 && i <= kMqttPointAnalog4) {
+      const uint32_t difference = points[i] > s_published[i] ?
+                                  points[i] - s_published[i] :
+                                  s_published[i] - points[i];
+      if (difference > CONFIG_KC868_MQTT_DEADBAND) {
+        changed |= 1U << i;
+      }
+    } else if (points[i] != s_published[i]) {
+      changed |= 1U << i;
+    }
+  }
+  return changed;
+}
+
+/* Hands the points of mask to the tcpip thread; false if no buffer was
+ * free or the thread's mailbox was full */
+static bool MqttSend(const uint32_t *points, uint32_t mask, int64_t now_us) {
+  MqttBuffer *buffer = NULL;
+  if (pdTRUE != xQueueReceive(s_free_buffers, &buffer, 0)) {
+    taskENTER_CRITICAL(&s_mqtt_lock);
+    s_statistics.busy++;
+    taskEXIT_CRITICAL(&s_mqtt_lock);
+    return false;
+  }
+
+  const size_t size = sizeof(buffer->payload);
+  int length = snprintf(buffer->payload, size,
+                        "{\"seq\":%" PRIu32 ",\"t_ms\":%" PRId64,
+                        s_sequence, now_us / 1000);
+  uint32_t count = 0;
+  for (size_t i = 0; i < kMqttPointCount; ++i) {
+    if (0 != (mask & (1U << i))) {
+      length += snprintf(buffer->payload + length, size - (size_t) length,
+                         ",\"%s\":%" PRIu32, kMqttPointNames[i], points[i]);
+      count++;
+    }
+  }
+  length += snprintf(buffer->payload + length, size - (size_t) length, "}");
+  buffer->length = (u16_t) length;
+
+  if (ERR_OK != tcpip_callbackmsg_trycallback(buffer->message)) {
+    (void) xQueueSend(s_free_buffers, &buffer, 0);
+    taskENTER_CRITICAL(&s_mqtt_lock);
+    s_statistics.busy++;
+    taskEXIT_CRITICAL(&s_mqtt_lock);
+    return false;
+  }
+  s_sequence++;
+  taskENTER_CRITICAL(&s_mqtt_lock);
+  s_statistics.messages++;
+  s_statistics.points += count;
+  taskEXIT_CRITICAL(&s_mqtt_lock);
+  return true;
+}
+
+static void MqttTask(void *argument) {
+  (void) argument;
+  const TickType_t period = pdMS_TO_TICKS(CONFIG_KC868_MQTT_SAMPLE_MS) > 0 ?
+                            pdMS_TO_TICKS(CONFIG_KC868_MQTT_SAMPLE_MS) : 1;
+  TickType_t wake = xTaskGetTickCount();
+  int64_t last_attempt_us = -MQTT_RECONNECT_INTERVAL_US;
+  int64_t last_full_us = 0;
+  int64_t window_start_us = 0;
+  bool window_open = false;
+  bool full_pending = true;
+  uint32_t points[kMqttPointCount];
+
+  for (;;) {
+    vTaskDelayUntil(&wake, period);
+    const int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_mqtt_lock);
+    const bool connected = s_statistics.connected;
+    full_pending = full_pending || s_resync;
+    s_resync = false;
+    taskEXIT_CRITICAL(&s_mqtt_lock);
+
+    if (!connected) {
+      window_open = false;
+      if (now_us - last_attempt_us >= MQTT_RECONNECT_INTERVAL_US) {
+        last_attempt_us = now_us;
+        struct tcpip_api_call_data call;
+        (void) tcpip_api_call(MqttConnectInTcpip, &call);
+      }
+      continue;
+    }
+
+    MqttSamplePoints(points);
+    if (now_us - last_full_us >=
+        (int64_t) CONFIG_KC868_MQTT_FULL_INTERVAL_S * 1000000) {
+      full_pending = true;
+    }
+    const uint32_t mask = full_pending ? MQTT_ALL_POINTS :
+                          MqttChangedPoints(points);
+    if (0 == mask) {
+      window_open = false;
+      continue;
+    }
+    /* The first change opens the window, changes until its end ride
+     * along */
+    if (!full_pending) {
+      if (!window_open) {
+        window_open = true;
+        window_start_us = now_us;
+      }
+      if (now_us - window_start_us <
+          (int64_t) CONFIG_KC868_MQTT_BATCH_MS * 1000) {
+        continue;
+      }
+    }
+    if (!MqttSend(points, mask, now_us)) {
+      continue; /* the changes stay pending */
+    }
+    for (size_t i = 0; i < kMqttPointCount; ++i) {
+      if (0 != (mask & (1U << i))) {
+        s_published[i] = points[i];
+      }
+    }
+    window_open = false;
+    if (full_pending) {
+      full_pending = false;
+      last_full_us = now_us;
+    }
+  }
+}
+
+void KC868_A16_MqttStart(void) {
+  if (NULL != s_free_buffers) {
+    return;
+  }
+  if (!ipaddr_aton(CONFIG_KC868_MQTT_BROKER, &s_broker) ||
+      !IP_IS_V4(&s_broker)) {
+    ESP_LOGE(TAG_MQTT, "Broker \"%s\" is no IPv4 address",
+             CONFIG_KC868_MQTT_BROKER);
+    return;
+  }
+  s_free_buffers = xQueueCreate(CONFIG_KC868_MQTT_BUFFERS, sizeof(MqttBuffer *));
+  if (NULL == s_free_buffers) {
+    ESP_LOGE(TAG_MQTT, "Failed to create the buffer queue");
+    return;
+  }
+  for (size_t i = 0; i < CONFIG_KC868_MQTT_BUFFERS; ++i) {
+    MqttBuffer *buffer = &s_buffers[i];
+    buffer->message = tcpip_callbackmsg_new(MqttPublishInTcpip, buffer);
+    if (NULL == buffer->message) {
+      ESP_LOGE(TAG_MQTT, "Failed to allocate the tcpip messages");
+      return;
+    }
+    (void) xQueueSend(s_free_buffers, &buffer, 0);
+  }
+
+  s_client_info.client_id = CONFIG_KC868_MQTT_CLIENT_ID;
+  s_client_info.keep_alive = MQTT_KEEP_ALIVE_S;
+  if (pdPASS != xTaskCreatePinnedToCore(MqttTask, "kc868_mqtt",
+                                        MQTT_TASK_STACK_SIZE, NULL,
+                                        CONFIG_KC868_MQTT_TASK_PRIORITY,
+                                        NULL, MQTT_TASK_CORE)) {
+    ESP_LOGE(TAG_MQTT, "Failed to create the publisher task");
+    return;
+  }
+  ESP_LOGI(TAG_MQTT, "Publishing to %s:%d on %s", CONFIG_KC868_MQTT_BROKER,
+           CONFIG_KC868_MQTT_PORT, CONFIG_KC868_MQTT_TOPIC);
+}
+
+void KC868_A16_MqttGetStatistics(KC868_A16_MqttStatistics *statistics) {
+  taskENTER_CRITICAL(&s_mqtt_lock);
+  *statistics = s_statistics;
+  taskEXIT_CRITICAL(&s_mqtt_lock);
+}
+
+#endif /* CONFIG_KC868_MQTT */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef KC868_A16_MQTT_H_
+#define KC868_A16_MQTT_H_
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_mqtt.h
+ *  @brief MQTT telemetry of the I/O points, next to EtherNet/IP
+ *
+ *  Selected with CONFIG_KC868_MQTT. A publisher task below the OpENer task
+ *  samples the points every CONFIG_KC868_MQTT_SAMPLE_MS from the copies
+ *  the OpENer task reads as well, so it never touches the I2C bus or an
+ *  assembly being written:
+ *  - "di": the digital inputs, bit 0 = input 1;
+ *  - "do": the output assembly, bit 0 = relay 1;
+ *  - "ai1" to "ai4": the raw analog inputs, changed by more than
+ *    CONFIG_KC868_MQTT_DEADBAND counts;
+ *  - "io_status": KC868_A16_IoGetStatus();
+ *  - "bus_errors": the failed expander accesses since start.
+ *
+ *  A changed point opens a batch window of CONFIG_KC868_MQTT_BATCH_MS.
+ *  At its end one message on CONFIG_KC868_MQTT_TOPIC carries every point
+ *  that changed meanwhile with a sequence number and the uptime:
+ *  {"seq":12,"t_ms":40210,"di":5,"ai2":1830}. All points are sent after a
+ *  connect, after a lost message and every
+ *  CONFIG_KC868_MQTT_FULL_INTERVAL_S.
+ *
+ *  Messages are QoS 0. Their payloads live in CONFIG_KC868_MQTT_BUFFERS
+ *  fixed buffers, each with a tcpip thread message allocated at start, and
+ *  the lwIP MQTT client copies them into its output ring buffer. With all
+ *  buffers in flight the changes keep accumulating for the next message;
+ *  the publisher never waits for the tcpip thread and never allocates.
+ *  The broker is an IPv4 address, the client reconnects every five
+ *  seconds while the connection is down.
+ */
+
+#if CONFIG_KC868_MQTT
+
+/** @brief Publisher counters since start */
+typedef struct {
+  bool connected;
+  CipUdint connects; /**< connections accepted by the broker */
+  CipUdint messages; /**< messages handed to the MQTT client */
+  CipUdint points; /**< points carried by them */
+  CipUdint busy; /**< batches postponed, all buffers in flight */
+  CipUdint dropped; /**< messages the MQTT client or the tcpip thread refused */
+} KC868_A16_MqttStatistics;
+
+/** @brief Allocate the buffers and start the publisher task
+ *
+ *  Called from ApplicationInitialization(). The task connects once the
+ *  network is up.
+ */
+void KC868_A16_MqttStart(void);
+
+/** @brief Read the counters, safe from any task */
+void KC868_A16_MqttGetStatistics(KC868_A16_MqttStatistics *statistics);
+
+#endif /* CONFIG_KC868_MQTT */
+
+#endif /* KC868_A16_MQTT_H_ */
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_pcnt.h"
+
+#if CONFIG_KC868_PCNT
+
+#include <string.h>
+
+#include "seqlock.h"
+#include "driver/pulse_cnt.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#define PCNT_HIGH_LIMIT  32767
+#define PCNT_LOW_LIMIT   (-32768)
+#define PCNT_WINDOW_US   ((int64_t)CONFIG_KC868_PCNT_FREQUENCY_WINDOW_MS * 1000)
+
+typedef struct {
+  int a_gpio;
+  int b_gpio; /* -1 without quadrature */
+} PcntPins;
+
+static const PcntPins kPcntPins[KC868_A16_PCNT_COUNTERS] = {
+  { CONFIG_KC868_PCNT1_A_GPIO, CONFIG_KC868_PCNT1_B_GPIO },
+  { CONFIG_KC868_PCNT2_A_GPIO, CONFIG_KC868_PCNT2_B_GPIO },
+  { CONFIG_KC868_PCNT3_A_GPIO, CONFIG_KC868_PCNT3_B_GPIO },
+};
+
+static const char *TAG_PCNT = "kc868_pcnt";
+
+static pcnt_unit_handle_t s_units[KC868_A16_PCNT_COUNTERS];
+
+/* Scan task only */
+static KC868_A16_PcntValues s_scan_values;
+static int s_window_count[KC868_A16_PCNT_COUNTERS];
+static int64_t s_window_start_us = 0;
+
+/* Published to the OpENer task, see seqlock.h */
+static KC868_A16_PcntValues s_values;
+static SeqLock s_values_lock;
+
+static esp_err_t AddChannel(pcnt_unit_handle_t unit, int edge_gpio,
+                            int level_gpio, bool count_down_on_rise,
+                            pcnt_channel_handle_t *channel_out) {
+  const pcnt_chan_config_t channel_config = {
+    .edge_gpio_num = edge_gpio,
+    .level_gpio_num = level_gpio,
+  };
+  pcnt_channel_handle_t channel = NULL;
+  esp_err_t ret = pcnt_new_channel(unit, &channel_config, &channel);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  *channel_out = channel;
+  if (level_gpio < 0) {
+    return pcnt_channel_set_edge_action(channel,
+                                        PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                        PCNT_CHANNEL_EDGE_ACTION_HOLD);
+  }
+  /* Four-edge quadrature: each channel counts both edges of its input, the
+   * level of the other one gives the direction */
+  ret = pcnt_channel_set_edge_action(channel,
+                                     count_down_on_rise ?
+                                     PCNT_CHANNEL_EDGE_ACTION_DECREASE :
+                                     PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                     count_down_on_rise ?
+                                     PCNT_CHANNEL_EDGE_ACTION_INCREASE :
+                                     PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  return pcnt_channel_set_level_action(channel,
+                                       PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+                                       PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+}
+
+static esp_err_t StartCounter(size_t index) {
+  const PcntPins *pins = &kPcntPins[index];
+  const pcnt_unit_config_t unit_config = {
+    .high_limit = PCNT_HIGH_LIMIT,
+    .low_limit = PCNT_LOW_LIMIT,
+    .flags.accum_count = true,
+  };
+  pcnt_unit_handle_t unit = NULL;
+  pcnt_channel_handle_t channels[2] = { NULL, NULL };
+  bool enabled = false;
+  esp_err_t ret = pcnt_new_unit(&unit_config, &unit);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+
+#if CONFIG_KC868_PCNT_GLITCH_FILTER_NS > 0
+  const pcnt_glitch_filter_config_t filter_config = {
+    .max_glitch_ns = CONFIG_KC868_PCNT_GLITCH_FILTER_NS,
+  };
+  ret = pcnt_unit_set_glitch_filter(unit, &filter_config);
+#endif
+  if (ret == ESP_OK) {
+    ret = AddChannel(unit, pins->a_gpio, pins->b_gpio, true, &channels[0]);
+  }
+  if (ret == ESP_OK && pins->b_gpio >= 0) {
+    ret = AddChannel(unit, pins->b_gpio, pins->a_gpio, false, &channels[1]);
+  }
+  /* Overflow accumulation needs the limits as watch points */
+  if (ret == ESP_OK) {
+    ret = pcnt_unit_add_watch_point(unit, PCNT_HIGH_LIMIT);
+  }
+  if (ret == ESP_OK) {
+    ret = pcnt_unit_add_watch_point(unit, PCNT_LOW_LIMIT);
+  }
+  if (ret == ESP_OK) {
+    ret = pcnt_unit_enable(unit);
+    enabled = (ret == ESP_OK);
+  }
+  if (ret == ESP_OK) {
+    ret = pcnt_unit_clear_count(unit);
+  }
+  if (ret == ESP_OK) {
+    ret = pcnt_unit_start(unit);
+  }
+  if (ret != ESP_OK) {
+    if (enabled) {
+      pcnt_unit_disable(unit);
+    }
+    for (size_t i = 0; i < 2; ++i) {
+      if (NULL != channels[i]) {
+        pcnt_del_channel(channels[i]);
+      }
+    }
+    pcnt_del_unit(unit);
+    return ret;
+  }
+  s_units[index] = unit;
+  return ESP_OK;
+}
+
+bool KC868_A16_PcntInitialize(void) {
+  bool running = false;
+  s_window_start_us = esp_timer_get_time();
+  for (size_t i = 0; i < KC868_A16_PCNT_COUNTERS; ++i) {
+    if (kPcntPins[i].a_gpio < 0 || NULL != s_units[i]) {
+      running = running || NULL != s_units[i];
+      continue;
+    }
+    esp_err_t ret = StartCounter(i);
+    if (ret != ESP_OK) {
+      ESP_LOGE(TAG_PCNT, "Counter %zu on GPIO%d failed: %s", i + 1,
+               kPcntPins[i].a_gpio, esp_err_to_name(ret));
+      continue;
+    }
+    running = true;
+    if (kPcntPins[i].b_gpio >= 0) {
+      ESP_LOGI(TAG_PCNT, "Counter %zu: quadrature A GPIO%d, B GPIO%d", i + 1,
+               kPcntPins[i].a_gpio, kPcntPins[i].b_gpio);
+    } else {
+      ESP_LOGI(TAG_PCNT, "Counter %zu: pulses on GPIO%d", i + 1,
+               kPcntPins[i].a_gpio);
+    }
+  }
+  return running;
+}
+
+void KC868_A16_PcntSample(int64_t now_us) {
+  for (size_t i = 0; i < KC868_A16_PCNT_COUNTERS; ++i) {
+    int count = 0;
+    if (NULL != s_units[i] && pcnt_unit_get_count(s_units[i], &count) == ESP_OK) {
+      s_scan_values.count[i] = count;
+    }
+  }
+
+  const int64_t elapsed_us = now_us - s_window_start_us;
+  if (elapsed_us >= PCNT_WINDOW_US) {
+    for (size_t i = 0; i < KC868_A16_PCNT_COUNTERS; ++i) {
+      /* Difference of the 32 bit counts also holds across a wrap */
+      int64_t edges = (int32_t)((uint32_t)s_scan_values.count[i] -
+                                (uint32_t)s_window_count[i]);
+      if (edges < 0) {
+        edges = -edges;
+      }
+      s_scan_values.frequency_mhz[i] = (CipUdint)(edges * 1000000000LL /
+                                                  elapsed_us);
+      s_window_count[i] = s_scan_values.count[i];
+    }
+    s_window_start_us = now_us;
+  }
+
+  SeqLockWrite(&s_values_lock, &s_values, &s_scan_values, sizeof(s_values));
+}
+
+bool KC868_A16_PcntGetValues(KC868_A16_PcntValues *values) {
+  KC868_A16_PcntValues copy;
+  if (!SeqLockRead(&s_values_lock, &copy, &s_values, sizeof(copy), NULL)) {
+    return false;
+  }
+  *values = copy;
+  return true;
+}
+
+#endif /* CONFIG_KC868_PCNT */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_PCNT_H_
+#define KC868_A16_PCNT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_pcnt.h
+ *  @brief Pulse counter inputs on the free KC868-A16 GPIOs
+ *
+ *  Selected with CONFIG_KC868_PCNT. Up to three ESP32 PCNT units count edges
+ *  on the direct inputs (HT1-HT3 by default) in hardware, so neither the
+ *  I2C expanders nor the RPI limit the pulse rate. A counter with a B input
+ *  decodes A/B quadrature in four-edge mode and counts up and down; one
+ *  without counts the rising edges of A. The 16 bit hardware counters are
+ *  extended to 32 bits by the driver's overflow accumulation.
+ *
+ *  The I/O scan task samples the counters on every scan and updates the
+ *  frequency once per CONFIG_KC868_PCNT_FREQUENCY_WINDOW_MS.
+ */
+
+#if CONFIG_KC868_PCNT
+
+#define KC868_A16_PCNT_COUNTERS 3
+
+/** @brief State of the pulse counters */
+typedef struct {
+  CipDint count[KC868_A16_PCNT_COUNTERS]; /**< counted edges, wraps around */
+  CipUdint frequency_mhz[KC868_A16_PCNT_COUNTERS]; /**< counted edges per second, in 1/1000 Hz */
+} KC868_A16_PcntValues;
+
+/** @brief Set up the PCNT units of the configured counters
+ *
+ *  @return true if at least one counter runs
+ */
+bool KC868_A16_PcntInitialize(void);
+
+/** @brief Sample the counters, I/O scan task only
+ *
+ *  @param now_us esp_timer_get_time() of the scan
+ */
+void KC868_A16_PcntSample(int64_t now_us);
+
+/** @brief Copy the most recent consistent counter values
+ *
+ *  Same sequence lock scheme as KC868_A16_IoGetInputImage(). Counters that
+ *  are not configured read 0.
+ *
+ *  @return true if values was updated, false if the scan task was writing
+ */
+bool KC868_A16_PcntGetValues(KC868_A16_PcntValues *values);
+
+#endif /* CONFIG_KC868_PCNT */
+
+#endif /* KC868_A16_PCNT_H_ */
@@ -0,0 +1,849 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_peer.h"
+
+#if CONFIG_KC868_PEER
+
+#include <errno.h>
+#include <string.h>
+
+#include "cipidentity.h"
+#include "kc868_a16_io.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "nvs.h"
+
+#define PEER_NVS_NAMESPACE       "kc868"
+#define PEER_NVS_KEY             "peer_config"
+#define PEER_NVS_VERSION         1
+
+#define PEER_TASK_STACK_SIZE     4096
+#define PEER_TASK_CORE           1
+#define PEER_CONNECT_TIMEOUT_MS  2000
+#define PEER_REPLY_TIMEOUT_MS    2000
+/* How soon the task notices a timeout or a new configuration */
+#define PEER_SELECT_TIMEOUT_MS   100
+
+#define PEER_EXPLICIT_PORT       44818
+#define PEER_IO_PORT             2222
+
+/* Encapsulation */
+#define PEER_ENCAP_HEADER_SIZE   24
+#define PEER_ENCAP_MAX_SIZE      256
+#define PEER_COMMAND_REGISTER_SESSION 0x0065
+#define PEER_COMMAND_SEND_RR_DATA     0x006F
+
+/* Common packet format items */
+#define PEER_ITEM_NULL_ADDRESS   0x0000
+#define PEER_ITEM_CONNECTED_DATA 0x00B1
+#define PEER_ITEM_UNCONNECTED_DATA 0x00B2
+#define PEER_ITEM_SOCKADDR_O_TO_T 0x8000
+#define PEER_ITEM_SOCKADDR_T_TO_O 0x8001
+#define PEER_ITEM_SEQUENCED_ADDRESS 0x8002
+#define PEER_SOCKADDR_SIZE       16
+
+/* Connection Manager */
+#define PEER_SERVICE_FORWARD_OPEN  0x54
+#define PEER_SERVICE_FORWARD_CLOSE 0x4E
+#define PEER_SERVICE_REPLY         0x80
+/* 1024 ms ticks, 14 of them for the unconnected request */
+#define PEER_PRIORITY_TIME_TICK    0x0A
+#define PEER_TIMEOUT_TICKS         0x0E
+/* Point to point, scheduled priority, fixed size */
+#define PEER_CONNECTION_PARAMETERS 0x4800
+/* Class 1, cyclic, client */
+#define PEER_TRANSPORT_CLASS_TRIGGER 0x01
+/* Sequence count in front of the data of a Class 1 packet */
+#define PEER_SEQUENCE_COUNT_SIZE   2
+
+/* Heartbeat: item count, sequenced address and connected data items */
+#define PEER_HEARTBEAT_SIZE        (2 + 4 + 8 + 4 + PEER_SEQUENCE_COUNT_SIZE)
+#define PEER_IO_MAX_SIZE           (PEER_HEARTBEAT_SIZE + KC868_A16_PEER_MAX_DATA)
+
+typedef struct __attribute__((packed)) {
+  uint8_t version;
+  KC868_A16_PeerConfig config;
+} PeerNvBlob;
+
+/* The open connection. Set up by the peer task before the timer starts;
+ * afterwards the timer callback and the task share it under s_peer_lock. */
+typedef struct {
+  bool established;
+  CipUdint o_to_t_connection_id;
+  CipUdint t_to_o_connection_id;
+  CipUdint o_to_t_sequence;
+  CipUdint t_to_o_sequence;
+  bool t_to_o_sequence_valid;
+  struct sockaddr_in o_to_t_address;
+  int64_t timeout_us;
+  int64_t deadline_us;
+} PeerLink;
+
+static const char *TAG_PEER = "kc868_peer";
+
+/* Configuration in effect, its successor, the connection and the status,
+ * under s_peer_lock */
+static KC868_A16_PeerConfig s_config;
+static bool s_config_pending = false;
+static PeerLink s_link;
+static KC868_A16_PeerStatus s_status;
+static portMUX_TYPE s_peer_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t s_peer_task = NULL;
+static esp_timer_handle_t s_peer_timer = NULL;
+/* O->T heartbeats, sent by the timer callback only; never closed */
+static int s_tx_socket = -1;
+static CipUint s_connection_serial = 0;
+
+static void PutUint16Le(uint8_t *data, uint16_t value) {
+  data[0] = (uint8_t)value;
+  data[1] = (uint8_t)(value >> 8);
+}
+
+static void PutUint32Le(uint8_t *data, uint32_t value) {
+  PutUint16Le(data, (uint16_t)value);
+  PutUint16Le(data + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t GetUint16Le(const uint8_t *data) {
+  return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static uint32_t GetUint32Le(const uint8_t *data) {
+  return GetUint16Le(data) | ((uint32_t)GetUint16Le(data + 2) << 16);
+}
+
+static void SetDefaultConfig(KC868_A16_PeerConfig *config) {
+  memset(config, 0, sizeof(*config));
+  config->config_point = 151;
+  config->consumed_point = 152;
+  config->produced_point = 103;
+  config->data_size = 2;
+  config->rpi_ms = 10;
+  config->timeout_multiplier = 1;
+  config->local_port = CONFIG_KC868_PEER_LOCAL_PORT;
+}
+
+const char *KC868_A16_PeerValidateConfig(const KC868_A16_PeerConfig *config) {
+  if (0 == config->address) {
+    return NULL; /* off, the rest is kept for the next time */
+  }
+  if (0 == config->config_point || 0 == config->consumed_point ||
+      0 == config->produced_point) {
+    return "connection points must be 1 to 65535";
+  }
+  if (0 == config->data_size || config->data_size > KC868_A16_PEER_MAX_DATA) {
+    return "data_size must be 1 to 32";
+  }
+  if (config->rpi_ms < 2 || config->rpi_ms > 10000) {
+    return "rpi_ms must be 2 to 10000";
+  }
+  if (config->timeout_multiplier > 7) {
+    return "timeout_multiplier must be 0 to 7";
+  }
+  if (0 != config->relay_mask &&
+      (unsigned)config->relay_byte + 2 > config->data_size) {
+    return "relay_byte leaves no word for the relays in data_size";
+  }
+  if (0 == config->local_port || PEER_IO_PORT == config->local_port ||
+      PEER_EXPLICIT_PORT == config->local_port) {
+    return "local_port must not be 0, 2222 or 44818";
+  }
+  return NULL;
+}
+
+void KC868_A16_PeerGetConfig(KC868_A16_PeerConfig *config) {
+  taskENTER_CRITICAL(&s_peer_lock);
+  *config = s_config;
+  taskEXIT_CRITICAL(&s_peer_lock);
+}
+
+static void PostConfig(const KC868_A16_PeerConfig *config) {
+  taskENTER_CRITICAL(&s_peer_lock);
+  s_config = *config;
+  s_config_pending = true;
+  taskEXIT_CRITICAL(&s_peer_lock);
+  if (NULL != s_peer_task) {
+    xTaskNotifyGive(s_peer_task);
+  }
+}
+
+static esp_err_t StoreConfig(const KC868_A16_PeerConfig *config) {
+  PeerNvBlob blob = {
+    .version = PEER_NVS_VERSION,
+    .config = *config,
+  };
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(PEER_NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    return err;
+  }
+  err = nvs_set_blob(handle, PEER_NVS_KEY, &blob, sizeof(blob));
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  return err;
+}
+
+EipStatus KC868_A16_PeerSetConfig(const KC868_A16_PeerConfig *config) {
+  const char *error = KC868_A16_PeerValidateConfig(config);
+  if (NULL != error) {
+    ESP_LOGW(TAG_PEER, "Configuration rejected: %s", error);
+    return kEipStatusError;
+  }
+  PostConfig(config);
+  esp_err_t err = StoreConfig(config);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG_PEER, "Failed to store the configuration: %s",
+             esp_err_to_name(err));
+    return kEipStatusError;
+  }
+  return kEipStatusOk;
+}
+
+static void LoadConfig(void) {
+  KC868_A16_PeerConfig config;
+  SetDefaultConfig(&config);
+  PeerNvBlob blob;
+  size_t length = sizeof(blob);
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(PEER_NVS_NAMESPACE, NVS_READONLY, &handle);
+  if (err == ESP_OK) {
+    err = nvs_get_blob(handle, PEER_NVS_KEY, &blob, &length);
+    nvs_close(handle);
+  }
+  if (err == ESP_OK) {
+    const KC868_A16_PeerConfig stored = blob.config;
+    if (length == sizeof(blob) && blob.version == PEER_NVS_VERSION &&
+        NULL == KC868_A16_PeerValidateConfig(&stored)) {
+      config = stored;
+    } else {
+      ESP_LOGW(TAG_PEER, "Ignoring invalid stored configuration");
+    }
+  }
+  PostConfig(&config);
+}
+
+void KC868_A16_PeerGetStatus(KC868_A16_PeerStatus *status) {
+  taskENTER_CRITICAL(&s_peer_lock);
+  *status = s_status;
+  taskEXIT_CRITICAL(&s_peer_lock);
+}
+
+bool KC868_A16_PeerGetBits(uint32_t *bits) {
+  uint8_t data[KC868_A16_PEER_LOGIC_BITS / 8] = { 0 };
+  taskENTER_CRITICAL(&s_peer_lock);
+  const bool established = s_link.established;
+  memcpy(data, s_status.data,
+         s_status.data_size < sizeof(data) ? s_status.data_size : sizeof(data));
+  taskEXIT_CRITICAL(&s_peer_lock);
+  *bits = GetUint32Le(data);
+  return established;
+}
+
+void KC868_A16_PeerGetRelays(uint16_t *mask, uint16_t *value) {
+  taskENTER_CRITICAL(&s_peer_lock);
+  *mask = s_config.relay_mask;
+  *value = 0;
+  if (0 != s_config.relay_mask &&
+      (unsigned)s_config.relay_byte + 2 <= s_status.data_size) {
+    *value = GetUint16Le(&s_status.data[s_config.relay_byte]);
+  }
+  taskEXIT_CRITICAL(&s_peer_lock);
+}
+
+static void SetState(KC868_A16_PeerState state) {
+  taskENTER_CRITICAL(&s_peer_lock);
+  s_status.state = state;
+  taskEXIT_CRITICAL(&s_peer_lock);
+}
+
+/* Caller holds s_peer_lock. Returns true if the data was not 0 already. */
+static bool LoseLink(KC868_A16_PeerState state) {
+  s_link.established = false;
+  s_status.state = state;
+  bool cleared = false;
+  for (size_t i = 0; i < s_status.data_size; ++i) {
+    cleared = cleared || 0 != s_status.data[i];
+  }
+  memset(s_status.data, 0, sizeof(s_status.data));
+  return cleared;
+}
+
+/* Runs in the esp_timer task every O->T API */
+static void PeerTimerCallback(void *arg) {
+  (void) arg;
+  uint8_t packet[PEER_HEARTBEAT_SIZE];
+  const int64_t now_us = esp_timer_get_time();
+
+  taskENTER_CRITICAL(&s_peer_lock);
+  if (!s_link.established) {
+    taskEXIT_CRITICAL(&s_peer_lock);
+    return;
+  }
+  if (now_us > s_link.deadline_us) {
+    s_status.timeouts++;
+    (void) LoseLink(kKc868PeerStateTimedOut);
+    taskEXIT_CRITICAL(&s_peer_lock);
+    /* Fail safe right away, the task reopens the connection */
+    KC868_A16_IoWakePeer();
+    xTaskNotifyGive(s_peer_task);
+    return;
+  }
+  const struct sockaddr_in address = s_link.o_to_t_address;
+  PutUint16Le(&packet[0], 2);
+  PutUint16Le(&packet[2], PEER_ITEM_SEQUENCED_ADDRESS);
+  PutUint16Le(&packet[4], 8);
+  PutUint32Le(&packet[6], s_link.o_to_t_connection_id);
+  PutUint32Le(&packet[10], ++s_link.o_to_t_sequence);
+  PutUint16Le(&packet[14], PEER_ITEM_CONNECTED_DATA);
+  PutUint16Le(&packet[16], PEER_SEQUENCE_COUNT_SIZE);
+  /* A heartbeat carries no data, its sequence count never advances */
+  PutUint16Le(&packet[18], 0);
+  s_status.heartbeats++;
+  taskEXIT_CRITICAL(&s_peer_lock);
+
+  (void) sendto(s_tx_socket, packet, sizeof(packet), MSG_DONTWAIT,
+                (const struct sockaddr *)&address, sizeof(address));
+}
+
+static bool SendAll(int socket_handle, const uint8_t *data, size_t length) {
+  while (length > 0) {
+    const int sent = send(socket_handle, data, length, 0);
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    length -= (size_t)sent;
+  }
+  return true;
+}
+
+static bool ReceiveAll(int socket_handle, uint8_t *data, size_t length) {
+  while (length > 0) {
+    const int received = recv(socket_handle, data, length, 0);
+    if (received <= 0) {
+      return false;
+    }
+    data += received;
+    length -= (size_t)received;
+  }
+  return true;
+}
+
+static void PutEncapsulationHeader(uint8_t *message, uint16_t command,
+                                   uint16_t length, CipUdint session) {
+  memset(message, 0, PEER_ENCAP_HEADER_SIZE);
+  PutUint16Le(&message[0], command);
+  PutUint16Le(&message[2], length);
+  PutUint32Le(&message[4], session);
+}
+
+/* Sends one encapsulation message and receives its reply; returns the
+ * length of the reply data after the header, -1 on a failure */
+static int Exchange(int socket_handle, uint8_t *message, size_t length) {
+  if (!SendAll(socket_handle, message, length) ||
+      !ReceiveAll(socket_handle, message, PEER_ENCAP_HEADER_SIZE)) {
+    return -1;
+  }
+  const uint16_t data_length = GetUint16Le(&message[2]);
+  if (0 != GetUint32Le(&message[8]) ||
+      data_length > PEER_ENCAP_MAX_SIZE - PEER_ENCAP_HEADER_SIZE ||
+      !ReceiveAll(socket_handle, message + PEER_ENCAP_HEADER_SIZE,
+                  data_length)) {
+    return -1;
+  }
+  return data_length;
+}
+
+static int ConnectExplicit(CipUdint address) {
+  const int socket_handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (socket_handle < 0) {
+    return -1;
+  }
+  const struct sockaddr_in peer = {
+    .sin_family = AF_INET,
+    .sin_port = htons(PEER_EXPLICIT_PORT),
+    .sin_addr.s_addr = address,
+  };
+  /* Not blocking for the connect, to bound the wait for a peer that is off */
+  const int flags = fcntl(socket_handle, F_GETFL, 0);
+  (void) fcntl(socket_handle, F_SETFL, flags | O_NONBLOCK);
+  bool connected = 0 == connect(socket_handle, (const struct sockaddr *)&peer,
+                                sizeof(peer));
+  if (!connected && EINPROGRESS == errno) {
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(socket_handle, &writable);
+    struct timeval timeout = {
+      .tv_sec = PEER_CONNECT_TIMEOUT_MS / 1000,
+      .tv_usec = (PEER_CONNECT_TIMEOUT_MS % 1000) * 1000,
+    };
+    int error = 0;
+    socklen_t error_length = sizeof(error);
+    connected = select(socket_handle + 1, NULL, &writable, NULL, &timeout) > 0 &&
+                0 == getsockopt(socket_handle, SOL_SOCKET, SO_ERROR, &error,
+                                &error_length) &&
+                0 == error;
+  }
+  (void) fcntl(socket_handle, F_SETFL, flags);
+  if (!connected) {
+    close(socket_handle);
+    return -1;
+  }
+  const struct timeval reply_timeout = {
+    .tv_sec = PEER_REPLY_TIMEOUT_MS / 1000,
+    .tv_usec = (PEER_REPLY_TIMEOUT_MS % 1000) * 1000,
+  };
+  const int no_delay = 1;
+  (void) setsockopt(socket_handle, SOL_SOCKET, SO_RCVTIMEO, &reply_timeout,
+                    sizeof(reply_timeout));
+  (void) setsockopt(socket_handle, SOL_SOCKET, SO_SNDTIMEO, &reply_timeout,
+                    sizeof(reply_timeout));
+  (void) setsockopt(socket_handle, IPPROTO_TCP, TCP_NODELAY, &no_delay,
+                    sizeof(no_delay));
+  return socket_handle;
+}
+
+static bool RegisterSession(int socket_handle, CipUdint *session) {
+  uint8_t message[PEER_ENCAP_HEADER_SIZE + 4];
+  PutEncapsulationHeader(message, PEER_COMMAND_REGISTER_SESSION, 4, 0);
+  PutUint16Le(&message[PEER_ENCAP_HEADER_SIZE], 1); /* protocol version */
+  PutUint16Le(&message[PEER_ENCAP_HEADER_SIZE + 2], 0); /* options */
+  if (4 != Exchange(socket_handle, message, sizeof(message)) ||
+      PEER_COMMAND_REGISTER_SESSION != GetUint16Le(&message[0])) {
+    return false;
+  }
+  *session = GetUint32Le(&message[4]);
+  return true;
+}
+
+/* Port segments are not needed, the peer is on the local network */
+static size_t PutLogicalSegment(uint8_t *path, uint8_t segment, CipUint value) {
+  if (value <= UINT8_MAX) {
+    path[0] = segment;
+    path[1] = (uint8_t)value;
+    return 2;
+  }
+  path[0] = (uint8_t)(segment | 0x01); /* 16 bit format */
+  path[1] = 0;
+  PutUint16Le(&path[2], value);
+  return 4;
+}
+
+static size_t PutConnectionPath(uint8_t *path,
+                                const KC868_A16_PeerConfig *config) {
+  size_t length = 0;
+  path[length++] = 0x20; /* class */
+  path[length++] = 0x04; /* Assembly */
+  length += PutLogicalSegment(&path[length], 0x24, config->config_point);
+  length += PutLogicalSegment(&path[length], 0x2C, config->consumed_point);
+  length += PutLogicalSegment(&path[length], 0x2C, config->produced_point);
+  return length;
+}
+
+/* Start of a SendRRData request to the Connection Manager; returns the
+ * offset of the service data */
+static size_t PutConnectionManagerRequest(uint8_t *message, uint8_t service) {
+  size_t offset = PEER_ENCAP_HEADER_SIZE;
+  PutUint32Le(&message[offset], 0); /* interface handle */
+  PutUint16Le(&message[offset + 4], 0); /* timeout */
+  offset += 6;
+  /* Item count and the null address item; the length of the unconnected
+   * data item is filled in by FinishConnectionManagerRequest() */
+  PutUint16Le(&message[offset], 0);
+  PutUint16Le(&message[offset + 2], PEER_ITEM_NULL_ADDRESS);
+  PutUint16Le(&message[offset + 4], 0);
+  PutUint16Le(&message[offset + 6], PEER_ITEM_UNCONNECTED_DATA);
+  offset += 10;
+  message[offset++] = service;
+  message[offset++] = 2; /* path words */
+  message[offset++] = 0x20;
+  message[offset++] = 0x06; /* Connection Manager */
+  message[offset++] = 0x24;
+  message[offset++] = 0x01;
+  message[offset++] = PEER_PRIORITY_TIME_TICK;
+  message[offset++] = PEER_TIMEOUT_TICKS;
+  return offset;
+}
+
+static void FinishConnectionManagerRequest(uint8_t *message, size_t data_end,
+                                           size_t length, uint16_t items,
+                                           CipUdint session) {
+  const size_t item_count_offset = PEER_ENCAP_HEADER_SIZE + 6;
+  const size_t data_offset = item_count_offset + 10;
+  PutEncapsulationHeader(message, PEER_COMMAND_SEND_RR_DATA,
+                         (uint16_t)(length - PEER_ENCAP_HEADER_SIZE), session);
+  PutUint16Le(&message[item_count_offset], items);
+  PutUint16Le(&message[data_offset - 2], (uint16_t)(data_end - data_offset));
+}
+
+/* Finds the unconnected data item and the O->T socket address of a reply */
+static const uint8_t *ParseReplyItems(const uint8_t *message, int length,
+                                      size_t *data_length,
+                                      struct sockaddr_in *o_to_t_address) {
+  const uint8_t *item = message + PEER_ENCAP_HEADER_SIZE + 6;
+  const uint8_t *const end = message + PEER_ENCAP_HEADER_SIZE + length;
+  if (item + 2 > end) {
+    return NULL;
+  }
+  uint16_t count = GetUint16Le(item);
+  item += 2;
+  const uint8_t *data = NULL;
+  while (count-- > 0 && item + 4 <= end) {
+    const uint16_t type = GetUint16Le(item);
+    const uint16_t item_length = GetUint16Le(item + 2);
+    item += 4;
+    if (item + item_length > end) {
+      return NULL;
+    }
+    if (PEER_ITEM_UNCONNECTED_DATA == type) {
+      data = item;
+      *data_length = item_length;
+    } else if (PEER_ITEM_SOCKADDR_O_TO_T == type &&
+               PEER_SOCKADDR_SIZE == item_length && NULL != o_to_t_address) {
+      /* sin_port and sin_addr in network byte order */
+      memcpy(&o_to_t_address->sin_port, item + 2, 2);
+      CipUdint address = 0;
+      memcpy(&address, item + 4, 4);
+      if (0 != address) {
+        o_to_t_address->sin_addr.s_addr = address;
+      }
+    }
+    item += item_length;
+  }
+  return data;
+}
+
+static bool ForwardOpen(int socket_handle, CipUdint session,
+                        const KC868_A16_PeerConfig *config) {
+  uint8_t message[PEER_ENCAP_MAX_SIZE];
+  size_t offset = PutConnectionManagerRequest(message, PEER_SERVICE_FORWARD_OPEN);
+  const CipUdint t_to_o_connection_id = esp_random();
+  const CipUdint rpi_us = (CipUdint)config->rpi_ms * 1000U;
+  s_connection_serial++;
+  PutUint32Le(&message[offset], 0); /* O->T, chosen by the peer */
+  PutUint32Le(&message[offset + 4], t_to_o_connection_id);
+  PutUint16Le(&message[offset + 8], s_connection_serial);
+  PutUint16Le(&message[offset + 10], g_identity.vendor_id);
+  PutUint32Le(&message[offset + 12], g_identity.serial_number);
+  message[offset + 16] = config->timeout_multiplier;
+  memset(&message[offset + 17], 0, 3);
+  PutUint32Le(&message[offset + 20], rpi_us);
+  PutUint16Le(&message[offset + 24],
+              PEER_CONNECTION_PARAMETERS | PEER_SEQUENCE_COUNT_SIZE);
+  PutUint32Le(&message[offset + 26], rpi_us);
+  PutUint16Le(&message[offset + 30], (uint16_t)(PEER_CONNECTION_PARAMETERS |
+                                                (PEER_SEQUENCE_COUNT_SIZE +
+                                                 config->data_size)));
+  message[offset + 32] = PEER_TRANSPORT_CLASS_TRIGGER;
+  const size_t path_length = PutConnectionPath(&message[offset + 34], config);
+  message[offset + 33] = (uint8_t)(path_length / 2);
+  offset += 34 + path_length;
+  const size_t data_end = offset;
+
+  /* Where the peer produces to, the address is the sender's */
+  PutUint16Le(&message[offset], PEER_ITEM_SOCKADDR_T_TO_O);
+  PutUint16Le(&message[offset + 2], PEER_SOCKADDR_SIZE);
+  memset(&message[offset + 4], 0, PEER_SOCKADDR_SIZE);
+  message[offset + 5] = AF_INET; /* sin_family, big endian */
+  message[offset + 6] = (uint8_t)(config->local_port >> 8);
+  message[offset + 7] = (uint8_t)config->local_port;
+  offset += 4 + PEER_SOCKADDR_SIZE;
+  FinishConnectionManagerRequest(message, data_end, offset, 3, session);
+
+  struct sockaddr_in o_to_t_address = {
+    .sin_family = AF_INET,
+    .sin_port = htons(PEER_IO_PORT),
+    .sin_addr.s_addr = config->address,
+  };
+  const int length = Exchange(socket_handle, message, offset);
+  size_t reply_length = 0;
+  const uint8_t *reply = length < 0 ? NULL :
+                         ParseReplyItems(message, length, &reply_length,
+                                         &o_to_t_address);
+  if (NULL == reply || reply_length < 4 ||
+      (PEER_SERVICE_FORWARD_OPEN | PEER_SERVICE_REPLY) != reply[0]) {
+    ESP_LOGW(TAG_PEER, "No Forward_Open reply");
+    return false;
+  }
+  const uint8_t general_status = reply[2];
+  const size_t additional_words = reply[3];
+  if (0 != general_status || reply_length < 4 + additional_words * 2 + 26) {
+    const uint16_t extended_status = (additional_words > 0 && reply_length >= 6) ?
+                                     GetUint16Le(&reply[4]) : 0;
+    ESP_LOGW(TAG_PEER, "Forward_Open refused, status 0x%02x, extended 0x%04x",
+             general_status, extended_status);
+    if (additional_words > 1 && reply_length >= 8) {
+      ESP_LOGW(TAG_PEER, "The peer asks for a connection size of %u",
+               GetUint16Le(&reply[6]));
+    }
+    taskENTER_CRITICAL(&s_peer_lock);
+    s_status.general_status = general_status;
+    s_status.extended_status = extended_status;
+    taskEXIT_CRITICAL(&s_peer_lock);
+    return false;
+  }
+
+  /* Success: IDs, serials, actual packet intervals */
+  const uint8_t *const data = &reply[4 + additional_words * 2];
+  const CipUdint o_to_t_api = GetUint32Le(&data[16]);
+  const CipUdint t_to_o_api = GetUint32Le(&data[20]);
+  taskENTER_CRITICAL(&s_peer_lock);
+  memset(&s_link, 0, sizeof(s_link));
+  s_link.o_to_t_connection_id = GetUint32Le(&data[0]);
+  s_link.t_to_o_connection_id = GetUint32Le(&data[4]);
+  s_link.o_to_t_address = o_to_t_address;
+  s_link.timeout_us = (int64_t)(0 != t_to_o_api ? t_to_o_api : rpi_us) *
+                      (4 << config->timeout_multiplier);
+  s_link.deadline_us = esp_timer_get_time() + s_link.timeout_us;
+  s_link.established = true;
+  s_status.state = kKc868PeerStateEstablished;
+  s_status.o_to_t_connection_id = s_link.o_to_t_connection_id;
+  s_status.t_to_o_connection_id = s_link.t_to_o_connection_id;
+  s_status.data_size = (CipUsint)config->data_size;
+  memset(s_status.data, 0, sizeof(s_status.data));
+  s_status.opens++;
+  s_status.general_status = 0;
+  s_status.extended_status = 0;
+  taskEXIT_CRITICAL(&s_peer_lock);
+
+  (void) esp_timer_start_periodic(s_peer_timer,
+                                  0 != o_to_t_api ? o_to_t_api : rpi_us);
+  ESP_LOGI(TAG_PEER, "Consuming assembly %u of the peer every %u us",
+           config->produced_point, (unsigned)t_to_o_api);
+  return true;
+}
+
+static void ForwardClose(int socket_handle, CipUdint session,
+                         const KC868_A16_PeerConfig *config) {
+  uint8_t message[PEER_ENCAP_MAX_SIZE];
+  size_t offset = PutConnectionManagerRequest(message,
+                                              PEER_SERVICE_FORWARD_CLOSE);
+  PutUint16Le(&message[offset], s_connection_serial);
+  PutUint16Le(&message[offset + 2], g_identity.vendor_id);
+  PutUint32Le(&message[offset + 4], g_identity.serial_number);
+  const size_t path_length = PutConnectionPath(&message[offset + 10], config);
+  message[offset + 8] = (uint8_t)(path_length / 2);
+  message[offset + 9] = 0;
+  offset += 10 + path_length;
+  FinishConnectionManagerRequest(message, offset, offset, 2, session);
+  (void) Exchange(socket_handle, message, offset);
+}
+
+/* Takes one T->O packet */
+static void TakePacket(const uint8_t *packet, size_t length,
+                       const KC868_A16_PeerConfig *config) {
+  if (length < PEER_HEARTBEAT_SIZE ||
+      2 != GetUint16Le(&packet[0]) ||
+      PEER_ITEM_SEQUENCED_ADDRESS != GetUint16Le(&packet[2]) ||
+      8 != GetUint16Le(&packet[4]) ||
+      PEER_ITEM_CONNECTED_DATA != GetUint16Le(&packet[14]) ||
+      PEER_SEQUENCE_COUNT_SIZE + config->data_size != GetUint16Le(&packet[16]) ||
+      (size_t)PEER_HEARTBEAT_SIZE + config->data_size != length) {
+    return;
+  }
+  const CipUdint connection_id = GetUint32Le(&packet[6]);
+  const CipUdint sequence = GetUint32Le(&packet[10]);
+  const uint8_t *const data = &packet[PEER_HEARTBEAT_SIZE];
+  bool changed = false;
+
+  taskENTER_CRITICAL(&s_peer_lock);
+  if (s_link.established && connection_id == s_link.t_to_o_connection_id &&
+      (!s_link.t_to_o_sequence_valid ||
+       (int32_t)(sequence - s_link.t_to_o_sequence) > 0)) {
+    s_link.t_to_o_sequence = sequence;
+    s_link.t_to_o_sequence_valid = true;
+    s_link.deadline_us = esp_timer_get_time() + s_link.timeout_us;
+    s_status.packets++;
+    changed = 0 != memcmp(s_status.data, data, config->data_size);
+    memcpy(s_status.data, data, config->data_size);
+  }
+  taskEXIT_CRITICAL(&s_peer_lock);
+  if (changed) {
+    KC868_A16_IoWakePeer();
+  }
+}
+
+static int OpenConsumingSocket(CipUint port) {
+  const int socket_handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  const struct sockaddr_in address = {
+    .sin_family = AF_INET,
+    .sin_port = htons(port),
+    .sin_addr.s_addr = htonl(INADDR_ANY),
+  };
+  if (socket_handle >= 0 &&
+      0 != bind(socket_handle, (const struct sockaddr *)&address,
+                sizeof(address))) {
+    close(socket_handle);
+    return -1;
+  }
+  return socket_handle;
+}
+
+/* Consumes until the connection times out or the configuration changes */
+static void Consume(int rx_socket, int *explicit_socket,
+                    const KC868_A16_PeerConfig *config) {
+  uint8_t packet[PEER_IO_MAX_SIZE];
+  for (;;) {
+    taskENTER_CRITICAL(&s_peer_lock);
+    const bool stop = s_config_pending || !s_link.established;
+    taskEXIT_CRITICAL(&s_peer_lock);
+    if (stop) {
+      return;
+    }
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(rx_socket, &readable);
+    int highest = rx_socket;
+    if (*explicit_socket >= 0) {
+      FD_SET(*explicit_socket, &readable);
+      highest = *explicit_socket > highest ? *explicit_socket : highest;
+    }
+    struct timeval timeout = {
+      .tv_sec = 0,
+      .tv_usec = PEER_SELECT_TIMEOUT_MS * 1000,
+    };
+    if (select(highest + 1, &readable, NULL, NULL, &timeout) <= 0) {
+      continue;
+    }
+    if (FD_ISSET(rx_socket, &readable)) {
+      struct sockaddr_in sender;
+      socklen_t sender_length = sizeof(sender);
+      const int length = recvfrom(rx_socket, packet, sizeof(packet),
+                                  MSG_DONTWAIT, (struct sockaddr *)&sender,
+                                  &sender_length);
+      if (length > 0 && sender.sin_addr.s_addr == config->address) {
+        TakePacket(packet, (size_t)length, config);
+      }
+    }
+    if (*explicit_socket >= 0 && FD_ISSET(*explicit_socket, &readable)) {
+      /* Nothing is expected; the peer closed the session */
+      uint8_t discard[PEER_ENCAP_HEADER_SIZE];
+      if (recv(*explicit_socket, discard, sizeof(discard), MSG_DONTWAIT) <= 0) {
+        close(*explicit_socket);
+        *explicit_socket = -1;
+      }
+    }
+  }
+}
+
+static void PeerTask(void *arg) {
+  (void) arg;
+  for (;;) {
+    KC868_A16_PeerConfig config;
+    taskENTER_CRITICAL(&s_peer_lock);
+    config = s_config;
+    s_config_pending = false;
+    taskEXIT_CRITICAL(&s_peer_lock);
+
+    if (0 != config.address) {
+      taskENTER_CRITICAL(&s_peer_lock);
+      s_status.state = kKc868PeerStateConnecting;
+      s_status.general_status = 0;
+      s_status.extended_status = 0;
+      taskEXIT_CRITICAL(&s_peer_lock);
+      CipUdint session = 0;
+      int explicit_socket = ConnectExplicit(config.address);
+      const int rx_socket = OpenConsumingSocket(config.local_port);
+      if (rx_socket < 0) {
+        ESP_LOGE(TAG_PEER, "Failed to bind UDP port %u", config.local_port);
+      }
+      if (explicit_socket >= 0 && rx_socket >= 0 &&
+          RegisterSession(explicit_socket, &session) &&
+          ForwardOpen(explicit_socket, session, &config)) {
+        Consume(rx_socket, &explicit_socket, &config);
+        (void) esp_timer_stop(s_peer_timer);
+        taskENTER_CRITICAL(&s_peer_lock);
+        const bool cleared = LoseLink(s_config_pending ?
+                                      kKc868PeerStateConnecting :
+                                      (KC868_A16_PeerState)s_status.state);
+        taskEXIT_CRITICAL(&s_peer_lock);
+        if (cleared) {
+          KC868_A16_IoWakePeer();
+        }
+        if (explicit_socket >= 0) {
+          ForwardClose(explicit_socket, session, &config);
+        }
+      } else {
+        taskENTER_CRITICAL(&s_peer_lock);
+        s_status.state = kKc868PeerStateRefused;
+        s_status.failures++;
+        taskEXIT_CRITICAL(&s_peer_lock);
+      }
+      if (explicit_socket >= 0) {
+        close(explicit_socket);
+      }
+      if (rx_socket >= 0) {
+        close(rx_socket);
+      }
+    } else {
+      SetState(kKc868PeerStateOff);
+    }
+
+    /* Notifications of the closed connection are done with; a new
+     * configuration is still pending and taken right away */
+    (void) ulTaskNotifyTake(pdTRUE, 0);
+    taskENTER_CRITICAL(&s_peer_lock);
+    const bool pending = s_config_pending;
+    const bool off = 0 == s_config.address;
+    taskEXIT_CRITICAL(&s_peer_lock);
+    if (!pending) {
+      (void) ulTaskNotifyTake(pdTRUE, off ? portMAX_DELAY :
+                              pdMS_TO_TICKS(KC868_A16_PEER_RETRY_MS));
+    }
+  }
+}
+
+void KC868_A16_PeerStart(void) {
+  if (NULL != s_peer_task) {
+    return;
+  }
+  LoadConfig();
+  s_connection_serial = (CipUint)esp_random();
+  s_tx_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  const esp_timer_create_args_t timer_args = {
+    .callback = PeerTimerCallback,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "kc868_peer",
+  };
+  if (s_tx_socket < 0 || ESP_OK != esp_timer_create(&timer_args, &s_peer_timer)) {
+    ESP_LOGE(TAG_PEER, "Failed to create the heartbeat socket or timer");
+    return;
+  }
+  if (pdPASS != xTaskCreatePinnedToCore(PeerTask, "kc868_peer",
+                                        PEER_TASK_STACK_SIZE, NULL,
+                                        CONFIG_KC868_PEER_TASK_PRIORITY,
+                                        &s_peer_task, PEER_TASK_CORE)) {
+    ESP_LOGE(TAG_PEER, "Failed to create the peer task");
+    s_peer_task = NULL;
+  }
+}
+
+#endif /* CONFIG_KC868_PEER */
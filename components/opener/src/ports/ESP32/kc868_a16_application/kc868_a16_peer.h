@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_PEER_H_
+#define KC868_A16_PEER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_peer.h
+ *  @brief Originator of one Class 1 connection to another adapter
+ *
+ *  Selected with CONFIG_KC868_PEER. Interlocks between two boards would
+ *  otherwise take the way board, PLC, board. Here the board opens an input
+ *  only connection to an assembly of the peer by itself: a peer task
+ *  registers a session on TCP port 44818 and sends a Forward_Open for
+ *  the configuration point, the heartbeat O->T point and the produced
+ *  T->O point of the configuration. The T->O data is point to point, to
+ *  the local UDP port of the configuration, which the Forward_Open names
+ *  in a T->O socket address item, so port 2222 stays with the stack.
+ *
+ *  An esp_timer sends the O->T heartbeat at the RPI and checks the T->O
+ *  timeout, RPI times 4 << timeout_multiplier. Consumed data wakes the I/O
+ *  scan task, which
+ *  - lets the relays of relay_mask follow the bits of the word at
+ *    relay_byte, below the forcing of the interlock rules, and
+ *  - evaluates the rules again, which take the first 32 bits of the data
+ *    and the connection state as operands, see kc868_a16_logic.h.
+ *  A peer reaction thus takes one production of the peer and one I/O
+ *  scan, without the PLC in the path.
+ *
+ *  While the connection is down the consumed data reads 0: the mapped
+ *  relays are off and the rule operands false, the fail safe state of an
+ *  interlock. A refused or timed out connection is opened again every
+ *  KC868_A16_PEER_RETRY_MS.
+ *
+ *  The configuration is stored in NVS and read and written through
+ *  GET/POST /api/peer. A new configuration closes the connection with a
+ *  Forward_Close and opens the new one.
+ */
+
+#if CONFIG_KC868_PEER
+
+/** Largest T->O data, without the sequence count */
+#define KC868_A16_PEER_MAX_DATA  32
+/** Bits of the consumed data the interlock rules can take */
+#define KC868_A16_PEER_LOGIC_BITS 32
+/** Pause before a refused or lost connection is opened again */
+#define KC868_A16_PEER_RETRY_MS  1000
+
+/** @brief Connection to the peer, fields named as in the web API */
+typedef struct {
+  CipUdint address; /**< peer IPv4 address, network byte order, 0 = off */
+  CipUint config_point; /**< configuration assembly of the peer */
+  CipUint consumed_point; /**< heartbeat O->T point, input only */
+  CipUint produced_point; /**< T->O assembly the board consumes */
+  CipUint data_size; /**< T->O bytes without the sequence count, 1 to KC868_A16_PEER_MAX_DATA */
+  CipUint rpi_ms; /**< of both directions */
+  CipUsint timeout_multiplier; /**< 0 to 7: timeout of 4 << n RPIs */
+  CipUsint relay_byte; /**< data offset of the word the relays follow */
+  CipWord relay_mask; /**< relays that follow the peer, bit n relay n+1 */
+  CipUint local_port; /**< UDP port the peer produces to, not 2222 */
+} KC868_A16_PeerConfig;
+
+typedef enum {
+  kKc868PeerStateOff = 0, /**< no peer configured */
+  kKc868PeerStateConnecting = 1, /**< session or Forward_Open in progress */
+  kKc868PeerStateEstablished = 2, /**< consuming the peer's data */
+  kKc868PeerStateRefused = 3, /**< no session or Forward_Open, see the status codes */
+  kKc868PeerStateTimedOut = 4, /**< no data within the timeout */
+} KC868_A16_PeerState;
+
+/** @brief State and counters since boot, fields named as in the web API */
+typedef struct {
+  CipUsint state; /**< KC868_A16_PeerState */
+  CipUsint general_status; /**< of a refused Forward_Open, 0 if the peer did not answer */
+  CipUint extended_status; /**< of a refused Forward_Open, 0 if none */
+  CipUdint o_to_t_connection_id;
+  CipUdint t_to_o_connection_id;
+  CipUdint opens; /**< Forward_Opens accepted */
+  CipUdint failures; /**< attempts refused or not answered */
+  CipUdint timeouts; /**< established connections that timed out */
+  CipUdint packets; /**< T->O packets taken */
+  CipUdint heartbeats; /**< O->T packets sent */
+  CipUsint data_size; /**< bytes in data */
+  EipUint8 data[KC868_A16_PEER_MAX_DATA]; /**< last consumed data, 0 while down */
+} KC868_A16_PeerStatus;
+
+/** @brief Load the configuration and start the peer task
+ *
+ *  Called from ApplicationInitialization(). Safe to call more than once,
+ *  only the first call has an effect.
+ */
+void KC868_A16_PeerStart(void);
+
+/** @brief Copy the configuration in effect */
+void KC868_A16_PeerGetConfig(KC868_A16_PeerConfig *config);
+
+/** @brief Check a configuration without applying it
+ *
+ *  @return NULL if it is valid, else a description of the error
+ */
+const char *KC868_A16_PeerValidateConfig(const KC868_A16_PeerConfig *config);
+
+/** @brief Apply a valid configuration and store it in NVS
+ *
+ *  May be called from any task, not from an interrupt.
+ *
+ *  @return kEipStatusOk, or kEipStatusError if the configuration is invalid
+ *          or could not be stored; an invalid one is not applied
+ */
+EipStatus KC868_A16_PeerSetConfig(const KC868_A16_PeerConfig *config);
+
+/** @brief Read the state and the counters, safe from any task */
+void KC868_A16_PeerGetStatus(KC868_A16_PeerStatus *status);
+
+/** @brief First KC868_A16_PEER_LOGIC_BITS bits of the consumed data
+ *
+ *  Safe from any task.
+ *
+ *  @param bits receives bit n of the data in bit n, 0 while down
+ *  @return true while the connection is established
+ */
+bool KC868_A16_PeerGetBits(uint32_t *bits);
+
+/** @brief Relays that follow the peer and their state
+ *
+ *  Safe from any task.
+ *
+ *  @param mask receives relay_mask
+ *  @param value receives the bits of the relay word, 0 while down
+ */
+void KC868_A16_PeerGetRelays(uint16_t *mask, uint16_t *value);
+
+#endif /* CONFIG_KC868_PEER */
+
+#endif /* KC868_A16_PEER_H_ */
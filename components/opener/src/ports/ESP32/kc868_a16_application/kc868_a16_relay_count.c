@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_relay_count.h"
+
+#if CONFIG_KC868_RELAY_COUNTERS
+
+#include <string.h>
+
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "endianconv.h"
+#include "enipmessage.h"
+#include "opener_api.h"
+#include "overload_governor.h"
+#include "trace.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+
+#define RELAY_COUNT_NVS_NAMESPACE  "kc868"
+#define RELAY_COUNT_NVS_KEY        "relay_count"
+#define RELAY_COUNT_NVS_VERSION    1
+
+#define RELAY_COUNT_TASK_STACK_SIZE 3072
+#define RELAY_COUNT_TASK_PRIORITY   (tskIDLE_PRIORITY + 1)
+/* A shutdown waits this long for a write in progress */
+#define RELAY_COUNT_SHUTDOWN_WAIT_MS 100
+
+typedef struct __attribute__((packed)) {
+  uint16_t version;
+  uint16_t relay_count;
+  uint32_t counts[KC868_A16_OUTPUT_COUNT];
+  uint32_t crc; /**< of all members above */
+} RelayCountNvBlob;
+
+static const char *TAG_RELAY_COUNT = "kc868_relay_count";
+
+/* Incremented by the scan task, read and reset by any task */
+static uint32_t s_counts[KC868_A16_OUTPUT_COUNT];
+/* Closings since the last write, and a reset that is not written yet */
+static uint32_t s_unsaved = 0;
+static bool s_reset_pending = false;
+
+static TaskHandle_t s_writer_task = NULL;
+/* One write at a time: the writer task, a reset and the shutdown handler */
+static SemaphoreHandle_t s_write_lock = NULL;
+
+static const CipUint kRelayCounterCountAttribute = KC868_A16_OUTPUT_COUNT;
+
+static uint32_t RelayCountCrc(const RelayCountNvBlob *blob) {
+  return esp_rom_crc32_le(0, (const uint8_t *)blob,
+                          offsetof(RelayCountNvBlob, crc));
+}
+
+static void LoadCounts(void) {
+  RelayCountNvBlob blob;
+  size_t length = sizeof(blob);
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(RELAY_COUNT_NVS_NAMESPACE, NVS_READONLY, &handle);
+  if (err == ESP_OK) {
+    err = nvs_get_blob(handle, RELAY_COUNT_NVS_KEY, &blob, &length);
+    nvs_close(handle);
+  }
+  if (err == ESP_ERR_NVS_NOT_FOUND) {
+    ESP_LOGI(TAG_RELAY_COUNT, "No stored relay counts, counting from 0");
+    return;
+  }
+  if (err != ESP_OK || length != sizeof(blob) ||
+      blob.version != RELAY_COUNT_NVS_VERSION ||
+      blob.relay_count != KC868_A16_OUTPUT_COUNT ||
+      blob.crc != RelayCountCrc(&blob)) {
+    ESP_LOGW(TAG_RELAY_COUNT, "Ignoring invalid stored relay counts");
+    return;
+  }
+  for (size_t relay = 0; relay < KC868_A16_OUTPUT_COUNT; ++relay) {
+    __atomic_store_n(&s_counts[relay], blob.counts[relay], __ATOMIC_RELAXED);
+  }
+  ESP_LOGI(TAG_RELAY_COUNT, "Loaded the relay counts");
+}
+
+static EipStatus WriteCounts(TickType_t wait) {
+  if (NULL == s_write_lock || pdTRUE != xSemaphoreTake(s_write_lock, wait)) {
+    return kEipStatusError;
+  }
+  /* Closings counted during the write are left for the next one */
+  const uint32_t unsaved = __atomic_exchange_n(&s_unsaved, 0, __ATOMIC_RELAXED);
+  const bool reset = __atomic_exchange_n(&s_reset_pending, false,
+                                         __ATOMIC_RELAXED);
+  if (0 == unsaved && !reset) {
+    xSemaphoreGive(s_write_lock);
+    return kEipStatusOk;
+  }
+
+  RelayCountNvBlob blob = {
+    .version = RELAY_COUNT_NVS_VERSION,
+    .relay_count = KC868_A16_OUTPUT_COUNT,
+  };
+  uint32_t counts[KC868_A16_OUTPUT_COUNT];
+  (void)KC868_A16_RelayCountGet(counts);
+  memcpy(blob.counts, counts, sizeof(blob.counts));
+  blob.crc = RelayCountCrc(&blob);
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(RELAY_COUNT_NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err == ESP_OK) {
+    err = nvs_set_blob(handle, RELAY_COUNT_NVS_KEY, &blob, sizeof(blob));
+    if (err == ESP_OK) {
+      err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG_RELAY_COUNT, "Failed to store the relay counts: %s",
+             esp_err_to_name(err));
+    __atomic_fetch_add(&s_unsaved, unsaved, __ATOMIC_RELAXED);
+    if (reset) {
+      __atomic_store_n(&s_reset_pending, true, __ATOMIC_RELAXED);
+    }
+  }
+  xSemaphoreGive(s_write_lock);
+  return (err == ESP_OK) ? kEipStatusOk : kEipStatusError;
+}
+
+/* Woken by a reset, otherwise once per interval */
+static void RelayCountTask(void *arg) {
+  (void) arg;
+  const TickType_t interval = pdMS_TO_TICKS(
+    (uint32_t)CONFIG_KC868_RELAY_COUNTER_FLUSH_MIN * 60U * 1000U);
+  while (true) {
+    (void)ulTaskNotifyTake(pdTRUE, interval);
+    /* The counts wait in RAM for the next interval while the stack is
+     * overloaded, a reset is written anyway */
+    if (OverloadGovernorIsShedding(kOverloadStageNvWrites) &&
+        !__atomic_load_n(&s_reset_pending, __ATOMIC_RELAXED)) {
+      continue;
+    }
+    (void)WriteCounts(portMAX_DELAY);
+  }
+}
+
+static void RelayCountShutdown(void) {
+  (void)WriteCounts(pdMS_TO_TICKS(RELAY_COUNT_SHUTDOWN_WAIT_MS));
+}
+
+void KC868_A16_RelayCountInitialize(void) {
+  if (NULL != s_write_lock) {
+    return;
+  }
+  LoadCounts();
+  s_write_lock = xSemaphoreCreateMutex();
+  if (NULL == s_write_lock) {
+    ESP_LOGE(TAG_RELAY_COUNT, "Failed to create the write lock, counts are "
+             "not stored");
+    return;
+  }
+  if (pdPASS != xTaskCreate(RelayCountTask, "kc868_relay_cnt",
+                            RELAY_COUNT_TASK_STACK_SIZE, NULL,
+                            RELAY_COUNT_TASK_PRIORITY, &s_writer_task)) {
+    ESP_LOGE(TAG_RELAY_COUNT, "Failed to create the writer task");
+    s_writer_task = NULL;
+  }
+  if (ESP_OK != esp_register_shutdown_handler(RelayCountShutdown)) {
+    ESP_LOGW(TAG_RELAY_COUNT, "Counts are not stored at esp_restart()");
+  }
+}
+
+void KC868_A16_RelayCountAdd(uint16_t closed) {
+  if (0 == closed) {
+    return;
+  }
+  __atomic_fetch_add(&s_unsaved, (uint32_t)__builtin_popcount(closed),
+                     __ATOMIC_RELAXED);
+  while (0 != closed) {
+    const unsigned relay = (unsigned)__builtin_ctz(closed);
+    __atomic_fetch_add(&s_counts[relay], 1, __ATOMIC_RELAXED);
+    closed &= (uint16_t)(closed - 1u);
+  }
+}
+
+uint32_t KC868_A16_RelayCountGet(uint32_t counts[KC868_A16_OUTPUT_COUNT]) {
+  for (size_t relay = 0; relay < KC868_A16_OUTPUT_COUNT; ++relay) {
+    counts[relay] = __atomic_load_n(&s_counts[relay], __ATOMIC_RELAXED);
+  }
+  return __atomic_load_n(&s_unsaved, __ATOMIC_RELAXED);
+}
+
+void KC868_A16_RelayCountReset(uint16_t relays) {
+  for (size_t relay = 0; relay < KC868_A16_OUTPUT_COUNT; ++relay) {
+    if (relays & (1u << relay)) {
+      __atomic_store_n(&s_counts[relay], 0, __ATOMIC_RELAXED);
+    }
+  }
+  __atomic_store_n(&s_reset_pending, true, __ATOMIC_RELAXED);
+  if (NULL != s_writer_task) {
+    xTaskNotifyGive(s_writer_task);
+  }
+}
+
+EipStatus KC868_A16_RelayCountFlush(void) {
+  return WriteCounts(portMAX_DELAY);
+}
+
+static void EncodeRelayCounts(const void *const data,
+                              ENIPMessage *const outgoing_message) {
+  (void) data;
+  uint32_t counts[KC868_A16_OUTPUT_COUNT];
+  (void)KC868_A16_RelayCountGet(counts);
+  for (size_t relay = 0; relay < KC868_A16_OUTPUT_COUNT; ++relay) {
+    AddDintToMessage(counts[relay], outgoing_message);
+  }
+}
+
+static void EncodeRelayCountUnsaved(const void *const data,
+                                    ENIPMessage *const outgoing_message) {
+  (void) data;
+  AddDintToMessage(__atomic_load_n(&s_unsaved, __ATOMIC_RELAXED),
+                   outgoing_message);
+}
+
+static EipStatus RelayCounterResetService(
+  CipInstance *const instance,
+  CipMessageRouterRequest *const message_router_request,
+  CipMessageRouterResponse *const message_router_response,
+  const struct sockaddr *originator_address,
+  const CipSessionHandle encapsulation_session) {
+  (void) instance;
+  (void) originator_address;
+  (void) encapsulation_session;
+
+  ClearENIPMessage(&message_router_response->message);
+  message_router_response->reply_service =
+    (0x80 | message_router_request->service);
+  message_router_response->size_of_additional_status = 0;
+  if (message_router_request->request_data_size < 2) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
+  if (message_router_request->request_data_size > 2) {
+    message_router_response->general_status = kCipErrorTooMuchData;
+    return kEipStatusOkSend;
+  }
+  const CipOctet *data = message_router_request->data;
+  const CipWord relays = GetWordFromMessage(&data);
+  if (0 == relays) {
+    message_router_response->general_status = kCipErrorInvalidParameter;
+    return kEipStatusOkSend;
+  }
+  KC868_A16_RelayCountReset(relays);
+  message_router_response->general_status = kCipErrorSuccess;
+  return kEipStatusOkSend;
+}
+
+EipStatus KC868_A16_RelayCountCreateCipObject(void) {
+  CipClass *relay_counter_class = NULL;
+
+  if ((relay_counter_class = CreateCipClass(kKc868RelayCounterClassCode,
+                                            7, /* # class attributes */
+                                            7, /* # highest class attribute number */
+                                            2, /* # class services */
+                                            3, /* # instance attributes */
+                                            3, /* # highest instance attribute number */
+                                            2, /* # instance services */
+                                            1, /* # instances */
+                                            "Relay Counter",
+                                            1, /* # class revision */
+                                            NULL /* # function pointer for initialization */
+                                            )) == 0) {
+    OPENER_TRACE_ERR("Relay counter: failed to create the CIP object\n");
+    return kEipStatusError;
+  }
+
+  CipInstance *instance = GetCipInstance(relay_counter_class, 1);
+  InsertAttribute(instance, 1, kCipUint, EncodeCipUint, NULL,
+                  (void *)&kRelayCounterCountAttribute, kGetableSingleAndAll);
+  /* The encoders read the counts themselves */
+  InsertAttribute(instance, 2, kCipAny, EncodeRelayCounts, NULL,
+                  s_counts, kGetableSingleAndAll);
+  InsertAttribute(instance, 3, kCipUdint, EncodeRelayCountUnsaved, NULL,
+                  &s_unsaved, kGetableSingleAndAll);
+
+  InsertService(relay_counter_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(relay_counter_class, kKc868RelayCounterResetService,
+                &RelayCounterResetService, "Reset");
+
+  return kEipStatusOk;
+}
+
+#endif /* CONFIG_KC868_RELAY_COUNTERS */
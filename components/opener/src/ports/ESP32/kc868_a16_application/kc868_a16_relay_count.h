@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_RELAY_COUNT_H_
+#define KC868_A16_RELAY_COUNT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "kc868_a16_io.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_relay_count.h
+ *  @brief Actuation counters of the relays
+ *
+ *  Selected with CONFIG_KC868_RELAY_COUNTERS. The I/O scan task counts every
+ *  closing of a relay from the port values it wrote to the output
+ *  expanders, so a relay is counted when it switched and not when an image
+ *  asked for it; no bus access is added. One closing is one switching cycle
+ *  of the relay's rated life.
+ *
+ *  The counts are kept in RAM and written to NVS as one record every
+ *  CONFIG_KC868_RELAY_COUNTER_FLUSH_MIN minutes if they changed, and before
+ *  a reset through the Identity object or esp_restart(). A power loss loses
+ *  the closings since the last write. The NVS is log-structured, each write
+ *  of the record lands on the next free entry, so the writes are spread over
+ *  the partition.
+ *
+ *  The vendor specific Relay Counter object (class 0x6A) and the web API
+ *  read the counts; its Reset service, and the web API, start the counts of
+ *  replaced relays over.
+ */
+
+#if CONFIG_KC868_RELAY_COUNTERS
+
+/** @brief Relay Counter object class code (vendor specific) */
+static const CipUint kKc868RelayCounterClassCode = 0x6AU;
+
+/** @brief Reset service of the Relay Counter object
+ *
+ *  Request: WORD of the relays to start over, bit 0 = Y01, at least one.
+ */
+static const CipUsint kKc868RelayCounterResetService = 0x4BU;
+
+/** @brief Load the stored counts and start the writer, before the scan task */
+void KC868_A16_RelayCountInitialize(void);
+
+/** @brief Count closed relays, scan task only
+ *
+ *  @param closed relays that switched on with the last write, bit 0 = Y01
+ */
+void KC868_A16_RelayCountAdd(uint16_t closed);
+
+/** @brief Copy the counts, any task
+ *
+ *  @param counts receives the closings of each relay, index 0 = Y01
+ *  @return closings since the last write to NVS
+ */
+uint32_t KC868_A16_RelayCountGet(uint32_t counts[KC868_A16_OUTPUT_COUNT]);
+
+/** @brief Start the counts of relays over, any task
+ *
+ *  The record is written by the writer task shortly after.
+ *
+ *  @param relays relays to reset, bit 0 = Y01
+ */
+void KC868_A16_RelayCountReset(uint16_t relays);
+
+/** @brief Write the counts now if they changed, before a planned reset
+ *
+ *  Takes milliseconds and stalls both cores, never from the scan task.
+ *
+ *  @return kEipStatusOk: stored or nothing to store
+ */
+EipStatus KC868_A16_RelayCountFlush(void);
+
+/** @brief Create the Relay Counter object, in ApplicationInitialization() */
+EipStatus KC868_A16_RelayCountCreateCipObject(void);
+
+#endif /* CONFIG_KC868_RELAY_COUNTERS */
+
+#endif /* KC868_A16_RELAY_COUNT_H_ */
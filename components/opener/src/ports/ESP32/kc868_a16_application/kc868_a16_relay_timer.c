@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_relay_timer.h"
+
+#if CONFIG_KC868_RELAY_TIMERS
+
+#include "kc868_a16_application.h"
+#include "kc868_a16_io.h"
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "endianconv.h"
+#include "enipmessage.h"
+#include "opener_api.h"
+#include "trace.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+  KC868_A16_RelayCommand command;
+  int64_t time_us; /**< esp_timer time of the request plus the command time */
+} RelayTimerCommand;
+
+/* Posted by the OpENer task, taken by the scan task */
+static RelayTimerCommand s_posted[KC868_A16_OUTPUT_COUNT];
+static uint16_t s_posted_relays = 0;
+static portMUX_TYPE s_posted_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Scan task only */
+static int64_t s_deadline_us[KC868_A16_OUTPUT_COUNT];
+static uint16_t s_deadline_relays = 0;
+static uint16_t s_deadline_value = 0;
+static uint16_t s_hold_relays = 0;
+static uint16_t s_hold_value = 0;
+
+/* Attributes, stored by the scan task in one write */
+static CipWord s_pending_attribute = 0;
+static CipWord s_held_attribute = 0;
+
+static const CipUint kRelayTimerCountAttribute = KC868_A16_OUTPUT_COUNT;
+
+static void RelayTimerPublish(void) {
+  __atomic_store_n(&s_pending_attribute, s_deadline_relays, __ATOMIC_RELAXED);
+  __atomic_store_n(&s_held_attribute, s_hold_relays, __ATOMIC_RELAXED);
+}
+
+static void RelayTimerExecute(size_t relay, const RelayTimerCommand *command) {
+  const uint16_t bit = (uint16_t)(1u << relay);
+  s_deadline_relays &= (uint16_t)~bit;
+  switch (command->command) {
+    case kKc868RelayCommandPulse:
+      s_hold_relays |= bit;
+      s_hold_value |= bit;
+      s_deadline_value &= (uint16_t)~bit;
+      break;
+    case kKc868RelayCommandOnDelay:
+      s_deadline_value |= bit;
+      break;
+    case kKc868RelayCommandOffDelay:
+      s_deadline_value &= (uint16_t)~bit;
+      break;
+    default:
+      s_hold_relays &= (uint16_t)~bit;
+      return;
+  }
+  s_deadline_us[relay] = command->time_us;
+  s_deadline_relays |= bit;
+}
+
+int64_t KC868_A16_RelayTimerRun(int64_t now_us, bool *changed) {
+  const uint16_t hold_relays = s_hold_relays;
+  const uint16_t hold_value = s_hold_value;
+
+  RelayTimerCommand posted[KC868_A16_OUTPUT_COUNT];
+  taskENTER_CRITICAL(&s_posted_lock);
+  const uint16_t posted_relays = s_posted_relays;
+  for (size_t relay = 0; relay < KC868_A16_OUTPUT_COUNT; ++relay) {
+    if (posted_relays & (1u << relay)) {
+      posted[relay] = s_posted[relay];
+    }
+  }
+  s_posted_relays = 0;
+  taskEXIT_CRITICAL(&s_posted_lock);
+  for (size_t relay = 0; relay < KC868_A16_OUTPUT_COUNT; ++relay) {
+    if (posted_relays & (1u << relay)) {
+      RelayTimerExecute(relay, &posted[relay]);
+    }
+  }
+
+  int64_t next_us = INT64_MAX;
+  for (size_t relay = 0; relay < KC868_A16_OUTPUT_COUNT; ++relay) {
+    const uint16_t bit = (uint16_t)(1u << relay);
+    if (0 == (s_deadline_relays & bit)) {
+      continue;
+    }
+    if (now_us - s_deadline_us[relay] >= 0) {
+      s_deadline_relays &= (uint16_t)~bit;
+      s_hold_relays |= bit;
+      s_hold_value = (uint16_t)((s_hold_value & ~bit) |
+                                (s_deadline_value & bit));
+    } else if (s_deadline_us[relay] < next_us) {
+      next_us = s_deadline_us[relay];
+    }
+  }
+
+  if (0 != posted_relays || hold_relays != s_hold_relays ||
+      hold_value != s_hold_value) {
+    *changed = true;
+  }
+  RelayTimerPublish();
+  return next_us;
+}
+
+uint16_t KC868_A16_RelayTimerApply(uint16_t outputs) {
+  return (uint16_t)((outputs & ~s_hold_relays) |
+                    (s_hold_value & s_hold_relays));
+}
+
+void KC868_A16_RelayTimerRelease(uint16_t relays) {
+  if (0 == (s_hold_relays & relays)) {
+    return;
+  }
+  s_hold_relays &= (uint16_t)~relays;
+  RelayTimerPublish();
+}
+
+void KC868_A16_RelayTimerCancel(void) {
+  taskENTER_CRITICAL(&s_posted_lock);
+  s_posted_relays = 0;
+  taskEXIT_CRITICAL(&s_posted_lock);
+  s_deadline_relays = 0;
+  s_hold_relays = 0;
+  RelayTimerPublish();
+}
+
+static EipStatus RelayTimerStartService(
+  CipInstance *const instance,
+  CipMessageRouterRequest *const message_router_request,
+  CipMessageRouterResponse *const message_router_response,
+  const struct sockaddr *originator_address,
+  const CipSessionHandle encapsulation_session) {
+  (void) instance;
+  (void) originator_address;
+  (void) encapsulation_session;
+
+  ClearENIPMessage(&message_router_response->message);
+  message_router_response->reply_service =
+    (0x80 | message_router_request->service);
+  message_router_response->size_of_additional_status = 0;
+  const size_t size = message_router_request->request_data_size;
+  if (size < KC868_A16_RELAY_COMMAND_SIZE ||
+      0 != size % KC868_A16_RELAY_COMMAND_SIZE) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
+  if (size > KC868_A16_OUTPUT_COUNT * KC868_A16_RELAY_COMMAND_SIZE) {
+    message_router_response->general_status = kCipErrorTooMuchData;
+    return kEipStatusOkSend;
+  }
+  /* The exclusive owner set the relays to their safe state */
+  if (KC868_A16_ApplicationOutputsOwned() &&
+      !KC868_A16_ApplicationOutputsRunning()) {
+    message_router_response->general_status = kCipErrorObjectStateConflict;
+    return kEipStatusOkSend;
+  }
+
+  const int64_t posted_us = esp_timer_get_time();
+  RelayTimerCommand commands[KC868_A16_OUTPUT_COUNT];
+  uint16_t relays = 0;
+  const CipOctet *data = message_router_request->data;
+  for (size_t offset = 0; offset < size;
+       offset += KC868_A16_RELAY_COMMAND_SIZE) {
+    const CipUsint relay = GetUsintFromMessage(&data);
+    const CipUsint command = GetUsintFromMessage(&data);
+    const CipUdint time_ms = GetUdintFromMessage(&data);
+    if (relay < 1 || relay > KC868_A16_OUTPUT_COUNT ||
+        command > kKc868RelayCommandOffDelay ||
+        time_ms > KC868_A16_RELAY_COMMAND_MAX_MS ||
+        (kKc868RelayCommandPulse == command && 0 == time_ms)) {
+      message_router_response->general_status = kCipErrorInvalidParameter;
+      return kEipStatusOkSend;
+    }
+    commands[relay - 1].command = (KC868_A16_RelayCommand)command;
+    commands[relay - 1].time_us = posted_us + (int64_t)time_ms * 1000;
+    relays |= (uint16_t)(1u << (relay - 1));
+  }
+
+  taskENTER_CRITICAL(&s_posted_lock);
+  for (size_t relay = 0; relay < KC868_A16_OUTPUT_COUNT; ++relay) {
+    if (relays & (1u << relay)) {
+      s_posted[relay] = commands[relay];
+    }
+  }
+  s_posted_relays |= relays;
+  taskEXIT_CRITICAL(&s_posted_lock);
+  KC868_A16_IoWakeRelayTimers();
+
+  message_router_response->general_status = kCipErrorSuccess;
+  return kEipStatusOkSend;
+}
+
+EipStatus KC868_A16_RelayTimerCreateCipObject(void) {
+  CipClass *relay_timer_class = NULL;
+
+  if ((relay_timer_class = CreateCipClass(kKc868RelayTimerClassCode,
+                                          7, /* # class attributes */
+                                          7, /* # highest class attribute number */
+                                          2, /* # class services */
+                                          3, /* # instance attributes */
+                                          3, /* # highest instance attribute number */
+                                          2, /* # instance services */
+                                          1, /* # instances */
+                                          "Relay Timer",
+                                          1, /* # class revision */
+                                          NULL /* # function pointer for initialization */
+                                          )) == 0) {
+    OPENER_TRACE_ERR("Relay timer: failed to create the CIP object\n");
+    return kEipStatusError;
+  }
+
+  CipInstance *instance = GetCipInstance(relay_timer_class, 1);
+  InsertAttribute(instance, 1, kCipUint, EncodeCipUint, NULL,
+                  (void *)&kRelayTimerCountAttribute, kGetableSingleAndAll);
+  InsertAttribute(instance, 2, kCipWord, EncodeCipWord, NULL,
+                  &s_pending_attribute, kGetableSingleAndAll);
+  InsertAttribute(instance, 3, kCipWord, EncodeCipWord, NULL,
+                  &s_held_attribute, kGetableSingleAndAll);
+
+  InsertService(relay_timer_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(relay_timer_class, kKc868RelayTimerStartService,
+                &RelayTimerStartService, "Start");
+
+  return kEipStatusOk;
+}
+
+#endif /* CONFIG_KC868_RELAY_TIMERS */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_RELAY_TIMER_H_
+#define KC868_A16_RELAY_TIMER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_relay_timer.h
+ *  @brief Locally timed relay commands
+ *
+ *  Selected with CONFIG_KC868_RELAY_TIMERS. The Start service of the
+ *  vendor specific Relay Timer object (class 0x69) takes a list of
+ *  commands, each switching one relay now and/or after a time in
+ *  milliseconds. The I/O scan task executes them from a deadline per relay,
+ *  woken by a one-shot esp_timer at the nearest one, so a 250 ms pulse is
+ *  250 ms at the relay, measured from the request and not from the RPI or
+ *  the PLC scan.
+ *
+ *  A command acts like a write of the relay at its time: the relay holds
+ *  the state it set until the output image changes that relay or another
+ *  command takes it over. Logic rules still force their relays on top.
+ *  Leaving the run mode cancels all commands, the safe state applies.
+ *
+ *  The scan task functions take the posted commands, the Start service runs
+ *  in the OpENer task.
+ */
+
+#if CONFIG_KC868_RELAY_TIMERS
+
+/** @brief Relay Timer object class code (vendor specific) */
+static const CipUint kKc868RelayTimerClassCode = 0x69U;
+
+/** @brief Start service of the Relay Timer object
+ *
+ *  Request: one or more commands of USINT relay (1-16), USINT
+ *  KC868_A16_RelayCommand and UDINT time in ms, all counted from the
+ *  request. A later command for the same relay replaces an earlier one.
+ *  The request is refused as a whole if a command is invalid, and while an
+ *  exclusive owner holds the outputs outside the run mode.
+ */
+static const CipUsint kKc868RelayTimerStartService = 0x4BU;
+
+typedef enum {
+  kKc868RelayCommandCancel = 0, /**< drop the command, follow the output image */
+  kKc868RelayCommandPulse = 1, /**< on now, off after the time, at least 1 ms */
+  kKc868RelayCommandOnDelay = 2, /**< on after the time */
+  kKc868RelayCommandOffDelay = 3, /**< off after the time */
+} KC868_A16_RelayCommand;
+
+/** Size of one command on the wire */
+#define KC868_A16_RELAY_COMMAND_SIZE    6
+/** Longest time of a command, one day */
+#define KC868_A16_RELAY_COMMAND_MAX_MS  86400000U
+
+/** @brief Take the posted commands and execute the due ones, scan task only
+ *
+ *  @param now_us esp_timer time
+ *  @param changed set if a relay switched, else left as is
+ *  @return esp_timer time of the next deadline, INT64_MAX if there is none
+ */
+int64_t KC868_A16_RelayTimerRun(int64_t now_us, bool *changed);
+
+/** @brief Outputs with the relays held by commands, scan task only
+ *
+ *  @param outputs requested relay image, bit 0 = Y01
+ */
+uint16_t KC868_A16_RelayTimerApply(uint16_t outputs);
+
+/** @brief Hand relays back to the output image, scan task only
+ *
+ *  @param relays relays the output image changed, bit 0 = Y01
+ */
+void KC868_A16_RelayTimerRelease(uint16_t relays);
+
+/** @brief Cancel all commands, posted ones too, scan task only */
+void KC868_A16_RelayTimerCancel(void);
+
+/** @brief Create the Relay Timer object, in ApplicationInitialization() */
+EipStatus KC868_A16_RelayTimerCreateCipObject(void);
+
+#endif /* CONFIG_KC868_RELAY_TIMERS */
+
+#endif /* KC868_A16_RELAY_TIMER_H_ */
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_scaling.h"
+
+#if CONFIG_KC868_ANALOG_SCALING
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+
+#define SCALING_NVS_NAMESPACE  "kc868"
+#define SCALING_NVS_KEY        "analog_scale"
+#define SCALING_NVS_VERSION    1
+
+#define SCALING_GAIN_FRACTION_BITS 16
+#define SCALING_NO_LIMIT           INT32_MIN
+
+typedef struct __attribute__((packed)) {
+  uint8_t version;
+  uint8_t channel_count;
+  KC868_A16_AnalogScaling scaling[KC868_A16_ANALOG_INPUT_COUNT];
+} ScalingNvBlob;
+
+/* Offset, gain and status limits derived from a calibration, scan task
+ * only */
+typedef struct {
+  KC868_A16_AnalogRange range;
+  int32_t input_low;
+  int32_t value_low;
+  int64_t gain; /**< 16.16 fixed point engineering units per input unit */
+  int32_t under_limit;
+  int32_t wire_break_limit;
+  int32_t over_limit;
+} ScalingChannel;
+
+static const char *TAG_SCALING = "kc868_scaling";
+
+/* Configured calibration, written by the application */
+static KC868_A16_AnalogScaling s_configured[KC868_A16_ANALOG_INPUT_COUNT];
+static bool s_configured_pending = false;
+static portMUX_TYPE s_configured_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Scan task only */
+static ScalingChannel s_channels[KC868_A16_ANALOG_INPUT_COUNT];
+static CipUsint s_status[KC868_A16_ANALOG_INPUT_COUNT];
+
+const char *KC868_A16_ScalingValidateConfig(const KC868_A16_AnalogScaling *scaling) {
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    if (scaling[channel_index].range > kKc868AnalogRange4To20mA) {
+      return "unknown range type";
+    }
+    if (scaling[channel_index].input_high <= scaling[channel_index].input_low) {
+      return "input high not above input low";
+    }
+  }
+  return NULL;
+}
+
+static bool ScalingEqual(const KC868_A16_AnalogScaling *a,
+                         const KC868_A16_AnalogScaling *b) {
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    if (a[channel_index].range != b[channel_index].range ||
+        a[channel_index].input_low != b[channel_index].input_low ||
+        a[channel_index].input_high != b[channel_index].input_high ||
+        a[channel_index].value_low != b[channel_index].value_low ||
+        a[channel_index].value_high != b[channel_index].value_high) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Returns false if the calibration is already configured */
+static bool PostConfig(const KC868_A16_AnalogScaling *scaling) {
+  bool changed = false;
+  taskENTER_CRITICAL(&s_configured_lock);
+  if (!ScalingEqual(s_configured, scaling)) {
+    memcpy(s_configured, scaling, sizeof(s_configured));
+    changed = true;
+  }
+  taskEXIT_CRITICAL(&s_configured_lock);
+  if (changed) {
+    __atomic_store_n(&s_configured_pending, true, __ATOMIC_RELEASE);
+  }
+  return changed;
+}
+
+void KC868_A16_ScalingGetConfig(KC868_A16_AnalogScaling *scaling) {
+  taskENTER_CRITICAL(&s_configured_lock);
+  memcpy(scaling, s_configured, sizeof(s_configured));
+  taskEXIT_CRITICAL(&s_configured_lock);
+}
+
+static esp_err_t StoreConfig(const KC868_A16_AnalogScaling *scaling) {
+  ScalingNvBlob blob;
+  memset(&blob, 0, sizeof(blob));
+  blob.version = SCALING_NVS_VERSION;
+  blob.channel_count = KC868_A16_ANALOG_INPUT_COUNT;
+  memcpy(blob.scaling, scaling, sizeof(blob.scaling));
+
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(SCALING_NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    return err;
+  }
+  err = nvs_set_blob(handle, SCALING_NVS_KEY, &blob, sizeof(blob));
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  return err;
+}
+
+EipStatus KC868_A16_ScalingSetConfig(const KC868_A16_AnalogScaling *scaling) {
+  const char *error = KC868_A16_ScalingValidateConfig(scaling);
+  if (NULL != error) {
+    ESP_LOGW(TAG_SCALING, "Calibration rejected: %s", error);
+    return kEipStatusError;
+  }
+  /* Every Forward_Open with configuration data ends up here, only a new
+   * calibration costs a flash write */
+  if (!PostConfig(scaling)) {
+    return kEipStatusOk;
+  }
+  esp_err_t err = StoreConfig(scaling);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG_SCALING, "Failed to store the calibration: %s",
+             esp_err_to_name(err));
+    return kEipStatusError;
+  }
+  return kEipStatusOk;
+}
+
+void KC868_A16_ScalingInitialize(void) {
+  /* Until a calibration is stored the engineering values are the input
+   * values */
+  KC868_A16_AnalogScaling scaling[KC868_A16_ANALOG_INPUT_COUNT];
+  memset(scaling, 0, sizeof(scaling));
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    scaling[channel_index].range = kKc868AnalogRangeOff;
+    scaling[channel_index].input_high = 4095;
+    scaling[channel_index].value_high = 4095;
+  }
+  ScalingNvBlob blob;
+  size_t length = sizeof(blob);
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(SCALING_NVS_NAMESPACE, NVS_READONLY, &handle);
+  if (err == ESP_OK) {
+    err = nvs_get_blob(handle, SCALING_NVS_KEY, &blob, &length);
+    nvs_close(handle);
+  }
+  if (err == ESP_OK) {
+    KC868_A16_AnalogScaling stored[KC868_A16_ANALOG_INPUT_COUNT];
+    memcpy(stored, blob.scaling, sizeof(stored));
+    if (length != sizeof(blob) || blob.version != SCALING_NVS_VERSION ||
+        blob.channel_count != KC868_A16_ANALOG_INPUT_COUNT ||
+        NULL != KC868_A16_ScalingValidateConfig(stored)) {
+      ESP_LOGW(TAG_SCALING, "Ignoring invalid stored calibration");
+    } else {
+      memcpy(scaling, stored, sizeof(scaling));
+      ESP_LOGI(TAG_SCALING, "Loaded the analog calibration");
+    }
+  }
+  taskENTER_CRITICAL(&s_configured_lock);
+  memcpy(s_configured, scaling, sizeof(s_configured));
+  taskEXIT_CRITICAL(&s_configured_lock);
+  __atomic_store_n(&s_configured_pending, true, __ATOMIC_RELEASE);
+}
+
+static void DeriveChannel(const KC868_A16_AnalogScaling *scaling,
+                          ScalingChannel *channel) {
+  const int32_t span = (int32_t)scaling->input_high - (int32_t)scaling->input_low;
+  const int64_t delta = (int64_t)scaling->value_high - (int64_t)scaling->value_low;
+  /* Rounded to nearest, so input_high comes out as value_high */
+  const int64_t scaled_delta = delta * (1 << SCALING_GAIN_FRACTION_BITS);
+  channel->range = (KC868_A16_AnalogRange)scaling->range;
+  channel->input_low = scaling->input_low;
+  channel->value_low = scaling->value_low;
+  channel->gain = (scaled_delta + (delta < 0 ? -span / 2 : span / 2)) / span;
+  channel->under_limit = SCALING_NO_LIMIT;
+  channel->wire_break_limit = SCALING_NO_LIMIT;
+  channel->over_limit = INT32_MAX;
+
+  switch (channel->range) {
+    case kKc868AnalogRangeLinear:
+      channel->under_limit = scaling->input_low;
+      channel->over_limit = scaling->input_high;
+      break;
+    case kKc868AnalogRange4To20mA:
+      /* 16 mA span: 3.8 mA is 1/80, 3.6 mA 1/40 below 4 mA and 20.5 mA is
+       * 1/32 above 20 mA */
+      channel->under_limit = scaling->input_low - span / 80;
+      channel->wire_break_limit = scaling->input_low - span / 40;
+      channel->over_limit = scaling->input_high + span / 32;
+      break;
+    default:
+      break;
+  }
+}
+
+static CipInt ScaleValue(const ScalingChannel *channel, int32_t input) {
+  if (kKc868AnalogRangeOff == channel->range) {
+    return (CipInt)((input > INT16_MAX) ? INT16_MAX : input);
+  }
+  const int64_t offset = (int64_t)(input - channel->input_low) * channel->gain;
+  int64_t value = channel->value_low +
+                  ((offset + (1 << (SCALING_GAIN_FRACTION_BITS - 1))) >>
+                   SCALING_GAIN_FRACTION_BITS);
+  if (value > INT16_MAX) {
+    value = INT16_MAX;
+  } else if (value < INT16_MIN) {
+    value = INT16_MIN;
+  }
+  return (CipInt)value;
+}
+
+static CipUsint RangeStatus(const ScalingChannel *channel, int32_t input) {
+  CipUsint status = 0;
+  if (input < channel->under_limit) {
+    status |= KC868_A16_ANALOG_UNDER_RANGE;
+  }
+  if (input < channel->wire_break_limit) {
+    status |= KC868_A16_ANALOG_WIRE_BREAK;
+  }
+  if (input > channel->over_limit) {
+    status |= KC868_A16_ANALOG_OVER_RANGE;
+  }
+  return status;
+}
+
+bool KC868_A16_ScalingProcess(const EipUint8 *image,
+                              KC868_A16_ScaledAnalogs *scaled) {
+  if (__atomic_exchange_n(&s_configured_pending, false, __ATOMIC_ACQUIRE)) {
+    KC868_A16_AnalogScaling scaling[KC868_A16_ANALOG_INPUT_COUNT];
+    KC868_A16_ScalingGetConfig(scaling);
+    for (size_t channel_index = 0;
+         channel_index < KC868_A16_ANALOG_INPUT_COUNT; ++channel_index) {
+      DeriveChannel(&scaling[channel_index], &s_channels[channel_index]);
+    }
+  }
+
+  bool changed = false;
+  for (size_t channel_index = 0; channel_index < KC868_A16_ANALOG_INPUT_COUNT;
+       ++channel_index) {
+    const size_t offset = KC868_A16_INPUT_ANALOG_START_OFFSET +
+                          channel_index * KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL;
+    const int32_t input = (int32_t)(image[offset] | (image[offset + 1] << 8));
+    const ScalingChannel *const channel = &s_channels[channel_index];
+    const CipUsint status = RangeStatus(channel, input);
+    scaled->value[channel_index] = ScaleValue(channel, input);
+    scaled->status[channel_index] = status;
+    if (status != s_status[channel_index]) {
+      s_status[channel_index] = status;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+#endif /* CONFIG_KC868_ANALOG_SCALING */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_SCALING_H_
+#define KC868_A16_SCALING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "kc868_a16_io.h"
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_scaling.h
+ *  @brief Engineering units and range status of the analog inputs
+ *
+ *  Selected with CONFIG_KC868_ANALOG_SCALING. Every channel is calibrated
+ *  with two points: the input values at the low and the high end of the
+ *  signal range, in counts or mV like the input image, and the INT
+ *  engineering values they stand for. When a calibration is applied the
+ *  offset and a 16.16 fixed point gain are derived from it once; the I/O
+ *  scan task then converts each sample with one multiply and shift, without
+ *  floating point.
+ *
+ *  The range type sets the status limits:
+ *  - linear (0-5 V, 0-10 V, 0-20 mA): under and over range outside the two
+ *    points
+ *  - 4-20 mA: the NAMUR NE43 limits, under range below 3.8 mA, wire break
+ *    below 3.6 mA and over range above 20.5 mA, taken relative to the
+ *    calibrated 4 and 20 mA points
+ *  Values outside the range are extrapolated and clamp to the INT limits.
+ *
+ *  The calibration is stored in NVS and is part of the configuration
+ *  assembly 151, so a PLC sets it with its Forward_Open. It is only written
+ *  to NVS when it changed.
+ */
+
+#if CONFIG_KC868_ANALOG_SCALING
+
+typedef enum {
+  kKc868AnalogRangeOff = 0, /**< engineering value = input value, no status */
+  kKc868AnalogRangeLinear = 1, /**< 0-5 V, 0-10 V, 0-20 mA and alike */
+  kKc868AnalogRange4To20mA = 2, /**< live zero with NE43 limits */
+} KC868_A16_AnalogRange;
+
+/** Size of the calibration of one channel on the wire */
+#define KC868_A16_ANALOG_SCALING_SIZE 9
+
+/** @brief Calibration of one channel, on the wire in this order, little endian */
+typedef struct {
+  CipUsint range; /**< KC868_A16_AnalogRange */
+  CipUint input_low; /**< input value at the low end of the range, e.g. 4 mA */
+  CipUint input_high; /**< input value at the high end, above input_low */
+  CipInt value_low; /**< engineering value of input_low */
+  CipInt value_high; /**< engineering value of input_high */
+} KC868_A16_AnalogScaling;
+
+/** @brief Load the calibration from NVS, before the I/O scan starts */
+void KC868_A16_ScalingInitialize(void);
+
+/** @brief Convert one input sample, I/O scan task only
+ *
+ *  Picks up a calibration applied since the previous call first.
+ *
+ *  @param image KC868_A16_INPUT_IMAGE_SIZE bytes of the scan image
+ *  @param scaled receives the values and the KC868_A16_ANALOG_* status bits
+ *  @return true if the status of a channel changed
+ */
+bool KC868_A16_ScalingProcess(const EipUint8 *image,
+                              KC868_A16_ScaledAnalogs *scaled);
+
+/** @brief Copy the calibration of all channels
+ *
+ *  @param scaling KC868_A16_ANALOG_INPUT_COUNT entries, A1 first
+ */
+void KC868_A16_ScalingGetConfig(KC868_A16_AnalogScaling *scaling);
+
+/** @brief Check a calibration without applying it
+ *
+ *  @return NULL if it is valid, else a description of the error
+ */
+const char *KC868_A16_ScalingValidateConfig(const KC868_A16_AnalogScaling *scaling);
+
+/** @brief Apply a valid calibration and store it in NVS if it changed
+ *
+ *  May be called from any task, not from an interrupt.
+ *
+ *  @param scaling KC868_A16_ANALOG_INPUT_COUNT entries, A1 first
+ *  @return kEipStatusOk, or kEipStatusError if the calibration is invalid
+ *          or could not be stored; an invalid calibration is not applied
+ */
+EipStatus KC868_A16_ScalingSetConfig(const KC868_A16_AnalogScaling *scaling);
+
+#endif /* CONFIG_KC868_ANALOG_SCALING */
+
+#endif /* KC868_A16_SCALING_H_ */
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_scan_schedule.h"
+
+#include <string.h>
+
+#include "seqlock.h"
+
+#define SCAN_PERIOD_US     ((int64_t)CONFIG_KC868_IO_SCAN_PERIOD_US)
+/* The scan timer jitters, a group due up to half a pass later runs now */
+#define SCAN_DUE_EARLY_US  (SCAN_PERIOD_US / 2)
+#define SCAN_RATE_WINDOW_US 1000000
+/* Weight of a new run in the average run time, 1/2^n */
+#define SCAN_RUN_TIME_SHIFT 3
+
+typedef struct {
+  int64_t period_us; /* 0: not used */
+  int64_t due_us;
+  int64_t run_time_us;
+  bool deferrable;
+  CipUdint window_runs; /* runs when the rate window started */
+} ScanGroupState;
+
+static ScanGroupState s_groups[kKc868ScanGroupCount];
+static int64_t s_pass_start_us = 0;
+/* Bit n: group n ran or was deferred in this pass */
+static uint32_t s_pass_handled = 0;
+static int64_t s_window_start_us = 0;
+
+static KC868_A16_ScanScheduleStatistics s_statistics;
+static KC868_A16_ScanScheduleStatistics s_published_statistics;
+static SeqLock s_statistics_lock;
+
+/* A multiple of the scan period, at least one */
+static int64_t GroupPeriod(int64_t period_us) {
+  const int64_t passes = (period_us + SCAN_PERIOD_US - 1) / SCAN_PERIOD_US;
+  return (passes > 1 ? passes : 1) * SCAN_PERIOD_US;
+}
+
+static void InitializeGroup(KC868_A16_ScanGroup group, int64_t period_us,
+                            bool deferrable, int64_t now_us) {
+  ScanGroupState *const state = &s_groups[group];
+  state->period_us = (period_us > 0) ? GroupPeriod(period_us) : 0;
+  state->due_us = now_us + SCAN_PERIOD_US;
+  state->deferrable = deferrable;
+  s_statistics.group[group].period_us = (CipUdint)state->period_us;
+}
+
+void KC868_A16_ScanScheduleInitialize(int64_t now_us) {
+  memset(s_groups, 0, sizeof(s_groups));
+  memset(&s_statistics, 0, sizeof(s_statistics));
+  InitializeGroup(kKc868ScanGroupDigital, SCAN_PERIOD_US, false, now_us);
+#if CONFIG_KC868_EXPANSION
+  InitializeGroup(kKc868ScanGroupExpansion, SCAN_PERIOD_US, true, now_us);
+#endif
+  InitializeGroup(kKc868ScanGroupAnalog, CONFIG_KC868_IO_ANALOG_PERIOD_US,
+                  true, now_us);
+  InitializeGroup(kKc868ScanGroupDiagnostics,
+                  (int64_t)CONFIG_KC868_IO_DIAGNOSTICS_PERIOD_MS * 1000, true,
+                  now_us);
+  s_window_start_us = now_us;
+  KC868_A16_ScanSchedulePublish();
+}
+
+void KC868_A16_ScanScheduleBeginPass(int64_t now_us) {
+  s_pass_start_us = now_us;
+  s_pass_handled = 0;
+  const int64_t window_us = now_us - s_window_start_us;
+  if (window_us < SCAN_RATE_WINDOW_US) {
+    return;
+  }
+  for (size_t i = 0; i < kKc868ScanGroupCount; i++) {
+    KC868_A16_ScanGroupStatistics *const statistics = &s_statistics.group[i];
+    const uint64_t runs = statistics->runs - s_groups[i].window_runs;
+    statistics->achieved_rate_hz =
+      (CipUdint)((runs * 1000000 + (uint64_t)window_us / 2) / (uint64_t)window_us);
+    s_groups[i].window_runs = statistics->runs;
+  }
+  s_window_start_us = now_us;
+}
+
+bool KC868_A16_ScanScheduleNext(int64_t now_us, KC868_A16_ScanGroup *group) {
+  const int64_t pass_end_us = s_pass_start_us + SCAN_PERIOD_US;
+  while (true) {
+    /* Earliest deadline among the due groups, the first on a tie */
+    size_t next = kKc868ScanGroupCount;
+    int64_t next_deadline_us = 0;
+    for (size_t i = 0; i < kKc868ScanGroupCount; i++) {
+      const ScanGroupState *const state = &s_groups[i];
+      if (0 == state->period_us || 0 != (s_pass_handled & (1u << i)) ||
+          now_us - state->due_us < -SCAN_DUE_EARLY_US) {
+        continue;
+      }
+      const int64_t deadline_us = state->due_us + state->period_us;
+      if (kKc868ScanGroupCount == next || deadline_us - next_deadline_us < 0) {
+        next = i;
+        next_deadline_us = deadline_us;
+      }
+    }
+    if (kKc868ScanGroupCount == next) {
+      return false;
+    }
+    s_pass_handled |= 1u << next;
+
+    /* Deferred only while a whole pass is left before its deadline, the
+     * next pass may be as full as this one */
+    const ScanGroupState *const state = &s_groups[next];
+    if (state->deferrable && now_us + state->run_time_us - pass_end_us > 0 &&
+        pass_end_us + SCAN_PERIOD_US + state->run_time_us - next_deadline_us <= 0) {
+      s_statistics.group[next].deferrals++;
+      continue;
+    }
+    *group = (KC868_A16_ScanGroup)next;
+    return true;
+  }
+}
+
+void KC868_A16_ScanScheduleComplete(KC868_A16_ScanGroup group, int64_t start_us,
+                                    int64_t end_us) {
+  ScanGroupState *const state = &s_groups[group];
+  KC868_A16_ScanGroupStatistics *const statistics = &s_statistics.group[group];
+  statistics->runs++;
+
+  /* Periods that passed without a run are missed, the next one starts
+   * from the period in progress */
+  const int64_t late_us = start_us - state->due_us;
+  int64_t missed = (late_us > 0) ? late_us / state->period_us : 0;
+  statistics->overruns += (CipUdint)missed;
+  state->due_us += (missed + 1) * state->period_us;
+
+  const int64_t run_time_us = end_us - start_us;
+  state->run_time_us += (run_time_us - state->run_time_us) >> SCAN_RUN_TIME_SHIFT;
+  statistics->run_time_us = (CipUdint)state->run_time_us;
+  if (run_time_us > (int64_t)statistics->max_run_time_us) {
+    statistics->max_run_time_us = (CipUdint)run_time_us;
+  }
+}
+
+void KC868_A16_ScanScheduleEndPass(int64_t now_us) {
+  s_statistics.passes++;
+  if (now_us - s_pass_start_us > SCAN_PERIOD_US) {
+    s_statistics.pass_overruns++;
+  }
+}
+
+void KC868_A16_ScanSchedulePublish(void) {
+  SeqLockWrite(&s_statistics_lock, &s_published_statistics, &s_statistics,
+               sizeof(s_published_statistics));
+}
+
+bool KC868_A16_ScanScheduleGetStatistics(KC868_A16_ScanScheduleStatistics *statistics) {
+  KC868_A16_ScanScheduleStatistics copy;
+  if (!SeqLockRead(&s_statistics_lock, &copy, &s_published_statistics,
+                   sizeof(copy), NULL)) {
+    return false;
+  }
+  *statistics = copy;
+  return true;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_SCAN_SCHEDULE_H_
+#define KC868_A16_SCAN_SCHEDULE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_scan_schedule.h
+ *  @brief Scan groups of the I/O scan task and their bus arbiter
+ *
+ *  Every tick of the scan timer (CONFIG_KC868_IO_SCAN_PERIOD_US) is a pass.
+ *  A pass runs the groups that are due, earliest deadline first, the group
+ *  order deciding between equal deadlines. A group is due once per period
+ *  and its deadline is the end of that period. Outputs are not a group,
+ *  every pass writes them.
+ *
+ *  The arbiter keeps the time each group takes. A group that does not fit
+ *  into the rest of the pass is deferred to the next one while a whole
+ *  pass is left before its deadline; the digital inputs are never deferred.
+ *  A group starting a whole period late has missed that period, an
+ *  overrun.
+ *
+ *  Scan task only, apart from KC868_A16_ScanScheduleGetStatistics().
+ */
+
+/** @brief The scan groups, most important first */
+typedef enum {
+  kKc868ScanGroupDigital = 0, /**< X01-X16 and the pulse counters, every pass */
+  kKc868ScanGroupExpansion = 1, /**< expansion devices, each at its own period */
+  kKc868ScanGroupAnalog = 2, /**< A1-A4, CONFIG_KC868_IO_ANALOG_PERIOD_US */
+  kKc868ScanGroupDiagnostics = 3, /**< bus and schedule statistics, CONFIG_KC868_IO_DIAGNOSTICS_PERIOD_MS */
+  kKc868ScanGroupCount
+} KC868_A16_ScanGroup;
+
+/** @brief Counters of one group, since start */
+typedef struct {
+  CipUdint period_us; /**< rounded up to the scan period, 0 if the group is not used */
+  CipUdint runs;
+  CipUdint achieved_rate_hz; /**< runs per second over the last second */
+  CipUdint overruns; /**< periods missed */
+  CipUdint deferrals; /**< passes the group was deferred from */
+  CipUdint run_time_us; /**< average time a run takes */
+  CipUdint max_run_time_us;
+} KC868_A16_ScanGroupStatistics;
+
+typedef struct {
+  KC868_A16_ScanGroupStatistics group[kKc868ScanGroupCount]; /**< KC868_A16_ScanGroup order */
+  CipUdint passes;
+  CipUdint pass_overruns; /**< passes longer than the scan period */
+} KC868_A16_ScanScheduleStatistics;
+
+/** @brief Set the periods, every group is due on the first tick
+ *
+ *  @param now_us esp_timer time the scan timer starts at
+ */
+void KC868_A16_ScanScheduleInitialize(int64_t now_us);
+
+/** @brief Start a pass on a tick of the scan timer
+ *
+ *  @param now_us esp_timer time
+ */
+void KC868_A16_ScanScheduleBeginPass(int64_t now_us);
+
+/** @brief The next group to run in this pass
+ *
+ *  Groups that do not fit into the pass any more are deferred on the way.
+ *  Run the group, then hand its start and end to
+ *  KC868_A16_ScanScheduleComplete().
+ *
+ *  @param now_us esp_timer time
+ *  @param group receives the group
+ *  @return false if no group is left for this pass
+ */
+bool KC868_A16_ScanScheduleNext(int64_t now_us, KC868_A16_ScanGroup *group);
+
+/** @brief Account a run of group and schedule its next period
+ *
+ *  @param group group returned by KC868_A16_ScanScheduleNext()
+ *  @param start_us esp_timer time the run started
+ *  @param end_us esp_timer time the run ended
+ */
+void KC868_A16_ScanScheduleComplete(KC868_A16_ScanGroup group, int64_t start_us,
+                                    int64_t end_us);
+
+/** @brief End the pass started by KC868_A16_ScanScheduleBeginPass()
+ *
+ *  @param now_us esp_timer time
+ */
+void KC868_A16_ScanScheduleEndPass(int64_t now_us);
+
+/** @brief Publish the counters for KC868_A16_ScanScheduleGetStatistics(),
+ *  done by the diagnostics group */
+void KC868_A16_ScanSchedulePublish(void);
+
+/** @brief Copy the counters published last, from any task
+ *
+ *  @param statistics receives the counters
+ *  @return false if the scan task was publishing them, statistics is
+ *          unchanged then
+ */
+bool KC868_A16_ScanScheduleGetStatistics(KC868_A16_ScanScheduleStatistics *statistics);
+
+#endif /* KC868_A16_SCAN_SCHEDULE_H_ */
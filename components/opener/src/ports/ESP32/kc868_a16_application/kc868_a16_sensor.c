@@ -0,0 +1,557 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_sensor.h"
+
+#if CONFIG_KC868_SENSORS
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "seqlock.h"
+#include "driver/gpio.h"
+#include "driver/rmt_rx.h"
+#include "driver/rmt_tx.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define SENSOR_TASK_STACK_SIZE     3072
+#define SENSOR_TASK_CORE           1
+/* 1 us per tick, the RMT durations are 15 bits */
+#define SENSOR_RMT_RESOLUTION_HZ   1000000
+#define SENSOR_RMT_MEM_SYMBOLS     64
+/* Pulses shorter than this are glitches, within the ESP32 filter limit */
+#define SENSOR_RX_MIN_NS           1000
+/* Longer than any transfer including the idle time that ends it */
+#define SENSOR_TRANSFER_TIMEOUT_MS 50
+/* Level changes a recording of SENSOR_RMT_MEM_SYMBOLS symbols can hold */
+#define SENSOR_MAX_LEVELS          (2 * SENSOR_RMT_MEM_SYMBOLS)
+
+/* 1-Wire timing in us, standard speed */
+#define ONEWIRE_RESET_LOW_US       480
+#define ONEWIRE_RESET_HIGH_US      500
+#define ONEWIRE_RESET_IDLE_US      600 /* longer than the reset pulse */
+#define ONEWIRE_PRESENCE_MIN_US    50
+#define ONEWIRE_SLOT_US            70
+#define ONEWIRE_WRITE_1_LOW_US     6
+#define ONEWIRE_WRITE_0_LOW_US     60
+#define ONEWIRE_READ_SAMPLE_US     15 /* a slave holding the slot low reads 0 */
+#define ONEWIRE_SLOT_IDLE_US       100
+
+#define DS18B20_SKIP_ROM           0xCC
+#define DS18B20_CONVERT_T          0x44
+#define DS18B20_READ_SCRATCHPAD    0xBE
+#define DS18B20_SCRATCHPAD_SIZE    9
+#define DS18B20_CONVERSION_MS      750 /* 12 bit resolution */
+
+/* DHT timing in us: the start pulse of the host and the bit threshold */
+#define DHT11_START_LOW_US         20000
+#define DHT22_START_LOW_US         1100
+#define DHT_START_MIN_US           500
+#define DHT_BIT_1_HIGH_US          48
+#define DHT_RESPONSE_IDLE_US       1000
+#define DHT_DATA_BYTES             5
+
+typedef enum {
+  kSensorTypeNone,
+  kSensorTypeDs18b20,
+  kSensorTypeDht11,
+  kSensorTypeDht22,
+} SensorType;
+
+#if CONFIG_KC868_SENSOR1_DS18B20
+#define SENSOR1_TYPE kSensorTypeDs18b20
+#elif CONFIG_KC868_SENSOR1_DHT11
+#define SENSOR1_TYPE kSensorTypeDht11
+#elif CONFIG_KC868_SENSOR1_DHT22
+#define SENSOR1_TYPE kSensorTypeDht22
+#else
+#define SENSOR1_TYPE kSensorTypeNone
+#endif
+#if CONFIG_KC868_SENSOR2_DS18B20
+#define SENSOR2_TYPE kSensorTypeDs18b20
+#elif CONFIG_KC868_SENSOR2_DHT11
+#define SENSOR2_TYPE kSensorTypeDht11
+#elif CONFIG_KC868_SENSOR2_DHT22
+#define SENSOR2_TYPE kSensorTypeDht22
+#else
+#define SENSOR2_TYPE kSensorTypeNone
+#endif
+#if CONFIG_KC868_SENSOR3_DS18B20
+#define SENSOR3_TYPE kSensorTypeDs18b20
+#elif CONFIG_KC868_SENSOR3_DHT11
+#define SENSOR3_TYPE kSensorTypeDht11
+#elif CONFIG_KC868_SENSOR3_DHT22
+#define SENSOR3_TYPE kSensorTypeDht22
+#else
+#define SENSOR3_TYPE kSensorTypeNone
+#endif
+
+typedef struct {
+  SensorType type;
+  int gpio;
+} SensorPin;
+
+static const SensorPin kSensorPins[KC868_A16_SENSOR_CHANNELS] = {
+  { SENSOR1_TYPE, CONFIG_KC868_SENSOR1_GPIO },
+  { SENSOR2_TYPE, CONFIG_KC868_SENSOR2_GPIO },
+  { SENSOR3_TYPE, CONFIG_KC868_SENSOR3_GPIO },
+};
+
+typedef struct {
+  SensorType type; /* kSensorTypeNone unless the channels are set up */
+  rmt_channel_handle_t tx;
+  rmt_channel_handle_t rx;
+  rmt_symbol_word_t received[SENSOR_RMT_MEM_SYMBOLS]; /* owned by the RMT
+                                                       * driver while
+                                                       * receiving */
+  size_t received_count; /* valid once done */
+  atomic_bool done;
+} SensorChannel;
+
+/* One level of a recording, see FlattenRecording() */
+typedef struct {
+  uint8_t level;
+  uint32_t duration_us;
+} SensorLevel;
+
+static const char *TAG_SENSOR = "kc868_sensor";
+
+static bool s_started = false;
+static TaskHandle_t s_task = NULL;
+static rmt_encoder_handle_t s_copy_encoder = NULL;
+static SensorChannel s_channels[KC868_A16_SENSOR_CHANNELS];
+
+/* Task only */
+static KC868_A16_SensorValues s_task_values;
+
+/* Published to the OpENer task, see seqlock.h */
+static KC868_A16_SensorValues s_values;
+static SeqLock s_values_lock;
+
+static bool OnReceiveDone(rmt_channel_handle_t rx,
+                          const rmt_rx_done_event_data_t *event,
+                          void *context) {
+  (void)rx;
+  SensorChannel *const channel = context;
+  BaseType_t woken = pdFALSE;
+  channel->received_count = event->num_symbols;
+  atomic_store(&channel->done, true);
+  vTaskNotifyGiveFromISR(s_task, &woken);
+  return pdTRUE == woken;
+}
+
+static bool UsedByCounter(int gpio) {
+#if CONFIG_KC868_PCNT
+  return gpio == CONFIG_KC868_PCNT1_A_GPIO ||
+         gpio == CONFIG_KC868_PCNT1_B_GPIO ||
+         gpio == CONFIG_KC868_PCNT2_A_GPIO ||
+         gpio == CONFIG_KC868_PCNT2_B_GPIO ||
+         gpio == CONFIG_KC868_PCNT3_A_GPIO ||
+         gpio == CONFIG_KC868_PCNT3_B_GPIO;
+#else
+  (void)gpio;
+  return false;
+#endif
+}
+
+/* The RX channel first, the TX channel then shares its GPIO through the
+ * loop back, as an open drain output next to the pull-up */
+static esp_err_t OpenChannel(SensorChannel *channel, int gpio) {
+  const rmt_rx_channel_config_t rx_config = {
+    .gpio_num = gpio,
+    .clk_src = RMT_CLK_SRC_DEFAULT,
+    .resolution_hz = SENSOR_RMT_RESOLUTION_HZ,
+    .mem_block_symbols = SENSOR_RMT_MEM_SYMBOLS,
+  };
+  esp_err_t ret = rmt_new_rx_channel(&rx_config, &channel->rx);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  const rmt_tx_channel_config_t tx_config = {
+    .gpio_num = gpio,
+    .clk_src = RMT_CLK_SRC_DEFAULT,
+    .resolution_hz = SENSOR_RMT_RESOLUTION_HZ,
+    .mem_block_symbols = SENSOR_RMT_MEM_SYMBOLS,
+    .trans_queue_depth = 1,
+    .flags.io_loop_back = true,
+    .flags.io_od_mode = true,
+  };
+  ret = rmt_new_tx_channel(&tx_config, &channel->tx);
+  const rmt_rx_event_callbacks_t callbacks = {
+    .on_recv_done = OnReceiveDone,
+  };
+  if (ret == ESP_OK) {
+    ret = rmt_rx_register_event_callbacks(channel->rx, &callbacks, channel);
+  }
+  if (ret == ESP_OK) {
+    ret = gpio_pullup_en(gpio);
+  }
+  bool rx_enabled = false;
+  if (ret == ESP_OK) {
+    ret = rmt_enable(channel->rx);
+    rx_enabled = (ret == ESP_OK);
+  }
+  if (ret == ESP_OK) {
+    ret = rmt_enable(channel->tx);
+  }
+  if (ret != ESP_OK) {
+    if (NULL != channel->tx) {
+      rmt_del_channel(channel->tx);
+      channel->tx = NULL;
+    }
+    if (rx_enabled) {
+      rmt_disable(channel->rx);
+    }
+    rmt_del_channel(channel->rx);
+    channel->rx = NULL;
+  }
+  return ret;
+}
+
+/* Send the symbols and record the line until it stayed idle for idle_us.
+ * The task sleeps meanwhile, the RMT interrupt wakes it. */
+static bool Transfer(SensorChannel *channel, const rmt_symbol_word_t *symbols,
+                     size_t count, uint32_t idle_us) {
+  const rmt_receive_config_t receive_config = {
+    .signal_range_min_ns = SENSOR_RX_MIN_NS,
+    .signal_range_max_ns = idle_us * 1000U,
+  };
+  const rmt_transmit_config_t transmit_config = {
+    .loop_count = 0,
+    .flags.eot_level = 1, /* released */
+  };
+  atomic_store(&channel->done, false);
+  (void)ulTaskNotifyTake(pdTRUE, 0);
+  if (rmt_receive(channel->rx, channel->received, sizeof(channel->received),
+                  &receive_config) != ESP_OK) {
+    return false;
+  }
+  bool sent = (rmt_transmit(channel->tx, s_copy_encoder, symbols,
+                            count * sizeof(*symbols), &transmit_config) ==
+               ESP_OK);
+  while (sent && !atomic_load(&channel->done)) {
+    sent = (0 != ulTaskNotifyTake(pdTRUE,
+                                  pdMS_TO_TICKS(SENSOR_TRANSFER_TIMEOUT_MS) +
+                                  1));
+  }
+  if (!sent) {
+    /* Stops the reception, the buffer is ours again */
+    rmt_disable(channel->rx);
+    rmt_enable(channel->rx);
+    return false;
+  }
+  (void)rmt_tx_wait_all_done(channel->tx, SENSOR_TRANSFER_TIMEOUT_MS);
+  return true;
+}
+
+/* The recording as alternating levels, empty durations left out */
+static size_t FlattenRecording(const SensorChannel *channel,
+                               SensorLevel *levels) {
+  size_t count = 0;
+  for (size_t i = 0; i < channel->received_count; ++i) {
+    const rmt_symbol_word_t *const symbol = &channel->received[i];
+    const uint8_t level[2] = { symbol->level0, symbol->level1 };
+    const uint32_t duration[2] = { symbol->duration0, symbol->duration1 };
+    for (size_t half = 0; half < 2; ++half) {
+      if (0 == duration[half]) {
+        continue;
+      }
+      if (count > 0 && levels[count - 1].level == level[half]) {
+        levels[count - 1].duration_us += duration[half];
+      } else if (count < SENSOR_MAX_LEVELS) {
+        levels[count].level = level[half];
+        levels[count].duration_us = duration[half];
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+static rmt_symbol_word_t MakeSymbol(uint32_t low_us, uint32_t high_us) {
+  const rmt_symbol_word_t symbol = {
+    .level0 = 0,
+    .duration0 = low_us,
+    .level1 = 1,
+    .duration1 = high_us,
+  };
+  return symbol;
+}
+
+/* Reset pulse, true if a device answered with its presence pulse */
+static bool OneWireReset(SensorChannel *channel) {
+  const rmt_symbol_word_t reset = MakeSymbol(ONEWIRE_RESET_LOW_US,
+                                             ONEWIRE_RESET_HIGH_US);
+  if (!Transfer(channel, &reset, 1, ONEWIRE_RESET_IDLE_US)) {
+    return false;
+  }
+  SensorLevel levels[SENSOR_MAX_LEVELS];
+  const size_t count = FlattenRecording(channel, levels);
+  /* Our reset pulse, then the presence pulse of the device */
+  bool reset_seen = false;
+  for (size_t i = 0; i < count; ++i) {
+    if (0 != levels[i].level) {
+      continue;
+    }
+    if (!reset_seen) {
+      reset_seen = levels[i].duration_us >= ONEWIRE_RESET_LOW_US / 2;
+    } else if (levels[i].duration_us >= ONEWIRE_PRESENCE_MIN_US) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Write one byte, least significant bit first. Writing 0xFF reads a byte:
+ * the device holds the slot of a 0 low past the sample point. */
+static bool OneWireTransferByte(SensorChannel *channel, uint8_t value,
+                                uint8_t *read) {
+  rmt_symbol_word_t slots[8];
+  for (size_t bit = 0; bit < 8; ++bit) {
+    const uint32_t low_us = (value & (1U << bit)) ? ONEWIRE_WRITE_1_LOW_US :
+                            ONEWIRE_WRITE_0_LOW_US;
+    slots[bit] = MakeSymbol(low_us, ONEWIRE_SLOT_US - low_us);
+  }
+  if (!Transfer(channel, slots, 8, ONEWIRE_SLOT_IDLE_US)) {
+    return false;
+  }
+  SensorLevel levels[SENSOR_MAX_LEVELS];
+  const size_t count = FlattenRecording(channel, levels);
+  uint8_t result = 0;
+  size_t bit = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (0 != levels[i].level) {
+      continue;
+    }
+    if (bit >= 8) {
+      return false;
+    }
+    if (levels[i].duration_us < ONEWIRE_READ_SAMPLE_US) {
+      result |= (uint8_t)(1U << bit);
+    }
+    bit++;
+  }
+  if (8 != bit) {
+    return false;
+  }
+  if (NULL != read) {
+    *read = result;
+  }
+  return true;
+}
+
+static bool OneWireCommand(SensorChannel *channel, uint8_t command) {
+  return OneWireReset(channel) &&
+         OneWireTransferByte(channel, DS18B20_SKIP_ROM, NULL) &&
+         OneWireTransferByte(channel, command, NULL);
+}
+
+/* Dallas/Maxim CRC-8, 0 over the data and its CRC */
+static uint8_t OneWireCrc8(const uint8_t *data, size_t length) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < length; ++i) {
+    crc ^= data[i];
+    for (size_t bit = 0; bit < 8; ++bit) {
+      crc = (crc & 1U) ? (uint8_t)((crc >> 1) ^ 0x8CU) : (uint8_t)(crc >> 1);
+    }
+  }
+  return crc;
+}
+
+static bool ReadDs18b20(SensorChannel *channel, CipInt *temperature_dc) {
+  uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];
+  if (!OneWireCommand(channel, DS18B20_READ_SCRATCHPAD)) {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(scratchpad); ++i) {
+    if (!OneWireTransferByte(channel, 0xFF, &scratchpad[i])) {
+      return false;
+    }
+  }
+  if (0 != OneWireCrc8(scratchpad, sizeof(scratchpad))) {
+    return false;
+  }
+  /* 1/16 degree, rounded to 1/10 */
+  const int32_t raw = (int16_t)(scratchpad[0] | (scratchpad[1] << 8));
+  *temperature_dc = (CipInt)((raw * 10 + (raw >= 0 ? 8 : -8)) / 16);
+  return true;
+}
+
+/* The start pulse releases the line, the sensor answers with a response
+ * pulse and 40 bits whose high time tells the value */
+static bool ReadDht(SensorChannel *channel, CipInt *temperature_dc,
+                    CipUint *humidity_dpm) {
+  const uint32_t start_us = (kSensorTypeDht11 == channel->type) ?
+                            DHT11_START_LOW_US : DHT22_START_LOW_US;
+  const rmt_symbol_word_t start = MakeSymbol(start_us, 10);
+  /* The idle time that ends the recording must exceed the start pulse */
+  if (!Transfer(channel, &start, 1, start_us + DHT_RESPONSE_IDLE_US)) {
+    return false;
+  }
+  SensorLevel levels[SENSOR_MAX_LEVELS];
+  const size_t count = FlattenRecording(channel, levels);
+  size_t i = 0;
+  while (i < count &&
+         (0 != levels[i].level || levels[i].duration_us < DHT_START_MIN_US)) {
+    i++;
+  }
+  /* Start, wait, response low and high, then low and high per bit */
+  i += 4;
+  if (i + 2 * 8 * DHT_DATA_BYTES > count) {
+    return false;
+  }
+  uint8_t data[DHT_DATA_BYTES] = { 0 };
+  for (size_t bit = 0; bit < 8 * DHT_DATA_BYTES; ++bit, i += 2) {
+    if (levels[i + 1].duration_us > DHT_BIT_1_HIGH_US) {
+      data[bit / 8] |= (uint8_t)(0x80U >> (bit % 8));
+    }
+  }
+  if (data[4] != (uint8_t)(data[0] + data[1] + data[2] + data[3])) {
+    return false;
+  }
+  if (kSensorTypeDht11 == channel->type) {
+    /* Integral and tenth parts, the sign in bit 7 of the tenths */
+    const int32_t magnitude = data[2] * 10 + (data[3] & 0x0F);
+    *temperature_dc = (CipInt)((data[3] & 0x80U) ? -magnitude : magnitude);
+    *humidity_dpm = (CipUint)(data[0] * 10 + (data[1] % 10));
+  } else {
+    /* Tenths, the sign in bit 15 of the temperature */
+    const int32_t magnitude = ((data[2] & 0x7F) << 8) | data[3];
+    *temperature_dc = (CipInt)((data[2] & 0x80U) ? -magnitude : magnitude);
+    *humidity_dpm = (CipUint)((data[0] << 8) | data[1]);
+  }
+  return true;
+}
+
+static void SetReading(size_t index, bool valid) {
+  if (valid) {
+    s_task_values.status &= (CipUsint) ~(1U << index);
+  } else {
+    if (0 == (s_task_values.status & (1U << index))) {
+      ESP_LOGW(TAG_SENSOR, "Sensor %u on GPIO%d: no valid reading",
+               (unsigned)index + 1, kSensorPins[index].gpio);
+    }
+    s_task_values.status |= (CipUsint)(1U << index);
+  }
+}
+
+static void SensorTask(void *arg) {
+  (void)arg;
+  TickType_t last_wake = xTaskGetTickCount();
+  while (true) {
+    /* The DS18B20s convert together, the line is free meanwhile */
+    bool converting[KC868_A16_SENSOR_CHANNELS] = { false };
+    bool any_converting = false;
+    for (size_t i = 0; i < KC868_A16_SENSOR_CHANNELS; ++i) {
+      if (kSensorTypeDs18b20 == s_channels[i].type) {
+        converting[i] = OneWireCommand(&s_channels[i], DS18B20_CONVERT_T);
+        any_converting = any_converting || converting[i];
+      }
+    }
+    if (any_converting) {
+      vTaskDelay(pdMS_TO_TICKS(DS18B20_CONVERSION_MS) + 1);
+    }
+    for (size_t i = 0; i < KC868_A16_SENSOR_CHANNELS; ++i) {
+      SensorChannel *const channel = &s_channels[i];
+      CipInt temperature = 0;
+      CipUint humidity = 0;
+      bool valid = false;
+      if (kSensorTypeDs18b20 == channel->type) {
+        valid = converting[i] && ReadDs18b20(channel, &temperature);
+      } else if (kSensorTypeNone != channel->type) {
+        valid = ReadDht(channel, &temperature, &humidity);
+      } else {
+        continue;
+      }
+      if (valid) {
+        s_task_values.temperature_dc[i] = temperature;
+        s_task_values.humidity_dpm[i] = humidity;
+      }
+      SetReading(i, valid);
+    }
+    SeqLockWrite(&s_values_lock, &s_values, &s_task_values, sizeof(s_values));
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_KC868_SENSOR_PERIOD_MS));
+  }
+}
+
+void KC868_A16_SensorStart(void) {
+  if (s_started) {
+    return;
+  }
+  s_started = true;
+  /* Every sensor is flagged until its first valid reading */
+  s_task_values.status = (CipUsint)((1U << KC868_A16_SENSOR_CHANNELS) - 1);
+  SeqLockWrite(&s_values_lock, &s_values, &s_task_values, sizeof(s_values));
+
+  const rmt_copy_encoder_config_t encoder_config = { 0 };
+  if (rmt_new_copy_encoder(&encoder_config, &s_copy_encoder) != ESP_OK) {
+    ESP_LOGE(TAG_SENSOR, "Failed to create the RMT encoder");
+    return;
+  }
+  size_t opened = 0;
+  for (size_t i = 0; i < KC868_A16_SENSOR_CHANNELS; ++i) {
+    const SensorPin *const pin = &kSensorPins[i];
+    if (kSensorTypeNone == pin->type) {
+      continue;
+    }
+    if (UsedByCounter(pin->gpio)) {
+      ESP_LOGE(TAG_SENSOR, "Sensor %zu: GPIO%d is a pulse counter input",
+               i + 1, pin->gpio);
+      continue;
+    }
+    const esp_err_t ret = OpenChannel(&s_channels[i], pin->gpio);
+    if (ret != ESP_OK) {
+      ESP_LOGE(TAG_SENSOR, "Sensor %zu on GPIO%d failed: %s", i + 1,
+               pin->gpio, esp_err_to_name(ret));
+      continue;
+    }
+    s_channels[i].type = pin->type;
+    opened++;
+    ESP_LOGI(TAG_SENSOR, "Sensor %zu: %s on GPIO%d", i + 1,
+             (kSensorTypeDs18b20 == pin->type) ? "DS18B20" :
+             (kSensorTypeDht11 == pin->type) ? "DHT11" : "DHT22", pin->gpio);
+  }
+  if (0 == opened) {
+    ESP_LOGW(TAG_SENSOR, "No sensor configured, the task is not started");
+    return;
+  }
+  if (pdPASS != xTaskCreatePinnedToCore(SensorTask, "kc868_sensor",
+                                        SENSOR_TASK_STACK_SIZE, NULL,
+                                        CONFIG_KC868_SENSOR_TASK_PRIORITY,
+                                        &s_task, SENSOR_TASK_CORE)) {
+    ESP_LOGE(TAG_SENSOR, "Failed to create the sensor task");
+  }
+}
+
+bool KC868_A16_SensorGetValues(KC868_A16_SensorValues *values) {
+  KC868_A16_SensorValues copy;
+  if (!SeqLockRead(&s_values_lock, &copy, &s_values, sizeof(copy), NULL)) {
+    return false;
+  }
+  *values = copy;
+  return true;
+}
+
+#endif /* CONFIG_KC868_SENSORS */
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_SENSOR_H_
+#define KC868_A16_SENSOR_H_
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_sensor.h
+ *  @brief Temperature and humidity sensors on the HT1-HT3 terminals
+ *
+ *  Selected with CONFIG_KC868_SENSORS. Each terminal takes one DS18B20 on
+ *  1-Wire or one DHT11 / DHT22 (AM2302). The ESP32 RMT peripheral times
+ *  the line: a TX channel in open drain mode drives the reset, the bit
+ *  slots or the start pulse, and an RX channel on the same GPIO records
+ *  the levels. The task of this module only prepares the symbols and
+ *  decodes the recording, and waits for the RMT interrupt in between, so
+ *  neither interrupts nor the scheduler are held off for the
+ *  milliseconds a bit-banged transfer takes.
+ *
+ *  A DS18B20 is read as the only device on its line (Skip ROM) with 12 bit
+ *  resolution; all of them convert at the same time. The readings are
+ *  taken every CONFIG_KC868_SENSOR_PERIOD_MS and published under the
+ *  sequence lock scheme of KC868_A16_IoGetInputImage().
+ */
+
+#if CONFIG_KC868_SENSORS
+
+#define KC868_A16_SENSOR_CHANNELS 3
+
+/** @brief Most recent readings of the sensors */
+typedef struct {
+  CipInt temperature_dc[KC868_A16_SENSOR_CHANNELS]; /**< in 0.1 degrees Celsius */
+  CipUint humidity_dpm[KC868_A16_SENSOR_CHANNELS]; /**< in 0.1 %RH, 0 for a DS18B20 */
+  CipUsint status; /**< bit n set while sensor n+1 has no valid reading */
+} KC868_A16_SensorValues;
+
+/** @brief Set up the RMT channels of the configured sensors and start the
+ *  acquisition task
+ *
+ *  Called from ApplicationInitialization(). Safe to call more than once,
+ *  only the first call has an effect.
+ */
+void KC868_A16_SensorStart(void);
+
+/** @brief Copy the most recent consistent readings
+ *
+ *  A sensor whose last reading failed keeps its previous values with its
+ *  status bit set. Terminals without a sensor read 0 and are flagged as
+ *  well.
+ *
+ *  @return true if values was updated, false if the task was writing
+ */
+bool KC868_A16_SensorGetValues(KC868_A16_SensorValues *values);
+
+#endif /* CONFIG_KC868_SENSORS */
+
+#endif /* KC868_A16_SENSOR_H_ */
@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "kc868_a16_sim.h"
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+static portMUX_TYPE s_sim_lock = portMUX_INITIALIZER_UNLOCKED;
+#define SIM_LOCK()   taskENTER_CRITICAL(&s_sim_lock)
+#define SIM_UNLOCK() taskEXIT_CRITICAL(&s_sim_lock)
+#else
+/* The host build runs the stack in one thread */
+#define SIM_LOCK()
+#define SIM_UNLOCK()
+#endif
+
+#define SIM_RELAY_PORTS  (KC868_A16_SIM_FIRST_INPUT_EXPANDER)
+#define SIM_PPM          1000000U
+
+static KC868_A16_SimSignal s_digital[KC868_A16_SIM_DIGITAL_INPUT_COUNT];
+static KC868_A16_SimSignal s_analog[KC868_A16_SIM_ANALOG_INPUT_COUNT];
+static KC868_A16_SimLatency s_latency;
+static KC868_A16_SimFault s_faults[KC868_A16_SIM_EXPANDER_COUNT];
+static KC868_A16_SimStatistics s_statistics;
+static uint8_t s_relay_ports[SIM_RELAY_PORTS] = { 0xFF, 0xFF };
+static uint32_t s_random = 1;
+
+/* xorshift32, enough for jitter and fault rates; never returns 0 */
+static uint32_t NextRandom(void) {
+  uint32_t x = s_random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  s_random = x;
+  return x;
+}
+
+static uint16_t SignalValue(const KC868_A16_SimSignal *signal,
+                            int64_t now_us) {
+  if (kKc868SimSignalConstant == signal->type) {
+    return signal->high;
+  }
+  if (kKc868SimSignalRelay == signal->type) {
+    const uint8_t relay = signal->relay % KC868_A16_SIM_RELAY_COUNT;
+    const bool energised = !(s_relay_ports[relay / 8] & (1u << (relay % 8)));
+    return energised ? 1 : 0;
+  }
+  if (0 == signal->period_us) {
+    return signal->low;
+  }
+
+  const int64_t period = signal->period_us;
+  const int64_t half = period / 2;
+  const int64_t span = (int64_t)signal->high - signal->low;
+  int64_t t = (now_us + signal->phase_us) % period;
+  if (t < 0) {
+    t += period;
+  }
+  switch (signal->type) {
+    case kKc868SimSignalSquare:
+      return (t < half) ? signal->high : signal->low;
+    case kKc868SimSignalRamp:
+      return (uint16_t)(signal->low + span * t / period);
+    case kKc868SimSignalTriangle:
+      if (0 == half) {
+        return signal->low;
+      }
+      if (t < half) {
+        return (uint16_t)(signal->low + span * t / half);
+      }
+      return (uint16_t)(signal->high - span * (t - half) / (period - half));
+    default:
+      return signal->low;
+  }
+}
+
+/* Port of an input expander, a pin is pulled low while its input is on */
+static uint8_t InputPort(size_t expander, int64_t now_us) {
+  const size_t first = (expander - KC868_A16_SIM_FIRST_INPUT_EXPANDER) * 8;
+  uint8_t port = 0xFF;
+  for (size_t bit = 0; bit < 8; bit++) {
+    if (0 != SignalValue(&s_digital[first + bit], now_us)) {
+      port &= (uint8_t)~(1u << bit);
+    }
+  }
+  return port;
+}
+
+static KC868_A16_SimResult AccessResult(size_t expander) {
+  KC868_A16_SimFault *const fault = &s_faults[expander];
+  if (fault->until_recovery) {
+    return fault->result;
+  }
+  if (fault->count > 0) {
+    fault->count--;
+    return fault->result;
+  }
+  if (0 != fault->rate_ppm && NextRandom() % SIM_PPM < fault->rate_ppm) {
+    return fault->result;
+  }
+  return kKc868SimOk;
+}
+
+static uint32_t TransactionTime(void) {
+  uint32_t time_us = s_latency.transaction_us;
+  if (0 != s_latency.jitter_us) {
+    time_us += NextRandom() % (s_latency.jitter_us + 1);
+  }
+  s_statistics.transactions++;
+  return time_us;
+}
+
+void KC868_A16_SimReset(void) {
+  SIM_LOCK();
+  memset(s_digital, 0, sizeof(s_digital));
+  memset(s_analog, 0, sizeof(s_analog));
+  for (size_t i = 0; i < KC868_A16_SIM_DIGITAL_INPUT_COUNT; i++) {
+    s_digital[i].type = kKc868SimSignalConstant; /* high 0: off */
+  }
+  for (size_t i = 0; i < KC868_A16_SIM_ANALOG_INPUT_COUNT; i++) {
+    s_analog[i].type = kKc868SimSignalConstant;
+  }
+  memset(&s_latency, 0, sizeof(s_latency));
+  memset(s_faults, 0, sizeof(s_faults));
+  memset(&s_statistics, 0, sizeof(s_statistics));
+  memset(s_relay_ports, 0xFF, sizeof(s_relay_ports));
+  s_random = 1;
+  SIM_UNLOCK();
+}
+
+void KC868_A16_SimSetSeed(uint32_t seed) {
+  SIM_LOCK();
+  s_random = (0 != seed) ? seed : 1;
+  SIM_UNLOCK();
+}
+
+void KC868_A16_SimSetDigitalSignal(size_t input,
+                                   const KC868_A16_SimSignal *signal) {
+  if (input >= KC868_A16_SIM_DIGITAL_INPUT_COUNT) {
+    return;
+  }
+  SIM_LOCK();
+  s_digital[input] = *signal;
+  SIM_UNLOCK();
+}
+
+void KC868_A16_SimSetAnalogSignal(size_t channel,
+                                  const KC868_A16_SimSignal *signal) {
+  if (channel >= KC868_A16_SIM_ANALOG_INPUT_COUNT) {
+    return;
+  }
+  SIM_LOCK();
+  s_analog[channel] = *signal;
+  SIM_UNLOCK();
+}
+
+void KC868_A16_SimSetLatency(const KC868_A16_SimLatency *latency) {
+  SIM_LOCK();
+  s_latency = *latency;
+  SIM_UNLOCK();
+}
+
+void KC868_A16_SimSetFault(size_t expander, const KC868_A16_SimFault *fault) {
+  if (expander >= KC868_A16_SIM_EXPANDER_COUNT) {
+    return;
+  }
+  SIM_LOCK();
+  if (NULL != fault) {
+    s_faults[expander] = *fault;
+  } else {
+    memset(&s_faults[expander], 0, sizeof(s_faults[expander]));
+  }
+  SIM_UNLOCK();
+}
+
+/* One access on the wire; a read is only stored once it succeeded */
+static KC868_A16_SimResult Access(size_t expander, uint8_t *port,
+                                  int64_t now_us, uint32_t *time_us) {
+  const KC868_A16_SimResult result = AccessResult(expander);
+  s_statistics.accesses++;
+  *time_us += (kKc868SimTimeout == result) ? s_latency.timeout_us :
+              s_latency.access_us;
+  if (kKc868SimOk != result) {
+    s_statistics.failed_accesses++;
+  } else if (expander < KC868_A16_SIM_FIRST_INPUT_EXPANDER) {
+    s_relay_ports[expander] = *port;
+  } else {
+    *port = InputPort(expander, now_us);
+  }
+  return result;
+}
+
+/* Like i2c_manager_execute_scan(): a batch stops at the first failure. A
+ * timeout fails every access, a NACK retries each of them on its own. */
+uint32_t KC868_A16_SimTransfer(const bool *access, bool separately,
+                               uint8_t *ports, KC868_A16_SimResult *results,
+                               int64_t now_us) {
+  uint32_t time_us = 0;
+  KC868_A16_SimResult failure = kKc868SimOk;
+  size_t accesses = 0;
+  SIM_LOCK();
+  if (!separately) {
+    uint8_t batch[KC868_A16_SIM_EXPANDER_COUNT];
+    memcpy(batch, ports, sizeof(batch));
+    for (size_t i = 0; i < KC868_A16_SIM_EXPANDER_COUNT; i++) {
+      if (!access[i]) {
+        continue;
+      }
+      if (0 == accesses++) {
+        time_us += TransactionTime();
+      }
+      failure = Access(i, &batch[i], now_us, &time_us);
+      if (kKc868SimOk != failure) {
+        break;
+      }
+    }
+    for (size_t i = 0; i < KC868_A16_SIM_EXPANDER_COUNT; i++) {
+      if (access[i] && kKc868SimNack != failure) {
+        results[i] = failure;
+        if (kKc868SimOk == failure) {
+          ports[i] = batch[i];
+        }
+      }
+    }
+  }
+  if (separately || kKc868SimNack == failure) {
+    for (size_t i = 0; i < KC868_A16_SIM_EXPANDER_COUNT; i++) {
+      if (access[i]) {
+        time_us += TransactionTime();
+        results[i] = Access(i, &ports[i], now_us, &time_us);
+      }
+    }
+  }
+  s_statistics.bus_time_us += time_us;
+  SIM_UNLOCK();
+  return time_us;
+}
+
+void KC868_A16_SimRecoverBus(void) {
+  SIM_LOCK();
+  for (size_t i = 0; i < KC868_A16_SIM_EXPANDER_COUNT; i++) {
+    s_faults[i].until_recovery = false;
+  }
+  s_statistics.bus_recoveries++;
+  SIM_UNLOCK();
+}
+
+uint32_t KC868_A16_SimReadAnalog(uint16_t *values, int64_t now_us) {
+  SIM_LOCK();
+  for (size_t i = 0; i < KC868_A16_SIM_ANALOG_INPUT_COUNT; i++) {
+    values[i] = SignalValue(&s_analog[i], now_us);
+  }
+  const uint32_t time_us = s_latency.adc_us;
+  SIM_UNLOCK();
+  return time_us;
+}
+
+uint16_t KC868_A16_SimGetRelays(void) {
+  SIM_LOCK();
+  const uint16_t ports = (uint16_t)(s_relay_ports[0] | (s_relay_ports[1] << 8));
+  SIM_UNLOCK();
+  return (uint16_t)~ports;
+}
+
+void KC868_A16_SimGetStatistics(KC868_A16_SimStatistics *statistics) {
+  SIM_LOCK();
+  *statistics = s_statistics;
+  SIM_UNLOCK();
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_SIM_H_
+#define KC868_A16_SIM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @file kc868_a16_sim.h
+ *  @brief Model of the KC868-A16 expanders and analog inputs
+ *
+ *  Stands in for the board where there is none: behind the simulated I/O
+ *  backend of the scan task (CONFIG_KC868_IO_BACKEND_SIMULATED, see
+ *  kc868_a16_io_backend.h) and in the sample application of the host build.
+ *  Apart from a lock on the ESP32 the model only depends on the C library.
+ *  The caller passes the time, so a run with the same programming and the
+ *  same seed is repeatable.
+ *
+ *  Ports hold the levels of the expander pins like the PCF8574: relays and
+ *  inputs are active low. Every input follows a programmable signal, a
+ *  relay output or a generator. Latencies are what a transfer would take on
+ *  the bus; the model only computes them, the caller decides whether to
+ *  wait. Faults make the accesses of one expander fail, a number of times,
+ *  at a random rate, or until the bus is recovered.
+ *
+ *  On the ESP32 the functions may be called from any task; the host build
+ *  is single threaded and takes no lock.
+ */
+
+/* Expanders in the order of KC868_A16_Expander: the two relay expanders,
+ * then the two input expanders */
+#define KC868_A16_SIM_EXPANDER_COUNT      4
+#define KC868_A16_SIM_FIRST_INPUT_EXPANDER 2
+#define KC868_A16_SIM_DIGITAL_INPUT_COUNT 16
+#define KC868_A16_SIM_RELAY_COUNT         16
+#define KC868_A16_SIM_ANALOG_INPUT_COUNT  4
+
+/** @brief Outcome of one simulated expander access */
+typedef enum {
+  kKc868SimOk = 0,
+  kKc868SimNack, /**< the expander did not acknowledge */
+  kKc868SimTimeout, /**< the bus was held, the access took the bus timeout */
+} KC868_A16_SimResult;
+
+/** @brief Waveforms of a simulated input */
+typedef enum {
+  kKc868SimSignalConstant = 0, /**< high */
+  kKc868SimSignalSquare, /**< high for the first half of the period, then low */
+  kKc868SimSignalRamp, /**< low to high over the period, then back to low */
+  kKc868SimSignalTriangle, /**< low to high over half a period and back */
+  kKc868SimSignalRelay, /**< digital inputs only: the state of a relay */
+} KC868_A16_SimSignalType;
+
+/** @brief Signal of one input
+ *
+ *  A digital input is on while the value is not 0, so low = 0 and high = 1
+ *  make a switch. Analog values are in the unit the ADC reports, raw counts
+ *  or millivolts. The phase shifts the signal ahead by that much.
+ */
+typedef struct {
+  KC868_A16_SimSignalType type;
+  uint16_t low;
+  uint16_t high;
+  uint32_t period_us; /**< 0 keeps a periodic signal at low */
+  uint32_t phase_us;
+  uint8_t relay; /**< kKc868SimSignalRelay: relay to follow, 0 = Y01 */
+} KC868_A16_SimSignal;
+
+/** @brief Time the simulated bus takes */
+typedef struct {
+  uint32_t transaction_us; /**< start, stop and queueing of one transaction */
+  uint32_t access_us; /**< one byte to or from an expander */
+  uint32_t timeout_us; /**< an access ending in kKc868SimTimeout instead */
+  uint32_t jitter_us; /**< up to this much added to each transaction */
+  uint32_t adc_us; /**< reading all analog inputs */
+} KC868_A16_SimLatency;
+
+/** @brief Failing accesses of one expander
+ *
+ *  The next count accesses fail with result, further ones fail at a rate
+ *  of rate_ppm per million. With until_recovery every access fails until
+ *  the next KC868_A16_SimRecoverBus(), like a device holding SDA low.
+ */
+typedef struct {
+  KC868_A16_SimResult result;
+  uint32_t count;
+  uint32_t rate_ppm;
+  bool until_recovery;
+} KC868_A16_SimFault;
+
+/** @brief Counters since the last KC868_A16_SimReset() */
+typedef struct {
+  uint32_t transactions;
+  uint32_t accesses;
+  uint32_t failed_accesses;
+  uint32_t bus_recoveries;
+  uint64_t bus_time_us; /**< sum of the latencies of all transfers */
+} KC868_A16_SimStatistics;
+
+/** @brief Back to the start state
+ *
+ *  Inputs off, analog inputs 0, relays released, no latency and no faults,
+ *  seed 1, counters cleared.
+ */
+void KC868_A16_SimReset(void);
+
+/** @brief Seed of the random jitter and fault rates */
+void KC868_A16_SimSetSeed(uint32_t seed);
+
+/** @brief Let a digital input follow a signal
+ *
+ *  @param input input to program, 0 = X01
+ *  @param signal its signal, copied
+ */
+void KC868_A16_SimSetDigitalSignal(size_t input,
+                                   const KC868_A16_SimSignal *signal);
+
+/** @brief Let an analog input follow a signal
+ *
+ *  @param channel channel to program, 0 = A1
+ *  @param signal its signal, copied
+ */
+void KC868_A16_SimSetAnalogSignal(size_t channel,
+                                  const KC868_A16_SimSignal *signal);
+
+/** @brief Set the time the bus takes, copied */
+void KC868_A16_SimSetLatency(const KC868_A16_SimLatency *latency);
+
+/** @brief Make the accesses of an expander fail
+ *
+ *  @param expander expander in KC868_A16_Expander order
+ *  @param fault the failures, copied; NULL clears them
+ */
+void KC868_A16_SimSetFault(size_t expander, const KC868_A16_SimFault *fault);
+
+/** @brief Access the expanders like the I/O scan task
+ *
+ *  For every expander with access set, the port value is written to a
+ *  relay expander or read from an input expander. A failed read leaves its
+ *  port value as it is. A batch fails like one of i2c_manager: at a NACK
+ *  every access is retried on its own, a timeout fails all of them.
+ *
+ *  @param access KC868_A16_SIM_EXPANDER_COUNT flags, which expanders to access
+ *  @param separately one transaction per access instead of one for all
+ *  @param ports KC868_A16_SIM_EXPANDER_COUNT port values
+ *  @param results KC868_A16_SIM_EXPANDER_COUNT results, set for the accessed expanders
+ *  @param now_us current time, for the signals
+ *  @return time the transfer takes on the bus
+ */
+uint32_t KC868_A16_SimTransfer(const bool *access, bool separately,
+                               uint8_t *ports, KC868_A16_SimResult *results,
+                               int64_t now_us);
+
+/** @brief Clock the bus free, ends the faults set until_recovery */
+void KC868_A16_SimRecoverBus(void);
+
+/** @brief Sample the analog inputs
+ *
+ *  @param values KC868_A16_SIM_ANALOG_INPUT_COUNT values, A1 first
+ *  @param now_us current time, for the signals
+ *  @return time the conversion takes
+ */
+uint32_t KC868_A16_SimReadAnalog(uint16_t *values, int64_t now_us);
+
+/** @brief Relays as last written, bit 0 = Y01, 1 = energised */
+uint16_t KC868_A16_SimGetRelays(void);
+
+/** @brief Copy the counters */
+void KC868_A16_SimGetStatistics(KC868_A16_SimStatistics *statistics);
+
+#endif /* KC868_A16_SIM_H_ */
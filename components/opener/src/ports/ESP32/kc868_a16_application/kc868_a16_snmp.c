@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_snmp.h"
+
+#if CONFIG_KC868_SNMP
+
+#include <stdint.h>
+#include <string.h>
+
+#include "kc868_a16_mib.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "lwip/apps/snmp.h"
+#include "lwip/apps/snmp_mib2.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"
+#if CONFIG_KC868_SNMP_V3
+#include "lwip/apps/snmpv3.h"
+#include "lwip/apps/snmp_snmpv2_framework.h"
+#include "lwip/apps/snmp_snmpv2_usm.h"
+#endif
+
+#define SNMP_NVS_NAMESPACE  "kc868"
+#define SNMP_NVS_KEY_BOOTS  "snmp_boots"
+
+static const char *TAG_SNMP = "kc868_snmp";
+
+#if CONFIG_KC868_SNMP_V3
+static const struct snmp_mib *s_mibs[] = {
+  &mib2, &snmpframeworkmib, &snmpusmmib, &kc868a16mib,
+};
+#else
+static const struct snmp_mib *s_mibs[] = { &mib2, &kc868a16mib };
+#endif
+
+static bool s_started = false;
+
+#if CONFIG_KC868_SNMP_V3
+#define SNMP_ENGINE_ID_LENGTH  11
+#define SNMP_KEY_LENGTH        20 /* SHA-1; AES-128 uses the first 16 bytes */
+#define SNMP_MIN_PASSWORD      8  /* RFC 3414 11.2 */
+#define SNMP_MAX_BOOTS         2147483647UL /* RFC 3414 2.2.2 */
+
+/* Written before snmp_init(), read by the tcpip thread afterwards */
+static char s_engine_id[SNMP_ENGINE_ID_LENGTH];
+static u32_t s_engine_boots = 0;
+static int64_t s_engine_time_base_us = 0;
+static bool s_user_enabled = false;
+static u8_t s_auth_key[SNMP_KEY_LENGTH];
+static u8_t s_priv_key[SNMP_KEY_LENGTH];
+
+/* RFC 3411 SnmpEngineID: enterprise number with the top bit set, format
+ * 3 (MAC address), the MAC */
+static void SnmpBuildEngineId(void) {
+  uint8_t mac[6] = { 0 };
+  (void) esp_read_mac(mac, ESP_MAC_ETH);
+  s_engine_id[0] = (char) (0x80 | ((SNMP_LWIP_ENTERPRISE_OID >> 24) & 0x7F));
+  s_engine_id[1] = (char) ((SNMP_LWIP_ENTERPRISE_OID >> 16) & 0xFF);
+  s_engine_id[2] = (char) ((SNMP_LWIP_ENTERPRISE_OID >> 8) & 0xFF);
+  s_engine_id[3] = (char) (SNMP_LWIP_ENTERPRISE_OID & 0xFF);
+  s_engine_id[4] = 3;
+  memcpy(&s_engine_id[5], mac, sizeof(mac));
+}
+
+/* Counts this start; a board that cannot store the count keeps 0, which
+ * RFC 3414 leaves to engines without non-volatile storage as well */
+static void SnmpCountBoot(void) {
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(SNMP_NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG_SNMP, "Engine boots not stored: %s", esp_err_to_name(err));
+    return;
+  }
+  uint32_t boots = 0;
+  (void) nvs_get_u32(handle, SNMP_NVS_KEY_BOOTS, &boots);
+  if (boots < SNMP_MAX_BOOTS) {
+    boots++;
+  }
+  err = nvs_set_u32(handle, SNMP_NVS_KEY_BOOTS, boots);
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG_SNMP, "Engine boots not stored: %s", esp_err_to_name(err));
+    return;
+  }
+  s_engine_boots = boots;
+}
+
+/* Each localization hashes a megabyte of password, done once here and not
+ * for every request */
+static void SnmpLocalizeKeys(void) {
+  const char *auth = CONFIG_KC868_SNMP_V3_AUTH_PASSWORD;
+  const char *priv = CONFIG_KC868_SNMP_V3_PRIV_PASSWORD;
+  if (strlen(auth) < SNMP_MIN_PASSWORD || strlen(priv) < SNMP_MIN_PASSWORD) {
+    ESP_LOGE(TAG_SNMP, "SNMPv3 passwords need %d characters, user disabled",
+             SNMP_MIN_PASSWORD);
+    return;
+  }
+  snmpv3_password_to_key_sha((const u8_t *) auth, strlen(auth),
+                             (const u8_t *) s_engine_id, sizeof(s_engine_id),
+                             s_auth_key);
+  snmpv3_password_to_key_sha((const u8_t *) priv, strlen(priv),
+                             (const u8_t *) s_engine_id, sizeof(s_engine_id),
+                             s_priv_key);
+  s_user_enabled = true;
+}
+
+static bool SnmpIsUser(const char *username) {
+  return s_user_enabled &&
+         0 == strcmp(username, CONFIG_KC868_SNMP_V3_USER);
+}
+
+/* The user database the lwIP SNMPv3 code calls, in the tcpip thread */
+
+void snmpv3_get_engine_id(const char **id, u8_t *len) {
+  *id = s_engine_id;
+  *len = sizeof(s_engine_id);
+}
+
+err_t snmpv3_set_engine_id(const char *id, u8_t len) {
+  (void) id;
+  (void) len;
+  return ERR_VAL; /* derived from the MAC */
+}
+
+u32_t snmpv3_get_engine_boots(void) {
+  return s_engine_boots;
+}
+
+/* Only after 68 years of uptime; not stored, the next start counts on
+ * from the stored value */
+void snmpv3_set_engine_boots(u32_t boots) {
+  s_engine_boots = boots;
+}
+
+u32_t snmpv3_get_engine_time(void) {
+  return (u32_t) ((esp_timer_get_time() - s_engine_time_base_us) / 1000000);
+}
+
+void snmpv3_reset_engine_time(void) {
+  s_engine_time_base_us = esp_timer_get_time();
+}
+
+err_t snmpv3_get_user(const char *username, snmpv3_auth_algo_t *auth_algo,
+                      u8_t *auth_key, snmpv3_priv_algo_t *priv_algo,
+                      u8_t *priv_key) {
+  /* An empty user name is the engine ID discovery */
+  if (0 == strlen(username)) {
+    return ERR_OK;
+  }
+  if (!SnmpIsUser(username)) {
+    return ERR_VAL;
+  }
+  if (NULL != auth_algo) {
+    *auth_algo = SNMP_V3_AUTH_ALGO_SHA;
+  }
+  if (NULL != auth_key) {
+    memcpy(auth_key, s_auth_key, sizeof(s_auth_key));
+  }
+  if (NULL != priv_algo) {
+    *priv_algo = SNMP_V3_PRIV_ALGO_AES;
+  }
+  if (NULL != priv_key) {
+    memcpy(priv_key, s_priv_key, sizeof(s_priv_key));
+  }
+  return ERR_OK;
+}
+
+u8_t snmpv3_get_amount_of_users(void) {
+  return s_user_enabled ? 1 : 0;
+}
+
+err_t snmpv3_get_user_storagetype(const char *username,
+                                  snmpv3_user_storagetype_t *storagetype) {
+  if (!SnmpIsUser(username)) {
+    return ERR_VAL;
+  }
+  *storagetype = SNMP_V3_USER_STORAGETYPE_READONLY;
+  return ERR_OK;
+}
+
+err_t snmpv3_get_username(char *username, u8_t index) {
+  if (!s_user_enabled || 0 != index) {
+    return ERR_VAL;
+  }
+  strcpy(username, CONFIG_KC868_SNMP_V3_USER);
+  return ERR_OK;
+}
+#endif /* CONFIG_KC868_SNMP_V3 */
+
+/* tcpip thread only; a disabled version drops its requests */
+static void SnmpEnableVersions(const bool paused) {
+  const bool community = !paused && ('\0' != CONFIG_KC868_SNMP_COMMUNITY[0]);
+  snmp_v1_enable(community ? 1 : 0);
+  snmp_v2c_enable(community ? 1 : 0);
+#if CONFIG_KC868_SNMP_V3
+  snmp_v3_enable(!paused && s_user_enabled ? 1 : 0);
+#endif
+}
+
+static void SnmpPauseInTcpip(void *paused) {
+  SnmpEnableVersions(0U != (uintptr_t)paused);
+}
+
+static err_t SnmpInitInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+  SnmpEnableVersions(false);
+  snmp_set_mibs(s_mibs, LWIP_ARRAYSIZE(s_mibs));
+  snmp_init();
+  return ERR_OK;
+}
+
+void KC868_A16_SnmpStart(void) {
+  if (s_started) {
+    return;
+  }
+  s_started = true;
+#if CONFIG_KC868_SNMP_V3
+  SnmpBuildEngineId();
+  SnmpCountBoot();
+  s_engine_time_base_us = esp_timer_get_time();
+  SnmpLocalizeKeys();
+#endif
+#if CONFIG_KC868_SNMP_V3
+  const bool v3 = s_user_enabled;
+#else
+  const bool v3 = false;
+#endif
+  struct tcpip_api_call_data call;
+  (void) tcpip_api_call(SnmpInitInTcpip, &call);
+  ESP_LOGI(TAG_SNMP, "Agent on UDP port 161, v1/v2c %s, v3 %s",
+           '\0' != CONFIG_KC868_SNMP_COMMUNITY[0] ? "on" : "off",
+           v3 ? "on" : "off");
+}
+
+void KC868_A16_SnmpSetPaused(const bool paused) {
+  if (!s_started) {
+    return;
+  }
+  /* Called with the stack lock held, must not wait for the tcpip thread */
+  if (ERR_OK != tcpip_try_callback(SnmpPauseInTcpip, (void *)(uintptr_t)paused)) {
+    ESP_LOGW(TAG_SNMP, "Agent not %s, tcpip mailbox full", paused ? "paused" : "resumed");
+  }
+}
+
+#endif /* CONFIG_KC868_SNMP */
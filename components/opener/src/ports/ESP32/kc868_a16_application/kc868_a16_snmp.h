@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_SNMP_H_
+#define KC868_A16_SNMP_H_
+
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+
+/** @file kc868_a16_snmp.h
+ *  @brief Read-only SNMP agent next to EtherNet/IP
+ *
+ *  Selected with CONFIG_KC868_SNMP. The lwIP agent runs on the raw API in
+ *  the tcpip thread and serves:
+ *  - MIB-II, with the interface table and the lwIP stack counters;
+ *  - KC868-A16-MIB (docs/mibs/KC868-A16-MIB, generated into
+ *    kc868_a16_mib.c by LwipMibCompiler): the I/O status, the relay and
+ *    input bits, the expander bus counters and one row per open I/O
+ *    connection with its RPI, packet, late and missed counters and the
+ *    largest interval deviation per direction.
+ *
+ *  Every value is a copy: the input image, the bus counters and the
+ *  output assembly through their sequence locks, the connection rows
+ *  through CipConnectionDiagnosticsGet(). A walk never takes a lock the
+ *  OpENer task or the I/O scan task waits for; a copy that races a writer
+ *  answers the previous value.
+ *
+ *  SNMPv1/v2c use CONFIG_KC868_SNMP_COMMUNITY, SNMPv3 one user with SHA
+ *  authentication and AES privacy. The engine ID is the lwIP enterprise
+ *  number with the Ethernet MAC; the engine boots are counted in NVS.
+ */
+
+#if CONFIG_KC868_SNMP
+
+/** @brief Localize the SNMPv3 keys and start the agent
+ *
+ *  Called from ApplicationInitialization(), after NVS is up. The agent
+ *  answers once the network is up.
+ */
+void KC868_A16_SnmpStart(void);
+
+/** @brief Drop or answer SNMP requests again
+ *
+ *  Called by the application when the overload governor sheds services,
+ *  see overload_governor.h. Does not wait for the tcpip thread.
+ *
+ *  @param paused true to drop the requests of every SNMP version
+ */
+void KC868_A16_SnmpSetPaused(const bool paused);
+
+#endif /* CONFIG_KC868_SNMP */
+
+#endif /* KC868_A16_SNMP_H_ */
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kc868_a16_soe.h"
+
+#if CONFIG_KC868_SOE_BUFFER
+
+#include <string.h>
+
+#include "kc868_a16_io.h"
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "endianconv.h"
+#include "enipmessage.h"
+#include "opener_api.h"
+#include "trace.h"
+#include "freertos/FreeRTOS.h"
+#if CONFIG_OPENER_PTP_TIME_SYNC
+#include "ptp_clock.h"
+#elif CONFIG_OPENER_SNTP_CLOCK
+#include "sntp_clock.h"
+#endif
+
+#define SOE_CAPACITY        CONFIG_KC868_SOE_BUFFER_ENTRIES
+/* Events per Read Events reply, 12 bytes each */
+#define SOE_CIP_MAX_EVENTS  32
+
+/* Written by the PCF8574 interrupt task and the scan task, read by the
+ * OpENer task and the web server; every access is a short copy under the
+ * lock */
+static KC868_A16_SoeEvent s_events[SOE_CAPACITY];
+static uint32_t s_next_sequence = 0;
+static EipUint16 s_inputs = 0;
+static portMUX_TYPE s_soe_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const CipUint kSoeCapacityAttribute = SOE_CAPACITY;
+
+void KC868_A16_SoeInitialize(const EipUint8 *digital) {
+  taskENTER_CRITICAL(&s_soe_lock);
+  s_inputs = (EipUint16)(digital[0] | (digital[1] << 8));
+  taskEXIT_CRITICAL(&s_soe_lock);
+}
+
+void KC868_A16_SoeRecord(size_t index, uint8_t value, int64_t time_us) {
+#if CONFIG_OPENER_PTP_TIME_SYNC
+  const EipUint64 time = PtpClockFromLocalTime(time_us) / 1000U;
+#elif CONFIG_OPENER_SNTP_CLOCK
+  const EipUint64 time = (EipUint64)SntpClockFromLocalTime(time_us);
+#else
+  const EipUint64 time = (EipUint64)time_us;
+#endif
+  const unsigned int shift = (unsigned int)(index * 8);
+
+  taskENTER_CRITICAL(&s_soe_lock);
+  const EipUint16 inputs = (EipUint16)((s_inputs & ~(0xFFu << shift)) |
+                                       ((unsigned int)value << shift));
+  const EipUint16 changed = (EipUint16)(inputs ^ s_inputs);
+  if (0 != changed) {
+    KC868_A16_SoeEvent *const event = &s_events[s_next_sequence % SOE_CAPACITY];
+    event->time_us = time;
+    event->inputs = inputs;
+    event->changed = changed;
+    s_inputs = inputs;
+    s_next_sequence++;
+  }
+  taskEXIT_CRITICAL(&s_soe_lock);
+}
+
+size_t KC868_A16_SoeRead(uint32_t *next, KC868_A16_SoeEvent *events,
+                         size_t max_events, uint32_t *lost) {
+  size_t count = 0;
+  *lost = 0;
+
+  taskENTER_CRITICAL(&s_soe_lock);
+  const uint32_t oldest = (s_next_sequence > SOE_CAPACITY) ?
+                          s_next_sequence - SOE_CAPACITY : 0;
+  if (*next < oldest) {
+    *lost = oldest - *next;
+    *next = oldest;
+  } else if (*next > s_next_sequence) {
+    *next = oldest;
+  }
+  while (count < max_events && *next < s_next_sequence) {
+    events[count++] = s_events[*next % SOE_CAPACITY];
+    (*next)++;
+  }
+  taskEXIT_CRITICAL(&s_soe_lock);
+  return count;
+}
+
+static EipStatus SoeReadEventsService(
+  CipInstance *const instance,
+  CipMessageRouterRequest *const message_router_request,
+  CipMessageRouterResponse *const message_router_response,
+  const struct sockaddr *originator_address,
+  const CipSessionHandle encapsulation_session) {
+  (void) instance;
+  (void) originator_address;
+  (void) encapsulation_session;
+
+  ClearENIPMessage(&message_router_response->message);
+  message_router_response->reply_service =
+    (0x80 | message_router_request->service);
+  message_router_response->size_of_additional_status = 0;
+  if (message_router_request->request_data_size < 6) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
+  if (message_router_request->request_data_size > 6) {
+    message_router_response->general_status = kCipErrorTooMuchData;
+    return kEipStatusOkSend;
+  }
+
+  uint32_t next = GetUdintFromMessage(&message_router_request->data);
+  size_t max_events = GetUintFromMessage(&message_router_request->data);
+  if (max_events > SOE_CIP_MAX_EVENTS) {
+    max_events = SOE_CIP_MAX_EVENTS;
+  }
+  KC868_A16_SoeEvent events[SOE_CIP_MAX_EVENTS];
+  uint32_t lost = 0;
+  const size_t count = KC868_A16_SoeRead(&next, events, max_events, &lost);
+
+  ENIPMessage *const message = &message_router_response->message;
+  AddDintToMessage((EipUint32)(next - count), message);
+  AddDintToMessage(lost, message);
+  AddIntToMessage((EipUint16)count, message);
+  for (size_t i = 0; i < count; ++i) {
+    AddLintToMessage(events[i].time_us, message);
+    AddIntToMessage(events[i].inputs, message);
+    AddIntToMessage(events[i].changed, message);
+  }
+  message_router_response->general_status = kCipErrorSuccess;
+  return kEipStatusOkSend;
+}
+
+EipStatus KC868_A16_SoeCreateCipObject(void) {
+  CipClass *soe_class = NULL;
+
+  if ((soe_class = CreateCipClass(kKc868SoeClassCode,
+                                  7, /* # class attributes */
+                                  7, /* # highest class attribute number */
+                                  2, /* # class services */
+                                  2, /* # instance attributes */
+                                  2, /* # highest instance attribute number */
+                                  2, /* # instance services */
+                                  1, /* # instances */
+                                  "Sequence Of Events",
+                                  1, /* # class revision */
+                                  NULL /* # function pointer for initialization */
+                                  )) == 0) {
+    OPENER_TRACE_ERR("SOE: failed to create the CIP object\n");
+    return kEipStatusError;
+  }
+
+  CipInstance *instance = GetCipInstance(soe_class, 1);
+  InsertAttribute(instance, 1, kCipUint, EncodeCipUint, NULL,
+                  (void *)&kSoeCapacityAttribute, kGetableSingleAndAll);
+  /* Number of the next event recorded, aligned and written in one store */
+  InsertAttribute(instance, 2, kCipUdint, EncodeCipUdint, NULL,
+                  &s_next_sequence, kGetableSingleAndAll);
+
+  InsertService(soe_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(soe_class, kKc868SoeReadEventsService, &SoeReadEventsService,
+                "ReadEvents");
+
+  return kEipStatusOk;
+}
+
+#endif /* CONFIG_KC868_SOE_BUFFER */
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KC868_A16_SOE_H_
+#define KC868_A16_SOE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+/** @file kc868_a16_soe.h
+ *  @brief Sequence of events recorder for the KC868-A16 digital inputs
+ *
+ *  Selected with CONFIG_KC868_SOE_BUFFER. Every transition of the 16 digital
+ *  inputs is recorded with its time in a ring of
+ *  CONFIG_KC868_SOE_BUFFER_ENTRIES events, also a pulse that begins and ends
+ *  between two productions. With interrupt driven inputs the PCF8574
+ *  interrupt task records every read it makes after an INT edge, stamped with
+ *  the edge; polled inputs are recorded by the scan task with the time of the
+ *  scan. When the ring is full the oldest events are overwritten.
+ *
+ *  Events are numbered from 0 on. Readers keep the number of the next event
+ *  they want and do not remove events, so the Sequence Of Events object and
+ *  GET /api/soe read independently.
+ *
+ *  Times are microseconds: PTP time with CONFIG_OPENER_PTP_TIME_SYNC, UTC
+ *  since 1970 with CONFIG_OPENER_SNTP_CLOCK once it is set, else the
+ *  esp_timer time since boot.
+ */
+
+#if CONFIG_KC868_SOE_BUFFER
+
+/** @brief Sequence Of Events object class code (vendor specific) */
+static const CipUint kKc868SoeClassCode = 0x66U;
+
+/** @brief Read Events service of the Sequence Of Events object
+ *
+ *  Request: UDINT number of the first event wanted, UINT maximum number of
+ *  events. Response: UDINT number of the first event returned, UDINT events
+ *  lost before it, UINT number of events, then per event ULINT time, WORD
+ *  inputs and WORD changed inputs.
+ */
+static const CipUsint kKc868SoeReadEventsService = 0x4BU;
+
+/** @brief One input transition */
+typedef struct {
+  EipUint64 time_us; /**< time of the transition */
+  EipUint16 inputs; /**< all inputs after it, bit 0 = input 1 */
+  EipUint16 changed; /**< inputs that changed */
+} KC868_A16_SoeEvent;
+
+/** @brief Set the input state later transitions are compared with
+ *
+ *  @param digital KC868_A16_DIGITAL_INPUT_BYTES bytes of the input image
+ */
+void KC868_A16_SoeInitialize(const EipUint8 *digital);
+
+/** @brief Record a new value of one input byte, if it changed
+ *
+ *  May be called from any task.
+ *
+ *  @param index input byte, 0 = inputs 1-8
+ *  @param value new value, bit set = input on
+ *  @param time_us esp_timer_get_time() at which the value was seen
+ */
+void KC868_A16_SoeRecord(size_t index, uint8_t value, int64_t time_us);
+
+/** @brief Copy the next events of a reader
+ *
+ *  A number older than the oldest event held, or newer than the newest one,
+ *  starts at the oldest event held; *lost then counts the events skipped.
+ *
+ *  @param next number of the next event wanted, advanced past the events
+ *         returned
+ *  @param events receives up to max_events events
+ *  @param max_events size of events
+ *  @param lost receives the number of overwritten events skipped
+ *  @return number of events copied
+ */
+size_t KC868_A16_SoeRead(uint32_t *next, KC868_A16_SoeEvent *events,
+                         size_t max_events, uint32_t *lost);
+
+/** @brief Create the Sequence Of Events object, called by the application */
+EipStatus KC868_A16_SoeCreateCipObject(void);
+
+#endif /* CONFIG_KC868_SOE_BUFFER */
+
+#endif /* KC868_A16_SOE_H_ */
@@ -16,6 +16,7 @@
 #include "lwip/sockets.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "sdkconfig.h"
 
 #ifndef RESTRICT
 #if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L
@@ -37,8 +38,13 @@
   #include "test_assert.h"
 #endif
 
+/** DLR beacon-based ring node, see dlr_ring_node.h */
 #ifndef OPENER_IS_DLR_DEVICE
-  #define OPENER_IS_DLR_DEVICE  0
+  #if defined(CONFIG_OPENER_DLR_RING_NODE)
+    #define OPENER_IS_DLR_DEVICE  1
+  #else
+    #define OPENER_IS_DLR_DEVICE  0
+  #endif
 #endif
 
 #if defined(OPENER_IS_DLR_DEVICE) && 0 != OPENER_IS_DLR_DEVICE
@@ -46,7 +52,8 @@
   #define OPENER_ETHLINK_CNTRS_ENABLE     1
   #define OPENER_ETHLINK_IFACE_CTRL_ENABLE  1
   #define OPENER_ETHLINK_LABEL_ENABLE     1
-  #define OPENER_ETHLINK_INSTANCE_CNT     3
+  /* A single PHY: one Ethernet Link instance, not two ring ports */
+  #define OPENER_ETHLINK_INSTANCE_CNT     1
 #endif
 #ifndef OPENER_TCPIP_IFACE_CFG_SETTABLE
   #define OPENER_TCPIP_IFACE_CFG_SETTABLE 1
@@ -64,28 +71,210 @@
   #define OPENER_ETHLINK_CNTRS_ENABLE 1
 #endif
 
+/** Interface Control applied to the PHY, see eth_link_control.h */
 #ifndef OPENER_ETHLINK_IFACE_CTRL_ENABLE
-  #define OPENER_ETHLINK_IFACE_CTRL_ENABLE 0
+  #if defined(CONFIG_OPENER_ETH_LINK_CONTROL)
+    #define OPENER_ETHLINK_IFACE_CTRL_ENABLE 1
+  #else
+    #define OPENER_ETHLINK_IFACE_CTRL_ENABLE 0
+  #endif
+#endif
+
+/** Implicit I/O on lwIP raw UDP callbacks instead of select(), see io_endpoint.h */
+#if defined(CONFIG_OPENER_NETWORK_BACKEND_EVENT)
+  #define OPENER_IO_EVENT_BACKEND 1
+#else
+  #define OPENER_IO_EVENT_BACKEND 0
+#endif
+
+/** TLS and DTLS sessions on port 2221, see secure_transport.h */
+#if defined(CONFIG_OPENER_CIP_SECURITY)
+  #define OPENER_CIP_SECURITY 1
+  #if defined(CONFIG_OPENER_CIP_SECURITY_ONLY)
+    #define OPENER_CIP_SECURITY_ONLY 1
+  #endif
+#else
+  #define OPENER_CIP_SECURITY 0
+#endif
+
+/** Datagrams and microseconds the select() loop spends at most on the shared
+ *  UDP I/O socket per wake-up, see CheckAndHandleConsumingUdpSocket() */
+#if defined(CONFIG_OPENER_IO_RECEIVE_BATCH)
+  #define OPENER_IO_RECEIVE_BATCH CONFIG_OPENER_IO_RECEIVE_BATCH
+  #define OPENER_IO_RECEIVE_BUDGET_US CONFIG_OPENER_IO_RECEIVE_BUDGET_US
+#endif
+
+/** Explicit requests per second and TCP session, and requests of all
+ *  sessions per loop iteration, see tcp_transport.h */
+#define OPENER_EXPLICIT_REQUESTS_PER_SECOND \
+  CONFIG_OPENER_EXPLICIT_REQUESTS_PER_SECOND
+#if defined(CONFIG_OPENER_EXPLICIT_REQUEST_BURST)
+  #define OPENER_EXPLICIT_REQUEST_BURST CONFIG_OPENER_EXPLICIT_REQUEST_BURST
+#endif
+#define OPENER_EXPLICIT_REQUESTS_PER_LOOP CONFIG_OPENER_EXPLICIT_REQUESTS_PER_LOOP
+
+/** Staged shedding of best effort work, see overload_governor.h */
+#if defined(CONFIG_OPENER_OVERLOAD_GOVERNOR)
+  #define OPENER_OVERLOAD_GOVERNOR 1
+  #define OPENER_OVERLOAD_LOOP_BUDGET_US CONFIG_OPENER_OVERLOAD_LOOP_BUDGET_US
+#else
+  #define OPENER_OVERLOAD_GOVERNOR 0
+#endif
+
+/** Wait for the next deadline instead of one timer tick while no connection
+ *  is open, see NetworkHandlerProcessCyclic() */
+#if defined(CONFIG_OPENER_TICKLESS_IDLE)
+  #define OPENER_TICKLESS_IDLE 1
+  #define OPENER_TICKLESS_IDLE_MAX_SLEEP_MS CONFIG_OPENER_TICKLESS_IDLE_MAX_SLEEP_MS
+#else
+  #define OPENER_TICKLESS_IDLE 0
+#endif
+
+/** Cycle counter profiling of the OpENer loop phases, see loop_profile.h */
+#if defined(CONFIG_OPENER_LOOP_PROFILE)
+  #define OPENER_LOOP_PROFILE 1
+#else
+  #define OPENER_LOOP_PROFILE 0
+#endif
+
+/** Worst case execution times of services and callbacks, see
+ *  wcet_profile.h */
+#if defined(CONFIG_OPENER_WCET_PROFILE)
+  #define OPENER_WCET_PROFILE 1
+  #define OPENER_WCET_PROFILE_ENTRIES CONFIG_OPENER_WCET_PROFILE_ENTRIES
+#else
+  #define OPENER_WCET_PROFILE 0
+#endif
+
+/** GPIO toggles along the I/O path, see latency_probe.h */
+#if defined(CONFIG_OPENER_LATENCY_PROBES)
+  #define OPENER_LATENCY_PROBES 1
+#else
+  #define OPENER_LATENCY_PROBES 0
+#endif
+
+/** Stack events for SEGGER SystemView, see trace_event.h */
+#if defined(CONFIG_OPENER_TRACE_EVENTS)
+  #define OPENER_TRACE_EVENTS 1
+#else
+  #define OPENER_TRACE_EVENTS 0
+#endif
+
+/** Stage times of the last Forward Opens, see GetForwardOpenTrace() */
+#define OPENER_FORWARD_OPEN_TRACE_ENTRIES \
+  CONFIG_OPENER_FORWARD_OPEN_TRACE_ENTRIES
+
+/** Microbenchmarks of the stack hot paths at start up, see benchmark.h */
+#if defined(CONFIG_OPENER_BENCHMARK)
+  #define OPENER_BENCHMARK 1
+#else
+  #define OPENER_BENCHMARK 0
 #endif
 
 #define OPENER_CIP_NUM_APPLICATION_SPECIFIC_CONNECTABLE_OBJECTS 1
 
-#define OPENER_CIP_NUM_EXPLICIT_CONNS 6
+/** Connection and session capacity, menu "OpenER Connections" */
+#define OPENER_CIP_NUM_EXPLICIT_CONNS CONFIG_OPENER_NUM_EXPLICIT_CONNS
+
+#define OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS CONFIG_OPENER_NUM_EXCLUSIVE_OWNER_CONNS
+
+#define OPENER_CIP_NUM_INPUT_ONLY_CONNS CONFIG_OPENER_NUM_INPUT_ONLY_CONNS
+
+#define OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH \
+  CONFIG_OPENER_NUM_INPUT_ONLY_CONNS_PER_CON_PATH
+
+#define OPENER_CIP_NUM_LISTEN_ONLY_CONNS CONFIG_OPENER_NUM_LISTEN_ONLY_CONNS
+
+#define OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH \
+  CONFIG_OPENER_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH
+
+#define OPENER_NUMBER_OF_SUPPORTED_SESSIONS CONFIG_OPENER_NUM_SESSIONS
+
+/** lwIP numbers its sockets from LWIP_SOCKET_OFFSET, the socket timers are
+ * looked up by handle in a table of CONFIG_LWIP_MAX_SOCKETS entries */
+#define OPENER_SOCKET_HANDLE_BASE LWIP_SOCKET_OFFSET
+#define OPENER_SOCKET_HANDLE_COUNT CONFIG_LWIP_MAX_SOCKETS
+
+/** Delayed replies to ListIdentity requests over UDP, one per requester */
+#define OPENER_LIST_IDENTITY_QUEUE_DEPTH CONFIG_OPENER_LIST_IDENTITY_QUEUE_DEPTH
+
+/** Milliseconds a timed out I/O connection waits for a re-open of its originator */
+#define OPENER_IO_CONNECTION_STANDBY_MS CONFIG_OPENER_IO_CONNECTION_STANDBY_MS
+
+/** Accept a standby exclusive owner from a redundant originator pair */
+#if defined(CONFIG_OPENER_REDUNDANT_OWNER)
+#define OPENER_CIP_REDUNDANT_OWNER 1
+#else
+#define OPENER_CIP_REDUNDANT_OWNER 0
+#endif
+
+/** Parsed Forward_Open connection paths kept for repeated opens */
+#define OPENER_CONNECTION_PATH_CACHE_SIZE CONFIG_OPENER_CONNECTION_PATH_CACHE_SIZE
 
-#define OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS 1
+/** Staggering of the first production of new cyclic connections, the
+ * producer timer sends at the exact deadline */
+#define OPENER_PRODUCTION_PHASE_SLOTS CONFIG_OPENER_PRODUCTION_PHASE_SLOTS
+#define OPENER_PRODUCTION_PHASE_RESOLUTION_US \
+  CONFIG_OPENER_PRODUCTION_PHASE_RESOLUTION_US
 
-#define OPENER_CIP_NUM_INPUT_ONLY_CONNS 1
+/** Admission control budgets of new I/O connections, 0 for no limit */
+#define OPENER_ADMISSION_MAX_PACKETS_PER_SECOND \
+  CONFIG_OPENER_ADMISSION_MAX_PACKETS_PER_SECOND
+#define OPENER_ADMISSION_CPU_BUDGET_PERCENT \
+  CONFIG_OPENER_ADMISSION_CPU_BUDGET_PERCENT
 
-#define OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH 3
+/** Explicit reads of an assembly reuse its data up to this age, 0 for never */
+#define OPENER_ASSEMBLY_EXPLICIT_READ_MAX_AGE_MS \
+  CONFIG_OPENER_ASSEMBLY_EXPLICIT_READ_MAX_AGE_MS
 
-#define OPENER_CIP_NUM_LISTEN_ONLY_CONNS 1
+/** Bytes of cached GetAttributeAll encoding per instance, 0 disables it */
+#define OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE \
+  CONFIG_OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE
 
-#define OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH   3
+/** Size of the Message Router class registry, one entry per CIP class */
+#define OPENER_CIP_NUM_REGISTERED_CLASSES 16
+
+/** The QoS object, without it frames carry the default DSCP values */
+#if defined(CONFIG_OPENER_QOS_OBJECT)
+  #define OPENER_CIP_QOS_OBJECT 1
+#else
+  #define OPENER_CIP_QOS_OBJECT 0
+#endif
+
+/** DLR, QoS and Connection Diagnostics are created on their first request,
+ *  see RegisterDeferredCipClass() */
+#if defined(CONFIG_OPENER_LAZY_CIP_OBJECTS)
+  #define OPENER_CIP_LAZY_OBJECTS 1
+#else
+  #define OPENER_CIP_LAZY_OBJECTS 0
+#endif
 
-#define OPENER_NUMBER_OF_SUPPORTED_SESSIONS 20
+/** Connection points and assembly sizes as constants of the build, taken
+ *  from kc868_a16_assembly_map.h, see appcontype.c and cipassembly.h */
+#if defined(CONFIG_OPENER_SEALED_CONFIGURATION)
+  #include "kc868_a16_assembly_map.h"
+  #define OPENER_SEALED_CONFIGURATION 1
+  #define OPENER_SEALED_EXCLUSIVE_OWNER_POINTS \
+  KC868_A16_SEALED_EXCLUSIVE_OWNER_POINTS
+  #define OPENER_SEALED_INPUT_ONLY_POINTS KC868_A16_SEALED_INPUT_ONLY_POINTS
+  #define OPENER_SEALED_LISTEN_ONLY_POINTS KC868_A16_SEALED_LISTEN_ONLY_POINTS
+  #define OPENER_SEALED_ASSEMBLIES KC868_A16_SEALED_ASSEMBLIES
+#else
+  #define OPENER_SEALED_CONFIGURATION 0
+#endif
 
 #define PC_OPENER_ETHERNET_BUFFER_SIZE 512
 
+/** Pooled buffers for explicit messages, see messagebufferpool.h. The small
+ *  class holds one frame per TCP session, the larger classes serve the few
+ *  explicit requests and responses that exceed PC_OPENER_ETHERNET_BUFFER_SIZE.
+ */
+#define OPENER_MESSAGE_BUFFER_SMALL_COUNT   OPENER_NUMBER_OF_SUPPORTED_SESSIONS
+#define OPENER_MESSAGE_BUFFER_MEDIUM_SIZE   1536
+#define OPENER_MESSAGE_BUFFER_MEDIUM_COUNT  4
+#define OPENER_MESSAGE_BUFFER_LARGE_SIZE    4096
+#define OPENER_MESSAGE_BUFFER_LARGE_COUNT   3
+
 static const MilliSeconds kOpenerTimerTickInMilliSeconds = 10;
 
 #define OPENER_WITH_TRACES
@@ -96,13 +285,22 @@ static const MilliSeconds kOpenerTimerTickInMilliSeconds = 10;
 #ifdef OPENER_WITH_TRACES
     #include <stdio.h>
 
-    #define LOG_TRACE(...)  fprintf(stderr,__VA_ARGS__)
+/** Record traces in a ring buffer instead of printing them, see trace_buffer.h */
+    #if defined(CONFIG_OPENER_TRACE_BUFFER)
+        #include "trace_buffer.h"
+
+        #define OPENER_TRACE_BUFFER 1
+        #define LOG_TRACE(...)  TraceBufferRecord(__VA_ARGS__)
+    #else
+        #define OPENER_TRACE_BUFFER 0
+        #define LOG_TRACE(...)  fprintf(stderr,__VA_ARGS__)
+    #endif
 
      #ifdef IDLING_ASSERT
         #define OPENER_ASSERT(assertion)                                    \
   do {                                                              \
     if( !(assertion) ) {                                            \
-      LOG_TRACE("Assertion \"%s\" failed: file \"%s\", line %d\n",  \
+      fprintf(stderr, "Assertion \"%s\" failed: file \"%s\", line %d\n", \
                 # assertion, __FILE__, __LINE__);                   \
       while(1) {  }                                                 \
     }                                                               \
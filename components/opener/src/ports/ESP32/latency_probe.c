@@ -0,0 +1,38 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "latency_probe.h"
+
+#if OPENER_LATENCY_PROBES
+
+#include "trace.h"
+#include "driver/gpio.h"
+
+static const int kLatencyProbePins[kLatencyProbeNumberOfProbes] =
+  LATENCY_PROBE_PINS;
+
+void LatencyProbeInitialize(void) {
+  for(size_t i = 0; i < kLatencyProbeNumberOfProbes; ++i) {
+    const int pin = kLatencyProbePins[i];
+    if(pin < 0) {
+      continue;
+    }
+    const gpio_config_t config = {
+      .pin_bit_mask = 1ULL << pin,
+      .mode = GPIO_MODE_OUTPUT,
+      .pull_up_en = GPIO_PULLUP_DISABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = GPIO_INTR_DISABLE,
+    };
+    if(ESP_OK != gpio_config(&config) ) {
+      OPENER_TRACE_ERR("Latency probe: GPIO %d is no output\n", pin);
+      continue;
+    }
+    gpio_set_level( (gpio_num_t) pin, 0 );
+  }
+}
+
+#endif /* OPENER_LATENCY_PROBES */
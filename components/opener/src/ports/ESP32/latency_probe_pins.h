@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_LATENCY_PROBE_PINS_H_
+#define OPENER_LATENCY_PROBE_PINS_H_
+
+/** @file latency_probe_pins.h
+ *  @brief Pins of the latency probes, see latency_probe.h
+ *
+ *  Set in menu "OpenER Tracing", -1 leaves a probe out. Included by
+ *  latency_probe.h after the LatencyProbe enumeration.
+ */
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+
+#define LATENCY_PROBE_PIN_INPUT_INTERRUPT \
+  CONFIG_OPENER_LATENCY_PROBE_INPUT_INTERRUPT_GPIO
+#define LATENCY_PROBE_PIN_INPUT_READ      CONFIG_OPENER_LATENCY_PROBE_INPUT_READ_GPIO
+#define LATENCY_PROBE_PIN_PRODUCE         CONFIG_OPENER_LATENCY_PROBE_PRODUCE_GPIO
+#define LATENCY_PROBE_PIN_TRANSMIT        CONFIG_OPENER_LATENCY_PROBE_TRANSMIT_GPIO
+#define LATENCY_PROBE_PIN_CONSUME         CONFIG_OPENER_LATENCY_PROBE_CONSUME_GPIO
+#define LATENCY_PROBE_PIN_OUTPUT_WRITTEN \
+  CONFIG_OPENER_LATENCY_PROBE_OUTPUT_WRITTEN_GPIO
+
+/* Indexed by LatencyProbe */
+#define LATENCY_PROBE_PINS { \
+    LATENCY_PROBE_PIN_INPUT_INTERRUPT, \
+    LATENCY_PROBE_PIN_INPUT_READ, \
+    LATENCY_PROBE_PIN_PRODUCE, \
+    LATENCY_PROBE_PIN_TRANSMIT, \
+    LATENCY_PROBE_PIN_CONSUME, \
+    LATENCY_PROBE_PIN_OUTPUT_WRITTEN, \
+}
+
+/* Inlined into interrupt handlers in IRAM, the pin folds to a constant */
+static inline __attribute__( (always_inline) )
+void LatencyProbeToggleGpio(const int gpio) {
+  if(gpio < 0) {
+    return;
+  }
+  if(gpio < 32) {
+    const uint32_t bit = 1UL << gpio;
+    REG_WRITE( (REG_READ(GPIO_OUT_REG) & bit) ? GPIO_OUT_W1TC_REG :
+               GPIO_OUT_W1TS_REG, bit );
+  } else {
+    const uint32_t bit = 1UL << (gpio - 32);
+    REG_WRITE( (REG_READ(GPIO_OUT1_REG) & bit) ? GPIO_OUT1_W1TC_REG :
+               GPIO_OUT1_W1TS_REG, bit );
+  }
+}
+
+static inline __attribute__( (always_inline) )
+void LatencyProbeToggle(const LatencyProbe probe) {
+  switch(probe) {
+    case kLatencyProbeInputInterrupt:
+      LatencyProbeToggleGpio(LATENCY_PROBE_PIN_INPUT_INTERRUPT);
+      break;
+    case kLatencyProbeInputRead:
+      LatencyProbeToggleGpio(LATENCY_PROBE_PIN_INPUT_READ);
+      break;
+    case kLatencyProbeProduce:
+      LatencyProbeToggleGpio(LATENCY_PROBE_PIN_PRODUCE);
+      break;
+    case kLatencyProbeTransmit:
+      LatencyProbeToggleGpio(LATENCY_PROBE_PIN_TRANSMIT);
+      break;
+    case kLatencyProbeConsume:
+      LatencyProbeToggleGpio(LATENCY_PROBE_PIN_CONSUME);
+      break;
+    case kLatencyProbeOutputWritten:
+      LatencyProbeToggleGpio(LATENCY_PROBE_PIN_OUTPUT_WRITTEN);
+      break;
+    default:
+      break;
+  }
+}
+
+#endif /* OPENER_LATENCY_PROBE_PINS_H_ */
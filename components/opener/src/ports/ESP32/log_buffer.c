@@ -0,0 +1,262 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "log_buffer.h"
+
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_LOG_BUFFER
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define LOG_BUFFER_ENTRIES CONFIG_OPENER_LOG_BUFFER_ENTRIES
+#if (LOG_BUFFER_ENTRIES & (LOG_BUFFER_ENTRIES - 1) ) != 0
+#error "CONFIG_OPENER_LOG_BUFFER_ENTRIES has to be a power of two"
+#endif
+
+/* An entry takes 64 bytes with its sequence number and length */
+#define LOG_BUFFER_ENTRY_TEXT   59
+/* Longest message kept, the rest is cut off; lives on the logger's stack */
+#define LOG_BUFFER_LINE_LENGTH  256
+
+/* Below every other task of the stack, printing may take milliseconds */
+#define LOG_BUFFER_TASK_PRIO       1
+#define LOG_BUFFER_STACK_SIZE      3072
+#define LOG_BUFFER_DRAIN_PERIOD_MS 50
+
+typedef struct {
+  atomic_uint_least32_t sequence; /* entry index + 1 once complete, 0 while written */
+  uint8_t length;
+  char text[LOG_BUFFER_ENTRY_TEXT];
+} LogBufferEntry;
+
+typedef enum {
+  kLogEntryReady,
+  kLogEntryPending,
+  kLogEntryOverwritten
+} LogEntryState;
+
+static atomic_uint_least32_t s_head; /* index of the next entry to reserve */
+static LogBufferEntry s_entries[LOG_BUFFER_ENTRIES];
+static bool s_installed = false;
+
+/* The vprintf hook, called by ESP_LOGx in the logging task */
+static int LogBufferVprintf(const char *format,
+                            va_list arguments) {
+  char line[LOG_BUFFER_LINE_LENGTH];
+  const int written = vsnprintf(line, sizeof(line), format, arguments);
+  if(written <= 0) {
+    return written;
+  }
+  size_t length = ( (size_t)written < sizeof(line) ) ?
+                  (size_t)written : sizeof(line) - 1;
+  if( (size_t)written >= sizeof(line) ) {
+    line[length - 1] = '\n'; /* keep the line structure of a cut message */
+  }
+
+  /* Consecutive entries, so the pieces of one message stay together */
+  const uint32_t count =
+    (uint32_t)( (length + LOG_BUFFER_ENTRY_TEXT - 1) / LOG_BUFFER_ENTRY_TEXT);
+  const uint32_t first = atomic_fetch_add_explicit(&s_head,
+                                                   count,
+                                                   memory_order_relaxed);
+  const char *piece = line;
+  for(uint32_t index = first; index != first + count; ++index) {
+    LogBufferEntry *const entry = &s_entries[index & (LOG_BUFFER_ENTRIES - 1)];
+    const size_t piece_length = (length < LOG_BUFFER_ENTRY_TEXT) ?
+                                length : LOG_BUFFER_ENTRY_TEXT;
+    atomic_store_explicit(&entry->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(entry->text, piece, piece_length);
+    entry->length = (uint8_t)piece_length;
+    atomic_store_explicit(&entry->sequence, index + 1, memory_order_release);
+    piece += piece_length;
+    length -= piece_length;
+  }
+  return written;
+}
+
+static LogEntryState ReadEntry(const uint32_t index,
+                               LogBufferEntry *const copy) {
+  LogBufferEntry *const entry = &s_entries[index & (LOG_BUFFER_ENTRIES - 1)];
+  const uint32_t sequence = atomic_load_explicit(&entry->sequence,
+                                                 memory_order_acquire);
+  if(index + 1 != sequence) {
+    return (0 != sequence && (int32_t)(sequence - (index + 1) ) > 0) ?
+           kLogEntryOverwritten : kLogEntryPending;
+  }
+  copy->length = entry->length;
+  memcpy(copy->text, entry->text, sizeof(copy->text) );
+  atomic_thread_fence(memory_order_acquire);
+  if(sequence != atomic_load_explicit(&entry->sequence, memory_order_relaxed) ) {
+    return kLogEntryOverwritten; /* a writer lapped us while copying */
+  }
+  if(copy->length > LOG_BUFFER_ENTRY_TEXT) {
+    copy->length = LOG_BUFFER_ENTRY_TEXT;
+  }
+  return kLogEntryReady;
+}
+
+static uint32_t OldestIndex(const uint32_t head) {
+  return (head > LOG_BUFFER_ENTRIES) ? head - LOG_BUFFER_ENTRIES : 0;
+}
+
+void LogBufferCursorInit(LogBufferCursor *const cursor,
+                         const bool from_oldest) {
+  const uint32_t head = atomic_load_explicit(&s_head, memory_order_acquire);
+  cursor->lost = 0;
+  cursor->next = from_oldest ? OldestIndex(head) : head;
+}
+
+void LogBufferCursorSet(LogBufferCursor *const cursor,
+                        const uint32_t next) {
+  const uint32_t head = atomic_load_explicit(&s_head, memory_order_acquire);
+  const uint32_t oldest = OldestIndex(head);
+  cursor->lost = 0;
+  if( (int32_t)(next - head) > 0) {
+    cursor->next = oldest; /* handed out before a reboot */
+  } else if( (int32_t)(oldest - next) > 0) {
+    cursor->lost = oldest - next;
+    cursor->next = oldest;
+  } else {
+    cursor->next = next;
+  }
+}
+
+size_t LogBufferRead(LogBufferCursor *const cursor,
+                     char *const text,
+                     const size_t size) {
+  LogBufferEntry entry;
+  size_t length = 0;
+
+  if(0 == size) {
+    return 0;
+  }
+  text[0] = '\0';
+  for(;; ) {
+    /* Skip what the writers have overwritten already */
+    const uint32_t head = atomic_load_explicit(&s_head, memory_order_acquire);
+    const uint32_t behind = head - cursor->next;
+    if( (int32_t)behind > LOG_BUFFER_ENTRIES) {
+      cursor->lost += behind - LOG_BUFFER_ENTRIES;
+      cursor->next = head - LOG_BUFFER_ENTRIES;
+    }
+
+    LogEntryState state;
+    while(kLogEntryOverwritten == (state = ReadEntry(cursor->next, &entry) ) ) {
+      cursor->next++;
+      cursor->lost++;
+    }
+    if(kLogEntryReady != state || length + entry.length >= size) {
+      break; /* nothing new, a writer is still busy or text is full */
+    }
+    memcpy(&text[length], entry.text, entry.length);
+    length += entry.length;
+    text[length] = '\0';
+    cursor->next++;
+  }
+  return length;
+}
+
+size_t LogBufferCapacity(void) {
+  return (size_t)LOG_BUFFER_ENTRIES * LOG_BUFFER_ENTRY_TEXT;
+}
+
+size_t LogBufferEntryTextSize(void) {
+  return LOG_BUFFER_ENTRY_TEXT;
+}
+
+#if defined(CONFIG_OPENER_LOG_BUFFER_CONSOLE)
+static void LogBufferConsoleTask(void *argument) {
+  (void) argument;
+  static char text[512];
+  LogBufferCursor cursor;
+  uint32_t reported_lost = 0;
+
+  LogBufferCursorInit(&cursor, true);
+  for(;; ) {
+    size_t length = 0;
+    while(0 != (length = LogBufferRead(&cursor, text, sizeof(text) ) ) ) {
+      fwrite(text, 1, length, stdout);
+    }
+    fflush(stdout);
+    if(reported_lost != cursor.lost) {
+      /* The console fell behind the loggers, not printed through the hook */
+      fprintf(stdout, "log: %" PRIu32 " entries not printed\n",
+              cursor.lost - reported_lost);
+      reported_lost = cursor.lost;
+    }
+    vTaskDelay(pdMS_TO_TICKS(LOG_BUFFER_DRAIN_PERIOD_MS) );
+  }
+}
+#endif /* CONFIG_OPENER_LOG_BUFFER_CONSOLE */
+
+void LogBufferInitialize(void) {
+  if(s_installed) {
+    return;
+  }
+#if defined(CONFIG_OPENER_LOG_BUFFER_CONSOLE)
+  if(pdPASS != xTaskCreatePinnedToCore(LogBufferConsoleTask,
+                                       "log console",
+                                       LOG_BUFFER_STACK_SIZE,
+                                       NULL,
+                                       LOG_BUFFER_TASK_PRIO,
+                                       NULL,
+                                       tskNO_AFFINITY) ) {
+    /* Keep the console, a ring nobody prints would hide every message */
+    fprintf(stderr, "log: failed to create the console task\n");
+    return;
+  }
+#endif
+  s_installed = true;
+  esp_log_set_vprintf(LogBufferVprintf);
+}
+
+#else /* CONFIG_OPENER_LOG_BUFFER */
+
+void LogBufferInitialize(void) {
+}
+
+void LogBufferCursorInit(LogBufferCursor *const cursor,
+                         const bool from_oldest) {
+  (void) from_oldest;
+  memset(cursor, 0, sizeof(*cursor) );
+}
+
+void LogBufferCursorSet(LogBufferCursor *const cursor,
+                        const uint32_t next) {
+  (void) next;
+  memset(cursor, 0, sizeof(*cursor) );
+}
+
+size_t LogBufferRead(LogBufferCursor *const cursor,
+                     char *const text,
+                     const size_t size) {
+  (void) cursor;
+  if(0 != size) {
+    text[0] = '\0';
+  }
+  return 0;
+}
+
+size_t LogBufferCapacity(void) {
+  return 0;
+}
+
+size_t LogBufferEntryTextSize(void) {
+  return 0;
+}
+
+#endif /* CONFIG_OPENER_LOG_BUFFER */
@@ -0,0 +1,88 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_LOG_BUFFER_H_
+#define OPENER_LOG_BUFFER_H_
+
+/** @file log_buffer.h
+ *  @brief Ring buffer of the ESP_LOGx output for GET /api/logs
+ *
+ *  Selected with CONFIG_OPENER_LOG_BUFFER. LogBufferInitialize() installs a
+ *  vprintf hook with esp_log_set_vprintf() that formats every log message
+ *  on the caller's stack and copies it into a fixed-size ring of entries.
+ *  Writers reserve their entries with an atomic increment, like the trace
+ *  buffer, and never wait for a lock, the UART or a reader. A message
+ *  longer than one entry takes several consecutive ones. When the ring is
+ *  full the oldest entries are overwritten.
+ *
+ *  The UART only sees the messages when CONFIG_OPENER_LOG_BUFFER_CONSOLE
+ *  starts a low priority task that copies them from the ring, so a slow
+ *  console delays nothing but that task. Every reader has its own cursor and
+ *  does not remove entries; the position of a cursor can be handed to a web
+ *  client and given back with its next request, so the client only fetches
+ *  new lines.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Read position of one reader */
+typedef struct {
+  uint32_t next; /**< index of the next entry to read */
+  uint32_t lost; /**< entries overwritten before this reader got them */
+} LogBufferCursor;
+
+/** @brief Install the log hook and start the console task
+ *
+ * Messages logged before the call go to the console only. Safe to call more
+ * than once.
+ */
+void LogBufferInitialize(void);
+
+/** @brief Position a cursor
+ *
+ * @param cursor cursor to set
+ * @param from_oldest true to start at the oldest entry still held, false to
+ *        start after the newest one
+ */
+void LogBufferCursorInit(LogBufferCursor *const cursor,
+                         const bool from_oldest);
+
+/** @brief Position a cursor at a value of LogBufferCursor::next
+ *
+ * For positions handed out earlier, e.g. to a web client. A position that
+ * was overwritten meanwhile counts the missed entries as lost. A position
+ * ahead of the newest entry stems from before a reboot and starts at the
+ * oldest entry.
+ *
+ * @param cursor cursor to set
+ * @param next entry index to continue at
+ */
+void LogBufferCursorSet(LogBufferCursor *const cursor,
+                        const uint32_t next);
+
+/** @brief Copy the next log text
+ *
+ * Returns the text of whole entries oldest first, stopping at an entry a
+ * writer is still filling. Lines keep the format of the console, including
+ * their line feeds.
+ *
+ * @param cursor cursor of the reader, advanced past the returned entries
+ * @param text receives the NUL terminated text
+ * @param size size of text, at least LogBufferEntryTextSize() + 1
+ * @return number of characters written, 0 if there are no new entries
+ */
+size_t LogBufferRead(LogBufferCursor *const cursor,
+                     char *const text,
+                     const size_t size);
+
+/** @brief Bytes of log text the ring holds when it is full */
+size_t LogBufferCapacity(void);
+
+/** @brief Text bytes of one entry */
+size_t LogBufferEntryTextSize(void);
+
+#endif /* OPENER_LOG_BUFFER_H_ */
@@ -0,0 +1,238 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "loop_profile.h"
+
+#if OPENER_LOOP_PROFILE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "endianconv.h"
+#include "opener_api.h"
+#include "trace.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+
+/* Four buckets per power of two, below 4 cycles one bucket per value */
+#define LOOP_PROFILE_SUB_BUCKET_BITS 2U
+#define LOOP_PROFILE_SUB_BUCKETS (1U << LOOP_PROFILE_SUB_BUCKET_BITS)
+#define LOOP_PROFILE_HISTOGRAM_BUCKETS \
+  ( (32U - LOOP_PROFILE_SUB_BUCKET_BITS + 1U) * LOOP_PROFILE_SUB_BUCKETS)
+
+typedef struct {
+  CipUdint samples;
+  CipUdint overruns;
+  CipUdint minimum; /* all in cycles */
+  CipUdint maximum;
+  uint64_t total;
+  CipUdint histogram[LOOP_PROFILE_HISTOGRAM_BUCKETS];
+} LoopProfileStatistics;
+
+static const char *const kLoopProfilePhaseNames[kLoopProfileNumberOfPhases] = {
+  "select",
+  "tcp",
+  "udp",
+  "manage_connections",
+  "production",
+  "application",
+  "io_scan",
+  "loop"
+};
+
+static const CipUint kLoopProfileNumberOfPhasesAttribute =
+  kLoopProfileNumberOfPhases;
+
+static LoopProfileStatistics s_statistics[kLoopProfileNumberOfPhases];
+static bool s_reset_requested[kLoopProfileNumberOfPhases];
+static CipUdint s_budget[kLoopProfileNumberOfPhases]; /* microseconds, 0 = none */
+
+static size_t GetBucket(const CipUdint cycles) {
+  if(cycles < LOOP_PROFILE_SUB_BUCKETS) {
+    return cycles;
+  }
+  const unsigned int msb = 31U - (unsigned int)__builtin_clz(cycles);
+  const size_t sub_bucket = (cycles >> (msb - LOOP_PROFILE_SUB_BUCKET_BITS) ) &
+                            (LOOP_PROFILE_SUB_BUCKETS - 1U);
+  return (msb - LOOP_PROFILE_SUB_BUCKET_BITS + 1U) * LOOP_PROFILE_SUB_BUCKETS +
+         sub_bucket;
+}
+
+/* Largest number of cycles counted in a bucket */
+static CipUdint GetBucketUpperLimit(const size_t bucket) {
+  if(bucket < LOOP_PROFILE_SUB_BUCKETS) {
+    return (CipUdint)bucket;
+  }
+  const unsigned int shift = bucket / LOOP_PROFILE_SUB_BUCKETS - 1U;
+  const uint64_t lower = (uint64_t)(LOOP_PROFILE_SUB_BUCKETS +
+                                    bucket % LOOP_PROFILE_SUB_BUCKETS) << shift;
+  const uint64_t upper = lower + ( (uint64_t)1 << shift) - 1U;
+  return upper > UINT32_MAX ? UINT32_MAX : (CipUdint)upper;
+}
+
+CipUdint LoopProfileGetCycleCount(void) {
+  return (CipUdint)esp_cpu_get_cycle_count();
+}
+
+void LoopProfileRecord(const LoopProfilePhase phase,
+                       const CipUdint cycles) {
+  LoopProfileStatistics *const statistics = &s_statistics[phase];
+  if(__atomic_exchange_n(&s_reset_requested[phase], false, __ATOMIC_ACQUIRE) ) {
+    memset(statistics, 0, sizeof(*statistics) );
+  }
+
+  if(0 == statistics->samples || cycles < statistics->minimum) {
+    statistics->minimum = cycles;
+  }
+  if(cycles > statistics->maximum) {
+    statistics->maximum = cycles;
+  }
+  statistics->total += cycles;
+  statistics->histogram[GetBucket(cycles)]++;
+  const uint64_t budget = (uint64_t)s_budget[phase] *
+                          esp_rom_get_cpu_ticks_per_us();
+  if(0 != budget && cycles > budget) {
+    statistics->overruns++;
+  }
+  statistics->samples++;
+}
+
+void LoopProfileSetBudget(const LoopProfilePhase phase,
+                          const CipUdint budget) {
+  s_budget[phase] = budget;
+}
+
+const char *LoopProfileGetPhaseName(const LoopProfilePhase phase) {
+  return kLoopProfilePhaseNames[phase];
+}
+
+void LoopProfileGetSummary(const LoopProfilePhase phase,
+                           LoopProfileSummary *const summary) {
+  const LoopProfileStatistics *const statistics = &s_statistics[phase];
+  const CipUdint ticks_per_us = esp_rom_get_cpu_ticks_per_us();
+
+  memset(summary, 0, sizeof(*summary) );
+  const CipUdint samples = statistics->samples;
+  if(0 == samples || 0 == ticks_per_us ||
+     __atomic_load_n(&s_reset_requested[phase], __ATOMIC_RELAXED) ) {
+    return;
+  }
+  summary->samples = samples;
+  summary->overruns = statistics->overruns;
+  summary->minimum = statistics->minimum / ticks_per_us;
+  summary->average = (CipUdint)(statistics->total / samples / ticks_per_us);
+  summary->maximum = statistics->maximum / ticks_per_us;
+
+  const uint64_t rank = ( (uint64_t)samples * 99U + 99U) / 100U;
+  CipUdint percentile_99 = statistics->maximum;
+  uint64_t seen = 0;
+  for(size_t bucket = 0; bucket < LOOP_PROFILE_HISTOGRAM_BUCKETS; ++bucket) {
+    seen += statistics->histogram[bucket];
+    if(seen >= rank) {
+      const CipUdint upper_limit = GetBucketUpperLimit(bucket);
+      if(upper_limit < percentile_99) {
+        percentile_99 = upper_limit;
+      }
+      break;
+    }
+  }
+  summary->percentile_99 = percentile_99 / ticks_per_us;
+}
+
+void LoopProfileReset(void) {
+  for(size_t i = 0; i < kLoopProfileNumberOfPhases; ++i) {
+    __atomic_store_n(&s_reset_requested[i], true, __ATOMIC_RELEASE);
+  }
+}
+
+static void EncodeLoopProfileSummaries(const void *const data,
+                                       ENIPMessage *const outgoing_message) {
+  (void) data;
+  for(size_t i = 0; i < kLoopProfileNumberOfPhases; ++i) {
+    LoopProfileSummary summary;
+    LoopProfileGetSummary( (LoopProfilePhase)i, &summary );
+    EncodeCipUdint(&summary.samples, outgoing_message);
+    EncodeCipUdint(&summary.overruns, outgoing_message);
+    EncodeCipUdint(&summary.minimum, outgoing_message);
+    EncodeCipUdint(&summary.average, outgoing_message);
+    EncodeCipUdint(&summary.maximum, outgoing_message);
+    EncodeCipUdint(&summary.percentile_99, outgoing_message);
+  }
+}
+
+static EipStatus LoopProfileResetService(
+  CipInstance *const instance,
+  CipMessageRouterRequest *const message_router_request,
+  CipMessageRouterResponse *const message_router_response,
+  const struct sockaddr *originator_address,
+  const CipSessionHandle encapsulation_session) {
+  (void) instance;
+  (void) originator_address;
+  (void) encapsulation_session;
+
+  message_router_response->reply_service =
+    (0x80 | message_router_request->service);
+  message_router_response->size_of_additional_status = 0;
+  if(0 != message_router_request->request_data_size) {
+    message_router_response->general_status = kCipErrorTooMuchData;
+  } else {
+    LoopProfileReset();
+    message_router_response->general_status = kCipErrorSuccess;
+  }
+  return kEipStatusOkSend;
+}
+
+EipStatus LoopProfileCreateCipObject(void) {
+  CipClass *profile_class = NULL;
+
+  LoopProfileSetBudget(kLoopProfilePhaseLoop,
+                       kOpenerTimerTickInMilliSeconds * 1000U);
+
+  if( ( profile_class = CreateCipClass(kLoopProfileClassCode,
+                                       7, /* # class attributes */
+                                       7, /* # highest class attribute number */
+                                       2, /* # class services */
+                                       2, /* # instance attributes */
+                                       2, /* # highest instance attribute number */
+                                       3, /* # instance services */
+                                       1, /* # instances */
+                                       "Loop Profile",
+                                       1, /* # class revision */
+                                       NULL /* # function pointer for initialization */
+                                       ) ) == 0 ) {
+    OPENER_TRACE_ERR("Loop profile: failed to create the CIP object\n");
+    return kEipStatusError;
+  }
+
+  CipInstance *instance = GetCipInstance(profile_class, 1);
+  InsertAttribute(instance,
+                  1,
+                  kCipUint,
+                  EncodeCipUint,
+                  NULL,
+                  (void *)&kLoopProfileNumberOfPhasesAttribute,
+                  kGetableSingleAndAll);
+  InsertAttribute(instance,
+                  2,
+                  kCipAny,
+                  EncodeLoopProfileSummaries,
+                  NULL,
+                  s_statistics,
+                  kGetableSingleAndAll);
+
+  InsertService(profile_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(profile_class, kGetAttributeAll, &GetAttributeAll,
+                "GetAttributeAll");
+  InsertService(profile_class, kReset, &LoopProfileResetService, "Reset");
+
+  return kEipStatusOk;
+}
+
+#endif /* OPENER_LOOP_PROFILE */
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "mbox_benchmark.h"
+
+#if CONFIG_OPENER_MBOX_BENCHMARK
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+
+/** Time the uncontended cases run for */
+#define MBOX_BENCHMARK_DURATION_US 200000
+/** Post and fetch pairs between two reads of the clock */
+#define MBOX_BENCHMARK_BATCH 32U
+/** Messages passed per wakeup case */
+#define MBOX_BENCHMARK_MESSAGES 20000U
+#define MBOX_BENCHMARK_PRODUCER_STACK_SIZE 2048
+#if CONFIG_FREERTOS_UNICORE
+#define MBOX_BENCHMARK_PRODUCER_CORE() 0
+#else
+#define MBOX_BENCHMARK_PRODUCER_CORE() (1 - xPortGetCoreID() )
+#endif
+
+typedef struct {
+  const char *name;
+  bool ring; /**< sys_mbox_new_ring() instead of sys_mbox_new() */
+  bool wakeup; /**< posted by a task on the other core */
+} MboxBenchmarkCase;
+
+typedef struct {
+  sys_mbox_t *mbox;
+  SemaphoreHandle_t done; /**< given when the producer no longer uses mbox */
+} MboxBenchmarkProducer;
+
+static const MboxBenchmarkCase kMboxBenchmarkCases[] = {
+  { "mbox queue post + fetch", false, false },
+  { "mbox ring post + fetch", true, false },
+  { "mbox queue wakeup other core", false, true },
+  { "mbox ring wakeup other core", true, true },
+};
+
+/* Any non-NULL message, the mailboxes only pass the pointer */
+static int s_message;
+
+static void MboxBenchmarkProducerTask(void *argument) {
+  MboxBenchmarkProducer *const producer = argument;
+  for(uint32_t i = 0; i < MBOX_BENCHMARK_MESSAGES; ++i) {
+    sys_mbox_post(producer->mbox, &s_message);
+  }
+  xSemaphoreGive(producer->done);
+  vTaskDelete(NULL);
+}
+
+/* Elapsed time of the case, 0 if it could not run */
+static int64_t RunUncontended(sys_mbox_t *const mbox, uint64_t *const operations) {
+  void *message = NULL;
+  const int64_t start = esp_timer_get_time();
+  int64_t elapsed = 0;
+  do {
+    for(uint32_t i = 0; i < MBOX_BENCHMARK_BATCH; ++i) {
+      if(ERR_OK != sys_mbox_trypost(mbox, &s_message) ||
+         SYS_MBOX_EMPTY == sys_arch_mbox_tryfetch(mbox, &message) ) {
+        return 0;
+      }
+    }
+    *operations += MBOX_BENCHMARK_BATCH;
+    elapsed = esp_timer_get_time() - start;
+  } while(elapsed < MBOX_BENCHMARK_DURATION_US);
+  return elapsed;
+}
+
+static int64_t RunWakeup(sys_mbox_t *const mbox, uint64_t *const operations) {
+  MboxBenchmarkProducer producer = {
+    .mbox = mbox,
+    .done = xSemaphoreCreateBinary(),
+  };
+  if(NULL == producer.done) {
+    return 0;
+  }
+  void *message = NULL;
+  const int64_t start = esp_timer_get_time();
+  if(pdPASS !=
+     xTaskCreatePinnedToCore(MboxBenchmarkProducerTask, "mbox_bench",
+                             MBOX_BENCHMARK_PRODUCER_STACK_SIZE, &producer,
+                             uxTaskPriorityGet(NULL), NULL,
+                             MBOX_BENCHMARK_PRODUCER_CORE() ) ) {
+    vSemaphoreDelete(producer.done);
+    return 0;
+  }
+  for(uint32_t i = 0; i < MBOX_BENCHMARK_MESSAGES; ++i) {
+    (void) sys_arch_mbox_fetch(mbox, &message, 0);
+  }
+  const int64_t elapsed = esp_timer_get_time() - start;
+  xSemaphoreTake(producer.done, portMAX_DELAY);
+  vSemaphoreDelete(producer.done);
+  *operations = MBOX_BENCHMARK_MESSAGES;
+  return elapsed;
+}
+
+static void RunCase(const MboxBenchmarkCase *const benchmark_case) {
+  sys_mbox_t mbox = NULL;
+  const err_t result =
+    benchmark_case->ring ? sys_mbox_new_ring(&mbox, TCPIP_MBOX_SIZE) :
+    sys_mbox_new(&mbox, TCPIP_MBOX_SIZE);
+  if(ERR_OK != result) {
+    printf("%-36s failed: out of memory\n", benchmark_case->name);
+    return;
+  }
+
+  uint64_t operations = 0;
+  const int64_t elapsed = benchmark_case->wakeup ?
+                          RunWakeup(&mbox, &operations) :
+                          RunUncontended(&mbox, &operations);
+  sys_mbox_free(&mbox);
+  if(0 == elapsed || 0 == operations) {
+    printf("%-36s failed\n", benchmark_case->name);
+    return;
+  }
+
+  /* tenths of nanoseconds per message */
+  const uint64_t tenth_ns = (uint64_t) elapsed * 10000U / operations;
+  printf("%-36s %12" PRIu64 " %8" PRIu64 ".%" PRIu64 "\n",
+         benchmark_case->name,
+         operations,
+         tenth_ns / 10U,
+         tenth_ns % 10U);
+}
+
+void MboxBenchmarkRunAll(void) {
+  printf("%-36s %12s %10s\n", "case", "operations", "ns/op");
+  for(size_t i = 0;
+      i < sizeof(kMboxBenchmarkCases) / sizeof(kMboxBenchmarkCases[0]);
+      ++i) {
+    RunCase(&kMboxBenchmarkCases[i]);
+  }
+}
+
+#endif /* CONFIG_OPENER_MBOX_BENCHMARK */
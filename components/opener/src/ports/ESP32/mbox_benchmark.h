@@ -0,0 +1,38 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_MBOX_BENCHMARK_H_
+#define OPENER_MBOX_BENCHMARK_H_
+
+/** @file mbox_benchmark.h
+ *  @brief FreeRTOS queue and lock-free ring lwIP mailboxes compared
+ *
+ *  Selected with CONFIG_OPENER_MBOX_BENCHMARK. Every socket call of the
+ *  network handler posts a message to the tcpip mailbox, and every received
+ *  datagram passes the receive mailbox of its UDP socket. With
+ *  CONFIG_OPENER_LWIP_RING_MBOX both are lock-free rings (sys_mbox_new_ring())
+ *  instead of FreeRTOS queues (sys_mbox_new()).
+ *
+ *  The uncontended cases post and fetch in the calling task, which is what a
+ *  message costs when the consumer is busy anyway. The wakeup cases pass
+ *  messages from a task on the other core to the calling task blocked in
+ *  sys_arch_mbox_fetch(), as the tcpip thread waits for the socket calls of
+ *  the OpENer task. The output has the format of BenchmarkRunAll(); compare
+ *  runs of one build on one board only.
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_MBOX_BENCHMARK
+
+/** @brief Run all cases and print one result line per case to stdout
+ *
+ *  Called before the OpENer task is created, takes about a second.
+ */
+void MboxBenchmarkRunAll(void);
+
+#endif /* CONFIG_OPENER_MBOX_BENCHMARK */
+
+#endif /* OPENER_MBOX_BENCHMARK_H_ */
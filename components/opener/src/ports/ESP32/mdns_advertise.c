@@ -0,0 +1,193 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "mdns_advertise.h"
+
+#if CONFIG_OPENER_MDNS
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cipidentity.h"
+#include "generic_networkhandler.h"
+#include "trace.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/apps/mdns.h"
+#include "lwip/priv/tcpip_priv.h"
+
+/* "-" and the last three MAC bytes appended after a host name conflict */
+#define MDNS_ADVERTISE_SUFFIX_LENGTH 7
+
+typedef struct {
+  struct tcpip_api_call_data call; /* has to be the first member */
+  struct netif *netif;
+} MdnsAdvertiseStartRequest;
+
+static const char *const kMdnsAdvertiseStateNames[] = {
+  "off", "probing", "announced", "conflict",
+};
+
+/* Changed by the tcpip thread, read by the web UI, under s_mdns_lock */
+static MdnsAdvertiseStatus s_status;
+static portMUX_TYPE s_mdns_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Only used by the tcpip thread */
+static bool s_started = false;
+static bool s_host_renamed = false;
+static bool s_service_renamed = false;
+static s8_t s_service_slot = -1;
+static char s_instance_name[MDNS_LABEL_MAXLEN + 1];
+
+static void MdnsAdvertiseSetState(const MdnsAdvertiseState state,
+                                  const bool conflict) {
+  taskENTER_CRITICAL(&s_mdns_lock);
+  s_status.state = state;
+  if(conflict) {
+    s_status.conflicts++;
+  }
+  taskEXIT_CRITICAL(&s_mdns_lock);
+}
+
+static void MdnsAdvertiseSetHostName(const char *const name) {
+  taskENTER_CRITICAL(&s_mdns_lock);
+  strncpy(s_status.host_name, name, sizeof(s_status.host_name) - 1);
+  s_status.host_name[sizeof(s_status.host_name) - 1] = '\0';
+  taskEXIT_CRITICAL(&s_mdns_lock);
+}
+
+static void MdnsAdvertiseAddText(struct mdns_service *service,
+                                 const char *const text) {
+  const size_t length = strlen(text);
+  if(ERR_OK != mdns_resp_add_service_txtitem(service, text, (u8_t) length) ) {
+    OPENER_TRACE_WARN("mDNS: TXT item \"%s\" does not fit\n", text);
+  }
+}
+
+/* Called each time a TXT answer is built; the Identity attributes used
+ * are set before the stack starts and never change */
+static void MdnsAdvertiseText(struct mdns_service *service, void *userdata) {
+  (void) userdata;
+  char text[64];
+  MdnsAdvertiseAddText(service, "txtvers=1");
+  snprintf(text, sizeof(text), "vendor=%u", (unsigned) g_identity.vendor_id);
+  MdnsAdvertiseAddText(service, text);
+  snprintf(text, sizeof(text), "devtype=%u",
+           (unsigned) g_identity.device_type);
+  MdnsAdvertiseAddText(service, text);
+  snprintf(text, sizeof(text), "product=%u",
+           (unsigned) g_identity.product_code);
+  MdnsAdvertiseAddText(service, text);
+  snprintf(text, sizeof(text), "rev=%u.%u",
+           (unsigned) g_identity.revision.major_revision,
+           (unsigned) g_identity.revision.minor_revision);
+  MdnsAdvertiseAddText(service, text);
+  snprintf(text, sizeof(text), "serial=%08" PRIX32,
+           g_identity.serial_number);
+  MdnsAdvertiseAddText(service, text);
+  snprintf(text, sizeof(text), "name=%.*s",
+           (int) g_identity.product_name.header.length,
+           (const char *) g_identity.product_name.string);
+  MdnsAdvertiseAddText(service, text);
+}
+
+/* Runs in the tcpip thread; slot 0 is the host, slot n service n - 1 */
+static void MdnsAdvertiseNameResult(struct netif *netif, u8_t result,
+                                    s8_t slot) {
+  if(MDNS_PROBING_SUCCESSFUL == result) {
+    MdnsAdvertiseSetState(kMdnsAdvertiseStateAnnounced, false);
+    return;
+  }
+  if(0 == slot && !s_host_renamed) {
+    char name[MDNS_LABEL_MAXLEN + 1];
+    const char *const host = netif_get_hostname(netif);
+    snprintf(name, sizeof(name), "%.*s-%02x%02x%02x",
+             MDNS_LABEL_MAXLEN - MDNS_ADVERTISE_SUFFIX_LENGTH,
+             NULL != host ? host : "opener",
+             netif->hwaddr[3], netif->hwaddr[4], netif->hwaddr[5]);
+    s_host_renamed = true;
+    MdnsAdvertiseSetState(kMdnsAdvertiseStateProbing, true);
+    MdnsAdvertiseSetHostName(name);
+    OPENER_TRACE_WARN("mDNS: host name taken, probing %s\n", name);
+    (void) mdns_resp_rename_netif(netif, name);
+    return;
+  }
+  if(0 < slot && !s_service_renamed) {
+    char name[MDNS_LABEL_MAXLEN + 1];
+    snprintf(name, sizeof(name), "%.*s (2)",
+             MDNS_LABEL_MAXLEN - 4, s_instance_name);
+    s_service_renamed = true;
+    MdnsAdvertiseSetState(kMdnsAdvertiseStateProbing, true);
+    OPENER_TRACE_WARN("mDNS: instance name taken, probing %s\n", name);
+    (void) mdns_resp_rename_service(netif, (u8_t) (slot - 1), name);
+    return;
+  }
+  /* the responder stays off on the netif until the next start */
+  MdnsAdvertiseSetState(kMdnsAdvertiseStateConflict, true);
+  OPENER_TRACE_ERR("mDNS: names taken, advertisement off\n");
+}
+
+static err_t MdnsAdvertiseStartInTcpip(struct tcpip_api_call_data *call) {
+  MdnsAdvertiseStartRequest *const request =
+    (MdnsAdvertiseStartRequest *) call;
+  struct netif *const netif = request->netif;
+  if(s_started) {
+    return ERR_OK;
+  }
+  s_started = true;
+
+  const char *const host = netif_get_hostname(netif);
+  char name[MDNS_LABEL_MAXLEN + 1];
+  snprintf(name, sizeof(name), "%s", NULL != host ? host : "opener");
+  snprintf(s_instance_name, sizeof(s_instance_name), "%.*s %08" PRIX32,
+           (int) g_identity.product_name.header.length,
+           (const char *) g_identity.product_name.string,
+           g_identity.serial_number);
+
+  mdns_resp_register_name_result_cb(MdnsAdvertiseNameResult);
+  mdns_resp_init();
+  err_t error = mdns_resp_add_netif(netif, name);
+  if(ERR_OK == error) {
+    s_service_slot = mdns_resp_add_service(netif, s_instance_name,
+                                           "_ethernet-ip", DNSSD_PROTO_TCP,
+                                           kOpenerEthernetPort,
+                                           MdnsAdvertiseText, NULL);
+    error = s_service_slot >= 0 ? ERR_OK : (err_t) s_service_slot;
+  }
+  if(ERR_OK != error) {
+    OPENER_TRACE_ERR("mDNS: responder not started: %d\n", (int) error);
+    return error;
+  }
+  MdnsAdvertiseSetHostName(name);
+  MdnsAdvertiseSetState(kMdnsAdvertiseStateProbing, false);
+  return ERR_OK;
+}
+
+void MdnsAdvertiseStart(struct netif *netif) {
+  if(NULL == netif) {
+    return;
+  }
+  MdnsAdvertiseStartRequest request = {
+    .netif = netif,
+  };
+  if(ERR_OK == tcpip_api_call(MdnsAdvertiseStartInTcpip, &request.call) ) {
+    OPENER_TRACE_INFO("mDNS: advertising %s._ethernet-ip._tcp.local\n",
+                      s_instance_name);
+  }
+}
+
+void MdnsAdvertiseGetStatus(MdnsAdvertiseStatus *const status) {
+  taskENTER_CRITICAL(&s_mdns_lock);
+  *status = s_status;
+  taskEXIT_CRITICAL(&s_mdns_lock);
+}
+
+const char *MdnsAdvertiseGetStateName(const MdnsAdvertiseState state) {
+  return state <= kMdnsAdvertiseStateConflict ?
+         kMdnsAdvertiseStateNames[state] : "unknown";
+}
+
+#endif /* CONFIG_OPENER_MDNS */
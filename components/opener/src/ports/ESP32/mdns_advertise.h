@@ -0,0 +1,75 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_MDNS_ADVERTISE_H_
+#define OPENER_MDNS_ADVERTISE_H_
+
+/** @file mdns_advertise.h
+ *  @brief DNS-SD advertisement of the adapter over multicast DNS
+ *
+ *  Selected with CONFIG_OPENER_MDNS. Asset tools that find devices with
+ *  ListIdentity broadcast to every subnet at a fixed interval, and every
+ *  request is answered by the OpENer task. Tools that support DNS-SD can
+ *  browse _ethernet-ip._tcp instead and learn the same identity without
+ *  sending anything to the adapter.
+ *
+ *  The lwIP mDNS responder runs in the tcpip thread and answers on
+ *  224.0.0.251 port 5353, never involving the OpENer task. It announces
+ *  the host and the service after probing, and again only when the netif
+ *  comes up or gets a new address; queries are answered, not polled. The
+ *  service instance is named after the Identity object, "<product name>
+ *  <serial number>", and points to TCP port 44818. Its TXT record holds the
+ *  Identity attributes 1 to 4, 6 and 7:
+ *  txtvers=1 vendor=<id> devtype=<type> product=<code> rev=<major>.<minor>
+ *  serial=<8 hex digits> name=<product name>.
+ *
+ *  The host name is the netif host name. When probing finds it taken,
+ *  the last three bytes of the MAC address are appended once; a second
+ *  conflict leaves mDNS off on the netif. A taken instance name gets the
+ *  suffix " (2)".
+ */
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_MDNS
+
+#include "lwip/netif.h"
+
+typedef enum {
+  kMdnsAdvertiseStateOff = 0,
+  kMdnsAdvertiseStateProbing,
+  kMdnsAdvertiseStateAnnounced,
+  kMdnsAdvertiseStateConflict, /**< the names were taken, mDNS is off */
+} MdnsAdvertiseState;
+
+/** @brief State of the advertisement */
+typedef struct {
+  MdnsAdvertiseState state;
+  char host_name[64]; /**< without .local */
+  CipUdint conflicts; /**< names found taken while probing */
+} MdnsAdvertiseStatus;
+
+/** @brief Start the responder on the netif
+ *
+ *  Called by opener_init() once the stack runs. Safe to call on every
+ *  start, only the first call has an effect; later address changes are
+ *  announced by the responder itself.
+ *
+ *  @param netif lwIP netif of the Ethernet driver
+ */
+void MdnsAdvertiseStart(struct netif *netif);
+
+/** @brief Read the state, safe from any task */
+void MdnsAdvertiseGetStatus(MdnsAdvertiseStatus *const status);
+
+/** @brief Name of a state, as used in the web API */
+const char *MdnsAdvertiseGetStateName(const MdnsAdvertiseState state);
+
+#endif /* CONFIG_OPENER_MDNS */
+
+#endif /* OPENER_MDNS_ADVERTISE_H_ */
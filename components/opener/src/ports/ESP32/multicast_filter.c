@@ -0,0 +1,274 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "multicast_filter.h"
+
+#if CONFIG_OPENER_MULTICAST_FILTER
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#include "esp_eth_com.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/esp_netif_net_stack.h"
+#include "lwip/igmp.h"
+#include "lwip/ip4_addr.h"
+#include "lwip/priv/tcpip_priv.h"
+#include "lwip/prot/ethernet.h"
+
+/* lwIP never has more groups joined than it has group structures */
+#define MULTICAST_FILTER_MAX_GROUPS MEMP_NUM_IGMP_GROUP
+
+/* A MAC address of an IPv4 group, 01:00:5e followed by the low 23 bits of
+ * the group address */
+typedef struct {
+  uint32_t key; /**< low 23 bits of the group address */
+  ip4_addr_t group; /**< first group joined with this address */
+  uint8_t groups; /**< joined groups sharing the address, 0 for a free entry */
+  bool filtered; /**< programmed into the EMAC filter */
+} MulticastFilterEntry;
+
+typedef struct {
+  struct tcpip_api_call_data call; /* has to be the first member */
+  struct netif *netif;
+} MulticastFilterAttachRequest;
+
+static const char *kTag = "mcast_filter";
+
+/* Changed by the tcpip thread, read by the Ethernet receive task and the
+ * web UI, all under s_filter_lock */
+static MulticastFilterEntry s_entries[MULTICAST_FILTER_MAX_GROUPS];
+static CipUdint s_filter_full = 0;
+/* The EMAC starts out passing all multicast */
+static bool s_pass_all_multicast = true;
+/* A group was joined that the table had no room for, nothing is dropped */
+static bool s_untracked = false;
+static portMUX_TYPE s_filter_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Only written by the Ethernet receive task */
+static volatile uint32_t s_dropped_frames = 0;
+
+/* Only used by the tcpip thread */
+static esp_eth_handle_t s_eth_handle = NULL;
+static netif_igmp_mac_filter_fn s_driver_filter = NULL;
+static bool s_attached = false;
+
+static uint32_t MulticastFilterGroupKey(const ip4_addr_t *const group) {
+  return ( (uint32_t) (ip4_addr2(group) & 0x7FU) << 16) |
+         ( (uint32_t) ip4_addr3(group) << 8) | ip4_addr4(group);
+}
+
+/* Caller holds s_filter_lock or is the tcpip thread */
+static MulticastFilterEntry *MulticastFilterFind(const uint32_t key) {
+  for(size_t i = 0; i < MULTICAST_FILTER_MAX_GROUPS; ++i) {
+    if(0 != s_entries[i].groups && key == s_entries[i].key) {
+      return &s_entries[i];
+    }
+  }
+  return NULL;
+}
+
+static MulticastFilterEntry *MulticastFilterFindFree(void) {
+  for(size_t i = 0; i < MULTICAST_FILTER_MAX_GROUPS; ++i) {
+    if(0 == s_entries[i].groups) {
+      return &s_entries[i];
+    }
+  }
+  return NULL;
+}
+
+/* Programs the EMAC filter through the ESP-IDF callback */
+static bool MulticastFilterProgram(struct netif *netif,
+                                   const ip4_addr_t *const group,
+                                   const enum netif_mac_filter_action action) {
+  return ERR_OK == s_driver_filter(netif, group, action);
+}
+
+/* Passes all multicast while a joined group is not in the EMAC filter */
+static void MulticastFilterUpdatePassAll(void) {
+  bool pass_all = s_untracked;
+  for(size_t i = 0; i < MULTICAST_FILTER_MAX_GROUPS && !pass_all; ++i) {
+    pass_all = 0 != s_entries[i].groups && !s_entries[i].filtered;
+  }
+  if(pass_all == s_pass_all_multicast) {
+    return;
+  }
+  if(ESP_OK != esp_eth_ioctl(s_eth_handle, ETH_CMD_S_ALL_MULTICAST, &pass_all) ) {
+    ESP_LOGW(kTag, "Failed to %s pass all multicast",
+             pass_all ? "enable" : "disable");
+    return;
+  }
+  taskENTER_CRITICAL(&s_filter_lock);
+  s_pass_all_multicast = pass_all;
+  taskEXIT_CRITICAL(&s_filter_lock);
+  ESP_LOGI(kTag, "%s", pass_all ? "EMAC filter full, passing all multicast" :
+           "EMAC filters multicast by joined group");
+}
+
+static void MulticastFilterJoin(struct netif *netif,
+                                const ip4_addr_t *const group) {
+  const uint32_t key = MulticastFilterGroupKey(group);
+  MulticastFilterEntry *entry = MulticastFilterFind(key);
+  if(NULL != entry) {
+    taskENTER_CRITICAL(&s_filter_lock);
+    entry->groups++;
+    taskEXIT_CRITICAL(&s_filter_lock);
+    return;
+  }
+  const bool filtered = MulticastFilterProgram(netif, group,
+                                               NETIF_ADD_MAC_FILTER);
+  entry = MulticastFilterFindFree();
+  taskENTER_CRITICAL(&s_filter_lock);
+  if(!filtered) {
+    s_filter_full++;
+  }
+  if(NULL == entry) {
+    s_untracked = true;
+  } else {
+    entry->key = key;
+    ip4_addr_copy(entry->group, *group);
+    entry->groups = 1;
+    entry->filtered = filtered;
+  }
+  taskEXIT_CRITICAL(&s_filter_lock);
+}
+
+static void MulticastFilterLeave(struct netif *netif,
+                                 const ip4_addr_t *const group) {
+  MulticastFilterEntry *entry = MulticastFilterFind(
+    MulticastFilterGroupKey(group) );
+  if(NULL == entry) {
+    (void) MulticastFilterProgram(netif, group, NETIF_DEL_MAC_FILTER);
+    return;
+  }
+  if(1 < entry->groups) {
+    taskENTER_CRITICAL(&s_filter_lock);
+    entry->groups--;
+    taskEXIT_CRITICAL(&s_filter_lock);
+    return;
+  }
+  if(entry->filtered) {
+    (void) MulticastFilterProgram(netif, &entry->group, NETIF_DEL_MAC_FILTER);
+  }
+  taskENTER_CRITICAL(&s_filter_lock);
+  entry->groups = 0;
+  taskEXIT_CRITICAL(&s_filter_lock);
+
+  /* the freed filter entry may take a group that did not fit before */
+  for(size_t i = 0; i < MULTICAST_FILTER_MAX_GROUPS; ++i) {
+    if(0 != s_entries[i].groups && !s_entries[i].filtered &&
+       MulticastFilterProgram(netif, &s_entries[i].group,
+                              NETIF_ADD_MAC_FILTER) ) {
+      taskENTER_CRITICAL(&s_filter_lock);
+      s_entries[i].filtered = true;
+      taskEXIT_CRITICAL(&s_filter_lock);
+    }
+  }
+}
+
+/* Called by lwIP in the tcpip thread for each group joined or left */
+static err_t MulticastFilterMacFilter(struct netif *netif,
+                                      const ip4_addr_t *group,
+                                      enum netif_mac_filter_action action) {
+  if(NETIF_ADD_MAC_FILTER == action) {
+    MulticastFilterJoin(netif, group);
+  } else {
+    MulticastFilterLeave(netif, group);
+  }
+  MulticastFilterUpdatePassAll();
+  /* a group that did not fit is still received while all multicast passes */
+  return ERR_OK;
+}
+
+static err_t MulticastFilterAttachInTcpip(struct tcpip_api_call_data *call) {
+  MulticastFilterAttachRequest *const request =
+    (MulticastFilterAttachRequest *) call;
+  struct netif *const netif = request->netif;
+  if(s_attached || NULL == netif->igmp_mac_filter) {
+    return ERR_OK;
+  }
+  s_attached = true;
+  s_driver_filter = netif->igmp_mac_filter;
+  netif_set_igmp_mac_filter(netif, MulticastFilterMacFilter);
+
+  /* The groups joined so far went to the ESP-IDF callback, whose failures
+   * only end up in the log. Program them again to learn which fit. */
+  for(struct igmp_group *group = netif_igmp_data(netif); NULL != group;
+      group = group->next) {
+    if(NULL == MulticastFilterFind(MulticastFilterGroupKey(
+                                     &group->group_address) ) ) {
+      (void) MulticastFilterProgram(netif, &group->group_address,
+                                    NETIF_DEL_MAC_FILTER);
+    }
+    MulticastFilterJoin(netif, &group->group_address);
+  }
+  MulticastFilterUpdatePassAll();
+  ethernetif_set_input_filter(MulticastFilterInput);
+  return ERR_OK;
+}
+
+void MulticastFilterInitialize(esp_eth_handle_t handle) {
+  s_eth_handle = handle;
+}
+
+void MulticastFilterAttach(struct netif *netif) {
+  if(NULL == s_eth_handle || NULL == netif) {
+    return;
+  }
+  MulticastFilterAttachRequest request = {
+    .netif = netif,
+  };
+  tcpip_api_call(MulticastFilterAttachInTcpip, &request.call);
+}
+
+bool MulticastFilterInput(struct netif *netif, struct pbuf *frame) {
+  (void) netif;
+  if(frame->len < SIZEOF_ETH_HDR) {
+    return false;
+  }
+  const struct eth_hdr *ethernet_header = frame->payload;
+  const u8_t *destination = ethernet_header->dest.addr;
+  if(PP_HTONS(ETHTYPE_IP) != ethernet_header->type ||
+     LL_IP4_MULTICAST_ADDR_0 != destination[0] ||
+     LL_IP4_MULTICAST_ADDR_1 != destination[1] ||
+     LL_IP4_MULTICAST_ADDR_2 != destination[2]) {
+    return false;
+  }
+  const uint32_t key = ( (uint32_t) (destination[3] & 0x7FU) << 16) |
+                       ( (uint32_t) destination[4] << 8) | destination[5];
+  taskENTER_CRITICAL(&s_filter_lock);
+  const bool keep = !s_pass_all_multicast || s_untracked ||
+                    NULL != MulticastFilterFind(key);
+  taskEXIT_CRITICAL(&s_filter_lock);
+  if(keep) {
+    return false;
+  }
+  s_dropped_frames++;
+  pbuf_free(frame);
+  return true;
+}
+
+void MulticastFilterGetStatistics(MulticastFilterStatistics *const statistics) {
+  *statistics = (MulticastFilterStatistics) {
+    0
+  };
+  taskENTER_CRITICAL(&s_filter_lock);
+  for(size_t i = 0; i < MULTICAST_FILTER_MAX_GROUPS; ++i) {
+    if(0 != s_entries[i].groups) {
+      statistics->groups++;
+      if(s_entries[i].filtered) {
+        statistics->filtered_groups++;
+      }
+    }
+  }
+  statistics->filter_full = s_filter_full;
+  statistics->pass_all_multicast = s_pass_all_multicast;
+  taskEXIT_CRITICAL(&s_filter_lock);
+  statistics->dropped_frames = s_dropped_frames;
+}
+
+#endif /* CONFIG_OPENER_MULTICAST_FILTER */
@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_MULTICAST_FILTER_H_
+#define OPENER_MULTICAST_FILTER_H_
+
+/** @file multicast_filter.h
+ *  @brief EMAC multicast address filter following the joined IPv4 groups
+ *
+ *  Selected with CONFIG_OPENER_MULTICAST_FILTER. The ESP32 EMAC passes all
+ *  multicast frames by default, so every multicast producer of another
+ *  adapter on the VLAN costs a receive descriptor, a pbuf and a trip
+ *  through lwIP until ip4_input() finds the group is not joined.
+ *
+ *  The module takes over the IGMP MAC filter callback of the lwIP netif.
+ *  Each group lwIP joins or leaves, whether by a consuming connection, PTP
+ *  or mDNS, still goes to the ESP-IDF callback and from there into the
+ *  EMAC perfect address filter. Groups sharing a MAC address are counted,
+ *  the filter entry is only removed with the last one. While all joined
+ *  groups fit in the filter, pass all multicast is turned off and the
+ *  EMAC drops unwanted groups in hardware. Once the filter is full the
+ *  EMAC passes all multicast again until a group is left.
+ *
+ *  While all multicast passes, IPv4 multicast frames for a group that is
+ *  not joined are dropped in the Ethernet receive task, before the tcpip
+ *  mailbox, and counted. Frames the EMAC drops itself are not counted, it
+ *  has no statistics for them.
+ *
+ *  A producing adapter does not join its own multicast groups, the
+ *  filter only changes what this device receives.
+ */
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_MULTICAST_FILTER
+
+#include "esp_eth_driver.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+/** @brief State of the filter and frames dropped since boot */
+typedef struct {
+  CipUdint groups; /**< MAC addresses of joined IPv4 groups */
+  CipUdint filtered_groups; /**< of these, programmed into the EMAC filter */
+  CipUdint filter_full; /**< groups the EMAC filter had no room for */
+  CipUdint dropped_frames; /**< multicast frames for groups not joined */
+  bool pass_all_multicast; /**< the EMAC passes every multicast frame */
+} MulticastFilterStatistics;
+
+/** @brief Keep the driver the filter is programmed through
+ *
+ *  @param handle installed Ethernet driver
+ */
+void MulticastFilterInitialize(esp_eth_handle_t handle);
+
+/** @brief Take over the IGMP MAC filter callback of the netif
+ *
+ *  Called once the netif is up, e.g. when it got its address. The groups
+ *  already joined are taken over. Safe to call more than once, only the
+ *  first call has an effect.
+ *
+ *  @param netif lwIP netif of the Ethernet driver
+ */
+void MulticastFilterAttach(struct netif *netif);
+
+/** @brief Ethernet input filter dropping unwanted multicast
+ *
+ *  Runs in the Ethernet receive task. Installed by MulticastFilterAttach();
+ *  an input filter that replaces it calls it first.
+ *
+ *  @param netif receiving netif
+ *  @param frame received frame
+ *  @return true if the frame was dropped and freed
+ */
+bool MulticastFilterInput(struct netif *netif, struct pbuf *frame);
+
+/** @brief Copy the state and counters */
+void MulticastFilterGetStatistics(MulticastFilterStatistics *const statistics);
+
+#endif /* CONFIG_OPENER_MULTICAST_FILTER */
+
+#endif /* OPENER_MULTICAST_FILTER_H_ */
@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "netif_status.h"
+
+#include <string.h>
+
+#include "seqlock.h"
+#include "trace.h"
+#include "esp_event.h"
+
+/* Written by NetifStatusInitialize() and then only by the default event
+ * loop task, so the writers are serialized */
+static NetifStatus s_status;
+static SeqLock s_status_lock;
+static esp_netif_t *s_netif = NULL;
+static esp_eth_handle_t s_eth_handle = NULL;
+
+static CipUdint NetifStatusNameServer(const esp_netif_dns_type_t type) {
+  esp_netif_dns_info_t dns_info;
+  if(ESP_OK != esp_netif_get_dns_info(s_netif, type, &dns_info) ||
+     ESP_IPADDR_TYPE_V4 != dns_info.ip.type) {
+    return 0;
+  }
+  return dns_info.ip.u_addr.ip4.addr;
+}
+
+/* The values not carried by the events */
+static void NetifStatusReadNames(NetifStatus *const status) {
+  const char *hostname = NULL;
+  if(ESP_OK != esp_netif_get_hostname(s_netif, &hostname) ||
+     NULL == hostname) {
+    hostname = "";
+  }
+  strncpy(status->hostname, hostname, sizeof(status->hostname) - 1);
+  status->hostname[sizeof(status->hostname) - 1] = '\0';
+  status->name_server = NetifStatusNameServer(ESP_NETIF_DNS_MAIN);
+  status->name_server_2 = NetifStatusNameServer(ESP_NETIF_DNS_BACKUP);
+}
+
+static void NetifStatusReadLink(NetifStatus *const status,
+                                esp_eth_handle_t handle) {
+  eth_speed_t speed = ETH_SPEED_10M;
+  eth_duplex_t duplex = ETH_DUPLEX_HALF;
+  status->link_up = true;
+  status->link_speed = 0;
+  status->full_duplex = false;
+  if(ESP_OK == esp_eth_ioctl(handle, ETH_CMD_G_SPEED, &speed) ) {
+    status->link_speed = ETH_SPEED_100M == speed ? 100U : 10U;
+  }
+  if(ESP_OK == esp_eth_ioctl(handle, ETH_CMD_G_DUPLEX_MODE, &duplex) ) {
+    status->full_duplex = ETH_DUPLEX_FULL == duplex;
+  }
+}
+
+static void NetifStatusPublish(const NetifStatus *const status) {
+  SeqLockWrite(&s_status_lock, &s_status, status, sizeof(s_status) );
+}
+
+static void NetifStatusEventHandler(void *argument,
+                                    esp_event_base_t event_base,
+                                    int32_t event_id,
+                                    void *event_data) {
+  (void) argument;
+  NetifStatus status = s_status;
+  if(ETH_EVENT == event_base) {
+    if(s_eth_handle != *(esp_eth_handle_t *) event_data) {
+      return;
+    }
+    if(ETHERNET_EVENT_CONNECTED == event_id) {
+      NetifStatusReadLink(&status, s_eth_handle);
+    } else {
+      status.link_up = false;
+      status.link_speed = 0;
+      status.full_duplex = false;
+    }
+  } else if(IP_EVENT_ETH_GOT_IP == event_id) {
+    const ip_event_got_ip_t *const event = event_data;
+    if(s_netif != event->esp_netif) {
+      return;
+    }
+    status.ip_address = event->ip_info.ip.addr;
+    status.network_mask = event->ip_info.netmask.addr;
+    status.gateway = event->ip_info.gw.addr;
+  } else {
+    const ip_event_got_ip_t *const event = event_data;
+    if(s_netif != event->esp_netif) {
+      return;
+    }
+    status.ip_address = 0;
+    status.network_mask = 0;
+    status.gateway = 0;
+  }
+  /* DHCP may have brought new DNS servers with the address */
+  NetifStatusReadNames(&status);
+  NetifStatusPublish(&status);
+}
+
+void NetifStatusInitialize(esp_netif_t *netif, esp_eth_handle_t eth_handle) {
+  s_netif = netif;
+  s_eth_handle = eth_handle;
+  NetifStatus status = { 0 };
+  NetifStatusReadNames(&status);
+  NetifStatusPublish(&status);
+
+  static const int32_t kEthEvents[] = {
+    ETHERNET_EVENT_CONNECTED, ETHERNET_EVENT_DISCONNECTED
+  };
+  static const int32_t kIpEvents[] = {
+    IP_EVENT_ETH_GOT_IP, IP_EVENT_ETH_LOST_IP
+  };
+  esp_err_t result = ESP_OK;
+  for(size_t i = 0; i < sizeof(kEthEvents) / sizeof(kEthEvents[0]); ++i) {
+    if(ESP_OK == result) {
+      result = esp_event_handler_register(ETH_EVENT, kEthEvents[i],
+                                          NetifStatusEventHandler, NULL);
+    }
+  }
+  for(size_t i = 0; i < sizeof(kIpEvents) / sizeof(kIpEvents[0]); ++i) {
+    if(ESP_OK == result) {
+      result = esp_event_handler_register(IP_EVENT, kIpEvents[i],
+                                          NetifStatusEventHandler, NULL);
+    }
+  }
+  if(ESP_OK != result) {
+    OPENER_TRACE_ERR("Netif status: registering the event handlers failed\n");
+  }
+}
+
+bool NetifStatusGet(NetifStatus *const status) {
+  return NULL != s_netif &&
+         SeqLockRead(&s_status_lock, status, &s_status, sizeof(*status),
+                     NULL);
+}
@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_NETIF_STATUS_H_
+#define OPENER_NETIF_STATUS_H_
+
+/** @file netif_status.h
+ *  @brief Status of the Ethernet netif, kept current by its events
+ *
+ *  Several esp_netif getters, esp_netif_get_dns_info() among them, run as
+ *  a synchronous call in the tcpip thread, which processes no packets until
+ *  the call returns. Reading struct netif from another task instead may see
+ *  an address half changed by the tcpip thread.
+ *
+ *  The default event loop task updates this snapshot when the link goes up
+ *  or down and when the address is assigned or lost, querying the DNS
+ *  servers, the hostname and the negotiated speed and duplex once per
+ *  event. Readers, such as IfaceGetConfiguration(), GetHostName() and
+ *  GET /api/ipconfig, copy it under a sequence lock and never wait for or
+ *  call into the tcpip thread.
+ */
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+#include "esp_eth_driver.h"
+#include "esp_netif.h"
+
+/** Room for the 64 characters of TCP/IP attribute 6 and the terminator */
+#define NETIF_STATUS_HOSTNAME_SIZE 65U
+
+typedef struct {
+  CipUdint ip_address; /**< network byte order, 0 without an address */
+  CipUdint network_mask; /**< network byte order */
+  CipUdint gateway; /**< network byte order */
+  CipUdint name_server; /**< network byte order, 0 if none */
+  CipUdint name_server_2; /**< network byte order, 0 if none */
+  char hostname[NETIF_STATUS_HOSTNAME_SIZE];
+  CipUint link_speed; /**< negotiated speed in Mbit/s, 0 while down */
+  bool full_duplex;
+  bool link_up;
+} NetifStatus;
+
+/** @brief Take the first snapshot and follow the events of netif
+ *
+ *  Call from app_main before registering other handlers of the Ethernet
+ *  and IP events, so that they already see the new status. Events of
+ *  other interfaces, such as the management port, are ignored.
+ *
+ *  @param netif the EtherNet/IP esp_netif, with the hostname set
+ *  @param eth_handle its Ethernet driver
+ */
+void NetifStatusInitialize(esp_netif_t *netif, esp_eth_handle_t eth_handle);
+
+/** @brief Copy the current status, safe from any task
+ *
+ *  @param status receives the copy
+ *  @return true on success, false before NetifStatusInitialize() or if an
+ *          update was in progress during every attempt
+ */
+bool NetifStatusGet(NetifStatus *const status);
+
+#endif /* OPENER_NETIF_STATUS_H_ */
@@ -14,6 +14,7 @@
 #include "ciperror.h"
 #include "trace.h"
 #include "opener_api.h"
+#include "netif_status.h"
 #include "lwip/netif.h"
 #include "lwip/ip4_addr.h"
 
@@ -43,23 +44,39 @@ static EipStatus GetGatewayFromRoute(TcpIpInterface *iface,
 EipStatus IfaceGetConfiguration(TcpIpInterface *iface,
                                 CipTcpIpInterfaceConfiguration *iface_cfg) {
   CipTcpIpInterfaceConfiguration local_cfg;
-  EipStatus status;
+  EipStatus status = kEipStatusOk;
+  NetifStatus netif_status;
 
   memset(&local_cfg, 0x00, sizeof local_cfg);
 
-  status = GetIpAndNetmaskFromInterface(iface, &local_cfg);
-  if (kEipStatusOk == status) {
-    status = GetGatewayFromRoute(iface, &local_cfg);
+  /* The snapshot kept by the netif events, struct netif only before the
+   * first one */
+  if (NetifStatusGet(&netif_status) ) {
+    local_cfg.ip_address = netif_status.ip_address;
+    local_cfg.network_mask = netif_status.network_mask;
+    local_cfg.gateway = netif_status.gateway;
+    local_cfg.name_server = netif_status.name_server;
+    local_cfg.name_server_2 = netif_status.name_server_2;
+  } else {
+    status = GetIpAndNetmaskFromInterface(iface, &local_cfg);
+    if (kEipStatusOk == status) {
+      status = GetGatewayFromRoute(iface, &local_cfg);
+    }
   }
   if (kEipStatusOk == status) {
-    ClearCipString(&iface_cfg->domain_name);
     *iface_cfg = local_cfg;
   }
   return status;
 }
 
 void GetHostName(TcpIpInterface *iface,
-                 CipString *hostname) {
-  SetCipStringByCstr(hostname, netif_get_hostname(iface));
+                 CipTcpIpHostName *hostname) {
+  NetifStatus netif_status;
+  const char *name = NULL;
+  if (NetifStatusGet(&netif_status) ) {
+    name = netif_status.hostname;
+  } else {
+    name = netif_get_hostname(iface);
+  }
+  (void) CIP_STRING_FIXED_SET_BY_CSTR(hostname, NULL != name ? name : "");
 }
-
@@ -12,13 +12,73 @@
 #include "opener_user_conf.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
+#include "production_scheduler.h"
+#include "loop_profile.h"
+#include "originator_arp.h"
+#include "power_management.h"
+
+#if CONFIG_OPENER_QOS_8021Q_TAGGING
+#include "cipqos.h"
+#include "lwip/pbuf.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/ip4.h"
+#endif
+
+MicroSeconds GetMicroSeconds(void) {
+  return (MicroSeconds) esp_timer_get_time();
+}
 
 MilliSeconds GetMilliSeconds(void) {
-  return (MilliSeconds)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+  /* derived from the microsecond timer instead of the 10 ms RTOS tick */
+  return (MilliSeconds) (GetMicroSeconds() / 1000ULL);
 }
 
 EipStatus NetworkHandlerInitializePlatform(void) {
-  return kEipStatusOk;
+  return ProductionSchedulerInitialize();
+}
+
+void NetworkHandlerEnterStack(void) {
+  ProductionSchedulerLock();
+}
+
+void NetworkHandlerLeaveStack(void) {
+  ProductionSchedulerUpdate();
+  ProductionSchedulerUnlock();
+}
+
+void GetIoPacketProcessingTime(CipUdint *const production_time,
+                               CipUdint *const consumption_time) {
+#if OPENER_LOOP_PROFILE
+  /* a production wake up usually sends one packet, the UDP phase handles
+   * the datagrams one readable socket or I/O event brought */
+  LoopProfileSummary summary;
+  LoopProfileGetSummary(kLoopProfilePhaseProduction, &summary);
+  *production_time = summary.average;
+  LoopProfileGetSummary(kLoopProfilePhaseUdp, &summary);
+  *consumption_time = summary.average;
+#else
+  *production_time = 0;
+  *consumption_time = 0;
+#endif
+}
+
+void IoConnectionOriginatorChanged(
+  const struct sockaddr_in *const originator_address,
+  const bool established) {
+#if CONFIG_OPENER_PM_IO_PERFORMANCE
+  PowerManagementIoConnectionChanged(established);
+#endif
+#if CONFIG_OPENER_ARP_PIN_ORIGINATORS
+  if(established) {
+    OriginatorArpAcquire(originator_address->sin_addr.s_addr);
+  } else {
+    OriginatorArpRelease(originator_address->sin_addr.s_addr);
+  }
+#else
+  (void) originator_address;
+  (void) established;
+#endif
 }
 
 void ShutdownSocketPlatform(int socket_handle) {
@@ -49,3 +109,27 @@ int SetQosOnSocket(const int socket,
   return setsockopt(socket, IPPROTO_IP, IP_TOS, &set_tos, sizeof(set_tos));
 }
 
+#if CONFIG_OPENER_QOS_8021Q_TAGGING
+/* Called by ethernet_output() in the tcpip thread for every frame, see
+ * LWIP_HOOK_VLAN_SET. The DSCP set by SetQosOnSocket() or the I/O endpoint
+ * selects the priority, so every connection is tagged by its own class. */
+s32_t lwip_hook_vlan_set(struct netif *netif,
+                         struct pbuf *p,
+                         const struct eth_addr *src,
+                         const struct eth_addr *dst,
+                         u16_t eth_type) {
+  (void) netif;
+  (void) src;
+  (void) dst;
+  if(ETHTYPE_IP != eth_type || p->len < IP_HLEN) {
+    return -1;
+  }
+  const struct ip_hdr *ip_header = p->payload;
+  const int priority = CipQosGetVlanPriority(IPH_TOS(ip_header) >> 2);
+  if(priority < 0) {
+    return -1;
+  }
+  /* VLAN ID 0: priority tagged, the switch keeps the port's VLAN */
+  return (s32_t) priority << 13;
+}
+#endif /* CONFIG_OPENER_QOS_8021Q_TAGGING */
@@ -0,0 +1,61 @@
+/*******************************************************************************
+ * Copyright (c) 2019, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+/** @file ESP32/nvqos.c
+ *  @brief QoS object NV data in the configuration record
+ *
+ *  Replaces ports/nvdata/nvqos.c, whose configuration file under nvdata/
+ *  cannot be opened on the board. The attributes are the QoS section of
+ *  the record, see nvconfig.h.
+ */
+#include "nvqos.h"
+
+#include "nvconfig.h"
+#include "trace.h"
+
+/** @brief Load NV data of the QoS object from the configuration record
+ *
+ *  @param  p_qos pointer to the QoS object's data structure
+ *  @return kEipStatusOk: success; kEipStatusError: nothing stored
+ */
+EipStatus NvQosLoad(CipQosObject *p_qos) {
+  NvConfigQos config;
+  if(!NvConfigGet(kNvConfigSectionQos, &config, sizeof(config) ) ) {
+    return kEipStatusError;
+  }
+  if(config.q_frames_enable > 1) {
+    OPENER_TRACE_WARN("NvQosLoad: ignoring invalid 802.1Q Tag Enable\n");
+    return kEipStatusError;
+  }
+  p_qos->q_frames_enable = config.q_frames_enable;
+  p_qos->dscp.urgent = config.dscp_urgent;
+  p_qos->dscp.scheduled = config.dscp_scheduled;
+  p_qos->dscp.high = config.dscp_high;
+  p_qos->dscp.low = config.dscp_low;
+  p_qos->dscp.explicit_msg = config.dscp_explicit;
+  return kEipStatusOk;
+}
+
+/** @brief Store NV data of the QoS object
+ *
+ *  Changes the record in RAM and leaves the flash write to the record's
+ *  writer task, the caller is the stack and must not wait for it.
+ *
+ *  @param  p_qos pointer to the QoS object's data structure
+ *  @return kEipStatusOk: write scheduled; kEipStatusError: failure
+ */
+EipStatus NvQosStore(const CipQosObject *p_qos) {
+  const NvConfigQos config = {
+    .q_frames_enable = p_qos->q_frames_enable,
+    .dscp_urgent = p_qos->dscp.urgent,
+    .dscp_scheduled = p_qos->dscp.scheduled,
+    .dscp_high = p_qos->dscp.high,
+    .dscp_low = p_qos->dscp.low,
+    .dscp_explicit = p_qos->dscp.explicit_msg,
+  };
+  (void)NvConfigSet(kNvConfigSectionQos, &config, sizeof(config) );
+  return NvConfigCommitDeferred();
+}
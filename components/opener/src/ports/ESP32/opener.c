@@ -7,26 +7,55 @@
 #include "opener_api.h"
 #include "cipcommon.h"
 #include "cipethernetlink.h"
+#include "eth_link_control.h"
 #include "ciptcpipinterface.h"
+#include "cipqos.h"
+#include "cipmessagerouter.h"
 #include "trace.h"
 #include "networkconfig.h"
 #include "doublylinkedlist.h"
 #include "cipconnectionobject.h"
 #include "nvdata.h"
 #include "nvtcpip.h"
+#include "production_scheduler.h"
+#include "trace_buffer.h"
+#include "benchmark.h"
+#include "security_benchmark.h"
+#include "mbox_benchmark.h"
+#include "cip_arena.h"
+#include "ptp_clock.h"
+#include "task_telemetry.h"
+#include "power_management.h"
+#include "ota_update.h"
+#include "mdns_advertise.h"
+#include "sntp_clock.h"
+#include "task_placement.h"
+#include "latency_probe.h"
+#include "trace_event.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "freertos/portable.h"
 #include "esp_random.h"
+#include "esp_log.h"
+#include "esp_timer.h"
 
-#define OPENER_THREAD_PRIO			5
 #define OPENER_STACK_SIZE			  8192  // Increased from 2000 to prevent stack overflow
 
+static const char *kTag = "opener";
+
 static void opener_thread(void *argument);
+static void log_connection_memory_budget(void);
 static SemaphoreHandle_t opener_init_mutex = NULL;
 static SemaphoreHandle_t opener_init_mutex_creation_mutex = NULL;
 static bool opener_initialized = false;
+/* CIP objects and assemblies exist, guarded by opener_init_mutex */
+static bool cip_stack_prepared = false;
+#if CONFIG_OPENER_LINK_DOWN_SUSPEND
+/* The link went down while the stack ran, guarded by opener_init_mutex */
+static bool link_suspended = false;
+static int64_t link_suspended_at = 0;
+#endif
 TaskHandle_t opener_task_handle = NULL;
 volatile int g_end_stack = 0;
 
@@ -52,7 +81,160 @@ static SemaphoreHandle_t get_opener_init_mutex(void) {
   return opener_init_mutex;
 }
 
+/* Static RAM of the connection and session tables sized in menu
+ * "OpenER Connections", the consumed sockets are printed by the build */
+static void log_connection_memory_budget(void) {
+  const size_t io_connections = OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS +
+                                OPENER_CIP_NUM_INPUT_ONLY_CONNS *
+                                OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH +
+                                OPENER_CIP_NUM_LISTEN_ONLY_CONNS *
+                                OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH;
+  const size_t connection_bytes = (OPENER_CIP_NUM_EXPLICIT_CONNS + io_connections) *
+                                  sizeof(CipConnectionObject);
+  const size_t node_bytes = OPENER_CIP_NUM_ACTIVE_CONNS *
+                            sizeof(DoublyLinkedListNode);
+  const size_t session_bytes = OPENER_NUMBER_OF_SUPPORTED_SESSIONS *
+                               (sizeof(SocketTimer) + sizeof(TcpReceiveBuffer) ) +
+                               OPENER_MESSAGE_BUFFER_SMALL_COUNT *
+                               PC_OPENER_ETHERNET_BUFFER_SIZE;
+  ESP_LOGI(kTag,
+           "%u I/O + %u explicit connections: %u B objects, %u B list nodes; "
+           "%u sessions: %u B",
+           (unsigned)io_connections, (unsigned)OPENER_CIP_NUM_EXPLICIT_CONNS,
+           (unsigned)connection_bytes, (unsigned)node_bytes,
+           (unsigned)OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+           (unsigned)session_bytes);
+}
+
+#if CONFIG_OPENER_LAZY_CIP_OBJECTS && CONFIG_OPENER_QOS_OBJECT
+/* Creates the QoS object on its first request, with the NV data callback */
+static EipStatus create_qos_class(void) {
+  const EipStatus status = CipQoSInit();
+  if (kEipStatusOk == status) {
+    InsertGetSetCallback(GetCipClass(kCipQoSClassCode), NvQosSetCallback,
+                         kNvDataFunc);
+  }
+  return status;
+}
+#endif
+
+/* The part of the start up that needs no network: CIP objects, assemblies
+ * and the application. Caller holds opener_init_mutex. */
+static void prepare_cip_stack(void) {
+  if (cip_stack_prepared) {
+    return;
+  }
+  log_connection_memory_budget();
+
+  DoublyLinkedListInitialize(&connection_list,
+                             CipConnectionObjectListArrayAllocator,
+                             CipConnectionObjectListArrayFree);
+
+  SetDeviceSerialNumber(123456789);
+
+  // Use hardware random number generator instead of rand()
+  EipUint16 unique_connection_id = (EipUint16)(esp_random() & 0xFFFF);
+
+#if CONFIG_OPENER_CIP_ARENA
+  CipArenaBeginInit();
+#endif
+  (void)CipStackInit(unique_connection_id);
+
+  CipClass *tcp_ip_class = GetCipClass(kCipTcpIpInterfaceClassCode);
+  if (NULL != tcp_ip_class) {
+    InsertGetSetCallback(tcp_ip_class, NvTcpipSetCallback, kNvDataFunc);
+  }
+#if CONFIG_OPENER_LAZY_CIP_OBJECTS
+#if CONFIG_OPENER_QOS_OBJECT
+  // Looking the class up would create it, take over its creation instead
+  (void)RegisterDeferredCipClass(kCipQoSClassCode, create_qos_class);
+#endif
+#else
+  CipClass *qos_class = GetCipClass(kCipQoSClassCode);
+  if (NULL != qos_class) {
+    InsertGetSetCallback(qos_class, NvQosSetCallback, kNvDataFunc);
+  }
+#endif
+  // The QoS attributes from the configuration record, put in use by
+  // NetworkHandlerInitialize()
+  (void)NvdataLoad();
+#if CONFIG_OPENER_ETH_LINK_CONTROL
+  (void)EthLinkControlBind();
+#endif
+#if CONFIG_OPENER_CIP_ARENA
+  CipArenaFreeze();
+#endif
+  cip_stack_prepared = true;
+  ESP_LOGI(kTag, "CIP objects ready %lld ms after power-on",
+           esp_timer_get_time() / 1000);
+}
+
+#if CONFIG_OPENER_LINK_DOWN_SUSPEND
+/* Continues a suspended stack if netif got its old address back. Caller
+ * holds opener_init_mutex. */
+static bool resume_cip_stack(struct netif *netif) {
+  if (!IfaceLinkIsUp(netif) ||
+      ip4_addr_get_u32(netif_ip4_addr(netif)) != g_network_status.ip_address) {
+    return false;
+  }
+  link_suspended = false;
+  ESP_LOGI(kTag, "Link back after %lld ms, EtherNet/IP resumed",
+           (esp_timer_get_time() - link_suspended_at) / 1000);
+  return true;
+}
+
+/* Runs in the OpENer task after each cycle. A link loss only suspends the
+ * stack: objects, assemblies, sessions and sockets stay, connections time
+ * out on their own watchdogs. A static address resumes here once the link
+ * is back, an address from DHCP in opener_init() when it is assigned again. */
+static void track_link_state(struct netif *netif) {
+  const bool link_up = IfaceLinkIsUp(netif);
+  if (link_up == !link_suspended) {
+    return;
+  }
+  if (xSemaphoreTake(opener_init_mutex, portMAX_DELAY) != pdTRUE) {
+    return;
+  }
+  if (!link_up && !link_suspended) {
+    link_suspended = true;
+    link_suspended_at = esp_timer_get_time();
+    ESP_LOGW(kTag, "Network link is down, EtherNet/IP suspended");
+  } else if (link_up && link_suspended) {
+    (void)resume_cip_stack(netif);
+  }
+  xSemaphoreGive(opener_init_mutex);
+}
+#endif
+
+void opener_prepare(void) {
+  TraceBufferInitialize();
+
+  opener_init_mutex = get_opener_init_mutex();
+  if (opener_init_mutex == NULL) {
+    OPENER_TRACE_ERR("Failed to create opener init mutex\n");
+    return;
+  }
+  if (xSemaphoreTake(opener_init_mutex, portMAX_DELAY) != pdTRUE) {
+    return;
+  }
+  if (!opener_initialized) {
+    prepare_cip_stack();
+  }
+  xSemaphoreGive(opener_init_mutex);
+}
+
 void opener_init(struct netif *netif) {
+  TraceBufferInitialize();
+#if OPENER_LATENCY_PROBES
+  LatencyProbeInitialize();
+#endif
+#if OPENER_TRACE_EVENTS
+  TraceEventInitialize();
+#endif
+#if CONFIG_OPENER_TASK_TELEMETRY
+  TaskTelemetryInitialize();
+#endif
+
   opener_init_mutex = get_opener_init_mutex();
   if (opener_init_mutex == NULL) {
     OPENER_TRACE_ERR("Failed to create opener init mutex\n");
@@ -65,6 +247,25 @@ void opener_init(struct netif *netif) {
     return;
   }
 
+#if CONFIG_OPENER_LINK_DOWN_SUSPEND
+  if (opener_initialized && link_suspended) {
+    if (resume_cip_stack(netif)) {
+      xSemaphoreGive(opener_init_mutex);
+      return;
+    }
+    // The sockets are bound to the old address, restart the stack on the
+    // new one. The OpENer task takes the mutex on its way out.
+    g_end_stack = 1;
+    xSemaphoreGive(opener_init_mutex);
+    while (opener_task_handle != NULL) {
+      vTaskDelay(1);
+    }
+    if (xSemaphoreTake(opener_init_mutex, portMAX_DELAY) != pdTRUE) {
+      return;
+    }
+  }
+#endif
+
   // Check if already initialized
   if (opener_initialized) {
     OPENER_TRACE_WARN("Opener already initialized, skipping\n");
@@ -75,36 +276,21 @@ void opener_init(struct netif *netif) {
   EipStatus eip_status = 0;
 
   if (IfaceLinkIsUp(netif)) {
-    DoublyLinkedListInitialize(&connection_list,
-                               CipConnectionObjectListArrayAllocator,
-                               CipConnectionObjectListArrayFree);
+    // Already done by opener_prepare() in a fast boot
+    prepare_cip_stack();
 
     uint8_t iface_mac[6];
     IfaceGetMacAddress(netif, iface_mac);
-
-    SetDeviceSerialNumber(123456789);
-
-    // Use hardware random number generator instead of rand()
-    EipUint16 unique_connection_id = (EipUint16)(esp_random() & 0xFFFF);
-
-    EipStatus eip_status = CipStackInit(unique_connection_id);
-
-    CipClass *tcp_ip_class = GetCipClass(kCipTcpIpInterfaceClassCode);
-    if (NULL != tcp_ip_class) {
-      InsertGetSetCallback(tcp_ip_class, NvTcpipSetCallback, kNvDataFunc);
-    }
-
     CipEthernetLinkSetMac(iface_mac);
 
     GetHostName(netif, &g_tcpip.hostname);
 
     g_end_stack = 0;
 
-    // NOTE: g_tcpip access here is safe because:
-    // 1. This runs during initialization before OpENer task starts
-    // 2. WebUI is initialized after OpENer, so no concurrent access yet
-    // 3. Once OpENer task starts, g_tcpip is only modified via NvTcpipStore()
-    //    which should be protected by mutex if called from WebUI
+    // On a restart after link up the web UI already runs: publish the loaded
+    // configuration as one snapshot and keep its writes out meanwhile
+    ProductionSchedulerLock();
+    CipTcpIpBeginUpdate();
     EipStatus nv_status = NvTcpipLoad(&g_tcpip);
     if (kEipStatusOk == nv_status) {
       OPENER_TRACE_INFO("Loaded TCP/IP configuration from NVS\n");
@@ -113,10 +299,28 @@ void opener_init(struct netif *netif) {
     }
 
     eip_status = IfaceGetConfiguration(netif, &g_tcpip.interface_configuration);
+    CipTcpIpEndUpdate();
+    ProductionSchedulerUnlock();
     if (eip_status < 0) {
       OPENER_TRACE_WARN("Problems getting interface configuration\n");
     }
 
+#if OPENER_BENCHMARK
+    // Before the OpENer task exists, nothing else runs in the stack
+    BenchmarkRunAll();
+#endif
+#if CONFIG_OPENER_SECURITY_BENCHMARK
+    SecurityBenchmarkRunAll();
+#endif
+#if CONFIG_OPENER_MBOX_BENCHMARK
+    MboxBenchmarkRunAll();
+#endif
+#if CONFIG_OPENER_PM_IO_PERFORMANCE
+    // After the benchmarks, they run at the default clock; a failure leaves
+    // the CPU at CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+    (void) PowerManagementInitialize();
+#endif
+
     eip_status = NetworkHandlerInitialize();
   }
   else {
@@ -124,18 +328,38 @@ void opener_init(struct netif *netif) {
     g_end_stack = 1;
   }
   if ((g_end_stack == 0) && (eip_status == kEipStatusOk)) {
-    // Pin OpENer task to Core 0 (same as LWIP TCP/IP task)
+#if CONFIG_OPENER_PTP_TIME_SYNC
+    PtpClockStart();
+#endif
+#if CONFIG_OPENER_MDNS
+    MdnsAdvertiseStart(netif);
+#endif
+#if CONFIG_OPENER_SNTP_CLOCK
+    SntpClockStart();
+#endif
+    TaskPlacement placement;
+    TaskPlacementGet(kTaskPlacementTaskOpener, &placement);
     BaseType_t result = xTaskCreatePinnedToCore(opener_thread,
                                                  "OpENer",
                                                  OPENER_STACK_SIZE,
                                                  netif,
-                                                 OPENER_THREAD_PRIO,
+                                                 placement.priority,
                                                  &opener_task_handle,
-                                                 0);  // Core 0
+                                                 placement.core);
     if (result == pdPASS) {
       opener_initialized = true;
-      OPENER_TRACE_INFO("OpENer: opener_thread started on Core 0, free heap size: %d\n",
-             xPortGetFreeHeapSize());
+#if CONFIG_OPENER_TASK_TELEMETRY
+      TaskTelemetryRegister(kTaskTelemetryOpener, OPENER_STACK_SIZE);
+#endif
+      ESP_LOGI(kTag, "EtherNet/IP ready %lld ms after power-on",
+               esp_timer_get_time() / 1000);
+#if CONFIG_OPENER_OTA_UPDATE
+      // An updated image that gets this far is kept, else it is rolled back
+      OtaUpdateConfirmRunningImage();
+#endif
+      OPENER_TRACE_INFO("OpENer: opener_thread started on core %d, priority %d, "
+                        "free heap size: %d\n", (int) placement.core,
+                        (int) placement.priority, xPortGetFreeHeapSize());
     } else {
       OPENER_TRACE_ERR("Failed to create OpENer task\n");
     }
@@ -146,6 +370,11 @@ void opener_init(struct netif *netif) {
   xSemaphoreGive(opener_init_mutex);
 }
 
+void opener_stop(void) {
+  // opener_thread notices it after the current NetworkHandlerProcessCyclic()
+  g_end_stack = 1;
+}
+
 static void opener_thread(void *argument) {
   struct netif *netif = (struct netif*) argument;
   while (!g_end_stack) {
@@ -153,18 +382,30 @@ static void opener_thread(void *argument) {
       OPENER_TRACE_ERR("Error in NetworkHandler loop! Exiting OpENer!\n");
       g_end_stack = 1;
     }
+#if CONFIG_OPENER_LINK_DOWN_SUSPEND
+    track_link_state(netif);
+#else
     if (!IfaceLinkIsUp(netif)) {
       OPENER_TRACE_INFO("Network link is down, exiting OpENer\n");
       g_end_stack = 1;
     }
+#endif
   }
+  ProductionSchedulerStop();
   NetworkHandlerFinish();
+#if CONFIG_OPENER_PTP_TIME_SYNC
+  PtpClockStop();
+#endif
   ShutdownCipStack();
   
   // Mark as not initialized and clear task handle atomically
   if (opener_init_mutex != NULL) {
     if (xSemaphoreTake(opener_init_mutex, portMAX_DELAY) == pdTRUE) {
+      cip_stack_prepared = false;
       opener_initialized = false;
+#if CONFIG_OPENER_LINK_DOWN_SUSPEND
+      link_suspended = false;
+#endif
       opener_task_handle = NULL;
       xSemaphoreGive(opener_init_mutex);
     }
@@ -3,8 +3,21 @@
 
 #include "lwip/netif.h"
 
+/** Create the CIP objects, assemblies and the application before the link is
+ *  up, so that opener_init() only has to open the sockets. Optional;
+ *  opener_init() does the same if it was not called. */
+void opener_prepare(void);
+
+/** Start the EtherNet/IP stack on netif once it has its address. With
+ *  CONFIG_OPENER_LINK_DOWN_SUSPEND a stack suspended by a link loss resumes
+ *  if netif has the old address again, else it is restarted on the new one. */
 void opener_init(struct netif *netif);
 
+/** Stop the EtherNet/IP stack, e.g. when the address is lost to a conflict.
+ *  The OpENer task closes the sockets and exits after its current cycle;
+ *  opener_init() starts the stack again. */
+void opener_stop(void);
+
 #endif
 
 
@@ -11,6 +11,8 @@
 
 #include "opener_error.h"
 
+#include "heap_class.h"
+
 const int kErrorMessageBufferSize = 255;
 
 int GetSocketErrorNumber(void) {
@@ -18,12 +20,16 @@ int GetSocketErrorNumber(void) {
 }
 
 char* GetErrorMessage(int error_number) {
-  char *error_message = malloc(kErrorMessageBufferSize);
+  char *error_message = heap_class_malloc(HEAP_CLASS_NETWORK,
+                                          kErrorMessageBufferSize);
+  if(NULL == error_message) {
+    return NULL;
+  }
   strerror_r(error_number, error_message, kErrorMessageBufferSize);
   return error_message;
 }
 
 void FreeErrorMessage(char *error_message) {
-  free(error_message);
+  heap_class_free(HEAP_CLASS_NETWORK, error_message);
 }
 
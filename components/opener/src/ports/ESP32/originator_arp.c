@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "originator_arp.h"
+
+#if CONFIG_OPENER_ARP_PIN_ORIGINATORS
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "trace.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/etharp.h"
+#include "lwip/ip4.h"
+#include "lwip/priv/tcpip_priv.h"
+#include "lwip/timeouts.h"
+
+#if !ETHARP_SUPPORT_STATIC_ENTRIES
+#error "CONFIG_OPENER_ARP_PIN_ORIGINATORS needs ETHARP_SUPPORT_STATIC_ENTRIES"
+#endif
+
+/* Retry period of addresses not resolved yet */
+#define ORIGINATOR_ARP_RETRY_MS 1000U
+
+/* The next hop of one or more originators */
+typedef struct {
+  ip4_addr_t address; /**< originator or gateway */
+  struct netif *netif;
+  uint8_t connections; /**< established I/O connections, 0 for a free entry */
+  bool pinned; /**< has a static ARP entry */
+} OriginatorArpEntry;
+
+typedef struct {
+  struct tcpip_api_call_data call; /* has to be the first member */
+  ip4_addr_t address;
+} OriginatorArpRequest;
+
+/* Changed by the tcpip thread, read by the web UI, under s_arp_lock */
+static OriginatorArpEntry s_entries[ORIGINATOR_ARP_MAX_ENTRIES];
+static CipUdint s_table_full = 0;
+static portMUX_TYPE s_arp_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Only used by the tcpip thread */
+static bool s_retry_scheduled = false;
+
+/* The address whose MAC address frames to the originator carry */
+static bool OriginatorArpNextHop(const ip4_addr_t *const address,
+                                 ip4_addr_t *const next_hop,
+                                 struct netif **const netif) {
+  *netif = ip4_route(address);
+  if(NULL == *netif || ip4_addr_isany(address) ||
+     ip4_addr_ismulticast(address) ||
+     ip4_addr_isbroadcast(address, *netif) ) {
+    return false;
+  }
+  if(ip4_addr_net_eq(address, netif_ip4_addr(*netif),
+                     netif_ip4_netmask(*netif) ) ) {
+    ip4_addr_copy(*next_hop, *address);
+    return true;
+  }
+  if(ip4_addr_isany(netif_ip4_gw(*netif) ) ) {
+    return false;
+  }
+  ip4_addr_copy(*next_hop, *netif_ip4_gw(*netif) );
+  return true;
+}
+
+static OriginatorArpEntry *OriginatorArpFind(const ip4_addr_t *const address) {
+  for(size_t i = 0; i < ORIGINATOR_ARP_MAX_ENTRIES; ++i) {
+    if(0 != s_entries[i].connections &&
+       ip4_addr_eq(&s_entries[i].address, address) ) {
+      return &s_entries[i];
+    }
+  }
+  return NULL;
+}
+
+/* Makes the learned entry static, or asks for it again */
+static bool OriginatorArpPin(OriginatorArpEntry *const entry) {
+  struct eth_addr *mac_address = NULL;
+  const ip4_addr_t *entry_address = NULL;
+  if(0 > etharp_find_addr(entry->netif, &entry->address, &mac_address,
+                          &entry_address) ) {
+    etharp_request(entry->netif, &entry->address);
+    return false;
+  }
+  /* copied, the pointer is into the ARP table being updated */
+  struct eth_addr learned;
+  SMEMCPY(&learned, mac_address, sizeof(learned) );
+  if(ERR_OK != etharp_add_static_entry(&entry->address, &learned) ) {
+    return false;
+  }
+  OPENER_TRACE_INFO("Originator ARP: pinned %s\n",
+                    ip4addr_ntoa(&entry->address) );
+  taskENTER_CRITICAL(&s_arp_lock);
+  entry->pinned = true;
+  taskEXIT_CRITICAL(&s_arp_lock);
+  return true;
+}
+
+static void OriginatorArpRetry(void *argument) {
+  (void) argument;
+  s_retry_scheduled = false;
+  bool pending = false;
+  for(size_t i = 0; i < ORIGINATOR_ARP_MAX_ENTRIES; ++i) {
+    if(0 != s_entries[i].connections && !s_entries[i].pinned &&
+       !OriginatorArpPin(&s_entries[i]) ) {
+      pending = true;
+    }
+  }
+  if(pending) {
+    s_retry_scheduled = true;
+    sys_timeout(ORIGINATOR_ARP_RETRY_MS, OriginatorArpRetry, NULL);
+  }
+}
+
+static err_t OriginatorArpAcquireInTcpip(struct tcpip_api_call_data *call) {
+  OriginatorArpRequest *const request = (OriginatorArpRequest *) call;
+  ip4_addr_t next_hop;
+  struct netif *netif = NULL;
+  if(!OriginatorArpNextHop(&request->address, &next_hop, &netif) ) {
+    return ERR_OK;
+  }
+  OriginatorArpEntry *entry = OriginatorArpFind(&next_hop);
+  if(NULL != entry) {
+    taskENTER_CRITICAL(&s_arp_lock);
+    entry->connections++;
+    taskEXIT_CRITICAL(&s_arp_lock);
+    return ERR_OK;
+  }
+  for(size_t i = 0; i < ORIGINATOR_ARP_MAX_ENTRIES && NULL == entry; ++i) {
+    if(0 == s_entries[i].connections) {
+      entry = &s_entries[i];
+    }
+  }
+  taskENTER_CRITICAL(&s_arp_lock);
+  if(NULL == entry) {
+    s_table_full++;
+  } else {
+    ip4_addr_copy(entry->address, next_hop);
+    entry->netif = netif;
+    entry->connections = 1;
+    entry->pinned = false;
+  }
+  taskEXIT_CRITICAL(&s_arp_lock);
+  if(NULL != entry && !OriginatorArpPin(entry) && !s_retry_scheduled) {
+    s_retry_scheduled = true;
+    sys_timeout(ORIGINATOR_ARP_RETRY_MS, OriginatorArpRetry, NULL);
+  }
+  return ERR_OK;
+}
+
+static err_t OriginatorArpReleaseInTcpip(struct tcpip_api_call_data *call) {
+  OriginatorArpRequest *const request = (OriginatorArpRequest *) call;
+  ip4_addr_t next_hop;
+  struct netif *netif = NULL;
+  if(!OriginatorArpNextHop(&request->address, &next_hop, &netif) ) {
+    return ERR_OK;
+  }
+  OriginatorArpEntry *const entry = OriginatorArpFind(&next_hop);
+  if(NULL == entry) {
+    return ERR_OK;
+  }
+  const bool unpin = 1 == entry->connections && entry->pinned;
+  taskENTER_CRITICAL(&s_arp_lock);
+  entry->connections--;
+  if(0 == entry->connections) {
+    entry->pinned = false;
+  }
+  taskEXIT_CRITICAL(&s_arp_lock);
+  if(unpin) {
+    /* the next packet resolves it again, as for any other peer */
+    (void) etharp_remove_static_entry(&next_hop);
+    OPENER_TRACE_INFO("Originator ARP: released %s\n",
+                      ip4addr_ntoa(&next_hop) );
+  }
+  return ERR_OK;
+}
+
+void OriginatorArpAcquire(const CipUdint address) {
+  OriginatorArpRequest request;
+  ip4_addr_set_u32(&request.address, address);
+  tcpip_api_call(OriginatorArpAcquireInTcpip, &request.call);
+}
+
+void OriginatorArpRelease(const CipUdint address) {
+  OriginatorArpRequest request;
+  ip4_addr_set_u32(&request.address, address);
+  tcpip_api_call(OriginatorArpReleaseInTcpip, &request.call);
+}
+
+void OriginatorArpGetStatistics(OriginatorArpStatistics *const statistics) {
+  *statistics = (OriginatorArpStatistics) {
+    0
+  };
+  taskENTER_CRITICAL(&s_arp_lock);
+  for(size_t i = 0; i < ORIGINATOR_ARP_MAX_ENTRIES; ++i) {
+    if(0 != s_entries[i].connections) {
+      if(s_entries[i].pinned) {
+        statistics->pinned++;
+      } else {
+        statistics->pending++;
+      }
+    }
+  }
+  statistics->table_full = s_table_full;
+  taskEXIT_CRITICAL(&s_arp_lock);
+}
+
+#endif /* CONFIG_OPENER_ARP_PIN_ORIGINATORS */
@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_ORIGINATOR_ARP_H_
+#define OPENER_ORIGINATOR_ARP_H_
+
+/** @file originator_arp.h
+ *  @brief Static ARP entries for the originators of I/O connections
+ *
+ *  Selected with CONFIG_OPENER_ARP_PIN_ORIGINATORS. lwIP ages out an ARP
+ *  entry after a few minutes. The packet that finds it expired is queued
+ *  until the originator answers a new request, a latency spike of one ARP
+ *  round trip on a short RPI that the connection never asked for.
+ *
+ *  While an originator has an I/O connection, its entry is made static
+ *  with lwIP etharp_add_static_entry(), using the MAC address the ARP
+ *  cache learned for the Forward_Open exchange. An originator on another
+ *  subnet pins the gateway instead. Connections are counted per address,
+ *  the entry becomes dynamic again when the last one closes. An address
+ *  that is not resolved yet is requested and retried every second.
+ *
+ *  At most ORIGINATOR_ARP_MAX_ENTRIES addresses are pinned, the rest of
+ *  the ARP table stays for dynamic entries.
+ */
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_ARP_PIN_ORIGINATORS
+
+#include "lwip/opt.h"
+
+/** Addresses pinned at most, half of the lwIP ARP table */
+#define ORIGINATOR_ARP_MAX_ENTRIES (ARP_TABLE_SIZE / 2)
+
+/** @brief Pinned addresses and failures since boot */
+typedef struct {
+  CipUdint pinned; /**< addresses with a static entry */
+  CipUdint pending; /**< addresses waiting for their ARP reply */
+  CipUdint table_full; /**< connections whose originator found no free entry */
+} OriginatorArpStatistics;
+
+/** @brief An I/O connection to the originator was established
+ *
+ *  Called from the OpENer task. Waits for the tcpip thread.
+ *
+ *  @param address originator address in network byte order
+ */
+void OriginatorArpAcquire(const CipUdint address);
+
+/** @brief An I/O connection to the originator was closed
+ *
+ *  @param address originator address in network byte order
+ */
+void OriginatorArpRelease(const CipUdint address);
+
+/** @brief Read the counters, safe from any task */
+void OriginatorArpGetStatistics(OriginatorArpStatistics *const statistics);
+
+#endif /* CONFIG_OPENER_ARP_PIN_ORIGINATORS */
+
+#endif /* OPENER_ORIGINATOR_ARP_H_ */
@@ -0,0 +1,441 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "ota_update.h"
+
+#if CONFIG_OPENER_OTA_UPDATE
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "trace.h"
+#include "app_scheduler.h"
+#include "production_scheduler.h"
+#include "networkhandler.h"
+#include "cipconnectionmanager.h"
+#include "cipconnectiondiagnostics.h"
+#include "esp_app_desc.h"
+#include "esp_app_format.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mbedtls/sha256.h"
+
+/* Behind a deadline for the production itself */
+#define OTA_UPDATE_DEADLINE_MARGIN_US 300
+#define OTA_UPDATE_HASH_SIZE 32U
+/* At least the image header, the first segment header and the app
+ * description */
+#define OTA_UPDATE_MIN_IMAGE_SIZE \
+  (sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + \
+   sizeof(esp_app_desc_t) )
+
+/* The job runs beside the web server task that hands it the blocks */
+#define OTA_UPDATE_JOB_CORE 1
+#define OTA_UPDATE_JOB_PRIORITY 5
+#define OTA_UPDATE_JOB_STACK_SIZE 4096U
+
+/* Miss counters of one Connection Diagnostics instance at the last look */
+typedef struct {
+  CipUdint connection_id;
+  CipUdint produced_late;
+  CipUdint produced_missed;
+  CipUdint consumed_late;
+  CipUdint consumed_missed;
+} OtaUpdateMissCount;
+
+static bool s_job_registered = false;
+static SemaphoreHandle_t s_block_done = NULL; /* given by the job per block */
+static SemaphoreHandle_t s_wake = NULL; /* given by s_wake_timer */
+static esp_timer_handle_t s_wake_timer = NULL;
+
+/* Set by the receiving task before it signals the job */
+static const esp_partition_t *s_partition = NULL;
+static const uint8_t *s_block = NULL;
+static size_t s_block_length = 0;
+static size_t s_offset = 0; /* of s_block in the partition */
+static esp_err_t s_block_result = ESP_OK;
+
+/* Only used by the receiving task */
+static mbedtls_sha256_context s_sha;
+static size_t s_hashed_size = 0; /* bytes the appended hash covers */
+static bool s_has_appended_hash = false;
+static uint8_t s_appended_hash[OTA_UPDATE_HASH_SIZE];
+
+/* Only used by the job, and by OtaUpdateBegin() while the job is idle */
+static CipUdint s_erase_cost_us = 0; /* longest operation seen, 0 unknown */
+static CipUdint s_write_cost_us = 0;
+static uint64_t s_deferred_us = 0;
+static OtaUpdateMissCount s_miss_counts[
+  CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES];
+
+/* Changed by both, read by the web UI, under s_status_lock */
+static OtaUpdateStatus s_status;
+static portMUX_TYPE s_status_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const kOtaUpdateStateNames[] = {
+  "idle", "writing", "done", "failed",
+};
+
+static EipStatus OtaUpdateFail(const char *const reason) {
+  OPENER_TRACE_ERR("OTA update failed: %s\n", reason);
+  taskENTER_CRITICAL(&s_status_lock);
+  s_status.state = kOtaUpdateStateFailed;
+  s_status.error = reason;
+  taskEXIT_CRITICAL(&s_status_lock);
+  mbedtls_sha256_free(&s_sha);
+  return kEipStatusError;
+}
+
+static void OtaUpdateWakeTimerExpired(void *argument) {
+  (void) argument;
+  xSemaphoreGive(s_wake);
+}
+
+/* Adds what the Connection Diagnostics object counted since the last look,
+ * a connection opened meanwhile starts from its current counters */
+static void OtaUpdateCountMisses(const bool reset) {
+  OtaUpdateMissCount added = { 0 };
+  for(size_t i = 0; i < CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES; ++i) {
+    CipConnectionDiagnostics diagnostics;
+    if(!CipConnectionDiagnosticsGet(i, &diagnostics) ) {
+      continue;
+    }
+    const OtaUpdateMissCount current = {
+      .connection_id = diagnostics.connection_id,
+      .produced_late = diagnostics.produced.late_packets,
+      .produced_missed = diagnostics.produced.missed_packets,
+      .consumed_late = diagnostics.consumed.late_packets,
+      .consumed_missed = diagnostics.consumed.missed_packets,
+    };
+    OtaUpdateMissCount *const last = &s_miss_counts[i];
+    if(!reset && 0 != current.connection_id &&
+       current.connection_id == last->connection_id) {
+      added.produced_late += current.produced_late - last->produced_late;
+      added.produced_missed += current.produced_missed - last->produced_missed;
+      added.consumed_late += current.consumed_late - last->consumed_late;
+      added.consumed_missed += current.consumed_missed - last->consumed_missed;
+    }
+    *last = current;
+  }
+  taskENTER_CRITICAL(&s_status_lock);
+  s_status.produced_late += added.produced_late;
+  s_status.produced_missed += added.produced_missed;
+  s_status.consumed_late += added.consumed_late;
+  s_status.consumed_missed += added.consumed_missed;
+  s_status.deferred_ms = (CipUdint) (s_deferred_us / 1000U);
+  taskEXIT_CRITICAL(&s_status_lock);
+}
+
+/* Returns when no deadline is due within cost_us, right behind a deadline
+ * for an unknown cost, or behind a deadline after the longest deferral */
+static void OtaUpdateWaitForSlack(const CipUdint cost_us) {
+  const int64_t start = esp_timer_get_time();
+  bool behind_deadline = false;
+  for(;; ) {
+    ProductionSchedulerLock();
+    const MicroSeconds deadline = GetNextConnectionDeadline();
+    ProductionSchedulerUnlock();
+    if(UINT64_MAX == deadline) {
+      break;
+    }
+    const int64_t now = (int64_t) GetMicroSeconds();
+    const int64_t slack = (int64_t) deadline - now;
+    if(slack >= (int64_t) cost_us && (0 != cost_us || behind_deadline) ) {
+      break;
+    }
+    if(behind_deadline &&
+       now - start >= (int64_t) CONFIG_OPENER_OTA_MAX_DEFER_MS * 1000) {
+      taskENTER_CRITICAL(&s_status_lock);
+      s_status.forced++;
+      taskEXIT_CRITICAL(&s_status_lock);
+      break;
+    }
+    const int64_t delay = (slack > 0 ? slack : 0) +
+                          OTA_UPDATE_DEADLINE_MARGIN_US;
+    if(ESP_OK != esp_timer_start_once(s_wake_timer, (uint64_t) delay) ) {
+      break;
+    }
+    xSemaphoreTake(s_wake, portMAX_DELAY);
+    behind_deadline = true;
+  }
+  s_deferred_us += (uint64_t) (esp_timer_get_time() - start);
+}
+
+/* Duration of an operation, kept as its cost if the longest so far */
+static CipUdint OtaUpdateTimeSince(const int64_t start,
+                                   CipUdint *const cost_us) {
+  const CipUdint duration = (CipUdint) (esp_timer_get_time() - start);
+  if(duration > *cost_us) {
+    *cost_us = duration;
+  }
+  return duration;
+}
+
+static esp_err_t OtaUpdateWriteBlock(void) {
+  OtaUpdateWaitForSlack(s_erase_cost_us);
+  int64_t start = esp_timer_get_time();
+  esp_err_t result = esp_partition_erase_range(s_partition, s_offset,
+                                               OTA_UPDATE_BLOCK_SIZE);
+  CipUdint duration = OtaUpdateTimeSince(start, &s_erase_cost_us);
+  taskENTER_CRITICAL(&s_status_lock);
+  if(duration > s_status.erase_max_us) {
+    s_status.erase_max_us = duration;
+  }
+  taskEXIT_CRITICAL(&s_status_lock);
+
+  for(size_t done = 0; ESP_OK == result && done < s_block_length;
+      done += CONFIG_OPENER_OTA_WRITE_SIZE) {
+    size_t length = s_block_length - done;
+    if(length > CONFIG_OPENER_OTA_WRITE_SIZE) {
+      length = CONFIG_OPENER_OTA_WRITE_SIZE;
+    }
+    OtaUpdateWaitForSlack(s_write_cost_us);
+    start = esp_timer_get_time();
+    result = esp_partition_write(s_partition, s_offset + done, s_block + done,
+                                 length);
+    duration = OtaUpdateTimeSince(start, &s_write_cost_us);
+    taskENTER_CRITICAL(&s_status_lock);
+    if(duration > s_status.write_max_us) {
+      s_status.write_max_us = duration;
+    }
+    if(ESP_OK == result) {
+      s_status.written += length;
+    }
+    taskEXIT_CRITICAL(&s_status_lock);
+  }
+  OtaUpdateCountMisses(false);
+  return result;
+}
+
+static void OtaUpdateJob(void *argument, uint32_t events) {
+  (void) argument;
+  (void) events;
+  if(NULL == s_block) {
+    return;
+  }
+  s_block_result = OtaUpdateWriteBlock();
+  xSemaphoreGive(s_block_done);
+}
+
+static bool OtaUpdateStartJob(void) {
+  if(s_job_registered) {
+    return true;
+  }
+  if(NULL == s_block_done) {
+    s_block_done = xSemaphoreCreateBinary();
+  }
+  if(NULL == s_wake) {
+    s_wake = xSemaphoreCreateBinary();
+  }
+  if(NULL == s_wake_timer) {
+    const esp_timer_create_args_t timer_args = {
+      .callback = OtaUpdateWakeTimerExpired,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "ota_wake",
+    };
+    if(ESP_OK != esp_timer_create(&timer_args, &s_wake_timer) ) {
+      s_wake_timer = NULL;
+    }
+  }
+  if(NULL == s_block_done || NULL == s_wake || NULL == s_wake_timer) {
+    return false;
+  }
+  const AppSchedulerJobConfig config = {
+    .name = "ota_write",
+    .function = OtaUpdateJob,
+    .argument = NULL,
+    .period_ms = 0,
+    .events = kAppSchedulerEventRequest,
+    .core = OTA_UPDATE_JOB_CORE,
+    .priority = OTA_UPDATE_JOB_PRIORITY,
+    .stack_size = OTA_UPDATE_JOB_STACK_SIZE,
+  };
+  s_job_registered = kEipStatusOk == AppSchedulerRegister(&config);
+  return s_job_registered;
+}
+
+/* Rejects an image for another chip or project before anything is erased */
+static EipStatus OtaUpdateCheckHeader(const uint8_t *const data,
+                                      const size_t length) {
+  if(length < OTA_UPDATE_MIN_IMAGE_SIZE) {
+    return OtaUpdateFail("image header incomplete");
+  }
+  esp_image_header_t header;
+  esp_app_desc_t description;
+  memcpy(&header, data, sizeof(header) );
+  memcpy(&description,
+         data + sizeof(header) + sizeof(esp_image_segment_header_t),
+         sizeof(description) );
+  if(ESP_IMAGE_HEADER_MAGIC != header.magic) {
+    return OtaUpdateFail("not an application image");
+  }
+  if(CONFIG_IDF_FIRMWARE_CHIP_ID != header.chip_id) {
+    return OtaUpdateFail("image for another chip");
+  }
+  if(ESP_APP_DESC_MAGIC_WORD != description.magic_word ||
+     0 != strncmp(description.project_name,
+                  esp_app_get_description()->project_name,
+                  sizeof(description.project_name) ) ) {
+    return OtaUpdateFail("image of another project");
+  }
+  s_has_appended_hash = 1 == header.hash_appended &&
+                        s_status.image_size > OTA_UPDATE_MIN_IMAGE_SIZE +
+                        OTA_UPDATE_HASH_SIZE;
+  s_hashed_size = s_has_appended_hash ?
+                  s_status.image_size - OTA_UPDATE_HASH_SIZE :
+                  s_status.image_size;
+  OPENER_TRACE_INFO("OTA update: %.32s %.32s, %u bytes\n",
+                    description.project_name, description.version,
+                    (unsigned) s_status.image_size);
+  return kEipStatusOk;
+}
+
+/* The stream up to the appended hash goes into the hash, the rest is the
+ * appended hash */
+static void OtaUpdateHash(const uint8_t *const data, const size_t length) {
+  size_t hashed = 0;
+  if(s_offset < s_hashed_size) {
+    hashed = s_hashed_size - s_offset;
+    if(hashed > length) {
+      hashed = length;
+    }
+    mbedtls_sha256_update(&s_sha, data, hashed);
+  }
+  if(hashed < length) {
+    memcpy(&s_appended_hash[s_offset + hashed - s_hashed_size], data + hashed,
+           length - hashed);
+  }
+}
+
+EipStatus OtaUpdateBegin(const size_t image_size) {
+  taskENTER_CRITICAL(&s_status_lock);
+  if(kOtaUpdateStateWriting == s_status.state) {
+    taskEXIT_CRITICAL(&s_status_lock);
+    return kEipStatusError;
+  }
+  s_status = (OtaUpdateStatus) {
+    .state = kOtaUpdateStateWriting,
+    .image_size = (CipUdint) image_size,
+  };
+  taskEXIT_CRITICAL(&s_status_lock);
+
+  mbedtls_sha256_init(&s_sha);
+  if(!OtaUpdateStartJob() ) {
+    return OtaUpdateFail("no write job");
+  }
+  s_partition = esp_ota_get_next_update_partition(NULL);
+  if(NULL == s_partition) {
+    return OtaUpdateFail("no OTA partition");
+  }
+  if(image_size < OTA_UPDATE_MIN_IMAGE_SIZE) {
+    return OtaUpdateFail("image too small");
+  }
+  if(image_size > s_partition->size) {
+    return OtaUpdateFail("image larger than the partition");
+  }
+#if !CONFIG_OPENER_IRAM_FAST_PATH
+  OPENER_TRACE_WARN("OTA update: I/O path not in IRAM, productions refill "
+                    "the cache after every flash operation\n");
+#endif
+  s_offset = 0;
+  s_has_appended_hash = false;
+  s_hashed_size = image_size;
+  s_deferred_us = 0;
+  mbedtls_sha256_starts(&s_sha, 0);
+  OtaUpdateCountMisses(true);
+  return kEipStatusOk;
+}
+
+EipStatus OtaUpdateWrite(const uint8_t *const data, const size_t length) {
+  if(kOtaUpdateStateWriting != s_status.state) {
+    return kEipStatusError;
+  }
+  const size_t image_size = s_status.image_size;
+  if(0 == length || length > OTA_UPDATE_BLOCK_SIZE ||
+     s_offset + length > image_size ||
+     (OTA_UPDATE_BLOCK_SIZE != length && s_offset + length != image_size) ) {
+    return OtaUpdateFail("block out of sequence");
+  }
+  if(0 == s_offset && kEipStatusOk != OtaUpdateCheckHeader(data, length) ) {
+    return kEipStatusError;
+  }
+  OtaUpdateHash(data, length);
+
+  s_block = data;
+  s_block_length = length;
+  AppSchedulerSignal(kAppSchedulerEventRequest);
+  xSemaphoreTake(s_block_done, portMAX_DELAY);
+  s_block = NULL;
+  if(ESP_OK != s_block_result) {
+    OPENER_TRACE_ERR("OTA update: flash at 0x%x: %s\n",
+                     (unsigned) s_offset, esp_err_to_name(s_block_result) );
+    return OtaUpdateFail("flash write failed");
+  }
+  s_offset += length;
+  return kEipStatusOk;
+}
+
+EipStatus OtaUpdateFinish(void) {
+  if(kOtaUpdateStateWriting != s_status.state) {
+    return kEipStatusError;
+  }
+  if(s_offset != s_status.image_size) {
+    return OtaUpdateFail("image incomplete");
+  }
+  if(s_has_appended_hash) {
+    uint8_t digest[OTA_UPDATE_HASH_SIZE];
+    if(0 != mbedtls_sha256_finish(&s_sha, digest) ||
+       0 != memcmp(digest, s_appended_hash, sizeof(digest) ) ) {
+      return OtaUpdateFail("SHA-256 mismatch");
+    }
+  }
+  /* verifies the image as written, then writes the otadata sector; this
+   * one write is not paced */
+  const esp_err_t result = esp_ota_set_boot_partition(s_partition);
+  if(ESP_OK != result) {
+    OPENER_TRACE_ERR("OTA update: %s\n", esp_err_to_name(result) );
+    return OtaUpdateFail("image does not verify");
+  }
+  mbedtls_sha256_free(&s_sha);
+  taskENTER_CRITICAL(&s_status_lock);
+  s_status.state = kOtaUpdateStateDone;
+  taskEXIT_CRITICAL(&s_status_lock);
+  OPENER_TRACE_INFO("OTA update: %s is the boot partition\n",
+                    s_partition->label);
+  return kEipStatusOk;
+}
+
+void OtaUpdateAbort(const char *const reason) {
+  if(kOtaUpdateStateWriting == s_status.state) {
+    OtaUpdateFail(reason);
+  }
+}
+
+void OtaUpdateGetStatus(OtaUpdateStatus *const status) {
+  taskENTER_CRITICAL(&s_status_lock);
+  *status = s_status;
+  taskEXIT_CRITICAL(&s_status_lock);
+}
+
+const char *OtaUpdateGetStateName(const OtaUpdateState state) {
+  return kOtaUpdateStateNames[state];
+}
+
+void OtaUpdateConfirmRunningImage(void) {
+  esp_ota_img_states_t state;
+  if(ESP_OK == esp_ota_get_state_partition(esp_ota_get_running_partition(),
+                                           &state) &&
+     ESP_OTA_IMG_PENDING_VERIFY == state &&
+     ESP_OK == esp_ota_mark_app_valid_cancel_rollback() ) {
+    OPENER_TRACE_INFO("OTA update: running image confirmed\n");
+  }
+}
+
+#endif /* CONFIG_OPENER_OTA_UPDATE */
@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_OTA_UPDATE_H_
+#define OPENER_OTA_UPDATE_H_
+
+/** @file ota_update.h
+ *  @brief Firmware update into the other OTA partition, paced around I/O
+ *
+ *  Selected with CONFIG_OPENER_OTA_UPDATE. Every flash erase or write
+ *  disables the flash cache: both cores stop until it completes, the I/O
+ *  task and the production timer included, and the cache is empty when
+ *  they resume. A sector erase takes longer than a short RPI.
+ *
+ *  The image arrives in blocks of one flash sector. An application
+ *  scheduler job erases each sector and writes it in
+ *  CONFIG_OPENER_OTA_WRITE_SIZE pieces. Before every operation the job
+ *  compares the time left until GetNextConnectionDeadline() with the
+ *  longest such operation seen so far. If the slack is too short, it
+ *  sleeps until just after the deadline and checks again, so the
+ *  operation starts right behind a production. After
+ *  CONFIG_OPENER_OTA_MAX_DEFER_MS the operation runs anyway, behind the
+ *  next deadline; with an RPI shorter than an erase there is no window
+ *  long enough. CONFIG_OPENER_IRAM_FAST_PATH keeps the I/O path out of
+ *  the emptied cache.
+ *
+ *  The image is checked as it arrives:
+ *  - before the first erase, the image header, chip and project name;
+ *  - all along, a SHA-256 of the stream, compared with the appended one;
+ *  - before the partition becomes the boot partition, the full image, by
+ *    esp_ota_set_boot_partition() reading back the flash.
+ *
+ *  The late and missed packets that the Connection Diagnostics object
+ *  counts during the update are reported with the status.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_OTA_UPDATE
+
+/** @brief Bytes handed to OtaUpdateWrite() at a time, one flash sector */
+#define OTA_UPDATE_BLOCK_SIZE 4096U
+
+typedef enum {
+  kOtaUpdateStateIdle = 0,
+  kOtaUpdateStateWriting,
+  kOtaUpdateStateDone, /**< boot partition set, active after a restart */
+  kOtaUpdateStateFailed,
+} OtaUpdateState;
+
+/** @brief Progress and cost of the current or last update */
+typedef struct {
+  OtaUpdateState state;
+  const char *error; /**< reason of kOtaUpdateStateFailed, else NULL */
+  CipUdint image_size;
+  CipUdint written; /**< bytes written to flash */
+  CipUdint erase_max_us; /**< longest sector erase */
+  CipUdint write_max_us; /**< longest write of CONFIG_OPENER_OTA_WRITE_SIZE bytes */
+  CipUdint deferred_ms; /**< time the operations waited for slack */
+  CipUdint forced; /**< operations started without enough slack */
+  CipUdint produced_late; /**< produced packets counted late meanwhile */
+  CipUdint produced_missed;
+  CipUdint consumed_late;
+  CipUdint consumed_missed;
+} OtaUpdateStatus;
+
+/** @brief Start an update
+ *
+ *  Called by the task that receives the image. Registers the write job on
+ *  first use.
+ *
+ *  @param image_size size of the image in bytes
+ *  @return kEipStatusOk, kEipStatusError if an update runs already, the
+ *          image does not fit the partition or the job could not start;
+ *          OtaUpdateGetStatus() tells why
+ */
+EipStatus OtaUpdateBegin(const size_t image_size);
+
+/** @brief Write the next block of the image
+ *
+ *  Blocks until the job wrote it. Every block but the last one has
+ *  OTA_UPDATE_BLOCK_SIZE bytes.
+ *
+ *  @return kEipStatusOk, kEipStatusError if the image was rejected or the
+ *          flash failed; the update is aborted then
+ */
+EipStatus OtaUpdateWrite(const uint8_t *const data, const size_t length);
+
+/** @brief Verify the written image and make it the boot partition
+ *
+ *  @return kEipStatusOk, kEipStatusError if the image is incomplete or
+ *          does not verify
+ */
+EipStatus OtaUpdateFinish(void);
+
+/** @brief Give up an update after a receive error */
+void OtaUpdateAbort(const char *const reason);
+
+/** @brief Read the progress, safe from any task */
+void OtaUpdateGetStatus(OtaUpdateStatus *const status);
+
+/** @brief Name of a state, as used in the web API */
+const char *OtaUpdateGetStateName(const OtaUpdateState state);
+
+/** @brief Keep the running image once the stack is up
+ *
+ *  With CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE an updated image boots
+ *  pending verification and is rolled back at the next reset unless it
+ *  is confirmed. Called once EtherNet/IP is ready.
+ */
+void OtaUpdateConfirmRunningImage(void);
+
+#endif /* CONFIG_OPENER_OTA_UPDATE */
+
+#endif /* OPENER_OTA_UPDATE_H_ */
@@ -0,0 +1,178 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "power_management.h"
+
+#if CONFIG_OPENER_PM_IO_PERFORMANCE
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "trace.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* The start-up workload: rounds over a buffer of the size of a large
+ * assembly, timed once in each mode */
+#define POWER_MANAGEMENT_WORKLOAD_WORDS 128U
+#define POWER_MANAGEMENT_WORKLOAD_ROUNDS 64U
+#define POWER_MANAGEMENT_WORKLOAD_RUNS 16U
+
+static esp_pm_lock_handle_t s_cpu_lock = NULL;
+static esp_pm_lock_handle_t s_sleep_lock = NULL;
+static bool s_initialized = false;
+
+/* Changed by the OpENer task, read by the web UI, under s_pm_lock */
+static PowerManagementStatistics s_statistics;
+static int64_t s_mode_since = 0; /* esp_timer time of the last change */
+static portMUX_TYPE s_pm_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t s_workload[POWER_MANAGEMENT_WORKLOAD_WORDS];
+
+static uint32_t PowerManagementWorkload(void) {
+  uint32_t sum = 0;
+  for(size_t round = 0; round < POWER_MANAGEMENT_WORKLOAD_ROUNDS; ++round) {
+    for(size_t i = 0; i < POWER_MANAGEMENT_WORKLOAD_WORDS; ++i) {
+      s_workload[i] = ( (s_workload[i] << 1) | (s_workload[i] >> 31) ) ^ sum;
+      sum += s_workload[i] + (uint32_t) i;
+    }
+  }
+  return sum;
+}
+
+/* Average time of one run of the workload in microseconds */
+static CipUdint PowerManagementTimeWorkload(void) {
+  volatile uint32_t result = PowerManagementWorkload(); /* warm up caches */
+  const int64_t start = esp_timer_get_time();
+  for(size_t run = 0; run < POWER_MANAGEMENT_WORKLOAD_RUNS; ++run) {
+    result += PowerManagementWorkload();
+  }
+  (void) result;
+  return (CipUdint) ( (esp_timer_get_time() - start) /
+                      POWER_MANAGEMENT_WORKLOAD_RUNS );
+}
+
+/* Takes both locks, returns the time the switch of the clock took */
+static CipUdint PowerManagementAcquire(void) {
+  const int64_t start = esp_timer_get_time();
+  esp_pm_lock_acquire(s_cpu_lock);
+  esp_pm_lock_acquire(s_sleep_lock);
+  return (CipUdint) (esp_timer_get_time() - start);
+}
+
+static void PowerManagementRelease(void) {
+  esp_pm_lock_release(s_sleep_lock);
+  esp_pm_lock_release(s_cpu_lock);
+}
+
+EipStatus PowerManagementInitialize(void) {
+  if(s_initialized) {
+    return kEipStatusOk;
+  }
+  const esp_pm_config_t config = {
+    .max_freq_mhz = CONFIG_OPENER_PM_MAX_FREQ_MHZ,
+    .min_freq_mhz = CONFIG_OPENER_PM_MIN_FREQ_MHZ,
+    .light_sleep_enable = false,
+  };
+  esp_err_t result = esp_pm_configure(&config);
+  if(ESP_OK == result) {
+    result = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "opener_io",
+                                &s_cpu_lock);
+  }
+  if(ESP_OK == result) {
+    result = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "opener_io",
+                                &s_sleep_lock);
+  }
+  if(ESP_OK != result) {
+    OPENER_TRACE_ERR("Power management: configuration failed: %s\n",
+                     esp_err_to_name(result) );
+    return kEipStatusError;
+  }
+
+  /* no lock of this module is held yet, the release puts the CPU to the
+   * minimum clock unless another driver keeps it up */
+  const CipUdint switch_us = PowerManagementAcquire();
+  const CipUdint workload_performance_us = PowerManagementTimeWorkload();
+  PowerManagementRelease();
+  const CipUdint workload_low_power_us = PowerManagementTimeWorkload();
+  OPENER_TRACE_INFO("Power management: %d/%d MHz, workload %" PRIu32
+                    "/%" PRIu32 " us, switch %" PRIu32 " us\n",
+                    CONFIG_OPENER_PM_MIN_FREQ_MHZ,
+                    CONFIG_OPENER_PM_MAX_FREQ_MHZ,
+                    workload_low_power_us, workload_performance_us,
+                    switch_us);
+
+  taskENTER_CRITICAL(&s_pm_lock);
+  s_statistics.workload_low_power_us = workload_low_power_us;
+  s_statistics.workload_performance_us = workload_performance_us;
+  s_statistics.switch_last_us = switch_us;
+  s_statistics.switch_max_us = switch_us;
+  s_mode_since = esp_timer_get_time();
+  s_initialized = true;
+  taskEXIT_CRITICAL(&s_pm_lock);
+  return kEipStatusOk;
+}
+
+void PowerManagementIoConnectionChanged(const bool established) {
+  if(!s_initialized) {
+    return;
+  }
+  if(!established && 0 == s_statistics.connections) {
+    return;
+  }
+  if(established && 0 == s_statistics.connections) {
+    const CipUdint switch_us = PowerManagementAcquire();
+    const int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_pm_lock);
+    s_statistics.low_power_ms += (uint64_t) (now - s_mode_since) / 1000U;
+    s_mode_since = now;
+    s_statistics.performance = true;
+    s_statistics.transitions++;
+    s_statistics.switch_last_us = switch_us;
+    if(switch_us > s_statistics.switch_max_us) {
+      s_statistics.switch_max_us = switch_us;
+    }
+    s_statistics.connections = 1;
+    taskEXIT_CRITICAL(&s_pm_lock);
+    return;
+  }
+  if(!established && 1 == s_statistics.connections) {
+    const int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_pm_lock);
+    s_statistics.performance_ms += (uint64_t) (now - s_mode_since) / 1000U;
+    s_mode_since = now;
+    s_statistics.performance = false;
+    s_statistics.connections = 0;
+    taskEXIT_CRITICAL(&s_pm_lock);
+    PowerManagementRelease();
+    return;
+  }
+  taskENTER_CRITICAL(&s_pm_lock);
+  if(established) {
+    s_statistics.connections++;
+  } else {
+    s_statistics.connections--;
+  }
+  taskEXIT_CRITICAL(&s_pm_lock);
+}
+
+void PowerManagementGetStatistics(PowerManagementStatistics *const statistics) {
+  const int64_t now = esp_timer_get_time();
+  taskENTER_CRITICAL(&s_pm_lock);
+  *statistics = s_statistics;
+  const uint64_t current_ms = s_initialized ?
+                              (uint64_t) (now - s_mode_since) / 1000U : 0U;
+  taskEXIT_CRITICAL(&s_pm_lock);
+  if(statistics->performance) {
+    statistics->performance_ms += current_ms;
+  } else {
+    statistics->low_power_ms += current_ms;
+  }
+}
+
+#endif /* CONFIG_OPENER_PM_IO_PERFORMANCE */
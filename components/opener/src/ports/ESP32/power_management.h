@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_POWER_MANAGEMENT_H_
+#define OPENER_POWER_MANAGEMENT_H_
+
+/** @file power_management.h
+ *  @brief CPU clock scaled with the established I/O connections
+ *
+ *  Selected with CONFIG_OPENER_PM_IO_PERFORMANCE, which needs the ESP-IDF
+ *  power management (CONFIG_PM_ENABLE). Dynamic frequency scaling runs the
+ *  CPU between CONFIG_OPENER_PM_MIN_FREQ_MHZ and
+ *  CONFIG_OPENER_PM_MAX_FREQ_MHZ. While at least one I/O connection is
+ *  established an ESP_PM_CPU_FREQ_MAX and an ESP_PM_NO_LIGHT_SLEEP lock
+ *  are held, so production and consumption run at the full clock. With
+ *  the last connection closed the locks are released and the CPU runs at
+ *  the minimum clock while idle, which is most of the time of a device
+ *  nobody scans. Light sleep is not configured, the EMAC has to receive.
+ *
+ *  The first Forward_Open is still handled at the minimum clock, the
+ *  locks are taken when the connection is established. What each mode
+ *  costs is measured on the board: a fixed workload is timed once in each
+ *  mode at start-up, and the time esp_pm_lock_acquire() takes to switch
+ *  is kept for every change.
+ */
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_PM_IO_PERFORMANCE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief Current mode and measurements since boot */
+typedef struct {
+  CipUdint connections; /**< established I/O connections */
+  bool performance; /**< the locks are held */
+  CipUdint transitions; /**< changes to the performance mode */
+  CipUdint switch_last_us; /**< duration of the last lock acquisition */
+  CipUdint switch_max_us;
+  uint64_t low_power_ms; /**< time with the locks released */
+  uint64_t performance_ms; /**< time with the locks held */
+  CipUdint workload_low_power_us; /**< start-up workload at the minimum clock */
+  CipUdint workload_performance_us; /**< start-up workload at the maximum clock */
+} PowerManagementStatistics;
+
+/** @brief Configure frequency scaling, create the locks and time the modes
+ *
+ *  Called before the OpENer task is created. Further calls return without
+ *  doing anything.
+ *
+ *  @return kEipStatusOk, kEipStatusError if the configuration is refused
+ */
+EipStatus PowerManagementInitialize(void);
+
+/** @brief An I/O connection was established or closed
+ *
+ *  Called from the OpENer task. The first established connection takes the
+ *  locks, closing the last one releases them.
+ *
+ *  @param established true for an established connection
+ */
+void PowerManagementIoConnectionChanged(const bool established);
+
+/** @brief Read the mode and the measurements, safe from any task */
+void PowerManagementGetStatistics(PowerManagementStatistics *const statistics);
+
+#endif /* CONFIG_OPENER_PM_IO_PERFORMANCE */
+
+#endif /* OPENER_POWER_MANAGEMENT_H_ */
@@ -0,0 +1,176 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "production_scheduler.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cipconnectionmanager.h"
+#include "networkhandler.h"
+#include "io_endpoint.h"
+#include "loop_profile.h"
+#include "task_placement.h"
+#if CONFIG_OPENER_TASK_TELEMETRY
+#include "task_telemetry.h"
+#endif
+#include "trace.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+#define PRODUCTION_SCHEDULER_STACK_SIZE       4096
+
+static const MicroSeconds kProductionSchedulerNotArmed = UINT64_MAX;
+
+/* Task notification bits of the producer task */
+#define PRODUCTION_EVENT_DEADLINE  (1UL << 0)
+#define PRODUCTION_EVENT_IO        (1UL << 1)
+
+static SemaphoreHandle_t s_stack_lock = NULL;
+static TaskHandle_t s_producer_task = NULL;
+static esp_timer_handle_t s_production_timer = NULL;
+static MicroSeconds s_armed_deadline = UINT64_MAX;
+static bool s_active = false;
+
+/* Runs in the esp_timer task, only hands over to the producer */
+static void ProductionTimerExpired(void *argument) {
+  (void) argument;
+  xTaskNotify(s_producer_task, PRODUCTION_EVENT_DEADLINE, eSetBits);
+}
+
+/* Caller holds s_stack_lock */
+static void ArmProductionTimer(const MicroSeconds deadline) {
+  if(deadline == s_armed_deadline) {
+    return;
+  }
+  esp_timer_stop(s_production_timer); /* fails harmlessly if not running */
+  s_armed_deadline = kProductionSchedulerNotArmed;
+  if(!s_active || kProductionSchedulerNotArmed == deadline) {
+    return;
+  }
+
+  const MicroSeconds now = GetMicroSeconds();
+  const uint64_t timeout = (deadline > now) ? deadline - now : 0;
+  if(ESP_OK == esp_timer_start_once(s_production_timer, timeout) ) {
+    s_armed_deadline = deadline;
+  } else {
+    OPENER_TRACE_ERR("Production scheduler: failed to arm timer\n");
+  }
+}
+
+static void ProducerTask(void *argument) {
+  (void) argument;
+  for(;; ) {
+    uint32_t events = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+    ProductionSchedulerLock();
+    if(s_active) {
+#if OPENER_IO_EVENT_BACKEND
+      if(0 != (events & PRODUCTION_EVENT_IO) ) {
+        OPENER_LOOP_PROFILE_BEGIN(udp_start);
+        IoEndpointDispatch();
+        OPENER_LOOP_PROFILE_END(kLoopProfilePhaseUdp, udp_start);
+      }
+#endif
+      if(0 != (events & PRODUCTION_EVENT_DEADLINE) ) {
+        s_armed_deadline = kProductionSchedulerNotArmed; /* one-shot has fired */
+        OPENER_LOOP_PROFILE_BEGIN(production_start);
+        ManageConnectionTimers();
+        OPENER_LOOP_PROFILE_END(kLoopProfilePhaseProduction, production_start);
+      }
+      ArmProductionTimer(GetNextConnectionDeadline() );
+    }
+    ProductionSchedulerUnlock();
+  }
+}
+
+EipStatus ProductionSchedulerInitialize(void) {
+  if(NULL == s_stack_lock) {
+    s_stack_lock = xSemaphoreCreateMutex();
+    if(NULL == s_stack_lock) {
+      OPENER_TRACE_ERR("Production scheduler: failed to create lock\n");
+      return kEipStatusError;
+    }
+  }
+
+  if(NULL == s_producer_task) {
+    TaskPlacement placement;
+    TaskPlacementGet(kTaskPlacementTaskIo, &placement);
+    if(pdPASS != xTaskCreatePinnedToCore(ProducerTask,
+                                         "OpENer_prod",
+                                         PRODUCTION_SCHEDULER_STACK_SIZE,
+                                         NULL,
+                                         placement.priority,
+                                         &s_producer_task,
+                                         placement.core) ) {
+      OPENER_TRACE_ERR("Production scheduler: failed to create task\n");
+      s_producer_task = NULL;
+      return kEipStatusError;
+    }
+#if CONFIG_OPENER_TASK_TELEMETRY
+    TaskTelemetryRegister(kTaskTelemetryProducer,
+                          PRODUCTION_SCHEDULER_STACK_SIZE);
+#endif
+    OPENER_TRACE_INFO("Production scheduler: I/O task on core %d, priority %d\n",
+                      (int) placement.core,
+                      (int) placement.priority);
+  }
+
+  if(NULL == s_production_timer) {
+    const esp_timer_create_args_t timer_args = {
+      .callback = ProductionTimerExpired,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "opener_prod",
+    };
+    if(ESP_OK != esp_timer_create(&timer_args, &s_production_timer) ) {
+      OPENER_TRACE_ERR("Production scheduler: failed to create timer\n");
+      s_production_timer = NULL;
+      return kEipStatusError;
+    }
+  }
+
+  ProductionSchedulerLock();
+  s_active = true;
+  s_armed_deadline = kProductionSchedulerNotArmed;
+  ProductionSchedulerUnlock();
+  return kEipStatusOk;
+}
+
+void ProductionSchedulerStop(void) {
+  if(NULL == s_stack_lock) {
+    return;
+  }
+  ProductionSchedulerLock();
+  s_active = false;
+  ArmProductionTimer(kProductionSchedulerNotArmed);
+  ProductionSchedulerUnlock();
+}
+
+void ProductionSchedulerLock(void) {
+  if(NULL != s_stack_lock) {
+    xSemaphoreTake(s_stack_lock, portMAX_DELAY);
+  }
+}
+
+void ProductionSchedulerUnlock(void) {
+  if(NULL != s_stack_lock) {
+    xSemaphoreGive(s_stack_lock);
+  }
+}
+
+void ProductionSchedulerNotifyIoEvent(void) {
+  if(NULL != s_producer_task) {
+    xTaskNotify(s_producer_task, PRODUCTION_EVENT_IO, eSetBits);
+  }
+}
+
+void ProductionSchedulerUpdate(void) {
+  if(s_active) {
+    ArmProductionTimer(GetNextConnectionDeadline() );
+  }
+}
@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_PRODUCTION_SCHEDULER_H_
+#define OPENER_PRODUCTION_SCHEDULER_H_
+
+/** @file production_scheduler.h
+ *  @brief Hardware timer driven production of cyclic I/O data
+ *
+ *  The select() loop of the network handler only wakes up every
+ *  kOpenerTimerTickInMilliSeconds, which limits the produced RPI to multiples
+ *  of the 10 ms FreeRTOS tick. The production scheduler arms a one-shot
+ *  esp_timer at the earliest connection deadline and lets a dedicated producer
+ *  task run ManageConnectionTimers() at that exact point in time.
+ *
+ *  The producer task is the I/O task: it owns production, the connection
+ *  watchdogs and, with the event backend, consumption. The OpENer task serves
+ *  TCP encapsulation, Forward Open and Get/Set. Both take the same priority
+ *  inheriting mutex before they touch the connection list or any other stack
+ *  data; the network handler takes it once per socket event, see
+ *  NetworkHandlerEnterStack() and NetworkHandlerLeaveStack(). Other tasks,
+ *  e.g. the web API, take it with ProductionSchedulerLock().
+ *
+ *  Core and priority of the I/O task come from the task placement profile,
+ *  see task_placement.h.
+ */
+
+#include "typedefs.h"
+
+/** @brief Create the producer task, timer and stack lock
+ *
+ * Safe to call again after ProductionSchedulerStop(), e.g. when the stack is
+ * restarted on link up.
+ *
+ * @return kEipStatusOk on success, kEipStatusError otherwise
+ */
+EipStatus ProductionSchedulerInitialize(void);
+
+/** @brief Stop producing from the timer, called before the stack shuts down */
+void ProductionSchedulerStop(void);
+
+/** @brief Take exclusive access to the stack */
+void ProductionSchedulerLock(void);
+
+/** @brief Release exclusive access to the stack */
+void ProductionSchedulerUnlock(void);
+
+/** @brief Wake the producer task to dispatch received I/O datagrams
+ *
+ * Called by the event driven I/O endpoint, see io_endpoint.h.
+ */
+void ProductionSchedulerNotifyIoEvent(void);
+
+/** @brief Re-arm the timer if the earliest connection deadline moved
+ *
+ * Has to be called with the stack lock held, after connections were opened,
+ * closed or triggered.
+ */
+void ProductionSchedulerUpdate(void);
+
+#endif /* OPENER_PRODUCTION_SCHEDULER_H_ */
@@ -0,0 +1,668 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "ptp_clock.h"
+
+#if CONFIG_OPENER_PTP_TIME_SYNC
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "cipqos.h"
+#include "endianconv.h"
+#include "opener_api.h"
+#include "trace.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/igmp.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/timeouts.h"
+#include "lwip/udp.h"
+#include "lwip/priv/tcpip_priv.h"
+
+#define PTP_EVENT_PORT 319
+#define PTP_GENERAL_PORT 320
+#define PTP_VERSION 2U
+#define PTP_DOMAIN 0U
+
+#define PTP_HEADER_LENGTH 34U
+#define PTP_SYNC_LENGTH 44U
+#define PTP_DELAY_REQ_LENGTH 44U
+#define PTP_DELAY_RESP_LENGTH 54U
+#define PTP_ANNOUNCE_LENGTH 64U
+#define PTP_PORT_IDENTITY_LENGTH 10U
+/* priority 1, clock quality, priority 2 and grandmaster identity */
+#define PTP_DATASET_LENGTH 14U
+
+/* Offsets in the common header */
+#define PTP_OFFSET_DOMAIN 4
+#define PTP_OFFSET_FLAGS 6
+#define PTP_OFFSET_CORRECTION 8
+#define PTP_OFFSET_SOURCE_PORT_IDENTITY 20
+#define PTP_OFFSET_SEQUENCE_ID 30
+#define PTP_OFFSET_CONTROL 32
+#define PTP_OFFSET_LOG_INTERVAL 33
+/* Offsets in the message bodies */
+#define PTP_OFFSET_TIMESTAMP 34
+#define PTP_OFFSET_REQUESTING_PORT_IDENTITY 44
+#define PTP_OFFSET_DATASET 47
+#define PTP_OFFSET_STEPS_REMOVED 61
+
+#define PTP_FLAG_TWO_STEP 0x02U
+#define PTP_CONTROL_DELAY_REQ 0x01U
+#define PTP_LOG_INTERVAL_UNSPECIFIED 0x7FU
+
+/* Offsets above this step the clock instead of slewing it */
+#define PTP_STEP_THRESHOLD_NS 1000000LL
+/* IsSynchronized is set while the offset stays below this. Software
+ * timestamps jitter with the load of the tcpip thread, hence the margin. */
+#define PTP_SYNCHRONIZED_THRESHOLD_NS 100000LL
+/* Servo gains as divisors: half the offset per Sync, a quarter of the rate
+ * error that caused it */
+#define PTP_SERVO_KP_DIVISOR 2
+#define PTP_SERVO_KI_DIVISOR 4
+#define PTP_MAX_DRIFT_PPB 500000
+/* The path delay is averaged over about this many measurements */
+#define PTP_DELAY_FILTER 8
+#define PTP_ANNOUNCE_RECEIPT_TIMEOUT 3U
+#define PTP_DELAY_RESPONSE_TIMEOUT_MS 2000U
+#define PTP_TICK_MS 1000U
+
+typedef enum {
+  kPtpMessageSync = 0x0,
+  kPtpMessageDelayReq = 0x1,
+  kPtpMessageFollowUp = 0x8,
+  kPtpMessageDelayResp = 0x9,
+  kPtpMessageAnnounce = 0xB,
+} PtpMessageType;
+
+/* PTP time is ptp_reference_ns plus the esp_timer time elapsed since
+ * local_reference_us, corrected by drift_ppb */
+typedef struct {
+  int64_t local_reference_us;
+  int64_t ptp_reference_ns;
+  int32_t drift_ppb;
+} PtpClockModel;
+
+typedef struct {
+  bool synchronized;
+  int64_t offset_ns;
+  uint64_t max_offset_ns;
+  int64_t path_delay_ns;
+} PtpClockStatus;
+
+/* Written by the tcpip thread, read from any task */
+static PtpClockModel s_model;
+static PtpClockStatus s_status;
+static portMUX_TYPE s_clock_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Everything below is only touched in the tcpip thread */
+typedef struct {
+  bool valid;
+  u8_t port_identity[PTP_PORT_IDENTITY_LENGTH];
+  u8_t dataset[PTP_DATASET_LENGTH];
+  u32_t announce_timeout_ms;
+  u32_t last_announce_ms;
+} PtpParent;
+
+static PtpParent s_parent;
+static u8_t s_port_identity[PTP_PORT_IDENTITY_LENGTH];
+static struct udp_pcb *s_event_pcb = NULL;
+static struct udp_pcb *s_general_pcb = NULL;
+static struct netif *s_netif = NULL;
+static const ip_addr_t s_ptp_group = IPADDR4_INIT_BYTES(224, 0, 1, 129);
+static u8_t s_event_tos = 0;
+static u8_t s_general_tos = 0;
+
+static bool s_locked = false;
+static int64_t s_last_servo_us = 0;
+/* Sync waiting for its Follow_Up */
+static bool s_sync_pending = false;
+static u16_t s_sync_sequence = 0;
+static int64_t s_sync_receive_us = 0;
+static int64_t s_sync_correction_ns = 0;
+/* Last master to slave measurement, t1 in PTP and t2 in esp_timer time */
+static int64_t s_t1_ns = 0;
+static int64_t s_t2_us = 0;
+/* Outstanding Delay_Req, t3 in esp_timer time */
+static bool s_delay_pending = false;
+static u16_t s_delay_sequence = 0;
+static int64_t s_delay_send_us = 0;
+static u32_t s_delay_sent_ms = 0;
+static bool s_have_delay = false;
+static int64_t s_path_delay_ns = 0;
+
+/* Stack task only */
+static bool s_started = false;
+static bool s_running = false;
+
+/* Time Sync object attributes, refreshed before every get */
+static CipBool s_ptp_enable = 1;
+static CipBool s_is_synchronized = 0;
+static CipUlint s_system_time_us = 0;
+static CipUlint s_system_time_ns = 0;
+static CipLint s_offset_from_master = 0;
+static CipUlint s_max_offset_from_master = 0;
+static CipLint s_mean_path_delay = 0;
+
+static int64_t PtpClockModelTime(const PtpClockModel *const model,
+                                 const int64_t local_us) {
+  const int64_t elapsed_us = local_us - model->local_reference_us;
+  return model->ptp_reference_ns + elapsed_us * 1000 +
+         elapsed_us * model->drift_ppb / 1000000;
+}
+
+static PtpClockModel PtpClockGetModel(void) {
+  taskENTER_CRITICAL(&s_clock_lock);
+  const PtpClockModel model = s_model;
+  taskEXIT_CRITICAL(&s_clock_lock);
+  return model;
+}
+
+CipUlint PtpClockFromLocalTime(const int64_t local_us) {
+  const PtpClockModel model = PtpClockGetModel();
+  return (CipUlint) PtpClockModelTime(&model, local_us);
+}
+
+bool PtpClockIsSynchronized(void) {
+  taskENTER_CRITICAL(&s_clock_lock);
+  const bool synchronized = s_status.synchronized;
+  taskEXIT_CRITICAL(&s_clock_lock);
+  return synchronized;
+}
+
+static u16_t PtpGetU16(const u8_t *const data) {
+  return (u16_t) ( (data[0] << 8) | data[1] );
+}
+
+static int64_t PtpGetCorrection(const u8_t *const message) {
+  uint64_t correction = 0;
+  for(size_t i = 0; i < 8; ++i) {
+    correction = (correction << 8) | message[PTP_OFFSET_CORRECTION + i];
+  }
+  /* scaled nanoseconds, 2^16 per nanosecond */
+  return (int64_t) correction / 65536;
+}
+
+/* Seconds (48 bit) and nanoseconds (32 bit) to nanoseconds */
+static int64_t PtpGetTimestamp(const u8_t *const data) {
+  uint64_t seconds = 0;
+  for(size_t i = 0; i < 6; ++i) {
+    seconds = (seconds << 8) | data[i];
+  }
+  uint32_t nanoseconds = 0;
+  for(size_t i = 6; i < 10; ++i) {
+    nanoseconds = (nanoseconds << 8) | data[i];
+  }
+  return (int64_t) (seconds * 1000000000ULL + nanoseconds);
+}
+
+static bool PtpIsFromParent(const u8_t *const message) {
+  return s_parent.valid &&
+         0 == memcmp(message + PTP_OFFSET_SOURCE_PORT_IDENTITY,
+                     s_parent.port_identity, PTP_PORT_IDENTITY_LENGTH);
+}
+
+static u32_t PtpIntervalMs(const u8_t log_interval) {
+  const int8_t exponent = (int8_t) log_interval;
+  if(exponent > 7 || exponent < -7) {
+    return 1000U;
+  }
+  return exponent >= 0 ? 1000U << exponent : 1000U >> -exponent;
+}
+
+static void PtpClockSetUnsynchronized(void) {
+  taskENTER_CRITICAL(&s_clock_lock);
+  s_status.synchronized = false;
+  taskEXIT_CRITICAL(&s_clock_lock);
+}
+
+static void PtpClockResetMeasurements(void) {
+  s_locked = false;
+  s_sync_pending = false;
+  s_delay_pending = false;
+  s_have_delay = false;
+  s_path_delay_ns = 0;
+  PtpClockSetUnsynchronized();
+}
+
+static void PtpClockServo(const int64_t t2_us, const int64_t offset_ns) {
+  PtpClockModel model = PtpClockGetModel();
+  const int64_t ptp_ns = PtpClockModelTime(&model, t2_us);
+  if(!s_locked || llabs(offset_ns) > PTP_STEP_THRESHOLD_NS) {
+    OPENER_TRACE_INFO("PTP: stepping the clock by %lld ns\n",
+                      (long long) -offset_ns);
+    model.ptp_reference_ns = ptp_ns - offset_ns;
+    s_locked = true;
+  } else {
+    const int64_t interval_us = t2_us - s_last_servo_us;
+    if(interval_us > 0) {
+      /* rate error in ppb that built up the offset since the last Sync */
+      int64_t drift_ppb = model.drift_ppb -
+                          offset_ns * 1000000 / interval_us /
+                          PTP_SERVO_KI_DIVISOR;
+      if(drift_ppb > PTP_MAX_DRIFT_PPB) {
+        drift_ppb = PTP_MAX_DRIFT_PPB;
+      } else if(drift_ppb < -PTP_MAX_DRIFT_PPB) {
+        drift_ppb = -PTP_MAX_DRIFT_PPB;
+      }
+      model.drift_ppb = (int32_t) drift_ppb;
+    }
+    model.ptp_reference_ns = ptp_ns - offset_ns / PTP_SERVO_KP_DIVISOR;
+  }
+  model.local_reference_us = t2_us;
+  s_last_servo_us = t2_us;
+
+  const uint64_t magnitude = (uint64_t) llabs(offset_ns);
+  taskENTER_CRITICAL(&s_clock_lock);
+  s_model = model;
+  s_status.offset_ns = offset_ns;
+  if(magnitude > s_status.max_offset_ns) {
+    s_status.max_offset_ns = magnitude;
+  }
+  s_status.path_delay_ns = s_path_delay_ns;
+  s_status.synchronized = s_have_delay &&
+                          offset_ns < PTP_SYNCHRONIZED_THRESHOLD_NS &&
+                          offset_ns > -PTP_SYNCHRONIZED_THRESHOLD_NS;
+  taskEXIT_CRITICAL(&s_clock_lock);
+}
+
+static void PtpWriteHeader(u8_t *const message,
+                           const PtpMessageType type,
+                           const u16_t length,
+                           const u16_t sequence,
+                           const u8_t control) {
+  memset(message, 0, length);
+  message[0] = (u8_t) type;
+  message[1] = PTP_VERSION;
+  message[2] = (u8_t) (length >> 8);
+  message[3] = (u8_t) length;
+  message[PTP_OFFSET_DOMAIN] = PTP_DOMAIN;
+  memcpy(message + PTP_OFFSET_SOURCE_PORT_IDENTITY, s_port_identity,
+         PTP_PORT_IDENTITY_LENGTH);
+  message[PTP_OFFSET_SEQUENCE_ID] = (u8_t) (sequence >> 8);
+  message[PTP_OFFSET_SEQUENCE_ID + 1] = (u8_t) sequence;
+  message[PTP_OFFSET_CONTROL] = control;
+  message[PTP_OFFSET_LOG_INTERVAL] = PTP_LOG_INTERVAL_UNSPECIFIED;
+}
+
+static void PtpClockSendDelayRequest(void) {
+  if(s_delay_pending &&
+     sys_now() - s_delay_sent_ms < PTP_DELAY_RESPONSE_TIMEOUT_MS) {
+    return;
+  }
+  struct pbuf *const p = pbuf_alloc(PBUF_TRANSPORT, PTP_DELAY_REQ_LENGTH,
+                                    PBUF_RAM);
+  if(NULL == p) {
+    return;
+  }
+  s_delay_sequence++;
+  PtpWriteHeader(p->payload, kPtpMessageDelayReq, PTP_DELAY_REQ_LENGTH,
+                 s_delay_sequence, PTP_CONTROL_DELAY_REQ);
+  /* t3: the datagram goes to the EMAC from this thread */
+  s_delay_send_us = esp_timer_get_time();
+  const err_t error = udp_sendto(s_event_pcb, p, &s_ptp_group,
+                                 PTP_EVENT_PORT);
+  pbuf_free(p);
+  if(ERR_OK == error) {
+    s_delay_pending = true;
+    s_delay_sent_ms = sys_now();
+  }
+}
+
+static void PtpClockMeasured(const int64_t t1_ns, const int64_t t2_us) {
+  const PtpClockModel model = PtpClockGetModel();
+  const int64_t offset_ns = PtpClockModelTime(&model, t2_us) - t1_ns -
+                            s_path_delay_ns;
+  s_t1_ns = t1_ns;
+  s_t2_us = t2_us;
+  PtpClockServo(t2_us, offset_ns);
+  PtpClockSendDelayRequest();
+}
+
+static void PtpClockHandleAnnounce(const u8_t *const message,
+                                   const u16_t length) {
+  if(length < PTP_ANNOUNCE_LENGTH ||
+     0xFFFFU == PtpGetU16(message + PTP_OFFSET_STEPS_REMOVED) ) {
+    return;
+  }
+  const u8_t *const dataset = message + PTP_OFFSET_DATASET;
+  const bool from_parent = PtpIsFromParent(message);
+  /* big endian fields compare like numbers, lower is better */
+  if(s_parent.valid && !from_parent &&
+     0 <= memcmp(dataset, s_parent.dataset, PTP_DATASET_LENGTH) ) {
+    return;
+  }
+  if(!from_parent) {
+    const u8_t *const identity = message + PTP_OFFSET_SOURCE_PORT_IDENTITY;
+    OPENER_TRACE_INFO("PTP: master %02x%02x%02x%02x%02x%02x%02x%02x\n",
+                      identity[0], identity[1], identity[2], identity[3],
+                      identity[4], identity[5], identity[6], identity[7]);
+    memcpy(s_parent.port_identity, identity, PTP_PORT_IDENTITY_LENGTH);
+    s_parent.valid = true;
+    PtpClockResetMeasurements();
+  }
+  memcpy(s_parent.dataset, dataset, PTP_DATASET_LENGTH);
+  s_parent.announce_timeout_ms = PTP_ANNOUNCE_RECEIPT_TIMEOUT *
+                                 PtpIntervalMs(
+    message[PTP_OFFSET_LOG_INTERVAL]);
+  s_parent.last_announce_ms = sys_now();
+}
+
+static void PtpClockHandleSync(const u8_t *const message,
+                               const int64_t receive_us) {
+  const int64_t correction_ns = PtpGetCorrection(message);
+  if(0 != (message[PTP_OFFSET_FLAGS] & PTP_FLAG_TWO_STEP) ) {
+    s_sync_pending = true;
+    s_sync_sequence = PtpGetU16(message + PTP_OFFSET_SEQUENCE_ID);
+    s_sync_receive_us = receive_us;
+    s_sync_correction_ns = correction_ns;
+    return;
+  }
+  s_sync_pending = false;
+  PtpClockMeasured(PtpGetTimestamp(message + PTP_OFFSET_TIMESTAMP) +
+                   correction_ns, receive_us);
+}
+
+static void PtpClockHandleFollowUp(const u8_t *const message) {
+  if(!s_sync_pending ||
+     s_sync_sequence != PtpGetU16(message + PTP_OFFSET_SEQUENCE_ID) ) {
+    return;
+  }
+  s_sync_pending = false;
+  PtpClockMeasured(PtpGetTimestamp(message + PTP_OFFSET_TIMESTAMP) +
+                   s_sync_correction_ns + PtpGetCorrection(message),
+                   s_sync_receive_us);
+}
+
+static void PtpClockHandleDelayResponse(const u8_t *const message) {
+  if(!s_delay_pending ||
+     s_delay_sequence != PtpGetU16(message + PTP_OFFSET_SEQUENCE_ID) ||
+     0 != memcmp(message + PTP_OFFSET_REQUESTING_PORT_IDENTITY,
+                 s_port_identity, PTP_PORT_IDENTITY_LENGTH) ) {
+    return;
+  }
+  s_delay_pending = false;
+  const int64_t t4_ns = PtpGetTimestamp(message + PTP_OFFSET_TIMESTAMP) -
+                        PtpGetCorrection(message);
+  /* both directions on the current clock, a step in between cancels out */
+  const PtpClockModel model = PtpClockGetModel();
+  const int64_t master_to_slave = PtpClockModelTime(&model, s_t2_us) -
+                                  s_t1_ns;
+  const int64_t slave_to_master = t4_ns -
+                                  PtpClockModelTime(&model, s_delay_send_us);
+  const int64_t delay_ns = (master_to_slave + slave_to_master) / 2;
+  if(delay_ns < 0) {
+    return;
+  }
+  if(s_have_delay) {
+    s_path_delay_ns += (delay_ns - s_path_delay_ns) / PTP_DELAY_FILTER;
+  } else {
+    s_path_delay_ns = delay_ns;
+    s_have_delay = true;
+  }
+}
+
+/* Both pcbs; software receive timestamp as early as lwIP allows */
+static void PtpClockReceive(void *argument,
+                            struct udp_pcb *pcb,
+                            struct pbuf *p,
+                            const ip_addr_t *address,
+                            u16_t port) {
+  const int64_t receive_us = esp_timer_get_time();
+  (void) argument;
+  (void) pcb;
+  (void) address;
+  (void) port;
+  u8_t message[PTP_ANNOUNCE_LENGTH];
+  const u16_t length = pbuf_copy_partial(p, message, sizeof(message), 0);
+  pbuf_free(p);
+  if(length < PTP_HEADER_LENGTH || PTP_VERSION != (message[1] & 0x0FU) ||
+     PTP_DOMAIN != message[PTP_OFFSET_DOMAIN]) {
+    return;
+  }
+
+  const PtpMessageType type = (PtpMessageType) (message[0] & 0x0FU);
+  if(kPtpMessageAnnounce == type) {
+    PtpClockHandleAnnounce(message, length);
+    return;
+  }
+  if(!PtpIsFromParent(message) ) {
+    return;
+  }
+  switch(type) {
+    case kPtpMessageSync:
+      if(length >= PTP_SYNC_LENGTH) {
+        PtpClockHandleSync(message, receive_us);
+      }
+      break;
+    case kPtpMessageFollowUp:
+      if(length >= PTP_SYNC_LENGTH) {
+        PtpClockHandleFollowUp(message);
+      }
+      break;
+    case kPtpMessageDelayResp:
+      if(length >= PTP_DELAY_RESP_LENGTH) {
+        PtpClockHandleDelayResponse(message);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static void PtpClockTick(void *argument) {
+  (void) argument;
+  if(s_parent.valid &&
+     sys_now() - s_parent.last_announce_ms > s_parent.announce_timeout_ms) {
+    OPENER_TRACE_WARN("PTP: announce timeout, clock free running\n");
+    s_parent.valid = false;
+    PtpClockResetMeasurements();
+  }
+  sys_timeout(PTP_TICK_MS, PtpClockTick, NULL);
+}
+
+static struct udp_pcb *PtpClockOpenPcb(const u16_t port, const u8_t tos) {
+  struct udp_pcb *const pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+  if(NULL == pcb) {
+    return NULL;
+  }
+  if(ERR_OK != udp_bind(pcb, IP4_ADDR_ANY, port) ) {
+    udp_remove(pcb);
+    return NULL;
+  }
+  pcb->tos = tos;
+  udp_set_multicast_ttl(pcb, 1);
+  udp_recv(pcb, PtpClockReceive, NULL);
+  return pcb;
+}
+
+static err_t PtpClockCloseInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+  sys_untimeout(PtpClockTick, NULL);
+  if(NULL != s_netif) {
+    igmp_leavegroup_netif(s_netif, ip_2_ip4(&s_ptp_group) );
+    s_netif = NULL;
+  }
+  if(NULL != s_event_pcb) {
+    udp_remove(s_event_pcb);
+    s_event_pcb = NULL;
+  }
+  if(NULL != s_general_pcb) {
+    udp_remove(s_general_pcb);
+    s_general_pcb = NULL;
+  }
+  s_parent.valid = false;
+  PtpClockResetMeasurements();
+  return ERR_OK;
+}
+
+static err_t PtpClockOpenInTcpip(struct tcpip_api_call_data *call) {
+  struct netif *const netif = netif_default;
+  if(NULL == netif) {
+    return ERR_IF;
+  }
+  /* EUI-64 clock identity from the MAC address, port 1 */
+  const u8_t *const mac = netif->hwaddr;
+  const u8_t identity[PTP_PORT_IDENTITY_LENGTH] = {
+    mac[0], mac[1], mac[2], 0xFF, 0xFE, mac[3], mac[4], mac[5], 0, 1
+  };
+  memcpy(s_port_identity, identity, sizeof(identity) );
+
+  s_event_pcb = PtpClockOpenPcb(PTP_EVENT_PORT, s_event_tos);
+  s_general_pcb = PtpClockOpenPcb(PTP_GENERAL_PORT, s_general_tos);
+  if(NULL == s_event_pcb || NULL == s_general_pcb) {
+    PtpClockCloseInTcpip(call);
+    return ERR_USE;
+  }
+  const err_t error = igmp_joingroup_netif(netif, ip_2_ip4(&s_ptp_group) );
+  if(ERR_OK != error) {
+    PtpClockCloseInTcpip(call);
+    return error;
+  }
+  s_netif = netif;
+  sys_timeout(PTP_TICK_MS, PtpClockTick, NULL);
+  return ERR_OK;
+}
+
+static void PtpClockOpen(void) {
+  if(s_running) {
+    return;
+  }
+  s_event_tos = (u8_t) (CipQosGetDscpPtp(true) << 2);
+  s_general_tos = (u8_t) (CipQosGetDscpPtp(false) << 2);
+  struct tcpip_api_call_data call;
+  const err_t error = tcpip_api_call(PtpClockOpenInTcpip, &call);
+  if(ERR_OK != error) {
+    OPENER_TRACE_ERR("PTP: cannot open UDP ports %d and %d: %d\n",
+                     PTP_EVENT_PORT, PTP_GENERAL_PORT, error);
+    return;
+  }
+  s_running = true;
+  OPENER_TRACE_INFO("PTP: slave clock listening on UDP ports %d and %d\n",
+                    PTP_EVENT_PORT, PTP_GENERAL_PORT);
+}
+
+static void PtpClockClose(void) {
+  if(!s_running) {
+    return;
+  }
+  struct tcpip_api_call_data call;
+  tcpip_api_call(PtpClockCloseInTcpip, &call);
+  s_running = false;
+}
+
+void PtpClockStart(void) {
+  s_started = true;
+  if(s_ptp_enable) {
+    PtpClockOpen();
+  }
+}
+
+void PtpClockStop(void) {
+  s_started = false;
+  PtpClockClose();
+}
+
+static int DecodePtpEnable(void *const data,
+                           CipMessageRouterRequest *const message_router_request,
+                           CipMessageRouterResponse *const message_router_response)
+{
+  const CipUsint value = GetUsintFromMessage(&message_router_request->data);
+  if(value > 1U) {
+    message_router_response->general_status = kCipErrorInvalidAttributeValue;
+    return -1;
+  }
+  *(CipBool *)data = value;
+  message_router_response->general_status = kCipErrorSuccess;
+  return 1;
+}
+
+static EipStatus PtpClockPreGetCallback(CipInstance *const instance,
+                                        const CipAttributeStruct *const attribute,
+                                        CipByte service) {
+  (void) instance;
+  (void) attribute;
+  (void) service;
+  const int64_t now_us = esp_timer_get_time();
+  taskENTER_CRITICAL(&s_clock_lock);
+  const PtpClockModel model = s_model;
+  const PtpClockStatus status = s_status;
+  taskEXIT_CRITICAL(&s_clock_lock);
+
+  s_is_synchronized = status.synchronized;
+  s_system_time_ns = (CipUlint) PtpClockModelTime(&model, now_us);
+  s_system_time_us = s_system_time_ns / 1000U;
+  s_offset_from_master = status.offset_ns;
+  s_max_offset_from_master = status.max_offset_ns;
+  s_mean_path_delay = status.path_delay_ns;
+  return kEipStatusOk;
+}
+
+static EipStatus PtpClockPostSetCallback(CipInstance *const instance,
+                                         const CipAttributeStruct *const attribute,
+                                         CipByte service) {
+  (void) instance;
+  (void) attribute;
+  (void) service;
+  if(!s_ptp_enable) {
+    PtpClockClose();
+  } else if(s_started) {
+    PtpClockOpen();
+  }
+  return kEipStatusOk;
+}
+
+EipStatus PtpClockCreateCipObject(void) {
+  CipClass *time_sync_class = NULL;
+
+  if( ( time_sync_class = CreateCipClass(kCipTimeSyncClassCode,
+                                         7, /* # class attributes */
+                                         7, /* # highest class attribute number */
+                                         2, /* # class services */
+                                         7, /* # instance attributes */
+                                         7, /* # highest instance attribute number */
+                                         2, /* # instance services */
+                                         1, /* # instances */
+                                         "Time Sync",
+                                         1, /* # class revision */
+                                         NULL /* # function pointer for initialization */
+                                         ) ) == 0 ) {
+    OPENER_TRACE_ERR("PTP: failed to create the Time Sync object\n");
+    return kEipStatusError;
+  }
+
+  CipInstance *instance = GetCipInstance(time_sync_class, 1);
+  InsertAttribute(instance, 1, kCipBool, EncodeCipBool, DecodePtpEnable,
+                  &s_ptp_enable, kSetAndGetAble | kPostSetFunc);
+  InsertAttribute(instance, 2, kCipBool, EncodeCipBool, NULL,
+                  &s_is_synchronized, kGetableSingle | kPreGetFunc);
+  InsertAttribute(instance, 3, kCipUlint, EncodeCipUlint, NULL,
+                  &s_system_time_us, kGetableSingle | kPreGetFunc);
+  InsertAttribute(instance, 4, kCipUlint, EncodeCipUlint, NULL,
+                  &s_system_time_ns, kGetableSingle | kPreGetFunc);
+  InsertAttribute(instance, 5, kCipLint, EncodeCipLint, NULL,
+                  &s_offset_from_master, kGetableSingle | kPreGetFunc);
+  InsertAttribute(instance, 6, kCipUlint, EncodeCipUlint, NULL,
+                  &s_max_offset_from_master, kGetableSingle | kPreGetFunc);
+  InsertAttribute(instance, 7, kCipLint, EncodeCipLint, NULL,
+                  &s_mean_path_delay, kGetableSingle | kPreGetFunc);
+  InsertGetSetCallback(time_sync_class, PtpClockPreGetCallback, kPreGetFunc);
+  InsertGetSetCallback(time_sync_class, PtpClockPostSetCallback,
+                       kPostSetFunc);
+
+  InsertService(time_sync_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(time_sync_class, kSetAttributeSingle, &SetAttributeSingle,
+                "SetAttributeSingle");
+
+  return kEipStatusOk;
+}
+
+#endif /* CONFIG_OPENER_PTP_TIME_SYNC */
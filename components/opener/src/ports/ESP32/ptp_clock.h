@@ -0,0 +1,68 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_PTP_CLOCK_H_
+#define OPENER_PTP_CLOCK_H_
+
+/** @file ptp_clock.h
+ *  @brief IEEE 1588 slave clock and Time Sync object for CIP Sync
+ *
+ *  Selected with CONFIG_OPENER_PTP_TIME_SYNC. An ordinary clock in slave only
+ *  mode on the default profile: IPv4/UDP, domain 0, end-to-end delay
+ *  measurement, one and two step masters. The master is chosen from the
+ *  Announce messages by the dataset comparison of priority 1, clock quality,
+ *  priority 2 and grandmaster identity.
+ *
+ *  The ESP32 EMAC driver of ESP-IDF has no PTP timestamping, so receive and
+ *  transmit times are taken in software: in the lwIP receive callback and
+ *  right before the Delay_Req is sent, both in the tcpip thread. The mailbox
+ *  delay of the tcpip thread adds to the offset jitter.
+ *
+ *  The clock runs on esp_timer. PtpClockFromLocalTime() converts any
+ *  esp_timer time, e.g. one taken in an interrupt, to PTP time, so an event
+ *  is stamped when it happens and converted later. Offsets are corrected by
+ *  a PI servo; offsets above one millisecond step the clock.
+ *
+ *  The Time Sync object (class 0x43) implements PTPEnable, IsSynchronized,
+ *  SystemTimeMicroseconds, SystemTimeNanoseconds, OffsetFromMaster,
+ *  MaxOffsetFromMaster and MeanPathDelayToMaster.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_PTP_TIME_SYNC
+
+/** @brief Time Sync object class code */
+static const CipUint kCipTimeSyncClassCode = 0x43U;
+
+/** @brief Create the Time Sync object, called by the application */
+EipStatus PtpClockCreateCipObject(void);
+
+/** @brief Open the PTP ports if PTPEnable is set, after the stack came up */
+void PtpClockStart(void);
+
+/** @brief Close the PTP ports, the clock keeps running on its last rate */
+void PtpClockStop(void);
+
+/** @brief Convert an esp_timer time to PTP time
+ *
+ *  May be called from any task. Before the first Sync the PTP time is the
+ *  time since boot.
+ *
+ *  @param local_us time returned by esp_timer_get_time()
+ *  @return nanoseconds since the PTP epoch
+ */
+CipUlint PtpClockFromLocalTime(const int64_t local_us);
+
+/** @brief True while the clock follows a master within the sync threshold */
+bool PtpClockIsSynchronized(void);
+
+#endif /* CONFIG_OPENER_PTP_TIME_SYNC */
+
+#endif /* OPENER_PTP_CLOCK_H_ */
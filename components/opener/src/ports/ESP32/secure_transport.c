@@ -0,0 +1,1525 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "secure_transport.h"
+
+#if OPENER_CIP_SECURITY
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "generic_networkhandler.h"
+#include "task_placement.h"
+#include "trace.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_cookie.h"
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/x509_crt.h"
+#include "nvs.h"
+
+#if !defined(MBEDTLS_SSL_PROTO_DTLS) || !defined(MBEDTLS_SSL_COOKIE_C) || \
+  !defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY)
+#error "CONFIG_OPENER_CIP_SECURITY needs MBEDTLS_SSL_PROTO_DTLS"
+#endif
+#if !CONFIG_OPENER_CIP_SECURITY_PSK && \
+  ( !defined(MBEDTLS_X509_CRT_WRITE_C) || !defined(MBEDTLS_PK_WRITE_C) )
+#error "CONFIG_OPENER_CIP_SECURITY needs MBEDTLS_X509_CRT_WRITE_C"
+#endif
+
+/** TCP and UDP port of CIP Security */
+#define SECURE_TRANSPORT_PORT 2221
+#define SECURE_TRANSPORT_STACK_SIZE 8192
+/** Time the task waits for the sockets of the TLS handshakes */
+#define SECURE_TRANSPORT_POLL_MS 10
+/** A TLS handshake not done by then is dropped */
+#define SECURE_TRANSPORT_HANDSHAKE_TIMEOUT_US (10 * 1000000LL)
+/** An established DTLS session without a record for this long is freed */
+#define SECURE_TRANSPORT_DTLS_IDLE_US (120 * 1000000LL)
+/** DTLS retransmission timeout, doubled up to the maximum */
+#define SECURE_TRANSPORT_DTLS_TIMEOUT_MIN_MS 500
+#define SECURE_TRANSPORT_DTLS_TIMEOUT_MAX_MS 8000
+/** A DTLS datagram at most, larger ones are dropped */
+#define SECURE_TRANSPORT_DATAGRAM_SIZE 1024
+/** Handshake datagrams waiting for the task */
+#define SECURE_TRANSPORT_QUEUE_LENGTH 4
+/** Datagrams read per SecureTransportReceiveIo() call */
+#define SECURE_TRANSPORT_DATAGRAMS_PER_CALL 8
+
+#define SECURE_TRANSPORT_NVS_NAMESPACE "cip_security"
+#define SECURE_TRANSPORT_NVS_KEY "key"
+#define SECURE_TRANSPORT_NVS_CERTIFICATE "cert"
+/** DER encoding of the key or the certificate at most */
+#define SECURE_TRANSPORT_DER_SIZE 1024
+
+#define SECURE_TRANSPORT_DTLS_SLOTS (CONFIG_OPENER_CIP_SECURITY_DTLS_SESSIONS + \
+                                     1)
+
+/* Record content type of a ClientHello */
+static const uint8_t kDtlsContentTypeHandshake = 22;
+
+typedef enum {
+  kSecureSessionFree = 0,
+  kSecureSessionListening, /**< DTLS: answers the ClientHellos of new peers */
+  kSecureSessionHandshake, /**< owned by the task */
+  kSecureSessionReady, /**< established, a TLS session waits to be taken */
+  kSecureSessionAdopted, /**< TLS: served by the network handler */
+} SecureSessionState;
+
+/* Compute time of a handshake, the socket calls taken out */
+typedef struct {
+  int64_t started_us;
+  int64_t compute_us;
+  bool resumed;
+} SecureHandshake;
+
+typedef struct {
+  SecureSessionState state;
+  int socket;
+  CipUdint peer_address; /**< network byte order */
+  mbedtls_ssl_context ssl;
+  SecureHandshake handshake;
+  int64_t bio_us; /**< time in send() and recv() of the current call */
+} TlsSession;
+
+typedef struct {
+  SecureSessionState state;
+  struct sockaddr_in peer;
+  int tls_socket; /**< TLS session it is bound to, kEipInvalidSocket if none */
+  mbedtls_ssl_context ssl;
+  SecureHandshake handshake;
+  int64_t bio_us;
+  const uint8_t *input; /**< the datagram the next read returns */
+  size_t input_length;
+  bool send_failed;
+  int64_t last_activity_us;
+  int64_t timer_start_us;
+  uint32_t timer_intermediate_ms;
+  uint32_t timer_final_ms; /**< 0 while the timer is cancelled */
+} DtlsSession;
+
+typedef struct {
+  struct sockaddr_in from;
+  size_t length;
+  uint8_t data[SECURE_TRANSPORT_DATAGRAM_SIZE];
+} DtlsDatagram;
+
+typedef struct {
+  uint32_t count;
+  uint64_t total_us;
+  uint32_t maximum_us;
+} SecureTransportTimer;
+
+/* Configuration and resumption state of TLS or of DTLS */
+typedef struct {
+  mbedtls_ssl_config config;
+#if defined(MBEDTLS_SSL_CACHE_C)
+  mbedtls_ssl_cache_context cache;
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+  mbedtls_ssl_ticket_context ticket;
+#endif
+} SecureTransportEndpoint;
+
+static const char *const kTimingNames[kSecureTransportNumberOfTimings] = {
+  [kSecureTransportTimingTlsDecrypt] = "tls_decrypt",
+  [kSecureTransportTimingTlsEncrypt] = "tls_encrypt",
+  [kSecureTransportTimingDtlsDecrypt] = "dtls_decrypt",
+  [kSecureTransportTimingDtlsEncrypt] = "dtls_encrypt",
+  [kSecureTransportTimingFullHandshake] = "full_handshake",
+  [kSecureTransportTimingResumedHandshake] = "resumed_handshake",
+};
+
+#if CONFIG_OPENER_CIP_SECURITY_PSK
+static const int kTlsCiphersuites[] = {
+  MBEDTLS_TLS_ECDHE_PSK_WITH_AES_128_CBC_SHA256,
+  0
+};
+static const int kDtlsCiphersuites[] = {
+#if CONFIG_OPENER_CIP_SECURITY_INTEGRITY_ONLY_IO && \
+  defined(MBEDTLS_CIPHER_NULL_CIPHER)
+  MBEDTLS_TLS_ECDHE_PSK_WITH_NULL_SHA256,
+#endif
+  MBEDTLS_TLS_ECDHE_PSK_WITH_AES_128_CBC_SHA256,
+  0
+};
+#else
+static const int kTlsCiphersuites[] = {
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+  0
+};
+static const int kDtlsCiphersuites[] = {
+#if CONFIG_OPENER_CIP_SECURITY_INTEGRITY_ONLY_IO && \
+  defined(MBEDTLS_CIPHER_NULL_CIPHER)
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_NULL_SHA,
+#endif
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+  0
+};
+#endif
+
+/* Guards the session states and the ssl of the established DTLS sessions.
+ * A handshake runs without it, only the task touches such a session. */
+static SemaphoreHandle_t s_lock = NULL;
+static SemaphoreHandle_t s_random_lock = NULL;
+static portMUX_TYPE s_statistics_lock = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t s_handshake_queue = NULL;
+static bool s_started = false;
+/* Cleared by SecureTransportClose(), the task then drops its handshakes */
+static volatile bool s_open = false;
+
+static int s_dtls_socket = kEipInvalidSocket; /* read by the network handler */
+static int s_tls_listener = kEipInvalidSocket; /* owned by the task */
+static CipUsint s_dtls_dscp = UINT8_MAX;
+
+static mbedtls_entropy_context s_entropy;
+static mbedtls_ctr_drbg_context s_random;
+static mbedtls_ssl_cookie_ctx s_cookie;
+static SecureTransportEndpoint s_tls;
+static SecureTransportEndpoint s_dtls;
+#if CONFIG_OPENER_CIP_SECURITY_PSK
+static unsigned char s_psk[32];
+static size_t s_psk_length = 0;
+#else
+static mbedtls_pk_context s_key;
+static mbedtls_x509_crt s_certificate;
+#endif
+
+static TlsSession s_tls_sessions[CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS];
+static DtlsSession s_dtls_sessions[SECURE_TRANSPORT_DTLS_SLOTS];
+static DtlsSession *s_dtls_listener = NULL; /* owned by the task */
+/* Set by the resumption callbacks, which only run in the task */
+static bool s_handshake_resumed = false;
+
+/* Used by the network handler and the producer, under the stack lock */
+static uint8_t s_receive_buffer[SECURE_TRANSPORT_DATAGRAM_SIZE];
+static uint8_t s_plaintext[SECURE_TRANSPORT_DATAGRAM_SIZE];
+static uint8_t s_send_buffer[PC_OPENER_ETHERNET_BUFFER_SIZE];
+/* Used by the task */
+static DtlsDatagram s_task_datagram;
+
+static SecureTransportTimer s_timers[kSecureTransportNumberOfTimings];
+static uint32_t s_handshake_failures = 0;
+static uint32_t s_refused_connections = 0;
+static uint32_t s_dropped_datagrams = 0;
+static uint32_t s_send_errors = 0;
+
+static void SecureTransportCount(uint32_t *const counter) {
+  taskENTER_CRITICAL(&s_statistics_lock);
+  (*counter)++;
+  taskEXIT_CRITICAL(&s_statistics_lock);
+}
+
+static void SecureTransportRecordTiming(const SecureTransportTimingKind kind,
+                                        const int64_t duration_us) {
+  const uint32_t duration = (duration_us > 0) ? (uint32_t) duration_us : 0;
+  taskENTER_CRITICAL(&s_statistics_lock);
+  SecureTransportTimer *const timer = &s_timers[kind];
+  timer->count++;
+  timer->total_us += duration;
+  if(duration > timer->maximum_us) {
+    timer->maximum_us = duration;
+  }
+  taskEXIT_CRITICAL(&s_statistics_lock);
+}
+
+/* The DRBG is shared by the task and the record layer, CBC takes its IVs */
+static int SecureTransportRandom(void *context,
+                                 unsigned char *output,
+                                 size_t length) {
+  xSemaphoreTake(s_random_lock, portMAX_DELAY);
+  const int result = mbedtls_ctr_drbg_random(context, output, length);
+  xSemaphoreGive(s_random_lock);
+  return result;
+}
+
+#if defined(MBEDTLS_SSL_CACHE_C)
+static int SecureTransportCacheGet(void *data,
+                                   unsigned char const *session_id,
+                                   size_t session_id_length,
+                                   mbedtls_ssl_session *session) {
+  const int result = mbedtls_ssl_cache_get(data, session_id,
+                                           session_id_length, session);
+  if(0 == result) {
+    s_handshake_resumed = true;
+  }
+  return result;
+}
+#endif
+
+#if defined(MBEDTLS_SSL_TICKET_C)
+static int SecureTransportTicketParse(void *ticket,
+                                      mbedtls_ssl_session *session,
+                                      unsigned char *buffer,
+                                      size_t length) {
+  const int result = mbedtls_ssl_ticket_parse(ticket, session, buffer,
+                                              length);
+  if(0 == result) {
+    s_handshake_resumed = true;
+  }
+  return result;
+}
+#endif
+
+/* One call of mbedtls_ssl_handshake(), its compute time is added up */
+static int SecureTransportHandshake(mbedtls_ssl_context *const ssl,
+                                    SecureHandshake *const handshake,
+                                    int64_t *const bio_us) {
+  *bio_us = 0;
+  s_handshake_resumed = false;
+  const int64_t start = esp_timer_get_time();
+  const int result = mbedtls_ssl_handshake(ssl);
+  handshake->compute_us += esp_timer_get_time() - start - *bio_us;
+  handshake->resumed = handshake->resumed || s_handshake_resumed;
+  return result;
+}
+
+static void SecureTransportHandshakeDone(const SecureHandshake *const handshake)
+{
+  SecureTransportRecordTiming(handshake->resumed ?
+                              kSecureTransportTimingResumedHandshake :
+                              kSecureTransportTimingFullHandshake,
+                              handshake->compute_us);
+}
+
+static bool SecureTransportIsPending(const int result) {
+  return MBEDTLS_ERR_SSL_WANT_READ == result ||
+         MBEDTLS_ERR_SSL_WANT_WRITE == result;
+}
+
+/* ---------------------------------------------------------------------------
+ * Device identity
+ * ------------------------------------------------------------------------- */
+
+#if CONFIG_OPENER_CIP_SECURITY_PSK
+
+static int SecureTransportHexDigit(const char digit) {
+  if(digit >= '0' && digit <= '9') {
+    return digit - '0';
+  }
+  if(digit >= 'a' && digit <= 'f') {
+    return digit - 'a' + 10;
+  }
+  if(digit >= 'A' && digit <= 'F') {
+    return digit - 'A' + 10;
+  }
+  return -1;
+}
+
+static bool SecureTransportLoadIdentity(void) {
+  const char *const hex = CONFIG_OPENER_CIP_SECURITY_PSK_KEY;
+  const size_t digits = strlen(hex);
+  if(0 != digits % 2U || digits < 32U || digits > 2U * sizeof(s_psk) ) {
+    OPENER_TRACE_ERR("secure_transport: the pre-shared key needs 16 to 32 "
+                     "bytes\n");
+    return false;
+  }
+  for(size_t i = 0; i < digits / 2U; ++i) {
+    const int high = SecureTransportHexDigit(hex[2U * i]);
+    const int low = SecureTransportHexDigit(hex[2U * i + 1U]);
+    if(high < 0 || low < 0) {
+      OPENER_TRACE_ERR("secure_transport: the pre-shared key is not hex\n");
+      return false;
+    }
+    s_psk[i] = (unsigned char) ( (high << 4) | low );
+  }
+  s_psk_length = digits / 2U;
+  return true;
+}
+
+#else
+
+static bool SecureTransportReadIdentity(void) {
+  nvs_handle_t handle;
+  if(ESP_OK != nvs_open(SECURE_TRANSPORT_NVS_NAMESPACE, NVS_READONLY,
+                        &handle) ) {
+    return false; /* never stored */
+  }
+  static unsigned char der[SECURE_TRANSPORT_DER_SIZE];
+  size_t size = sizeof(der);
+  bool loaded = ESP_OK == nvs_get_blob(handle, SECURE_TRANSPORT_NVS_KEY, der,
+                                       &size) &&
+                0 == mbedtls_pk_parse_key(&s_key, der, size, NULL, 0,
+                                          SecureTransportRandom, &s_random);
+  mbedtls_platform_zeroize(der, sizeof(der) );
+  size = sizeof(der);
+  loaded = loaded &&
+           ESP_OK == nvs_get_blob(handle, SECURE_TRANSPORT_NVS_CERTIFICATE, der,
+                                  &size) &&
+           0 == mbedtls_x509_crt_parse_der(&s_certificate, der, size);
+  nvs_close(handle);
+  return loaded;
+}
+
+static void SecureTransportStoreIdentity(const unsigned char *const key,
+                                         const size_t key_length,
+                                         const unsigned char *const
+                                         certificate,
+                                         const size_t certificate_length) {
+  nvs_handle_t handle;
+  if(ESP_OK != nvs_open(SECURE_TRANSPORT_NVS_NAMESPACE, NVS_READWRITE,
+                        &handle) ) {
+    OPENER_TRACE_WARN("secure_transport: identity not stored, a new one is "
+                      "made at the next start\n");
+    return;
+  }
+  if(ESP_OK != nvs_set_blob(handle, SECURE_TRANSPORT_NVS_KEY, key,
+                            key_length) ||
+     ESP_OK != nvs_set_blob(handle, SECURE_TRANSPORT_NVS_CERTIFICATE,
+                            certificate, certificate_length) ||
+     ESP_OK != nvs_commit(handle) ) {
+    OPENER_TRACE_WARN("secure_transport: identity not stored, a new one is "
+                      "made at the next start\n");
+  }
+  nvs_close(handle);
+}
+
+/* An ECDSA P-256 key and a certificate signed with it, named after the
+ * Ethernet MAC address */
+static bool SecureTransportCreateIdentity(void) {
+  mbedtls_pk_free(&s_key);
+  mbedtls_pk_init(&s_key);
+  mbedtls_x509_crt_free(&s_certificate);
+  mbedtls_x509_crt_init(&s_certificate);
+
+  int result = mbedtls_pk_setup(&s_key,
+                                mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY) );
+  if(0 == result) {
+    result = mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1,
+                                 mbedtls_pk_ec(s_key),
+                                 SecureTransportRandom,
+                                 &s_random);
+  }
+  if(0 != result) {
+    OPENER_TRACE_ERR("secure_transport: key generation failed: -0x%04x\n",
+                     (unsigned) -result);
+    return false;
+  }
+
+  uint8_t mac[6] = { 0 };
+  (void) esp_read_mac(mac, ESP_MAC_ETH);
+  char subject[64];
+  snprintf(subject, sizeof(subject),
+           "CN=OpENer-%02X%02X%02X%02X%02X%02X,O=OpENer",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  unsigned char serial[8];
+  result = SecureTransportRandom(&s_random, serial, sizeof(serial) );
+  serial[0] = (serial[0] & 0x7FU) | 0x01U; /* positive and not zero */
+
+  mbedtls_x509write_cert writer;
+  mbedtls_x509write_crt_init(&writer);
+  mbedtls_x509write_crt_set_version(&writer, MBEDTLS_X509_CRT_VERSION_3);
+  mbedtls_x509write_crt_set_md_alg(&writer, MBEDTLS_MD_SHA256);
+  mbedtls_x509write_crt_set_subject_key(&writer, &s_key);
+  mbedtls_x509write_crt_set_issuer_key(&writer, &s_key);
+  if(0 == result) {
+    result = mbedtls_x509write_crt_set_subject_name(&writer, subject);
+  }
+  if(0 == result) {
+    result = mbedtls_x509write_crt_set_issuer_name(&writer, subject);
+  }
+  if(0 == result) {
+    result = mbedtls_x509write_crt_set_serial_raw(&writer, serial,
+                                                  sizeof(serial) );
+  }
+  if(0 == result) {
+    result = mbedtls_x509write_crt_set_validity(&writer, "20250101000000",
+                                                "20491231235959");
+  }
+  if(0 == result) {
+    result = mbedtls_x509write_crt_set_basic_constraints(&writer, 0, -1);
+  }
+  if(0 == result) {
+    result = mbedtls_x509write_crt_set_key_usage(&writer,
+                                                 MBEDTLS_X509_KU_DIGITAL_SIGNATURE);
+  }
+
+  /* both are written to the end of their buffer */
+  static unsigned char certificate[SECURE_TRANSPORT_DER_SIZE];
+  static unsigned char key[SECURE_TRANSPORT_DER_SIZE];
+  int certificate_length = 0;
+  if(0 == result) {
+    certificate_length = mbedtls_x509write_crt_der(&writer, certificate,
+                                                   sizeof(certificate),
+                                                   SecureTransportRandom,
+                                                   &s_random);
+    result = (certificate_length > 0) ? 0 : certificate_length;
+  }
+  mbedtls_x509write_crt_free(&writer);
+  int key_length = 0;
+  if(0 == result) {
+    key_length = mbedtls_pk_write_key_der(&s_key, key, sizeof(key) );
+    result = (key_length > 0) ? 0 : key_length;
+  }
+  if(0 == result) {
+    const unsigned char *const certificate_der = certificate +
+                                                 sizeof(certificate) -
+                                                 certificate_length;
+    result = mbedtls_x509_crt_parse_der(&s_certificate, certificate_der,
+                                        (size_t) certificate_length);
+    if(0 == result) {
+      SecureTransportStoreIdentity(key + sizeof(key) - key_length,
+                                   (size_t) key_length,
+                                   certificate_der,
+                                   (size_t) certificate_length);
+    }
+  }
+  mbedtls_platform_zeroize(key, sizeof(key) );
+  if(0 != result) {
+    OPENER_TRACE_ERR("secure_transport: certificate not created: -0x%04x\n",
+                     (unsigned) -result);
+    return false;
+  }
+  OPENER_TRACE_INFO("secure_transport: created the certificate of %s\n",
+                    subject);
+  return true;
+}
+
+static bool SecureTransportLoadIdentity(void) {
+  return SecureTransportReadIdentity() || SecureTransportCreateIdentity();
+}
+
+#endif /* CONFIG_OPENER_CIP_SECURITY_PSK */
+
+static int SecureTransportSetUpEndpoint(SecureTransportEndpoint *const
+                                        endpoint,
+                                        const int transport,
+                                        const int *const ciphersuites) {
+  mbedtls_ssl_config *const config = &endpoint->config;
+  int result = mbedtls_ssl_config_defaults(config, MBEDTLS_SSL_IS_SERVER,
+                                           transport,
+                                           MBEDTLS_SSL_PRESET_DEFAULT);
+  if(0 != result) {
+    return result;
+  }
+  mbedtls_ssl_conf_min_tls_version(config, MBEDTLS_SSL_VERSION_TLS1_2);
+  mbedtls_ssl_conf_max_tls_version(config, MBEDTLS_SSL_VERSION_TLS1_2);
+  mbedtls_ssl_conf_rng(config, SecureTransportRandom, &s_random);
+  /* without the Certificate Management object there is no trust store for
+   * the originators' certificates */
+  mbedtls_ssl_conf_authmode(config, MBEDTLS_SSL_VERIFY_NONE);
+  mbedtls_ssl_conf_ciphersuites(config, ciphersuites);
+#if defined(MBEDTLS_SSL_RENEGOTIATION)
+  /* an established session is never handed back to the task */
+  mbedtls_ssl_conf_renegotiation(config, MBEDTLS_SSL_RENEGOTIATION_DISABLED);
+#endif
+#if CONFIG_OPENER_CIP_SECURITY_PSK
+  result = mbedtls_ssl_conf_psk(config, s_psk, s_psk_length,
+                                (const unsigned char *)
+                                CONFIG_OPENER_CIP_SECURITY_PSK_IDENTITY,
+                                strlen(CONFIG_OPENER_CIP_SECURITY_PSK_IDENTITY) );
+#else
+  result = mbedtls_ssl_conf_own_cert(config, &s_certificate, &s_key);
+#endif
+  if(0 != result) {
+    return result;
+  }
+
+#if defined(MBEDTLS_SSL_CACHE_C)
+  if(0 != CONFIG_OPENER_CIP_SECURITY_SESSION_CACHE) {
+    mbedtls_ssl_cache_set_max_entries(&endpoint->cache,
+                                      CONFIG_OPENER_CIP_SECURITY_SESSION_CACHE);
+    mbedtls_ssl_cache_set_timeout(&endpoint->cache,
+                                  CONFIG_OPENER_CIP_SECURITY_SESSION_LIFETIME_S);
+    mbedtls_ssl_conf_session_cache(config, &endpoint->cache,
+                                   SecureTransportCacheGet,
+                                   mbedtls_ssl_cache_set);
+  }
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+  result = mbedtls_ssl_ticket_setup(&endpoint->ticket, SecureTransportRandom,
+                                    &s_random, MBEDTLS_CIPHER_AES_256_GCM,
+                                    CONFIG_OPENER_CIP_SECURITY_SESSION_LIFETIME_S);
+  if(0 != result) {
+    return result;
+  }
+  mbedtls_ssl_conf_session_tickets_cb(config, mbedtls_ssl_ticket_write,
+                                      SecureTransportTicketParse,
+                                      &endpoint->ticket);
+#endif
+
+  if(MBEDTLS_SSL_TRANSPORT_DATAGRAM == transport) {
+    mbedtls_ssl_conf_dtls_cookies(config, mbedtls_ssl_cookie_write,
+                                  mbedtls_ssl_cookie_check, &s_cookie);
+    mbedtls_ssl_conf_handshake_timeout(config,
+                                       SECURE_TRANSPORT_DTLS_TIMEOUT_MIN_MS,
+                                       SECURE_TRANSPORT_DTLS_TIMEOUT_MAX_MS);
+  }
+  return 0;
+}
+
+static bool SecureTransportConfigure(void) {
+  static const char kPersonalization[] = "opener cip security";
+  int result = mbedtls_ctr_drbg_seed(&s_random, mbedtls_entropy_func,
+                                     &s_entropy,
+                                     (const unsigned char *) kPersonalization,
+                                     sizeof(kPersonalization) - 1U);
+  if(0 != result || !SecureTransportLoadIdentity() ) {
+    OPENER_TRACE_ERR("secure_transport: no identity: -0x%04x\n",
+                     (unsigned) -result);
+    return false;
+  }
+  result = mbedtls_ssl_cookie_setup(&s_cookie, SecureTransportRandom,
+                                    &s_random);
+  if(0 == result) {
+    result = SecureTransportSetUpEndpoint(&s_tls,
+                                          MBEDTLS_SSL_TRANSPORT_STREAM,
+                                          kTlsCiphersuites);
+  }
+  if(0 == result) {
+    result = SecureTransportSetUpEndpoint(&s_dtls,
+                                          MBEDTLS_SSL_TRANSPORT_DATAGRAM,
+                                          kDtlsCiphersuites);
+  }
+  if(0 != result) {
+    OPENER_TRACE_ERR("secure_transport: configuration failed: -0x%04x\n",
+                     (unsigned) -result);
+    return false;
+  }
+  return true;
+}
+
+static int SecureTransportOpenSocket(const int type) {
+  const int socket_handle = socket(AF_INET, type,
+                                   (SOCK_DGRAM == type) ? IPPROTO_UDP :
+                                   IPPROTO_TCP);
+  if(socket_handle < 0) {
+    return kEipInvalidSocket;
+  }
+  int option_value = 1;
+  (void) setsockopt(socket_handle, SOL_SOCKET, SO_REUSEADDR, &option_value,
+                    sizeof(option_value) );
+  const struct sockaddr_in address = {
+    .sin_family = AF_INET,
+    .sin_port = htons(SECURE_TRANSPORT_PORT),
+    .sin_addr.s_addr = htonl(INADDR_ANY),
+  };
+  if(0 != bind(socket_handle, (const struct sockaddr *) &address,
+               sizeof(address) ) ||
+     SetSocketToNonBlocking(socket_handle) < 0 ||
+     (SOCK_STREAM == type &&
+      0 != listen(socket_handle, CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS) ) ) {
+    OPENER_TRACE_ERR("secure_transport: port %d not opened: %d\n",
+                     SECURE_TRANSPORT_PORT, errno);
+    close(socket_handle);
+    return kEipInvalidSocket;
+  }
+  return socket_handle;
+}
+
+/* ---------------------------------------------------------------------------
+ * TLS
+ * ------------------------------------------------------------------------- */
+
+static int TlsSessionSend(void *context,
+                          const unsigned char *data,
+                          size_t length) {
+  TlsSession *const session = context;
+  const int64_t start = esp_timer_get_time();
+  const ssize_t sent = send(session->socket, data, length, MSG_DONTWAIT);
+  session->bio_us += esp_timer_get_time() - start;
+  if(sent >= 0) {
+    return (int) sent;
+  }
+  if(EWOULDBLOCK == errno || EAGAIN == errno) {
+    return MBEDTLS_ERR_SSL_WANT_WRITE;
+  }
+  return (EPIPE == errno || ECONNRESET == errno) ?
+         MBEDTLS_ERR_NET_CONN_RESET : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+static int TlsSessionReceive(void *context,
+                             unsigned char *buffer,
+                             size_t length) {
+  TlsSession *const session = context;
+  const int64_t start = esp_timer_get_time();
+  const ssize_t received = recv(session->socket, buffer, length,
+                                MSG_DONTWAIT);
+  session->bio_us += esp_timer_get_time() - start;
+  if(received >= 0) {
+    return (int) received; /* 0 is the end of the stream */
+  }
+  if(EWOULDBLOCK == errno || EAGAIN == errno) {
+    return MBEDTLS_ERR_SSL_WANT_READ;
+  }
+  return (ECONNRESET == errno) ?
+         MBEDTLS_ERR_NET_CONN_RESET : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+/* Called with s_lock held */
+static TlsSession *TlsSessionFind(const int socket_handle,
+                                  const SecureSessionState state) {
+  for(size_t i = 0; i < CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS; ++i) {
+    TlsSession *const session = &s_tls_sessions[i];
+    if(state == session->state && socket_handle == session->socket) {
+      return session;
+    }
+  }
+  return NULL;
+}
+
+/* Called with s_lock held, the socket is left to the caller */
+static void TlsSessionRelease(TlsSession *const session) {
+  mbedtls_ssl_free(&session->ssl);
+  mbedtls_ssl_init(&session->ssl);
+  session->socket = kEipInvalidSocket;
+  session->peer_address = 0;
+  session->state = kSecureSessionFree;
+}
+
+static void TlsSessionFail(TlsSession *const session, const int result) {
+  OPENER_TRACE_WARN("secure_transport: TLS handshake with %08" PRIx32
+                    " failed: -0x%04x\n",
+                    (uint32_t) ntohl(session->peer_address),
+                    (unsigned) -result);
+  SecureTransportCount(&s_handshake_failures);
+  const int socket_handle = session->socket;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  TlsSessionRelease(session);
+  xSemaphoreGive(s_lock);
+  close(socket_handle);
+}
+
+static void TlsAccept(void) {
+  struct sockaddr_in peer;
+  socklen_t peer_length = sizeof(peer);
+  const int socket_handle = accept(s_tls_listener, (struct sockaddr *) &peer,
+                                   &peer_length);
+  if(socket_handle < 0) {
+    return;
+  }
+
+  /* only the task takes free sessions */
+  TlsSession *session = NULL;
+  for(size_t i = 0; i < CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS; ++i) {
+    if(kSecureSessionFree == s_tls_sessions[i].state) {
+      session = &s_tls_sessions[i];
+      break;
+    }
+  }
+  if(NULL == session || SetSocketToNonBlocking(socket_handle) < 0 ||
+     0 != mbedtls_ssl_setup(&session->ssl, &s_tls.config) ) {
+    if(NULL != session) {
+      mbedtls_ssl_free(&session->ssl);
+      mbedtls_ssl_init(&session->ssl);
+    }
+    SecureTransportCount(&s_refused_connections);
+    close(socket_handle);
+    return;
+  }
+  mbedtls_ssl_set_bio(&session->ssl, session, TlsSessionSend,
+                      TlsSessionReceive, NULL);
+  session->socket = socket_handle;
+  session->peer_address = peer.sin_addr.s_addr;
+  session->handshake = (SecureHandshake) {
+    .started_us = esp_timer_get_time(),
+  };
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  session->state = kSecureSessionHandshake;
+  xSemaphoreGive(s_lock);
+}
+
+static void TlsSessionStep(TlsSession *const session, const int64_t now) {
+  const int result = SecureTransportHandshake(&session->ssl,
+                                              &session->handshake,
+                                              &session->bio_us);
+  if(0 == result) {
+    SecureTransportHandshakeDone(&session->handshake);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    session->state = kSecureSessionReady;
+    xSemaphoreGive(s_lock);
+    OPENER_TRACE_INFO("secure_transport: TLS session on socket %d, %s\n",
+                      session->socket,
+                      mbedtls_ssl_get_ciphersuite(&session->ssl) );
+  } else if(!SecureTransportIsPending(result) ) {
+    TlsSessionFail(session, result);
+  } else if(now - session->handshake.started_us >
+            SECURE_TRANSPORT_HANDSHAKE_TIMEOUT_US) {
+    TlsSessionFail(session, MBEDTLS_ERR_SSL_TIMEOUT);
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * DTLS
+ * ------------------------------------------------------------------------- */
+
+static int DtlsSessionSend(void *context,
+                           const unsigned char *data,
+                           size_t length) {
+  DtlsSession *const session = context;
+  const int64_t start = esp_timer_get_time();
+  const ssize_t sent = sendto(s_dtls_socket, data, length, 0,
+                              (const struct sockaddr *) &session->peer,
+                              sizeof(session->peer) );
+  session->bio_us += esp_timer_get_time() - start;
+  if(sent < 0) {
+    SecureTransportCount(&s_send_errors);
+    session->send_failed = true;
+  }
+  return (int) length; /* a datagram that was not sent is lost on the way */
+}
+
+static int DtlsSessionReceive(void *context,
+                              unsigned char *buffer,
+                              size_t length) {
+  DtlsSession *const session = context;
+  if(NULL == session->input || session->input_length > length) {
+    session->input = NULL;
+    return MBEDTLS_ERR_SSL_WANT_READ;
+  }
+  const size_t input_length = session->input_length;
+  memcpy(buffer, session->input, input_length);
+  session->input = NULL;
+  return (int) input_length;
+}
+
+static void DtlsSessionSetTimer(void *context,
+                                uint32_t intermediate_ms,
+                                uint32_t final_ms) {
+  DtlsSession *const session = context;
+  session->timer_start_us = esp_timer_get_time();
+  session->timer_intermediate_ms = intermediate_ms;
+  session->timer_final_ms = final_ms;
+}
+
+static int DtlsSessionGetTimer(void *context) {
+  const DtlsSession *const session = context;
+  if(0 == session->timer_final_ms) {
+    return -1;
+  }
+  const int64_t elapsed_ms = (esp_timer_get_time() - session->timer_start_us) /
+                             1000;
+  if(elapsed_ms >= session->timer_final_ms) {
+    return 2;
+  }
+  return (elapsed_ms >= session->timer_intermediate_ms) ? 1 : 0;
+}
+
+static bool DtlsSessionMatches(const DtlsSession *const session,
+                               const struct sockaddr_in *const peer) {
+  return session->peer.sin_addr.s_addr == peer->sin_addr.s_addr &&
+         session->peer.sin_port == peer->sin_port;
+}
+
+/* A handshake or established session with the peer, called with s_lock
+ * held */
+static DtlsSession *DtlsSessionFind(const struct sockaddr_in *const peer) {
+  for(size_t i = 0; i < SECURE_TRANSPORT_DTLS_SLOTS; ++i) {
+    DtlsSession *const session = &s_dtls_sessions[i];
+    if( (kSecureSessionHandshake == session->state ||
+         kSecureSessionReady == session->state) &&
+        DtlsSessionMatches(session, peer) ) {
+      return session;
+    }
+  }
+  return NULL;
+}
+
+/* Called with s_lock held */
+static void DtlsSessionRelease(DtlsSession *const session) {
+  if(s_dtls_listener == session) {
+    s_dtls_listener = NULL;
+  }
+  mbedtls_ssl_free(&session->ssl);
+  mbedtls_ssl_init(&session->ssl);
+  session->input = NULL;
+  session->timer_final_ms = 0;
+  session->tls_socket = kEipInvalidSocket;
+  session->state = kSecureSessionFree;
+}
+
+static void DtlsSessionFail(DtlsSession *const session, const int result) {
+  OPENER_TRACE_WARN("secure_transport: DTLS handshake with %08" PRIx32
+                    " failed: -0x%04x\n",
+                    (uint32_t) ntohl(session->peer.sin_addr.s_addr),
+                    (unsigned) -result);
+  SecureTransportCount(&s_handshake_failures);
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  DtlsSessionRelease(session);
+  xSemaphoreGive(s_lock);
+}
+
+/* A free context answers new peers while the sessions are not used up */
+static void DtlsChooseListener(void) {
+  if(NULL != s_dtls_listener) {
+    return;
+  }
+  size_t used = 0;
+  DtlsSession *free_session = NULL;
+  for(size_t i = 0; i < SECURE_TRANSPORT_DTLS_SLOTS; ++i) {
+    DtlsSession *const session = &s_dtls_sessions[i];
+    if(kSecureSessionFree == session->state) {
+      free_session = (NULL == free_session) ? session : free_session;
+    } else {
+      used++;
+    }
+  }
+  if(NULL == free_session || used >= CONFIG_OPENER_CIP_SECURITY_DTLS_SESSIONS) {
+    return;
+  }
+  if(0 != mbedtls_ssl_setup(&free_session->ssl, &s_dtls.config) ) {
+    mbedtls_ssl_free(&free_session->ssl);
+    mbedtls_ssl_init(&free_session->ssl);
+    return;
+  }
+  mbedtls_ssl_set_bio(&free_session->ssl, free_session, DtlsSessionSend,
+                      DtlsSessionReceive, NULL);
+  mbedtls_ssl_set_timer_cb(&free_session->ssl, free_session,
+                           DtlsSessionSetTimer, DtlsSessionGetTimer);
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  free_session->state = kSecureSessionListening;
+  xSemaphoreGive(s_lock);
+  s_dtls_listener = free_session;
+}
+
+static void DtlsSessionStep(DtlsSession *const session,
+                            const uint8_t *const data,
+                            const size_t length) {
+  session->input = data;
+  session->input_length = length;
+  const int result = SecureTransportHandshake(&session->ssl,
+                                              &session->handshake,
+                                              &session->bio_us);
+  session->input = NULL;
+  if(0 == result) {
+    SecureTransportHandshakeDone(&session->handshake);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    session->last_activity_us = esp_timer_get_time();
+    session->tls_socket = kEipInvalidSocket;
+    session->state = kSecureSessionReady;
+    xSemaphoreGive(s_lock);
+    OPENER_TRACE_INFO("secure_transport: DTLS session with %08" PRIx32
+                      ", %s\n",
+                      (uint32_t) ntohl(session->peer.sin_addr.s_addr),
+                      mbedtls_ssl_get_ciphersuite(&session->ssl) );
+    DtlsChooseListener();
+  } else if(!SecureTransportIsPending(result) ) {
+    DtlsSessionFail(session, result);
+    DtlsChooseListener();
+  }
+}
+
+/* The listening context sends a HelloVerifyRequest to a ClientHello
+ * without a valid cookie. One with the cookie starts a session. */
+static void DtlsListen(const DtlsDatagram *const datagram) {
+  if(NULL == s_dtls_listener) {
+    DtlsChooseListener();
+  }
+  DtlsSession *const listener = s_dtls_listener;
+  if(NULL == listener ||
+     0 != mbedtls_ssl_session_reset(&listener->ssl) ) {
+    SecureTransportCount(&s_dropped_datagrams);
+    return;
+  }
+  listener->peer = datagram->from;
+  unsigned char transport_id[sizeof(datagram->from.sin_addr.s_addr) +
+                             sizeof(datagram->from.sin_port)];
+  memcpy(transport_id, &datagram->from.sin_addr.s_addr,
+         sizeof(datagram->from.sin_addr.s_addr) );
+  memcpy(transport_id + sizeof(datagram->from.sin_addr.s_addr),
+         &datagram->from.sin_port, sizeof(datagram->from.sin_port) );
+  (void) mbedtls_ssl_set_client_transport_id(&listener->ssl, transport_id,
+                                             sizeof(transport_id) );
+  listener->handshake = (SecureHandshake) {
+    .started_us = esp_timer_get_time(),
+  };
+  listener->input = datagram->data;
+  listener->input_length = datagram->length;
+  const int result = SecureTransportHandshake(&listener->ssl,
+                                              &listener->handshake,
+                                              &listener->bio_us);
+  listener->input = NULL;
+  if( SecureTransportIsPending(result) ) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    listener->state = kSecureSessionHandshake;
+    s_dtls_listener = NULL;
+    xSemaphoreGive(s_lock);
+    DtlsChooseListener();
+  } else if(MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED != result) {
+    SecureTransportCount(&s_dropped_datagrams); /* not a ClientHello */
+  }
+}
+
+static void DtlsHandleDatagram(const DtlsDatagram *const datagram) {
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  DtlsSession *const session = DtlsSessionFind(&datagram->from);
+  xSemaphoreGive(s_lock);
+  if(NULL == session) {
+    DtlsListen(datagram);
+  } else if(kSecureSessionHandshake == session->state) {
+    DtlsSessionStep(session, datagram->data, datagram->length);
+  }
+  /* else established meanwhile, the peer retransmits what is still needed */
+}
+
+/* Decrypts the records of a datagram, called with s_lock held */
+static void DtlsSessionRead(DtlsSession *const session,
+                            const uint8_t *const data,
+                            const size_t length,
+                            struct sockaddr_in *const from) {
+  session->input = data;
+  session->input_length = length;
+  while(kSecureSessionReady == session->state) {
+    session->bio_us = 0;
+    const int64_t start = esp_timer_get_time();
+    const int result = mbedtls_ssl_read(&session->ssl, s_plaintext,
+                                        sizeof(s_plaintext) );
+    if(result > 0) {
+      const int64_t now = esp_timer_get_time();
+      SecureTransportRecordTiming(kSecureTransportTimingDtlsDecrypt,
+                                  now - start - session->bio_us);
+      session->last_activity_us = now;
+      /* the connection manager may produce, which takes the lock again */
+      xSemaphoreGive(s_lock);
+      NetworkHandlerReceivedSecureIoMessage(s_plaintext, (size_t) result,
+                                            from);
+      xSemaphoreTake(s_lock, portMAX_DELAY);
+      continue;
+    }
+    if( !SecureTransportIsPending(result) ) {
+      /* a ClientHello from the same port starts over, its retransmission
+       * reaches the listening context */
+      OPENER_TRACE_INFO("secure_transport: DTLS session with %08" PRIx32
+                        " closed: -0x%04x\n",
+                        (uint32_t) ntohl(session->peer.sin_addr.s_addr),
+                        (unsigned) -result);
+      DtlsSessionRelease(session);
+    }
+    break;
+  }
+  session->input = NULL;
+}
+
+/* The sessions established before Close are freed there, those of the
+ * task and the waiting TLS sessions here */
+static void SecureTransportDropHandshakes(void) {
+  while(pdTRUE == xQueueReceive(s_handshake_queue, &s_task_datagram, 0) ) {
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  for(size_t i = 0; i < SECURE_TRANSPORT_DTLS_SLOTS; ++i) {
+    if(kSecureSessionHandshake == s_dtls_sessions[i].state) {
+      DtlsSessionRelease(&s_dtls_sessions[i]);
+    }
+  }
+  for(size_t i = 0; i < CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS; ++i) {
+    TlsSession *const session = &s_tls_sessions[i];
+    if(kSecureSessionHandshake == session->state ||
+       kSecureSessionReady == session->state) {
+      const int socket_handle = session->socket;
+      TlsSessionRelease(session);
+      close(socket_handle);
+    }
+  }
+  xSemaphoreGive(s_lock);
+}
+
+static void DtlsExpireSessions(const int64_t now) {
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  for(size_t i = 0; i < SECURE_TRANSPORT_DTLS_SLOTS; ++i) {
+    DtlsSession *const session = &s_dtls_sessions[i];
+    if(kSecureSessionReady == session->state &&
+       now - session->last_activity_us > SECURE_TRANSPORT_DTLS_IDLE_US) {
+      (void) mbedtls_ssl_close_notify(&session->ssl);
+      DtlsSessionRelease(session);
+    }
+  }
+  xSemaphoreGive(s_lock);
+}
+
+/* ---------------------------------------------------------------------------
+ * Handshake task
+ * ------------------------------------------------------------------------- */
+
+static void SecureTransportTask(void *argument) {
+  (void) argument;
+  if( !SecureTransportConfigure() ) {
+    OPENER_TRACE_ERR("secure_transport: port %d stays closed\n",
+                     SECURE_TRANSPORT_PORT);
+    vTaskDelete(NULL);
+    return;
+  }
+  /* datagrams received meanwhile waited in the queue */
+  s_tls_listener = SecureTransportOpenSocket(SOCK_STREAM);
+
+  int64_t last_expiry = esp_timer_get_time();
+  for(;; ) {
+    fd_set read_sockets;
+    FD_ZERO(&read_sockets);
+    int highest_socket = -1;
+    const bool open = __atomic_load_n(&s_open, __ATOMIC_ACQUIRE);
+    if(open && kEipInvalidSocket != s_tls_listener) {
+      FD_SET(s_tls_listener, &read_sockets);
+      highest_socket = s_tls_listener;
+    }
+    for(size_t i = 0; i < CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS; ++i) {
+      const TlsSession *const session = &s_tls_sessions[i];
+      if(kSecureSessionHandshake == session->state) {
+        FD_SET(session->socket, &read_sockets);
+        highest_socket = (session->socket > highest_socket) ?
+                         session->socket : highest_socket;
+      }
+    }
+    struct timeval timeout = {
+      .tv_sec = 0,
+      .tv_usec = SECURE_TRANSPORT_POLL_MS * 1000,
+    };
+    if(highest_socket >= 0) {
+      (void) select(highest_socket + 1, &read_sockets, NULL, NULL, &timeout);
+    } else {
+      vTaskDelay(pdMS_TO_TICKS(SECURE_TRANSPORT_POLL_MS) );
+    }
+
+    if(!open) {
+      SecureTransportDropHandshakes();
+      continue;
+    }
+    if(kEipInvalidSocket != s_tls_listener &&
+       FD_ISSET(s_tls_listener, &read_sockets) ) {
+      TlsAccept();
+    }
+    const int64_t now = esp_timer_get_time();
+    /* a handshake that waits for a write is stepped as well */
+    for(size_t i = 0; i < CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS; ++i) {
+      TlsSession *const session = &s_tls_sessions[i];
+      if(kSecureSessionHandshake == session->state) {
+        TlsSessionStep(session, now);
+      }
+    }
+
+    while(pdTRUE == xQueueReceive(s_handshake_queue, &s_task_datagram, 0) ) {
+      DtlsHandleDatagram(&s_task_datagram);
+    }
+    for(size_t i = 0; i < SECURE_TRANSPORT_DTLS_SLOTS; ++i) {
+      DtlsSession *const session = &s_dtls_sessions[i];
+      if(kSecureSessionHandshake == session->state &&
+         2 == DtlsSessionGetTimer(session) ) {
+        DtlsSessionStep(session, NULL, 0); /* retransmits the last flight */
+      }
+    }
+    if(now - last_expiry > 1000000LL) {
+      DtlsExpireSessions(now);
+      last_expiry = now;
+    }
+  }
+}
+
+static bool SecureTransportStart(void) {
+  s_lock = xSemaphoreCreateMutex();
+  s_random_lock = xSemaphoreCreateMutex();
+  s_handshake_queue = xQueueCreate(SECURE_TRANSPORT_QUEUE_LENGTH,
+                                   sizeof(DtlsDatagram) );
+  if(NULL == s_lock || NULL == s_random_lock || NULL == s_handshake_queue) {
+    return false;
+  }
+  mbedtls_entropy_init(&s_entropy);
+  mbedtls_ctr_drbg_init(&s_random);
+  mbedtls_ssl_cookie_init(&s_cookie);
+#if !CONFIG_OPENER_CIP_SECURITY_PSK
+  mbedtls_pk_init(&s_key);
+  mbedtls_x509_crt_init(&s_certificate);
+#endif
+  SecureTransportEndpoint *const endpoints[] = { &s_tls, &s_dtls };
+  for(size_t i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); ++i) {
+    mbedtls_ssl_config_init(&endpoints[i]->config);
+#if defined(MBEDTLS_SSL_CACHE_C)
+    mbedtls_ssl_cache_init(&endpoints[i]->cache);
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+    mbedtls_ssl_ticket_init(&endpoints[i]->ticket);
+#endif
+  }
+  for(size_t i = 0; i < CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS; ++i) {
+    s_tls_sessions[i].socket = kEipInvalidSocket;
+    mbedtls_ssl_init(&s_tls_sessions[i].ssl);
+  }
+  for(size_t i = 0; i < SECURE_TRANSPORT_DTLS_SLOTS; ++i) {
+    s_dtls_sessions[i].tls_socket = kEipInvalidSocket;
+    mbedtls_ssl_init(&s_dtls_sessions[i].ssl);
+  }
+
+  s_dtls_socket = SecureTransportOpenSocket(SOCK_DGRAM);
+  if(kEipInvalidSocket == s_dtls_socket) {
+    return false;
+  }
+  TaskPlacement placement;
+  TaskPlacementGet(kTaskPlacementTaskOpener, &placement);
+  if(pdPASS != xTaskCreatePinnedToCore(SecureTransportTask,
+                                       "cip_security",
+                                       SECURE_TRANSPORT_STACK_SIZE,
+                                       NULL,
+                                       CONFIG_OPENER_CIP_SECURITY_TASK_PRIORITY,
+                                       NULL,
+                                       placement.core) ) {
+    close(s_dtls_socket);
+    s_dtls_socket = kEipInvalidSocket;
+    return false;
+  }
+  return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * Platform interface, see networkhandler.h
+ * ------------------------------------------------------------------------- */
+
+int SecureTransportOpen(void) {
+  if(!s_started) {
+    s_started = true;
+    if( !SecureTransportStart() ) {
+      OPENER_TRACE_ERR("secure_transport: not started\n");
+    }
+  }
+  if(kEipInvalidSocket == s_dtls_socket) {
+    return kEipInvalidSocket;
+  }
+  __atomic_store_n(&s_open, true, __ATOMIC_RELEASE);
+  return s_dtls_socket;
+}
+
+void SecureTransportClose(void) {
+  if(kEipInvalidSocket == s_dtls_socket) {
+    return;
+  }
+  __atomic_store_n(&s_open, false, __ATOMIC_RELEASE);
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  for(size_t i = 0; i < SECURE_TRANSPORT_DTLS_SLOTS; ++i) {
+    DtlsSession *const session = &s_dtls_sessions[i];
+    if(kSecureSessionReady == session->state) {
+      (void) mbedtls_ssl_close_notify(&session->ssl);
+      DtlsSessionRelease(session);
+    }
+  }
+  xSemaphoreGive(s_lock);
+}
+
+int SecureTransportTakeSession(CipUdint *const peer_address) {
+  int socket_handle = kEipInvalidSocket;
+  if(NULL == s_lock) {
+    return socket_handle;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  for(size_t i = 0; i < CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS; ++i) {
+    TlsSession *const session = &s_tls_sessions[i];
+    if(kSecureSessionReady == session->state) {
+      session->state = kSecureSessionAdopted;
+      *peer_address = session->peer_address;
+      socket_handle = session->socket;
+      break;
+    }
+  }
+  xSemaphoreGive(s_lock);
+  return socket_handle;
+}
+
+bool SecureTransportIsHandshaking(void) {
+  if(NULL == s_lock) {
+    return false;
+  }
+  bool handshaking = false;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  for(size_t i = 0; i < CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS; ++i) {
+    const SecureSessionState state = s_tls_sessions[i].state;
+    handshaking = handshaking || kSecureSessionHandshake == state ||
+                  kSecureSessionReady == state;
+  }
+  xSemaphoreGive(s_lock);
+  return handshaking;
+}
+
+/* An adopted session is only used by the network handler, the lock guards
+ * the lookup against the task changing other sessions */
+static TlsSession *TlsSessionAdopted(const int socket_handle) {
+  if(NULL == s_lock) {
+    return NULL;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  TlsSession *const session = TlsSessionFind(socket_handle,
+                                             kSecureSessionAdopted);
+  xSemaphoreGive(s_lock);
+  return session;
+}
+
+long SecureTransportReceive(const int socket,
+                            CipOctet *const buffer,
+                            const size_t length) {
+  TlsSession *const session = TlsSessionAdopted(socket);
+  if(NULL == session) {
+    errno = EBADF;
+    return -1;
+  }
+  session->bio_us = 0;
+  const int64_t start = esp_timer_get_time();
+  const int result = mbedtls_ssl_read(&session->ssl, buffer, length);
+  if(result > 0) {
+    SecureTransportRecordTiming(kSecureTransportTimingTlsDecrypt,
+                                esp_timer_get_time() - start -
+                                session->bio_us);
+    return result;
+  }
+  if(0 == result || MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY == result) {
+    return 0;
+  }
+  if( SecureTransportIsPending(result) ) {
+    errno = EWOULDBLOCK; /* a record is not complete yet */
+    return -1;
+  }
+  OPENER_TRACE_WARN("secure_transport: TLS read on socket %d failed: "
+                    "-0x%04x\n", socket, (unsigned) -result);
+  errno = ECONNRESET;
+  return -1;
+}
+
+long SecureTransportSend(const int socket,
+                         const CipOctet *const data,
+                         const size_t length) {
+  TlsSession *const session = TlsSessionAdopted(socket);
+  if(NULL == session) {
+    errno = EBADF;
+    return -1;
+  }
+  session->bio_us = 0;
+  const int64_t start = esp_timer_get_time();
+  const int result = mbedtls_ssl_write(&session->ssl, data, length);
+  if(result > 0) {
+    SecureTransportRecordTiming(kSecureTransportTimingTlsEncrypt,
+                                esp_timer_get_time() - start -
+                                session->bio_us);
+    return result;
+  }
+  if( SecureTransportIsPending(result) ) {
+    errno = EWOULDBLOCK;
+    return -1;
+  }
+  OPENER_TRACE_WARN("secure_transport: TLS write on socket %d failed: "
+                    "-0x%04x\n", socket, (unsigned) -result);
+  SecureTransportCount(&s_send_errors);
+  errno = ECONNRESET;
+  return -1;
+}
+
+bool SecureTransportHasPendingData(const int socket) {
+  TlsSession *const session = TlsSessionAdopted(socket);
+  return NULL != session &&
+         (0 != mbedtls_ssl_get_bytes_avail(&session->ssl) ||
+          0 != mbedtls_ssl_check_pending(&session->ssl) );
+}
+
+void SecureTransportCloseSession(const int socket) {
+  if(NULL == s_lock) {
+    return;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  TlsSession *const session = TlsSessionFind(socket, kSecureSessionAdopted);
+  if(NULL != session) {
+    (void) mbedtls_ssl_close_notify(&session->ssl); /* one try, no wait */
+    TlsSessionRelease(session);
+  }
+  /* the bound I/O connections keep the address and port of their session,
+   * the socket number may be reused */
+  for(size_t i = 0; i < SECURE_TRANSPORT_DTLS_SLOTS; ++i) {
+    if(socket == s_dtls_sessions[i].tls_socket) {
+      s_dtls_sessions[i].tls_socket = kEipInvalidSocket;
+    }
+  }
+  xSemaphoreGive(s_lock);
+}
+
+void SecureTransportReceiveIo(void) {
+  for(size_t i = 0; i < SECURE_TRANSPORT_DATAGRAMS_PER_CALL; ++i) {
+    struct sockaddr_in from;
+    socklen_t from_length = sizeof(from);
+    const ssize_t length = recvfrom(s_dtls_socket, s_receive_buffer,
+                                    sizeof(s_receive_buffer), MSG_DONTWAIT,
+                                    (struct sockaddr *) &from, &from_length);
+    if(length < 0) {
+      return; /* OPENER_SOCKET_WOULD_BLOCK */
+    }
+    if(0 == length) {
+      continue;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    DtlsSession *const session = DtlsSessionFind(&from);
+    const bool established = NULL != session &&
+                             kSecureSessionReady == session->state;
+    if(established) {
+      DtlsSessionRead(session, s_receive_buffer, (size_t) length, &from);
+    }
+    xSemaphoreGive(s_lock);
+    if(established) {
+      continue;
+    }
+
+    /* a new peer has to start with a ClientHello */
+    if(NULL == session && kDtlsContentTypeHandshake != s_receive_buffer[0]) {
+      SecureTransportCount(&s_dropped_datagrams);
+      continue;
+    }
+    static DtlsDatagram datagram;
+    datagram.from = from;
+    datagram.length = (size_t) length;
+    memcpy(datagram.data, s_receive_buffer, (size_t) length);
+    if(pdTRUE != xQueueSend(s_handshake_queue, &datagram, 0) ) {
+      SecureTransportCount(&s_dropped_datagrams);
+    }
+  }
+}
+
+bool SecureTransportBindIoSession(const int tls_socket,
+                                  const CipUdint address,
+                                  struct sockaddr_in *const peer) {
+  if(NULL == s_lock) {
+    return false;
+  }
+  DtlsSession *bound = NULL;
+  DtlsSession *unbound = NULL;
+  size_t unbound_count = 0;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  for(size_t i = 0; i < SECURE_TRANSPORT_DTLS_SLOTS && NULL == bound; ++i) {
+    DtlsSession *const session = &s_dtls_sessions[i];
+    if(kSecureSessionReady != session->state ||
+       address != session->peer.sin_addr.s_addr) {
+      continue;
+    }
+    if(tls_socket == session->tls_socket) {
+      bound = session;
+    } else if(kEipInvalidSocket == session->tls_socket) {
+      unbound = session;
+      unbound_count++;
+    }
+  }
+  if(NULL == bound && 1 == unbound_count) {
+    unbound->tls_socket = tls_socket;
+    bound = unbound;
+  }
+  if(NULL != bound) {
+    *peer = bound->peer;
+  } else {
+    /* bound by the first record, see SecureTransportClaimIoSession() */
+    *peer = (struct sockaddr_in) { .sin_family = AF_INET,
+                                   .sin_addr.s_addr = address };
+  }
+  xSemaphoreGive(s_lock);
+  return NULL != bound || 0 != unbound_count;
+}
+
+bool SecureTransportClaimIoSession(const int tls_socket,
+                                   const struct sockaddr_in *const peer) {
+  if(NULL == s_lock) {
+    return false;
+  }
+  bool claimed = false;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  DtlsSession *const session = DtlsSessionFind(peer);
+  if(NULL != session && kSecureSessionReady == session->state &&
+     (kEipInvalidSocket == session->tls_socket ||
+      tls_socket == session->tls_socket) ) {
+    session->tls_socket = tls_socket;
+    claimed = true;
+  }
+  xSemaphoreGive(s_lock);
+  return claimed;
+}
+
+EipStatus SecureTransportSendIo(const struct sockaddr_in *const peer,
+                                const CipUsint dscp,
+                                const CipOctet *const header,
+                                const size_t header_length,
+                                const CipOctet *const payload,
+                                const size_t payload_length) {
+  const size_t length = header_length + payload_length;
+  if(NULL == s_lock || length > sizeof(s_send_buffer) ) {
+    SecureTransportCount(&s_send_errors);
+    return kEipStatusError;
+  }
+  EipStatus status = kEipStatusError;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  DtlsSession *const session = DtlsSessionFind(peer);
+  if(NULL != session && kSecureSessionReady == session->state) {
+    if(dscp != s_dtls_dscp) {
+      SetQosOnSocket(s_dtls_socket, dscp);
+      s_dtls_dscp = dscp;
+    }
+    memcpy(s_send_buffer, header, header_length);
+    if(0 != payload_length) {
+      memcpy(s_send_buffer + header_length, payload, payload_length);
+    }
+    session->bio_us = 0;
+    session->send_failed = false;
+    const int64_t start = esp_timer_get_time();
+    const int result = mbedtls_ssl_write(&session->ssl, s_send_buffer,
+                                         length);
+    if( (int) length == result) {
+      SecureTransportRecordTiming(kSecureTransportTimingDtlsEncrypt,
+                                  esp_timer_get_time() - start -
+                                  session->bio_us);
+      status = session->send_failed ? kEipStatusError : kEipStatusOk;
+    } else {
+      SecureTransportCount(&s_send_errors);
+    }
+  }
+  xSemaphoreGive(s_lock);
+  return status;
+}
+
+/* ---------------------------------------------------------------------------
+ * Statistics, see secure_transport.h
+ * ------------------------------------------------------------------------- */
+
+void SecureTransportGetStatistics(SecureTransportStatistics *const statistics)
+{
+  *statistics = (SecureTransportStatistics) { 0 };
+  if(NULL != s_lock) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for(size_t i = 0; i < CONFIG_OPENER_CIP_SECURITY_TLS_SESSIONS; ++i) {
+      statistics->tls_sessions +=
+        (kSecureSessionAdopted == s_tls_sessions[i].state) ? 1U : 0U;
+    }
+    for(size_t i = 0; i < SECURE_TRANSPORT_DTLS_SLOTS; ++i) {
+      statistics->dtls_sessions +=
+        (kSecureSessionReady == s_dtls_sessions[i].state) ? 1U : 0U;
+    }
+    xSemaphoreGive(s_lock);
+  }
+  taskENTER_CRITICAL(&s_statistics_lock);
+  statistics->handshake_failures = s_handshake_failures;
+  statistics->refused_connections = s_refused_connections;
+  statistics->dropped_datagrams = s_dropped_datagrams;
+  statistics->send_errors = s_send_errors;
+  for(size_t i = 0; i < kSecureTransportNumberOfTimings; ++i) {
+    const SecureTransportTimer *const timer = &s_timers[i];
+    statistics->timings[i] = (SecureTransportTiming) {
+      .count = timer->count,
+      .average_us = (0 != timer->count) ?
+                    (uint32_t) (timer->total_us / timer->count) : 0,
+      .maximum_us = timer->maximum_us,
+    };
+  }
+  taskEXIT_CRITICAL(&s_statistics_lock);
+}
+
+const char *SecureTransportGetTimingName(const SecureTransportTimingKind kind)
+{
+  return (kind < kSecureTransportNumberOfTimings) ? kTimingNames[kind] :
+         "unknown";
+}
+
+#endif /* OPENER_CIP_SECURITY */
@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_SECURE_TRANSPORT_H_
+#define OPENER_SECURE_TRANSPORT_H_
+
+/** @file secure_transport.h
+ *  @brief CIP Security transport, TLS and DTLS 1.2 on port 2221
+ *
+ *  Selected with CONFIG_OPENER_CIP_SECURITY. A task of its own accepts TLS
+ *  connections on TCP port 2221 and runs the handshakes of TLS and of DTLS
+ *  on UDP port 2221 with mbedTLS, with an ECDSA P-256 key and self-signed
+ *  certificate that are generated on the first start and kept in the NVS,
+ *  or with a pre-shared key. The handshakes never take the stack lock. An
+ *  established TLS session is handed to the network handler, which serves
+ *  it like an accepted TCP connection; a Forward Open received over it
+ *  opens a point-to-point I/O connection that is produced and consumed over
+ *  the DTLS session of the same originator. That DTLS session is bound to
+ *  the TLS session and to the connection by its address and port.
+ *
+ *  The network handler reads the DTLS socket: records of established
+ *  sessions are decrypted in the UDP phase and go to the connection
+ *  manager, handshake records are queued for the task. A new peer is
+ *  answered with a HelloVerifyRequest cookie by a context kept for that,
+ *  so a spoofed ClientHello sets up no session. Every DTLS session keeps the
+ *  transform of its handshake, the HMAC key schedule included, and all I/O
+ *  connections of the originator share it.
+ *
+ *  Sessions are resumed with session tickets and the session ID cache, so
+ *  an originator reconnecting within CONFIG_OPENER_CIP_SECURITY_SESSION_
+ *  LIFETIME_S skips the ECDHE and ECDSA operations. The statistics time the
+ *  record layer and the handshakes the way security_benchmark.h does
+ *  without a peer; socket time is not counted.
+ *
+ *  The platform interface is declared in networkhandler.h.
+ */
+
+#include "networkhandler.h"
+
+#if OPENER_CIP_SECURITY
+
+#include <stdint.h>
+
+/** @brief Operations timed by the transport */
+typedef enum {
+  kSecureTransportTimingTlsDecrypt = 0, /**< one mbedtls_ssl_read() with data */
+  kSecureTransportTimingTlsEncrypt, /**< one mbedtls_ssl_write() */
+  kSecureTransportTimingDtlsDecrypt, /**< one I/O record */
+  kSecureTransportTimingDtlsEncrypt, /**< one I/O record */
+  kSecureTransportTimingFullHandshake, /**< compute time of a handshake */
+  kSecureTransportTimingResumedHandshake, /**< with a ticket or cached ID */
+  kSecureTransportNumberOfTimings
+} SecureTransportTimingKind;
+
+/** @brief Operation count and times in microseconds */
+typedef struct {
+  uint32_t count;
+  uint32_t average_us;
+  uint32_t maximum_us;
+} SecureTransportTiming;
+
+/** @brief Sessions and counters since boot */
+typedef struct {
+  uint32_t tls_sessions; /**< established, served by the network handler */
+  uint32_t dtls_sessions; /**< established */
+  uint32_t handshake_failures; /**< failed or timed out, TLS and DTLS */
+  uint32_t refused_connections; /**< TLS connections without a free session */
+  uint32_t dropped_datagrams; /**< not for a session or the handshake queue */
+  uint32_t send_errors; /**< records not handed to the IP layer */
+  SecureTransportTiming timings[kSecureTransportNumberOfTimings];
+} SecureTransportStatistics;
+
+/** @brief Read the sessions and counters, safe from any task */
+void SecureTransportGetStatistics(SecureTransportStatistics *const statistics);
+
+/** @brief Name of a timed operation, e.g. "tls_decrypt" */
+const char *SecureTransportGetTimingName(const SecureTransportTimingKind kind);
+
+#endif /* OPENER_CIP_SECURITY */
+
+#endif /* OPENER_SECURE_TRANSPORT_H_ */
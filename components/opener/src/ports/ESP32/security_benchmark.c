@@ -0,0 +1,242 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "security_benchmark.h"
+
+#if CONFIG_OPENER_SECURITY_BENCHMARK
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "trace.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/md.h"
+
+/** Time the packet cases run for */
+#define SECURITY_BENCHMARK_PACKET_DURATION_US 200000
+/** Time the handshake cases run for */
+#define SECURITY_BENCHMARK_HANDSHAKE_DURATION_US 1000000
+/** Packet operations between two reads of the clock */
+#define SECURITY_BENCHMARK_BATCH 32U
+
+/* A Class 1 packet of the KC868-A16 input assembly as a DTLS record
+ * payload carries it: CPF items, sequence count and 10 bytes of data */
+#define SECURITY_BENCHMARK_IO_PACKET_SIZE 32U
+#define SECURITY_BENCHMARK_TAG_SIZE 16U
+
+typedef struct {
+  const char *name;
+  int (*run)(void); /**< one operation, 0 on success */
+  int64_t duration_us;
+  uint32_t batch; /**< operations between two reads of the clock */
+} SecurityBenchmarkCase;
+
+/* Fixtures, built once by SecurityBenchmarkSetUp() */
+static uint8_t s_packet[SECURITY_BENCHMARK_IO_PACKET_SIZE];
+static uint8_t s_output[SECURITY_BENCHMARK_IO_PACKET_SIZE];
+static uint8_t s_tag[SECURITY_BENCHMARK_TAG_SIZE];
+static uint8_t s_mac_key[32];
+static uint8_t s_iv[12];
+static uint8_t s_digest[32];
+static mbedtls_md_context_t s_hmac;
+static mbedtls_gcm_context s_gcm;
+static mbedtls_ecp_group s_group;
+static mbedtls_mpi s_private_key; /* device key, signs the handshake */
+static mbedtls_ecp_point s_peer_public_key; /* originator's ECDHE share */
+static mbedtls_mpi s_ephemeral_key;
+static mbedtls_ecp_point s_ephemeral_public_key;
+static mbedtls_mpi s_shared_secret;
+static mbedtls_mpi s_signature_r;
+static mbedtls_mpi s_signature_s;
+
+static int SecurityBenchmarkRandom(void *context,
+                                   unsigned char *output,
+                                   size_t length) {
+  (void) context;
+  esp_fill_random(output, length);
+  return 0;
+}
+
+/* Integrity only I/O, the key schedule kept in the connection */
+static int RunHmacPrecomputed(void) {
+  int result = mbedtls_md_hmac_reset(&s_hmac);
+  if(0 == result) {
+    result = mbedtls_md_hmac_update(&s_hmac, s_packet, sizeof(s_packet) );
+  }
+  if(0 == result) {
+    result = mbedtls_md_hmac_finish(&s_hmac, s_digest);
+  }
+  return result;
+}
+
+/* Integrity only I/O, keyed again for every packet */
+static int RunHmacKeyed(void) {
+  int result = mbedtls_md_hmac_starts(&s_hmac, s_mac_key, sizeof(s_mac_key) );
+  if(0 == result) {
+    result = mbedtls_md_hmac_update(&s_hmac, s_packet, sizeof(s_packet) );
+  }
+  if(0 == result) {
+    result = mbedtls_md_hmac_finish(&s_hmac, s_digest);
+  }
+  return result;
+}
+
+/* Encrypted I/O */
+static int RunAesGcm(void) {
+  return mbedtls_gcm_crypt_and_tag(&s_gcm, MBEDTLS_GCM_ENCRYPT,
+                                   sizeof(s_packet), s_iv, sizeof(s_iv),
+                                   NULL, 0, s_packet, s_output,
+                                   sizeof(s_tag), s_tag);
+}
+
+/* The device's share of an ECDHE exchange with a new originator */
+static int RunEcdhe(void) {
+  int result = mbedtls_ecdh_gen_public(&s_group, &s_ephemeral_key,
+                                       &s_ephemeral_public_key,
+                                       SecurityBenchmarkRandom, NULL);
+  if(0 == result) {
+    result = mbedtls_ecdh_compute_shared(&s_group, &s_shared_secret,
+                                         &s_peer_public_key, &s_ephemeral_key,
+                                         SecurityBenchmarkRandom, NULL);
+  }
+  return result;
+}
+
+/* The device's CertificateVerify / ServerKeyExchange signature */
+static int RunEcdsaSign(void) {
+  return mbedtls_ecdsa_sign(&s_group, &s_signature_r, &s_signature_s,
+                            &s_private_key, s_digest, sizeof(s_digest),
+                            SecurityBenchmarkRandom, NULL);
+}
+
+static const SecurityBenchmarkCase kSecurityBenchmarkCases[] = {
+  { "HMAC-SHA256 I/O packet (precomputed)", RunHmacPrecomputed,
+    SECURITY_BENCHMARK_PACKET_DURATION_US, SECURITY_BENCHMARK_BATCH },
+  { "HMAC-SHA256 I/O packet (keyed)", RunHmacKeyed,
+    SECURITY_BENCHMARK_PACKET_DURATION_US, SECURITY_BENCHMARK_BATCH },
+  { "AES-128-GCM I/O packet", RunAesGcm,
+    SECURITY_BENCHMARK_PACKET_DURATION_US, SECURITY_BENCHMARK_BATCH },
+  { "ECDHE P-256 key exchange", RunEcdhe,
+    SECURITY_BENCHMARK_HANDSHAKE_DURATION_US, 1U },
+  { "ECDSA P-256 sign", RunEcdsaSign,
+    SECURITY_BENCHMARK_HANDSHAKE_DURATION_US, 1U },
+};
+
+static int SecurityBenchmarkSetUp(void) {
+  esp_fill_random(s_packet, sizeof(s_packet) );
+  esp_fill_random(s_mac_key, sizeof(s_mac_key) );
+  esp_fill_random(s_iv, sizeof(s_iv) );
+
+  mbedtls_md_init(&s_hmac);
+  mbedtls_gcm_init(&s_gcm);
+  mbedtls_ecp_group_init(&s_group);
+  mbedtls_mpi_init(&s_private_key);
+  mbedtls_ecp_point_init(&s_peer_public_key);
+  mbedtls_mpi_init(&s_ephemeral_key);
+  mbedtls_ecp_point_init(&s_ephemeral_public_key);
+  mbedtls_mpi_init(&s_shared_secret);
+  mbedtls_mpi_init(&s_signature_r);
+  mbedtls_mpi_init(&s_signature_s);
+
+  uint8_t aes_key[16];
+  esp_fill_random(aes_key, sizeof(aes_key) );
+  mbedtls_mpi peer_private_key;
+  mbedtls_mpi_init(&peer_private_key);
+
+  int result = mbedtls_md_setup(&s_hmac,
+                                mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                                1);
+  if(0 == result) {
+    result = mbedtls_md_hmac_starts(&s_hmac, s_mac_key, sizeof(s_mac_key) );
+  }
+  if(0 == result) {
+    result = mbedtls_gcm_setkey(&s_gcm, MBEDTLS_CIPHER_ID_AES, aes_key,
+                                8U * sizeof(aes_key) );
+  }
+  if(0 == result) {
+    result = mbedtls_ecp_group_load(&s_group, MBEDTLS_ECP_DP_SECP256R1);
+  }
+  if(0 == result) {
+    result = mbedtls_ecdh_gen_public(&s_group, &peer_private_key,
+                                     &s_peer_public_key,
+                                     SecurityBenchmarkRandom, NULL);
+  }
+  if(0 == result) {
+    result = mbedtls_ecp_gen_privkey(&s_group, &s_private_key,
+                                     SecurityBenchmarkRandom, NULL);
+  }
+  mbedtls_mpi_free(&peer_private_key);
+  return result;
+}
+
+static void SecurityBenchmarkTearDown(void) {
+  mbedtls_md_free(&s_hmac);
+  mbedtls_gcm_free(&s_gcm);
+  mbedtls_ecp_group_free(&s_group);
+  mbedtls_mpi_free(&s_private_key);
+  mbedtls_ecp_point_free(&s_peer_public_key);
+  mbedtls_mpi_free(&s_ephemeral_key);
+  mbedtls_ecp_point_free(&s_ephemeral_public_key);
+  mbedtls_mpi_free(&s_shared_secret);
+  mbedtls_mpi_free(&s_signature_r);
+  mbedtls_mpi_free(&s_signature_s);
+}
+
+static void RunCase(const SecurityBenchmarkCase *const benchmark_case) {
+  /* warm up caches, and fail early */
+  int result = benchmark_case->run();
+  if(0 != result) {
+    printf("%-36s failed: -0x%04x\n", benchmark_case->name,
+           (unsigned int) -result);
+    return;
+  }
+
+  uint64_t operations = 0;
+  const int64_t start = esp_timer_get_time();
+  int64_t elapsed = 0;
+  do {
+    for(uint32_t i = 0; i < benchmark_case->batch && 0 == result; ++i) {
+      result = benchmark_case->run();
+    }
+    operations += benchmark_case->batch;
+    elapsed = esp_timer_get_time() - start;
+  } while(0 == result && elapsed < benchmark_case->duration_us);
+  if(0 != result) {
+    printf("%-36s failed: -0x%04x\n", benchmark_case->name,
+           (unsigned int) -result);
+    return;
+  }
+
+  /* tenths of nanoseconds per operation */
+  const uint64_t tenth_ns = (uint64_t) elapsed * 10000U / operations;
+  printf("%-36s %12" PRIu64 " %8" PRIu64 ".%" PRIu64 "\n",
+         benchmark_case->name,
+         operations,
+         tenth_ns / 10U,
+         tenth_ns % 10U);
+}
+
+void SecurityBenchmarkRunAll(void) {
+  if(0 != SecurityBenchmarkSetUp() ) {
+    OPENER_TRACE_ERR("Security benchmark: setting up the keys failed\n");
+    SecurityBenchmarkTearDown();
+    return;
+  }
+  printf("%-36s %12s %10s\n", "case", "operations", "ns/op");
+  for(size_t i = 0;
+      i < sizeof(kSecurityBenchmarkCases) / sizeof(kSecurityBenchmarkCases[0]);
+      ++i) {
+    RunCase(&kSecurityBenchmarkCases[i]);
+  }
+  SecurityBenchmarkTearDown();
+}
+
+#endif /* CONFIG_OPENER_SECURITY_BENCHMARK */
@@ -0,0 +1,40 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_SECURITY_BENCHMARK_H_
+#define OPENER_SECURITY_BENCHMARK_H_
+
+/** @file security_benchmark.h
+ *  @brief Cost of the CIP Security cryptography on this target
+ *
+ *  Selected with CONFIG_OPENER_SECURITY_BENCHMARK. CIP Security runs
+ *  explicit messaging over TLS on port 2221 and Class 1 I/O over DTLS,
+ *  either integrity only (HMAC-SHA256) or encrypted (AES-GCM), after an
+ *  ECDHE-ECDSA handshake, see secure_transport.h. These cases show what a
+ *  protected I/O packet and a handshake cost with the mbedTLS build of the
+ *  firmware, which uses the ESP32 AES, SHA and MPI accelerators when
+ *  CONFIG_MBEDTLS_HARDWARE_AES, _SHA and _MPI are set, without a peer; the
+ *  transport measures the same on its sessions.
+ *
+ *  The HMAC case with a precomputed context is the per-connection state a
+ *  DTLS record layer keeps, the keyed case is what resetting the key for
+ *  every packet would cost. The output has the format of BenchmarkRunAll()
+ *  and the same caveat: compare runs of one build on one board only.
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_SECURITY_BENCHMARK
+
+/** @brief Run all cases and print one result line per case to stdout
+ *
+ *  Called before the OpENer task is created. The packet cases run for
+ *  0.2 s each, the handshake cases for 1 s each.
+ */
+void SecurityBenchmarkRunAll(void);
+
+#endif /* CONFIG_OPENER_SECURITY_BENCHMARK */
+
+#endif /* OPENER_SECURITY_BENCHMARK_H_ */
@@ -0,0 +1,485 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "self_test.h"
+
+#if CONFIG_OPENER_SELF_TEST
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "trace.h"
+#include "app_scheduler.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/apps/lwiperf.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/priv/tcpip_priv.h"
+
+/* A probe not back by then counts as lost */
+#define SELF_TEST_PROBE_TIMEOUT_MS 1000U
+#define SELF_TEST_MAX_PROBES 10000U
+#define SELF_TEST_MAX_INTERVAL_MS 10000U
+#define SELF_TEST_MAX_TIMEOUT_S 3600U
+/* Fill of the probe after the sequence number */
+#define SELF_TEST_PROBE_PATTERN 0x55U
+
+/* The job only waits, the tcpip thread does the work; below the OpENer
+ * task and beside the web server that starts it */
+#define SELF_TEST_JOB_CORE 1
+#define SELF_TEST_JOB_PRIORITY 2
+#define SELF_TEST_JOB_STACK_SIZE 3072U
+
+static bool s_job_registered = false;
+static SemaphoreHandle_t s_done = NULL; /* given by the report or the echo */
+
+/* Set by SelfTestStart() before it signals the job, read by the job and
+ * the tcpip thread while the test runs */
+static SelfTestRequest s_request;
+static ip_addr_t s_peer;
+
+/* tcpip thread only */
+static void *s_server_session = NULL; /* the iperf server stays */
+static struct udp_pcb *s_udp_pcb = NULL;
+
+/* Job only: I/O connection counters at the start of the test */
+static CipConnectionDiagnostics s_io_start[
+  CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES];
+
+/* Changed by the job and the tcpip thread, read by the web UI, under
+ * s_status_lock */
+static SelfTestStatus s_status;
+static bool s_start_pending = false;
+static bool s_waiting = false; /* for a report or for the echo of a probe */
+static uint32_t s_test_number = 0; /* tells an old client report apart */
+static uint32_t s_probe_sequence = 0;
+static int64_t s_probe_sent_us = 0;
+static uint64_t s_rtt_sum_us = 0;
+static int64_t s_started_us = 0;
+static portMUX_TYPE s_status_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const kSelfTestModeNames[] = {
+  "tcp_server", "tcp_client", "udp_latency",
+};
+
+static const char *const kSelfTestStateNames[] = {
+  "idle", "running", "done", "failed",
+};
+
+static void SelfTestFail(const char *const reason) {
+  OPENER_TRACE_ERR("Self test failed: %s\n", reason);
+  taskENTER_CRITICAL(&s_status_lock);
+  s_status.state = kSelfTestStateFailed;
+  s_status.error = reason;
+  taskEXIT_CRITICAL(&s_status_lock);
+}
+
+/* Called in the tcpip thread when an iperf session ends. The server's
+ * reports, argument NULL, count while a server test waits, a client's
+ * report only for the test that started it. */
+static void SelfTestReport(void *arg,
+                           enum lwiperf_report_type report_type,
+                           const ip_addr_t *local_addr,
+                           u16_t local_port,
+                           const ip_addr_t *remote_addr,
+                           u16_t remote_port,
+                           u32_t bytes_transferred,
+                           u32_t ms_duration,
+                           u32_t bandwidth_kbitpsec) {
+  (void) local_addr;
+  (void) local_port;
+  (void) remote_addr;
+  (void) remote_port;
+  const char *error = NULL;
+  switch(report_type) {
+    case LWIPERF_TCP_DONE_SERVER:
+    case LWIPERF_TCP_DONE_CLIENT:
+      break;
+    case LWIPERF_TCP_ABORTED_REMOTE:
+      error = "aborted by the peer";
+      break;
+    case LWIPERF_TCP_ABORTED_LOCAL_DATAERROR:
+      error = "iperf data error";
+      break;
+    case LWIPERF_TCP_ABORTED_LOCAL_TXERROR:
+      error = "transmit error";
+      break;
+    default:
+      error = "aborted locally";
+      break;
+  }
+  taskENTER_CRITICAL(&s_status_lock);
+  const bool wanted = s_waiting &&
+                      (NULL == arg ?
+                       kSelfTestModeTcpServer == s_status.mode :
+                       (uintptr_t) arg == s_test_number);
+  if(wanted) {
+    s_waiting = false;
+    s_status.bytes = bytes_transferred;
+    s_status.duration_ms = ms_duration;
+    s_status.bandwidth_kbps = bandwidth_kbitpsec;
+    if(NULL != error) {
+      s_status.state = kSelfTestStateFailed;
+      s_status.error = error;
+    }
+  }
+  taskEXIT_CRITICAL(&s_status_lock);
+  if(wanted) {
+    xSemaphoreGive(s_done);
+  }
+}
+
+static err_t SelfTestStartServerInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+  if(NULL == s_server_session) {
+    s_server_session = lwiperf_start_tcp_server_default(SelfTestReport, NULL);
+  }
+  return NULL == s_server_session ? ERR_MEM : ERR_OK;
+}
+
+static err_t SelfTestStartClientInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+  /* Frees itself after its report; lwiperf_abort() would leave the pcb */
+  void *session = lwiperf_start_tcp_client(&s_peer, s_request.port,
+                                           LWIPERF_CLIENT, SelfTestReport,
+                                           (void *) (uintptr_t) s_test_number);
+  return NULL == session ? ERR_CONN : ERR_OK;
+}
+
+static void SelfTestUdpReceive(void *arg,
+                               struct udp_pcb *pcb,
+                               struct pbuf *p,
+                               const ip_addr_t *addr,
+                               u16_t port) {
+  (void) arg;
+  (void) pcb;
+  (void) addr;
+  (void) port;
+  const int64_t now = esp_timer_get_time();
+  uint32_t sequence = 0;
+  bool expected = false;
+  if(p->tot_len == s_request.size &&
+     sizeof(sequence) == pbuf_copy_partial(p, &sequence, sizeof(sequence),
+                                           0) ) {
+    taskENTER_CRITICAL(&s_status_lock);
+    expected = s_waiting && sequence == s_probe_sequence;
+    if(expected) {
+      s_waiting = false;
+      const CipUdint rtt_us = (CipUdint) (now - s_probe_sent_us);
+      if(0 == s_status.received || rtt_us < s_status.rtt_min_us) {
+        s_status.rtt_min_us = rtt_us;
+      }
+      if(rtt_us > s_status.rtt_max_us) {
+        s_status.rtt_max_us = rtt_us;
+      }
+      s_rtt_sum_us += rtt_us;
+      s_status.received++;
+    }
+    taskEXIT_CRITICAL(&s_status_lock);
+  }
+  pbuf_free(p);
+  if(expected) {
+    xSemaphoreGive(s_done);
+  }
+}
+
+static err_t SelfTestUdpOpenInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+  s_udp_pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+  if(NULL == s_udp_pcb) {
+    return ERR_MEM;
+  }
+  const err_t error = udp_bind(s_udp_pcb, IP4_ADDR_ANY, 0);
+  if(ERR_OK != error) {
+    udp_remove(s_udp_pcb);
+    s_udp_pcb = NULL;
+    return error;
+  }
+  udp_recv(s_udp_pcb, SelfTestUdpReceive, NULL);
+  return ERR_OK;
+}
+
+static err_t SelfTestUdpCloseInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+  if(NULL != s_udp_pcb) {
+    udp_remove(s_udp_pcb);
+    s_udp_pcb = NULL;
+  }
+  return ERR_OK;
+}
+
+/* The sequence number was set by the job, the clock starts here */
+static err_t SelfTestUdpSendInTcpip(struct tcpip_api_call_data *call) {
+  (void) call;
+  struct pbuf *probe = pbuf_alloc(PBUF_TRANSPORT, (u16_t) s_request.size,
+                                  PBUF_RAM);
+  if(NULL == probe) {
+    return ERR_MEM;
+  }
+  memset(probe->payload, SELF_TEST_PROBE_PATTERN, s_request.size);
+  taskENTER_CRITICAL(&s_status_lock);
+  memcpy(probe->payload, &s_probe_sequence, sizeof(s_probe_sequence) );
+  s_probe_sent_us = esp_timer_get_time();
+  s_waiting = true;
+  taskEXIT_CRITICAL(&s_status_lock);
+  const err_t error = udp_sendto(s_udp_pcb, probe, &s_peer, s_request.port);
+  pbuf_free(probe);
+  return error;
+}
+
+/* True if the result or echo arrived within timeout_ms */
+static bool SelfTestWait(const uint32_t timeout_ms) {
+  if(pdTRUE == xSemaphoreTake(s_done, pdMS_TO_TICKS(timeout_ms) ) ) {
+    return true;
+  }
+  taskENTER_CRITICAL(&s_status_lock);
+  const bool delivered = !s_waiting; /* just behind the timeout */
+  s_waiting = false;
+  taskEXIT_CRITICAL(&s_status_lock);
+  return delivered;
+}
+
+static void SelfTestRunTcp(void) {
+  taskENTER_CRITICAL(&s_status_lock);
+  s_waiting = true;
+  taskEXIT_CRITICAL(&s_status_lock);
+  struct tcpip_api_call_data call;
+  const err_t error = tcpip_api_call(
+    kSelfTestModeTcpServer == s_request.mode ?
+    SelfTestStartServerInTcpip : SelfTestStartClientInTcpip, &call);
+  if(ERR_OK != error) {
+    taskENTER_CRITICAL(&s_status_lock);
+    s_waiting = false;
+    taskEXIT_CRITICAL(&s_status_lock);
+    SelfTestFail("iperf session not started");
+    return;
+  }
+  if(!SelfTestWait(s_request.timeout_s * 1000U) ) {
+    SelfTestFail("no result before the timeout");
+  }
+}
+
+static void SelfTestRunUdp(void) {
+  struct tcpip_api_call_data call;
+  if(ERR_OK != tcpip_api_call(SelfTestUdpOpenInTcpip, &call) ) {
+    SelfTestFail("no UDP socket");
+    return;
+  }
+  for(uint32_t sequence = 0; sequence < s_request.count; ++sequence) {
+    taskENTER_CRITICAL(&s_status_lock);
+    s_probe_sequence = sequence;
+    taskEXIT_CRITICAL(&s_status_lock);
+    if(ERR_OK != tcpip_api_call(SelfTestUdpSendInTcpip, &call) ) {
+      SelfTestFail("probe not sent");
+      break;
+    }
+    taskENTER_CRITICAL(&s_status_lock);
+    s_status.sent++;
+    taskEXIT_CRITICAL(&s_status_lock);
+    (void) SelfTestWait(SELF_TEST_PROBE_TIMEOUT_MS);
+    if(0 != s_request.interval_ms) {
+      vTaskDelay(pdMS_TO_TICKS(s_request.interval_ms) );
+    }
+  }
+  tcpip_api_call(SelfTestUdpCloseInTcpip, &call);
+  taskENTER_CRITICAL(&s_status_lock);
+  const bool none_back = 0 == s_status.received &&
+                         kSelfTestStateRunning == s_status.state;
+  taskEXIT_CRITICAL(&s_status_lock);
+  if(none_back) {
+    SelfTestFail("no probe came back");
+  }
+}
+
+/* Takes the counters at the start, or adds what changed since then on
+ * the connections that stayed open */
+static void SelfTestCountIo(const bool start) {
+  SelfTestStatus added;
+  memset(&added, 0, sizeof(added) );
+  for(size_t i = 0; i < CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES; ++i) {
+    CipConnectionDiagnostics current;
+    if(!CipConnectionDiagnosticsGet(i, &current) ) {
+      current.connection_id = 0;
+    }
+    const CipConnectionDiagnostics *const first = &s_io_start[i];
+    if(start) {
+      s_io_start[i] = current;
+      continue;
+    }
+    if(0 == current.connection_id ||
+       current.connection_id != first->connection_id) {
+      continue;
+    }
+    added.io_connections++;
+    added.produced_packets += current.produced.packets -
+                              first->produced.packets;
+    added.produced_late += current.produced.late_packets -
+                           first->produced.late_packets;
+    added.produced_missed += current.produced.missed_packets -
+                             first->produced.missed_packets;
+    added.consumed_late += current.consumed.late_packets -
+                           first->consumed.late_packets;
+    added.consumed_missed += current.consumed.missed_packets -
+                             first->consumed.missed_packets;
+    for(size_t bucket = 0; bucket < CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS;
+        ++bucket) {
+      added.produced_histogram[bucket] += current.produced.histogram[bucket] -
+                                          first->produced.histogram[bucket];
+    }
+  }
+  if(start) {
+    return;
+  }
+  taskENTER_CRITICAL(&s_status_lock);
+  s_status.io_connections = added.io_connections;
+  s_status.produced_packets = added.produced_packets;
+  s_status.produced_late = added.produced_late;
+  s_status.produced_missed = added.produced_missed;
+  s_status.consumed_late = added.consumed_late;
+  s_status.consumed_missed = added.consumed_missed;
+  memcpy(s_status.produced_histogram, added.produced_histogram,
+         sizeof(s_status.produced_histogram) );
+  taskEXIT_CRITICAL(&s_status_lock);
+}
+
+static void SelfTestJob(void *argument, uint32_t events) {
+  (void) argument;
+  (void) events;
+  taskENTER_CRITICAL(&s_status_lock);
+  const bool start = s_start_pending;
+  s_start_pending = false;
+  taskEXIT_CRITICAL(&s_status_lock);
+  if(!start) {
+    return; /* a request for another job */
+  }
+  (void) xSemaphoreTake(s_done, 0); /* an echo behind the last timeout */
+  SelfTestCountIo(true);
+  if(kSelfTestModeUdpLatency == s_request.mode) {
+    SelfTestRunUdp();
+  } else {
+    SelfTestRunTcp();
+  }
+  SelfTestCountIo(false);
+
+  const int64_t now = esp_timer_get_time();
+  taskENTER_CRITICAL(&s_status_lock);
+  s_status.elapsed_ms = (CipUdint) ( (now - s_started_us) / 1000);
+  if(kSelfTestStateRunning == s_status.state) {
+    s_status.state = kSelfTestStateDone;
+  }
+  taskEXIT_CRITICAL(&s_status_lock);
+  OPENER_TRACE_INFO("Self test %s: %s\n",
+                    kSelfTestModeNames[s_request.mode],
+                    kSelfTestStateNames[s_status.state]);
+}
+
+static bool SelfTestStartJob(void) {
+  if(s_job_registered) {
+    return true;
+  }
+  if(NULL == s_done) {
+    s_done = xSemaphoreCreateBinary();
+  }
+  if(NULL == s_done) {
+    return false;
+  }
+  const AppSchedulerJobConfig config = {
+    .name = "self_test",
+    .function = SelfTestJob,
+    .argument = NULL,
+    .period_ms = 0,
+    .events = kAppSchedulerEventRequest,
+    .core = SELF_TEST_JOB_CORE,
+    .priority = SELF_TEST_JOB_PRIORITY,
+    .stack_size = SELF_TEST_JOB_STACK_SIZE,
+  };
+  s_job_registered = kEipStatusOk == AppSchedulerRegister(&config);
+  return s_job_registered;
+}
+
+static const char *SelfTestCheckRequest(const SelfTestRequest *const request) {
+  if(request->mode > kSelfTestModeUdpLatency) {
+    return "unknown mode";
+  }
+  if(kSelfTestModeTcpServer != request->mode &&
+     (0 == request->address || 0 == request->port) ) {
+    return "peer address and port needed";
+  }
+  if(kSelfTestModeUdpLatency == request->mode) {
+    if(request->size < SELF_TEST_MIN_PROBE_SIZE ||
+       request->size > SELF_TEST_MAX_PROBE_SIZE) {
+      return "probe size out of range";
+    }
+    if(0 == request->count || request->count > SELF_TEST_MAX_PROBES) {
+      return "probe count out of range";
+    }
+    if(request->interval_ms > SELF_TEST_MAX_INTERVAL_MS) {
+      return "probe interval out of range";
+    }
+  } else if(0 == request->timeout_s ||
+            request->timeout_s > SELF_TEST_MAX_TIMEOUT_S) {
+    return "timeout out of range";
+  }
+  return NULL;
+}
+
+EipStatus SelfTestStart(const SelfTestRequest *const request) {
+  if(kSelfTestStateRunning == s_status.state) {
+    return kEipStatusError;
+  }
+  const char *const error = SelfTestCheckRequest(request);
+  if(NULL != error) {
+    SelfTestFail(error);
+    return kEipStatusError;
+  }
+  if(!SelfTestStartJob() ) {
+    SelfTestFail("no application scheduler job");
+    return kEipStatusError;
+  }
+
+  s_request = *request;
+  ip_addr_set_ip4_u32_val(s_peer, request->address);
+  taskENTER_CRITICAL(&s_status_lock);
+  memset(&s_status, 0, sizeof(s_status) );
+  s_status.state = kSelfTestStateRunning;
+  s_status.mode = request->mode;
+  s_test_number++;
+  s_rtt_sum_us = 0;
+  s_started_us = esp_timer_get_time();
+  s_start_pending = true;
+  taskEXIT_CRITICAL(&s_status_lock);
+  AppSchedulerSignal(kAppSchedulerEventRequest);
+  return kEipStatusOk;
+}
+
+void SelfTestGetStatus(SelfTestStatus *const status) {
+  const int64_t now = esp_timer_get_time();
+  taskENTER_CRITICAL(&s_status_lock);
+  *status = s_status;
+  const uint64_t rtt_sum_us = s_rtt_sum_us;
+  const int64_t started_us = s_started_us;
+  taskEXIT_CRITICAL(&s_status_lock);
+  if(kSelfTestStateRunning == status->state) {
+    status->elapsed_ms = (CipUdint) ( (now - started_us) / 1000);
+  }
+  if(0 != status->received) {
+    status->rtt_avg_us = (CipUdint) (rtt_sum_us / status->received);
+  }
+}
+
+const char *SelfTestGetModeName(const SelfTestMode mode) {
+  return mode <= kSelfTestModeUdpLatency ? kSelfTestModeNames[mode] : "unknown";
+}
+
+const char *SelfTestGetStateName(const SelfTestState state) {
+  return state <= kSelfTestStateFailed ? kSelfTestStateNames[state] : "unknown";
+}
+
+#endif /* CONFIG_OPENER_SELF_TEST */
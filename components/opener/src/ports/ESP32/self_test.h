@@ -0,0 +1,116 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_SELF_TEST_H_
+#define OPENER_SELF_TEST_H_
+
+/** @file self_test.h
+ *  @brief Commissioning self test of the network path, beside the I/O
+ *
+ *  Selected with CONFIG_OPENER_SELF_TEST. An installer runs one test at a
+ *  time from the web API while the I/O connections keep running:
+ *  - TCP server: the lwIP iperf server on port 5001 is started on first
+ *    use and stays, the test waits for the next run of an iperf 2 client
+ *    (iperf -c <device>);
+ *  - TCP client: lwiperf sends to an iperf 2 server for ten seconds, the
+ *    fixed duration of the vendored lwiperf client;
+ *  - UDP latency: ping-pong probes of a configurable size to a UDP echo
+ *    service (RFC 862, port 7), each sent when the previous one returned
+ *    or was lost, with the minimum, average and maximum round trip.
+ *
+ *  The vendored lwiperf has no UDP mode; the UDP test measures latency
+ *  instead of throughput.
+ *
+ *  While a test runs the Connection Diagnostics counters of every I/O
+ *  connection open throughout are compared with their start: produced
+ *  packets, late and missed packets both ways, and the histogram of the
+ *  produced intervals, so the installer sees what the load did to the
+ *  jitter against the latency budget.
+ *
+ *  The test runs in an application scheduler job, registered on first use.
+ */
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_SELF_TEST
+
+#include "cipconnectiondiagnostics.h"
+
+/** @brief Largest UDP probe, one Ethernet frame */
+#define SELF_TEST_MAX_PROBE_SIZE 1472U
+/** @brief Smallest UDP probe, the sequence number */
+#define SELF_TEST_MIN_PROBE_SIZE 4U
+
+typedef enum {
+  kSelfTestModeTcpServer = 0,
+  kSelfTestModeTcpClient,
+  kSelfTestModeUdpLatency,
+} SelfTestMode;
+
+typedef enum {
+  kSelfTestStateIdle = 0,
+  kSelfTestStateRunning,
+  kSelfTestStateDone,
+  kSelfTestStateFailed,
+} SelfTestState;
+
+/** @brief Parameters of a test */
+typedef struct {
+  SelfTestMode mode;
+  CipUdint address; /**< peer IPv4 address, network byte order; unused by the server */
+  CipUint port; /**< peer port; the server listens on 5001 */
+  CipUdint timeout_s; /**< TCP: longest wait for the result */
+  CipUdint size; /**< UDP: probe size in bytes */
+  CipUdint count; /**< UDP: probes */
+  CipUdint interval_ms; /**< UDP: pause between two probes */
+} SelfTestRequest;
+
+/** @brief Result of the current or last test */
+typedef struct {
+  SelfTestState state;
+  SelfTestMode mode;
+  const char *error; /**< reason of kSelfTestStateFailed, else NULL */
+  CipUdint elapsed_ms;
+  /* TCP */
+  CipUdint bytes;
+  CipUdint duration_ms;
+  CipUdint bandwidth_kbps;
+  /* UDP */
+  CipUdint sent;
+  CipUdint received;
+  CipUdint rtt_min_us;
+  CipUdint rtt_avg_us;
+  CipUdint rtt_max_us;
+  /* I/O connections open throughout the test */
+  CipUdint io_connections;
+  CipUdint produced_packets;
+  CipUdint produced_late;
+  CipUdint produced_missed;
+  CipUdint consumed_late;
+  CipUdint consumed_missed;
+  CipUdint produced_histogram[CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS];
+} SelfTestStatus;
+
+/** @brief Start a test
+ *
+ *  Called by the web server task, returns at once.
+ *
+ *  @return kEipStatusOk, kEipStatusError if a test runs already, a
+ *          parameter is out of range or the job could not start;
+ *          SelfTestGetStatus() tells why unless a test runs
+ */
+EipStatus SelfTestStart(const SelfTestRequest *const request);
+
+/** @brief Read the progress and the result, safe from any task */
+void SelfTestGetStatus(SelfTestStatus *const status);
+
+/** @brief Names used in the web API */
+const char *SelfTestGetModeName(const SelfTestMode mode);
+const char *SelfTestGetStateName(const SelfTestState state);
+
+#endif /* CONFIG_OPENER_SELF_TEST */
+
+#endif /* OPENER_SELF_TEST_H_ */
@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "sntp_clock.h"
+
+#if CONFIG_OPENER_SNTP_CLOCK
+
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "seqlock.h"
+#include "trace.h"
+#include "esp_netif_sntp.h"
+#include "esp_sntp.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define SNTP_CLOCK_POLL_INTERVAL_US \
+  ( (int64_t) CONFIG_OPENER_SNTP_POLL_INTERVAL_S * 1000000LL)
+#define SNTP_CLOCK_STEP_THRESHOLD_US \
+  ( (int64_t) CONFIG_OPENER_SNTP_STEP_THRESHOLD_MS * 1000LL)
+/* Slewing at up to 500 ppm keeps the clock monotonic */
+#define SNTP_CLOCK_MAX_SLEW_PPB 500000LL
+#define SNTP_CLOCK_MAX_DRIFT_PPB 500000LL
+/* A quarter of the rate error of an interval corrects the drift */
+#define SNTP_CLOCK_FLL_DIVISOR 4
+#define SNTP_CLOCK_HOLDOVER_POLLS 4
+
+/* UTC of local time local_reference_us, advancing at 1 + drift_ppb; the
+ * slew adds slew_ppb until slew_end_us */
+typedef struct {
+  int64_t local_reference_us;
+  int64_t utc_reference_us;
+  int64_t slew_end_us;
+  int32_t drift_ppb;
+  int32_t slew_ppb;
+} SntpClockModel;
+
+typedef struct {
+  SeqLock lock;
+  SntpClockModel model;
+} SntpClockModelSlot;
+
+static const char *const kSntpClockStateNames[] = {
+  "off", "unsynchronized", "synchronized", "holdover",
+};
+
+/* Written by the tcpip thread only: the idle slot, then s_active_slot */
+static SntpClockModelSlot s_slots[2];
+static uint32_t s_active_slot = 0;
+
+/* Changed by the tcpip thread, read by the web UI, under s_sntp_lock */
+static SntpClockStatus s_status;
+static int64_t s_last_sync_us = 0;
+static portMUX_TYPE s_sntp_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool s_started = false;
+
+static int64_t SntpClockModelTime(const SntpClockModel *const model,
+                                  const int64_t local_us) {
+  const int64_t elapsed_us = local_us - model->local_reference_us;
+  int64_t slewed_us = model->slew_end_us - model->local_reference_us;
+  if(elapsed_us < slewed_us) {
+    slewed_us = elapsed_us;
+  }
+  if(slewed_us < 0) {
+    slewed_us = 0;
+  }
+  return model->utc_reference_us + elapsed_us +
+         elapsed_us * model->drift_ppb / 1000000000LL +
+         slewed_us * model->slew_ppb / 1000000000LL;
+}
+
+static SntpClockModel SntpClockGetModel(void) {
+  SntpClockModel model;
+  uint32_t slot;
+  /* Only fails if the writer replaced both slots during the copy */
+  do {
+    slot = __atomic_load_n(&s_active_slot, __ATOMIC_ACQUIRE);
+  } while(!SeqLockRead(&s_slots[slot].lock, &model, &s_slots[slot].model,
+                       sizeof(model), NULL) );
+  return model;
+}
+
+static void SntpClockSetModel(const SntpClockModel *const model) {
+  const uint32_t slot = 1U - __atomic_load_n(&s_active_slot,
+                                             __ATOMIC_RELAXED);
+  SeqLockWrite(&s_slots[slot].lock, &s_slots[slot].model, model,
+               sizeof(*model) );
+  __atomic_store_n(&s_active_slot, slot, __ATOMIC_RELEASE);
+}
+
+int64_t SntpClockFromLocalTime(const int64_t local_us) {
+  const SntpClockModel model = SntpClockGetModel();
+  return SntpClockModelTime(&model, local_us);
+}
+
+int64_t SntpClockNowUs(void) {
+  return SntpClockFromLocalTime(esp_timer_get_time() );
+}
+
+bool SntpClockIsSynchronized(void) {
+  return 0 != __atomic_load_n(&s_status.steps, __ATOMIC_RELAXED);
+}
+
+static int64_t SntpClockClamp(const int64_t value, const int64_t limit) {
+  return value > limit ? limit : (value < -limit ? -limit : value);
+}
+
+/* Runs in the tcpip thread right after the SNTP client took a response */
+static void SntpClockSynchronized(struct timeval *tv) {
+  const int64_t local_us = esp_timer_get_time();
+  const int64_t server_us = (int64_t) tv->tv_sec * 1000000LL + tv->tv_usec;
+  SntpClockModel model = SntpClockGetModel();
+  const int64_t clock_us = SntpClockModelTime(&model, local_us);
+  const int64_t offset_us = server_us - clock_us;
+
+  taskENTER_CRITICAL(&s_sntp_lock);
+  const bool first = 0 == s_status.steps;
+  const int64_t interval_us = local_us - s_last_sync_us;
+  taskEXIT_CRITICAL(&s_sntp_lock);
+
+  const bool step = first || llabs(offset_us) > SNTP_CLOCK_STEP_THRESHOLD_US;
+  if(step) {
+    model.utc_reference_us = server_us;
+    model.slew_ppb = 0;
+    model.slew_end_us = local_us;
+  } else {
+    /* What the previous slew did not correct yet is no rate error */
+    int64_t pending_us = 0;
+    if(model.slew_end_us > local_us) {
+      pending_us = (model.slew_end_us - local_us) * model.slew_ppb /
+                   1000000000LL;
+    }
+    if(0 < interval_us) {
+      const int64_t drift_ppb = model.drift_ppb +
+                                (offset_us - pending_us) * 1000000000LL /
+                                interval_us / SNTP_CLOCK_FLL_DIVISOR;
+      model.drift_ppb = (int32_t) SntpClockClamp(drift_ppb,
+                                                 SNTP_CLOCK_MAX_DRIFT_PPB);
+    }
+    int64_t slew_us = SNTP_CLOCK_POLL_INTERVAL_US;
+    int64_t slew_ppb = offset_us * 1000000000LL / slew_us;
+    if(llabs(slew_ppb) > SNTP_CLOCK_MAX_SLEW_PPB) {
+      slew_ppb = SntpClockClamp(slew_ppb, SNTP_CLOCK_MAX_SLEW_PPB);
+      slew_us = offset_us * 1000000000LL / slew_ppb;
+    }
+    model.utc_reference_us = clock_us;
+    model.slew_ppb = (int32_t) slew_ppb;
+    model.slew_end_us = local_us + slew_us;
+  }
+  model.local_reference_us = local_us;
+  SntpClockSetModel(&model);
+
+  taskENTER_CRITICAL(&s_sntp_lock);
+  s_status.syncs++;
+  if(step) {
+    s_status.steps++;
+  } else if( (CipUdint) llabs(offset_us) > s_status.max_offset_us) {
+    s_status.max_offset_us = (CipUdint) llabs(offset_us);
+  }
+  s_status.last_offset_us = (CipDint) SntpClockClamp(offset_us, INT32_MAX);
+  s_status.drift_ppb = model.drift_ppb;
+  s_last_sync_us = local_us;
+  taskEXIT_CRITICAL(&s_sntp_lock);
+
+  if(step) {
+    OPENER_TRACE_INFO("SNTP: clock set, offset %lld us\n",
+                      (long long) offset_us);
+  }
+}
+
+void SntpClockStart(void) {
+  if(s_started) {
+    return;
+  }
+  esp_sntp_config_t config =
+    ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_OPENER_SNTP_SERVER);
+  config.wait_for_sync = false;
+  config.sync_cb = SntpClockSynchronized;
+  sntp_set_sync_interval(CONFIG_OPENER_SNTP_POLL_INTERVAL_S * 1000U);
+  const esp_err_t result = esp_netif_sntp_init(&config);
+  if(ESP_OK != result) {
+    OPENER_TRACE_ERR("SNTP: client not started, error %d\n", (int) result);
+    return;
+  }
+  s_started = true;
+  taskENTER_CRITICAL(&s_sntp_lock);
+  s_status.state = kSntpClockStateUnsynchronized;
+  taskEXIT_CRITICAL(&s_sntp_lock);
+  OPENER_TRACE_INFO("SNTP: polling %s every %u s\n",
+                    CONFIG_OPENER_SNTP_SERVER,
+                    (unsigned) CONFIG_OPENER_SNTP_POLL_INTERVAL_S);
+}
+
+void SntpClockGetStatus(SntpClockStatus *const status) {
+  const int64_t now_us = esp_timer_get_time();
+  taskENTER_CRITICAL(&s_sntp_lock);
+  *status = s_status;
+  const int64_t last_sync_us = s_last_sync_us;
+  taskEXIT_CRITICAL(&s_sntp_lock);
+  if(0 == status->syncs) {
+    return;
+  }
+  const int64_t age_us = now_us - last_sync_us;
+  status->last_sync_age_ms = (CipUdint) (age_us / 1000);
+  status->state = age_us > SNTP_CLOCK_HOLDOVER_POLLS *
+                  SNTP_CLOCK_POLL_INTERVAL_US ?
+                  kSntpClockStateHoldover : kSntpClockStateSynchronized;
+}
+
+const char *SntpClockGetStateName(const SntpClockState state) {
+  return state <= kSntpClockStateHoldover ?
+         kSntpClockStateNames[state] : "unknown";
+}
+
+#endif /* CONFIG_OPENER_SNTP_CLOCK */
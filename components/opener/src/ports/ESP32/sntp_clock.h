@@ -0,0 +1,92 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_SNTP_CLOCK_H_
+#define OPENER_SNTP_CLOCK_H_
+
+/** @file sntp_clock.h
+ *  @brief SNTP disciplined wall clock for time stamps
+ *
+ *  Selected with CONFIG_OPENER_SNTP_CLOCK. The clock runs on esp_timer like
+ *  the PTP clock: SntpClockFromLocalTime() converts any esp_timer time to
+ *  UTC, so an event is stamped when it happens and converted later. The
+ *  ESP-IDF SNTP client polls CONFIG_OPENER_SNTP_SERVER every
+ *  CONFIG_OPENER_SNTP_POLL_INTERVAL_S seconds in the tcpip thread, with the
+ *  round-trip delay compensated.
+ *
+ *  The first response sets the clock, and so does an offset above
+ *  CONFIG_OPENER_SNTP_STEP_THRESHOLD_MS. Smaller offsets are slewed out over
+ *  the next poll interval at no more than 500 ppm, so the time never runs
+ *  backwards, and a quarter of the rate error they show corrects the drift
+ *  of the crystal.
+ *
+ *  The model is double buffered: the tcpip thread writes the idle copy and
+ *  then switches to it, so a reader never waits and never retries behind a
+ *  writer it preempted. A conversion is a few multiplications and can be
+ *  done from the I/O paths.
+ *
+ *  The system time of newlib is set by the SNTP client as well, but steps
+ *  with every response; it is not used here.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_SNTP_CLOCK
+
+typedef enum {
+  kSntpClockStateOff = 0,
+  kSntpClockStateUnsynchronized, /**< no response yet */
+  kSntpClockStateSynchronized,
+  /** no response for four poll intervals, the clock runs on the last
+   *  drift */
+  kSntpClockStateHoldover,
+} SntpClockState;
+
+/** @brief Synchronization quality */
+typedef struct {
+  SntpClockState state;
+  CipUdint syncs; /**< responses taken */
+  CipUdint steps; /**< responses that set the clock */
+  CipDint last_offset_us; /**< server minus clock at the last response */
+  CipUdint max_offset_us; /**< largest slewed offset since the first sync */
+  CipUdint last_sync_age_ms; /**< 0 before the first response */
+  CipDint drift_ppb; /**< rate correction of the crystal */
+} SntpClockStatus;
+
+/** @brief Start the SNTP client, after the stack came up
+ *
+ *  Safe to call more than once, only the first call has an effect.
+ */
+void SntpClockStart(void);
+
+/** @brief Convert an esp_timer time to UTC
+ *
+ *  May be called from any task. Before the first response the result is the
+ *  time since boot, see SntpClockIsSynchronized().
+ *
+ *  @param local_us time returned by esp_timer_get_time()
+ *  @return microseconds since 1970-01-01 00:00:00 UTC
+ */
+int64_t SntpClockFromLocalTime(const int64_t local_us);
+
+/** @brief Current UTC in microseconds, SntpClockFromLocalTime() of now */
+int64_t SntpClockNowUs(void);
+
+/** @brief True once a response set the clock, also during holdover */
+bool SntpClockIsSynchronized(void);
+
+/** @brief Read the synchronization quality, safe from any task */
+void SntpClockGetStatus(SntpClockStatus *const status);
+
+/** @brief Name of a state, as used in the web API */
+const char *SntpClockGetStateName(const SntpClockState state);
+
+#endif /* CONFIG_OPENER_SNTP_CLOCK */
+
+#endif /* OPENER_SNTP_CLOCK_H_ */
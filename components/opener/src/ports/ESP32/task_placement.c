@@ -0,0 +1,343 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "task_placement.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "app_scheduler.h"
+#include "loop_profile.h"
+#include "trace.h"
+#include "esp_err.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+#define TASK_PLACEMENT_NVS_NAMESPACE "placement"
+#define TASK_PLACEMENT_NVS_PROFILE_KEY "profile"
+
+#define TASK_PLACEMENT_MAX_DURATION_S 3600U
+
+/* The job only sleeps while it measures; below everything it measures */
+#define TASK_PLACEMENT_JOB_CORE 1
+#define TASK_PLACEMENT_JOB_PRIORITY 1
+#define TASK_PLACEMENT_JOB_STACK_SIZE 3072U
+
+#if CONFIG_FREERTOS_UNICORE
+#define TASK_PLACEMENT_OTHER_CORE 0
+#define TASK_PLACEMENT_IO_PRIORITY 7
+#else
+#define TASK_PLACEMENT_OTHER_CORE 1
+#define TASK_PLACEMENT_IO_PRIORITY CONFIG_OPENER_IO_TASK_PRIORITY
+#endif
+
+#if CONFIG_OPENER_TASK_PLACEMENT_TCPIP
+#define TASK_PLACEMENT_DEFAULT_PROFILE kTaskPlacementProfileTcpip
+#elif CONFIG_OPENER_TASK_PLACEMENT_IO_CORE1
+#define TASK_PLACEMENT_DEFAULT_PROFILE kTaskPlacementProfileIoCore1
+#elif CONFIG_OPENER_TASK_PLACEMENT_SPLIT
+#define TASK_PLACEMENT_DEFAULT_PROFILE kTaskPlacementProfileSplit
+#else
+#define TASK_PLACEMENT_DEFAULT_PROFILE kTaskPlacementProfileShared
+#endif
+
+static const TaskPlacement kTaskPlacementProfiles[
+  kTaskPlacementNumberOfProfiles][kTaskPlacementNumberOfTasks] = {
+  [kTaskPlacementProfileShared] = {
+    [kTaskPlacementTaskOpener] = { 0, 5 },
+    [kTaskPlacementTaskIo] = { 0, 6 },
+    [kTaskPlacementTaskHttpd] = { TASK_PLACEMENT_OTHER_CORE, 5 },
+  },
+  [kTaskPlacementProfileTcpip] = {
+    [kTaskPlacementTaskOpener] = { 0, CONFIG_LWIP_TCPIP_TASK_PRIO - 2 },
+    [kTaskPlacementTaskIo] = { 0, CONFIG_LWIP_TCPIP_TASK_PRIO - 1 },
+    [kTaskPlacementTaskHttpd] = { TASK_PLACEMENT_OTHER_CORE, 5 },
+  },
+  [kTaskPlacementProfileIoCore1] = {
+    [kTaskPlacementTaskOpener] = { 0, 5 },
+    [kTaskPlacementTaskIo] = { TASK_PLACEMENT_OTHER_CORE,
+                               TASK_PLACEMENT_IO_PRIORITY },
+    [kTaskPlacementTaskHttpd] = { TASK_PLACEMENT_OTHER_CORE, 5 },
+  },
+  [kTaskPlacementProfileSplit] = {
+    [kTaskPlacementTaskOpener] = { 0, 5 },
+    [kTaskPlacementTaskIo] = { TASK_PLACEMENT_OTHER_CORE,
+                               TASK_PLACEMENT_IO_PRIORITY },
+    [kTaskPlacementTaskHttpd] = { 0, 4 },
+  },
+};
+
+static const char *const kTaskPlacementProfileNames[] = {
+  "shared", "tcpip", "io_core1", "split",
+};
+
+static const char *const kTaskPlacementTaskNames[] = {
+  "opener", "io", "httpd",
+};
+
+/* NVS keys of the measurements, one per profile */
+static const char *const kTaskPlacementMeasurementKeys[] = {
+  "m_shared", "m_tcpip", "m_io_core1", "m_split",
+};
+
+/* Set once by TaskPlacementInitialize() before the tasks are created */
+static TaskPlacementProfile s_profile = TASK_PLACEMENT_DEFAULT_PROFILE;
+
+static bool s_job_registered = false;
+static CipUdint s_duration_s = 0; /* set before the job is signalled */
+
+/* Job only: I/O connection counters at the start of the measurement */
+static CipConnectionDiagnostics s_io_start[
+  CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES];
+
+/* Written by the web UI and the job, under s_placement_lock */
+static TaskPlacementProfile s_stored_profile = TASK_PLACEMENT_DEFAULT_PROFILE;
+static TaskPlacementMeasurement s_measurements[kTaskPlacementNumberOfProfiles];
+static portMUX_TYPE s_placement_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void TaskPlacementInitialize(void) {
+  nvs_handle_t handle;
+  if(ESP_OK != nvs_open(TASK_PLACEMENT_NVS_NAMESPACE, NVS_READONLY, &handle) ) {
+    OPENER_TRACE_INFO("Task placement: %s\n",
+                      kTaskPlacementProfileNames[s_profile]);
+    return; /* nothing stored yet */
+  }
+  uint8_t profile = 0;
+  if(ESP_OK == nvs_get_u8(handle, TASK_PLACEMENT_NVS_PROFILE_KEY, &profile) &&
+     profile < kTaskPlacementNumberOfProfiles) {
+    s_profile = (TaskPlacementProfile) profile;
+    s_stored_profile = s_profile;
+  }
+  for(size_t i = 0; i < kTaskPlacementNumberOfProfiles; ++i) {
+    TaskPlacementMeasurement measurement;
+    size_t length = sizeof(measurement);
+    /* A blob of another firmware's layout is dropped */
+    if(ESP_OK == nvs_get_blob(handle, kTaskPlacementMeasurementKeys[i],
+                              &measurement, &length) &&
+       sizeof(measurement) == length &&
+       kTaskPlacementMeasurementDone == measurement.state) {
+      s_measurements[i] = measurement;
+    }
+  }
+  nvs_close(handle);
+  OPENER_TRACE_INFO("Task placement: %s\n",
+                    kTaskPlacementProfileNames[s_profile]);
+}
+
+TaskPlacementProfile TaskPlacementGetProfile(void) {
+  return s_profile;
+}
+
+TaskPlacementProfile TaskPlacementGetStoredProfile(void) {
+  taskENTER_CRITICAL(&s_placement_lock);
+  const TaskPlacementProfile profile = s_stored_profile;
+  taskEXIT_CRITICAL(&s_placement_lock);
+  return profile;
+}
+
+void TaskPlacementGetForProfile(const TaskPlacementProfile profile,
+                                const TaskPlacementTask task,
+                                TaskPlacement *const placement) {
+  *placement = kTaskPlacementProfiles[profile][task];
+}
+
+void TaskPlacementGet(const TaskPlacementTask task,
+                      TaskPlacement *const placement) {
+  TaskPlacementGetForProfile(s_profile, task, placement);
+}
+
+EipStatus TaskPlacementStoreProfile(const TaskPlacementProfile profile) {
+  if(profile >= kTaskPlacementNumberOfProfiles) {
+    return kEipStatusError;
+  }
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(TASK_PLACEMENT_NVS_NAMESPACE, NVS_READWRITE,
+                           &handle);
+  if(ESP_OK == err) {
+    err = nvs_set_u8(handle, TASK_PLACEMENT_NVS_PROFILE_KEY, (uint8_t) profile);
+    if(ESP_OK == err) {
+      err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+  }
+  if(ESP_OK != err) {
+    OPENER_TRACE_ERR("Task placement: storing the profile failed (%s)\n",
+                     esp_err_to_name(err) );
+    return kEipStatusError;
+  }
+  taskENTER_CRITICAL(&s_placement_lock);
+  s_stored_profile = profile;
+  taskEXIT_CRITICAL(&s_placement_lock);
+  return kEipStatusOk;
+}
+
+const char *TaskPlacementGetProfileName(const TaskPlacementProfile profile) {
+  return profile < kTaskPlacementNumberOfProfiles ?
+         kTaskPlacementProfileNames[profile] : "unknown";
+}
+
+const char *TaskPlacementGetTaskName(const TaskPlacementTask task) {
+  return task < kTaskPlacementNumberOfTasks ?
+         kTaskPlacementTaskNames[task] : "unknown";
+}
+
+bool TaskPlacementFindProfile(const char *const name,
+                              TaskPlacementProfile *const profile) {
+  for(size_t i = 0; i < kTaskPlacementNumberOfProfiles; ++i) {
+    if(0 == strcmp(name, kTaskPlacementProfileNames[i]) ) {
+      *profile = (TaskPlacementProfile) i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Takes the counters at the start, or adds what changed since then on
+ * the connections that stayed open */
+static void TaskPlacementCountIo(const bool start,
+                                 TaskPlacementMeasurement *const result) {
+  for(size_t i = 0; i < CIP_CONNECTION_DIAGNOSTICS_NUMBER_OF_INSTANCES; ++i) {
+    CipConnectionDiagnostics current;
+    if(!CipConnectionDiagnosticsGet(i, &current) ) {
+      current.connection_id = 0;
+    }
+    const CipConnectionDiagnostics *const first = &s_io_start[i];
+    if(start) {
+      s_io_start[i] = current;
+      continue;
+    }
+    if(0 == current.connection_id ||
+       current.connection_id != first->connection_id) {
+      continue;
+    }
+    result->io_connections++;
+    result->produced_packets += current.produced.packets -
+                                first->produced.packets;
+    result->produced_late += current.produced.late_packets -
+                             first->produced.late_packets;
+    result->produced_missed += current.produced.missed_packets -
+                               first->produced.missed_packets;
+    for(size_t bucket = 0; bucket < CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS;
+        ++bucket) {
+      result->produced_histogram[bucket] += current.produced.histogram[bucket] -
+                                            first->produced.histogram[bucket];
+    }
+  }
+}
+
+static void TaskPlacementStoreMeasurement(
+  const TaskPlacementMeasurement *const measurement) {
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(TASK_PLACEMENT_NVS_NAMESPACE, NVS_READWRITE,
+                           &handle);
+  if(ESP_OK == err) {
+    err = nvs_set_blob(handle, kTaskPlacementMeasurementKeys[s_profile],
+                       measurement, sizeof(*measurement) );
+    if(ESP_OK == err) {
+      err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+  }
+  if(ESP_OK != err) {
+    OPENER_TRACE_WARN("Task placement: storing the measurement failed (%s)\n",
+                      esp_err_to_name(err) );
+  }
+}
+
+static void TaskPlacementJob(void *argument, uint32_t events) {
+  (void) argument;
+  (void) events;
+  taskENTER_CRITICAL(&s_placement_lock);
+  const bool start = kTaskPlacementMeasurementRunning ==
+                     s_measurements[s_profile].state;
+  taskEXIT_CRITICAL(&s_placement_lock);
+  if(!start) {
+    return; /* a request for another job */
+  }
+
+  TaskPlacementMeasurement result;
+  memset(&result, 0, sizeof(result) );
+  TaskPlacementCountIo(true, &result);
+#if OPENER_LOOP_PROFILE
+  LoopProfileReset();
+#endif
+  vTaskDelay(pdMS_TO_TICKS(s_duration_s * 1000U) );
+  TaskPlacementCountIo(false, &result);
+#if OPENER_LOOP_PROFILE
+  LoopProfileSummary summary;
+  LoopProfileGetSummary(kLoopProfilePhaseLoop, &summary);
+  result.loop_profile = true;
+  result.loop_p99 = summary.percentile_99;
+  result.loop_maximum = summary.maximum;
+  LoopProfileGetSummary(kLoopProfilePhaseProduction, &summary);
+  result.production_p99 = summary.percentile_99;
+  result.production_maximum = summary.maximum;
+#endif
+  result.duration_s = s_duration_s;
+  result.state = kTaskPlacementMeasurementDone;
+
+  taskENTER_CRITICAL(&s_placement_lock);
+  s_measurements[s_profile] = result;
+  taskEXIT_CRITICAL(&s_placement_lock);
+  TaskPlacementStoreMeasurement(&result);
+  OPENER_TRACE_INFO("Task placement %s: %u I/O connections, %u packets, "
+                    "%u late, %u missed\n",
+                    kTaskPlacementProfileNames[s_profile],
+                    (unsigned) result.io_connections,
+                    (unsigned) result.produced_packets,
+                    (unsigned) result.produced_late,
+                    (unsigned) result.produced_missed);
+}
+
+static bool TaskPlacementStartJob(void) {
+  if(s_job_registered) {
+    return true;
+  }
+  const AppSchedulerJobConfig config = {
+    .name = "placement",
+    .function = TaskPlacementJob,
+    .argument = NULL,
+    .period_ms = 0,
+    .events = kAppSchedulerEventRequest,
+    .core = TASK_PLACEMENT_JOB_CORE,
+    .priority = TASK_PLACEMENT_JOB_PRIORITY,
+    .stack_size = TASK_PLACEMENT_JOB_STACK_SIZE,
+  };
+  s_job_registered = kEipStatusOk == AppSchedulerRegister(&config);
+  return s_job_registered;
+}
+
+EipStatus TaskPlacementMeasureStart(const CipUdint duration_s) {
+  if(0 == duration_s || duration_s > TASK_PLACEMENT_MAX_DURATION_S) {
+    return kEipStatusError;
+  }
+  if(!TaskPlacementStartJob() ) {
+    return kEipStatusError;
+  }
+  taskENTER_CRITICAL(&s_placement_lock);
+  const bool running = kTaskPlacementMeasurementRunning ==
+                       s_measurements[s_profile].state;
+  if(!running) {
+    memset(&s_measurements[s_profile], 0, sizeof(s_measurements[s_profile]) );
+    s_measurements[s_profile].state = kTaskPlacementMeasurementRunning;
+    s_measurements[s_profile].duration_s = duration_s;
+    s_duration_s = duration_s;
+  }
+  taskEXIT_CRITICAL(&s_placement_lock);
+  if(running) {
+    return kEipStatusError;
+  }
+  AppSchedulerSignal(kAppSchedulerEventRequest);
+  return kEipStatusOk;
+}
+
+void TaskPlacementGetMeasurement(const TaskPlacementProfile profile,
+                                 TaskPlacementMeasurement *const measurement) {
+  taskENTER_CRITICAL(&s_placement_lock);
+  *measurement = s_measurements[profile];
+  taskEXIT_CRITICAL(&s_placement_lock);
+}
@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_TASK_PLACEMENT_H_
+#define OPENER_TASK_PLACEMENT_H_
+
+/** @file task_placement.h
+ *  @brief Core and priority profiles of the OpENer, I/O and web server tasks
+ *
+ *  A profile decides where the tasks of the stack run:
+ *  - shared: OpENer task and I/O task on core 0, the I/O task one priority
+ *    above, the web server on core 1;
+ *  - tcpip: OpENer and I/O task on core 0 right below the tcpip thread, so
+ *    no other task runs between lwIP and the stack. The tcpip thread itself
+ *    is only kept on core 0 with CONFIG_LWIP_TCPIP_TASK_AFFINITY_CPU0;
+ *  - io_core1: the I/O task on core 1 at CONFIG_OPENER_IO_TASK_PRIORITY,
+ *    above the I/O scan task and the web server;
+ *  - split: the I/O task alone with the I/O scan task on core 1, the
+ *    explicit side, OpENer task and web server, on core 0 with the web
+ *    server below the OpENer task.
+ *
+ *  The build default is chosen with CONFIG_OPENER_TASK_PLACEMENT_PROFILE.
+ *  TaskPlacementStoreProfile() keeps another one in the NVS, which is taken
+ *  from the next boot on; tasks keep their place while they run. On single
+ *  core builds every task runs on core 0. The priority of the tcpip thread
+ *  comes from CONFIG_LWIP_TCPIP_TASK_PRIO in every profile.
+ *
+ *  TaskPlacementMeasureStart() compares profiles with the data of the
+ *  running I/O connections: for a given time it counts the produced packets,
+ *  the late and missed ones and their interval deviation histogram, see
+ *  cipconnectiondiagnostics.h, and with OPENER_LOOP_PROFILE the 99th
+ *  percentile and maximum of the loop iteration and of the timer driven
+ *  production, see loop_profile.h, whose statistics it clears at the start.
+ *  The result is stored in the NVS per profile, so the profiles measured in
+ *  the boots before stay available beside the active one.
+ */
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+#include "cipconnectiondiagnostics.h"
+#include "freertos/FreeRTOS.h"
+
+typedef enum {
+  kTaskPlacementProfileShared = 0,
+  kTaskPlacementProfileTcpip,
+  kTaskPlacementProfileIoCore1,
+  kTaskPlacementProfileSplit,
+  kTaskPlacementNumberOfProfiles
+} TaskPlacementProfile;
+
+/** @brief Tasks placed by the profiles */
+typedef enum {
+  kTaskPlacementTaskOpener = 0, /**< explicit messages, TCP, Forward Open */
+  kTaskPlacementTaskIo, /**< producer task, see production_scheduler.h */
+  kTaskPlacementTaskHttpd, /**< web UI server */
+  kTaskPlacementNumberOfTasks
+} TaskPlacementTask;
+
+/** @brief Where a task runs */
+typedef struct {
+  BaseType_t core;
+  UBaseType_t priority;
+} TaskPlacement;
+
+typedef enum {
+  kTaskPlacementMeasurementNone = 0, /**< never measured */
+  kTaskPlacementMeasurementRunning,
+  kTaskPlacementMeasurementDone,
+} TaskPlacementMeasurementState;
+
+/** @brief Result of a measurement, times in microseconds */
+typedef struct {
+  TaskPlacementMeasurementState state;
+  CipUdint duration_s;
+  CipUdint io_connections; /**< I/O connections open throughout */
+  CipUdint produced_packets;
+  CipUdint produced_late;
+  CipUdint produced_missed;
+  CipUdint produced_histogram[CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS];
+  bool loop_profile; /**< the loop members are valid */
+  CipUdint loop_p99;
+  CipUdint loop_maximum;
+  CipUdint production_p99;
+  CipUdint production_maximum;
+} TaskPlacementMeasurement;
+
+/** @brief Load the profile of this boot, called once after nvs_flash_init() */
+void TaskPlacementInitialize(void);
+
+/** @brief Profile of this boot */
+TaskPlacementProfile TaskPlacementGetProfile(void);
+
+/** @brief Profile taken from the next boot on */
+TaskPlacementProfile TaskPlacementGetStoredProfile(void);
+
+/** @brief Place of a task in the profile of this boot */
+void TaskPlacementGet(const TaskPlacementTask task,
+                      TaskPlacement *const placement);
+
+/** @brief Place of a task in any profile */
+void TaskPlacementGetForProfile(const TaskPlacementProfile profile,
+                                const TaskPlacementTask task,
+                                TaskPlacement *const placement);
+
+/** @brief Store the profile for the next boot
+ *
+ *  @return kEipStatusError for an unknown profile or an NVS error
+ */
+EipStatus TaskPlacementStoreProfile(const TaskPlacementProfile profile);
+
+/** @brief Names used in the web API */
+const char *TaskPlacementGetProfileName(const TaskPlacementProfile profile);
+const char *TaskPlacementGetTaskName(const TaskPlacementTask task);
+
+/** @brief Look up a profile by its name
+ *
+ *  @return false if there is none of that name
+ */
+bool TaskPlacementFindProfile(const char *const name,
+                              TaskPlacementProfile *const profile);
+
+/** @brief Measure the profile of this boot for duration_s seconds
+ *
+ *  Called by the web server task, returns at once.
+ *
+ *  @return kEipStatusError if a measurement runs already, the duration is
+ *          out of range or the job could not start
+ */
+EipStatus TaskPlacementMeasureStart(const CipUdint duration_s);
+
+/** @brief Copy the last measurement of a profile, safe from any task */
+void TaskPlacementGetMeasurement(const TaskPlacementProfile profile,
+                                 TaskPlacementMeasurement *const measurement);
+
+#endif /* OPENER_TASK_PLACEMENT_H_ */
@@ -0,0 +1,32 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_TASK_SWITCH_HOOK_H_
+#define OPENER_TASK_SWITCH_HOOK_H_
+
+/** @file task_switch_hook.h
+ *  @brief Task switch hook of the FreeRTOS kernel
+ *
+ *  With CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD the component's CMakeLists
+ *  force-includes this header into the sources of the freertos component
+ *  only, so FreeRTOS.h takes this traceTASK_SWITCHED_IN instead of its empty
+ *  default. The kernel calls it in vTaskSwitchContext() on the switching
+ *  core, from a task or an interrupt, also when the same task is selected
+ *  again. It must not depend on any other header.
+ */
+
+#ifndef __ASSEMBLER__
+
+/** @brief Count a task switch of the calling core, in IRAM */
+void TaskTelemetryTaskSwitchedIn(void);
+
+/* Left alone where FreeRTOS.h came first, i.e. outside the kernel */
+#ifndef traceTASK_SWITCHED_IN
+#define traceTASK_SWITCHED_IN() TaskTelemetryTaskSwitchedIn()
+#endif
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* OPENER_TASK_SWITCH_HOOK_H_ */
@@ -0,0 +1,494 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "task_telemetry.h"
+
+#if CONFIG_OPENER_TASK_TELEMETRY
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "cipcommon.h"
+#include "opener_api.h"
+#include "trace.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/opt.h"
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+#include "task_switch_hook.h"
+#endif
+
+/* Recommendations are rounded up to this many bytes */
+#define TASK_TELEMETRY_STACK_GRANULARITY 256U
+
+static const char *kTag = "task_telemetry";
+
+static const char *const kTaskTelemetryTaskNames[kTaskTelemetryNumberOfTasks] =
+{
+  "OpENer",
+  "httpd",
+  TCPIP_THREAD_NAME,
+  "kc868_io",
+  "nv_config",
+  "OpENer_prod"
+};
+
+static const CipUint kTaskTelemetryNumberOfTasksAttribute =
+  kTaskTelemetryNumberOfTasks;
+
+/* Written by the esp_timer task and TaskTelemetryRegister(), read by the
+ * web UI and the OpENer task, all under s_telemetry_lock */
+static TaskTelemetryStack s_stacks[kTaskTelemetryNumberOfTasks];
+static TaskTelemetryHeap s_heap;
+static portMUX_TYPE s_telemetry_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_telemetry_timer = NULL;
+
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+#define TASK_TELEMETRY_CPU_WINDOW CONFIG_OPENER_TASK_TELEMETRY_CPU_WINDOW
+
+/* Incremented by the task switch hook of each core only */
+static volatile uint32_t s_task_switches[portNUM_PROCESSORS];
+
+/* Columns of the sample window: the busy time of each core, then the load
+ * of each watched task, all in per mille of one core */
+#define TASK_TELEMETRY_CPU_SERIES (portNUM_PROCESSORS + \
+                                   kTaskTelemetryNumberOfTasks)
+
+/* Sample window of the esp_timer task */
+static CipUint s_cpu_samples[TASK_TELEMETRY_CPU_WINDOW][TASK_TELEMETRY_CPU_SERIES];
+static CipUdint s_cpu_switch_samples[TASK_TELEMETRY_CPU_WINDOW][
+  portNUM_PROCESSORS];
+static size_t s_cpu_next_sample = 0;
+static size_t s_cpu_window_samples = 0;
+static bool s_cpu_started = false;
+static configRUN_TIME_COUNTER_TYPE s_cpu_last_time;
+static configRUN_TIME_COUNTER_TYPE s_cpu_last_idle[portNUM_PROCESSORS];
+static uint32_t s_cpu_last_switches[portNUM_PROCESSORS];
+static TaskHandle_t s_cpu_task_handles[kTaskTelemetryNumberOfTasks];
+static configRUN_TIME_COUNTER_TYPE s_cpu_task_counters[kTaskTelemetryNumberOfTasks];
+
+/* Results, under s_telemetry_lock */
+static TaskTelemetryCore s_cores[portNUM_PROCESSORS];
+static TaskTelemetryLoad s_task_loads[kTaskTelemetryNumberOfTasks];
+static BaseType_t s_task_cores[kTaskTelemetryNumberOfTasks];
+
+static const CipUint kTaskTelemetryNumberOfCoresAttribute = portNUM_PROCESSORS;
+#endif /* CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD */
+
+static CipUdint TaskTelemetryRecommend(const CipUdint stack_size,
+                                       const CipUdint minimum_free) {
+  const CipUdint used = stack_size - minimum_free;
+  const CipUdint recommended = used + CONFIG_OPENER_TASK_TELEMETRY_STACK_MARGIN +
+                               TASK_TELEMETRY_STACK_GRANULARITY - 1U;
+  return recommended - recommended % TASK_TELEMETRY_STACK_GRANULARITY;
+}
+
+static void TaskTelemetrySampleStacks(void) {
+  for(size_t i = 0; i < kTaskTelemetryNumberOfTasks; ++i) {
+    taskENTER_CRITICAL(&s_telemetry_lock);
+    const CipUdint stack_size = s_stacks[i].stack_size;
+    taskEXIT_CRITICAL(&s_telemetry_lock);
+    if(0 == stack_size) {
+      continue;
+    }
+
+    /* Looked up on every sample, the OpENer and NV writer tasks come and
+     * go. A task deleting itself is freed by the idle task, so its control
+     * block outlives the short window between both calls. */
+    TaskHandle_t handle = xTaskGetHandle(kTaskTelemetryTaskNames[i]);
+    const CipUdint free_stack = (NULL != handle) ?
+                                (CipUdint) uxTaskGetStackHighWaterMark(handle) :
+                                0;
+
+    bool new_low = false;
+    CipUdint recommended = 0;
+    taskENTER_CRITICAL(&s_telemetry_lock);
+    TaskTelemetryStack *const stack = &s_stacks[i];
+    stack->running = (NULL != handle);
+    if(NULL != handle && stack_size == stack->stack_size &&
+       (0 == stack->recommended || free_stack < stack->minimum_free) ) {
+      stack->minimum_free = free_stack;
+      stack->recommended = TaskTelemetryRecommend(stack_size, free_stack);
+      recommended = stack->recommended;
+      new_low = true;
+    }
+    taskEXIT_CRITICAL(&s_telemetry_lock);
+
+    if(new_low) {
+      if(recommended > stack_size) {
+        ESP_LOGW(kTag, "%s: %" PRIu32 " of %" PRIu32 " stack bytes free, "
+                 "recommended %" PRIu32, kTaskTelemetryTaskNames[i],
+                 free_stack, stack_size, recommended);
+      } else {
+        ESP_LOGI(kTag, "%s: %" PRIu32 " of %" PRIu32 " stack bytes free, "
+                 "recommended %" PRIu32, kTaskTelemetryTaskNames[i],
+                 free_stack, stack_size, recommended);
+      }
+    }
+  }
+}
+
+static void TaskTelemetrySampleHeap(void) {
+  TaskTelemetryHeap heap = {
+    .free = (CipUdint) heap_caps_get_free_size(MALLOC_CAP_8BIT),
+    .minimum_free = (CipUdint) heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+    .largest_free_block =
+      (CipUdint) heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+  };
+  if(0 != heap.free) {
+    heap.fragmentation = 100U - (CipUdint)
+                         ( (uint64_t) heap.largest_free_block * 100U /
+                           heap.free );
+  }
+  taskENTER_CRITICAL(&s_telemetry_lock);
+  s_heap = heap;
+  taskEXIT_CRITICAL(&s_telemetry_lock);
+}
+
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+void IRAM_ATTR TaskTelemetryTaskSwitchedIn(void) {
+  s_task_switches[xPortGetCoreID()]++;
+}
+
+static CipUint TaskTelemetryPerMille(const configRUN_TIME_COUNTER_TYPE part,
+                                     const configRUN_TIME_COUNTER_TYPE whole) {
+  if(0 == whole) {
+    return 0;
+  }
+  const uint64_t per_mille = (uint64_t) part * 1000U / whole;
+  return (CipUint) (per_mille > 1000U ? 1000U : per_mille);
+}
+
+/* Reduce one column of the window to its last, average and peak value */
+static void TaskTelemetryReduce(const size_t series,
+                                TaskTelemetryLoad *const load) {
+  const size_t last = (s_cpu_next_sample + TASK_TELEMETRY_CPU_WINDOW - 1U) %
+                      TASK_TELEMETRY_CPU_WINDOW;
+  CipUdint sum = 0;
+  CipUdint peak = 0;
+  for(size_t i = 0; i < s_cpu_window_samples; ++i) {
+    const CipUdint value = s_cpu_samples[i][series];
+    sum += value;
+    if(value > peak) {
+      peak = value;
+    }
+  }
+  load->last = s_cpu_samples[last][series];
+  load->average = sum / s_cpu_window_samples;
+  load->peak = peak;
+}
+
+static void TaskTelemetrySampleCpu(void) {
+  const configRUN_TIME_COUNTER_TYPE now =
+    (configRUN_TIME_COUNTER_TYPE) esp_timer_get_time();
+  const configRUN_TIME_COUNTER_TYPE elapsed = now - s_cpu_last_time;
+  CipUint *const sample = s_cpu_samples[s_cpu_next_sample];
+  CipUdint *const switch_sample = s_cpu_switch_samples[s_cpu_next_sample];
+
+  for(BaseType_t core = 0; core < portNUM_PROCESSORS; ++core) {
+    const configRUN_TIME_COUNTER_TYPE idle =
+      ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core) );
+    const uint32_t switches = s_task_switches[core];
+    sample[core] = 1000U - TaskTelemetryPerMille(idle - s_cpu_last_idle[core],
+                                                 elapsed);
+    switch_sample[core] = switches - s_cpu_last_switches[core];
+    s_cpu_last_idle[core] = idle;
+    s_cpu_last_switches[core] = switches;
+  }
+
+  BaseType_t task_cores[kTaskTelemetryNumberOfTasks];
+  for(size_t i = 0; i < kTaskTelemetryNumberOfTasks; ++i) {
+    TaskHandle_t handle = xTaskGetHandle(kTaskTelemetryTaskNames[i]);
+    configRUN_TIME_COUNTER_TYPE counter = 0;
+    task_cores[i] = tskNO_AFFINITY;
+    if(NULL != handle) {
+      counter = ulTaskGetRunTimeCounter(handle);
+      task_cores[i] = xTaskGetCoreID(handle);
+    }
+    /* A recreated task counts from zero again */
+    if(handle != s_cpu_task_handles[i] || counter < s_cpu_task_counters[i]) {
+      s_cpu_task_counters[i] = 0;
+    }
+    sample[portNUM_PROCESSORS + i] =
+      TaskTelemetryPerMille(counter - s_cpu_task_counters[i], elapsed);
+    s_cpu_task_handles[i] = handle;
+    s_cpu_task_counters[i] = counter;
+  }
+  s_cpu_last_time = now;
+
+  /* The first sample only sets the baselines */
+  if(!s_cpu_started) {
+    s_cpu_started = true;
+    return;
+  }
+  s_cpu_next_sample = (s_cpu_next_sample + 1U) % TASK_TELEMETRY_CPU_WINDOW;
+  if(s_cpu_window_samples < TASK_TELEMETRY_CPU_WINDOW) {
+    s_cpu_window_samples++;
+  }
+
+  TaskTelemetryCore cores[portNUM_PROCESSORS];
+  TaskTelemetryLoad task_loads[kTaskTelemetryNumberOfTasks];
+  for(BaseType_t core = 0; core < portNUM_PROCESSORS; ++core) {
+    TaskTelemetryReduce(core, &cores[core].busy);
+    CipUdint switches = 0;
+    for(size_t i = 0; i < s_cpu_window_samples; ++i) {
+      switches += s_cpu_switch_samples[i][core];
+    }
+    cores[core].task_switches_per_s = (CipUdint)
+                                      ( (uint64_t) switches * 1000U /
+                                        ( (uint64_t) s_cpu_window_samples *
+                                          CONFIG_OPENER_TASK_TELEMETRY_PERIOD_MS ) );
+    cores[core].task_switches = s_cpu_last_switches[core];
+  }
+  for(size_t i = 0; i < kTaskTelemetryNumberOfTasks; ++i) {
+    TaskTelemetryReduce(portNUM_PROCESSORS + i, &task_loads[i]);
+  }
+
+  taskENTER_CRITICAL(&s_telemetry_lock);
+  memcpy(s_cores, cores, sizeof(s_cores) );
+  memcpy(s_task_loads, task_loads, sizeof(s_task_loads) );
+  memcpy(s_task_cores, task_cores, sizeof(s_task_cores) );
+  taskEXIT_CRITICAL(&s_telemetry_lock);
+}
+#endif /* CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD */
+
+static void TaskTelemetryTimerCallback(void *argument) {
+  (void) argument;
+  TaskTelemetrySampleStacks();
+  TaskTelemetrySampleHeap();
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+  TaskTelemetrySampleCpu();
+#endif
+}
+
+void TaskTelemetryInitialize(void) {
+  if(NULL != s_telemetry_timer) {
+    return;
+  }
+  TaskTelemetryRegister(kTaskTelemetryTcpip,
+                        CONFIG_LWIP_TCPIP_TASK_STACK_SIZE);
+  TaskTelemetrySampleHeap();
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+  for(size_t i = 0; i < kTaskTelemetryNumberOfTasks; ++i) {
+    s_task_cores[i] = tskNO_AFFINITY;
+  }
+  TaskTelemetrySampleCpu();
+#endif
+
+  const esp_timer_create_args_t timer_args = {
+    .callback = TaskTelemetryTimerCallback,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "task_telemetry",
+  };
+  if(ESP_OK != esp_timer_create(&timer_args, &s_telemetry_timer) ) {
+    ESP_LOGE(kTag, "Failed to create the sampling timer");
+    s_telemetry_timer = NULL;
+    return;
+  }
+  if(ESP_OK !=
+     esp_timer_start_periodic(s_telemetry_timer,
+                              (uint64_t) CONFIG_OPENER_TASK_TELEMETRY_PERIOD_MS *
+                              1000U) ) {
+    ESP_LOGE(kTag, "Failed to start the sampling timer");
+  }
+}
+
+void TaskTelemetryRegister(const TaskTelemetryTask task,
+                           const size_t stack_size) {
+  taskENTER_CRITICAL(&s_telemetry_lock);
+  TaskTelemetryStack *const stack = &s_stacks[task];
+  if(stack_size != stack->stack_size) {
+    /* A recreated task keeps its low, a resized one starts over */
+    memset(stack, 0, sizeof(*stack) );
+    stack->stack_size = (CipUdint) stack_size;
+  }
+  taskEXIT_CRITICAL(&s_telemetry_lock);
+}
+
+const char *TaskTelemetryGetTaskName(const TaskTelemetryTask task) {
+  return kTaskTelemetryTaskNames[task];
+}
+
+void TaskTelemetryGetStack(const TaskTelemetryTask task,
+                           TaskTelemetryStack *const stack) {
+  taskENTER_CRITICAL(&s_telemetry_lock);
+  *stack = s_stacks[task];
+  taskEXIT_CRITICAL(&s_telemetry_lock);
+}
+
+void TaskTelemetryGetHeap(TaskTelemetryHeap *const heap) {
+  taskENTER_CRITICAL(&s_telemetry_lock);
+  *heap = s_heap;
+  taskEXIT_CRITICAL(&s_telemetry_lock);
+}
+
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+CipUdint TaskTelemetryGetCpuWindowSamples(void) {
+  taskENTER_CRITICAL(&s_telemetry_lock);
+  const CipUdint samples = (CipUdint) s_cpu_window_samples;
+  taskEXIT_CRITICAL(&s_telemetry_lock);
+  return samples;
+}
+
+void TaskTelemetryGetCore(const BaseType_t core,
+                          TaskTelemetryCore *const load) {
+  taskENTER_CRITICAL(&s_telemetry_lock);
+  *load = s_cores[core];
+  taskEXIT_CRITICAL(&s_telemetry_lock);
+}
+
+void TaskTelemetryGetTaskLoad(const TaskTelemetryTask task,
+                              TaskTelemetryLoad *const load) {
+  taskENTER_CRITICAL(&s_telemetry_lock);
+  *load = s_task_loads[task];
+  taskEXIT_CRITICAL(&s_telemetry_lock);
+}
+
+BaseType_t TaskTelemetryGetTaskCore(const TaskTelemetryTask task) {
+  taskENTER_CRITICAL(&s_telemetry_lock);
+  const BaseType_t core = s_task_cores[task];
+  taskEXIT_CRITICAL(&s_telemetry_lock);
+  return core;
+}
+#endif /* CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD */
+
+static void EncodeTaskTelemetryStacks(const void *const data,
+                                      ENIPMessage *const outgoing_message) {
+  (void) data;
+  for(size_t i = 0; i < kTaskTelemetryNumberOfTasks; ++i) {
+    TaskTelemetryStack stack;
+    TaskTelemetryGetStack( (TaskTelemetryTask) i, &stack );
+    EncodeCipUdint(&stack.stack_size, outgoing_message);
+    EncodeCipUdint(&stack.minimum_free, outgoing_message);
+    EncodeCipUdint(&stack.recommended, outgoing_message);
+  }
+}
+
+static void EncodeTaskTelemetryHeap(const void *const data,
+                                    ENIPMessage *const outgoing_message) {
+  (void) data;
+  TaskTelemetryHeap heap;
+  TaskTelemetryGetHeap(&heap);
+  EncodeCipUdint(&heap.free, outgoing_message);
+  EncodeCipUdint(&heap.minimum_free, outgoing_message);
+  EncodeCipUdint(&heap.largest_free_block, outgoing_message);
+  EncodeCipUdint(&heap.fragmentation, outgoing_message);
+}
+
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+static void EncodeTaskTelemetryLoad(const TaskTelemetryLoad *const load,
+                                    ENIPMessage *const outgoing_message) {
+  EncodeCipUdint(&load->last, outgoing_message);
+  EncodeCipUdint(&load->average, outgoing_message);
+  EncodeCipUdint(&load->peak, outgoing_message);
+}
+
+static void EncodeTaskTelemetryCores(const void *const data,
+                                     ENIPMessage *const outgoing_message) {
+  (void) data;
+  for(BaseType_t core = 0; core < portNUM_PROCESSORS; ++core) {
+    TaskTelemetryCore load;
+    TaskTelemetryGetCore(core, &load);
+    EncodeTaskTelemetryLoad(&load.busy, outgoing_message);
+    EncodeCipUdint(&load.task_switches_per_s, outgoing_message);
+    EncodeCipUdint(&load.task_switches, outgoing_message);
+  }
+}
+
+static void EncodeTaskTelemetryTaskLoads(const void *const data,
+                                         ENIPMessage *const outgoing_message) {
+  (void) data;
+  for(size_t i = 0; i < kTaskTelemetryNumberOfTasks; ++i) {
+    TaskTelemetryLoad load;
+    TaskTelemetryGetTaskLoad( (TaskTelemetryTask) i, &load );
+    EncodeTaskTelemetryLoad(&load, outgoing_message);
+  }
+}
+#endif /* CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD */
+
+EipStatus TaskTelemetryCreateCipObject(void) {
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+  const int number_of_instance_attributes = 6;
+#else
+  const int number_of_instance_attributes = 3;
+#endif
+  CipClass *telemetry_class = NULL;
+
+  if( ( telemetry_class = CreateCipClass(kTaskTelemetryClassCode,
+                                         7, /* # class attributes */
+                                         7, /* # highest class attribute number */
+                                         2, /* # class services */
+                                         number_of_instance_attributes, /* # instance attributes */
+                                         number_of_instance_attributes, /* # highest instance attribute number */
+                                         2, /* # instance services */
+                                         1, /* # instances */
+                                         "Task Telemetry",
+                                         1, /* # class revision */
+                                         NULL /* # function pointer for initialization */
+                                         ) ) == 0 ) {
+    OPENER_TRACE_ERR("Task telemetry: failed to create the CIP object\n");
+    return kEipStatusError;
+  }
+
+  CipInstance *instance = GetCipInstance(telemetry_class, 1);
+  InsertAttribute(instance,
+                  1,
+                  kCipUint,
+                  EncodeCipUint,
+                  NULL,
+                  (void *)&kTaskTelemetryNumberOfTasksAttribute,
+                  kGetableSingleAndAll);
+  InsertAttribute(instance,
+                  2,
+                  kCipAny,
+                  EncodeTaskTelemetryStacks,
+                  NULL,
+                  s_stacks,
+                  kGetableSingleAndAll);
+  InsertAttribute(instance,
+                  3,
+                  kCipAny,
+                  EncodeTaskTelemetryHeap,
+                  NULL,
+                  &s_heap,
+                  kGetableSingleAndAll);
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+  InsertAttribute(instance,
+                  4,
+                  kCipUint,
+                  EncodeCipUint,
+                  NULL,
+                  (void *)&kTaskTelemetryNumberOfCoresAttribute,
+                  kGetableSingleAndAll);
+  InsertAttribute(instance,
+                  5,
+                  kCipAny,
+                  EncodeTaskTelemetryCores,
+                  NULL,
+                  s_cores,
+                  kGetableSingleAndAll);
+  InsertAttribute(instance,
+                  6,
+                  kCipAny,
+                  EncodeTaskTelemetryTaskLoads,
+                  NULL,
+                  s_task_loads,
+                  kGetableSingleAndAll);
+#endif
+
+  InsertService(telemetry_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(telemetry_class, kGetAttributeAll, &GetAttributeAll,
+                "GetAttributeAll");
+
+  return kEipStatusOk;
+}
+
+#endif /* CONFIG_OPENER_TASK_TELEMETRY */
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_TASK_TELEMETRY_H_
+#define OPENER_TASK_TELEMETRY_H_
+
+/** @file task_telemetry.h
+ *  @brief Stack high water marks of the firmware's tasks and heap statistics
+ *
+ *  Selected with CONFIG_OPENER_TASK_TELEMETRY. The tasks report their
+ *  configured stack size with TaskTelemetryRegister() when they are created.
+ *  An esp_timer samples uxTaskGetStackHighWaterMark() of every registered
+ *  task, found by its name, and the largest free block, free and minimum free
+ *  size of the 8-bit capable heap.
+ *
+ *  The lowest free stack seen since boot is kept per task. Each new low is
+ *  logged with a recommended stack size: the used part plus
+ *  CONFIG_OPENER_TASK_TELEMETRY_STACK_MARGIN, rounded up to 256 bytes.
+ *  ESP-IDF counts stacks in bytes, so do the high water marks. The
+ *  recommendation only covers the paths that ran since boot; let the device
+ *  run its full workload, e.g. Forward_Opens, web UI use and a link loss,
+ *  before shrinking a stack.
+ *
+ *  With CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD every sample also reads the
+ *  FreeRTOS run-time counters, clocked by esp_timer in microseconds. A core
+ *  is busy for the time its idle task did not run, a watched task loads one
+ *  core with its own run time. A traceTASK_SWITCHED_IN hook compiled into
+ *  the FreeRTOS kernel counts the task switches of each core, see
+ *  task_switch_hook.h. The last CONFIG_OPENER_TASK_TELEMETRY_CPU_WINDOW
+ *  samples form a sliding window with its average and peak. Interrupts are
+ *  charged to the task they interrupt, FreeRTOS keeps no separate ISR time.
+ *
+ *  The statistics are available through GET /api/system and the vendor
+ *  specific Task Telemetry object (class 0x68).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+
+#if CONFIG_OPENER_TASK_TELEMETRY
+
+/** @brief Task Telemetry object class code */
+static const CipUint kTaskTelemetryClassCode = 0x68U;
+
+/** @brief Tasks whose stacks are watched, the order of the CIP attribute */
+typedef enum {
+  kTaskTelemetryOpener = 0, /**< OpENer loop */
+  kTaskTelemetryHttpd, /**< web UI server */
+  kTaskTelemetryTcpip, /**< lwIP tcpip thread */
+  kTaskTelemetryIoScan, /**< KC868-A16 I/O scan */
+  kTaskTelemetryNvWriter, /**< deferred NVS writes of the configuration record */
+  kTaskTelemetryProducer, /**< timer driven I/O production */
+  kTaskTelemetryNumberOfTasks
+} TaskTelemetryTask;
+
+/** @brief Stack usage of one task, all sizes in bytes */
+typedef struct {
+  CipUdint stack_size; /**< configured size, 0 if the task is not registered */
+  CipUdint minimum_free; /**< lowest free stack seen, 0 before the first sample */
+  CipUdint recommended; /**< recommended stack size, 0 before the first sample */
+  bool running; /**< the task existed at the last sample */
+} TaskTelemetryStack;
+
+/** @brief Heap of 8-bit capable memory, sizes in bytes */
+typedef struct {
+  CipUdint free;
+  CipUdint minimum_free; /**< lowest free size since boot */
+  CipUdint largest_free_block;
+  CipUdint fragmentation; /**< percent of the free size not in the largest block */
+} TaskTelemetryHeap;
+
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+/** @brief CPU time in per mille of one core */
+typedef struct {
+  CipUdint last; /**< last sample period */
+  CipUdint average; /**< average of the window */
+  CipUdint peak; /**< highest sample period of the window */
+} TaskTelemetryLoad;
+
+/** @brief Load of one core */
+typedef struct {
+  TaskTelemetryLoad busy; /**< time its idle task did not run */
+  CipUdint task_switches_per_s; /**< average of the window */
+  CipUdint task_switches; /**< since boot */
+} TaskTelemetryCore;
+#endif /* CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD */
+
+/** @brief Start sampling, safe to call more than once
+ *
+ *  Registers the tcpip thread, whose stack size comes from the lwIP
+ *  configuration.
+ */
+void TaskTelemetryInitialize(void);
+
+/** @brief Report the stack size a task has been created with
+ *
+ *  May be called again when the task is recreated, e.g. the OpENer task
+ *  after a link loss. The lowest free stack is kept.
+ *
+ *  @param task watched task
+ *  @param stack_size stack size passed to xTaskCreate() in bytes
+ */
+void TaskTelemetryRegister(const TaskTelemetryTask task,
+                           const size_t stack_size);
+
+/** @brief Name of a watched task, as passed to xTaskCreate() */
+const char *TaskTelemetryGetTaskName(const TaskTelemetryTask task);
+
+/** @brief Copy the stack usage of a task */
+void TaskTelemetryGetStack(const TaskTelemetryTask task,
+                           TaskTelemetryStack *const stack);
+
+/** @brief Copy the heap statistics of the last sample */
+void TaskTelemetryGetHeap(TaskTelemetryHeap *const heap);
+
+#if CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD
+/** @brief Samples in the window so far, up to
+ *  CONFIG_OPENER_TASK_TELEMETRY_CPU_WINDOW */
+CipUdint TaskTelemetryGetCpuWindowSamples(void);
+
+/** @brief Copy the load of a core
+ *
+ *  @param core core number below portNUM_PROCESSORS
+ *  @param load receives the load, zeros before the second sample
+ */
+void TaskTelemetryGetCore(const BaseType_t core,
+                          TaskTelemetryCore *const load);
+
+/** @brief Copy the CPU time of a watched task, zeros while it does not run */
+void TaskTelemetryGetTaskLoad(const TaskTelemetryTask task,
+                              TaskTelemetryLoad *const load);
+
+/** @brief Core a watched task is pinned to, tskNO_AFFINITY if it is not or
+ *  it does not run */
+BaseType_t TaskTelemetryGetTaskCore(const TaskTelemetryTask task);
+#endif /* CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD */
+
+/** @brief Create the Task Telemetry object, called by the application */
+EipStatus TaskTelemetryCreateCipObject(void);
+
+#endif /* CONFIG_OPENER_TASK_TELEMETRY */
+
+#endif /* OPENER_TASK_TELEMETRY_H_ */
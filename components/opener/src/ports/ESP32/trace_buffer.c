@@ -0,0 +1,618 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "trace_buffer.h"
+
+#include <string.h>
+
+#include "opener_user_conf.h"
+
+#if OPENER_TRACE_BUFFER
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "sntp_clock.h"
+
+#define TRACE_BUFFER_ENTRIES CONFIG_OPENER_TRACE_BUFFER_ENTRIES
+#if (TRACE_BUFFER_ENTRIES & (TRACE_BUFFER_ENTRIES - 1) ) != 0
+#error "CONFIG_OPENER_TRACE_BUFFER_ENTRIES has to be a power of two"
+#endif
+#if portNUM_PROCESSORS > TRACE_BUFFER_NUMBER_OF_RINGS
+#error "TRACE_BUFFER_NUMBER_OF_RINGS is smaller than the number of cores"
+#endif
+
+#define TRACE_BUFFER_ARGUMENT_WORDS      8
+#define TRACE_BUFFER_STRING_BYTES        32
+#define TRACE_BUFFER_LINE_LENGTH         256
+#define TRACE_BUFFER_SPECIFICATION_LENGTH 24
+
+/* Below every other task of the stack, printing may take milliseconds */
+#define TRACE_BUFFER_TASK_PRIO           1
+#define TRACE_BUFFER_STACK_SIZE          3072
+#define TRACE_BUFFER_DRAIN_PERIOD_MS     50
+
+typedef struct {
+  atomic_uint_least32_t sequence; /* entry index + 1 once complete, 0 while written */
+  const char *format;
+  int64_t timestamp;
+  uint8_t core;
+  uint8_t argument_words;
+  uint8_t string_bytes;
+  uint32_t arguments[TRACE_BUFFER_ARGUMENT_WORDS];
+  char strings[TRACE_BUFFER_STRING_BYTES];
+} TraceBufferEntry;
+
+typedef struct {
+  atomic_uint_least32_t head; /* index of the next entry to reserve */
+  TraceBufferEntry entries[TRACE_BUFFER_ENTRIES];
+} TraceBufferRing;
+
+typedef enum {
+  kTraceLengthDefault,
+  kTraceLengthLong,
+  kTraceLengthLongLong,
+  kTraceLengthIntMax,
+  kTraceLengthSize,
+  kTraceLengthPtrDiff,
+  kTraceLengthUnsupported
+} TraceLength;
+
+/* One conversion specification of a format string */
+typedef struct {
+  const char *start; /* the '%' */
+  const char *end; /* one past the conversion character */
+  int star_count; /* '*' for width and precision */
+  TraceLength length;
+  char conversion;
+} TraceConversion;
+
+typedef enum {
+  kTraceEntryReady,
+  kTraceEntryPending,
+  kTraceEntryOverwritten
+} TraceEntryState;
+
+typedef struct {
+  char *text;
+  size_t length;
+  size_t capacity; /* including the terminating NUL */
+} TraceLine;
+
+static TraceBufferRing s_rings[TRACE_BUFFER_NUMBER_OF_RINGS];
+
+/* Parse the next conversion specification, false at the end of the string */
+static bool FindConversion(const char *position,
+                           TraceConversion *const conversion) {
+  for(; '\0' != *position; ++position) {
+    if('%' != *position) {
+      continue;
+    }
+    if('%' == position[1]) {
+      ++position;
+      continue;
+    }
+    conversion->start = position++;
+    conversion->star_count = 0;
+    while('\0' != *position && NULL != strchr("-+ #0", *position) ) {
+      ++position;
+    }
+    if('*' == *position) {
+      conversion->star_count++;
+      ++position;
+    }
+    while(*position >= '0' && *position <= '9') {
+      ++position;
+    }
+    if('.' == *position) {
+      ++position;
+      if('*' == *position) {
+        conversion->star_count++;
+        ++position;
+      }
+      while(*position >= '0' && *position <= '9') {
+        ++position;
+      }
+    }
+    conversion->length = kTraceLengthDefault;
+    switch(*position) {
+      case 'h':
+        ++position;
+        if('h' == *position) {
+          ++position;
+        }
+        break; /* promoted to int */
+      case 'l':
+        ++position;
+        conversion->length = kTraceLengthLong;
+        if('l' == *position) {
+          ++position;
+          conversion->length = kTraceLengthLongLong;
+        }
+        break;
+      case 'j': ++position; conversion->length = kTraceLengthIntMax; break;
+      case 'z': ++position; conversion->length = kTraceLengthSize; break;
+      case 't': ++position; conversion->length = kTraceLengthPtrDiff; break;
+      case 'L': ++position; conversion->length = kTraceLengthUnsupported; break;
+      default: break;
+    }
+    if('\0' == *position) {
+      return false;
+    }
+    conversion->conversion = *position;
+    conversion->end = position + 1;
+    return true;
+  }
+  return false;
+}
+
+static bool PushArgument(TraceBufferEntry *const entry,
+                         const void *const value,
+                         const size_t size) {
+  const size_t words = (size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+  if(entry->argument_words + words > TRACE_BUFFER_ARGUMENT_WORDS) {
+    return false;
+  }
+  memcpy(&entry->arguments[entry->argument_words], value, size);
+  entry->argument_words += words;
+  return true;
+}
+
+static bool PopArgument(const TraceBufferEntry *const entry,
+                        size_t *const read,
+                        void *const value,
+                        const size_t size) {
+  const size_t words = (size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+  if(*read + words > entry->argument_words) {
+    return false;
+  }
+  memcpy(value, &entry->arguments[*read], size);
+  *read += words;
+  return true;
+}
+
+static bool PushString(TraceBufferEntry *const entry, const char *string) {
+  const size_t free_bytes = TRACE_BUFFER_STRING_BYTES - entry->string_bytes;
+  if(0 == free_bytes) {
+    return false;
+  }
+  if(NULL == string) {
+    string = "(null)";
+  }
+  const uint32_t offset = entry->string_bytes;
+  if(!PushArgument(entry, &offset, sizeof(offset) ) ) {
+    return false;
+  }
+  const size_t length = strnlen(string, free_bytes - 1);
+  memcpy(&entry->strings[offset], string, length);
+  entry->strings[offset + length] = '\0';
+  entry->string_bytes += length + 1;
+  return true;
+}
+
+#define TRACE_BUFFER_CAPTURE(type) \
+  do { \
+    type value = va_arg(arguments, type); \
+    stored = PushArgument(entry, &value, sizeof(value) ); \
+  } while(0)
+
+/* Stops at the first argument that does not fit, the formatter stops there */
+static void CaptureArguments(TraceBufferEntry *const entry,
+                             const char *format,
+                             va_list arguments) {
+  TraceConversion conversion;
+  bool stored = true;
+  while(stored && FindConversion(format, &conversion) ) {
+    format = conversion.end;
+    for(int i = 0; stored && i < conversion.star_count; ++i) {
+      TRACE_BUFFER_CAPTURE(int);
+    }
+    if(!stored) {
+      break;
+    }
+    switch(conversion.conversion) {
+      case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+        switch(conversion.length) {
+          case kTraceLengthDefault: TRACE_BUFFER_CAPTURE(int); break;
+          case kTraceLengthLong: TRACE_BUFFER_CAPTURE(long); break;
+          case kTraceLengthLongLong: TRACE_BUFFER_CAPTURE(long long); break;
+          case kTraceLengthIntMax: TRACE_BUFFER_CAPTURE(intmax_t); break;
+          case kTraceLengthSize: TRACE_BUFFER_CAPTURE(size_t); break;
+          case kTraceLengthPtrDiff: TRACE_BUFFER_CAPTURE(ptrdiff_t); break;
+          default: stored = false; break;
+        }
+        break;
+      case 'c':
+        TRACE_BUFFER_CAPTURE(int);
+        break;
+      case 'p':
+        TRACE_BUFFER_CAPTURE(void *);
+        break;
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a':
+      case 'A':
+        if(kTraceLengthUnsupported == conversion.length) {
+          stored = false;
+        } else {
+          TRACE_BUFFER_CAPTURE(double);
+        }
+        break;
+      case 's':
+        stored = kTraceLengthDefault == conversion.length &&
+                 PushString(entry, va_arg(arguments, const char *) );
+        break;
+      default: /* %n and unknown conversions are not recorded */
+        stored = false;
+        break;
+    }
+  }
+}
+
+void TraceBufferRecord(const char *format,
+                       ...) {
+  const uint8_t core = (uint8_t)xPortGetCoreID();
+  TraceBufferRing *const ring = &s_rings[core];
+  const uint32_t index = atomic_fetch_add_explicit(&ring->head,
+                                                   1,
+                                                   memory_order_relaxed);
+  TraceBufferEntry *const entry =
+    &ring->entries[index & (TRACE_BUFFER_ENTRIES - 1)];
+
+  atomic_store_explicit(&entry->sequence, 0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  entry->format = format;
+  entry->timestamp = esp_timer_get_time();
+  entry->core = core;
+  entry->argument_words = 0;
+  entry->string_bytes = 0;
+  va_list arguments;
+  va_start(arguments, format);
+  CaptureArguments(entry, format, arguments);
+  va_end(arguments);
+  atomic_store_explicit(&entry->sequence, index + 1, memory_order_release);
+}
+
+static TraceEntryState ReadEntry(TraceBufferRing *const ring,
+                                 const uint32_t index,
+                                 TraceBufferEntry *const copy) {
+  TraceBufferEntry *const entry =
+    &ring->entries[index & (TRACE_BUFFER_ENTRIES - 1)];
+  const uint32_t sequence = atomic_load_explicit(&entry->sequence,
+                                                 memory_order_acquire);
+  if(index + 1 != sequence) {
+    return (0 != sequence && (int32_t)(sequence - (index + 1) ) > 0) ?
+           kTraceEntryOverwritten : kTraceEntryPending;
+  }
+  copy->format = entry->format;
+  copy->timestamp = entry->timestamp;
+  copy->core = entry->core;
+  copy->argument_words = entry->argument_words;
+  copy->string_bytes = entry->string_bytes;
+  memcpy(copy->arguments, entry->arguments, sizeof(copy->arguments) );
+  memcpy(copy->strings, entry->strings, sizeof(copy->strings) );
+  atomic_thread_fence(memory_order_acquire);
+  if(sequence != atomic_load_explicit(&entry->sequence, memory_order_relaxed) ) {
+    return kTraceEntryOverwritten; /* a writer lapped us while copying */
+  }
+  return kTraceEntryReady;
+}
+
+/* Skip what the writers have overwritten already */
+static void SkipLostEntries(TraceBufferCursor *const cursor,
+                            const size_t ring_number) {
+  const uint32_t head = atomic_load_explicit(&s_rings[ring_number].head,
+                                             memory_order_acquire);
+  const uint32_t behind = head - cursor->next[ring_number];
+  if( (int32_t)behind > TRACE_BUFFER_ENTRIES) {
+    cursor->lost += behind - TRACE_BUFFER_ENTRIES;
+    cursor->next[ring_number] = head - TRACE_BUFFER_ENTRIES;
+  }
+}
+
+static void AppendFormatted(TraceLine *const line,
+                            const char *const format,
+                            ...) {
+  const size_t space = line->capacity - line->length;
+  va_list arguments;
+  va_start(arguments, format);
+  const int written = vsnprintf(&line->text[line->length], space, format,
+                                arguments);
+  va_end(arguments);
+  if(written > 0) {
+    line->length += ( (size_t)written < space) ? (size_t)written : space - 1;
+  }
+}
+
+/* Literal text of a format string, "%%" becomes "%" */
+static void AppendLiteral(TraceLine *const line,
+                          const char *from,
+                          const char *const to) {
+  while(from < to && line->length + 1 < line->capacity) {
+    line->text[line->length++] = *from;
+    from += ('%' == from[0] && '%' == from[1]) ? 2 : 1;
+  }
+  line->text[line->length] = '\0';
+}
+
+#define TRACE_BUFFER_APPEND(type) \
+  do { \
+    type value; \
+    if(!PopArgument(entry, read, &value, sizeof(value) ) ) { \
+      return false; \
+    } \
+    AppendFormatted(line, specification, value); \
+  } while(0)
+
+static bool AppendConversion(TraceLine *const line,
+                             const TraceBufferEntry *const entry,
+                             size_t *const read,
+                             const TraceConversion *const conversion) {
+  char specification[TRACE_BUFFER_SPECIFICATION_LENGTH];
+  size_t length = 0;
+  for(const char *position = conversion->start; position < conversion->end;
+      ++position) {
+    if(length + 12 >= sizeof(specification) ) {
+      return false;
+    }
+    if('*' == *position) {
+      int value = 0;
+      if(!PopArgument(entry, read, &value, sizeof(value) ) ) {
+        return false;
+      }
+      length += (size_t)snprintf(&specification[length],
+                                 sizeof(specification) - length, "%d", value);
+    } else {
+      specification[length++] = *position;
+    }
+  }
+  specification[length] = '\0';
+
+  const bool is_signed = 'd' == conversion->conversion ||
+                         'i' == conversion->conversion;
+  switch(conversion->conversion) {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+      switch(conversion->length) {
+        case kTraceLengthDefault:
+          if(is_signed) {
+            TRACE_BUFFER_APPEND(int);
+          } else {
+            TRACE_BUFFER_APPEND(unsigned int);
+          }
+          break;
+        case kTraceLengthLong:
+          if(is_signed) {
+            TRACE_BUFFER_APPEND(long);
+          } else {
+            TRACE_BUFFER_APPEND(unsigned long);
+          }
+          break;
+        case kTraceLengthLongLong:
+          if(is_signed) {
+            TRACE_BUFFER_APPEND(long long);
+          } else {
+            TRACE_BUFFER_APPEND(unsigned long long);
+          }
+          break;
+        case kTraceLengthIntMax:
+          if(is_signed) {
+            TRACE_BUFFER_APPEND(intmax_t);
+          } else {
+            TRACE_BUFFER_APPEND(uintmax_t);
+          }
+          break;
+        case kTraceLengthSize: TRACE_BUFFER_APPEND(size_t); break;
+        case kTraceLengthPtrDiff: TRACE_BUFFER_APPEND(ptrdiff_t); break;
+        default: return false;
+      }
+      return true;
+    case 'c':
+      TRACE_BUFFER_APPEND(int);
+      return true;
+    case 'p':
+      TRACE_BUFFER_APPEND(void *);
+      return true;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a':
+    case 'A':
+      TRACE_BUFFER_APPEND(double);
+      return true;
+    case 's': {
+      uint32_t offset = 0;
+      if(!PopArgument(entry, read, &offset, sizeof(offset) ) ||
+         offset >= entry->string_bytes) {
+        return false;
+      }
+      AppendFormatted(line, specification, &entry->strings[offset]);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+static size_t FormatEntry(const TraceBufferEntry *const entry,
+                          char *const text,
+                          const size_t capacity) {
+  TraceLine line = { .text = text, .length = 0, .capacity = capacity };
+  text[0] = '\0';
+#if CONFIG_OPENER_SNTP_CLOCK
+  if(SntpClockIsSynchronized() ) {
+    const int64_t utc_us = SntpClockFromLocalTime(entry->timestamp);
+    const time_t seconds = (time_t)(utc_us / 1000000);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    AppendFormatted(&line, "[%04d-%02d-%02dT%02d:%02d:%02d.%06luZ] C%u ",
+                    utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday,
+                    utc.tm_hour, utc.tm_min, utc.tm_sec,
+                    (unsigned long)(utc_us % 1000000),
+                    (unsigned)entry->core);
+  } else
+#endif
+  AppendFormatted(&line, "[%lu.%06lu] C%u ",
+                  (unsigned long)(entry->timestamp / 1000000),
+                  (unsigned long)(entry->timestamp % 1000000),
+                  (unsigned)entry->core);
+
+  const char *position = entry->format;
+  size_t read = 0;
+  TraceConversion conversion;
+  bool complete = true;
+  while(FindConversion(position, &conversion) ) {
+    AppendLiteral(&line, position, conversion.start);
+    position = conversion.end;
+    if(!AppendConversion(&line, entry, &read, &conversion) ) {
+      complete = false;
+      break;
+    }
+  }
+  if(complete) {
+    AppendLiteral(&line, position, position + strlen(position) );
+  } else {
+    AppendFormatted(&line, "...");
+  }
+
+  if('\n' != text[line.length - 1]) {
+    if(line.length + 1 >= line.capacity) {
+      line.length--;
+    }
+    text[line.length++] = '\n';
+    text[line.length] = '\0';
+  }
+  return line.length;
+}
+
+void TraceBufferCursorInit(TraceBufferCursor *const cursor,
+                           const bool from_oldest) {
+  cursor->lost = 0;
+  for(size_t i = 0; i < TRACE_BUFFER_NUMBER_OF_RINGS; ++i) {
+    const uint32_t head = atomic_load_explicit(&s_rings[i].head,
+                                               memory_order_acquire);
+    if(!from_oldest) {
+      cursor->next[i] = head;
+    } else {
+      cursor->next[i] = (head > TRACE_BUFFER_ENTRIES) ?
+                        head - TRACE_BUFFER_ENTRIES : 0;
+    }
+  }
+}
+
+size_t TraceBufferRead(TraceBufferCursor *const cursor,
+                       char *const text,
+                       const size_t size) {
+  char line[TRACE_BUFFER_LINE_LENGTH];
+  TraceBufferEntry oldest;
+  TraceBufferEntry candidate;
+  size_t length = 0;
+
+  if(0 == size) {
+    return 0;
+  }
+  text[0] = '\0';
+  for(;; ) {
+    size_t oldest_ring = TRACE_BUFFER_NUMBER_OF_RINGS;
+    for(size_t i = 0; i < TRACE_BUFFER_NUMBER_OF_RINGS; ++i) {
+      SkipLostEntries(cursor, i);
+      TraceEntryState state;
+      while(kTraceEntryOverwritten ==
+            (state = ReadEntry(&s_rings[i], cursor->next[i], &candidate) ) ) {
+        cursor->next[i]++;
+        cursor->lost++;
+      }
+      if(kTraceEntryReady == state &&
+         (TRACE_BUFFER_NUMBER_OF_RINGS == oldest_ring ||
+          candidate.timestamp < oldest.timestamp) ) {
+        oldest = candidate;
+        oldest_ring = i;
+      }
+    }
+    if(TRACE_BUFFER_NUMBER_OF_RINGS == oldest_ring) {
+      break; /* nothing new */
+    }
+
+    size_t line_length = FormatEntry(&oldest, line, sizeof(line) );
+    if(length + line_length >= size) {
+      if(0 != length) {
+        break; /* keep the entry for the next call */
+      }
+      line_length = size - 1;
+    }
+    memcpy(&text[length], line, line_length);
+    length += line_length;
+    text[length] = '\0';
+    cursor->next[oldest_ring]++;
+  }
+  return length;
+}
+
+#if defined(CONFIG_OPENER_TRACE_BUFFER_CONSOLE)
+static TaskHandle_t s_console_task = NULL;
+
+static void TraceBufferConsoleTask(void *argument) {
+  (void) argument;
+  static char text[1024];
+  TraceBufferCursor cursor;
+  uint32_t reported_lost = 0;
+
+  TraceBufferCursorInit(&cursor, true);
+  for(;; ) {
+    size_t length = 0;
+    while(0 != (length = TraceBufferRead(&cursor, text, sizeof(text) ) ) ) {
+      fwrite(text, 1, length, stderr);
+    }
+    if(reported_lost != cursor.lost) {
+      fprintf(stderr, "trace: %" PRIu32 " entries lost\n",
+              cursor.lost - reported_lost);
+      reported_lost = cursor.lost;
+    }
+    vTaskDelay(pdMS_TO_TICKS(TRACE_BUFFER_DRAIN_PERIOD_MS) );
+  }
+}
+#endif /* CONFIG_OPENER_TRACE_BUFFER_CONSOLE */
+
+void TraceBufferInitialize(void) {
+#if defined(CONFIG_OPENER_TRACE_BUFFER_CONSOLE)
+  if(NULL != s_console_task) {
+    return;
+  }
+  if(pdPASS != xTaskCreatePinnedToCore(TraceBufferConsoleTask,
+                                       "OpENer trace",
+                                       TRACE_BUFFER_STACK_SIZE,
+                                       NULL,
+                                       TRACE_BUFFER_TASK_PRIO,
+                                       &s_console_task,
+                                       tskNO_AFFINITY) ) {
+    s_console_task = NULL;
+    fprintf(stderr, "trace: failed to create the console task\n");
+  }
+#endif
+}
+
+#else /* OPENER_TRACE_BUFFER */
+
+void TraceBufferInitialize(void) {
+}
+
+void TraceBufferCursorInit(TraceBufferCursor *const cursor,
+                           const bool from_oldest) {
+  (void) from_oldest;
+  memset(cursor, 0, sizeof(*cursor) );
+}
+
+size_t TraceBufferRead(TraceBufferCursor *const cursor,
+                       char *const text,
+                       const size_t size) {
+  (void) cursor;
+  if(0 != size) {
+    text[0] = '\0';
+  }
+  return 0;
+}
+
+#endif /* OPENER_TRACE_BUFFER */
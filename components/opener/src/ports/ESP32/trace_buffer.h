@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_TRACE_BUFFER_H_
+#define OPENER_TRACE_BUFFER_H_
+
+/** @file trace_buffer.h
+ *  @brief Binary trace backend for the OPENER_TRACE_* macros
+ *
+ *  Selected with CONFIG_OPENER_TRACE_BUFFER. LOG_TRACE() does not format the
+ *  message but records the address of the format string, a timestamp and the
+ *  raw arguments in a fixed-size ring buffer of the calling core. Writers
+ *  reserve their entry with an atomic increment and never block, so tracing
+ *  from the I/O paths costs a few microseconds. When a ring is full the
+ *  oldest entries are overwritten.
+ *
+ *  Strings passed for %s are copied into the entry, truncated to the space
+ *  left in it. The format string itself has to stay valid, which holds for
+ *  the string literals used with the trace macros.
+ *
+ *  Messages are formatted only when read: by a low priority task that prints
+ *  them on the console (CONFIG_OPENER_TRACE_BUFFER_CONSOLE) and by the web
+ *  UI's GET /api/trace download. Every reader has its own cursor and does not
+ *  remove entries from the rings.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Number of cores with a ring of their own */
+#define TRACE_BUFFER_NUMBER_OF_RINGS 2
+
+/** @brief Read position of one reader in all rings */
+typedef struct {
+  uint32_t next[TRACE_BUFFER_NUMBER_OF_RINGS]; /**< next entry index per ring */
+  uint32_t lost; /**< entries overwritten before this reader got them */
+} TraceBufferCursor;
+
+/** @brief Start the task printing traces on the console
+ *
+ * Recording works without it, entries are kept from the first trace on. Safe
+ * to call more than once.
+ */
+void TraceBufferInitialize(void);
+
+/** @brief Record a trace message, the LOG_TRACE() of this backend
+ *
+ * May be called from any task or interrupt on either core.
+ *
+ * @param format printf format string, has to stay valid
+ */
+void TraceBufferRecord(const char *format,
+                       ...) __attribute__( (format(printf, 1, 2) ) );
+
+/** @brief Position a cursor
+ *
+ * @param cursor cursor to set
+ * @param from_oldest true to start at the oldest entry still held, false to
+ *        start after the newest one
+ */
+void TraceBufferCursorInit(TraceBufferCursor *const cursor,
+                           const bool from_oldest);
+
+/** @brief Format the next entries as text lines
+ *
+ * Entries of both rings are returned in timestamp order, each as
+ * "[seconds.microseconds] C<core> message" with the time since boot, or
+ * with CONFIG_OPENER_SNTP_CLOCK once it is set as
+ * "[YYYY-MM-DDThh:mm:ss.uuuuuuZ] C<core> message". Only whole lines are
+ * written; a line longer than the buffer is truncated.
+ *
+ * @param cursor cursor of the reader, advanced past the returned entries
+ * @param text receives the NUL terminated lines
+ * @param size size of text
+ * @return number of characters written, 0 if there are no new entries
+ */
+size_t TraceBufferRead(TraceBufferCursor *const cursor,
+                       char *const text,
+                       const size_t size);
+
+#endif /* OPENER_TRACE_BUFFER_H_ */
@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "trace_event.h"
+
+#if OPENER_TRACE_EVENTS
+
+#include <stdbool.h>
+
+#include "SEGGER_SYSVIEW.h"
+
+/* Module descriptions in the SystemView syntax, at most
+ * SEGGER_SYSVIEW_MAX_STRING_LEN characters each */
+static const char *const kTraceEventDescriptions[kTraceEventNumberOfEvents] = {
+  "0 ConnOpen serial=%u o_t_rpi_us=%u t_o_rpi_us=%u",
+  "1 ConnClose serial=%u",
+  "2 ConnTimeout serial=%u",
+  "3 Produce serial=%u seq=%u",
+  "4 Consume serial=%u seq=%u",
+  "5 Request service=%u length=%u serial=%u | Status=%u",
+  "6 NvCommit sections=%u | Error=%u",
+  "7 I2C expanders=%u | Error=%u",
+};
+
+static const CipUsint kTraceEventParameters[kTraceEventNumberOfEvents] = {
+  3, 1, 1, 2, 2, 3, 1, 1,
+};
+
+static void TraceEventSendDescriptions(void);
+
+static SEGGER_SYSVIEW_MODULE s_module = {
+  .sModule = "M=OpENer",
+  .NumEvents = kTraceEventNumberOfEvents,
+  .EventOffset = 0,
+  .pfSendModuleDesc = TraceEventSendDescriptions,
+  .pNext = NULL,
+};
+
+/* EventOffset is only valid once the module is registered */
+static volatile bool s_registered = false;
+
+/* Called by SystemView whenever a recorder connects */
+static void TraceEventSendDescriptions(void) {
+  for(size_t i = 0; i < kTraceEventNumberOfEvents; ++i) {
+    SEGGER_SYSVIEW_RecordModuleDescription(&s_module,
+                                           kTraceEventDescriptions[i]);
+  }
+}
+
+void TraceEventInitialize(void) {
+  if(s_registered) {
+    return;
+  }
+  SEGGER_SYSVIEW_RegisterModule(&s_module);
+  s_registered = true;
+}
+
+void TraceEventRecord(const TraceEvent event,
+                      const CipUdint parameter_0,
+                      const CipUdint parameter_1,
+                      const CipUdint parameter_2) {
+  if(!s_registered) {
+    return;
+  }
+  const unsigned id = s_module.EventOffset + (unsigned) event;
+  switch(kTraceEventParameters[event]) {
+    case 1:
+      SEGGER_SYSVIEW_RecordU32(id, parameter_0);
+      break;
+    case 2:
+      SEGGER_SYSVIEW_RecordU32x2(id, parameter_0, parameter_1);
+      break;
+    default:
+      SEGGER_SYSVIEW_RecordU32x3(id, parameter_0, parameter_1, parameter_2);
+      break;
+  }
+}
+
+void TraceEventRecordEnd(const TraceEvent event,
+                         const CipUdint result) {
+  if(!s_registered) {
+    return;
+  }
+  SEGGER_SYSVIEW_RecordEndCallU32(s_module.EventOffset + (unsigned) event,
+                                  result);
+}
+
+#endif /* OPENER_TRACE_EVENTS */
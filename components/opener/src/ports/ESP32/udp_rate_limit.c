@@ -0,0 +1,143 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "udp_rate_limit.h"
+
+#if CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "generic_networkhandler.h"
+#include "esp_timer.h"
+#include "lwip/def.h"
+#include "lwip/ip.h"
+#include "lwip/ip4_addr.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+
+/* Sources with a bucket of their own */
+#define UDP_RATE_LIMIT_SOURCES 8U
+
+/* Tokens are kept in millionths, one datagram costs a full token and a
+ * rate of r per second adds r millionths per microsecond */
+#define UDP_RATE_LIMIT_TOKEN 1000000ULL
+#define UDP_RATE_LIMIT_DEPTH(rate) \
+  ( ( (uint64_t) (rate) / 4U + 1U) * UDP_RATE_LIMIT_TOKEN)
+
+typedef struct {
+  uint64_t tokens;
+  int64_t updated; /**< esp_timer time of the last refill */
+} UdpRateLimitBucket;
+
+typedef struct {
+  uint32_t address; /**< network byte order, 0 for a free entry */
+  UdpRateLimitBucket bucket;
+} UdpRateLimitSource;
+
+/* Only used by the tcpip thread, the counters are read by the web UI */
+static UdpRateLimitBucket s_global_bucket = {
+  .tokens = UDP_RATE_LIMIT_DEPTH(CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT),
+};
+static UdpRateLimitSource s_sources[UDP_RATE_LIMIT_SOURCES];
+static volatile uint32_t s_dropped_global = 0;
+static volatile uint32_t s_dropped_source = 0;
+
+/* Refills the bucket for the time passed and takes a token if there is one */
+static bool UdpRateLimitTake(UdpRateLimitBucket *const bucket,
+                             const uint32_t rate,
+                             const int64_t now) {
+  const uint64_t depth = UDP_RATE_LIMIT_DEPTH(rate);
+  const uint64_t elapsed = (uint64_t) (now - bucket->updated);
+  bucket->updated = now;
+  if(elapsed >= depth / rate) {
+    bucket->tokens = depth;
+  } else {
+    bucket->tokens += elapsed * rate;
+    if(bucket->tokens > depth) {
+      bucket->tokens = depth;
+    }
+  }
+  if(bucket->tokens < UDP_RATE_LIMIT_TOKEN) {
+    return false;
+  }
+  bucket->tokens -= UDP_RATE_LIMIT_TOKEN;
+  return true;
+}
+
+/* The bucket of a source; a new source takes a free entry, else the one
+ * longest quiet */
+static UdpRateLimitBucket *UdpRateLimitSourceBucket(const uint32_t address,
+                                                    const int64_t now) {
+  UdpRateLimitSource *replaced = NULL;
+  for(size_t i = 0; i < UDP_RATE_LIMIT_SOURCES; ++i) {
+    UdpRateLimitSource *const source = &s_sources[i];
+    if(address == source->address) {
+      return &source->bucket;
+    }
+    if(NULL == replaced ||
+       (0 != replaced->address &&
+        (0 == source->address ||
+         source->bucket.updated < replaced->bucket.updated) ) ) {
+      replaced = source;
+    }
+  }
+  replaced->address = address;
+  replaced->bucket.tokens =
+    UDP_RATE_LIMIT_DEPTH(CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT_PER_SOURCE);
+  replaced->bucket.updated = now;
+  return &replaced->bucket;
+}
+
+int lwip_hook_ip4_input(struct pbuf *pbuf, struct netif *input_netif) {
+  (void) input_netif;
+  if(pbuf->len < IP_HLEN) {
+    return 0;
+  }
+  const struct ip_hdr *ip_header = pbuf->payload;
+  const u16_t header_length = IPH_HL_BYTES(ip_header);
+  if(IP_PROTO_UDP != IPH_PROTO(ip_header) ||
+     pbuf->len < header_length + UDP_HLEN ||
+     0 != (lwip_ntohs(IPH_OFFSET(ip_header) ) & IP_OFFMASK) ) {
+    return 0;
+  }
+  const struct udp_hdr *udp_header =
+    (const struct udp_hdr *) ( (const u8_t *) ip_header + header_length);
+  if(PP_HTONS(kOpenerEthernetPort) != udp_header->dest) {
+    return 0;
+  }
+
+  const int64_t now = esp_timer_get_time();
+  /* the source bucket first, a flooding source must not use up the
+   * tokens of the others */
+  UdpRateLimitBucket *const source_bucket =
+    UdpRateLimitSourceBucket(ip4_addr_get_u32(&ip_header->src), now);
+  if(!UdpRateLimitTake(source_bucket,
+                       CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT_PER_SOURCE, now) ) {
+    s_dropped_source++;
+  } else if(!UdpRateLimitTake(&s_global_bucket,
+                              CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT, now) ) {
+    s_dropped_global++;
+  } else {
+    return 0;
+  }
+  NetworkHandlerDiscardedIoMessages(kNetworkDropRateLimited, 1);
+  pbuf_free(pbuf);
+  return 1;
+}
+
+void UdpRateLimitGetStatistics(UdpRateLimitStatistics *const statistics) {
+  statistics->dropped_global = s_dropped_global;
+  statistics->dropped_source = s_dropped_source;
+  statistics->sources = 0;
+  for(size_t i = 0; i < UDP_RATE_LIMIT_SOURCES; ++i) {
+    if(0 != s_sources[i].address) {
+      statistics->sources++;
+    }
+  }
+}
+
+#endif /* CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT */
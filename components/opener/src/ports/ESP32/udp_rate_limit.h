@@ -0,0 +1,61 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_UDP_RATE_LIMIT_H_
+#define OPENER_UDP_RATE_LIMIT_H_
+
+/** @file udp_rate_limit.h
+ *  @brief Token buckets for UDP port 44818 datagrams in front of lwIP UDP
+ *
+ *  ListIdentity, ListServices and the other datagrams to UDP port 44818
+ *  are answered by the OpENer task, the same task that produces I/O. A
+ *  tool sweeping in a loop or a broadcast storm during switch maintenance
+ *  would keep it replying instead of producing.
+ *
+ *  LWIP_HOOK_IP4_INPUT checks every of these datagrams in the tcpip
+ *  thread, before lwIP looks for the socket. A token bucket per source
+ *  address and one for all sources allow CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT_PER_SOURCE
+ *  and CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT datagrams per second, with a
+ *  burst of a quarter second. Datagrams without a token are dropped and
+ *  counted as rate_limited, which is part of the In Discards counter.
+ *
+ *  The sources seen last are kept, a new source takes the place of the
+ *  one longest quiet. Many spoofed sources are still bounded by the
+ *  global bucket.
+ *
+ *  Other broadcast traffic never reaches the OpENer task. With
+ *  CONFIG_OPENER_IO_EARLY_DEMUX, CONFIG_OPENER_BROADCAST_RATE_LIMIT limits
+ *  it before the tcpip mailbox.
+ */
+
+#include "typedefs.h"
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+/** @brief Datagrams dropped since boot */
+typedef struct {
+  CipUdint dropped_global; /**< no token left in the bucket of all sources */
+  CipUdint dropped_source; /**< no token left in the bucket of the source */
+  CipUdint sources; /**< sources currently tracked */
+} UdpRateLimitStatistics;
+
+/** @brief LWIP_HOOK_IP4_INPUT, drops datagrams above the limits
+ *
+ *  @param pbuf received datagram positioned at the IP header
+ *  @param input_netif receiving netif
+ *  @return 1 if the datagram was dropped and freed, 0 to pass it on
+ */
+int lwip_hook_ip4_input(struct pbuf *pbuf, struct netif *input_netif);
+
+/** @brief Read the counters, safe from any task */
+void UdpRateLimitGetStatistics(UdpRateLimitStatistics *const statistics);
+
+#endif /* CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT */
+
+#endif /* OPENER_UDP_RATE_LIMIT_H_ */
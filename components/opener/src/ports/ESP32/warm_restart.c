@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "warm_restart.h"
+
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_WARM_RESTART
+
+#include <string.h>
+
+#include "opener_user_conf.h"
+#include "trace.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+
+/* "OWRS" and the layout of WarmRestartBlock, a block of another layout is
+ * not taken */
+#define WARM_RESTART_MAGIC   0x5352574FUL
+#define WARM_RESTART_VERSION 1U
+
+typedef struct {
+  CipUdint magic;
+  CipUdint version;
+  CipUdint ip_address; /**< network byte order, 0 if none */
+  CipUdint application_valid;
+  CipOctet application[WARM_RESTART_APPLICATION_SIZE];
+  CipUdint crc; /**< of all members above */
+} WarmRestartBlock;
+
+/* Not initialized at start up, survives every reset but power-on */
+static RTC_NOINIT_ATTR WarmRestartBlock s_block;
+
+/* What the last boot left, taken by WarmRestartInitialize() */
+static WarmRestartBlock s_taken;
+static bool s_warm = false;
+
+static portMUX_TYPE s_block_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static CipUdint WarmRestartCrc(const WarmRestartBlock *const block) {
+  return esp_rom_crc32_le(0, (const uint8_t *) block,
+                          offsetof(WarmRestartBlock, crc) );
+}
+
+/* Resets of the firmware gone wrong, the outputs were driven up to it */
+static bool WarmRestartReason(const esp_reset_reason_t reason) {
+  switch(reason) {
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void WarmRestartInitialize(void) {
+  const esp_reset_reason_t reason = esp_reset_reason();
+  if(WarmRestartReason(reason) && WARM_RESTART_MAGIC == s_block.magic &&
+     WARM_RESTART_VERSION == s_block.version &&
+     WarmRestartCrc(&s_block) == s_block.crc) {
+    s_taken = s_block;
+    s_warm = true;
+    OPENER_TRACE_INFO("Warm restart after reset reason %d\n", (int) reason);
+  }
+
+  /* From here on the block describes this boot */
+  memset(&s_block, 0, sizeof(s_block) );
+  s_block.magic = WARM_RESTART_MAGIC;
+  s_block.version = WARM_RESTART_VERSION;
+  s_block.crc = WarmRestartCrc(&s_block);
+}
+
+bool WarmRestartIsWarm(void) {
+  return s_warm;
+}
+
+bool WarmRestartGetApplication(void *const data, const size_t size) {
+  OPENER_ASSERT(size <= WARM_RESTART_APPLICATION_SIZE);
+  if(!s_warm || !s_taken.application_valid) {
+    return false;
+  }
+  memcpy(data, s_taken.application, size);
+  return true;
+}
+
+void WarmRestartSetApplication(const size_t offset, const void *const data,
+                               const size_t size) {
+  OPENER_ASSERT(offset + size <= WARM_RESTART_APPLICATION_SIZE);
+  taskENTER_CRITICAL(&s_block_lock);
+  memcpy(s_block.application + offset, data, size);
+  s_block.application_valid = 1U;
+  s_block.crc = WarmRestartCrc(&s_block);
+  taskEXIT_CRITICAL(&s_block_lock);
+}
+
+CipUdint WarmRestartGetAddress(void) {
+  return s_warm ? s_taken.ip_address : 0;
+}
+
+void WarmRestartSetAddress(const CipUdint ip_address) {
+  taskENTER_CRITICAL(&s_block_lock);
+  s_block.ip_address = ip_address;
+  s_block.crc = WarmRestartCrc(&s_block);
+  taskEXIT_CRITICAL(&s_block_lock);
+}
+
+#endif /* CONFIG_OPENER_WARM_RESTART */
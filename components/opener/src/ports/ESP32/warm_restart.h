@@ -0,0 +1,76 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_WARM_RESTART_H_
+#define OPENER_WARM_RESTART_H_
+
+/** @file warm_restart.h
+ *  @brief State kept in RTC slow memory across a watchdog or panic reset
+ *
+ *  With CONFIG_OPENER_WARM_RESTART a small block in RTC_NOINIT memory
+ *  holds the state needed to come back bumpless: an application area, for
+ *  the KC868-A16 the relay image and the fault actions in effect, and the
+ *  IP address in use. Every update rewrites its CRC. RTC slow memory keeps
+ *  its content through every reset except power-on, so at start up the
+ *  block is taken only after a panic or a watchdog reset and with a valid
+ *  CRC; after power-on, a brownout or a deliberate esp_restart() the device
+ *  starts cold as before.
+ *
+ *  Updates are plain stores under a spinlock, cheap enough for the I/O scan
+ *  task, and may come from any task, not from an interrupt.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "typedefs.h"
+
+/** Size of the application area */
+#define WARM_RESTART_APPLICATION_SIZE 32U
+
+/** @brief Check the reset reason and the block, once, before any update
+ *
+ *  Called by app_main first thing. Without a warm restart the block is
+ *  cleared, so the state of an earlier boot is never taken.
+ */
+void WarmRestartInitialize(void);
+
+/** @brief Whether this boot is a warm restart with a valid block */
+bool WarmRestartIsWarm(void);
+
+/** @brief Copy the application area saved before the reset
+ *
+ *  @param data receives size bytes
+ *  @param size at most WARM_RESTART_APPLICATION_SIZE
+ *  @return false without a warm restart or if the application never saved
+ *          its area
+ */
+bool WarmRestartGetApplication(void *const data, const size_t size);
+
+/** @brief Save part of the application area for the next warm restart
+ *
+ *  Writers of different parts do not need to serialize. The area counts
+ *  as saved after the first call.
+ *
+ *  @param offset of the part in the area
+ *  @param data size bytes of state
+ *  @param size offset + size at most WARM_RESTART_APPLICATION_SIZE
+ */
+void WarmRestartSetApplication(const size_t offset, const void *const data,
+                               const size_t size);
+
+/** @brief IP address in use when the reset happened
+ *
+ *  @return network byte order, 0 without a warm restart or an address
+ */
+CipUdint WarmRestartGetAddress(void);
+
+/** @brief Record the IP address in use, 0 when it is lost or in conflict
+ *
+ *  @param ip_address network byte order
+ */
+void WarmRestartSetAddress(const CipUdint ip_address);
+
+#endif /* OPENER_WARM_RESTART_H_ */
@@ -0,0 +1,228 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "wcet_profile.h"
+
+#if OPENER_WCET_PROFILE
+
+#include <string.h>
+
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "endianconv.h"
+#include "opener_api.h"
+#include "trace.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+
+/* Entries per Read And Reset reply, 16 bytes each fit the reply buffer */
+#define WCET_PROFILE_ENTRIES_PER_REPLY 24U
+
+/* Entries are appended and keep kind, code and class once published by
+ * s_number_of_entries, so lookups read them without the lock. Counts and
+ * captures change under s_lock only. */
+static WcetProfileEntry s_entries[OPENER_WCET_PROFILE_ENTRIES];
+static size_t s_number_of_entries;
+static CipUdint s_dropped; /**< calls of entries that found no room */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+CipUdint WcetProfileGetCycleCount(void) {
+  return (CipUdint)esp_cpu_get_cycle_count();
+}
+
+CipUdint WcetProfileGetCyclesPerMicroSecond(void) {
+  return esp_rom_get_cpu_ticks_per_us();
+}
+
+static WcetProfileEntry *FindEntry(const size_t number_of_entries,
+                                   const WcetProfileKind kind,
+                                   const CipUint class_id,
+                                   const CipUsint code) {
+  for(size_t i = 0; i < number_of_entries; ++i) {
+    WcetProfileEntry *const entry = &s_entries[i];
+    if(kind == entry->kind && code == entry->code &&
+       class_id == entry->class_id) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+void WcetProfileRecord(const WcetProfileKind kind,
+                       const CipUint class_id,
+                       const CipUsint code,
+                       const char *const name,
+                       const CipUint instance,
+                       const CipUint attribute,
+                       const CipUdint cycles) {
+  WcetProfileEntry *entry = FindEntry(
+    __atomic_load_n(&s_number_of_entries, __ATOMIC_ACQUIRE),
+    kind, class_id, code);
+
+  portENTER_CRITICAL(&s_lock);
+  if(NULL == entry) {
+    /* Another task may have added it since the lookup */
+    entry = FindEntry(s_number_of_entries, kind, class_id, code);
+  }
+  if(NULL == entry) {
+    if(s_number_of_entries >= OPENER_WCET_PROFILE_ENTRIES) {
+      s_dropped++;
+      portEXIT_CRITICAL(&s_lock);
+      return;
+    }
+    entry = &s_entries[s_number_of_entries];
+    memset(entry, 0, sizeof(*entry) );
+    entry->kind = (CipUsint)kind;
+    entry->code = code;
+    entry->class_id = class_id;
+    __atomic_store_n(&s_number_of_entries, s_number_of_entries + 1,
+                     __ATOMIC_RELEASE);
+  }
+  if(NULL == entry->name) {
+    entry->name = name;
+  }
+  entry->calls++;
+  if(cycles >= entry->maximum) {
+    entry->maximum = cycles;
+    entry->instance = instance;
+    entry->attribute = attribute;
+  }
+  portEXIT_CRITICAL(&s_lock);
+}
+
+size_t WcetProfileGetNumberOfEntries(void) {
+  return __atomic_load_n(&s_number_of_entries, __ATOMIC_ACQUIRE);
+}
+
+CipUdint WcetProfileGetDropped(void) {
+  return __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+}
+
+size_t WcetProfileGetEntries(const size_t first,
+                             WcetProfileEntry *const entries,
+                             const size_t count,
+                             const bool reset) {
+  size_t copied = 0;
+  portENTER_CRITICAL(&s_lock);
+  for(size_t i = first; i < s_number_of_entries && copied < count; ++i) {
+    entries[copied++] = s_entries[i];
+    if(reset) {
+      s_entries[i].calls = 0;
+      s_entries[i].maximum = 0;
+      s_entries[i].instance = 0;
+      s_entries[i].attribute = 0;
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+  return copied;
+}
+
+static void EncodeWcetProfileNumberOfEntries(const void *const data,
+                                             ENIPMessage *const outgoing_message)
+{
+  (void) data;
+  AddIntToMessage( (EipUint16) WcetProfileGetNumberOfEntries(),
+                   outgoing_message );
+}
+
+static void EncodeWcetProfileDropped(const void *const data,
+                                     ENIPMessage *const outgoing_message) {
+  (void) data;
+  AddDintToMessage(WcetProfileGetDropped(), outgoing_message);
+}
+
+static EipStatus WcetProfileReadAndReset(
+  CipInstance *const instance,
+  CipMessageRouterRequest *const message_router_request,
+  CipMessageRouterResponse *const message_router_response,
+  const struct sockaddr *originator_address,
+  const CipSessionHandle encapsulation_session) {
+  (void) instance;
+  (void) originator_address;
+  (void) encapsulation_session;
+
+  ClearENIPMessage(&message_router_response->message);
+  message_router_response->reply_service =
+    (0x80 | message_router_request->service);
+  message_router_response->size_of_additional_status = 0;
+  if(message_router_request->request_data_size < 2) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
+  if(message_router_request->request_data_size > 2) {
+    message_router_response->general_status = kCipErrorTooMuchData;
+    return kEipStatusOkSend;
+  }
+  const CipOctet *data = message_router_request->data;
+  const CipUint first = GetUintFromMessage(&data);
+
+  WcetProfileEntry entries[WCET_PROFILE_ENTRIES_PER_REPLY];
+  const size_t count = WcetProfileGetEntries(first, entries,
+                                             WCET_PROFILE_ENTRIES_PER_REPLY,
+                                             true);
+  ENIPMessage *const message = &message_router_response->message;
+  AddIntToMessage( (EipUint16) WcetProfileGetNumberOfEntries(), message );
+  AddIntToMessage( (EipUint16) count, message );
+  for(size_t i = 0; i < count; ++i) {
+    AddSintToMessage(entries[i].kind, message);
+    AddSintToMessage(entries[i].code, message);
+    AddIntToMessage(entries[i].class_id, message);
+    AddIntToMessage(entries[i].instance, message);
+    AddIntToMessage(entries[i].attribute, message);
+    AddDintToMessage(entries[i].calls, message);
+    AddDintToMessage(entries[i].maximum, message);
+  }
+  message_router_response->general_status = kCipErrorSuccess;
+  return kEipStatusOkSend;
+}
+
+EipStatus WcetProfileCreateCipObject(void) {
+  CipClass *profile_class = NULL;
+
+  if( ( profile_class = CreateCipClass(kWcetProfileClassCode,
+                                       7, /* # class attributes */
+                                       7, /* # highest class attribute number */
+                                       2, /* # class services */
+                                       2, /* # instance attributes */
+                                       2, /* # highest instance attribute number */
+                                       3, /* # instance services */
+                                       1, /* # instances */
+                                       "WCET Profile",
+                                       1, /* # class revision */
+                                       NULL /* # function pointer for initialization */
+                                       ) ) == 0 ) {
+    OPENER_TRACE_ERR("WCET profile: failed to create the CIP object\n");
+    return kEipStatusError;
+  }
+
+  CipInstance *instance = GetCipInstance(profile_class, 1);
+  InsertAttribute(instance,
+                  1,
+                  kCipUint,
+                  EncodeWcetProfileNumberOfEntries,
+                  NULL,
+                  s_entries,
+                  kGetableSingleAndAll);
+  InsertAttribute(instance,
+                  2,
+                  kCipUdint,
+                  EncodeWcetProfileDropped,
+                  NULL,
+                  &s_dropped,
+                  kGetableSingleAndAll);
+
+  InsertService(profile_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(profile_class, kGetAttributeAll, &GetAttributeAll,
+                "GetAttributeAll");
+  InsertService(profile_class, kWcetProfileReadAndResetService,
+                &WcetProfileReadAndReset, "ReadAndReset");
+
+  return kEipStatusOk;
+}
+
+#endif /* OPENER_WCET_PROFILE */
@@ -0,0 +1,29 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#include <stdlib.h>
+
+#include "benchmark.h"
+#include "opener_api.h"
+#include "doublylinkedlist.h"
+#include "cipconnectionobject.h"
+#include "encap.h"
+
+/** Runs the microbenchmarks on the initialized stack, without any sockets */
+int main(void) {
+  DoublyLinkedListInitialize(&connection_list,
+                             CipConnectionObjectListArrayAllocator,
+                             CipConnectionObjectListArrayFree);
+
+  if (kEipStatusOk != CipStackInit(1) ) {
+    return EXIT_FAILURE;
+  }
+  /* Done by NetworkHandlerInitialize() otherwise, marks all sessions free */
+  EncapsulationInit();
+
+  BenchmarkRunAll();
+  ShutdownCipStack();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "generic_networkhandler.h"
+#include "opener_api.h"
+#include "cipcommon.h"
+#include "cipethernetlink.h"
+#include "ciptcpipinterface.h"
+#include "trace.h"
+#include "networkconfig.h"
+#include "doublylinkedlist.h"
+#include "cipconnectionobject.h"
+#include "nvdata.h"
+
+/** Cleared by SIGINT / SIGTERM to leave the network handler loop */
+volatile int g_end_stack = 0;
+
+static void LeaveStack(int signal) {
+  (void) signal;
+  g_end_stack = 1;
+}
+
+int main(int argc,
+         char *argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <network interface>\n", argv[0]);
+    fprintf(stderr, "e.g. %s eth0\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  const char *const iface = argv[1];
+
+  if (!IfaceLinkIsUp(iface) ) {
+    fprintf(stderr, "Network interface %s is not up\n", iface);
+    return EXIT_FAILURE;
+  }
+
+  DoublyLinkedListInitialize(&connection_list,
+                             CipConnectionObjectListArrayAllocator,
+                             CipConnectionObjectListArrayFree);
+
+  uint8_t iface_mac[6];
+  if (kEipStatusOk != IfaceGetMacAddress(iface, iface_mac) ) {
+    fprintf(stderr, "Cannot read the MAC address of %s\n", iface);
+    return EXIT_FAILURE;
+  }
+
+  SetDeviceSerialNumber(123456789);
+
+  /* Seed the connection IDs differently on every start */
+  EipUint16 unique_connection_id = (EipUint16)(GetMicroSeconds() & 0xFFFF);
+
+  if (kEipStatusOk != CipStackInit(unique_connection_id) ) {
+    fprintf(stderr, "CipStackInit failed\n");
+    return EXIT_FAILURE;
+  }
+
+  CipClass *tcp_ip_class = GetCipClass(kCipTcpIpInterfaceClassCode);
+  if (NULL != tcp_ip_class) {
+    InsertGetSetCallback(tcp_ip_class, NvTcpipSetCallback, kNvDataFunc);
+  }
+
+  CipEthernetLinkSetMac(iface_mac);
+
+  GetHostName(&g_tcpip.hostname);
+
+  if (kEipStatusOk != IfaceGetConfiguration(iface,
+                                            &g_tcpip.interface_configuration) )
+  {
+    OPENER_TRACE_WARN("Problems getting interface configuration\n");
+  }
+
+  if (kEipStatusOk != NetworkHandlerInitialize() ) {
+    fprintf(stderr, "NetworkHandlerInitialize failed\n");
+    ShutdownCipStack();
+    return EXIT_FAILURE;
+  }
+
+  struct sigaction action = { .sa_handler = LeaveStack };
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  fprintf(stderr, "OpENer running on %s, Ctrl-C to stop\n", iface);
+  while (!g_end_stack) {
+    if (kEipStatusOk != NetworkHandlerProcessCyclic() ) {
+      OPENER_TRACE_ERR("Error in NetworkHandler loop! Exiting OpENer!\n");
+      break;
+    }
+  }
+
+  NetworkHandlerFinish();
+  ShutdownCipStack();
+  return EXIT_SUCCESS;
+}
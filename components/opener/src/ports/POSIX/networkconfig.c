@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include "cipstring.h"
+#include "networkconfig.h"
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "trace.h"
+#include "opener_api.h"
+
+/* Run one SIOCGIF* request for the interface on a throw-away socket */
+static EipStatus IfaceIoctl(TcpIpInterface *iface,
+                            const unsigned long request,
+                            struct ifreq *const ifr) {
+  memset(ifr, 0, sizeof(*ifr) );
+  strncpy(ifr->ifr_name, iface, sizeof(ifr->ifr_name) - 1);
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    return kEipStatusError;
+  }
+  int result = ioctl(fd, request, ifr);
+  close(fd);
+  if (result < 0) {
+    OPENER_TRACE_ERR("ioctl(0x%lx) on %s failed\n", request, iface);
+    return kEipStatusError;
+  }
+  return kEipStatusOk;
+}
+
+bool IfaceLinkIsUp(TcpIpInterface *iface) {
+  struct ifreq ifr;
+  if (kEipStatusOk != IfaceIoctl(iface, SIOCGIFFLAGS, &ifr) ) {
+    return false;
+  }
+  return (ifr.ifr_flags & IFF_UP) && (ifr.ifr_flags & IFF_RUNNING);
+}
+
+EipStatus IfaceGetMacAddress(TcpIpInterface *iface,
+                             uint8_t *const physical_address) {
+  struct ifreq ifr;
+  EipStatus status = IfaceIoctl(iface, SIOCGIFHWADDR, &ifr);
+  if (kEipStatusOk == status) {
+    memcpy(physical_address, ifr.ifr_hwaddr.sa_data, 6);
+  }
+  return status;
+}
+
+static EipStatus GetIpAndNetmaskFromInterface(
+    TcpIpInterface *iface, CipTcpIpInterfaceConfiguration *iface_cfg) {
+  struct ifreq ifr;
+
+  if (kEipStatusOk != IfaceIoctl(iface, SIOCGIFADDR, &ifr) ) {
+    return kEipStatusError;
+  }
+  iface_cfg->ip_address =
+    ( (struct sockaddr_in *)&ifr.ifr_addr)->sin_addr.s_addr;
+
+  if (kEipStatusOk != IfaceIoctl(iface, SIOCGIFNETMASK, &ifr) ) {
+    return kEipStatusError;
+  }
+  iface_cfg->network_mask =
+    ( (struct sockaddr_in *)&ifr.ifr_netmask)->sin_addr.s_addr;
+
+  return kEipStatusOk;
+}
+
+/* The default route of the interface, 0 if it has none */
+static EipStatus GetGatewayFromRoute(TcpIpInterface *iface,
+                                     CipTcpIpInterfaceConfiguration *iface_cfg) {
+  FILE *file = fopen("/proc/net/route", "r");
+  if (NULL == file) {
+    OPENER_TRACE_WARN("Cannot open /proc/net/route\n");
+    return kEipStatusOk;
+  }
+
+  char line[256];
+  char name[IFNAMSIZ + 1];
+  unsigned long destination;
+  unsigned long gateway;
+  iface_cfg->gateway = 0;
+  while (NULL != fgets(line, sizeof(line), file) ) {
+    /* Values are hex numbers in network byte order */
+    if (3 == sscanf(line, "%16s %lx %lx", name, &destination, &gateway) &&
+        0 == strcmp(name, iface) && 0 == destination) {
+      iface_cfg->gateway = (CipUdint)gateway;
+      break;
+    }
+  }
+  fclose(file);
+  return kEipStatusOk;
+}
+
+EipStatus IfaceGetConfiguration(TcpIpInterface *iface,
+                                CipTcpIpInterfaceConfiguration *iface_cfg) {
+  CipTcpIpInterfaceConfiguration local_cfg;
+  EipStatus status;
+
+  memset(&local_cfg, 0x00, sizeof local_cfg);
+
+  status = GetIpAndNetmaskFromInterface(iface, &local_cfg);
+  if (kEipStatusOk == status) {
+    status = GetGatewayFromRoute(iface, &local_cfg);
+  }
+  if (kEipStatusOk == status) {
+    *iface_cfg = local_cfg;
+  }
+  return status;
+}
+
+void GetHostName(CipTcpIpHostName *hostname) {
+  char name[HOST_NAME_MAX + 1];
+
+  if (0 != gethostname(name, sizeof(name) ) ) {
+    return;
+  }
+  name[sizeof(name) - 1] = '\0';
+  (void) CIP_STRING_FIXED_SET_BY_CSTR(hostname, name);
+}
@@ -0,0 +1,21 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_POSIX_NETWORKCONFIG_H_
+#define OPENER_POSIX_NETWORKCONFIG_H_
+
+#include <stdbool.h>
+
+#include "opener_api.h"
+
+/** @brief Check the IFF_RUNNING flag of an interface
+ *
+ * @param iface name of the interface, e.g. "eth0"
+ * @return true if the interface is up and has a carrier
+ */
+bool IfaceLinkIsUp(TcpIpInterface *iface);
+
+#endif /* OPENER_POSIX_NETWORKCONFIG_H_ */
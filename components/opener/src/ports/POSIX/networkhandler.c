@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <sys/socket.h>
+
+#include "networkhandler.h"
+
+#include "opener_error.h"
+#include "trace.h"
+#include "encap.h"
+#include "opener_user_conf.h"
+
+MicroSeconds GetMicroSeconds(void) {
+  struct timespec now = { .tv_nsec = 0, .tv_sec = 0 };
+
+  int error = clock_gettime(CLOCK_MONOTONIC, &now);
+  OPENER_ASSERT(-1 != error);
+  (void) error; /* without assertions */
+  return (MicroSeconds) now.tv_nsec / 1000ULL +
+         (MicroSeconds) now.tv_sec * 1000000ULL;
+}
+
+MilliSeconds GetMilliSeconds(void) {
+  return (MilliSeconds) (GetMicroSeconds() / 1000ULL);
+}
+
+EipStatus NetworkHandlerInitializePlatform(void) {
+  /* Nothing to do, the sockets API needs no set up on Linux */
+  return kEipStatusOk;
+}
+
+void NetworkHandlerEnterStack(void) {
+  /* Single threaded, no other task touches the stack */
+}
+
+void NetworkHandlerLeaveStack(void) {
+}
+
+void GetIoPacketProcessingTime(CipUdint *const production_time,
+                               CipUdint *const consumption_time) {
+  /* not measured, only the packet rate budget applies */
+  *production_time = 0;
+  *consumption_time = 0;
+}
+
+void IoConnectionOriginatorChanged(
+  const struct sockaddr_in *const originator_address,
+  const bool established) {
+  /* the host's ARP cache is left to the operating system */
+  (void) originator_address;
+  (void) established;
+}
+
+void ShutdownSocketPlatform(int socket_handle) {
+  if (0 != shutdown(socket_handle, SHUT_RDWR)) {
+    int error_code = GetSocketErrorNumber();
+    char *error_message = GetErrorMessage(error_code);
+    OPENER_TRACE_ERR("Failed shutdown() socket %d - Error Code: %d - %s\n",
+                     socket_handle,
+                     error_code,
+                     error_message);
+    FreeErrorMessage(error_message);
+  }
+}
+
+void CloseSocketPlatform(int socket_handle) {
+  close(socket_handle);
+}
+
+int SetSocketToNonBlocking(int socket_handle) {
+  return fcntl(socket_handle, F_SETFL, fcntl(socket_handle,
+                                             F_GETFL,
+                                             0) | O_NONBLOCK);
+}
+
+int SetQosOnSocket(const int socket,
+                   CipUsint qos_value) {
+  /* The DSCP value is the upper six bits of the TOS byte */
+  int set_tos = qos_value << 2;
+  return setsockopt(socket, IPPROTO_IP, IP_TOS, &set_tos, sizeof(set_tos));
+}
@@ -0,0 +1,31 @@
+/*******************************************************************************
+ * Copyright (c) 2019, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+/** @file POSIX/nvtcpip.c
+ *  @brief TCP/IP object NV data of the host build
+ *
+ *  The host adapter always takes its configuration from the Linux interface,
+ *  nothing is persisted. Replaces ports/nvdata/nvtcpip.c, which stores to
+ *  the ESP32 NVS.
+ */
+#include "nvtcpip.h"
+
+#include "trace.h"
+
+EipStatus NvTcpipLoad(CipTcpIpObject *p_tcp_ip) {
+  (void) p_tcp_ip;
+  return kEipStatusError; /* nothing stored, use the interface defaults */
+}
+
+EipStatus NvTcpipStore(const CipTcpIpObject *p_tcp_ip) {
+  (void) p_tcp_ip;
+  OPENER_TRACE_INFO("NvTcpipStore: not persisted on the host build\n");
+  return kEipStatusOk;
+}
+
+EipStatus NvTcpipStoreDeferred(void) {
+  return NvTcpipStore(&g_tcpip);
+}
@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+/* Host test of the overload governor against the timer driven productions of
+ * the connection manager. The stack runs on a virtual clock (-Wl,--wrap) and
+ * ManageConnectionTimers() is called every timer tick, as the network handler
+ * does; a production sends nothing. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opener_api.h"
+#include "cipconnectionmanager.h"
+#include "cipconnectionobject.h"
+#include "doublylinkedlist.h"
+#include "encap.h"
+#include "overload_governor.h"
+
+#define OVERLOAD_TEST_CLOCK_START_US 1000000U
+#define OVERLOAD_TEST_DURATION_MS    30000U
+
+static MicroSeconds s_clock_us = OVERLOAD_TEST_CLOCK_START_US;
+
+MicroSeconds __wrap_GetMicroSeconds(void) {
+  return s_clock_us;
+}
+
+MilliSeconds __wrap_GetMilliSeconds(void) {
+  return (MilliSeconds) (s_clock_us / 1000U);
+}
+
+static EipStatus OverloadTestSend(CipConnectionObject *connection_object) {
+  (void) connection_object;
+  return kEipStatusOk;
+}
+
+/** The connections are static, closing them only drops them from the lists */
+static void OverloadTestClose(CipConnectionObject *connection_object) {
+  (void) connection_object;
+}
+
+/** Open a cyclic class 1 producing connection with the given T->O RPI */
+static void OverloadTestOpenConnection(CipConnectionObject *const connection,
+                                       const CipUdint rpi_us) {
+  memset(connection, 0, sizeof(*connection) );
+  connection->socket[kUdpCommuncationDirectionConsuming] = kEipInvalidSocket;
+  /* never used as a socket, a production only calls OverloadTestSend() */
+  connection->socket[kUdpCommuncationDirectionProducing] = 0;
+  connection->transport_class_trigger = 0x01; /* client, cyclic, class 1 */
+  connection->t_to_o_requested_packet_interval = rpi_us;
+  ConnectionObjectSetExpectedPacketRate(connection);
+  connection->connection_send_data_function = OverloadTestSend;
+  connection->connection_close_function = OverloadTestClose;
+  connection->transmission_trigger_timer = s_clock_us;
+  AddNewActiveConnection(connection);
+}
+
+/** Run the timer ticks for a while, stalling every stall_every-th one */
+static void OverloadTestRun(const MilliSeconds duration_ms,
+                            const unsigned int stall_every,
+                            const MilliSeconds stall_ms) {
+  for(MilliSeconds elapsed = 0; elapsed < duration_ms;
+      elapsed += kOpenerTimerTickInMilliSeconds) {
+    s_clock_us += (MicroSeconds) kOpenerTimerTickInMilliSeconds * 1000U;
+    if(0 != stall_every &&
+       0 == (elapsed / kOpenerTimerTickInMilliSeconds) % stall_every) {
+      s_clock_us += (MicroSeconds) stall_ms * 1000U;
+    }
+    ManageConnectionTimers();
+    OverloadGovernorEvaluate(__wrap_GetMilliSeconds() );
+  }
+}
+
+static int OverloadTestCheck(const char *const name,
+                             const OverloadStage expected_stage) {
+  OverloadGovernorStatistics statistics;
+  OverloadGovernorGetStatistics(&statistics);
+  CipUdint productions = 0;
+  CipUdint late_productions = 0;
+  ConnectionManagerGetProductionCounts(&productions, &late_productions);
+  const bool passed = expected_stage == statistics.highest_stage;
+  printf("%s %s: highest stage %s, %" PRIu32 " of %" PRIu32
+         " productions late\n", passed ? "PASS" : "FAIL", name,
+         OverloadGovernorGetStageName(
+           (OverloadStage) statistics.highest_stage), late_productions,
+         productions);
+  return passed ? 0 : 1;
+}
+
+int main(void) {
+  DoublyLinkedListInitialize(&connection_list,
+                             CipConnectionObjectListArrayAllocator,
+                             CipConnectionObjectListArrayFree);
+
+  if(kEipStatusOk != CipStackInit(1) ) {
+    return EXIT_FAILURE;
+  }
+  /* Done by NetworkHandlerInitialize() otherwise, marks all sessions free */
+  EncapsulationInit();
+
+  int failures = 0;
+  static CipConnectionObject fast_connection;
+  OverloadTestOpenConnection(&fast_connection,
+                             kOpenerTimerTickInMilliSeconds * 1000U / 2U);
+  OverloadTestRun(OVERLOAD_TEST_DURATION_MS, 0, 0);
+  failures += OverloadTestCheck("RPI below the tick without load",
+                                kOverloadStageNone);
+
+  /* Every second tick stalls by five ticks: more than a tenth late */
+  OverloadTestRun(OVERLOAD_TEST_DURATION_MS, 2,
+                  5U * kOpenerTimerTickInMilliSeconds);
+  failures += OverloadTestCheck("stalled timer ticks",
+                                kOverloadStageSessions);
+
+  ShutdownCipStack();
+  return 0 == failures ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,375 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "pcap_reader.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#define PCAP_MAGIC_MICROSECONDS 0xA1B2C3D4U
+#define PCAP_MAGIC_NANOSECONDS  0xA1B23C4DU
+#define PCAPNG_SECTION_HEADER   0x0A0D0D0AU
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4DU
+
+#define PCAPNG_INTERFACE_DESCRIPTION 0x00000001U
+#define PCAPNG_PACKET                0x00000002U /* obsolete */
+#define PCAPNG_SIMPLE_PACKET         0x00000003U
+#define PCAPNG_ENHANCED_PACKET       0x00000006U
+#define PCAPNG_OPTION_TSRESOL        9U
+
+#define LINKTYPE_NULL          0U
+#define LINKTYPE_ETHERNET      1U
+#define LINKTYPE_RAW           101U
+#define LINKTYPE_LOOP          108U
+#define LINKTYPE_LINUX_SLL     113U
+#define LINKTYPE_IPV4          228U
+#define LINKTYPE_LINUX_SLL2    276U
+
+#define ETHERTYPE_IPV4 0x0800U
+#define ETHERTYPE_VLAN 0x8100U
+#define ETHERTYPE_QINQ 0x88A8U
+
+/* No capture of EtherNet/IP needs more, larger records are damaged */
+#define PCAP_READER_MAX_RECORD (16U * 1024U * 1024U)
+
+static uint16_t Get16(const PcapReader *const reader,
+                      const uint8_t *const data) {
+  return reader->swapped ? (uint16_t)(data[0] << 8 | data[1]) :
+         (uint16_t)(data[1] << 8 | data[0]);
+}
+
+static uint32_t Get32(const PcapReader *const reader,
+                      const uint8_t *const data) {
+  const uint32_t value = (uint32_t)data[0] | (uint32_t)data[1] << 8 |
+                         (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+  return reader->swapped ? __builtin_bswap32(value) : value;
+}
+
+static uint16_t GetBig16(const uint8_t *const data) {
+  return (uint16_t)(data[0] << 8 | data[1]);
+}
+
+static uint32_t GetBig32(const uint8_t *const data) {
+  return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+         (uint32_t)data[2] << 8 | (uint32_t)data[3];
+}
+
+static bool ReadBytes(PcapReader *const reader, const size_t length) {
+  if (length > reader->buffer_size) {
+    uint8_t *const buffer = realloc(reader->buffer, length);
+    if (NULL == buffer) {
+      return false;
+    }
+    reader->buffer = buffer;
+    reader->buffer_size = length;
+  }
+  return 1 == fread(reader->buffer, length, 1, reader->file);
+}
+
+static uint64_t ToMicroSeconds(const uint64_t timestamp,
+                               const uint64_t units_per_second) {
+  return (uint64_t)( (unsigned __int128)timestamp * 1000000U /
+                     units_per_second );
+}
+
+/* Strip the link and IP headers, false for anything but IPv4 TCP or UDP */
+static bool DecodeFrame(PcapReader *const reader,
+                        const uint32_t link_type,
+                        const uint8_t *data,
+                        size_t length,
+                        PcapPacket *const packet) {
+  switch (link_type) {
+    case LINKTYPE_ETHERNET: {
+      if (length < 14) {
+        return false;
+      }
+      uint16_t ethertype = GetBig16(data + 12);
+      data += 14;
+      length -= 14;
+      while ( (ETHERTYPE_VLAN == ethertype || ETHERTYPE_QINQ == ethertype) &&
+              length >= 4 ) {
+        ethertype = GetBig16(data + 2);
+        data += 4;
+        length -= 4;
+      }
+      if (ETHERTYPE_IPV4 != ethertype) {
+        return false;
+      }
+      break;
+    }
+    case LINKTYPE_LINUX_SLL:
+      if (length < 16 || ETHERTYPE_IPV4 != GetBig16(data + 14) ) {
+        return false;
+      }
+      data += 16;
+      length -= 16;
+      break;
+    case LINKTYPE_LINUX_SLL2:
+      if (length < 20 || ETHERTYPE_IPV4 != GetBig16(data) ) {
+        return false;
+      }
+      data += 20;
+      length -= 20;
+      break;
+    case LINKTYPE_NULL:
+    case LINKTYPE_LOOP:
+      /* AF_INET is 2 everywhere, in the byte order of the capturing host */
+      if (length < 4 ||
+          (2U != GetBig32(data) && 2U != __builtin_bswap32(GetBig32(data) ) ) )
+      {
+        return false;
+      }
+      data += 4;
+      length -= 4;
+      break;
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+      break;
+    default:
+      return false;
+  }
+
+  if (length < 20 || 4U != (data[0] >> 4) ) {
+    return false;
+  }
+  const size_t ip_header_length = (size_t)(data[0] & 0x0FU) * 4U;
+  const size_t ip_total_length = GetBig16(data + 2);
+  /* more fragments or a fragment offset */
+  if (0 != (GetBig16(data + 6) & 0x3FFFU) ) {
+    return false;
+  }
+  if (ip_header_length < 20 || ip_total_length < ip_header_length) {
+    return false;
+  }
+  if (ip_total_length > length) {
+    reader->truncated_frames++;
+    return false;
+  }
+  packet->protocol = data[9];
+  packet->source_address = GetBig32(data + 12);
+  packet->destination_address = GetBig32(data + 16);
+  data += ip_header_length;
+  length = ip_total_length - ip_header_length; /* drops Ethernet padding */
+
+  if (IPPROTO_TCP == packet->protocol) {
+    if (length < 20) {
+      return false;
+    }
+    const size_t tcp_header_length = (size_t)(data[12] >> 4) * 4U;
+    if (tcp_header_length < 20 || tcp_header_length > length) {
+      return false;
+    }
+    packet->tcp_sequence = GetBig32(data + 4);
+    packet->tcp_flags = data[13];
+    packet->source_port = GetBig16(data);
+    packet->destination_port = GetBig16(data + 2);
+    packet->payload = data + tcp_header_length;
+    packet->payload_length = length - tcp_header_length;
+    return true;
+  }
+  if (IPPROTO_UDP == packet->protocol) {
+    if (length < 8) {
+      return false;
+    }
+    packet->tcp_sequence = 0;
+    packet->tcp_flags = 0;
+    packet->source_port = GetBig16(data);
+    packet->destination_port = GetBig16(data + 2);
+    packet->payload = data + 8;
+    packet->payload_length = length - 8;
+    return true;
+  }
+  return false;
+}
+
+bool PcapReaderOpen(PcapReader *const reader, const char *const path) {
+  memset(reader, 0, sizeof(*reader) );
+  reader->file = fopen(path, "rb");
+  if (NULL == reader->file) {
+    return false;
+  }
+  uint8_t header[24];
+  if (1 != fread(header, sizeof(header), 1, reader->file) ) {
+    PcapReaderClose(reader);
+    return false;
+  }
+  const uint32_t magic = (uint32_t)header[0] | (uint32_t)header[1] << 8 |
+                         (uint32_t)header[2] << 16 |
+                         (uint32_t)header[3] << 24;
+  if (PCAPNG_SECTION_HEADER == magic) {
+    /* The section header is read again as a block by PcapReaderNext() */
+    reader->pcapng = true;
+    rewind(reader->file);
+    return true;
+  }
+  uint64_t units_per_second = 0;
+  if (PCAP_MAGIC_MICROSECONDS == magic ||
+      PCAP_MAGIC_MICROSECONDS == __builtin_bswap32(magic) ) {
+    units_per_second = 1000000U;
+  } else if (PCAP_MAGIC_NANOSECONDS == magic ||
+             PCAP_MAGIC_NANOSECONDS == __builtin_bswap32(magic) ) {
+    units_per_second = 1000000000U;
+  } else {
+    PcapReaderClose(reader);
+    return false;
+  }
+  reader->swapped = PCAP_MAGIC_MICROSECONDS != magic &&
+                    PCAP_MAGIC_NANOSECONDS != magic;
+  reader->link_types[0] = Get32(reader, header + 20) & 0x0FFFFFFFU;
+  reader->units_per_second[0] = units_per_second;
+  reader->interface_count = 1;
+  return true;
+}
+
+static int NextPcapRecord(PcapReader *const reader, PcapPacket *const packet) {
+  uint8_t header[16];
+  for (;; ) {
+    if (1 != fread(header, sizeof(header), 1, reader->file) ) {
+      return feof(reader->file) ? 0 : -1;
+    }
+    const uint32_t captured_length = Get32(reader, header + 8);
+    if (captured_length > PCAP_READER_MAX_RECORD ||
+        !ReadBytes(reader, captured_length) ) {
+      return -1;
+    }
+    if (captured_length < Get32(reader, header + 12) ) {
+      reader->truncated_frames++;
+    }
+    const uint64_t fraction = Get32(reader, header + 4);
+    packet->time_us = (uint64_t)Get32(reader, header) * 1000000U +
+                      ToMicroSeconds(fraction, reader->units_per_second[0]);
+    if (DecodeFrame(reader, reader->link_types[0], reader->buffer,
+                    captured_length, packet) ) {
+      return 1;
+    }
+    reader->skipped_frames++;
+  }
+}
+
+static void ReadInterfaceDescription(PcapReader *const reader,
+                                     const uint8_t *const body,
+                                     const size_t length) {
+  if (length < 8 || reader->interface_count >= PCAP_READER_MAX_INTERFACES) {
+    return;
+  }
+  const size_t index = reader->interface_count++;
+  reader->link_types[index] = Get16(reader, body);
+  reader->units_per_second[index] = 1000000U;
+  size_t offset = 8;
+  while (offset + 4 <= length) {
+    const uint16_t code = Get16(reader, body + offset);
+    const uint16_t option_length = Get16(reader, body + offset + 2);
+    offset += 4;
+    if (0 == code || offset + option_length > length) {
+      break;
+    }
+    if (PCAPNG_OPTION_TSRESOL == code && option_length >= 1) {
+      const uint8_t resolution = body[offset];
+      uint64_t units = 1;
+      if (resolution & 0x80U) {
+        units <<= (resolution & 0x7FU) < 63U ? (resolution & 0x7FU) : 63U;
+      } else {
+        for (uint8_t i = 0; i < resolution && i < 19U; ++i) {
+          units *= 10U;
+        }
+      }
+      reader->units_per_second[index] = units;
+    }
+    offset += (option_length + 3U) & ~3U;
+  }
+}
+
+static int NextPcapngBlock(PcapReader *const reader, PcapPacket *const packet)
+{
+  uint8_t header[8];
+  for (;; ) {
+    if (1 != fread(header, sizeof(header), 1, reader->file) ) {
+      return feof(reader->file) ? 0 : -1;
+    }
+    uint32_t type = Get32(reader, header);
+    if (PCAPNG_SECTION_HEADER == type) {
+      /* A new section, its byte order follows in the body */
+      uint8_t byte_order[4];
+      if (1 != fread(byte_order, sizeof(byte_order), 1, reader->file) ) {
+        return -1;
+      }
+      reader->swapped = false;
+      if (PCAPNG_BYTE_ORDER_MAGIC != Get32(reader, byte_order) ) {
+        reader->swapped = true;
+        if (PCAPNG_BYTE_ORDER_MAGIC != Get32(reader, byte_order) ) {
+          return -1;
+        }
+      }
+      reader->interface_count = 0;
+      const uint32_t total_length = Get32(reader, header + 4);
+      if (total_length < 16 || total_length > PCAP_READER_MAX_RECORD ||
+          !ReadBytes(reader, total_length - 12) ) {
+        return -1;
+      }
+      continue;
+    }
+    const uint32_t total_length = Get32(reader, header + 4);
+    if (total_length < 12 || total_length > PCAP_READER_MAX_RECORD ||
+        !ReadBytes(reader, total_length - 8) ) {
+      return -1;
+    }
+    const uint8_t *const body = reader->buffer;
+    const size_t body_length = total_length - 12;
+    if (PCAPNG_INTERFACE_DESCRIPTION == type) {
+      ReadInterfaceDescription(reader, body, body_length);
+      continue;
+    }
+    if (PCAPNG_ENHANCED_PACKET == type || PCAPNG_PACKET == type) {
+      if (body_length < 20) {
+        return -1;
+      }
+      const uint32_t interface_id = PCAPNG_PACKET == type ?
+                                    Get16(reader, body) :
+                                    Get32(reader, body);
+      const uint32_t captured_length = Get32(reader, body + 12);
+      if (captured_length > body_length - 20) {
+        return -1;
+      }
+      if (captured_length < Get32(reader, body + 16) ) {
+        reader->truncated_frames++;
+      }
+      if (interface_id >= reader->interface_count) {
+        reader->skipped_frames++;
+        continue;
+      }
+      const uint64_t timestamp = (uint64_t)Get32(reader, body + 4) << 32 |
+                                 Get32(reader, body + 8);
+      packet->time_us = ToMicroSeconds(timestamp,
+                                       reader->units_per_second[interface_id]);
+      if (DecodeFrame(reader, reader->link_types[interface_id], body + 20,
+                      captured_length, packet) ) {
+        return 1;
+      }
+      reader->skipped_frames++;
+      continue;
+    }
+    /* simple packet blocks have no time and other blocks no packet */
+    if (PCAPNG_SIMPLE_PACKET == type) {
+      reader->skipped_frames++;
+    }
+  }
+}
+
+int PcapReaderNext(PcapReader *const reader, PcapPacket *const packet) {
+  return reader->pcapng ? NextPcapngBlock(reader, packet) :
+         NextPcapRecord(reader, packet);
+}
+
+void PcapReaderClose(PcapReader *const reader) {
+  if (NULL != reader->file) {
+    fclose(reader->file);
+    reader->file = NULL;
+  }
+  free(reader->buffer);
+  reader->buffer = NULL;
+  reader->buffer_size = 0;
+}
@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_PCAP_READER_H_
+#define OPENER_PCAP_READER_H_
+
+/** @file pcap_reader.h
+ *  @brief Minimal reader of libpcap and pcapng capture files
+ *
+ *  Returns the IPv4 TCP and UDP packets of a capture with their time, other
+ *  frames are skipped and counted. Ethernet (with VLAN tags), Linux cooked
+ *  (v1 and v2), BSD loopback and raw IP link types are understood. IP
+ *  fragments are skipped, EtherNet/IP does not fragment in practice.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PCAP_READER_MAX_INTERFACES 8
+
+/** @brief One TCP or UDP packet, addresses and ports in host byte order */
+typedef struct {
+  uint64_t time_us; /**< capture time, microseconds since the epoch */
+  uint8_t protocol; /**< IPPROTO_TCP or IPPROTO_UDP */
+  uint32_t source_address;
+  uint32_t destination_address;
+  uint16_t source_port;
+  uint16_t destination_port;
+  uint32_t tcp_sequence; /**< TCP only */
+  uint8_t tcp_flags; /**< TCP only */
+  const uint8_t *payload; /**< valid until the next PcapReaderNext() */
+  size_t payload_length;
+} PcapPacket;
+
+typedef struct {
+  FILE *file;
+  bool pcapng;
+  bool swapped; /**< file written with the other byte order */
+  uint32_t link_types[PCAP_READER_MAX_INTERFACES];
+  uint64_t units_per_second[PCAP_READER_MAX_INTERFACES];
+  size_t interface_count;
+  uint8_t *buffer;
+  size_t buffer_size;
+  size_t skipped_frames; /**< not IPv4 TCP or UDP */
+  size_t truncated_frames; /**< captured shorter than sent */
+} PcapReader;
+
+/** @brief Open a capture and read its file header
+ *
+ *  @return false if the file cannot be read or has no known format
+ */
+bool PcapReaderOpen(PcapReader *const reader, const char *const path);
+
+/** @brief Read the next TCP or UDP packet
+ *
+ *  @return 1 with a packet, 0 at the end of the file, -1 on a damaged file
+ */
+int PcapReaderNext(PcapReader *const reader, PcapPacket *const packet);
+
+void PcapReaderClose(PcapReader *const reader);
+
+#endif /* OPENER_PCAP_READER_H_ */
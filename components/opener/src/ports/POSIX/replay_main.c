@@ -0,0 +1,1394 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+/* Replays the EtherNet/IP traffic of a capture into the stack, without any
+ * network I/O. The explicit TCP sessions, UDP encapsulation requests and
+ * Class 1 O->T packets addressed to the recorded adapter are fed to the
+ * stack in capture order, each request is timed and every reply is compared
+ * with the one the adapter sent in the capture.
+ *
+ * The stack runs on a virtual clock that follows the capture time, and
+ * ManageConnections() is called every timer tick of it, so watchdogs, RPIs
+ * and the simulated analog ramp behave as in the capture at any replay
+ * speed. The sockets the stack would use are replaced at link time
+ * (-Wl,--wrap): T->O productions are counted instead of sent, and nothing
+ * ever leaves the host. */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "pcap_reader.h"
+#include "generic_networkhandler.h"
+#include "opener_api.h"
+#include "cipcommon.h"
+#include "cipconnectionobject.h"
+#include "ciptcpipinterface.h"
+#include "cpf.h"
+#include "doublylinkedlist.h"
+#include "encap.h"
+#include "enipmessage.h"
+#include "messagebufferpool.h"
+#include "trace.h"
+
+#define REPLAY_ENIP_PORT 44818U
+#define REPLAY_IO_PORT   2222U
+/* Stack time at the first packet, 0 is avoided as a time stamp */
+#define REPLAY_CLOCK_START_US 1000000U
+#define REPLAY_MAX_LABELS 64U
+#define REPLAY_DEFAULT_SHOWN_DIFFERENCES 10U
+#define REPLAY_SHOWN_BYTES 16U
+#define REPLAY_NONE SIZE_MAX
+
+/* Encapsulation commands, see encap.c */
+#define REPLAY_COMMAND_REGISTER_SESSION   0x0065U
+#define REPLAY_COMMAND_UNREGISTER_SESSION 0x0066U
+#define REPLAY_COMMAND_SEND_RR_DATA       0x006FU
+#define REPLAY_COMMAND_SEND_UNIT_DATA     0x0070U
+
+#define REPLAY_SERVICE_UNCONNECTED_SEND   0x52U
+#define REPLAY_SERVICE_FORWARD_OPEN       0x54U
+#define REPLAY_SERVICE_LARGE_FORWARD_OPEN 0x5BU
+#define REPLAY_SERVICE_REPLY              0x80U
+
+#define TCP_FLAG_FIN 0x01U
+#define TCP_FLAG_SYN 0x02U
+#define TCP_FLAG_RST 0x04U
+#define TCP_FLAG_ACK 0x10U
+
+typedef enum {
+  kReplayToDevice = 0,
+  kReplayFromDevice = 1,
+} ReplayDirection;
+
+typedef enum {
+  kReplayMessageTcp, /**< encapsulation request on a TCP session */
+  kReplayMessageUdp, /**< encapsulation request over UDP */
+  kReplayMessageIo, /**< Class 1 O->T packet */
+  kReplayMessageClose, /**< the client closed its TCP connection */
+} ReplayMessageKind;
+
+typedef enum {
+  kReplayResultNone, /**< no reply recorded and none produced */
+  kReplayResultSame,
+  kReplayResultDifferent,
+  kReplayResultMissing, /**< reply recorded, none produced */
+  kReplayResultExtra, /**< reply produced, none recorded */
+  kReplayResultSkipped, /**< the stack had closed the session */
+} ReplayResult;
+
+static const char *const kReplayResultNames[] = {
+  "none", "same", "different", "missing", "extra", "skipped",
+};
+
+typedef struct {
+  uint8_t *data;
+  size_t length;
+  size_t capacity;
+} ReplayBytes;
+
+/** A TCP connection or, for UDP, one client address and port */
+typedef struct {
+  bool udp;
+  uint32_t client_address;
+  uint16_t client_port;
+  uint32_t next_sequence[2];
+  bool synchronized[2];
+  bool close_recorded;
+  ReplayBytes pending[2]; /**< start of an incomplete frame */
+  size_t gaps; /**< segments missing from the capture */
+  size_t first_reply;
+  size_t last_reply;
+  size_t reply_cursor; /**< first reply not yet matched */
+  /* Replay state */
+  int socket;
+  bool closed; /**< closed by the stack */
+  CipUdint recorded_session;
+  CipUdint live_session;
+} ReplayStream;
+
+typedef struct {
+  ReplayMessageKind kind;
+  uint64_t time_us;
+  size_t stream;
+  size_t offset; /**< in s_arena */
+  size_t length;
+  size_t reply; /**< recorded reply, or REPLAY_NONE */
+  size_t label;
+  uint64_t processing_ns;
+  ReplayResult result;
+  size_t difference_offset;
+  size_t live_offset; /**< replayed reply of a shown difference */
+  size_t live_length;
+} ReplayMessage;
+
+typedef struct {
+  uint64_t time_us;
+  size_t offset;
+  size_t length;
+  size_t next_in_stream;
+  bool claimed;
+} ReplayReply;
+
+typedef struct {
+  CipUdint recorded_o2t;
+  CipUdint recorded_t2o;
+  CipUdint live_o2t;
+  CipUdint live_t2o;
+  bool opened; /**< a Forward_Open of it was replayed */
+  size_t o2t_packets;
+  size_t t2o_recorded;
+  size_t t2o_produced;
+} ReplayConnection;
+
+typedef struct {
+  char name[48];
+  uint64_t *samples; /**< processing times in ns */
+  size_t count;
+  size_t capacity;
+} ReplayLabel;
+
+/* Capture */
+static ReplayBytes s_arena;
+static ReplayStream *s_streams;
+static size_t s_stream_count;
+static size_t s_stream_capacity;
+static ReplayMessage *s_messages;
+static size_t s_message_count;
+static size_t s_message_capacity;
+static ReplayReply *s_replies;
+static size_t s_reply_count;
+static size_t s_reply_capacity;
+static ReplayConnection *s_connections;
+static size_t s_connection_count;
+static size_t s_connection_capacity;
+static ReplayLabel s_labels[REPLAY_MAX_LABELS];
+static size_t s_label_count;
+static uint32_t s_device_address;
+static bool s_device_known;
+static uint64_t s_first_time_us;
+static size_t s_packets_read;
+
+/* Replay */
+static MicroSeconds s_clock_us;
+static MicroSeconds s_next_tick_us;
+static size_t s_tick_label;
+static ENIPMessage s_response;
+static uint8_t s_request[PC_OPENER_ETHERNET_BUFFER_SIZE + 65535U];
+static int s_udp_socket = kEipInvalidSocket;
+static size_t s_unmatched_o2t;
+static size_t s_unmatched_t2o_produced;
+static uint64_t s_real_start_ns;
+
+/* Options */
+static double s_speed = 0.0;
+static size_t s_shown_differences = REPLAY_DEFAULT_SHOWN_DIFFERENCES;
+static const char *s_csv_path;
+
+static void ReplayFail(const char *const what) {
+  fprintf(stderr, "OpENer_replay: %s\n", what);
+  exit(EXIT_FAILURE);
+}
+
+static void Reserve(void **const items,
+                    size_t *const capacity,
+                    const size_t needed,
+                    const size_t item_size) {
+  if (needed <= *capacity) {
+    return;
+  }
+  size_t new_capacity = (0 != *capacity) ? *capacity : 64U;
+  while (new_capacity < needed) {
+    new_capacity *= 2U;
+  }
+  void *const grown = realloc(*items, new_capacity * item_size);
+  if (NULL == grown) {
+    ReplayFail("out of memory");
+  }
+  *items = grown;
+  *capacity = new_capacity;
+}
+
+static void AppendBytes(ReplayBytes *const bytes,
+                        const uint8_t *const data,
+                        const size_t length) {
+  if (0 == length) {
+    return;
+  }
+  Reserve( (void **)&bytes->data, &bytes->capacity, bytes->length + length,
+           1U );
+  memcpy(bytes->data + bytes->length, data, length);
+  bytes->length += length;
+}
+
+static uint16_t GetLe16(const uint8_t *const data) {
+  return (uint16_t)(data[0] | data[1] << 8);
+}
+
+static uint32_t GetLe32(const uint8_t *const data) {
+  return (uint32_t)data[0] | (uint32_t)data[1] << 8 |
+         (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static void PutLe32(uint8_t *const data, const uint32_t value) {
+  data[0] = (uint8_t)value;
+  data[1] = (uint8_t)(value >> 8);
+  data[2] = (uint8_t)(value >> 16);
+  data[3] = (uint8_t)(value >> 24);
+}
+
+static uint64_t RealTimeNs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec;
+}
+
+/* ---- Labels and statistics ---- */
+
+static size_t FindLabel(const char *const name) {
+  for (size_t i = 0; i < s_label_count; ++i) {
+    if (0 == strcmp(s_labels[i].name, name) ) {
+      return i;
+    }
+  }
+  if (s_label_count == REPLAY_MAX_LABELS) {
+    return REPLAY_MAX_LABELS - 1U; /* the last one collects the rest */
+  }
+  snprintf(s_labels[s_label_count].name, sizeof(s_labels[0].name), "%s",
+           name);
+  return s_label_count++;
+}
+
+static void AddSample(const size_t label, const uint64_t processing_ns) {
+  ReplayLabel *const entry = &s_labels[label];
+  Reserve( (void **)&entry->samples, &entry->capacity, entry->count + 1U,
+           sizeof(entry->samples[0]) );
+  entry->samples[entry->count++] = processing_ns;
+}
+
+static const char *ServiceName(const uint8_t service) {
+  switch (service) {
+    case 0x01: return "Get_Attributes_All";
+    case 0x02: return "Set_Attributes_All";
+    case 0x03: return "Get_Attribute_List";
+    case 0x04: return "Set_Attribute_List";
+    case 0x05: return "Reset";
+    case 0x0A: return "Multiple_Service_Packet";
+    case 0x0E: return "Get_Attribute_Single";
+    case 0x10: return "Set_Attribute_Single";
+    case 0x4B: return "Vendor 0x4B";
+    case 0x4E: return "Forward_Close";
+    case 0x52: return "Unconnected_Send";
+    case 0x54: return "Forward_Open";
+    case 0x5B: return "Large_Forward_Open";
+    default: return NULL;
+  }
+}
+
+static const char *CommandName(const uint16_t command) {
+  switch (command) {
+    case 0x0000: return "NOP";
+    case 0x0004: return "ListServices";
+    case 0x0063: return "ListIdentity";
+    case 0x0064: return "ListInterfaces";
+    case REPLAY_COMMAND_REGISTER_SESSION: return "RegisterSession";
+    case REPLAY_COMMAND_UNREGISTER_SESSION: return "UnRegisterSession";
+    case REPLAY_COMMAND_SEND_RR_DATA: return "SendRRData";
+    case REPLAY_COMMAND_SEND_UNIT_DATA: return "SendUnitData";
+    default: return NULL;
+  }
+}
+
+/* Finds a common packet format item of an encapsulation message */
+static const uint8_t *FindCpfItem(const uint8_t *const message,
+                                  const size_t length,
+                                  const uint16_t type,
+                                  size_t *const item_length) {
+  size_t offset = ENCAPSULATION_HEADER_LENGTH + 6U; /* handle, timeout */
+  if (offset + 2U > length) {
+    return NULL;
+  }
+  const uint16_t item_count = GetLe16(message + offset);
+  offset += 2U;
+  for (uint16_t i = 0; i < item_count && offset + 4U <= length; ++i) {
+    const uint16_t item_type = GetLe16(message + offset);
+    const size_t data_length = GetLe16(message + offset + 2U);
+    offset += 4U;
+    if (offset + data_length > length) {
+      return NULL;
+    }
+    if (item_type == type) {
+      *item_length = data_length;
+      return message + offset;
+    }
+    offset += data_length;
+  }
+  return NULL;
+}
+
+/* CIP service of a request, the embedded one of an Unconnected_Send */
+static bool RequestService(const uint8_t *const message,
+                           const size_t length,
+                           uint8_t *const service) {
+  const uint16_t command = GetLe16(message);
+  size_t data_length = 0;
+  if (REPLAY_COMMAND_SEND_RR_DATA == command) {
+    const uint8_t *const data = FindCpfItem(message, length,
+                                            kCipItemIdUnconnectedDataItem,
+                                            &data_length);
+    if (NULL == data || data_length < 1U) {
+      return false;
+    }
+    *service = data[0];
+    const size_t embedded = 2U + 2U * (data_length > 1U ? data[1] : 0U) + 4U;
+    if (REPLAY_SERVICE_UNCONNECTED_SEND == data[0] &&
+        embedded < data_length) {
+      *service = data[embedded];
+    }
+    return true;
+  }
+  if (REPLAY_COMMAND_SEND_UNIT_DATA == command) {
+    const uint8_t *const data = FindCpfItem(message, length,
+                                            kCipItemIdConnectedDataItem,
+                                            &data_length);
+    if (NULL == data || data_length < 3U) {
+      return false;
+    }
+    *service = data[2]; /* after the sequence count */
+    return true;
+  }
+  return false;
+}
+
+static size_t LabelMessage(const ReplayMessageKind kind,
+                           const uint8_t *const message,
+                           const size_t length) {
+  char name[sizeof(s_labels[0].name)];
+  if (kReplayMessageIo == kind) {
+    return FindLabel("Class 1 O->T");
+  }
+  if (kReplayMessageClose == kind) {
+    return FindLabel("TCP close");
+  }
+  const uint16_t command = GetLe16(message);
+  const char *const command_name = CommandName(command);
+  uint8_t service = 0;
+  if (NULL == command_name) {
+    snprintf(name, sizeof(name), "command 0x%04X", command);
+  } else if (RequestService(message, length, &service) ) {
+    const char *const service_name = ServiceName(service);
+    if (NULL != service_name) {
+      snprintf(name, sizeof(name), "%s %s", command_name, service_name);
+    } else {
+      snprintf(name, sizeof(name), "%s service 0x%02X", command_name,
+               service);
+    }
+  } else {
+    snprintf(name, sizeof(name), "%s%s", command_name,
+             kReplayMessageUdp == kind ? " (UDP)" : "");
+  }
+  return FindLabel(name);
+}
+
+/* ---- Loading the capture ---- */
+
+static size_t NewStream(const bool udp,
+                        const uint32_t address,
+                        const uint16_t port) {
+  Reserve( (void **)&s_streams, &s_stream_capacity, s_stream_count + 1U,
+           sizeof(s_streams[0]) );
+  ReplayStream *const stream = &s_streams[s_stream_count];
+  memset(stream, 0, sizeof(*stream) );
+  stream->udp = udp;
+  stream->client_address = address;
+  stream->client_port = port;
+  stream->first_reply = REPLAY_NONE;
+  stream->last_reply = REPLAY_NONE;
+  stream->reply_cursor = REPLAY_NONE;
+  stream->socket = kEipInvalidSocket;
+  return s_stream_count++;
+}
+
+static size_t FindStream(const bool udp,
+                         const uint32_t address,
+                         const uint16_t port,
+                         const bool create) {
+  /* The latest one, a client may reuse its port for a new connection */
+  for (size_t i = s_stream_count; i > 0; --i) {
+    const ReplayStream *const stream = &s_streams[i - 1U];
+    if (stream->udp == udp && stream->client_address == address &&
+        stream->client_port == port) {
+      return i - 1U;
+    }
+  }
+  return create ? NewStream(udp, address, port) : REPLAY_NONE;
+}
+
+static void AddMessage(const ReplayMessageKind kind,
+                       const size_t stream,
+                       const uint64_t time_us,
+                       const uint8_t *const data,
+                       const size_t length) {
+  Reserve( (void **)&s_messages, &s_message_capacity, s_message_count + 1U,
+           sizeof(s_messages[0]) );
+  ReplayMessage *const message = &s_messages[s_message_count++];
+  memset(message, 0, sizeof(*message) );
+  message->kind = kind;
+  message->stream = stream;
+  message->time_us = time_us;
+  message->offset = s_arena.length;
+  message->length = length;
+  message->reply = REPLAY_NONE;
+  message->label = LabelMessage(kind, data, length);
+  AppendBytes(&s_arena, data, length);
+}
+
+static void AddReply(const size_t stream_index,
+                     const uint64_t time_us,
+                     const uint8_t *const data,
+                     const size_t length) {
+  Reserve( (void **)&s_replies, &s_reply_capacity, s_reply_count + 1U,
+           sizeof(s_replies[0]) );
+  ReplayReply *const reply = &s_replies[s_reply_count];
+  reply->time_us = time_us;
+  reply->offset = s_arena.length;
+  reply->length = length;
+  reply->next_in_stream = REPLAY_NONE;
+  reply->claimed = false;
+  AppendBytes(&s_arena, data, length);
+
+  ReplayStream *const stream = &s_streams[stream_index];
+  if (REPLAY_NONE == stream->last_reply) {
+    stream->first_reply = s_reply_count;
+    stream->reply_cursor = s_reply_count;
+  } else {
+    s_replies[stream->last_reply].next_in_stream = s_reply_count;
+  }
+  stream->last_reply = s_reply_count++;
+}
+
+static ReplayConnection *FindConnection(const CipUdint id,
+                                        const bool live,
+                                        const bool t2o) {
+  for (size_t i = 0; i < s_connection_count; ++i) {
+    ReplayConnection *const connection = &s_connections[i];
+    const CipUdint candidate = live ?
+                               (t2o ? connection->live_t2o : connection->live_o2t) :
+                               (t2o ? connection->recorded_t2o :
+                                connection->recorded_o2t);
+    if (candidate == id && (!live || connection->opened) ) {
+      return connection;
+    }
+  }
+  return NULL;
+}
+
+static ReplayConnection *AddConnection(void) {
+  Reserve( (void **)&s_connections, &s_connection_capacity,
+           s_connection_count + 1U, sizeof(s_connections[0]) );
+  ReplayConnection *const connection = &s_connections[s_connection_count++];
+  memset(connection, 0, sizeof(*connection) );
+  return connection;
+}
+
+/* Splits a TCP byte stream into encapsulation messages */
+static void FrameStream(const size_t stream_index,
+                        const ReplayDirection direction,
+                        const uint64_t time_us) {
+  ReplayBytes *const pending = &s_streams[stream_index].pending[direction];
+  size_t consumed = 0;
+  while (pending->length - consumed >= ENCAPSULATION_HEADER_LENGTH) {
+    const uint8_t *const frame = pending->data + consumed;
+    const size_t length = ENCAPSULATION_HEADER_LENGTH + GetLe16(frame + 2);
+    if (pending->length - consumed < length) {
+      break;
+    }
+    if (kReplayToDevice == direction) {
+      AddMessage(kReplayMessageTcp, stream_index, time_us, frame, length);
+    } else {
+      AddReply(stream_index, time_us, frame, length);
+    }
+    consumed += length;
+  }
+  memmove(pending->data, pending->data + consumed, pending->length - consumed);
+  pending->length -= consumed;
+}
+
+static void TakeTcpSegment(const PcapPacket *const packet,
+                           const ReplayDirection direction) {
+  const uint32_t client_address = kReplayToDevice == direction ?
+                                  packet->source_address :
+                                  packet->destination_address;
+  const uint16_t client_port = kReplayToDevice == direction ?
+                               packet->source_port : packet->destination_port;
+  size_t stream_index = FindStream(false, client_address, client_port, true);
+  const bool syn = 0 != (packet->tcp_flags & TCP_FLAG_SYN);
+  if (syn && kReplayToDevice == direction &&
+      0 == (packet->tcp_flags & TCP_FLAG_ACK) ) {
+    /* A new connection on the port, unless the SYN is retransmitted */
+    const ReplayStream *const previous = &s_streams[stream_index];
+    if (previous->synchronized[direction] &&
+        previous->next_sequence[direction] != packet->tcp_sequence + 1U) {
+      stream_index = NewStream(false, client_address, client_port);
+    }
+  }
+  ReplayStream *const stream = &s_streams[stream_index];
+  if (syn) {
+    stream->next_sequence[direction] = packet->tcp_sequence + 1U;
+    stream->synchronized[direction] = true;
+    return;
+  }
+
+  const uint8_t *payload = packet->payload;
+  size_t length = packet->payload_length;
+  if (0 != length) {
+    if (!stream->synchronized[direction]) {
+      stream->next_sequence[direction] = packet->tcp_sequence;
+      stream->synchronized[direction] = true;
+    }
+    const int32_t ahead = (int32_t)(packet->tcp_sequence -
+                                    stream->next_sequence[direction]);
+    if (ahead > 0) {
+      /* Lost in the capture, the frame in progress cannot be completed */
+      stream->gaps++;
+      stream->pending[direction].length = 0;
+      stream->next_sequence[direction] = packet->tcp_sequence;
+    } else if (ahead < 0) {
+      const size_t repeated = (size_t)(-(int64_t)ahead);
+      if (repeated >= length) {
+        length = 0; /* retransmission */
+      } else {
+        payload += repeated;
+        length -= repeated;
+      }
+    }
+    if (0 != length) {
+      AppendBytes(&stream->pending[direction], payload, length);
+      stream->next_sequence[direction] += (uint32_t)length;
+      FrameStream(stream_index, direction, packet->time_us);
+    }
+  }
+  if (kReplayToDevice == direction && !stream->close_recorded &&
+      0 != (packet->tcp_flags & (TCP_FLAG_FIN | TCP_FLAG_RST) ) ) {
+    stream->close_recorded = true;
+    AddMessage(kReplayMessageClose, stream_index, packet->time_us, NULL, 0);
+  }
+}
+
+static bool IsRequestDestination(const uint32_t address) {
+  return address == s_device_address || 0xFFFFFFFFU == address ||
+         0xFFU == (address & 0xFFU);
+}
+
+static void TakePacket(const PcapPacket *const packet) {
+  if (IPPROTO_TCP == packet->protocol) {
+    if (REPLAY_ENIP_PORT == packet->destination_port &&
+        s_device_address == packet->destination_address) {
+      TakeTcpSegment(packet, kReplayToDevice);
+    } else if (REPLAY_ENIP_PORT == packet->source_port &&
+               s_device_address == packet->source_address) {
+      TakeTcpSegment(packet, kReplayFromDevice);
+    }
+    return;
+  }
+  if (REPLAY_ENIP_PORT == packet->destination_port &&
+      IsRequestDestination(packet->destination_address) &&
+      s_device_address != packet->source_address) {
+    if (packet->payload_length >= ENCAPSULATION_HEADER_LENGTH) {
+      AddMessage(kReplayMessageUdp,
+                 FindStream(true, packet->source_address,
+                            packet->source_port, true),
+                 packet->time_us, packet->payload, packet->payload_length);
+    }
+  } else if (REPLAY_ENIP_PORT == packet->source_port &&
+             s_device_address == packet->source_address) {
+    AddReply(FindStream(true, packet->destination_address,
+                        packet->destination_port, true),
+             packet->time_us, packet->payload, packet->payload_length);
+  } else if (REPLAY_IO_PORT == packet->destination_port &&
+             s_device_address == packet->destination_address) {
+    AddMessage(kReplayMessageIo,
+               FindStream(true, packet->source_address, packet->source_port,
+                          true),
+               packet->time_us, packet->payload, packet->payload_length);
+  } else if (REPLAY_IO_PORT == packet->source_port &&
+             s_device_address == packet->source_address &&
+             packet->payload_length >= 10U &&
+             kCipItemIdSequencedAddressItem == GetLe16(packet->payload + 2) ) {
+    const CipUdint t2o = GetLe32(packet->payload + 6);
+    ReplayConnection *connection = FindConnection(t2o, false, true);
+    if (NULL == connection) {
+      connection = AddConnection();
+      connection->recorded_t2o = t2o;
+    }
+    connection->t2o_recorded++;
+  }
+}
+
+/* Without --device, the adapter is the first one seen on TCP port 44818 */
+static bool FindDevice(const char *const path) {
+  PcapReader reader;
+  if (!PcapReaderOpen(&reader, path) ) {
+    return false;
+  }
+  PcapPacket packet;
+  int result = 0;
+  while (!s_device_known && 1 == (result = PcapReaderNext(&reader, &packet) ) )
+  {
+    if (IPPROTO_TCP != packet.protocol) {
+      continue;
+    }
+    if (REPLAY_ENIP_PORT == packet.destination_port) {
+      s_device_address = packet.destination_address;
+      s_device_known = true;
+    } else if (REPLAY_ENIP_PORT == packet.source_port) {
+      s_device_address = packet.source_address;
+      s_device_known = true;
+    }
+  }
+  PcapReaderClose(&reader);
+  return s_device_known;
+}
+
+static bool LoadCapture(const char *const path) {
+  PcapReader reader;
+  if (!PcapReaderOpen(&reader, path) ) {
+    fprintf(stderr, "OpENer_replay: cannot read %s as pcap or pcapng\n",
+            path);
+    return false;
+  }
+  PcapPacket packet;
+  int result = 0;
+  while (1 == (result = PcapReaderNext(&reader, &packet) ) ) {
+    if (0 == s_packets_read++) {
+      s_first_time_us = packet.time_us;
+    }
+    TakePacket(&packet);
+  }
+  if (result < 0) {
+    fprintf(stderr, "OpENer_replay: %s is damaged after %zu packets, "
+            "replaying those\n", path, s_packets_read);
+  }
+  if (0 != reader.truncated_frames) {
+    fprintf(stderr, "OpENer_replay: %zu frames were truncated by the "
+            "capture snap length\n", reader.truncated_frames);
+  }
+  PcapReaderClose(&reader);
+  return true;
+}
+
+/* Pairs every request with the next unmatched reply of the same command on
+ * its stream; UnRegisterSession has none */
+static void MatchReplies(void) {
+  for (size_t i = 0; i < s_message_count; ++i) {
+    ReplayMessage *const message = &s_messages[i];
+    if (kReplayMessageTcp != message->kind &&
+        kReplayMessageUdp != message->kind) {
+      continue;
+    }
+    const uint8_t *const request = s_arena.data + message->offset;
+    const uint16_t command = GetLe16(request);
+    if (REPLAY_COMMAND_UNREGISTER_SESSION == command) {
+      continue;
+    }
+    ReplayStream *const stream = &s_streams[message->stream];
+    /* older replies answered nothing of the capture */
+    while (REPLAY_NONE != stream->reply_cursor &&
+           (s_replies[stream->reply_cursor].claimed ||
+            s_replies[stream->reply_cursor].time_us < message->time_us) ) {
+      stream->reply_cursor = s_replies[stream->reply_cursor].next_in_stream;
+    }
+    for (size_t r = stream->reply_cursor; REPLAY_NONE != r;
+         r = s_replies[r].next_in_stream) {
+      ReplayReply *const reply = &s_replies[r];
+      if (!reply->claimed &&
+          GetLe16(s_arena.data + reply->offset) == command) {
+        reply->claimed = true;
+        message->reply = r;
+        break;
+      }
+    }
+  }
+}
+
+/* ---- Stack environment, replaced at link time ---- */
+
+MicroSeconds __wrap_GetMicroSeconds(void);
+MilliSeconds __wrap_GetMilliSeconds(void);
+int __wrap_CreateUdpSocket(void);
+EipStatus __wrap_SendUdpFrame(const struct sockaddr_in *const address,
+                              const CipUsint dscp,
+                              const EipUint8 *const header,
+                              const size_t header_length,
+                              const EipUint8 *const payload,
+                              const size_t payload_length);
+void __wrap_CloseTcpSocket(int socket_handle);
+int __wrap_getpeername(int socket_handle,
+                       struct sockaddr *address,
+                       socklen_t *address_length);
+int __real_getpeername(int socket_handle,
+                       struct sockaddr *address,
+                       socklen_t *address_length);
+
+MicroSeconds __wrap_GetMicroSeconds(void) {
+  return s_clock_us;
+}
+
+MilliSeconds __wrap_GetMilliSeconds(void) {
+  return (MilliSeconds)(s_clock_us / 1000U);
+}
+
+/* An unbound socket, the stack sends through SendUdpFrame() only */
+int __wrap_CreateUdpSocket(void) {
+  if (kEipInvalidSocket == g_network_status.udp_io_messaging) {
+    g_network_status.udp_io_messaging = socket(AF_INET, SOCK_DGRAM, 0);
+  }
+  return g_network_status.udp_io_messaging;
+}
+
+EipStatus __wrap_SendUdpFrame(const struct sockaddr_in *const address,
+                              const CipUsint dscp,
+                              const EipUint8 *const header,
+                              const size_t header_length,
+                              const EipUint8 *const payload,
+                              const size_t payload_length) {
+  (void)address;
+  (void)dscp;
+  (void)payload;
+  (void)payload_length;
+  if (header_length >= 10U &&
+      kCipItemIdSequencedAddressItem == GetLe16(header + 2) ) {
+    ReplayConnection *const connection =
+      FindConnection(GetLe32(header + 6), true, true);
+    if (NULL != connection) {
+      connection->t2o_produced++;
+    } else {
+      s_unmatched_t2o_produced++;
+    }
+  }
+  return kEipStatusOk;
+}
+
+static ReplayStream *StreamOfSocket(const int socket_handle) {
+  for (size_t i = 0; i < s_stream_count; ++i) {
+    if (!s_streams[i].udp && s_streams[i].socket == socket_handle) {
+      return &s_streams[i];
+    }
+  }
+  return NULL;
+}
+
+void __wrap_CloseTcpSocket(int socket_handle) {
+  ReplayStream *const stream = StreamOfSocket(socket_handle);
+  if (NULL != stream) {
+    stream->closed = true;
+    stream->socket = kEipInvalidSocket;
+  }
+  close(socket_handle);
+}
+
+/* The session sockets are not connected, their peer is the recorded client */
+int __wrap_getpeername(int socket_handle,
+                       struct sockaddr *address,
+                       socklen_t *address_length) {
+  const ReplayStream *const stream = StreamOfSocket(socket_handle);
+  if (NULL == stream || *address_length < sizeof(struct sockaddr_in) ) {
+    return __real_getpeername(socket_handle, address, address_length);
+  }
+  struct sockaddr_in peer = {
+    .sin_family = AF_INET,
+    .sin_port = htons(stream->client_port),
+    .sin_addr.s_addr = htonl(stream->client_address),
+  };
+  memcpy(address, &peer, sizeof(peer) );
+  *address_length = sizeof(peer);
+  return 0;
+}
+
+/* ---- Replay ---- */
+
+static void AdvanceClock(const uint64_t capture_time_us) {
+  const MicroSeconds time_us = REPLAY_CLOCK_START_US +
+                               (capture_time_us - s_first_time_us);
+  const MicroSeconds tick_us = (MicroSeconds)kOpenerTimerTickInMilliSeconds *
+                               1000U;
+  while (s_next_tick_us <= time_us) {
+    s_clock_us = s_next_tick_us;
+    const uint64_t start_ns = RealTimeNs();
+    ManageConnections(kOpenerTimerTickInMilliSeconds);
+    AddSample(s_tick_label, RealTimeNs() - start_ns);
+    s_next_tick_us += tick_us;
+  }
+  s_clock_us = time_us;
+}
+
+static void Pace(const uint64_t capture_time_us) {
+  if (s_speed <= 0.0) {
+    return;
+  }
+  const uint64_t target_ns = s_real_start_ns +
+                             (uint64_t)( (double)(capture_time_us -
+                                                  s_first_time_us) *
+                                         1000.0 / s_speed );
+  const struct timespec target = {
+    .tv_sec = (time_t)(target_ns / 1000000000U),
+    .tv_nsec = (long)(target_ns % 1000000000U),
+  };
+  while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target,
+                                  NULL) ) {
+  }
+}
+
+static struct sockaddr_in ClientAddress(const ReplayStream *const stream) {
+  struct sockaddr_in address = {
+    .sin_family = AF_INET,
+    .sin_port = htons(stream->client_port),
+    .sin_addr.s_addr = htonl(stream->client_address),
+  };
+  return address;
+}
+
+static const ReplayReply *RecordedReply(const ReplayMessage *const message) {
+  return REPLAY_NONE != message->reply ? &s_replies[message->reply] : NULL;
+}
+
+/* Connection IDs of a successful Forward_Open reply */
+static bool ForwardOpenIds(const uint8_t *const reply,
+                           const size_t length,
+                           CipUdint *const o2t,
+                           CipUdint *const t2o,
+                           uint8_t **const ids) {
+  size_t data_length = 0;
+  const uint8_t *const data = FindCpfItem(reply, length,
+                                          kCipItemIdUnconnectedDataItem,
+                                          &data_length);
+  if (NULL == data || data_length < 12U || 0 != data[2] ||
+      ( (REPLAY_SERVICE_FORWARD_OPEN | REPLAY_SERVICE_REPLY) != data[0] &&
+        (REPLAY_SERVICE_LARGE_FORWARD_OPEN | REPLAY_SERVICE_REPLY) !=
+        data[0]) ) {
+    return false;
+  }
+  *o2t = GetLe32(data + 4);
+  *t2o = GetLe32(data + 8);
+  if (NULL != ids) {
+    *ids = (uint8_t *)(data + 4);
+  }
+  return true;
+}
+
+/* Session handles and connection IDs the stack chose for the replay */
+static void LearnFromReply(ReplayStream *const stream,
+                           const ReplayReply *const recorded,
+                           const ENIPMessage *const live) {
+  const uint8_t *const live_data = live->message_buffer;
+  const size_t live_length = live->used_message_length;
+  if (live_length < ENCAPSULATION_HEADER_LENGTH || NULL == recorded ||
+      recorded->length < ENCAPSULATION_HEADER_LENGTH) {
+    return;
+  }
+  const uint8_t *const recorded_data = s_arena.data + recorded->offset;
+  const uint16_t command = GetLe16(live_data);
+  if (REPLAY_COMMAND_REGISTER_SESSION == command &&
+      0 == GetLe32(live_data + 8) ) {
+    stream->live_session = GetLe32(live_data + 4);
+    stream->recorded_session = GetLe32(recorded_data + 4);
+    return;
+  }
+  CipUdint live_o2t = 0;
+  CipUdint live_t2o = 0;
+  CipUdint recorded_o2t = 0;
+  CipUdint recorded_t2o = 0;
+  if (REPLAY_COMMAND_SEND_RR_DATA != command ||
+      !ForwardOpenIds(live_data, live_length, &live_o2t, &live_t2o, NULL) ||
+      !ForwardOpenIds(recorded_data, recorded->length, &recorded_o2t,
+                      &recorded_t2o, NULL) ) {
+    return;
+  }
+  ReplayConnection *connection = FindConnection(recorded_t2o, false, true);
+  if (NULL == connection) {
+    connection = AddConnection();
+    connection->recorded_t2o = recorded_t2o;
+  }
+  connection->recorded_o2t = recorded_o2t;
+  connection->live_o2t = live_o2t;
+  connection->live_t2o = live_t2o;
+  connection->opened = true;
+}
+
+/* Replaces what the stack chose by what the adapter chose in the capture */
+static void NormalizeReply(const ReplayStream *const stream,
+                           const ReplayReply *const recorded,
+                           uint8_t *const reply,
+                           const size_t length) {
+  if (length < ENCAPSULATION_HEADER_LENGTH) {
+    return;
+  }
+  if (0 != stream->live_session && GetLe32(reply + 4) == stream->live_session) {
+    PutLe32(reply + 4, stream->recorded_session);
+  }
+  CipUdint o2t = 0;
+  CipUdint t2o = 0;
+  uint8_t *ids = NULL;
+  if (REPLAY_COMMAND_SEND_RR_DATA == GetLe16(reply) &&
+      ForwardOpenIds(reply, length, &o2t, &t2o, &ids) ) {
+    CipUdint recorded_o2t = 0;
+    CipUdint recorded_t2o = 0;
+    if (ForwardOpenIds(s_arena.data + recorded->offset, recorded->length,
+                       &recorded_o2t, &recorded_t2o, NULL) ) {
+      PutLe32(ids, recorded_o2t);
+      PutLe32(ids + 4, recorded_t2o);
+    }
+  }
+}
+
+static void CompareReply(ReplayMessage *const message,
+                         ReplayStream *const stream,
+                         const ENIPMessage *const live) {
+  const ReplayReply *const recorded = RecordedReply(message);
+  if (NULL != live) {
+    LearnFromReply(stream, recorded, live);
+  }
+  if (NULL == recorded) {
+    message->result = NULL == live ? kReplayResultNone : kReplayResultExtra;
+    return;
+  }
+  if (NULL == live) {
+    message->result = kReplayResultMissing;
+    return;
+  }
+  const size_t length = live->used_message_length;
+  const size_t live_offset = s_arena.length;
+  AppendBytes(&s_arena, live->message_buffer, length);
+  uint8_t *const normalized = s_arena.data + live_offset;
+  NormalizeReply(stream, recorded, normalized, length);
+
+  const uint8_t *const expected = s_arena.data + recorded->offset;
+  const size_t common = length < recorded->length ? length : recorded->length;
+  size_t offset = 0;
+  while (offset < common && normalized[offset] == expected[offset]) {
+    offset++;
+  }
+  if (offset == common && length == recorded->length) {
+    message->result = kReplayResultSame;
+    s_arena.length = live_offset; /* not shown */
+    return;
+  }
+  message->result = kReplayResultDifferent;
+  message->difference_offset = offset;
+  message->live_offset = live_offset;
+  message->live_length = length;
+}
+
+/* Request with the recorded session handle and connection ID replaced */
+static void RewriteRequest(const ReplayStream *const stream,
+                           uint8_t *const request,
+                           const size_t length) {
+  if (0 != stream->live_session &&
+      GetLe32(request + 4) == stream->recorded_session) {
+    PutLe32(request + 4, stream->live_session);
+  }
+  if (REPLAY_COMMAND_SEND_UNIT_DATA == GetLe16(request) ) {
+    size_t item_length = 0;
+    uint8_t *const address = (uint8_t *)FindCpfItem(request, length,
+                                                    kCipItemIdConnectionAddress,
+                                                    &item_length);
+    if (NULL != address && item_length >= 4U) {
+      const ReplayConnection *const connection =
+        FindConnection(GetLe32(address), false, false);
+      if (NULL != connection && connection->opened) {
+        PutLe32(address, connection->live_o2t);
+      }
+    }
+  }
+}
+
+static ENIPMessage *BeginReplayResponse(void) {
+  if (NULL == s_response.message_buffer) {
+    PrepareENIPMessage(&s_response);
+  }
+  (void)ENIPMessageAttachPooledBuffer(&s_response,
+                                      kMessageBufferPoolMaximumSize);
+  return &s_response;
+}
+
+static void EndReplayResponse(void) {
+  ClearENIPMessage(&s_response);
+  ENIPMessageReleasePooledBuffer(&s_response);
+}
+
+static void ReplayTcpMessage(ReplayMessage *const message,
+                             ReplayStream *const stream) {
+  if (stream->closed) {
+    message->result = kReplayResultSkipped;
+    return;
+  }
+  if (kEipInvalidSocket == stream->socket) {
+    stream->socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (kEipInvalidSocket == stream->socket) {
+      ReplayFail("cannot create a socket handle for a session");
+    }
+  }
+  RewriteRequest(stream, s_request, message->length);
+  struct sockaddr_in client = ClientAddress(stream);
+  ENIPMessage *const outgoing = BeginReplayResponse();
+  int remaining_bytes = 0;
+  g_current_active_tcp_socket = stream->socket;
+  const uint64_t start_ns = RealTimeNs();
+  const EipStatus need_to_send =
+    HandleReceivedExplictTcpData(stream->socket, s_request, message->length,
+                                 &remaining_bytes, (struct sockaddr *)&client,
+                                 outgoing);
+  message->processing_ns = RealTimeNs() - start_ns;
+  g_current_active_tcp_socket = kEipInvalidSocket;
+  CompareReply(message, stream, need_to_send > 0 ? outgoing : NULL);
+  EndReplayResponse();
+}
+
+static void ReplayUdpMessage(ReplayMessage *const message,
+                             ReplayStream *const stream) {
+  struct sockaddr_in client = ClientAddress(stream);
+  ENIPMessage *const outgoing = BeginReplayResponse();
+  int remaining_bytes = 0;
+  /* Answered as unicast, a delayed broadcast reply would not be seen */
+  const uint64_t start_ns = RealTimeNs();
+  const EipStatus need_to_send =
+    HandleReceivedExplictUdpData(s_udp_socket, &client, s_request,
+                                 message->length, &remaining_bytes, true,
+                                 outgoing);
+  message->processing_ns = RealTimeNs() - start_ns;
+  CompareReply(message, stream, need_to_send > 0 ? outgoing : NULL);
+  EndReplayResponse();
+}
+
+static void ReplayIoMessage(ReplayMessage *const message,
+                            ReplayStream *const stream) {
+  if (message->length >= 10U &&
+      kCipItemIdSequencedAddressItem == GetLe16(s_request + 2) ) {
+    ReplayConnection *const connection =
+      FindConnection(GetLe32(s_request + 6), false, false);
+    if (NULL != connection && connection->opened) {
+      PutLe32(s_request + 6, connection->live_o2t);
+      connection->o2t_packets++;
+    } else {
+      s_unmatched_o2t++;
+    }
+  }
+  struct sockaddr_in client = ClientAddress(stream);
+  const uint64_t start_ns = RealTimeNs();
+  (void)HandleReceivedConnectedData(s_request, (int)message->length, &client);
+  message->processing_ns = RealTimeNs() - start_ns;
+}
+
+static void ReplayClose(ReplayMessage *const message,
+                        ReplayStream *const stream) {
+  if (stream->closed || kEipInvalidSocket == stream->socket) {
+    return;
+  }
+  const uint64_t start_ns = RealTimeNs();
+  RemoveSession(stream->socket);
+  message->processing_ns = RealTimeNs() - start_ns;
+  __wrap_CloseTcpSocket(stream->socket);
+}
+
+static void Replay(void) {
+  s_clock_us = REPLAY_CLOCK_START_US;
+  s_next_tick_us = REPLAY_CLOCK_START_US;
+  s_tick_label = FindLabel("ManageConnections tick");
+  s_real_start_ns = RealTimeNs();
+  for (size_t i = 0; i < s_message_count; ++i) {
+    ReplayMessage *const message = &s_messages[i];
+    ReplayStream *const stream = &s_streams[message->stream];
+    Pace(message->time_us);
+    AdvanceClock(message->time_us);
+    memcpy(s_request, s_arena.data + message->offset, message->length);
+    switch (message->kind) {
+      case kReplayMessageTcp:
+        ReplayTcpMessage(message, stream);
+        break;
+      case kReplayMessageUdp:
+        ReplayUdpMessage(message, stream);
+        break;
+      case kReplayMessageIo:
+        ReplayIoMessage(message, stream);
+        break;
+      case kReplayMessageClose:
+        ReplayClose(message, stream);
+        break;
+    }
+    if (kReplayResultSkipped != message->result) {
+      AddSample(message->label, message->processing_ns);
+    }
+  }
+}
+
+/* ---- Report ---- */
+
+static int CompareSamples(const void *const a, const void *const b) {
+  const uint64_t left = *(const uint64_t *)a;
+  const uint64_t right = *(const uint64_t *)b;
+  return (left > right) - (left < right);
+}
+
+static void PrintTimes(void) {
+  printf("%-44s %10s %10s %10s %10s %10s\n", "request", "count", "mean ns",
+         "p50 ns", "p99 ns", "max ns");
+  for (size_t i = 0; i < s_label_count; ++i) {
+    ReplayLabel *const label = &s_labels[i];
+    if (0 == label->count) {
+      continue;
+    }
+    qsort(label->samples, label->count, sizeof(label->samples[0]),
+          CompareSamples);
+    uint64_t sum = 0;
+    for (size_t j = 0; j < label->count; ++j) {
+      sum += label->samples[j];
+    }
+    printf("%-44s %10zu %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10"
+           PRIu64 "\n",
+           label->name, label->count, sum / label->count,
+           label->samples[label->count / 2U],
+           label->samples[(label->count - 1U) * 99U / 100U],
+           label->samples[label->count - 1U]);
+  }
+}
+
+static void PrintBytes(const char *const name,
+                       const uint8_t *const data,
+                       const size_t length,
+                       const size_t offset) {
+  printf("    %-9s", name);
+  for (size_t i = offset; i < length && i < offset + REPLAY_SHOWN_BYTES; ++i) {
+    printf(" %02X", data[i]);
+  }
+  printf("%s\n", length > offset + REPLAY_SHOWN_BYTES ? " ..." : "");
+}
+
+/* @return number of replies that did not match */
+static size_t PrintReplies(void) {
+  size_t counts[kReplayResultSkipped + 1] = { 0 };
+  for (size_t i = 0; i < s_message_count; ++i) {
+    if (kReplayMessageTcp == s_messages[i].kind ||
+        kReplayMessageUdp == s_messages[i].kind) {
+      counts[s_messages[i].result]++;
+    }
+  }
+  printf("\nreplies: %zu same, %zu different, %zu missing, %zu extra, "
+         "%zu requests on closed sessions\n",
+         counts[kReplayResultSame], counts[kReplayResultDifferent],
+         counts[kReplayResultMissing], counts[kReplayResultExtra],
+         counts[kReplayResultSkipped]);
+
+  size_t shown = 0;
+  for (size_t i = 0; i < s_message_count && shown < s_shown_differences;
+       ++i) {
+    const ReplayMessage *const message = &s_messages[i];
+    if (kReplayResultDifferent != message->result &&
+        kReplayResultMissing != message->result &&
+        kReplayResultExtra != message->result) {
+      continue;
+    }
+    shown++;
+    printf("  #%zu at %.6f s, %s: %s", i,
+           (double)(message->time_us - s_first_time_us) / 1e6,
+           s_labels[message->label].name,
+           kReplayResultNames[message->result]);
+    if (kReplayResultDifferent != message->result) {
+      printf("\n");
+      continue;
+    }
+    const ReplayReply *const recorded = RecordedReply(message);
+    const size_t from = message->difference_offset & ~(size_t)7U;
+    printf(" from offset %zu, %zu bytes recorded, %zu replayed\n",
+           message->difference_offset, recorded->length,
+           message->live_length);
+    PrintBytes("recorded", s_arena.data + recorded->offset, recorded->length,
+               from);
+    PrintBytes("replayed", s_arena.data + message->live_offset,
+               message->live_length, from);
+  }
+  return counts[kReplayResultDifferent] + counts[kReplayResultMissing] +
+         counts[kReplayResultExtra];
+}
+
+static void PrintConnections(void) {
+  if (0 == s_connection_count && 0 == s_unmatched_o2t) {
+    return;
+  }
+  printf("\nClass 1 connections:\n");
+  for (size_t i = 0; i < s_connection_count; ++i) {
+    const ReplayConnection *const connection = &s_connections[i];
+    if (!connection->opened) {
+      printf("  T->O 0x%08" PRIX32 " opened before the capture: "
+             "%zu T->O recorded\n",
+             connection->recorded_t2o, connection->t2o_recorded);
+      continue;
+    }
+    printf("  O->T 0x%08" PRIX32 " T->O 0x%08" PRIX32 ": %zu O->T replayed, "
+           "%zu T->O recorded, %zu T->O produced\n",
+           connection->recorded_o2t, connection->recorded_t2o,
+           connection->o2t_packets, connection->t2o_recorded,
+           connection->t2o_produced);
+  }
+  if (0 != s_unmatched_o2t) {
+    printf("  %zu O->T packets of connections opened before the capture\n",
+           s_unmatched_o2t);
+  }
+  if (0 != s_unmatched_t2o_produced) {
+    printf("  %zu T->O packets produced on connections not in the "
+           "capture\n", s_unmatched_t2o_produced);
+  }
+}
+
+static bool WriteCsv(const char *const path) {
+  FILE *const file = fopen(path, "w");
+  if (NULL == file) {
+    return false;
+  }
+  fprintf(file, "index,time_s,request,bytes,processing_ns,reply\n");
+  for (size_t i = 0; i < s_message_count; ++i) {
+    const ReplayMessage *const message = &s_messages[i];
+    fprintf(file, "%zu,%.6f,%s,%zu,%" PRIu64 ",%s\n", i,
+            (double)(message->time_us - s_first_time_us) / 1e6,
+            s_labels[message->label].name, message->length,
+            message->processing_ns, kReplayResultNames[message->result]);
+  }
+  return 0 == fclose(file);
+}
+
+static void Usage(const char *const program) {
+  fprintf(stderr,
+          "Usage: %s [options] <capture.pcap|capture.pcapng>\n"
+          "  --device <ip>      adapter of the capture, default: the first "
+          "one on TCP 44818\n"
+          "  --speed <factor>   1 replays at the captured rate, 10 ten "
+          "times faster,\n"
+          "                     0 (default) as fast as possible\n"
+          "  --csv <file>       write one line per replayed packet\n"
+          "  --differences <n>  replies shown that did not match, default "
+          "%u\n",
+          program, (unsigned)REPLAY_DEFAULT_SHOWN_DIFFERENCES);
+}
+
+int main(int argc,
+         char *argv[]) {
+  static const struct option kOptions[] = {
+    { "device", required_argument, NULL, 'd' },
+    { "speed", required_argument, NULL, 's' },
+    { "csv", required_argument, NULL, 'c' },
+    { "differences", required_argument, NULL, 'n' },
+    { NULL, 0, NULL, 0 },
+  };
+  int option = 0;
+  while (-1 != (option = getopt_long(argc, argv, "", kOptions, NULL) ) ) {
+    struct in_addr address;
+    switch (option) {
+      case 'd':
+        if (1 != inet_pton(AF_INET, optarg, &address) ) {
+          Usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        s_device_address = ntohl(address.s_addr);
+        s_device_known = true;
+        break;
+      case 's':
+        s_speed = strtod(optarg, NULL);
+        break;
+      case 'c':
+        s_csv_path = optarg;
+        break;
+      case 'n':
+        s_shown_differences = strtoul(optarg, NULL, 10);
+        break;
+      default:
+        Usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if (optind + 1 != argc) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  const char *const path = argv[optind];
+
+  if (!s_device_known && !FindDevice(path) ) {
+    fprintf(stderr, "OpENer_replay: no EtherNet/IP session in %s, "
+            "give the adapter with --device\n", path);
+    return EXIT_FAILURE;
+  }
+  if (!LoadCapture(path) ) {
+    return EXIT_FAILURE;
+  }
+  MatchReplies();
+
+  /* The stack as OpENer runs it, see main.c, with the recorded address */
+  g_network_status.tcp_listener = kEipInvalidSocket;
+  g_network_status.udp_unicast_listener = kEipInvalidSocket;
+  g_network_status.udp_global_broadcast_listener = kEipInvalidSocket;
+  g_network_status.udp_io_messaging = kEipInvalidSocket;
+  DoublyLinkedListInitialize(&connection_list,
+                             CipConnectionObjectListArrayAllocator,
+                             CipConnectionObjectListArrayFree);
+  SetDeviceSerialNumber(123456789);
+  if (kEipStatusOk != CipStackInit(1) ) {
+    fprintf(stderr, "CipStackInit failed\n");
+    return EXIT_FAILURE;
+  }
+  NetworkHandlerInitializeSessions();
+  EncapsulationInit();
+  GetHostName(&g_tcpip.hostname);
+  g_tcpip.interface_configuration.ip_address = htonl(s_device_address);
+
+  /* UDP replies cannot leave through a local socket */
+  int udp_sockets[2];
+  if (0 != socketpair(AF_UNIX, SOCK_DGRAM, 0, udp_sockets) ) {
+    fprintf(stderr, "OpENer_replay: cannot create the UDP socket handle\n");
+    return EXIT_FAILURE;
+  }
+  s_udp_socket = udp_sockets[0];
+  InitializeENIPMessage(&s_response);
+
+  struct in_addr device = { .s_addr = htonl(s_device_address) };
+  printf("%s: %zu packets, adapter %s, %zu requests, %zu recorded replies, "
+         "%zu sessions and clients\n\n",
+         path, s_packets_read, inet_ntoa(device), s_message_count,
+         s_reply_count, s_stream_count);
+
+  const uint64_t start_ns = RealTimeNs();
+  Replay();
+  const uint64_t replay_ns = RealTimeNs() - start_ns;
+
+  PrintTimes();
+  const size_t mismatches = PrintReplies();
+  PrintConnections();
+  size_t gaps = 0;
+  for (size_t i = 0; i < s_stream_count; ++i) {
+    gaps += s_streams[i].gaps;
+  }
+  if (0 != gaps) {
+    printf("\n%zu TCP segments were missing from the capture\n", gaps);
+  }
+  printf("\nreplayed in %.3f s, the capture spans %.3f s\n",
+         (double)replay_ns / 1e9,
+         (double)(s_clock_us - REPLAY_CLOCK_START_US) / 1e6);
+
+  if (NULL != s_csv_path && !WriteCsv(s_csv_path) ) {
+    fprintf(stderr, "OpENer_replay: cannot write %s\n", s_csv_path);
+  }
+
+  ShutdownCipStack();
+  close(udp_sockets[0]);
+  close(udp_sockets[1]);
+  /* 2 tells a regression run that replies changed */
+  return 0 == mismatches ? EXIT_SUCCESS : 2;
+}
@@ -0,0 +1,212 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_USER_CONF_H_
+#define OPENER_USER_CONF_H_
+
+#include <assert.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "typedefs.h"
+
+#ifndef RESTRICT
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L
+#define RESTRICT restrict
+#else
+#define RESTRICT
+#endif
+#endif
+
+#ifndef CIP_FILE_OBJECT
+  #define CIP_FILE_OBJECT 0
+#endif
+
+#ifndef CIP_SECURITY_OBJECTS
+  #define CIP_SECURITY_OBJECTS 0
+#endif
+
+#ifdef OPENER_UNIT_TEST
+  #include "test_assert.h"
+#endif
+
+#ifndef OPENER_IS_DLR_DEVICE
+  #define OPENER_IS_DLR_DEVICE  0
+#endif
+
+#if defined(OPENER_IS_DLR_DEVICE) && 0 != OPENER_IS_DLR_DEVICE
+  #define OPENER_TCPIP_IFACE_CFG_SETTABLE 1
+  #define OPENER_ETHLINK_CNTRS_ENABLE     1
+  #define OPENER_ETHLINK_IFACE_CTRL_ENABLE  1
+  #define OPENER_ETHLINK_LABEL_ENABLE     1
+  #define OPENER_ETHLINK_INSTANCE_CNT     3
+#endif
+#ifndef OPENER_TCPIP_IFACE_CFG_SETTABLE
+  #define OPENER_TCPIP_IFACE_CFG_SETTABLE 1
+#endif
+
+#ifndef OPENER_ETHLINK_INSTANCE_CNT
+  #define OPENER_ETHLINK_INSTANCE_CNT  1
+#endif
+
+#ifndef OPENER_ETHLINK_LABEL_ENABLE
+  #define OPENER_ETHLINK_LABEL_ENABLE  0
+#endif
+
+#ifndef OPENER_ETHLINK_CNTRS_ENABLE
+  #define OPENER_ETHLINK_CNTRS_ENABLE 1
+#endif
+
+#ifndef OPENER_ETHLINK_IFACE_CTRL_ENABLE
+  #define OPENER_ETHLINK_IFACE_CTRL_ENABLE 0
+#endif
+
+/** The sample application configures its connection points at run time,
+ *  a sealed configuration lists them in OPENER_SEALED_EXCLUSIVE_OWNER_POINTS
+ *  etc., see appcontype.c */
+#ifndef OPENER_SEALED_CONFIGURATION
+  #define OPENER_SEALED_CONFIGURATION 0
+#endif
+
+/** The host build runs the select() loop without the ESP32 only backends */
+#define OPENER_IO_EVENT_BACKEND 0
+#define OPENER_CIP_SECURITY 0
+#define OPENER_LOOP_PROFILE 0
+#define OPENER_WCET_PROFILE 0
+#define OPENER_LATENCY_PROBES 0
+#define OPENER_TRACE_EVENTS 0
+
+/** Set by the OpENer_benchmark target only, see benchmark.h */
+#ifndef OPENER_BENCHMARK
+  #define OPENER_BENCHMARK 0
+#endif
+
+#define OPENER_CIP_NUM_APPLICATION_SPECIFIC_CONNECTABLE_OBJECTS 1
+
+#define OPENER_CIP_NUM_EXPLICIT_CONNS 6
+
+#define OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS 1
+
+#define OPENER_CIP_NUM_INPUT_ONLY_CONNS 1
+
+/* The host build runs the 16+ I/O connection load tests, 1 + 8 + 8 */
+#define OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH 8
+
+#define OPENER_CIP_NUM_LISTEN_ONLY_CONNS 1
+
+#define OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH   8
+
+#define OPENER_NUMBER_OF_SUPPORTED_SESSIONS 20
+
+/** Delayed replies to ListIdentity requests over UDP, one per requester */
+#define OPENER_LIST_IDENTITY_QUEUE_DEPTH 16
+
+/** Milliseconds a timed out I/O connection waits for a re-open of its originator */
+#define OPENER_IO_CONNECTION_STANDBY_MS 10000
+
+/** Accept a standby exclusive owner from a redundant originator pair */
+#define OPENER_CIP_REDUNDANT_OWNER 1
+
+/** Parsed Forward_Open connection paths kept for repeated opens */
+#define OPENER_CONNECTION_PATH_CACHE_SIZE 4
+
+/** Phase slots new cyclic connections are staggered in within their RPI */
+#define OPENER_PRODUCTION_PHASE_SLOTS 64
+
+/** Admission control budgets of new I/O connections, 0 for no limit */
+#define OPENER_ADMISSION_MAX_PACKETS_PER_SECOND 0
+#define OPENER_ADMISSION_CPU_BUDGET_PERCENT 0
+
+/** Explicit reads of an assembly reuse its data up to this age, 0 for never */
+#define OPENER_ASSEMBLY_EXPLICIT_READ_MAX_AGE_MS 0
+
+/** Bytes of cached GetAttributeAll encoding per instance, 0 disables it */
+#define OPENER_GET_ATTRIBUTE_ALL_CACHE_SIZE 64
+
+/** Size of the Message Router class registry, one entry per CIP class */
+#define OPENER_CIP_NUM_REGISTERED_CLASSES 16
+
+#define PC_OPENER_ETHERNET_BUFFER_SIZE 512
+
+/** Datagrams and microseconds the select() loop spends at most on the shared
+ *  UDP I/O socket per wake-up, see CheckAndHandleConsumingUdpSocket() */
+#define OPENER_IO_RECEIVE_BATCH 64
+#define OPENER_IO_RECEIVE_BUDGET_US 2000
+
+/** Produced frames carry the DSCP of their connection as IP_TOS ancillary
+ *  data of the sendmsg(), Linux takes it from 4.6 on */
+#if defined(__linux__)
+#define OPENER_UDP_TOS_CONTROL_MESSAGE 1
+#endif
+
+/** Explicit requests per second and TCP session, 0 for no limit, and
+ *  requests of all sessions per loop iteration, see tcp_transport.h */
+#define OPENER_EXPLICIT_REQUESTS_PER_SECOND 0
+#define OPENER_EXPLICIT_REQUESTS_PER_LOOP 8
+
+/** Staged shedding of best effort work, see overload_governor.h */
+#define OPENER_OVERLOAD_GOVERNOR 1
+
+/** Pooled buffers for explicit messages, see messagebufferpool.h. The small
+ *  class holds one frame per TCP session, the larger classes serve the few
+ *  explicit requests and responses that exceed PC_OPENER_ETHERNET_BUFFER_SIZE.
+ */
+#define OPENER_MESSAGE_BUFFER_SMALL_COUNT   OPENER_NUMBER_OF_SUPPORTED_SESSIONS
+#define OPENER_MESSAGE_BUFFER_MEDIUM_SIZE   1536
+#define OPENER_MESSAGE_BUFFER_MEDIUM_COUNT  4
+#define OPENER_MESSAGE_BUFFER_LARGE_SIZE    4096
+#define OPENER_MESSAGE_BUFFER_LARGE_COUNT   3
+
+static const MilliSeconds kOpenerTimerTickInMilliSeconds = 10;
+
+#define OPENER_WITH_TRACES
+#define OPENER_TRACE_LEVEL (OPENER_TRACE_LEVEL_ERROR | OPENER_TRACE_LEVEL_WARNING)
+
+#ifndef OPENER_UNIT_TEST
+
+#ifdef OPENER_WITH_TRACES
+    #include <stdio.h>
+
+    #define OPENER_TRACE_BUFFER 0
+    #define LOG_TRACE(...)  fprintf(stderr,__VA_ARGS__)
+
+     #ifdef IDLING_ASSERT
+        #define OPENER_ASSERT(assertion)                                    \
+  do {                                                              \
+    if( !(assertion) ) {                                            \
+      fprintf(stderr, "Assertion \"%s\" failed: file \"%s\", line %d\n", \
+                # assertion, __FILE__, __LINE__);                   \
+      while(1) {  }                                                 \
+    }                                                               \
+  } while(0)
+
+    #else
+        #define OPENER_ASSERT(assertion) assert(assertion)
+    #endif
+
+#else
+    #if 0
+        #define OPENER_ASSERT(assertion) (assertion)
+    #elif 0
+        #define OPENER_ASSERT(assertion)                    \
+  do { if(!(assertion) ) { while(1) {} } } while (0)
+    #elif 0
+        #define OPENER_ASSERT(assertion)
+    #else
+        #define OPENER_ASSERT(assertion) assert(assertion)
+    #endif
+
+#endif
+
+#endif
+
+#endif
+
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opener_api.h"
+#include "appcontype.h"
+#include "benchmark.h"
+#include "networkhandler.h"
+#include "trace.h"
+#include "cipidentity.h"
+#include "ciptcpipinterface.h"
+#include "cipqos.h"
+#include "cipstring.h"
+#include "ciptypes.h"
+#include "typedefs.h"
+#include "kc868_a16_sim.h"
+
+/* Simulated KC868-A16 I/O: same assemblies and sizes as the firmware. The
+ * expanders and analog inputs are the model of the firmware's simulated I/O
+ * backend, kc868_a16_sim.h, programmed so the 16 inputs read back the 16
+ * relays and the four analog channels ramp. Its bus latencies are not
+ * waited for. */
+#define DEMO_APP_INPUT_ASSEMBLY_NUM                100
+#define DEMO_APP_OUTPUT_ASSEMBLY_NUM               150
+#define DEMO_APP_CONFIG_ASSEMBLY_NUM               151
+#define DEMO_APP_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM  152
+#define DEMO_APP_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM 153
+
+#define SIM_DIGITAL_INPUT_BYTES                   2
+#define SIM_ANALOG_INPUT_COUNT                    4
+#define SIM_ANALOG_FULL_SCALE                     4095U
+#define SIM_ANALOG_PERIOD_MS                      10000U
+
+#define OUTPUT_ASSEMBLY_SIZE                      2
+#define CONFIG_ASSEMBLY_SIZE                      0
+#define INPUT_ASSEMBLY_SIZE                       (SIM_DIGITAL_INPUT_BYTES + \
+                                                   SIM_ANALOG_INPUT_COUNT * 2)
+
+static EipUint8 s_input_assembly_data[INPUT_ASSEMBLY_SIZE];
+static EipUint8 s_output_assembly_data[OUTPUT_ASSEMBLY_SIZE];
+static EipUint8 s_config_assembly_data[1];  /* Minimal config assembly */
+
+/* Last inputs read, 1 = on */
+static EipUint8 s_digital_inputs[SIM_DIGITAL_INPUT_BYTES];
+
+/* Every input follows its relay, the analog channels are sawtooths a
+ * quarter period apart, in raw ADC counts */
+static void InitializeSimulation(void) {
+  KC868_A16_SimReset();
+  for (size_t input = 0; input < KC868_A16_SIM_DIGITAL_INPUT_COUNT; ++input) {
+    const KC868_A16_SimSignal relay = {
+      .type = kKc868SimSignalRelay,
+      .relay = (uint8_t)input,
+    };
+    KC868_A16_SimSetDigitalSignal(input, &relay);
+  }
+  for (size_t channel = 0; channel < SIM_ANALOG_INPUT_COUNT; ++channel) {
+    const KC868_A16_SimSignal ramp = {
+      .type = kKc868SimSignalRamp,
+      .low = 0,
+      .high = SIM_ANALOG_FULL_SCALE,
+      .period_us = SIM_ANALOG_PERIOD_MS * 1000U,
+      .phase_us = (uint32_t)channel * (SIM_ANALOG_PERIOD_MS / 4U) * 1000U,
+    };
+    KC868_A16_SimSetAnalogSignal(channel, &ramp);
+  }
+}
+
+static void WriteRelays(const EipUint8 *const relays) {
+  const bool access[KC868_A16_SIM_EXPANDER_COUNT] = { true, true, false, false };
+  uint8_t ports[KC868_A16_SIM_EXPANDER_COUNT] = { 0 };
+  KC868_A16_SimResult results[KC868_A16_SIM_EXPANDER_COUNT];
+  for (size_t i = 0; i < OUTPUT_ASSEMBLY_SIZE; ++i) {
+    ports[i] = (uint8_t)~relays[i]; /* active low */
+  }
+  (void)KC868_A16_SimTransfer(access, false, ports, results, GetMicroSeconds() );
+}
+
+/* True if an input changed since the last read */
+static bool ReadDigitalInputs(void) {
+  const bool access[KC868_A16_SIM_EXPANDER_COUNT] = { false, false, true, true };
+  uint8_t ports[KC868_A16_SIM_EXPANDER_COUNT] = { 0 };
+  KC868_A16_SimResult results[KC868_A16_SIM_EXPANDER_COUNT];
+  bool changed = false;
+  (void)KC868_A16_SimTransfer(access, false, ports, results, GetMicroSeconds() );
+  for (size_t i = 0; i < SIM_DIGITAL_INPUT_BYTES; ++i) {
+    const size_t expander = KC868_A16_SIM_FIRST_INPUT_EXPANDER + i;
+    if (kKc868SimOk == results[expander] &&
+        s_digital_inputs[i] != (EipUint8)~ports[expander]) {
+      s_digital_inputs[i] = (EipUint8)~ports[expander];
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+static void UpdateInputImage(EipUint8 *const image) {
+  uint16_t counts[SIM_ANALOG_INPUT_COUNT];
+  (void)ReadDigitalInputs();
+  memcpy(image, s_digital_inputs, SIM_DIGITAL_INPUT_BYTES);
+  (void)KC868_A16_SimReadAnalog(counts, GetMicroSeconds() );
+  for (unsigned int channel = 0; channel < SIM_ANALOG_INPUT_COUNT; ++channel) {
+    image[SIM_DIGITAL_INPUT_BYTES + 2 * channel] = (EipUint8)(counts[channel] & 0xFF);
+    image[SIM_DIGITAL_INPUT_BYTES + 2 * channel + 1] = (EipUint8)(counts[channel] >> 8);
+  }
+}
+
+EipStatus ApplicationInitialization(void) {
+  InitializeSimulation();
+
+  CreateAssemblyObject(DEMO_APP_OUTPUT_ASSEMBLY_NUM, s_output_assembly_data,
+                       OUTPUT_ASSEMBLY_SIZE);
+
+  CreateAssemblyObject(DEMO_APP_INPUT_ASSEMBLY_NUM, s_input_assembly_data,
+                       INPUT_ASSEMBLY_SIZE);
+
+  CreateAssemblyObject(DEMO_APP_CONFIG_ASSEMBLY_NUM, s_config_assembly_data,
+                       CONFIG_ASSEMBLY_SIZE);
+
+  /* Zero sized O->T points of the input only and listen only connections */
+  CreateAssemblyObject(DEMO_APP_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM, NULL, 0);
+  CreateAssemblyObject(DEMO_APP_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM, NULL, 0);
+
+  ConfigureExclusiveOwnerConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
+                                        DEMO_APP_INPUT_ASSEMBLY_NUM,
+                                        DEMO_APP_CONFIG_ASSEMBLY_NUM);
+  ConfigureInputOnlyConnectionPoint(0, DEMO_APP_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM,
+                                    DEMO_APP_INPUT_ASSEMBLY_NUM,
+                                    DEMO_APP_CONFIG_ASSEMBLY_NUM);
+  ConfigureListenOnlyConnectionPoint(0, DEMO_APP_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM,
+                                     DEMO_APP_INPUT_ASSEMBLY_NUM,
+                                     DEMO_APP_CONFIG_ASSEMBLY_NUM);
+  CipRunIdleHeaderSetO2T(false);
+  CipRunIdleHeaderSetT2O(false);
+
+  return kEipStatusOk;
+}
+
+void HandleApplication(void) {
+  /* The digital inputs are the only ones that change of state connections
+   * trigger on, the analog ramp would trigger every cycle. */
+  if (ReadDigitalInputs() ) {
+    TriggerConnections(DEMO_APP_OUTPUT_ASSEMBLY_NUM,
+                       DEMO_APP_INPUT_ASSEMBLY_NUM);
+  }
+}
+
+void CheckIoConnectionEvent(unsigned int output_assembly_id,
+                            unsigned int input_assembly_id,
+                            IoConnectionEvent io_connection_event) {
+  (void) output_assembly_id;
+  (void) input_assembly_id;
+  (void) io_connection_event;
+}
+
+EipStatus AfterAssemblyDataReceived(CipInstance *instance) {
+  if (instance->instance_number == DEMO_APP_OUTPUT_ASSEMBLY_NUM) {
+    WriteRelays(s_output_assembly_data);
+  }
+  return kEipStatusOk;
+}
+
+EipBool8 BeforeAssemblyDataSend(CipInstance *instance) {
+  if (instance->instance_number == DEMO_APP_INPUT_ASSEMBLY_NUM) {
+    UpdateInputImage(s_input_assembly_data);
+  }
+  return true;
+}
+
+EipStatus ResetDevice(void) {
+  CloseAllConnections();
+  CipQosUpdateUsedSetQosValues();
+  return kEipStatusOk;
+}
+
+EipStatus ResetDeviceToInitialConfiguration(void) {
+  g_tcpip.encapsulation_inactivity_timeout = 120;
+  CipQosResetAttributesToDefaultValues();
+  CloseAllConnections();
+  return kEipStatusOk;
+}
+
+void* CipCalloc(size_t number_of_elements, size_t size_of_element) {
+#if OPENER_BENCHMARK
+  BenchmarkCountAllocation(number_of_elements * size_of_element);
+#endif
+  return calloc(number_of_elements, size_of_element);
+}
+
+void CipFree(void *data) {
+  free(data);
+}
+
+void RunIdleChanged(EipUint32 run_idle_value) {
+  (void) run_idle_value;
+}
@@ -0,0 +1,335 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "benchmark.h"
+
+#if OPENER_BENCHMARK
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cipcommon.h"
+#include "cipconnectionmanager.h"
+#include "cipconnectionobject.h"
+#include "cipidentity.h"
+#include "cpf.h"
+#include "devicedata.h"
+#include "encap.h"
+#include "endianconv.h"
+#include "enipmessage.h"
+#include "networkhandler.h"
+#include "trace.h"
+
+/** Time every case runs for */
+#define BENCHMARK_CASE_DURATION_US 200000U
+/** Operations between two reads of the clock */
+#define BENCHMARK_BATCH 32U
+/** Calls per operation of the endian conversion cases */
+#define BENCHMARK_ENDIAN_CALLS 64U
+
+#define BENCHMARK_IO_INPUT_SIZE   10U /* input assembly of the KC868-A16 */
+#define BENCHMARK_IO_CONNECTION_ID 0x12345678U
+
+typedef struct {
+  const char *name;
+  void (*run)(void); /**< one call, see calls_per_run */
+  CipUdint calls_per_run; /**< operations done by one run() */
+} BenchmarkCase;
+
+static size_t s_allocated_bytes;
+static volatile CipUdint s_sink; /* keeps results alive */
+
+/* Fixtures, built once by BenchmarkSetUp() */
+static ENIPMessage s_io_packet; /* received Class 1 CPF */
+static ENIPMessage s_encapsulation_packet; /* SendRRData GetAttributeSingle */
+static ENIPMessage s_forward_open; /* Forward Open request data */
+static ENIPMessage s_outgoing;
+static CipOctet s_io_data[2 + BENCHMARK_IO_INPUT_SIZE];
+static CipOctet s_endian_data[2 * BENCHMARK_ENDIAN_CALLS];
+static CipCommonPacketFormatData s_io_cpf;
+static CipCommonPacketFormatData s_explicit_cpf;
+static CipMessageRouterRequest s_get_request;
+static CipMessageRouterResponse s_get_response;
+static CipMessageRouterResponse s_linear_response;
+static CipInstance *s_identity_instance;
+static CipConnectionObject s_connection_template;
+static CipConnectionObject s_connection;
+static const CipOctet *s_connection_path;
+
+void BenchmarkCountAllocation(const size_t size) {
+  s_allocated_bytes += size;
+}
+
+static void BuildIoPacket(void) {
+  InitializeENIPMessage(&s_io_packet);
+  AddIntToMessage(2, &s_io_packet); /* item count */
+  AddIntToMessage(kCipItemIdSequencedAddressItem, &s_io_packet);
+  AddIntToMessage(8, &s_io_packet);
+  AddDintToMessage(BENCHMARK_IO_CONNECTION_ID, &s_io_packet);
+  AddDintToMessage(42, &s_io_packet); /* encapsulation sequence number */
+  AddIntToMessage(kCipItemIdConnectedDataItem, &s_io_packet);
+  AddIntToMessage(2 + 4 + 2, &s_io_packet);
+  AddIntToMessage(42, &s_io_packet); /* CIP sequence count */
+  AddDintToMessage(1, &s_io_packet); /* run/idle header: run */
+  AddIntToMessage(0xA55A, &s_io_packet); /* relay outputs */
+}
+
+static void BuildEncapsulationPacket(void) {
+  static const CipOctet kGetProductName[] =
+  { kGetAttributeSingle, 0x03, 0x20, 0x01, 0x24, 0x01, 0x30, 0x07 };
+
+  InitializeENIPMessage(&s_encapsulation_packet);
+  AddIntToMessage(0x006F, &s_encapsulation_packet); /* SendRRData */
+  AddIntToMessage(6 + 10 + 4 + sizeof(kGetProductName),
+                  &s_encapsulation_packet);
+  AddDintToMessage(1, &s_encapsulation_packet); /* session handle */
+  AddDintToMessage(0, &s_encapsulation_packet); /* status */
+  FillNextNMessageOctetsWithValueAndMoveToNextPosition(0, 8,
+                                                       &s_encapsulation_packet);
+  AddDintToMessage(0, &s_encapsulation_packet); /* options */
+  AddDintToMessage(0, &s_encapsulation_packet); /* interface handle */
+  AddIntToMessage(0, &s_encapsulation_packet); /* timeout */
+  AddIntToMessage(2, &s_encapsulation_packet); /* item count */
+  AddIntToMessage(kCipItemIdNullAddress, &s_encapsulation_packet);
+  AddIntToMessage(0, &s_encapsulation_packet);
+  AddIntToMessage(kCipItemIdUnconnectedDataItem, &s_encapsulation_packet);
+  AddIntToMessage(sizeof(kGetProductName), &s_encapsulation_packet);
+  memcpy(s_encapsulation_packet.current_message_position, kGetProductName,
+         sizeof(kGetProductName) );
+  s_encapsulation_packet.current_message_position += sizeof(kGetProductName);
+  s_encapsulation_packet.used_message_length += sizeof(kGetProductName);
+}
+
+/* Exclusive owner O->T 150, T->O 100, configuration 151, electronic key */
+static EipStatus BuildForwardOpen(void) {
+  InitializeENIPMessage(&s_forward_open);
+  AddSintToMessage(0x0A, &s_forward_open); /* priority / time tick */
+  AddSintToMessage(0xF0, &s_forward_open); /* timeout ticks */
+  AddDintToMessage(0, &s_forward_open); /* O->T connection ID */
+  AddDintToMessage(0x11223344, &s_forward_open); /* T->O connection ID */
+  AddIntToMessage(1, &s_forward_open); /* connection serial number */
+  AddIntToMessage(0x1234, &s_forward_open); /* originator vendor ID */
+  AddDintToMessage(0x55667788, &s_forward_open); /* originator serial */
+  AddSintToMessage(1, &s_forward_open); /* timeout multiplier */
+  FillNextNMessageOctetsWithValueAndMoveToNextPosition(0, 3, &s_forward_open);
+  AddDintToMessage(10000, &s_forward_open); /* O->T RPI */
+  AddIntToMessage(0x4000 | 8, &s_forward_open); /* point to point, 8 bytes */
+  AddDintToMessage(10000, &s_forward_open); /* T->O RPI */
+  AddIntToMessage(0x2000 | 12, &s_forward_open); /* multicast, 12 bytes */
+  AddSintToMessage(0x01, &s_forward_open); /* class 1, cyclic */
+  AddSintToMessage(9, &s_forward_open); /* connection path size in words */
+  const size_t path_offset = s_forward_open.used_message_length - 1;
+  AddSintToMessage(0x34, &s_forward_open); /* electronic key, format 4 */
+  AddSintToMessage(0x04, &s_forward_open);
+  AddIntToMessage(OPENER_DEVICE_VENDOR_ID, &s_forward_open);
+  AddIntToMessage(OPENER_DEVICE_TYPE, &s_forward_open);
+  AddIntToMessage(OPENER_DEVICE_PRODUCT_CODE, &s_forward_open);
+  AddSintToMessage(OPENER_DEVICE_MAJOR_REVISION, &s_forward_open);
+  AddSintToMessage(OPENER_DEVICE_MINOR_REVISION, &s_forward_open);
+  AddSintToMessage(0x20, &s_forward_open); /* class assembly */
+  AddSintToMessage(0x04, &s_forward_open);
+  AddSintToMessage(0x24, &s_forward_open); /* configuration instance */
+  AddSintToMessage(151, &s_forward_open);
+  AddSintToMessage(0x2C, &s_forward_open); /* consumed connection point */
+  AddSintToMessage(150, &s_forward_open);
+  AddSintToMessage(0x2C, &s_forward_open); /* produced connection point */
+  AddSintToMessage(100, &s_forward_open);
+
+  const CipOctet *message = s_forward_open.message_buffer;
+  ConnectionObjectInitializeEmpty(&s_connection_template);
+  ConnectionObjectInitializeFromMessage(&message, &s_connection_template);
+  s_connection_path = s_forward_open.message_buffer + path_offset;
+  OPENER_ASSERT(message == s_connection_path);
+
+  memcpy(&s_connection, &s_connection_template, sizeof(s_connection) );
+  CipMessageRouterRequest request = {
+    .data = s_connection_path,
+    .request_data_size = s_forward_open.used_message_length
+  };
+  EipUint16 extended_error = 0;
+  return (kEipStatusOk == ParseConnectionPath(&s_connection, &request,
+                                              &extended_error) ) ?
+         kEipStatusOk : kEipStatusError;
+}
+
+static EipStatus BenchmarkSetUp(void) {
+  BuildIoPacket();
+  BuildEncapsulationPacket();
+
+  for(size_t i = 0; i < sizeof(s_io_data); ++i) {
+    s_io_data[i] = (CipOctet)i;
+  }
+  for(size_t i = 0; i < sizeof(s_endian_data); ++i) {
+    s_endian_data[i] = (CipOctet)(i * 7U);
+  }
+
+  s_io_cpf.item_count = 2;
+  s_io_cpf.address_item.type_id = kCipItemIdSequencedAddressItem;
+  s_io_cpf.address_item.length = 8;
+  s_io_cpf.address_item.data.connection_identifier =
+    BENCHMARK_IO_CONNECTION_ID;
+  s_io_cpf.address_item.data.sequence_number = 42;
+  s_io_cpf.data_item.type_id = kCipItemIdConnectedDataItem;
+  s_io_cpf.data_item.length = sizeof(s_io_data);
+  s_io_cpf.data_item.data = s_io_data;
+
+  CipClass *identity_class = GetCipClass(kCipIdentityClassCode);
+  s_identity_instance = (NULL != identity_class) ?
+                        GetCipInstance(identity_class, 1) : NULL;
+  if(NULL == s_identity_instance) {
+    return kEipStatusError;
+  }
+  s_get_request.service = kGetAttributeSingle;
+  s_get_request.request_path.class_id = kCipIdentityClassCode;
+  s_get_request.request_path.instance_number = 1;
+  InitializeENIPMessage(&s_get_response.message);
+
+  /* GetAttributeSingle response to the product name for the linear case */
+  s_get_request.request_path.attribute_number = 7;
+  InitializeENIPMessage(&s_linear_response.message);
+  GetAttributeSingle(s_identity_instance, &s_get_request, &s_linear_response,
+                     NULL, 0);
+  s_explicit_cpf.item_count = 2;
+  s_explicit_cpf.address_item.type_id = kCipItemIdNullAddress;
+  s_explicit_cpf.data_item.type_id = kCipItemIdUnconnectedDataItem;
+
+  InitializeENIPMessage(&s_outgoing);
+  return BuildForwardOpen();
+}
+
+static void RunCreateCommonPacketFormatStructure(void) {
+  CipCommonPacketFormatData cpf;
+  s_sink += CreateCommonPacketFormatStructure(s_io_packet.message_buffer,
+                                              s_io_packet.used_message_length,
+                                              &cpf);
+  s_sink += cpf.address_item.data.sequence_number;
+}
+
+static void RunAssembleIOMessage(void) {
+  PrepareENIPMessage(&s_outgoing);
+  AssembleIOMessage(&s_io_cpf, &s_outgoing);
+  s_sink += s_outgoing.used_message_length;
+}
+
+static void RunAssembleLinearMessage(void) {
+  PrepareENIPMessage(&s_outgoing);
+  s_sink += AssembleLinearMessage(&s_linear_response, &s_explicit_cpf,
+                                  &s_outgoing);
+}
+
+static void RunCreateEncapsulationStructure(void) {
+  EncapsulationData encapsulation_data;
+  s_sink += CreateEncapsulationStructure(
+    s_encapsulation_packet.message_buffer,
+    s_encapsulation_packet.used_message_length,
+    &encapsulation_data);
+}
+
+static void RunGetUintFromMessage(void) {
+  const CipOctet *buffer = s_endian_data;
+  CipUdint sum = 0;
+  for(size_t i = 0; i < BENCHMARK_ENDIAN_CALLS; ++i) {
+    sum += GetUintFromMessage(&buffer);
+  }
+  s_sink += sum;
+}
+
+static void RunAddIntToMessage(void) {
+  PrepareENIPMessage(&s_outgoing);
+  for(size_t i = 0; i < BENCHMARK_ENDIAN_CALLS; ++i) {
+    AddIntToMessage( (EipUint16)i, &s_outgoing );
+  }
+  s_sink += s_outgoing.used_message_length;
+}
+
+static void RunGetAttributeSingle(const EipUint16 attribute_number) {
+  s_get_request.request_path.attribute_number = attribute_number;
+  PrepareENIPMessage(&s_get_response.message);
+  s_sink += GetAttributeSingle(s_identity_instance, &s_get_request,
+                               &s_get_response, NULL, 0);
+}
+
+static void RunGetAttributeSingleUint(void) {
+  RunGetAttributeSingle(1); /* vendor ID */
+}
+
+static void RunGetAttributeSingleShortString(void) {
+  RunGetAttributeSingle(7); /* product name */
+}
+
+static void RunParseConnectionPath(void) {
+  memcpy(&s_connection, &s_connection_template, sizeof(s_connection) );
+  CipMessageRouterRequest request = {
+    .data = s_connection_path,
+    .request_data_size = s_forward_open.used_message_length
+  };
+  EipUint16 extended_error = 0;
+  s_sink += ParseConnectionPath(&s_connection, &request, &extended_error);
+}
+
+/* Every Forward_Open of a path not seen before */
+static void RunParseConnectionPathUncached(void) {
+  ClearConnectionPathCache();
+  RunParseConnectionPath();
+}
+
+static const BenchmarkCase kBenchmarkCases[] = {
+  { "CreateCommonPacketFormatStructure", RunCreateCommonPacketFormatStructure,
+    1 },
+  { "AssembleIOMessage", RunAssembleIOMessage, 1 },
+  { "AssembleLinearMessage", RunAssembleLinearMessage, 1 },
+  { "CreateEncapsulationStructure", RunCreateEncapsulationStructure, 1 },
+  { "GetUintFromMessage", RunGetUintFromMessage, BENCHMARK_ENDIAN_CALLS },
+  { "AddIntToMessage", RunAddIntToMessage, BENCHMARK_ENDIAN_CALLS },
+  { "GetAttributeSingle (UINT)", RunGetAttributeSingleUint, 1 },
+  { "GetAttributeSingle (SHORT_STRING)", RunGetAttributeSingleShortString, 1 },
+  { "ParseConnectionPath (cached)", RunParseConnectionPath, 1 },
+  { "ParseConnectionPath (uncached)", RunParseConnectionPathUncached, 1 },
+};
+
+static void RunCase(const BenchmarkCase *const benchmark_case) {
+  benchmark_case->run(); /* warm up caches */
+
+  uint64_t runs = 0;
+  s_allocated_bytes = 0;
+  const MicroSeconds start = GetMicroSeconds();
+  MicroSeconds elapsed = 0;
+  do {
+    for(size_t i = 0; i < BENCHMARK_BATCH; ++i) {
+      benchmark_case->run();
+    }
+    runs += BENCHMARK_BATCH;
+    elapsed = GetMicroSeconds() - start;
+  } while(elapsed < BENCHMARK_CASE_DURATION_US);
+
+  /* tenths of nanoseconds and bytes per operation */
+  const uint64_t operations = runs * benchmark_case->calls_per_run;
+  const uint64_t tenth_ns = (uint64_t)elapsed * 10000U / operations;
+  const uint64_t tenth_bytes = (uint64_t)s_allocated_bytes * 10U / operations;
+  printf("%-36s %12" PRIu64 " %8" PRIu64 ".%" PRIu64 " %6" PRIu64 ".%" PRIu64
+         "\n",
+         benchmark_case->name,
+         operations,
+         tenth_ns / 10U,
+         tenth_ns % 10U,
+         tenth_bytes / 10U,
+         tenth_bytes % 10U);
+}
+
+void BenchmarkRunAll(void) {
+  if(kEipStatusOk != BenchmarkSetUp() ) {
+    OPENER_TRACE_ERR("Benchmark: setting up the fixtures failed\n");
+    return;
+  }
+  printf("%-36s %12s %10s %8s\n", "case", "operations", "ns/op", "B/op");
+  for(size_t i = 0; i < sizeof(kBenchmarkCases) / sizeof(kBenchmarkCases[0]);
+      ++i) {
+    RunCase(&kBenchmarkCases[i]);
+  }
+}
+
+#endif /* OPENER_BENCHMARK */
@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_BENCHMARK_H_
+#define OPENER_BENCHMARK_H_
+
+/** @file benchmark.h
+ *  @brief Microbenchmarks of the CPF, encapsulation, endian conversion and
+ *  CIP request hot paths
+ *
+ *  Enabled with OPENER_BENCHMARK. Every case repeats one operation on
+ *  prepared data for a fixed time measured with GetMicroSeconds() and
+ *  reports the time per operation in nanoseconds and the bytes requested
+ *  from CipCalloc() per operation. The numbers are a regression baseline:
+ *  compare runs of the same build type on the same platform only.
+ *
+ *  The host build runs the cases from the OpENer_benchmark executable, the
+ *  ESP32 firmware once at start up before the OpENer task is created.
+ */
+
+#include <stddef.h>
+
+#include "typedefs.h"
+#include "opener_user_conf.h"
+
+#if OPENER_BENCHMARK
+
+/** @brief Run all cases and print one result line per case to stdout
+ *
+ * Needs the initialized CIP stack including the application's assemblies
+ * (CipStackInit()). Must not run concurrently with the network handler.
+ */
+void BenchmarkRunAll(void);
+
+/** @brief Account an allocation to the case that is running
+ *
+ * Called from the application's CipCalloc().
+ *
+ * @param size number of bytes requested
+ */
+void BenchmarkCountAllocation(const size_t size);
+
+#endif /* OPENER_BENCHMARK */
+
+#endif /* OPENER_BENCHMARK_H_ */
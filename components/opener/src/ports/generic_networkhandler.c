@@ -20,12 +20,68 @@
 #include "trace.h"
 #include "opener_error.h"
 #include "encap.h"
+#include "cipconnectionmanager.h"
 #include "ciptcpipinterface.h"
 #include "opener_user_conf.h"
 #include "cipqos.h"
+#include "messagebufferpool.h"
+#include "loop_profile.h"
+#include "tcp_transport.h"
+#include "overload_governor.h"
+#include "latency_probe.h"
 
 #define MAX_NO_OF_TCP_SOCKETS 10
 
+#ifndef OPENER_IO_RECEIVE_BATCH
+/** Datagrams read from the UDP I/O socket per select() wake-up */
+#define OPENER_IO_RECEIVE_BATCH OPENER_CIP_NUM_ACTIVE_CONNS
+#endif
+
+#ifndef OPENER_TICKLESS_IDLE
+/** Wait for the next deadline instead of one timer tick while no connection
+ * is open */
+#define OPENER_TICKLESS_IDLE 0
+#endif
+
+#ifndef OPENER_TICKLESS_IDLE_MAX_SLEEP_MS
+/** Longest idle wait, the platform loop checks for a stop request between */
+#define OPENER_TICKLESS_IDLE_MAX_SLEEP_MS 1000
+#endif
+
+#ifndef OPENER_EXPLICIT_REQUESTS_PER_LOOP
+/** Explicit requests taken from all TCP sessions per loop iteration, 0 for
+ * no limit */
+#define OPENER_EXPLICIT_REQUESTS_PER_LOOP (2U * OPENER_TCP_TRANSMIT_QUEUE_LENGTH)
+#endif
+
+#ifndef OPENER_IO_RECEIVE_BUDGET_US
+/** Time in microseconds spent reading the UDP I/O socket per select()
+ * wake-up, 0 for no time limit */
+#define OPENER_IO_RECEIVE_BUDGET_US 0
+#endif
+
+#ifndef OPENER_TCP_ACCEPTS_PER_LOOP
+/** Connections taken from the TCP listen backlog per select() wake-up */
+#define OPENER_TCP_ACCEPTS_PER_LOOP OPENER_NUMBER_OF_SUPPORTED_SESSIONS
+#endif
+
+#ifndef OPENER_CIP_SECURITY
+/** TLS and DTLS sessions on port 2221 of the platform, see networkhandler.h */
+#define OPENER_CIP_SECURITY 0
+#endif
+
+#ifndef OPENER_CIP_SECURITY_ONLY
+/** Do not listen on the unsecured TCP port */
+#define OPENER_CIP_SECURITY_ONLY 0
+#endif
+
+#ifndef OPENER_UDP_TOS_CONTROL_MESSAGE
+/** Mark every produced frame with an IP_TOS control message of its sendmsg()
+ * instead of setting IP_TOS on the shared UDP I/O socket when the DSCP
+ * changes, for IP stacks that take IP_TOS as ancillary data */
+#define OPENER_UDP_TOS_CONTROL_MESSAGE 0
+#endif
+
 /** @brief Ethernet/IP standard port */
 
 /* ----- Windows size_t PRI macros ------------- */
@@ -59,6 +115,67 @@
 
 SocketTimer g_timestamps[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
 
+/** Registered socket timers, least recently active first */
+static SocketTimerList s_socket_timer_list;
+
+#ifndef OPENER_SOCKET_HANDLE_COUNT
+/** Socket handles are numbered from OPENER_SOCKET_HANDLE_BASE, select()
+ * only takes handles below FD_SETSIZE */
+#define OPENER_SOCKET_HANDLE_BASE 0
+#define OPENER_SOCKET_HANDLE_COUNT FD_SETSIZE
+#endif
+
+/** Socket timer of each socket handle, NULL for sockets without one */
+static SocketTimer *s_socket_timer_by_handle[OPENER_SOCKET_HANDLE_COUNT];
+
+/** Unused entries of g_timestamps */
+static SocketTimer *s_free_socket_timers[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
+static size_t s_free_socket_timer_count;
+
+/** @brief An accepted TCP connection */
+typedef struct {
+  int socket; /**< kEipInvalidSocket while the entry is unused */
+  CipUdint peer_address; /**< network byte order */
+  EipBool8 secure; /**< a TLS session of the CIP Security transport */
+} TcpConnection;
+
+/** @brief Accepted TCP connections, one per session at most
+ *
+ * A connection beyond OPENER_NUMBER_OF_SUPPORTED_SESSIONS could never
+ * register a session, so it is closed right after accept(). */
+static TcpConnection s_tcp_connections[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
+
+/** @brief Frame reassembly per TCP session */
+static TcpReceiveBuffer g_tcp_receive_buffers[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
+
+/** @brief Replies not yet taken by the IP stack per TCP session */
+static TcpTransmitQueue g_tcp_transmit_queues[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
+
+/** @brief Explicit request rate limit per TCP session */
+static TcpRequestBucket g_tcp_request_buckets[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
+
+/** @brief TCP socket the next loop iteration reads first */
+static int s_next_tcp_socket = 0;
+
+/** @brief Receive buffer of the UDP sockets and the explicit responses
+ *
+ * Static instead of on the OpENer task stack. They are only used under the
+ * stack lock, one datagram or frame at a time. The receive buffer is not
+ * cleared, only the received octets are decoded. */
+static CipOctet s_udp_receive_buffer[PC_OPENER_ETHERNET_BUFFER_SIZE];
+static ENIPMessage s_udp_response;
+static ENIPMessage s_tcp_response;
+
+#if OPENER_CIP_SECURITY
+/** UDP socket of the DTLS sessions, owned by the platform */
+static int s_secure_io_socket = kEipInvalidSocket;
+#endif
+
+#if !OPENER_IO_EVENT_BACKEND && !OPENER_UDP_TOS_CONTROL_MESSAGE
+/** DSCP last set on the UDP I/O socket, above the DSCP range if unknown */
+static CipUsint s_io_socket_dscp = 0xFF;
+#endif
+
 //EipUint8 g_ethernet_communication_buffer[PC_OPENER_ETHERNET_BUFFER_SIZE]; /**< communication buffer */
 /* global vars */
 fd_set master_socket;
@@ -86,6 +203,19 @@ TimeoutCheckerFunction timeout_checker_array[OPENER_TIMEOUT_CHECKER_ARRAY_SIZE];
  */
 void CheckAndHandleTcpListenerSocket(void);
 
+/** @brief Get a static response message ready for the next response
+ *
+ * Holds zeros like an initialized message: it starts out zero-filled and
+ * EndResponse() clears only the octets the previous response wrote.
+ */
+static ENIPMessage *BeginResponse(ENIPMessage *const message);
+
+/** @brief Clear a static response message after it has been sent or queued
+ *
+ * A pooled buffer is released instead, the transmit queue may still hold it.
+ */
+static void EndResponse(ENIPMessage *const message);
+
 /** @brief Checks and processes request received via the UDP unicast socket, currently the implementation is port-specific
  *
  */
@@ -104,69 +234,251 @@ void CheckAndHandleConsumingUdpSocket(void);
 /** @brief Handles data on an established TCP connection, processed connection is given by socket
  *
  *  @param socket The socket to be processed
- *  @return kEipStatusOk on success, or kEipStatusError on failure
+ *  @param request_budget Requests that may still be handled in this loop
+ *         iteration, reduced by the requests handled
+ *  @return kEipStatusOk on success, also when a request closed the socket,
+ *          or kEipStatusError on failure
  */
-EipStatus HandleDataOnTcpSocket(int socket);
+EipStatus HandleDataOnTcpSocket(int socket,
+                                size_t *const request_budget);
+
+static bool TcpSocketIsOpen(const int socket_handle);
 
-void CheckEncapsulationInactivity(int socket_handle);
+static EipBool8 TcpSocketIsSecure(const int socket_handle);
+
+static void SendPendingTcpReplies(void);
+
+void CheckEncapsulationInactivity(void);
 
 void RemoveSocketTimerFromList(const int socket_handle);
 
-static NetworkInterfaceCounters g_network_interface_counters;
+/* Only ever added to, read or exchanged against 0, each with one atomic
+ * operation: the web UI and the Ethernet Link object read them from other
+ * tasks. On 32 bit targets the 64 bit operations come from libatomic. */
+static NetworkTrafficCounters s_traffic_counters[kNetworkTrafficClassCount];
+static CipUlint s_dropped_counters[kNetworkDropReasonCount];
 
-static void NetworkCountersRecordRx(size_t bytes, EipBool8 is_multicast) {
-  g_network_interface_counters.in_octets += (CipUdint)bytes;
-  if (is_multicast) {
-    g_network_interface_counters.in_nucast_packets++;
-  } else {
-    g_network_interface_counters.in_ucast_packets++;
-  }
+static void NetworkCounterAdd(CipUlint *const counter, const size_t value) {
+  __atomic_fetch_add(counter, (CipUlint)value, __ATOMIC_RELAXED);
 }
 
-static void NetworkCountersRecordTx(size_t bytes, EipBool8 is_multicast) {
-  g_network_interface_counters.out_octets += (CipUdint)bytes;
-  if (is_multicast) {
-    g_network_interface_counters.out_nucast_packets++;
-  } else {
-    g_network_interface_counters.out_ucast_packets++;
-  }
+static void NetworkCountersRecordRx(const NetworkTrafficClass traffic_class,
+                                    const size_t bytes,
+                                    const EipBool8 is_multicast) {
+  NetworkTrafficCounters *const counters = &s_traffic_counters[traffic_class];
+  NetworkCounterAdd(&counters->in_octets, bytes);
+  NetworkCounterAdd(is_multicast ? &counters->in_nucast_packets :
+                    &counters->in_ucast_packets, 1);
 }
 
-static void NetworkCountersRecordRxError(void) {
-  g_network_interface_counters.in_errors++;
+static void NetworkCountersRecordTx(const NetworkTrafficClass traffic_class,
+                                    const size_t bytes,
+                                    const EipBool8 is_multicast) {
+  NetworkTrafficCounters *const counters = &s_traffic_counters[traffic_class];
+  NetworkCounterAdd(&counters->out_octets, bytes);
+  NetworkCounterAdd(is_multicast ? &counters->out_nucast_packets :
+                    &counters->out_ucast_packets, 1);
 }
 
-static void NetworkCountersRecordTxError(void) {
-  g_network_interface_counters.out_errors++;
+static void NetworkCountersRecordRxError(
+  const NetworkTrafficClass traffic_class) {
+  NetworkCounterAdd(&s_traffic_counters[traffic_class].in_errors, 1);
 }
 
-static void NetworkCountersRecordRxDiscard(void) {
-  g_network_interface_counters.in_discards++;
+static void NetworkCountersRecordTxError(
+  const NetworkTrafficClass traffic_class) {
+  NetworkCounterAdd(&s_traffic_counters[traffic_class].out_errors, 1);
 }
 
-static void NetworkCountersRecordTxDiscard(void) {
-  g_network_interface_counters.out_discards++;
+static void NetworkCountersRecordDrop(const NetworkDropReason reason) {
+  NetworkCounterAdd(&s_dropped_counters[reason], 1);
 }
 
-const NetworkInterfaceCounters *NetworkGetInterfaceCounters(void) {
-  return &g_network_interface_counters;
+static CipUlint NetworkCounterTake(CipUlint *const counter, const bool clear) {
+  return clear ? __atomic_exchange_n(counter, 0, __ATOMIC_RELAXED) :
+         __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static void NetworkCountersTake(NetworkInterfaceCounters *const counters,
+                                const bool clear) {
+  memset(counters, 0, sizeof(*counters) );
+  for(size_t i = 0; i < kNetworkTrafficClassCount; ++i) {
+    NetworkTrafficCounters *const source = &s_traffic_counters[i];
+    NetworkTrafficCounters *const traffic = &counters->traffic[i];
+    traffic->in_octets = NetworkCounterTake(&source->in_octets, clear);
+    traffic->in_ucast_packets =
+      NetworkCounterTake(&source->in_ucast_packets, clear);
+    traffic->in_nucast_packets =
+      NetworkCounterTake(&source->in_nucast_packets, clear);
+    traffic->in_errors = NetworkCounterTake(&source->in_errors, clear);
+    traffic->out_octets = NetworkCounterTake(&source->out_octets, clear);
+    traffic->out_ucast_packets =
+      NetworkCounterTake(&source->out_ucast_packets, clear);
+    traffic->out_nucast_packets =
+      NetworkCounterTake(&source->out_nucast_packets, clear);
+    traffic->out_errors = NetworkCounterTake(&source->out_errors, clear);
+
+    counters->in_octets += traffic->in_octets;
+    counters->in_ucast_packets += traffic->in_ucast_packets;
+    counters->in_nucast_packets += traffic->in_nucast_packets;
+    counters->in_errors += traffic->in_errors;
+    counters->out_octets += traffic->out_octets;
+    counters->out_ucast_packets += traffic->out_ucast_packets;
+    counters->out_nucast_packets += traffic->out_nucast_packets;
+    counters->out_errors += traffic->out_errors;
+  }
+  for(size_t i = 0; i < kNetworkDropReasonCount; ++i) {
+    counters->dropped[i] = NetworkCounterTake(&s_dropped_counters[i], clear);
+    if(kNetworkDropPartialSend == i) {
+      counters->out_discards += counters->dropped[i];
+    } else {
+      counters->in_discards += counters->dropped[i];
+    }
+  }
+}
+
+void NetworkGetInterfaceCounters(NetworkInterfaceCounters *counters) {
+  NetworkCountersTake(counters, false);
+}
+
+void NetworkGetAndClearInterfaceCounters(NetworkInterfaceCounters *counters) {
+  NetworkCountersTake(counters, true);
 }
 
 void NetworkResetInterfaceCounters(void) {
-  memset(&g_network_interface_counters, 0, sizeof(g_network_interface_counters));
+  NetworkInterfaceCounters counters;
+  NetworkCountersTake(&counters, true);
+}
+
+/* Written by the OpENer task only, read by the web UI */
+static NetworkIdleStatistics s_idle_statistics;
+
+void NetworkGetIdleStatistics(NetworkIdleStatistics *statistics) {
+  statistics->tick_waits =
+    NetworkCounterTake(&s_idle_statistics.tick_waits, false);
+  statistics->tick_wait_time_ms =
+    NetworkCounterTake(&s_idle_statistics.tick_wait_time_ms, false);
+  statistics->idle_waits =
+    NetworkCounterTake(&s_idle_statistics.idle_waits, false);
+  statistics->idle_wait_time_ms =
+    NetworkCounterTake(&s_idle_statistics.idle_wait_time_ms, false);
+}
+
+/** @brief Time select() may wait before the loop has work to do
+ *
+ * Connections and timeout checkers need ManageConnections() every timer
+ * tick. Without them only the encapsulation inactivity timeout and delayed
+ * ListIdentity replies are due, so with OPENER_TICKLESS_IDLE the wait lasts
+ * until the earlier of both, at most OPENER_TICKLESS_IDLE_MAX_SLEEP_MS.
+ */
+static MilliSeconds NetworkHandlerGetWaitTime(void) {
+  const MilliSeconds tick_wait =
+    (g_network_status.elapsed_time < kOpenerTimerTickInMilliSeconds) ?
+    kOpenerTimerTickInMilliSeconds - g_network_status.elapsed_time : 0;
+#if OPENER_TICKLESS_IDLE
+  if(NULL != connection_list.first) {
+    return tick_wait;
+  }
+  for(size_t i = 0; i < OPENER_TIMEOUT_CHECKER_ARRAY_SIZE; i++) {
+    if(NULL != timeout_checker_array[i]) {
+      return tick_wait;
+    }
+  }
+
+  MilliSeconds wait = OPENER_TICKLESS_IDLE_MAX_SLEEP_MS;
+  MilliSeconds remaining_time = 0;
+  if( GetNextDelayedEncapsulationMessage(&remaining_time) ) {
+    /* sent by ManageConnections(), which runs once a tick has elapsed */
+    remaining_time = (remaining_time > g_network_status.elapsed_time) ?
+                     remaining_time - g_network_status.elapsed_time : 0;
+    if(remaining_time < tick_wait) {
+      remaining_time = tick_wait;
+    }
+    if(remaining_time < wait) {
+      wait = remaining_time;
+    }
+  }
+  SocketTimer *const oldest = SocketTimerListGetOldest(
+    &s_socket_timer_list);
+  if(0 < g_tcpip.encapsulation_inactivity_timeout && NULL != oldest) {
+    const MilliSeconds timeout =
+      (MilliSeconds) (1000UL * g_tcpip.encapsulation_inactivity_timeout);
+    const MilliSeconds idle_time =
+      (MilliSeconds) (g_actual_time - SocketTimerGetLastUpdate(oldest) );
+    remaining_time = (idle_time < timeout) ? timeout - idle_time : 0;
+    if(remaining_time < wait) {
+      wait = remaining_time;
+    }
+  }
+  return wait;
+#else
+  return tick_wait;
+#endif /* OPENER_TICKLESS_IDLE */
+}
+
+void NetworkHandlerReceivedIoMessage(const CipOctet *const data,
+                                     const size_t length,
+                                     struct sockaddr_in *from_address)
+{
+  if(0 == length) {
+    NetworkCountersRecordDrop(kNetworkDropEmptyDatagram);
+    return;
+  }
+  NetworkCountersRecordRx(kNetworkTrafficImplicitIo, length, false);
+  HandleReceivedConnectedData(data, (int)length, from_address);
+}
+
+void NetworkHandlerReceivedSecureIoMessage(const CipOctet *const data,
+                                           const size_t length,
+                                           struct sockaddr_in *from_address)
+{
+  if(0 == length) {
+    NetworkCountersRecordDrop(kNetworkDropEmptyDatagram);
+    return;
+  }
+  NetworkCountersRecordRx(kNetworkTrafficImplicitIo, length, false);
+  HandleReceivedSecureConnectedData(data, (int)length, from_address);
+}
+
+void NetworkHandlerDiscardedIoMessages(const NetworkDropReason reason,
+                                       const size_t count) {
+  NetworkCounterAdd(&s_dropped_counters[reason], count);
 }
 
 /*************************************************
 * Function implementations from now on
 *************************************************/
 
+void NetworkHandlerInitializeSessions(void) {
+  SocketTimerArrayInitialize(g_timestamps, OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+  SocketTimerListInitialize(&s_socket_timer_list);
+  memset(s_socket_timer_by_handle, 0, sizeof(s_socket_timer_by_handle) );
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
+    /* handed out from the start of the table */
+    s_free_socket_timers[i] =
+      &g_timestamps[OPENER_NUMBER_OF_SUPPORTED_SESSIONS - 1 - i];
+  }
+  s_free_socket_timer_count = OPENER_NUMBER_OF_SUPPORTED_SESSIONS;
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
+    s_tcp_connections[i].socket = kEipInvalidSocket;
+    s_tcp_connections[i].peer_address = 0;
+    s_tcp_connections[i].secure = false;
+  }
+  TcpReceiveBufferArrayInitialize(g_tcp_receive_buffers,
+                                  OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+  TcpTransmitQueueArrayInitialize(g_tcp_transmit_queues,
+                                  OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+  TcpRequestBucketArrayInitialize(g_tcp_request_buckets,
+                                  OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+}
+
 EipStatus NetworkHandlerInitialize(void) {
 
   if( kEipStatusOk != NetworkHandlerInitializePlatform() ) {
     return kEipStatusError;
   }
 
-  SocketTimerArrayInitialize(g_timestamps, OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+  NetworkHandlerInitializeSessions();
   /* Activate the current DSCP values to become the used set of values. */
   CipQosUpdateUsedSetQosValues();
   /* Make sure the multicast configuration matches the current IP address. */
@@ -386,6 +698,7 @@ EipStatus NetworkHandlerInitialize(void) {
     /* print message but don't abort by intent */
   }
 
+#if !OPENER_CIP_SECURITY_ONLY
   /* switch socket in listen mode */
   if( ( listen(g_network_status.tcp_listener,
                MAX_NO_OF_TCP_SOCKETS) ) == -1 ) {
@@ -401,6 +714,7 @@ EipStatus NetworkHandlerInitialize(void) {
 
   /* add the listener socket to the master set */
   FD_SET(g_network_status.tcp_listener, &master_socket);
+#endif /* the bound listener refuses connections without listen() */
   FD_SET(g_network_status.udp_unicast_listener, &master_socket);
   FD_SET(g_network_status.udp_global_broadcast_listener, &master_socket);
 
@@ -410,6 +724,19 @@ EipStatus NetworkHandlerInitialize(void) {
                                        0,
                                        g_network_status.udp_unicast_listener);
 
+#if OPENER_CIP_SECURITY
+  s_secure_io_socket = SecureTransportOpen();
+  if(kEipInvalidSocket == s_secure_io_socket) {
+    OPENER_TRACE_ERR("networkhandler: CIP Security transport not started\n");
+    /* print message but don't abort by intent */
+  } else {
+    FD_SET(s_secure_io_socket, &master_socket);
+    if(s_secure_io_socket > highest_socket_handle) {
+      highest_socket_handle = s_secure_io_socket;
+    }
+  }
+#endif
+
   g_last_time = GetMilliSeconds(); /* initialize time keeping */
   g_network_status.elapsed_time = 0;
   NetworkResetInterfaceCounters();
@@ -418,24 +745,117 @@ EipStatus NetworkHandlerInitialize(void) {
 }
 
 void CloseUdpSocket(int socket_handle) {
+#if OPENER_IO_EVENT_BACKEND
+  if(kOpenerIoEndpointHandle == socket_handle) {
+    return; /* shared by all I/O connections, closed in NetworkHandlerFinish() */
+  }
+#endif
   OPENER_TRACE_STATE("Closing UDP socket %d\n", socket_handle);
   CloseSocket(socket_handle);
 }
 
+static TcpConnection *FindTcpConnection(const int socket_handle) {
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
+    if(socket_handle == s_tcp_connections[i].socket) {
+      return &s_tcp_connections[i];
+    }
+  }
+  return NULL;
+}
+
+static bool TcpSocketIsOpen(const int socket_handle) {
+  return FD_ISSET(socket_handle, &master_socket);
+}
+
+static EipBool8 TcpSocketIsSecure(const int socket_handle) {
+#if OPENER_CIP_SECURITY
+  if(kEipInvalidSocket == socket_handle) {
+    return false;
+  }
+  const TcpConnection *const connection = FindTcpConnection(socket_handle);
+  return NULL != connection && connection->secure;
+#else
+  (void) socket_handle;
+  return false;
+#endif
+}
+
 void CloseTcpSocket(int socket_handle) {
   OPENER_TRACE_STATE("Closing TCP socket %d\n", socket_handle);
+  TcpConnection *const connection = FindTcpConnection(socket_handle);
+#if OPENER_CIP_SECURITY
+  if(NULL != connection && connection->secure) {
+    SecureTransportCloseSession(socket_handle); /* close_notify before the FIN */
+  }
+#endif
   ShutdownSocketPlatform(socket_handle);
   RemoveSocketTimerFromList(socket_handle);
+  if(NULL != connection) {
+    connection->socket = kEipInvalidSocket;
+    connection->peer_address = 0;
+    connection->secure = false;
+  }
+  TcpReceiveBuffer *receive_buffer = TcpReceiveBufferArrayGetBuffer(
+    g_tcp_receive_buffers,
+    OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+    socket_handle);
+  if(NULL != receive_buffer) {
+    TcpReceiveBufferClear(receive_buffer);
+  }
+  TcpTransmitQueue *transmit_queue = TcpTransmitQueueArrayGetQueue(
+    g_tcp_transmit_queues,
+    OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+    socket_handle);
+  if(NULL != transmit_queue) {
+    TcpTransmitQueueClear(transmit_queue);
+  }
+  TcpRequestBucket *request_bucket = TcpRequestBucketArrayGetBucket(
+    g_tcp_request_buckets,
+    OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+    socket_handle);
+  if(NULL != request_bucket) {
+    TcpRequestBucketClear(request_bucket);
+  }
   CloseSocket(socket_handle);
 }
 
+static bool SocketHandleInTimerTable(const int socket_handle) {
+  return socket_handle >= OPENER_SOCKET_HANDLE_BASE &&
+         socket_handle - OPENER_SOCKET_HANDLE_BASE <
+         OPENER_SOCKET_HANDLE_COUNT;
+}
+
+static SocketTimer *GetSocketTimer(const int socket_handle) {
+  if( !SocketHandleInTimerTable(socket_handle) ) {
+    return NULL;
+  }
+  return s_socket_timer_by_handle[socket_handle - OPENER_SOCKET_HANDLE_BASE];
+}
+
+void AddSocketTimerToList(const int socket_handle) {
+  SocketTimer *socket_timer = GetSocketTimer(socket_handle);
+  if(NULL == socket_timer) {
+    if( !SocketHandleInTimerTable(socket_handle) ||
+        0 == s_free_socket_timer_count ) {
+      OPENER_TRACE_ERR("networkhandler: no socket timer for socket %d\n",
+                       socket_handle);
+      return;
+    }
+    socket_timer = s_free_socket_timers[--s_free_socket_timer_count];
+    s_socket_timer_by_handle[socket_handle - OPENER_SOCKET_HANDLE_BASE] =
+      socket_timer;
+    SocketTimerSetSocket(socket_timer, socket_handle);
+  }
+  SocketTimerListUpdate(&s_socket_timer_list, socket_timer, g_actual_time);
+}
+
 void RemoveSocketTimerFromList(const int socket_handle) {
-  SocketTimer *socket_timer = NULL;
-  while( NULL != ( socket_timer = SocketTimerArrayGetSocketTimer(g_timestamps,
-                                                                 OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
-                                                                 socket_handle) ) )
-  {
+  SocketTimer *socket_timer = GetSocketTimer(socket_handle);
+  if(NULL != socket_timer) {
+    SocketTimerListRemove(&s_socket_timer_list, socket_timer);
+    s_socket_timer_by_handle[socket_handle - OPENER_SOCKET_HANDLE_BASE] = NULL;
     SocketTimerClear(socket_timer);
+    s_free_socket_timers[s_free_socket_timer_count++] = socket_timer;
   }
 }
 
@@ -453,79 +873,227 @@ EipBool8 CheckSocketSet(int socket) {
   return return_value;
 }
 
-void CheckAndHandleTcpListenerSocket(void) {
-  int new_socket = kEipInvalidSocket;
-  /* see if this is a connection request to the TCP listener*/
-  if( true == CheckSocketSet(g_network_status.tcp_listener) ) {
-    OPENER_TRACE_INFO("networkhandler: new TCP connection\n");
-
-    new_socket = accept(g_network_status.tcp_listener, NULL, NULL);
-    if(new_socket == kEipInvalidSocket) {
-      int error_code = GetSocketErrorNumber();
-      char *error_message = GetErrorMessage(error_code);
-      OPENER_TRACE_ERR("networkhandler: error on accept: %d - %s\n",
-                       error_code, error_message);
-      FreeErrorMessage(error_message);
-      return;
-    } OPENER_TRACE_INFO(">>> network handler: accepting new TCP socket: %d \n",
-                        new_socket);
-
-    /* MODIFICATION: Disable Nagle's algorithm for low latency EtherNet/IP explicit messaging
-     * Added by: Adam G. Sweeney <agsweeney@gmail.com>
-     * Rationale: Nagle's algorithm can delay small packets, increasing latency for
-     * EtherNet/IP explicit messaging. Disabling TCP_NODELAY ensures immediate packet
-     * transmission, improving real-time performance for industrial communication.
-     */
-    int flag = 1;
-    if(setsockopt(new_socket, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(flag)) < 0) {
-      int error_code = GetSocketErrorNumber();
-      char *error_message = GetErrorMessage(error_code);
-      OPENER_TRACE_WARN("networkhandler: failed to set TCP_NODELAY on new TCP socket %d: %d - %s\n",
-                        new_socket, error_code, error_message);
-      FreeErrorMessage(error_message);
+/** @brief Connection a known I/O originator may take the place of
+ *
+ * Only connections from other peers are given up. One that never registered
+ * a session goes first, else the one idle for the longest time.
+ *
+ * @return The connection to close, NULL if all belong to I/O originators
+ */
+static TcpConnection *GetTcpConnectionToEvict(void) {
+  TcpConnection *evict = NULL;
+  MilliSeconds evict_idle_time = 0;
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
+    TcpConnection *const connection = &s_tcp_connections[i];
+    if(IsIoConnectionOriginator(connection->peer_address) ) {
+      continue;
+    }
+    SocketTimer *const socket_timer = GetSocketTimer(connection->socket);
+    if(NULL == socket_timer) {
+      return connection;
+    }
+    const MilliSeconds idle_time = g_actual_time -
+                                   SocketTimerGetLastUpdate(socket_timer);
+    if(NULL == evict || idle_time > evict_idle_time) {
+      evict = connection;
+      evict_idle_time = idle_time;
     }
+  }
+  return evict;
+}
 
-    SocketTimer *socket_timer = SocketTimerArrayGetEmptySocketTimer(
-      g_timestamps,
-      OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+/** @brief Decide at accept() whether a new TCP connection may stay
+ *
+ * While sessions are free every connection is taken. Once all are in use
+ * only an originator of an established I/O connection gets in, in place of
+ * a connection from another peer. While the overload governor sheds
+ * sessions only such originators are taken.
+ *
+ * @param peer_address address of the peer, network byte order
+ * @return The entry for the new connection, NULL to close it at once
+ */
+static TcpConnection *AdmitTcpConnection(const CipUdint peer_address) {
+  const EipBool8 is_io_originator = IsIoConnectionOriginator(peer_address);
+  if(!is_io_originator && OverloadGovernorIsShedding(kOverloadStageSessions) ) {
+    OPENER_TRACE_WARN("networkhandler: overloaded, no new sessions\n");
+    return NULL;
+  }
+  TcpConnection *connection = FindTcpConnection(kEipInvalidSocket);
+  if(NULL != connection) {
+    return connection;
+  }
+  OPENER_TRACE_WARN("networkhandler: all %u sessions in use\n",
+                    (unsigned) OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+  if(!is_io_originator) {
+    return NULL;
+  }
+  connection = GetTcpConnectionToEvict();
+  if(NULL == connection) {
+    return NULL;
+  }
+  const int evicted_socket = connection->socket;
+  OPENER_TRACE_WARN(
+    "networkhandler: closing TCP socket %d for a connection of an I/O originator\n",
+    evicted_socket);
+  CloseTcpSocket(evicted_socket); /* frees the entry */
+  RemoveSession(evicted_socket);
+  return connection;
+}
 
-//    OPENER_TRACE_INFO("Current time stamp: %ld\n", g_actual_time);
-//    for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; i++) {
-//      OPENER_TRACE_INFO("Socket: %d - Last Update: %ld\n",
-//                        g_timestamps[i].socket,
-//                        g_timestamps[i].last_update);
-//    }
+/** @brief Take a connected socket into the TCP sessions, or close it
+ *
+ * @param new_socket the socket
+ * @param peer_address address of the peer, network byte order
+ * @param secure the socket carries an established TLS session
+ */
+static void AddTcpConnection(const int new_socket,
+                             const CipUdint peer_address,
+                             const EipBool8 secure) {
+  TcpConnection *const connection = AdmitTcpConnection(peer_address);
+  if(NULL == connection) {
+    OPENER_TRACE_WARN("networkhandler: refusing TCP socket %d\n",
+                      new_socket);
+#if OPENER_CIP_SECURITY
+    if(secure) {
+      SecureTransportCloseSession(new_socket);
+    }
+#endif
+    CloseSocketPlatform(new_socket);
+    return;
+  }
+  connection->socket = new_socket;
+  connection->peer_address = peer_address;
+  connection->secure = secure;
+  OPENER_TRACE_INFO(">>> network handler: accepting new TCP socket: %d \n",
+                    new_socket);
+
+  /* TCP_NODELAY and keepalive */
+  TcpTransportConfigureSocket(new_socket,
+                              g_tcpip.encapsulation_inactivity_timeout);
+
+  OPENER_ASSERT(0 != s_free_socket_timer_count);
+
+  FD_SET(new_socket, &master_socket);
+  /* add newfd to master set */
+  if(new_socket > highest_socket_handle) {
+    OPENER_TRACE_INFO("New highest socket: %d\n", new_socket);
+    highest_socket_handle = new_socket;
+  }
 
-    OPENER_ASSERT(socket_timer != NULL);
+  OPENER_TRACE_STATE("networkhandler: opened new TCP connection on fd %d\n",
+                     new_socket);
+}
 
-    FD_SET(new_socket, &master_socket);
-    /* add newfd to master set */
-    if(new_socket > highest_socket_handle) {
-      OPENER_TRACE_INFO("New highest socket: %d\n", new_socket);
-      highest_socket_handle = new_socket;
-    }
+#if OPENER_CIP_SECURITY
+/** @brief Take the TLS sessions whose handshake the platform completed */
+static void CheckAndTakeSecureTcpSessions(void) {
+  CipUdint peer_address = 0;
+  int new_socket = kEipInvalidSocket;
+  while( kEipInvalidSocket !=
+         ( new_socket = SecureTransportTakeSession(&peer_address) ) ) {
+    AddTcpConnection(new_socket, peer_address, true);
+  }
+}
+#endif
 
-    OPENER_TRACE_STATE("networkhandler: opened new TCP connection on fd %d\n",
-                       new_socket);
+void CheckAndHandleTcpListenerSocket(void) {
+  /* see if this is a connection request to the TCP listener*/
+  if( true != CheckSocketSet(g_network_status.tcp_listener) ) {
+    return;
+  }
+  /* After a network outage all clients reconnect at once. The backlog is
+   * drained in one go, bounded so the I/O connections are not held off. */
+  for(size_t accepted = 0; accepted < OPENER_TCP_ACCEPTS_PER_LOOP; ++accepted) {
+    struct sockaddr_in peer_address = { 0 };
+    socklen_t peer_address_length = sizeof(peer_address);
+    const int new_socket = accept(g_network_status.tcp_listener,
+                                  (struct sockaddr *) &peer_address,
+                                  &peer_address_length);
+    if(new_socket == kEipInvalidSocket) {
+      int error_code = GetSocketErrorNumber();
+      if(OPENER_SOCKET_WOULD_BLOCK != error_code) {
+        char *error_message = GetErrorMessage(error_code);
+        OPENER_TRACE_ERR("networkhandler: error on accept: %d - %s\n",
+                         error_code, error_message);
+        FreeErrorMessage(error_message);
+      }
+      return;
+    }
+    AddTcpConnection(new_socket, peer_address.sin_addr.s_addr, false);
   }
 }
 
 EipStatus NetworkHandlerProcessCyclic(void) {
 
   read_socket = master_socket;
+  /* A socket whose replies are still queued is not read, its next requests
+   * wait in the TCP window. select() returns once it can take more. */
+  fd_set write_socket;
+  FD_ZERO(&write_socket);
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
+    if( TcpTransmitQueueIsPending(&g_tcp_transmit_queues[i]) ) {
+      FD_CLR(g_tcp_transmit_queues[i].socket, &read_socket);
+      FD_SET(g_tcp_transmit_queues[i].socket, &write_socket);
+    }
+  }
 
-  g_time_value.tv_sec = 0;
-  g_time_value.tv_usec =
-    (g_network_status.elapsed_time <
-     kOpenerTimerTickInMilliSeconds ? kOpenerTimerTickInMilliSeconds -
-     g_network_status.elapsed_time : 0)
-    * 1000; /* 10 ms */
+  /* A session that used up its request rate is not read either, select()
+   * waits at most until its next request has been refilled */
+  MilliSeconds wait_time = NetworkHandlerGetWaitTime();
+  const MilliSeconds now = GetMilliSeconds();
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
+    TcpRequestBucket *const bucket = &g_tcp_request_buckets[i];
+    if(kEipInvalidSocket == bucket->socket ||
+       0 != TcpRequestBucketGetAvailable(bucket, now) ) {
+      continue;
+    }
+    FD_CLR(bucket->socket, &read_socket);
+    const MilliSeconds refill_time = TcpRequestBucketGetRefillTime(bucket);
+    if(refill_time < wait_time) {
+      wait_time = refill_time;
+    }
+  }
+#if OPENER_CIP_SECURITY
+  /* Octets a TLS record held beyond the frame read last are already
+   * decrypted, select() does not report them. A completed handshake is
+   * taken within a tick. */
+  fd_set pending_socket;
+  FD_ZERO(&pending_socket);
+  int number_of_pending_sockets = 0;
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
+    const TcpConnection *const connection = &s_tcp_connections[i];
+    if(connection->secure && FD_ISSET(connection->socket, &read_socket) &&
+       SecureTransportHasPendingData(connection->socket) ) {
+      FD_SET(connection->socket, &pending_socket);
+      number_of_pending_sockets++;
+    }
+  }
+  if(0 != number_of_pending_sockets) {
+    wait_time = 0;
+  } else if(wait_time > kOpenerTimerTickInMilliSeconds &&
+            SecureTransportIsHandshaking() ) {
+    wait_time = kOpenerTimerTickInMilliSeconds;
+  }
+#endif
+  g_time_value.tv_sec = wait_time / 1000U;
+  g_time_value.tv_usec = (wait_time % 1000U) * 1000U;
 
+  const MilliSeconds wait_start = GetMilliSeconds();
+  OPENER_LOOP_PROFILE_BEGIN(select_start);
   int ready_socket = select(highest_socket_handle + 1,
                             &read_socket,
-                            0,
+                            &write_socket,
                             0,
                             &g_time_value);
+  OPENER_LOOP_PROFILE_END(kLoopProfilePhaseSelect, select_start);
+  const MilliSeconds waited = GetMilliSeconds() - wait_start;
+  if(wait_time > kOpenerTimerTickInMilliSeconds) {
+    NetworkCounterAdd(&s_idle_statistics.idle_waits, 1);
+    NetworkCounterAdd(&s_idle_statistics.idle_wait_time_ms, waited);
+  } else {
+    NetworkCounterAdd(&s_idle_statistics.tick_waits, 1);
+    NetworkCounterAdd(&s_idle_statistics.tick_wait_time_ms, waited);
+  }
 
   if(ready_socket == kEipInvalidSocket) {
     if(EINTR == errno) /* we have somehow been interrupted. The default behavior is to go back into the select loop. */
@@ -541,29 +1109,80 @@ EipStatus NetworkHandlerProcessCyclic(void) {
       return kEipStatusError;
     }
   }
+#if OPENER_CIP_SECURITY
+  for(int socket = 0;
+      socket <= highest_socket_handle && 0 != number_of_pending_sockets;
+      ++socket) {
+    if( FD_ISSET(socket, &pending_socket) && !FD_ISSET(socket, &read_socket) ) {
+      FD_SET(socket, &read_socket);
+      ready_socket++;
+    }
+  }
+#endif
+
+  /* The stack is entered once per socket event instead of once per loop, so
+   * a burst of explicit requests leaves the stack to a platform's I/O task
+   * between the requests. */
+  OPENER_LOOP_PROFILE_BEGIN(loop_start);
+  const MicroSeconds busy_start = GetMicroSeconds();
 
   if(ready_socket > 0) {
 
-    CheckAndHandleTcpListenerSocket();
+    OPENER_LOOP_PROFILE_BEGIN(udp_start);
+    NetworkHandlerEnterStack();
     CheckAndHandleUdpUnicastSocket();
     CheckAndHandleUdpGlobalBroadcastSocket();
     CheckAndHandleConsumingUdpSocket();
+#if OPENER_CIP_SECURITY
+    if( kEipInvalidSocket != s_secure_io_socket &&
+        CheckSocketSet(s_secure_io_socket) ) {
+      SecureTransportReceiveIo();
+    }
+#endif
+    OPENER_LOOP_PROFILE_END(kLoopProfilePhaseUdp, udp_start); /* shared with the I/O task */
+    NetworkHandlerLeaveStack();
 
-    for(int socket = 0; socket <= highest_socket_handle; socket++) {
+    OPENER_LOOP_PROFILE_BEGIN(tcp_start);
+    NetworkHandlerEnterStack();
+    CheckAndHandleTcpListenerSocket();
+    NetworkHandlerLeaveStack();
+    /* The sessions are read round robin from the one after the last read
+     * in the previous iteration. Once the loop's request budget is used up
+     * the remaining sockets stay readable and are read first next time, so
+     * the I/O connections are served between the batches of requests. */
+    size_t request_budget = (0 != OPENER_EXPLICIT_REQUESTS_PER_LOOP) ?
+                            OPENER_EXPLICIT_REQUESTS_PER_LOOP : SIZE_MAX;
+    const int number_of_sockets = highest_socket_handle + 1;
+    const int first_socket = (s_next_tcp_socket < number_of_sockets) ?
+                             s_next_tcp_socket : 0;
+    for(int i = 0; i < number_of_sockets && 0 != request_budget; i++) {
+      const int socket = (first_socket + i) % number_of_sockets;
+      if( !FD_ISSET(socket, &read_socket) ) {
+        continue; /* rechecked by CheckSocketSet() with the stack entered */
+      }
+      NetworkHandlerEnterStack();
       if( true == CheckSocketSet(socket) ) {
         /* if it is still checked it is a TCP receive */
-        if( kEipStatusError == HandleDataOnTcpSocket(socket) ) /* if error */
+        s_next_tcp_socket = socket + 1;
+        if( kEipStatusError ==
+            HandleDataOnTcpSocket(socket, &request_budget) &&
+          TcpSocketIsOpen(socket) ) /* if error and not closed already */
         {
           CloseTcpSocket(socket);
           RemoveSession(socket); /* clean up session and close the socket */
         }
       }
+      NetworkHandlerLeaveStack();
     }
+    OPENER_LOOP_PROFILE_END(kLoopProfilePhaseTcp, tcp_start);
   }
 
-  for(int socket = 0; socket <= highest_socket_handle; socket++) {
-    CheckEncapsulationInactivity(socket);
-  }
+  NetworkHandlerEnterStack();
+#if OPENER_CIP_SECURITY
+  CheckAndTakeSecureTcpSessions(); /* completed without a socket event */
+#endif
+  SendPendingTcpReplies();
+  CheckEncapsulationInactivity();
 
   /* Check if all connections from one originator times out */
   //CheckForTimedOutConnectionsAndCloseTCPConnections();
@@ -577,6 +1196,7 @@ EipStatus NetworkHandlerProcessCyclic(void) {
    * This should compensate the jitter of the windows timer
    */
   if(g_network_status.elapsed_time >= kOpenerTimerTickInMilliSeconds) {
+    OPENER_LOOP_PROFILE_BEGIN(manage_start);
     /* call manage_connections() in connection manager every kOpenerTimerTickInMilliSeconds ms */
     ManageConnections(g_network_status.elapsed_time);
 
@@ -588,17 +1208,54 @@ EipStatus NetworkHandlerProcessCyclic(void) {
     }
 
     g_network_status.elapsed_time = 0;
+    OPENER_LOOP_PROFILE_END(kLoopProfilePhaseManageConnections, manage_start);
   }
+  OverloadGovernorRecordLoop(GetMicroSeconds() - busy_start);
+  OverloadGovernorEvaluate(g_actual_time);
+  NetworkHandlerLeaveStack();
+
+  OPENER_LOOP_PROFILE_END(kLoopProfilePhaseLoop, loop_start);
   return kEipStatusOk;
 }
 
 EipStatus NetworkHandlerFinish(void) {
+#if OPENER_CIP_SECURITY
+  if(kEipInvalidSocket != s_secure_io_socket) {
+    /* the socket stays with the platform for the next start */
+    FD_CLR(s_secure_io_socket, &master_socket);
+    SecureTransportClose();
+    s_secure_io_socket = kEipInvalidSocket;
+  }
+#endif
   CloseTcpSocket(g_network_status.tcp_listener);
   CloseUdpSocket(g_network_status.udp_unicast_listener);
   CloseUdpSocket(g_network_status.udp_global_broadcast_listener);
+#if OPENER_IO_EVENT_BACKEND
+  if(kOpenerIoEndpointHandle == g_network_status.udp_io_messaging) {
+    IoEndpointClose();
+    g_network_status.udp_io_messaging = kEipInvalidSocket;
+  }
+#endif
   return kEipStatusOk;
 }
 
+static ENIPMessage *BeginResponse(ENIPMessage *const message) {
+  if(NULL == message->message_buffer) {
+    PrepareENIPMessage(message);
+  }
+  return message;
+}
+
+static void EndResponse(ENIPMessage *const message) {
+  if(message->message_buffer == message->inline_buffer) {
+    ClearENIPMessage(message);
+  } else {
+    /* a pooled buffer may still be queued for sending; the pool clears it
+     * when it hands it out again */
+    ENIPMessageReleasePooledBuffer(message);
+  }
+}
+
 void CheckAndHandleUdpGlobalBroadcastSocket(void) {
   /* see if this is an unsolicited inbound UDP message */
   if( true == CheckSocketSet(g_network_status.udp_global_broadcast_listener) ) {
@@ -609,10 +1266,10 @@ void CheckAndHandleUdpGlobalBroadcastSocket(void) {
       "networkhandler: unsolicited UDP message on EIP global broadcast socket\n");
 
     /* Handle UDP broadcast messages */
-    CipOctet incoming_message[PC_OPENER_ETHERNET_BUFFER_SIZE] = { 0 };
+    CipOctet *const incoming_message = s_udp_receive_buffer;
     int received_size = recvfrom(g_network_status.udp_global_broadcast_listener,
                                  NWBUF_CAST incoming_message,
-                                 sizeof(incoming_message),
+                                 sizeof(s_udp_receive_buffer),
                                  0,
                                  (struct sockaddr *) &from_address,
                                  &from_address_length);
@@ -625,21 +1282,24 @@ void CheckAndHandleUdpGlobalBroadcastSocket(void) {
         error_code,
         error_message);
       FreeErrorMessage(error_message);
+      NetworkCountersRecordRxError(kNetworkTrafficExplicitUdp);
       return;
     }
 
     // Check if packet was truncated
-    if (received_size >= (int)sizeof(incoming_message)) {
+    if (received_size >= (int)sizeof(s_udp_receive_buffer)) {
       OPENER_TRACE_WARN("UDP packet may have been truncated (received: %d, buffer: %zu)\n",
-                        received_size, sizeof(incoming_message));
+                        received_size, sizeof(s_udp_receive_buffer));
+      NetworkCountersRecordDrop(kNetworkDropTruncated);
     }
+    NetworkCountersRecordRx(kNetworkTrafficExplicitUdp, (size_t)received_size,
+                            true);
 
     OPENER_TRACE_INFO("Data received on global broadcast UDP:\n");
 
     const EipUint8 *receive_buffer = &incoming_message[0];
     int remaining_bytes = 0;
-    ENIPMessage outgoing_message;
-    InitializeENIPMessage(&outgoing_message);
+    ENIPMessage *const outgoing_message = BeginResponse(&s_udp_response);
     EipStatus need_to_send = HandleReceivedExplictUdpData(
       g_network_status.udp_unicast_listener,
       /* sending from unicast port, due to strange behavior of the broadcast port */
@@ -648,7 +1308,7 @@ void CheckAndHandleUdpGlobalBroadcastSocket(void) {
       received_size,
       &remaining_bytes,
       false,
-      &outgoing_message);
+      outgoing_message);
 
     receive_buffer += received_size - remaining_bytes;
     received_size = remaining_bytes;
@@ -658,14 +1318,20 @@ void CheckAndHandleUdpGlobalBroadcastSocket(void) {
 
       /* if the active socket matches a registered UDP callback, handle a UDP packet */
       if(sendto( g_network_status.udp_unicast_listener,  /* sending from unicast port, due to strange behavior of the broadcast port */
-                 (char *) outgoing_message.message_buffer,
-                 outgoing_message.used_message_length, 0,
+                 (char *) outgoing_message->message_buffer,
+                 outgoing_message->used_message_length, 0,
                  (struct sockaddr *) &from_address, sizeof(from_address) )
-         != outgoing_message.used_message_length) {
+         != outgoing_message->used_message_length) {
         OPENER_TRACE_INFO(
           "networkhandler: UDP response was not fully sent\n");
+        NetworkCountersRecordTxError(kNetworkTrafficExplicitUdp);
+      }
+      else {
+        NetworkCountersRecordTx(kNetworkTrafficExplicitUdp,
+                                outgoing_message->used_message_length, false);
       }
     }
+    EndResponse(outgoing_message);
     if(remaining_bytes > 0) {
       OPENER_TRACE_ERR("Request on broadcast UDP port had too many data (%d)",
                        remaining_bytes);
@@ -684,10 +1350,10 @@ void CheckAndHandleUdpUnicastSocket(void) {
       "networkhandler: unsolicited UDP message on EIP unicast socket\n");
 
     /* Handle UDP broadcast messages */
-    CipOctet incoming_message[PC_OPENER_ETHERNET_BUFFER_SIZE] = { 0 };
+    CipOctet *const incoming_message = s_udp_receive_buffer;
     int received_size = recvfrom(g_network_status.udp_unicast_listener,
                                  NWBUF_CAST incoming_message,
-                                 sizeof(incoming_message),
+                                 sizeof(s_udp_receive_buffer),
                                  0,
                                  (struct sockaddr *) &from_address,
                                  &from_address_length);
@@ -700,26 +1366,25 @@ void CheckAndHandleUdpUnicastSocket(void) {
          error_code,
          error_message);
        FreeErrorMessage(error_message);
-      NetworkCountersRecordRxError();
+      NetworkCountersRecordRxError(kNetworkTrafficExplicitUdp);
       return;
     }
 
     // Check if packet was truncated
-    if (received_size >= (int)sizeof(incoming_message)) {
+    if (received_size >= (int)sizeof(s_udp_receive_buffer)) {
       OPENER_TRACE_WARN("UDP unicast packet may have been truncated (received: %d, buffer: %zu)\n",
-                        received_size, sizeof(incoming_message));
-      NetworkCountersRecordRxDiscard();
+                        received_size, sizeof(s_udp_receive_buffer));
+      NetworkCountersRecordDrop(kNetworkDropTruncated);
     }
 
     if (received_size > 0) {
-      NetworkCountersRecordRx((size_t)received_size, false);
+      NetworkCountersRecordRx(kNetworkTrafficExplicitUdp, (size_t)received_size, false);
     }
     OPENER_TRACE_INFO("Data received on UDP unicast:\n");
 
     EipUint8 *receive_buffer = &incoming_message[0];
     int remaining_bytes = 0;
-    ENIPMessage outgoing_message;
-    InitializeENIPMessage(&outgoing_message);
+    ENIPMessage *const outgoing_message = BeginResponse(&s_udp_response);
     EipStatus need_to_send = HandleReceivedExplictUdpData(
       g_network_status.udp_unicast_listener,
       &from_address,
@@ -727,7 +1392,7 @@ void CheckAndHandleUdpUnicastSocket(void) {
       received_size,
       &remaining_bytes,
       true,
-      &outgoing_message);
+      outgoing_message);
 
     receive_buffer += received_size - remaining_bytes;
     received_size = remaining_bytes;
@@ -737,19 +1402,21 @@ void CheckAndHandleUdpUnicastSocket(void) {
 
       /* if the active socket matches a registered UDP callback, handle a UDP packet */
       if(sendto( g_network_status.udp_unicast_listener,
-                 (char *) outgoing_message.message_buffer,
-                 outgoing_message.used_message_length, 0,
+                 (char *) outgoing_message->message_buffer,
+                 outgoing_message->used_message_length, 0,
                  (struct sockaddr *) &from_address,
                  sizeof(from_address) ) !=
-         outgoing_message.used_message_length) {
+         outgoing_message->used_message_length) {
         OPENER_TRACE_INFO(
           "networkhandler: UDP unicast response was not fully sent\n");
-        NetworkCountersRecordTxError();
+        NetworkCountersRecordTxError(kNetworkTrafficExplicitUdp);
       }
       else {
-        NetworkCountersRecordTx(outgoing_message.used_message_length, false);
+        NetworkCountersRecordTx(kNetworkTrafficExplicitUdp,
+                                outgoing_message->used_message_length, false);
       }
     }
+    EndResponse(outgoing_message);
     if (remaining_bytes > 0) {
       OPENER_TRACE_ERR(
         "Request on broadcast UDP port had too many data (%d)",
@@ -761,6 +1428,20 @@ void CheckAndHandleUdpUnicastSocket(void) {
 EipStatus SendUdpData(const struct sockaddr_in *const address,
                       const ENIPMessage
                       *const outgoing_message) {
+  return SendUdpFrame(address,
+                      CipQosGetDscpPriority(kConnectionObjectPriorityScheduled),
+                      outgoing_message->message_buffer,
+                      outgoing_message->used_message_length,
+                      NULL,
+                      0);
+}
+
+EipStatus SendUdpFrame(const struct sockaddr_in *const address,
+                       const CipUsint dscp,
+                       const EipUint8 *const header,
+                       const size_t header_length,
+                       const EipUint8 *const payload,
+                       const size_t payload_length) {
 
 #if defined(OPENER_TRACE_ENABLED)
   static char ip_str[INET_ADDRSTRLEN];
@@ -770,54 +1451,222 @@ EipStatus SendUdpData(const struct sockaddr_in *const address,
     ntohs(address->sin_port) );
 #endif
 
-  int sent_length = sendto( g_network_status.udp_io_messaging,
-                            (char *)outgoing_message->message_buffer,
-                            outgoing_message->used_message_length, 0,
-                            (struct sockaddr *) address, sizeof(*address) );
+  const size_t frame_length = header_length + payload_length;
+  const EipBool8 is_multicast = IN_MULTICAST(ntohl(address->sin_addr.s_addr) );
+#if OPENER_IO_EVENT_BACKEND
+  if(kEipStatusOk != IoEndpointSend(address->sin_addr.s_addr,
+                                    address->sin_port,
+                                    dscp,
+                                    header,
+                                    header_length,
+                                    payload,
+                                    payload_length) ) {
+    NetworkCountersRecordTxError(kNetworkTrafficImplicitIo);
+    return kEipStatusError;
+  }
+  OPENER_LATENCY_PROBE(kLatencyProbeTransmit);
+  NetworkCountersRecordTx(kNetworkTrafficImplicitIo, frame_length, is_multicast);
+  return kEipStatusOk;
+#else
+  /* gathered by the IP stack, so header and payload need not be contiguous */
+  struct iovec frame_parts[2] = {
+    { .iov_base = (void *)header, .iov_len = header_length },
+    { .iov_base = (void *)payload, .iov_len = payload_length },
+  };
+  struct msghdr frame = {
+    .msg_name = (void *)address,
+    .msg_namelen = sizeof(*address),
+    .msg_iov = frame_parts,
+    .msg_iovlen = (0 != payload_length) ? 2 : 1,
+  };
+#if OPENER_UDP_TOS_CONTROL_MESSAGE
+  union {
+    char buffer[CMSG_SPACE(sizeof(int) )];
+    struct cmsghdr alignment;
+  } tos_control;
+  memset(&tos_control, 0, sizeof(tos_control) );
+  frame.msg_control = tos_control.buffer;
+  frame.msg_controllen = sizeof(tos_control.buffer);
+  struct cmsghdr *const tos_message = CMSG_FIRSTHDR(&frame);
+  tos_message->cmsg_level = IPPROTO_IP;
+  tos_message->cmsg_type = IP_TOS;
+  tos_message->cmsg_len = CMSG_LEN(sizeof(int) );
+  const int tos = dscp << 2;
+  memcpy(CMSG_DATA(tos_message), &tos, sizeof(tos) );
+#else
+  /* connections of one priority send back to back, the option only changes
+   * between the priorities */
+  if(dscp != s_io_socket_dscp) {
+    if(0 == SetQosOnSocket(g_network_status.udp_io_messaging, dscp) ) {
+      s_io_socket_dscp = dscp;
+    } else {
+      int error_code = GetSocketErrorNumber();
+      char *error_message = GetErrorMessage(error_code);
+      OPENER_TRACE_ERR("networkhandler: error on set QoS on socket: %d - %s\n",
+                       error_code, error_message);
+      FreeErrorMessage(error_message);
+    }
+  }
+#endif
+  int sent_length = sendmsg(g_network_status.udp_io_messaging, &frame, 0);
   if(sent_length < 0) {
     int error_code = GetSocketErrorNumber();
     char *error_message = GetErrorMessage(error_code);
     OPENER_TRACE_ERR(
-      "networkhandler: error with sendto in SendUDPData: %d - %s\n",
+      "networkhandler: error with sendmsg in SendUdpFrame: %d - %s\n",
       error_code,
       error_message);
     FreeErrorMessage(error_message);
-    NetworkCountersRecordTxError();
+    NetworkCountersRecordTxError(kNetworkTrafficImplicitIo);
     return kEipStatusError;
   }
 
-  if(sent_length != outgoing_message->used_message_length) {
+  if( (size_t)sent_length != frame_length ) {
     OPENER_TRACE_WARN(
-      "data length sent_length mismatch; probably not all data was sent in SendUdpData, sent %d of %d\n",
+      "data length sent_length mismatch; probably not all data was sent in SendUdpFrame, sent %d of %u\n",
       sent_length,
-      outgoing_message->used_message_length);
-    NetworkCountersRecordTxDiscard();
+      (unsigned)frame_length);
+    NetworkCountersRecordDrop(kNetworkDropPartialSend);
     return kEipStatusError;
   }
 
-  NetworkCountersRecordTx((size_t)sent_length, false);
+  OPENER_LATENCY_PROBE(kLatencyProbeTransmit);
+  NetworkCountersRecordTx(kNetworkTrafficImplicitIo, (size_t)sent_length, is_multicast);
   return kEipStatusOk;
+#endif
 }
 
-EipStatus HandleDataOnTcpSocket(int socket) {
-  OPENER_TRACE_INFO("Entering HandleDataOnTcpSocket for socket: %d\n", socket);
-  int remaining_bytes = 0;
-  long data_sent = PC_OPENER_ETHERNET_BUFFER_SIZE;
+#if OPENER_CIP_SECURITY
+EipStatus SendSecureUdpFrame(const struct sockaddr_in *const address,
+                             const CipUsint dscp,
+                             const EipUint8 *const header,
+                             const size_t header_length,
+                             const EipUint8 *const payload,
+                             const size_t payload_length) {
+  if(kEipStatusOk != SecureTransportSendIo(address,
+                                           dscp,
+                                           header,
+                                           header_length,
+                                           payload,
+                                           payload_length) ) {
+    NetworkCountersRecordTxError(kNetworkTrafficImplicitIo);
+    return kEipStatusError;
+  }
+  OPENER_LATENCY_PROBE(kLatencyProbeTransmit);
+  NetworkCountersRecordTx(kNetworkTrafficImplicitIo,
+                          header_length + payload_length,
+                          false);
+  return kEipStatusOk;
+}
+#endif
 
-  /* We will handle just one EIP packet here the rest is done by the select
-   * method which will inform us if more data is available in the socket
-     because of the current implementation of the main loop this may not be
-     the fastest way and a loop here with a non blocking socket would better
-     fit*/
+static TcpTransmitQueue *GetTcpTransmitQueue(const int socket) {
+  TcpTransmitQueue *queue = TcpTransmitQueueArrayGetQueue(
+    g_tcp_transmit_queues,
+    OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+    socket);
+  if(NULL == queue) {
+    queue = TcpTransmitQueueArrayGetEmptyQueue(g_tcp_transmit_queues,
+                                               OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+    if(NULL != queue) {
+      TcpTransmitQueueSetSocket(queue, socket);
+    }
+  }
+  return queue;
+}
 
-  /*Check how many data is here -- read the first four bytes from the connection */
-  CipOctet incoming_message[PC_OPENER_ETHERNET_BUFFER_SIZE] = { 0 };
+/** @brief Sends what the IP stack takes of the replies queued for a socket
+ *
+ *  @param queue Transmit queue of the socket
+ *  @return kEipStatusOk if the replies were sent or stay queued,
+ *          kEipStatusError if the socket failed
+ */
+static EipStatus SendTcpTransmitQueue(TcpTransmitQueue *const queue) {
+  size_t sent_length = 0;
+  size_t sent_replies = 0;
+#if OPENER_CIP_SECURITY
+  const TcpTransportStatus status = TcpSocketIsSecure(queue->socket) ?
+                                    TcpTransmitQueueFlushSecure(queue,
+                                                                &sent_length,
+                                                                &sent_replies)
+                                    :
+                                    TcpTransmitQueueFlush(queue,
+                                                          &sent_length,
+                                                          &sent_replies);
+#else
+  const TcpTransportStatus status = TcpTransmitQueueFlush(queue,
+                                                          &sent_length,
+                                                          &sent_replies);
+#endif
+  if(0 != sent_length) {
+    NetworkTrafficCounters *const counters =
+      &s_traffic_counters[kNetworkTrafficExplicitTcp];
+    NetworkCounterAdd(&counters->out_octets, sent_length);
+    NetworkCounterAdd(&counters->out_ucast_packets, sent_replies);
+    SocketTimerListUpdate(&s_socket_timer_list, GetSocketTimer(queue->socket),
+                          g_actual_time);
+  }
+  if(kTcpTransportError == status) {
+    NetworkCountersRecordTxError(kNetworkTrafficExplicitTcp);
+    return kEipStatusError;
+  }
+  return kEipStatusOk;
+}
+
+/** @brief Retries the sockets whose replies the IP stack did not take at once */
+static void SendPendingTcpReplies(void) {
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i) {
+    TcpTransmitQueue *const queue = &g_tcp_transmit_queues[i];
+    if( !TcpTransmitQueueIsPending(queue) ) {
+      continue;
+    }
+    const int socket = queue->socket;
+    if(kEipStatusError == SendTcpTransmitQueue(queue) ) {
+      CloseTcpSocket(socket);
+      RemoveSession(socket);
+    }
+  }
+}
+
+/** @brief recv() without blocking, through the TLS session of a secure socket
+ *
+ *  @return the octets read, 0 once the peer closed, -1 with the error number
+ *          set on failure
+ */
+static long ReceiveTcpData(const int socket,
+                           CipOctet *const buffer,
+                           const size_t length) {
+#if OPENER_CIP_SECURITY
+  if( TcpSocketIsSecure(socket) ) {
+    return SecureTransportReceive(socket, buffer, length);
+  }
+#endif
+  return recv(socket, NWBUF_CAST buffer, length, MSG_DONTWAIT);
+}
+
+/** @brief Reads and handles one encapsulation frame
+ *
+ *  The reply, if any, is added to the transmit queue of the socket.
+ *
+ *  @return kEipStatusOkSend if a frame was handled and the next may follow,
+ *          kEipStatusOk if the socket has no more complete frame,
+ *          kEipStatusError if the session has to be closed
+ */
+static EipStatus HandleTcpFrame(const int socket,
+                                TcpReceiveBuffer *const receive_buffer,
+                                TcpTransmitQueue *const transmit_queue) {
+  int remaining_bytes = 0;
 
-  long number_of_read_bytes = recv(socket, NWBUF_CAST incoming_message, 4, 0); /*TODO we may have to set the socket to a non blocking socket */
+  /* Only the octets still missing from the current frame are read. A partial
+   * frame returns right away and is continued when select() reports the
+   * socket again, so a slow client cannot stall the I/O connections. */
+  long number_of_read_bytes = ReceiveTcpData(socket,
+                                             TcpReceiveBufferGetWritePosition(
+                                               receive_buffer),
+                                             TcpReceiveBufferGetMissingLength(
+                                               receive_buffer) );
 
-  SocketTimer *const socket_timer = SocketTimerArrayGetSocketTimer(g_timestamps,
-                                                                   OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
-                                                                   socket);
+  SocketTimer *const socket_timer = GetSocketTimer(socket);
   if(number_of_read_bytes == 0) {
     OPENER_TRACE_ERR(
       "networkhandler: socket: %d - connection closed by client.\n",
@@ -839,171 +1688,177 @@ EipStatus HandleDataOnTcpSocket(int socket) {
     return kEipStatusError;
   }
 
-  const EipUint8 *read_buffer = &incoming_message[2]; /* at this place EIP stores the data length */
-  EipUint16 reported_length = GetUintFromMessage(&read_buffer);
-  
-  // Prevent integer overflow: check if reported_length would cause overflow
-  if (reported_length > (PC_OPENER_ETHERNET_BUFFER_SIZE + 4)) {
-    OPENER_TRACE_ERR("Invalid packet length reported: %u (max: %u)\n",
-                     reported_length, PC_OPENER_ETHERNET_BUFFER_SIZE);
-    return kEipStatusError;
+  SocketTimerListUpdate(&s_socket_timer_list, socket_timer, g_actual_time);
+  if( !TcpReceiveBufferCommit(receive_buffer, (size_t)number_of_read_bytes) ) {
+    return kEipStatusOk; /* frame not complete yet */
   }
-  
-  size_t data_size = reported_length + ENCAPSULATION_HEADER_LENGTH - 4; /* -4 is for the 4 bytes we have already read*/
-  /* (NOTE this advances the buffer pointer) */
-  if( (PC_OPENER_ETHERNET_BUFFER_SIZE - 4) < data_size ) { /*TODO can this be handled in a better way?*/
+
+  size_t data_size = receive_buffer->frame_length;
+  if( TcpReceiveBufferIsDiscarding(receive_buffer) ) {
     OPENER_TRACE_ERR(
-      "too large packet received will be ignored, will drop the data\n");
-    /* Currently we will drop the whole packet */
-
-    do {
-      OPENER_TRACE_INFO(
-        "Entering consumption loop, remaining data to receive: %ld\n",
-        data_sent);
-      number_of_read_bytes = recv(socket,
-                                  NWBUF_CAST & incoming_message[0],
-                                  data_sent,
-                                  0);
-
-      if(number_of_read_bytes == 0) /* got error or connection closed by client */
-      {
-        int error_code = GetSocketErrorNumber();
-        char *error_message = GetErrorMessage(error_code);
-        OPENER_TRACE_ERR(
-          "networkhandler: socket: %d - connection closed by client: %d - %s\n",
-          socket,
-          error_code,
-          error_message);
-        FreeErrorMessage(error_message);
-        RemoveSocketTimerFromList(socket);
-        return kEipStatusError;
-      }
-      if(number_of_read_bytes < 0) {
-        int error_code = GetSocketErrorNumber();
-        char *error_message = GetErrorMessage(error_code);
-        if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
-          return kEipStatusOk;
-        } OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
-                           error_code,
-                           error_message);
-        FreeErrorMessage(error_message);
-        return kEipStatusError;
-      }
-      data_size -= number_of_read_bytes;
-      if( (data_size < PC_OPENER_ETHERNET_BUFFER_SIZE) && (data_size != 0) ) {
-        data_sent = data_size;
-      }
-    } while(0 < data_size);
-    SocketTimerSetLastUpdate(socket_timer, g_actual_time);
-    return kEipStatusOk;
+      "too large packet received will be ignored, dropped %" PRIuSZT " bytes\n",
+      data_size);
+    NetworkCountersRecordDrop(kNetworkDropOversizedFrame);
+    TcpReceiveBufferStartNextFrame(receive_buffer);
+    return kEipStatusOkSend;
   }
 
-  number_of_read_bytes = recv(socket,
-                              NWBUF_CAST & incoming_message[4],
-                              data_size,
-                              0);
+  OPENER_TRACE_INFO("Data received on TCP: %" PRIuSZT "\n", data_size);
+  NetworkCountersRecordRx(kNetworkTrafficExplicitTcp, data_size, false);
+
+  g_current_active_tcp_socket = socket;
 
-  if(0 == number_of_read_bytes) /* got error or connection closed by client */
-  {
+  struct sockaddr sender_address;
+  memset( &sender_address, 0, sizeof(sender_address) );
+  socklen_t fromlen = sizeof(sender_address);
+  if(getpeername(socket, (struct sockaddr *) &sender_address, &fromlen) < 0) {
     int error_code = GetSocketErrorNumber();
     char *error_message = GetErrorMessage(error_code);
-    OPENER_TRACE_ERR(
-      "networkhandler: socket: %d - connection closed by client: %d - %s\n",
-      socket,
-      error_code,
-      error_message);
+    OPENER_TRACE_ERR("networkhandler: could not get peername: %d - %s\n",
+                     error_code,
+                     error_message);
     FreeErrorMessage(error_message);
-    RemoveSocketTimerFromList(socket);
-    RemoveSession(socket);
-    return kEipStatusError;
   }
-  if(number_of_read_bytes < 0) {
-    int error_code = GetSocketErrorNumber();
-    char *error_message = GetErrorMessage(error_code);
-    if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
-      return kEipStatusOk;
-    } OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
-                       error_code,
-                       error_message);
-    FreeErrorMessage(error_message);
+
+  /* large replies of the previous frames stay queued in their pool buffers,
+   * send them before this reply may find none of the full size */
+  if( TcpTransmitQueueIsPending(transmit_queue) &&
+      !MessageBufferPoolIsAvailable(kMessageBufferPoolMaximumSize) &&
+      (kEipStatusError == SendTcpTransmitQueue(transmit_queue) ) ) {
     return kEipStatusError;
   }
 
-  if( (unsigned) number_of_read_bytes == data_size ) {
-    /*we got the right amount of data */
-    data_size += 4;
-    /*TODO handle partial packets*/
-    OPENER_TRACE_INFO("Data received on TCP: %" PRIuSZT "\n", data_size);
-    NetworkCountersRecordRx(data_size, false);
-
-    g_current_active_tcp_socket = socket;
+  ENIPMessage *const outgoing_message = BeginResponse(&s_tcp_response);
+  /* replies larger than the inline buffer need a pooled one */
+  (void)ENIPMessageAttachPooledBuffer(outgoing_message,
+                                      kMessageBufferPoolMaximumSize);
+  EipStatus need_to_send = HandleReceivedExplictTcpData(socket,
+                                                        receive_buffer->data,
+                                                        data_size,
+                                                        &remaining_bytes,
+                                                        &sender_address,
+                                                        outgoing_message);
+  TcpReceiveBufferStartNextFrame(receive_buffer);
+  SocketTimerListUpdate(&s_socket_timer_list, socket_timer, g_actual_time);
+
+  g_current_active_tcp_socket = kEipInvalidSocket;
+
+  if(remaining_bytes != 0) {
+    OPENER_TRACE_WARN(
+      "Warning: received packet was to long: %d Bytes left!\n",
+      remaining_bytes);
+  }
 
-    struct sockaddr sender_address;
-    memset( &sender_address, 0, sizeof(sender_address) );
-    socklen_t fromlen = sizeof(sender_address);
-    if(getpeername(socket, (struct sockaddr *) &sender_address, &fromlen) < 0) {
-      int error_code = GetSocketErrorNumber();
-      char *error_message = GetErrorMessage(error_code);
-      OPENER_TRACE_ERR("networkhandler: could not get peername: %d - %s\n",
-                       error_code,
-                       error_message);
-      FreeErrorMessage(error_message);
+  EipStatus status = kEipStatusOkSend;
+  if(need_to_send > 0) {
+    OPENER_TRACE_INFO("TCP reply: queue %" PRIuSZT " bytes on %d\n",
+                      outgoing_message->used_message_length,
+                      socket);
+    if( !TcpTransmitQueueAppendBuffer(transmit_queue,
+                                      outgoing_message->message_buffer,
+                                      outgoing_message->used_message_length) )
+    {
+      /* no free pool buffer to hold the reply, send what is queued and try
+       * once more before the reply is lost */
+      if( kEipStatusError == SendTcpTransmitQueue(transmit_queue) ) {
+        status = kEipStatusError;
+      } else if( !TcpTransmitQueueAppendBuffer(transmit_queue,
+                                               outgoing_message->message_buffer,
+                                               outgoing_message->used_message_length) )
+      {
+        OPENER_TRACE_WARN(
+          "TCP response of %" PRIuSZT " bytes could not be queued on %d\n",
+          outgoing_message->used_message_length,
+          socket);
+        NetworkCountersRecordDrop(kNetworkDropPartialSend);
+        NetworkCountersRecordTxError(kNetworkTrafficExplicitTcp);
+      }
     }
+  }
+  EndResponse(outgoing_message);
 
-    ENIPMessage outgoing_message;
-    InitializeENIPMessage(&outgoing_message);
-    EipStatus need_to_send = HandleReceivedExplictTcpData(socket,
-                                                          incoming_message,
-                                                          data_size,
-                                                          &remaining_bytes,
-                                                          &sender_address,
-                                                          &outgoing_message);
-    if(NULL != socket_timer) {
-      SocketTimerSetLastUpdate(socket_timer, g_actual_time);
-    }
+  return status;
+}
 
-    g_current_active_tcp_socket = kEipInvalidSocket;
+EipStatus HandleDataOnTcpSocket(int socket,
+                                size_t *const request_budget) {
+  OPENER_TRACE_INFO("Entering HandleDataOnTcpSocket for socket: %d\n", socket);
 
-    if(remaining_bytes != 0) {
-      OPENER_TRACE_WARN(
-        "Warning: received packet was to long: %d Bytes left!\n",
-        remaining_bytes);
+  TcpReceiveBuffer *receive_buffer = TcpReceiveBufferArrayGetBuffer(
+    g_tcp_receive_buffers,
+    OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+    socket);
+  if(NULL == receive_buffer) {
+    receive_buffer = TcpReceiveBufferArrayGetEmptyBuffer(g_tcp_receive_buffers,
+                                                         OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+    if(NULL == receive_buffer) {
+      OPENER_TRACE_ERR("networkhandler: no TCP receive buffer for socket %d\n",
+                       socket);
+      return kEipStatusError;
     }
+    TcpReceiveBufferSetSocket(receive_buffer, socket);
+  }
+  TcpTransmitQueue *const transmit_queue = GetTcpTransmitQueue(socket);
+  if(NULL == transmit_queue) {
+    OPENER_TRACE_ERR("networkhandler: no TCP transmit queue for socket %d\n",
+                     socket);
+    return kEipStatusError;
+  }
+  TcpRequestBucket *request_bucket = TcpRequestBucketArrayGetBucket(
+    g_tcp_request_buckets,
+    OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+    socket);
+  if(NULL == request_bucket) {
+    request_bucket = TcpRequestBucketArrayGetEmptyBucket(g_tcp_request_buckets,
+                                                         OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+    if(NULL == request_bucket) {
+      OPENER_TRACE_ERR("networkhandler: no TCP request bucket for socket %d\n",
+                       socket);
+      return kEipStatusError;
+    }
+    TcpRequestBucketSetSocket(request_bucket, socket, g_actual_time);
+  }
+  size_t max_frames = TcpRequestBucketGetAvailable(request_bucket,
+                                                   GetMilliSeconds() );
+  if(max_frames > *request_budget) {
+    max_frames = *request_budget;
+  }
+  if(max_frames > OPENER_TCP_TRANSMIT_QUEUE_LENGTH) {
+    max_frames = OPENER_TCP_TRANSMIT_QUEUE_LENGTH;
+  }
 
-    if(need_to_send > 0) {
-      OPENER_TRACE_INFO("TCP reply: send %" PRIuSZT " bytes on %d\n",
-                        outgoing_message.used_message_length,
-                        socket);
-
-      data_sent = send(socket,
-                       (char *) outgoing_message.message_buffer,
-                       outgoing_message.used_message_length,
-                       MSG_NOSIGNAL);
-      SocketTimerSetLastUpdate(socket_timer, g_actual_time);
-      if(data_sent != outgoing_message.used_message_length) {
-        OPENER_TRACE_WARN(
-          "TCP response was not fully sent: exp %" PRIuSZT ", sent %ld\n",
-          outgoing_message.used_message_length,
-          data_sent);
-        NetworkCountersRecordTxDiscard();
-      }
-      if (data_sent > 0) {
-        NetworkCountersRecordTx((size_t)data_sent, false);
-      } else {
-        NetworkCountersRecordTxError();
-      }
+  /* Requests the originator sent back to back are handled in one go and
+   * their replies leave with one send. The stack is left between them so
+   * the I/O task is not held off for the whole batch. */
+  EipStatus status = kEipStatusOkSend;
+  size_t frames = 0;
+  size_t requests = 0;
+  while(kEipStatusOkSend == status &&
+        !TcpTransmitQueueIsFull(transmit_queue) &&
+        frames < max_frames) {
+    if(0 != frames) {
+      NetworkHandlerLeaveStack();
+      NetworkHandlerEnterStack();
     }
+    status = HandleTcpFrame(socket, receive_buffer, transmit_queue);
+    frames++;
+    if(kEipStatusOkSend == status) {
+      requests++; /* a complete frame was handled */
+    }
+    if( !TcpSocketIsOpen(socket) ) {
+      /* UnregisterSession closed the socket and released its buffers, the
+       * descriptor may already be handed out again */
+      *request_budget -= requests;
+      return kEipStatusOk;
+    }
+  }
+  TcpRequestBucketTake(request_bucket, requests);
+  *request_budget -= requests;
 
-    return kEipStatusOk;
-  } else {
-    /* we got a fragmented packet currently we cannot handle this will
-     * for this we would need a network buffer per TCP socket
-     *
-     * However with typical packet sizes of EIP this shouldn't be a big issue.
-     */
-    /*TODO handle fragmented packets */
-  }
-  return kEipStatusError;
+  if( kEipStatusError == SendTcpTransmitQueue(transmit_queue) ) {
+    return kEipStatusError;
+  }
+  return (kEipStatusError == status) ? kEipStatusError : kEipStatusOk;
 }
 
 /** @brief Create the UDP socket for the implicit IO messaging, one socket handles all connections
@@ -1011,8 +1866,18 @@ EipStatus HandleDataOnTcpSocket(int socket) {
  * @return the socket handle if successful, else kEipInvalidSocket */
 int CreateUdpSocket(void) {
 
+#if OPENER_IO_EVENT_BACKEND
+  if(kOpenerIoEndpointHandle != g_network_status.udp_io_messaging) {
+    g_network_status.udp_io_messaging = IoEndpointOpen();
+  }
+  return g_network_status.udp_io_messaging;
+#endif
+
   /* create a new UDP socket */
   g_network_status.udp_io_messaging = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#if !OPENER_IO_EVENT_BACKEND && !OPENER_UDP_TOS_CONTROL_MESSAGE
+  s_io_socket_dscp = 0xFF;
+#endif
 
   if (g_network_status.udp_io_messaging == kEipInvalidSocket) {
     int error_code = GetSocketErrorNumber();
@@ -1074,27 +1939,15 @@ int CreateUdpSocket(void) {
   return g_network_status.udp_io_messaging;
 }
 
-/** @brief Set the Qos the socket for implicit IO messaging
- *
- * @return 0 if successful, else the error code */
-int SetQos(CipUsint qos_for_socket) {
-  if (SetQosOnSocket( g_network_status.udp_io_messaging,
-                      CipQosGetDscpPriority(qos_for_socket) ) !=
-      0) { /* got error */
-    int error_code = GetSocketErrorNumber();
-    char *error_message = GetErrorMessage(error_code);
-    OPENER_TRACE_ERR("networkhandler: error on set QoS on socket: %d - %s\n",
-                     error_code, error_message);
-    FreeErrorMessage(error_message);
-    return error_code;
-  }
-  return 0;
-}
-
 /** @brief Set the socket options for Multicast Producer
  *
  * @return 0 if successful, else the error code */
 int SetSocketOptionsMulticastProduce(void) {
+#if OPENER_IO_EVENT_BACKEND
+  IoEndpointSetMulticastProduce(g_tcpip.mcast_ttl_value,
+                                g_network_status.ip_address);
+  return 0;
+#endif
   if (g_tcpip.mcast_ttl_value != 1) {
     /* we need to set a TTL value for the socket */
     if (setsockopt( g_network_status.udp_io_messaging, IPPROTO_IP,
@@ -1145,73 +1998,73 @@ EipUint32 GetPeerAddress(void) {
   return peer_address.sin_addr.s_addr;
 }
 
-void CheckAndHandleConsumingUdpSocket(void) {
-  DoublyLinkedListNode *iterator = connection_list.first;
+EipBool8 IsPeerSessionSecure(void) {
+  return TcpSocketIsSecure(g_current_active_tcp_socket);
+}
 
-  CipConnectionObject *current_connection_object = NULL;
+void CheckAndHandleConsumingUdpSocket(void) {
+  /* All consuming I/O connections share the UDP I/O socket; the received
+   * connection ID selects the connection in HandleReceivedConnectedData(). */
+#if OPENER_IO_EVENT_BACKEND
+  return; /* dispatched by the platform's event task, see IoEndpointOpen() */
+#endif
+  if( (kEipInvalidSocket == g_network_status.udp_io_messaging) ||
+      (true != CheckSocketSet(g_network_status.udp_io_messaging) ) ) {
+    return;
+  }
 
-  /* see a message of the registered UDP socket has been received     */
-  while(NULL != iterator) {
-    current_connection_object = (CipConnectionObject *) iterator->data;
-    iterator = iterator->next; /* do this at the beginning as the close function may can make the entry invalid */
+  /* Drain the datagrams queued since the last select(), bounded in number
+   * and time so a flood on the I/O port cannot starve the rest of the loop */
+#if OPENER_IO_RECEIVE_BUDGET_US > 0
+  const MicroSeconds receive_start = GetMicroSeconds();
+#endif
+  CipOctet *const incoming_message = s_udp_receive_buffer;
+  for(size_t i = 0; i < OPENER_IO_RECEIVE_BATCH; ++i) {
+    #if NETWORK_VERBOSE_LOGGING
+    OPENER_TRACE_INFO("Processing UDP consuming message\n");
+    #endif
+    struct sockaddr_in from_address = { 0 };
+    socklen_t from_address_length = sizeof(from_address);
 
-    if( (kEipInvalidSocket !=
-         current_connection_object->socket[kUdpCommuncationDirectionConsuming])
-        && ( true ==
-             CheckSocketSet(current_connection_object->socket[
-                              kUdpCommuncationDirectionConsuming
-                            ]) ) ) {
-      #if NETWORK_VERBOSE_LOGGING
-      OPENER_TRACE_INFO("Processing UDP consuming message\n");
-      #endif
-      struct sockaddr_in from_address = { 0 };
-      socklen_t from_address_length = sizeof(from_address);
-      CipOctet incoming_message[PC_OPENER_ETHERNET_BUFFER_SIZE] = { 0 };
-
-      int received_size = recvfrom(g_network_status.udp_io_messaging,
-                                   NWBUF_CAST incoming_message,
-                                   sizeof(incoming_message),
-                                   0,
-                                   (struct sockaddr *) &from_address,
-                                   &from_address_length);
-      if(0 == received_size) {
-        NetworkCountersRecordRxDiscard();
-        NetworkCountersRecordRxError();
-        int error_code = GetSocketErrorNumber();
-        char *error_message = GetErrorMessage(error_code);
-        OPENER_TRACE_ERR(
-          "networkhandler: socket: %d - connection closed by client: %d - %s\n",
-          current_connection_object->socket[
-            kUdpCommuncationDirectionConsuming],
-          error_code,
-          error_message);
-        FreeErrorMessage(error_message);
-        current_connection_object->connection_close_function(
-          current_connection_object);
-        continue;
-      }
+    int received_size = recvfrom(g_network_status.udp_io_messaging,
+                                 NWBUF_CAST incoming_message,
+                                 sizeof(s_udp_receive_buffer),
+                                 MSG_DONTWAIT,
+                                 (struct sockaddr *) &from_address,
+                                 &from_address_length);
+    if(0 == received_size) {
+      NetworkCountersRecordDrop(kNetworkDropEmptyDatagram);
+      return;
+    }
 
-      if(0 > received_size) {
-        int error_code = GetSocketErrorNumber();
-        if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
-          return; // No fatal error, resume execution
-        } 
-        NetworkCountersRecordRxError();
-        char *error_message = GetErrorMessage(error_code);
-        OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
-                           error_code,
-                           error_message);
-        FreeErrorMessage(error_message);
-        current_connection_object->connection_close_function(
-          current_connection_object);
-        continue;
+    if(0 > received_size) {
+      int error_code = GetSocketErrorNumber();
+      if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
+        return; // No fatal error, resume execution
       }
+      NetworkCountersRecordRxError(kNetworkTrafficImplicitIo);
+      char *error_message = GetErrorMessage(error_code);
+      OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
+                       error_code,
+                       error_message);
+      FreeErrorMessage(error_message);
+      return;
+    }
 
-      NetworkCountersRecordRx((size_t)received_size, false);
-      HandleReceivedConnectedData(incoming_message, received_size,
-                                  &from_address);
+    NetworkCountersRecordRx(kNetworkTrafficImplicitIo, (size_t)received_size,
+                            false);
+    HandleReceivedConnectedData(incoming_message, received_size,
+                                &from_address);
 
+#if OPENER_IO_RECEIVE_BUDGET_US > 0
+    if(GetMicroSeconds() - receive_start >= OPENER_IO_RECEIVE_BUDGET_US) {
+      #if NETWORK_VERBOSE_LOGGING
+      OPENER_TRACE_INFO("networkhandler: I/O receive budget used after %"
+                        PRIuSZT " datagrams\n", i + 1);
+      #endif
+      return; /* the rest is read after the next select() */
     }
+#endif
   }
 }
 
@@ -1244,30 +2097,26 @@ int GetMaxSocket(int socket1,
   return socket4;
 }
 
-void CheckEncapsulationInactivity(int socket_handle) {
+void CheckEncapsulationInactivity(void) {
   if(0 < g_tcpip.encapsulation_inactivity_timeout) { //*< Encapsulation inactivity timeout is enabled
-    SocketTimer *socket_timer = SocketTimerArrayGetSocketTimer(g_timestamps,
-                                                               OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
-                                                               socket_handle);
-
-//    OPENER_TRACE_INFO("Check socket %d - socket timer: %p\n",
-//                      socket_handle,
-//                      socket_timer);
-    if(NULL != socket_timer) {
-      MilliSeconds diff_milliseconds = g_actual_time - SocketTimerGetLastUpdate(
-        socket_timer);
-
-      if( diff_milliseconds >=
-          (MilliSeconds) (1000UL * g_tcpip.encapsulation_inactivity_timeout) ) {
+    const MilliSeconds timeout =
+      (MilliSeconds) (1000UL * g_tcpip.encapsulation_inactivity_timeout);
+    /* The list is ordered by last update, so only expired timers are visited */
+    SocketTimer *socket_timer = NULL;
+    while( NULL !=
+           ( socket_timer = SocketTimerListGetOldest(&s_socket_timer_list) ) &&
+           (MilliSeconds) (g_actual_time -
+                           SocketTimerGetLastUpdate(socket_timer) ) >= timeout )
+    {
+      const int socket_handle = socket_timer->socket;
 
-        CipSessionHandle encapsulation_session_handle =
-          GetSessionFromSocket(socket_handle);
+      CipSessionHandle encapsulation_session_handle =
+        GetSessionFromSocket(socket_handle);
 
-        CloseClass3ConnectionBasedOnSession(encapsulation_session_handle);
+      CloseClass3ConnectionBasedOnSession(encapsulation_session_handle);
 
-        CloseTcpSocket(socket_handle);
-        RemoveSession(socket_handle);
-      }
+      CloseTcpSocket(socket_handle); /* removes the socket timer */
+      RemoveSession(socket_handle);
     }
   }
 }
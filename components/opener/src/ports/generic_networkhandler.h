@@ -30,6 +30,7 @@
 #include "networkhandler.h"
 #include "appcontype.h"
 #include "socket_timer.h"
+#include "tcp_receive_buffer.h"
 
 /*The port to be used per default for I/O messages on UDP.*/
 extern const uint16_t kOpenerEipIoUdpPort;
@@ -72,33 +73,163 @@ typedef struct {
 
 extern NetworkStatus g_network_status; /**< Global variable holding the current network status */
 
+/** @brief Traffic classes of the interface counters */
+typedef enum {
+  kNetworkTrafficImplicitIo = 0, /**< class 0/1 I/O on UDP port 2222 */
+  kNetworkTrafficExplicitTcp, /**< encapsulation on TCP port 44818 */
+  kNetworkTrafficExplicitUdp, /**< ListIdentity and alike on UDP port 44818 */
+  kNetworkTrafficClassCount
+} NetworkTrafficClass;
+
+/** @brief Why a frame was discarded */
+typedef enum {
+  kNetworkDropEmptyDatagram = 0, /**< received, zero length */
+  kNetworkDropTruncated, /**< received, larger than the receive buffer */
+  kNetworkDropOversizedFrame, /**< received on TCP, larger than the buffer */
+  kNetworkDropIoQueueFull, /**< received, the I/O backend queue overflowed */
+  kNetworkDropNoReceiveBuffer, /**< received, the driver had no buffer for it */
+  kNetworkDropPartialSend, /**< sent, the IP stack took only a part */
+  kNetworkDropRateLimited, /**< received, above the UDP port 44818 rate limit */
+  kNetworkDropReasonCount
+} NetworkDropReason;
+
 typedef struct {
-  CipUdint in_octets;
-  CipUdint in_ucast_packets;
-  CipUdint in_nucast_packets;
-  CipUdint in_discards;
-  CipUdint in_errors;
-  CipUdint in_unknown_protos;
-  CipUdint out_octets;
-  CipUdint out_ucast_packets;
-  CipUdint out_nucast_packets;
-  CipUdint out_discards;
-  CipUdint out_errors;
+  CipUlint in_octets;
+  CipUlint in_ucast_packets;
+  CipUlint in_nucast_packets;
+  CipUlint in_errors;
+  CipUlint out_octets;
+  CipUlint out_ucast_packets;
+  CipUlint out_nucast_packets;
+  CipUlint out_errors;
+} NetworkTrafficCounters;
+
+/** @brief Counters of the network handler
+ *
+ *  The totals in the first block are the sums of the traffic classes, the
+ *  discards the sums of the drop reasons of each direction. They are 64
+ *  bits wide; the 32 bit Interface Counters of the Ethernet Link object
+ *  take their lower half.
+ */
+typedef struct {
+  CipUlint in_octets;
+  CipUlint in_ucast_packets;
+  CipUlint in_nucast_packets;
+  CipUlint in_discards;
+  CipUlint in_errors;
+  CipUlint in_unknown_protos;
+  CipUlint out_octets;
+  CipUlint out_ucast_packets;
+  CipUlint out_nucast_packets;
+  CipUlint out_discards;
+  CipUlint out_errors;
+  NetworkTrafficCounters traffic[kNetworkTrafficClassCount];
+  CipUlint dropped[kNetworkDropReasonCount];
 } NetworkInterfaceCounters;
 
-const NetworkInterfaceCounters *NetworkGetInterfaceCounters(void);
+/** @brief Copy the interface counters
+ *
+ *  Each counter is updated with a single atomic operation, so this may be
+ *  called from any task without the stack lock. The counters are read one
+ *  by one; a frame counted meanwhile can show up in some of them only.
+ *
+ *  @param counters destination
+ */
+void NetworkGetInterfaceCounters(NetworkInterfaceCounters *counters);
+
+/** @brief Copy and clear the interface counters
+ *
+ *  Every counter is exchanged against 0 atomically, so a frame counted
+ *  meanwhile ends up in this copy or the next one, never in none or both.
+ *
+ *  @param counters destination
+ */
+void NetworkGetAndClearInterfaceCounters(NetworkInterfaceCounters *counters);
+
 void NetworkResetInterfaceCounters(void);
 
+/** @brief Time the OpENer loop spent waiting in select()
+ *
+ *  Waits of at most one timer tick are the normal loop pace. Longer waits
+ *  are taken with OPENER_TICKLESS_IDLE while no connection is open, until
+ *  the next socket event or encapsulation deadline.
+ */
+typedef struct {
+  CipUlint tick_waits; /**< waits of at most one timer tick */
+  CipUlint tick_wait_time_ms; /**< time spent in them */
+  CipUlint idle_waits; /**< waits longer than one timer tick */
+  CipUlint idle_wait_time_ms; /**< time spent in them */
+} NetworkIdleStatistics;
+
+/** @brief Copy the wait statistics of the OpENer loop
+ *
+ *  May be called from any task, each value is read atomically.
+ *
+ *  @param statistics destination
+ */
+void NetworkGetIdleStatistics(NetworkIdleStatistics *statistics);
+
+/** @brief Count and dispatch a datagram received on the I/O port
+ *
+ * Entry point of event driven platform backends that receive implicit I/O
+ * outside of NetworkHandlerProcessCyclic(). Has to be called with the stack
+ * lock held.
+ *
+ * @param data received datagram
+ * @param length length of the datagram
+ * @param from_address sender of the datagram
+ */
+void NetworkHandlerReceivedIoMessage(const CipOctet *const data,
+                                     const size_t length,
+                                     struct sockaddr_in *from_address);
+
+/** @brief Count and dispatch the plaintext of a DTLS record
+ *
+ * Entry point of the CIP Security transport, see SecureTransportReceiveIo().
+ * Has to be called with the stack lock held.
+ *
+ * @param data decrypted datagram
+ * @param length length of the datagram
+ * @param from_address peer of the DTLS session
+ */
+void NetworkHandlerReceivedSecureIoMessage(const CipOctet *const data,
+                                           const size_t length,
+                                           struct sockaddr_in *from_address);
+
+/** @brief Count datagrams a platform backend or driver had to drop
+ *
+ * May be called without the stack lock.
+ *
+ * @param reason why they were dropped
+ * @param count number of dropped datagrams
+ */
+void NetworkHandlerDiscardedIoMessages(const NetworkDropReason reason,
+                                       const size_t count);
+
 /** @brief The platform independent part of network handler initialization routine
  *
  *  @return Returns the OpENer status after the initialization routine
  */
 EipStatus NetworkHandlerInitialize(void);
 
+/** @brief Reset the per session state (socket timers, TCP receive buffers
+ *  and transmit queues), part of NetworkHandlerInitialize()
+ *
+ *  For hosts that feed the stack without the listening sockets.
+ */
+void NetworkHandlerInitializeSessions(void);
+
 void CloseUdpSocket(int socket_handle);
 
 void CloseTcpSocket(int socket_handle);
 
+/** @brief Start or restart the encapsulation inactivity supervision of a
+ *  TCP socket, called when a session is registered on it
+ *
+ *  @param socket_handle The socket of the session
+ */
+void AddSocketTimerToList(const int socket_handle);
+
 EipStatus NetworkHandlerProcessCyclic(void);
 
 EipStatus NetworkHandlerFinish(void);
@@ -122,11 +253,6 @@ int GetMaxSocket(int socket1,
                  int socket3,
                  int socket4);
 
-/** @brief Set the Qos the socket for implicit IO messaging
- *
- * @return 0 if successful, else the error code */
-int SetQos(CipUsint qos_for_socket);
-
 /** @brief Set the socket options for Multicast Producer
  *
  * @return 0 if successful, else the error code */
@@ -137,4 +263,30 @@ int SetSocketOptionsMulticastProduce(void);
  * @return peer address if successful, else any address (0) */
 EipUint32 GetPeerAddress(void);
 
+/** @brief Whether the explicit message being handled came over TLS
+ *
+ * @return true on a CIP Security session, see SecureTransportTakeSession() */
+EipBool8 IsPeerSessionSecure(void);
+
+#if defined(OPENER_CIP_SECURITY) && 0 != OPENER_CIP_SECURITY
+/** @brief Send an implicit I/O frame over the DTLS session with a peer
+ *
+ * Counterpart of SendUdpFrame() for connections opened over TLS.
+ *
+ * @param address Address and port of the DTLS session
+ * @param dscp DSCP value of the frame
+ * @param header CPF header of the frame
+ * @param header_length Length of the header
+ * @param payload Frame payload, may be NULL if payload_length is 0
+ * @param payload_length Length of the payload
+ * @return kEipStatusOk on success
+ */
+EipStatus SendSecureUdpFrame(const struct sockaddr_in *const address,
+                             const CipUsint dscp,
+                             const EipUint8 *const header,
+                             const size_t header_length,
+                             const EipUint8 *const payload,
+                             const size_t payload_length);
+#endif /* OPENER_CIP_SECURITY */
+
 #endif /* GENERIC_NETWORKHANDLER_H_ */
@@ -0,0 +1,60 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_LATENCY_PROBE_H_
+#define OPENER_LATENCY_PROBE_H_
+
+/** @file latency_probe.h
+ *  @brief Output pins toggled along the I/O path for oscilloscope timing
+ *
+ *  Enabled with OPENER_LATENCY_PROBES. Each probe point toggles its own pin,
+ *  so every edge on the pin is one pass; trigger the scope on both edges.
+ *  Input edge to packet is the time from the INT line of the input
+ *  expanders, or from kLatencyProbeInputRead when the inputs are polled, to
+ *  kLatencyProbeTransmit; packet to relay is the time from
+ *  kLatencyProbeConsume to kLatencyProbeOutputWritten plus the settle time
+ *  of the relay.
+ *
+ *  Without OPENER_LATENCY_PROBES OPENER_LATENCY_PROBE() expands to nothing.
+ *  With it the platform header latency_probe_pins.h maps the probes to pins
+ *  at compile time and a probe costs the register accesses of one toggle; a
+ *  probe without a pin compiles to nothing as well. Probe points may run in
+ *  an interrupt handler. A probe point passed by two tasks at the same time
+ *  can lose one of the edges.
+ */
+
+#include "opener_user_conf.h"
+
+#ifndef OPENER_LATENCY_PROBES
+#define OPENER_LATENCY_PROBES 0
+#endif
+
+typedef enum {
+  kLatencyProbeInputInterrupt = 0, /**< INT edge of the input expanders, in the ISR */
+  kLatencyProbeInputRead, /**< input expanders read over I2C */
+  kLatencyProbeProduce, /**< entry of SendConnectedData() */
+  kLatencyProbeTransmit, /**< produced datagram handed to the MAC */
+  kLatencyProbeConsume, /**< consumed I/O datagram arrived in the stack */
+  kLatencyProbeOutputWritten, /**< relay expanders written over I2C */
+  kLatencyProbeNumberOfProbes
+} LatencyProbe;
+
+#if OPENER_LATENCY_PROBES
+
+#include "latency_probe_pins.h"
+
+/** @brief Configure the pins of all probes as outputs, driven low */
+void LatencyProbeInitialize(void);
+
+/** @def OPENER_LATENCY_PROBE(probe) Toggle the pin of probe */
+#define OPENER_LATENCY_PROBE(probe) LatencyProbeToggle(probe)
+
+#else
+
+#define OPENER_LATENCY_PROBE(probe)
+
+#endif /* OPENER_LATENCY_PROBES */
+
+#endif /* OPENER_LATENCY_PROBE_H_ */
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_LOOP_PROFILE_H_
+#define OPENER_LOOP_PROFILE_H_
+
+/** @file loop_profile.h
+ *  @brief Cycle counter profiling of the phases of the OpENer loop
+ *
+ *  Enabled with OPENER_LOOP_PROFILE. Every phase keeps the number of samples,
+ *  minimum, average, maximum, a log-linear histogram for the 99th percentile
+ *  and the number of samples that took longer than the budget of the phase.
+ *  Phases nest: the application callbacks are also part of the UDP and
+ *  connection handling that called them.
+ *
+ *  Begin and end of a sample have to run on the same core, the cycle counter
+ *  is per core. Samples of one phase must not be recorded concurrently; a
+ *  reset is taken over by the recording task with its next sample.
+ *
+ *  The platform implements the functions, see ports/ESP32/loop_profile.c.
+ */
+
+#include "typedefs.h"
+#include "opener_user_conf.h"
+
+/** @brief Loop Profile Object class code (vendor specific range) */
+static const CipUint kLoopProfileClassCode = 0x65U;
+
+typedef enum {
+  kLoopProfilePhaseSelect = 0, /**< waiting in select() */
+  kLoopProfilePhaseTcp, /**< TCP listener and explicit messages */
+  kLoopProfilePhaseUdp, /**< UDP unicast, broadcast and consumed I/O */
+  kLoopProfilePhaseManageConnections, /**< ManageConnections() and timeout checkers */
+  kLoopProfilePhaseProduction, /**< timer driven production */
+  kLoopProfilePhaseApplication, /**< assembly and application callbacks */
+  kLoopProfilePhaseIoScan, /**< one I/O scan including the I2C transfers */
+  kLoopProfilePhaseLoop, /**< one loop iteration without the select() wait */
+  kLoopProfileNumberOfPhases
+} LoopProfilePhase;
+
+/** @brief Statistics of one phase, all times in microseconds */
+typedef struct {
+  CipUdint samples;
+  CipUdint overruns; /**< samples longer than the budget of the phase */
+  CipUdint minimum;
+  CipUdint average;
+  CipUdint maximum;
+  CipUdint percentile_99; /**< upper limit of the histogram bucket */
+} LoopProfileSummary;
+
+#if OPENER_LOOP_PROFILE
+
+/** @brief Read the cycle counter of the calling core */
+CipUdint LoopProfileGetCycleCount(void);
+
+/** @brief Add one sample to a phase
+ *
+ *  @param phase phase the sample belongs to
+ *  @param cycles duration in CPU cycles
+ */
+void LoopProfileRecord(const LoopProfilePhase phase,
+                       const CipUdint cycles);
+
+/** @brief Set the time budget above which a sample counts as overrun
+ *
+ *  @param phase phase to set
+ *  @param budget budget in microseconds, 0 for none
+ */
+void LoopProfileSetBudget(const LoopProfilePhase phase,
+                          const CipUdint budget);
+
+/** @brief Name of a phase, as used in the web API */
+const char *LoopProfileGetPhaseName(const LoopProfilePhase phase);
+
+/** @brief Take a snapshot of the statistics of one phase
+ *
+ *  May be called from any task; a snapshot taken while a sample is recorded
+ *  can mix values from before and after that sample.
+ */
+void LoopProfileGetSummary(const LoopProfilePhase phase,
+                           LoopProfileSummary *const summary);
+
+/** @brief Clear the statistics of all phases */
+void LoopProfileReset(void);
+
+/** @brief Create the Loop Profile Object and set the loop budget
+ *
+ *  Instance 1 has the number of phases as attribute 1 and the summaries of
+ *  all phases as attribute 2; the Reset service clears the statistics.
+ */
+EipStatus LoopProfileCreateCipObject(void);
+
+/** @def OPENER_LOOP_PROFILE_BEGIN(start) Start a sample named start */
+#define OPENER_LOOP_PROFILE_BEGIN(start) \
+  const CipUdint start = LoopProfileGetCycleCount()
+
+/** @def OPENER_LOOP_PROFILE_END(phase, start) Record the sample start */
+#define OPENER_LOOP_PROFILE_END(phase, start) \
+  LoopProfileRecord(phase, LoopProfileGetCycleCount() - (start) )
+
+#else
+
+#define OPENER_LOOP_PROFILE_BEGIN(start)
+#define OPENER_LOOP_PROFILE_END(phase, start)
+
+#endif /* OPENER_LOOP_PROFILE */
+
+#endif /* OPENER_LOOP_PROFILE_H_ */
@@ -6,7 +6,10 @@
 #ifndef OPENER_NETWORKHANDLER_H_
 #define OPENER_NETWORKHANDLER_H_
 
+#include <limits.h>
+
 #include "typedefs.h"
+#include "opener_user_conf.h"
 
 #define OPENER_SOCKET_WOULD_BLOCK EWOULDBLOCK
 
@@ -36,6 +39,23 @@ void CloseSocketPlatform(int socket_handle);
  */
 int SetSocketToNonBlocking(int socket_handle);
 
+/** @brief Begin processing of network events by the stack
+ *
+ * Called by NetworkHandlerProcessCyclic() before any socket, encapsulation or
+ * connection data is touched, once for the UDP sockets, once per TCP socket
+ * with data and once for the connection timers. Platforms that run parts of
+ * the stack from another task, e.g. a timer driven producer, take their lock
+ * here; entering per event keeps the lock hold time to one request.
+ */
+void NetworkHandlerEnterStack(void);
+
+/** @brief End processing of network events by the stack
+ *
+ * Counterpart of NetworkHandlerEnterStack(), called after each event and
+ * before the network handler blocks in select() again.
+ */
+void NetworkHandlerLeaveStack(void);
+
 /** @brief Returns current time in microseconds from monotonic time base, please note
  *  that this does not represent a real absolute time, but measured from an arbitrary starting point
  *
@@ -71,4 +91,183 @@ MilliSeconds GetMilliSeconds(void);
 int SetQosOnSocket(const int socket,
                    CipUsint qos_value);
 
+#if defined(OPENER_IO_EVENT_BACKEND) && 0 != OPENER_IO_EVENT_BACKEND
+
+/** @brief Handle of the implicit I/O endpoint of an event driven platform
+ *
+ * Stored in g_network_status.udp_io_messaging and the connection sockets in
+ * place of a BSD socket. It is never part of the select() set.
+ */
+#define kOpenerIoEndpointHandle INT_MAX
+
+/** @brief Open the UDP port 2222 endpoint shared by all I/O connections
+ *
+ * Received datagrams are handed to NetworkHandlerReceivedIoMessage() from
+ * the platform's event task, with the stack lock held.
+ *
+ * @return kOpenerIoEndpointHandle on success, kEipInvalidSocket otherwise
+ */
+int IoEndpointOpen(void);
+
+/** @brief Close the I/O endpoint and drop all queued datagrams */
+void IoEndpointClose(void);
+
+/** @brief Send a datagram from the I/O endpoint
+ *
+ * Header and payload are gathered into the datagram, which may be at most
+ * PC_OPENER_ETHERNET_BUFFER_SIZE bytes long.
+ *
+ * @param address destination address, network byte order
+ * @param port destination port, network byte order
+ * @param dscp DSCP value of the datagram, as used by SetQosOnSocket()
+ * @param header first part of the datagram
+ * @param header_length length of the header
+ * @param payload second part of the datagram, may be NULL if payload_length is 0
+ * @param payload_length length of the payload
+ *
+ * @return kEipStatusOk if the datagram was handed to the IP layer
+ */
+EipStatus IoEndpointSend(const CipUdint address,
+                         const CipUint port,
+                         const CipUsint dscp,
+                         const CipOctet *const header,
+                         const size_t header_length,
+                         const CipOctet *const payload,
+                         const size_t payload_length);
+
+/** @brief Set the multicast TTL and outgoing interface of the I/O endpoint
+ *
+ * @param ttl multicast time to live
+ * @param interface_address address of the outgoing interface, network byte order
+ */
+void IoEndpointSetMulticastProduce(const CipUsint ttl,
+                                   const CipUdint interface_address);
+
+#endif /* OPENER_IO_EVENT_BACKEND */
+
+#if defined(OPENER_CIP_SECURITY) && 0 != OPENER_CIP_SECURITY
+
+#include <stdbool.h>
+#include <netinet/in.h>
+
+/** @brief Start the TLS and DTLS sessions on port 2221
+ *
+ * The handshakes run in a task of the platform. The records of established
+ * sessions are read and written with the stack lock held: TLS sessions are
+ * taken with SecureTransportTakeSession() and served like accepted TCP
+ * connections, DTLS records are read by SecureTransportReceiveIo() when the
+ * returned socket is readable. Called again after NetworkHandlerFinish().
+ *
+ * @return the UDP socket of the DTLS sessions, kEipInvalidSocket on failure
+ */
+int SecureTransportOpen(void);
+
+/** @brief Close the DTLS sessions
+ *
+ * The TLS sessions are closed with their sockets by CloseTcpSocket().
+ */
+void SecureTransportClose(void);
+
+/** @brief Take a TLS session whose handshake has completed
+ *
+ * @param peer_address receives the address of the peer, network byte order
+ * @return its non-blocking socket, kEipInvalidSocket if none is waiting
+ */
+int SecureTransportTakeSession(CipUdint *const peer_address);
+
+/** @brief Whether TLS handshakes are under way or sessions wait to be taken */
+bool SecureTransportIsHandshaking(void);
+
+/** @brief Read plaintext of a TLS session, recv() with MSG_DONTWAIT alike
+ *
+ * @return the octets read, 0 once the peer closed the session, -1 with
+ *         errno set to OPENER_SOCKET_WOULD_BLOCK or another error
+ */
+long SecureTransportReceive(const int socket,
+                            CipOctet *const buffer,
+                            const size_t length);
+
+/** @brief Write plaintext to a TLS session, send() with MSG_DONTWAIT alike
+ *
+ * After -1 with OPENER_SOCKET_WOULD_BLOCK the same data has to be passed
+ * again, the record may already be partly sent.
+ *
+ * @return the octets taken, -1 with errno set on failure
+ */
+long SecureTransportSend(const int socket,
+                         const CipOctet *const data,
+                         const size_t length);
+
+/** @brief Whether a TLS session holds decrypted octets not yet read
+ *
+ * The socket is not readable for them, select() does not report it.
+ */
+bool SecureTransportHasPendingData(const int socket);
+
+/** @brief Send close_notify and release the TLS session of a socket
+ *
+ * The socket itself is left open.
+ */
+void SecureTransportCloseSession(const int socket);
+
+/** @brief Read the datagrams on the DTLS socket
+ *
+ * Application data of established sessions is handed to
+ * NetworkHandlerReceivedSecureIoMessage(), handshake records are passed on
+ * to the handshake task.
+ */
+void SecureTransportReceiveIo(void);
+
+/** @brief Bind the DTLS session of an originator to its TLS session
+ *
+ * Called for a Forward Open received over the TLS session. Only established
+ * DTLS sessions from the address count: the one bound to the TLS session
+ * already, else the only one not bound to any. With several unbound ones
+ * the connection is bound by its first record, see
+ * SecureTransportClaimIoSession().
+ *
+ * @param tls_socket socket of the TLS session, see SecureTransportTakeSession()
+ * @param address address of the originator, network byte order
+ * @param peer receives the address and port of the bound DTLS session, port
+ *        0 while it is not bound yet
+ * @return false without an established DTLS session to bind
+ */
+bool SecureTransportBindIoSession(const int tls_socket,
+                                  const CipUdint address,
+                                  struct sockaddr_in *const peer);
+
+/** @brief Bind the DTLS session a record came from to a TLS session
+ *
+ * @param tls_socket socket of the TLS session the connection was opened over
+ * @param peer address and port the record came from
+ * @return true if the session is established and unbound or bound to
+ *         tls_socket already
+ */
+bool SecureTransportClaimIoSession(const int tls_socket,
+                                   const struct sockaddr_in *const peer);
+
+/** @brief Send a datagram as one DTLS record to a peer
+ *
+ * Header and payload are gathered into the record, which may be at most
+ * PC_OPENER_ETHERNET_BUFFER_SIZE bytes long.
+ *
+ * @param peer address and port of the DTLS session
+ * @param dscp DSCP value of the datagram, as used by SetQosOnSocket()
+ * @param header first part of the datagram
+ * @param header_length length of the header
+ * @param payload second part of the datagram, may be NULL if payload_length is 0
+ * @param payload_length length of the payload
+ *
+ * @return kEipStatusOk if the record was handed to the IP layer,
+ *         kEipStatusError without an established session
+ */
+EipStatus SecureTransportSendIo(const struct sockaddr_in *const peer,
+                                const CipUsint dscp,
+                                const CipOctet *const header,
+                                const size_t header_length,
+                                const CipOctet *const payload,
+                                const size_t payload_length);
+
+#endif /* OPENER_CIP_SECURITY */
+
 #endif /* OPENER_NETWORKHANDLER_H_ */
@@ -0,0 +1,267 @@
+/*******************************************************************************
+ * Copyright (c) 2019, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+/** @file nvconfig.c
+ *  @brief This file implements the configuration record in the ESP32 NVS.
+ *
+ *  The record is read once at boot and kept in RAM. Writes replace the whole
+ *  blob, the NVS keeps the old one until the new one is committed, so a
+ *  reset during the write leaves one of the two.
+ */
+#include "nvconfig.h"
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "trace.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "task_telemetry.h"
+#include "overload_governor.h"
+#include "trace_event.h"
+
+#define NV_CONFIG_NVS_NAMESPACE  "opener"
+#define NV_CONFIG_NVS_KEY        "config"
+/* Layout of NvConfigRecord, a record of another layout is not taken */
+#define NV_CONFIG_VERSION        1U
+
+#ifndef CONFIG_OPENER_NV_STORE_DELAY_MS
+#define CONFIG_OPENER_NV_STORE_DELAY_MS 500
+#endif
+
+/** Changes that keep coming postpone the write by at most this many delays */
+#define NV_CONFIG_MAX_DEFERRALS      8U
+#define NV_CONFIG_WRITER_STACK_SIZE  3072
+#define NV_CONFIG_WRITER_PRIORITY    (tskIDLE_PRIORITY + 1)
+/** Polls of the overload governor before a deferred write goes ahead anyway */
+#define NV_CONFIG_OVERLOAD_POLL_MS   1000U
+#define NV_CONFIG_MAX_OVERLOAD_WAITS 60U
+
+static const char *kTag = "NvConfig";
+
+typedef struct __attribute__((packed)) {
+  uint16_t version;
+  uint16_t length;   /**< sizeof(NvConfigRecord) */
+  uint32_t sections; /**< bit n: section n stored */
+  NvConfigTcpip tcpip;
+  NvConfigQos qos;
+  NvConfigEthLink eth_link;
+  NvConfigIo io;
+  uint32_t crc;      /**< of all members above */
+} NvConfigRecord;
+
+typedef struct {
+  size_t offset;
+  size_t size;
+} NvConfigSectionLayout;
+
+static const NvConfigSectionLayout kSectionLayout[kNvConfigSectionCount] = {
+  [kNvConfigSectionTcpip] = { offsetof(NvConfigRecord, tcpip), sizeof(NvConfigTcpip) },
+  [kNvConfigSectionQos] = { offsetof(NvConfigRecord, qos), sizeof(NvConfigQos) },
+  [kNvConfigSectionEthLink] = { offsetof(NvConfigRecord, eth_link), sizeof(NvConfigEthLink) },
+  [kNvConfigSectionIo] = { offsetof(NvConfigRecord, io), sizeof(NvConfigIo) },
+};
+
+/* The RAM copy, its crc is only valid in what was read or written */
+static NvConfigRecord s_record;
+static bool s_loaded = false;
+static bool s_dirty = false;
+static TaskHandle_t s_nv_writer_task = NULL;
+static portMUX_TYPE s_record_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t NvConfigCrc(const NvConfigRecord *record) {
+  return esp_rom_crc32_le(0, (const uint8_t *)record,
+                          offsetof(NvConfigRecord, crc));
+}
+
+static bool NvConfigIsValid(const NvConfigRecord *record, size_t length) {
+  return sizeof(*record) == length &&
+         NV_CONFIG_VERSION == record->version &&
+         sizeof(*record) == record->length &&
+         NvConfigCrc(record) == record->crc;
+}
+
+static void NvConfigReadRecord(NvConfigRecord *record) {
+  memset(record, 0, sizeof(*record));
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(NV_CONFIG_NVS_NAMESPACE, NVS_READONLY, &handle);
+  if (ESP_ERR_NVS_NOT_FOUND == err) {
+    ESP_LOGI(kTag, "No stored configuration record");
+    return;
+  }
+  if (ESP_OK != err) {
+    ESP_LOGE(kTag, "nvs_open failed (%s)", esp_err_to_name(err));
+    return;
+  }
+  NvConfigRecord stored;
+  size_t length = sizeof(stored);
+  err = nvs_get_blob(handle, NV_CONFIG_NVS_KEY, &stored, &length);
+  nvs_close(handle);
+  if (ESP_ERR_NVS_NOT_FOUND == err) {
+    ESP_LOGI(kTag, "No stored configuration record");
+  } else if (ESP_OK != err && ESP_ERR_NVS_INVALID_LENGTH != err) {
+    ESP_LOGE(kTag, "Failed to load the configuration record (%s)",
+             esp_err_to_name(err));
+  } else if (ESP_OK != err || !NvConfigIsValid(&stored, length)) {
+    ESP_LOGW(kTag, "Ignoring a stored configuration record of another "
+             "layout or with a wrong CRC");
+  } else {
+    *record = stored;
+  }
+}
+
+/* Each notification follows a change of the RAM copy. The task waits until
+ * no change arrived for CONFIG_OPENER_NV_STORE_DELAY_MS, so the
+ * Set_Attribute requests of one configuration end up in a single write. */
+static void NvConfigWriterTask(void *arg) {
+  (void) arg;
+  const TickType_t quiet_ticks = pdMS_TO_TICKS(CONFIG_OPENER_NV_STORE_DELAY_MS);
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    for (unsigned int deferrals = 0; deferrals < NV_CONFIG_MAX_DEFERRALS; ++deferrals) {
+      if (0 == ulTaskNotifyTake(pdTRUE, quiet_ticks)) {
+        break;
+      }
+    }
+
+    /* While overloaded the flash write, which stalls both cores, waits for
+     * the stack to recover, but not forever */
+    for (unsigned int waits = 0; waits < NV_CONFIG_MAX_OVERLOAD_WAITS &&
+         OverloadGovernorIsShedding(kOverloadStageNvWrites); ++waits) {
+      vTaskDelay(pdMS_TO_TICKS(NV_CONFIG_OVERLOAD_POLL_MS));
+    }
+
+    /* A change made during the write notifies again and is written on the
+     * next round */
+    (void)NvConfigCommit();
+  }
+}
+
+/* Created by the first NvConfigLoad(), before the stack and the web server
+ * run, so the callers of NvConfigCommitDeferred() only notify it */
+static void NvConfigStartWriter(void) {
+  if (pdPASS != xTaskCreate(NvConfigWriterTask, "nv_config",
+                            NV_CONFIG_WRITER_STACK_SIZE, NULL,
+                            NV_CONFIG_WRITER_PRIORITY, &s_nv_writer_task)) {
+    s_nv_writer_task = NULL;
+    ESP_LOGW(kTag, "No NV writer task, storing in the calling task");
+    return;
+  }
+#if CONFIG_OPENER_TASK_TELEMETRY
+  TaskTelemetryRegister(kTaskTelemetryNvWriter, NV_CONFIG_WRITER_STACK_SIZE);
+#endif
+}
+
+EipStatus NvConfigLoad(void) {
+  taskENTER_CRITICAL(&s_record_lock);
+  const bool loaded = s_loaded;
+  taskEXIT_CRITICAL(&s_record_lock);
+  if (!loaded) {
+    NvConfigRecord record;
+    NvConfigReadRecord(&record);
+    taskENTER_CRITICAL(&s_record_lock);
+    const bool first = !s_loaded;
+    if (first) {
+      s_record = record;
+      s_loaded = true;
+    }
+    taskEXIT_CRITICAL(&s_record_lock);
+    if (first) {
+      NvConfigStartWriter();
+    }
+  }
+  taskENTER_CRITICAL(&s_record_lock);
+  const uint32_t sections = s_record.sections;
+  taskEXIT_CRITICAL(&s_record_lock);
+  return (0U != sections) ? kEipStatusOk : kEipStatusError;
+}
+
+bool NvConfigGet(NvConfigSection section, void *data, size_t size) {
+  if ((unsigned)section >= kNvConfigSectionCount ||
+      kSectionLayout[section].size != size) {
+    return false;
+  }
+  (void)NvConfigLoad();
+  bool stored = false;
+  taskENTER_CRITICAL(&s_record_lock);
+  if (0U != (s_record.sections & (1UL << section))) {
+    memcpy(data, (const uint8_t *)&s_record + kSectionLayout[section].offset,
+           size);
+    stored = true;
+  }
+  taskEXIT_CRITICAL(&s_record_lock);
+  return stored;
+}
+
+bool NvConfigSet(NvConfigSection section, const void *data, size_t size) {
+  if ((unsigned)section >= kNvConfigSectionCount ||
+      kSectionLayout[section].size != size) {
+    return false;
+  }
+  (void)NvConfigLoad();
+  uint8_t *const target = (uint8_t *)&s_record + kSectionLayout[section].offset;
+  taskENTER_CRITICAL(&s_record_lock);
+  if (0U == (s_record.sections & (1UL << section)) ||
+      0 != memcmp(target, data, size)) {
+    memcpy(target, data, size);
+    s_record.sections |= 1UL << section;
+    s_dirty = true;
+  }
+  taskEXIT_CRITICAL(&s_record_lock);
+  return true;
+}
+
+EipStatus NvConfigCommit(void) {
+  NvConfigRecord record;
+  taskENTER_CRITICAL(&s_record_lock);
+  const bool dirty = s_dirty;
+  record = s_record;
+  s_dirty = false;
+  taskEXIT_CRITICAL(&s_record_lock);
+  if (!dirty) {
+    return kEipStatusOk;
+  }
+
+  record.version = NV_CONFIG_VERSION;
+  record.length = sizeof(record);
+  record.crc = NvConfigCrc(&record);
+
+  OPENER_TRACE_EVENT(kTraceEventNvCommit, record.sections, 0, 0);
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(NV_CONFIG_NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (ESP_OK == err) {
+    err = nvs_set_blob(handle, NV_CONFIG_NVS_KEY, &record, sizeof(record));
+    if (ESP_OK == err) {
+      err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+  }
+  OPENER_TRACE_EVENT_END(kTraceEventNvCommit, err);
+
+  if (ESP_OK != err) {
+    ESP_LOGE(kTag, "Failed to store the configuration record (%s)",
+             esp_err_to_name(err));
+    taskENTER_CRITICAL(&s_record_lock);
+    s_dirty = true;
+    taskEXIT_CRITICAL(&s_record_lock);
+    return kEipStatusError;
+  }
+  ESP_LOGI(kTag, "Stored the configuration record (sections 0x%02" PRIx32 ")",
+           record.sections);
+  return kEipStatusOk;
+}
+
+EipStatus NvConfigCommitDeferred(void) {
+  if (NULL == s_nv_writer_task) {
+    return NvConfigCommit();
+  }
+  xTaskNotifyGive(s_nv_writer_task);
+  return kEipStatusOk;
+}
@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * Copyright (c) 2019, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+/** @file nvconfig.h
+ *  @brief One configuration record for the NV data of the device
+ *
+ *  The TCP/IP, QoS and Ethernet Link objects and the I/O configuration are
+ *  kept in one versioned record, protected by a CRC and stored as a single
+ *  blob in the ESP32 NVS. NvConfigLoad() reads it once at boot; afterwards
+ *  the sections are read from and written to the RAM copy, and the record
+ *  goes to flash as a whole, either right away with NvConfigCommit() or
+ *  written behind by a low priority task with NvConfigCommitDeferred().
+ *
+ *  A section that was never stored reads as absent, its owner keeps its
+ *  defaults or takes the blob an older firmware stored under its own key.
+ */
+#ifndef _NVCONFIG_H_
+#define _NVCONFIG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+
+#define NV_CONFIG_TCPIP_DOMAIN_MAX_LEN   48U
+#define NV_CONFIG_TCPIP_HOSTNAME_MAX_LEN 64U
+/** Inputs the I/O section has a debounce time for */
+#define NV_CONFIG_IO_INPUT_COUNT         16U
+
+typedef enum {
+  kNvConfigSectionTcpip = 0, /**< NvConfigTcpip, TCP/IP Interface object */
+  kNvConfigSectionQos,       /**< NvConfigQos, QoS object */
+  kNvConfigSectionEthLink,   /**< NvConfigEthLink, Ethernet Link interface control */
+  kNvConfigSectionIo,        /**< NvConfigIo, input debounce times */
+  kNvConfigSectionCount
+} NvConfigSection;
+
+typedef struct __attribute__((packed)) {
+  uint32_t config_control;
+  uint32_t ip_address;
+  uint32_t network_mask;
+  uint32_t gateway;
+  uint32_t name_server;
+  uint32_t name_server2;
+  uint16_t domain_length;
+  uint16_t hostname_length;
+  uint8_t domain[NV_CONFIG_TCPIP_DOMAIN_MAX_LEN];
+  uint8_t hostname[NV_CONFIG_TCPIP_HOSTNAME_MAX_LEN];
+  uint8_t select_acd;
+  uint8_t quick_connect;
+} NvConfigTcpip;
+
+typedef struct __attribute__((packed)) {
+  uint8_t q_frames_enable;
+  uint8_t dscp_urgent;
+  uint8_t dscp_scheduled;
+  uint8_t dscp_high;
+  uint8_t dscp_low;
+  uint8_t dscp_explicit;
+} NvConfigQos;
+
+typedef struct __attribute__((packed)) {
+  uint16_t control_bits;
+  uint16_t forced_interface_speed;
+} NvConfigEthLink;
+
+typedef struct __attribute__((packed)) {
+  uint8_t input_count;
+  uint8_t debounce_ms[NV_CONFIG_IO_INPUT_COUNT];
+} NvConfigIo;
+
+/** @brief Read the record from NVS into RAM
+ *
+ *  Called once by app_main after nvs_flash_init(), before anything loads
+ *  its configuration. A later call does not read the flash again.
+ *
+ *  @return kEipStatusOk if a valid record was read, kEipStatusError if
+ *  none is stored or it failed the version, size or CRC check. All
+ *  sections are absent then.
+ */
+EipStatus NvConfigLoad(void);
+
+/** @brief Copy a section out of the RAM copy
+ *
+ *  @param section section to read
+ *  @param data receives the section
+ *  @param size size of the section's type
+ *  @return false if the section was never stored or size does not match
+ */
+bool NvConfigGet(NvConfigSection section, void *data, size_t size);
+
+/** @brief Change a section in the RAM copy
+ *
+ *  Does not write the flash, follow with NvConfigCommit() or
+ *  NvConfigCommitDeferred(). Setting the section to its stored value
+ *  leaves the record clean, so nothing is written for it.
+ *
+ *  @return false if size does not match the section's type
+ */
+bool NvConfigSet(NvConfigSection section, const void *data, size_t size);
+
+/** @brief Write the record now if a section changed
+ *
+ *  Takes milliseconds and stalls both cores, keep it out of the stack lock.
+ *
+ *  @return kEipStatusOk: stored or nothing to store; kEipStatusError: the
+ *  NVS write failed, the record stays dirty
+ */
+EipStatus NvConfigCommit(void);
+
+/** @brief Schedule writing the record without blocking the caller
+ *
+ *  The write happens in a low priority task once no further change arrived
+ *  for CONFIG_OPENER_NV_STORE_DELAY_MS, so the changes of one
+ *  configuration end up in a single write.
+ *
+ *  @return kEipStatusOk: write scheduled; kEipStatusError: the immediate
+ *  fallback write failed
+ */
+EipStatus NvConfigCommitDeferred(void);
+
+#endif  /* _NVCONFIG_H_ */
@@ -60,7 +60,7 @@ EipStatus NvdataLoad(void) {
  * at once using a single NvQosStore() call.
  */
 EipStatus NvQosSetCallback(CipInstance *const instance,
-                           CipAttributeStruct *const attribute,
+                           const CipAttributeStruct *const attribute,
                            CipByte service) {
   /* Suppress unused parameter compiler warning. */
   (void)service;
@@ -93,10 +93,11 @@ EipStatus NvQosSetCallback(CipInstance *const instance,
  * class instance to external storage.
  *
  * This application specific implementation chose to save all attributes
- * at once using a single NvTcpipStore() call.
+ * at once. NvTcpipStoreDeferred() keeps the flash write out of the stack and
+ * coalesces the Set_Attribute requests of one configuration change.
  */
 EipStatus NvTcpipSetCallback(CipInstance *const instance,
-                             CipAttributeStruct *const attribute,
+                             const CipAttributeStruct *const attribute,
                              CipByte service) {
   /* Suppress parameters used only for trace macros. */
 #ifndef OPENER_WITH_TRACES
@@ -112,7 +113,7 @@ EipStatus NvTcpipSetCallback(CipInstance *const instance,
                         instance->cip_class->class_name,
                         (EipUint32)instance->instance_number,
                         attribute->attribute_number);
-      status = NvTcpipStore(&g_tcpip);
+      status = NvTcpipStoreDeferred();
     }
   }
   return status;
@@ -20,14 +20,14 @@ EipStatus NvdataLoad(void);
 EipStatus NvQosSetCallback
 (
   CipInstance *const instance,
-  CipAttributeStruct *const attribute,
+  const CipAttributeStruct *const attribute,
   CipByte service
 );
 
 EipStatus NvTcpipSetCallback
 (
     CipInstance *const instance,
-    CipAttributeStruct *const attribute,
+    const CipAttributeStruct *const attribute,
     CipByte service
 );
 
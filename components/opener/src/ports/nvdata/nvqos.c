@@ -45,6 +45,7 @@ EipStatus NvQosLoad(CipQosObject *p_qos) {
   unsigned int dscp_high = 0;
   unsigned int dscp_low = 0;
   unsigned int dscp_explicit = 0;
+  unsigned int q_frames_enable = 0;
 
   FILE  *p_file = ConfFileOpen(false, QOS_CFG_NAME);
   if (NULL != p_file) {
@@ -56,12 +57,13 @@ EipStatus NvQosLoad(CipQosObject *p_qos) {
 
     /* Read input data */
     rd_cnt = fscanf(p_file,
-                    " %u, %u, %u, %u, %u\n",
+                    " %u, %u, %u, %u, %u, %u\n",
                     &dscp_urgent,
                     &dscp_scheduled,
                     &dscp_high,
                     &dscp_low,
-                    &dscp_explicit);
+                    &dscp_explicit,
+                    &q_frames_enable);
 
 /* Restore default depreciation warning behavior. */
 #ifdef _MSC_VER
@@ -81,17 +83,20 @@ EipStatus NvQosLoad(CipQosObject *p_qos) {
          || (dscp_scheduled > UCHAR_MAX)
          || (dscp_high > UCHAR_MAX)
          || (dscp_low > UCHAR_MAX)
-         || (dscp_explicit > UCHAR_MAX) ) {
+         || (dscp_explicit > UCHAR_MAX)
+         || (q_frames_enable > 1) ) {
       rd_cnt = 0;
     }
 
-    /* If all data were read copy them to the global QoS object. */
-    if (5 == rd_cnt) {
+    /* If all data were read copy them to the global QoS object. Files
+     * written before the 802.1Q Tag Enable was stored lack the last value. */
+    if (5 == rd_cnt || 6 == rd_cnt) {
       p_qos->dscp.urgent = (CipUsint)dscp_urgent;
       p_qos->dscp.scheduled = (CipUsint)dscp_scheduled;
       p_qos->dscp.high = (CipUsint)dscp_high;
       p_qos->dscp.low = (CipUsint)dscp_low;
       p_qos->dscp.explicit_msg = (CipUsint)dscp_explicit;
+      p_qos->q_frames_enable = (CipUsint)q_frames_enable;
     } else {
       eip_status = kEipStatusError;
     }
@@ -111,12 +116,13 @@ EipStatus NvQosStore(const CipQosObject *p_qos) {
     /* Print output data */
     if ( 0 >= fprintf(p_file,
                       " %" PRIu8 ", %" PRIu8 ", %" PRIu8 ", %" PRIu8 ", %" PRIu8
-                      "\n",
+                      ", %" PRIu8 "\n",
                       p_qos->dscp.urgent,
                       p_qos->dscp.scheduled,
                       p_qos->dscp.high,
                       p_qos->dscp.low,
-                      p_qos->dscp.explicit_msg) ) {
+                      p_qos->dscp.explicit_msg,
+                      p_qos->q_frames_enable) ) {
       eip_status = kEipStatusError;
     }
 
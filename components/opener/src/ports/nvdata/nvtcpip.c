@@ -7,8 +7,10 @@
 /** @file nvtcpip.c
  *  @brief This file implements the functions to handle TCP/IP object's NV data.
  *
- *  This is only a code skeleton. The real load and store operation is NOT
- *  implemented.
+ *  The configuration is the TCP/IP section of the configuration record, see
+ *  nvconfig.h. Changes made by the stack are written behind by the record's
+ *  writer task, see NvTcpipStoreDeferred(). The blob earlier firmware stored
+ *  under its own key is taken over into the record once.
  */
 #include "nvtcpip.h"
 
@@ -22,13 +24,15 @@
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "lwip/ip4_addr.h"
+#include "nvconfig.h"
 
+/* The blob of earlier firmware, read once to fill the record */
 #define TCPIP_NVS_NAMESPACE  "opener"   /**< NVS namespace for TCP/IP data */
 #define TCPIP_NVS_KEY        "tcpip_cfg"
-#define TCPIP_NV_VERSION     2U
+#define TCPIP_NV_VERSION     3U
 
-#define TCPIP_DOMAIN_MAX_LEN   48U
-#define TCPIP_HOSTNAME_MAX_LEN 64U
+#define TCPIP_DOMAIN_MAX_LEN   NV_CONFIG_TCPIP_DOMAIN_MAX_LEN
+#define TCPIP_HOSTNAME_MAX_LEN NV_CONFIG_TCPIP_HOSTNAME_MAX_LEN
 
 static const char *kTag = "NvTcpip";
 
@@ -45,8 +49,24 @@ typedef struct __attribute__((packed)) {
   uint8_t domain[TCPIP_DOMAIN_MAX_LEN];
   uint8_t hostname[TCPIP_HOSTNAME_MAX_LEN];
   uint8_t select_acd;
+  uint8_t quick_connect;
 } TcpipNvBlob;
 
+typedef struct __attribute__((packed)) {
+  uint32_t version;
+  uint32_t config_control;
+  uint32_t ip_address;
+  uint32_t network_mask;
+  uint32_t gateway;
+  uint32_t name_server;
+  uint32_t name_server2;
+  uint16_t domain_length;
+  uint16_t hostname_length;
+  uint8_t domain[TCPIP_DOMAIN_MAX_LEN];
+  uint8_t hostname[TCPIP_HOSTNAME_MAX_LEN];
+  uint8_t select_acd;
+} TcpipNvBlobV2;
+
 typedef struct __attribute__((packed)) {
   uint32_t version;
   uint32_t config_control;
@@ -61,26 +81,19 @@ typedef struct __attribute__((packed)) {
   uint8_t hostname[TCPIP_HOSTNAME_MAX_LEN];
 } TcpipNvBlobV1;
 
-static esp_err_t TcpipNvOpen(nvs_handle_t *handle, nvs_open_mode_t mode) {
-  esp_err_t err = nvs_open(TCPIP_NVS_NAMESPACE, mode, handle);
-  if (ESP_ERR_NVS_NOT_FOUND == err && mode == NVS_READWRITE) {
-    /* Namespace does not exist yet - create by opening in read/write */
-    err = nvs_open(TCPIP_NVS_NAMESPACE, NVS_READWRITE, handle);
-  }
+static esp_err_t TcpipNvOpen(nvs_handle_t *handle) {
+  esp_err_t err = nvs_open(TCPIP_NVS_NAMESPACE, NVS_READONLY, handle);
   if (ESP_OK != err && ESP_ERR_NVS_NOT_FOUND != err) {
     ESP_LOGE(kTag, "nvs_open failed (%s)", esp_err_to_name(err));
   }
   return err;
 }
 
-/** @brief Load NV data of the TCP/IP object from NVS
- *
- *  @param  p_tcp_ip pointer to the TCP/IP object's data structure
- *  @return kEipStatusOk: success; kEipStatusError: failure
- */
-EipStatus NvTcpipLoad(CipTcpIpObject *p_tcp_ip) {
+/* Read the blob of earlier firmware from the NVS, a version 1 or 2 blob is
+ * converted */
+static EipStatus TcpipNvReadBlob(TcpipNvBlob *blob) {
   nvs_handle_t handle;
-  esp_err_t err = TcpipNvOpen(&handle, NVS_READONLY);
+  esp_err_t err = TcpipNvOpen(&handle);
   if (ESP_ERR_NVS_NOT_FOUND == err) {
     ESP_LOGI(kTag, "No stored TCP/IP configuration found, using defaults");
     return kEipStatusError;
@@ -101,44 +114,95 @@ EipStatus NvTcpipLoad(CipTcpIpObject *p_tcp_ip) {
     return kEipStatusError;
   }
 
-  const TcpipNvBlob *blob_v2 = NULL;
-  TcpipNvBlobV1 blob_v1 = {0};
-
   if (length == sizeof(TcpipNvBlob)) {
-    blob_v2 = (const TcpipNvBlob *)raw_blob;
-    if (blob_v2->version != TCPIP_NV_VERSION) {
+    memcpy(blob, raw_blob, sizeof(*blob));
+    if (blob->version != TCPIP_NV_VERSION) {
       ESP_LOGW(kTag, "Stored TCP/IP configuration has unexpected version %" PRIu32,
-               blob_v2->version);
+               blob->version);
       return kEipStatusError;
     }
+  } else if (length == sizeof(TcpipNvBlobV2)) {
+    TcpipNvBlobV2 blob_v2;
+    memcpy(&blob_v2, raw_blob, sizeof(blob_v2));
+    if (blob_v2.version != 2U) {
+      ESP_LOGW(kTag, "Stored TCP/IP configuration has incompatible format");
+      return kEipStatusError;
+    }
+    memset(blob, 0, sizeof(*blob));
+    memcpy(blob, &blob_v2, sizeof(blob_v2)); /* same layout up to quick_connect */
+    blob->version = TCPIP_NV_VERSION;
+    blob->quick_connect = 0u;
   } else if (length == sizeof(TcpipNvBlobV1)) {
+    TcpipNvBlobV1 blob_v1;
     memcpy(&blob_v1, raw_blob, sizeof(blob_v1));
     if (blob_v1.version != 1U) {
       ESP_LOGW(kTag, "Stored TCP/IP configuration has incompatible format");
       return kEipStatusError;
     }
+    memset(blob, 0, sizeof(*blob));
+    memcpy(blob, &blob_v1, sizeof(blob_v1)); /* same layout up to select_acd */
+    blob->version = TCPIP_NV_VERSION;
+    blob->select_acd = 0u;
+    blob->quick_connect = 0u;
   } else {
     ESP_LOGW(kTag, "Stored TCP/IP configuration has incompatible format");
     return kEipStatusError;
   }
+  return kEipStatusOk;
+}
 
-  if (blob_v2 != NULL) {
-    p_tcp_ip->config_control = blob_v2->config_control;
-    p_tcp_ip->interface_configuration.ip_address = blob_v2->ip_address;
-    p_tcp_ip->interface_configuration.network_mask = blob_v2->network_mask;
-    p_tcp_ip->interface_configuration.gateway = blob_v2->gateway;
-    p_tcp_ip->interface_configuration.name_server = blob_v2->name_server;
-    p_tcp_ip->interface_configuration.name_server_2 = blob_v2->name_server2;
-    p_tcp_ip->select_acd = (blob_v2->select_acd != 0u);
-  } else {
-    p_tcp_ip->config_control = blob_v1.config_control;
-    p_tcp_ip->interface_configuration.ip_address = blob_v1.ip_address;
-    p_tcp_ip->interface_configuration.network_mask = blob_v1.network_mask;
-    p_tcp_ip->interface_configuration.gateway = blob_v1.gateway;
-    p_tcp_ip->interface_configuration.name_server = blob_v1.name_server;
-    p_tcp_ip->interface_configuration.name_server_2 = blob_v1.name_server2;
-    p_tcp_ip->select_acd = false;
+_Static_assert(sizeof(TcpipNvBlob) == sizeof(uint32_t) + sizeof(NvConfigTcpip),
+               "TcpipNvBlob is the version and NvConfigTcpip");
+
+/* Only the first load without a section looks for the blob of earlier
+ * firmware, the stack loads again on every start after a link loss */
+static bool s_legacy_read = false;
+
+/* The section of the record, or the blob of earlier firmware moved into it */
+static EipStatus TcpipNvGetConfig(NvConfigTcpip *config) {
+  if (NvConfigGet(kNvConfigSectionTcpip, config, sizeof(*config))) {
+    return kEipStatusOk;
+  }
+  if (s_legacy_read) {
+    return kEipStatusError;
+  }
+  s_legacy_read = true;
+  TcpipNvBlob blob;
+  if (kEipStatusOk != TcpipNvReadBlob(&blob)) {
+    return kEipStatusError;
   }
+  /* Same layout after the version */
+  memcpy(config, (const uint8_t *)&blob + sizeof(blob.version), sizeof(*config));
+  (void)NvConfigSet(kNvConfigSectionTcpip, config, sizeof(*config));
+  (void)NvConfigCommitDeferred();
+  ESP_LOGI(kTag, "Moving the stored TCP/IP configuration into the configuration record");
+  return kEipStatusOk;
+}
+
+static void TcpipNvFillConfig(const CipTcpIpObject *p_tcp_ip, NvConfigTcpip *config);
+
+/** @brief Load NV data of the TCP/IP object from the configuration record
+ *
+ *  Reads the RAM copy of the record, the flash only to take over the blob
+ *  of earlier firmware.
+ *
+ *  @param  p_tcp_ip pointer to the TCP/IP object's data structure
+ *  @return kEipStatusOk: success; kEipStatusError: failure
+ */
+EipStatus NvTcpipLoad(CipTcpIpObject *p_tcp_ip) {
+  NvConfigTcpip blob;
+  if (kEipStatusOk != TcpipNvGetConfig(&blob)) {
+    return kEipStatusError;
+  }
+
+  p_tcp_ip->config_control = blob.config_control;
+  p_tcp_ip->interface_configuration.ip_address = blob.ip_address;
+  p_tcp_ip->interface_configuration.network_mask = blob.network_mask;
+  p_tcp_ip->interface_configuration.gateway = blob.gateway;
+  p_tcp_ip->interface_configuration.name_server = blob.name_server;
+  p_tcp_ip->interface_configuration.name_server_2 = blob.name_server2;
+  p_tcp_ip->select_acd = (blob.select_acd != 0u);
+  p_tcp_ip->quick_connect = (blob.quick_connect != 0u);
 
   ip4_addr_t nv_ip = { .addr = p_tcp_ip->interface_configuration.ip_address };
   ip4_addr_t nv_mask = { .addr = p_tcp_ip->interface_configuration.network_mask };
@@ -168,31 +232,29 @@ EipStatus NvTcpipLoad(CipTcpIpObject *p_tcp_ip) {
            dns1_print,
            dns2_print);
 
-  ClearCipString(&p_tcp_ip->interface_configuration.domain_name);
-  uint16_t domain_length = blob_v2 ? blob_v2->domain_length : blob_v1.domain_length;
+  (void) ClearCipStringFixed(&p_tcp_ip->interface_configuration.domain_name.header);
+  uint16_t domain_length = blob.domain_length;
   if (domain_length > TCPIP_DOMAIN_MAX_LEN) {
     domain_length = TCPIP_DOMAIN_MAX_LEN;
   }
   if (domain_length > 0u) {
-    const uint8_t *domain_src = blob_v2 ? blob_v2->domain : blob_v1.domain;
-    if (NULL == SetCipStringByData(&p_tcp_ip->interface_configuration.domain_name,
-                                   domain_length,
-                                   domain_src)) {
+    if (NULL == CIP_STRING_FIXED_SET_BY_DATA(&p_tcp_ip->interface_configuration.domain_name,
+                                             domain_length,
+                                             blob.domain)) {
       ESP_LOGE(kTag, "Failed to restore domain name");
       return kEipStatusError;
     }
   }
 
-  ClearCipString(&p_tcp_ip->hostname);
-  uint16_t hostname_length = blob_v2 ? blob_v2->hostname_length : blob_v1.hostname_length;
+  (void) ClearCipStringFixed(&p_tcp_ip->hostname.header);
+  uint16_t hostname_length = blob.hostname_length;
   if (hostname_length > TCPIP_HOSTNAME_MAX_LEN) {
     hostname_length = TCPIP_HOSTNAME_MAX_LEN;
   }
   if (hostname_length > 0u) {
-    const uint8_t *hostname_src = blob_v2 ? blob_v2->hostname : blob_v1.hostname;
-    if (NULL == SetCipStringByData(&p_tcp_ip->hostname,
-                                   hostname_length,
-                                   hostname_src)) {
+    if (NULL == CIP_STRING_FIXED_SET_BY_DATA(&p_tcp_ip->hostname,
+                                             hostname_length,
+                                             blob.hostname)) {
       ESP_LOGE(kTag, "Failed to restore host name");
       return kEipStatusError;
     }
@@ -213,15 +275,13 @@ EipStatus NvTcpipLoad(CipTcpIpObject *p_tcp_ip) {
       p_tcp_ip->interface_configuration.name_server = 0u;
       p_tcp_ip->interface_configuration.name_server_2 = 0u;
       p_tcp_ip->status &= ~(kTcpipStatusAcdStatus | kTcpipStatusAcdFault);
-      (void)NvTcpipStore(p_tcp_ip);
+      NvConfigTcpip config;
+      TcpipNvFillConfig(p_tcp_ip, &config);
+      (void)NvConfigSet(kNvConfigSectionTcpip, &config, sizeof(config));
+      (void)NvConfigCommitDeferred();
     }
   }
 
-  if (blob_v2 == NULL) {
-    /* Upgrade legacy blob to latest format */
-    (void)NvTcpipStore(p_tcp_ip);
-  }
-
   ESP_LOGI(kTag, "Restored TCP/IP configuration (method=%s)",
            ( (p_tcp_ip->config_control & kTcpipCfgCtrlMethodMask) == kTcpipCfgCtrlDhcp) ?
            "DHCP" : "Static");
@@ -229,63 +289,67 @@ EipStatus NvTcpipLoad(CipTcpIpObject *p_tcp_ip) {
   return kEipStatusOk;
 }
 
-/** @brief Store NV data of the TCP/IP object to NVS
- *
- *  @param  p_tcp_ip pointer to the TCP/IP object's data structure
- *  @return kEipStatusOk: success; kEipStatusError: failure
- */
-EipStatus NvTcpipStore(const CipTcpIpObject *p_tcp_ip) {
-  nvs_handle_t handle;
-  esp_err_t err = TcpipNvOpen(&handle, NVS_READWRITE);
-  if (ESP_OK != err) {
-    return kEipStatusError;
-  }
-
-  TcpipNvBlob blob = {0};
-  blob.version = TCPIP_NV_VERSION;
-  blob.config_control = p_tcp_ip->config_control;
-  blob.ip_address = p_tcp_ip->interface_configuration.ip_address;
-  blob.network_mask = p_tcp_ip->interface_configuration.network_mask;
-  blob.gateway = p_tcp_ip->interface_configuration.gateway;
-  blob.name_server = p_tcp_ip->interface_configuration.name_server;
-  blob.name_server2 = p_tcp_ip->interface_configuration.name_server_2;
-
-  if (p_tcp_ip->interface_configuration.domain_name.length > TCPIP_DOMAIN_MAX_LEN) {
-    blob.domain_length = TCPIP_DOMAIN_MAX_LEN;
+static void TcpipNvFillConfig(const CipTcpIpObject *p_tcp_ip, NvConfigTcpip *blob) {
+  memset(blob, 0, sizeof(*blob));
+  blob->config_control = p_tcp_ip->config_control;
+  blob->ip_address = p_tcp_ip->interface_configuration.ip_address;
+  blob->network_mask = p_tcp_ip->interface_configuration.network_mask;
+  blob->gateway = p_tcp_ip->interface_configuration.gateway;
+  blob->name_server = p_tcp_ip->interface_configuration.name_server;
+  blob->name_server2 = p_tcp_ip->interface_configuration.name_server_2;
+
+  if (p_tcp_ip->interface_configuration.domain_name.header.length > TCPIP_DOMAIN_MAX_LEN) {
+    blob->domain_length = TCPIP_DOMAIN_MAX_LEN;
   } else {
-    blob.domain_length = p_tcp_ip->interface_configuration.domain_name.length;
+    blob->domain_length = p_tcp_ip->interface_configuration.domain_name.header.length;
   }
-  if (blob.domain_length > 0u && NULL != p_tcp_ip->interface_configuration.domain_name.string) {
-    memcpy(blob.domain,
+  if (blob->domain_length > 0u) {
+    memcpy(blob->domain,
            p_tcp_ip->interface_configuration.domain_name.string,
-           blob.domain_length);
+           blob->domain_length);
   }
 
-  if (p_tcp_ip->hostname.length > TCPIP_HOSTNAME_MAX_LEN) {
-    blob.hostname_length = TCPIP_HOSTNAME_MAX_LEN;
+  if (p_tcp_ip->hostname.header.length > TCPIP_HOSTNAME_MAX_LEN) {
+    blob->hostname_length = TCPIP_HOSTNAME_MAX_LEN;
   } else {
-    blob.hostname_length = p_tcp_ip->hostname.length;
+    blob->hostname_length = p_tcp_ip->hostname.header.length;
   }
-  if (blob.hostname_length > 0u && NULL != p_tcp_ip->hostname.string) {
-    memcpy(blob.hostname, p_tcp_ip->hostname.string, blob.hostname_length);
+  if (blob->hostname_length > 0u) {
+    memcpy(blob->hostname, p_tcp_ip->hostname.string, blob->hostname_length);
   }
 
-  blob.select_acd = p_tcp_ip->select_acd ? 1u : 0u;
-
-  err = nvs_set_blob(handle, TCPIP_NVS_KEY, &blob, sizeof(blob));
-  if (ESP_OK == err) {
-    err = nvs_commit(handle);
-  }
-  nvs_close(handle);
-
-  if (ESP_OK != err) {
-    ESP_LOGE(kTag, "Failed to store TCP/IP configuration (%s)", esp_err_to_name(err));
-    return kEipStatusError;
-  }
+  blob->select_acd = p_tcp_ip->select_acd ? 1u : 0u;
+  blob->quick_connect = p_tcp_ip->quick_connect ? 1u : 0u;
+}
 
+static void TcpipNvLogStored(const NvConfigTcpip *config) {
   ESP_LOGI(kTag, "Stored TCP/IP configuration (method=%s)",
-           ((p_tcp_ip->config_control & kTcpipCfgCtrlMethodMask) == kTcpipCfgCtrlDhcp) ?
+           ((config->config_control & kTcpipCfgCtrlMethodMask) == kTcpipCfgCtrlDhcp) ?
            "DHCP" : "Static");
+}
 
+/** @brief Store NV data of the TCP/IP object to NVS
+ *
+ *  Writes the configuration record right away.
+ *
+ *  @param  p_tcp_ip pointer to the TCP/IP object's data structure
+ *  @return kEipStatusOk: success; kEipStatusError: failure
+ */
+EipStatus NvTcpipStore(const CipTcpIpObject *p_tcp_ip) {
+  NvConfigTcpip config;
+  TcpipNvFillConfig(p_tcp_ip, &config);
+  (void)NvConfigSet(kNvConfigSectionTcpip, &config, sizeof(config));
+  if (kEipStatusOk != NvConfigCommit()) {
+    return kEipStatusError;
+  }
+  TcpipNvLogStored(&config);
   return kEipStatusOk;
 }
+
+EipStatus NvTcpipStoreDeferred(void) {
+  /* The caller holds the stack lock, g_tcpip is consistent */
+  NvConfigTcpip config;
+  TcpipNvFillConfig(&g_tcpip, &config);
+  (void)NvConfigSet(kNvConfigSectionTcpip, &config, sizeof(config));
+  return NvConfigCommitDeferred();
+}
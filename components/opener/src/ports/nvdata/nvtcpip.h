@@ -19,4 +19,15 @@ EipStatus NvTcpipLoad(CipTcpIpObject *p_tcp_ip);
 
 EipStatus NvTcpipStore(const CipTcpIpObject *p_tcp_ip);
 
+/** @brief Schedule storing g_tcpip without blocking the caller
+ *
+ *  Marks the configuration dirty; the store happens later outside the
+ *  calling task, once no further change arrived for a short quiet period.
+ *  Call with the stack lock held, i.e. from the stack's callbacks.
+ *
+ *  @return kEipStatusOk: store scheduled; kEipStatusError: the immediate
+ *  fallback store failed
+ */
+EipStatus NvTcpipStoreDeferred(void);
+
 #endif  /* _NVTCPIP_H_ */
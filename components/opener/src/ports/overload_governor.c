@@ -0,0 +1,163 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "overload_governor.h"
+
+#include <stdint.h>
+
+#include "cipconnectionmanager.h"
+#include "opener_user_conf.h"
+#include "trace.h"
+
+#ifndef OPENER_OVERLOAD_GOVERNOR
+#define OPENER_OVERLOAD_GOVERNOR 0
+#endif
+
+#ifndef OPENER_OVERLOAD_LOOP_BUDGET_US
+/** An iteration this long delays the next timer tick */
+#define OPENER_OVERLOAD_LOOP_BUDGET_US (kOpenerTimerTickInMilliSeconds * 1000U)
+#endif
+
+#ifndef OPENER_OVERLOAD_WINDOW_MS
+#define OPENER_OVERLOAD_WINDOW_MS 1000U
+#endif
+
+#ifndef OPENER_OVERLOAD_OVERRUNS_PER_WINDOW
+#define OPENER_OVERLOAD_OVERRUNS_PER_WINDOW 3U
+#endif
+
+#ifndef OPENER_OVERLOAD_LATE_PERCENT
+/** Share of late productions a window tolerates; one tick of slack over
+ *  max(RPI, tick) already covers timer tick production without load */
+#define OPENER_OVERLOAD_LATE_PERCENT 10U
+#endif
+
+#ifndef OPENER_OVERLOAD_ENTER_WINDOWS
+#define OPENER_OVERLOAD_ENTER_WINDOWS 2U
+#endif
+
+#ifndef OPENER_OVERLOAD_EXIT_WINDOWS
+/** Slower than entering, so the stage does not flap at the limit */
+#define OPENER_OVERLOAD_EXIT_WINDOWS 5U
+#endif
+
+static const char *const kOverloadStageNames[kOverloadNumberOfStages] = {
+  "none", "services", "discovery", "nv_writes", "sessions",
+};
+
+/* Read by any task, written with the stack lock held */
+static OverloadGovernorStatistics s_statistics;
+
+/* Stack lock only */
+static MilliSeconds s_window_start = 0;
+static CipUdint s_window_overruns = 0;
+static CipUdint s_last_productions = 0;
+static CipUdint s_last_late_productions = 0;
+static CipUdint s_overloaded_windows = 0;
+static CipUdint s_clean_windows = 0;
+static OverloadGovernorStageCallback s_stage_callback = NULL;
+
+static void OverloadGovernorStore(CipUdint *const value, const CipUdint update) {
+  __atomic_store_n(value, update, __ATOMIC_RELAXED);
+}
+
+static CipUdint OverloadGovernorLoad(const CipUdint *const value) {
+  return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+void OverloadGovernorRecordLoop(const MicroSeconds busy_time) {
+  if(busy_time > OPENER_OVERLOAD_LOOP_BUDGET_US) {
+    s_window_overruns++;
+    OverloadGovernorStore(&s_statistics.loop_overruns,
+                          s_statistics.loop_overruns + 1);
+  }
+}
+
+static void OverloadGovernorSetStage(const CipUdint stage) {
+  OverloadGovernorStore(&s_statistics.stage, stage);
+  OverloadGovernorStore(&s_statistics.stage_changes,
+                        s_statistics.stage_changes + 1);
+  if(stage > s_statistics.highest_stage) {
+    OverloadGovernorStore(&s_statistics.highest_stage, stage);
+  }
+  OPENER_TRACE_WARN("overload: shedding stage %s\n",
+                    kOverloadStageNames[stage]);
+  if(NULL != s_stage_callback) {
+    s_stage_callback( (OverloadStage) stage );
+  }
+}
+
+void OverloadGovernorEvaluate(const MilliSeconds now) {
+  if(!OPENER_OVERLOAD_GOVERNOR ||
+     now - s_window_start < OPENER_OVERLOAD_WINDOW_MS) {
+    return;
+  }
+  s_window_start = now;
+  CipUdint productions = 0;
+  CipUdint late_productions = 0;
+  ConnectionManagerGetProductionCounts(&productions, &late_productions);
+  const CipUdint new_productions = productions - s_last_productions;
+  const CipUdint new_late_productions = late_productions -
+                                        s_last_late_productions;
+  s_last_productions = productions;
+  s_last_late_productions = late_productions;
+  OverloadGovernorStore(&s_statistics.late_productions,
+                        s_statistics.late_productions + new_late_productions);
+  const bool overloaded =
+    (uint64_t) new_late_productions * 100U >
+    (uint64_t) new_productions * OPENER_OVERLOAD_LATE_PERCENT ||
+    s_window_overruns >= OPENER_OVERLOAD_OVERRUNS_PER_WINDOW;
+  s_window_overruns = 0;
+
+  const CipUdint stage = s_statistics.stage;
+  if(overloaded) {
+    OverloadGovernorStore(&s_statistics.overloaded_windows,
+                          s_statistics.overloaded_windows + 1);
+    s_clean_windows = 0;
+    if(++s_overloaded_windows >= OPENER_OVERLOAD_ENTER_WINDOWS &&
+       stage + 1 < kOverloadNumberOfStages) {
+      s_overloaded_windows = 0;
+      OverloadGovernorSetStage(stage + 1);
+    }
+  } else {
+    s_overloaded_windows = 0;
+    if(++s_clean_windows >= OPENER_OVERLOAD_EXIT_WINDOWS &&
+       stage > kOverloadStageNone) {
+      s_clean_windows = 0;
+      OverloadGovernorSetStage(stage - 1);
+    }
+  }
+}
+
+OverloadStage OverloadGovernorGetStage(void) {
+  return (OverloadStage) OverloadGovernorLoad(&s_statistics.stage);
+}
+
+bool OverloadGovernorIsShedding(const OverloadStage stage) {
+  return OverloadGovernorGetStage() >= stage;
+}
+
+const char *OverloadGovernorGetStageName(const OverloadStage stage) {
+  return stage < kOverloadNumberOfStages ? kOverloadStageNames[stage] :
+         "unknown";
+}
+
+void OverloadGovernorSetStageCallback(
+  const OverloadGovernorStageCallback callback) {
+  s_stage_callback = callback;
+}
+
+void OverloadGovernorGetStatistics(
+  OverloadGovernorStatistics *const statistics) {
+  statistics->stage = OverloadGovernorLoad(&s_statistics.stage);
+  statistics->highest_stage = OverloadGovernorLoad(&s_statistics.highest_stage);
+  statistics->loop_overruns = OverloadGovernorLoad(&s_statistics.loop_overruns);
+  statistics->late_productions =
+    OverloadGovernorLoad(&s_statistics.late_productions);
+  statistics->overloaded_windows =
+    OverloadGovernorLoad(&s_statistics.overloaded_windows);
+  statistics->stage_changes = OverloadGovernorLoad(&s_statistics.stage_changes);
+}
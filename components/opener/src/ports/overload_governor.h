@@ -0,0 +1,90 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_OVERLOAD_GOVERNOR_H_
+#define OPENER_OVERLOAD_GOVERNOR_H_
+
+/** @file overload_governor.h
+ *  @brief Staged shedding of best effort work while the stack is overloaded
+ *
+ *  Enabled with OPENER_OVERLOAD_GOVERNOR. The network handler reports the
+ *  busy time of every loop iteration, an iteration longer than
+ *  OPENER_OVERLOAD_LOOP_BUDGET_US counts as overrun. Every
+ *  OPENER_OVERLOAD_WINDOW_MS the window is overloaded if it had
+ *  OPENER_OVERLOAD_OVERRUNS_PER_WINDOW overruns or more than
+ *  OPENER_OVERLOAD_LATE_PERCENT of its productions came more than one timer
+ *  tick after max(RPI, tick), see ConnectionManagerGetProductionCounts().
+ *
+ *  After OPENER_OVERLOAD_ENTER_WINDOWS overloaded windows in a row the
+ *  governor sheds one more stage, after OPENER_OVERLOAD_EXIT_WINDOWS clean
+ *  ones in a row it gives one back. Each stage keeps the ones below:
+ *  1. services: web UI sessions and SNMP requests are throttled;
+ *  2. discovery: ListIdentity replies take the full delay the request
+ *     allows;
+ *  3. NV writes: NVS commits of the configuration wait for recovery;
+ *  4. sessions: TCP connections of peers without an I/O connection are
+ *     refused.
+ *  I/O connections are never shed, an I/O originator still gets a session.
+ */
+
+#include <stdbool.h>
+
+#include "typedefs.h"
+
+typedef enum {
+  kOverloadStageNone = 0,
+  kOverloadStageServices, /**< throttle web UI and SNMP */
+  kOverloadStageDiscovery, /**< delay ListIdentity replies */
+  kOverloadStageNvWrites, /**< defer NVS commits */
+  kOverloadStageSessions, /**< refuse new explicit sessions */
+  kOverloadNumberOfStages
+} OverloadStage;
+
+/** @brief Counters since start up */
+typedef struct {
+  CipUdint stage; /**< current OverloadStage */
+  CipUdint highest_stage; /**< highest stage reached */
+  CipUdint loop_overruns; /**< iterations above the loop budget */
+  CipUdint late_productions; /**< productions a tick after max(RPI, tick) */
+  CipUdint overloaded_windows;
+  CipUdint stage_changes;
+} OverloadGovernorStatistics;
+
+/** @brief Called with the stack lock held when the stage changed */
+typedef void (*OverloadGovernorStageCallback)(const OverloadStage stage);
+
+/** @brief Add the busy time of one loop iteration, with the stack lock held */
+void OverloadGovernorRecordLoop(const MicroSeconds busy_time);
+
+/** @brief Close the window once it elapsed, called once per loop iteration
+ *  with the stack lock held
+ *
+ *  @param now current time
+ */
+void OverloadGovernorEvaluate(const MilliSeconds now);
+
+/** @brief Current stage, may be called from any task */
+OverloadStage OverloadGovernorGetStage(void);
+
+/** @brief True while the given stage or a higher one is shed, may be called
+ *  from any task */
+bool OverloadGovernorIsShedding(const OverloadStage stage);
+
+/** @brief Name of a stage, as used in the web API */
+const char *OverloadGovernorGetStageName(const OverloadStage stage);
+
+/** @brief Set the one function told about stage changes, NULL for none */
+void OverloadGovernorSetStageCallback(
+  const OverloadGovernorStageCallback callback);
+
+/** @brief Copy the counters, may be called from any task
+ *
+ *  Each value is read atomically; one updated meanwhile can be newer than
+ *  the others.
+ */
+void OverloadGovernorGetStatistics(
+  OverloadGovernorStatistics *const statistics);
+
+#endif /* OPENER_OVERLOAD_GOVERNOR_H_ */
@@ -6,6 +6,9 @@
 
 #include "socket_timer.h"
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #include "trace.h"
 
 void SocketTimerSetSocket(SocketTimer *const socket_timer,
@@ -29,6 +32,8 @@ MilliSeconds SocketTimerGetLastUpdate(SocketTimer *const socket_timer) {
 void SocketTimerClear(SocketTimer *const socket_timer) {
   socket_timer->socket = kEipInvalidSocket;
   socket_timer->last_update = 0;
+  socket_timer->previous = NULL;
+  socket_timer->next = NULL;
 }
 
 void SocketTimerArrayInitialize(SocketTimer *const array_of_socket_timers,
@@ -56,3 +61,56 @@ SocketTimer *SocketTimerArrayGetEmptySocketTimer(
   return SocketTimerArrayGetSocketTimer(array_of_socket_timers, array_length,
                                         kEipInvalidSocket);
 }
+
+void SocketTimerListInitialize(SocketTimerList *const list) {
+  list->oldest = NULL;
+  list->newest = NULL;
+}
+
+static bool SocketTimerListContains(const SocketTimerList *const list,
+                                    const SocketTimer *const socket_timer) {
+  return NULL != socket_timer->previous || list->oldest == socket_timer;
+}
+
+void SocketTimerListRemove(SocketTimerList *const list,
+                           SocketTimer *const socket_timer) {
+  if (!SocketTimerListContains(list, socket_timer) ) {
+    return;
+  }
+  if (NULL != socket_timer->previous) {
+    socket_timer->previous->next = socket_timer->next;
+  } else {
+    list->oldest = socket_timer->next;
+  }
+  if (NULL != socket_timer->next) {
+    socket_timer->next->previous = socket_timer->previous;
+  } else {
+    list->newest = socket_timer->previous;
+  }
+  socket_timer->previous = NULL;
+  socket_timer->next = NULL;
+}
+
+void SocketTimerListUpdate(SocketTimerList *const list,
+                           SocketTimer *const socket_timer,
+                           const MilliSeconds actual_time) {
+  if (NULL == socket_timer) {
+    return;
+  }
+  SocketTimerSetLastUpdate(socket_timer, actual_time);
+  if (list->newest == socket_timer) {
+    return;
+  }
+  SocketTimerListRemove(list, socket_timer);
+  socket_timer->previous = list->newest;
+  if (NULL != list->newest) {
+    list->newest->next = socket_timer;
+  } else {
+    list->oldest = socket_timer;
+  }
+  list->newest = socket_timer;
+}
+
+SocketTimer *SocketTimerListGetOldest(const SocketTimerList *const list) {
+  return list->oldest;
+}
@@ -15,8 +15,21 @@
 typedef struct socket_timer {
   int socket;       /**< key */
   MilliSeconds last_update;       /**< time stop of last update */
+  struct socket_timer *previous;       /**< less recently updated timer in the SocketTimerList */
+  struct socket_timer *next;       /**< more recently updated timer in the SocketTimerList */
 } SocketTimer;
 
+/** @brief Socket Timers ordered by their last update
+ *
+ * All sockets share the same inactivity timeout, so moving a timer to the
+ * end of the list on every update keeps the list sorted by deadline and
+ * the next timer to expire is always the first one.
+ */
+typedef struct {
+  SocketTimer *oldest; /**< least recently updated timer */
+  SocketTimer *newest; /**< most recently updated timer */
+} SocketTimerList;
+
 
 /** @brief
  * Sets socket of a Socket Timer
@@ -86,4 +99,41 @@ SocketTimer *SocketTimerArrayGetEmptySocketTimer(
   SocketTimer *const array_of_socket_timers,
   const size_t array_length);
 
+/** @brief
+ * Initializes an empty Socket Timer list
+ *
+ * @param list The list to be initialized
+ */
+void SocketTimerListInitialize(SocketTimerList *const list);
+
+/** @brief
+ * Sets the time stamp of a Socket Timer and moves it to the end of the list
+ *
+ * Timers not in the list yet are appended.
+ *
+ * @param list The Socket Timer list
+ * @param socket_timer Socket Timer to be updated, NULL is ignored
+ * @param actual_time Time stamp
+ */
+void SocketTimerListUpdate(SocketTimerList *const list,
+                           SocketTimer *const socket_timer,
+                           const MilliSeconds actual_time);
+
+/** @brief
+ * Removes a Socket Timer from the list, timers not in the list are ignored
+ *
+ * @param list The Socket Timer list
+ * @param socket_timer Socket Timer to be removed
+ */
+void SocketTimerListRemove(SocketTimerList *const list,
+                           SocketTimer *const socket_timer);
+
+/** @brief
+ * Get the least recently updated Socket Timer
+ *
+ * @param list The Socket Timer list
+ * @return The first Socket Timer to expire, NULL if the list is empty
+ */
+SocketTimer *SocketTimerListGetOldest(const SocketTimerList *const list);
+
 #endif /* SRC_PORTS_SOCKET_TIMER_H_ */
@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * Copyright (c) 2016, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "tcp_receive_buffer.h"
+
+#include "encap.h"
+#include "endianconv.h"
+#include "messagebufferpool.h"
+#include "trace.h"
+
+/** Offset of the length field in the encapsulation header */
+#define TCP_RECEIVE_BUFFER_LENGTH_FIELD_OFFSET 2
+
+/** Bodies of dropped frames are read into this, they are never looked at */
+static CipOctet s_discard_buffer[PC_OPENER_ETHERNET_BUFFER_SIZE];
+
+void TcpReceiveBufferSetSocket(TcpReceiveBuffer *const receive_buffer,
+                               const int socket) {
+  receive_buffer->socket = socket;
+  TcpReceiveBufferStartNextFrame(receive_buffer);
+  OPENER_TRACE_INFO("Adds socket %d to TCP receive buffers\n", socket);
+}
+
+void TcpReceiveBufferClear(TcpReceiveBuffer *const receive_buffer) {
+  receive_buffer->socket = kEipInvalidSocket;
+  TcpReceiveBufferStartNextFrame(receive_buffer);
+}
+
+bool TcpReceiveBufferIsDiscarding(const TcpReceiveBuffer *const receive_buffer)
+{
+  return (0 != receive_buffer->frame_length) && (NULL == receive_buffer->data);
+}
+
+CipOctet *TcpReceiveBufferGetWritePosition(
+  TcpReceiveBuffer *const receive_buffer) {
+  if(0 == receive_buffer->frame_length) {
+    return &receive_buffer->header[receive_buffer->received_length];
+  }
+  if( TcpReceiveBufferIsDiscarding(receive_buffer) ) {
+    return s_discard_buffer;
+  }
+  return &receive_buffer->data[receive_buffer->received_length];
+}
+
+size_t TcpReceiveBufferGetMissingLength(
+  const TcpReceiveBuffer *const receive_buffer) {
+  if(0 == receive_buffer->frame_length) {
+    return ENCAPSULATION_HEADER_LENGTH - receive_buffer->received_length;
+  }
+  const size_t missing_length = receive_buffer->frame_length -
+                                receive_buffer->received_length;
+  if( TcpReceiveBufferIsDiscarding(receive_buffer) &&
+      (missing_length > sizeof(s_discard_buffer) ) ) {
+    return sizeof(s_discard_buffer);
+  }
+  return missing_length;
+}
+
+bool TcpReceiveBufferCommit(TcpReceiveBuffer *const receive_buffer,
+                            const size_t length) {
+  receive_buffer->received_length += length;
+
+  if( (0 == receive_buffer->frame_length) &&
+      (ENCAPSULATION_HEADER_LENGTH == receive_buffer->received_length) ) {
+    const CipOctet *length_field =
+      &receive_buffer->header[TCP_RECEIVE_BUFFER_LENGTH_FIELD_OFFSET];
+    receive_buffer->frame_length = ENCAPSULATION_HEADER_LENGTH +
+                                   GetUintFromMessage(&length_field);
+    /* stays NULL if the frame is too large or the pool is exhausted */
+    receive_buffer->data = MessageBufferPoolAllocate(
+      receive_buffer->frame_length,
+      &receive_buffer->capacity);
+    if(NULL != receive_buffer->data) {
+      memcpy(receive_buffer->data,
+             receive_buffer->header,
+             ENCAPSULATION_HEADER_LENGTH);
+    }
+  }
+
+  return (0 != receive_buffer->frame_length) &&
+         (receive_buffer->received_length == receive_buffer->frame_length);
+}
+
+void TcpReceiveBufferStartNextFrame(TcpReceiveBuffer *const receive_buffer) {
+  if(NULL != receive_buffer->data) {
+    MessageBufferPoolFree(receive_buffer->data);
+    receive_buffer->data = NULL;
+  }
+  receive_buffer->capacity = 0;
+  receive_buffer->received_length = 0;
+  receive_buffer->frame_length = 0;
+}
+
+void TcpReceiveBufferArrayInitialize(
+  TcpReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length) {
+  for (size_t i = 0; i < array_length; ++i) {
+    array_of_receive_buffers[i].data = NULL;
+    TcpReceiveBufferClear(&array_of_receive_buffers[i]);
+  }
+}
+
+TcpReceiveBuffer *TcpReceiveBufferArrayGetBuffer(
+  TcpReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length,
+  const int socket) {
+  for (size_t i = 0; i < array_length; ++i) {
+    if (socket == array_of_receive_buffers[i].socket) {
+      return &array_of_receive_buffers[i];
+    }
+  }
+  return NULL;
+}
+
+TcpReceiveBuffer *TcpReceiveBufferArrayGetEmptyBuffer(
+  TcpReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length) {
+  return TcpReceiveBufferArrayGetBuffer(array_of_receive_buffers,
+                                        array_length,
+                                        kEipInvalidSocket);
+}
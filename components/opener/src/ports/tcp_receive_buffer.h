@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * Copyright (c) 2016, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef SRC_PORTS_TCP_RECEIVE_BUFFER_H_
+#define SRC_PORTS_TCP_RECEIVE_BUFFER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "typedefs.h"
+#include "opener_user_conf.h"
+
+/** Length of the encapsulation header, same as ENCAPSULATION_HEADER_LENGTH */
+#define TCP_RECEIVE_BUFFER_HEADER_LENGTH 24
+
+/** @brief Reassembly state of the encapsulation frame being received on a TCP socket
+ *
+ * The network handler only reads the octets still missing from the current
+ * frame, so a frame that arrives in pieces is collected over several calls
+ * without blocking and no octet of the next frame is ever read ahead.
+ *
+ * The header is collected in place; once it is complete the frame is moved
+ * to the smallest message buffer pool block it fits in, which is returned
+ * when the next frame is started.
+ */
+typedef struct tcp_receive_buffer {
+  int socket; /**< key */
+  size_t received_length; /**< octets of the current frame received so far */
+  size_t frame_length; /**< length of the current frame, 0 until its header is complete */
+  CipOctet header[TCP_RECEIVE_BUFFER_HEADER_LENGTH]; /**< header of the current frame */
+  CipOctet *data; /**< current frame, NULL while the header is received or the frame is dropped */
+  size_t capacity; /**< size of the block data points to */
+} TcpReceiveBuffer;
+
+/** @brief
+ * Assigns a TCP Receive Buffer to a socket
+ *
+ * @param receive_buffer TCP Receive Buffer to be set
+ * @param socket Socket handle
+ */
+void TcpReceiveBufferSetSocket(TcpReceiveBuffer *const receive_buffer,
+                               const int socket);
+
+/** @brief
+ * Releases a TCP Receive Buffer and drops any partially received frame
+ *
+ * @param receive_buffer TCP Receive Buffer to be cleared
+ */
+void TcpReceiveBufferClear(TcpReceiveBuffer *const receive_buffer);
+
+/** @brief
+ * Gets the position the next received octets have to be stored at
+ *
+ * @param receive_buffer TCP Receive Buffer
+ * @return Write position inside the buffer
+ */
+CipOctet *TcpReceiveBufferGetWritePosition(
+  TcpReceiveBuffer *const receive_buffer);
+
+/** @brief
+ * Gets the number of octets to read next
+ *
+ * This is the rest of the encapsulation header until it is complete, then
+ * the rest of the frame. Frames no message buffer could be taken for are read
+ * in PC_OPENER_ETHERNET_BUFFER_SIZE pieces and dropped.
+ *
+ * @param receive_buffer TCP Receive Buffer
+ * @return Number of octets to read
+ */
+size_t TcpReceiveBufferGetMissingLength(
+  const TcpReceiveBuffer *const receive_buffer);
+
+/** @brief
+ * Accounts for octets stored at the write position
+ *
+ * @param receive_buffer TCP Receive Buffer
+ * @param length Number of octets received
+ * @return true if the current frame is complete
+ */
+bool TcpReceiveBufferCommit(TcpReceiveBuffer *const receive_buffer,
+                            const size_t length);
+
+/** @brief
+ * Checks if the current frame is dropped because it is too large or no
+ * message buffer was free
+ *
+ * @param receive_buffer TCP Receive Buffer
+ * @return true if the frame is dropped
+ */
+bool TcpReceiveBufferIsDiscarding(const TcpReceiveBuffer *const receive_buffer);
+
+/** @brief
+ * Starts reception of the next frame and returns the message buffer
+ *
+ * @param receive_buffer TCP Receive Buffer
+ */
+void TcpReceiveBufferStartNextFrame(TcpReceiveBuffer *const receive_buffer);
+
+/** @brief
+ * Initializes an array of TCP Receive Buffers
+ *
+ * @param array_of_receive_buffers The array of TCP Receive Buffers
+ * @param array_length the length of the array
+ */
+void TcpReceiveBufferArrayInitialize(
+  TcpReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length);
+
+/** @brief
+ * Get the TCP Receive Buffer for a specific socket
+ *
+ * @param array_of_receive_buffers The TCP Receive Buffer array
+ * @param array_length the length of the array
+ * @param socket The socket the TCP Receive Buffer is searched for
+ *
+ * @return The TCP Receive Buffer if found, NULL otherwise
+ */
+TcpReceiveBuffer *TcpReceiveBufferArrayGetBuffer(
+  TcpReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length,
+  const int socket);
+
+/** @brief
+ * Get an unassigned TCP Receive Buffer
+ *
+ * @param array_of_receive_buffers The TCP Receive Buffer array
+ * @param array_length the length of the array
+ *
+ * @return An unassigned TCP Receive Buffer, NULL if all are in use
+ */
+TcpReceiveBuffer *TcpReceiveBufferArrayGetEmptyBuffer(
+  TcpReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length);
+
+#endif /* SRC_PORTS_TCP_RECEIVE_BUFFER_H_ */
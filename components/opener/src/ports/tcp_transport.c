@@ -0,0 +1,335 @@
+/*******************************************************************************
+ * Copyright (c) 2016, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "tcp_transport.h"
+
+#include "generic_networkhandler.h"
+#include "messagebufferpool.h"
+#include "opener_error.h"
+#include "trace.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static void TcpTransportSetOption(const int socket,
+                                  const int level,
+                                  const int option,
+                                  const int value,
+                                  const char *const name) {
+  if(setsockopt(socket, level, option, (char *)&value, sizeof(value) ) < 0) {
+    int error_code = GetSocketErrorNumber();
+    char *error_message = GetErrorMessage(error_code);
+    OPENER_TRACE_WARN("tcp_transport: failed to set %s on socket %d: %d - %s\n",
+                      name, socket, error_code, error_message);
+    FreeErrorMessage(error_message);
+  }
+}
+
+void TcpTransportConfigureSocket(const int socket,
+                                 const CipUint inactivity_timeout) {
+  /* replies are complete frames, holding them back for the ACK of the
+   * previous one only adds the originator's delayed ACK time */
+  TcpTransportSetOption(socket, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+
+  TcpTransportSetOption(socket, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+  int idle = OPENER_TCP_KEEPALIVE_IDLE;
+  if(0 != inactivity_timeout) {
+    idle = (inactivity_timeout < 2U) ? 1 : inactivity_timeout / 2U;
+  }
+  int interval = idle / (int) OPENER_TCP_KEEPALIVE_PROBES;
+  if(interval < 1) {
+    interval = 1;
+  }
+  TcpTransportSetOption(socket, IPPROTO_TCP, TCP_KEEPIDLE, idle,
+                        "TCP_KEEPIDLE");
+  TcpTransportSetOption(socket, IPPROTO_TCP, TCP_KEEPINTVL, interval,
+                        "TCP_KEEPINTVL");
+  TcpTransportSetOption(socket, IPPROTO_TCP, TCP_KEEPCNT,
+                        (int) OPENER_TCP_KEEPALIVE_PROBES, "TCP_KEEPCNT");
+#else
+  (void) inactivity_timeout;
+#endif
+}
+
+bool TcpTransmitQueueAppend(TcpTransmitQueue *const queue,
+                            const CipOctet *const data,
+                            const size_t length) {
+  if(TcpTransmitQueueIsFull(queue) ) {
+    return false;
+  }
+  size_t buffer_size = 0;
+  CipOctet *buffer = MessageBufferPoolAllocate(length, &buffer_size);
+  if(NULL == buffer) {
+    return false;
+  }
+  memcpy(buffer, data, length);
+  TcpTransmitSegment *segment = &queue->segments[queue->number_of_segments];
+  segment->data = buffer;
+  segment->length = length;
+  queue->number_of_segments++;
+  return true;
+}
+
+bool TcpTransmitQueueAppendBuffer(TcpTransmitQueue *const queue,
+                                  CipOctet *const buffer,
+                                  const size_t length) {
+  if( (length <= PC_OPENER_ETHERNET_BUFFER_SIZE) ||
+      !MessageBufferPoolOwnsBuffer(buffer) ) {
+    return TcpTransmitQueueAppend(queue, buffer, length);
+  }
+  if(TcpTransmitQueueIsFull(queue) ) {
+    return false;
+  }
+  MessageBufferPoolRetain(buffer);
+  TcpTransmitSegment *segment = &queue->segments[queue->number_of_segments];
+  segment->data = buffer;
+  segment->length = length;
+  queue->number_of_segments++;
+  return true;
+}
+
+/* Returns the first segments once the IP stack has taken them completely */
+static size_t TcpTransmitQueueConsume(TcpTransmitQueue *const queue,
+                                    size_t length) {
+  size_t done = 0;
+  length += queue->sent;
+  while(done < queue->number_of_segments &&
+        length >= queue->segments[done].length) {
+    length -= queue->segments[done].length;
+    MessageBufferPoolFree(queue->segments[done].data);
+    done++;
+  }
+  queue->number_of_segments -= done;
+  memmove(queue->segments, &queue->segments[done],
+          queue->number_of_segments * sizeof(queue->segments[0]) );
+  queue->sent = length;
+  return done;
+}
+
+static void TcpTransmitQueueRelease(TcpTransmitQueue *const queue) {
+  for (size_t i = 0; i < queue->number_of_segments; ++i) {
+    MessageBufferPoolFree(queue->segments[i].data);
+  }
+  queue->number_of_segments = 0;
+  queue->sent = 0;
+}
+
+TcpTransportStatus TcpTransmitQueueFlush(TcpTransmitQueue *const queue,
+                                         size_t *const sent_length,
+                                         size_t *const sent_replies) {
+  *sent_length = 0;
+  *sent_replies = 0;
+  if(!TcpTransmitQueueIsPending(queue) ) {
+    return kTcpTransportSent;
+  }
+
+  struct iovec parts[OPENER_TCP_TRANSMIT_QUEUE_LENGTH];
+  size_t queued_length = 0;
+  for (size_t i = 0; i < queue->number_of_segments; ++i) {
+    const size_t skip = (0 == i) ? queue->sent : 0;
+    parts[i].iov_base = (void *) (queue->segments[i].data + skip);
+    parts[i].iov_len = queue->segments[i].length - skip;
+    queued_length += parts[i].iov_len;
+  }
+  struct msghdr message = {
+    .msg_iov = parts,
+    .msg_iovlen = queue->number_of_segments,
+  };
+  const long data_sent = sendmsg(queue->socket, &message,
+                                 MSG_NOSIGNAL | MSG_DONTWAIT);
+  if(data_sent < 0) {
+    int error_code = GetSocketErrorNumber();
+    if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
+      return kTcpTransportWouldBlock;
+    }
+    char *error_message = GetErrorMessage(error_code);
+    OPENER_TRACE_ERR("tcp_transport: error on sendmsg: %d - %s\n",
+                     error_code, error_message);
+    FreeErrorMessage(error_message);
+    TcpTransmitQueueRelease(queue);
+    return kTcpTransportError;
+  }
+
+  *sent_length = (size_t) data_sent;
+  *sent_replies = TcpTransmitQueueConsume(queue, (size_t) data_sent);
+  if( (size_t) data_sent < queued_length) {
+    OPENER_TRACE_INFO("tcp_transport: %lu octets left on socket %d\n",
+                      (unsigned long) (queued_length - (size_t) data_sent),
+                      queue->socket);
+    return kTcpTransportWouldBlock;
+  }
+  return kTcpTransportSent;
+}
+
+#if defined(OPENER_CIP_SECURITY) && 0 != OPENER_CIP_SECURITY
+TcpTransportStatus TcpTransmitQueueFlushSecure(TcpTransmitQueue *const queue,
+                                               size_t *const sent_length,
+                                               size_t *const sent_replies) {
+  *sent_length = 0;
+  *sent_replies = 0;
+  while(TcpTransmitQueueIsPending(queue) ) {
+    const TcpTransmitSegment *const segment = &queue->segments[0];
+    const long data_sent = SecureTransportSend(queue->socket,
+                                               segment->data + queue->sent,
+                                               segment->length - queue->sent);
+    if(data_sent < 0) {
+      int error_code = GetSocketErrorNumber();
+      if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
+        return kTcpTransportWouldBlock;
+      }
+      char *error_message = GetErrorMessage(error_code);
+      OPENER_TRACE_ERR("tcp_transport: error on TLS write: %d - %s\n",
+                       error_code, error_message);
+      FreeErrorMessage(error_message);
+      TcpTransmitQueueRelease(queue);
+      return kTcpTransportError;
+    }
+    *sent_length += (size_t) data_sent;
+    *sent_replies += TcpTransmitQueueConsume(queue, (size_t) data_sent);
+  }
+  return kTcpTransportSent;
+}
+#endif /* OPENER_CIP_SECURITY */
+
+bool TcpTransmitQueueIsPending(const TcpTransmitQueue *const queue) {
+  return 0 != queue->number_of_segments;
+}
+
+bool TcpTransmitQueueIsFull(const TcpTransmitQueue *const queue) {
+  return OPENER_TCP_TRANSMIT_QUEUE_LENGTH <= queue->number_of_segments;
+}
+
+void TcpTransmitQueueClear(TcpTransmitQueue *const queue) {
+  queue->socket = kEipInvalidSocket;
+  TcpTransmitQueueRelease(queue);
+}
+
+void TcpTransmitQueueArrayInitialize(TcpTransmitQueue *const array_of_queues,
+                                     const size_t array_length) {
+  for (size_t i = 0; i < array_length; ++i) {
+    array_of_queues[i].number_of_segments = 0;
+    TcpTransmitQueueClear(&array_of_queues[i]);
+  }
+}
+
+void TcpTransmitQueueSetSocket(TcpTransmitQueue *const queue,
+                               const int socket) {
+  TcpTransmitQueueRelease(queue);
+  queue->socket = socket;
+}
+
+TcpTransmitQueue *TcpTransmitQueueArrayGetQueue(
+  TcpTransmitQueue *const array_of_queues,
+  const size_t array_length,
+  const int socket) {
+  for (size_t i = 0; i < array_length; ++i) {
+    if (socket == array_of_queues[i].socket) {
+      return &array_of_queues[i];
+    }
+  }
+  return NULL;
+}
+
+TcpTransmitQueue *TcpTransmitQueueArrayGetEmptyQueue(
+  TcpTransmitQueue *const array_of_queues,
+  const size_t array_length) {
+  return TcpTransmitQueueArrayGetQueue(array_of_queues,
+                                       array_length,
+                                       kEipInvalidSocket);
+}
+
+#define TCP_REQUEST_TOKEN 1000U /* thousandths of a request */
+#define TCP_REQUEST_BUCKET_SIZE (OPENER_EXPLICIT_REQUEST_BURST * TCP_REQUEST_TOKEN)
+
+size_t TcpRequestBucketGetAvailable(TcpRequestBucket *const bucket,
+                                    const MilliSeconds now) {
+#if OPENER_EXPLICIT_REQUESTS_PER_SECOND > 0
+  /* a millisecond adds the rate in thousandths of a request */
+  const MilliSeconds elapsed = now - bucket->last_refill;
+  const uint64_t tokens = (uint64_t) bucket->tokens +
+                          (uint64_t) elapsed * OPENER_EXPLICIT_REQUESTS_PER_SECOND;
+  bucket->tokens = (tokens > TCP_REQUEST_BUCKET_SIZE) ?
+                   TCP_REQUEST_BUCKET_SIZE : (CipUdint) tokens;
+  bucket->last_refill = now;
+  return bucket->tokens / TCP_REQUEST_TOKEN;
+#else
+  (void) bucket;
+  (void) now;
+  return SIZE_MAX;
+#endif
+}
+
+void TcpRequestBucketTake(TcpRequestBucket *const bucket,
+                          const size_t requests) {
+#if OPENER_EXPLICIT_REQUESTS_PER_SECOND > 0
+  const uint64_t taken = (uint64_t) requests * TCP_REQUEST_TOKEN;
+  bucket->tokens = (taken < bucket->tokens) ?
+                   bucket->tokens - (CipUdint) taken : 0;
+#else
+  (void) bucket;
+  (void) requests;
+#endif
+}
+
+MilliSeconds TcpRequestBucketGetRefillTime(const TcpRequestBucket *const bucket)
+{
+#if OPENER_EXPLICIT_REQUESTS_PER_SECOND > 0
+  if(bucket->tokens >= TCP_REQUEST_TOKEN) {
+    return 0;
+  }
+  return (TCP_REQUEST_TOKEN - bucket->tokens +
+          OPENER_EXPLICIT_REQUESTS_PER_SECOND - 1) /
+         OPENER_EXPLICIT_REQUESTS_PER_SECOND;
+#else
+  (void) bucket;
+  return 0;
+#endif
+}
+
+void TcpRequestBucketArrayInitialize(TcpRequestBucket *const array_of_buckets,
+                                     const size_t array_length) {
+  for (size_t i = 0; i < array_length; ++i) {
+    TcpRequestBucketClear(&array_of_buckets[i]);
+  }
+}
+
+void TcpRequestBucketSetSocket(TcpRequestBucket *const bucket,
+                               const int socket,
+                               const MilliSeconds now) {
+  bucket->socket = socket;
+  bucket->tokens = TCP_REQUEST_BUCKET_SIZE;
+  bucket->last_refill = now;
+}
+
+void TcpRequestBucketClear(TcpRequestBucket *const bucket) {
+  bucket->socket = kEipInvalidSocket;
+  bucket->tokens = 0;
+  bucket->last_refill = 0;
+}
+
+TcpRequestBucket *TcpRequestBucketArrayGetBucket(
+  TcpRequestBucket *const array_of_buckets,
+  const size_t array_length,
+  const int socket) {
+  for (size_t i = 0; i < array_length; ++i) {
+    if (socket == array_of_buckets[i].socket) {
+      return &array_of_buckets[i];
+    }
+  }
+  return NULL;
+}
+
+TcpRequestBucket *TcpRequestBucketArrayGetEmptyBucket(
+  TcpRequestBucket *const array_of_buckets,
+  const size_t array_length) {
+  return TcpRequestBucketArrayGetBucket(array_of_buckets,
+                                        array_length,
+                                        kEipInvalidSocket);
+}
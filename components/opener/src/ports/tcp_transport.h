@@ -0,0 +1,325 @@
+/*******************************************************************************
+ * Copyright (c) 2016, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef SRC_PORTS_TCP_TRANSPORT_H_
+#define SRC_PORTS_TCP_TRANSPORT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#include "opener_user_conf.h"
+
+/** @file tcp_transport.h
+ * @brief Socket options and transmit queues of the explicit messaging TCP sessions
+ *
+ * Every accepted socket gets Nagle disabled, so a reply is not held back
+ * until the originator's delayed ACK, and TCP keepalive timed from the
+ * encapsulation inactivity timeout.
+ *
+ * The replies to all frames handled for a socket in one loop iteration are
+ * collected in its transmit queue and sent with a single sendmsg(). The send
+ * never blocks: what the IP stack does not take stays queued, the network
+ * handler stops reading the socket and retries on the following iterations.
+ * The originator's TCP window then fills, which pushes back on it instead
+ * of stalling the stack or cutting a reply short.
+ *
+ * A request bucket per socket limits the rate of explicit requests the
+ * network handler takes from one session. A session that used up its
+ * bucket is not read until a request has been refilled, its requests wait
+ * in the TCP window the same way.
+ */
+
+/** Keepalive idle time in seconds while the inactivity timeout is disabled */
+#ifndef OPENER_TCP_KEEPALIVE_IDLE
+#define OPENER_TCP_KEEPALIVE_IDLE 60U
+#endif
+
+/** Number of unanswered keepalive probes before a session is dropped */
+#define OPENER_TCP_KEEPALIVE_PROBES 3U
+
+/** @brief Result of an attempt to send a transmit queue */
+typedef enum {
+  kTcpTransportSent = 0, /**< queue empty, everything was sent */
+  kTcpTransportWouldBlock, /**< the IP stack is full, the rest stays queued */
+  kTcpTransportError /**< the socket failed, the queue was dropped */
+} TcpTransportStatus;
+
+/** Replies a transmit queue holds, also the number of frames handled for a
+ *  socket before its replies are sent */
+#ifndef OPENER_TCP_TRANSMIT_QUEUE_LENGTH
+#define OPENER_TCP_TRANSMIT_QUEUE_LENGTH 4U
+#endif
+
+/** Explicit requests per second taken from one TCP session, 0 for no limit */
+#ifndef OPENER_EXPLICIT_REQUESTS_PER_SECOND
+#define OPENER_EXPLICIT_REQUESTS_PER_SECOND 0U
+#endif
+
+/** Requests a TCP session may send back to back before its rate applies */
+#ifndef OPENER_EXPLICIT_REQUEST_BURST
+#define OPENER_EXPLICIT_REQUEST_BURST 16U
+#endif
+
+/** @brief A queued reply in a message buffer pool block */
+typedef struct {
+  CipOctet *data;
+  size_t length;
+} TcpTransmitSegment;
+
+/** @brief Replies waiting to be sent on a TCP socket
+ *
+ * A reply that fits a small message buffer pool block is copied into one. A
+ * larger reply built in a pool block is queued by a reference on that block,
+ * without a copy. The queue is sent with one gathering sendmsg() and the
+ * references are dropped as soon as the IP stack has taken the replies.
+ */
+typedef struct tcp_transmit_queue {
+  int socket; /**< key */
+  TcpTransmitSegment segments[OPENER_TCP_TRANSMIT_QUEUE_LENGTH]; /**< replies in sending order */
+  size_t number_of_segments; /**< replies queued */
+  size_t sent; /**< octets of the first reply already taken by the IP stack */
+} TcpTransmitQueue;
+
+/** @brief
+ * Applies the transport options to a newly accepted socket
+ *
+ * Sets TCP_NODELAY and keepalive. Keepalive probes start after half of the
+ * encapsulation inactivity timeout, so a peer that vanished is dropped after
+ * about the full timeout even while replies are still queued for it. Without
+ * a timeout OPENER_TCP_KEEPALIVE_IDLE is used. Options the platform does not
+ * know are skipped.
+ *
+ * @param socket Accepted socket
+ * @param inactivity_timeout Encapsulation inactivity timeout in seconds, 0 if disabled
+ */
+void TcpTransportConfigureSocket(const int socket,
+                                 const CipUint inactivity_timeout);
+
+/** @brief
+ * Appends a reply to the transmit queue of a socket
+ *
+ * @param queue Transmit queue of the socket
+ * @param data Reply
+ * @param length Length of the reply
+ * @return true if the reply was queued. false if the queue is full or no
+ *         buffer was free; send the queue and try again.
+ */
+bool TcpTransmitQueueAppend(TcpTransmitQueue *const queue,
+                            const CipOctet *const data,
+                            const size_t length);
+
+/** @brief
+ * Appends a reply built in a message buffer pool block
+ *
+ * Replies larger than PC_OPENER_ETHERNET_BUFFER_SIZE are queued by a
+ * reference on @p buffer, the caller keeps its own reference and must not
+ * write the block before releasing it. Smaller replies are copied, a small
+ * block is cheaper to hold queued than the large one they were built in.
+ *
+ * @param queue Transmit queue of the socket
+ * @param buffer Pool block holding the reply from its start
+ * @param length Length of the reply
+ * @return true if the reply was queued. false if the queue is full or no
+ *         buffer was free; send the queue and try again.
+ */
+bool TcpTransmitQueueAppendBuffer(TcpTransmitQueue *const queue,
+                                  CipOctet *const buffer,
+                                  const size_t length);
+
+/** @brief
+ * Sends as much of the queue as the IP stack takes without blocking
+ *
+ * @param queue Transmit queue of the socket
+ * @param sent_length Receives the number of octets sent by this call
+ * @param sent_replies Receives the number of replies completed by this call
+ * @return Whether the queue was sent completely, is still pending or failed
+ */
+TcpTransportStatus TcpTransmitQueueFlush(TcpTransmitQueue *const queue,
+                                         size_t *const sent_length,
+                                         size_t *const sent_replies);
+
+#if defined(OPENER_CIP_SECURITY) && 0 != OPENER_CIP_SECURITY
+/** @brief
+ * Sends as much of the queue of a TLS session as it takes without blocking
+ *
+ * Counterpart of TcpTransmitQueueFlush() with SecureTransportSend(). Each
+ * reply is written on its own, a reply the session did not take is passed
+ * again unchanged on the next call, as mbedTLS requires.
+ *
+ * @param queue Transmit queue of the socket
+ * @param sent_length Receives the number of plaintext octets sent by this call
+ * @param sent_replies Receives the number of replies completed by this call
+ * @return Whether the queue was sent completely, is still pending or failed
+ */
+TcpTransportStatus TcpTransmitQueueFlushSecure(TcpTransmitQueue *const queue,
+                                               size_t *const sent_length,
+                                               size_t *const sent_replies);
+#endif /* OPENER_CIP_SECURITY */
+
+/** @brief
+ * Checks if replies are waiting to be sent
+ *
+ * @param queue Transmit queue of the socket
+ * @return true if the queue holds unsent octets
+ */
+bool TcpTransmitQueueIsPending(const TcpTransmitQueue *const queue);
+
+/** @brief
+ * Checks if another reply can be queued
+ *
+ * @param queue Transmit queue of the socket
+ * @return true if all OPENER_TCP_TRANSMIT_QUEUE_LENGTH entries are in use
+ */
+bool TcpTransmitQueueIsFull(const TcpTransmitQueue *const queue);
+
+/** @brief
+ * Releases a transmit queue, drops queued replies and returns the buffer
+ *
+ * @param queue Transmit queue to be cleared
+ */
+void TcpTransmitQueueClear(TcpTransmitQueue *const queue);
+
+/** @brief
+ * Initializes an array of transmit queues
+ *
+ * @param array_of_queues The array of transmit queues
+ * @param array_length the length of the array
+ */
+void TcpTransmitQueueArrayInitialize(TcpTransmitQueue *const array_of_queues,
+                                     const size_t array_length);
+
+/** @brief
+ * Assigns a transmit queue to a socket
+ *
+ * @param queue Transmit queue to be set
+ * @param socket Socket handle
+ */
+void TcpTransmitQueueSetSocket(TcpTransmitQueue *const queue,
+                               const int socket);
+
+/** @brief
+ * Get the transmit queue of a specific socket
+ *
+ * @param array_of_queues The transmit queue array
+ * @param array_length the length of the array
+ * @param socket The socket the transmit queue is searched for
+ *
+ * @return The transmit queue if found, NULL otherwise
+ */
+TcpTransmitQueue *TcpTransmitQueueArrayGetQueue(
+  TcpTransmitQueue *const array_of_queues,
+  const size_t array_length,
+  const int socket);
+
+/** @brief
+ * Get an unassigned transmit queue
+ *
+ * @param array_of_queues The transmit queue array
+ * @param array_length the length of the array
+ *
+ * @return An unassigned transmit queue, NULL if all are in use
+ */
+TcpTransmitQueue *TcpTransmitQueueArrayGetEmptyQueue(
+  TcpTransmitQueue *const array_of_queues,
+  const size_t array_length);
+
+/** @brief Token bucket of the explicit requests of a TCP socket
+ *
+ * Filled at OPENER_EXPLICIT_REQUESTS_PER_SECOND up to
+ * OPENER_EXPLICIT_REQUEST_BURST requests, in thousandths of a request so a
+ * millisecond of refill is exact.
+ */
+typedef struct {
+  int socket; /**< key */
+  CipUdint tokens; /**< thousandths of a request */
+  MilliSeconds last_refill; /**< time tokens were last added */
+} TcpRequestBucket;
+
+/** @brief
+ * Refills the bucket and returns the requests it allows now
+ *
+ * @param bucket Request bucket of the socket
+ * @param now Current time
+ * @return Requests that may be handled, SIZE_MAX without a rate limit
+ */
+size_t TcpRequestBucketGetAvailable(TcpRequestBucket *const bucket,
+                                    const MilliSeconds now);
+
+/** @brief
+ * Takes handled requests from the bucket
+ *
+ * @param bucket Request bucket of the socket
+ * @param requests Requests handled, at most what
+ *        TcpRequestBucketGetAvailable() returned
+ */
+void TcpRequestBucketTake(TcpRequestBucket *const bucket,
+                          const size_t requests);
+
+/** @brief
+ * Time until the bucket allows the next request
+ *
+ * @param bucket Request bucket of the socket
+ * @return Milliseconds until a request has been refilled, 0 if one is
+ *         available
+ */
+MilliSeconds TcpRequestBucketGetRefillTime(const TcpRequestBucket *const bucket);
+
+/** @brief
+ * Initializes an array of request buckets
+ *
+ * @param array_of_buckets The array of request buckets
+ * @param array_length the length of the array
+ */
+void TcpRequestBucketArrayInitialize(TcpRequestBucket *const array_of_buckets,
+                                     const size_t array_length);
+
+/** @brief
+ * Assigns a full request bucket to a socket
+ *
+ * @param bucket Request bucket to be set
+ * @param socket Socket handle
+ * @param now Current time
+ */
+void TcpRequestBucketSetSocket(TcpRequestBucket *const bucket,
+                               const int socket,
+                               const MilliSeconds now);
+
+/** @brief
+ * Releases a request bucket
+ *
+ * @param bucket Request bucket to be cleared
+ */
+void TcpRequestBucketClear(TcpRequestBucket *const bucket);
+
+/** @brief
+ * Get the request bucket of a specific socket
+ *
+ * @param array_of_buckets The request bucket array
+ * @param array_length the length of the array
+ * @param socket The socket the request bucket is searched for
+ *
+ * @return The request bucket if found, NULL otherwise
+ */
+TcpRequestBucket *TcpRequestBucketArrayGetBucket(
+  TcpRequestBucket *const array_of_buckets,
+  const size_t array_length,
+  const int socket);
+
+/** @brief
+ * Get an unassigned request bucket
+ *
+ * @param array_of_buckets The request bucket array
+ * @param array_length the length of the array
+ *
+ * @return An unassigned request bucket, NULL if all are in use
+ */
+TcpRequestBucket *TcpRequestBucketArrayGetEmptyBucket(
+  TcpRequestBucket *const array_of_buckets,
+  const size_t array_length);
+
+#endif /* SRC_PORTS_TCP_TRANSPORT_H_ */
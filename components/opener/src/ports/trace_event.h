@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_TRACE_EVENT_H_
+#define OPENER_TRACE_EVENT_H_
+
+/** @file trace_event.h
+ *  @brief Named events of the stack for a timeline recorder
+ *
+ *  Enabled with OPENER_TRACE_EVENTS. Each event has a fixed ID, its offset
+ *  in the module of the platform, and up to three parameters. An event with
+ *  OPENER_TRACE_EVENT_END() is a call: it starts with OPENER_TRACE_EVENT()
+ *  and ends with the result, so the recorder shows its duration. The
+ *  platform implements the functions, see ports/ESP32/trace_event.c for
+ *  SEGGER SystemView.
+ *
+ *  Without OPENER_TRACE_EVENTS the macros expand to nothing and their
+ *  arguments are not evaluated. Events may be recorded from any task or
+ *  interrupt.
+ */
+
+#include "typedefs.h"
+#include "opener_user_conf.h"
+
+#ifndef OPENER_TRACE_EVENTS
+#define OPENER_TRACE_EVENTS 0
+#endif
+
+typedef enum {
+  kTraceEventConnectionOpen = 0, /**< serial, O->T RPI, T->O RPI in us */
+  kTraceEventConnectionClose, /**< serial */
+  kTraceEventConnectionTimeout, /**< serial, inactivity watchdog expired */
+  kTraceEventProduce, /**< serial, sequence count */
+  kTraceEventConsume, /**< serial, sequence count */
+  kTraceEventExplicitRequest, /**< call: service, length, serial or 0 for
+                                 UCMM; ends with the general status */
+  kTraceEventNvCommit, /**< call: stored sections of the record; ends with the platform error */
+  kTraceEventI2cTransfer, /**< call: expander mask; ends with the first
+                             error */
+  kTraceEventNumberOfEvents
+} TraceEvent;
+
+#if OPENER_TRACE_EVENTS
+
+/** @brief Register the events with the recorder, called once at start up */
+void TraceEventInitialize(void);
+
+/** @brief Record an event, or the start of a call
+ *
+ *  Parameters beyond the ones of the event are not recorded.
+ */
+void TraceEventRecord(const TraceEvent event,
+                      const CipUdint parameter_0,
+                      const CipUdint parameter_1,
+                      const CipUdint parameter_2);
+
+/** @brief Record the end of a call started with TraceEventRecord() */
+void TraceEventRecordEnd(const TraceEvent event,
+                         const CipUdint result);
+
+/** @def OPENER_TRACE_EVENT(event, p0, p1, p2) Record event */
+#define OPENER_TRACE_EVENT(event, p0, p1, p2) \
+  TraceEventRecord(event, (CipUdint) (p0), (CipUdint) (p1), (CipUdint) (p2) )
+
+/** @def OPENER_TRACE_EVENT_END(event, result) End the call event */
+#define OPENER_TRACE_EVENT_END(event, result) \
+  TraceEventRecordEnd(event, (CipUdint) (result) )
+
+#else
+
+#define OPENER_TRACE_EVENT(event, p0, p1, p2)
+#define OPENER_TRACE_EVENT_END(event, result)
+
+#endif /* OPENER_TRACE_EVENTS */
+
+#endif /* OPENER_TRACE_EVENT_H_ */
@@ -0,0 +1,145 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_WCET_PROFILE_H_
+#define OPENER_WCET_PROFILE_H_
+
+/** @file wcet_profile.h
+ *  @brief Worst case execution times of CIP services and callbacks
+ *
+ *  Enabled with OPENER_WCET_PROFILE. Every CIP service handler, the
+ *  application callbacks AfterAssemblyDataReceived() and
+ *  BeforeAssemblyDataSend(), the post set callbacks of the classes (e.g.
+ *  NvTcpipSetCallback()) and the web API handlers keep the number of calls
+ *  and the longest one in CPU cycles, together with the request that took
+ *  it: class, instance and attribute for the CIP entries, the assembly
+ *  instance for the callbacks.
+ *
+ *  Entries are created by their first call, up to
+ *  OPENER_WCET_PROFILE_ENTRIES. Reading them with the Read And Reset service
+ *  of the WCET Profile object clears the entries it returned, so every read
+ *  has the worst cases since the last one.
+ *
+ *  Begin and end of a sample have to run on the same core, the cycle counter
+ *  is per core. Samples may be recorded from any task.
+ *
+ *  The platform implements the functions, see ports/ESP32/wcet_profile.c.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "typedefs.h"
+#include "opener_user_conf.h"
+
+/** @brief WCET Profile object class code (vendor specific range) */
+static const CipUint kWcetProfileClassCode = 0x6BU;
+
+/** @brief Read And Reset service of the WCET Profile object
+ *
+ *  Request: UINT index of the first entry wanted. Response: UINT number of
+ *  entries, UINT number of entries returned, then per entry USINT kind,
+ *  USINT code, UINT class, UINT instance, UINT attribute, UDINT calls and
+ *  UDINT maximum cycles. The entries returned are cleared.
+ */
+static const CipUsint kWcetProfileReadAndResetService = 0x4BU;
+
+typedef enum {
+  kWcetProfileKindService = 0, /**< code is the service code */
+  kWcetProfileKindCallback, /**< code is a WcetProfileCallback */
+  kWcetProfileKindWeb /**< code is the HTTP method, name the URI */
+} WcetProfileKind;
+
+typedef enum {
+  kWcetProfileCallbackAfterAssemblyDataReceived = 1,
+  kWcetProfileCallbackBeforeAssemblyDataSend,
+  kWcetProfileCallbackPostSet
+} WcetProfileCallback;
+
+/** @brief One entry, also the capture of its longest call */
+typedef struct {
+  const char *name; /**< service name or URI, NULL if not known */
+  CipUsint kind; /**< WcetProfileKind */
+  CipUsint code;
+  CipUint class_id;
+  CipUint instance; /**< of the longest call */
+  CipUint attribute; /**< of the longest call, 0 if none */
+  CipUdint calls;
+  CipUdint maximum; /**< cycles */
+} WcetProfileEntry;
+
+#if OPENER_WCET_PROFILE
+
+/** @brief Read the cycle counter of the calling core */
+CipUdint WcetProfileGetCycleCount(void);
+
+/** @brief Add one call to its entry, creating the entry on the first call
+ *
+ *  @param kind WcetProfileKind of the entry
+ *  @param class_id class of the entry, 0 for web handlers
+ *  @param code service code, callback or HTTP method of the entry
+ *  @param name service name or URI, taken over if the entry has none
+ *  @param instance instance the call addressed
+ *  @param attribute attribute the call addressed, 0 if none
+ *  @param cycles duration in CPU cycles
+ */
+void WcetProfileRecord(const WcetProfileKind kind,
+                       const CipUint class_id,
+                       const CipUsint code,
+                       const char *const name,
+                       const CipUint instance,
+                       const CipUint attribute,
+                       const CipUdint cycles);
+
+/** @brief Copy the entries
+ *
+ *  @param first index of the first entry
+ *  @param entries receives the entries
+ *  @param count number of entries wanted
+ *  @param reset clear the entries copied
+ *  @return number of entries copied
+ */
+size_t WcetProfileGetEntries(const size_t first,
+                             WcetProfileEntry *const entries,
+                             const size_t count,
+                             const bool reset);
+
+/** @brief Number of entries in use */
+size_t WcetProfileGetNumberOfEntries(void);
+
+/** @brief Calls not recorded because all entries were taken */
+CipUdint WcetProfileGetDropped(void);
+
+/** @brief CPU cycles per microsecond, to convert the maxima */
+CipUdint WcetProfileGetCyclesPerMicroSecond(void);
+
+/** @brief Create the WCET Profile object
+ *
+ *  Instance 1 has the number of entries as attribute 1 and the calls that
+ *  found no free entry as attribute 2; the Read And Reset service returns
+ *  and clears the entries.
+ */
+EipStatus WcetProfileCreateCipObject(void);
+
+/** @def OPENER_WCET_PROFILE_BEGIN(start) Start a sample named start */
+#define OPENER_WCET_PROFILE_BEGIN(start) \
+  const CipUdint start = WcetProfileGetCycleCount()
+
+/** @def OPENER_WCET_PROFILE_END(start, kind, class_id, code, name, instance,
+ *  attribute) Record the sample start */
+#define OPENER_WCET_PROFILE_END(start, kind, class_id, code, name, instance, \
+                                attribute) \
+  WcetProfileRecord(kind, class_id, code, name, instance, attribute, \
+                    WcetProfileGetCycleCount() - (start) )
+
+#else
+
+#define OPENER_WCET_PROFILE_BEGIN(start)
+#define OPENER_WCET_PROFILE_END(start, kind, class_id, code, name, instance, \
+                                attribute)
+
+#endif /* OPENER_WCET_PROFILE */
+
+#endif /* OPENER_WCET_PROFILE_H_ */
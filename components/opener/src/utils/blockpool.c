@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (c) 2017, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "blockpool.h"
+
+#include <string.h>
+
+#include "opener_user_conf.h"
+#include "trace.h"
+
+void BlockPoolInitialize(BlockPool *const pool,
+                         void *const storage,
+                         const size_t block_size,
+                         const size_t block_count) {
+  OPENER_ASSERT(NULL != pool);
+  OPENER_ASSERT(NULL != storage);
+  OPENER_ASSERT(block_size >= sizeof(BlockPoolFreeBlock) );
+
+  pool->storage = storage;
+  pool->block_size = block_size;
+  pool->block_count = block_count;
+  pool->free_list = NULL;
+  pool->blocks_in_use = 0;
+  pool->high_water_mark = 0;
+  pool->allocation_failures = 0;
+
+  /* Chain back to front so the first allocation returns the first block */
+  for(size_t i = block_count; i > 0; --i) {
+    BlockPoolFreeBlock *block =
+      (BlockPoolFreeBlock *)(pool->storage + (i - 1) * block_size);
+    block->next = pool->free_list;
+    pool->free_list = block;
+  }
+}
+
+void *BlockPoolAllocate(BlockPool *const pool) {
+  BlockPoolFreeBlock *block = pool->free_list;
+  if(NULL == block) {
+    pool->allocation_failures++;
+    OPENER_TRACE_WARN("Block pool exhausted, %zu blocks in use\n",
+                      pool->blocks_in_use);
+    return NULL;
+  }
+
+  pool->free_list = block->next;
+  pool->blocks_in_use++;
+  if(pool->blocks_in_use > pool->high_water_mark) {
+    pool->high_water_mark = pool->blocks_in_use;
+  }
+  memset(block, 0, pool->block_size);
+  return block;
+}
+
+void BlockPoolFree(BlockPool *const pool,
+                   void *const block) {
+  unsigned char *const address = block;
+  const size_t storage_size = pool->block_size * pool->block_count;
+
+  if(NULL == block) {
+    OPENER_TRACE_ERR("Attempt to return NULL block to pool\n");
+    return;
+  }
+  if(address < pool->storage || address >= pool->storage + storage_size ||
+     0 != (size_t)(address - pool->storage) % pool->block_size) {
+    OPENER_TRACE_ERR("Attempt to return foreign block to pool\n");
+    return;
+  }
+  OPENER_ASSERT(pool->blocks_in_use > 0);
+
+  BlockPoolFreeBlock *free_block = block;
+  free_block->next = pool->free_list;
+  pool->free_list = free_block;
+  pool->blocks_in_use--;
+}
+
+bool BlockPoolIsInitialized(const BlockPool *const pool) {
+  return NULL != pool->storage;
+}
@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * Copyright (c) 2017, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef SRC_UTILS_BLOCKPOOL_H_
+#define SRC_UTILS_BLOCKPOOL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file blockpool.h
+ *
+ * Fixed-block pool allocator with O(1) allocation and release
+ *
+ * The pool hands out equally sized blocks from caller provided storage. Free
+ * blocks are chained through their own first bytes, so the pool needs no
+ * bookkeeping memory besides the BlockPool structure itself. Blocks must be at
+ * least pointer sized and the storage must be suitably aligned for the stored
+ * type, e.g. by declaring it as an array of that type.
+ */
+
+typedef struct block_pool_free_block BlockPoolFreeBlock;
+
+typedef struct block_pool_free_block {
+  BlockPoolFreeBlock *next;
+} BlockPoolFreeBlock;
+
+typedef struct {
+  unsigned char *storage; /**< Start of the block storage */
+  size_t block_size; /**< Size of one block in bytes */
+  size_t block_count; /**< Number of blocks in the storage */
+  BlockPoolFreeBlock *free_list; /**< Head of the free block chain */
+  size_t blocks_in_use; /**< Number of currently allocated blocks */
+  size_t high_water_mark; /**< Maximum of blocks_in_use since initialization */
+  size_t allocation_failures; /**< Allocations refused because the pool was empty */
+} BlockPool;
+
+/** @brief Build the free list over the given storage
+ *
+ * @param pool The pool to initialize
+ * @param storage Memory for block_count blocks of block_size bytes
+ * @param block_size Size of one block, at least sizeof(BlockPoolFreeBlock)
+ * @param block_count Number of blocks in @p storage
+ */
+void BlockPoolInitialize(BlockPool *const pool,
+                         void *const storage,
+                         const size_t block_size,
+                         const size_t block_count);
+
+/** @brief Take a zero-filled block from the pool
+ *
+ * @param pool The pool to allocate from
+ * @return The block, or NULL if all blocks are in use
+ */
+void *BlockPoolAllocate(BlockPool *const pool);
+
+/** @brief Return a block to the pool
+ *
+ * Pointers that were not handed out by @p pool are rejected with an error
+ * trace.
+ *
+ * @param pool The pool the block was allocated from
+ * @param block The block to release
+ */
+void BlockPoolFree(BlockPool *const pool,
+                   void *const block);
+
+/** @brief Check whether the pool storage has been set up */
+bool BlockPoolIsInitialized(const BlockPool *const pool);
+
+#endif /* SRC_UTILS_BLOCKPOOL_H_ */
@@ -7,7 +7,78 @@
 #include "enipmessage.h"
 #include "string.h"
 
+#include "messagebufferpool.h"
+
 void InitializeENIPMessage(ENIPMessage *const message) {
   memset(message, 0, sizeof(ENIPMessage) );
+  PrepareENIPMessage(message);
+}
+
+void PrepareENIPMessage(ENIPMessage *const message) {
+  message->message_buffer = message->inline_buffer;
+  message->message_buffer_size = sizeof(message->inline_buffer);
   message->current_message_position = message->message_buffer;
+  message->used_message_length = 0;
+}
+
+void ClearENIPMessage(ENIPMessage *const message) {
+  size_t written_length = (size_t)(message->current_message_position -
+                                   message->message_buffer);
+  if(message->used_message_length > written_length) {
+    written_length = message->used_message_length;
+  }
+  if(written_length > message->message_buffer_size) {
+    written_length = message->message_buffer_size;
+  }
+  memset(message->message_buffer, 0, written_length);
+  message->current_message_position = message->message_buffer;
+  message->used_message_length = 0;
+}
+
+bool ENIPMessageAttachPooledBuffer(ENIPMessage *const message,
+                                   const size_t maximum_size) {
+  size_t buffer_size = 0;
+  CipOctet *buffer = MessageBufferPoolAllocateLargest(
+    sizeof(message->inline_buffer) + 1,
+    maximum_size,
+    &buffer_size);
+  if(NULL == buffer) {
+    return false;
+  }
+  message->message_buffer = buffer;
+  message->message_buffer_size = buffer_size;
+  message->current_message_position = buffer;
+  message->used_message_length = 0;
+  return true;
+}
+
+void ENIPMessageReleasePooledBuffer(ENIPMessage *const message) {
+  if(message->message_buffer != message->inline_buffer) {
+    MessageBufferPoolFree(message->message_buffer);
+    message->message_buffer = message->inline_buffer;
+    message->message_buffer_size = sizeof(message->inline_buffer);
+  }
+  message->current_message_position = message->message_buffer;
+  message->used_message_length = 0;
+}
+
+bool ENIPMessageCopy(ENIPMessage *const destination,
+                     const ENIPMessage *const source) {
+  /* zero-filled or struct-copied messages do not point at a buffer of their own */
+  if( (destination->message_buffer != destination->inline_buffer) &&
+      !MessageBufferPoolOwnsBuffer(destination->message_buffer) ) {
+    PrepareENIPMessage(destination);
+  }
+  destination->current_message_position = destination->message_buffer;
+  destination->used_message_length = 0;
+  if(source->used_message_length > destination->message_buffer_size) {
+    return false;
+  }
+  memcpy(destination->message_buffer,
+         source->message_buffer,
+         source->used_message_length);
+  destination->used_message_length = source->used_message_length;
+  destination->current_message_position = destination->message_buffer +
+                                          source->used_message_length;
+  return true;
 }
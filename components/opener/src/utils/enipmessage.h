@@ -6,14 +6,61 @@
 #ifndef SRC_CIP_ENIPMESSAGE_H_
 #define SRC_CIP_ENIPMESSAGE_H_
 
+#include <stdbool.h>
+
 #include "opener_user_conf.h"
 
 typedef struct enip_message {
-  CipOctet message_buffer[PC_OPENER_ETHERNET_BUFFER_SIZE];
+  CipOctet *message_buffer; /**< inline_buffer or a pooled buffer */
+  size_t message_buffer_size; /**< capacity of message_buffer */
   CipOctet *current_message_position;
   size_t used_message_length;
+  CipOctet inline_buffer[PC_OPENER_ETHERNET_BUFFER_SIZE];
 } ENIPMessage;
 
+/** @brief Set up an empty, zeroed message in its inline buffer */
 void InitializeENIPMessage(ENIPMessage *const message);
 
+/** @brief Point a message at its inline buffer without clearing it
+ *
+ * For callers that write every octet they send, e.g. the cyclic I/O path.
+ */
+void PrepareENIPMessage(ENIPMessage *const message);
+
+/** @brief Empty an initialized message but keep its buffer
+ *
+ * Only the octets written so far are cleared.
+ */
+void ClearENIPMessage(ENIPMessage *const message);
+
+/** @brief Move an empty message into the largest free pooled buffer
+ *
+ * Lets explicit responses grow beyond PC_OPENER_ETHERNET_BUFFER_SIZE. The
+ * message keeps its inline buffer if no larger buffer is free.
+ *
+ * @param message Initialized, empty message
+ * @param maximum_size Upper bound for the capacity, e.g. the capacity of the
+ *        message the content is copied into later
+ * @return true if a pooled buffer was attached
+ */
+bool ENIPMessageAttachPooledBuffer(ENIPMessage *const message,
+                                   const size_t maximum_size);
+
+/** @brief Drop the message's reference on its pooled buffer and fall back
+ *  to the empty inline buffer
+ *
+ * The buffer returns to the pool once no transmit queue holds it either.
+ */
+void ENIPMessageReleasePooledBuffer(ENIPMessage *const message);
+
+/** @brief Copy the content of a message into another one's buffer
+ *
+ * @param destination Message to copy to, may also be zero-filled or a struct
+ *        copy of another message
+ * @param source Message to copy from
+ * @return true if the content fit, otherwise @p destination is left empty
+ */
+bool ENIPMessageCopy(ENIPMessage *const destination,
+                     const ENIPMessage *const source);
+
 #endif /* SRC_CIP_ENIPMESSAGE_H_ */
@@ -0,0 +1,184 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "messagebufferpool.h"
+
+#include <stdint.h>
+
+#include "blockpool.h"
+#include "opener_user_conf.h"
+#include "trace.h"
+
+#define MESSAGE_BUFFER_POOL_CLASS_COUNT 3
+
+/* Declared as pointer arrays so every block is suitably aligned */
+static void *s_small_storage[(PC_OPENER_ETHERNET_BUFFER_SIZE *
+                              OPENER_MESSAGE_BUFFER_SMALL_COUNT) /
+                             sizeof(void *)];
+static void *s_medium_storage[(OPENER_MESSAGE_BUFFER_MEDIUM_SIZE *
+                               OPENER_MESSAGE_BUFFER_MEDIUM_COUNT) /
+                              sizeof(void *)];
+static void *s_large_storage[(OPENER_MESSAGE_BUFFER_LARGE_SIZE *
+                              OPENER_MESSAGE_BUFFER_LARGE_COUNT) /
+                             sizeof(void *)];
+
+/** Ordered from the smallest to the largest class */
+static BlockPool s_message_buffer_pools[MESSAGE_BUFFER_POOL_CLASS_COUNT];
+
+/* References held on every block, 0 while it is free */
+static uint8_t s_small_references[OPENER_MESSAGE_BUFFER_SMALL_COUNT];
+static uint8_t s_medium_references[OPENER_MESSAGE_BUFFER_MEDIUM_COUNT];
+static uint8_t s_large_references[OPENER_MESSAGE_BUFFER_LARGE_COUNT];
+
+static uint8_t *const s_message_buffer_references[
+  MESSAGE_BUFFER_POOL_CLASS_COUNT] = {
+  s_small_references, s_medium_references, s_large_references
+};
+
+static void MessageBufferPoolInitialize(void) {
+  if(BlockPoolIsInitialized(&s_message_buffer_pools[0]) ) {
+    return;
+  }
+  BlockPoolInitialize(&s_message_buffer_pools[0], s_small_storage,
+                      PC_OPENER_ETHERNET_BUFFER_SIZE,
+                      OPENER_MESSAGE_BUFFER_SMALL_COUNT);
+  BlockPoolInitialize(&s_message_buffer_pools[1], s_medium_storage,
+                      OPENER_MESSAGE_BUFFER_MEDIUM_SIZE,
+                      OPENER_MESSAGE_BUFFER_MEDIUM_COUNT);
+  BlockPoolInitialize(&s_message_buffer_pools[2], s_large_storage,
+                      OPENER_MESSAGE_BUFFER_LARGE_SIZE,
+                      OPENER_MESSAGE_BUFFER_LARGE_COUNT);
+}
+
+static bool MessageBufferPoolOwns(const BlockPool *const pool,
+                                  const CipOctet *const buffer) {
+  const uintptr_t start = (uintptr_t)pool->storage;
+  const uintptr_t end = start + pool->block_size * pool->block_count;
+  return ( (uintptr_t)buffer >= start ) && ( (uintptr_t)buffer < end );
+}
+
+/* Class of a buffer, MESSAGE_BUFFER_POOL_CLASS_COUNT if it is not pooled */
+static size_t MessageBufferPoolFindClass(const CipOctet *const buffer) {
+  for(size_t i = 0; i < MESSAGE_BUFFER_POOL_CLASS_COUNT; ++i) {
+    if(MessageBufferPoolOwns(&s_message_buffer_pools[i], buffer) ) {
+      return i;
+    }
+  }
+  return MESSAGE_BUFFER_POOL_CLASS_COUNT;
+}
+
+static size_t MessageBufferPoolBlockIndex(const size_t pool_class,
+                                          const CipOctet *const buffer) {
+  const BlockPool *const pool = &s_message_buffer_pools[pool_class];
+  return (size_t)( (uintptr_t)buffer - (uintptr_t)pool->storage ) /
+         pool->block_size;
+}
+
+static CipOctet *MessageBufferPoolTake(const size_t pool_class,
+                                       size_t *const buffer_size) {
+  BlockPool *const pool = &s_message_buffer_pools[pool_class];
+  CipOctet *buffer = BlockPoolAllocate(pool);
+  if(NULL != buffer) {
+    s_message_buffer_references[pool_class][
+      MessageBufferPoolBlockIndex(pool_class, buffer)] = 1;
+    *buffer_size = pool->block_size;
+  }
+  return buffer;
+}
+
+CipOctet *MessageBufferPoolAllocate(const size_t minimum_size,
+                                    size_t *const buffer_size) {
+  MessageBufferPoolInitialize();
+  for(size_t i = 0; i < MESSAGE_BUFFER_POOL_CLASS_COUNT; ++i) {
+    BlockPool *const pool = &s_message_buffer_pools[i];
+    if(pool->block_size < minimum_size) {
+      continue;
+    }
+    CipOctet *buffer = MessageBufferPoolTake(i, buffer_size);
+    if(NULL != buffer) {
+      return buffer;
+    }
+  }
+  OPENER_TRACE_WARN("No message buffer of %u octets available\n",
+                    (unsigned)minimum_size);
+  return NULL;
+}
+
+CipOctet *MessageBufferPoolAllocateLargest(const size_t minimum_size,
+                                           const size_t maximum_size,
+                                           size_t *const buffer_size) {
+  MessageBufferPoolInitialize();
+  for(size_t i = MESSAGE_BUFFER_POOL_CLASS_COUNT; i > 0; --i) {
+    BlockPool *const pool = &s_message_buffer_pools[i - 1];
+    if( (pool->block_size > maximum_size) ||
+        (pool->block_size < minimum_size) ) {
+      continue;
+    }
+    CipOctet *buffer = MessageBufferPoolTake(i - 1, buffer_size);
+    if(NULL != buffer) {
+      return buffer;
+    }
+  }
+  return NULL;
+}
+
+bool MessageBufferPoolIsAvailable(const size_t minimum_size) {
+  MessageBufferPoolInitialize();
+  for(size_t i = 0; i < MESSAGE_BUFFER_POOL_CLASS_COUNT; ++i) {
+    const BlockPool *const pool = &s_message_buffer_pools[i];
+    if( (pool->block_size >= minimum_size) &&
+        (pool->blocks_in_use < pool->block_count) ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MessageBufferPoolOwnsBuffer(const CipOctet *const buffer) {
+  MessageBufferPoolInitialize();
+  return MESSAGE_BUFFER_POOL_CLASS_COUNT != MessageBufferPoolFindClass(buffer);
+}
+
+size_t MessageBufferPoolGetBufferSize(const CipOctet *const buffer) {
+  MessageBufferPoolInitialize();
+  const size_t pool_class = MessageBufferPoolFindClass(buffer);
+  if(MESSAGE_BUFFER_POOL_CLASS_COUNT == pool_class) {
+    return 0;
+  }
+  return s_message_buffer_pools[pool_class].block_size;
+}
+
+void MessageBufferPoolRetain(CipOctet *const buffer) {
+  const size_t pool_class = MessageBufferPoolFindClass(buffer);
+  if(MESSAGE_BUFFER_POOL_CLASS_COUNT == pool_class) {
+    OPENER_TRACE_ERR("Retaining a buffer that is not from the message buffer pool\n");
+    return;
+  }
+  uint8_t *const references = &s_message_buffer_references[pool_class][
+    MessageBufferPoolBlockIndex(pool_class, buffer)];
+  OPENER_ASSERT( (0 != *references) && (UINT8_MAX != *references) );
+  (*references)++;
+}
+
+void MessageBufferPoolFree(CipOctet *const buffer) {
+  if(NULL == buffer) {
+    return;
+  }
+  const size_t pool_class = MessageBufferPoolFindClass(buffer);
+  if(MESSAGE_BUFFER_POOL_CLASS_COUNT == pool_class) {
+    OPENER_TRACE_ERR("Freeing a buffer that is not from the message buffer pool\n");
+    return;
+  }
+  uint8_t *const references = &s_message_buffer_references[pool_class][
+    MessageBufferPoolBlockIndex(pool_class, buffer)];
+  if(0 == *references) {
+    OPENER_TRACE_ERR("Freeing a message buffer that is not in use\n");
+    return;
+  }
+  if(0 == --(*references) ) {
+    BlockPoolFree(&s_message_buffer_pools[pool_class], buffer);
+  }
+}
@@ -0,0 +1,90 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef SRC_UTILS_MESSAGEBUFFERPOOL_H_
+#define SRC_UTILS_MESSAGEBUFFERPOOL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "typedefs.h"
+
+/**
+ * @file messagebufferpool.h
+ *
+ * Explicit message buffers in three size classes
+ *
+ * Small buffers of PC_OPENER_ETHERNET_BUFFER_SIZE octets, plus medium and
+ * large buffers of OPENER_MESSAGE_BUFFER_MEDIUM_SIZE and
+ * OPENER_MESSAGE_BUFFER_LARGE_SIZE octets, each class backed by a BlockPool
+ * over static storage. Allocation and release are O(1) and never touch the
+ * heap. Only the OpENer task may use the pool.
+ *
+ * Every buffer carries a reference count. The allocation holds the first
+ * reference, MessageBufferPoolRetain() adds one and MessageBufferPoolFree()
+ * drops one, the buffer returns to its class with the last. A reply can so
+ * be handed to the transport, e.g. a TCP transmit queue, without a copy
+ * while its builder releases the buffer as usual. A buffer held by more than
+ * one owner must not be written.
+ */
+
+/** @brief Size of the largest buffer class */
+#define kMessageBufferPoolMaximumSize OPENER_MESSAGE_BUFFER_LARGE_SIZE
+
+/** @brief Take the smallest free buffer holding at least @p minimum_size octets
+ *
+ * @param minimum_size Number of octets needed
+ * @param buffer_size Receives the size of the returned buffer
+ * @return Zero-filled buffer, or NULL if no class is large enough or all
+ *         suitable buffers are in use
+ */
+CipOctet *MessageBufferPoolAllocate(const size_t minimum_size,
+                                    size_t *const buffer_size);
+
+/** @brief Take the largest free buffer of @p minimum_size to @p maximum_size octets
+ *
+ * @param minimum_size Lower bound for the buffer size
+ * @param maximum_size Upper bound for the buffer size
+ * @param buffer_size Receives the size of the returned buffer
+ * @return Zero-filled buffer, or NULL if no suitable buffer is free
+ */
+CipOctet *MessageBufferPoolAllocateLargest(const size_t minimum_size,
+                                           const size_t maximum_size,
+                                           size_t *const buffer_size);
+
+/** @brief Check whether a buffer of @p minimum_size octets could be taken
+ *
+ * @param minimum_size Number of octets needed
+ * @return true if a class large enough has a free buffer
+ */
+bool MessageBufferPoolIsAvailable(const size_t minimum_size);
+
+/** @brief Check whether a buffer was taken from the pool
+ *
+ * @param buffer Buffer to check
+ * @return true if @p buffer lies in the storage of one of the classes
+ */
+bool MessageBufferPoolOwnsBuffer(const CipOctet *const buffer);
+
+/** @brief Size of the class a buffer was taken from
+ *
+ * @param buffer Buffer to check
+ * @return Capacity of @p buffer, 0 if it is not from the pool
+ */
+size_t MessageBufferPoolGetBufferSize(const CipOctet *const buffer);
+
+/** @brief Add a reference to a buffer in use
+ *
+ * @param buffer Buffer taken from the pool
+ */
+void MessageBufferPoolRetain(CipOctet *const buffer);
+
+/** @brief Drop a reference, the last returns the buffer to its class
+ *
+ * @param buffer Buffer taken from the pool, NULL is ignored
+ */
+void MessageBufferPoolFree(CipOctet *const buffer);
+
+#endif /* SRC_UTILS_MESSAGEBUFFERPOOL_H_ */
@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_SEQLOCK_H_
+#define OPENER_SEQLOCK_H_
+
+/** @file seqlock.h
+ *  @brief Sequence lock for consistent copies without blocking the writer
+ *
+ *  The writer makes the sequence odd while it changes the protected data and
+ *  even again once the data is complete. Readers copy the data and retry until
+ *  they observe the same even sequence before and after their copy. The even
+ *  sequence also serves as version of the data, readers can compare it to
+ *  detect a change.
+ *
+ *  Writers have to be serialized by the caller. A reader that preempted the
+ *  writer on the same core cannot succeed until the writer runs again, so
+ *  SeqLockRead() gives up after kSeqLockReadAttempts and leaves it to the
+ *  caller to retry later.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/** @brief Copy attempts of SeqLockRead() before it gives up */
+enum {
+  kSeqLockReadAttempts = 4
+};
+
+typedef struct {
+  uint32_t sequence; /**< odd while a write is in progress */
+} SeqLock;
+
+/** @brief Start changing the protected data */
+static inline void SeqLockWriteBegin(SeqLock *const lock) {
+  const uint32_t sequence = __atomic_load_n(&lock->sequence, __ATOMIC_RELAXED);
+  __atomic_store_n(&lock->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/** @brief Publish the changed data as a new version */
+static inline void SeqLockWriteEnd(SeqLock *const lock) {
+  const uint32_t sequence = __atomic_load_n(&lock->sequence, __ATOMIC_RELAXED);
+  __atomic_store_n(&lock->sequence, sequence + 1, __ATOMIC_RELEASE);
+}
+
+/** @brief Replace a block of protected data */
+static inline void SeqLockWrite(SeqLock *const lock,
+                                void *const data,
+                                const void *const source,
+                                const size_t size) {
+  SeqLockWriteBegin(lock);
+  memcpy(data, source, size);
+  SeqLockWriteEnd(lock);
+}
+
+/** @brief Start a read, returns the sequence to pass to SeqLockReadValid() */
+static inline uint32_t SeqLockReadBegin(const SeqLock *const lock) {
+  return __atomic_load_n(&lock->sequence, __ATOMIC_ACQUIRE);
+}
+
+/** @brief Check that the data read since SeqLockReadBegin() is consistent */
+static inline bool SeqLockReadValid(const SeqLock *const lock,
+                                    const uint32_t sequence) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return 0 == (sequence & 1u) &&
+         sequence == __atomic_load_n(&lock->sequence, __ATOMIC_RELAXED);
+}
+
+/** @brief Take a consistent copy of a block of protected data
+ *
+ *  @param lock lock of the data
+ *  @param copy destination of the copy
+ *  @param data protected data
+ *  @param size number of bytes to copy
+ *  @param version set to the version of the copy if not NULL
+ *  @return true if copy is consistent, false if a write was in progress
+ *  during all kSeqLockReadAttempts
+ */
+static inline bool SeqLockRead(const SeqLock *const lock,
+                               void *const copy,
+                               const void *const data,
+                               const size_t size,
+                               uint32_t *const version) {
+  for(unsigned int attempt = 0; attempt < kSeqLockReadAttempts; ++attempt) {
+    const uint32_t sequence = SeqLockReadBegin(lock);
+    memcpy(copy, data, size);
+    if(SeqLockReadValid(lock, sequence) ) {
+      if(NULL != version) {
+        *version = sequence;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+#endif /* OPENER_SEQLOCK_H_ */
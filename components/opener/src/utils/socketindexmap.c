@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * Copyright (c) 2017, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "socketindexmap.h"
+
+#include "typedefs.h"
+#include "opener_user_conf.h"
+#include "trace.h"
+
+/* Socket handles are small consecutive numbers, a multiplicative hash
+ * spreads them over the whole table */
+static size_t SocketIndexMapHome(const SocketIndexMap *const map,
+                                 const int socket) {
+  return ( (size_t)( (unsigned int)socket * 2654435761U) ) % map->capacity;
+}
+
+/* Entry holding @p socket, or the empty entry ending its probe sequence */
+static size_t SocketIndexMapProbe(const SocketIndexMap *const map,
+                                  const int socket) {
+  size_t slot = SocketIndexMapHome(map, socket);
+  while(kEipInvalidSocket != map->entries[slot].socket &&
+        socket != map->entries[slot].socket) {
+    slot = (slot + 1) % map->capacity;
+  }
+  return slot;
+}
+
+void SocketIndexMapInitialize(SocketIndexMap *const map,
+                              SocketIndexMapEntry *const entries,
+                              const size_t capacity) {
+  OPENER_ASSERT(NULL != entries);
+  OPENER_ASSERT(0 < capacity);
+
+  map->entries = entries;
+  map->capacity = capacity;
+  map->count = 0;
+  for(size_t i = 0; i < capacity; ++i) {
+    entries[i].socket = kEipInvalidSocket;
+    entries[i].index = 0;
+  }
+}
+
+bool SocketIndexMapInsert(SocketIndexMap *const map,
+                          const int socket,
+                          const size_t index) {
+  OPENER_ASSERT(kEipInvalidSocket != socket);
+
+  /* Keep one empty entry so that every probe sequence terminates */
+  if(map->count + 1 >= map->capacity) {
+    size_t existing;
+    if(!SocketIndexMapFind(map, socket, &existing) ) {
+      OPENER_TRACE_ERR("Socket index map full, cannot add socket %d\n",
+                       socket);
+      return false;
+    }
+  }
+
+  const size_t slot = SocketIndexMapProbe(map, socket);
+  if(kEipInvalidSocket == map->entries[slot].socket) {
+    map->entries[slot].socket = socket;
+    map->count++;
+  }
+  map->entries[slot].index = index;
+  return true;
+}
+
+bool SocketIndexMapFind(const SocketIndexMap *const map,
+                        const int socket,
+                        size_t *const index) {
+  if(kEipInvalidSocket == socket) {
+    return false;
+  }
+  const size_t slot = SocketIndexMapProbe(map, socket);
+  if(kEipInvalidSocket == map->entries[slot].socket) {
+    return false;
+  }
+  *index = map->entries[slot].index;
+  return true;
+}
+
+void SocketIndexMapRemove(SocketIndexMap *const map,
+                          const int socket) {
+  if(kEipInvalidSocket == socket) {
+    return;
+  }
+  size_t hole = SocketIndexMapProbe(map, socket);
+  if(kEipInvalidSocket == map->entries[hole].socket) {
+    return;
+  }
+
+  /* Shift later entries of the probe sequence back into the hole instead of
+   * leaving a tombstone, so lookups never get slower over time */
+  size_t slot = hole;
+  while(true) {
+    slot = (slot + 1) % map->capacity;
+    if(kEipInvalidSocket == map->entries[slot].socket) {
+      break;
+    }
+    const size_t home = SocketIndexMapHome(map, map->entries[slot].socket);
+    /* The entry may move if its home is not cyclically within (hole, slot] */
+    const bool home_after_hole = (slot > hole) ?
+                                 (home > hole && home <= slot) :
+                                 (home > hole || home <= slot);
+    if(!home_after_hole) {
+      map->entries[hole] = map->entries[slot];
+      hole = slot;
+    }
+  }
+  map->entries[hole].socket = kEipInvalidSocket;
+  map->entries[hole].index = 0;
+  map->count--;
+}
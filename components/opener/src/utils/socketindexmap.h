@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * Copyright (c) 2017, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef SRC_UTILS_SOCKETINDEXMAP_H_
+#define SRC_UTILS_SOCKETINDEXMAP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file socketindexmap.h
+ *
+ * Fixed size hash map from a socket handle to a table index
+ *
+ * The session table is searched by socket on every TCP frame. The map
+ * resolves a socket in O(1) with open addressing and linear probing over
+ * caller provided storage. Keep the storage at least twice as
+ * large as the number of stored sockets, see SOCKET_INDEX_MAP_CAPACITY().
+ */
+
+/** Recommended number of map entries for @p table_length sockets */
+#define SOCKET_INDEX_MAP_CAPACITY(table_length) (2 * (table_length) )
+
+typedef struct {
+  int socket; /**< key, kEipInvalidSocket for an empty entry */
+  size_t index; /**< value */
+} SocketIndexMapEntry;
+
+typedef struct {
+  SocketIndexMapEntry *entries; /**< Caller provided entry storage */
+  size_t capacity; /**< Number of entries in the storage */
+  size_t count; /**< Number of stored sockets */
+} SocketIndexMap;
+
+/** @brief Set up an empty map over the given storage
+ *
+ * @param map The map to initialize
+ * @param entries Storage for @p capacity entries
+ * @param capacity Number of entries in @p entries
+ */
+void SocketIndexMapInitialize(SocketIndexMap *const map,
+                              SocketIndexMapEntry *const entries,
+                              const size_t capacity);
+
+/** @brief Store or replace the index of a socket
+ *
+ * @param map The map
+ * @param socket The socket handle, not kEipInvalidSocket
+ * @param index The index stored for @p socket
+ * @return true if stored, false if the map is full
+ */
+bool SocketIndexMapInsert(SocketIndexMap *const map,
+                          const int socket,
+                          const size_t index);
+
+/** @brief Look up the index of a socket
+ *
+ * @param map The map
+ * @param socket The socket handle
+ * @param index Receives the stored index if found
+ * @return true if @p socket is stored
+ */
+bool SocketIndexMapFind(const SocketIndexMap *const map,
+                        const int socket,
+                        size_t *const index);
+
+/** @brief Remove a socket, unknown sockets are ignored
+ *
+ * @param map The map
+ * @param socket The socket handle
+ */
+void SocketIndexMapRemove(SocketIndexMap *const map,
+                          const int socket);
+
+#endif /* SRC_UTILS_SOCKETINDEXMAP_H_ */
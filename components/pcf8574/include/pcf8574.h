@@ -22,7 +22,9 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include "esp_err.h"
+#include "driver/gpio.h"
 #include "driver/i2c_master.h"
 
 #ifdef __cplusplus
@@ -31,6 +33,29 @@ extern "C" {
 
 typedef struct pcf8574_handle *pcf8574_handle_t;
 
+/**
+ * @brief Callback invoked after an interrupt-triggered read of a PCF8574
+ *
+ * Runs in the context of the PCF8574 interrupt task, not in the ISR, so it may
+ * block briefly but should not perform further bus transactions.
+ *
+ * @param handle Device that signalled the change
+ * @param value Port value read after the interrupt (bit 0 = P0, bit 7 = P7)
+ * @param timestamp_us esp_timer_get_time() of the falling INT edge, taken in
+ *        the ISR; for a re-read of a line that stayed low, the time of the read
+ * @param user_ctx User context passed to pcf8574_enable_interrupt()
+ */
+typedef void (*pcf8574_change_cb_t)(pcf8574_handle_t handle, uint8_t value,
+                                    int64_t timestamp_us, void *user_ctx);
+
+/**
+ * @brief Function run first in the INT interrupt handler
+ *
+ * Runs in the ISR on every falling INT edge, so it has to be in IRAM and
+ * must not block, e.g. to mark the edge on a GPIO.
+ */
+typedef void (*pcf8574_isr_hook_t)(void);
+
 /**
  * @brief Configuration structure for PCF8574
  */
@@ -86,6 +111,56 @@ esp_err_t pcf8574_write(pcf8574_handle_t handle, uint8_t value);
 esp_err_t pcf8574_scan(const uint8_t *expected_addresses, size_t num_addresses,
                        uint8_t *found_addresses, size_t *num_found);
 
+/**
+ * @brief Check which devices answer on the I2C bus, in one pass
+ *
+ * Sends only the address byte of each device with i2c_master_probe(), no
+ * device is added to the bus for it. present[i] is set for addresses[i].
+ *
+ * @param addresses Array of I2C addresses to check
+ * @param num_addresses Number of addresses in the array
+ * @param present Output array, true for each device that acknowledged
+ * @param timeout_ms Timeout of each probe, only reached on a stuck bus
+ * @return ESP_OK on success, error code if the bus is not available
+ */
+esp_err_t pcf8574_probe(const uint8_t *addresses, size_t num_addresses,
+                        bool *present, uint32_t timeout_ms);
+
+/**
+ * @brief Read the port whenever the device pulls its INT line low
+ *
+ * Configures int_gpio as a falling-edge interrupt with pull-up (the PCF8574
+ * INT output is open drain). The ISR only wakes the PCF8574 interrupt task,
+ * which reads every device registered on that GPIO and hands the value to the
+ * callback. Several devices may share one INT line; all of them are then read
+ * when the line falls, and read again while it stays low, up to a bounded
+ * number of passes. A line still low after that is logged as an error.
+ *
+ * @param handle Device handle
+ * @param int_gpio GPIO connected to the INT output
+ * @param callback Called with each interrupt-triggered read
+ * @param user_ctx Passed unchanged to callback
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if no interrupt slot or task could
+ *         be allocated, error code otherwise
+ */
+esp_err_t pcf8574_enable_interrupt(pcf8574_handle_t handle, gpio_num_t int_gpio,
+                                   pcf8574_change_cb_t callback, void *user_ctx);
+
+/**
+ * @brief Set the function run first in the INT interrupt handler
+ *
+ * @param hook Hook shared by all INT lines, NULL for none
+ */
+void pcf8574_set_isr_hook(pcf8574_isr_hook_t hook);
+
+/**
+ * @brief Stop interrupt-driven reads for a device
+ *
+ * @param handle Device handle
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if interrupts were not enabled
+ */
+esp_err_t pcf8574_disable_interrupt(pcf8574_handle_t handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,19 +22,45 @@
 
 #include "pcf8574.h"
 #include "i2c_manager.h"
+#include "heap_class.h"
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 
 static const char *TAG = "pcf8574";
 #define PCF8574_TIMEOUT_MS 100
+#define PCF8574_PROBE_TIMEOUT_MS 10
+
+#define PCF8574_MAX_INT_DEVICES     8
+#define PCF8574_INT_TASK_STACK_SIZE 3072
+#define PCF8574_INT_TASK_PRIORITY   7
+#define PCF8574_INT_MAX_PASSES      3
 
 struct pcf8574_handle {
     i2c_master_dev_handle_t dev_handle;
     uint8_t address;
 };
 
+typedef struct {
+    pcf8574_handle_t handle;
+    gpio_num_t gpio;
+    pcf8574_change_cb_t callback;
+    void *user_ctx;
+    int64_t edge_time_us;      // esp_timer time of the last falling edge
+} pcf8574_int_slot_t;
+
+static pcf8574_int_slot_t s_int_slots[PCF8574_MAX_INT_DEVICES];
+static portMUX_TYPE s_int_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_int_task = NULL;
+static bool s_isr_service_installed = false;
+static volatile pcf8574_isr_hook_t s_isr_hook = NULL;
+
 esp_err_t pcf8574_init(const pcf8574_config_t *config, pcf8574_handle_t *handle) {
     if (config == NULL || handle == NULL) {
         return ESP_ERR_INVALID_ARG;
@@ -51,7 +77,7 @@ esp_err_t pcf8574_init(const pcf8574_config_t *config, pcf8574_handle_t *handle)
         return ret;
     }
 
-    pcf8574_handle_t dev = (pcf8574_handle_t)malloc(sizeof(struct pcf8574_handle));
+    pcf8574_handle_t dev = heap_class_malloc(HEAP_CLASS_HOT_IO, sizeof(struct pcf8574_handle));
     if (dev == NULL) {
         return ESP_ERR_NO_MEM;
     }
@@ -66,7 +92,7 @@ esp_err_t pcf8574_init(const pcf8574_config_t *config, pcf8574_handle_t *handle)
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to add PCF8574 device at 0x%02X: %s", 
                  config->address, esp_err_to_name(ret));
-        free(dev);
+        heap_class_free(HEAP_CLASS_HOT_IO, dev);
         return ret;
     }
 
@@ -82,13 +108,15 @@ esp_err_t pcf8574_deinit(pcf8574_handle_t handle) {
         return ESP_ERR_INVALID_ARG;
     }
 
+    pcf8574_disable_interrupt(handle);
+
     i2c_master_bus_handle_t bus_handle;
     esp_err_t ret = i2c_manager_get_bus(&bus_handle);
     if (ret == ESP_OK) {
         i2c_master_bus_rm_device(handle->dev_handle);
     }
 
-    free(handle);
+    heap_class_free(HEAP_CLASS_HOT_IO, handle);
     return ESP_OK;
 }
 
@@ -108,9 +136,9 @@ esp_err_t pcf8574_write(pcf8574_handle_t handle, uint8_t value) {
     return i2c_master_transmit(handle->dev_handle, &value, 1, PCF8574_TIMEOUT_MS);
 }
 
-esp_err_t pcf8574_scan(const uint8_t *expected_addresses, size_t num_addresses,
-                       uint8_t *found_addresses, size_t *num_found) {
-    if (expected_addresses == NULL || num_addresses == 0) {
+esp_err_t pcf8574_probe(const uint8_t *addresses, size_t num_addresses,
+                        bool *present, uint32_t timeout_ms) {
+    if (addresses == NULL || present == NULL || num_addresses == 0) {
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -125,43 +153,245 @@ esp_err_t pcf8574_scan(const uint8_t *expected_addresses, size_t num_addresses,
         return ret;
     }
 
-    // Temporarily lower I2C log level to suppress NACK errors during scan
-    esp_log_level_set("i2c.master", ESP_LOG_WARN);
+    // An address byte per device on the bus, no device is added for it. A
+    // missing device NACKs at once, the timeout only matters on a stuck bus.
+    for (size_t i = 0; i < num_addresses; i++) {
+        present[i] = (i2c_master_probe(bus_handle, addresses[i],
+                                       (int)timeout_ms) == ESP_OK);
+    }
+    return ESP_OK;
+}
+
+esp_err_t pcf8574_scan(const uint8_t *expected_addresses, size_t num_addresses,
+                       uint8_t *found_addresses, size_t *num_found) {
+    if (expected_addresses == NULL || num_addresses == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
     size_t found = 0;
+    for (size_t i = 0; i < num_addresses; i++) {
+        bool present = false;
+        esp_err_t ret = pcf8574_probe(&expected_addresses[i], 1, &present,
+                                      PCF8574_PROBE_TIMEOUT_MS);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (present) {
+            if (found_addresses != NULL && found < num_addresses) {
+                found_addresses[found] = expected_addresses[i];
+            }
+            found++;
+        }
+    }
 
-    // Get the bus frequency for device configuration
-    uint32_t bus_freq_hz = 400000; // Default fallback
-    i2c_manager_get_freq(&bus_freq_hz);
+    if (num_found != NULL) {
+        *num_found = found;
+    }
 
-    for (size_t i = 0; i < num_addresses; i++) {
-        i2c_device_config_t dev_cfg = {
-            .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-            .device_address = expected_addresses[i],
-            .scl_speed_hz = bus_freq_hz,
-        };
+    return ESP_OK;
+}
 
-        i2c_master_dev_handle_t temp_handle = NULL;
-        ret = i2c_master_bus_add_device(bus_handle, &dev_cfg, &temp_handle);
-        if (ret == ESP_OK) {
-            uint8_t test_value = 0xFF;
-            ret = i2c_master_transmit(temp_handle, &test_value, 1, 50);
-            if (ret == ESP_OK) {
-                if (found_addresses != NULL && found < num_addresses) {
-                    found_addresses[found] = expected_addresses[i];
+static void IRAM_ATTR pcf8574_int_isr(void *arg) {
+    const pcf8574_isr_hook_t hook = s_isr_hook;
+    if (hook != NULL) {
+        hook();
+    }
+    gpio_num_t gpio = (gpio_num_t)(intptr_t)arg;
+    uint32_t slot_mask = 0;
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL_ISR(&s_int_lock);
+    for (size_t i = 0; i < PCF8574_MAX_INT_DEVICES; i++) {
+        if (s_int_slots[i].handle != NULL && s_int_slots[i].gpio == gpio) {
+            s_int_slots[i].edge_time_us = now_us;
+            slot_mask |= (1u << i);
+        }
+    }
+    portEXIT_CRITICAL_ISR(&s_int_lock);
+
+    if (slot_mask != 0 && s_int_task != NULL) {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        xTaskNotifyFromISR(s_int_task, slot_mask, eSetBits, &higher_priority_task_woken);
+        if (higher_priority_task_woken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+// Reads every device in line_mask, which all share int_gpio. Reading a port
+// releases only that device's INT, so while the line stays low some device on
+// it still has a change pending and no new falling edge will come for it: read
+// them all again, up to PCF8574_INT_MAX_PASSES passes in total. Those passes
+// are stamped with the time of the pass.
+static void pcf8574_int_service_line(const pcf8574_int_slot_t *slots,
+                                     uint32_t line_mask, gpio_num_t int_gpio) {
+    for (int pass = 0; pass < PCF8574_INT_MAX_PASSES; pass++) {
+        int64_t pass_time_us = esp_timer_get_time();
+        for (size_t i = 0; i < PCF8574_MAX_INT_DEVICES; i++) {
+            if ((line_mask & (1u << i)) == 0) {
+                continue;
+            }
+            uint8_t value = 0xFF;
+            esp_err_t ret = pcf8574_read(slots[i].handle, &value);
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "Interrupt read at 0x%02X failed: %s",
+                         slots[i].handle->address, esp_err_to_name(ret));
+                continue;
+            }
+            slots[i].callback(slots[i].handle, value,
+                              pass == 0 ? slots[i].edge_time_us : pass_time_us,
+                              slots[i].user_ctx);
+        }
+        if (gpio_get_level(int_gpio) != 0) {
+            return;
+        }
+    }
+    ESP_LOGE(TAG, "INT GPIO%d still low after %d reads of every device on it, "
+             "giving up until the next edge", int_gpio, PCF8574_INT_MAX_PASSES);
+}
+
+static void pcf8574_int_task(void *arg) {
+    (void)arg;
+
+    while (true) {
+        uint32_t slot_mask = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &slot_mask, portMAX_DELAY);
+
+        pcf8574_int_slot_t slots[PCF8574_MAX_INT_DEVICES];
+        portENTER_CRITICAL(&s_int_lock);
+        memcpy(slots, s_int_slots, sizeof(slots));
+        portEXIT_CRITICAL(&s_int_lock);
+
+        for (size_t i = 0; i < PCF8574_MAX_INT_DEVICES; i++) {
+            if (slots[i].handle == NULL) {
+                slot_mask &= ~(1u << i);
+            }
+        }
+
+        // The ISR sets the bit of every device on the line that fell, so one
+        // line at a time is serviced for all of its devices
+        while (slot_mask != 0) {
+            gpio_num_t int_gpio = slots[__builtin_ctz(slot_mask)].gpio;
+            uint32_t line_mask = 0;
+            for (size_t i = 0; i < PCF8574_MAX_INT_DEVICES; i++) {
+                if ((slot_mask & (1u << i)) != 0 && slots[i].gpio == int_gpio) {
+                    line_mask |= (1u << i);
                 }
-                found++;
             }
-            i2c_master_bus_rm_device(temp_handle);
+            slot_mask &= ~line_mask;
+            pcf8574_int_service_line(slots, line_mask, int_gpio);
         }
     }
+}
 
-    // Restore I2C log level
-    esp_log_level_set("i2c.master", ESP_LOG_INFO);
+void pcf8574_set_isr_hook(pcf8574_isr_hook_t hook) {
+    s_isr_hook = hook;
+}
 
-    if (num_found != NULL) {
-        *num_found = found;
+static bool pcf8574_int_gpio_in_use(gpio_num_t gpio, pcf8574_handle_t exclude) {
+    for (size_t i = 0; i < PCF8574_MAX_INT_DEVICES; i++) {
+        if (s_int_slots[i].handle != NULL && s_int_slots[i].handle != exclude &&
+            s_int_slots[i].gpio == gpio) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t pcf8574_enable_interrupt(pcf8574_handle_t handle, gpio_num_t int_gpio,
+                                   pcf8574_change_cb_t callback, void *user_ctx) {
+    if (handle == NULL || callback == NULL || !GPIO_IS_VALID_GPIO(int_gpio)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t free_slot = PCF8574_MAX_INT_DEVICES;
+    for (size_t i = 0; i < PCF8574_MAX_INT_DEVICES; i++) {
+        if (s_int_slots[i].handle == handle) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (s_int_slots[i].handle == NULL && free_slot == PCF8574_MAX_INT_DEVICES) {
+            free_slot = i;
+        }
+    }
+    if (free_slot == PCF8574_MAX_INT_DEVICES) {
+        ESP_LOGE(TAG, "No free interrupt slot for 0x%02X", handle->address);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (s_int_task == NULL) {
+        if (xTaskCreate(pcf8574_int_task, "pcf8574_int", PCF8574_INT_TASK_STACK_SIZE,
+                        NULL, PCF8574_INT_TASK_PRIORITY, &s_int_task) != pdPASS) {
+            s_int_task = NULL;
+            return ESP_ERR_NO_MEM;
+        }
     }
 
+    esp_err_t ret = ESP_OK;
+    if (!s_isr_service_installed) {
+        ret = gpio_install_isr_service(0);
+        // Another component may already have installed the service
+        if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+            ESP_LOGE(TAG, "Failed to install GPIO ISR service: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        s_isr_service_installed = true;
+    }
+
+    if (!pcf8574_int_gpio_in_use(int_gpio, NULL)) {
+        gpio_config_t io_conf = {
+            .pin_bit_mask = 1ULL << int_gpio,
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_ENABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_NEGEDGE,
+        };
+        ret = gpio_config(&io_conf);
+        if (ret == ESP_OK) {
+            ret = gpio_isr_handler_add(int_gpio, pcf8574_int_isr, (void *)(intptr_t)int_gpio);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to configure INT GPIO%d: %s", int_gpio, esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    portENTER_CRITICAL(&s_int_lock);
+    s_int_slots[free_slot].gpio = int_gpio;
+    s_int_slots[free_slot].callback = callback;
+    s_int_slots[free_slot].user_ctx = user_ctx;
+    s_int_slots[free_slot].edge_time_us = esp_timer_get_time();
+    s_int_slots[free_slot].handle = handle;
+    portEXIT_CRITICAL(&s_int_lock);
+
+    // Deliver the current port state once so the caller starts in sync and a
+    // line that is already low gets released.
+    xTaskNotify(s_int_task, 1u << free_slot, eSetBits);
+
+    ESP_LOGI(TAG, "Interrupt enabled for 0x%02X on GPIO%d", handle->address, int_gpio);
     return ESP_OK;
 }
+
+esp_err_t pcf8574_disable_interrupt(pcf8574_handle_t handle) {
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < PCF8574_MAX_INT_DEVICES; i++) {
+        if (s_int_slots[i].handle != handle) {
+            continue;
+        }
+
+        gpio_num_t gpio = s_int_slots[i].gpio;
+        if (!pcf8574_int_gpio_in_use(gpio, handle)) {
+            gpio_isr_handler_remove(gpio);
+            gpio_intr_disable(gpio);
+        }
+
+        portENTER_CRITICAL(&s_int_lock);
+        memset(&s_int_slots[i], 0, sizeof(s_int_slots[i]));
+        portEXIT_CRITICAL(&s_int_lock);
+        return ESP_OK;
+    }
+
+    return ESP_ERR_INVALID_STATE;
+}
@@ -24,6 +24,7 @@
 #define WEBUI_H
 
 #include <stdbool.h>
+#include "esp_netif.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,6 +37,16 @@ extern "C" {
  */
 bool webui_init(void);
 
+/**
+ * @brief Serve the web UI only on the address of one interface
+ *
+ * Connections accepted on any other address are closed right away. Call
+ * before webui_init().
+ *
+ * @param netif interface to serve, NULL for all
+ */
+void webui_restrict_to_netif(esp_netif_t *netif);
+
 /**
  * @brief Stop the web UI HTTP server
  */
@@ -37,11 +37,30 @@ extern "C" {
 void webui_register_api_handlers(httpd_handle_t server);
 
 /**
- * @brief Get index HTML page (Network Configuration)
+ * @brief Register the /ws/io WebSocket that streams the I/O assembly images
  * 
- * @return HTML content as string
+ * Does nothing unless CONFIG_HTTPD_WS_SUPPORT is enabled.
+ * 
+ * @param server HTTP server handle
+ */
+void webui_register_io_stream_handler(httpd_handle_t server);
+
+/**
+ * @brief Stop streaming and forget all /ws/io clients, called before the server stops
+ */
+void webui_io_stream_stop(void);
+
+/**
+ * @brief Register GET /api/assemblies and GET /api/assemblies/sizes
+ * 
+ * @param server HTTP server handle
+ */
+void webui_register_assemblies_handlers(httpd_handle_t server);
+
+/**
+ * @brief Answer the waiting /api/assemblies long polls, called before the server stops
  */
-const char *webui_get_index_html(void);
+void webui_assemblies_stop(void);
 
 #ifdef __cplusplus
 }
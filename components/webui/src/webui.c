@@ -21,110 +21,108 @@
  */
 
 #include "webui.h"
+#include "esp_netif.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "webui_api.h"
+#include "webui_assets.h"
+#include "webui_async.h"
+#include "webui_wcet.h"
+#include "task_telemetry.h"
+#include "task_placement.h"
+#include "overload_governor.h"
+#include "heap_class.h"
+#include "cJSON.h"
+#include "esp_timer.h"
 #include "lwip/sockets.h"
 #include <string.h>
 
-// Forward declarations for HTML content functions
-const char *webui_get_index_html(void);
-
 static const char *TAG = "webui";
 static httpd_handle_t server_handle = NULL;
+// Set by webui_restrict_to_netif() before the server starts
+static esp_netif_t *s_allowed_netif = NULL;
+
+// While the stack is overloaded one new HTTP session per interval is taken,
+// the browser retries the others
+#define WEBUI_OVERLOAD_SESSION_INTERVAL_US 1000000
+
+static int64_t s_last_session_us = 0;
 
-static esp_err_t root_handler(httpd_req_t *req)
+// httpd open_fn: keeps a connection only if it was accepted on the address
+// of the allowed netif, throttled while the stack is overloaded
+static esp_err_t session_open_handler(httpd_handle_t handle, int sockfd)
 {
-    const char *html = webui_get_index_html();
-    
-    // Calculate actual length by scanning for null terminator
-    // This handles cases where strlen() might stop early due to embedded nulls
-    size_t html_len = 0;
-    const char *p = html;
-    while (*p != '\0' && html_len < 200000) { // Safety limit of 200KB
-        html_len++;
-        p++;
+    (void)handle;
+    if (OverloadGovernorIsShedding(kOverloadStageServices)) {
+        const int64_t now = esp_timer_get_time();
+        if (now - s_last_session_us < WEBUI_OVERLOAD_SESSION_INTERVAL_US) {
+            return ESP_FAIL;
+        }
+        s_last_session_us = now;
     }
-    
-    ESP_LOGI(TAG, "HTML string length: %zu bytes", html_len);
-    
-    // Verify the string ends with </html>
-    const char *html_end = "</html>";
-    size_t html_end_len = strlen(html_end);
-    if (html_len < html_end_len || strncmp(html + html_len - html_end_len, html_end, html_end_len) != 0) {
-        ESP_LOGW(TAG, "HTML string may be truncated! Length: %zu, Last 30 bytes: %.30s", html_len, html + (html_len > 30 ? html_len - 30 : 0));
-    } else {
-        ESP_LOGI(TAG, "HTML string appears complete, ends with </html>");
+    if (s_allowed_netif == NULL) {
+        return ESP_OK;
     }
-    
-    // Check if we hit the safety limit (indicates potential issue)
-    if (html_len >= 200000) {
-        ESP_LOGE(TAG, "HTML string appears to be too long or unterminated!");
-        return ESP_ERR_INVALID_SIZE;
+    struct sockaddr_in local_address;
+    socklen_t length = sizeof(local_address);
+    esp_netif_ip_info_t ip_info;
+    if (getsockname(sockfd, (struct sockaddr *)&local_address, &length) == 0 &&
+        local_address.sin_family == AF_INET &&
+        esp_netif_get_ip_info(s_allowed_netif, &ip_info) == ESP_OK &&
+        local_address.sin_addr.s_addr == ip_info.ip.addr) {
+        return ESP_OK;
     }
-    
-    // Check for null bytes in the string (which would cause strlen to stop early)
-    for (size_t i = 0; i < html_len && i < 50000; i++) {
-        if (html[i] == '\0' && i < html_len - 1) {
-            ESP_LOGW(TAG, "Found null byte at position %zu (before end of string)", i);
-            break;
-        }
+    return ESP_FAIL;
+}
+
+// True if the request's If-None-Match lists the asset's ETag
+static bool etag_matches(httpd_req_t *req, const webui_asset_t *asset)
+{
+    char if_none_match[128];
+    size_t length = httpd_req_get_hdr_value_len(req, "If-None-Match");
+    if (length == 0 || length >= sizeof(if_none_match) ||
+        httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match,
+                                    sizeof(if_none_match)) != ESP_OK) {
+        return false;
     }
-    
-    httpd_resp_set_type(req, "text/html; charset=utf-8");
-    
-    // Use chunked transfer encoding for large responses
-    // This avoids buffer size limits in httpd_resp_send
-    httpd_resp_set_hdr(req, "Transfer-Encoding", "chunked");
-    
-    const size_t chunk_size = 4096;
-    size_t sent = 0;
-    esp_err_t ret = ESP_OK;
-    
-    while (sent < html_len && ret == ESP_OK) {
-        size_t to_send = (html_len - sent > chunk_size) ? chunk_size : (html_len - sent);
-        ret = httpd_resp_send_chunk(req, html + sent, to_send);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to send HTML chunk at offset %zu/%zu: %s", sent, html_len, esp_err_to_name(ret));
-            return ret;
-        }
-        sent += to_send;
+    return strcmp(if_none_match, "*") == 0 || strstr(if_none_match, asset->etag) != NULL;
+}
+
+// Serves one of the gzip compressed assets, the asset is the user context
+static esp_err_t asset_handler(httpd_req_t *req)
+{
+    const webui_asset_t *asset = (const webui_asset_t *)req->user_ctx;
+
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", asset->cache_control);
+    if (etag_matches(req, asset)) {
+        // The browser's copy is current, no body
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
     }
-    
-    // Finalize chunked transfer
-    ret = httpd_resp_send_chunk(req, NULL, 0);
+
+    // All browsers accept gzip, the assets are only stored compressed
+    httpd_resp_set_type(req, asset->content_type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    esp_err_t ret = httpd_resp_send(req, (const char *)asset->data, asset->length);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to finalize chunked transfer: %s", esp_err_to_name(ret));
-        return ret;
+        ESP_LOGE(TAG, "Failed to send %s: %s", asset->uri, esp_err_to_name(ret));
     }
-    
-    ESP_LOGI(TAG, "Successfully sent %zu bytes of HTML using chunked encoding", sent);
-    return ESP_OK;
+    return ret;
 }
 
-
-static esp_err_t favicon_handler(httpd_req_t *req)
+// Parsed request bodies live only for one handler, web scratch memory
+static void *json_malloc(size_t size)
 {
-    // Return 404 for now - favicon embedding will be fixed separately
-    httpd_resp_send_404(req);
-    return ESP_FAIL;
+    return heap_class_malloc(HEAP_CLASS_SCRATCH, size);
 }
 
-static const httpd_uri_t root_uri = {
-    .uri       = "/",
-    .method    = HTTP_GET,
-    .handler   = root_handler,
-    .user_ctx  = NULL
-};
-
-static const httpd_uri_t favicon_uri = {
-    .uri       = "/favicon.ico",
-    .method    = HTTP_GET,
-    .handler   = favicon_handler,
-    .user_ctx  = NULL
-};
+static void json_free(void *ptr)
+{
+    heap_class_free(HEAP_CLASS_SCRATCH, ptr);
+}
 
 bool webui_init(void)
 {
@@ -135,12 +133,27 @@ bool webui_init(void)
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
-    config.max_uri_handlers = 5; // Root, favicon, GET/POST /api/ipconfig
-    config.max_open_sockets = 3;
+    config.max_uri_handlers = 36; // index.html, favicon, GET /api/status, GET/POST /api/ipconfig, GET /api/diagnostics/connections, GET /api/diagnostics/network, GET /api/io, POST /api/io/outputs, GET /api/relays/counters, POST /api/relays/counters/reset, GET /api/assemblies, GET /api/assemblies/sizes, GET /api/trace, GET /api/logs, GET /api/perf, POST /api/perf/reset, GET /api/wcet, GET /api/soe, GET/POST /api/history, GET /api/history/status, GET/POST /api/logic, GET /api/system, POST /api/ota/update, GET /api/ota/status, GET/POST /api/selftest, GET/POST /api/placement, GET/POST /api/peer, GET /api/eds, /ws/io
+    config.max_open_sockets = CONFIG_WEBUI_MAX_OPEN_SOCKETS;
+    // With all sockets taken a new client closes the least recently used one
+    // instead of being refused
+    config.lru_purge_enable = true;
+    // Browsers keep their connections open between requests, TCP keep-alive
+    // frees the sockets of those that went away without closing
+    config.keep_alive_enable = true;
+    config.keep_alive_idle = 5;
+    config.keep_alive_interval = 5;
+    config.keep_alive_count = 3;
     config.stack_size = 8192; // Reduced for minimal web UI
-    config.task_priority = 5;
-    config.core_id = 1;
+    TaskPlacement placement;
+    TaskPlacementGet(kTaskPlacementTaskHttpd, &placement);
+    config.task_priority = placement.priority;
+    config.core_id = placement.core;
     config.max_req_hdr_len = 1024;
+    config.open_fn = session_open_handler;
+
+    cJSON_Hooks json_hooks = { .malloc_fn = json_malloc, .free_fn = json_free };
+    cJSON_InitHooks(&json_hooks);
 
     ESP_LOGI(TAG, "Starting HTTP server on port %d", config.server_port);
     
@@ -151,13 +164,27 @@ bool webui_init(void)
     
     if (httpd_start(&server_handle, &config) == ESP_OK) {
         ESP_LOGI(TAG, "HTTP server started");
+#if CONFIG_OPENER_TASK_TELEMETRY
+        TaskTelemetryRegister(kTaskTelemetryHttpd, config.stack_size);
+#endif
+        // Workers outlive webui_stop(), a restarted server finds them running
+        (void)webui_async_start(config.stack_size, config.task_priority, config.core_id);
         
-        // Register URI handlers
-        httpd_register_uri_handler(server_handle, &root_uri);
-        httpd_register_uri_handler(server_handle, &favicon_uri);
+        // Register the static assets
+        for (size_t i = 0; i < webui_asset_count; i++) {
+            const httpd_uri_t asset_uri = {
+                .uri       = webui_assets[i].uri,
+                .method    = HTTP_GET,
+                .handler   = asset_handler,
+                .user_ctx  = (void *)&webui_assets[i]
+            };
+            webui_register_uri_handler(server_handle, &asset_uri);
+        }
         
         // Register API handlers
         webui_register_api_handlers(server_handle);
+        webui_register_io_stream_handler(server_handle);
+        webui_register_assemblies_handlers(server_handle);
         
         return true;
     }
@@ -166,9 +193,16 @@ bool webui_init(void)
     return false;
 }
 
+void webui_restrict_to_netif(esp_netif_t *netif)
+{
+    s_allowed_netif = netif;
+}
+
 void webui_stop(void)
 {
     if (server_handle != NULL) {
+        webui_io_stream_stop();
+        webui_assemblies_stop();
         httpd_stop(server_handle);
         server_handle = NULL;
         ESP_LOGI(TAG, "HTTP server stopped");
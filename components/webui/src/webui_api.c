@@ -21,92 +21,154 @@
  */
 
 #include "webui_api.h"
+#include "webui_async.h"
+#include "webui_json.h"
+#include "webui_wcet.h"
 #include "ciptcpipinterface.h"
+#include "cipconnectiondiagnostics.h"
+#include "cipconnectionmanager.h"
+#include "cipassembly.h"
+#include "cipidentity.h"
+#include "kc868_a16_application.h"
+#include "kc868_a16_assembly_map.h"
+#include "kc868_a16_io.h"
+#include "kc868_a16_soe.h"
+#include "kc868_a16_history.h"
+#include "kc868_a16_mqtt.h"
+#include "kc868_a16_modbus.h"
+#include "kc868_a16_modbus_rtu.h"
+#include "kc868_a16_logic.h"
+#include "kc868_a16_peer.h"
+#include "kc868_a16_relay_count.h"
+#include "kc868_a16_expansion.h"
+#include "kc868_a16_scan_schedule.h"
+#include "trace_buffer.h"
+#include "log_buffer.h"
+#include "loop_profile.h"
+#include "wcet_profile.h"
+#include "production_scheduler.h"
+#include "io_endpoint.h"
+#include "secure_transport.h"
+#include "generic_networkhandler.h"
+#include "cip_arena.h"
+#include "task_telemetry.h"
+#include "app_scheduler.h"
+#include "eth_media_counters.h"
+#include "eth_rx_moderation.h"
+#include "multicast_filter.h"
+#include "originator_arp.h"
+#include "udp_rate_limit.h"
+#include "power_management.h"
+#include "ota_update.h"
+#include "self_test.h"
+#include "task_placement.h"
+#include "overload_governor.h"
+#include "mdns_advertise.h"
+#include "sntp_clock.h"
+#include "eds_file.h"
 #include "nvtcpip.h"
+#include "netif_status.h"
+#include "heap_class.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "lwip/inet.h"
+#include "lwip/stats.h"
+#include "lwip/esp_pbuf_ref.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "webui_api";
 
-// Mutex for protecting g_tcpip structure access (shared between OpENer task and API handlers)
-static SemaphoreHandle_t s_tcpip_mutex = NULL;
-static SemaphoreHandle_t s_tcpip_mutex_creation_mutex = NULL;
-
-static SemaphoreHandle_t get_tcpip_mutex(void) {
-  if (s_tcpip_mutex != NULL) {
-    return s_tcpip_mutex;
-  }
-  
-  if (s_tcpip_mutex_creation_mutex == NULL) {
-    s_tcpip_mutex_creation_mutex = xSemaphoreCreateMutex();
-    if (s_tcpip_mutex_creation_mutex == NULL) {
-      return NULL;
-    }
-  }
-  
-  if (xSemaphoreTake(s_tcpip_mutex_creation_mutex, portMAX_DELAY) == pdTRUE) {
-    if (s_tcpip_mutex == NULL) {
-      s_tcpip_mutex = xSemaphoreCreateMutex();
-    }
-    xSemaphoreGive(s_tcpip_mutex_creation_mutex);
-  }
-  
-  return s_tcpip_mutex;
-}
-
-// Helper function to send JSON response
-static esp_err_t send_json_response(httpd_req_t *req, cJSON *json, esp_err_t status_code)
-{
-    char *json_str = cJSON_Print(json);
-    if (json_str == NULL) {
-        cJSON_Delete(json);
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+// Attempts to get a consistent TCP/IP snapshot, one tick apart
+#define TCPIP_SNAPSHOT_ATTEMPTS 10
+
+// Assemblies of the KC868-A16 application, the output one holds the relay image
+#define IO_INPUT_ASSEMBLY 100
+#define IO_OUTPUT_ASSEMBLY 150
+// Largest assembly image /api/status returns
+#define STATUS_MAX_ASSEMBLY_SIZE 256
+
+// Reads g_tcpip without blocking the OpENer task; a failed read means a
+// writer was preempted mid-update, so give it a tick to finish
+static bool get_tcpip_snapshot(CipTcpIpSnapshot *snapshot)
+{
+    for (int attempt = 0; attempt < TCPIP_SNAPSHOT_ATTEMPTS; attempt++) {
+        if (CipTcpIpGetSnapshot(snapshot) == kEipStatusOk) {
+            return true;
+        }
+        vTaskDelay(1);
     }
-    
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_status(req, status_code == ESP_OK ? "200 OK" : "400 Bad Request");
-    httpd_resp_send(req, json_str, strlen(json_str));
-    
-    free(json_str);
-    cJSON_Delete(json);
-    return ESP_OK;
+    return false;
 }
 
 // Helper function to send JSON error response
 static esp_err_t send_json_error(httpd_req_t *req, const char *message, int http_status)
 {
-    cJSON *json = cJSON_CreateObject();
-    cJSON_AddStringToObject(json, "status", "error");
-    cJSON_AddStringToObject(json, "message", message);
-    
-    char *json_str = cJSON_Print(json);
-    if (json_str == NULL) {
-        cJSON_Delete(json);
-        httpd_resp_send_500(req);
+    webui_json_writer_t writer;
+    const char *status = "400 Bad Request";
+    if (http_status == 409) {
+        status = "409 Conflict";
+    } else if (http_status == 413) {
+        status = "413 Payload Too Large";
+    } else if (http_status == 500) {
+        status = "500 Internal Server Error";
+    }
+    webui_json_begin(&writer, req, status);
+    webui_json_add_string(&writer, "status", "error");
+    webui_json_add_string(&writer, "message", message);
+    return webui_json_end(&writer);
+}
+
+// Times a body receive may time out in a row before the request is dropped
+#define WEBUI_RECV_TIMEOUT_RETRIES 3
+
+// Helper function to read a whole request body into buf as a string; on
+// failure the error reply has been sent and the handler returns ESP_FAIL
+static esp_err_t webui_recv_body(httpd_req_t *req, char *buf, size_t size)
+{
+    if (req->content_len >= size) {
+        send_json_error(req, "Request too large", 413);
         return ESP_FAIL;
     }
-    
-    httpd_resp_set_type(req, "application/json");
-    if (http_status == 400) {
-        httpd_resp_set_status(req, "400 Bad Request");
-    } else if (http_status == 500) {
-        httpd_resp_set_status(req, "500 Internal Server Error");
-    } else {
-        httpd_resp_set_status(req, "400 Bad Request");
+    size_t received = 0;
+    unsigned int timeouts = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, buf + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts <= WEBUI_RECV_TIMEOUT_RETRIES) {
+            continue;
+        }
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+            return ESP_FAIL;
+        }
+        if (ret <= 0) {
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
+        timeouts = 0;
+        received += (size_t)ret;
     }
-    httpd_resp_send(req, json_str, strlen(json_str));
-    
-    free(json_str);
-    cJSON_Delete(json);
+    buf[received] = '\0';
     return ESP_OK;
 }
 
+// Helper function to send a JSON status message
+static esp_err_t send_json_status(httpd_req_t *req, const char *message)
+{
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_string(&writer, "status", "ok");
+    webui_json_add_string(&writer, "message", message);
+    return webui_json_end(&writer);
+}
+
 // Helper function to convert IP string to uint32_t (network byte order)
 static uint32_t ip_string_to_uint32(const char *ip_str)
 {
@@ -137,51 +199,61 @@ static void ip_uint32_to_string(uint32_t ip, char *buf, size_t buf_size)
 // GET /api/ipconfig - Get IP configuration
 static esp_err_t api_get_ipconfig_handler(httpd_req_t *req)
 {
-    s_tcpip_mutex = get_tcpip_mutex();
-    if (s_tcpip_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create TCP/IP mutex");
-        return send_json_error(req, "Internal error: mutex creation failed", 500);
-    }
-    
     // Always read from OpENer's g_tcpip (single source of truth)
-    // Protect with mutex to prevent race conditions with OpENer task
-    if (xSemaphoreTake(s_tcpip_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        ESP_LOGW(TAG, "Timeout waiting for TCP/IP mutex");
+    CipTcpIpSnapshot tcpip;
+    if (!get_tcpip_snapshot(&tcpip)) {
+        ESP_LOGW(TAG, "Timeout waiting for a consistent TCP/IP configuration");
         return send_json_error(req, "Timeout accessing IP configuration", 500);
     }
     
-    bool use_dhcp = (g_tcpip.config_control & kTcpipCfgCtrlMethodMask) == kTcpipCfgCtrlDhcp;
-    
-    // Copy values to local variables while holding mutex
-    uint32_t ip_address = g_tcpip.interface_configuration.ip_address;
-    uint32_t network_mask = g_tcpip.interface_configuration.network_mask;
-    uint32_t gateway = g_tcpip.interface_configuration.gateway;
-    uint32_t name_server = g_tcpip.interface_configuration.name_server;
-    uint32_t name_server_2 = g_tcpip.interface_configuration.name_server_2;
-    
-    xSemaphoreGive(s_tcpip_mutex);
+    bool use_dhcp = (tcpip.config_control & kTcpipCfgCtrlMethodMask) == kTcpipCfgCtrlDhcp;
+    uint32_t ip_address = tcpip.ip_address;
+    uint32_t network_mask = tcpip.network_mask;
+    uint32_t gateway = tcpip.gateway;
+    uint32_t name_server = tcpip.name_server;
+    uint32_t name_server_2 = tcpip.name_server_2;
+
+    // The netif snapshot, without a call into the tcpip thread. With DHCP it
+    // holds the current lease; a static configuration saved here only takes
+    // effect after a reboot, so g_tcpip stays the source of those values.
+    NetifStatus netif_status;
+    bool have_netif_status = NetifStatusGet(&netif_status);
+    if (have_netif_status && use_dhcp) {
+        ip_address = netif_status.ip_address;
+        network_mask = netif_status.network_mask;
+        gateway = netif_status.gateway;
+        name_server = netif_status.name_server;
+        name_server_2 = netif_status.name_server_2;
+    }
     
-    // Build JSON response outside of mutex (safer, no blocking)
-    cJSON *json = cJSON_CreateObject();
-    cJSON_AddBoolToObject(json, "use_dhcp", use_dhcp);
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_bool(&writer, "use_dhcp", use_dhcp);
     
     char ip_str[16];
     ip_uint32_to_string(ip_address, ip_str, sizeof(ip_str));
-    cJSON_AddStringToObject(json, "ip_address", ip_str);
+    webui_json_add_string(&writer, "ip_address", ip_str);
     
     ip_uint32_to_string(network_mask, ip_str, sizeof(ip_str));
-    cJSON_AddStringToObject(json, "netmask", ip_str);
+    webui_json_add_string(&writer, "netmask", ip_str);
     
     ip_uint32_to_string(gateway, ip_str, sizeof(ip_str));
-    cJSON_AddStringToObject(json, "gateway", ip_str);
+    webui_json_add_string(&writer, "gateway", ip_str);
     
     ip_uint32_to_string(name_server, ip_str, sizeof(ip_str));
-    cJSON_AddStringToObject(json, "dns1", ip_str);
+    webui_json_add_string(&writer, "dns1", ip_str);
     
     ip_uint32_to_string(name_server_2, ip_str, sizeof(ip_str));
-    cJSON_AddStringToObject(json, "dns2", ip_str);
+    webui_json_add_string(&writer, "dns2", ip_str);
+    webui_json_add_bool(&writer, "quick_connect", tcpip.quick_connect);
+    if (have_netif_status) {
+        webui_json_add_string(&writer, "hostname", netif_status.hostname);
+        webui_json_add_bool(&writer, "link_up", netif_status.link_up);
+        webui_json_add_uint(&writer, "link_speed", netif_status.link_speed);
+        webui_json_add_bool(&writer, "full_duplex", netif_status.full_duplex);
+    }
     
-    return send_json_response(req, json, ESP_OK);
+    return webui_json_end(&writer);
 }
 
 // POST /api/ipconfig - Set IP configuration
@@ -201,7 +273,7 @@ static esp_err_t api_post_ipconfig_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
     
-    // Parse JSON first (before taking mutex)
+    // Parse JSON first (before entering the stack)
     cJSON *item = cJSON_GetObjectItem(json, "use_dhcp");
     bool use_dhcp_requested = false;
     bool use_dhcp_set = false;
@@ -224,9 +296,9 @@ static esp_err_t api_post_ipconfig_handler(httpd_req_t *req)
     
     // Read current config_control to determine if we should parse IP settings
     bool is_static_ip = false;
-    if (s_tcpip_mutex != NULL && xSemaphoreTake(s_tcpip_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        is_static_ip = ((g_tcpip.config_control & kTcpipCfgCtrlMethodMask) == kTcpipCfgCtrlStaticIp);
-        xSemaphoreGive(s_tcpip_mutex);
+    CipTcpIpSnapshot tcpip;
+    if (get_tcpip_snapshot(&tcpip)) {
+        is_static_ip = ((tcpip.config_control & kTcpipCfgCtrlMethodMask) == kTcpipCfgCtrlStaticIp);
     }
     
     if (is_static_ip || !use_dhcp_requested) {
@@ -261,21 +333,21 @@ static esp_err_t api_post_ipconfig_handler(httpd_req_t *req)
         name_server_2_set = true;
     }
     
-    cJSON_Delete(json);
-    
-    s_tcpip_mutex = get_tcpip_mutex();
-    if (s_tcpip_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create TCP/IP mutex");
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Internal error: mutex creation failed");
-        return ESP_FAIL;
+    // TCP/IP attribute 12, applied at the next power-up
+    item = cJSON_GetObjectItem(json, "quick_connect");
+    bool quick_connect_new = false;
+    bool quick_connect_set = false;
+    if (item != NULL && cJSON_IsBool(item)) {
+        quick_connect_new = cJSON_IsTrue(item);
+        quick_connect_set = true;
     }
     
-    // Update g_tcpip with mutex protection
-    if (xSemaphoreTake(s_tcpip_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        ESP_LOGW(TAG, "Timeout waiting for TCP/IP mutex");
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Timeout accessing IP configuration");
-        return ESP_FAIL;
-    }
+    cJSON_Delete(json);
+    
+    // Writers of g_tcpip are serialized by the stack lock; readers see the
+    // changes as one new snapshot
+    ProductionSchedulerLock();
+    CipTcpIpBeginUpdate();
     
     // Update configuration control
     if (use_dhcp_set) {
@@ -307,58 +379,2272 @@ static esp_err_t api_post_ipconfig_handler(httpd_req_t *req)
     if (name_server_2_set) {
         g_tcpip.interface_configuration.name_server_2 = name_server_2_new;
     }
+    if (quick_connect_set) {
+        g_tcpip.quick_connect = quick_connect_new;
+    }
+    
+    CipTcpIpEndUpdate();
+    CipTcpIpObject stored_tcpip = g_tcpip;
+    ProductionSchedulerUnlock();
     
-    // Save to NVS while holding mutex
-    EipStatus nvs_status = NvTcpipStore(&g_tcpip);
-    xSemaphoreGive(s_tcpip_mutex);
+    // The NVS write takes milliseconds, store a copy outside the stack lock
+    EipStatus nvs_status = NvTcpipStore(&stored_tcpip);
     
     if (nvs_status != kEipStatusOk) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save IP configuration");
         return ESP_FAIL;
     }
     
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "status", "ok");
-    cJSON_AddStringToObject(response, "message", "IP configuration saved successfully. Reboot required to apply changes.");
-    
-    return send_json_response(req, response, ESP_OK);
+    return send_json_status(req, "IP configuration saved successfully. Reboot required to apply changes.");
 }
 
-void webui_register_api_handlers(httpd_handle_t server)
+// POST /api/ipconfig stores to the NVS, run it in a worker
+static esp_err_t api_post_ipconfig_async(httpd_req_t *req)
 {
-    if (server == NULL) {
-        ESP_LOGE(TAG, "Cannot register API handlers: server handle is NULL!");
-        return;
+    return webui_async_submit(req, api_post_ipconfig_handler);
+}
+
+// Helper function to add a histogram as JSON array
+static void add_histogram(webui_json_writer_t *writer, const char *name, const CipUdint *histogram)
+{
+    webui_json_begin_array(writer, name);
+    for (size_t i = 0; i < CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS; i++) {
+        webui_json_add_uint(writer, NULL, histogram[i]);
     }
-    
-    ESP_LOGI(TAG, "Registering API handlers...");
-    
-    // GET /api/ipconfig
-    httpd_uri_t get_ipconfig_uri = {
-        .uri       = "/api/ipconfig",
-        .method    = HTTP_GET,
-        .handler   = api_get_ipconfig_handler,
-        .user_ctx  = NULL
+    webui_json_end_array(writer);
+}
+
+// Helper function to add one direction's interval statistics as JSON object
+static void add_interval_statistics(webui_json_writer_t *writer, const char *name,
+                                    const CipConnectionIntervalStatistics *statistics)
+{
+    webui_json_begin_object(writer, name);
+    webui_json_add_uint(writer, "rpi_us", statistics->requested_interval);
+    webui_json_add_uint(writer, "packets", statistics->packets);
+    webui_json_add_uint(writer, "late", statistics->late_packets);
+    webui_json_add_uint(writer, "missed", statistics->missed_packets);
+    // UINT32_MAX means no interval was measured yet
+    webui_json_add_uint(writer, "min_interval_us",
+                        statistics->minimum_interval == UINT32_MAX ? 0 : statistics->minimum_interval);
+    webui_json_add_uint(writer, "max_interval_us", statistics->maximum_interval);
+    add_histogram(writer, "histogram", statistics->histogram);
+    webui_json_end_object(writer);
+}
+
+// GET /api/diagnostics/connections - Get I/O connection timing statistics
+static esp_err_t api_get_connection_diagnostics_handler(httpd_req_t *req)
+{
+    // One multicast production serves all consumers of the same input
+    // Walks the connection list, so hold the stack lock like the stack tasks do;
+    // read before streaming so the lock is never held across a send
+    MulticastProductionStatistics multicast;
+#if OPENER_FORWARD_OPEN_TRACE_ENTRIES > 0
+    static ForwardOpenTrace forward_opens[OPENER_FORWARD_OPEN_TRACE_ENTRIES]; // httpd runs one request at a time
+#endif
+    size_t forward_open_count = 0;
+    ProductionSchedulerLock();
+    GetMulticastProductionStatistics(&multicast);
+#if OPENER_FORWARD_OPEN_TRACE_ENTRIES > 0
+    while (forward_open_count < OPENER_FORWARD_OPEN_TRACE_ENTRIES &&
+           GetForwardOpenTrace(forward_open_count, &forward_opens[forward_open_count])) {
+        forward_open_count++;
+    }
+#endif
+    ProductionSchedulerUnlock();
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+
+    webui_json_begin_array(&writer, "interval_bucket_limits_percent");
+    for (size_t i = 0; i < CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS - 1; i++) {
+        webui_json_add_uint(&writer, NULL, kCipConnectionDiagnosticsIntervalLimits[i]);
+    }
+    webui_json_end_array(&writer);
+    webui_json_begin_array(&writer, "latency_bucket_limits_us");
+    for (size_t i = 0; i < CIP_CONNECTION_DIAGNOSTICS_HISTOGRAM_BUCKETS - 1; i++) {
+        webui_json_add_uint(&writer, NULL, kCipConnectionDiagnosticsLatencyLimits[i]);
+    }
+    webui_json_end_array(&writer);
+
+    webui_json_begin_array(&writer, "connections");
+    CipConnectionDiagnostics diagnostics;
+    for (size_t i = 0; CipConnectionDiagnosticsGet(i, &diagnostics); i++) {
+        // Statistics are written by the OpENer task; a snapshot may straddle one packet
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_uint(&writer, "instance", i + 1);
+        webui_json_add_bool(&writer, "active", diagnostics.connection_id != 0);
+        webui_json_add_uint(&writer, "connection_id", diagnostics.connection_id);
+        add_interval_statistics(&writer, "produced", &diagnostics.produced);
+        add_interval_statistics(&writer, "consumed", &diagnostics.consumed);
+
+        webui_json_begin_object(&writer, "consumed_to_applied");
+        webui_json_add_uint(&writer, "samples", diagnostics.consumed_to_applied.samples);
+        webui_json_add_uint(&writer, "max_us", diagnostics.consumed_to_applied.maximum_latency);
+        add_histogram(&writer, "histogram", diagnostics.consumed_to_applied.histogram);
+        webui_json_end_object(&writer);
+
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+
+    webui_json_begin_object(&writer, "multicast");
+    webui_json_add_uint(&writer, "producers", multicast.producers);
+    webui_json_add_uint(&writer, "consumers", multicast.consumers);
+    webui_json_add_uint(&writer, "packets_produced", multicast.packets_produced);
+    webui_json_add_uint(&writer, "packets_saved", multicast.packets_saved);
+    webui_json_end_object(&writer);
+
+    // Latest first; the stage times add up to total_us
+    webui_json_begin_array(&writer, "forward_opens");
+#if OPENER_FORWARD_OPEN_TRACE_ENTRIES > 0
+    static const char *const stage_names[kForwardOpenStageCount] = {
+        "request", "path", "electronic_key", "admission", "establish", "channels", "response",
     };
-    esp_err_t ret = httpd_register_uri_handler(server, &get_ipconfig_uri);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to register GET /api/ipconfig: %s", esp_err_to_name(ret));
-    } else {
-        ESP_LOGI(TAG, "Registered GET /api/ipconfig handler");
+    for (size_t i = 0; i < forward_open_count; i++) {
+        const ForwardOpenTrace *trace = &forward_opens[i];
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_uint(&writer, "sequence", trace->sequence);
+        webui_json_add_uint64(&writer, "received_us", trace->received);
+        webui_json_add_bool(&writer, "large", trace->large);
+        webui_json_add_uint(&writer, "connection_serial", trace->connection_serial_number);
+        webui_json_add_uint(&writer, "vendor_id", trace->originator_vendor_id);
+        webui_json_add_uint(&writer, "originator_serial", trace->originator_serial_number);
+        webui_json_add_uint(&writer, "general_status", trace->general_status);
+        webui_json_add_uint(&writer, "extended_status", trace->extended_status);
+        webui_json_add_uint(&writer, "total_us", trace->total_us);
+        webui_json_begin_object(&writer, "stages_us");
+        for (size_t stage = 0; stage < kForwardOpenStageCount; stage++) {
+            webui_json_add_uint(&writer, stage_names[stage], trace->stage_us[stage]);
+        }
+        webui_json_end_object(&writer);
+        webui_json_end_object(&writer);
     }
-    
-    // POST /api/ipconfig
-    httpd_uri_t post_ipconfig_uri = {
-        .uri       = "/api/ipconfig",
-        .method    = HTTP_POST,
-        .handler   = api_post_ipconfig_handler,
-        .user_ctx  = NULL
+#else
+    (void)forward_open_count;
+#endif
+    webui_json_end_array(&writer);
+
+    return webui_json_end(&writer);
+}
+
+// GET /api/diagnostics/network - Get the I/O receive queue and lwIP allocation counters
+static esp_err_t api_get_network_diagnostics_handler(httpd_req_t *req)
+{
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+
+#if OPENER_IO_EVENT_BACKEND
+    IoEndpointStatistics io_statistics;
+    IoEndpointGetStatistics(&io_statistics);
+    webui_json_begin_object(&writer, "io_queue");
+    webui_json_add_uint(&writer, "length", io_statistics.queue_length);
+    webui_json_add_uint(&writer, "peak", io_statistics.queue_peak);
+    webui_json_add_uint(&writer, "dropped_oldest", io_statistics.dropped_datagrams);
+    webui_json_add_uint(&writer, "early_demux", io_statistics.early_datagrams);
+    webui_json_add_uint(&writer, "dropped_broadcasts", io_statistics.dropped_broadcasts);
+    webui_json_add_uint(&writer, "arp_queued", io_statistics.arp_queued);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_OPENER_OVERLOAD_GOVERNOR
+    OverloadGovernorStatistics overload;
+    OverloadGovernorGetStatistics(&overload);
+    webui_json_begin_object(&writer, "overload");
+    webui_json_add_string(&writer, "stage", OverloadGovernorGetStageName((OverloadStage)overload.stage));
+    webui_json_add_string(&writer, "highest_stage",
+                          OverloadGovernorGetStageName((OverloadStage)overload.highest_stage));
+    webui_json_add_uint(&writer, "loop_overruns", overload.loop_overruns);
+    webui_json_add_uint(&writer, "late_productions", overload.late_productions);
+    webui_json_add_uint(&writer, "overloaded_windows", overload.overloaded_windows);
+    webui_json_add_uint(&writer, "stage_changes", overload.stage_changes);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT
+    UdpRateLimitStatistics rate_limit;
+    UdpRateLimitGetStatistics(&rate_limit);
+    webui_json_begin_object(&writer, "encap_udp_rate_limit");
+    webui_json_add_uint(&writer, "limit", CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT);
+    webui_json_add_uint(&writer, "limit_per_source", CONFIG_OPENER_ENCAP_UDP_RATE_LIMIT_PER_SOURCE);
+    webui_json_add_uint(&writer, "dropped_global", rate_limit.dropped_global);
+    webui_json_add_uint(&writer, "dropped_source", rate_limit.dropped_source);
+    webui_json_add_uint(&writer, "sources", rate_limit.sources);
+    webui_json_end_object(&writer);
+#endif
+
+#if OPENER_CIP_SECURITY
+    SecureTransportStatistics secure;
+    SecureTransportGetStatistics(&secure);
+    webui_json_begin_object(&writer, "cip_security");
+    webui_json_add_uint(&writer, "tls_sessions", secure.tls_sessions);
+    webui_json_add_uint(&writer, "dtls_sessions", secure.dtls_sessions);
+    webui_json_add_uint(&writer, "handshake_failures", secure.handshake_failures);
+    webui_json_add_uint(&writer, "refused_connections", secure.refused_connections);
+    webui_json_add_uint(&writer, "dropped_datagrams", secure.dropped_datagrams);
+    webui_json_add_uint(&writer, "send_errors", secure.send_errors);
+    webui_json_begin_object(&writer, "timings");
+    for (size_t i = 0; i < kSecureTransportNumberOfTimings; i++) {
+        const SecureTransportTiming *const timing = &secure.timings[i];
+        webui_json_begin_object(&writer, SecureTransportGetTimingName((SecureTransportTimingKind)i));
+        webui_json_add_uint(&writer, "count", timing->count);
+        webui_json_add_uint(&writer, "average_us", timing->average_us);
+        webui_json_add_uint(&writer, "maximum_us", timing->maximum_us);
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_object(&writer);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_OPENER_ARP_PIN_ORIGINATORS
+    OriginatorArpStatistics arp;
+    OriginatorArpGetStatistics(&arp);
+    webui_json_begin_object(&writer, "originator_arp");
+    webui_json_add_uint(&writer, "pinned", arp.pinned);
+    webui_json_add_uint(&writer, "pending", arp.pending);
+    webui_json_add_uint(&writer, "table_full", arp.table_full);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_OPENER_PM_IO_PERFORMANCE
+    // Clock mode and what each mode costs, the workload was timed at start-up
+    PowerManagementStatistics power;
+    PowerManagementGetStatistics(&power);
+    webui_json_begin_object(&writer, "power");
+    webui_json_add_bool(&writer, "performance", power.performance);
+    webui_json_add_uint(&writer, "min_freq_mhz", CONFIG_OPENER_PM_MIN_FREQ_MHZ);
+    webui_json_add_uint(&writer, "max_freq_mhz", CONFIG_OPENER_PM_MAX_FREQ_MHZ);
+    webui_json_add_uint(&writer, "io_connections", power.connections);
+    webui_json_add_uint(&writer, "transitions", power.transitions);
+    webui_json_add_uint(&writer, "switch_last_us", power.switch_last_us);
+    webui_json_add_uint(&writer, "switch_max_us", power.switch_max_us);
+    webui_json_add_uint64(&writer, "low_power_ms", power.low_power_ms);
+    webui_json_add_uint64(&writer, "performance_ms", power.performance_ms);
+    webui_json_add_uint(&writer, "workload_low_power_us", power.workload_low_power_us);
+    webui_json_add_uint(&writer, "workload_performance_us", power.workload_performance_us);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_OPENER_MDNS
+    MdnsAdvertiseStatus mdns;
+    MdnsAdvertiseGetStatus(&mdns);
+    webui_json_begin_object(&writer, "mdns");
+    webui_json_add_string(&writer, "state", MdnsAdvertiseGetStateName(mdns.state));
+    webui_json_add_string(&writer, "host_name", mdns.host_name);
+    webui_json_add_uint(&writer, "conflicts", mdns.conflicts);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_OPENER_SNTP_CLOCK
+    SntpClockStatus sntp;
+    SntpClockGetStatus(&sntp);
+    webui_json_begin_object(&writer, "sntp");
+    webui_json_add_string(&writer, "state", SntpClockGetStateName(sntp.state));
+    webui_json_add_string(&writer, "server", CONFIG_OPENER_SNTP_SERVER);
+    webui_json_add_uint64(&writer, "utc_us", (uint64_t)SntpClockNowUs());
+    webui_json_add_uint(&writer, "syncs", sntp.syncs);
+    webui_json_add_uint(&writer, "steps", sntp.steps);
+    webui_json_add_int(&writer, "last_offset_us", sntp.last_offset_us);
+    webui_json_add_uint(&writer, "max_offset_us", sntp.max_offset_us);
+    webui_json_add_uint(&writer, "last_sync_age_ms", sntp.last_sync_age_ms);
+    webui_json_add_int(&writer, "drift_ppb", sntp.drift_ppb);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_KC868_MQTT
+    KC868_A16_MqttStatistics mqtt;
+    KC868_A16_MqttGetStatistics(&mqtt);
+    webui_json_begin_object(&writer, "mqtt");
+    webui_json_add_bool(&writer, "connected", mqtt.connected);
+    webui_json_add_uint(&writer, "connects", mqtt.connects);
+    webui_json_add_uint(&writer, "messages", mqtt.messages);
+    webui_json_add_uint(&writer, "points", mqtt.points);
+    webui_json_add_uint(&writer, "busy", mqtt.busy);
+    webui_json_add_uint(&writer, "dropped", mqtt.dropped);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_KC868_MODBUS
+    KC868_A16_ModbusStatistics modbus;
+    KC868_A16_ModbusGetStatistics(&modbus);
+    webui_json_begin_object(&writer, "modbus");
+    webui_json_add_uint(&writer, "clients", modbus.clients);
+    webui_json_add_uint(&writer, "accepted", modbus.accepted);
+    webui_json_add_uint(&writer, "requests", modbus.requests);
+    webui_json_add_uint(&writer, "exceptions", modbus.exceptions);
+    webui_json_add_uint(&writer, "writes_refused", modbus.writes_refused);
+    webui_json_add_uint(&writer, "dropped", modbus.dropped);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_KC868_MODBUS_RTU
+    static KC868_A16_ModbusRtuSlaveStatistics slaves[KC868_A16_MODBUS_RTU_MAX_ENTRIES]; // httpd runs one request at a time
+    const size_t slave_count = KC868_A16_ModbusRtuGetStatistics(slaves);
+    webui_json_begin_object(&writer, "modbus_rtu");
+    webui_json_begin_array(&writer, "slaves");
+    for (size_t i = 0; i < slave_count; i++) {
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_uint(&writer, "unit", slaves[i].unit);
+        webui_json_add_bool(&writer, "online", slaves[i].online);
+        webui_json_add_uint(&writer, "requests", slaves[i].requests);
+        webui_json_add_uint(&writer, "responses", slaves[i].responses);
+        webui_json_add_uint(&writer, "exceptions", slaves[i].exceptions);
+        webui_json_add_uint(&writer, "timeouts", slaves[i].timeouts);
+        webui_json_add_uint(&writer, "crc_errors", slaves[i].crc_errors);
+        webui_json_add_uint(&writer, "cycle_ms", slaves[i].cycle_ms);
+        webui_json_add_uint(&writer, "cycle_max_ms", slaves[i].cycle_max_ms);
+        webui_json_add_uint(&writer, "timeout_ms", slaves[i].timeout_ms);
+        webui_json_add_uint(&writer, "backoff_ms", slaves[i].backoff_ms);
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+    webui_json_end_object(&writer);
+#endif
+
+#if defined(CONFIG_OPENER_CIP_ARENA)
+    CipArenaStatistics arena;
+    CipArenaGetStatistics(&arena);
+    webui_json_begin_object(&writer, "cip_memory");
+    webui_json_add_uint(&writer, "arena_size", arena.arena_size);
+    webui_json_add_uint(&writer, "arena_used", arena.arena_used);
+    webui_json_add_bool(&writer, "frozen", arena.frozen);
+    webui_json_add_uint(&writer, "pool_blocks", arena.pool_blocks);
+    webui_json_add_uint(&writer, "pool_in_use", arena.pool_in_use);
+    webui_json_add_uint(&writer, "pool_peak", arena.pool_peak);
+    webui_json_add_uint(&writer, "runtime_allocations", arena.runtime_allocations);
+    webui_json_add_uint(&writer, "heap_allocations", arena.heap_allocations);
+    webui_json_end_object(&writer);
+#endif
+
+    // Counters of CONFIG_LWIP_STATS; pbufs and pools come from the heap, so an
+    // allocation error is counted by the pool that asked for the memory
+    webui_json_begin_object(&writer, "lwip");
+    webui_json_add_bool(&writer, "stats", LWIP_STATS != 0);
+#if LWIP_STATS && MEM_STATS
+    webui_json_begin_object(&writer, "heap");
+    webui_json_add_uint(&writer, "used", lwip_stats.mem.used);
+    webui_json_add_uint(&writer, "max", lwip_stats.mem.max);
+    webui_json_add_uint(&writer, "err", lwip_stats.mem.err);
+    webui_json_end_object(&writer);
+#endif
+#if LWIP_STATS && MEMP_STATS
+    webui_json_begin_array(&writer, "pools");
+    for (size_t i = 0; i < MEMP_MAX; i++) {
+        const struct stats_mem *pool = lwip_stats.memp[i];
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_string(&writer, "name", pool->name);
+        webui_json_add_uint(&writer, "used", pool->used);
+        webui_json_add_uint(&writer, "max", pool->max);
+        webui_json_add_uint(&writer, "err", pool->err);
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+#endif
+#if LWIP_STATS && UDP_STATS
+    webui_json_add_uint(&writer, "udp_drop", lwip_stats.udp.drop);
+#endif
+    webui_json_end_object(&writer);
+
+    // Stack-level counters kept by the network handler; reading them here
+    // never clears them, that is left to the Ethernet Link GetAndClear service
+    static const char *const traffic_names[kNetworkTrafficClassCount] = {
+        "implicit_io", "explicit_tcp", "explicit_udp"
     };
-    ret = httpd_register_uri_handler(server, &post_ipconfig_uri);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to register POST /api/ipconfig: %s", esp_err_to_name(ret));
-    } else {
-        ESP_LOGI(TAG, "Registered POST /api/ipconfig handler");
+    static const char *const drop_names[kNetworkDropReasonCount] = {
+        "empty_datagram", "truncated", "oversized_frame", "io_queue_full",
+        "no_receive_buffer", "partial_send", "rate_limited"
+    };
+    NetworkInterfaceCounters counters;
+    NetworkGetInterfaceCounters(&counters);
+    webui_json_begin_object(&writer, "interface");
+    webui_json_add_uint64(&writer, "in_octets", counters.in_octets);
+    webui_json_add_uint64(&writer, "in_ucast", counters.in_ucast_packets);
+    webui_json_add_uint64(&writer, "in_nucast", counters.in_nucast_packets);
+    webui_json_add_uint64(&writer, "in_discards", counters.in_discards);
+    webui_json_add_uint64(&writer, "in_errors", counters.in_errors);
+    webui_json_add_uint64(&writer, "out_octets", counters.out_octets);
+    webui_json_add_uint64(&writer, "out_ucast", counters.out_ucast_packets);
+    webui_json_add_uint64(&writer, "out_nucast", counters.out_nucast_packets);
+    webui_json_add_uint64(&writer, "out_discards", counters.out_discards);
+    webui_json_add_uint64(&writer, "out_errors", counters.out_errors);
+    for (size_t i = 0; i < kNetworkTrafficClassCount; i++) {
+        const NetworkTrafficCounters *traffic = &counters.traffic[i];
+        webui_json_begin_object(&writer, traffic_names[i]);
+        webui_json_add_uint64(&writer, "in_octets", traffic->in_octets);
+        webui_json_add_uint64(&writer, "in_ucast", traffic->in_ucast_packets);
+        webui_json_add_uint64(&writer, "in_nucast", traffic->in_nucast_packets);
+        webui_json_add_uint64(&writer, "in_errors", traffic->in_errors);
+        webui_json_add_uint64(&writer, "out_octets", traffic->out_octets);
+        webui_json_add_uint64(&writer, "out_ucast", traffic->out_ucast_packets);
+        webui_json_add_uint64(&writer, "out_nucast", traffic->out_nucast_packets);
+        webui_json_add_uint64(&writer, "out_errors", traffic->out_errors);
+        webui_json_end_object(&writer);
+    }
+    webui_json_begin_object(&writer, "dropped");
+    for (size_t i = 0; i < kNetworkDropReasonCount; i++) {
+        webui_json_add_uint64(&writer, drop_names[i], counters.dropped[i]);
+    }
+    webui_json_end_object(&writer);
+    webui_json_end_object(&writer);
+
+    // Time the OpENer task slept in select(), idle waits only happen with
+    // CONFIG_OPENER_TICKLESS_IDLE while no connection is open
+    NetworkIdleStatistics idle;
+    NetworkGetIdleStatistics(&idle);
+    webui_json_begin_object(&writer, "loop_wait");
+    webui_json_add_uint64(&writer, "tick_waits", idle.tick_waits);
+    webui_json_add_uint64(&writer, "tick_wait_ms", idle.tick_wait_time_ms);
+    webui_json_add_uint64(&writer, "idle_waits", idle.idle_waits);
+    webui_json_add_uint64(&writer, "idle_wait_ms", idle.idle_wait_time_ms);
+    webui_json_end_object(&writer);
+
+    // Wrappers of received frames handed to lwIP, heap_allocated frames found
+    // the pool of CONFIG_OPENER_ETH_RX_PBUF_POOL empty
+    esp_pbuf_stats_t rx_pbufs;
+    esp_pbuf_get_stats(&rx_pbufs);
+    webui_json_begin_object(&writer, "rx_pbufs");
+    webui_json_add_uint(&writer, "pool_size", rx_pbufs.pool_size);
+    webui_json_add_uint(&writer, "pool_free", rx_pbufs.pool_free);
+    webui_json_add_uint(&writer, "pool_free_min", rx_pbufs.pool_free_min);
+    webui_json_add_uint(&writer, "pooled", rx_pbufs.pooled);
+    webui_json_add_uint(&writer, "heap_allocated", rx_pbufs.allocated);
+    webui_json_end_object(&writer);
+
+#if CONFIG_OPENER_ETH_MEDIA_COUNTERS
+    // Receive errors of the EMAC and the PHY; frames without a DMA buffer are
+    // in interface.dropped.no_receive_buffer
+    EthMediaCounters media;
+    EthMediaCountersGet(&media);
+    webui_json_begin_object(&writer, "media");
+    webui_json_add_uint(&writer, "symbol_errors", media.symbol_errors);
+    webui_json_add_uint(&writer, "fifo_overflows", media.fifo_overflows);
+    webui_json_add_uint(&writer, "mdio_errors", media.mdio_errors);
+    webui_json_add_uint(&writer, "overrun_samples", media.overrun_samples);
+    webui_json_add_uint(&writer, "overrun_peak", media.overrun_peak);
+    webui_json_add_uint(&writer, "sample_period_ms", CONFIG_OPENER_ETH_MEDIA_COUNTERS_PERIOD_MS);
+    webui_json_begin_object(&writer, "dma");
+    webui_json_add_uint(&writer, "buffer_size", CONFIG_ETH_DMA_BUFFER_SIZE);
+    webui_json_add_uint(&writer, "rx_buffers", CONFIG_ETH_DMA_RX_BUFFER_NUM);
+    webui_json_add_uint(&writer, "tx_buffers", CONFIG_ETH_DMA_TX_BUFFER_NUM);
+    webui_json_end_object(&writer);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_OPENER_ETH_RX_MODERATION
+    // Receive interrupt moderation; frame_rate is only measured in the
+    // adaptive mode
+    EthRxModerationStatistics moderation;
+    EthRxModerationGetStatistics(&moderation);
+    webui_json_begin_object(&writer, "rx_moderation");
+    webui_json_add_bool(&writer, "active", moderation.active);
+    webui_json_add_uint(&writer, "frames", CONFIG_OPENER_ETH_RX_MODERATION_FRAMES);
+    webui_json_add_uint(&writer, "timeout_us", CONFIG_OPENER_ETH_RX_MODERATION_TIMEOUT_US);
+    webui_json_add_uint(&writer, "watchdog_units", moderation.watchdog_units);
+    webui_json_add_uint(&writer, "frame_rate", moderation.frame_rate);
+    webui_json_add_uint(&writer, "activations", moderation.activations);
+    webui_json_end_object(&writer);
+#endif
+
+#if CONFIG_OPENER_MULTICAST_FILTER
+    // Multicast groups in the EMAC filter; dropped_frames only counts what
+    // reached software while the filter was full
+    MulticastFilterStatistics multicast;
+    MulticastFilterGetStatistics(&multicast);
+    webui_json_begin_object(&writer, "multicast_filter");
+    webui_json_add_uint(&writer, "groups", multicast.groups);
+    webui_json_add_uint(&writer, "filtered_groups", multicast.filtered_groups);
+    webui_json_add_uint(&writer, "filter_full", multicast.filter_full);
+    webui_json_add_bool(&writer, "pass_all_multicast", multicast.pass_all_multicast);
+    webui_json_add_uint(&writer, "dropped_frames", multicast.dropped_frames);
+    webui_json_end_object(&writer);
+#endif
+
+    return webui_json_end(&writer);
+}
+
+// Reads the scanned inputs and the relay image without blocking the stack,
+// retrying like get_tcpip_snapshot() while a writer is mid-update
+static bool get_io_snapshot(EipUint8 *inputs, EipUint8 *outputs)
+{
+    // The relays lead the output assembly, a schedule time may follow them
+    EipUint8 assembly[KC868_A16_OUTPUT_ASSEMBLY_SIZE];
+    for (int attempt = 0; attempt < TCPIP_SNAPSHOT_ATTEMPTS; attempt++) {
+        if (KC868_A16_IoGetInputImage(inputs) &&
+            GetAssemblyDataSnapshot(IO_OUTPUT_ASSEMBLY, assembly, sizeof(assembly),
+                                    NULL, NULL) == kEipStatusOk) {
+            memcpy(outputs, assembly, KC868_A16_OUTPUT_IMAGE_SIZE);
+            return true;
+        }
+        vTaskDelay(1);
+    }
+    return false;
+}
+
+// Helper function to read an optional 16 bit mask from a JSON request
+static bool get_mask_item(const cJSON *json, const char *name, uint16_t *mask)
+{
+    const cJSON *item = cJSON_GetObjectItem(json, name);
+    if (item == NULL) {
+        *mask = 0;
+        return true;
+    }
+    if (!cJSON_IsNumber(item)) {
+        return false;
+    }
+    double value = cJSON_GetNumberValue(item);
+    if (value < 0 || value > UINT16_MAX || value != (double)(uint16_t)value) {
+        return false;
+    }
+    *mask = (uint16_t)value;
+    return true;
+}
+
+// Integer member of a request, fallback if it is missing
+static bool get_uint_item(const cJSON *json, const char *name, uint32_t fallback,
+                          uint32_t max, uint32_t *value)
+{
+    const cJSON *item = cJSON_GetObjectItem(json, name);
+    if (item == NULL) {
+        *value = fallback;
+        return true;
+    }
+    if (!cJSON_IsNumber(item)) {
+        return false;
+    }
+    double number = cJSON_GetNumberValue(item);
+    if (number < 0 || number > max || number != (double)(uint32_t)number) {
+        return false;
+    }
+    *value = (uint32_t)number;
+    return true;
+}
+
+// GET /api/io - Get all digital inputs, relay outputs and analog inputs
+static esp_err_t api_get_io_handler(httpd_req_t *req)
+{
+    EipUint8 inputs[KC868_A16_INPUT_IMAGE_SIZE];
+    EipUint8 outputs[KC868_A16_OUTPUT_IMAGE_SIZE];
+    if (!get_io_snapshot(inputs, outputs)) {
+        return send_json_error(req, "Timeout reading the I/O images", 500);
+    }
+
+    // Walks the connection list, so hold the stack lock like the stack tasks do
+    ProductionSchedulerLock();
+    bool owned = KC868_A16_ApplicationOutputsOwned();
+    ProductionSchedulerUnlock();
+
+    // Bit 0 is channel 1
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_uint(&writer, "inputs", inputs[0] | (inputs[1] << 8));
+    webui_json_add_uint(&writer, "outputs", outputs[0] | (outputs[1] << 8));
+    webui_json_add_bool(&writer, "outputs_owned", owned);
+    webui_json_begin_array(&writer, "analog");
+    for (size_t i = 0; i < KC868_A16_ANALOG_INPUT_COUNT; i++) {
+        size_t offset = KC868_A16_INPUT_ANALOG_START_OFFSET + i * KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL;
+        webui_json_add_uint(&writer, NULL, inputs[offset] | (inputs[offset + 1] << 8));
+    }
+    webui_json_end_array(&writer);
+
+    // Expanders in KC868_A16_Expander order, the counters are 0 if the scan
+    // task was publishing them
+    KC868_A16_IoBusStatistics bus = {0};
+    (void)KC868_A16_IoGetBusStatistics(&bus);
+    const CipUsint status = KC868_A16_IoGetStatus();
+    static const char *const expander_names[kKc868ExpanderCount] = {
+        "Y01-Y08", "Y09-Y16", "X01-X08", "X09-X16",
+    };
+    webui_json_begin_array(&writer, "expanders");
+    for (size_t i = 0; i < kKc868ExpanderCount; i++) {
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_string(&writer, "name", expander_names[i]);
+        webui_json_add_bool(&writer, "failed", (status & (1u << i)) != 0);
+        webui_json_add_uint(&writer, "errors", bus.expander[i].errors);
+        webui_json_add_uint(&writer, "retries", bus.expander[i].retries);
+        if (i < KC868_A16_OUTPUT_IMAGE_SIZE) {
+            webui_json_add_bool(&writer, "mismatch",
+                                (status & (KC868_A16_IO_OUTPUTS_1_8_MISMATCH << i)) != 0);
+            webui_json_add_uint(&writer, "mismatches", bus.expander[i].mismatches);
+        }
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+    webui_json_add_uint(&writer, "bus_recoveries", bus.bus_recoveries);
+
+    // Scan groups in KC868_A16_ScanGroup order, as published by the
+    // diagnostics group
+    KC868_A16_ScanScheduleStatistics schedule = {0};
+    (void)KC868_A16_ScanScheduleGetStatistics(&schedule);
+    static const char *const group_names[kKc868ScanGroupCount] = {
+        "digital", "expansion", "analog", "diagnostics",
+    };
+    webui_json_begin_array(&writer, "scan_groups");
+    for (size_t i = 0; i < kKc868ScanGroupCount; i++) {
+        const KC868_A16_ScanGroupStatistics *group = &schedule.group[i];
+        if (group->period_us == 0) {
+            continue;
+        }
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_string(&writer, "name", group_names[i]);
+        webui_json_add_uint(&writer, "period_us", group->period_us);
+        webui_json_add_uint(&writer, "achieved_rate_hz", group->achieved_rate_hz);
+        webui_json_add_uint(&writer, "runs", group->runs);
+        webui_json_add_uint(&writer, "overruns", group->overruns);
+        webui_json_add_uint(&writer, "deferrals", group->deferrals);
+        webui_json_add_uint(&writer, "run_time_us", group->run_time_us);
+        webui_json_add_uint(&writer, "max_run_time_us", group->max_run_time_us);
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+    webui_json_add_uint(&writer, "scan_passes", schedule.passes);
+    webui_json_add_uint(&writer, "scan_pass_overruns", schedule.pass_overruns);
+#if CONFIG_KC868_SCHEDULED_OUTPUTS
+    // Output images with an Apply At time, lateness of the last one applied
+    KC868_A16_ScheduledOutputStatistics scheduled = {0};
+    (void)KC868_A16_IoGetScheduledOutputStatistics(&scheduled);
+    webui_json_begin_object(&writer, "scheduled_outputs");
+    webui_json_add_uint(&writer, "scheduled", scheduled.scheduled);
+    webui_json_add_uint(&writer, "applied", scheduled.applied);
+    webui_json_add_uint(&writer, "replaced", scheduled.replaced);
+    webui_json_add_uint(&writer, "cancelled", scheduled.cancelled);
+    webui_json_add_uint(&writer, "late", scheduled.late);
+    webui_json_add_uint(&writer, "out_of_range", scheduled.out_of_range);
+    webui_json_add_uint(&writer, "last_lateness_us", scheduled.last_lateness_us);
+    webui_json_add_uint(&writer, "max_lateness_us", scheduled.max_lateness_us);
+    webui_json_end_object(&writer);
+#endif
+#if CONFIG_KC868_EXPANSION
+    // Registered at boot, failed while the bit in the expansion status is set
+    const KC868_A16_ExpansionDevice *devices = NULL;
+    const size_t device_count = KC868_A16_ExpansionGetDevices(&devices);
+    uint8_t expansion[KC868_A16_EXPANSION_STATUS_SIZE + KC868_A16_EXPANSION_MAX_IMAGE_BYTES] = {0};
+    (void)KC868_A16_ExpansionGetInputImage(expansion);
+    const uint32_t failed = expansion[0] | (expansion[1] << 8);
+    webui_json_begin_array(&writer, "expansion");
+    for (size_t i = 0; i < device_count; i++) {
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_uint(&writer, "i2c_address", devices[i].i2c_address);
+        webui_json_add_uint(&writer, "device_type", devices[i].device_type);
+        webui_json_add_uint(&writer, "pin_directions", devices[i].pin_directions);
+        webui_json_add_uint(&writer, "input_byte_start", devices[i].input_byte_start);
+        webui_json_add_uint(&writer, "output_byte_start", devices[i].output_byte_start);
+        webui_json_add_uint(&writer, "update_rate_ms", devices[i].update_rate_ms);
+        webui_json_add_bool(&writer, "detected", devices[i].detected);
+        webui_json_add_bool(&writer, "failed", (failed & (1u << i)) != 0);
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+#endif
+    return webui_json_end(&writer);
+}
+
+// Raw bytes of an assembly in the shape GET /api/assemblies uses, empty if
+// no consistent snapshot could be taken
+static void add_assembly_bytes(webui_json_writer_t *writer, const char *key, EipUint16 instance)
+{
+    static uint8_t data[STATUS_MAX_ASSEMBLY_SIZE];
+    size_t length = 0;
+    for (int attempt = 0; attempt < TCPIP_SNAPSHOT_ATTEMPTS; attempt++) {
+        if (GetAssemblyDataSnapshot(instance, data, sizeof(data), &length, NULL) == kEipStatusOk) {
+            break;
+        }
+        length = 0;
+        vTaskDelay(1);
+    }
+
+    webui_json_begin_object(writer, key);
+    webui_json_add_uint(writer, "instance", instance);
+    webui_json_add_uint(writer, "size", (uint32_t)length);
+    webui_json_begin_array(writer, "raw_bytes");
+    for (size_t i = 0; i < length; i++) {
+        webui_json_add_uint(writer, NULL, data[i]);
+    }
+    webui_json_end_array(writer);
+    webui_json_end_object(writer);
+}
+
+// GET /api/status - Everything a dashboard shows in one response, so a client
+// watching many devices needs a single request per device and refresh
+static esp_err_t api_get_status_handler(httpd_req_t *req)
+{
+    EipUint8 inputs[KC868_A16_INPUT_IMAGE_SIZE];
+    EipUint8 outputs[KC868_A16_OUTPUT_IMAGE_SIZE];
+    bool have_io = get_io_snapshot(inputs, outputs);
+
+    ProductionSchedulerLock();
+    bool owned = KC868_A16_ApplicationOutputsOwned();
+    ProductionSchedulerUnlock();
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_uint(&writer, "uptime_s", (uint32_t)(esp_timer_get_time() / 1000000));
+
+    // Set up before the stack starts, only status and state change later
+    char product_name[CIP_IDENTITY_MAX_PRODUCT_NAME_LENGTH + 1];
+    size_t name_length = g_identity.product_name.header.length;
+    if (name_length > CIP_IDENTITY_MAX_PRODUCT_NAME_LENGTH) {
+        name_length = CIP_IDENTITY_MAX_PRODUCT_NAME_LENGTH;
+    }
+    memcpy(product_name, g_identity.product_name.string, name_length);
+    product_name[name_length] = '\0';
+    char serial[9];
+    snprintf(serial, sizeof(serial), "%08" PRIX32, (uint32_t)g_identity.serial_number);
+    webui_json_begin_object(&writer, "identity");
+    webui_json_add_uint(&writer, "vendor_id", g_identity.vendor_id);
+    webui_json_add_uint(&writer, "device_type", g_identity.device_type);
+    webui_json_add_uint(&writer, "product_code", g_identity.product_code);
+    webui_json_add_uint(&writer, "major_revision", g_identity.revision.major_revision);
+    webui_json_add_uint(&writer, "minor_revision", g_identity.revision.minor_revision);
+    webui_json_add_string(&writer, "serial_number", serial);
+    webui_json_add_string(&writer, "product_name", product_name);
+    webui_json_add_uint(&writer, "status", g_identity.status);
+    webui_json_add_uint(&writer, "state", g_identity.state);
+    webui_json_end_object(&writer);
+
+    NetifStatus netif_status;
+    if (NetifStatusGet(&netif_status)) {
+        char ip_str[16];
+        webui_json_begin_object(&writer, "network");
+        ip_uint32_to_string(netif_status.ip_address, ip_str, sizeof(ip_str));
+        webui_json_add_string(&writer, "ip_address", ip_str);
+        webui_json_add_string(&writer, "hostname", netif_status.hostname);
+        webui_json_add_bool(&writer, "link_up", netif_status.link_up);
+        webui_json_add_uint(&writer, "link_speed", netif_status.link_speed);
+        webui_json_add_bool(&writer, "full_duplex", netif_status.full_duplex);
+        webui_json_end_object(&writer);
+    }
+
+    // Same meaning as GET /api/io, left out if the images could not be read
+    if (have_io) {
+        webui_json_begin_object(&writer, "io");
+        webui_json_add_uint(&writer, "inputs", inputs[0] | (inputs[1] << 8));
+        webui_json_add_uint(&writer, "outputs", outputs[0] | (outputs[1] << 8));
+        webui_json_add_bool(&writer, "outputs_owned", owned);
+        webui_json_begin_array(&writer, "analog");
+        for (size_t i = 0; i < KC868_A16_ANALOG_INPUT_COUNT; i++) {
+            size_t offset = KC868_A16_INPUT_ANALOG_START_OFFSET + i * KC868_A16_ANALOG_INPUT_BYTES_PER_CHANNEL;
+            webui_json_add_uint(&writer, NULL, inputs[offset] | (inputs[offset + 1] << 8));
+        }
+        webui_json_end_array(&writer);
+        webui_json_add_uint(&writer, "failed_expanders", KC868_A16_IoGetStatus() & 0x0F);
+        webui_json_end_object(&writer);
+    }
+
+    // Totals over the open I/O connections, details are in /api/diagnostics/connections
+    uint32_t active = 0;
+    uint32_t late = 0;
+    uint32_t missed = 0;
+    CipConnectionDiagnostics diagnostics;
+    for (size_t i = 0; CipConnectionDiagnosticsGet(i, &diagnostics); i++) {
+        if (diagnostics.connection_id == 0) {
+            continue;
+        }
+        active++;
+        late += diagnostics.produced.late_packets + diagnostics.consumed.late_packets;
+        missed += diagnostics.produced.missed_packets + diagnostics.consumed.missed_packets;
+    }
+    webui_json_begin_object(&writer, "connections");
+    webui_json_add_uint(&writer, "active", active);
+    webui_json_add_uint(&writer, "late_packets", late);
+    webui_json_add_uint(&writer, "missed_packets", missed);
+    webui_json_end_object(&writer);
+
+    webui_json_begin_object(&writer, "heap");
+    webui_json_add_uint(&writer, "free", (uint32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    webui_json_add_uint(&writer, "min_free", (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    webui_json_end_object(&writer);
+
+    add_assembly_bytes(&writer, "input_assembly_100", IO_INPUT_ASSEMBLY);
+    add_assembly_bytes(&writer, "output_assembly_150", IO_OUTPUT_ASSEMBLY);
+    return webui_json_end(&writer);
+}
+
+// POST /api/io/outputs - Set and clear relays in one read-modify-write
+static esp_err_t api_post_io_outputs_handler(httpd_req_t *req)
+{
+    char content[128];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+
+    cJSON *json = cJSON_Parse(content);
+    if (json == NULL) {
+        return send_json_error(req, "Invalid JSON", 400);
+    }
+    uint16_t set_mask = 0;
+    uint16_t clear_mask = 0;
+    bool valid = get_mask_item(json, "set", &set_mask) && get_mask_item(json, "clear", &clear_mask);
+    cJSON_Delete(json);
+    if (!valid) {
+        return send_json_error(req, "set and clear must be integers from 0 to 65535", 400);
+    }
+    if ((set_mask & clear_mask) != 0) {
+        return send_json_error(req, "set and clear overlap", 400);
+    }
+
+    // The ownership check and the update are one step under the stack lock,
+    // so a connection cannot be opened in between
+    EipUint16 outputs = 0;
+    ProductionSchedulerLock();
+    EipStatus status = KC868_A16_ApplicationUpdateOutputs(set_mask, clear_mask, &outputs);
+    ProductionSchedulerUnlock();
+    if (status != kEipStatusOk) {
+        return send_json_error(req, "Outputs are owned by an I/O connection", 409);
+    }
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_string(&writer, "status", "ok");
+    webui_json_add_uint(&writer, "outputs", outputs);
+    return webui_json_end(&writer);
+}
+
+#if defined(CONFIG_KC868_RELAY_COUNTERS)
+// GET /api/relays/counters - Get the closings of each relay
+static esp_err_t api_get_relay_counters_handler(httpd_req_t *req)
+{
+    uint32_t counts[KC868_A16_OUTPUT_COUNT];
+    uint32_t unsaved = KC868_A16_RelayCountGet(counts);
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_begin_array(&writer, "counts");
+    for (size_t i = 0; i < KC868_A16_OUTPUT_COUNT; i++) {
+        webui_json_add_uint(&writer, NULL, counts[i]);
+    }
+    webui_json_end_array(&writer);
+    webui_json_add_uint(&writer, "unsaved", unsaved);
+    webui_json_add_uint(&writer, "flush_interval_min", CONFIG_KC868_RELAY_COUNTER_FLUSH_MIN);
+    return webui_json_end(&writer);
+}
+
+// POST /api/relays/counters/reset - Start the counts of replaced relays over
+static esp_err_t api_post_relay_counters_reset_handler(httpd_req_t *req)
+{
+    char content[64];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+
+    cJSON *json = cJSON_Parse(content);
+    if (json == NULL) {
+        return send_json_error(req, "Invalid JSON", 400);
+    }
+    uint16_t relays = 0;
+    bool valid = get_mask_item(json, "relays", &relays);
+    cJSON_Delete(json);
+    if (!valid || relays == 0) {
+        return send_json_error(req, "relays must be an integer from 1 to 65535", 400);
+    }
+    KC868_A16_RelayCountReset(relays);
+    return send_json_status(req, "Counts reset.");
+}
+#endif
+
+#if defined(CONFIG_OPENER_TRACE_BUFFER)
+// GET /api/trace - Download the recorded OpENer traces as text
+static esp_err_t api_get_trace_handler(httpd_req_t *req)
+{
+    static char chunk[1024]; // httpd runs one request at a time
+    TraceBufferCursor cursor;
+    size_t length;
+
+    httpd_resp_set_type(req, "text/plain");
+    TraceBufferCursorInit(&cursor, true);
+    while ((length = TraceBufferRead(&cursor, chunk, sizeof(chunk))) != 0) {
+        if (httpd_resp_send_chunk(req, chunk, length) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    if (cursor.lost != 0) {
+        // Entries overwritten by new traces while the download was running
+        length = snprintf(chunk, sizeof(chunk), "# %lu entries lost\n", (unsigned long)cursor.lost);
+        httpd_resp_send_chunk(req, chunk, length);
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+#endif
+
+#if defined(CONFIG_OPENER_LOG_BUFFER)
+// Log text returned by one GET /api/logs unless ?max= asks for less
+#define LOGS_API_MAX_BYTES 8192
+
+// GET /api/logs?cursor=N&max=M - Read the buffered log messages after a cursor
+static esp_err_t api_get_logs_handler(httpd_req_t *req)
+{
+    static char chunk[1024]; // httpd runs one request at a time
+    LogBufferCursor cursor;
+    uint32_t max_bytes = LOGS_API_MAX_BYTES;
+    char query[64];
+    char value[12];
+
+    // Without a cursor the download starts at the oldest message still held
+    LogBufferCursorInit(&cursor, true);
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "cursor", value, sizeof(value)) == ESP_OK) {
+            LogBufferCursorSet(&cursor, (uint32_t)strtoul(value, NULL, 10));
+        }
+        if (httpd_query_key_value(query, "max", value, sizeof(value)) == ESP_OK) {
+            uint32_t requested = (uint32_t)strtoul(value, NULL, 10);
+            if (requested < max_bytes) {
+                max_bytes = requested;
+            }
+        }
+    }
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_string(&writer, "status", "ok");
+    webui_json_begin_string(&writer, "logs");
+    size_t size = 0;
+    bool truncated = false;
+    for (;;) {
+        size_t space = max_bytes - size;
+        if (space > sizeof(chunk) - 1) {
+            space = sizeof(chunk) - 1;
+        }
+        if (space < LogBufferEntryTextSize()) {
+            truncated = true; // more may be waiting, the client asks again with next
+            break;
+        }
+        size_t length = LogBufferRead(&cursor, chunk, space + 1);
+        if (length == 0) {
+            break;
+        }
+        webui_json_append_string(&writer, chunk, length);
+        size += length;
+    }
+    webui_json_end_string(&writer);
+    webui_json_add_uint(&writer, "size", (uint32_t)size);
+    webui_json_add_uint(&writer, "total_size", (uint32_t)LogBufferCapacity());
+    webui_json_add_bool(&writer, "truncated", truncated);
+    webui_json_add_uint(&writer, "next", cursor.next);
+    webui_json_add_uint(&writer, "lost", cursor.lost);
+    return webui_json_end(&writer);
+}
+#endif
+
+#if defined(CONFIG_OPENER_LOOP_PROFILE)
+// GET /api/perf - Get the OpENer loop phase timing statistics
+static esp_err_t api_get_perf_handler(httpd_req_t *req)
+{
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_begin_array(&writer, "phases");
+
+    for (size_t i = 0; i < kLoopProfileNumberOfPhases; i++) {
+        LoopProfileSummary summary;
+        LoopProfileGetSummary((LoopProfilePhase)i, &summary);
+
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_string(&writer, "name", LoopProfileGetPhaseName((LoopProfilePhase)i));
+        webui_json_add_uint(&writer, "samples", summary.samples);
+        webui_json_add_uint(&writer, "overruns", summary.overruns);
+        webui_json_add_uint(&writer, "min_us", summary.minimum);
+        webui_json_add_uint(&writer, "avg_us", summary.average);
+        webui_json_add_uint(&writer, "max_us", summary.maximum);
+        webui_json_add_uint(&writer, "p99_us", summary.percentile_99);
+        webui_json_end_object(&writer);
+    }
+
+    webui_json_end_array(&writer);
+    return webui_json_end(&writer);
+}
+
+// POST /api/perf/reset - Clear the loop phase timing statistics
+static esp_err_t api_post_perf_reset_handler(httpd_req_t *req)
+{
+    LoopProfileReset();
+
+    return send_json_status(req, "Loop profile statistics cleared.");
+}
+#endif
+
+#if defined(CONFIG_OPENER_WCET_PROFILE)
+// GET /api/wcet - Get the longest calls of the CIP services, callbacks and web handlers
+static esp_err_t api_get_wcet_handler(httpd_req_t *req)
+{
+    static const char *const kind_names[] = { "service", "callback", "web" };
+    static WcetProfileEntry entries[OPENER_WCET_PROFILE_ENTRIES]; // httpd runs one request at a time
+    char query[32];
+    char value[4];
+    bool reset = false;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "reset", value, sizeof(value)) == ESP_OK) {
+        reset = (strcmp(value, "1") == 0);
+    }
+    const size_t count = WcetProfileGetEntries(0, entries, OPENER_WCET_PROFILE_ENTRIES, reset);
+    const uint32_t cycles_per_us = WcetProfileGetCyclesPerMicroSecond();
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_uint(&writer, "cycles_per_us", cycles_per_us);
+    webui_json_add_uint(&writer, "dropped", WcetProfileGetDropped());
+    webui_json_begin_array(&writer, "entries");
+    for (size_t i = 0; i < count; i++) {
+        const WcetProfileEntry *entry = &entries[i];
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_string(&writer, "kind", entry->kind < 3 ? kind_names[entry->kind] : "");
+        webui_json_add_string(&writer, "name", entry->name != NULL ? entry->name : "");
+        webui_json_add_uint(&writer, "class", entry->class_id);
+        webui_json_add_uint(&writer, "code", entry->code);
+        webui_json_add_uint(&writer, "calls", entry->calls);
+        webui_json_add_uint(&writer, "max_cycles", entry->maximum);
+        webui_json_add_uint(&writer, "max_us", cycles_per_us != 0 ? entry->maximum / cycles_per_us : 0);
+        webui_json_add_uint(&writer, "instance", entry->instance);
+        webui_json_add_uint(&writer, "attribute", entry->attribute);
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+    return webui_json_end(&writer);
+}
+#endif
+
+#if defined(CONFIG_OPENER_TASK_TELEMETRY)
+// GET /api/system - Get the task stack high water marks and heap statistics
+static esp_err_t api_get_system_handler(httpd_req_t *req)
+{
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_uint(&writer, "uptime_s", (uint32_t)(esp_timer_get_time() / 1000000));
+
+    webui_json_begin_array(&writer, "tasks");
+    for (size_t i = 0; i < kTaskTelemetryNumberOfTasks; i++) {
+        TaskTelemetryStack stack;
+        TaskTelemetryGetStack((TaskTelemetryTask)i, &stack);
+        if (stack.stack_size == 0) {
+            continue; // never created, e.g. no deferred NVS write yet
+        }
+
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_string(&writer, "name", TaskTelemetryGetTaskName((TaskTelemetryTask)i));
+        webui_json_add_bool(&writer, "running", stack.running);
+        webui_json_add_uint(&writer, "stack_size", stack.stack_size);
+        webui_json_add_uint(&writer, "min_free", stack.minimum_free);
+        webui_json_add_uint(&writer, "recommended", stack.recommended);
+#if defined(CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD)
+        TaskTelemetryLoad load;
+        TaskTelemetryGetTaskLoad((TaskTelemetryTask)i, &load);
+        const BaseType_t core = TaskTelemetryGetTaskCore((TaskTelemetryTask)i);
+        webui_json_add_int(&writer, "core", core == tskNO_AFFINITY ? -1 : (int32_t)core);
+        webui_json_add_uint(&writer, "cpu_permille", load.last);
+        webui_json_add_uint(&writer, "cpu_avg_permille", load.average);
+        webui_json_add_uint(&writer, "cpu_peak_permille", load.peak);
+#endif
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+
+#if defined(CONFIG_OPENER_TASK_TELEMETRY_CPU_LOAD)
+    // Busy time per core over the sliding window, in per mille
+    webui_json_begin_object(&writer, "cpu");
+    webui_json_add_uint(&writer, "window_ms",
+                        TaskTelemetryGetCpuWindowSamples() * CONFIG_OPENER_TASK_TELEMETRY_PERIOD_MS);
+    webui_json_begin_array(&writer, "cores");
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++) {
+        TaskTelemetryCore load;
+        TaskTelemetryGetCore(core, &load);
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_uint(&writer, "core", (uint32_t)core);
+        webui_json_add_uint(&writer, "busy_permille", load.busy.last);
+        webui_json_add_uint(&writer, "busy_avg_permille", load.busy.average);
+        webui_json_add_uint(&writer, "busy_peak_permille", load.busy.peak);
+        webui_json_add_uint(&writer, "task_switches_per_s", load.task_switches_per_s);
+        webui_json_add_uint(&writer, "task_switches", load.task_switches);
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+    webui_json_end_object(&writer);
+#endif
+
+    // Application scheduler jobs, times in microseconds
+    webui_json_begin_array(&writer, "jobs");
+    for (size_t i = 0; i < AppSchedulerGetNumberOfJobs(); i++) {
+        AppSchedulerJobStatistics job;
+        if (AppSchedulerGetJobStatistics(i, &job) != kEipStatusOk) {
+            continue;
+        }
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_string(&writer, "name", job.name);
+        webui_json_add_uint(&writer, "period_ms", job.period_ms);
+        webui_json_add_uint(&writer, "runs", job.runs);
+        webui_json_add_uint(&writer, "overruns", job.overruns);
+        webui_json_add_uint(&writer, "max_latency_us", job.maximum_latency);
+        webui_json_add_uint(&writer, "max_run_time_us", job.maximum_run_time);
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+
+    TaskTelemetryHeap heap;
+    TaskTelemetryGetHeap(&heap);
+    webui_json_begin_object(&writer, "heap");
+    webui_json_add_uint(&writer, "free", heap.free);
+    webui_json_add_uint(&writer, "min_free", heap.minimum_free);
+    webui_json_add_uint(&writer, "largest_free_block", heap.largest_free_block);
+    webui_json_add_uint(&writer, "fragmentation_percent", heap.fragmentation);
+    webui_json_end_object(&writer);
+
+    webui_json_begin_array(&writer, "heap_classes");
+    for (size_t i = 0; i < HEAP_CLASS_COUNT; i++) {
+        heap_class_stats_t stats;
+        heap_class_get_stats((heap_class_t)i, &stats);
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_string(&writer, "name", heap_class_name((heap_class_t)i));
+        webui_json_add_uint(&writer, "in_use", stats.in_use);
+        webui_json_add_uint(&writer, "peak", stats.peak);
+        webui_json_add_uint(&writer, "external", stats.external);
+        webui_json_add_uint(&writer, "allocations", stats.allocations);
+        webui_json_add_uint(&writer, "failures", stats.failures);
+        webui_json_add_uint(&writer, "refused", stats.refused);
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+
+    return webui_json_end(&writer);
+}
+#endif
+
+#if defined(CONFIG_KC868_SOE_BUFFER)
+// Events returned by one GET /api/soe unless ?max= asks for fewer
+#define SOE_API_MAX_EVENTS 256
+#define SOE_API_BATCH 32
+
+// Value of a numeric query parameter, fallback if it is missing
+static uint32_t get_query_uint(httpd_req_t *req, const char *key, uint32_t fallback)
+{
+    char query[64];
+    char value[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) {
+        return fallback;
+    }
+    return (uint32_t)strtoul(value, NULL, 10);
+}
+
+// GET /api/soe?next=N&max=M - Read the recorded digital input transitions
+static esp_err_t api_get_soe_handler(httpd_req_t *req)
+{
+    static KC868_A16_SoeEvent events[SOE_API_BATCH]; // httpd runs one request at a time
+    uint32_t next = get_query_uint(req, "next", 0);
+    uint32_t remaining = get_query_uint(req, "max", SOE_API_MAX_EVENTS);
+    if (remaining > SOE_API_MAX_EVENTS) {
+        remaining = SOE_API_MAX_EVENTS;
+    }
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_begin_array(&writer, "events");
+    uint32_t lost_total = 0;
+    size_t count;
+    do {
+        uint32_t lost = 0;
+        size_t batch = remaining < SOE_API_BATCH ? remaining : SOE_API_BATCH;
+        count = KC868_A16_SoeRead(&next, events, batch, &lost);
+        lost_total += lost;
+        for (size_t i = 0; i < count; i++) {
+            webui_json_begin_object(&writer, NULL);
+            webui_json_add_uint(&writer, "seq", (uint32_t)(next - count + i));
+            webui_json_add_uint64(&writer, "time_us", events[i].time_us);
+            webui_json_add_uint(&writer, "inputs", events[i].inputs);
+            webui_json_add_uint(&writer, "changed", events[i].changed);
+            webui_json_end_object(&writer);
+        }
+        remaining -= (uint32_t)count;
+    } while (count == SOE_API_BATCH && remaining != 0);
+    webui_json_end_array(&writer);
+
+    webui_json_add_uint(&writer, "next", next);
+    webui_json_add_uint(&writer, "lost", lost_total);
+    return webui_json_end(&writer);
+}
+#endif
+
+#if defined(CONFIG_KC868_HISTORY)
+// GET /api/history?format=csv|bin - Download the recorded I/O history
+static esp_err_t api_get_history_handler(httpd_req_t *req)
+{
+    // On the stack, downloads run in the async workers, several at a time
+    KC868_A16_HistoryCursor cursor;
+    uint8_t chunk[1024];
+    char query[32];
+    char format[8] = "csv";
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char value[sizeof(format)];
+        if (httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+            strcpy(format, value);
+        }
+    }
+    bool binary = strcmp(format, "bin") == 0;
+    if (!binary && strcmp(format, "csv") != 0) {
+        return send_json_error(req, "format must be csv or bin", 400);
+    }
+
+    httpd_resp_set_type(req, binary ? "application/octet-stream" : "text/csv");
+    httpd_resp_set_hdr(req, "Content-Disposition",
+                       binary ? "attachment; filename=\"history.bin\"" : "attachment; filename=\"history.csv\"");
+    KC868_A16_HistoryCursorInit(&cursor, binary ? kKc868HistoryFormatBinary : kKc868HistoryFormatCsv);
+    size_t length;
+    while ((length = KC868_A16_HistoryRead(&cursor, chunk, sizeof(chunk))) != 0) {
+        if (httpd_resp_send_chunk(req, (const char *)chunk, length) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// GET /api/history streams the whole buffer, run it in a worker
+static esp_err_t api_get_history_async(httpd_req_t *req)
+{
+    return webui_async_submit(req, api_get_history_handler);
+}
+
+// GET /api/history/status - Get the fill level, trigger state and trigger settings
+static esp_err_t api_get_history_status_handler(httpd_req_t *req)
+{
+    KC868_A16_HistoryStatus status;
+    KC868_A16_HistoryGetStatus(&status);
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_bool(&writer, "psram", status.psram);
+    webui_json_add_uint(&writer, "capacity", status.capacity);
+    webui_json_add_uint(&writer, "samples", status.samples);
+    webui_json_add_uint64(&writer, "oldest_us", status.oldest_us);
+    webui_json_add_uint64(&writer, "newest_us", status.newest_us);
+    webui_json_add_uint(&writer, "blocks_overwritten", status.blocks_overwritten);
+    webui_json_add_bool(&writer, "frozen", status.frozen);
+    webui_json_add_string(&writer, "trigger", KC868_A16_HistoryGetTriggerName(status.trigger));
+    webui_json_add_uint64(&writer, "trigger_time_us", status.trigger_time_us);
+    webui_json_add_uint(&writer, "trigger_inputs", status.config.inputs);
+    webui_json_add_bool(&writer, "trigger_timeout", status.config.timeout);
+    webui_json_add_uint(&writer, "post_trigger", status.config.post_trigger);
+    return webui_json_end(&writer);
+}
+
+// POST /api/history - Change the trigger settings and re-arm, or trigger by hand
+static esp_err_t api_post_history_handler(httpd_req_t *req)
+{
+    char content[128];
+    if (webui_recv_body(req, content, sizeof(content)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    cJSON *json = cJSON_Parse(req->content_len != 0 ? content : "{}");
+    if (json == NULL) {
+        return send_json_error(req, "Invalid JSON", 400);
+    }
+    if (cJSON_IsTrue(cJSON_GetObjectItem(json, "trigger"))) {
+        cJSON_Delete(json);
+        KC868_A16_HistoryTrigger(kKc868HistoryTriggerRequest);
+        return send_json_status(req, "History triggered, frozen after the post trigger scans.");
+    }
+
+    KC868_A16_HistoryStatus status;
+    KC868_A16_HistoryGetStatus(&status);
+    KC868_A16_HistoryTriggerConfig config = status.config;
+    bool valid = true;
+    if (cJSON_GetObjectItem(json, "trigger_inputs") != NULL) {
+        valid = get_mask_item(json, "trigger_inputs", &config.inputs);
+    }
+    const cJSON *item = cJSON_GetObjectItem(json, "trigger_timeout");
+    if (item != NULL) {
+        valid = valid && cJSON_IsBool(item);
+        config.timeout = cJSON_IsTrue(item);
+    }
+    item = cJSON_GetObjectItem(json, "post_trigger");
+    if (item != NULL) {
+        double value = cJSON_GetNumberValue(item);
+        valid = valid && cJSON_IsNumber(item) && value >= 0 && value <= 1000000 &&
+                value == (double)(uint32_t)value;
+        config.post_trigger = valid ? (uint32_t)value : 0;
+    }
+    cJSON_Delete(json);
+    if (!valid) {
+        return send_json_error(req, "trigger_inputs must be 0 to 65535, trigger_timeout a boolean, "
+                                    "post_trigger 0 to 1000000", 400);
+    }
+    KC868_A16_HistoryArm(&config);
+    return send_json_status(req, "History armed.");
+}
+#endif
+
+#if defined(CONFIG_KC868_LOGIC)
+// Largest accepted POST /api/logic body, enough for a full table
+#define LOGIC_API_MAX_BODY 2048
+
+// GET /api/logic - Interlock rule table and the current rule status
+static esp_err_t api_get_logic_handler(httpd_req_t *req)
+{
+    static KC868_A16_LogicRule rules[KC868_A16_LOGIC_MAX_RULES]; // httpd runs one request at a time
+    KC868_A16_LogicGetRules(rules);
+    uint32_t status = KC868_A16_LogicGetStatus();
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_begin_array(&writer, "rules");
+    for (size_t i = 0; i < KC868_A16_LOGIC_MAX_RULES; i++) {
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_uint(&writer, "type", rules[i].type);
+        webui_json_add_uint(&writer, "a", rules[i].operand_a);
+        webui_json_add_uint(&writer, "b", rules[i].operand_b);
+        webui_json_add_uint(&writer, "flags", rules[i].flags);
+        webui_json_add_uint(&writer, "output", rules[i].output);
+        webui_json_add_uint(&writer, "preset_ms", rules[i].preset_ms);
+        webui_json_add_uint(&writer, "threshold", rules[i].threshold);
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+    webui_json_add_uint(&writer, "results", status & 0xFFFF);
+    webui_json_add_uint(&writer, "forced", status >> 16);
+    return webui_json_end(&writer);
+}
+
+static bool parse_logic_rule(const cJSON *json, KC868_A16_LogicRule *rule)
+{
+    uint32_t type, a, b, flags, output, preset_ms, threshold;
+    if (!cJSON_IsObject(json) ||
+        !get_uint_item(json, "type", kKc868LogicDisabled, UINT8_MAX, &type) ||
+        !get_uint_item(json, "a", KC868_A16_LOGIC_OPERAND_TRUE, UINT8_MAX, &a) ||
+        !get_uint_item(json, "b", KC868_A16_LOGIC_OPERAND_TRUE, UINT8_MAX, &b) ||
+        !get_uint_item(json, "flags", 0, UINT8_MAX, &flags) ||
+        !get_uint_item(json, "output", KC868_A16_LOGIC_NO_OUTPUT, UINT8_MAX, &output) ||
+        !get_uint_item(json, "preset_ms", 0, UINT16_MAX, &preset_ms) ||
+        !get_uint_item(json, "threshold", 0, UINT16_MAX, &threshold)) {
+        return false;
+    }
+    rule->type = (CipUsint)type;
+    rule->operand_a = (CipUsint)a;
+    rule->operand_b = (CipUsint)b;
+    rule->flags = (CipUsint)flags;
+    rule->output = (CipUsint)output;
+    rule->reserved = 0;
+    rule->preset_ms = (CipUint)preset_ms;
+    rule->threshold = (CipUint)threshold;
+    return true;
+}
+
+// POST /api/logic - Replace the interlock rule table, rules not given are disabled
+static esp_err_t api_post_logic_handler(httpd_req_t *req)
+{
+    // The body is too large for the stack of the async workers
+    char *content = heap_class_malloc(HEAP_CLASS_SCRATCH, LOGIC_API_MAX_BODY);
+    if (content == NULL) {
+        return send_json_error(req, "Out of memory", 500);
+    }
+    KC868_A16_LogicRule rules[KC868_A16_LOGIC_MAX_RULES];
+    if (webui_recv_body(req, content, LOGIC_API_MAX_BODY) != ESP_OK) {
+        heap_class_free(HEAP_CLASS_SCRATCH, content);
+        return ESP_FAIL;
+    }
+
+    cJSON *json = cJSON_Parse(content);
+    heap_class_free(HEAP_CLASS_SCRATCH, content);
+    if (json == NULL) {
+        return send_json_error(req, "Invalid JSON", 400);
+    }
+    const cJSON *array = cJSON_GetObjectItem(json, "rules");
+    if (!cJSON_IsArray(array) || cJSON_GetArraySize(array) > KC868_A16_LOGIC_MAX_RULES) {
+        cJSON_Delete(json);
+        return send_json_error(req, "rules must be an array of up to 16 rules", 400);
+    }
+    memset(rules, 0, sizeof(rules));
+    for (size_t i = 0; i < KC868_A16_LOGIC_MAX_RULES; i++) {
+        rules[i].operand_a = KC868_A16_LOGIC_OPERAND_TRUE;
+        rules[i].operand_b = KC868_A16_LOGIC_OPERAND_TRUE;
+        rules[i].output = KC868_A16_LOGIC_NO_OUTPUT;
+    }
+    bool valid = true;
+    size_t index = 0;
+    const cJSON *item = NULL;
+    cJSON_ArrayForEach(item, array) {
+        valid = valid && parse_logic_rule(item, &rules[index++]);
+    }
+    cJSON_Delete(json);
+    if (!valid) {
+        return send_json_error(req, "Rule members must be integers in range", 400);
+    }
+    const char *error = KC868_A16_LogicValidateRules(rules);
+    if (error != NULL) {
+        return send_json_error(req, error, 400);
+    }
+    if (KC868_A16_LogicSetRules(rules) != kEipStatusOk) {
+        return send_json_error(req, "Rules applied but not saved", 500);
+    }
+    return send_json_status(req, "Rules saved.");
+}
+
+// POST /api/logic stores to the NVS, run it in a worker
+static esp_err_t api_post_logic_async(httpd_req_t *req)
+{
+    return webui_async_submit(req, api_post_logic_handler);
+}
+#endif
+
+#if defined(CONFIG_KC868_PEER)
+static const char *peer_state_name(CipUsint state)
+{
+    switch ((KC868_A16_PeerState)state) {
+        case kKc868PeerStateOff: return "off";
+        case kKc868PeerStateConnecting: return "connecting";
+        case kKc868PeerStateEstablished: return "established";
+        case kKc868PeerStateRefused: return "refused";
+        case kKc868PeerStateTimedOut: return "timed_out";
+        default: return "unknown";
+    }
+}
+
+// GET /api/peer - Configuration and state of the connection to the peer
+static esp_err_t api_get_peer_handler(httpd_req_t *req)
+{
+    KC868_A16_PeerConfig config;
+    KC868_A16_PeerStatus status;
+    KC868_A16_PeerGetConfig(&config);
+    KC868_A16_PeerGetStatus(&status);
+    char ip_str[16];
+    ip_uint32_to_string(config.address, ip_str, sizeof(ip_str));
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_begin_object(&writer, "config");
+    webui_json_add_string(&writer, "address", config.address != 0 ? ip_str : "");
+    webui_json_add_uint(&writer, "config_point", config.config_point);
+    webui_json_add_uint(&writer, "consumed_point", config.consumed_point);
+    webui_json_add_uint(&writer, "produced_point", config.produced_point);
+    webui_json_add_uint(&writer, "data_size", config.data_size);
+    webui_json_add_uint(&writer, "rpi_ms", config.rpi_ms);
+    webui_json_add_uint(&writer, "timeout_multiplier", config.timeout_multiplier);
+    webui_json_add_uint(&writer, "relay_byte", config.relay_byte);
+    webui_json_add_uint(&writer, "relay_mask", config.relay_mask);
+    webui_json_add_uint(&writer, "local_port", config.local_port);
+    webui_json_end_object(&writer);
+    webui_json_add_string(&writer, "state", peer_state_name(status.state));
+    webui_json_add_uint(&writer, "general_status", status.general_status);
+    webui_json_add_uint(&writer, "extended_status", status.extended_status);
+    webui_json_add_uint(&writer, "o_to_t_connection_id", status.o_to_t_connection_id);
+    webui_json_add_uint(&writer, "t_to_o_connection_id", status.t_to_o_connection_id);
+    webui_json_add_uint(&writer, "opens", status.opens);
+    webui_json_add_uint(&writer, "failures", status.failures);
+    webui_json_add_uint(&writer, "timeouts", status.timeouts);
+    webui_json_add_uint(&writer, "packets", status.packets);
+    webui_json_add_uint(&writer, "heartbeats", status.heartbeats);
+    webui_json_begin_array(&writer, "data");
+    for (size_t i = 0; i < status.data_size; i++) {
+        webui_json_add_uint(&writer, NULL, status.data[i]);
+    }
+    webui_json_end_array(&writer);
+    return webui_json_end(&writer);
+}
+
+// POST /api/peer - Change the connection to the peer, members not given are kept
+static esp_err_t api_post_peer_handler(httpd_req_t *req)
+{
+    char content[384];
+    if (webui_recv_body(req, content, sizeof(content)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    cJSON *json = cJSON_Parse(content);
+    if (json == NULL) {
+        return send_json_error(req, "Invalid JSON", 400);
+    }
+    KC868_A16_PeerConfig config;
+    KC868_A16_PeerGetConfig(&config);
+    bool valid = true;
+    const cJSON *address = cJSON_GetObjectItem(json, "address");
+    if (address != NULL) {
+        const char *address_str = cJSON_GetStringValue(address);
+        // An empty address turns the connection off
+        config.address = ip_string_to_uint32(address_str);
+        valid = address_str != NULL && (config.address != 0 || address_str[0] == '\0');
+    }
+    uint32_t config_point, consumed_point, produced_point, data_size, rpi_ms;
+    uint32_t timeout_multiplier, relay_byte, relay_mask, local_port;
+    valid = valid &&
+            get_uint_item(json, "config_point", config.config_point, UINT16_MAX, &config_point) &&
+            get_uint_item(json, "consumed_point", config.consumed_point, UINT16_MAX, &consumed_point) &&
+            get_uint_item(json, "produced_point", config.produced_point, UINT16_MAX, &produced_point) &&
+            get_uint_item(json, "data_size", config.data_size, UINT16_MAX, &data_size) &&
+            get_uint_item(json, "rpi_ms", config.rpi_ms, UINT16_MAX, &rpi_ms) &&
+            get_uint_item(json, "timeout_multiplier", config.timeout_multiplier, UINT8_MAX,
+                          &timeout_multiplier) &&
+            get_uint_item(json, "relay_byte", config.relay_byte, UINT8_MAX, &relay_byte) &&
+            get_uint_item(json, "relay_mask", config.relay_mask, UINT16_MAX, &relay_mask) &&
+            get_uint_item(json, "local_port", config.local_port, UINT16_MAX, &local_port);
+    cJSON_Delete(json);
+    if (!valid) {
+        return send_json_error(req, "address must be an IPv4 address or empty, "
+                                    "the other members integers in range", 400);
+    }
+    config.config_point = (CipUint)config_point;
+    config.consumed_point = (CipUint)consumed_point;
+    config.produced_point = (CipUint)produced_point;
+    config.data_size = (CipUint)data_size;
+    config.rpi_ms = (CipUint)rpi_ms;
+    config.timeout_multiplier = (CipUsint)timeout_multiplier;
+    config.relay_byte = (CipUsint)relay_byte;
+    config.relay_mask = (CipWord)relay_mask;
+    config.local_port = (CipUint)local_port;
+    const char *error = KC868_A16_PeerValidateConfig(&config);
+    if (error != NULL) {
+        return send_json_error(req, error, 400);
+    }
+    if (KC868_A16_PeerSetConfig(&config) != kEipStatusOk) {
+        return send_json_error(req, "Configuration applied but not saved", 500);
+    }
+    return send_json_status(req, config.address != 0 ?
+                            "Configuration saved, connecting to the peer." :
+                            "Configuration saved, peer connection off.");
+}
+
+// POST /api/peer stores to the NVS, run it in a worker
+static esp_err_t api_post_peer_async(httpd_req_t *req)
+{
+    return webui_async_submit(req, api_post_peer_handler);
+}
+#endif
+
+#if defined(CONFIG_OPENER_OTA_UPDATE)
+// POST /api/ota/update - Stream an application image into the other OTA partition
+static esp_err_t api_post_ota_update_handler(httpd_req_t *req)
+{
+    // Blocks of one flash sector, handed to the paced write job. Static is
+    // safe in the async workers, OtaUpdateBegin() admits one upload at a time
+    static uint8_t block[OTA_UPDATE_BLOCK_SIZE];
+    if (req->content_len == 0) {
+        return send_json_error(req, "Send the image as the request body", 400);
+    }
+    OtaUpdateStatus status;
+    if (OtaUpdateBegin(req->content_len) != kEipStatusOk) {
+        OtaUpdateGetStatus(&status);
+        if (status.state == kOtaUpdateStateWriting) {
+            return send_json_error(req, "An update is in progress", 409);
+        }
+        return send_json_error(req, status.error, 400);
+    }
+
+    size_t remaining = req->content_len;
+    while (remaining > 0) {
+        size_t length = remaining < sizeof(block) ? remaining : sizeof(block);
+        size_t received = 0;
+        while (received < length) {
+            int ret = httpd_req_recv(req, (char *)block + received, length - received);
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                continue;
+            }
+            if (ret <= 0) {
+                OtaUpdateAbort("upload interrupted");
+                return ESP_FAIL;
+            }
+            received += (size_t)ret;
+        }
+        if (OtaUpdateWrite(block, length) != kEipStatusOk) {
+            OtaUpdateGetStatus(&status);
+            return send_json_error(req, status.error, 400);
+        }
+        remaining -= length;
+    }
+
+    if (OtaUpdateFinish() != kEipStatusOk) {
+        OtaUpdateGetStatus(&status);
+        return send_json_error(req, status.error, 400);
+    }
+    return send_json_status(req, "Update written, active after the next restart.");
+}
+
+// POST /api/ota/update receives the whole image, run it in a worker
+static esp_err_t api_post_ota_update_async(httpd_req_t *req)
+{
+    return webui_async_submit(req, api_post_ota_update_handler);
+}
+
+// GET /api/ota/status - Get the progress and the I/O cost of the current or last update
+static esp_err_t api_get_ota_status_handler(httpd_req_t *req)
+{
+    OtaUpdateStatus status;
+    OtaUpdateGetStatus(&status);
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_string(&writer, "status", OtaUpdateGetStateName(status.state));
+    if (status.error != NULL) {
+        webui_json_add_string(&writer, "error", status.error);
+    }
+    webui_json_add_uint(&writer, "image_size", status.image_size);
+    webui_json_add_uint(&writer, "written", status.written);
+    webui_json_add_uint(&writer, "progress",
+                        status.image_size > 0 ? (uint32_t)((uint64_t)status.written * 100U / status.image_size) : 0);
+    webui_json_add_uint(&writer, "erase_max_us", status.erase_max_us);
+    webui_json_add_uint(&writer, "write_max_us", status.write_max_us);
+    webui_json_add_uint(&writer, "deferred_ms", status.deferred_ms);
+    webui_json_add_uint(&writer, "forced", status.forced);
+    webui_json_begin_object(&writer, "io");
+    webui_json_add_uint(&writer, "produced_late", status.produced_late);
+    webui_json_add_uint(&writer, "produced_missed", status.produced_missed);
+    webui_json_add_uint(&writer, "consumed_late", status.consumed_late);
+    webui_json_add_uint(&writer, "consumed_missed", status.consumed_missed);
+    webui_json_end_object(&writer);
+    return webui_json_end(&writer);
+}
+#endif
+
+#if defined(CONFIG_OPENER_SELF_TEST)
+// POST /api/selftest - Start a network self test beside the I/O connections
+static esp_err_t api_post_selftest_handler(httpd_req_t *req)
+{
+    char content[192];
+    if (webui_recv_body(req, content, sizeof(content)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    cJSON *json = cJSON_Parse(content);
+    if (json == NULL) {
+        return send_json_error(req, "Invalid JSON", 400);
+    }
+    SelfTestRequest request = { 0 };
+    const char *mode = cJSON_GetStringValue(cJSON_GetObjectItem(json, "mode"));
+    bool valid = mode != NULL;
+    if (valid && strcmp(mode, "tcp_server") == 0) {
+        request.mode = kSelfTestModeTcpServer;
+    } else if (valid && strcmp(mode, "tcp_client") == 0) {
+        request.mode = kSelfTestModeTcpClient;
+    } else if (valid && strcmp(mode, "udp_latency") == 0) {
+        request.mode = kSelfTestModeUdpLatency;
+    } else {
+        valid = false;
+    }
+    request.address = ip_string_to_uint32(cJSON_GetStringValue(cJSON_GetObjectItem(json, "host")));
+    // iperf 2 listens on 5001, the RFC 862 echo service on 7
+    uint32_t port = 0;
+    valid = valid &&
+            get_uint_item(json, "port", request.mode == kSelfTestModeUdpLatency ? 7 : 5001,
+                          UINT16_MAX, &port) &&
+            get_uint_item(json, "timeout_s", 60, UINT32_MAX, &request.timeout_s) &&
+            get_uint_item(json, "size", 64, UINT32_MAX, &request.size) &&
+            get_uint_item(json, "count", 100, UINT32_MAX, &request.count) &&
+            get_uint_item(json, "interval_ms", 10, UINT32_MAX, &request.interval_ms);
+    request.port = (CipUint)port;
+    cJSON_Delete(json);
+    if (!valid) {
+        return send_json_error(req, "mode must be tcp_server, tcp_client or udp_latency, "
+                                    "the other members non-negative integers", 400);
+    }
+
+    if (SelfTestStart(&request) != kEipStatusOk) {
+        SelfTestStatus status;
+        SelfTestGetStatus(&status);
+        if (status.state == kSelfTestStateRunning) {
+            return send_json_error(req, "A self test is already running", 409);
+        }
+        return send_json_error(req, status.error != NULL ? status.error : "Self test not started", 400);
+    }
+    return send_json_status(req, "Self test started, see GET /api/selftest.");
+}
+
+// GET /api/selftest - Result of the current or last self test
+static esp_err_t api_get_selftest_handler(httpd_req_t *req)
+{
+    SelfTestStatus status;
+    SelfTestGetStatus(&status);
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_string(&writer, "status", SelfTestGetStateName(status.state));
+    webui_json_add_string(&writer, "mode", SelfTestGetModeName(status.mode));
+    if (status.error != NULL) {
+        webui_json_add_string(&writer, "error", status.error);
+    }
+    webui_json_add_uint(&writer, "elapsed_ms", status.elapsed_ms);
+    if (status.mode == kSelfTestModeUdpLatency) {
+        webui_json_add_uint(&writer, "sent", status.sent);
+        webui_json_add_uint(&writer, "received", status.received);
+        webui_json_add_uint(&writer, "rtt_min_us", status.rtt_min_us);
+        webui_json_add_uint(&writer, "rtt_avg_us", status.rtt_avg_us);
+        webui_json_add_uint(&writer, "rtt_max_us", status.rtt_max_us);
+    } else {
+        webui_json_add_uint(&writer, "bytes", status.bytes);
+        webui_json_add_uint(&writer, "duration_ms", status.duration_ms);
+        webui_json_add_uint(&writer, "bandwidth_kbps", status.bandwidth_kbps);
+    }
+    webui_json_begin_object(&writer, "io");
+    webui_json_add_uint(&writer, "connections", status.io_connections);
+    webui_json_add_uint(&writer, "produced_packets", status.produced_packets);
+    webui_json_add_uint(&writer, "produced_late", status.produced_late);
+    webui_json_add_uint(&writer, "produced_missed", status.produced_missed);
+    webui_json_add_uint(&writer, "consumed_late", status.consumed_late);
+    webui_json_add_uint(&writer, "consumed_missed", status.consumed_missed);
+    add_histogram(&writer, "produced_histogram", status.produced_histogram);
+    webui_json_end_object(&writer);
+    return webui_json_end(&writer);
+}
+#endif
+
+#if defined(CONFIG_OPENER_EDS_FILE)
+// GET /api/eds - The EDS of this firmware, the image of the File object
+static esp_err_t api_get_eds_handler(httpd_req_t *req)
+{
+    // The image is a zlib stream, which is the deflate content coding
+    char disposition[64];
+    snprintf(disposition, sizeof(disposition), "attachment; filename=\"%s\"",
+             g_eds_file_image.name);
+    httpd_resp_set_type(req, "text/plain; charset=iso-8859-1");
+    httpd_resp_set_hdr(req, "Content-Encoding", "deflate");
+    httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    return httpd_resp_send(req, (const char *)g_eds_file_image.data, g_eds_file_image.size);
+}
+#endif
+
+// POST /api/placement - Store the task placement profile of the next boot,
+// or measure the profile of this boot
+static esp_err_t api_post_placement_handler(httpd_req_t *req)
+{
+    char content[96];
+    if (webui_recv_body(req, content, sizeof(content)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    cJSON *json = cJSON_Parse(content);
+    if (json == NULL) {
+        return send_json_error(req, "Invalid JSON", 400);
+    }
+    const char *name = cJSON_GetStringValue(cJSON_GetObjectItem(json, "profile"));
+    TaskPlacementProfile profile = TaskPlacementGetStoredProfile();
+    bool valid = name == NULL || TaskPlacementFindProfile(name, &profile);
+    uint32_t measure_s = 0;
+    valid = valid && get_uint_item(json, "measure_s", 0, UINT32_MAX, &measure_s);
+    cJSON_Delete(json);
+    if (!valid || (name == NULL && measure_s == 0)) {
+        return send_json_error(req, "profile must be shared, tcpip, io_core1 or split, "
+                                    "measure_s a number of seconds", 400);
+    }
+
+    if (name != NULL && TaskPlacementStoreProfile(profile) != kEipStatusOk) {
+        return send_json_error(req, "Failed to store the profile", 500);
+    }
+    if (measure_s != 0 && TaskPlacementMeasureStart(measure_s) != kEipStatusOk) {
+        return send_json_error(req, "Measurement not started: one runs already "
+                                    "or measure_s is above 3600", 409);
+    }
+    return send_json_status(req, measure_s != 0 ?
+                            "Measurement started, see GET /api/placement." :
+                            "Profile stored, restart the device to apply it.");
+}
+
+// POST /api/placement stores to the NVS, run it in a worker
+static esp_err_t api_post_placement_async(httpd_req_t *req)
+{
+    return webui_async_submit(req, api_post_placement_handler);
+}
+
+// GET /api/placement - Task placement profiles and their measurements
+static esp_err_t api_get_placement_handler(httpd_req_t *req)
+{
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_string(&writer, "active",
+                          TaskPlacementGetProfileName(TaskPlacementGetProfile()));
+    webui_json_add_string(&writer, "next_boot",
+                          TaskPlacementGetProfileName(TaskPlacementGetStoredProfile()));
+    webui_json_add_uint(&writer, "tcpip_priority", CONFIG_LWIP_TCPIP_TASK_PRIO);
+    webui_json_begin_array(&writer, "profiles");
+    for (size_t i = 0; i < kTaskPlacementNumberOfProfiles; i++) {
+        const TaskPlacementProfile profile = (TaskPlacementProfile)i;
+        webui_json_begin_object(&writer, NULL);
+        webui_json_add_string(&writer, "name", TaskPlacementGetProfileName(profile));
+        webui_json_begin_object(&writer, "tasks");
+        for (size_t task = 0; task < kTaskPlacementNumberOfTasks; task++) {
+            TaskPlacement placement;
+            TaskPlacementGetForProfile(profile, (TaskPlacementTask)task, &placement);
+            webui_json_begin_object(&writer, TaskPlacementGetTaskName((TaskPlacementTask)task));
+            webui_json_add_int(&writer, "core", placement.core);
+            webui_json_add_uint(&writer, "priority", placement.priority);
+            webui_json_end_object(&writer);
+        }
+        webui_json_end_object(&writer);
+
+        TaskPlacementMeasurement measurement;
+        TaskPlacementGetMeasurement(profile, &measurement);
+        if (measurement.state == kTaskPlacementMeasurementRunning) {
+            webui_json_add_string(&writer, "measurement", "running");
+        } else if (measurement.state == kTaskPlacementMeasurementDone) {
+            webui_json_begin_object(&writer, "measurement");
+            webui_json_add_uint(&writer, "duration_s", measurement.duration_s);
+            webui_json_add_uint(&writer, "io_connections", measurement.io_connections);
+            webui_json_add_uint(&writer, "produced_packets", measurement.produced_packets);
+            webui_json_add_uint(&writer, "produced_late", measurement.produced_late);
+            webui_json_add_uint(&writer, "produced_missed", measurement.produced_missed);
+            add_histogram(&writer, "produced_histogram", measurement.produced_histogram);
+            if (measurement.loop_profile) {
+                webui_json_add_uint(&writer, "loop_p99_us", measurement.loop_p99);
+                webui_json_add_uint(&writer, "loop_max_us", measurement.loop_maximum);
+                webui_json_add_uint(&writer, "production_p99_us", measurement.production_p99);
+                webui_json_add_uint(&writer, "production_max_us", measurement.production_maximum);
+            }
+            webui_json_end_object(&writer);
+        }
+        webui_json_end_object(&writer);
+    }
+    webui_json_end_array(&writer);
+    return webui_json_end(&writer);
+}
+
+void webui_register_api_handlers(httpd_handle_t server)
+{
+    if (server == NULL) {
+        ESP_LOGE(TAG, "Cannot register API handlers: server handle is NULL!");
+        return;
+    }
+    
+    ESP_LOGI(TAG, "Registering API handlers...");
+    
+    // GET /api/status
+    httpd_uri_t get_status_uri = {
+        .uri       = "/api/status",
+        .method    = HTTP_GET,
+        .handler   = api_get_status_handler,
+        .user_ctx  = NULL
+    };
+    esp_err_t ret = webui_register_uri_handler(server, &get_status_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/status: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/status handler");
+    }
+
+    // GET /api/ipconfig
+    httpd_uri_t get_ipconfig_uri = {
+        .uri       = "/api/ipconfig",
+        .method    = HTTP_GET,
+        .handler   = api_get_ipconfig_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_ipconfig_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/ipconfig: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/ipconfig handler");
+    }
+    
+    // POST /api/ipconfig
+    httpd_uri_t post_ipconfig_uri = {
+        .uri       = "/api/ipconfig",
+        .method    = HTTP_POST,
+        .handler   = api_post_ipconfig_async,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &post_ipconfig_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/ipconfig: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered POST /api/ipconfig handler");
+    }
+    
+    // GET /api/diagnostics/connections
+    httpd_uri_t get_connection_diagnostics_uri = {
+        .uri       = "/api/diagnostics/connections",
+        .method    = HTTP_GET,
+        .handler   = api_get_connection_diagnostics_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_connection_diagnostics_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/diagnostics/connections: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/diagnostics/connections handler");
+    }
+    
+    // GET /api/diagnostics/network
+    httpd_uri_t get_network_diagnostics_uri = {
+        .uri       = "/api/diagnostics/network",
+        .method    = HTTP_GET,
+        .handler   = api_get_network_diagnostics_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_network_diagnostics_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/diagnostics/network: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/diagnostics/network handler");
+    }
+    
+    // GET /api/io
+    httpd_uri_t get_io_uri = {
+        .uri       = "/api/io",
+        .method    = HTTP_GET,
+        .handler   = api_get_io_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_io_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/io: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/io handler");
+    }
+    
+    // POST /api/io/outputs
+    httpd_uri_t post_io_outputs_uri = {
+        .uri       = "/api/io/outputs",
+        .method    = HTTP_POST,
+        .handler   = api_post_io_outputs_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &post_io_outputs_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/io/outputs: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered POST /api/io/outputs handler");
+    }
+    
+#if defined(CONFIG_KC868_RELAY_COUNTERS)
+    // GET /api/relays/counters
+    httpd_uri_t get_relay_counters_uri = {
+        .uri       = "/api/relays/counters",
+        .method    = HTTP_GET,
+        .handler   = api_get_relay_counters_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_relay_counters_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/relays/counters: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/relays/counters handler");
+    }
+
+    // POST /api/relays/counters/reset
+    httpd_uri_t post_relay_counters_reset_uri = {
+        .uri       = "/api/relays/counters/reset",
+        .method    = HTTP_POST,
+        .handler   = api_post_relay_counters_reset_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &post_relay_counters_reset_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/relays/counters/reset: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered POST /api/relays/counters/reset handler");
+    }
+#endif
+    
+#if defined(CONFIG_OPENER_TRACE_BUFFER)
+    // GET /api/trace
+    httpd_uri_t get_trace_uri = {
+        .uri       = "/api/trace",
+        .method    = HTTP_GET,
+        .handler   = api_get_trace_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_trace_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/trace: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/trace handler");
+    }
+#endif
+    
+#if defined(CONFIG_OPENER_LOG_BUFFER)
+    // GET /api/logs
+    httpd_uri_t get_logs_uri = {
+        .uri       = "/api/logs",
+        .method    = HTTP_GET,
+        .handler   = api_get_logs_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_logs_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/logs: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/logs handler");
+    }
+#endif
+    
+#if defined(CONFIG_OPENER_LOOP_PROFILE)
+    // GET /api/perf
+    httpd_uri_t get_perf_uri = {
+        .uri       = "/api/perf",
+        .method    = HTTP_GET,
+        .handler   = api_get_perf_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_perf_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/perf: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/perf handler");
+    }
+    
+    // POST /api/perf/reset
+    httpd_uri_t post_perf_reset_uri = {
+        .uri       = "/api/perf/reset",
+        .method    = HTTP_POST,
+        .handler   = api_post_perf_reset_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &post_perf_reset_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/perf/reset: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered POST /api/perf/reset handler");
+    }
+#endif
+
+#if defined(CONFIG_OPENER_WCET_PROFILE)
+    // GET /api/wcet
+    httpd_uri_t get_wcet_uri = {
+        .uri       = "/api/wcet",
+        .method    = HTTP_GET,
+        .handler   = api_get_wcet_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_wcet_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/wcet: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/wcet handler");
+    }
+#endif
+
+#if defined(CONFIG_KC868_SOE_BUFFER)
+    // GET /api/soe
+    httpd_uri_t get_soe_uri = {
+        .uri       = "/api/soe",
+        .method    = HTTP_GET,
+        .handler   = api_get_soe_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_soe_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/soe: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/soe handler");
+    }
+#endif
+
+#if defined(CONFIG_KC868_HISTORY)
+    // GET /api/history
+    httpd_uri_t get_history_uri = {
+        .uri       = "/api/history",
+        .method    = HTTP_GET,
+        .handler   = api_get_history_async,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_history_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/history: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/history handler");
+    }
+
+    // GET /api/history/status
+    httpd_uri_t get_history_status_uri = {
+        .uri       = "/api/history/status",
+        .method    = HTTP_GET,
+        .handler   = api_get_history_status_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_history_status_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/history/status: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/history/status handler");
+    }
+
+    // POST /api/history
+    httpd_uri_t post_history_uri = {
+        .uri       = "/api/history",
+        .method    = HTTP_POST,
+        .handler   = api_post_history_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &post_history_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/history: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered POST /api/history handler");
+    }
+#endif
+
+#if defined(CONFIG_KC868_LOGIC)
+    // GET /api/logic
+    httpd_uri_t get_logic_uri = {
+        .uri       = "/api/logic",
+        .method    = HTTP_GET,
+        .handler   = api_get_logic_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_logic_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/logic: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/logic handler");
+    }
+
+    // POST /api/logic
+    httpd_uri_t post_logic_uri = {
+        .uri       = "/api/logic",
+        .method    = HTTP_POST,
+        .handler   = api_post_logic_async,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &post_logic_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/logic: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered POST /api/logic handler");
+    }
+#endif
+
+#if defined(CONFIG_KC868_PEER)
+    // GET /api/peer
+    httpd_uri_t get_peer_uri = {
+        .uri       = "/api/peer",
+        .method    = HTTP_GET,
+        .handler   = api_get_peer_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_peer_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/peer: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/peer handler");
+    }
+
+    // POST /api/peer
+    httpd_uri_t post_peer_uri = {
+        .uri       = "/api/peer",
+        .method    = HTTP_POST,
+        .handler   = api_post_peer_async,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &post_peer_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/peer: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered POST /api/peer handler");
+    }
+#endif
+
+#if defined(CONFIG_OPENER_TASK_TELEMETRY)
+    // GET /api/system
+    httpd_uri_t get_system_uri = {
+        .uri       = "/api/system",
+        .method    = HTTP_GET,
+        .handler   = api_get_system_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_system_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/system: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/system handler");
+    }
+#endif
+
+#if defined(CONFIG_OPENER_OTA_UPDATE)
+    // POST /api/ota/update
+    httpd_uri_t post_ota_update_uri = {
+        .uri       = "/api/ota/update",
+        .method    = HTTP_POST,
+        .handler   = api_post_ota_update_async,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &post_ota_update_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/ota/update: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered POST /api/ota/update handler");
+    }
+
+    // GET /api/ota/status
+    httpd_uri_t get_ota_status_uri = {
+        .uri       = "/api/ota/status",
+        .method    = HTTP_GET,
+        .handler   = api_get_ota_status_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_ota_status_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/ota/status: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/ota/status handler");
+    }
+#endif
+
+#if defined(CONFIG_OPENER_EDS_FILE)
+    // GET /api/eds
+    httpd_uri_t get_eds_uri = {
+        .uri       = "/api/eds",
+        .method    = HTTP_GET,
+        .handler   = api_get_eds_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_eds_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/eds: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/eds handler");
+    }
+#endif
+
+#if defined(CONFIG_OPENER_SELF_TEST)
+    // GET /api/selftest
+    httpd_uri_t get_selftest_uri = {
+        .uri       = "/api/selftest",
+        .method    = HTTP_GET,
+        .handler   = api_get_selftest_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_selftest_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/selftest: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/selftest handler");
+    }
+
+    // POST /api/selftest
+    httpd_uri_t post_selftest_uri = {
+        .uri       = "/api/selftest",
+        .method    = HTTP_POST,
+        .handler   = api_post_selftest_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &post_selftest_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/selftest: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered POST /api/selftest handler");
+    }
+#endif
+    // GET /api/placement
+    httpd_uri_t get_placement_uri = {
+        .uri       = "/api/placement",
+        .method    = HTTP_GET,
+        .handler   = api_get_placement_handler,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &get_placement_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/placement: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET /api/placement handler");
+    }
+
+    // POST /api/placement
+    httpd_uri_t post_placement_uri = {
+        .uri       = "/api/placement",
+        .method    = HTTP_POST,
+        .handler   = api_post_placement_async,
+        .user_ctx  = NULL
+    };
+    ret = webui_register_uri_handler(server, &post_placement_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/placement: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered POST /api/placement handler");
     }
     
     ESP_LOGI(TAG, "API handler registration complete");
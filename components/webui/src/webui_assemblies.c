@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// GET /api/assemblies and /api/assemblies/sizes: the input and output
+// assembly images for polling clients, as JSON or as one binary record, with
+// ?since=<version> long polling. See README.md for the formats.
+
+#include "webui_api.h"
+#include "webui_json.h"
+#include "webui_wcet.h"
+#include "cipassembly.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "webui_asm";
+
+// Assembly instances of the KC868-A16 application
+#define ASSEMBLIES_INPUT            100
+#define ASSEMBLIES_OUTPUT           150
+#define ASSEMBLIES_MAX_IMAGE_SIZE   256
+
+// Attempts to get a consistent snapshot, one tick apart
+#define ASSEMBLIES_SNAPSHOT_ATTEMPTS 10
+
+// Long polls held at the same time, each one keeps a socket of the server
+#define ASSEMBLIES_MAX_WAITERS      2
+// Period the images are checked for changes while a long poll waits
+#define ASSEMBLIES_POLL_MS          20
+#define ASSEMBLIES_DEFAULT_WAIT_MS  5000
+#define ASSEMBLIES_MAX_WAIT_MS      30000
+
+#define ASSEMBLIES_RECORD_FORMAT    1
+#define ASSEMBLIES_HEADER_SIZE      16
+
+typedef struct {
+    uint8_t data[ASSEMBLIES_MAX_IMAGE_SIZE];
+    size_t length;
+    uint32_t stack_version; // snapshot version, advances on every write
+    bool valid;
+} assembly_image_t;
+
+typedef struct {
+    httpd_req_t *req;        // async copy, NULL if the slot is free
+    uint32_t since;
+    int64_t deadline_us;
+    bool binary;
+} assemblies_waiter_t;
+
+static httpd_handle_t s_server = NULL;
+static esp_timer_handle_t s_poll_timer = NULL;
+static bool s_check_pending = false;
+
+// Only touched from the httpd task: the URI handlers and the queued checks
+static assembly_image_t s_input;
+static assembly_image_t s_output;
+// Advances when the bytes of either image change, 0 before the first read
+static uint32_t s_version = 0;
+static assemblies_waiter_t s_waiters[ASSEMBLIES_MAX_WAITERS];
+
+static void put_u16(uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t *buffer, uint32_t value)
+{
+    put_u16(buffer, (uint16_t)value);
+    put_u16(buffer + 2, (uint16_t)(value >> 16));
+}
+
+// Takes a snapshot of the image; true if its bytes differ from the last one
+static bool refresh_image(EipUint16 instance, assembly_image_t *image)
+{
+    static uint8_t data[ASSEMBLIES_MAX_IMAGE_SIZE];
+    size_t length = 0;
+    uint32_t stack_version = 0;
+    for (int attempt = 0; attempt < ASSEMBLIES_SNAPSHOT_ATTEMPTS; attempt++) {
+        if (GetAssemblyDataSnapshot(instance, data, sizeof(data), &length,
+                                    &stack_version) == kEipStatusOk) {
+            if (image->valid && stack_version == image->stack_version) {
+                return false; // nothing was written since the last snapshot
+            }
+            bool changed = !image->valid || length != image->length ||
+                           memcmp(data, image->data, length) != 0;
+            memcpy(image->data, data, length);
+            image->length = length;
+            image->stack_version = stack_version;
+            image->valid = true;
+            return changed;
+        }
+        vTaskDelay(1);
+    }
+    return false; // keep the last image
+}
+
+static void refresh_images(void)
+{
+    bool changed = refresh_image(ASSEMBLIES_INPUT, &s_input);
+    changed = refresh_image(ASSEMBLIES_OUTPUT, &s_output) || changed;
+    if (changed) {
+        s_version++;
+        if (s_version == 0) {
+            s_version = 1; // 0 stays "never read" for ?since=0
+        }
+    }
+}
+
+static void add_raw_bytes(webui_json_writer_t *writer, const char *key, EipUint16 instance,
+                          const assembly_image_t *image)
+{
+    webui_json_begin_object(writer, key);
+    webui_json_add_uint(writer, "instance", instance);
+    webui_json_add_uint(writer, "size", (uint32_t)image->length);
+    webui_json_begin_array(writer, "raw_bytes");
+    for (size_t i = 0; i < image->length; i++) {
+        webui_json_add_uint(writer, NULL, image->data[i]);
+    }
+    webui_json_end_array(writer);
+    webui_json_end_object(writer);
+}
+
+static esp_err_t send_images(httpd_req_t *req, bool binary)
+{
+    const uint32_t uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    if (binary) {
+        static uint8_t record[ASSEMBLIES_HEADER_SIZE + 2 * ASSEMBLIES_MAX_IMAGE_SIZE];
+        record[0] = ASSEMBLIES_RECORD_FORMAT;
+        record[1] = 0;
+        put_u16(record + 2, (uint16_t)s_input.length);
+        put_u16(record + 4, (uint16_t)s_output.length);
+        put_u16(record + 6, 0);
+        put_u32(record + 8, s_version);
+        put_u32(record + 12, uptime_ms);
+        memcpy(record + ASSEMBLIES_HEADER_SIZE, s_input.data, s_input.length);
+        memcpy(record + ASSEMBLIES_HEADER_SIZE + s_input.length, s_output.data, s_output.length);
+        httpd_resp_set_type(req, "application/octet-stream");
+        httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+        return httpd_resp_send(req, (const char *)record,
+                               ASSEMBLIES_HEADER_SIZE + s_input.length + s_output.length);
+    }
+
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_uint(&writer, "version", s_version);
+    webui_json_add_uint(&writer, "uptime_ms", uptime_ms);
+    add_raw_bytes(&writer, "input_assembly_100", ASSEMBLIES_INPUT, &s_input);
+    add_raw_bytes(&writer, "output_assembly_150", ASSEMBLIES_OUTPUT, &s_output);
+    return webui_json_end(&writer);
+}
+
+// Long poll that ran out of time: nothing changed since the client's version
+static esp_err_t send_not_modified(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "304 Not Modified");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+static void finish_waiter(assemblies_waiter_t *waiter, bool changed)
+{
+    if (changed) {
+        (void)send_images(waiter->req, waiter->binary);
+    } else {
+        (void)send_not_modified(waiter->req);
+    }
+    httpd_req_async_handler_complete(waiter->req);
+    waiter->req = NULL;
+}
+
+static void check_waiters(void *arg)
+{
+    (void)arg;
+    __atomic_store_n(&s_check_pending, false, __ATOMIC_RELEASE);
+
+    refresh_images();
+    const int64_t now = esp_timer_get_time();
+    bool waiting = false;
+    for (size_t i = 0; i < ASSEMBLIES_MAX_WAITERS; i++) {
+        assemblies_waiter_t *waiter = &s_waiters[i];
+        if (waiter->req == NULL) {
+            continue;
+        }
+        if (waiter->since != s_version) {
+            finish_waiter(waiter, true);
+        } else if (now >= waiter->deadline_us) {
+            finish_waiter(waiter, false);
+        } else {
+            waiting = true;
+        }
+    }
+    if (!waiting) {
+        esp_timer_stop(s_poll_timer);
+    }
+}
+
+// Runs in the esp_timer task, hands the check over to the httpd task
+static void poll_timer_expired(void *arg)
+{
+    (void)arg;
+    if (__atomic_exchange_n(&s_check_pending, true, __ATOMIC_ACQ_REL)) {
+        return; // previous check still queued
+    }
+    if (httpd_queue_work(s_server, check_waiters, NULL) != ESP_OK) {
+        __atomic_store_n(&s_check_pending, false, __ATOMIC_RELEASE);
+    }
+}
+
+// Value of a numeric query parameter, false if it is missing
+static bool get_query_uint(const char *query, const char *key, uint32_t *value)
+{
+    char text[12];
+    if (query == NULL || httpd_query_key_value(query, key, text, sizeof(text)) != ESP_OK) {
+        return false;
+    }
+    *value = (uint32_t)strtoul(text, NULL, 10);
+    return true;
+}
+
+// GET /api/assemblies?format=json|bin&since=V&wait_ms=T
+static esp_err_t api_get_assemblies_handler(httpd_req_t *req)
+{
+    char query[64];
+    const char *parameters = NULL;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        parameters = query;
+    }
+    bool binary = false;
+    char format[8];
+    if (parameters != NULL &&
+        httpd_query_key_value(parameters, "format", format, sizeof(format)) == ESP_OK) {
+        binary = strcmp(format, "bin") == 0;
+        if (!binary && strcmp(format, "json") != 0) {
+            webui_json_writer_t writer;
+            webui_json_begin(&writer, req, "400 Bad Request");
+            webui_json_add_string(&writer, "status", "error");
+            webui_json_add_string(&writer, "message", "format must be json or bin");
+            return webui_json_end(&writer);
+        }
+    }
+
+    refresh_images();
+    uint32_t since = 0;
+    if (!get_query_uint(parameters, "since", &since) || since != s_version) {
+        return send_images(req, binary);
+    }
+
+    uint32_t wait_ms = ASSEMBLIES_DEFAULT_WAIT_MS;
+    (void)get_query_uint(parameters, "wait_ms", &wait_ms);
+    if (wait_ms > ASSEMBLIES_MAX_WAIT_MS) {
+        wait_ms = ASSEMBLIES_MAX_WAIT_MS;
+    }
+    assemblies_waiter_t *waiter = NULL;
+    for (size_t i = 0; i < ASSEMBLIES_MAX_WAITERS && waiter == NULL; i++) {
+        if (s_waiters[i].req == NULL) {
+            waiter = &s_waiters[i];
+        }
+    }
+    // No slot, or no wait asked for: answer at once
+    if (wait_ms == 0 || waiter == NULL || s_poll_timer == NULL) {
+        return send_not_modified(req);
+    }
+
+    // The server goes on with other sockets while this one waits
+    httpd_req_t *async_req = NULL;
+    if (httpd_req_async_handler_begin(req, &async_req) != ESP_OK) {
+        return send_not_modified(req);
+    }
+    *waiter = (assemblies_waiter_t) {
+        .req = async_req,
+        .since = since,
+        .deadline_us = esp_timer_get_time() + (int64_t)wait_ms * 1000,
+        .binary = binary,
+    };
+    if (!esp_timer_is_active(s_poll_timer)) {
+        esp_timer_start_periodic(s_poll_timer, ASSEMBLIES_POLL_MS * 1000);
+    }
+    return ESP_OK;
+}
+
+// GET /api/assemblies/sizes
+static esp_err_t api_get_assembly_sizes_handler(httpd_req_t *req)
+{
+    refresh_images();
+    webui_json_writer_t writer;
+    webui_json_begin(&writer, req, "200 OK");
+    webui_json_add_uint(&writer, "input_assembly", ASSEMBLIES_INPUT);
+    webui_json_add_uint(&writer, "input_assembly_size", (uint32_t)s_input.length);
+    webui_json_add_uint(&writer, "output_assembly", ASSEMBLIES_OUTPUT);
+    webui_json_add_uint(&writer, "output_assembly_size", (uint32_t)s_output.length);
+    return webui_json_end(&writer);
+}
+
+static void register_handler(httpd_handle_t server, const httpd_uri_t *uri)
+{
+    esp_err_t ret = webui_register_uri_handler(server, uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET %s: %s", uri->uri, esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered GET %s handler", uri->uri);
+    }
+}
+
+void webui_register_assemblies_handlers(httpd_handle_t server)
+{
+    if (s_poll_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = poll_timer_expired,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "webui_asm",
+        };
+        if (esp_timer_create(&timer_args, &s_poll_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create poll timer, long polls answer at once");
+            s_poll_timer = NULL;
+        }
+    }
+    s_server = server;
+
+    const httpd_uri_t assemblies_uri = {
+        .uri       = "/api/assemblies",
+        .method    = HTTP_GET,
+        .handler   = api_get_assemblies_handler,
+        .user_ctx  = NULL
+    };
+    register_handler(server, &assemblies_uri);
+    const httpd_uri_t sizes_uri = {
+        .uri       = "/api/assemblies/sizes",
+        .method    = HTTP_GET,
+        .handler   = api_get_assembly_sizes_handler,
+        .user_ctx  = NULL
+    };
+    register_handler(server, &sizes_uri);
+}
+
+// Runs in the httpd task before it handles the shutdown queued after it
+static void finish_all_waiters(void *arg)
+{
+    (void)arg;
+    for (size_t i = 0; i < ASSEMBLIES_MAX_WAITERS; i++) {
+        if (s_waiters[i].req != NULL) {
+            finish_waiter(&s_waiters[i], false);
+        }
+    }
+}
+
+void webui_assemblies_stop(void)
+{
+    if (s_poll_timer != NULL) {
+        esp_timer_stop(s_poll_timer);
+    }
+    if (s_server != NULL) {
+        httpd_queue_work(s_server, finish_all_waiters, NULL);
+    }
+    s_server = NULL;
+}
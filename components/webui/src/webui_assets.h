@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef WEBUI_ASSETS_H
+#define WEBUI_ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Static file served by the web UI, gzip compressed at build time
+ */
+typedef struct {
+    const char *uri;
+    const char *content_type;
+    const char *cache_control;
+    const char *etag;           // strong ETag including the quotes
+    const uint8_t *data;        // gzip stream
+    size_t length;
+} webui_asset_t;
+
+// Defined in webui_assets.c, generated by scripts/embed_web_assets.py
+extern const webui_asset_t webui_assets[];
+extern const size_t webui_asset_count;
+
+#endif // WEBUI_ASSETS_H
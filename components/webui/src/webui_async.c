@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "webui_async.h"
+#include "webui_wcet.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+
+static const char *TAG = "webui_async";
+
+typedef struct {
+    httpd_req_t *req; // copy owned by the worker until it completes it
+    webui_async_handler_t handler;
+#if CONFIG_OPENER_WCET_PROFILE
+    const void *wcet; // handler that submitted the job, timed in the worker as well
+#endif
+} webui_async_job_t;
+
+static QueueHandle_t s_jobs = NULL;
+// One count per idle worker, so a job is only queued when a worker takes it
+static SemaphoreHandle_t s_idle_workers = NULL;
+
+static void async_worker_task(void *arg)
+{
+    (void)arg;
+    webui_async_job_t job;
+    while (true) {
+        if (xQueueReceive(s_jobs, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+#if CONFIG_OPENER_WCET_PROFILE
+        const uint32_t start = WcetProfileGetCycleCount();
+        (void)job.handler(job.req);
+        webui_wcet_record(job.wcet, WcetProfileGetCycleCount() - start);
+#else
+        (void)job.handler(job.req);
+#endif
+        if (httpd_req_async_handler_complete(job.req) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to complete %s", job.req->uri);
+        }
+        xSemaphoreGive(s_idle_workers);
+    }
+}
+
+bool webui_async_start(size_t stack_size, unsigned priority, int core)
+{
+#if CONFIG_WEBUI_ASYNC_WORKERS == 0
+    (void)stack_size;
+    (void)priority;
+    (void)core;
+    (void)async_worker_task;
+    return false;
+#else
+    if (s_jobs != NULL) {
+        return true;
+    }
+    s_jobs = xQueueCreate(CONFIG_WEBUI_ASYNC_WORKERS, sizeof(webui_async_job_t));
+    s_idle_workers = xSemaphoreCreateCounting(CONFIG_WEBUI_ASYNC_WORKERS, 0);
+    if (s_jobs == NULL || s_idle_workers == NULL) {
+        ESP_LOGE(TAG, "No memory for the worker queue");
+        return false;
+    }
+    unsigned started = 0;
+    for (unsigned i = 0; i < CONFIG_WEBUI_ASYNC_WORKERS; i++) {
+        char name[configMAX_TASK_NAME_LEN];
+        snprintf(name, sizeof(name), "httpd_wk%u", i);
+        if (xTaskCreatePinnedToCore(async_worker_task, name, stack_size, NULL,
+                                    priority, NULL, core) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create worker %u", i);
+            break;
+        }
+        xSemaphoreGive(s_idle_workers);
+        started++;
+    }
+    ESP_LOGI(TAG, "%u workers for slow handlers", started);
+    return started != 0;
+#endif
+}
+
+esp_err_t webui_async_submit(httpd_req_t *req, webui_async_handler_t handler)
+{
+    if (s_idle_workers == NULL) {
+        return handler(req);
+    }
+    if (xSemaphoreTake(s_idle_workers, 0) != pdTRUE) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_set_type(req, "application/json");
+        return httpd_resp_sendstr(req, "{\"status\":\"error\",\"message\":\"Busy, retry\"}");
+    }
+    webui_async_job_t job = { .req = NULL, .handler = handler };
+#if CONFIG_OPENER_WCET_PROFILE
+    job.wcet = webui_wcet_current();
+#endif
+    if (httpd_req_async_handler_begin(req, &job.req) != ESP_OK) {
+        xSemaphoreGive(s_idle_workers);
+        return handler(req);
+    }
+    // A worker is idle, so the queue has room
+    (void)xQueueSend(s_jobs, &job, 0);
+    return ESP_OK;
+}
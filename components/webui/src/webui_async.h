@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef WEBUI_ASYNC_H
+#define WEBUI_ASYNC_H
+
+#include "esp_http_server.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Handlers that take long, run by a pool of worker tasks
+ *
+ * httpd serves all sockets from one task, so a handler that writes the NVS
+ * or streams a download stalls every other request meanwhile. Such a
+ * handler is registered through webui_async_submit(): the request is taken
+ * over with httpd_req_async_handler_begin() and run by one of
+ * CONFIG_WEBUI_ASYNC_WORKERS tasks, and httpd goes on with the other
+ * sockets. Handlers run this way may block but must not share static
+ * buffers, several of them can run at once.
+ *
+ * With all workers busy the request is answered with 503 and a Retry-After
+ * right away. Without workers (CONFIG_WEBUI_ASYNC_WORKERS 0, or a task that
+ * could not be created) the handler runs in the httpd task as before.
+ */
+
+typedef esp_err_t (*webui_async_handler_t)(httpd_req_t *req);
+
+/**
+ * @brief Create the worker tasks, once before the first request
+ *
+ * @param stack_size stack of each worker, that of the httpd task
+ * @param priority priority of the workers, that of the httpd task
+ * @param core core of the workers, that of the httpd task
+ * @return false if no worker could be created
+ */
+bool webui_async_start(size_t stack_size, unsigned priority, int core);
+
+/**
+ * @brief Run handler in a worker, from an httpd URI handler
+ *
+ * @return ESP_OK once the request is handed over or answered with 503,
+ *         otherwise the result of handler run in the httpd task
+ */
+esp_err_t webui_async_submit(httpd_req_t *req, webui_async_handler_t handler);
+
+#endif // WEBUI_ASYNC_H
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// WebSocket /ws/io: pushes the I/O assembly images and connection counters as
+// compact binary frames, see README.md for the frame layout
+
+#include "webui_api.h"
+#include "webui_wcet.h"
+#include "sdkconfig.h"
+
+#if CONFIG_HTTPD_WS_SUPPORT
+
+#include "cipassembly.h"
+#include "cipconnectiondiagnostics.h"
+#include "overload_governor.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+static const char *TAG = "webui_io";
+
+// Assembly instances of the KC868-A16 application
+#define IO_STREAM_INPUT_ASSEMBLY    100
+#define IO_STREAM_OUTPUT_ASSEMBLY   150
+#define IO_STREAM_MAX_IMAGE_SIZE    64
+
+#define IO_STREAM_MAX_CLIENTS       2
+// Period the images are checked for changes
+#define IO_STREAM_POLL_MS           20
+#define IO_STREAM_MAX_INTERVAL_MS   10000
+// Shortest push interval while the stack is overloaded
+#define IO_STREAM_OVERLOAD_INTERVAL_MS 1000
+
+#define IO_STREAM_FRAME_VERSION     1
+#define IO_STREAM_HEADER_SIZE       32
+
+typedef struct {
+    int fd;                  // -1 if the slot is free
+    uint32_t interval_ms;    // 0: send on change only
+    int64_t last_sent_us;    // 0: nothing sent yet
+    uint32_t input_version;
+    uint32_t output_version;
+} io_stream_client_t;
+
+static httpd_handle_t s_server = NULL;
+static esp_timer_handle_t s_poll_timer = NULL;
+static bool s_push_pending = false;
+static uint32_t s_frame_sequence = 0;
+
+// Only touched from the httpd task: the URI handler and the queued push work
+static io_stream_client_t s_clients[IO_STREAM_MAX_CLIENTS] = {
+    { .fd = -1 }, { .fd = -1 },
+};
+static size_t s_client_count = 0;
+
+static void put_u16(uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t *buffer, uint32_t value)
+{
+    put_u16(buffer, (uint16_t)value);
+    put_u16(buffer + 2, (uint16_t)(value >> 16));
+}
+
+static void remove_client(io_stream_client_t *client)
+{
+    ESP_LOGI(TAG, "Client on socket %d left", client->fd);
+    client->fd = -1;
+    s_client_count--;
+}
+
+static io_stream_client_t *find_client(int fd)
+{
+    for (size_t i = 0; i < IO_STREAM_MAX_CLIENTS; i++) {
+        if (s_clients[i].fd == fd) {
+            return &s_clients[i];
+        }
+    }
+    return NULL;
+}
+
+static void push_frames(void *arg)
+{
+    (void)arg;
+    __atomic_store_n(&s_push_pending, false, __ATOMIC_RELEASE);
+
+    uint8_t frame_data[IO_STREAM_HEADER_SIZE + 2 * IO_STREAM_MAX_IMAGE_SIZE];
+    uint8_t *input = frame_data + IO_STREAM_HEADER_SIZE;
+    size_t input_length = 0;
+    uint32_t input_version = 0;
+    if (GetAssemblyDataSnapshot(IO_STREAM_INPUT_ASSEMBLY, input, IO_STREAM_MAX_IMAGE_SIZE,
+                                &input_length, &input_version) != kEipStatusOk) {
+        return; // stack is writing the image, try again on the next poll
+    }
+    uint8_t *output = input + input_length;
+    size_t output_length = 0;
+    uint32_t output_version = 0;
+    if (GetAssemblyDataSnapshot(IO_STREAM_OUTPUT_ASSEMBLY, output, IO_STREAM_MAX_IMAGE_SIZE,
+                                &output_length, &output_version) != kEipStatusOk) {
+        return;
+    }
+
+    const int64_t now = esp_timer_get_time();
+    bool counters_valid = false;
+    uint16_t connections = 0;
+    uint32_t produced = 0;
+    uint32_t consumed = 0;
+
+    for (size_t i = 0; i < IO_STREAM_MAX_CLIENTS; i++) {
+        io_stream_client_t *client = &s_clients[i];
+        if (client->fd < 0) {
+            continue;
+        }
+        if (httpd_ws_get_fd_info(s_server, client->fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            remove_client(client);
+            continue;
+        }
+
+        bool due = client->last_sent_us == 0;
+        if (client->interval_ms == 0) {
+            due = due || client->input_version != input_version ||
+                  client->output_version != output_version;
+        } else {
+            due = due || now - client->last_sent_us >= (int64_t)client->interval_ms * 1000;
+        }
+        if (due && client->last_sent_us != 0 &&
+            OverloadGovernorIsShedding(kOverloadStageServices) &&
+            now - client->last_sent_us < (int64_t)IO_STREAM_OVERLOAD_INTERVAL_MS * 1000) {
+            due = false;
+        }
+        if (!due) {
+            continue;
+        }
+
+        // Counters are summed once per push and only if a client needs them
+        if (!counters_valid) {
+            CipConnectionDiagnostics diagnostics;
+            for (size_t index = 0; CipConnectionDiagnosticsGet(index, &diagnostics); index++) {
+                if (diagnostics.connection_id != 0) {
+                    connections++;
+                }
+                produced += diagnostics.produced.packets;
+                consumed += diagnostics.consumed.packets;
+            }
+            counters_valid = true;
+        }
+
+        frame_data[0] = IO_STREAM_FRAME_VERSION;
+        frame_data[1] = (uint8_t)input_length;
+        frame_data[2] = (uint8_t)output_length;
+        frame_data[3] = 0;
+        put_u32(frame_data + 4, s_frame_sequence++);
+        put_u32(frame_data + 8, (uint32_t)(now / 1000));
+        put_u32(frame_data + 12, input_version);
+        put_u32(frame_data + 16, output_version);
+        put_u16(frame_data + 20, connections);
+        put_u16(frame_data + 22, 0);
+        put_u32(frame_data + 24, produced);
+        put_u32(frame_data + 28, consumed);
+
+        httpd_ws_frame_t frame = {
+            .type = HTTPD_WS_TYPE_BINARY,
+            .payload = frame_data,
+            .len = IO_STREAM_HEADER_SIZE + input_length + output_length,
+        };
+        if (httpd_ws_send_frame_async(s_server, client->fd, &frame) != ESP_OK) {
+            remove_client(client);
+            continue;
+        }
+        client->last_sent_us = now;
+        client->input_version = input_version;
+        client->output_version = output_version;
+    }
+
+    if (s_client_count == 0) {
+        esp_timer_stop(s_poll_timer);
+    }
+}
+
+// Runs in the esp_timer task, hands the push over to the httpd task
+static void poll_timer_expired(void *arg)
+{
+    (void)arg;
+    if (__atomic_exchange_n(&s_push_pending, true, __ATOMIC_ACQ_REL)) {
+        return; // previous push still queued
+    }
+    if (httpd_queue_work(s_server, push_frames, NULL) != ESP_OK) {
+        __atomic_store_n(&s_push_pending, false, __ATOMIC_RELEASE);
+    }
+}
+
+static esp_err_t add_client(int fd)
+{
+    io_stream_client_t *client = find_client(-1);
+    if (client == NULL) {
+        ESP_LOGW(TAG, "Rejecting socket %d, %d clients already connected", fd,
+                 IO_STREAM_MAX_CLIENTS);
+        return ESP_FAIL;
+    }
+    *client = (io_stream_client_t) { .fd = fd };
+    s_client_count++;
+    ESP_LOGI(TAG, "Client on socket %d connected", fd);
+
+    if (!esp_timer_is_active(s_poll_timer)) {
+        esp_timer_start_periodic(s_poll_timer, IO_STREAM_POLL_MS * 1000);
+    }
+    return ESP_OK;
+}
+
+// Text frame {"interval_ms": N} sets the push rate, 0 for on change only
+static void handle_client_message(int fd, const char *text)
+{
+    io_stream_client_t *client = find_client(fd);
+    cJSON *json = cJSON_Parse(text);
+    if (client == NULL || json == NULL) {
+        cJSON_Delete(json);
+        return;
+    }
+    cJSON *item = cJSON_GetObjectItem(json, "interval_ms");
+    if (item != NULL && cJSON_IsNumber(item)) {
+        double interval = cJSON_GetNumberValue(item);
+        if (interval <= 0) {
+            client->interval_ms = 0;
+        } else if (interval < IO_STREAM_POLL_MS) {
+            client->interval_ms = IO_STREAM_POLL_MS;
+        } else if (interval > IO_STREAM_MAX_INTERVAL_MS) {
+            client->interval_ms = IO_STREAM_MAX_INTERVAL_MS;
+        } else {
+            client->interval_ms = (uint32_t)interval;
+        }
+        ESP_LOGI(TAG, "Socket %d interval %" PRIu32 " ms", fd, client->interval_ms);
+    }
+    cJSON_Delete(json);
+}
+
+static esp_err_t ws_io_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    if (req->method == HTTP_GET) {
+        // Handshake completed
+        return add_client(fd);
+    }
+
+    httpd_ws_frame_t frame = { 0 };
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    char text[64];
+    if (frame.type != HTTPD_WS_TYPE_TEXT || frame.len == 0 || frame.len >= sizeof(text)) {
+        return ESP_OK;
+    }
+    frame.payload = (uint8_t *)text;
+    ret = httpd_ws_recv_frame(req, &frame, frame.len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    text[frame.len] = '\0';
+    handle_client_message(fd, text);
+    return ESP_OK;
+}
+
+void webui_register_io_stream_handler(httpd_handle_t server)
+{
+    if (s_poll_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = poll_timer_expired,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "webui_io",
+        };
+        if (esp_timer_create(&timer_args, &s_poll_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create poll timer");
+            return;
+        }
+    }
+    s_server = server;
+
+    httpd_uri_t ws_io_uri = {
+        .uri          = "/ws/io",
+        .method       = HTTP_GET,
+        .handler      = ws_io_handler,
+        .user_ctx     = NULL,
+        .is_websocket = true,
+    };
+    esp_err_t ret = webui_register_uri_handler(server, &ws_io_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register /ws/io: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Registered /ws/io handler");
+    }
+}
+
+void webui_io_stream_stop(void)
+{
+    if (s_poll_timer != NULL) {
+        esp_timer_stop(s_poll_timer);
+    }
+    for (size_t i = 0; i < IO_STREAM_MAX_CLIENTS; i++) {
+        s_clients[i].fd = -1;
+    }
+    s_client_count = 0;
+    s_server = NULL;
+}
+
+#else
+
+void webui_register_io_stream_handler(httpd_handle_t server)
+{
+    (void)server;
+}
+
+void webui_io_stream_stop(void)
+{
+}
+
+#endif // CONFIG_HTTPD_WS_SUPPORT
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "webui_json.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+static void flush(webui_json_writer_t *writer)
+{
+    if (writer->used == 0 || writer->error != ESP_OK) {
+        return;
+    }
+    writer->error = httpd_resp_send_chunk(writer->req, writer->buffer, writer->used);
+    writer->used = 0;
+    writer->flushed = true;
+}
+
+static void put(webui_json_writer_t *writer, const char *text, size_t length)
+{
+    while (length > 0 && writer->error == ESP_OK) {
+        size_t space = sizeof(writer->buffer) - writer->used;
+        if (space == 0) {
+            flush(writer);
+            continue;
+        }
+        size_t count = length < space ? length : space;
+        memcpy(writer->buffer + writer->used, text, count);
+        writer->used += count;
+        text += count;
+        length -= count;
+    }
+}
+
+static void put_text(webui_json_writer_t *writer, const char *text)
+{
+    put(writer, text, strlen(text));
+}
+
+// Escapes quotes, backslashes and control characters
+static void put_escaped(webui_json_writer_t *writer, const char *text, size_t length)
+{
+    const char *run = text;
+    const char *end = text + length;
+    for (const char *c = text; c < end; c++) {
+        unsigned char ch = (unsigned char)*c;
+        if (ch != '"' && ch != '\\' && ch >= 0x20) {
+            continue;
+        }
+        put(writer, run, c - run);
+        char escape[8];
+        if (ch == '"' || ch == '\\') {
+            escape[0] = '\\';
+            escape[1] = (char)ch;
+            put(writer, escape, 2);
+        } else {
+            int escape_length = snprintf(escape, sizeof(escape), "\\u%04x", ch);
+            put(writer, escape, (size_t)escape_length);
+        }
+        run = c + 1;
+    }
+    put(writer, run, end - run);
+}
+
+static void put_quoted(webui_json_writer_t *writer, const char *text)
+{
+    put(writer, "\"", 1);
+    put_escaped(writer, text, strlen(text));
+    put(writer, "\"", 1);
+}
+
+// Separator and key in front of every member or element
+static void put_member(webui_json_writer_t *writer, const char *key)
+{
+    if (writer->has_members[writer->depth]) {
+        put(writer, ",", 1);
+    }
+    writer->has_members[writer->depth] = true;
+    if (key != NULL) {
+        put_quoted(writer, key);
+        put(writer, ":", 1);
+    }
+}
+
+static void open_container(webui_json_writer_t *writer, const char *key, const char *bracket)
+{
+    put_member(writer, key);
+    put(writer, bracket, 1);
+    if (writer->depth + 1 < WEBUI_JSON_MAX_DEPTH) {
+        writer->depth++;
+        writer->has_members[writer->depth] = false;
+    } else if (writer->error == ESP_OK) {
+        writer->error = ESP_ERR_INVALID_STATE; // programming error, drop the rest
+    }
+}
+
+static void close_container(webui_json_writer_t *writer, const char *bracket)
+{
+    if (writer->depth > 0) {
+        writer->depth--;
+    }
+    put(writer, bracket, 1);
+}
+
+void webui_json_begin(webui_json_writer_t *writer, httpd_req_t *req, const char *status)
+{
+    writer->req = req;
+    writer->error = ESP_OK;
+    writer->used = 0;
+    writer->flushed = false;
+    writer->depth = 0;
+    writer->has_members[0] = false;
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_status(req, status);
+    // The root object is the only member of level 0
+    open_container(writer, NULL, "{");
+}
+
+esp_err_t webui_json_end(webui_json_writer_t *writer)
+{
+    close_container(writer, "}");
+    if (writer->error != ESP_OK) {
+        return writer->error;
+    }
+    if (!writer->flushed) {
+        return httpd_resp_send(writer->req, writer->buffer, writer->used);
+    }
+    flush(writer);
+    if (writer->error != ESP_OK) {
+        return writer->error;
+    }
+    return httpd_resp_send_chunk(writer->req, NULL, 0);
+}
+
+void webui_json_begin_object(webui_json_writer_t *writer, const char *key)
+{
+    open_container(writer, key, "{");
+}
+
+void webui_json_end_object(webui_json_writer_t *writer)
+{
+    close_container(writer, "}");
+}
+
+void webui_json_begin_array(webui_json_writer_t *writer, const char *key)
+{
+    open_container(writer, key, "[");
+}
+
+void webui_json_end_array(webui_json_writer_t *writer)
+{
+    close_container(writer, "]");
+}
+
+void webui_json_add_string(webui_json_writer_t *writer, const char *key, const char *value)
+{
+    put_member(writer, key);
+    put_quoted(writer, value != NULL ? value : "");
+}
+
+void webui_json_begin_string(webui_json_writer_t *writer, const char *key)
+{
+    put_member(writer, key);
+    put(writer, "\"", 1);
+}
+
+void webui_json_append_string(webui_json_writer_t *writer, const char *text, size_t length)
+{
+    put_escaped(writer, text, length);
+}
+
+void webui_json_end_string(webui_json_writer_t *writer)
+{
+    put(writer, "\"", 1);
+}
+
+void webui_json_add_uint(webui_json_writer_t *writer, const char *key, uint32_t value)
+{
+    char number[12];
+    int length = snprintf(number, sizeof(number), "%" PRIu32, value);
+    put_member(writer, key);
+    put(writer, number, (size_t)length);
+}
+
+void webui_json_add_uint64(webui_json_writer_t *writer, const char *key, uint64_t value)
+{
+    char number[21];
+    int length = snprintf(number, sizeof(number), "%" PRIu64, value);
+    put_member(writer, key);
+    put(writer, number, (size_t)length);
+}
+
+void webui_json_add_int(webui_json_writer_t *writer, const char *key, int32_t value)
+{
+    char number[12];
+    int length = snprintf(number, sizeof(number), "%" PRId32, value);
+    put_member(writer, key);
+    put(writer, number, (size_t)length);
+}
+
+void webui_json_add_bool(webui_json_writer_t *writer, const char *key, bool value)
+{
+    put_member(writer, key);
+    put_text(writer, value ? "true" : "false");
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef WEBUI_JSON_H
+#define WEBUI_JSON_H
+
+#include "esp_http_server.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bytes collected before they are sent as one chunk
+#define WEBUI_JSON_BUFFER_SIZE 512
+// Deepest nesting of objects and arrays, the root object included
+#define WEBUI_JSON_MAX_DEPTH 8
+
+/**
+ * @brief Writer that streams a compact JSON document into an HTTP response
+ *
+ * Lives on the handler's stack; nothing is allocated. Output is collected in
+ * the buffer and sent with httpd_resp_send_chunk() whenever it is full. A
+ * document that fits into the buffer is sent in one piece with a
+ * Content-Length instead. After the first send error all further output is
+ * dropped and webui_json_end() reports the error.
+ *
+ * Keys are only used inside objects, pass NULL for array elements.
+ */
+typedef struct {
+    httpd_req_t *req;
+    esp_err_t error;
+    size_t used;
+    bool flushed;                          // a chunk went out already
+    uint8_t depth;
+    bool has_members[WEBUI_JSON_MAX_DEPTH]; // a comma is due before the next member
+    char buffer[WEBUI_JSON_BUFFER_SIZE];
+} webui_json_writer_t;
+
+/**
+ * @brief Start a response of type application/json and open its root object
+ *
+ * @param status HTTP status line, e.g. "200 OK"
+ */
+void webui_json_begin(webui_json_writer_t *writer, httpd_req_t *req, const char *status);
+
+/**
+ * @brief Close the root object and finish the response
+ *
+ * @return ESP_OK, or the first error of sending the response
+ */
+esp_err_t webui_json_end(webui_json_writer_t *writer);
+
+void webui_json_begin_object(webui_json_writer_t *writer, const char *key);
+void webui_json_end_object(webui_json_writer_t *writer);
+void webui_json_begin_array(webui_json_writer_t *writer, const char *key);
+void webui_json_end_array(webui_json_writer_t *writer);
+
+void webui_json_add_string(webui_json_writer_t *writer, const char *key, const char *value);
+void webui_json_add_uint(webui_json_writer_t *writer, const char *key, uint32_t value);
+void webui_json_add_uint64(webui_json_writer_t *writer, const char *key, uint64_t value);
+void webui_json_add_int(webui_json_writer_t *writer, const char *key, int32_t value);
+void webui_json_add_bool(webui_json_writer_t *writer, const char *key, bool value);
+
+/**
+ * @brief Write a string member in pieces, for text too long to hold in memory
+ *
+ * webui_json_append_string() escapes and adds the next piece; nothing else
+ * may be added until webui_json_end_string() closes the string.
+ */
+void webui_json_begin_string(webui_json_writer_t *writer, const char *key);
+void webui_json_append_string(webui_json_writer_t *writer, const char *text, size_t length);
+void webui_json_end_string(webui_json_writer_t *writer);
+
+#endif // WEBUI_JSON_H
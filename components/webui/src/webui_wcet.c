@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "webui_wcet.h"
+
+#if CONFIG_OPENER_WCET_PROFILE
+
+#include "esp_log.h"
+
+static const char *TAG = "webui_wcet";
+
+// One per handler, up to the max_uri_handlers of the server
+#define WEBUI_WCET_HANDLERS 40
+
+typedef struct {
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+    const char *uri;
+    CipUint number;
+    CipUsint method;
+} webui_wcet_handler_t;
+
+static webui_wcet_handler_t s_handlers[WEBUI_WCET_HANDLERS];
+static size_t s_handler_count = 0;
+// Set while a timed handler runs; httpd runs one request at a time
+static const webui_wcet_handler_t *s_current = NULL;
+
+static esp_err_t timed_handler(httpd_req_t *req)
+{
+    const webui_wcet_handler_t *handler = req->user_ctx;
+    // The handler gets the context it was registered with
+    req->user_ctx = handler->user_ctx;
+    s_current = handler;
+    const uint32_t start = WcetProfileGetCycleCount();
+    esp_err_t ret = handler->handler(req);
+    webui_wcet_record(handler, WcetProfileGetCycleCount() - start);
+    s_current = NULL;
+    return ret;
+}
+
+esp_err_t webui_register_uri_handler(httpd_handle_t server, const httpd_uri_t *uri)
+{
+    // A restarted server registers the same handlers again
+    size_t index = 0;
+    while (index < s_handler_count &&
+           (s_handlers[index].uri != uri->uri || s_handlers[index].method != (CipUsint)uri->method)) {
+        index++;
+    }
+    if (index >= WEBUI_WCET_HANDLERS) {
+        ESP_LOGW(TAG, "%s is not timed, no room", uri->uri);
+        return httpd_register_uri_handler(server, uri);
+    }
+    webui_wcet_handler_t *handler = &s_handlers[index];
+    handler->handler = uri->handler;
+    handler->user_ctx = uri->user_ctx;
+    handler->uri = uri->uri;
+    handler->number = (CipUint)(index + 1);
+    handler->method = (CipUsint)uri->method;
+
+    httpd_uri_t timed = *uri;
+    timed.handler = timed_handler;
+    timed.user_ctx = handler;
+    esp_err_t ret = httpd_register_uri_handler(server, &timed);
+    if (ret == ESP_OK && index == s_handler_count) {
+        s_handler_count++;
+    }
+    return ret;
+}
+
+const void *webui_wcet_current(void)
+{
+    return s_current;
+}
+
+void webui_wcet_record(const void *handler, uint32_t cycles)
+{
+    const webui_wcet_handler_t *timed = handler;
+    if (timed == NULL) {
+        return;
+    }
+    WcetProfileRecord(kWcetProfileKindWeb, timed->number, timed->method, timed->uri, 0, 0, cycles);
+}
+
+#endif
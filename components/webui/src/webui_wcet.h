@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef WEBUI_WCET_H
+#define WEBUI_WCET_H
+
+#include "esp_http_server.h"
+#include "sdkconfig.h"
+
+/**
+ * @brief URI handlers timed by the WCET profile
+ *
+ * With CONFIG_OPENER_WCET_PROFILE every handler registered through
+ * webui_register_uri_handler() runs behind a dispatcher that records its
+ * longest call in the WCET profile of the stack, see wcet_profile.h. The
+ * entry's class is the handler's number, its code the HTTP method and its
+ * name the URI. A handler passed to webui_async_submit() is also timed in
+ * the worker, under the same entry. Without the option the handler is
+ * registered as it is.
+ */
+
+#if CONFIG_OPENER_WCET_PROFILE
+
+#include "wcet_profile.h"
+
+/** @brief httpd_register_uri_handler() with the handler timed */
+esp_err_t webui_register_uri_handler(httpd_handle_t server, const httpd_uri_t *uri);
+
+/**
+ * @brief The handler running in the httpd task, for webui_async_submit()
+ *
+ * @return opaque handle to pass to webui_wcet_record(), NULL outside a
+ *         timed handler
+ */
+const void *webui_wcet_current(void);
+
+/**
+ * @brief Record a call of the handler of webui_wcet_current()
+ *
+ * @param handler value of webui_wcet_current(), ignored if NULL
+ * @param cycles duration in CPU cycles
+ */
+void webui_wcet_record(const void *handler, uint32_t cycles);
+
+#else
+
+static inline esp_err_t webui_register_uri_handler(httpd_handle_t server, const httpd_uri_t *uri)
+{
+    return httpd_register_uri_handler(server, uri);
+}
+
+#endif
+
+#endif // WEBUI_WCET_H
@@ -25,6 +25,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_netif.h"
 #include "esp_netif_net_stack.h"
 #include "esp_event.h"
@@ -37,33 +38,116 @@
 #include "nvs_flash.h"
 #include "lwip/netif.h"
 #include "lwip/ip4_addr.h"
+#include "lwip/etharp.h"
+#include "lwip/tcpip.h"
+#include "lwip/acd.h"
 #include "opener.h"
 #include "webui.h"
 #include "ciptcpipinterface.h"
 #include "nvtcpip.h"
+#include "nvconfig.h"
+#include "production_scheduler.h"
+#include "eth_media_counters.h"
+#include "eth_rx_moderation.h"
+#include "eth_link_control.h"
+#include "multicast_filter.h"
+#include "netif_status.h"
+#include "mgmt_eth.h"
+#include "log_buffer.h"
+#include "task_placement.h"
+#include "warm_restart.h"
+#include "kc868_a16_io.h"
 
 static const char *TAG = "main";
 static esp_netif_t *s_eth_netif = NULL;
+static esp_eth_handle_t s_eth_handle = NULL;
+// TCP/IP attribute 12 set with a static address, read at power-up
+static bool s_quick_connect = false;
 
 #define ETH_PHY_ADDR         0
 #define ETH_PHY_MDC_PIN       23
 #define ETH_PHY_MDIO_PIN      18
 
+// Fast boot: how long the PHY may take to answer after power-on
+#define ETH_PHY_READY_TIMEOUT_MS  1000
+#define ETH_PHY_POLL_MS           10
+
+#ifndef CONFIG_OPENER_FAST_BOOT
+#define CONFIG_OPENER_FAST_BOOT 0
+#endif
+#ifndef CONFIG_OPENER_ACD_STARTUP_OPTIMISTIC
+#define CONFIG_OPENER_ACD_STARTUP_OPTIMISTIC 0
+#endif
+
+// Start up runs in the app_main loop instead of the default event loop
+// task, whose handlers only notify it. Link and IP events keep being
+// dispatched while the stack is built.
+#define STARTUP_NOTIFY_GOT_IP  (1U << 5)
+#define WEBUI_INIT_STACK_SIZE  4096
+#define WEBUI_INIT_PRIORITY    5
+
+typedef enum {
+    STARTUP_WAIT_ADDRESS,  // no address yet
+    STARTUP_RUNNING,       // EtherNet/IP started and the web UI launched
+} startup_state_t;
+
+static TaskHandle_t s_main_task = NULL;
+static startup_state_t s_startup_state = STARTUP_WAIT_ADDRESS;
+
+#if CONFIG_LWIP_DHCP_DOES_ACD_CHECK
+// ACD of the static address (TCP/IP attribute 10). The lwIP task runs the
+// probe and defense, its results are handled by the app_main loop, which
+// may take the stack lock.
+#define ACD_NOTIFY_ADDRESS_OK  (1U << 0)
+#define ACD_NOTIFY_CONFLICT    (1U << 1)
+#define ACD_NOTIFY_RESTART     (1U << 2)
+#define ACD_NOTIFY_LINK_UP     (1U << 3)
+#define ACD_NOTIFY_LINK_DOWN   (1U << 4)
+
+static struct acd s_static_acd;
+static bool s_static_acd_enabled = false;
+// EtherNet/IP starts at link up while the probe runs, instead of after it
+static bool s_acd_optimistic = false;
+static bool s_static_ip_assigned = false;
+static esp_netif_ip_info_t s_static_ip_info;
+static unsigned int s_acd_retries = 0;
+static int64_t s_acd_retry_at_us = 0;  // 0: no retry pending
+#endif
+
 static void eth_event_handler(void *arg, esp_event_base_t event_base,
                                    int32_t event_id, void *event_data)
 {
     uint8_t mac_addr[6] = {0};
     esp_eth_handle_t eth_handle = *(esp_eth_handle_t *)event_data;
 
+    if (eth_handle != s_eth_handle) {
+        // The management port, it has no part in EtherNet/IP
+        if (event_id == ETHERNET_EVENT_CONNECTED || event_id == ETHERNET_EVENT_DISCONNECTED) {
+            ESP_LOGI(TAG, "Management port link %s",
+                     event_id == ETHERNET_EVENT_CONNECTED ? "up" : "down");
+        }
+        return;
+    }
+
     switch (event_id) {
     case ETHERNET_EVENT_CONNECTED:
         esp_eth_ioctl(eth_handle, ETH_CMD_G_MAC_ADDR, mac_addr);
-        ESP_LOGI(TAG, "Ethernet Link Up");
+        ESP_LOGI(TAG, "Ethernet Link Up %lld ms after power-on", esp_timer_get_time() / 1000);
         ESP_LOGI(TAG, "Ethernet HW Addr %02x:%02x:%02x:%02x:%02x:%02x",
                  mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
+#if CONFIG_LWIP_DHCP_DOES_ACD_CHECK
+        if (s_static_acd_enabled) {
+            xTaskNotify(s_main_task, ACD_NOTIFY_LINK_UP, eSetBits);
+        }
+#endif
         break;
     case ETHERNET_EVENT_DISCONNECTED:
         ESP_LOGI(TAG, "Ethernet Link Down");
+#if CONFIG_LWIP_DHCP_DOES_ACD_CHECK
+        if (s_static_acd_enabled) {
+            xTaskNotify(s_main_task, ACD_NOTIFY_LINK_DOWN, eSetBits);
+        }
+#endif
         break;
     case ETHERNET_EVENT_START:
         ESP_LOGI(TAG, "Ethernet Started");
@@ -76,40 +160,227 @@ static void eth_event_handler(void *arg, esp_event_base_t event_base,
     }
 }
 
+// Runs in the lwIP task: announce the address, so that a scanner with a
+// stale ARP entry updates it, and resolve the gateway before the first
+// Forward Open reply to a routed originator needs it
+static void quick_connect_prime_arp(void *ctx)
+{
+    struct netif *lwip_netif = (struct netif *)ctx;
+    etharp_gratuitous(lwip_netif);
+    const ip4_addr_t *gateway = netif_ip4_gw(lwip_netif);
+    if (gateway != NULL && !ip4_addr_isany(gateway)) {
+        etharp_request(lwip_netif, gateway);
+    }
+}
+
+#if CONFIG_LWIP_DHCP_DOES_ACD_CHECK
+// Runs in the lwIP task
+static void static_acd_callback(struct netif *netif, acd_callback_enum_t state)
+{
+    (void)netif;
+    switch (state) {
+    case ACD_IP_OK:
+        xTaskNotify(s_main_task, ACD_NOTIFY_ADDRESS_OK, eSetBits);
+        break;
+    case ACD_DECLINE:
+        xTaskNotify(s_main_task, ACD_NOTIFY_CONFLICT, eSetBits);
+        break;
+    case ACD_RESTART_CLIENT:
+        xTaskNotify(s_main_task, ACD_NOTIFY_RESTART, eSetBits);
+        break;
+    default:
+        break;
+    }
+}
+
+// Runs in the lwIP task
+static void static_acd_start(void *ctx)
+{
+    struct netif *lwip_netif = (struct netif *)ctx;
+    ip4_addr_t address = { .addr = s_static_ip_info.ip.addr };
+    acd_add(lwip_netif, &s_static_acd, static_acd_callback);
+    acd_start(lwip_netif, &s_static_acd, address);
+}
+
+static void static_acd_probe(void)
+{
+    struct netif *lwip_netif = esp_netif_get_netif_impl(s_eth_netif);
+    if (lwip_netif != NULL) {
+        ESP_LOGI(TAG, "ACD: probing " IPSTR "%s", IP2STR(&s_static_ip_info.ip),
+                 s_static_ip_assigned ? " in the background" : "");
+        tcpip_callback(static_acd_start, lwip_netif);
+    }
+}
+
+static void set_acd_status(CipDword set, CipDword clear)
+{
+    ProductionSchedulerLock();
+    CipTcpIpBeginUpdate();
+    g_tcpip.status = (g_tcpip.status & ~clear) | set;
+    CipTcpIpEndUpdate();
+    ProductionSchedulerUnlock();
+}
+
+static void release_static_ip(void)
+{
+    if (s_static_ip_assigned) {
+        esp_netif_ip_info_t no_address = { 0 };
+        esp_netif_set_ip_info(s_eth_netif, &no_address);
+        s_static_ip_assigned = false;
+    }
+}
+
+// Runs in the app_main task, the only one changing the ACD state above
+static void handle_acd_events(uint32_t events)
+{
+    if (events & ACD_NOTIFY_LINK_DOWN) {
+        // lwIP stopped the probe; strictly, the address is used again
+        // only after the next one
+        s_acd_retry_at_us = 0;
+        if (!s_acd_optimistic) {
+            release_static_ip();
+        }
+    }
+    if (events & ACD_NOTIFY_LINK_UP) {
+        // A new link may lead to a different network, probe again
+        s_acd_retries = 0;
+        s_acd_retry_at_us = 0;
+        static_acd_probe();
+    }
+    if (events & ACD_NOTIFY_CONFLICT) {
+        ESP_LOGE(TAG, "ACD: " IPSTR " is used by another device, releasing it",
+                 IP2STR(&s_static_ip_info.ip));
+        // EtherNet/IP first, so that no reply leaves with the conflicting address
+        opener_stop();
+        release_static_ip();
+#if CONFIG_OPENER_WARM_RESTART
+        WarmRestartSetAddress(0);
+#endif
+        set_acd_status(kTcpipStatusAcdStatus | kTcpipStatusAcdFault, 0);
+    }
+    if (events & ACD_NOTIFY_RESTART) {
+#if CONFIG_OPENER_ACD_RETRY_ENABLED
+        if (s_acd_retries < CONFIG_OPENER_ACD_RETRY_MAX_ATTEMPTS) {
+            s_acd_retries++;
+            s_acd_retry_at_us = esp_timer_get_time() + CONFIG_OPENER_ACD_RETRY_DELAY_MS * 1000LL;
+            ESP_LOGW(TAG, "ACD: retry %u of %d in %d ms", s_acd_retries,
+                     CONFIG_OPENER_ACD_RETRY_MAX_ATTEMPTS, CONFIG_OPENER_ACD_RETRY_DELAY_MS);
+        } else {
+            ESP_LOGE(TAG, "ACD: giving up after %u retries, next attempt at link up", s_acd_retries);
+        }
+#else
+        ESP_LOGE(TAG, "ACD: address stays released until the next link up");
+#endif
+    }
+    if (events & ACD_NOTIFY_ADDRESS_OK) {
+        ESP_LOGI(TAG, "ACD: " IPSTR " confirmed %lld ms after power-on",
+                 IP2STR(&s_static_ip_info.ip), esp_timer_get_time() / 1000);
+        set_acd_status(0, kTcpipStatusAcdFault);
+        if (!s_static_ip_assigned) {
+            // Raises the got IP event, which starts EtherNet/IP
+            s_static_ip_assigned = true;
+            esp_netif_set_ip_info(s_eth_netif, &s_static_ip_info);
+        }
+    }
+}
+
+// How long the app_main loop may sleep until a pending retry is due
+static TickType_t static_acd_wait_ticks(void)
+{
+    if (s_acd_retry_at_us == 0) {
+        return portMAX_DELAY;
+    }
+    const int64_t remaining_us = s_acd_retry_at_us - esp_timer_get_time();
+    return remaining_us > 0 ? pdMS_TO_TICKS(remaining_us / 1000) + 1 : 0;
+}
+#endif
+
 static void got_ip_event_handler(void *arg, esp_event_base_t event_base,
                                  int32_t event_id, void *event_data)
 {
     ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
     const esp_netif_ip_info_t *ip_info = &event->ip_info;
 
-    ESP_LOGI(TAG, "Ethernet Got IP Address");
+    if (event->esp_netif != s_eth_netif) {
+        ESP_LOGI(TAG, "Management port address " IPSTR, IP2STR(&ip_info->ip));
+        return;
+    }
+
+    ESP_LOGI(TAG, "Ethernet Got IP Address %lld ms after power-on", esp_timer_get_time() / 1000);
     ESP_LOGI(TAG, "~~~~~~~~~~~");
     ESP_LOGI(TAG, "ETHIP:" IPSTR, IP2STR(&ip_info->ip));
     ESP_LOGI(TAG, "ETHMASK:" IPSTR, IP2STR(&ip_info->netmask));
     ESP_LOGI(TAG, "ETHGW:" IPSTR, IP2STR(&ip_info->gw));
     ESP_LOGI(TAG, "~~~~~~~~~~~");
+#if CONFIG_OPENER_WARM_RESTART
+    WarmRestartSetAddress(ip_info->ip.addr);
+#endif
 
-    if (s_eth_netif != NULL) {
-        struct netif *lwip_netif = esp_netif_get_netif_impl(s_eth_netif);
-        if (lwip_netif != NULL) {
-            ESP_LOGI(TAG, "Initializing OpENer EtherNet/IP stack...");
-            opener_init(lwip_netif);
-            
-            ESP_LOGI(TAG, "Initializing Web UI...");
-            if (!webui_init()) {
-                ESP_LOGW(TAG, "Failed to initialize Web UI");
-            }
-        } else {
-            ESP_LOGE(TAG, "Failed to get lwIP netif from esp_netif");
+    xTaskNotify(s_main_task, STARTUP_NOTIFY_GOT_IP, eSetBits);
+}
+
+// One-shot task on core 1, the HTTP server starts while the app_main task
+// builds the CIP stack on core 0
+static void webui_init_task(void *arg)
+{
+    ESP_LOGI(TAG, "Initializing Web UI...");
+    if (!webui_init()) {
+        ESP_LOGW(TAG, "Failed to initialize Web UI");
+    }
+    vTaskDelete(NULL);
+}
+
+// Runs in the app_main task for each got IP event. opener_init() starts the
+// stack, resumes it after a link loss or restarts it on a new address.
+static void handle_got_ip(void)
+{
+    struct netif *lwip_netif = s_eth_netif != NULL ? esp_netif_get_netif_impl(s_eth_netif) : NULL;
+    if (lwip_netif == NULL) {
+        ESP_LOGE(TAG, "Failed to get lwIP netif from esp_netif");
+        return;
+    }
+    if (s_quick_connect) {
+        tcpip_callback(quick_connect_prime_arp, lwip_netif);
+    }
+#if CONFIG_OPENER_MULTICAST_FILTER
+    MulticastFilterAttach(lwip_netif);
+#endif
+    if (s_startup_state == STARTUP_WAIT_ADDRESS) {
+        if (xTaskCreatePinnedToCore(webui_init_task, "webui_init", WEBUI_INIT_STACK_SIZE, NULL,
+                                    WEBUI_INIT_PRIORITY, NULL, 1) != pdPASS) {
+            ESP_LOGW(TAG, "Failed to create the Web UI init task");
         }
+        s_startup_state = STARTUP_RUNNING;
     }
+    ESP_LOGI(TAG, "Initializing OpENer EtherNet/IP stack...");
+    opener_init(lwip_netif);
 }
 
 void app_main(void)
 {
+    // First, so the start up messages are in GET /api/logs too
+    LogBufferInitialize();
     ESP_LOGI(TAG, "TEST BUILD - NOT FOR PRODUCTION!");
+    s_main_task = xTaskGetCurrentTaskHandle();
+#if CONFIG_OPENER_WARM_RESTART
+    // Before the I/O and the network record the state of this boot
+    WarmRestartInitialize();
+    const bool warm_restart = WarmRestartIsWarm();
+    const uint32_t warm_address = WarmRestartGetAddress();
+#else
+    const bool warm_restart = false;
+    const uint32_t warm_address = 0;
+#endif
     
     ESP_ERROR_CHECK(nvs_flash_init());
+    // Before any task of the stack or the web server is created
+    TaskPlacementInitialize();
+    // The one NVS read of the configuration record, TCP/IP, QoS, Ethernet
+    // Link and I/O settings are taken from its RAM copy from here on
+    (void)NvConfigLoad();
+    // The I2C expanders are probed while the PHY comes up and the address
+    // is obtained, KC868_A16_IoInitialize() only registers them
+    KC868_A16_IoStartProbe();
 
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -120,12 +391,15 @@ void app_main(void)
     bool use_dhcp = true;
     esp_netif_ip_info_t static_ip_info = {0};
     
+    // From the RAM copy of the configuration record, opener_init() gets the
+    // same data again
     EipStatus nv_status = NvTcpipLoad(&g_tcpip);
     if (kEipStatusOk == nv_status) {
         bool is_dhcp = ((g_tcpip.config_control & kTcpipCfgCtrlMethodMask) == kTcpipCfgCtrlDhcp);
         use_dhcp = is_dhcp;
         
         if (!is_dhcp) {
+            s_quick_connect = g_tcpip.quick_connect;
             static_ip_info.ip.addr = g_tcpip.interface_configuration.ip_address;
             static_ip_info.netmask.addr = g_tcpip.interface_configuration.network_mask;
             static_ip_info.gw.addr = g_tcpip.interface_configuration.gateway;
@@ -140,11 +414,25 @@ void app_main(void)
         ESP_LOGI(TAG, "No saved IP config in NVS, using DHCP by default");
     }
 
-    // Add delay to allow PHY power supply and clock to stabilize
-    ESP_LOGI(TAG, "Waiting for PHY power/clock stabilization...");
-    vTaskDelay(pdMS_TO_TICKS(200));
+    // Quick Connect takes the fast boot path whatever the build default, so
+    // does a warm restart: the PHY stayed powered through the reset
+    const bool fast_boot = CONFIG_OPENER_FAST_BOOT || s_quick_connect || warm_restart;
+    if (s_quick_connect) {
+        ESP_LOGI(TAG, "Quick Connect enabled");
+    }
+    if (warm_restart) {
+        ESP_LOGW(TAG, "Warm restart, taking the fast boot path");
+    }
+
+    if (!fast_boot) {
+        // Add delay to allow PHY power supply and clock to stabilize
+        ESP_LOGI(TAG, "Waiting for PHY power/clock stabilization...");
+        vTaskDelay(pdMS_TO_TICKS(200));
+    }
 
     eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    mac_config.rx_task_prio = CONFIG_OPENER_ETH_RX_TASK_PRIORITY;
+    mac_config.rx_task_stack_size = CONFIG_OPENER_ETH_RX_TASK_STACK_SIZE;
     eth_phy_config_t phy_config = ETH_PHY_DEFAULT_CONFIG();
     phy_config.phy_addr = ETH_PHY_ADDR;
     phy_config.reset_gpio_num = -1;
@@ -161,8 +449,36 @@ void app_main(void)
 
     esp_eth_config_t eth_config = ETH_DEFAULT_CONFIG(mac, phy);
     esp_eth_handle_t eth_handle = NULL;
-    ESP_ERROR_CHECK(esp_eth_driver_install(&eth_config, &eth_handle));
+    if (fast_boot) {
+        // Installing the driver resets and probes the PHY; retry until it answers
+        // instead of always waiting for the worst case power/clock start up
+        const int64_t phy_deadline_us = esp_timer_get_time() + ETH_PHY_READY_TIMEOUT_MS * 1000;
+        esp_err_t eth_ret;
+        while ((eth_ret = esp_eth_driver_install(&eth_config, &eth_handle)) != ESP_OK &&
+               esp_timer_get_time() < phy_deadline_us) {
+            vTaskDelay(pdMS_TO_TICKS(ETH_PHY_POLL_MS));
+        }
+        ESP_ERROR_CHECK(eth_ret);
+        ESP_LOGI(TAG, "PHY ready %lld ms after power-on", esp_timer_get_time() / 1000);
+    } else {
+        ESP_ERROR_CHECK(esp_eth_driver_install(&eth_config, &eth_handle));
+    }
+#if CONFIG_OPENER_ETH_MEDIA_COUNTERS
+    EthMediaCountersInitialize(eth_handle);
+#endif
+#if CONFIG_OPENER_ETH_RX_MODERATION
+    // Marks the receive descriptors again at every start of the driver
+    EthRxModerationInitialize(eth_handle);
+#endif
+#if CONFIG_OPENER_ETH_LINK_CONTROL
+    // Forced speed and duplex go to the PHY while the driver is stopped
+    EthLinkControlInitialize(eth_handle);
+#endif
+#if CONFIG_OPENER_MULTICAST_FILTER
+    MulticastFilterInitialize(eth_handle);
+#endif
 
+    s_eth_handle = eth_handle;
     ESP_ERROR_CHECK(esp_netif_attach(s_eth_netif, esp_eth_new_netif_glue(eth_handle)));
 
     if (nv_status == kEipStatusOk && g_tcpip.hostname.length > 0 && g_tcpip.hostname.string != NULL) {
@@ -175,7 +491,28 @@ void app_main(void)
     if (!use_dhcp) {
         ESP_LOGI(TAG, "Configuring static IP address...");
         ESP_ERROR_CHECK(esp_netif_dhcpc_stop(s_eth_netif));
+#if CONFIG_LWIP_DHCP_DOES_ACD_CHECK
+        s_static_ip_info = static_ip_info;
+        s_static_acd_enabled = g_tcpip.select_acd;
+        // Quick Connect must not wait for the probe, nor does a warm restart
+        // on the address that was in use without a conflict up to the reset
+        s_acd_optimistic = CONFIG_OPENER_ACD_STARTUP_OPTIMISTIC || s_quick_connect ||
+                           (warm_address != 0 && warm_address == static_ip_info.ip.addr);
+        if (!s_static_acd_enabled || s_acd_optimistic) {
+            ESP_ERROR_CHECK(esp_netif_set_ip_info(s_eth_netif, &static_ip_info));
+            s_static_ip_assigned = true;
+        }
+        if (s_static_acd_enabled) {
+            ESP_LOGI(TAG, "ACD enabled, EtherNet/IP starts %s",
+                     s_acd_optimistic ? "at link up" : "once the address is confirmed");
+        }
+#else
+        (void)warm_address;
+        if (g_tcpip.select_acd) {
+            ESP_LOGW(TAG, "ACD of a static address needs CONFIG_LWIP_DHCP_DOES_ACD_CHECK");
+        }
         ESP_ERROR_CHECK(esp_netif_set_ip_info(s_eth_netif, &static_ip_info));
+#endif
         
         if (g_tcpip.interface_configuration.name_server != 0) {
             esp_netif_dns_info_t dns_info;
@@ -194,12 +531,48 @@ void app_main(void)
         ESP_ERROR_CHECK(esp_netif_dhcpc_start(s_eth_netif));
     }
 
+    // Before the got IP handler below, so that it and the start up it
+    // triggers already read the new address
+    NetifStatusInitialize(s_eth_netif, eth_handle);
     ESP_ERROR_CHECK(esp_event_handler_register(ETH_EVENT, ESP_EVENT_ANY_ID, &eth_event_handler, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_ETH_GOT_IP, &got_ip_event_handler, NULL));
     
     ESP_ERROR_CHECK(esp_eth_start(eth_handle));
+
+#if CONFIG_OPENER_MGMT_ETH
+    // Started after the EtherNet/IP port, which keeps the default route
+    esp_netif_t *mgmt_netif = mgmt_eth_start();
+#if CONFIG_OPENER_MGMT_ETH_WEBUI_ONLY
+    if (mgmt_netif != NULL) {
+        webui_restrict_to_netif(mgmt_netif);
+    } else {
+        ESP_LOGW(TAG, "No management port, the web UI stays on the EtherNet/IP port");
+    }
+#else
+    (void)mgmt_netif;
+#endif
+#endif
+
+    if (fast_boot) {
+        // Build the CIP objects and assemblies while the PHY negotiates the
+        // link, the got IP event then only opens the sockets
+        opener_prepare();
+    }
     
     while (1) {
-    vTaskDelay(pdMS_TO_TICKS(1000));
+        uint32_t events = 0;
+#if CONFIG_LWIP_DHCP_DOES_ACD_CHECK
+        if (xTaskNotifyWait(0, UINT32_MAX, &events, static_acd_wait_ticks()) == pdTRUE) {
+            handle_acd_events(events);
+        } else if (s_acd_retry_at_us != 0) {
+            s_acd_retry_at_us = 0;
+            static_acd_probe();
+        }
+#else
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+#endif
+        if (events & STARTUP_NOTIFY_GOT_IP) {
+            handle_got_ip();
+        }
     }
 }
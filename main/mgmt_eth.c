@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "mgmt_eth.h"
+
+#if CONFIG_OPENER_MGMT_ETH
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_eth.h"
+#include "esp_eth_mac_spi.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+
+static const char *TAG = "mgmt_eth";
+
+// Below ESP_NETIF_INHERENT_DEFAULT_ETH (50), the EtherNet/IP port keeps
+// the default route
+#define MGMT_ETH_ROUTE_PRIO   30
+#define MGMT_ETH_SPI_QUEUE    20
+
+static bool mgmt_eth_pins_set(void)
+{
+    return CONFIG_OPENER_MGMT_ETH_SCLK_GPIO >= 0 && CONFIG_OPENER_MGMT_ETH_MOSI_GPIO >= 0 &&
+           CONFIG_OPENER_MGMT_ETH_MISO_GPIO >= 0 && CONFIG_OPENER_MGMT_ETH_CS_GPIO >= 0;
+}
+
+static esp_eth_handle_t mgmt_eth_install_driver(void)
+{
+    const spi_host_device_t host = (spi_host_device_t)CONFIG_OPENER_MGMT_ETH_SPI_HOST;
+    spi_bus_config_t bus_config = {
+        .miso_io_num = CONFIG_OPENER_MGMT_ETH_MISO_GPIO,
+        .mosi_io_num = CONFIG_OPENER_MGMT_ETH_MOSI_GPIO,
+        .sclk_io_num = CONFIG_OPENER_MGMT_ETH_SCLK_GPIO,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+    };
+    esp_err_t ret = spi_bus_initialize(host, &bus_config, SPI_DMA_CH_AUTO);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "SPI bus: %s", esp_err_to_name(ret));
+        return NULL;
+    }
+    if (CONFIG_OPENER_MGMT_ETH_INT_GPIO >= 0) {
+        // The driver installs its handler on the GPIO ISR service
+        ret = gpio_install_isr_service(0);
+        if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+            ESP_LOGE(TAG, "GPIO ISR service: %s", esp_err_to_name(ret));
+            spi_bus_free(host);
+            return NULL;
+        }
+    }
+
+    spi_device_interface_config_t device_config = {
+        .mode = 0,
+        .clock_speed_hz = CONFIG_OPENER_MGMT_ETH_SPI_CLOCK_MHZ * 1000 * 1000,
+        .queue_size = MGMT_ETH_SPI_QUEUE,
+        .spics_io_num = CONFIG_OPENER_MGMT_ETH_CS_GPIO,
+    };
+    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    eth_phy_config_t phy_config = ETH_PHY_DEFAULT_CONFIG();
+    phy_config.reset_gpio_num = -1;
+#if CONFIG_OPENER_MGMT_ETH_INT_GPIO >= 0
+    const uint32_t poll_period_ms = 0;
+#else
+    const uint32_t poll_period_ms = CONFIG_OPENER_MGMT_ETH_POLL_MS;
+#endif
+
+#if CONFIG_OPENER_MGMT_ETH_W5500
+    eth_w5500_config_t chip_config = ETH_W5500_DEFAULT_CONFIG(host, &device_config);
+    chip_config.int_gpio_num = CONFIG_OPENER_MGMT_ETH_INT_GPIO;
+    chip_config.poll_period_ms = poll_period_ms;
+    esp_eth_mac_t *mac = esp_eth_mac_new_w5500(&chip_config, &mac_config);
+    esp_eth_phy_t *phy = esp_eth_phy_new_w5500(&phy_config);
+#else
+    eth_dm9051_config_t chip_config = ETH_DM9051_DEFAULT_CONFIG(host, &device_config);
+    chip_config.int_gpio_num = CONFIG_OPENER_MGMT_ETH_INT_GPIO;
+    chip_config.poll_period_ms = poll_period_ms;
+    esp_eth_mac_t *mac = esp_eth_mac_new_dm9051(&chip_config, &mac_config);
+    esp_eth_phy_t *phy = esp_eth_phy_new_dm9051(&phy_config);
+#endif
+
+    esp_eth_handle_t handle = NULL;
+    esp_eth_config_t eth_config = ETH_DEFAULT_CONFIG(mac, phy);
+    if (mac == NULL || phy == NULL || esp_eth_driver_install(&eth_config, &handle) != ESP_OK) {
+        ESP_LOGE(TAG, "No Ethernet controller answers on the SPI bus");
+        if (phy != NULL) {
+            phy->del(phy);
+        }
+        if (mac != NULL) {
+            mac->del(mac);
+        }
+        spi_bus_free(host);
+        return NULL;
+    }
+
+    // The SPI controllers have no MAC address of their own, take the
+    // locally administered one derived from the EMAC address
+    uint8_t eth_mac[6];
+    uint8_t mgmt_mac[6];
+    if (esp_read_mac(eth_mac, ESP_MAC_ETH) == ESP_OK &&
+        esp_derive_local_mac(mgmt_mac, eth_mac) == ESP_OK) {
+        esp_eth_ioctl(handle, ETH_CMD_S_MAC_ADDR, mgmt_mac);
+    }
+    return handle;
+}
+
+static void mgmt_eth_configure_address(esp_netif_t *netif)
+{
+    const char *static_ip = CONFIG_OPENER_MGMT_ETH_STATIC_IP;
+    if (static_ip[0] == '\0') {
+        ESP_LOGI(TAG, "Management port uses DHCP");
+        return;
+    }
+#ifdef CONFIG_OPENER_MGMT_ETH_NETMASK
+    esp_netif_ip_info_t ip_info = { 0 };
+    if (esp_netif_str_to_ip4(static_ip, &ip_info.ip) != ESP_OK ||
+        esp_netif_str_to_ip4(CONFIG_OPENER_MGMT_ETH_NETMASK, &ip_info.netmask) != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid static address %s/%s, using DHCP", static_ip,
+                 CONFIG_OPENER_MGMT_ETH_NETMASK);
+        return;
+    }
+    if (CONFIG_OPENER_MGMT_ETH_GATEWAY[0] != '\0' &&
+        esp_netif_str_to_ip4(CONFIG_OPENER_MGMT_ETH_GATEWAY, &ip_info.gw) != ESP_OK) {
+        ESP_LOGW(TAG, "Invalid gateway %s, none set", CONFIG_OPENER_MGMT_ETH_GATEWAY);
+        ip_info.gw.addr = 0;
+    }
+    esp_netif_dhcpc_stop(netif);
+    if (esp_netif_set_ip_info(netif, &ip_info) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set the static address");
+        return;
+    }
+    ESP_LOGI(TAG, "Management port address " IPSTR "/" IPSTR,
+             IP2STR(&ip_info.ip), IP2STR(&ip_info.netmask));
+#endif
+}
+
+esp_netif_t *mgmt_eth_start(void)
+{
+    if (!mgmt_eth_pins_set()) {
+        ESP_LOGW(TAG, "Management port enabled but its SPI pins are not set");
+        return NULL;
+    }
+    esp_eth_handle_t handle = mgmt_eth_install_driver();
+    if (handle == NULL) {
+        return NULL;
+    }
+
+    esp_netif_inherent_config_t base_config = ESP_NETIF_INHERENT_DEFAULT_ETH();
+    base_config.if_key = "ETH_MGMT";
+    base_config.if_desc = "mgmt";
+    base_config.route_prio = MGMT_ETH_ROUTE_PRIO;
+    esp_netif_config_t netif_config = {
+        .base = &base_config,
+        .stack = ESP_NETIF_NETSTACK_DEFAULT_ETH,
+    };
+    esp_netif_t *netif = esp_netif_new(&netif_config);
+    if (netif == NULL || esp_netif_attach(netif, esp_eth_new_netif_glue(handle)) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create the management netif");
+        return NULL;
+    }
+    mgmt_eth_configure_address(netif);
+
+    if (esp_eth_start(handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the management port");
+        return NULL;
+    }
+    ESP_LOGI(TAG, "Management port started");
+    return netif;
+}
+
+#endif // CONFIG_OPENER_MGMT_ETH
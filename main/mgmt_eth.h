@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MGMT_ETH_H
+#define MGMT_ETH_H
+
+#include "sdkconfig.h"
+
+#if CONFIG_OPENER_MGMT_ETH
+
+#include "esp_netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bring up the management port on the SPI Ethernet module
+ *
+ * Installs the driver, creates its netif with a lower route priority than
+ * the EtherNet/IP port, configures the address and starts the driver. A
+ * missing or unwired module is logged and leaves the EtherNet/IP port
+ * running alone.
+ *
+ * @return the management netif, or NULL if the port is not available
+ */
+esp_netif_t *mgmt_eth_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_OPENER_MGMT_ETH
+
+#endif // MGMT_ETH_H
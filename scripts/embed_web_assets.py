@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""
+Script to embed the web UI assets as gzip compressed C arrays.
+Called as a custom command by components/webui/CMakeLists.txt.
+
+Every asset is given as four arguments: URI, content type, Cache-Control value
+and source file. The strong ETag of an asset is derived from its compressed
+bytes, so it changes exactly when the served representation changes.
+"""
+import gzip
+import hashlib
+import os
+import sys
+
+BYTES_PER_LINE = 16
+
+
+def c_string(text):
+    """Quote text as a C string literal."""
+    return '"' + text.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def main():
+    if len(sys.argv) < 6 or (len(sys.argv) - 2) % 4 != 0:
+        print("Usage: embed_web_assets.py <output.c> "
+              "<uri> <content_type> <cache_control> <file> [...]")
+        sys.exit(1)
+
+    output_path = sys.argv[1]
+    arguments = sys.argv[2:]
+    assets = [arguments[i:i + 4] for i in range(0, len(arguments), 4)]
+
+    lines = [
+        "// Generated by scripts/embed_web_assets.py from the files in components/webui,",
+        "// do not edit",
+        "",
+        '#include "webui_assets.h"',
+        "",
+    ]
+    entries = []
+    for index, (uri, content_type, cache_control, source) in enumerate(assets):
+        with open(source, 'rb') as f:
+            content = f.read()
+        # mtime=0 keeps the output, and with it the ETag, reproducible
+        compressed = gzip.compress(content, compresslevel=9, mtime=0)
+        etag = '"' + hashlib.sha256(compressed).hexdigest()[:16] + '"'
+
+        lines.append("// %s: %d bytes, %d compressed" %
+                     (os.path.basename(source), len(content), len(compressed)))
+        lines.append("static const uint8_t s_asset_%d[] = {" % index)
+        for offset in range(0, len(compressed), BYTES_PER_LINE):
+            chunk = compressed[offset:offset + BYTES_PER_LINE]
+            lines.append("    " + ", ".join("0x%02x" % b for b in chunk) + ",")
+        lines.append("};")
+        lines.append("")
+        entries.append("    { %s, %s, %s, %s, s_asset_%d, sizeof(s_asset_%d) }," %
+                       (c_string(uri), c_string(content_type),
+                        c_string(cache_control), c_string(etag), index, index))
+        print("embed_web_assets: %s %d -> %d bytes, ETag %s" %
+              (uri, len(content), len(compressed), etag))
+
+    lines.append("const webui_asset_t webui_assets[] = {")
+    lines.extend(entries)
+    lines.append("};")
+    lines.append("")
+    lines.append("const size_t webui_asset_count = sizeof(webui_assets) / sizeof(webui_assets[0]);")
+    lines.append("")
+
+    with open(output_path, 'w') as f:
+        f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
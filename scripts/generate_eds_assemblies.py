@@ -0,0 +1,439 @@
+#!/usr/bin/env python3
+"""
+Script to generate the assembly entries of eds/KC868A16.eds from the data
+map in kc868_a16_assembly_map.h.
+
+The map is run through the C preprocessor with the options of an sdkconfig
+file, so the EDS describes the assemblies of that configuration. The script
+rewrites the [Assembly] and [Connection Manager] sections and the member
+parameters between the generated markers of [Params]; everything else in
+the EDS is kept. Every input assembly lists the connections of the types
+it offers, for as many assemblies as the configuration has connection
+points of each type. A connection whose RPI default differs from Param1-3
+gets an RPI parameter of its own after the member parameters.
+
+Usage: generate_eds_assemblies.py [--sdkconfig FILE] [--eds FILE] [--cc CC]
+                                  [--check] [--embed FILE]
+
+With --check nothing is written and the exit status is 1 if the EDS is out
+of date. With --embed the EDS is left alone and the generated one is written
+zlib compressed into a C source instead, the image of the CIP File object in
+ESP32/eds_file.h; components/opener/CMakeLists.txt builds it with the
+sdkconfig of the firmware.
+"""
+import argparse
+import os
+import re
+import shlex
+import subprocess
+import sys
+import tempfile
+import zlib
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+MAP_DIRECTORY = os.path.join(REPO_ROOT, "components", "opener", "src", "ports",
+                             "ESP32", "kc868_a16_application")
+
+# Member parameters are numbered from here, below are the hand written ones
+FIRST_GENERATED_PARAM = 100
+PARAMS_BEGIN = "        $ Assembly member parameters, generated by " \
+               "scripts/generate_eds_assemblies.py\n"
+PARAMS_END = "        $ End of generated parameters\n"
+
+# Default of the hand written RPI parameters Param1-3
+DEFAULT_RPI_US = 10000
+
+# RPI parameters and connection types of the three connection points
+CONNECTION_TYPES = [
+    # name, help, trigger and transport, parameters, RPI, consumes outputs,
+    # option with the number of connection points, KC868_A16_POINT_* bit
+    ("Exclusive Owner", "Exclusive Owner connection for relay control",
+     "0x04030002", "0x44640405", "Param1", True,
+     "CONFIG_OPENER_NUM_EXCLUSIVE_OWNER_CONNS", 0x01),
+    ("Input Only", "Input Only connection for input monitoring",
+     "0x02030002", "0x44640305", "Param2", False,
+     "CONFIG_OPENER_NUM_INPUT_ONLY_CONNS", 0x02),
+    ("Listen Only", "Listen Only connection for input monitoring",
+     "0x01030002", "0x44240305", "Param3", False,
+     "CONFIG_OPENER_NUM_LISTEN_ONLY_CONNS", 0x04),
+]
+
+PROBE = r'''
+#include "kc868_a16_assembly_map.h"
+#define EDS_KIND(kind, size, eds_type, name, units, help, limits) \
+  EDS_KIND kind size eds_type name units help limits ;
+#define EDS_FIELD(kind, argument) EDS_FIELD kind argument ;
+#define EDS_INPUT(name, instance, eds_name, fields, points, rpi_us) \
+  EDS_INPUT instance eds_name (points) rpi_us ; fields(EDS_FIELD) EDS_END ;
+#define EDS_OTHER(name, instance, eds_name, fields) \
+  EDS_OTHER instance eds_name ; fields(EDS_FIELD) EDS_END ;
+KC868_A16_FIELD_KINDS(EDS_KIND)
+KC868_A16_INPUT_ASSEMBLIES(EDS_INPUT)
+KC868_A16_OTHER_ASSEMBLIES(EDS_OTHER)
+EDS_POINTS KC868_A16_OUTPUT_ASSEMBLY_NUM KC868_A16_CONFIG_ASSEMBLY_NUM
+  KC868_A16_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM
+  KC868_A16_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM ;
+'''
+
+TOKEN = re.compile(r'"(?:\\.|[^"\\])*"|0[xX][0-9a-fA-F]+|\w+|[;()|]')
+
+
+def read_sdkconfig(path):
+    """Options of an sdkconfig file, a missing option is disabled."""
+    options = {}
+    with open(path) as f:
+        for line in f:
+            match = re.match(r'(CONFIG_\w+)=(.*)$', line.strip())
+            if match and match.group(2) != "n":
+                options[match.group(1)] = match.group(2)
+    return options
+
+
+def preprocess(cc, options):
+    defines = ["#define %s %s" % (name, "1" if value == "y" else value)
+               for name, value in options.items()]
+    with tempfile.TemporaryDirectory() as directory:
+        with open(os.path.join(directory, "sdkconfig.h"), "w") as f:
+            f.write("\n".join(defines) + "\n")
+        probe = os.path.join(directory, "probe.c")
+        with open(probe, "w") as f:
+            f.write(PROBE)
+        command = shlex.split(cc) + ["-E", "-P", "-I", directory,
+                                     "-I", MAP_DIRECTORY, probe]
+        return subprocess.run(command, check=True, stdout=subprocess.PIPE,
+                              universal_newlines=True).stdout
+
+
+def unquote(token):
+    return token[1:-1].replace('\\"', '"').replace('\\\\', '\\')
+
+
+def or_expression(tokens):
+    """Value of the KC868_A16_POINT_* bits or-ed together in tokens."""
+    value = 0
+    for token in tokens:
+        if token in "()|":
+            continue
+        value |= int(token, 0)
+    return value
+
+
+def parse(output):
+    """Split the preprocessed probe into kinds, assemblies and points."""
+    statements = []
+    statement = []
+    for token in TOKEN.findall(output):
+        if token == ";":
+            statements.append(statement)
+            statement = []
+        else:
+            statement.append(token)
+
+    kinds = {}
+    assemblies = []
+    points = None
+    for statement in statements:
+        keyword = statement[0]
+        if keyword == "EDS_KIND":
+            kind, size, eds_type, name, units, help_text, limits = statement[1:]
+            kinds[kind] = {
+                "size": int(size, 0), "type": eds_type, "name": unquote(name),
+                "units": unquote(units), "help": unquote(help_text),
+                "limits": unquote(limits),
+            }
+        elif keyword in ("EDS_INPUT", "EDS_OTHER"):
+            assembly = {
+                "input": keyword == "EDS_INPUT", "instance": int(statement[1], 0),
+                "name": unquote(statement[2]), "fields": [],
+            }
+            if assembly["input"]:
+                assembly["points"] = or_expression(statement[3:-1])
+                assembly["rpi"] = int(statement[-1], 0)
+            assemblies.append(assembly)
+        elif keyword == "EDS_FIELD":
+            assemblies[-1]["fields"].append((statement[1], int(statement[2], 0)))
+        elif keyword == "EDS_POINTS":
+            points = [int(token, 0) for token in statement[1:]]
+    return kinds, assemblies, points
+
+
+def format_text(text, argument):
+    return text % (argument + 1) if "%" in text else text
+
+
+PARAM_TEMPLATE = (
+    "        Param%d =\n"
+    "                0,\n"
+    "                ,,\n"
+    "                0x0000,\n"
+    "                %s,\n"
+    "                %d,\n"
+    "                \"%s\",\n"
+    "                \"%s\",\n"
+    "                \"%s\",\n"
+    "                %s,\n"
+    "                ,,,,\n"
+    "                ,,,,\n"
+    "                ;\n")
+
+
+def plan_connections(assemblies, options):
+    """Connection type and input assembly of every connection point.
+
+    The application hands out the connection points of each type in the
+    order of the map to the assemblies offering that type, so an assembly
+    past the configured number has none of that type.
+    """
+    connections = []
+    used = [0] * len(CONNECTION_TYPES)
+    for assembly in assemblies:
+        if not assembly["input"]:
+            continue
+        for type_index, connection_type in enumerate(CONNECTION_TYPES):
+            option, bit = connection_type[6], connection_type[7]
+            if not assembly["points"] & bit:
+                continue
+            if used[type_index] < int(options.get(option, "1")):
+                connections.append((type_index, used[type_index], assembly))
+            used[type_index] += 1
+    return connections
+
+
+def generate_params(kinds, assemblies, connections):
+    """One parameter per distinct field, shared by the assemblies, then the
+    RPI parameters of connections with an RPI default of their own."""
+    numbers = {}
+    lines = [PARAMS_BEGIN]
+    for assembly in assemblies:
+        for field in assembly["fields"]:
+            if field in numbers:
+                continue
+            number = FIRST_GENERATED_PARAM + len(numbers)
+            numbers[field] = number
+            kind, argument = field
+            info = kinds[kind]
+            lines.append(PARAM_TEMPLATE %
+                         (number, info["type"], info["size"],
+                          format_text(info["name"], argument), info["units"],
+                          format_text(info["help"], argument), info["limits"]))
+
+    rpi_params = {}
+    number = FIRST_GENERATED_PARAM + len(numbers)
+    for type_index, _, assembly in connections:
+        if assembly["rpi"] == DEFAULT_RPI_US:
+            continue
+        name = CONNECTION_TYPES[type_index][0]
+        rpi_params[(type_index, assembly["instance"])] = "Param%d" % number
+        lines.append(PARAM_TEMPLATE %
+                     (number, "0xC8", 4,
+                      "%s RPI (%s)" % (name, assembly["name"]), "us",
+                      "Requested Packet Interval for the %s connection of "
+                      "the %s" % (name, assembly["name"]),
+                      "1000,,%d" % assembly["rpi"]))
+        number += 1
+    lines.append(PARAMS_END)
+    return "".join(lines), numbers, rpi_params
+
+
+def assembly_size(kinds, assembly):
+    return sum(kinds[kind]["size"] for kind, _ in assembly["fields"])
+
+
+def generate_assembly_section(kinds, assemblies, numbers, points):
+    output_point = points[0]
+    lines = [
+        "[Assembly]\n",
+        "        Object_Name = \"Assembly Object\";\n",
+        "        Object_Class_Code = 0x04;\n",
+        "        Number_Of_Static_Instances = %d;\n" % len(assemblies),
+    ]
+    for assembly in assemblies:
+        members = ["                %d,Param%d" %
+                   (kinds[field[0]]["size"] * 8, numbers[field])
+                   for field in assembly["fields"]]
+        lines.append(
+            "        Assem%d =\n"
+            "                \"%s\",\n"
+            "                \"20 04 24 %02X 30 03\",\n"
+            "                %d,\n"
+            "                %s,\n"
+            "                ,,\n"
+            "%s;\n" %
+            (assembly["instance"], assembly["name"], assembly["instance"],
+             assembly_size(kinds, assembly),
+             "0x0001" if assembly["instance"] == output_point else "0x0000",
+             ",\n".join(members)))
+    lines.append("\n")
+    return "".join(lines)
+
+
+def generate_connection_section(kinds, assemblies, points, connections,
+                                rpi_params):
+    """Connections of the connection points planned by plan_connections()."""
+    output_point, config_point, input_only_point, listen_only_point = points
+    by_instance = {assembly["instance"]: assembly for assembly in assemblies}
+    output_size = assembly_size(kinds, by_instance[output_point])
+    config_size = assembly_size(kinds, by_instance[config_point])
+    connection_points = [output_point, input_only_point, listen_only_point]
+
+    lines = [
+        "[Connection Manager]\n",
+        "        Revision = 1;\n",
+        "        Object_Name = \"Connection Manager Object\";\n",
+        "        Object_Class_Code = 0x06;\n",
+        "        MaxInst = 1;\n",
+        "        Number_Of_Static_Instances = 1;\n",
+        "        Max_Number_Of_Dynamic_Instances = 0;\n",
+    ]
+    for number, (type_index, point, assembly) in enumerate(connections, 1):
+        name, help_text, trigger, parameters, rpi, owner, _, _ = \
+            CONNECTION_TYPES[type_index]
+        consumed = connection_points[type_index]
+        rpi = rpi_params.get((type_index, assembly["instance"]), rpi)
+        if point > 0:
+            name = "%s (%s)" % (name, assembly["name"])
+            help_text = "%s, %s" % (help_text, assembly["name"])
+        lines.append(
+            "        Connection%d =\n"
+            "                %s,\n"
+            "                %s,\n"
+            "                %s,%s,\n"
+            "                %s,%d,Assem%d,\n"
+            "                ,,\n"
+            "                %s,\n"
+            "                \"%s\",\n"
+            "                \"%s\",\n"
+            "                \"20 04 24 %02X 2C %02X 2C %02X\";\n" %
+            (number, trigger, parameters, rpi,
+             "%d,Assem%d" % (output_size, output_point) if owner else "0,",
+             rpi, assembly_size(kinds, assembly), assembly["instance"],
+             "%d,Assem%d" % (config_size, config_point) if owner else ",",
+             name, help_text, config_point, consumed,
+             assembly["instance"]))
+    lines.append("\n")
+    return "".join(lines)
+
+
+def replace_section(eds, name, text):
+    pattern = re.compile(r'^\[%s\]\n.*?(?=^\[)' % re.escape(name),
+                         re.MULTILINE | re.DOTALL)
+    if not pattern.search(eds):
+        raise SystemExit("generate_eds_assemblies: no [%s] section" % name)
+    return pattern.sub(lambda match: text, eds, count=1)
+
+
+def replace_params(eds, text):
+    begin = eds.find(PARAMS_BEGIN)
+    end = eds.find(PARAMS_END)
+    if begin < 0 or end < begin:
+        raise SystemExit("generate_eds_assemblies: the generated parameter "
+                         "markers are missing in [Params]")
+    return eds[:begin] + text + eds[end + len(PARAMS_END):]
+
+
+def file_revision(eds):
+    """Major and minor revision of the [File] section."""
+    match = re.search(r'^\[File\][^\[]*?^\s*Revision\s*=\s*(\d+)\.(\d+)\s*;',
+                      eds, re.MULTILINE)
+    if not match:
+        raise SystemExit("generate_eds_assemblies: no Revision in [File]")
+    return int(match.group(1)), int(match.group(2))
+
+
+def write_embedded(path, eds_path, eds):
+    """Write the EDS compressed as the g_eds_file_image of eds_file.h."""
+    content = eds.encode("latin-1")
+    compressed = zlib.compress(content, 9)
+    # File Checksum of the File object: two's complement of the 16-bit sum
+    checksum = -sum(compressed) & 0xFFFF
+    major, minor = file_revision(eds)
+    name = os.path.basename(eds_path)
+    lines = [
+        "/* Generated by scripts/generate_eds_assemblies.py --embed from %s" %
+        name,
+        " * and the assembly map, do not edit */",
+        "",
+        '#include "eds_file.h"',
+        "",
+        "/* %d bytes, %d compressed */" % (len(content), len(compressed)),
+        "static const EipUint8 s_eds_file_data[] = {",
+    ]
+    for offset in range(0, len(compressed), 12):
+        chunk = compressed[offset:offset + 12]
+        lines.append("  " + ", ".join("0x%02x" % b for b in chunk) + ",")
+    lines += [
+        "};",
+        "",
+        "const EdsFileImage g_eds_file_image = {",
+        '  .name = "%s",' % name,
+        "  .data = s_eds_file_data,",
+        "  .size = sizeof(s_eds_file_data),",
+        "  .uncompressed_size = %dU," % len(content),
+        "  .checksum = 0x%04XU," % checksum,
+        "  .revision_major = %d," % major,
+        "  .revision_minor = %d," % minor,
+        "};",
+        "",
+    ]
+    text = "\n".join(lines)
+    # Only touch the source when it changes, it is a build output
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return
+    with open(path, "w") as f:
+        f.write(text)
+    print("generate_eds_assemblies: embedded %s, %d -> %d bytes" %
+          (name, len(content), len(compressed)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--sdkconfig", default=os.path.join(REPO_ROOT,
+                                                             "sdkconfig"))
+    parser.add_argument("--eds", default=os.path.join(REPO_ROOT, "eds",
+                                                       "KC868A16.eds"))
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"),
+                        help="C compiler used as preprocessor")
+    parser.add_argument("--check", action="store_true",
+                        help="only check that the EDS is up to date")
+    parser.add_argument("--embed", metavar="FILE",
+                        help="write the generated EDS into this C source")
+    arguments = parser.parse_args()
+
+    options = read_sdkconfig(arguments.sdkconfig)
+    kinds, assemblies, points = parse(preprocess(arguments.cc, options))
+    connections = plan_connections(assemblies, options)
+    params, numbers, rpi_params = generate_params(kinds, assemblies,
+                                                  connections)
+
+    with open(arguments.eds) as f:
+        eds = f.read()
+    updated = replace_params(eds, params)
+    updated = replace_section(updated, "Assembly",
+                              generate_assembly_section(kinds, assemblies,
+                                                        numbers, points))
+    updated = replace_section(updated, "Connection Manager",
+                              generate_connection_section(kinds, assemblies,
+                                                          points, connections,
+                                                          rpi_params))
+
+    if arguments.embed:
+        write_embedded(arguments.embed, arguments.eds, updated)
+        return
+    if arguments.check:
+        if updated != eds:
+            print("generate_eds_assemblies: %s is out of date" % arguments.eds)
+            sys.exit(1)
+        return
+    if updated != eds:
+        with open(arguments.eds, "w") as f:
+            f.write(updated)
+    for assembly in assemblies:
+        print("generate_eds_assemblies: Assem%d %s, %d bytes" %
+              (assembly["instance"], assembly["name"],
+               assembly_size(kinds, assembly)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,738 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+/* On-target performance regression tests of the EtherNet/IP stack and the
+ * KC868-A16 I/O.
+ *
+ * The stack is built like the firmware builds it (opener_prepare()), but no
+ * OpENer task is started: the test task takes its place and calls the
+ * network handler's entry points itself, like the host replay tool does. The
+ * requests travel over lwIP's loopback interface, 127.0.0.1, so the numbers
+ * include the lwIP socket path of a real frame but no Ethernet driver:
+ *
+ *  - explicit requests are sent over a TCP connection to a listener of the
+ *    test and handed to HandleReceivedExplictTcpData() on the accepting end
+ *  - the Class 1 connection produces through a UDP socket bound to
+ *    127.0.0.1:2222, which is also where its T->O packets are addressed to,
+ *    so the test reads them from the same socket
+ *
+ * Every measurement prints one line "[PERF] {json}" with the value, its
+ * threshold from menu "OpENer Performance Test" and the verdict, which
+ * pytest_opener_perf.py collects. The tests run in the main task, sized like
+ * the OpENer task, so its stack high water mark stands for the OpENer task.
+ *
+ * Built with CONFIG_KC868_IO_BACKEND_SIMULATED (sdkconfig.ci.simulated) the
+ * I/O scan task runs on the model of kc868_a16_sim.h; the I2C case is then
+ * replaced by cases that switch simulated inputs and inject bus faults.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_utils.h"
+
+#include "esp_heap_caps.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "nvs_flash.h"
+#include "sdkconfig.h"
+
+#include "opener.h"
+#include "opener_api.h"
+#include "ciptcpipinterface.h"
+#include "cpf.h"
+#include "devicedata.h"
+#include "encap.h"
+#include "endianconv.h"
+#include "enipmessage.h"
+#include "generic_networkhandler.h"
+#include "kc868_a16_assembly_map.h"
+#include "kc868_a16_io.h"
+#if CONFIG_KC868_IO_BACKEND_SIMULATED
+#include "kc868_a16_sim.h"
+#else
+#include "i2c_manager.h"
+#endif
+
+#define PERF_SAMPLES CONFIG_OPENER_PERF_SAMPLES
+
+#define PERF_ENIP_PORT 44818U
+#define PERF_IO_PORT   2222U
+#define PERF_RECEIVE_TIMEOUT_MS 200
+#define PERF_RPI_US    10000U
+
+/* Encapsulation commands, see encap.c */
+#define PERF_COMMAND_REGISTER_SESSION 0x0065U
+#define PERF_COMMAND_SEND_RR_DATA     0x006FU
+
+/* SendRRData: interface handle, timeout, item count, two item headers */
+#define PERF_SEND_RR_DATA_HEADER (4U + 2U + 2U + 4U + 4U)
+#define PERF_CIP_REPLY_OFFSET (ENCAPSULATION_HEADER_LENGTH + \
+                               PERF_SEND_RR_DATA_HEADER)
+
+/* Identity of the originator, the connection serial changes per open */
+#define PERF_ORIGINATOR_VENDOR_ID 0x1234U
+#define PERF_ORIGINATOR_SERIAL    0x55667788U
+#define PERF_T2O_CONNECTION_ID    0x11223344U
+
+#define PERF_INPUT_ASSEMBLY_NUM 100U
+#define PERF_INPUT_SIZE  KC868_A16_ASSEMBLY_SIZE(KC868_A16_MAP_STANDARD_INPUT)
+#define PERF_OUTPUT_SIZE KC868_A16_ASSEMBLY_SIZE(KC868_A16_MAP_OUTPUT)
+
+#if CONFIG_KC868_IO_BACKEND_SIMULATED
+/* Longest wait for the scan task to react */
+#define PERF_IO_WAIT_US          200000
+/* Bus timeout of the scan task's transfers, see kc868_a16_io_pcf8574.c */
+#define PERF_BUS_TIMEOUT_US      10000U
+/* The scan task recovers the bus at most once per second */
+#define PERF_RECOVERY_HOLDOFF_MS 1100
+#define PERF_RECOVERY_SAMPLES    5
+#else
+/* The expanders in the order of the I/O scan task, see kc868_a16_io.h */
+#define PERF_I2C_TIMEOUT_MS 10
+static const uint8_t kExpanderAddresses[] = { 0x24, 0x25, 0x22, 0x21 };
+#endif
+
+typedef struct {
+  uint32_t count;
+  uint64_t sum_us;
+  uint32_t min_us;
+  uint32_t max_us;
+} PerfSamples;
+
+static bool s_stack_ready = false;
+static int s_listener = -1;
+static int s_client = -1; /* originator end of the session */
+static int s_session_socket = -1; /* end the stack serves */
+static int s_io_socket = -1; /* g_network_status.udp_io_messaging */
+static CipUdint s_session_handle;
+static CipUint s_connection_serial;
+static CipOctet s_frame[PC_OPENER_ETHERNET_BUFFER_SIZE];
+static ENIPMessage s_request;
+static ENIPMessage s_reply;
+
+static void SamplesReset(PerfSamples *const samples) {
+  memset(samples, 0, sizeof(*samples) );
+  samples->min_us = UINT32_MAX;
+}
+
+static void SamplesAdd(PerfSamples *const samples,
+                       const int64_t elapsed_us) {
+  const uint32_t value = (uint32_t)elapsed_us;
+  samples->count++;
+  samples->sum_us += value;
+  if(value < samples->min_us) {
+    samples->min_us = value;
+  }
+  if(value > samples->max_us) {
+    samples->max_us = value;
+  }
+}
+
+/* Latencies are judged by their mean, the maximum is reported for the
+ * jitter but depends too much on other tasks to be a threshold */
+static void ReportLatency(const char *const name,
+                          const PerfSamples *const samples,
+                          const uint32_t threshold_us) {
+  TEST_ASSERT_NOT_EQUAL(0, samples->count);
+  const uint32_t average_us = (uint32_t)(samples->sum_us / samples->count);
+  const bool pass = average_us <= threshold_us;
+  printf("[PERF] {\"name\":\"%s\",\"unit\":\"us\",\"value\":%" PRIu32
+         ",\"min\":%" PRIu32 ",\"max\":%" PRIu32 ",\"samples\":%" PRIu32
+         ",\"threshold\":%" PRIu32 ",\"limit\":\"max\",\"pass\":%s}\n",
+         name, average_us, samples->min_us, samples->max_us, samples->count,
+         threshold_us, pass ? "true" : "false");
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(threshold_us, average_us);
+}
+
+static void ReportMinimum(const char *const name,
+                          const uint32_t value,
+                          const uint32_t threshold) {
+  const bool pass = value >= threshold;
+  printf("[PERF] {\"name\":\"%s\",\"unit\":\"bytes\",\"value\":%" PRIu32
+         ",\"threshold\":%" PRIu32 ",\"limit\":\"min\",\"pass\":%s}\n",
+         name, value, threshold, pass ? "true" : "false");
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(threshold, value);
+}
+
+static void SetReceiveTimeout(const int socket_handle) {
+  const struct timeval timeout = {
+    .tv_sec = 0,
+    .tv_usec = PERF_RECEIVE_TIMEOUT_MS * 1000
+  };
+  TEST_ASSERT_EQUAL(0, setsockopt(socket_handle, SOL_SOCKET, SO_RCVTIMEO,
+                                  &timeout, sizeof(timeout) ) );
+}
+
+static struct sockaddr_in LoopbackAddress(const uint16_t port) {
+  struct sockaddr_in address = {
+    .sin_family = AF_INET,
+    .sin_port = htons(port),
+    .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+  };
+  return address;
+}
+
+static void ReceiveAll(const int socket_handle,
+                       CipOctet *const buffer,
+                       const size_t length) {
+  size_t received = 0;
+  while(received < length) {
+    const int result = recv(socket_handle, buffer + received,
+                            length - received, 0);
+    TEST_ASSERT_GREATER_THAN_INT(0, result);
+    received += (size_t)result;
+  }
+}
+
+/* Reads one encapsulation frame, header and data */
+static size_t ReceiveFrame(const int socket_handle) {
+  ReceiveAll(socket_handle, s_frame, ENCAPSULATION_HEADER_LENGTH);
+  const size_t length = LoadUint16LittleEndian(s_frame + 2);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(s_frame) - ENCAPSULATION_HEADER_LENGTH,
+                            length);
+  ReceiveAll(socket_handle, s_frame + ENCAPSULATION_HEADER_LENGTH, length);
+  return ENCAPSULATION_HEADER_LENGTH + length;
+}
+
+static void SendAll(const int socket_handle,
+                    const CipOctet *const data,
+                    const size_t length) {
+  TEST_ASSERT_EQUAL((int)length, send(socket_handle, data, length, 0) );
+}
+
+/* One explicit request as the network handler serves it: the frame is
+ * received on the session socket, handled, and the reply sent back. Leaves
+ * the reply in s_frame. */
+static void ExplicitRoundTrip(void) {
+  SendAll(s_client, s_request.message_buffer, s_request.used_message_length);
+
+  const size_t request_length = ReceiveFrame(s_session_socket);
+  struct sockaddr_in originator = LoopbackAddress(0);
+  socklen_t originator_length = sizeof(originator);
+  TEST_ASSERT_EQUAL(0, getpeername(s_session_socket,
+                                   (struct sockaddr *)&originator,
+                                   &originator_length) );
+  InitializeENIPMessage(&s_reply);
+  int remaining_bytes = 0;
+  g_current_active_tcp_socket = s_session_socket;
+  const EipStatus need_to_send =
+    HandleReceivedExplictTcpData(s_session_socket, s_frame, request_length,
+                                 &remaining_bytes,
+                                 (struct sockaddr *)&originator, &s_reply);
+  g_current_active_tcp_socket = kEipInvalidSocket;
+  TEST_ASSERT_EQUAL(0, remaining_bytes);
+  TEST_ASSERT_GREATER_THAN_INT(0, need_to_send);
+  SendAll(s_session_socket, s_reply.message_buffer,
+          s_reply.used_message_length);
+
+  (void)ReceiveFrame(s_client);
+  /* encapsulation status */
+  TEST_ASSERT_EQUAL_UINT32(0, LoadUint32LittleEndian(s_frame + 8) );
+}
+
+static void BeginEncapsulation(const CipUint command,
+                               const CipUint length) {
+  InitializeENIPMessage(&s_request);
+  AddIntToMessage(command, &s_request);
+  AddIntToMessage(length, &s_request);
+  AddDintToMessage(s_session_handle, &s_request);
+  AddDintToMessage(0, &s_request); /* status */
+  FillNextNMessageOctetsWithValueAndMoveToNextPosition(0, 8, &s_request);
+  AddDintToMessage(0, &s_request); /* options */
+}
+
+/* An unconnected request in a SendRRData, service and path included */
+static void BuildSendRRData(const CipOctet *const data,
+                            const size_t length) {
+  BeginEncapsulation(PERF_COMMAND_SEND_RR_DATA,
+                     (CipUint)(PERF_SEND_RR_DATA_HEADER + length) );
+  AddDintToMessage(0, &s_request); /* interface handle */
+  AddIntToMessage(0, &s_request); /* timeout */
+  AddIntToMessage(2, &s_request); /* item count */
+  AddIntToMessage(kCipItemIdNullAddress, &s_request);
+  AddIntToMessage(0, &s_request);
+  AddIntToMessage(kCipItemIdUnconnectedDataItem, &s_request);
+  AddIntToMessage( (CipUint)length, &s_request );
+  memcpy(s_request.current_message_position, data, length);
+  s_request.current_message_position += length;
+  s_request.used_message_length += length;
+}
+
+/* General status of the CIP reply in s_frame */
+static CipUsint ReplyGeneralStatus(void) {
+  return s_frame[PERF_CIP_REPLY_OFFSET + 2];
+}
+
+static void RegisterSession(void) {
+  s_session_handle = 0;
+  BeginEncapsulation(PERF_COMMAND_REGISTER_SESSION, 4);
+  AddIntToMessage(1, &s_request); /* protocol version */
+  AddIntToMessage(0, &s_request); /* options */
+  ExplicitRoundTrip();
+  s_session_handle = LoadUint32LittleEndian(s_frame + 4);
+  TEST_ASSERT_NOT_EQUAL(0, s_session_handle);
+}
+
+/* Exclusive owner O->T 150, T->O 100, configuration 151, both cyclic point
+ * to point at PERF_RPI_US; the sizes follow the run/idle header settings */
+static void BuildForwardOpen(void) {
+  const CipUint o2t_size = (CipUint)(2U + PERF_OUTPUT_SIZE +
+                                     (CipRunIdleHeaderGetO2T() ? 4U : 0U) );
+  const CipUint t2o_size = (CipUint)(2U + PERF_INPUT_SIZE +
+                                     (CipRunIdleHeaderGetT2O() ? 4U : 0U) );
+  CipOctet data[96];
+  ENIPMessage *const message = &s_reply; /* scratch, sent before replies */
+  InitializeENIPMessage(message);
+  AddSintToMessage(kForwardOpen, message);
+  AddSintToMessage(2, message); /* path to the Connection Manager */
+  AddSintToMessage(0x20, message);
+  AddSintToMessage(0x06, message);
+  AddSintToMessage(0x24, message);
+  AddSintToMessage(0x01, message);
+  AddSintToMessage(0x0A, message); /* priority / time tick */
+  AddSintToMessage(0xF0, message); /* timeout ticks */
+  AddDintToMessage(0, message); /* O->T connection ID, chosen by the target */
+  AddDintToMessage(PERF_T2O_CONNECTION_ID, message);
+  AddIntToMessage(++s_connection_serial, message);
+  AddIntToMessage(PERF_ORIGINATOR_VENDOR_ID, message);
+  AddDintToMessage(PERF_ORIGINATOR_SERIAL, message);
+  AddSintToMessage(1, message); /* timeout multiplier */
+  FillNextNMessageOctetsWithValueAndMoveToNextPosition(0, 3, message);
+  AddDintToMessage(PERF_RPI_US, message); /* O->T RPI */
+  AddIntToMessage(0x4000 | o2t_size, message); /* point to point */
+  AddDintToMessage(PERF_RPI_US, message); /* T->O RPI */
+  AddIntToMessage(0x4000 | t2o_size, message); /* point to point */
+  AddSintToMessage(0x01, message); /* class 1, cyclic */
+  AddSintToMessage(9, message); /* connection path size in words */
+  AddSintToMessage(0x34, message); /* electronic key, format 4 */
+  AddSintToMessage(0x04, message);
+  AddIntToMessage(OPENER_DEVICE_VENDOR_ID, message);
+  AddIntToMessage(OPENER_DEVICE_TYPE, message);
+  AddIntToMessage(OPENER_DEVICE_PRODUCT_CODE, message);
+  AddSintToMessage(OPENER_DEVICE_MAJOR_REVISION, message);
+  AddSintToMessage(OPENER_DEVICE_MINOR_REVISION, message);
+  AddSintToMessage(0x20, message); /* class assembly */
+  AddSintToMessage(0x04, message);
+  AddSintToMessage(0x24, message); /* configuration instance */
+  AddSintToMessage(KC868_A16_CONFIG_ASSEMBLY_NUM, message);
+  AddSintToMessage(0x2C, message); /* consumed connection point */
+  AddSintToMessage(KC868_A16_OUTPUT_ASSEMBLY_NUM, message);
+  AddSintToMessage(0x2C, message); /* produced connection point */
+  AddSintToMessage(PERF_INPUT_ASSEMBLY_NUM, message);
+
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(data), message->used_message_length);
+  const size_t length = message->used_message_length;
+  memcpy(data, message->message_buffer, length);
+  BuildSendRRData(data, length);
+}
+
+/* Closes the connection of the last BuildForwardOpen() */
+static void BuildForwardClose(void) {
+  static const CipOctet kApplicationPath[] = {
+    0x20, 0x04, 0x24, KC868_A16_CONFIG_ASSEMBLY_NUM,
+    0x2C, KC868_A16_OUTPUT_ASSEMBLY_NUM, 0x2C, PERF_INPUT_ASSEMBLY_NUM
+  };
+  CipOctet data[48];
+  ENIPMessage *const message = &s_reply;
+  InitializeENIPMessage(message);
+  AddSintToMessage(kForwardClose, message);
+  AddSintToMessage(2, message);
+  AddSintToMessage(0x20, message);
+  AddSintToMessage(0x06, message);
+  AddSintToMessage(0x24, message);
+  AddSintToMessage(0x01, message);
+  AddSintToMessage(0x0A, message); /* priority / time tick */
+  AddSintToMessage(0xF0, message); /* timeout ticks */
+  AddIntToMessage(s_connection_serial, message);
+  AddIntToMessage(PERF_ORIGINATOR_VENDOR_ID, message);
+  AddDintToMessage(PERF_ORIGINATOR_SERIAL, message);
+  AddSintToMessage(sizeof(kApplicationPath) / 2U, message);
+  AddSintToMessage(0, message); /* reserved */
+  memcpy(message->current_message_position, kApplicationPath,
+         sizeof(kApplicationPath) );
+  message->current_message_position += sizeof(kApplicationPath);
+  message->used_message_length += sizeof(kApplicationPath);
+
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(data), message->used_message_length);
+  const size_t length = message->used_message_length;
+  memcpy(data, message->message_buffer, length);
+  BuildSendRRData(data, length);
+}
+
+/* Opens the connection and returns the O->T connection ID chosen by us */
+static CipUdint ForwardOpen(void) {
+  BuildForwardOpen();
+  ExplicitRoundTrip();
+  TEST_ASSERT_EQUAL_HEX8(0x80 | kForwardOpen, s_frame[PERF_CIP_REPLY_OFFSET]);
+  TEST_ASSERT_EQUAL_HEX8(kCipErrorSuccess, ReplyGeneralStatus() );
+  return LoadUint32LittleEndian(s_frame + PERF_CIP_REPLY_OFFSET + 4);
+}
+
+static void ForwardClose(void) {
+  BuildForwardClose();
+  ExplicitRoundTrip();
+  TEST_ASSERT_EQUAL_HEX8(kCipErrorSuccess, ReplyGeneralStatus() );
+}
+
+/* Drops the datagrams queued on the I/O socket, e.g. earlier productions */
+static void DrainIoSocket(void) {
+  CipOctet datagram[64];
+  while(recv(s_io_socket, datagram, sizeof(datagram), MSG_DONTWAIT) > 0) {
+  }
+}
+
+/* Receives I/O datagrams until one of connection_id arrives */
+static int ReceiveIo(const CipUdint connection_id,
+                     struct sockaddr_in *const from) {
+  for(;; ) {
+    socklen_t from_length = sizeof(*from);
+    const int length = recvfrom(s_io_socket, s_frame, sizeof(s_frame), 0,
+                                (struct sockaddr *)from, &from_length);
+    TEST_ASSERT_GREATER_THAN_INT_MESSAGE(0, length, "I/O datagram missing");
+    if(length >= 10 &&
+       kCipItemIdSequencedAddressItem == LoadUint16LittleEndian(s_frame + 2) &&
+       connection_id == LoadUint32LittleEndian(s_frame + 6) ) {
+      return length;
+    }
+  }
+}
+
+static void BuildO2TPacket(const CipUdint connection_id,
+                           const CipUdint sequence) {
+  const CipUint data_length = (CipUint)(2U + PERF_OUTPUT_SIZE +
+                                        (CipRunIdleHeaderGetO2T() ? 4U : 0U) );
+  InitializeENIPMessage(&s_request);
+  AddIntToMessage(2, &s_request); /* item count */
+  AddIntToMessage(kCipItemIdSequencedAddressItem, &s_request);
+  AddIntToMessage(8, &s_request);
+  AddDintToMessage(connection_id, &s_request);
+  AddDintToMessage(sequence, &s_request); /* encapsulation sequence number */
+  AddIntToMessage(kCipItemIdConnectedDataItem, &s_request);
+  AddIntToMessage(data_length, &s_request);
+  AddIntToMessage( (CipUint)sequence, &s_request ); /* CIP sequence count */
+  if(CipRunIdleHeaderGetO2T() ) {
+    AddDintToMessage(1, &s_request); /* run */
+  }
+  /* all relays off, the board may be wired to the machine */
+  FillNextNMessageOctetsWithValueAndMoveToNextPosition(0, PERF_OUTPUT_SIZE,
+                                                       &s_request);
+}
+
+static void OpenSession(void) {
+  struct sockaddr_in address = LoopbackAddress(PERF_ENIP_PORT);
+  const int enable = 1;
+
+  s_listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  TEST_ASSERT_GREATER_OR_EQUAL_INT(0, s_listener);
+  TEST_ASSERT_EQUAL(0, setsockopt(s_listener, SOL_SOCKET, SO_REUSEADDR,
+                                  &enable, sizeof(enable) ) );
+  TEST_ASSERT_EQUAL(0, bind(s_listener, (struct sockaddr *)&address,
+                            sizeof(address) ) );
+  TEST_ASSERT_EQUAL(0, listen(s_listener, 1) );
+
+  s_client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  TEST_ASSERT_GREATER_OR_EQUAL_INT(0, s_client);
+  TEST_ASSERT_EQUAL(0, connect(s_client, (struct sockaddr *)&address,
+                               sizeof(address) ) );
+  s_session_socket = accept(s_listener, NULL, NULL);
+  TEST_ASSERT_GREATER_OR_EQUAL_INT(0, s_session_socket);
+  (void)setsockopt(s_client, IPPROTO_TCP, TCP_NODELAY, &enable,
+                   sizeof(enable) );
+  (void)setsockopt(s_session_socket, IPPROTO_TCP, TCP_NODELAY, &enable,
+                   sizeof(enable) );
+  SetReceiveTimeout(s_client);
+  SetReceiveTimeout(s_session_socket);
+
+  RegisterSession();
+}
+
+static void OpenIoSocket(void) {
+  struct sockaddr_in address = LoopbackAddress(PERF_IO_PORT);
+  s_io_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  TEST_ASSERT_GREATER_OR_EQUAL_INT(0, s_io_socket);
+  TEST_ASSERT_EQUAL(0, bind(s_io_socket, (struct sockaddr *)&address,
+                            sizeof(address) ) );
+  SetReceiveTimeout(s_io_socket);
+  g_network_status.udp_io_messaging = s_io_socket;
+}
+
+/* The parts of opener_init() and NetworkHandlerInitialize() the tests need,
+ * on the loopback address and without the OpENer task */
+static void PrepareStack(void) {
+  if(s_stack_ready) {
+    return;
+  }
+  esp_err_t result = nvs_flash_init();
+  if(ESP_ERR_NVS_NO_FREE_PAGES == result ||
+     ESP_ERR_NVS_NEW_VERSION_FOUND == result) {
+    TEST_ESP_OK(nvs_flash_erase() );
+    result = nvs_flash_init();
+  }
+  TEST_ESP_OK(result);
+  TEST_ESP_OK(esp_netif_init() ); /* starts the tcpip thread */
+
+  g_network_status.tcp_listener = kEipInvalidSocket;
+  g_network_status.udp_unicast_listener = kEipInvalidSocket;
+  g_network_status.udp_global_broadcast_listener = kEipInvalidSocket;
+  g_network_status.udp_io_messaging = kEipInvalidSocket;
+  opener_prepare();
+
+  g_tcpip.interface_configuration.ip_address = htonl(INADDR_LOOPBACK);
+  g_tcpip.interface_configuration.network_mask = htonl(0xFF000000U);
+  g_network_status.ip_address = g_tcpip.interface_configuration.ip_address;
+  g_network_status.network_mask =
+    g_tcpip.interface_configuration.network_mask;
+  NetworkHandlerInitializeSessions();
+  EncapsulationInit();
+
+  OpenIoSocket();
+  OpenSession();
+  s_stack_ready = true;
+}
+
+TEST_GROUP(opener_perf);
+
+TEST_SETUP(opener_perf)
+{
+  /* The stack stays set up for all cases, so no leak check */
+  PrepareStack();
+}
+
+TEST_TEAR_DOWN(opener_perf)
+{
+}
+
+TEST(opener_perf, forward_open_latency)
+{
+  PerfSamples samples;
+  SamplesReset(&samples);
+  for(int i = 0; i < PERF_SAMPLES; ++i) {
+    BuildForwardOpen();
+    const int64_t start = esp_timer_get_time();
+    ExplicitRoundTrip();
+    SamplesAdd(&samples, esp_timer_get_time() - start);
+    TEST_ASSERT_EQUAL_HEX8(kCipErrorSuccess, ReplyGeneralStatus() );
+    ForwardClose();
+  }
+  ReportLatency("forward_open_latency", &samples,
+                CONFIG_OPENER_PERF_FORWARD_OPEN_MAX_US);
+}
+
+TEST(opener_perf, get_attribute_single_latency)
+{
+  static const CipOctet kGetProductName[] =
+  { kGetAttributeSingle, 0x03, 0x20, 0x01, 0x24, 0x01, 0x30, 0x07 };
+  PerfSamples samples;
+  SamplesReset(&samples);
+  for(int i = 0; i < PERF_SAMPLES; ++i) {
+    BuildSendRRData(kGetProductName, sizeof(kGetProductName) );
+    const int64_t start = esp_timer_get_time();
+    ExplicitRoundTrip();
+    SamplesAdd(&samples, esp_timer_get_time() - start);
+    TEST_ASSERT_EQUAL_HEX8(kCipErrorSuccess, ReplyGeneralStatus() );
+  }
+  ReportLatency("get_attribute_single_latency", &samples,
+                CONFIG_OPENER_PERF_GET_ATTRIBUTE_MAX_US);
+}
+
+/* One cycle is an O->T packet sent, received and consumed, then the T->O
+ * production of ManageConnections() until it is received. The test waits an
+ * RPI before each cycle so the production is due; the wait is not counted. */
+TEST(opener_perf, class1_cycle_time)
+{
+  const CipUdint o2t_connection_id = ForwardOpen();
+  const CipUdint t2o_connection_id =
+    LoadUint32LittleEndian(s_frame + PERF_CIP_REPLY_OFFSET + 8);
+  const struct sockaddr_in device = LoopbackAddress(PERF_IO_PORT);
+  const TickType_t rpi_ticks = pdMS_TO_TICKS(PERF_RPI_US / 1000U) + 1;
+  struct sockaddr_in from;
+  PerfSamples samples;
+  SamplesReset(&samples);
+  DrainIoSocket();
+
+  for(int i = 0; i < PERF_SAMPLES; ++i) {
+    BuildO2TPacket(o2t_connection_id, (CipUdint)i + 1U);
+    vTaskDelay(rpi_ticks);
+    const int64_t start = esp_timer_get_time();
+    TEST_ASSERT_EQUAL( (int)s_request.used_message_length,
+                       sendto(s_io_socket, s_request.message_buffer,
+                              s_request.used_message_length, 0,
+                              (const struct sockaddr *)&device,
+                              sizeof(device) ) );
+    const int length = ReceiveIo(o2t_connection_id, &from);
+    TEST_ASSERT_EQUAL(kEipStatusOk,
+                      HandleReceivedConnectedData(s_frame, length, &from) );
+    (void)ManageConnections(PERF_RPI_US / 1000U);
+    (void)ReceiveIo(t2o_connection_id, &from);
+    SamplesAdd(&samples, esp_timer_get_time() - start);
+  }
+  ForwardClose();
+  DrainIoSocket();
+  ReportLatency("class1_cycle_time", &samples,
+                CONFIG_OPENER_PERF_CLASS1_CYCLE_MAX_US);
+}
+
+#if CONFIG_KC868_IO_BACKEND_SIMULATED
+static void GetBusStatistics(KC868_A16_IoBusStatistics *const statistics) {
+  while(!KC868_A16_IoGetBusStatistics(statistics) ) {
+    /* the scan task was publishing, try again */
+  }
+}
+
+/* X01 is switched on and off and timed until the scan task raises the
+ * change of state flag the application triggers its connections on. No
+ * OpENer task takes the flag meanwhile. Each sample starts a tick later, at
+ * another phase of the scan period. */
+TEST(opener_perf, cos_input_latency)
+{
+  EipUint8 image[KC868_A16_INPUT_IMAGE_SIZE];
+  PerfSamples samples;
+  SamplesReset(&samples);
+  for(int i = 0; i < PERF_SAMPLES; ++i) {
+    const KC868_A16_SimSignal level = {
+      .type = kKc868SimSignalConstant,
+      .high = (uint16_t)( (i + 1) & 1),
+    };
+    vTaskDelay(1);
+    (void)KC868_A16_IoTakeInputChange();
+    const int64_t start = esp_timer_get_time();
+    KC868_A16_SimSetDigitalSignal(0, &level);
+    while(!KC868_A16_IoTakeInputChange() ) {
+      TEST_ASSERT_TRUE_MESSAGE(esp_timer_get_time() - start < PERF_IO_WAIT_US,
+                               "no change of state");
+    }
+    SamplesAdd(&samples, esp_timer_get_time() - start);
+    TEST_ASSERT_TRUE(KC868_A16_IoGetInputImage(image) );
+    TEST_ASSERT_EQUAL(level.high, image[0] & 0x01);
+  }
+  ReportLatency("cos_input_latency", &samples,
+                CONFIG_OPENER_PERF_COS_INPUT_MAX_US);
+}
+
+/* The bus gets stuck at X01-X08 until it is recovered: timed from the
+ * fault until the expander is read again, through the failed access, the
+ * bus recovery and the retry of the scan task. A retry is counted once it
+ * is done, so its counter tells when the expander answered again. */
+TEST(opener_perf, bus_fault_recovery)
+{
+  const KC868_A16_SimLatency latency = { .timeout_us = PERF_BUS_TIMEOUT_US };
+  const KC868_A16_SimLatency no_latency = { 0 };
+  const KC868_A16_SimFault stuck = {
+    .result = kKc868SimTimeout,
+    .until_recovery = true,
+  };
+  KC868_A16_IoBusStatistics before;
+  KC868_A16_IoBusStatistics statistics;
+  PerfSamples samples;
+  SamplesReset(&samples);
+  KC868_A16_SimSetLatency(&latency);
+  GetBusStatistics(&before);
+
+  for(int i = 0; i < PERF_RECOVERY_SAMPLES; ++i) {
+    vTaskDelay(pdMS_TO_TICKS(PERF_RECOVERY_HOLDOFF_MS) );
+    GetBusStatistics(&statistics);
+    const KC868_A16_ExpanderStatistics last =
+      statistics.expander[kKc868ExpanderInputs1To8];
+    const int64_t start = esp_timer_get_time();
+    KC868_A16_SimSetFault(kKc868ExpanderInputs1To8, &stuck);
+    do {
+      TEST_ASSERT_TRUE_MESSAGE(esp_timer_get_time() - start < PERF_IO_WAIT_US,
+                               "the bus was not recovered");
+      GetBusStatistics(&statistics);
+    } while(statistics.expander[kKc868ExpanderInputs1To8].retries ==
+            last.retries);
+    SamplesAdd(&samples, esp_timer_get_time() - start);
+    TEST_ASSERT_EQUAL_UINT32(last.errors + 1,
+                             statistics.expander[kKc868ExpanderInputs1To8].errors);
+    /* The status follows the statistics */
+    while(0 != (KC868_A16_IoGetStatus() & KC868_A16_IO_INPUTS_1_8_STALE) ) {
+      TEST_ASSERT_TRUE_MESSAGE(esp_timer_get_time() - start < PERF_IO_WAIT_US,
+                               "X01-X08 stay stale");
+    }
+  }
+  KC868_A16_SimSetLatency(&no_latency);
+  GetBusStatistics(&statistics);
+  TEST_ASSERT_EQUAL_UINT32(before.bus_recoveries + PERF_RECOVERY_SAMPLES,
+                           statistics.bus_recoveries);
+  ReportLatency("bus_fault_recovery", &samples,
+                CONFIG_OPENER_PERF_BUS_RECOVERY_MAX_US);
+}
+#else
+/* One read of each expander as one batch, while the I/O scan task keeps
+ * scanning; needs the KC868-A16 board */
+TEST(opener_perf, i2c_scan_time)
+{
+  uint8_t values[sizeof(kExpanderAddresses)];
+  i2c_manager_op_t ops[sizeof(kExpanderAddresses)];
+  i2c_manager_scan_handle_t scan = NULL;
+  for(size_t i = 0; i < sizeof(kExpanderAddresses); ++i) {
+    ops[i] = (i2c_manager_op_t) {
+      .type = I2C_MANAGER_OP_READ,
+      .address = kExpanderAddresses[i],
+      .data = &values[i],
+      .length = 1,
+    };
+  }
+  TEST_ESP_OK(i2c_manager_create_scan(ops, sizeof(kExpanderAddresses),
+                                      &scan) );
+
+  PerfSamples samples;
+  SamplesReset(&samples);
+  esp_err_t result = ESP_OK;
+  for(int i = 0; i < PERF_SAMPLES && ESP_OK == result; ++i) {
+    const int64_t start = esp_timer_get_time();
+    result = i2c_manager_execute_scan(scan, PERF_I2C_TIMEOUT_MS);
+    SamplesAdd(&samples, esp_timer_get_time() - start);
+  }
+  TEST_ESP_OK(i2c_manager_delete_scan(scan) );
+  TEST_ASSERT_EQUAL_HEX32_MESSAGE(ESP_OK, result,
+                                  "expanders not found, is this a KC868-A16?");
+  ReportLatency("i2c_scan_time", &samples, CONFIG_OPENER_PERF_I2C_SCAN_MAX_US);
+}
+
+#endif
+
+/* Last, so the high water marks cover all the cases before */
+TEST(opener_perf, heap_and_stack_usage)
+{
+  ReportMinimum("heap_minimum_free",
+                (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+                CONFIG_OPENER_PERF_MIN_FREE_HEAP);
+  ReportMinimum("opener_stack_minimum_free",
+                (uint32_t)uxTaskGetStackHighWaterMark(NULL),
+                CONFIG_OPENER_PERF_MIN_FREE_STACK);
+  TaskHandle_t io_task = xTaskGetHandle("kc868_io");
+  TEST_ASSERT_NOT_NULL(io_task);
+  ReportMinimum("io_scan_stack_minimum_free",
+                (uint32_t)uxTaskGetStackHighWaterMark(io_task),
+                CONFIG_OPENER_PERF_MIN_FREE_STACK);
+}
+
+TEST_GROUP_RUNNER(opener_perf)
+{
+  RUN_TEST_CASE(opener_perf, forward_open_latency)
+  RUN_TEST_CASE(opener_perf, get_attribute_single_latency)
+  RUN_TEST_CASE(opener_perf, class1_cycle_time)
+#if CONFIG_KC868_IO_BACKEND_SIMULATED
+  RUN_TEST_CASE(opener_perf, cos_input_latency)
+  RUN_TEST_CASE(opener_perf, bus_fault_recovery)
+#else
+  RUN_TEST_CASE(opener_perf, i2c_scan_time)
+#endif
+  RUN_TEST_CASE(opener_perf, heap_and_stack_usage)
+}
+
+void app_main(void)
+{
+  UNITY_MAIN(opener_perf);
+}
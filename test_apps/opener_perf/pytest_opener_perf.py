@@ -0,0 +1,77 @@
+"""
+OpENer performance regression test
+
+Runs the opener_perf test app on a KC868-A16, collects the "[PERF] {json}"
+line of every measurement and writes them to opener_perf.json in the log
+directory of the test case, so a CI job can keep and compare them across
+firmware versions. A measurement beyond its threshold fails the test, in
+addition to the failing Unity case on the device.
+
+The "default" configuration scans the expanders of the board, "simulated"
+(sdkconfig.ci.simulated) runs the I/O scan task on the simulated backend.
+
+    pytest --target esp32 test_apps/opener_perf
+"""
+
+import json
+import os
+import re
+
+import pytest
+from pytest_embedded import Dut
+from pytest_embedded_idf.utils import idf_parametrize
+
+# In the order the test app reports them, see TEST_GROUP_RUNNER(opener_perf)
+STACK_MEASUREMENTS = [
+    'forward_open_latency',
+    'get_attribute_single_latency',
+    'class1_cycle_time',
+]
+USAGE_MEASUREMENTS = [
+    'heap_minimum_free',
+    'opener_stack_minimum_free',
+    'io_scan_stack_minimum_free',
+]
+IO_MEASUREMENTS = {
+    'default': ['i2c_scan_time'],
+    'simulated': ['cos_input_latency', 'bus_fault_recovery'],
+}
+
+PERF_LINE = re.compile(rb'\[PERF\] (\{[^\r\n]*\})')
+UNITY_SUMMARY = re.compile(rb'(\d+) Tests (\d+) Failures (\d+) Ignored')
+
+
+def within_threshold(result: dict) -> bool:
+    """True if the value of a measurement respects its threshold"""
+    if result['limit'] == 'min':
+        return result['value'] >= result['threshold']
+    return result['value'] <= result['threshold']
+
+
+@pytest.mark.generic
+@idf_parametrize('config', ['default', 'simulated'], indirect=['config'])
+@idf_parametrize('target', ['esp32'], indirect=['target'])
+def test_opener_perf(dut: Dut, config: str) -> None:
+    # A failed case prints no result, so read up to the Unity summary
+    results = {}
+    while True:
+        match = dut.expect([PERF_LINE, UNITY_SUMMARY], timeout=120)
+        if match.re is UNITY_SUMMARY:
+            summary = match
+            break
+        result = json.loads(match.group(1).decode())
+        results[result['name']] = result
+
+    with open(os.path.join(dut.logdir, 'opener_perf.json'), 'w', encoding='utf-8') as output:
+        json.dump(results, output, indent=2)
+
+    measurements = STACK_MEASUREMENTS + IO_MEASUREMENTS[config] + USAGE_MEASUREMENTS
+    missing = [name for name in measurements if name not in results]
+    assert not missing, f'no result for {", ".join(missing)}'
+    exceeded = [
+        f'{name}: {result["value"]} {result["unit"]}, threshold {result["threshold"]}'
+        for name, result in results.items()
+        if not within_threshold(result)
+    ]
+    assert not exceeded, 'thresholds exceeded: ' + '; '.join(exceeded)
+    assert int(summary.group(2)) == 0, 'a Unity test case failed'
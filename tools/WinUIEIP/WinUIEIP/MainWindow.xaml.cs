@@ -135,6 +135,7 @@ public sealed partial class MainWindow : Window
             Type? pageType = tag switch
             {
                 "Configuration" => typeof(ConfigurationPage),
+                "Dashboard" => typeof(DashboardPage),
                 "Mpu6050Status" => typeof(Mpu6050StatusPage),
                 "Lsm6ds3Status" => typeof(Lsm6ds3StatusPage),
                 "InputAssembly" => typeof(InputAssemblyPage),
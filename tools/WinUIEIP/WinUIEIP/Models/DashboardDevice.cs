@@ -0,0 +1,137 @@
+using System;
+using System.ComponentModel;
+using System.Runtime.CompilerServices;
+
+namespace EulerLink.Models;
+
+// One row of the dashboard, refreshed from the device's GET /api/status
+public class DashboardDevice : INotifyPropertyChanged
+{
+    private string _productName = string.Empty;
+    private string _stateText = "Connecting...";
+    private string _uptimeText = string.Empty;
+    private string _inputsText = string.Empty;
+    private string _outputsText = string.Empty;
+    private string _connectionsText = string.Empty;
+    private string _heapText = string.Empty;
+    private string _lastUpdateText = string.Empty;
+    private bool _isOnline;
+    private uint _failedPolls;
+
+    public string IpAddress { get; init; } = string.Empty;
+
+    public string ProductName
+    {
+        get => _productName;
+        private set => SetField(ref _productName, value);
+    }
+
+    public string StateText
+    {
+        get => _stateText;
+        private set => SetField(ref _stateText, value);
+    }
+
+    public string UptimeText
+    {
+        get => _uptimeText;
+        private set => SetField(ref _uptimeText, value);
+    }
+
+    public string InputsText
+    {
+        get => _inputsText;
+        private set => SetField(ref _inputsText, value);
+    }
+
+    public string OutputsText
+    {
+        get => _outputsText;
+        private set => SetField(ref _outputsText, value);
+    }
+
+    public string ConnectionsText
+    {
+        get => _connectionsText;
+        private set => SetField(ref _connectionsText, value);
+    }
+
+    public string HeapText
+    {
+        get => _heapText;
+        private set => SetField(ref _heapText, value);
+    }
+
+    public string LastUpdateText
+    {
+        get => _lastUpdateText;
+        private set => SetField(ref _lastUpdateText, value);
+    }
+
+    public bool IsOnline
+    {
+        get => _isOnline;
+        private set => SetField(ref _isOnline, value);
+    }
+
+    public uint FailedPolls
+    {
+        get => _failedPolls;
+        private set => SetField(ref _failedPolls, value);
+    }
+
+    public void Update(DeviceStatus status)
+    {
+        IsOnline = true;
+        if (status.Identity != null)
+        {
+            ProductName = status.Identity.ProductName;
+            StateText = GetStateText(status.Identity.State);
+        }
+        UptimeText = TimeSpan.FromSeconds(status.UptimeSeconds).ToString(@"d\.hh\:mm\:ss");
+        if (status.Io != null)
+        {
+            InputsText = $"0x{status.Io.Inputs:X4}";
+            OutputsText = status.Io.OutputsOwned ? $"0x{status.Io.Outputs:X4} (PLC)" : $"0x{status.Io.Outputs:X4}";
+        }
+        if (status.Connections != null)
+        {
+            ConnectionsText = $"{status.Connections.Active} ({status.Connections.LatePackets} late, {status.Connections.MissedPackets} missed)";
+        }
+        if (status.Heap != null)
+        {
+            HeapText = $"{status.Heap.Free / 1024} KB (min {status.Heap.MinimumFree / 1024} KB)";
+        }
+        LastUpdateText = DateTime.Now.ToString("HH:mm:ss");
+    }
+
+    public void SetError(string error)
+    {
+        IsOnline = false;
+        FailedPolls++;
+        StateText = $"Offline: {error}";
+    }
+
+    private static string GetStateText(byte state)
+    {
+        return state switch
+        {
+            1 => "Self Testing",
+            2 => "Standby",
+            3 => "Operational",
+            4 => "Recoverable Fault",
+            5 => "Unrecoverable Fault",
+            _ => "Unknown"
+        };
+    }
+
+    public event PropertyChangedEventHandler? PropertyChanged;
+
+    private void SetField<T>(ref T field, T value, [CallerMemberName] string? propertyName = null)
+    {
+        if (Equals(field, value))
+            return;
+        field = value;
+        PropertyChanged?.Invoke(this, new PropertyChangedEventArgs(propertyName));
+    }
+}
@@ -0,0 +1,119 @@
+using System.Collections.Generic;
+using System.Text.Json.Serialization;
+
+namespace EulerLink.Models;
+
+// Response of GET /api/status, the aggregate a dashboard reads per refresh
+public class DeviceStatus
+{
+    [JsonPropertyName("uptime_s")]
+    public uint UptimeSeconds { get; set; }
+
+    [JsonPropertyName("identity")]
+    public DeviceIdentityStatus? Identity { get; set; }
+
+    [JsonPropertyName("network")]
+    public DeviceNetworkStatus? Network { get; set; }
+
+    [JsonPropertyName("io")]
+    public DeviceIoStatus? Io { get; set; }
+
+    [JsonPropertyName("connections")]
+    public DeviceConnectionStatus? Connections { get; set; }
+
+    [JsonPropertyName("heap")]
+    public DeviceHeapStatus? Heap { get; set; }
+
+    [JsonPropertyName("input_assembly_100")]
+    public AssemblyDataItem? InputAssembly100 { get; set; }
+
+    [JsonPropertyName("output_assembly_150")]
+    public AssemblyDataItem? OutputAssembly150 { get; set; }
+}
+
+public class DeviceIdentityStatus
+{
+    [JsonPropertyName("vendor_id")]
+    public ushort VendorId { get; set; }
+
+    [JsonPropertyName("device_type")]
+    public ushort DeviceType { get; set; }
+
+    [JsonPropertyName("product_code")]
+    public ushort ProductCode { get; set; }
+
+    [JsonPropertyName("major_revision")]
+    public byte MajorRevision { get; set; }
+
+    [JsonPropertyName("minor_revision")]
+    public byte MinorRevision { get; set; }
+
+    [JsonPropertyName("serial_number")]
+    public string SerialNumber { get; set; } = string.Empty;
+
+    [JsonPropertyName("product_name")]
+    public string ProductName { get; set; } = string.Empty;
+
+    [JsonPropertyName("status")]
+    public ushort Status { get; set; }
+
+    [JsonPropertyName("state")]
+    public byte State { get; set; }
+}
+
+public class DeviceNetworkStatus
+{
+    [JsonPropertyName("ip_address")]
+    public string IpAddress { get; set; } = string.Empty;
+
+    [JsonPropertyName("hostname")]
+    public string Hostname { get; set; } = string.Empty;
+
+    [JsonPropertyName("link_up")]
+    public bool LinkUp { get; set; }
+
+    [JsonPropertyName("link_speed")]
+    public uint LinkSpeed { get; set; }
+
+    [JsonPropertyName("full_duplex")]
+    public bool FullDuplex { get; set; }
+}
+
+public class DeviceIoStatus
+{
+    [JsonPropertyName("inputs")]
+    public ushort Inputs { get; set; }
+
+    [JsonPropertyName("outputs")]
+    public ushort Outputs { get; set; }
+
+    [JsonPropertyName("outputs_owned")]
+    public bool OutputsOwned { get; set; }
+
+    [JsonPropertyName("analog")]
+    public List<ushort> Analog { get; set; } = new();
+
+    [JsonPropertyName("failed_expanders")]
+    public byte FailedExpanders { get; set; }
+}
+
+public class DeviceConnectionStatus
+{
+    [JsonPropertyName("active")]
+    public uint Active { get; set; }
+
+    [JsonPropertyName("late_packets")]
+    public uint LatePackets { get; set; }
+
+    [JsonPropertyName("missed_packets")]
+    public uint MissedPackets { get; set; }
+}
+
+public class DeviceHeapStatus
+{
+    [JsonPropertyName("free")]
+    public uint Free { get; set; }
+
+    [JsonPropertyName("min_free")]
+    public uint MinimumFree { get; set; }
+}
@@ -18,5 +18,13 @@ public class LogBufferResponse
 
     [JsonPropertyName("truncated")]
     public bool Truncated { get; set; }
+
+    // Cursor for the next request, only new messages are returned with it
+    [JsonPropertyName("next")]
+    public uint? Next { get; set; }
+
+    // Messages overwritten on the device before they were downloaded
+    [JsonPropertyName("lost")]
+    public uint Lost { get; set; }
 }
 
@@ -15,6 +15,14 @@ public class DeviceApiService
     private readonly HttpClient _httpClient;
     private string _deviceIp = "172.16.82.99";
     private bool _isConnected = false;
+    private uint _assemblyVersion = 0;
+    private AssemblyData? _lastAssemblies;
+
+    // Binary record of GET /api/assemblies?format=bin
+    private const int AssemblyRecordHeaderSize = 16;
+    private const byte AssemblyRecordFormat = 1;
+    // Short enough that the connection state on the pages stays current
+    private const int AssemblyWaitMs = 2000;
 
     public static DeviceApiService Instance
     {
@@ -41,6 +49,8 @@ public class DeviceApiService
     public void SetDeviceIp(string ip)
     {
         _deviceIp = ip;
+        _assemblyVersion = 0;
+        _lastAssemblies = null;
     }
 
     public void SetConnected(bool connected)
@@ -115,66 +125,66 @@ public class DeviceApiService
     {
         try
         {
-            var response = await _httpClient.GetAsync($"{GetBaseUrl()}/api/status");
+            // Long poll: the device answers once the images differ from the
+            // version we hold, or with 304 after AssemblyWaitMs
+            var url = $"{GetBaseUrl()}/api/assemblies?format=bin&since={_assemblyVersion}&wait_ms={AssemblyWaitMs}";
+            var response = await _httpClient.GetAsync(url);
+            if (response.StatusCode == System.Net.HttpStatusCode.NotModified && _lastAssemblies != null)
+            {
+                return _lastAssemblies;
+            }
+            if (response.StatusCode == System.Net.HttpStatusCode.NotFound)
+            {
+                return await GetAssembliesFromStatusAsync();
+            }
             response.EnsureSuccessStatusCode();
-            var json = await response.Content.ReadAsStringAsync();
-            
-            var result = new AssemblyData
+            var record = await response.Content.ReadAsByteArrayAsync();
+            if (record.Length < AssemblyRecordHeaderSize || record[0] != AssemblyRecordFormat)
             {
-                InputAssembly100 = new Models.AssemblyDataItem(),
-                OutputAssembly150 = new Models.AssemblyDataItem()
-            };
-            
-            using (JsonDocument doc = JsonDocument.Parse(json))
+                return null;
+            }
+
+            // Header: format, reserved, input length, output length, reserved,
+            // version, uptime; little endian, then the input and output images
+            int inputLength = BitConverter.ToUInt16(record, 2);
+            int outputLength = BitConverter.ToUInt16(record, 4);
+            if (record.Length < AssemblyRecordHeaderSize + inputLength + outputLength)
             {
-                var root = doc.RootElement;
-                
-                if (root.TryGetProperty("input_assembly_100", out var inputAssembly))
+                return null;
+            }
+            var result = new AssemblyData
+            {
+                InputAssembly100 = new Models.AssemblyDataItem
                 {
-                    if (inputAssembly.TryGetProperty("raw_bytes", out var rawBytes) && rawBytes.ValueKind == JsonValueKind.Array)
-                    {
-                        var bytes = new byte[32];
-                        int index = 0;
-                        foreach (var element in rawBytes.EnumerateArray())
-                        {
-                            if (index >= 32) break;
-                            if (element.ValueKind == JsonValueKind.Number)
-                            {
-                                bytes[index++] = (byte)element.GetInt32();
-                            }
-                        }
-                        result.InputAssembly100.RawBytes = bytes;
-                    }
-                }
-                
-                if (root.TryGetProperty("output_assembly_150", out var outputAssembly))
+                    RawBytes = record.AsSpan(AssemblyRecordHeaderSize, inputLength).ToArray()
+                },
+                OutputAssembly150 = new Models.AssemblyDataItem
                 {
-                    if (outputAssembly.TryGetProperty("raw_bytes", out var rawBytes) && rawBytes.ValueKind == JsonValueKind.Array)
-                    {
-                        var bytes = new byte[32];
-                        int index = 0;
-                        foreach (var element in rawBytes.EnumerateArray())
-                        {
-                            if (index >= 32) break;
-                            if (element.ValueKind == JsonValueKind.Number)
-                            {
-                                bytes[index++] = (byte)element.GetInt32();
-                            }
-                        }
-                        result.OutputAssembly150.RawBytes = bytes;
-                    }
+                    RawBytes = record.AsSpan(AssemblyRecordHeaderSize + inputLength, outputLength).ToArray()
                 }
-            }
-            
+            };
+            _assemblyVersion = BitConverter.ToUInt32(record, 8);
+            _lastAssemblies = result;
             return result;
         }
         catch (Exception ex)
         {
             System.Diagnostics.Debug.WriteLine($"GetAssembliesAsync error: {ex.Message}");
+            _assemblyVersion = 0;
+            _lastAssemblies = null;
             return null;
         }
     }
 
+    // Firmware without /api/assemblies
+    private async Task<AssemblyData?> GetAssembliesFromStatusAsync()
+    {
+        var response = await _httpClient.GetAsync($"{GetBaseUrl()}/api/status");
+        response.EnsureSuccessStatusCode();
+        var json = await response.Content.ReadAsStringAsync();
+        return JsonSerializer.Deserialize<AssemblyData>(json);
+    }
+
     public async Task<bool> UploadFirmwareAsync(string filePath)
     {
         try
@@ -268,11 +278,13 @@ public class DeviceApiService
         }
     }
 
-    public async Task<LogBufferResponse?> GetLogsAsync()
+    // Without a cursor the device returns the oldest messages it holds
+    public async Task<LogBufferResponse?> GetLogsAsync(uint? cursor = null)
     {
         try
         {
-            var response = await _httpClient.GetAsync($"{GetBaseUrl()}/api/logs");
+            var query = cursor.HasValue ? $"?cursor={cursor.Value}" : string.Empty;
+            var response = await _httpClient.GetAsync($"{GetBaseUrl()}/api/logs{query}");
             response.EnsureSuccessStatusCode();
             var json = await response.Content.ReadAsStringAsync();
             return JsonSerializer.Deserialize<LogBufferResponse>(json);
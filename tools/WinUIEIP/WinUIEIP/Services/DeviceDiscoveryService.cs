@@ -14,6 +14,10 @@ public class DeviceDiscoveryService
     private const int ETHERNET_IP_LISTIDENTITY_PORT = 2222;
     private const int ETHERNET_IP_STANDARD_PORT = 44818;
     private const int DISCOVERY_TIMEOUT_MS = 3000;
+    private const int UNICAST_TIMEOUT_MS = 1000;
+    private const int DEFAULT_MAX_PARALLEL_PROBES = 32;
+    // Keeps a typo in a range from probing a whole /16
+    public const int MAX_RANGE_ADDRESSES = 1024;
     
     public async Task<List<DiscoveredDevice>> DiscoverDevicesAsync(CancellationToken cancellationToken = default)
     {
@@ -170,6 +174,109 @@ public class DeviceDiscoveryService
         return discoveredDevices;
     }
     
+    // Sends a unicast ListIdentity to every address, at most maxParallel at a
+    // time, for networks where the broadcast does not reach the devices
+    public async Task<List<DiscoveredDevice>> DiscoverRangeAsync(IEnumerable<IPAddress> addresses,
+                                                                int maxParallel = DEFAULT_MAX_PARALLEL_PROBES,
+                                                                CancellationToken cancellationToken = default)
+    {
+        using var gate = new SemaphoreSlim(Math.Max(maxParallel, 1));
+        var probes = new List<Task<DiscoveredDevice?>>();
+        foreach (var address in addresses)
+        {
+            probes.Add(ProbeAsync(address, gate, cancellationToken));
+        }
+
+        var results = await Task.WhenAll(probes);
+        var discoveredDevices = new List<DiscoveredDevice>();
+        var deviceIps = new HashSet<string>();
+        foreach (var device in results)
+        {
+            if (device != null && deviceIps.Add(device.IpAddress))
+            {
+                discoveredDevices.Add(device);
+            }
+        }
+        System.Diagnostics.Debug.WriteLine($"Range discovery complete. Probed {probes.Count} address(es), found {discoveredDevices.Count} device(s)");
+        return discoveredDevices;
+    }
+
+    // Addresses from first to last, both included; empty if last is before
+    // first or the range has more than MAX_RANGE_ADDRESSES entries
+    public static List<IPAddress> GetAddressRange(IPAddress first, IPAddress last)
+    {
+        var addresses = new List<IPAddress>();
+        if (first.AddressFamily != AddressFamily.InterNetwork || last.AddressFamily != AddressFamily.InterNetwork)
+            return addresses;
+
+        uint start = ToHostOrder(first);
+        uint end = ToHostOrder(last);
+        if (end < start || end - start >= MAX_RANGE_ADDRESSES)
+            return addresses;
+
+        for (uint value = start; ; value++)
+        {
+            addresses.Add(new IPAddress(new[] { (byte)(value >> 24), (byte)(value >> 16), (byte)(value >> 8), (byte)value }));
+            if (value == end)
+                break;
+        }
+        return addresses;
+    }
+
+    private static uint ToHostOrder(IPAddress address)
+    {
+        var bytes = address.GetAddressBytes();
+        return ((uint)bytes[0] << 24) | ((uint)bytes[1] << 16) | ((uint)bytes[2] << 8) | bytes[3];
+    }
+
+    private async Task<DiscoveredDevice?> ProbeAsync(IPAddress address, SemaphoreSlim gate, CancellationToken cancellationToken)
+    {
+        try
+        {
+            await gate.WaitAsync(cancellationToken);
+        }
+        catch (OperationCanceledException)
+        {
+            return null;
+        }
+
+        try
+        {
+            using var udpClient = new UdpClient(0);
+            byte[] listIdentityRequest = CreateListIdentityRequest();
+            var endPoint = new IPEndPoint(address, ETHERNET_IP_STANDARD_PORT);
+            await udpClient.SendAsync(listIdentityRequest, listIdentityRequest.Length, endPoint);
+
+            using var timeout = CancellationTokenSource.CreateLinkedTokenSource(cancellationToken);
+            timeout.CancelAfter(UNICAST_TIMEOUT_MS);
+            while (true)
+            {
+                var result = await udpClient.ReceiveAsync(timeout.Token);
+                // Ignore stray datagrams, e.g. from a device answering late for another address
+                if (!result.RemoteEndPoint.Address.Equals(address))
+                    continue;
+                return ParseListIdentityResponse(result.Buffer, address.ToString());
+            }
+        }
+        catch (OperationCanceledException)
+        {
+            return null;
+        }
+        catch (SocketException)
+        {
+            return null; // e.g. ICMP port unreachable reported as a connection reset
+        }
+        catch (Exception ex)
+        {
+            System.Diagnostics.Debug.WriteLine($"ListIdentity probe of {address} failed: {ex.Message}");
+            return null;
+        }
+        finally
+        {
+            gate.Release();
+        }
+    }
+
     private byte[] CreateListIdentityRequest()
     {
         var request = new List<byte>();
@@ -0,0 +1,157 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Net.Http;
+using System.Text.Json;
+using System.Threading;
+using System.Threading.Tasks;
+using EulerLink.Models;
+
+namespace EulerLink.Services;
+
+// Polls GET /api/status of many devices for the dashboard. Every device gets
+// its own HttpClient limited to one keep-alive connection, and the next
+// request is only sent once the previous answer arrived, so a device never
+// sees more than one socket and one request from this application.
+public class DeviceMonitorService : IDisposable
+{
+    private const int DefaultIntervalMs = 1000;
+    private const int RequestTimeoutMs = 3000;
+    // Longer than the poll interval so the connection is reused between polls
+    private static readonly TimeSpan IdleConnectionTimeout = TimeSpan.FromSeconds(30);
+
+    private readonly Dictionary<string, DeviceMonitor> _monitors = new();
+    private readonly object _lock = new();
+
+    public int IntervalMs { get; set; } = DefaultIntervalMs;
+
+    // Raised on a pool thread with the device IP and its status, or the error
+    public event Action<string, DeviceStatus?, string?>? StatusUpdated;
+
+    public bool Contains(string ip)
+    {
+        lock (_lock)
+        {
+            return _monitors.ContainsKey(ip);
+        }
+    }
+
+    public void Add(string ip)
+    {
+        lock (_lock)
+        {
+            if (_monitors.ContainsKey(ip))
+                return;
+            var monitor = new DeviceMonitor(this, ip);
+            _monitors[ip] = monitor;
+            monitor.Start();
+        }
+    }
+
+    public void Remove(string ip)
+    {
+        DeviceMonitor? monitor;
+        lock (_lock)
+        {
+            if (!_monitors.Remove(ip, out monitor))
+                return;
+        }
+        monitor.Dispose();
+    }
+
+    public void RemoveAll()
+    {
+        List<DeviceMonitor> monitors;
+        lock (_lock)
+        {
+            monitors = new List<DeviceMonitor>(_monitors.Values);
+            _monitors.Clear();
+        }
+        foreach (var monitor in monitors)
+        {
+            monitor.Dispose();
+        }
+    }
+
+    public void Dispose()
+    {
+        RemoveAll();
+    }
+
+    private void OnStatus(string ip, DeviceStatus? status, string? error)
+    {
+        StatusUpdated?.Invoke(ip, status, error);
+    }
+
+    private sealed class DeviceMonitor : IDisposable
+    {
+        private readonly DeviceMonitorService _owner;
+        private readonly string _ip;
+        private readonly HttpClient _httpClient;
+        private readonly CancellationTokenSource _cancellation = new();
+
+        public DeviceMonitor(DeviceMonitorService owner, string ip)
+        {
+            _owner = owner;
+            _ip = ip;
+            var handler = new SocketsHttpHandler
+            {
+                MaxConnectionsPerServer = 1,
+                PooledConnectionIdleTimeout = IdleConnectionTimeout,
+                ConnectTimeout = TimeSpan.FromMilliseconds(RequestTimeoutMs)
+            };
+            _httpClient = new HttpClient(handler)
+            {
+                Timeout = TimeSpan.FromMilliseconds(RequestTimeoutMs)
+            };
+        }
+
+        public void Start()
+        {
+            _ = Task.Run(() => PollAsync(_cancellation.Token));
+        }
+
+        private async Task PollAsync(CancellationToken cancellationToken)
+        {
+            var url = $"http://{_ip}/api/status";
+            var stopwatch = new Stopwatch();
+            while (!cancellationToken.IsCancellationRequested)
+            {
+                stopwatch.Restart();
+                try
+                {
+                    using var response = await _httpClient.GetAsync(url, cancellationToken);
+                    response.EnsureSuccessStatusCode();
+                    var json = await response.Content.ReadAsStringAsync(cancellationToken);
+                    _owner.OnStatus(_ip, JsonSerializer.Deserialize<DeviceStatus>(json), null);
+                }
+                catch (Exception) when (cancellationToken.IsCancellationRequested)
+                {
+                    break; // removed, the client may be disposed under the request
+                }
+                catch (Exception ex)
+                {
+                    System.Diagnostics.Debug.WriteLine($"Status poll of {_ip} failed: {ex.Message}");
+                    _owner.OnStatus(_ip, null, ex is TaskCanceledException ? "Timeout" : ex.Message);
+                }
+
+                var remaining = _owner.IntervalMs - (int)stopwatch.ElapsedMilliseconds;
+                try
+                {
+                    await Task.Delay(Math.Max(remaining, 0), cancellationToken);
+                }
+                catch (OperationCanceledException)
+                {
+                    break;
+                }
+            }
+        }
+
+        public void Dispose()
+        {
+            _cancellation.Cancel();
+            _httpClient.Dispose();
+            _cancellation.Dispose();
+        }
+    }
+}
@@ -0,0 +1,178 @@
+using System;
+using System.Collections.Generic;
+using System.Collections.ObjectModel;
+using System.Linq;
+using System.Net;
+using System.Threading;
+using System.Threading.Tasks;
+using Microsoft.UI.Dispatching;
+using Microsoft.UI.Xaml;
+using Microsoft.UI.Xaml.Controls;
+using EulerLink.Models;
+using EulerLink.Services;
+
+namespace EulerLink.Views;
+
+// Watches many devices at once through GET /api/status; unlike the other
+// pages it does not need the sidebar connection
+public sealed partial class DashboardPage : Page
+{
+    // Shared by all visits of the page so monitoring continues in the background
+    private static readonly DeviceMonitorService MonitorService = new();
+    private static readonly ObservableCollection<DashboardDevice> Devices = new();
+
+    private readonly DeviceDiscoveryService _discoveryService = new();
+    private readonly DispatcherQueue _dispatcherQueue;
+    private CancellationTokenSource? _discoveryCancellation;
+
+    public DashboardPage()
+    {
+        this.InitializeComponent();
+        this.NavigationCacheMode = Microsoft.UI.Xaml.Navigation.NavigationCacheMode.Enabled;
+        _dispatcherQueue = DispatcherQueue.GetForCurrentThread();
+        DevicesListView.ItemsSource = Devices;
+        Loaded += DashboardPage_Loaded;
+        Unloaded += DashboardPage_Unloaded;
+    }
+
+    private void DashboardPage_Loaded(object sender, RoutedEventArgs e)
+    {
+        MonitorService.StatusUpdated += MonitorService_StatusUpdated;
+        ShowEmptyHint();
+    }
+
+    private void DashboardPage_Unloaded(object sender, RoutedEventArgs e)
+    {
+        MonitorService.StatusUpdated -= MonitorService_StatusUpdated;
+        _discoveryCancellation?.Cancel();
+    }
+
+    private void MonitorService_StatusUpdated(string ip, DeviceStatus? status, string? error)
+    {
+        _dispatcherQueue.TryEnqueue(() =>
+        {
+            var device = Devices.FirstOrDefault(d => d.IpAddress == ip);
+            if (device == null)
+                return; // removed while the request was in flight
+            if (status != null)
+            {
+                device.Update(status);
+            }
+            else
+            {
+                device.SetError(error ?? "No response");
+            }
+        });
+    }
+
+    private bool AddDevice(string ip)
+    {
+        if (MonitorService.Contains(ip))
+            return false;
+        Devices.Add(new DashboardDevice { IpAddress = ip });
+        MonitorService.Add(ip);
+        return true;
+    }
+
+    private void AddButton_Click(object sender, RoutedEventArgs e)
+    {
+        var text = AddIpTextBox.Text.Trim();
+        if (!IPAddress.TryParse(text, out var address) || address.AddressFamily != System.Net.Sockets.AddressFamily.InterNetwork)
+        {
+            StatusTextBlock.Text = $"'{text}' is not an IPv4 address.";
+            return;
+        }
+        StatusTextBlock.Text = AddDevice(address.ToString())
+            ? $"Added {address}."
+            : $"{address} is already monitored.";
+        AddIpTextBox.Text = string.Empty;
+        ShowEmptyHint();
+    }
+
+    private async void DiscoverButton_Click(object sender, RoutedEventArgs e)
+    {
+        List<IPAddress>? range = null;
+        var startText = RangeStartTextBox.Text.Trim();
+        var endText = RangeEndTextBox.Text.Trim();
+        if (startText.Length > 0 || endText.Length > 0)
+        {
+            if (!IPAddress.TryParse(startText, out var first) || !IPAddress.TryParse(endText, out var last))
+            {
+                StatusTextBlock.Text = "Enter both ends of the scan range as IPv4 addresses.";
+                return;
+            }
+            range = DeviceDiscoveryService.GetAddressRange(first, last);
+            if (range.Count == 0)
+            {
+                StatusTextBlock.Text = $"The scan range must be in order and hold at most {DeviceDiscoveryService.MAX_RANGE_ADDRESSES} addresses.";
+                return;
+            }
+        }
+
+        DiscoverButton.IsEnabled = false;
+        StatusTextBlock.Text = range == null
+            ? "Discovering devices..."
+            : $"Discovering devices, also probing {range.Count} address(es)...";
+        _discoveryCancellation?.Cancel();
+        _discoveryCancellation = new CancellationTokenSource();
+        var token = _discoveryCancellation.Token;
+
+        try
+        {
+            // The broadcast and the unicast probes run at the same time
+            var searches = new List<Task<List<DiscoveredDevice>>>
+            {
+                _discoveryService.DiscoverDevicesAsync(token)
+            };
+            if (range != null)
+            {
+                searches.Add(_discoveryService.DiscoverRangeAsync(range, cancellationToken: token));
+            }
+            var results = await Task.WhenAll(searches);
+
+            int found = 0;
+            int added = 0;
+            foreach (var device in results.SelectMany(r => r).GroupBy(d => d.IpAddress).Select(g => g.First()))
+            {
+                found++;
+                if (AddDevice(device.IpAddress))
+                    added++;
+            }
+            StatusTextBlock.Text = $"Found {found} device(s), {added} new.";
+        }
+        catch (Exception ex)
+        {
+            StatusTextBlock.Text = $"Error during discovery: {ex.Message}";
+        }
+        finally
+        {
+            DiscoverButton.IsEnabled = true;
+            ShowEmptyHint();
+        }
+    }
+
+    private void RemoveButton_Click(object sender, RoutedEventArgs e)
+    {
+        foreach (var device in DevicesListView.SelectedItems.OfType<DashboardDevice>().ToList())
+        {
+            MonitorService.Remove(device.IpAddress);
+            Devices.Remove(device);
+        }
+        ShowEmptyHint();
+    }
+
+    private void RemoveAllButton_Click(object sender, RoutedEventArgs e)
+    {
+        MonitorService.RemoveAll();
+        Devices.Clear();
+        ShowEmptyHint();
+    }
+
+    private void ShowEmptyHint()
+    {
+        if (Devices.Count == 0 && string.IsNullOrEmpty(StatusTextBlock.Text))
+        {
+            StatusTextBlock.Text = "Add devices by IP or discover them on the network.";
+        }
+    }
+}
@@ -12,6 +12,15 @@ public sealed partial class LogsPage : Page
     private readonly DeviceApiService _apiService = DeviceApiService.Instance;
     private DispatcherTimer? _updateTimer;
     private bool _isUpdating = false;
+    private readonly System.Text.StringBuilder _logText = new();
+    private uint? _logCursor;
+    private uint _lostEntries;
+    private string _logDeviceIp = string.Empty;
+
+    // Requests per refresh while the device reports more to fetch
+    private const int MaxRequestsPerRefresh = 8;
+    // Oldest text is dropped beyond this many characters
+    private const int MaxLogCharacters = 256 * 1024;
 
     public LogsPage()
     {
@@ -86,16 +95,48 @@ public sealed partial class LogsPage : Page
             return;
         }
 
+        // Another device starts a new log
+        if (_logDeviceIp != _apiService.GetDeviceIp())
+        {
+            _logDeviceIp = _apiService.GetDeviceIp();
+            _logText.Clear();
+            _logCursor = null;
+            _lostEntries = 0;
+        }
+
         try
         {
-            var logResponse = await _apiService.GetLogsAsync();
+            LogBufferResponse? logResponse = null;
+            for (int request = 0; request < MaxRequestsPerRefresh; request++)
+            {
+                logResponse = await _apiService.GetLogsAsync(_logCursor);
+                if (logResponse == null || logResponse.Status != "ok")
+                    break;
+                // Firmware without a cursor returns the whole buffer every time
+                if (logResponse.Next == null)
+                {
+                    _logText.Clear();
+                    _logText.Append(logResponse.Logs);
+                    break;
+                }
+                _logText.Append(logResponse.Logs);
+                _lostEntries += logResponse.Lost;
+                _logCursor = logResponse.Next;
+                if (!logResponse.Truncated)
+                    break;
+            }
+
             if (logResponse != null && logResponse.Status == "ok")
             {
-                LogsTextBlock.Text = logResponse.Logs;
-                LogSizeTextBlock.Text = $"{logResponse.Size:N0} bytes";
+                if (_logText.Length > MaxLogCharacters)
+                {
+                    _logText.Remove(0, _logText.Length - MaxLogCharacters);
+                }
+                LogsTextBlock.Text = _logText.ToString();
+                LogSizeTextBlock.Text = $"{_logText.Length:N0} bytes";
                 TotalSizeTextBlock.Text = $"{logResponse.TotalSize:N0} bytes";
-                TruncatedTextBlock.Text = logResponse.Truncated 
-                    ? "⚠️ Logs truncated (buffer wrapped)" 
+                TruncatedTextBlock.Text = _lostEntries > 0
+                    ? $"⚠️ {_lostEntries:N0} entries overwritten on the device before download"
                     : "✓ Complete";
             }
             else
@@ -0,0 +1,788 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Streaming EtherNet/IP Capture Analyzer
+
+Reads the tshark dissection of a capture as a stream and keeps only
+counters and fixed size histograms, so the memory use does not grow with
+the length of the capture:
+1. Per Class 1 connection the packet interval histogram against the RPI
+   (the API of the Forward Open reply, or the median interval if the
+   Forward Open is not in the capture), interval jitter, lost, duplicate
+   and out of order sequence numbers
+2. Per Forward Open the consume to produce latency: the age of the newest
+   O->T packet when the adapter produces the next T->O packet
+3. ACD timing: ARP probe and announcement intervals and address conflicts
+4. A JSON summary, and a Markdown comparison of two summaries, e.g. of two
+   firmware versions under the same load
+
+Pipe tshark into it to avoid writing the dissection to disk:
+    tshark -r capture.pcapng -Y "arp or enip or cipio" -T ek | python analyze_capture.py analyze -
+
+Usage:
+    python analyze_capture.py analyze capture.pdml
+    python analyze_capture.py analyze capture.ek.json --device 172.16.82.100 --json v1.json --label v1.0
+    python analyze_capture.py compare v1.json v2.json
+
+Input formats:
+    PDML (tshark -T pdml, Wireshark Export Packet Dissections -> As XML),
+    read with iterparse, and Elasticsearch JSON (tshark -T ek), one packet
+    per line. The format is detected from the first character.
+
+Requirements:
+    Python 3.8 or later, no additional packages
+
+Author: Adam G. Sweeney <agsweeney@gmail.com>
+License: MIT
+"""
+
+import argparse
+import json
+import math
+import sys
+import xml.etree.ElementTree as ET
+from datetime import datetime
+
+# Fix Windows console encoding
+if sys.platform == 'win32':
+    import codecs
+    sys.stdout = codecs.getwriter('utf-8')(sys.stdout.buffer, 'strict')
+    sys.stderr = codecs.getwriter('utf-8')(sys.stderr.buffer, 'strict')
+
+CLASS1_PORT = 2222
+
+# Fields taken from a packet, by their Wireshark names
+FIELD_TIME = 'frame.time_epoch'
+FIELD_IP_SOURCE = 'ip.src'
+FIELD_IP_DESTINATION = 'ip.dst'
+FIELD_UDP_SOURCE_PORT = 'udp.srcport'
+FIELD_UDP_DESTINATION_PORT = 'udp.dstport'
+FIELD_UDP_LENGTH = 'udp.length'
+FIELD_CONNECTION_ID = 'enip.cpf.sai.connid'
+FIELD_SEQUENCE = 'enip.cpf.sai.seq'
+FIELD_OT_CONNECTION_ID = 'cip.cm.ot_connid'
+FIELD_TO_CONNECTION_ID = 'cip.cm.to_connid'
+FIELD_OT_API = 'cip.cm.otapi'
+FIELD_TO_API = 'cip.cm.toapi'
+FIELD_ARP_OPCODE = 'arp.opcode'
+FIELD_ARP_SENDER_MAC = 'arp.src.hw_mac'
+FIELD_ARP_SENDER_IP = 'arp.src.proto_ipv4'
+FIELD_ARP_TARGET_IP = 'arp.dst.proto_ipv4'
+
+FIELDS = frozenset((
+    FIELD_TIME, FIELD_IP_SOURCE, FIELD_IP_DESTINATION,
+    FIELD_UDP_SOURCE_PORT, FIELD_UDP_DESTINATION_PORT, FIELD_UDP_LENGTH,
+    FIELD_CONNECTION_ID, FIELD_SEQUENCE,
+    FIELD_OT_CONNECTION_ID, FIELD_TO_CONNECTION_ID, FIELD_OT_API, FIELD_TO_API,
+    FIELD_ARP_OPCODE, FIELD_ARP_SENDER_MAC, FIELD_ARP_SENDER_IP, FIELD_ARP_TARGET_IP,
+))
+
+# Interval / RPI classes of the RPI histogram, upper bounds
+RPI_BINS = (
+    ('<50%', 0.5),
+    ('50-90%', 0.9),
+    ('90-98%', 0.98),
+    ('98-102%', 1.02),
+    ('102-110%', 1.1),
+    ('110-150%', 1.5),
+    ('150-200%', 2.0),
+    ('>=200%', math.inf),
+)
+
+# A probe this long after the last ARP of the address starts a new ACD cycle
+ACD_CYCLE_GAP_S = 10.0
+ACD_MAX_CYCLES = 64
+ACD_MAX_CONFLICTS = 32
+ACD_MAX_REPORTED_INTERVALS = 8
+
+
+class LogHistogram:
+    """Log linear histogram of non negative integers
+
+    Values below SUB_BUCKETS are exact, above they fall into buckets of
+    less than 1/SUB_BUCKETS relative width. The buckets are kept sparse,
+    a few hundred at most for microsecond intervals.
+    """
+
+    SUB_BUCKETS = 128
+
+    def __init__(self):
+        self.counts = {}
+        self.total = 0
+
+    @classmethod
+    def index(cls, value):
+        if value < cls.SUB_BUCKETS:
+            return value
+        shift = value.bit_length() - cls.SUB_BUCKETS.bit_length()
+        return cls.SUB_BUCKETS * (shift + 1) + (value >> shift) - cls.SUB_BUCKETS
+
+    @classmethod
+    def bounds(cls, index):
+        """Lowest value and width of a bucket"""
+        if index < cls.SUB_BUCKETS:
+            return index, 1
+        shift = index // cls.SUB_BUCKETS - 1
+        return (cls.SUB_BUCKETS + index % cls.SUB_BUCKETS) << shift, 1 << shift
+
+    def add(self, value):
+        index = self.index(max(0, int(value)))
+        self.counts[index] = self.counts.get(index, 0) + 1
+        self.total += 1
+
+    def buckets(self):
+        """(middle value, count) in ascending order"""
+        for index in sorted(self.counts):
+            low, width = self.bounds(index)
+            yield low + (width - 1) / 2, self.counts[index]
+
+    def percentile(self, fraction):
+        return weighted_percentile(self.buckets(), self.total, fraction)
+
+
+def weighted_percentile(ordered, total, fraction):
+    """Nearest rank percentile of ascending (value, count), None if empty"""
+    if total == 0:
+        return None
+    rank = max(1, math.ceil(fraction * total))
+    seen = 0
+    value = None
+    for value, count in ordered:
+        seen += count
+        if seen >= rank:
+            break
+    return value
+
+
+class IntervalStatistics:
+    """Exact count, mean, deviation and extremes plus a LogHistogram"""
+
+    def __init__(self):
+        self.count = 0
+        self.mean = 0.0
+        self.m2 = 0.0
+        self.minimum = None
+        self.maximum = None
+        self.histogram = LogHistogram()
+
+    def add(self, value):
+        self.count += 1
+        delta = value - self.mean
+        self.mean += delta / self.count
+        self.m2 += delta * (value - self.mean)
+        self.minimum = value if self.minimum is None else min(self.minimum, value)
+        self.maximum = value if self.maximum is None else max(self.maximum, value)
+        self.histogram.add(value)
+
+    def summary(self):
+        if self.count == 0:
+            return None
+        return {
+            'count': self.count,
+            'min': self.minimum,
+            'mean': round(self.mean, 1),
+            'stddev': round(math.sqrt(self.m2 / self.count), 1),
+            'p50': self.percentile(0.5),
+            'p90': self.percentile(0.9),
+            'p99': self.percentile(0.99),
+            'p999': self.percentile(0.999),
+            'max': self.maximum,
+        }
+
+    def percentile(self, fraction):
+        """Bucket middle, kept within the exact extremes"""
+        value = self.histogram.percentile(fraction)
+        return min(max(value, self.minimum), self.maximum)
+
+    def rpi_bins(self, rpi):
+        bins = {name: 0 for name, _ in RPI_BINS}
+        for value, count in self.histogram.buckets():
+            ratio = value / rpi
+            for name, limit in RPI_BINS:
+                if ratio < limit:
+                    bins[name] += count
+                    break
+        return bins
+
+    def jitter(self, rpi):
+        """Percentiles of |interval - RPI|"""
+        deviations = sorted((abs(value - rpi), count) for value, count in self.histogram.buckets())
+        if not deviations:
+            return None
+        return {
+            'p50': round(weighted_percentile(deviations, self.count, 0.5), 1),
+            'p99': round(weighted_percentile(deviations, self.count, 0.99), 1),
+            'max': round(max(abs(self.minimum - rpi), abs(self.maximum - rpi)), 1),
+        }
+
+
+class ForwardOpen:
+    """Connection pair of a successful Forward Open reply"""
+
+    def __init__(self, device, scanner, ot_id, to_id, ot_api, to_api):
+        self.device = device
+        self.scanner = scanner
+        self.ot_id = ot_id
+        self.to_id = to_id
+        self.ot_api = ot_api
+        self.to_api = to_api
+        self.last_consumed = None
+        self.consume_to_produce = IntervalStatistics()
+
+
+class Class1Stream:
+    """Packets of one connection ID between two addresses"""
+
+    def __init__(self, source, destination, connection_id):
+        self.source = source
+        self.destination = destination
+        self.connection_id = connection_id
+        self.direction = None
+        self.rpi = None
+        self.pair = None
+        self.packets = 0
+        self.octets = 0
+        self.first_time = None
+        self.last_time = None
+        self.last_sequence = None
+        self.gaps = 0
+        self.lost = 0
+        self.duplicates = 0
+        self.out_of_order = 0
+        self.intervals = IntervalStatistics()
+
+    def restart(self):
+        """A new Forward Open restarts the sequence and the interval"""
+        self.last_time = None
+        self.last_sequence = None
+
+    def add(self, time_s, sequence, length):
+        self.packets += 1
+        self.octets += length
+        if self.first_time is None:
+            self.first_time = time_s
+        if self.last_time is not None:
+            self.intervals.add(round((time_s - self.last_time) * 1e6))
+        self.last_time = time_s
+        if sequence is None:
+            return
+        if self.last_sequence is not None:
+            delta = (sequence - self.last_sequence) & 0xFFFFFFFF
+            if delta == 0:
+                self.duplicates += 1
+                return
+            if delta >= 0x80000000:
+                self.out_of_order += 1
+                return
+            if delta > 1:
+                self.gaps += 1
+                self.lost += delta - 1
+        self.last_sequence = sequence
+
+    def summary(self):
+        rpi = self.rpi
+        rpi_source = 'forward_open'
+        intervals = self.intervals.summary()
+        if rpi is None and intervals is not None:
+            rpi = intervals['p50']
+            rpi_source = 'median'
+        result = {
+            'direction': self.direction or '?',
+            'source': self.source,
+            'destination': self.destination,
+            'connection_id': f"0x{self.connection_id:08X}",
+            'rpi_us': rpi,
+            'rpi_source': rpi_source if rpi is not None else None,
+            'packets': self.packets,
+            'octets': self.octets,
+            'interval_us': intervals,
+            'jitter_us': self.intervals.jitter(rpi) if rpi else None,
+            'rpi_histogram': self.intervals.rpi_bins(rpi) if rpi else None,
+            'sequence': {
+                'gaps': self.gaps,
+                'lost': self.lost,
+                'duplicates': self.duplicates,
+                'out_of_order': self.out_of_order,
+            },
+            'consume_to_produce_us': None,
+        }
+        if self.direction == 'T->O' and self.pair is not None:
+            result['consume_to_produce_us'] = self.pair.consume_to_produce.summary()
+        return result
+
+
+class AcdAddress:
+    """ARP probes and announcements of one MAC for one IP address"""
+
+    def __init__(self, mac, ip):
+        self.mac = mac
+        self.ip = ip
+        self.probes = 0
+        self.announcements = 0
+        self.cycles = []
+        self.dropped_cycles = 0
+        self.cycle = None
+        self.last_time = None
+        self.last_announcement = None
+        self.defense_intervals = IntervalStatistics()
+
+    def add(self, time_s, probe):
+        new_cycle = probe and (self.cycle is None or not self.cycle['in_probe'] or
+                               time_s - self.last_time > ACD_CYCLE_GAP_S)
+        if new_cycle:
+            self.cycle = {'start': time_s, 'probe_times': [], 'announce_times': [],
+                          'in_probe': True}
+            if len(self.cycles) < ACD_MAX_CYCLES:
+                self.cycles.append(self.cycle)
+            else:
+                self.dropped_cycles += 1
+        if probe:
+            self.probes += 1
+            if self.cycle['in_probe'] and len(self.cycle['probe_times']) < ACD_MAX_REPORTED_INTERVALS:
+                self.cycle['probe_times'].append(time_s)
+        else:
+            self.announcements += 1
+            if self.cycle is not None:
+                self.cycle['in_probe'] = False
+            if (self.cycle is not None and
+                    len(self.cycle['announce_times']) < ACD_MAX_REPORTED_INTERVALS and
+                    time_s - self.cycle['start'] < ACD_CYCLE_GAP_S):
+                self.cycle['announce_times'].append(time_s)
+            elif self.last_announcement is not None:
+                # Announcements after the start up, e.g. defending the address
+                self.defense_intervals.add(round((time_s - self.last_announcement) * 1e3))
+            self.last_announcement = time_s
+        self.last_time = time_s
+
+    def summary(self, epoch):
+        cycles = []
+        for cycle in self.cycles:
+            probes = cycle['probe_times']
+            announcements = cycle['announce_times']
+            cycles.append({
+                'start_s': round(cycle['start'] - epoch, 6),
+                'probes': len(probes),
+                'probe_intervals_ms': differences_ms(probes),
+                'probe_to_announce_ms': (round((announcements[0] - probes[-1]) * 1e3, 3)
+                                         if probes and announcements else None),
+                'announce_intervals_ms': differences_ms(announcements),
+            })
+        return {
+            'ip': self.ip,
+            'mac': self.mac,
+            'probes': self.probes,
+            'announcements': self.announcements,
+            'cycles': cycles,
+            'cycles_not_listed': self.dropped_cycles,
+            'later_announcement_interval_ms': self.defense_intervals.summary(),
+        }
+
+
+def differences_ms(times):
+    return [round((b - a) * 1e3, 3) for a, b in zip(times, times[1:])]
+
+
+def parse_integer(text):
+    """'0x0000abcd', '10000' or '10000 (10.000 ms)' -> int, None if empty"""
+    if text is None or text == '':
+        return None
+    try:
+        return int(str(text).split()[0], 0)
+    except ValueError:
+        return None
+
+
+def parse_time(text):
+    try:
+        return float(text)
+    except (TypeError, ValueError):
+        pass
+    try:
+        return datetime.fromisoformat(str(text).replace('Z', '+00:00')).timestamp()
+    except ValueError:
+        return None
+
+
+class Analyzer:
+    """Consumes packets as {field name: value} and builds the summary"""
+
+    def __init__(self, device=None):
+        self.device = device
+        self.packets = 0
+        self.first_time = None
+        self.last_time = None
+        self.streams = {}
+        self.forward_opens = []
+        self.ot_pairs = {}
+        self.to_pairs = {}
+        self.acd = {}
+        self.conflicts = []
+        self.conflict_count = 0
+
+    def packet(self, fields):
+        time_s = parse_time(fields.get(FIELD_TIME))
+        if time_s is None:
+            return
+        self.packets += 1
+        if self.first_time is None:
+            self.first_time = time_s
+        self.last_time = time_s
+        if FIELD_ARP_OPCODE in fields:
+            self.arp(time_s, fields)
+        elif FIELD_OT_API in fields and FIELD_UDP_DESTINATION_PORT not in fields:
+            self.forward_open_reply(fields)
+        elif FIELD_CONNECTION_ID in fields and CLASS1_PORT in (
+                parse_integer(fields.get(FIELD_UDP_SOURCE_PORT)),
+                parse_integer(fields.get(FIELD_UDP_DESTINATION_PORT))):
+            self.class1(time_s, fields)
+
+    def forward_open_reply(self, fields):
+        ot_id = parse_integer(fields.get(FIELD_OT_CONNECTION_ID))
+        to_id = parse_integer(fields.get(FIELD_TO_CONNECTION_ID))
+        if ot_id is None or to_id is None:
+            return
+        device = fields.get(FIELD_IP_SOURCE)
+        pair = ForwardOpen(device, fields.get(FIELD_IP_DESTINATION), ot_id, to_id,
+                           parse_integer(fields.get(FIELD_OT_API)),
+                           parse_integer(fields.get(FIELD_TO_API)))
+        self.forward_opens.append(pair)
+        self.ot_pairs[(device, ot_id)] = pair
+        self.to_pairs.setdefault((device, to_id), [])
+        # A reopened connection replaces the old one with the same scanner
+        self.to_pairs[(device, to_id)] = [p for p in self.to_pairs[(device, to_id)]
+                                          if p.scanner != pair.scanner or p.ot_id != ot_id]
+        self.to_pairs[(device, to_id)].append(pair)
+        for stream in self.streams.values():
+            if stream.connection_id in (ot_id, to_id):
+                stream.restart()
+                stream.direction = None
+
+    def class1(self, time_s, fields):
+        source = fields.get(FIELD_IP_SOURCE)
+        destination = fields.get(FIELD_IP_DESTINATION)
+        connection_id = parse_integer(fields.get(FIELD_CONNECTION_ID))
+        if connection_id is None:
+            return
+        key = (source, destination, connection_id)
+        stream = self.streams.get(key)
+        if stream is None:
+            stream = self.streams[key] = Class1Stream(source, destination, connection_id)
+        if stream.direction is None:
+            self.classify(stream)
+        length = parse_integer(fields.get(FIELD_UDP_LENGTH)) or 0
+        stream.add(time_s, parse_integer(fields.get(FIELD_SEQUENCE)), max(0, length - 8))
+        if stream.direction == 'O->T' and stream.pair is not None:
+            stream.pair.last_consumed = time_s
+        elif stream.direction == 'T->O':
+            for pair in self.to_pairs.get((source, connection_id), ()):
+                if pair.last_consumed is not None:
+                    pair.consume_to_produce.add(round((time_s - pair.last_consumed) * 1e6))
+                    pair.last_consumed = None
+
+    def classify(self, stream):
+        pair = self.ot_pairs.get((stream.destination, stream.connection_id))
+        if pair is not None:
+            stream.direction, stream.pair, stream.rpi = 'O->T', pair, pair.ot_api
+            return
+        pairs = self.to_pairs.get((stream.source, stream.connection_id))
+        if pairs:
+            stream.direction, stream.pair, stream.rpi = 'T->O', pairs[-1], pairs[-1].to_api
+            return
+        if self.device is not None and stream.source == self.device:
+            stream.direction = 'T->O'
+        elif self.device is not None and stream.destination == self.device:
+            stream.direction = 'O->T'
+
+    def arp(self, time_s, fields):
+        mac = (fields.get(FIELD_ARP_SENDER_MAC) or '').lower()
+        sender = fields.get(FIELD_ARP_SENDER_IP)
+        target = fields.get(FIELD_ARP_TARGET_IP)
+        probe = sender == '0.0.0.0'
+        ip = target if probe else sender
+        if not ip or ip == '0.0.0.0':
+            return
+        owners = [entry for entry in self.acd.values() if entry.ip == ip]
+        for owner in owners:
+            if owner.mac != mac:
+                self.conflict_count += 1
+                if len(self.conflicts) < ACD_MAX_CONFLICTS:
+                    self.conflicts.append({'time_s': time_s, 'ip': ip, 'mac': mac,
+                                           'owner_mac': owner.mac})
+        key = (mac, ip)
+        entry = self.acd.get(key)
+        if entry is None:
+            if not probe and ip != self.device:
+                return
+            entry = self.acd[key] = AcdAddress(mac, ip)
+        if probe or sender == target:
+            entry.add(time_s, probe)
+
+    def summary(self, label, source):
+        epoch = self.first_time or 0.0
+        return {
+            'label': label,
+            'source': source,
+            'packets': self.packets,
+            'span_s': round((self.last_time or 0.0) - epoch, 6),
+            'forward_opens': len(self.forward_opens),
+            'connections': [stream.summary() for stream in
+                            sorted(self.streams.values(), key=lambda s: s.first_time)],
+            'acd': [entry.summary(epoch) for entry in self.acd.values()],
+            'conflicts': [dict(conflict, time_s=round(conflict['time_s'] - epoch, 6))
+                          for conflict in self.conflicts],
+            'conflict_count': self.conflict_count,
+        }
+
+
+def iter_pdml(stream):
+    """Packets of a PDML document, cleared after use to keep memory flat"""
+    root = None
+    for event, element in ET.iterparse(stream, events=('start', 'end')):
+        if root is None:
+            root = element
+            continue
+        if event != 'end' or element.tag != 'packet':
+            continue
+        fields = {}
+        for field in element.iter('field'):
+            name = field.get('name')
+            if name in FIELDS and name not in fields:
+                fields[name] = field.get('show')
+        yield fields
+        root.clear()
+
+
+def iter_ek(stream):
+    """Packets of tshark -T ek output, the index lines are skipped"""
+    wanted = {name.replace('.', '_'): name for name in FIELDS}
+    for line in stream:
+        line = line.strip()
+        if not line:
+            continue
+        document = json.loads(line)
+        layers = document.get('layers')
+        if layers is None:
+            continue
+        fields = {}
+        collect_ek(layers, wanted, fields)
+        if FIELD_TIME not in fields and 'timestamp' in document:
+            fields[FIELD_TIME] = parse_integer(document['timestamp']) / 1e3
+        yield fields
+
+
+def collect_ek(layers, wanted, fields):
+    """Layers hold fields as 'ip_ip_src' (older tshark), 'ip_src' or with -e flat"""
+    for layer, content in layers.items():
+        items = content.items() if isinstance(content, dict) else ((layer, content),)
+        for key, value in items:
+            doubled = f"{layer}_{layer}_"
+            if key.startswith(doubled):
+                key = key[len(layer) + 1:]
+            name = wanted.get(key)
+            if name is None or name in fields:
+                continue
+            if isinstance(value, list):
+                if not value:
+                    continue
+                value = value[0]
+            fields[name] = value
+
+
+def iter_packets(path):
+    stream = sys.stdin.buffer if path == '-' else open(path, 'rb')
+    first = stream.peek(64).lstrip()[:1] if hasattr(stream, 'peek') else b''
+    if first == b'{':
+        yield from iter_ek(line.decode('utf-8') for line in stream)
+    else:
+        yield from iter_pdml(stream)
+    if path != '-':
+        stream.close()
+
+
+def format_us(value):
+    return '-' if value is None else f"{value / 1e3:.3f}"
+
+
+def print_report(summary):
+    print(f"{summary['source']}: {summary['packets']} packets over {summary['span_s']:.3f} s, "
+          f"{summary['forward_opens']} Forward Open replies")
+    connections = summary['connections']
+    if connections:
+        print()
+        print("=== Class 1 connections (ms) ===")
+        print(f"{'dir':5} {'connection':10} {'source':>15} -> {'destination':15} {'packets':>8} "
+              f"{'RPI':>8} {'p50':>8} {'p99':>8} {'max':>8} {'jit p99':>8} {'lost':>6} {'dup':>5} {'ooo':>5}")
+        for c in connections:
+            interval = c['interval_us'] or {}
+            jitter = c['jitter_us'] or {}
+            rpi = format_us(c['rpi_us']) + ('*' if c['rpi_source'] == 'median' else '')
+            sequence = c['sequence']
+            print(f"{c['direction']:5} {c['connection_id']:10} {c['source']:>15} -> {c['destination']:15} "
+                  f"{c['packets']:8} {rpi:>8} {format_us(interval.get('p50')):>8} "
+                  f"{format_us(interval.get('p99')):>8} {format_us(interval.get('max')):>8} "
+                  f"{format_us(jitter.get('p99')):>8} {sequence['lost']:6} {sequence['duplicates']:5} "
+                  f"{sequence['out_of_order']:5}")
+        if any(c['rpi_source'] == 'median' for c in connections):
+            print("* no Forward Open reply in the capture, the median interval is taken as RPI")
+
+        print()
+        print("=== RPI histogram (packet interval / RPI) ===")
+        names = [name for name, _ in RPI_BINS]
+        print(f"{'connection':10} " + ' '.join(f"{name:>9}" for name in names))
+        for c in connections:
+            if c['rpi_histogram']:
+                print(f"{c['connection_id']:10} " +
+                      ' '.join(f"{c['rpi_histogram'][name]:9}" for name in names))
+
+        latencies = [c for c in connections if c['consume_to_produce_us']]
+        if latencies:
+            print()
+            print("=== Consume to produce (newest O->T packet to next T->O packet, ms) ===")
+            for c in latencies:
+                latency = c['consume_to_produce_us']
+                print(f"T->O {c['connection_id']}: {latency['count']} productions, "
+                      f"p50 {format_us(latency['p50'])} p99 {format_us(latency['p99'])} "
+                      f"max {format_us(latency['max'])}")
+
+    if summary['acd']:
+        print()
+        print("=== ACD ===")
+        for entry in summary['acd']:
+            print(f"{entry['ip']} from {entry['mac']}: {entry['probes']} probes, "
+                  f"{entry['announcements']} announcements, {len(entry['cycles'])} probe cycles")
+            for cycle in entry['cycles']:
+                print(f"  at {cycle['start_s']:.3f} s: {cycle['probes']} probes, intervals "
+                      f"{cycle['probe_intervals_ms']} ms, probe to announce "
+                      f"{cycle['probe_to_announce_ms']} ms, announce intervals "
+                      f"{cycle['announce_intervals_ms']} ms")
+            later = entry['later_announcement_interval_ms']
+            if later:
+                print(f"  later announcements: {later['count'] + 1}, interval "
+                      f"min {later['min']} mean {later['mean']} max {later['max']} ms")
+        for conflict in summary['conflicts']:
+            print(f"conflict at {conflict['time_s']:.3f} s: {conflict['ip']} claimed by "
+                  f"{conflict['mac']}, used by {conflict['owner_mac']}")
+        if summary['conflict_count'] > len(summary['conflicts']):
+            print(f"... {summary['conflict_count']} conflicts in total")
+
+
+def connection_keys(summary):
+    """Connection IDs differ between runs, so match direction, RPI and order"""
+    keys = {}
+    seen = {}
+    for c in summary['connections']:
+        rpi = c['rpi_us']
+        base = f"{c['direction']} {rpi / 1e3:g} ms" if rpi else f"{c['direction']} ?"
+        seen[base] = seen.get(base, 0) + 1
+        keys[f"{base} #{seen[base]}"] = c
+    return keys
+
+
+COMPARED_METRICS = (
+    ('interval p50 (ms)', lambda c: (c['interval_us'] or {}).get('p50'), 1e-3),
+    ('interval p99 (ms)', lambda c: (c['interval_us'] or {}).get('p99'), 1e-3),
+    ('interval max (ms)', lambda c: (c['interval_us'] or {}).get('max'), 1e-3),
+    ('interval stddev (ms)', lambda c: (c['interval_us'] or {}).get('stddev'), 1e-3),
+    ('jitter p99 (ms)', lambda c: (c['jitter_us'] or {}).get('p99'), 1e-3),
+    ('late >=150% RPI', lambda c: (c['rpi_histogram'] or {}).get('150-200%', 0) +
+     (c['rpi_histogram'] or {}).get('>=200%', 0) if c['rpi_histogram'] else None, 1),
+    ('lost packets', lambda c: c['sequence']['lost'], 1),
+    ('consume to produce p50 (ms)', lambda c: (c['consume_to_produce_us'] or {}).get('p50'), 1e-3),
+    ('consume to produce p99 (ms)', lambda c: (c['consume_to_produce_us'] or {}).get('p99'), 1e-3),
+)
+
+
+def format_number(value):
+    if value is None:
+        return '-'
+    return f"{value:g}" if isinstance(value, int) else f"{value:.3f}"
+
+
+def print_comparison(before, after):
+    print(f"# {before['label']} vs {after['label']}")
+    print()
+    print(f"Captures: `{before['source']}` ({before['span_s']:.1f} s), "
+          f"`{after['source']}` ({after['span_s']:.1f} s)")
+    keys_before = connection_keys(before)
+    keys_after = connection_keys(after)
+    for key in list(keys_before) + [k for k in keys_after if k not in keys_before]:
+        print()
+        print(f"## {key}")
+        print()
+        print(f"| Metric | {before['label']} | {after['label']} | Change |")
+        print("|--------|------|------|--------|")
+        a = keys_before.get(key)
+        b = keys_after.get(key)
+        for name, get, scale in COMPARED_METRICS:
+            va = get(a) if a else None
+            vb = get(b) if b else None
+            if va is None and vb is None:
+                continue
+            va = va * scale if va is not None and scale != 1 else va
+            vb = vb * scale if vb is not None and scale != 1 else vb
+            change = '-'
+            if va is not None and vb is not None:
+                change = format_number(vb - va)
+                if va:
+                    change += f" ({(vb - va) / va * 100:+.1f}%)"
+            print(f"| {name} | {format_number(va)} | {format_number(vb)} | {change} |")
+
+    acd_before = {entry['ip']: entry for entry in before['acd']}
+    acd_after = {entry['ip']: entry for entry in after['acd']}
+    for ip in list(acd_before) + [ip for ip in acd_after if ip not in acd_before]:
+        print()
+        print(f"## ACD {ip}")
+        print()
+        print(f"| Metric | {before['label']} | {after['label']} |")
+        print("|--------|------|------|")
+        rows = (
+            ('probe cycles', lambda e: len(e['cycles'])),
+            ('probe intervals (ms)', lambda e: e['cycles'][0]['probe_intervals_ms'] if e['cycles'] else None),
+            ('probe to announce (ms)', lambda e: e['cycles'][0]['probe_to_announce_ms'] if e['cycles'] else None),
+            ('announce intervals (ms)', lambda e: e['cycles'][0]['announce_intervals_ms'] if e['cycles'] else None),
+        )
+        for name, get in rows:
+            values = [get(entries[ip]) if ip in entries else None for entries in (acd_before, acd_after)]
+            print(f"| {name} | " + ' | '.join('-' if v is None else str(v) for v in values) + " |")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Streaming EtherNet/IP capture analyzer')
+    commands = parser.add_subparsers(dest='command', required=True)
+    analyze = commands.add_parser('analyze', help='analyze a PDML or EK dissection')
+    analyze.add_argument('input', help="PDML or EK file, '-' for stdin")
+    analyze.add_argument('--device', help='IP address of the adapter, for connections and ARP '
+                                          'without a Forward Open or probe in the capture')
+    analyze.add_argument('--label', help='name of the summary in comparisons (default: input name)')
+    analyze.add_argument('--json', help='write the summary to this JSON file')
+    compare = commands.add_parser('compare', help='compare two JSON summaries as Markdown')
+    compare.add_argument('before', help='summary of the reference run')
+    compare.add_argument('after', help='summary of the run to compare')
+    args = parser.parse_args()
+
+    if args.command == 'compare':
+        with open(args.before) as first, open(args.after) as second:
+            print_comparison(json.load(first), json.load(second))
+        return 0
+
+    analyzer = Analyzer(args.device)
+    try:
+        for fields in iter_packets(args.input):
+            analyzer.packet(fields)
+    except FileNotFoundError:
+        print(f"Error: File '{args.input}' not found")
+        return 1
+    except (ET.ParseError, json.JSONDecodeError) as error:
+        # A capture cut off while tshark was still writing
+        print(f"Warning: input ends with a parse error after {analyzer.packets} packets: {error}")
+    summary = analyzer.summary(args.label or args.input, args.input)
+    print_report(summary)
+    if args.json:
+        with open(args.json, 'w') as output:
+            json.dump(summary, output, indent=2)
+        print(f"\nSummary written to {args.json}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
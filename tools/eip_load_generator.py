@@ -0,0 +1,700 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+EtherNet/IP Scanner Emulator / Load Generator
+
+This script loads an EtherNet/IP adapter the way one or more scanners would:
+1. Opens N exclusive owner, input only and listen only connections with
+   Forward Open at configurable RPIs
+2. Streams Class 1 O->T data and receives the T->O data of every connection
+3. Records per connection the T->O packet interval jitter against the
+   actual packet interval, lost sequence numbers and timeouts
+4. Optionally floods explicit GetAttributeSingle requests from concurrent
+   TCP sessions and sends ListIdentity broadcasts at the same time
+5. Closes all connections with Forward Close and prints a report
+
+Use it to find the connection and RPI ceiling of a device. It needs no
+raw sockets, only the standard library. Class 1 traffic uses UDP port 2222
+of the host, so do not run it on the same host as an adapter bound to it.
+
+Usage:
+    python eip_load_generator.py --target 172.16.82.100 --eo 1 --rpi 10
+    python eip_load_generator.py --target 172.16.82.100 --eo 1 --io 2 --lo 2 --rpi 5 --duration 120
+    python eip_load_generator.py --target 172.16.82.100 --eo 1 --rpi 2 --flood-sessions 4 --list-identity-rate 10
+    python eip_load_generator.py --target 172.16.82.100 --eo 1 --rpi 10 --t2o-p2p --json result.json
+
+Requirements:
+    Python 3.8 or later, no additional packages
+
+Author: Adam G. Sweeney <agsweeney@gmail.com>
+License: MIT
+"""
+
+import argparse
+import heapq
+import json
+import random
+import select
+import socket
+import struct
+import sys
+import threading
+import time
+
+# Fix Windows console encoding
+if sys.platform == 'win32':
+    import codecs
+    sys.stdout = codecs.getwriter('utf-8')(sys.stdout.buffer, 'strict')
+    sys.stderr = codecs.getwriter('utf-8')(sys.stderr.buffer, 'strict')
+
+ENIP_PORT = 44818
+CLASS1_PORT = 2222
+
+CMD_LIST_IDENTITY = 0x0063
+CMD_REGISTER_SESSION = 0x0065
+CMD_UNREGISTER_SESSION = 0x0066
+CMD_SEND_RR_DATA = 0x006F
+
+ITEM_NULL_ADDRESS = 0x0000
+ITEM_CONNECTED_DATA = 0x00B1
+ITEM_UNCONNECTED_DATA = 0x00B2
+ITEM_SOCKADDR_T2O = 0x8001
+ITEM_SEQUENCED_ADDRESS = 0x8002
+
+SERVICE_GET_ATTRIBUTE_SINGLE = 0x0E
+SERVICE_FORWARD_CLOSE = 0x4E
+SERVICE_FORWARD_OPEN = 0x54
+
+CONNECTION_MANAGER_PATH = bytes([0x20, 0x06, 0x24, 0x01])
+
+CONNECTION_TYPE_NULL = 0
+CONNECTION_TYPE_MULTICAST = 1
+CONNECTION_TYPE_P2P = 2
+
+EXTENDED_STATUS_TEXT = {
+    0x0100: "connection in use / duplicate forward open",
+    0x0103: "transport class and trigger not supported",
+    0x0106: "ownership conflict",
+    0x0107: "connection not found",
+    0x0108: "invalid network connection parameter",
+    0x0109: "invalid connection size",
+    0x0111: "RPI not supported",
+    0x0113: "out of connections",
+    0x0114: "vendor ID or product code mismatch",
+    0x0115: "device type mismatch",
+    0x0116: "revision mismatch",
+    0x0117: "invalid produced or consumed application path",
+    0x0118: "invalid or inconsistent configuration application path",
+    0x0119: "non listen only connection not opened",
+    0x011A: "target object out of connections",
+    0x0127: "invalid O->T connection size",
+    0x0128: "invalid T->O connection size",
+    0x0315: "invalid segment in connection path",
+}
+
+
+def percentile(values, fraction):
+    """Nearest rank percentile of an unsorted list, None if empty"""
+    if not values:
+        return None
+    ordered = sorted(values)
+    rank = max(0, min(len(ordered) - 1, int(round(fraction * len(ordered) + 0.5)) - 1))
+    return ordered[rank]
+
+
+def parse_path(text):
+    """'20 04 24 97 2C 96 2C 64' -> bytes"""
+    return bytes(int(octet, 16) for octet in text.split())
+
+
+def encapsulation(command, data=b'', session=0, context=b'\0' * 8):
+    return struct.pack('<HHII8sI', command, len(data), session, 0, context, 0) + data
+
+
+def parse_cpf(data):
+    """Returns a list of (type_id, item data)"""
+    items = []
+    count, = struct.unpack_from('<H', data, 0)
+    offset = 2
+    for _ in range(count):
+        if offset + 4 > len(data):
+            break
+        type_id, length = struct.unpack_from('<HH', data, offset)
+        items.append((type_id, data[offset + 4:offset + 4 + length]))
+        offset += 4 + length
+    return items
+
+
+class CipError(Exception):
+    def __init__(self, general_status, extended_status):
+        self.general_status = general_status
+        self.extended_status = extended_status
+        text = EXTENDED_STATUS_TEXT.get(extended_status, "")
+        message = f"general status 0x{general_status:02X}"
+        if extended_status is not None:
+            message += f", extended status 0x{extended_status:04X}"
+            if text:
+                message += f" ({text})"
+        super().__init__(message)
+
+
+class ExplicitSession:
+    """One TCP session for unconnected explicit messages"""
+
+    def __init__(self, target, timeout=2.0):
+        self.sock = socket.create_connection((target, ENIP_PORT), timeout=timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.session = 0
+        reply = self._transact(encapsulation(CMD_REGISTER_SESSION, struct.pack('<HH', 1, 0)))
+        command, _, session, status = struct.unpack_from('<HHII', reply, 0)
+        if command != CMD_REGISTER_SESSION or status != 0:
+            raise ConnectionError(f"RegisterSession failed, status 0x{status:X}")
+        self.session = session
+
+    def _receive_exactly(self, length):
+        data = b''
+        while len(data) < length:
+            chunk = self.sock.recv(length - len(data))
+            if not chunk:
+                raise ConnectionError("connection closed by the target")
+            data += chunk
+        return data
+
+    def _transact(self, request):
+        self.sock.sendall(request)
+        header = self._receive_exactly(24)
+        length, = struct.unpack_from('<H', header, 2)
+        return header + self._receive_exactly(length)
+
+    def request(self, service, path, data=b''):
+        """Send an unconnected CIP request, returns (reply data, CPF items)"""
+        cip = bytes([service, len(path) // 2]) + path + data
+        cpf = struct.pack('<IHH', 0, 0, 2)
+        cpf += struct.pack('<HH', ITEM_NULL_ADDRESS, 0)
+        cpf += struct.pack('<HH', ITEM_UNCONNECTED_DATA, len(cip)) + cip
+        reply = self._transact(encapsulation(CMD_SEND_RR_DATA, cpf, self.session))
+        status, = struct.unpack_from('<I', reply, 8)
+        if status != 0:
+            raise ConnectionError(f"SendRRData failed, encapsulation status 0x{status:X}")
+        items = parse_cpf(reply[24 + 6:])
+        for type_id, item in items:
+            if type_id == ITEM_UNCONNECTED_DATA:
+                general_status = item[2]
+                additional_words = item[3]
+                extended_status = None
+                if additional_words > 0:
+                    extended_status, = struct.unpack_from('<H', item, 4)
+                if general_status != 0:
+                    raise CipError(general_status, extended_status)
+                return item[4 + 2 * additional_words:], items
+        raise ConnectionError("reply without unconnected data item")
+
+    def close(self):
+        try:
+            self.sock.sendall(encapsulation(CMD_UNREGISTER_SESSION, b'', self.session))
+        except OSError:
+            pass
+        self.sock.close()
+
+
+class RunningStatistics:
+    """Sample list with the summary the report prints"""
+
+    def __init__(self):
+        self.samples = []
+
+    def add(self, value):
+        self.samples.append(value)
+
+    def summary(self, scale=1.0):
+        if not self.samples:
+            return None
+        return {
+            'count': len(self.samples),
+            'min': min(self.samples) * scale,
+            'avg': sum(self.samples) / len(self.samples) * scale,
+            'p99': percentile(self.samples, 0.99) * scale,
+            'max': max(self.samples) * scale,
+        }
+
+
+class IoConnection:
+    """State and statistics of one Class 1 connection"""
+
+    def __init__(self, kind, index, args, path):
+        self.kind = kind
+        self.name = f"{kind}{index}"
+        self.path = path
+        self.rpi_us = int(args.rpi * 1000)
+        self.t2o_rpi_us = int((args.t2o_rpi if args.t2o_rpi else args.rpi) * 1000)
+        self.timeout_multiplier = args.timeout_multiplier
+        self.t2o_type = CONNECTION_TYPE_P2P if args.t2o_p2p else CONNECTION_TYPE_MULTICAST
+        if kind == 'EO':
+            o2t_data = args.o2t_size + (4 if args.o2t_run_idle else 0)
+        else:
+            o2t_data = 0  # heartbeat
+        self.o2t_size = 2 + o2t_data  # with the CIP sequence count
+        self.t2o_size = 2 + args.t2o_size + (4 if args.t2o_run_idle else 0)
+        self.o2t_payload = bytes(o2t_data)
+        self.serial_number = random.randint(1, 0xFFFF)
+        self.t2o_requested_id = random.randint(1, 0xFFFFFFFF)
+        self.o2t_id = 0
+        self.t2o_id = 0
+        self.o2t_api_us = 0
+        self.t2o_api_us = 0
+        self.multicast_address = None
+        self.open = False
+        self.error = None
+        # O->T production
+        self.encapsulation_sequence = 0
+        self.cip_sequence = 0
+        self.sent = 0
+        self.send_late = RunningStatistics()  # seconds behind schedule
+        # T->O consumption
+        self.received = 0
+        self.lost = 0
+        self.duplicates = 0
+        self.timeouts = 0
+        self.timed_out = False
+        self.last_sequence = None
+        self.last_receive = None
+        self.jitter = RunningStatistics()  # interval - API, seconds
+        self.intervals = RunningStatistics()
+
+    def timeout_seconds(self):
+        return self.t2o_api_us / 1e6 * (4 << self.timeout_multiplier)
+
+    def forward_open_data(self, originator_serial):
+        o2t_parameters = (CONNECTION_TYPE_P2P << 13) | self.o2t_size
+        t2o_parameters = (self.t2o_type << 13) | self.t2o_size
+        data = struct.pack('<BBIIHHIB3xIHIHB',
+                           0x0A, 0x0E,  # priority / time tick, timeout ticks
+                           0, self.t2o_requested_id,
+                           self.serial_number, 0x1234, originator_serial,
+                           self.timeout_multiplier,
+                           self.rpi_us, o2t_parameters,
+                           self.t2o_rpi_us, t2o_parameters,
+                           0x01)  # class 1, cyclic
+        return data + bytes([len(self.path) // 2]) + self.path
+
+    def forward_close_data(self, originator_serial):
+        data = struct.pack('<BBHHIBx', 0x0A, 0x0E, self.serial_number, 0x1234,
+                           originator_serial, len(self.path) // 2)
+        return data + self.path
+
+    def on_forward_open_reply(self, reply, items):
+        (self.o2t_id, self.t2o_id, _, _, _,
+         self.o2t_api_us, self.t2o_api_us) = struct.unpack_from('<IIHHIII', reply, 0)
+        for type_id, item in items:
+            if type_id == ITEM_SOCKADDR_T2O and len(item) >= 8:
+                address = socket.inet_ntoa(item[4:8])
+                if int(address.split('.')[0]) >= 224:
+                    self.multicast_address = address
+        self.open = True
+
+    def class1_packet(self):
+        """Next O->T packet, sequenced address item plus connected data"""
+        self.encapsulation_sequence = (self.encapsulation_sequence + 1) & 0xFFFFFFFF
+        self.cip_sequence = (self.cip_sequence + 1) & 0xFFFF
+        data = struct.pack('<H', self.cip_sequence) + self.o2t_payload
+        return (struct.pack('<HHHII', 2, ITEM_SEQUENCED_ADDRESS, 8,
+                            self.o2t_id, self.encapsulation_sequence) +
+                struct.pack('<HH', ITEM_CONNECTED_DATA, len(data)) + data)
+
+    def on_class1_packet(self, sequence, now):
+        if self.last_sequence is not None:
+            gap = (sequence - self.last_sequence) & 0xFFFFFFFF
+            if gap == 0 or gap > 0x7FFFFFFF:
+                self.duplicates += 1
+                return
+            self.lost += gap - 1
+            interval = now - self.last_receive
+            self.intervals.add(interval)
+            self.jitter.add(interval - self.t2o_api_us / 1e6)
+        self.last_sequence = sequence
+        self.last_receive = now
+        self.received += 1
+        self.timed_out = False
+
+    def check_timeout(self, now):
+        if self.open and not self.timed_out and self.last_receive is not None:
+            if now - self.last_receive > self.timeout_seconds():
+                self.timeouts += 1
+                self.timed_out = True
+
+    def report(self):
+        jitter = self.jitter.summary(1e3)
+        late = self.send_late.summary(1e3)
+        return {
+            'name': self.name,
+            'open': self.open,
+            'error': self.error,
+            'o2t_id': self.o2t_id,
+            't2o_id': self.t2o_id,
+            'o2t_api_ms': self.o2t_api_us / 1e3,
+            't2o_api_ms': self.t2o_api_us / 1e3,
+            'multicast': self.multicast_address,
+            'sent': self.sent,
+            'received': self.received,
+            'lost': self.lost,
+            'duplicates': self.duplicates,
+            'timeouts': self.timeouts,
+            'jitter_ms': jitter,
+            'o2t_send_late_ms': late,
+        }
+
+
+class Class1Engine(threading.Thread):
+    """Sends O->T data of all connections on schedule and receives T->O data"""
+
+    def __init__(self, target, connections, stop, local_address):
+        super().__init__(daemon=True)
+        self.target = target
+        self.connections = [c for c in connections if c.open]
+        self.by_id = {}  # listen only and input only consumers share the T->O ID
+        for connection in self.connections:
+            self.by_id.setdefault(connection.t2o_id, []).append(connection)
+        self.stop = stop
+        self.unknown = 0
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+        self.sock.bind(('', CLASS1_PORT))
+        self.sock.setblocking(False)
+        joined = set()
+        for connection in self.connections:
+            group = connection.multicast_address
+            if group and group not in joined:
+                membership = socket.inet_aton(group) + socket.inet_aton(local_address)
+                self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+                joined.add(group)
+
+    def run(self):
+        start = time.perf_counter()
+        schedule = [(start + i * 1e-4, i) for i in range(len(self.connections))]
+        heapq.heapify(schedule)
+        next_timeout_check = start
+        while not self.stop.is_set():
+            now = time.perf_counter()
+            while schedule and schedule[0][0] <= now:
+                due, i = heapq.heappop(schedule)
+                connection = self.connections[i]
+                connection.send_late.add(now - due)
+                try:
+                    self.sock.sendto(connection.class1_packet(), (self.target, CLASS1_PORT))
+                    connection.sent += 1
+                except OSError:
+                    pass
+                interval = connection.o2t_api_us / 1e6
+                due += interval
+                if due < now - interval:  # fell behind, do not burst
+                    due = now + interval
+                heapq.heappush(schedule, (due, i))
+            wait = max(0.0, schedule[0][0] - time.perf_counter()) if schedule else 0.1
+            readable, _, _ = select.select([self.sock], [], [], min(wait, 0.05))
+            if readable:
+                self._receive()
+            now = time.perf_counter()
+            if now >= next_timeout_check:
+                for connection in self.connections:
+                    connection.check_timeout(now)
+                next_timeout_check = now + 0.001
+        self.sock.close()
+
+    def _receive(self):
+        while True:
+            try:
+                data, _ = self.sock.recvfrom(2048)
+            except (BlockingIOError, OSError):
+                return
+            now = time.perf_counter()
+            if len(data) < 14:
+                continue
+            count, type_id, length = struct.unpack_from('<HHH', data, 0)
+            if count < 2 or type_id != ITEM_SEQUENCED_ADDRESS or length != 8:
+                continue
+            connection_id, sequence = struct.unpack_from('<II', data, 6)
+            consumers = self.by_id.get(connection_id)
+            if consumers is None:
+                self.unknown += 1
+                continue
+            for connection in consumers:
+                connection.on_class1_packet(sequence, now)
+
+
+class ExplicitFlood(threading.Thread):
+    """Back to back (or rate limited) GetAttributeSingle requests"""
+
+    def __init__(self, target, rate, stop, path):
+        super().__init__(daemon=True)
+        self.target = target
+        self.rate = rate
+        self.stop = stop
+        self.path = path
+        self.requests = 0
+        self.errors = 0
+        self.latency = RunningStatistics()
+
+    def run(self):
+        try:
+            session = ExplicitSession(self.target)
+        except OSError as error:
+            print(f"Explicit flood: {error}")
+            self.errors += 1
+            return
+        period = 1.0 / self.rate if self.rate > 0 else 0.0
+        next_request = time.perf_counter()
+        while not self.stop.is_set():
+            start = time.perf_counter()
+            try:
+                session.request(SERVICE_GET_ATTRIBUTE_SINGLE, self.path)
+                self.latency.add(time.perf_counter() - start)
+            except CipError:
+                self.errors += 1
+            except OSError:
+                self.errors += 1
+                break
+            self.requests += 1
+            if period:
+                next_request += period
+                delay = next_request - time.perf_counter()
+                if delay > 0:
+                    self.stop.wait(delay)
+        session.close()
+
+
+class ListIdentityBroadcaster(threading.Thread):
+    """ListIdentity to the broadcast address, counting replies of the target"""
+
+    def __init__(self, target, broadcast, rate, stop):
+        super().__init__(daemon=True)
+        self.target = target
+        self.broadcast = broadcast
+        self.rate = rate
+        self.stop = stop
+        self.sent = 0
+        self.replies = 0
+        self.other_replies = 0
+        self.latency = RunningStatistics()
+
+    def run(self):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+        sock.bind(('', 0))
+        period = 1.0 / self.rate
+        next_send = time.perf_counter()
+        sent_at = {}
+        while not self.stop.is_set():
+            now = time.perf_counter()
+            if now >= next_send:
+                context = struct.pack('<Q', self.sent)
+                sent_at[context] = now
+                sock.sendto(encapsulation(CMD_LIST_IDENTITY, context=context),
+                            (self.broadcast, ENIP_PORT))
+                self.sent += 1
+                next_send += period
+            readable, _, _ = select.select([sock], [], [], max(0.0, min(next_send - now, 0.05)))
+            if readable:
+                data, (address, _) = sock.recvfrom(2048)
+                if address != self.target:
+                    self.other_replies += 1
+                    continue
+                self.replies += 1
+                start = sent_at.pop(data[12:20], None)
+                if start is not None:
+                    self.latency.add(time.perf_counter() - start)
+        sock.close()
+
+
+def open_connections(args, originator_serial):
+    paths = {'EO': parse_path(args.eo_path), 'IO': parse_path(args.io_path),
+             'LO': parse_path(args.lo_path)}
+    # Exclusive owners first, listen only connections need an open producer
+    connections = [IoConnection(kind, i + 1, args, paths[kind])
+                   for kind, count in (('EO', args.eo), ('IO', args.io), ('LO', args.lo))
+                   for i in range(count)]
+    session = ExplicitSession(args.target)
+    for connection in connections:
+        try:
+            reply, items = session.request(SERVICE_FORWARD_OPEN, CONNECTION_MANAGER_PATH,
+                                           connection.forward_open_data(originator_serial))
+            connection.on_forward_open_reply(reply, items)
+            where = f", multicast {connection.multicast_address}" if connection.multicast_address else ""
+            print(f"{connection.name}: open, O->T 0x{connection.o2t_id:08X} API {connection.o2t_api_us / 1e3:.1f} ms, "
+                  f"T->O 0x{connection.t2o_id:08X} API {connection.t2o_api_us / 1e3:.1f} ms{where}")
+        except (CipError, OSError) as error:
+            connection.error = str(error)
+            print(f"{connection.name}: Forward Open failed: {error}")
+    return session, connections
+
+
+def close_connections(session, connections, originator_serial):
+    # Reverse order, listen only connections before their producer
+    for connection in reversed(connections):
+        if not connection.open:
+            continue
+        try:
+            session.request(SERVICE_FORWARD_CLOSE, CONNECTION_MANAGER_PATH,
+                            connection.forward_close_data(originator_serial))
+        except (CipError, OSError) as error:
+            print(f"{connection.name}: Forward Close failed: {error}")
+    session.close()
+
+
+def format_summary(summary, unit='ms'):
+    if summary is None:
+        return "-"
+    return (f"avg {summary['avg']:+.3f} p99 {summary['p99']:+.3f} "
+            f"max {summary['max']:+.3f} {unit}")
+
+
+def print_report(connections, engine, floods, broadcaster, duration):
+    print()
+    print(f"=== Connections ({duration:.1f} s) ===")
+    print(f"{'name':6} {'sent':>8} {'recv':>8} {'lost':>6} {'dup':>5} {'tmo':>4}  T->O jitter (interval - API)")
+    for connection in connections:
+        if not connection.open:
+            print(f"{connection.name:6} not open: {connection.error}")
+            continue
+        print(f"{connection.name:6} {connection.sent:8} {connection.received:8} {connection.lost:6} "
+              f"{connection.duplicates:5} {connection.timeouts:4}  {format_summary(connection.jitter.summary(1e3))}")
+    if engine is not None and engine.unknown:
+        print(f"Class 1 packets with an unknown connection ID: {engine.unknown}")
+    late = [c.send_late.summary(1e3) for c in connections if c.open and c.send_late.samples]
+    if late:
+        worst = max(s['p99'] for s in late)
+        print(f"O->T send lateness of this host, worst p99: {worst:.3f} ms")
+
+    if floods:
+        requests = sum(f.requests for f in floods)
+        errors = sum(f.errors for f in floods)
+        latency = RunningStatistics()
+        for flood in floods:
+            latency.samples.extend(flood.latency.samples)
+        summary = latency.summary(1e3)
+        print()
+        print(f"=== Explicit flood ({len(floods)} sessions) ===")
+        print(f"requests {requests} ({requests / duration:.0f}/s), errors {errors}")
+        if summary:
+            print(f"latency avg {summary['avg']:.3f} p99 {summary['p99']:.3f} max {summary['max']:.3f} ms")
+
+    if broadcaster is not None:
+        summary = broadcaster.latency.summary(1e3)
+        print()
+        print("=== ListIdentity broadcast ===")
+        print(f"sent {broadcaster.sent}, replies from target {broadcaster.replies}, "
+              f"from other devices {broadcaster.other_replies}")
+        if summary:
+            print(f"latency avg {summary['avg']:.3f} p99 {summary['p99']:.3f} max {summary['max']:.3f} ms")
+
+
+def local_address_towards(target):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    try:
+        sock.connect((target, ENIP_PORT))
+        return sock.getsockname()[0]
+    finally:
+        sock.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='EtherNet/IP scanner emulator and load generator')
+    parser.add_argument('--target', required=True, help='IP address of the adapter')
+    parser.add_argument('--eo', type=int, default=1, help='number of exclusive owner connections (default: 1)')
+    parser.add_argument('--io', type=int, default=0, help='number of input only connections (default: 0)')
+    parser.add_argument('--lo', type=int, default=0, help='number of listen only connections (default: 0)')
+    parser.add_argument('--rpi', type=float, default=10.0, help='O->T RPI in ms (default: 10)')
+    parser.add_argument('--t2o-rpi', type=float, default=None, help='T->O RPI in ms (default: same as --rpi)')
+    parser.add_argument('--timeout-multiplier', type=int, default=0, choices=range(8),
+                        help='connection timeout multiplier index, timeout = RPI * 4 << n (default: 0)')
+    parser.add_argument('--t2o-p2p', action='store_true', help='request point to point instead of multicast T->O')
+    parser.add_argument('--o2t-size', type=int, default=2, help='O->T data bytes of exclusive owners (default: 2)')
+    parser.add_argument('--t2o-size', type=int, default=10, help='T->O data bytes (default: 10)')
+    parser.add_argument('--o2t-run-idle', action='store_true', help='O->T data carries a 32 bit run/idle header')
+    parser.add_argument('--t2o-run-idle', action='store_true', help='T->O data carries a 32 bit run/idle header')
+    parser.add_argument('--eo-path', default='20 04 24 97 2C 96 2C 64',
+                        help='exclusive owner connection path (default: config 151, O->T 150, T->O 100)')
+    parser.add_argument('--io-path', default='20 04 24 97 2C 98 2C 64',
+                        help='input only connection path (default: config 151, O->T heartbeat 152, T->O 100)')
+    parser.add_argument('--lo-path', default='20 04 24 97 2C 99 2C 64',
+                        help='listen only connection path (default: config 151, O->T heartbeat 153, T->O 100)')
+    parser.add_argument('--duration', type=float, default=60.0, help='test duration in seconds (default: 60)')
+    parser.add_argument('--flood-sessions', type=int, default=0,
+                        help='TCP sessions sending GetAttributeSingle requests (default: 0)')
+    parser.add_argument('--flood-rate', type=float, default=0.0,
+                        help='requests per second per session, 0 = back to back (default: 0)')
+    parser.add_argument('--flood-path', default='20 01 24 01 30 07',
+                        help='attribute requested by the flood (default: Identity product name)')
+    parser.add_argument('--list-identity-rate', type=float, default=0.0,
+                        help='ListIdentity broadcasts per second (default: 0)')
+    parser.add_argument('--broadcast', default='255.255.255.255', help='ListIdentity broadcast address')
+    parser.add_argument('--json', help='write the results to this JSON file')
+    args = parser.parse_args()
+
+    originator_serial = random.randint(1, 0xFFFFFFFF)
+    try:
+        session, connections = open_connections(args, originator_serial)
+    except OSError as error:
+        print(f"Cannot reach {args.target}: {error}")
+        return 1
+
+    stop = threading.Event()
+    engine = None
+    if any(c.open for c in connections):
+        engine = Class1Engine(args.target, connections, stop, local_address_towards(args.target))
+    floods = [ExplicitFlood(args.target, args.flood_rate, stop, parse_path(args.flood_path))
+              for _ in range(args.flood_sessions)]
+    broadcaster = None
+    if args.list_identity_rate > 0:
+        broadcaster = ListIdentityBroadcaster(args.target, args.broadcast, args.list_identity_rate, stop)
+
+    workers = ([engine] if engine else []) + floods + ([broadcaster] if broadcaster else [])
+    start = time.perf_counter()
+    for worker in workers:
+        worker.start()
+    try:
+        print(f"Running for {args.duration:.0f} s, Ctrl-C to stop early")
+        stop.wait(args.duration)
+    except KeyboardInterrupt:
+        pass
+    stop.set()
+    for worker in workers:
+        worker.join(timeout=2.0)
+    duration = time.perf_counter() - start
+
+    close_connections(session, connections, originator_serial)
+    print_report(connections, engine, floods, broadcaster, duration)
+
+    if args.json:
+        result = {
+            'target': args.target,
+            'duration_s': duration,
+            'rpi_ms': args.rpi,
+            'connections': [c.report() for c in connections],
+            'unknown_class1_packets': engine.unknown if engine else 0,
+        }
+        if floods:
+            latency = RunningStatistics()
+            for flood in floods:
+                latency.samples.extend(flood.latency.samples)
+            result['explicit_flood'] = {
+                'sessions': len(floods),
+                'requests': sum(f.requests for f in floods),
+                'errors': sum(f.errors for f in floods),
+                'latency_ms': latency.summary(1e3),
+            }
+        if broadcaster:
+            result['list_identity'] = {
+                'sent': broadcaster.sent,
+                'replies': broadcaster.replies,
+                'other_replies': broadcaster.other_replies,
+                'latency_ms': broadcaster.latency.summary(1e3),
+            }
+        with open(args.json, 'w') as output:
+            json.dump(result, output, indent=2)
+        print(f"\nResults written to {args.json}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,769 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+EtherNet/IP Soak Test
+
+This script qualifies a firmware for long uptimes under a mixed load:
+1. Keeps exclusive owner, input only and listen only connections running
+   at fixed RPIs with the Class 1 engine of eip_load_generator.py, and
+   reopens them if they time out
+2. Churns one more input only connection: a new TCP session, Forward Open,
+   a short hold and Forward Close, over and over
+3. Polls explicit GetAttributeSingle requests and fetches web UI pages at
+   fixed rates, reconnecting after errors
+4. Samples the device telemetry of the web API every interval: free heap,
+   minimum free heap, largest free block, the stack high water marks of
+   GET /api/system and the loop overruns of GET /api/diagnostics/network,
+   next to the T->O jitter percentiles of the interval
+5. Fits the trend of each value after a warm-up and prints a pass/fail
+   report: projected heap and largest block at the end of the qualification
+   horizon, stack margins, and the creep of loop overruns and jitter from
+   the first to the last quarter of the run
+
+Memory use does not grow with the run beyond one sample per interval, the
+jitter and latency samples are summarized and dropped every interval.
+
+Usage:
+    python eip_soak_test.py --target 172.16.82.100 --duration 72h
+    python eip_soak_test.py --target 172.16.82.100 --duration 7d --eo 1 --io 2 --rpi 5 --csv soak.csv --json soak.json
+    python eip_soak_test.py --target 172.16.82.100 --duration 30m --warmup 5m --sample-interval 10 --horizon-days 180
+
+Requirements:
+    Python 3.8 or later, no additional packages. eip_load_generator.py
+    has to be in the same directory.
+
+Author: Adam G. Sweeney <agsweeney@gmail.com>
+License: MIT
+"""
+
+import argparse
+import csv
+import http.client
+import json
+import os
+import random
+import statistics
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+from eip_load_generator import (  # noqa: E402
+    CONNECTION_MANAGER_PATH, SERVICE_FORWARD_CLOSE, SERVICE_FORWARD_OPEN,
+    SERVICE_GET_ATTRIBUTE_SINGLE, CipError, Class1Engine, ExplicitSession,
+    IoConnection, close_connections, local_address_towards, open_connections,
+    parse_path, percentile)
+
+# Fix Windows console encoding
+if sys.platform == 'win32':
+    import codecs
+    sys.stdout = codecs.getwriter('utf-8')(sys.stdout.buffer, 'strict')
+    sys.stderr = codecs.getwriter('utf-8')(sys.stderr.buffer, 'strict')
+
+SECONDS_PER_DAY = 86400.0
+# Trends need this many samples after the warm-up, each quarter two
+MINIMUM_TREND_SAMPLES = 8
+
+CSV_COLUMNS = [
+    'time', 'elapsed_s', 'uptime_s', 'heap_free', 'heap_min_free', 'largest_free_block',
+    'min_stack_free', 'min_stack_task', 'loop_overruns', 'jitter_p50_ms', 'jitter_p99_ms',
+    'jitter_p999_ms', 'jitter_max_ms', 'lost', 'timeouts', 'reopens', 'churn_cycles',
+    'churn_failures', 'explicit_requests', 'explicit_errors', 'explicit_p99_ms',
+    'web_requests', 'web_errors', 'web_p99_ms', 'telemetry_errors', 'reboots',
+]
+
+
+def parse_duration(text):
+    """'90' or '90s', '15m', '72h', '7d' -> seconds"""
+    units = {'s': 1, 'm': 60, 'h': 3600, 'd': 86400}
+    text = text.strip().lower()
+    if text and text[-1] in units:
+        return float(text[:-1]) * units[text[-1]]
+    return float(text)
+
+
+def take_samples(statistics_object):
+    """Swap out the samples another thread appends to, returns the old list"""
+    samples, statistics_object.samples = statistics_object.samples, []
+    return samples
+
+
+def slope_per_day(points):
+    """Least squares slope of (seconds, value) points, per day"""
+    if len(points) < 2:
+        return None
+    mean_t = sum(t for t, _ in points) / len(points)
+    mean_v = sum(v for _, v in points) / len(points)
+    variance = sum((t - mean_t) ** 2 for t, _ in points)
+    if variance == 0:
+        return None
+    covariance = sum((t - mean_t) * (v - mean_v) for t, v in points)
+    return covariance / variance * SECONDS_PER_DAY
+
+
+def quarter_medians(values):
+    """Medians of the first and the last quarter"""
+    quarter = max(2, len(values) // 4)
+    return statistics.median(values[:quarter]), statistics.median(values[-quarter:])
+
+
+class WindowCounter:
+    """Requests, errors and latencies of a worker, the latencies per window"""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.requests = 0
+        self.errors = 0
+        self.last_error = None
+        self.latencies = []
+
+    def success(self, latency):
+        with self.lock:
+            self.requests += 1
+            self.latencies.append(latency)
+
+    def failure(self, error):
+        with self.lock:
+            self.requests += 1
+            self.errors += 1
+            self.last_error = str(error)
+
+    def window(self):
+        """(requests, errors, p99 latency in ms or None), latencies cleared"""
+        with self.lock:
+            latencies, self.latencies = self.latencies, []
+            requests, errors = self.requests, self.errors
+        p99 = percentile(latencies, 0.99)
+        return requests, errors, None if p99 is None else p99 * 1e3
+
+
+class ConnectionChurn(threading.Thread):
+    """Opens and closes an input only connection on a new session each cycle.
+
+    The connection sends no heartbeat, so it is opened with the largest
+    timeout multiplier and held for at most half its timeout.
+    """
+
+    def __init__(self, args, originator_serial, stop):
+        super().__init__(daemon=True)
+        self.target = args.target
+        self.interval = args.churn_interval
+        self.stop = stop
+        self.originator_serial = originator_serial
+        self.path = parse_path(args.io_path)
+        self.churn_args = argparse.Namespace(**vars(args))
+        self.churn_args.timeout_multiplier = 7
+        self.hold = args.churn_hold
+        self.counter = WindowCounter()
+
+    def run(self):
+        cycle = 0
+        while not self.stop.wait(self.interval):
+            cycle += 1
+            connection = IoConnection('CH', cycle, self.churn_args, self.path)
+            start = time.perf_counter()
+            try:
+                session = ExplicitSession(self.target)
+            except OSError as error:
+                self.counter.failure(f"RegisterSession: {error}")
+                continue
+            try:
+                reply, items = session.request(SERVICE_FORWARD_OPEN, CONNECTION_MANAGER_PATH,
+                                               connection.forward_open_data(self.originator_serial))
+                connection.on_forward_open_reply(reply, items)
+                self.stop.wait(min(self.hold, connection.timeout_seconds() / 2))
+                session.request(SERVICE_FORWARD_CLOSE, CONNECTION_MANAGER_PATH,
+                                connection.forward_close_data(self.originator_serial))
+                self.counter.success(time.perf_counter() - start)
+            except (CipError, OSError) as error:
+                self.counter.failure(error)
+            finally:
+                session.close()
+
+
+class ExplicitPoller(threading.Thread):
+    """GetAttributeSingle at a fixed rate on one session, reconnecting on errors"""
+
+    def __init__(self, target, rate, path, stop):
+        super().__init__(daemon=True)
+        self.target = target
+        self.period = 1.0 / rate
+        self.path = path
+        self.stop = stop
+        self.reconnects = 0
+        self.counter = WindowCounter()
+
+    def run(self):
+        session = None
+        next_request = time.perf_counter()
+        while not self.stop.is_set():
+            if session is None:
+                try:
+                    session = ExplicitSession(self.target)
+                except OSError as error:
+                    self.counter.failure(f"RegisterSession: {error}")
+                    self.stop.wait(1.0)
+                    continue
+            start = time.perf_counter()
+            try:
+                session.request(SERVICE_GET_ATTRIBUTE_SINGLE, self.path)
+                self.counter.success(time.perf_counter() - start)
+            except CipError as error:
+                self.counter.failure(error)
+            except OSError as error:
+                self.counter.failure(error)
+                session.close()
+                session = None
+                self.reconnects += 1
+            next_request += self.period
+            delay = next_request - time.perf_counter()
+            if delay > 0:
+                self.stop.wait(delay)
+            else:
+                next_request = time.perf_counter()
+        if session is not None:
+            session.close()
+
+
+class WebTraffic(threading.Thread):
+    """GET requests for the web UI pages in turn, each on a new connection"""
+
+    def __init__(self, target, port, rate, pages, stop):
+        super().__init__(daemon=True)
+        self.target = target
+        self.port = port
+        self.period = 1.0 / rate
+        self.pages = pages
+        self.stop = stop
+        self.counter = WindowCounter()
+
+    def run(self):
+        index = 0
+        next_request = time.perf_counter()
+        while not self.stop.is_set():
+            page = self.pages[index % len(self.pages)]
+            index += 1
+            start = time.perf_counter()
+            try:
+                status, _ = http_get(self.target, self.port, page)
+                if status == 200:
+                    self.counter.success(time.perf_counter() - start)
+                else:
+                    self.counter.failure(f"GET {page}: HTTP {status}")
+            except (OSError, http.client.HTTPException) as error:
+                self.counter.failure(f"GET {page}: {error}")
+            next_request += self.period
+            delay = next_request - time.perf_counter()
+            if delay > 0:
+                self.stop.wait(delay)
+            else:
+                next_request = time.perf_counter()
+
+
+def http_get(target, port, path, timeout=5.0):
+    """(status, body) of a GET request"""
+    connection = http.client.HTTPConnection(target, port, timeout=timeout)
+    try:
+        connection.request('GET', path, headers={'Connection': 'close'})
+        response = connection.getresponse()
+        return response.status, response.read()
+    finally:
+        connection.close()
+
+
+class Telemetry:
+    """Reads the web API; an endpoint the firmware does not have is left out"""
+
+    def __init__(self, target, port):
+        self.target = target
+        self.port = port
+        self.missing = set()
+        self.errors = 0
+        self.last_error = None
+
+    def get(self, path):
+        if path in self.missing:
+            return None
+        try:
+            status, body = http_get(self.target, self.port, path)
+        except (OSError, http.client.HTTPException) as error:
+            self.errors += 1
+            self.last_error = f"GET {path}: {error}"
+            return None
+        if status == 404:
+            print(f"{path} not available, built without it")
+            self.missing.add(path)
+            return None
+        if status != 200:
+            self.errors += 1
+            self.last_error = f"GET {path}: HTTP {status}"
+            return None
+        try:
+            return json.loads(body)
+        except ValueError as error:
+            self.errors += 1
+            self.last_error = f"GET {path}: {error}"
+            return None
+
+    def sample(self):
+        """Device values of one sample, None where not known"""
+        values = {'uptime_s': None, 'heap_free': None, 'heap_min_free': None,
+                  'largest_free_block': None, 'stacks': {}, 'loop_overruns': None}
+        system = self.get('/api/system')
+        if system is None and '/api/system' in self.missing:
+            system = self.get('/api/status')  # free and minimum free heap only
+        if system is not None:
+            heap = system.get('heap', {})
+            values['uptime_s'] = system.get('uptime_s')
+            values['heap_free'] = heap.get('free')
+            values['heap_min_free'] = heap.get('min_free')
+            values['largest_free_block'] = heap.get('largest_free_block')
+            values['stacks'] = {task['name']: task['min_free'] for task in system.get('tasks', [])
+                                if 'min_free' in task}
+        network = self.get('/api/diagnostics/network')
+        if network is not None and 'overload' in network:
+            values['loop_overruns'] = network['overload'].get('loop_overruns')
+        return values
+
+
+class SteadyLoad:
+    """The connections measured for jitter, reopened after a timeout"""
+
+    def __init__(self, args, originator_serial):
+        self.args = args
+        self.originator_serial = originator_serial
+        self.session = None
+        self.connections = []
+        self.engine = None
+        self.stop = None
+        self.reopens = 0
+        self.timeouts = 0
+        self.lost = 0
+
+    def open(self):
+        self.session, self.connections = open_connections(self.args, self.originator_serial)
+        self.stop = threading.Event()
+        if any(c.open for c in self.connections):
+            self.engine = Class1Engine(self.args.target, self.connections, self.stop,
+                                       local_address_towards(self.args.target))
+            self.engine.start()
+
+    def close(self):
+        if self.stop is not None:
+            self.stop.set()
+        if self.engine is not None:
+            self.engine.join(timeout=2.0)
+            self.engine = None
+        if self.session is not None:
+            try:
+                close_connections(self.session, self.connections, self.originator_serial)
+            except OSError as error:
+                print(f"Forward Close: {error}")
+            self.session = None
+
+    def window(self):
+        """Absolute jitter samples of the window in ms, samples cleared"""
+        jitter = []
+        for connection in self.connections:
+            if not connection.open:
+                continue
+            jitter.extend(abs(value) * 1e3 for value in take_samples(connection.jitter))
+            take_samples(connection.intervals)
+            take_samples(connection.send_late)
+        return jitter
+
+    def totals(self):
+        lost = self.lost + sum(c.lost for c in self.connections)
+        timeouts = self.timeouts + sum(c.timeouts for c in self.connections)
+        return lost, timeouts
+
+    def reopen_if_timed_out(self):
+        """Also retries after a reopen that opened nothing"""
+        wanted = self.args.eo + self.args.io + self.args.lo
+        if not any(c.open and c.timed_out for c in self.connections) and \
+                (wanted == 0 or any(c.open for c in self.connections)):
+            return False
+        self.lost += sum(c.lost for c in self.connections)
+        self.timeouts += sum(c.timeouts for c in self.connections)
+        self.close()
+        try:
+            self.open()
+        except OSError as error:
+            print(f"Reopen failed: {error}")
+            self.connections = []
+        self.reopens += 1
+        return True
+
+
+def take_sample(start, telemetry, load, churn, pollers, web, previous):
+    now = time.time()
+    device = telemetry.sample()
+    jitter = load.window()
+    lost, timeouts = load.totals()
+    churn_cycles, churn_failures, _ = churn.counter.window() if churn else (0, 0, None)
+    explicit = [poller.counter.window() for poller in pollers]
+    explicit_p99 = [p99 for _, _, p99 in explicit if p99 is not None]
+    web_requests, web_errors, web_p99 = web.counter.window() if web else (0, 0, None)
+
+    reboots = previous['reboots'] if previous else 0
+    if previous and device['uptime_s'] is not None and previous['uptime_s'] is not None \
+            and device['uptime_s'] < previous['uptime_s']:
+        reboots += 1
+        print(f"Device restarted, uptime {device['uptime_s']} s")
+    stacks = device['stacks']
+    lowest_task = min(stacks, key=stacks.get) if stacks else None
+    return {
+        'time': time.strftime('%Y-%m-%dT%H:%M:%S', time.localtime(now)),
+        'elapsed_s': round(time.perf_counter() - start, 1),
+        'uptime_s': device['uptime_s'],
+        'heap_free': device['heap_free'],
+        'heap_min_free': device['heap_min_free'],
+        'largest_free_block': device['largest_free_block'],
+        'stacks': stacks,
+        'min_stack_free': stacks[lowest_task] if lowest_task else None,
+        'min_stack_task': lowest_task,
+        'loop_overruns': device['loop_overruns'],
+        'jitter_p50_ms': percentile(jitter, 0.5),
+        'jitter_p99_ms': percentile(jitter, 0.99),
+        'jitter_p999_ms': percentile(jitter, 0.999),
+        'jitter_max_ms': max(jitter) if jitter else None,
+        'lost': lost,
+        'timeouts': timeouts,
+        'reopens': load.reopens,
+        'churn_cycles': churn_cycles,
+        'churn_failures': churn_failures,
+        'explicit_requests': sum(requests for requests, _, _ in explicit),
+        'explicit_errors': sum(errors for _, errors, _ in explicit),
+        'explicit_p99_ms': max(explicit_p99) if explicit_p99 else None,
+        'web_requests': web_requests,
+        'web_errors': web_errors,
+        'web_p99_ms': web_p99,
+        'telemetry_errors': telemetry.errors,
+        'reboots': reboots,
+    }
+
+
+def format_value(value, digits=3):
+    if value is None:
+        return '-'
+    if isinstance(value, float):
+        return f"{value:.{digits}f}"
+    return str(value)
+
+
+def print_progress(sample):
+    print(f"{sample['time']} heap {format_value(sample['heap_free'])} "
+          f"min {format_value(sample['heap_min_free'])} "
+          f"block {format_value(sample['largest_free_block'])} "
+          f"stack {format_value(sample['min_stack_free'])} "
+          f"overruns {format_value(sample['loop_overruns'])} "
+          f"jitter p99 {format_value(sample['jitter_p99_ms'])} ms "
+          f"timeouts {sample['timeouts']} errors "
+          f"{sample['churn_failures'] + sample['explicit_errors'] + sample['web_errors']}")
+
+
+class Checks:
+    """Results of the qualification checks, in the order they ran"""
+
+    def __init__(self):
+        self.results = []
+
+    def add(self, name, verdict, detail):
+        self.results.append({'check': name, 'verdict': verdict, 'detail': detail})
+
+    def limit(self, name, value, maximum, unit=''):
+        verdict = 'PASS' if value <= maximum else 'FAIL'
+        self.add(name, verdict, f"{format_value(value)}{unit}, limit {format_value(maximum)}{unit}")
+
+    def verdict(self):
+        verdicts = {result['verdict'] for result in self.results}
+        if 'FAIL' in verdicts:
+            return 'FAIL'
+        if 'SKIP' in verdicts:
+            return 'INCOMPLETE'
+        return 'PASS'
+
+
+def series(samples, key):
+    return [(s['elapsed_s'], s[key]) for s in samples if s.get(key) is not None]
+
+
+def check_projection(checks, name, points, horizon_days, minimum):
+    """The value at the end of the horizon on its trend, against a floor"""
+    if len(points) < MINIMUM_TREND_SAMPLES:
+        checks.add(name, 'SKIP', f"{len(points)} samples after the warm-up")
+        return
+    slope = slope_per_day(points) or 0.0
+    last = points[-1][1]
+    projected = last + min(slope, 0.0) * horizon_days
+    verdict = 'PASS' if projected >= minimum else 'FAIL'
+    checks.add(name, verdict, f"now {last}, trend {slope:+.0f} bytes/day, "
+               f"{projected:.0f} after {horizon_days:g} days, floor {minimum}")
+
+
+def check_creep(checks, name, points, maximum_creep, unit):
+    """Median of the last quarter against the first quarter"""
+    if len(points) < MINIMUM_TREND_SAMPLES:
+        checks.add(name, 'SKIP', f"{len(points)} samples after the warm-up")
+        return
+    first, last = quarter_medians([value for _, value in points])
+    creep = last - first
+    verdict = 'PASS' if creep <= maximum_creep else 'FAIL'
+    checks.add(name, verdict, f"first quarter {first:.3f}{unit}, last quarter {last:.3f}{unit}, "
+               f"creep {creep:+.3f}{unit}, limit {maximum_creep:g}{unit}")
+
+
+def overrun_rates(samples):
+    """Loop overruns per hour between consecutive samples"""
+    rates = []
+    for before, after in zip(samples, samples[1:]):
+        if before['loop_overruns'] is None or after['loop_overruns'] is None:
+            continue
+        hours = (after['elapsed_s'] - before['elapsed_s']) / 3600.0
+        increase = after['loop_overruns'] - before['loop_overruns']
+        if hours > 0 and increase >= 0:  # a restart resets the counter
+            rates.append((after['elapsed_s'], increase / hours))
+    return rates
+
+
+def evaluate(samples, args):
+    checks = Checks()
+    if not samples:
+        checks.add('samples', 'SKIP', 'no sample was taken')
+        return checks
+    last = samples[-1]
+    settled = [s for s in samples if s['elapsed_s'] >= args.warmup]
+    before = [s for s in samples if s['elapsed_s'] < args.warmup]
+    baseline = before[-1] if before else samples[0]
+
+    checks.limit('device restarts', last['reboots'], 0)
+    checks.limit('connection timeouts', last['timeouts'], args.max_errors)
+    errors = {
+        'connection churn failures': last['churn_failures'],
+        'explicit errors': last['explicit_errors'],
+        'web errors': last['web_errors'],
+        'telemetry errors': last['telemetry_errors'],
+    }
+    for name, value in errors.items():
+        checks.limit(name, value, args.max_errors)
+
+    check_projection(checks, 'free heap trend', series(settled, 'heap_free'),
+                     args.horizon_days, args.min_free_heap)
+    if any(s['largest_free_block'] is not None for s in samples):
+        check_projection(checks, 'largest free block trend', series(settled, 'largest_free_block'),
+                         args.horizon_days, args.min_largest_block)
+    else:
+        checks.add('largest free block trend', 'SKIP', 'firmware without GET /api/system')
+
+    if last['heap_min_free'] is not None and baseline['heap_min_free'] is not None:
+        drop = baseline['heap_min_free'] - last['heap_min_free']
+        verdict = 'PASS' if drop <= args.heap_tolerance else 'FAIL'
+        checks.add('minimum free heap after warm-up', verdict,
+                   f"{baseline['heap_min_free']} -> {last['heap_min_free']}, drop {drop}, "
+                   f"limit {args.heap_tolerance}")
+    else:
+        checks.add('minimum free heap after warm-up', 'SKIP', 'not reported')
+
+    if last['stacks']:
+        for task, minimum_free in sorted(last['stacks'].items()):
+            earlier = baseline['stacks'].get(task)
+            drop = '' if earlier is None else f", {earlier - minimum_free} since the warm-up"
+            verdict = 'PASS' if minimum_free >= args.stack_margin else 'FAIL'
+            checks.add(f"stack {task}", verdict,
+                       f"{minimum_free} bytes free{drop}, margin {args.stack_margin}")
+    else:
+        checks.add('stacks', 'SKIP', 'firmware without GET /api/system')
+
+    rates = overrun_rates(settled)
+    if rates or any(s['loop_overruns'] is not None for s in samples):
+        check_creep(checks, 'loop overrun creep', rates, args.max_overrun_creep, '/h')
+    else:
+        checks.add('loop overrun creep', 'SKIP', 'firmware without the overload governor')
+
+    jitter = series(settled, 'jitter_p99_ms')
+    check_creep(checks, 'jitter p99 creep', jitter, args.max_jitter_creep, ' ms')
+    if jitter:
+        worst = max(value for _, value in jitter)
+        maximum = args.max_jitter_p99 if args.max_jitter_p99 is not None else args.rpi
+        checks.limit('worst jitter p99 of an interval', worst, maximum, ' ms')
+    return checks
+
+
+def print_report(checks, samples, duration):
+    print()
+    print(f"=== Soak test ({duration / 3600.0:.1f} h, {len(samples)} samples) ===")
+    width = max(len(result['check']) for result in checks.results)
+    for result in checks.results:
+        print(f"{result['verdict']:10} {result['check']:{width}}  {result['detail']}")
+    print()
+    print(f"Result: {checks.verdict()}")
+
+
+def write_csv_row(writer, sample):
+    writer.writerow({column: sample.get(column) for column in CSV_COLUMNS})
+
+
+def main():
+    parser = argparse.ArgumentParser(description='EtherNet/IP soak test with a pass/fail report')
+    parser.add_argument('--target', required=True, help='IP address of the adapter')
+    parser.add_argument('--duration', default='24h',
+                        help='test duration, s, m, h or d suffix (default: 24h)')
+    parser.add_argument('--warmup', default=None,
+                        help='start of the trends, s, m, h or d suffix (default: a tenth of the duration)')
+    parser.add_argument('--sample-interval', type=float, default=60.0,
+                        help='seconds between telemetry samples (default: 60)')
+    # Steady connections, see eip_load_generator.py
+    parser.add_argument('--eo', type=int, default=1, help='exclusive owner connections (default: 1)')
+    parser.add_argument('--io', type=int, default=0, help='input only connections (default: 0)')
+    parser.add_argument('--lo', type=int, default=0, help='listen only connections (default: 0)')
+    parser.add_argument('--rpi', type=float, default=10.0, help='RPI in ms (default: 10)')
+    parser.add_argument('--t2o-rpi', type=float, default=None, help='T->O RPI in ms (default: same as --rpi)')
+    parser.add_argument('--timeout-multiplier', type=int, default=0, choices=range(8),
+                        help='connection timeout multiplier index (default: 0)')
+    parser.add_argument('--t2o-p2p', action='store_true', help='request point to point instead of multicast T->O')
+    parser.add_argument('--o2t-size', type=int, default=2, help='O->T data bytes of exclusive owners (default: 2)')
+    parser.add_argument('--t2o-size', type=int, default=10, help='T->O data bytes (default: 10)')
+    parser.add_argument('--o2t-run-idle', action='store_true', help='O->T data carries a 32 bit run/idle header')
+    parser.add_argument('--t2o-run-idle', action='store_true', help='T->O data carries a 32 bit run/idle header')
+    parser.add_argument('--eo-path', default='20 04 24 97 2C 96 2C 64', help='exclusive owner connection path')
+    parser.add_argument('--io-path', default='20 04 24 97 2C 98 2C 64',
+                        help='input only connection path, also used by the churn')
+    parser.add_argument('--lo-path', default='20 04 24 97 2C 99 2C 64', help='listen only connection path')
+    # Background load
+    parser.add_argument('--churn-interval', type=float, default=5.0,
+                        help='seconds between churned connections, 0 = no churn (default: 5)')
+    parser.add_argument('--churn-hold', type=float, default=1.0,
+                        help='seconds a churned connection stays open (default: 1)')
+    parser.add_argument('--explicit-sessions', type=int, default=2,
+                        help='TCP sessions polling GetAttributeSingle (default: 2)')
+    parser.add_argument('--explicit-rate', type=float, default=10.0,
+                        help='requests per second per session (default: 10)')
+    parser.add_argument('--explicit-path', default='20 01 24 01 30 07',
+                        help='attribute polled (default: Identity product name)')
+    parser.add_argument('--web-port', type=int, default=80, help='web UI port (default: 80)')
+    parser.add_argument('--web-rate', type=float, default=2.0,
+                        help='web requests per second, 0 = none (default: 2)')
+    parser.add_argument('--web-pages', default='/,/api/status,/api/io,/api/diagnostics/connections',
+                        help='comma separated pages fetched in turn')
+    # Qualification
+    parser.add_argument('--horizon-days', type=float, default=90.0,
+                        help='uptime the heap trends are projected to (default: 90)')
+    parser.add_argument('--min-free-heap', type=int, default=32768,
+                        help='free heap bytes the projection must keep (default: 32768)')
+    parser.add_argument('--min-largest-block', type=int, default=16384,
+                        help='largest free block bytes the projection must keep (default: 16384)')
+    parser.add_argument('--heap-tolerance', type=int, default=2048,
+                        help='bytes the minimum free heap may drop after the warm-up (default: 2048)')
+    parser.add_argument('--stack-margin', type=int, default=512,
+                        help='stack bytes every task must keep free (default: 512)')
+    parser.add_argument('--max-overrun-creep', type=float, default=10.0,
+                        help='loop overruns per hour the last quarter may add to the first (default: 10)')
+    parser.add_argument('--max-jitter-creep', type=float, default=0.5,
+                        help='ms the jitter p99 of the last quarter may add to the first (default: 0.5)')
+    parser.add_argument('--max-jitter-p99', type=float, default=None,
+                        help='ms no interval p99 jitter may exceed (default: the RPI)')
+    parser.add_argument('--max-errors', type=int, default=0,
+                        help='timeouts and errors allowed per kind (default: 0)')
+    parser.add_argument('--csv', help='append every sample to this CSV file')
+    parser.add_argument('--json', help='write the samples and the report to this JSON file')
+    args = parser.parse_args()
+
+    duration = parse_duration(args.duration)
+    args.warmup = parse_duration(args.warmup) if args.warmup else duration / 10.0
+
+    originator_serial = random.randint(1, 0xFFFFFFFF)
+    load = SteadyLoad(args, originator_serial)
+    try:
+        load.open()
+    except OSError as error:
+        print(f"Cannot reach {args.target}: {error}")
+        return 2
+
+    stop = threading.Event()
+    churn = ConnectionChurn(args, originator_serial, stop) if args.churn_interval > 0 else None
+    pollers = [ExplicitPoller(args.target, args.explicit_rate, parse_path(args.explicit_path), stop)
+               for _ in range(args.explicit_sessions if args.explicit_rate > 0 else 0)]
+    web = None
+    if args.web_rate > 0:
+        web = WebTraffic(args.target, args.web_port, args.web_rate,
+                         [page for page in args.web_pages.split(',') if page], stop)
+    workers = ([churn] if churn else []) + pollers + ([web] if web else [])
+    for worker in workers:
+        worker.start()
+
+    telemetry = Telemetry(args.target, args.web_port)
+    csv_file = None
+    csv_writer = None
+    if args.csv:
+        new_file = not os.path.exists(args.csv) or os.path.getsize(args.csv) == 0
+        csv_file = open(args.csv, 'a', newline='')
+        csv_writer = csv.DictWriter(csv_file, fieldnames=CSV_COLUMNS)
+        if new_file:
+            csv_writer.writeheader()
+
+    samples = []
+    start = time.perf_counter()
+    print(f"Running for {duration / 3600.0:.1f} h, warm-up {args.warmup / 3600.0:.1f} h, "
+          f"a sample every {args.sample_interval:g} s, Ctrl-C to stop early")
+    try:
+        next_sample = start + args.sample_interval
+        while True:
+            remaining = start + duration - time.perf_counter()
+            if remaining <= 0:
+                break
+            time.sleep(max(0.0, min(next_sample - time.perf_counter(), remaining)))
+            if time.perf_counter() < next_sample:
+                continue
+            next_sample += args.sample_interval
+            if load.reopen_if_timed_out():
+                print("Steady connections timed out or were not open, reopened them")
+            sample = take_sample(start, telemetry, load, churn, pollers, web,
+                                 samples[-1] if samples else None)
+            samples.append(sample)
+            print_progress(sample)
+            if csv_writer:
+                write_csv_row(csv_writer, sample)
+                csv_file.flush()
+    except KeyboardInterrupt:
+        print("Stopped early")
+    elapsed = time.perf_counter() - start
+
+    stop.set()
+    for worker in workers:
+        worker.join(timeout=5.0)
+    load.close()
+    if csv_file:
+        csv_file.close()
+
+    checks = evaluate(samples, args)
+    print_report(checks, samples, elapsed)
+    last_errors = {
+        'churn': churn.counter.last_error if churn else None,
+        'explicit': next((p.counter.last_error for p in pollers if p.counter.last_error), None),
+        'web': web.counter.last_error if web else None,
+        'telemetry': telemetry.last_error,
+    }
+    for kind, error in last_errors.items():
+        if error:
+            print(f"Last {kind} error: {error}")
+
+    if args.json:
+        result = {
+            'target': args.target,
+            'duration_s': elapsed,
+            'warmup_s': args.warmup,
+            'rpi_ms': args.rpi,
+            'verdict': checks.verdict(),
+            'checks': checks.results,
+            'last_errors': last_errors,
+            'samples': samples,
+        }
+        with open(args.json, 'w') as output:
+            json.dump(result, output, indent=2)
+        print(f"\nResults written to {args.json}")
+    return 0 if checks.verdict() == 'PASS' else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,784 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+EtherNet/IP Fleet Health Poller
+
+This script watches the health of many EtherNet/IP adapters from one host:
+1. Discovers the boards with ListIdentity broadcasts, with the mDNS
+   advertisement of _ethernet-ip._tcp, and from an explicit target list
+2. Keeps one TCP session per board and polls it on a fixed interval,
+   each board at its own offset within the interval
+3. Reads all attributes of a poll with Multiple Service Packet requests,
+   one for the connection list and the counters and one for the statistics
+   of the open I/O connections
+4. Appends every sample to a CSV time series and serves the latest ones in
+   the Prometheus exposition format, over HTTP and/or as a text file
+
+Collected per board: Identity status, Ethernet Link interface and media
+counters, the jitter and latency histograms of the Connection Diagnostics
+object (0x64), the stacks and heap of the Task Telemetry object (0x68) and
+the relay closings of the Relay Counter object (0x6A). Objects a firmware
+does not have are asked once and then left out for that board.
+
+The load on a board does not grow with the fleet: each board gets two
+requests per interval on its own session. Polls are spread over the
+interval and at most --concurrency are in flight, so one interval still
+covers the fleet as long as boards x poll time / concurrency stays below
+the interval; the poller reports when it does not.
+
+Usage:
+    python fleet_poller.py --broadcast 172.16.82.255 --interval 10 --csv fleet.csv --prometheus-port 9468
+    python fleet_poller.py --targets 172.16.82.100,172.16.82.101 --interval 5 --prometheus-file /var/lib/node_exporter/eip.prom
+    python fleet_poller.py --targets-file boards.txt --mdns --duration 3600 --csv fleet.csv
+
+Requirements:
+    Python 3.8 or later, no additional packages
+
+Author: Adam G. Sweeney <agsweeney@gmail.com>
+License: MIT
+"""
+
+import argparse
+import asyncio
+import csv
+import ipaddress
+import os
+import socket
+import struct
+import sys
+import time
+import zlib
+
+# Fix Windows console encoding
+if sys.platform == 'win32':
+    import codecs
+    sys.stdout = codecs.getwriter('utf-8')(sys.stdout.buffer, 'strict')
+    sys.stderr = codecs.getwriter('utf-8')(sys.stderr.buffer, 'strict')
+
+ENIP_PORT = 44818
+MDNS_ADDRESS = '224.0.0.251'
+MDNS_PORT = 5353
+MDNS_SERVICE = '_ethernet-ip._tcp.local'
+
+CMD_LIST_IDENTITY = 0x0063
+CMD_REGISTER_SESSION = 0x0065
+CMD_UNREGISTER_SESSION = 0x0066
+CMD_SEND_RR_DATA = 0x006F
+
+ITEM_NULL_ADDRESS = 0x0000
+ITEM_CIP_IDENTITY = 0x000C
+ITEM_UNCONNECTED_DATA = 0x00B2
+
+SERVICE_GET_ATTRIBUTE_SINGLE = 0x0E
+SERVICE_MULTIPLE_SERVICE_PACKET = 0x0A
+
+MESSAGE_ROUTER_PATH = bytes([0x20, 0x02, 0x24, 0x01])
+
+STATUS_SUCCESS = 0x00
+STATUS_EMBEDDED_SERVICE_ERROR = 0x1E
+STATUS_REPLY_DATA_TOO_LARGE = 0x11
+# The object, instance, attribute or service is not there: skip it from now on
+STATUS_NOT_PRESENT = (0x05, 0x08, 0x14, 0x16)
+
+CLASS_IDENTITY = 0x01
+CLASS_ETHERNET_LINK = 0xF6
+CLASS_CONNECTION_DIAGNOSTICS = 0x64
+CLASS_TASK_TELEMETRY = 0x68
+CLASS_RELAY_COUNTER = 0x6A
+
+# Upper limits of the histogram buckets, cipconnectiondiagnostics.c
+INTERVAL_LIMITS_PERCENT = (1, 2, 5, 10, 25, 50, 100)
+LATENCY_LIMITS_US = (50, 100, 250, 500, 1000, 2500, 5000)
+HISTOGRAM_BUCKETS = 8
+
+INTERFACE_COUNTERS = ('in_octets', 'in_ucast', 'in_nucast', 'in_discards', 'in_errors',
+                      'in_unknown_protos', 'out_octets', 'out_ucast', 'out_nucast',
+                      'out_discards', 'out_errors')
+MEDIA_COUNTERS = ('align_errors', 'fcs_errors', 'single_collisions', 'multiple_collisions',
+                  'sqe_test_errors', 'deferred_transmissions', 'late_collisions',
+                  'excessive_collisions', 'mac_tx_errors', 'carrier_sense_errors',
+                  'frame_too_long', 'mac_rx_errors')
+# Order of the Task Telemetry stacks, task_telemetry.h
+TASK_NAMES = ('opener', 'httpd', 'tcpip', 'io_scan', 'nv_config', 'producer')
+
+# Bytes of every embedded reply besides its data, and of its offset
+EMBEDDED_REPLY_OVERHEAD = 4 + 2
+
+
+def encapsulation(command, data=b'', session=0, context=b'\0' * 8):
+    return struct.pack('<HHII8sI', command, len(data), session, 0, context, 0) + data
+
+
+def parse_cpf(data):
+    """Returns a list of (type_id, item data)"""
+    items = []
+    count, = struct.unpack_from('<H', data, 0)
+    offset = 2
+    for _ in range(count):
+        if offset + 4 > len(data):
+            break
+        type_id, length = struct.unpack_from('<HH', data, offset)
+        items.append((type_id, data[offset + 4:offset + 4 + length]))
+        offset += 4 + length
+    return items
+
+
+def attribute_path(class_id, instance, attribute):
+    """8 bit logical segments, all objects read here have small numbers"""
+    return bytes([0x20, class_id, 0x24, instance, 0x30, attribute])
+
+
+def parse_identity_item(item):
+    """CIP Identity item of a ListIdentity reply -> dict, None if malformed"""
+    if len(item) < 33:
+        return None
+    vendor, device_type, product, major, minor, status, serial = \
+        struct.unpack_from('<HHHBBHI', item, 18)
+    name_length = item[32]
+    name = item[33:33 + name_length].decode('ascii', 'replace')
+    return {
+        'address': socket.inet_ntoa(item[6:10]),
+        'vendor': vendor,
+        'device_type': device_type,
+        'product': product,
+        'revision': f"{major}.{minor}",
+        'status': status,
+        'serial': f"{serial:08X}",
+        'name': name,
+    }
+
+
+class ListIdentityProtocol(asyncio.DatagramProtocol):
+    def __init__(self, found):
+        self.found = found
+
+    def datagram_received(self, data, address):
+        if len(data) < 24 or struct.unpack_from('<H', data, 0)[0] != CMD_LIST_IDENTITY:
+            return
+        for type_id, item in parse_cpf(data[24:]):
+            if type_id == ITEM_CIP_IDENTITY:
+                identity = parse_identity_item(item)
+                if identity is not None:
+                    # The socket address item may still hold 0.0.0.0
+                    identity['address'] = address[0]
+                    self.found[address[0]] = identity
+
+
+async def discover_list_identity(broadcasts, wait):
+    """ListIdentity to each broadcast address, replies within wait seconds"""
+    loop = asyncio.get_running_loop()
+    found = {}
+    transport, _ = await loop.create_datagram_endpoint(
+        lambda: ListIdentityProtocol(found), local_addr=('0.0.0.0', 0), allow_broadcast=True)
+    try:
+        for broadcast in broadcasts:
+            transport.sendto(encapsulation(CMD_LIST_IDENTITY), (broadcast, ENIP_PORT))
+        # Adapters delay broadcast replies by up to their maximum response delay
+        await asyncio.sleep(wait)
+    finally:
+        transport.close()
+    return found
+
+
+def dns_name(labels):
+    return b''.join(bytes([len(label)]) + label.encode() for label in labels.split('.')) + b'\0'
+
+
+def read_dns_name(packet, offset):
+    """(name, offset after it), following compression pointers"""
+    labels = []
+    end = None
+    for _ in range(64):
+        length = packet[offset]
+        if length & 0xC0 == 0xC0:
+            if end is None:
+                end = offset + 2
+            offset = ((length & 0x3F) << 8) | packet[offset + 1]
+            continue
+        if length == 0:
+            return '.'.join(labels), (end if end is not None else offset + 1)
+        labels.append(packet[offset + 1:offset + 1 + length].decode('ascii', 'replace'))
+        offset += 1 + length
+    raise ValueError("DNS name loop")
+
+
+def mdns_answers_service(packet):
+    """True if an mDNS response has a PTR record of the EtherNet/IP service"""
+    try:
+        _, flags, questions, answers, authorities, additionals = struct.unpack_from('>6H', packet, 0)
+        if not flags & 0x8000:
+            return False
+        offset = 12
+        for _ in range(questions):
+            _, offset = read_dns_name(packet, offset)
+            offset += 4
+        for _ in range(answers + authorities + additionals):
+            name, offset = read_dns_name(packet, offset)
+            record_type, _, _, length = struct.unpack_from('>HHIH', packet, offset)
+            offset += 10 + length
+            if record_type == 12 and name.lower() == MDNS_SERVICE:
+                return True
+    except (IndexError, ValueError, struct.error):
+        pass
+    return False
+
+
+class MdnsProtocol(asyncio.DatagramProtocol):
+    def __init__(self, found):
+        self.found = found
+
+    def datagram_received(self, data, address):
+        # Responders answer from their own address, that is all we need
+        if mdns_answers_service(data):
+            self.found.add(address[0])
+
+
+async def discover_mdns(wait):
+    """One-shot mDNS query for _ethernet-ip._tcp, addresses of the answers"""
+    loop = asyncio.get_running_loop()
+    found = set()
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 255)
+    sock.bind(('0.0.0.0', 0))
+    transport, _ = await loop.create_datagram_endpoint(lambda: MdnsProtocol(found), sock=sock)
+    try:
+        # Query with the unicast response bit, answered to our port
+        query = struct.pack('>6H', 0, 0, 1, 0, 0, 0) + dns_name(MDNS_SERVICE) + struct.pack('>HH', 12, 0x8001)
+        transport.sendto(query, (MDNS_ADDRESS, MDNS_PORT))
+        await asyncio.sleep(wait)
+    finally:
+        transport.close()
+    return found
+
+
+class CipError(Exception):
+    def __init__(self, general_status):
+        self.general_status = general_status
+        super().__init__(f"general status 0x{general_status:02X}")
+
+
+class Request:
+    """One embedded GetAttributeSingle of a poll"""
+
+    def __init__(self, key, class_id, instance, attribute, reply_size):
+        self.key = key
+        self.object = (class_id, attribute)
+        self.cip = bytes([SERVICE_GET_ATTRIBUTE_SINGLE, 3]) + attribute_path(class_id, instance, attribute)
+        self.reply_size = reply_size
+
+
+def batches(requests, max_reply):
+    """Group requests into Multiple Service Packets whose replies fit max_reply"""
+    batch = []
+    size = 2
+    for request in requests:
+        cost = EMBEDDED_REPLY_OVERHEAD + request.reply_size
+        if batch and size + cost > max_reply:
+            yield batch
+            batch = []
+            size = 2
+        batch.append(request)
+        size += cost
+    if batch:
+        yield batch
+
+
+def multiple_service_packet(requests):
+    offsets = []
+    offset = 2 + 2 * len(requests)
+    for request in requests:
+        offsets.append(offset)
+        offset += len(request.cip)
+    data = struct.pack(f'<H{len(requests)}H', len(requests), *offsets)
+    data += b''.join(request.cip for request in requests)
+    return bytes([SERVICE_MULTIPLE_SERVICE_PACKET, len(MESSAGE_ROUTER_PATH) // 2]) + MESSAGE_ROUTER_PATH + data
+
+
+def parse_embedded_replies(reply, count):
+    """Reply data of a Multiple Service Packet -> list of (general status, data)"""
+    number, = struct.unpack_from('<H', reply, 0)
+    if number != count:
+        raise ConnectionError(f"{number} embedded replies for {count} requests")
+    offsets = struct.unpack_from(f'<{number}H', reply, 2) + (len(reply),)
+    results = []
+    for start, end in zip(offsets, offsets[1:]):
+        embedded = reply[start:end]
+        general_status = embedded[2]
+        additional_words = embedded[3]
+        results.append((general_status, embedded[4 + 2 * additional_words:]))
+    return results
+
+
+class Session:
+    """One TCP session for unconnected explicit messages, asyncio streams"""
+
+    def __init__(self, reader, writer, handle):
+        self.reader = reader
+        self.writer = writer
+        self.handle = handle
+
+    @classmethod
+    async def open(cls, address, timeout):
+        reader, writer = await asyncio.wait_for(asyncio.open_connection(address, ENIP_PORT), timeout)
+        writer.get_extra_info('socket').setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        session = cls(reader, writer, 0)
+        try:
+            reply = await session.transact(
+                encapsulation(CMD_REGISTER_SESSION, struct.pack('<HH', 1, 0)), timeout)
+        except BaseException:
+            writer.close()
+            raise
+        command, _, handle, status = struct.unpack_from('<HHII', reply, 0)
+        if command != CMD_REGISTER_SESSION or status != 0:
+            writer.close()
+            raise ConnectionError(f"RegisterSession failed, status 0x{status:X}")
+        session.handle = handle
+        return session
+
+    async def transact(self, request, timeout):
+        self.writer.write(request)
+        await self.writer.drain()
+        header = await asyncio.wait_for(self.reader.readexactly(24), timeout)
+        length, = struct.unpack_from('<H', header, 2)
+        return header + await asyncio.wait_for(self.reader.readexactly(length), timeout)
+
+    async def request(self, cip, timeout):
+        """Send an unconnected CIP request -> (general status, reply data)"""
+        cpf = struct.pack('<IHH', 0, 0, 2)
+        cpf += struct.pack('<HH', ITEM_NULL_ADDRESS, 0)
+        cpf += struct.pack('<HH', ITEM_UNCONNECTED_DATA, len(cip)) + cip
+        reply = await self.transact(encapsulation(CMD_SEND_RR_DATA, cpf, self.handle), timeout)
+        status, = struct.unpack_from('<I', reply, 8)
+        if status != 0:
+            raise ConnectionError(f"SendRRData failed, encapsulation status 0x{status:X}")
+        for type_id, item in parse_cpf(reply[24 + 6:]):
+            if type_id == ITEM_UNCONNECTED_DATA:
+                return item[2], item[4 + 2 * item[3]:]
+        raise ConnectionError("reply without unconnected data item")
+
+    async def get_attributes(self, requests, timeout):
+        """One Multiple Service Packet -> list of (general status, data)"""
+        general_status, reply = await self.request(multiple_service_packet(requests), timeout)
+        if general_status not in (STATUS_SUCCESS, STATUS_EMBEDDED_SERVICE_ERROR):
+            raise CipError(general_status)
+        return parse_embedded_replies(reply, len(requests))
+
+    def close(self):
+        try:
+            self.writer.write(encapsulation(CMD_UNREGISTER_SESSION, b'', self.handle))
+        except (OSError, RuntimeError):
+            pass
+        self.writer.close()
+
+
+def udints(data, count):
+    return struct.unpack_from(f'<{count}I', data, 0)
+
+
+class Sample:
+    """Metrics of one poll: name -> list of (labels, value)"""
+
+    def __init__(self):
+        self.metrics = {}
+
+    def add(self, name, value, **labels):
+        self.metrics.setdefault(name, []).append((labels, value))
+
+
+# name -> (Prometheus type, help text)
+METRICS = {
+    'eip_up': ('gauge', "1 if the last poll of the board succeeded"),
+    'eip_poll_seconds': ('gauge', "Duration of the last poll"),
+    'eip_poll_requests': ('gauge', "Multiple Service Packet requests of the last poll"),
+    'eip_device_info': ('gauge', "Identity from ListIdentity, always 1"),
+    'eip_identity_status': ('gauge', "Identity object status word"),
+    'eip_interface_counter_total': ('counter', "Ethernet Link interface counters"),
+    'eip_media_counter_total': ('counter', "Ethernet Link media counters"),
+    'eip_connection_packets_total': ('counter', "Packets of an I/O connection"),
+    'eip_connection_late_packets_total': ('counter', "Intervals more than 25 % above the RPI"),
+    'eip_connection_missed_packets_total': ('counter', "Packets missing from intervals of twice the RPI or more"),
+    'eip_connection_requested_interval_us': ('gauge', "RPI of the direction"),
+    'eip_connection_min_interval_us': ('gauge', "Shortest packet interval seen"),
+    'eip_connection_max_interval_us': ('gauge', "Longest packet interval seen"),
+    'eip_connection_interval_deviation_total': ('counter',
+                                                "Intervals deviating from the RPI by at most le percent"),
+    'eip_connection_applied_samples_total': ('counter', "Consumed packets handed to the application"),
+    'eip_connection_applied_max_latency_us': ('gauge', "Longest consumed to applied latency"),
+    'eip_connection_applied_latency_total': ('counter', "Consumed to applied latencies of at most le us"),
+    'eip_task_stack_size_bytes': ('gauge', "Configured stack of a watched task"),
+    'eip_task_stack_min_free_bytes': ('gauge', "Lowest free stack seen"),
+    'eip_heap_free_bytes': ('gauge', "Free heap"),
+    'eip_heap_min_free_bytes': ('gauge', "Lowest free heap since boot"),
+    'eip_heap_largest_free_block_bytes': ('gauge', "Largest free heap block"),
+    'eip_heap_fragmentation_percent': ('gauge', "Free heap not in the largest block"),
+    'eip_relay_closings_total': ('counter', "Closings of a relay"),
+}
+
+
+def add_histogram(sample, name, limits, counts, **labels):
+    """Device buckets are per class, Prometheus counts up to each limit"""
+    total = 0
+    for limit, count in zip(limits + ('+Inf',), counts):
+        total += count
+        sample.add(name, total, le=str(limit), **labels)
+
+
+class Device:
+    """Poll state of one board"""
+
+    def __init__(self, address, identity=None):
+        self.address = address
+        self.identity = identity
+        self.session = None
+        self.absent = set()  # (class, attribute) the board does not have
+        self.single = set()  # request keys whose reply needs a packet of its own
+        self.diagnostics_instances = None
+        self.task_count = None
+        # Own offset within the interval, the same on every run
+        self.phase = zlib.crc32(address.encode()) / 2 ** 32
+        self.sample = None
+        self.failures = 0
+        self.error = None
+
+    async def read(self, requests, args):
+        """Values of the requests present on the board, key -> data"""
+        wanted = [r for r in requests if r.object not in self.absent]
+        grouped = [[r] for r in wanted if r.key in self.single]
+        grouped += list(batches([r for r in wanted if r.key not in self.single], args.max_reply))
+        values = {}
+        rounds = 0
+        while grouped:
+            batch = grouped.pop(0)
+            results = await self.session.get_attributes(batch, args.timeout)
+            rounds += 1
+            for request, (general_status, data) in zip(batch, results):
+                if general_status == STATUS_SUCCESS:
+                    values[request.key] = data
+                elif general_status in STATUS_NOT_PRESENT:
+                    self.absent.add(request.object)
+                elif general_status == STATUS_REPLY_DATA_TOO_LARGE and len(batch) > 1:
+                    self.single.add(request.key)
+                    grouped.append([request])
+        return values, rounds
+
+    async def poll(self, args):
+        if self.session is None:
+            self.session = await Session.open(self.address, args.timeout)
+        sample = Sample()
+        start = time.perf_counter()
+
+        if self.diagnostics_instances is None:
+            # Class attributes: highest instance, number of watched tasks
+            values, _ = await self.read([
+                Request('diagnostics_instances', CLASS_CONNECTION_DIAGNOSTICS, 0, 2, 2),
+                Request('task_count', CLASS_TASK_TELEMETRY, 1, 1, 2),
+            ], args)
+            self.diagnostics_instances = struct.unpack('<H', values['diagnostics_instances'][:2])[0] \
+                if 'diagnostics_instances' in values else 0
+            self.task_count = struct.unpack('<H', values['task_count'][:2])[0] \
+                if 'task_count' in values else 0
+
+        requests = [
+            Request('status', CLASS_IDENTITY, 1, 5, 2),
+            Request('interface', CLASS_ETHERNET_LINK, 1, 4, 4 * len(INTERFACE_COUNTERS)),
+            Request('media', CLASS_ETHERNET_LINK, 1, 5, 4 * len(MEDIA_COUNTERS)),
+            Request('stacks', CLASS_TASK_TELEMETRY, 1, 2, 12 * self.task_count),
+            Request('heap', CLASS_TASK_TELEMETRY, 1, 3, 16),
+            Request('relays', CLASS_RELAY_COUNTER, 1, 2, 64),
+        ]
+        requests += [Request(('connection', i), CLASS_CONNECTION_DIAGNOSTICS, i, 1, 4)
+                     for i in range(1, self.diagnostics_instances + 1)]
+        values, rounds = await self.read(requests, args)
+
+        # Statistics only of the slots holding a connection
+        open_slots = [i for i in range(1, self.diagnostics_instances + 1)
+                      if ('connection', i) in values and udints(values[('connection', i)], 1)[0] != 0]
+        statistics = []
+        for i in open_slots:
+            statistics += [Request(('produced', i), CLASS_CONNECTION_DIAGNOSTICS, i, 2, 56),
+                           Request(('consumed', i), CLASS_CONNECTION_DIAGNOSTICS, i, 3, 56),
+                           Request(('applied', i), CLASS_CONNECTION_DIAGNOSTICS, i, 4, 40)]
+        if statistics:
+            more, more_rounds = await self.read(statistics, args)
+            values.update(more)
+            rounds += more_rounds
+
+        if 'status' in values:
+            sample.add('eip_identity_status', struct.unpack('<H', values['status'][:2])[0])
+        for key, name, counters in (('interface', 'eip_interface_counter_total', INTERFACE_COUNTERS),
+                                    ('media', 'eip_media_counter_total', MEDIA_COUNTERS)):
+            if key in values and len(values[key]) >= 4 * len(counters):
+                for counter, value in zip(counters, udints(values[key], len(counters))):
+                    sample.add(name, value, counter=counter)
+        if 'stacks' in values and len(values['stacks']) >= 12 * self.task_count:
+            words = udints(values['stacks'], 3 * self.task_count)
+            for task in range(self.task_count):
+                name = TASK_NAMES[task] if task < len(TASK_NAMES) else f"task{task}"
+                if words[3 * task] == 0:
+                    continue  # not registered on this board
+                sample.add('eip_task_stack_size_bytes', words[3 * task], task=name)
+                sample.add('eip_task_stack_min_free_bytes', words[3 * task + 1], task=name)
+        if 'heap' in values and len(values['heap']) >= 16:
+            free, minimum, largest, fragmentation = udints(values['heap'], 4)
+            sample.add('eip_heap_free_bytes', free)
+            sample.add('eip_heap_min_free_bytes', minimum)
+            sample.add('eip_heap_largest_free_block_bytes', largest)
+            sample.add('eip_heap_fragmentation_percent', fragmentation)
+        if 'relays' in values and len(values['relays']) >= 64:
+            for relay, count in enumerate(udints(values['relays'], 16)):
+                sample.add('eip_relay_closings_total', count, relay=f"Y{relay + 1:02d}")
+        for i in open_slots:
+            connection_id = f"{udints(values[('connection', i)], 1)[0]:08X}"
+            for direction in ('produced', 'consumed'):
+                data = values.get((direction, i))
+                if data is None or len(data) < 56:
+                    continue
+                words = udints(data, 6 + HISTOGRAM_BUCKETS)
+                labels = {'instance': str(i), 'connection_id': connection_id, 'direction': direction}
+                sample.add('eip_connection_requested_interval_us', words[0], **labels)
+                sample.add('eip_connection_packets_total', words[1], **labels)
+                sample.add('eip_connection_late_packets_total', words[2], **labels)
+                sample.add('eip_connection_missed_packets_total', words[3], **labels)
+                sample.add('eip_connection_min_interval_us', words[4], **labels)
+                sample.add('eip_connection_max_interval_us', words[5], **labels)
+                add_histogram(sample, 'eip_connection_interval_deviation_total',
+                              INTERVAL_LIMITS_PERCENT, words[6:], **labels)
+            data = values.get(('applied', i))
+            if data is not None and len(data) >= 40:
+                words = udints(data, 2 + HISTOGRAM_BUCKETS)
+                labels = {'instance': str(i), 'connection_id': connection_id}
+                sample.add('eip_connection_applied_samples_total', words[0], **labels)
+                sample.add('eip_connection_applied_max_latency_us', words[1], **labels)
+                add_histogram(sample, 'eip_connection_applied_latency_total',
+                              LATENCY_LIMITS_US, words[2:], **labels)
+
+        sample.add('eip_poll_seconds', round(time.perf_counter() - start, 6))
+        sample.add('eip_poll_requests', rounds)
+        return sample
+
+    def drop_session(self):
+        if self.session is not None:
+            self.session.close()
+            self.session = None
+
+
+def escape_label(value):
+    return str(value).replace('\\', '\\\\').replace('"', '\\"').replace('\n', '\\n')
+
+
+def format_labels(labels):
+    if not labels:
+        return ''
+    return '{' + ','.join(f'{key}="{escape_label(value)}"' for key, value in labels.items()) + '}'
+
+
+def prometheus_text(devices):
+    """Exposition format of the latest sample of every board"""
+    series = {}
+    for device in devices:
+        base = {'device': device.address}
+        series.setdefault('eip_up', []).append((base, 1 if device.error is None else 0))
+        if device.identity:
+            info = dict(base, name=device.identity['name'], serial=device.identity['serial'],
+                        product=device.identity['product'], revision=device.identity['revision'])
+            series.setdefault('eip_device_info', []).append((info, 1))
+        if device.sample is None:
+            continue
+        for name, values in device.sample.metrics.items():
+            series.setdefault(name, []).extend((dict(base, **labels), value) for labels, value in values)
+    lines = []
+    for name, values in series.items():
+        metric_type, text = METRICS[name]
+        lines.append(f"# HELP {name} {text}")
+        lines.append(f"# TYPE {name} {metric_type}")
+        lines.extend(f"{name}{format_labels(labels)} {value}" for labels, value in values)
+    return '\n'.join(lines) + '\n'
+
+
+class Poller:
+    def __init__(self, args):
+        self.args = args
+        self.devices = {}
+        self.semaphore = asyncio.Semaphore(args.concurrency)
+        self.csv_file = None
+        self.csv_writer = None
+        self.cycle_start = time.time()
+        self.late_polls = 0
+
+    def add_devices(self, found):
+        for address, identity in found.items():
+            device = self.devices.get(address)
+            if device is None:
+                self.devices[address] = Device(address, identity)
+                print(f"Found {address} {identity['name'] if identity else ''}".rstrip())
+            elif identity is not None:
+                device.identity = identity
+
+    async def discover(self):
+        found = {}
+        for address in self.args.target_list:
+            found[address] = None
+        if self.args.broadcast:
+            found.update(await discover_list_identity(self.args.broadcast, self.args.discovery_wait))
+        if self.args.mdns:
+            try:
+                for address in await discover_mdns(self.args.discovery_wait):
+                    found.setdefault(address, None)
+            except OSError as error:
+                print(f"mDNS discovery not available: {error}")
+        self.add_devices(found)
+
+    def write_csv(self, timestamp, device):
+        if self.csv_writer is None:
+            return
+        for name, values in device.sample.metrics.items():
+            for labels, value in values:
+                label_text = ';'.join(f"{key}={value}" for key, value in labels.items())
+                self.csv_writer.writerow([f"{timestamp:.3f}", device.address, name, label_text, value])
+
+    async def poll_device(self, device, cycle):
+        # Each board at its own offset, so the fleet's polls are spread evenly
+        due = self.cycle_start + (cycle + device.phase) * self.args.interval
+        await asyncio.sleep(max(0.0, due - time.time()))
+        async with self.semaphore:
+            if time.time() - due > self.args.interval:
+                self.late_polls += 1
+            timestamp = time.time()
+            try:
+                device.sample = await device.poll(self.args)
+                device.error = None
+                device.failures = 0
+                self.write_csv(timestamp, device)
+            except (OSError, asyncio.TimeoutError, asyncio.IncompleteReadError,
+                    ConnectionError, CipError, struct.error, IndexError) as error:
+                device.drop_session()
+                device.sample = None
+                device.failures += 1
+                if device.error is None:
+                    print(f"{device.address}: {error or type(error).__name__}")
+                device.error = error or type(error).__name__
+
+    async def run(self):
+        if self.args.csv:
+            new_file = not os.path.exists(self.args.csv)
+            self.csv_file = open(self.args.csv, 'a', newline='')
+            self.csv_writer = csv.writer(self.csv_file)
+            if new_file:
+                self.csv_writer.writerow(['time', 'device', 'metric', 'labels', 'value'])
+        server = None
+        if self.args.prometheus_port:
+            server = await asyncio.start_server(self.serve_metrics, self.args.listen,
+                                                self.args.prometheus_port)
+            print(f"Prometheus metrics on http://{self.args.listen}:{self.args.prometheus_port}/metrics")
+
+        await self.discover()
+        if not self.devices:
+            print("No boards found")
+        end = time.time() + self.args.duration if self.args.duration else None
+        cycle = 0
+        self.cycle_start = time.time()
+        try:
+            while end is None or time.time() < end:
+                if self.args.rediscover and cycle and cycle % self.args.rediscover == 0:
+                    await self.discover()
+                started = time.perf_counter()
+                late = self.late_polls
+                await asyncio.gather(*(self.poll_device(d, cycle) for d in list(self.devices.values())))
+                if self.csv_file:
+                    self.csv_file.flush()
+                if self.args.prometheus_file:
+                    self.write_prometheus_file()
+                up = sum(1 for d in self.devices.values() if d.error is None)
+                elapsed = time.perf_counter() - started
+                print(f"Cycle {cycle}: {up}/{len(self.devices)} boards up, {elapsed:.1f} s")
+                if self.late_polls > late:
+                    print(f"  {self.late_polls - late} polls started more than one interval late, "
+                          f"raise --concurrency or --interval")
+                cycle += 1
+        finally:
+            for device in self.devices.values():
+                device.drop_session()
+            if self.csv_file:
+                self.csv_file.close()
+            if server:
+                server.close()
+
+    def write_prometheus_file(self):
+        # Replaced in one rename, a scraping collector never reads half a file
+        temporary = self.args.prometheus_file + '.tmp'
+        with open(temporary, 'w') as output:
+            output.write(prometheus_text(self.devices.values()))
+        os.replace(temporary, self.args.prometheus_file)
+
+    async def serve_metrics(self, reader, writer):
+        try:
+            request = await asyncio.wait_for(reader.readline(), 5.0)
+            while (await asyncio.wait_for(reader.readline(), 5.0)) not in (b'\r\n', b'\n', b''):
+                pass
+            if request.split(b' ')[1:2] in ([b'/metrics'], [b'/']):
+                body = prometheus_text(self.devices.values()).encode()
+                writer.write(b"HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                             b"Content-Length: " + str(len(body)).encode() + b"\r\n\r\n" + body)
+            else:
+                writer.write(b"HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n")
+            await writer.drain()
+        except (OSError, asyncio.TimeoutError):
+            pass
+        finally:
+            writer.close()
+
+
+def parse_targets(args):
+    """Addresses of --targets and --targets-file, CIDR ranges expanded"""
+    entries = []
+    if args.targets:
+        entries += args.targets.split(',')
+    if args.targets_file:
+        with open(args.targets_file) as targets:
+            entries += [line.split('#')[0] for line in targets]
+    addresses = []
+    for entry in (e.strip() for e in entries):
+        if not entry:
+            continue
+        if '/' in entry:
+            addresses += [str(host) for host in ipaddress.ip_network(entry, strict=False).hosts()]
+        else:
+            addresses.append(entry)
+    return addresses
+
+
+def main():
+    parser = argparse.ArgumentParser(description='EtherNet/IP fleet health poller')
+    parser.add_argument('--targets', help='comma separated addresses or CIDR ranges of boards')
+    parser.add_argument('--targets-file', help='file with one address or CIDR range per line')
+    parser.add_argument('--broadcast', action='append',
+                        help='discover with ListIdentity to this broadcast address, may be repeated')
+    parser.add_argument('--mdns', action='store_true', help='discover _ethernet-ip._tcp with mDNS')
+    parser.add_argument('--discovery-wait', type=float, default=3.0,
+                        help='seconds to collect discovery replies (default: 3)')
+    parser.add_argument('--rediscover', type=int, default=0,
+                        help='discover again every N cycles, 0 = only at start (default: 0)')
+    parser.add_argument('--interval', type=float, default=10.0, help='seconds between polls of a board (default: 10)')
+    parser.add_argument('--duration', type=float, default=0.0, help='seconds to run, 0 = until Ctrl-C (default: 0)')
+    parser.add_argument('--concurrency', type=int, default=32, help='polls in flight at once (default: 32)')
+    parser.add_argument('--timeout', type=float, default=2.0, help='seconds to wait for a reply (default: 2)')
+    parser.add_argument('--max-reply', type=int, default=480,
+                        help='reply bytes one Multiple Service Packet may ask for (default: 480)')
+    parser.add_argument('--csv', help='append the samples to this CSV file')
+    parser.add_argument('--prometheus-file', help='write the latest samples to this file after each cycle')
+    parser.add_argument('--prometheus-port', type=int, help='serve the latest samples on this HTTP port')
+    parser.add_argument('--listen', default='0.0.0.0', help='address of the metrics server (default: 0.0.0.0)')
+    args = parser.parse_args()
+    args.target_list = parse_targets(args)
+    if not args.target_list and not args.broadcast and not args.mdns:
+        parser.error('give --targets, --targets-file, --broadcast or --mdns')
+
+    try:
+        asyncio.run(Poller(args).run())
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())